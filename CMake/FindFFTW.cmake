@@ -4,6 +4,8 @@
 #  FFTW_INCLUDES    - where to find fftw3.h
 #  FFTW_LIBRARIES   - List of libraries when using FFTW.
 #  FFTW_FOUND       - True if FFTW found.
+#  FFTW_MPI_LIBRARIES - FFTW's MPI interface library (if found).
+#  FFTW_THREADS_LIBRARIES - FFTW's threads library (if found).
 
 if (FFTW_INCLUDES)
   # Already in cache, be silent
@@ -40,9 +42,20 @@ if ((NOT FFTW_LIBRARIES) OR (NOT FFTW_INCLUDES))
   endif()
 endif()
 
+# FFTW's MPI interface is optional; look for it next to the serial library.
+if (FFTW_LIBRARIES)
+  get_filename_component(FFTW_MPI_LIB_HINT ${FFTW_LIBRARIES} PATH)
+  find_library (FFTW_MPI_LIBRARIES
+    NAMES fftw3_mpi
+    HINTS ${FFTW_MPI_LIB_HINT})
+  find_library (FFTW_THREADS_LIBRARIES
+    NAMES fftw3_threads
+    HINTS ${FFTW_MPI_LIB_HINT})
+endif()
+
 # handle the QUIETLY and REQUIRED arguments and set FFTW_FOUND to TRUE if
 # all listed variables are TRUE
 include (FindPackageHandleStandardArgs)
 find_package_handle_standard_args (FFTW DEFAULT_MSG FFTW_LIBRARIES FFTW_INCLUDES)
 
-mark_as_advanced (FFTW_LIBRARIES FFTW_INCLUDES)
+mark_as_advanced (FFTW_LIBRARIES FFTW_INCLUDES FFTW_MPI_LIBRARIES FFTW_THREADS_LIBRARIES)
@@ -164,6 +164,7 @@ macro(pism_find_prerequisites)
   find_package (NetCDF REQUIRED)
   find_package (FFTW REQUIRED)
   find_package (HDF5 COMPONENTS C HL)
+  find_package (Threads REQUIRED)
 
   # Optional libraries
   if (Pism_USE_PNETCDF)
@@ -178,6 +179,32 @@ macro(pism_find_prerequisites)
     find_package (ParallelIO REQUIRED)
   endif()
 
+  if (Pism_USE_FFTW_MPI)
+    if (NOT FFTW_MPI_LIBRARIES)
+      message(FATAL_ERROR
+        "Pism_USE_FFTW_MPI is ON but FFTW's MPI library (libfftw3_mpi) was not found.")
+    endif()
+  endif()
+
+  if (Pism_USE_FFTW_THREADS)
+    if (NOT FFTW_THREADS_LIBRARIES)
+      message(FATAL_ERROR
+        "Pism_USE_FFTW_THREADS is ON but FFTW's threads library (libfftw3_threads) was not found.")
+    endif()
+  endif()
+
+  if (Pism_USE_OPENMP)
+    find_package (OpenMP REQUIRED COMPONENTS CXX)
+  endif()
+
+  if (Pism_USE_PERF_EVENT)
+    find_file(PERF_EVENT_H linux/perf_event.h)
+    if (NOT PERF_EVENT_H)
+      message(FATAL_ERROR
+        "Pism_USE_PERF_EVENT is ON but linux/perf_event.h was not found.")
+    endif()
+  endif()
+
   if (Pism_USE_PARALLEL_NETCDF4)
     # Try to find netcdf_par.h. We assume that NetCDF was compiled with
     # parallel I/O if this header is present.
@@ -242,7 +269,8 @@ macro(pism_set_dependencies)
     ${NETCDF_LIBRARIES}
     ${MPI_C_LIBRARIES}
     ${HDF5_LIBRARIES}
-    ${HDF5_HL_LIBRARIES})
+    ${HDF5_HL_LIBRARIES}
+    ${CMAKE_THREAD_LIBS_INIT})
 
   # optional libraries
   if (Pism_USE_JANSSON)
@@ -265,6 +293,21 @@ macro(pism_set_dependencies)
     list (APPEND Pism_EXTERNAL_LIBS ${PNETCDF_LIBRARIES})
   endif()
 
+  if (Pism_USE_FFTW_MPI)
+    # libfftw3_mpi depends on libfftw3, so it has to go first
+    list (INSERT Pism_EXTERNAL_LIBS 0 ${FFTW_MPI_LIBRARIES})
+  endif()
+
+  if (Pism_USE_FFTW_THREADS)
+    # libfftw3_threads depends on libfftw3, so it has to go first
+    list (INSERT Pism_EXTERNAL_LIBS 0 ${FFTW_THREADS_LIBRARIES})
+  endif()
+
+  if (Pism_USE_OPENMP)
+    set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
+    list (APPEND Pism_EXTERNAL_LIBS ${OpenMP_CXX_LIBRARIES})
+  endif()
+
   # Hide distracting CMake variables
   mark_as_advanced(file_cmd MPI_LIBRARY MPI_EXTRA_LIBRARY
     HDF5_C_LIBRARY_dl HDF5_C_LIBRARY_hdf5 HDF5_C_LIBRARY_hdf5_hl HDF5_C_LIBRARY_m HDF5_C_LIBRARY_z
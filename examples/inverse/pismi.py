@@ -41,6 +41,38 @@ import sys, os, math
 
 class SSAForwardRun(PISM.invert.ssa.SSAForwardRunFromInputFile):
 
+    def __init__(self, input_filename, inv_data_filename, design_var, coarsening=1):
+        """
+        :param coarsening: use a grid that is `coarsening` times coarser than the one in the input file
+        """
+        PISM.invert.ssa.SSAForwardRunFromInputFile.__init__(self, input_filename, inv_data_filename, design_var)
+        self.coarsening = coarsening
+
+    def _initGrid(self):
+        if self.coarsening == 1:
+            PISM.invert.ssa.SSAForwardRunFromInputFile._initGrid(self)
+            return
+
+        if self.is_regional:
+            registration = PISM.CELL_CORNER
+        else:
+            registration = PISM.CELL_CENTER
+
+        ctx = PISM.Context()
+
+        # same domain, fewer grid points; all inputs are interpolated using regrid()
+        P = PISM.GridParameters(ctx.ctx, self.input_filename, "enthalpy", registration)
+        k = self.coarsening
+        if registration == PISM.CELL_CORNER:
+            P.Mx = (P.Mx - 1) // k + 1
+            P.My = (P.My - 1) // k + 1
+        else:
+            P.Mx = P.Mx // k
+            P.My = P.My // k
+        P.ownership_ranges_from_options(ctx.size)
+
+        self.grid = PISM.IceGrid(ctx.ctx, P)
+
     def write(self, filename, append=False):
         if not append:
             PISM.invert.ssa.SSAForwardRunFromInputFile.write(self, filename)
@@ -253,7 +285,14 @@ def createDesignVec(grid, design_var, name=None, **kwargs):
 
 
 # Main code starts here
-def run():
+def run(level=0, initial_guess=None):
+    """Solve the inverse problem.
+
+    :param level: grid level; level `n` uses a grid coarsened by the factor of `2**n`
+    :param initial_guess: name of the file containing the initial guess `zeta_inv`
+
+    Returns the name of the output file.
+    """
     context = PISM.Context()
     config = context.config
     com = context.com
@@ -339,9 +378,16 @@ def run():
     if output_filename is None:
         output_filename = "pismi_" + os.path.basename(input_filename)
 
+    if level > 0:
+        # results on coarse grids go to separate files
+        root, ext = os.path.splitext(output_filename)
+        output_filename = "%s_level_%d%s" % (root, level, ext)
+        append_mode = False
+
     saving_inv_data = (inv_data_filename != output_filename)
 
-    forward_run = SSAForwardRun(input_filename, inv_data_filename, design_var)
+    forward_run = SSAForwardRun(input_filename, inv_data_filename, design_var,
+                                coarsening=2**level)
     forward_run.setup()
     design_param = forward_run.designVariableParameterization()
     solver = PISM.invert.ssa.createInvSSASolver(forward_run)
@@ -411,7 +457,10 @@ def run():
     zeta = PISM.IceModelVec2S()
     zeta.create(grid, "zeta_inv", PISM.WITH_GHOSTS, WIDE_STENCIL)
     zeta.set_attrs("diagnostic", "zeta_inv", "1", "1", "zeta_inv", 0)
-    if do_restart:
+    if initial_guess is not None:
+        PISM.logging.logMessage("  Inversion starting from 'zeta_inv' found in %s\n" % initial_guess)
+        zeta.regrid(initial_guess, True)
+    elif do_restart:
         # Just to be sure, verify that we have a 'zeta_inv' in the output file.
         if not PISM.util.fileHasVariable(output_filename, 'zeta_inv'):
             PISM.verbPrintf(
@@ -580,9 +629,41 @@ def run():
     # Save the misfit history
     misfit_logger.write(output_filename)
 
+    PISM.logging.remove_logger(message_logger)
+
+    return output_filename
+
+
+def run_multilevel():
+    """Solve the inverse problem on a sequence of grids, from coarse to fine.
+
+    Each level uses the solution from the previous (coarser) level, interpolated using
+    regrid(), as the initial guess. The Tikhonov penalty weight on the level `n` is
+    multiplied by `inverse.multilevel.penalty_weight_factor**n`.
+    """
+    config = PISM.Context().config
+
+    n_levels = int(config.get_number("inverse.multilevel.levels"))
+    if PISM.OptionBool("-inv_restart", "Restart a stopped computation."):
+        # restarting refers to the finest grid
+        n_levels = 1
+
+    eta = config.get_number("inverse.tikhonov.penalty_weight")
+    factor = config.get_number("inverse.multilevel.penalty_weight_factor")
+
+    initial_guess = None
+    for level in reversed(range(n_levels)):
+        if n_levels > 1:
+            PISM.logging.logMessage("============== Grid level %d of %d ==================\n" %
+                                    (n_levels - level, n_levels))
+        config.set_number("inverse.tikhonov.penalty_weight", eta * factor**level)
+        initial_guess = run(level, initial_guess)
+
+    config.set_number("inverse.tikhonov.penalty_weight", eta)
+
 
 if __name__ == "__main__":
-    run()
+    run_multilevel()
 
 # try to stop coverage and save a report:
 try:                            # pragma: no cover
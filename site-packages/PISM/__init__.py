@@ -1,4 +1,4 @@
-# Copyright (C) 2011, 2014, 2015, 2016, 2018, 2019 David Maxwell and Constantine Khrulev
+# Copyright (C) 2011, 2014, 2015, 2016, 2018, 2019, 2020 David Maxwell and Constantine Khrulev
 #
 # This file is part of PISM.
 #
@@ -83,6 +83,10 @@ else:                           # pragma: no cover
         "Defined to build Sphinx docs."
         pass
 
+    class StepListener(object):
+        "Defined to build Sphinx docs."
+        pass
+
 import PISM.util
 import PISM.vec
 import PISM.ssa
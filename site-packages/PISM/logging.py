@@ -1,4 +1,4 @@
-# Copyright (C) 2012, 2015, 2016, 2018, 2019 David Maxwell
+# Copyright (C) 2012, 2015, 2016, 2018, 2019, 2020 David Maxwell
 #
 # This file is part of PISM.
 #
@@ -70,6 +70,12 @@ def add_logger(logger):
     _loggers.append(logger)
 
 
+def remove_logger(logger):
+    """Removes a logger from the global list of loggers."""
+    global _loggers
+    _loggers.remove(logger)
+
+
 def log(message, verbosity):
     """Logs a message with the specified verbosity"""
     for l in _loggers:
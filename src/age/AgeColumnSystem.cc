@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::min, std::max
+
 #include "AgeColumnSystem.hh"
 
 #include "pism/util/error_handling.hh"
@@ -50,15 +52,30 @@ void AgeColumnSystem::init(int i, int j, double thickness) {
     return;
   }
 
-  coarse_to_fine(m_u3, i, j, &m_u[0]);
-  coarse_to_fine(m_v3, i, j, &m_v[0]);
-  coarse_to_fine(m_w3, i, j, &m_w[0]);
+  velocity_to_fine(m_u3, i, j, &m_u[0]);
+  velocity_to_fine(m_v3, i, j, &m_v[0]);
+  velocity_to_fine(m_w3, i, j, &m_w[0]);
 
-  coarse_to_fine(m_age3, m_i, m_j,   &m_A[0]);
-  coarse_to_fine(m_age3, m_i, m_j+1, &m_A_n[0]);
-  coarse_to_fine(m_age3, m_i+1, m_j, &m_A_e[0]);
-  coarse_to_fine(m_age3, m_i, m_j-1, &m_A_s[0]);
-  coarse_to_fine(m_age3, m_i-1, m_j, &m_A_w[0]);
+  coarse_to_fine(m_age3, m_i, m_j,
+                 &m_A[0], &m_A_n[0], &m_A_e[0], &m_A_s[0], &m_A_w[0]);
+}
+
+/*!
+ * Initialize using ice velocity on the fine grid from `velocity`, a column system
+ * initialized for the same column (see columnSystemCtx::copy_velocity()).
+ */
+void AgeColumnSystem::init(int i, int j, double thickness,
+                           const columnSystemCtx &velocity, bool copy_w) {
+  init_column(i, j, thickness);
+
+  if (m_ks == 0) {
+    return;
+  }
+
+  copy_velocity(velocity, copy_w);
+
+  coarse_to_fine(m_age3, m_i, m_j,
+                 &m_A[0], &m_A_n[0], &m_A_e[0], &m_A_s[0], &m_A_w[0]);
 }
 
 //! First-order upwind scheme with implicit in the vertical: one column solve.
@@ -70,52 +87,7 @@ void AgeColumnSystem::solve(std::vector<double> &x) {
 
   TridiagonalSystem &S = *m_solver;
 
-  // set up system: 0 <= k < m_ks
-  for (unsigned int k = 0; k < m_ks; k++) {
-    // do lowest-order upwinding, explicitly for horizontal
-    S.RHS(k) =  (m_u[k] < 0 ?
-                 m_u[k] * (m_A_e[k] -  m_A[k]) / m_dx :
-                 m_u[k] * (m_A[k]  - m_A_w[k]) / m_dx);
-    S.RHS(k) += (m_v[k] < 0 ?
-                 m_v[k] * (m_A_n[k] -  m_A[k]) / m_dy :
-                 m_v[k] * (m_A[k]  - m_A_s[k]) / m_dy);
-    // note it is the age eqn: dage/dt = 1.0 and we have moved the hor.
-    //   advection terms over to right:
-    S.RHS(k) = m_A[k] + m_dt * (1.0 - S.RHS(k));
-
-    // do lowest-order upwinding, *implicitly* for vertical
-    double AA = m_nu * m_w[k];
-    if (k > 0) {
-      if (AA >= 0) { // upward velocity
-        S.L(k) = - AA;
-        S.D(k) = 1.0 + AA;
-        S.U(k) = 0.0;
-      } else { // downward velocity; note  -AA >= 0
-        S.L(k) = 0.0;
-        S.D(k) = 1.0 - AA;
-        S.U(k) = + AA;
-      }
-    } else { // k == 0 case
-      // note L[0] is not used
-      if (AA > 0) { // if strictly upward velocity apply boundary condition:
-                    // age = 0 because ice is being added to base
-        S.D(0) = 1.0;
-        S.U(0) = 0.0;
-        S.RHS(0) = 0.0;
-      } else { // downward velocity; note  -AA >= 0
-        S.D(0) = 1.0 - AA;
-        S.U(0) = + AA;
-        // keep rhs[0] as is
-      }
-    }
-  }  // done "set up system: 0 <= k < m_ks"
-
-  // surface b.c. at m_ks
-  if (m_ks > 0) {
-    S.L(m_ks) = 0;
-    S.D(m_ks) = 1.0;   // ignore U[m_ks]
-    S.RHS(m_ks) = 0.0;  // age zero at surface
-  }
+  assemble(&S.L(0), &S.D(0), &S.U(0), &S.RHS(0), 1);
 
   // solve it
   try {
@@ -135,4 +107,100 @@ void AgeColumnSystem::solve(std::vector<double> &x) {
   }
 }
 
+//! Set up the system in the lane `lane` of a batch, to be solved using
+//! TridiagonalSystemBatch::solve().
+/*!
+ * Use get_solution() to retrieve the result. The system will be identical to the one
+ * solved by solve().
+ */
+void AgeColumnSystem::assemble(TridiagonalSystemBatch &batch, unsigned int lane) {
+  const unsigned int W = batch.batch_size();
+
+  assemble(&batch.L(0, lane), &batch.D(0, lane), &batch.U(0, lane), &batch.RHS(0, lane), W);
+
+  batch.set_size(lane, m_ks + 1);
+}
+
+//! Copy the solution of the system in the lane `lane` of a batch to `x`.
+void AgeColumnSystem::get_solution(const TridiagonalSystemBatch &batch, unsigned int lane,
+                                   std::vector<double> &x) const {
+  x.resize(m_z.size());
+
+  for (unsigned int k = 0; k <= m_ks; ++k) {
+    x[k] = batch.x(k, lane);
+  }
+
+  // set age of ice above (and at) surface to zero years
+  for (unsigned int k = m_ks + 1; k < x.size(); k++) {
+    x[k] = 0.0;
+  }
+}
+
+//! Set up the tridiagonal system. Row `k` is stored at `k * stride`.
+/*!
+ * Upwinding is done by splitting each velocity component into its positive and negative
+ * parts instead of branching on its sign, so that the loop over levels can be vectorized.
+ * Only one of the two parts is non-zero, so this gives the same system as choosing the
+ * upwind neighbor.
+ */
+void AgeColumnSystem::assemble(double *L, double *D, double *U, double *RHS,
+                               unsigned int stride) {
+  const double
+    *u   = m_u.data(),
+    *v   = m_v.data(),
+    *w   = m_w.data(),
+    *A   = m_A.data(),
+    *A_n = m_A_n.data(),
+    *A_e = m_A_e.data(),
+    *A_s = m_A_s.data(),
+    *A_w = m_A_w.data();
+
+  // set up system: 0 <= k < m_ks
+  for (unsigned int k = 0; k < m_ks; k++) {
+    const unsigned int r = k * stride;
+
+    const double
+      u_plus  = std::max(u[k], 0.0),
+      u_minus = std::min(u[k], 0.0),
+      v_plus  = std::max(v[k], 0.0),
+      v_minus = std::min(v[k], 0.0);
+
+    // do lowest-order upwinding, explicitly for horizontal
+    double rhs = (u_minus * (A_e[k] - A[k]) / m_dx +
+                  u_plus  * (A[k] - A_w[k]) / m_dx);
+    rhs += (v_minus * (A_n[k] - A[k]) / m_dy +
+            v_plus  * (A[k] - A_s[k]) / m_dy);
+    // note it is the age eqn: dage/dt = 1.0 and we have moved the hor.
+    //   advection terms over to right:
+    RHS[r] = A[k] + m_dt * (1.0 - rhs);
+
+    // do lowest-order upwinding, *implicitly* for vertical
+    const double
+      AA       = m_nu * w[k],
+      AA_plus  = std::max(AA, 0.0),
+      AA_minus = std::min(AA, 0.0);
+
+    // note that L[0] is not used
+    L[r] = - AA_plus;
+    D[r] = 1.0 + AA_plus - AA_minus;
+    U[r] = + AA_minus;
+  }
+
+  // if the velocity at the base is strictly upward apply the boundary condition: age = 0
+  // because ice is being added to base
+  if (m_ks > 0 and m_nu * w[0] > 0) {
+    D[0]   = 1.0;
+    U[0]   = 0.0;
+    RHS[0] = 0.0;
+  }
+
+  // surface b.c. at m_ks
+  if (m_ks > 0) {
+    const unsigned int r = m_ks * stride;
+    L[r]   = 0;
+    D[r]   = 1.0;   // ignore U[m_ks]
+    RHS[r] = 0.0;   // age zero at surface
+  }
+}
+
 } // end of namespace pism
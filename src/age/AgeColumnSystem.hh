@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -36,9 +36,16 @@ public:
                   const IceModelVec3 &w3);
 
   void init(int i, int j, double thickness);
+  void init(int i, int j, double thickness, const columnSystemCtx &velocity, bool copy_w);
 
   void solve(std::vector<double> &x);
+
+  void assemble(TridiagonalSystemBatch &batch, unsigned int lane);
+  void get_solution(const TridiagonalSystemBatch &batch, unsigned int lane,
+                    std::vector<double> &x) const;
 protected:
+  void assemble(double *L, double *D, double *U, double *RHS, unsigned int stride);
+
   const IceModelVec3 &m_age3;
   double m_nu;
   std::vector<double> m_A, m_A_n, m_A_e, m_A_s, m_A_w;
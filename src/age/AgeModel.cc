@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,9 +17,14 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::min, std::max, std::upper_bound
+#include <cmath>                // std::floor
+#include <memory>               // std::unique_ptr
+
 #include "AgeModel.hh"
 
 #include "pism/age/AgeColumnSystem.hh"
+#include "pism/util/ColumnInterpolation.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/io/File.hh"
@@ -30,7 +35,7 @@ AgeModelInputs::AgeModelInputs(const IceModelVec2S *thickness,
                                const IceModelVec3 *u,
                                const IceModelVec3 *v,
                                const IceModelVec3 *w)
-  : ice_thickness(thickness), u3(u), v3(v), w3(w) {
+  : ice_thickness(thickness), u3(u), v3(v), w3(w), cell_type(NULL) {
   // empty
 }
 
@@ -39,6 +44,7 @@ AgeModelInputs::AgeModelInputs() {
   u3            = NULL;
   v3            = NULL;
   w3            = NULL;
+  cell_type     = NULL;
 }
 
 static void check_input(const IceModelVec *ptr, const char *name) {
@@ -60,7 +66,22 @@ AgeModel::AgeModel(IceGrid::ConstPtr grid, stressbalance::StressBalance *stress_
     // FIXME: should be able to use width=1...
     m_ice_age(m_grid, "age", WITH_GHOSTS, m_config->get_number("grid.max_stencil_width")),
     m_work(m_grid, "work_vector", WITHOUT_GHOSTS),
-    m_stress_balance(stress_balance) {
+    m_stress_balance(stress_balance),
+    m_active_cells(*m_grid),
+    m_n_skipped(0),
+    m_dt_skipped(0.0) {
+
+  m_semi_lagrangian = m_config->get_string("age.method") == "semi_lagrangian";
+
+  {
+    int N = m_config->get_number("age.semi_lagrangian.update_interval");
+    if (N < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "age.semi_lagrangian.update_interval = %d is invalid"
+                                    " (has to be 1 or greater)", N);
+    }
+    m_update_interval = N;
+  }
 
   m_ice_age.set_attrs("model_state", "age of ice",
                       "s", "years", "" /* no standard name*/, 0);
@@ -104,6 +125,8 @@ calculation.  Note that the columnSystemCtx methods coarse_to_fine() and
 fine_to_coarse() interpolate back and forth between this fine grid and
 the storage grid.  The storage grid may or may not be equally-spaced.  See
 AgeColumnSystem::solve() for the actual method.
+
+If `age.method` is `semi_lagrangian` this method calls update_semi_lagrangian() instead.
  */
 void AgeModel::update(double t, double dt, const AgeModelInputs &inputs) {
 
@@ -112,53 +135,323 @@ void AgeModel::update(double t, double dt, const AgeModelInputs &inputs) {
 
   inputs.check();
 
+  if (m_semi_lagrangian) {
+    m_n_skipped  += 1;
+    m_dt_skipped += dt;
+
+    if (m_n_skipped == m_update_interval) {
+      update_semi_lagrangian(m_dt_skipped, inputs);
+
+      m_n_skipped  = 0;
+      m_dt_skipped = 0.0;
+    }
+    return;
+  }
+
   const IceModelVec2S &ice_thickness = *inputs.ice_thickness;
 
+  ColumnUpdate column(*this, dt, inputs, 1);
+
+  IceModelVec::AccessList list{&ice_thickness};
+
+  ParallelSection loop(m_grid->com);
+  try {
+    if (inputs.cell_type != NULL) {
+      m_active_cells.update(*inputs.cell_type);
+
+      const Tiles &tiles = m_active_cells.tiles();
+      for (unsigned int k = 0; k < tiles.size(); ++k) {
+        for (auto c : m_active_cells.active(tiles[k])) {
+          column.update(0, c.i, c.j, ice_thickness(c.i, c.j));
+        }
+
+        for (auto c : m_active_cells.inactive(tiles[k])) {
+          if (ice_thickness(c.i, c.j) / column.dz() < 1.0) {
+            // same as update() if the column system has ks == 0
+            column.set_ice_free(c.i, c.j);
+          } else {
+            // an ice-free cell (according to the mask) can still contain a thin layer of
+            // ice
+            column.update(0, c.i, c.j, ice_thickness(c.i, c.j));
+          }
+        }
+      }
+    } else {
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        column.update(0, i, j, ice_thickness(i, j));
+      }
+    }
+
+    column.flush(0);
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+
+  column.finish();
+}
+
+//! Column systems, the batch and the work space used by one thread.
+struct AgeModel::ColumnUpdate::Slot {
+  Slot(unsigned int Mz_fine, unsigned int batch_size)
+    : batch(Mz_fine, batch_size), columns(batch_size), n_columns(0), x(Mz_fine) {
+    // empty
+  }
+
+  // one column system per lane of the batch
+  std::vector<std::unique_ptr<AgeColumnSystem> > systems;
+  TridiagonalSystemBatch batch;
+  // indexes of columns in the current batch
+  std::vector<std::pair<int, int> > columns;
+  unsigned int n_columns;
+  // space for solution
+  std::vector<double> x;
+};
+
+AgeModel::ColumnUpdate::ColumnUpdate(AgeModel &model, double dt,
+                                     const AgeModelInputs &inputs,
+                                     unsigned int n_slots)
+  : m_model(model) {
+
+  inputs.check();
+
+  IceGrid::ConstPtr grid = m_model.grid();
+
+  // systems in columns are solved in batches of batch_size columns
+  const unsigned int batch_size = 16;
+
+  for (unsigned int k = 0; k < n_slots; ++k) {
+    std::vector<std::unique_ptr<AgeColumnSystem> > systems;
+    for (unsigned int l = 0; l < batch_size; ++l) {
+      // linear system to solve in each column
+      systems.emplace_back(new AgeColumnSystem(grid->z(), "age",
+                                               grid->dx(), grid->dy(), dt,
+                                               m_model.m_ice_age,
+                                               *inputs.u3, *inputs.v3, *inputs.w3));
+    }
+
+    m_slots.emplace_back(new Slot(systems[0]->z().size(), batch_size));
+    m_slots.back()->systems = std::move(systems);
+  }
+
+  m_list.add({inputs.u3, inputs.v3, inputs.w3, &m_model.m_ice_age, &m_model.m_work});
+}
+
+AgeModel::ColumnUpdate::~ColumnUpdate() {
+  // empty
+}
+
+//! Vertical spacing of the fine grid.
+double AgeModel::ColumnUpdate::dz() const {
+  return m_slots[0]->systems[0]->dz();
+}
+
+//! Update age in the column `i, j`.
+void AgeModel::ColumnUpdate::update(unsigned int slot, int i, int j, double ice_thickness) {
+  Slot &s = *m_slots[slot];
+
+  s.systems[s.n_columns]->init(i, j, ice_thickness);
+  add(slot, i, j);
+}
+
+//! Update age in the column `i, j` using ice velocity from `velocity` (see
+//! AgeColumnSystem::init()).
+void AgeModel::ColumnUpdate::update(unsigned int slot, int i, int j, double ice_thickness,
+                                    const columnSystemCtx &velocity, bool copy_w) {
+  Slot &s = *m_slots[slot];
+
+  s.systems[s.n_columns]->init(i, j, ice_thickness, velocity, copy_w);
+  add(slot, i, j);
+}
+
+//! Set age in the ice-free column `i, j`.
+void AgeModel::ColumnUpdate::set_ice_free(int i, int j) {
+  m_model.m_work.set_column(i, j, 0.0);
+}
+
+//! Add the column `i, j` (initialized using the next available column system of `slot`)
+//! to the current batch.
+void AgeModel::ColumnUpdate::add(unsigned int slot_index, int i, int j) {
+  Slot &slot = *m_slots[slot_index];
+  AgeColumnSystem &system = *slot.systems[slot.n_columns];
+
+  if (system.ks() == 0) {
+    // if no ice, set the entire column to zero age
+    set_ice_free(i, j);
+    return;
+  }
+
+  // general case: solve advection PDE
+  system.assemble(slot.batch, slot.n_columns);
+
+  slot.columns[slot.n_columns] = {i, j};
+  slot.n_columns += 1;
+
+  if (slot.n_columns == slot.systems.size()) {
+    flush(slot_index);
+  }
+}
+
+//! Solve systems in the current batch of `slot` and store results.
+void AgeModel::ColumnUpdate::flush(unsigned int slot) {
+  Slot &s = *m_slots[slot];
+
+  if (s.n_columns == 0) {
+    return;
+  }
+
+  const int failed = s.batch.solve(s.n_columns);
+  if (failed >= 0) {
+    // solve this system again to get an informative error message
+    s.systems[failed]->solve(s.x);
+
+    throw RuntimeError(PISM_ERROR_LOCATION, "failed to solve a tridiagonal system");
+  }
+
+  const unsigned int Mz = m_model.grid()->Mz();
+
+  for (unsigned int lane = 0; lane < s.n_columns; ++lane) {
+    const int
+      i = s.columns[lane].first,
+      j = s.columns[lane].second;
+
+    s.systems[lane]->get_solution(s.batch, lane, s.x);
+
+    // put solution in IceModelVec3
+    s.systems[lane]->fine_to_coarse(s.x, i, j, m_model.m_work);
+
+    // Ensure that the age of the ice is non-negative.
+    //
+    // FIXME: this is a kludge. We need to ensure that our numerical method has the maximum
+    // principle instead. (We may still need this for correctness, though.)
+    double *column = m_model.m_work.get_column(i, j);
+    for (unsigned int k = 0; k < Mz; ++k) {
+      if (column[k] < 0.0) {
+        column[k] = 0.0;
+      }
+    }
+  }
+
+  s.n_columns = 0;
+}
+
+//! Finish the update (call this after updating all columns and calling flush() for each slot).
+void AgeModel::ColumnUpdate::finish() {
+  m_model.m_work.update_ghosts(m_model.m_ice_age);
+}
+
+/*!
+ * Semi-Lagrangian age update: the new age at a grid point is the old age at the departure
+ * point plus `dt`.
+ *
+ * The departure point is found by tracing back along the ice velocity at the grid point
+ * (one backward Euler step), so this method is unconditionally stable. Old age is
+ * interpolated at the departure point using bilinear interpolation in the horizontal and
+ * linear interpolation in the vertical. Ice entering through the base (departure points
+ * below the base) has age zero. Departure points above the ice surface pick up the age
+ * stored above the surface (zero).
+ *
+ * Departure points are limited to the ghost region of the age field (of width
+ * `grid.max_stencil_width`), limiting the horizontal distance traveled in one update.
+ */
+void AgeModel::update_semi_lagrangian(double dt, const AgeModelInputs &inputs) {
+  const IceModelVec2S &ice_thickness = *inputs.ice_thickness;
   const IceModelVec3
     &u3 = *inputs.u3,
     &v3 = *inputs.v3,
     &w3 = *inputs.w3;
 
-  AgeColumnSystem system(m_grid->z(), "age",
-                         m_grid->dx(), m_grid->dy(), dt,
-                         m_ice_age, u3, v3, w3); // linear system to solve in each column
+  const std::vector<double> &z = m_grid->z();
+
+  const unsigned int Mz = z.size();
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy(),
+    W  = m_ice_age.stencil_width(),
+    z_max = z.back();
+
+  // 3D velocity may use a subset of grid levels (see stress_balance.Mz): interpolate it
+  // to grid levels if necessary
+  const bool all_levels = (u3.levels().size() == Mz);
+  std::unique_ptr<ColumnInterpolation> interp;
+  std::vector<double> u_column, v_column, w_column;
+  if (not all_levels) {
+    interp.reset(new ColumnInterpolation(u3.levels(), z));
+    u_column.resize(Mz);
+    v_column.resize(Mz);
+    w_column.resize(Mz);
+  }
 
-  size_t Mz_fine = system.z().size();
-  std::vector<double> x(Mz_fine);   // space for solution
+  // Location of a departure point relative to the grid point (i, j): the offset of the
+  // lower-left corner of the cell containing it and the weight of the next grid point in
+  // this cell.
+  auto offset = [W](double distance, double spacing, int &shift, double &weight) {
+    double x = std::max(std::min(distance / spacing, W), -W);
 
-  IceModelVec::AccessList list{&ice_thickness, &u3, &v3, &w3, &m_ice_age, &m_work};
+    shift = std::min((int)std::floor(x), (int)W - 1);
+    weight = x - shift;
+  };
 
-  unsigned int Mz = m_grid->Mz();
+  IceModelVec::AccessList list{&ice_thickness, &u3, &v3, &w3, &m_ice_age, &m_work};
 
   ParallelSection loop(m_grid->com);
   try {
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      system.init(i, j, ice_thickness(i, j));
+      const double H = ice_thickness(i, j);
 
-      if (system.ks() == 0) {
-        // if no ice, set the entire column to zero age
-        m_work.set_column(i, j, 0.0);
-      } else {
-        // general case: solve advection PDE
+      const double
+        *u = u3.get_column(i, j),
+        *v = v3.get_column(i, j),
+        *w = w3.get_column(i, j);
 
-        // solve the system for this column; call checks that params set
-        system.solve(x);
+      if (not all_levels) {
+        interp->coarse_to_fine(u, Mz - 1, u_column.data());
+        interp->coarse_to_fine(v, Mz - 1, v_column.data());
+        interp->coarse_to_fine(w, Mz - 1, w_column.data());
+        u = u_column.data();
+        v = v_column.data();
+        w = w_column.data();
+      }
 
-        // put solution in IceModelVec3
-        system.fine_to_coarse(x, i, j, m_work);
+      double *result = m_work.get_column(i, j);
 
-        // Ensure that the age of the ice is non-negative.
-        //
-        // FIXME: this is a kludge. We need to ensure that our numerical method has the maximum
-        // principle instead. (We may still need this for correctness, though.)
-        double *column = m_work.get_column(i, j);
-        for (unsigned int k = 0; k < Mz; ++k) {
-          if (column[k] < 0.0) {
-            column[k] = 0.0;
-          }
+      for (unsigned int k = 0; k < Mz; ++k) {
+        if (z[k] > H) {
+          // ice-free (above the surface)
+          result[k] = 0.0;
+          continue;
+        }
+
+        const double z_d = z[k] - w[k] * dt;
+        if (z_d < 0.0) {
+          // ice added to the base
+          result[k] = std::min(z[k] / (z[k] - z_d), 1.0) * dt;
+          continue;
         }
+
+        int di = 0, dj = 0;
+        double wx = 0.0, wy = 0.0;
+        offset(-u[k] * dt, dx, di, wx);
+        offset(-v[k] * dt, dy, dj, wy);
+
+        // the level below the departure point
+        unsigned int m = std::upper_bound(z.begin(), z.end(), std::min(z_d, z_max)) - z.begin();
+        m = std::min(std::max(m, 1u), Mz - 1) - 1;
+        const double wz = std::min((z_d - z[m]) / (z[m + 1] - z[m]), 1.0);
+
+        auto column = [&](int a, int b) {
+          const double *A = m_ice_age.get_column(i + di + a, j + dj + b);
+          return (1.0 - wz) * A[m] + wz * A[m + 1];
+        };
+
+        const double age_d = ((1.0 - wy) * ((1.0 - wx) * column(0, 0) + wx * column(1, 0)) +
+                              wy * ((1.0 - wx) * column(0, 1) + wx * column(1, 1)));
+
+        result[k] = std::max(age_d, 0.0) + dt;
       }
     }
   } catch (...) {
@@ -173,10 +466,20 @@ const IceModelVec3 & AgeModel::age() const {
   return m_ice_age;
 }
 
+//! Returns true if this model updates age column by column (see ColumnUpdate).
+bool AgeModel::column_based() const {
+  return not m_semi_lagrangian;
+}
+
 MaxTimestep AgeModel::max_timestep_impl(double t) const {
   // fix a compiler warning
   (void) t;
 
+  if (m_semi_lagrangian) {
+    // the semi-Lagrangian method is unconditionally stable
+    return MaxTimestep("age model");
+  }
+
   if (m_stress_balance == NULL) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
                                   "AgeModel: no stress balance provided."
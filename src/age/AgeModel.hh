@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -22,10 +22,14 @@
 
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/Component.hh"
+#include "pism/util/ActiveCellList.hh"
 #include "pism/stressbalance/StressBalance.hh"
 
 namespace pism {
 
+class AgeColumnSystem;
+class columnSystemCtx;
+
 class AgeModelInputs {
 public:
   AgeModelInputs();
@@ -39,6 +43,9 @@ public:
   const IceModelVec3 *u3;
   const IceModelVec3 *v3;
   const IceModelVec3 *w3;
+
+  //! optional; used to skip ice-free columns if set
+  const IceModelVec2CellType *cell_type;
 };
 
 class AgeModel : public Component {
@@ -50,14 +57,65 @@ public:
   void init(const InputOptions &opts);
 
   const IceModelVec3 & age() const;
+
+  bool column_based() const;
+
+  //! Updates age column by column.
+  /*!
+   * This makes it possible to update age as a part of a sweep over columns done by
+   * another model (see energy::EnthalpyModel), re-using ice velocity interpolated onto
+   * the fine vertical grid by that model.
+   *
+   * Columns may be updated concurrently if each thread uses its own `slot`.
+   *
+   * Systems in columns are solved in batches (see TridiagonalSystemBatch), so the new age
+   * in a column is available only after the batch is full or flush() is called.
+   */
+  class ColumnUpdate {
+  public:
+    ColumnUpdate(AgeModel &model, double dt, const AgeModelInputs &inputs,
+                 unsigned int n_slots);
+    ~ColumnUpdate();
+
+    void update(unsigned int slot, int i, int j, double ice_thickness);
+    void update(unsigned int slot, int i, int j, double ice_thickness,
+                const columnSystemCtx &velocity, bool copy_w);
+    void set_ice_free(int i, int j);
+
+    void flush(unsigned int slot);
+
+    double dz() const;
+
+    void finish();
+  private:
+    struct Slot;
+
+    void add(unsigned int slot, int i, int j);
+
+    AgeModel &m_model;
+    IceModelVec::AccessList m_list;
+    std::vector<std::unique_ptr<Slot> > m_slots;
+  };
 protected:
   MaxTimestep max_timestep_impl(double t) const;
   void define_model_state_impl(const File &output) const;
   void write_model_state_impl(const File &output) const;
 
+  void update_semi_lagrangian(double dt, const AgeModelInputs &inputs);
+
   IceModelVec3 m_ice_age;
   IceModelVec3 m_work;
   stressbalance::StressBalance *m_stress_balance;
+  ActiveCellList m_active_cells;
+
+  //! true if using the semi-Lagrangian method (see update_semi_lagrangian())
+  bool m_semi_lagrangian;
+  //! number of calls to update() between semi-Lagrangian age updates
+  unsigned int m_update_interval;
+  //! number of calls to update() since the last age update
+  unsigned int m_n_skipped;
+  //! time since the last age update
+  double m_dt_skipped;
 };
 
 } // end of namespace pism
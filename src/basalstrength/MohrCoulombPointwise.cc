@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -48,9 +48,18 @@ double MohrCoulombPointwise::yield_stress(double delta,
                                           double water_thickness,
                                           double phi) const {
 
+  return yield_stress_tan_phi(delta, P_overburden, water_thickness,
+                              tan((M_PI / 180.0) * phi));
+}
+
+double MohrCoulombPointwise::yield_stress_tan_phi(double delta,
+                                                  double P_overburden,
+                                                  double water_thickness,
+                                                  double tan_phi) const {
+
   double N_till = effective_pressure(delta, P_overburden, water_thickness);
 
-  return m_till_cohesion + N_till * tan((M_PI / 180.0) * phi);
+  return m_till_cohesion + N_till * tan_phi;
 }
 
 double MohrCoulombPointwise::till_friction_angle(double delta,
@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -45,6 +45,24 @@ public:
                       double water_thickness,
                       double phi) const;
 
+  /*!
+   * Compute basal yield stress using the tangent of the till friction angle.
+   *
+   * Same as `yield_stress()`, but avoids computing `tan(phi)` when the till friction angle
+   * does not change.
+   *
+   * @param[in] delta fraction of overburden pressure
+   * @param[in] P_overburden overburden pressure (Pa)
+   * @param[in] water_thickness till water thickness (m)
+   * @param[in] tan_phi tangent of the till friction angle
+   *
+   * returns basal yield stress in Pascal
+   */
+  double yield_stress_tan_phi(double delta,
+                              double P_overburden,
+                              double water_thickness,
+                              double tan_phi) const;
+
   /*!
    * Inverse of `yield_stress()`.
    *
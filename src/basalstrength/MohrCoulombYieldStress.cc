@@ -16,6 +16,8 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cmath>                // tan
+
 #include "MohrCoulombYieldStress.hh"
 #include "MohrCoulombPointwise.hh"
 
@@ -88,7 +90,9 @@ read-in-from-file state or with a default constant value from the config file.
 */
 MohrCoulombYieldStress::MohrCoulombYieldStress(IceGrid::ConstPtr grid)
   : YieldStress(grid),
-  m_till_phi(m_grid, "tillphi", WITHOUT_GHOSTS) {
+  m_till_phi(m_grid, "tillphi", WITHOUT_GHOSTS),
+  m_tan_till_phi(m_grid, "tan_tillphi", WITHOUT_GHOSTS),
+  m_tan_till_phi_memo(m_grid->ctx()->memo(), "basal_yield_stress.tan_tillphi") {
 
   m_name = "Mohr-Coulomb yield stress model";
 
@@ -295,7 +299,22 @@ void MohrCoulombYieldStress::update_impl(const YieldStressInputs &inputs,
   const IceModelVec2S        &bed_topography = inputs.geometry->bed_elevation;
   const IceModelVec2S        &sea_level      = inputs.geometry->sea_level_elevation;
 
-  IceModelVec::AccessList list{&W_till, &m_till_phi, &m_basal_yield_stress, &cell_type,
+  // the till friction angle is usually time-independent: compute tan(phi) only when it
+  // changes
+  std::vector<int> key{m_till_phi.state_counter()};
+  if (not m_tan_till_phi_memo.up_to_date(key)) {
+    IceModelVec::AccessList list{&m_till_phi, &m_tan_till_phi};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_tan_till_phi(i, j) = tan((M_PI / 180.0) * m_till_phi(i, j));
+    }
+
+    m_tan_till_phi_memo.set(key);
+  }
+
+  IceModelVec::AccessList list{&W_till, &m_tan_till_phi, &m_basal_yield_stress, &cell_type,
                                &bed_topography, &sea_level, &ice_thickness};
 
   if (add_transportable_water) {
@@ -328,8 +347,9 @@ void MohrCoulombYieldStress::update_impl(const YieldStressInputs &inputs,
 
       double P_overburden = ice_density * standard_gravity * ice_thickness(i, j);
 
-      m_basal_yield_stress(i, j) = mc.yield_stress(m_delta ? (*m_delta)(i, j) : delta,
-                                                   P_overburden, water, m_till_phi(i, j));
+      m_basal_yield_stress(i, j) = mc.yield_stress_tan_phi(m_delta ? (*m_delta)(i, j) : delta,
+                                                           P_overburden, water,
+                                                           m_tan_till_phi(i, j));
     }
   }
 
@@ -397,6 +417,8 @@ void MohrCoulombYieldStress::till_friction_angle(const IceModelVec2S &bed_topogr
     }
   }
 
+  result.inc_state_counter();   // mark as modified
+
   // communicate ghosts so that the tauc computation can be performed locally
   // (including ghosts of tauc, that is)
   result.update_ghosts();
@@ -442,6 +464,8 @@ void MohrCoulombYieldStress::till_friction_angle(const IceModelVec2S &basal_yiel
     }
   }
 
+  result.inc_state_counter();   // mark as modified
+
   result.update_ghosts();
 }
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -23,6 +23,7 @@
 
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/iceModelVec2T.hh"
+#include "pism/util/Memo.hh"
 
 namespace pism {
 
@@ -62,6 +63,11 @@ private:
 
   IceModelVec2S m_till_phi;
 
+  //! tangent of the till friction angle (updated when `m_till_phi` changes)
+  IceModelVec2S m_tan_till_phi;
+  //! state counter of `m_till_phi` corresponding to `m_tan_till_phi`
+  Memo m_tan_till_phi_memo;
+
   IceModelVec2T::Ptr m_delta;
 };
 
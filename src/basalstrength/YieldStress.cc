@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <cmath>                // NAN, std::isnan
+
 #include "YieldStress.hh"
 
 #include "pism/util/ConfigInterface.hh"
@@ -34,7 +36,9 @@ YieldStressInputs::YieldStressInputs() {
 YieldStress::YieldStress(IceGrid::ConstPtr g)
   : Component(g),
   m_basal_yield_stress(m_grid, "tauc", WITH_GHOSTS,
-                       m_config->get_number("grid.max_stencil_width")) {
+                       m_config->get_number("grid.max_stencil_width")),
+  m_update_interval(m_config->get_number("basal_yield_stress.update_interval", "seconds")),
+  m_t_last(NAN) {
 
   // PROPOSED standard_name = land_ice_basal_material_yield_stress
   m_basal_yield_stress.set_attrs("model_state",
@@ -76,9 +80,22 @@ void YieldStress::init(const YieldStressInputs &inputs) {
 
 /*!
  * Update a yield stress model.
+ *
+ * If `basal_yield_stress.update_interval` is positive, updates are skipped until the end
+ * of the current time step is at least one update interval past the last update. The
+ * yield stress changes slowly compared to the ice geometry, so this saves computation
+ * without restricting the time step.
  */
 void YieldStress::update(const YieldStressInputs &inputs, double t, double dt) {
+  if (m_update_interval > 0.0 and
+      not std::isnan(m_t_last) and
+      t + dt < m_t_last + m_update_interval) {
+    return;
+  }
+
   this->update_impl(inputs, t, dt);
+
+  m_t_last = t;
 }
 
 const IceModelVec2S& YieldStress::basal_material_yield_stress() {
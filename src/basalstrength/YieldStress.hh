@@ -75,6 +75,11 @@ protected:
   IceModelVec2S m_basal_yield_stress;
 
   std::string m_name;
+
+  //! minimum time between updates, in seconds (zero: update every time step)
+  double m_update_interval;
+  //! time of the last update (NAN if not updated yet)
+  double m_t_last;
 };
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2017, 2019 Jed Brown, Ed Bueler, and Constantine Khroulev
+// Copyright (C) 2004-2017, 2019, 2020 Jed Brown, Ed Bueler, and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -16,7 +16,7 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
-#include <cmath>                // pow, sqrt
+#include <cmath>                // pow, sqrt, cbrt, fabs
 
 #include "basal_resistance.hh"
 
@@ -72,6 +72,35 @@ void IceBasalResistancePlasticLaw::drag_with_derivative(double tauc, double vx,
   }
 }
 
+//! Compute drag coefficients at `n` points.
+void IceBasalResistancePlasticLaw::drag_n(const double *tauc, const Vector2 *velocity,
+                                          unsigned int n, double *result) const {
+  drag_with_derivative_n(tauc, velocity, n, result, nullptr);
+}
+
+//! Compute drag coefficients and their derivatives at `n` points.
+/*!
+ * Set `dbeta` to NULL if derivatives are not needed.
+ */
+void IceBasalResistancePlasticLaw::drag_with_derivative_n(const double *tauc,
+                                                          const Vector2 *velocity,
+                                                          unsigned int n,
+                                                          double *beta, double *dbeta) const {
+  const double eps2 = square(m_plastic_regularize);
+
+  for (unsigned int k = 0; k < n; ++k) {
+    const double magreg2 = eps2 + square(velocity[k].u) + square(velocity[k].v);
+    beta[k] = tauc[k] / sqrt(magreg2);
+  }
+
+  if (dbeta) {
+    for (unsigned int k = 0; k < n; ++k) {
+      const double magreg2 = eps2 + square(velocity[k].u) + square(velocity[k].v);
+      dbeta[k] = -1 * beta[k] / magreg2;
+    }
+  }
+}
+
 /* Pseudo-plastic */
 
 IceBasalResistancePseudoPlasticLaw::IceBasalResistancePseudoPlasticLaw(const Config &config)
@@ -79,6 +108,19 @@ IceBasalResistancePseudoPlasticLaw::IceBasalResistancePseudoPlasticLaw(const Con
   m_pseudo_q = config.get_number("basal_resistance.pseudo_plastic.q");
   m_pseudo_u_threshold = config.get_number("basal_resistance.pseudo_plastic.u_threshold", "m second-1");
   m_sliding_scale_factor_reduces_tauc = config.get_number("basal_resistance.pseudo_plastic.sliding_scale_factor");
+
+  const double q = m_pseudo_q;
+  if (q == 0.0) {
+    m_exponent = PLASTIC;
+  } else if (q == 0.25) {
+    m_exponent = ONE_QUARTER;
+  } else if (fabs(q - 1.0 / 3.0) < 1e-12) {
+    m_exponent = ONE_THIRD;
+  } else if (q == 1.0) {
+    m_exponent = LINEAR;
+  } else {
+    m_exponent = GENERAL;
+  }
 }
 
 IceBasalResistancePseudoPlasticLaw::~IceBasalResistancePseudoPlasticLaw() {
@@ -194,4 +236,97 @@ void IceBasalResistancePseudoPlasticLaw::drag_with_derivative(double tauc, doubl
 
 }
 
+//! Compute drag coefficients at `n` points.
+void IceBasalResistancePseudoPlasticLaw::drag_n(const double *tauc, const Vector2 *velocity,
+                                                unsigned int n, double *result) const {
+  drag_with_derivative_n(tauc, velocity, n, result, nullptr);
+}
+
+//! Compute drag coefficients and their derivatives at `n` points.
+/*!
+ * Set `dbeta` to NULL if derivatives are not needed.
+ *
+ * Uses sqrt() and cbrt() instead of pow() for common values of
+ * `basal_resistance.pseudo_plastic.q`.
+ */
+void IceBasalResistancePseudoPlasticLaw::drag_with_derivative_n(const double *tauc,
+                                                                const Vector2 *velocity,
+                                                                unsigned int n,
+                                                                double *beta,
+                                                                double *dbeta) const {
+  switch (m_exponent) {
+  case PLASTIC:
+    drag_n_impl<PLASTIC>(tauc, velocity, n, beta, dbeta);
+    break;
+  case ONE_QUARTER:
+    drag_n_impl<ONE_QUARTER>(tauc, velocity, n, beta, dbeta);
+    break;
+  case ONE_THIRD:
+    drag_n_impl<ONE_THIRD>(tauc, velocity, n, beta, dbeta);
+    break;
+  case LINEAR:
+    drag_n_impl<LINEAR>(tauc, velocity, n, beta, dbeta);
+    break;
+  case GENERAL:
+  default:
+    drag_n_impl<GENERAL>(tauc, velocity, n, beta, dbeta);
+  }
+}
+
+template<IceBasalResistancePseudoPlasticLaw::Exponent E>
+void IceBasalResistancePseudoPlasticLaw::drag_n_impl(const double *tauc,
+                                                     const Vector2 *velocity,
+                                                     unsigned int n,
+                                                     double *beta,
+                                                     double *dbeta) const {
+  const double
+    q    = m_pseudo_q,
+    eps2 = square(m_plastic_regularize);
+
+  // the factor multiplying tauc * (|u|^2)^((q - 1) / 2)
+  double C = pow(m_pseudo_u_threshold, -q);
+  if (m_sliding_scale_factor_reduces_tauc > 0.0) {
+    C /= pow(m_sliding_scale_factor_reduces_tauc, q);
+  }
+
+  for (unsigned int k = 0; k < n; ++k) {
+    const double magreg2 = eps2 + square(velocity[k].u) + square(velocity[k].v);
+
+    // (|u|^2)^((q - 1) / 2)
+    double F = 0.0;
+    switch (E) {
+    case PLASTIC:
+      F = 1.0 / sqrt(magreg2);
+      break;
+    case ONE_QUARTER:
+      {
+        // (|u|^2)^(-3/8) = 1 / ((|u|^2)^(1/4) * (|u|^2)^(1/8))
+        const double
+          r4 = sqrt(sqrt(magreg2)),
+          r8 = sqrt(r4);
+        F = 1.0 / (r4 * r8);
+      }
+      break;
+    case ONE_THIRD:
+      F = 1.0 / cbrt(magreg2);
+      break;
+    case LINEAR:
+      F = 1.0;
+      break;
+    case GENERAL:
+    default:
+      F = pow(magreg2, 0.5 * (q - 1));
+    }
+
+    beta[k] = C * tauc[k] * F;
+  }
+
+  if (dbeta) {
+    for (unsigned int k = 0; k < n; ++k) {
+      const double magreg2 = eps2 + square(velocity[k].u) + square(velocity[k].v);
+      dbeta[k] = (q - 1) * beta[k] / magreg2;
+    }
+  }
+}
+
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2015, 2017, 2019 Jed Brown, Ed Bueler, and Constantine Khroulev
+// Copyright (C) 2004-2015, 2017, 2019, 2020 Jed Brown, Ed Bueler, and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 #define __basal_resistance_hh
 
 #include "pism/util/Units.hh"
+#include "pism/util/Vector2.hh"
 
 namespace pism {
 
@@ -39,6 +40,11 @@ public:
   virtual double drag(double tauc, double vx, double vy) const;
   virtual void drag_with_derivative(double tauc, double vx, double vy,
                                     double *drag, double *ddrag) const;
+
+  virtual void drag_n(const double *tauc, const Vector2 *velocity,
+                      unsigned int n, double *drag) const;
+  virtual void drag_with_derivative_n(const double *tauc, const Vector2 *velocity,
+                                      unsigned int n, double *drag, double *ddrag) const;
 protected:
   double m_plastic_regularize;
 };
@@ -51,8 +57,21 @@ public:
   virtual double drag(double tauc, double vx, double vy) const;
   virtual void drag_with_derivative(double tauc, double vx, double vy,
                                     double *drag, double *ddrag) const;
+
+  virtual void drag_n(const double *tauc, const Vector2 *velocity,
+                      unsigned int n, double *drag) const;
+  virtual void drag_with_derivative_n(const double *tauc, const Vector2 *velocity,
+                                      unsigned int n, double *drag, double *ddrag) const;
 protected:
   double m_pseudo_q, m_pseudo_u_threshold, m_sliding_scale_factor_reduces_tauc;
+private:
+  //! exponents with faster implementations than pow()
+  enum Exponent {GENERAL, PLASTIC, ONE_QUARTER, ONE_THIRD, LINEAR};
+  Exponent m_exponent;
+
+  template<Exponent E>
+  void drag_n_impl(const double *tauc, const Vector2 *velocity,
+                   unsigned int n, double *drag, double *ddrag) const;
 };
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2008-2018 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
+// Copyright (C) 2008-2018, 2020 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
 // Gudfinna Adalgeirsdottir and Andy Aschwanden
 //
 // This file is part of PISM.
@@ -20,6 +20,7 @@
 #ifndef __AtmosphereModel
 #define __AtmosphereModel
 
+#include <utility>              // std::pair
 #include <vector>
 
 #include "pism/util/Component.hh"
@@ -28,6 +29,7 @@ namespace pism {
 
 class Geometry;
 class IceModelVec2S;
+class FusedField;
 
 //! @brief Atmosphere models and modifiers: provide precipitation and
 //! temperature to a surface::SurfaceModel below
@@ -63,6 +65,23 @@ public:
   //! grid. Times (in years) are specified in ts. NB! Has to be surrounded by
   //! begin_pointwise_access() and end_pointwise_access()
   void temp_time_series(int i, int j, std::vector<double> &result) const;
+
+  //! \brief Sets `result` to time-series of ice-equivalent precipitation (m/s) at
+  //! `columns`, stored one after another.
+  void precip_time_series(const std::vector<std::pair<int, int> > &columns,
+                          std::vector<double> &result) const;
+
+  //! \brief Sets `result` to time-series of near-surface air temperature (degrees Kelvin)
+  //! at `columns`, stored one after another. Has to be surrounded by
+  //! begin_pointwise_access() and end_pointwise_access().
+  void temp_time_series(const std::vector<std::pair<int, int> > &columns,
+                        std::vector<double> &result) const;
+
+  //! \brief Returns true if time series of temperature and precipitation are the same in
+  //! all grid columns.
+  //!
+  //! Consumers can then get time series for one column and use them everywhere.
+  bool spatially_uniform() const;
 protected:
   virtual void init_impl(const Geometry &geometry) = 0;
   virtual void update_impl(const Geometry &geometry, double t, double dt) = 0;
@@ -79,6 +98,17 @@ protected:
   virtual void init_timeseries_impl(const std::vector<double> &ts) const;
   virtual void precip_time_series_impl(int i, int j, std::vector<double> &result) const;
   virtual void temp_time_series_impl(int i, int j, std::vector<double> &result) const;
+  virtual void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                            std::vector<double> &result) const;
+  virtual void temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                          std::vector<double> &result) const;
+  virtual bool spatially_uniform_impl() const;
+
+  //! Returns the FusedField providing the output `name` if this model is a scalar
+  //! modifier of it, nullptr otherwise.
+  virtual const FusedField* fused_field_impl(const std::string &name) const;
+  //! Returns the FusedField of the input model providing `name` (or nullptr).
+  const FusedField* input_fused_field(const std::string &name) const;
 
   virtual DiagnosticList diagnostics_impl() const;
   virtual TSDiagnosticList ts_diagnostics_impl() const;
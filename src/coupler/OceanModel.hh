@@ -1,4 +1,4 @@
-// Copyright (C) 2008-2011, 2013, 2014, 2015, 2016, 2017, 2018 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
+// Copyright (C) 2008-2011, 2013, 2014, 2015, 2016, 2017, 2018, 2020 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
 // Gudfinna Adalgeirsdottir and Andy Aschwanden
 //
 // This file is part of PISM.
@@ -27,6 +27,7 @@
 namespace pism {
 
 class IceModelVec2S;
+class FusedField;
 class Geometry;
 
 //! @brief Ocean models and modifiers: provide sea level elevation,
@@ -66,6 +67,12 @@ protected:
   virtual const IceModelVec2S& shelf_base_mass_flux_impl() const;
   virtual const IceModelVec2S& melange_back_pressure_fraction_impl() const;
 
+  //! Returns the FusedField providing the output `name` if this model is a scalar
+  //! modifier of it, nullptr otherwise.
+  virtual const FusedField* fused_field_impl(const std::string &name) const;
+  //! Returns the FusedField of the input model providing `name` (or nullptr).
+  const FusedField* input_fused_field(const std::string &name) const;
+
 protected:
   std::shared_ptr<OceanModel> m_input_model;
   IceModelVec2S::Ptr m_melange_back_pressure_fraction;
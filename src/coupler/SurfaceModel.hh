@@ -1,4 +1,4 @@
-// Copyright (C) 2008-2018 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
+// Copyright (C) 2008-2018, 2020 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
 // Gudfinna Adalgeirsdottir and Andy Aschwanden
 //
 // This file is part of PISM.
@@ -35,6 +35,7 @@ class AtmosphereModel;
 
 class Geometry;
 class IceModelVec2S;
+class FusedField;
 
 //! @brief Surface models and modifiers: provide top-surface
 //! temperature, mass flux, liquid water fraction, mass and thickness of the surface
@@ -75,6 +76,12 @@ protected:
   virtual const IceModelVec2S& runoff_impl() const;
   virtual const IceModelVec2S& temperature_impl() const;
 
+  //! Returns the FusedField providing the output `name` if this model is a scalar
+  //! modifier of it, nullptr otherwise.
+  virtual const FusedField* fused_field_impl(const std::string &name) const;
+  //! Returns the FusedField of the input model providing `name` (or nullptr).
+  const FusedField* input_fused_field(const std::string &name) const;
+
   virtual void init_impl(const Geometry &geometry);
   virtual void update_impl(const Geometry &geometry, double t, double dt);
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -161,5 +161,44 @@ void Anomaly::precip_time_series_impl(int i, int j, std::vector<double> &result)
   }
 }
 
+void Anomaly::temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                          std::vector<double> &result) const {
+  m_input_model->temp_time_series(columns, result);
+
+  const size_t N = m_ts_times.size();
+  m_temp_anomaly.resize(N);
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    m_air_temp_anomaly->interp(columns[c].first, columns[c].second, m_temp_anomaly);
+
+    double *T = &result[c * N];
+    for (size_t k = 0; k < N; ++k) {
+      T[k] += m_temp_anomaly[k];
+    }
+  }
+}
+
+void Anomaly::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                            std::vector<double> &result) const {
+  m_input_model->precip_time_series(columns, result);
+
+  const size_t N = m_ts_times.size();
+  m_mass_flux_anomaly.resize(N);
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    m_precipitation_anomaly->interp(columns[c].first, columns[c].second, m_mass_flux_anomaly);
+
+    double *P = &result[c * N];
+    for (size_t k = 0; k < N; ++k) {
+      P[k] += m_mass_flux_anomaly[k];
+    }
+  }
+}
+
+//! Anomalies are read from 2D fields.
+bool Anomaly::spatially_uniform_impl() const {
+  return false;
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -44,6 +44,11 @@ protected:
   void end_pointwise_access_impl() const;
   void temp_time_series_impl(int i, int j, std::vector<double> &values) const;
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                   std::vector<double> &result) const;
+  void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                     std::vector<double> &result) const;
+  bool spatially_uniform_impl() const;
 protected:
   mutable std::vector<double> m_mass_flux_anomaly, m_temp_anomaly;
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <algorithm>            // std::copy
 #include <gsl/gsl_math.h>       // GSL_NAN
 
 #include "pism/coupler/AtmosphereModel.hh"
@@ -98,6 +99,22 @@ void AtmosphereModel::temp_time_series(int i, int j, std::vector<double> &result
   this->temp_time_series_impl(i, j, result);
 }
 
+void AtmosphereModel::precip_time_series(const std::vector<std::pair<int, int> > &columns,
+                                         std::vector<double> &result) const {
+  result.resize(columns.size() * m_ts_times.size());
+  this->precip_time_series_block_impl(columns, result);
+}
+
+void AtmosphereModel::temp_time_series(const std::vector<std::pair<int, int> > &columns,
+                                       std::vector<double> &result) const {
+  result.resize(columns.size() * m_ts_times.size());
+  this->temp_time_series_block_impl(columns, result);
+}
+
+bool AtmosphereModel::spatially_uniform() const {
+  return this->spatially_uniform_impl();
+}
+
 namespace diagnostics {
 
 /*! @brief Instantaneous near-surface air temperature. */
@@ -126,6 +143,16 @@ protected:
 
     model->begin_pointwise_access();
 
+    if (model->spatially_uniform()) {
+      // the time series is the same in all columns
+      model->temp_time_series(m_grid->xs(), m_grid->ys(), temperature);
+      model->end_pointwise_access();
+
+      result->set(temperature[0]);
+
+      return result;
+    }
+
     IceModelVec::AccessList list(*result);
     ParallelSection loop(m_grid->com);
     try {
@@ -296,6 +323,47 @@ void AtmosphereModel::precip_time_series_impl(int i, int j, std::vector<double>
   }
 }
 
+/*!
+ * Default implementation: process one column at a time. Models that can fill a block of
+ * time series faster (e.g. because time-dependent factors are the same in all columns)
+ * override this.
+ */
+void AtmosphereModel::temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                  std::vector<double> &result) const {
+  const size_t N = m_ts_times.size();
+
+  std::vector<double> column(N);
+  for (size_t c = 0; c < columns.size(); ++c) {
+    this->temp_time_series_impl(columns[c].first, columns[c].second, column);
+    std::copy(column.begin(), column.end(), result.begin() + c * N);
+  }
+}
+
+//! Default implementation: process one column at a time (see temp_time_series_block_impl()).
+void AtmosphereModel::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                    std::vector<double> &result) const {
+  const size_t N = m_ts_times.size();
+
+  std::vector<double> column(N);
+  for (size_t c = 0; c < columns.size(); ++c) {
+    this->precip_time_series_impl(columns[c].first, columns[c].second, column);
+    std::copy(column.begin(), column.end(), result.begin() + c * N);
+  }
+}
+
+/*!
+ * Default implementation: modifiers preserve spatial uniformity of their input models.
+ *
+ * Modifiers that add spatial variability (e.g. using 2D fields or surface elevation)
+ * override this.
+ */
+bool AtmosphereModel::spatially_uniform_impl() const {
+  if (m_input_model) {
+    return m_input_model->spatially_uniform();
+  }
+  return false;
+}
+
 void AtmosphereModel::init_timeseries_impl(const std::vector<double> &ts) const {
   if (m_input_model) {
     m_input_model->init_timeseries(ts);
@@ -305,5 +373,20 @@ void AtmosphereModel::init_timeseries_impl(const std::vector<double> &ts) const
   }
 }
 
+/*!
+ * Default implementation: this model is not a scalar modifier (see FusedField).
+ */
+const FusedField* AtmosphereModel::fused_field_impl(const std::string &name) const {
+  (void) name;
+  return nullptr;
+}
+
+const FusedField* AtmosphereModel::input_fused_field(const std::string &name) const {
+  if (m_input_model) {
+    return m_input_model->fused_field_impl(name);
+  }
+  return nullptr;
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -93,8 +93,10 @@ void CosineYearlyCycle::init_timeseries_impl(const std::vector<double> &ts) cons
   YearlyCycle::init_timeseries_impl(ts);
 
   if (m_A) {
+    std::vector<double> A;
+    m_A->value(ts, A);
     for (unsigned int k = 0; k < ts.size(); ++k) {
-      m_cosine_cycle[k] *= m_A->value(ts[k]);
+      m_cosine_cycle[k] *= A[k];
     }
   }
 }
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 
 #include "pism/util/ConfigInterface.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/FusedField.hh"
 
 namespace pism {
 namespace atmosphere {
@@ -34,7 +35,10 @@ Delta_P::Delta_P(IceGrid::ConstPtr grid, std::shared_ptr<AtmosphereModel> in)
                                     "kg m-2 year-1",
                                     "precipitation offsets"));
 
-  m_precipitation = allocate_precipitation(grid);
+  m_precipitation.reset(new FusedField([grid]() { return allocate_precipitation(grid); },
+                                       [this]() -> const IceModelVec2S& {
+                                         return m_input_model->mean_precipitation();
+                                       }));
 }
 
 Delta_P::~Delta_P() {
@@ -52,22 +56,22 @@ void Delta_P::init_impl(const Geometry &geometry) {
 void Delta_P::init_timeseries_impl(const std::vector<double> &ts) const {
   AtmosphereModel::init_timeseries_impl(ts);
 
-  m_offset_values.resize(ts.size());
-  for (unsigned int k = 0; k < ts.size(); ++k) {
-    m_offset_values[k] = m_forcing->value(ts[k]);
-  }
+  m_forcing->value(ts, m_offset_values);
 }
 
 void Delta_P::update_impl(const Geometry &geometry, double t, double dt) {
   m_input_model->update(geometry, t, dt);
   m_forcing->update(t, dt);
 
-  m_precipitation->copy_from(m_input_model->mean_precipitation());
-  m_precipitation->shift(m_forcing->value());
+  m_precipitation->update(1.0, m_forcing->value(), input_fused_field("precipitation"));
 }
 
 const IceModelVec2S& Delta_P::mean_precipitation_impl() const {
-  return *m_precipitation;
+  return m_precipitation->value();
+}
+
+const FusedField* Delta_P::fused_field_impl(const std::string &name) const {
+  return name == "precipitation" ? m_precipitation.get() : nullptr;
 }
 
 void Delta_P::precip_time_series_impl(int i, int j, std::vector<double> &result) const {
@@ -78,5 +82,17 @@ void Delta_P::precip_time_series_impl(int i, int j, std::vector<double> &result)
   }
 }
 
+void Delta_P::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                            std::vector<double> &result) const {
+  m_input_model->precip_time_series(columns, result);
+
+  const size_t N = m_offset_values.size();
+  for (size_t c = 0; c < columns.size(); ++c) {
+    for (size_t k = 0; k < N; ++k) {
+      result[c * N + k] += m_offset_values[k];
+    }
+  }
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 
 #include "pism/util/ConfigInterface.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/FusedField.hh"
 
 namespace pism {
 namespace atmosphere {
@@ -36,7 +37,14 @@ Delta_T::Delta_T(IceGrid::ConstPtr grid, std::shared_ptr<AtmosphereModel> in)
                                     "Kelvin",
                                     "near-surface air temperature offsets"));
 
-  m_temperature = allocate_temperature(grid);
+  m_temperature.reset(new FusedField([grid]() { return allocate_temperature(grid); },
+                                     [this]() -> const IceModelVec2S& {
+                                       return m_input_model->mean_annual_temp();
+                                     }));
+}
+
+Delta_T::~Delta_T() {
+  // empty
 }
 
 void Delta_T::init_impl(const Geometry &geometry) {
@@ -50,22 +58,22 @@ void Delta_T::init_impl(const Geometry &geometry) {
 void Delta_T::init_timeseries_impl(const std::vector<double> &ts) const {
   AtmosphereModel::init_timeseries_impl(ts);
 
-  m_offset_values.resize(ts.size());
-  for (unsigned int k = 0; k < ts.size(); ++k) {
-    m_offset_values[k] = m_forcing->value(ts[k]);
-  }
+  m_forcing->value(ts, m_offset_values);
 }
 
 void Delta_T::update_impl(const Geometry& geometry, double t, double dt) {
   m_input_model->update(geometry, t, dt);
   m_forcing->update(t, dt);
 
-  m_temperature->copy_from(m_input_model->mean_annual_temp());
-  m_temperature->shift(m_forcing->value());
+  m_temperature->update(1.0, m_forcing->value(), input_fused_field("air_temp"));
 }
 
 const IceModelVec2S& Delta_T::mean_annual_temp_impl() const {
-  return *m_temperature;
+  return m_temperature->value();
+}
+
+const FusedField* Delta_T::fused_field_impl(const std::string &name) const {
+  return name == "air_temp" ? m_temperature.get() : nullptr;
 }
 
 void Delta_T::temp_time_series_impl(int i, int j, std::vector<double> &result) const {
@@ -76,5 +84,17 @@ void Delta_T::temp_time_series_impl(int i, int j, std::vector<double> &result) c
   }
 }
 
+void Delta_T::temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                          std::vector<double> &result) const {
+  m_input_model->temp_time_series(columns, result);
+
+  const size_t N = m_offset_values.size();
+  for (size_t c = 0; c < columns.size(); ++c) {
+    for (size_t k = 0; k < N; ++k) {
+      result[c * N + k] += m_offset_values[k];
+    }
+  }
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -26,23 +26,27 @@
 namespace pism {
 
 class ScalarForcing;
+class FusedField;
 
 namespace atmosphere {
 
 class Delta_T : public AtmosphereModel {
 public:
   Delta_T(IceGrid::ConstPtr g, std::shared_ptr<AtmosphereModel> in);
-  virtual ~Delta_T() {}
+  virtual ~Delta_T();
 protected:
   void init_impl(const Geometry &geometry);
   void update_impl(const Geometry &geometry, double t, double dt);
 
   const IceModelVec2S& mean_annual_temp_impl() const;
+  const FusedField* fused_field_impl(const std::string &name) const;
 
   void init_timeseries_impl(const std::vector<double> &ts) const;
   void temp_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                   std::vector<double> &result) const;
 private:
-  IceModelVec2S::Ptr m_temperature;
+  std::unique_ptr<FusedField> m_temperature;
 
   std::unique_ptr<ScalarForcing> m_forcing;
 
@@ -21,7 +21,6 @@
 #include <cmath>                // std::exp()
 
 #include "pism/coupler/util/options.hh"
-#include "pism/coupler/util/lapse_rates.hh"
 #include "pism/util/io/io_helpers.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/pism_options.hh"
@@ -32,7 +31,8 @@ namespace atmosphere {
 
 ElevationChange::ElevationChange(IceGrid::ConstPtr grid, std::shared_ptr<AtmosphereModel> in)
   : AtmosphereModel(grid, in),
-  m_surface(grid, "ice_surface_elevation", WITHOUT_GHOSTS) {
+  m_surface(grid, "ice_surface_elevation", WITHOUT_GHOSTS),
+  m_elevation_difference(grid) {
 
   m_precip_lapse_rate = m_config->get_number("atmosphere.elevation_change.precipitation.lapse_rate",
                                              "(kg m-2 / s) / m");
@@ -114,45 +114,36 @@ void ElevationChange::update_impl(const Geometry &geometry, double t, double dt)
   // temperature and precipitation time series
   m_surface.copy_from(geometry.ice_surface_elevation);
 
-  // temperature
-  {
-    m_temperature->copy_from(m_input_model->mean_annual_temp());
-
-    lapse_rate_correction(m_surface, *m_reference_surface,
-                          m_temp_lapse_rate, *m_temperature);
-  }
+  const IceModelVec2S &dz = m_elevation_difference.update(geometry.ice_surface_elevation,
+                                                          *m_reference_surface);
 
-  // precipitation
+  // apply temperature and precipitation corrections in one pass
   {
-    m_precipitation->copy_from(m_input_model->mean_precipitation());
+    const IceModelVec2S
+      &temperature   = m_input_model->mean_annual_temp(),
+      &precipitation = m_input_model->mean_precipitation();
 
-    switch (m_precip_method) {
-    case SCALE:
-      {
-        const IceModelVec2S &input_temperature = m_input_model->mean_annual_temp();
+    IceModelVec::AccessList list{&dz, &temperature, &precipitation,
+                                 m_temperature.get(), m_precipitation.get()};
 
-        IceModelVec::AccessList list{m_temperature.get(),
-                                     &input_temperature,
-                                     m_precipitation.get()};
+    const bool scale = m_precip_method == SCALE;
 
-        for (Points p(*m_grid); p; p.next()) {
-          const int i = p.i(), j = p.j();
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
 
-          double dT = (*m_temperature)(i, j) - input_temperature(i, j);
+      double dT = -m_temp_lapse_rate * dz(i, j);
 
-          (*m_precipitation)(i, j) *= std::exp(m_precip_exp_factor * dT);
-        }
+      (*m_temperature)(i, j) = temperature(i, j) + dT;
 
+      if (scale) {
+        (*m_precipitation)(i, j) = precipitation(i, j) * std::exp(m_precip_exp_factor * dT);
+      } else {
+        (*m_precipitation)(i, j) = precipitation(i, j) - m_precip_lapse_rate * dz(i, j);
       }
-      break;
-    case SHIFT:
-    default:
-      {
-        lapse_rate_correction(m_surface, *m_reference_surface,
-                              m_precip_lapse_rate, *m_precipitation);
-      }
-      break;
     }
+
+    m_temperature->inc_state_counter();
+    m_precipitation->inc_state_counter();
   }
 }
 
@@ -221,5 +212,62 @@ void ElevationChange::precip_time_series_impl(int i, int j, std::vector<double>
   }
 }
 
+void ElevationChange::temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                  std::vector<double> &result) const {
+  m_input_model->temp_time_series(columns, result);
+
+  const size_t N = m_ts_times.size();
+  m_usurf.resize(N);
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    const int i = columns[c].first, j = columns[c].second;
+
+    m_reference_surface->interp(i, j, m_usurf);
+
+    const double surface = m_surface(i, j);
+
+    double *T = &result[c * N];
+    for (size_t m = 0; m < N; ++m) {
+      T[m] -= m_temp_lapse_rate * (surface - m_usurf[m]);
+    }
+  }
+}
+
+void ElevationChange::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                    std::vector<double> &result) const {
+  m_input_model->precip_time_series(columns, result);
+
+  const size_t N = m_ts_times.size();
+  m_usurf.resize(N);
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    const int i = columns[c].first, j = columns[c].second;
+
+    m_reference_surface->interp(i, j, m_usurf);
+
+    const double surface = m_surface(i, j);
+
+    double *P = &result[c * N];
+    switch (m_precip_method) {
+    case SCALE:
+      for (size_t m = 0; m < N; ++m) {
+        double dT = -m_temp_lapse_rate * (surface - m_usurf[m]);
+        P[m] *= std::exp(m_precip_exp_factor * dT);
+      }
+      break;
+    case SHIFT:
+      for (size_t m = 0; m < N; ++m) {
+        P[m] -= m_precip_lapse_rate * (surface - m_usurf[m]);
+      }
+      break;
+    }
+  }
+}
+
+//! Lapse rate corrections depend on the surface elevation.
+bool ElevationChange::spatially_uniform_impl() const {
+  return false;
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -22,6 +22,7 @@
 #include "pism/coupler/AtmosphereModel.hh"
 
 #include "pism/util/iceModelVec2T.hh"
+#include "pism/coupler/util/lapse_rates.hh"
 
 namespace pism {
 namespace atmosphere {
@@ -45,6 +46,11 @@ protected:
   void init_timeseries_impl(const std::vector<double> &ts) const;
   void precip_time_series_impl(int i, int j, std::vector<double> &result) const;
   void temp_time_series_impl(int i, int j, std::vector<double> &result) const;
+  void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                     std::vector<double> &result) const;
+  void temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                   std::vector<double> &result) const;
+  bool spatially_uniform_impl() const;
 
 protected:
   enum Method {SCALE, SHIFT};
@@ -59,6 +65,9 @@ protected:
   IceModelVec2S::Ptr m_precipitation;
   IceModelVec2S::Ptr m_temperature;
   IceModelVec2S m_surface;
+  ElevationDifference m_elevation_difference;
+  //! storage for the reference surface elevation time series
+  mutable std::vector<double> m_usurf;
 };
 
 } // end of namespace atmosphere
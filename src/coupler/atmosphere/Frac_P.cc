@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 
 #include "pism/util/ConfigInterface.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/FusedField.hh"
 
 namespace pism {
 namespace atmosphere {
@@ -33,7 +34,10 @@ Frac_P::Frac_P(IceGrid::ConstPtr grid, std::shared_ptr<AtmosphereModel> in)
                                     "1", "1",
                                     "precipitation multiplier, pure fraction"));
 
-  m_precipitation = allocate_precipitation(grid);
+  m_precipitation.reset(new FusedField([grid]() { return allocate_precipitation(grid); },
+                                       [this]() -> const IceModelVec2S& {
+                                         return m_input_model->mean_precipitation();
+                                       }));
 }
 
 Frac_P::~Frac_P() {
@@ -51,22 +55,22 @@ void Frac_P::init_impl(const Geometry &geometry) {
 void Frac_P::init_timeseries_impl(const std::vector<double> &ts) const {
   AtmosphereModel::init_timeseries_impl(ts);
 
-  m_offset_values.resize(ts.size());
-  for (unsigned int k = 0; k < ts.size(); ++k) {
-    m_offset_values[k] = m_forcing->value(ts[k]);
-  }
+  m_forcing->value(ts, m_offset_values);
 }
 
 void Frac_P::update_impl(const Geometry &geometry, double t, double dt) {
   m_input_model->update(geometry, t, dt);
   m_forcing->update(t, dt);
 
-  m_precipitation->copy_from(m_input_model->mean_precipitation());
-  m_precipitation->scale(m_forcing->value());
+  m_precipitation->update(m_forcing->value(), 0.0, input_fused_field("precipitation"));
 }
 
 const IceModelVec2S& Frac_P::mean_precipitation_impl() const {
-  return *m_precipitation;
+  return m_precipitation->value();
+}
+
+const FusedField* Frac_P::fused_field_impl(const std::string &name) const {
+  return name == "precipitation" ? m_precipitation.get() : nullptr;
 }
 
 void Frac_P::precip_time_series_impl(int i, int j, std::vector<double> &result) const {
@@ -77,5 +81,17 @@ void Frac_P::precip_time_series_impl(int i, int j, std::vector<double> &result)
   }
 }
 
+void Frac_P::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                           std::vector<double> &result) const {
+  m_input_model->precip_time_series(columns, result);
+
+  const size_t N = m_offset_values.size();
+  for (size_t c = 0; c < columns.size(); ++c) {
+    for (size_t k = 0; k < N; ++k) {
+      result[c * N + k] *= m_offset_values[k];
+    }
+  }
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -19,11 +19,14 @@
 #ifndef _PAFPFORCING_H_
 #define _PAFPFORCING_H_
 
+#include <memory>               // std::unique_ptr
+
 #include "pism/coupler/AtmosphereModel.hh"
 
 namespace pism {
 
 class ScalarForcing;
+class FusedField;
 
 namespace atmosphere {
 
@@ -39,14 +42,17 @@ private:
   void init_timeseries_impl(const std::vector<double> &ts) const;
 
   const IceModelVec2S& mean_precipitation_impl() const;
+  const FusedField* fused_field_impl(const std::string &name) const;
 
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                     std::vector<double> &result) const;
 
   mutable std::vector<double> m_offset_values;
 
   std::unique_ptr<ScalarForcing> m_forcing;
 
-  IceModelVec2S::Ptr m_precipitation;
+  std::unique_ptr<FusedField> m_precipitation;
 };
 
 } // end of namespace atmosphere
@@ -0,0 +1,102 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_ATMOSPHERE_LINEARTHEORY_H
+#define PISM_ATMOSPHERE_LINEARTHEORY_H
+
+#include <vector>
+
+#include <fftw3.h>
+
+namespace pism {
+
+class Config;
+
+namespace atmosphere {
+
+//! Parameters and the transfer function of the linear theory of orographic precipitation
+//! [@ref SmithBarstad2004], [@ref SmithBarstadBonneau2005].
+/*!
+ * This part of the model is shared by the serial (OrographicPrecipitationSerial) and the
+ * distributed (OrographicPrecipitationParallel) implementations.
+ */
+class LinearTheory {
+public:
+  LinearTheory(const Config &config, double dx, double dy, int Nx, int Ny);
+
+  //! Compute the Fourier transform of precipitation given the Fourier transform of the
+  //! surface elevation.
+  /*!
+   * Processes rows `row_start` to `row_start + n_rows - 1` (in the X direction) of the
+   * `Nx*Ny` spectrum. Arguments are arrays of size `n_rows*Ny`.
+   */
+  void precipitation_spectrum(fftw_complex *h_hat, int row_start, int n_rows,
+                              fftw_complex *P_hat) const;
+
+  //! Add background precipitation, truncate and scale.
+  double postprocess(double P) const;
+private:
+  // regularization
+  double m_eps;
+
+  //! truncate
+  bool m_truncate;
+  //! precipitation scale factor
+  double m_precip_scale_factor;
+  //! background precipitation
+  double m_background_precip_pre, m_background_precip_post;
+  //! cloud conversion time
+  double m_tau_c;
+  //! cloud fallout time
+  double m_tau_f;
+  //! water vapor scale height
+  double m_Hw;
+  //! moist stability frequency
+  double m_Nm;
+  //! wind direction
+  double m_wind_direction;
+  //! wind speed
+  double m_wind_speed;
+  //! moist adiabatic lapse rate
+  double m_Theta_m;
+  //! moist lapse rate
+  double m_gamma;
+  //! reference density
+  double m_rho_Sref;
+  //! Coriolis force
+  double m_f;
+  //! uplift sensitivity factor
+  double m_Cw;
+  //! latitude for Coriolis force
+  double m_latitude;
+  //! horizontal wind component
+  double m_u;
+  //! vertical wind component
+  double m_v;
+
+  // extended grid size in the Y direction
+  int m_Ny;
+
+  std::vector<double> m_kx, m_ky;
+};
+
+} // end of namespace atmosphere
+} // end of namespace pism
+
+#endif /* PISM_ATMOSPHERE_LINEARTHEORY_H */
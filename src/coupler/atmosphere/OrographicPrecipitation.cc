@@ -16,25 +16,37 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>            // std::fill
+
 #include "OrographicPrecipitation.hh"
 
 #include "OrographicPrecipitationSerial.hh"
+#include "pism/pism_config.hh"
+#if (Pism_USE_FFTW_MPI==1)
+#include "OrographicPrecipitationParallel.hh"
+#endif
 #include "pism/coupler/util/options.hh"
 #include "pism/geometry/Geometry.hh"
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/Time.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/MemoryTracker.hh"
 
 namespace pism {
 namespace atmosphere {
 
 OrographicPrecipitation::OrographicPrecipitation(IceGrid::ConstPtr grid,
                                                  std::shared_ptr<AtmosphereModel> in)
-    : AtmosphereModel(grid, in) {
+    : AtmosphereModel(grid, in),
+      m_memo(grid->ctx()->memo(), "atmosphere.orographic_precipitation") {
 
   m_precipitation = allocate_precipitation(grid);
 
-  m_work0 = m_precipitation->allocate_proc0_copy();
+  m_reuse_surface_transform =
+    m_config->get_flag("atmosphere.orographic_precipitation.reuse_surface_transform");
+  m_last_surface       = nullptr;
+  m_fftw_memory_id     = -1;
 
   const int
     Mx = m_grid->Mx(),
@@ -43,6 +55,19 @@ OrographicPrecipitation::OrographicPrecipitation(IceGrid::ConstPtr grid,
     Nx = Z * (Mx - 1) + 1,
     Ny = Z * (My - 1) + 1;
 
+  if (m_config->get_flag("atmosphere.orographic_precipitation.fftw_mpi")) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model.reset(new OrographicPrecipitationParallel(m_grid, Nx, Ny));
+    return;
+#else
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "atmosphere.orographic_precipitation.fftw_mpi requires FFTW's MPI interface.\n"
+                       "Please re-build PISM with -DPism_USE_FFTW_MPI=ON.");
+#endif
+  }
+
+  m_work0 = m_precipitation->allocate_proc0_copy();
+
   ParallelSection rank0(m_grid->com);
   try {
     if (m_grid->rank() == 0) {
@@ -50,6 +75,10 @@ OrographicPrecipitation::OrographicPrecipitation(IceGrid::ConstPtr grid,
                                                              Mx, My,
                                                              m_grid->dx(), m_grid->dy(),
                                                              Nx, Ny));
+
+      // OrographicPrecipitationSerial allocates 2 FFTW arrays on the extended grid
+      m_fftw_memory_id = m_grid->ctx()->memory().allocate("orographic precipitation FFTW arrays",
+                                                          2 * sizeof(fftw_complex) * Nx * Ny);
     }
   } catch (...) {
     rank0.failed();
@@ -58,7 +87,7 @@ OrographicPrecipitation::OrographicPrecipitation(IceGrid::ConstPtr grid,
 }
 
 OrographicPrecipitation::~OrographicPrecipitation() {
-  // empty
+  m_grid->ctx()->memory().deallocate(m_fftw_memory_id);
 }
 
 const IceModelVec2S &OrographicPrecipitation::mean_precipitation_impl() const {
@@ -83,26 +112,49 @@ void OrographicPrecipitation::init_impl(const Geometry &geometry) {
 void OrographicPrecipitation::update_impl(const Geometry &geometry, double t, double dt) {
   m_input_model->update(geometry, t, dt);
 
-  geometry.ice_surface_elevation.put_on_proc0(*m_work0);
+  const IceModelVec2S &surface = geometry.ice_surface_elevation;
 
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) { // processor zero updates the precipitation
-      m_serial_model->update(*m_work0);
+  // Precipitation computed by this model depends on the surface elevation only, so
+  // re-using the transform of an unchanged surface means re-using the result.
+  if (not m_reuse_surface_transform or m_last_surface != &surface) {
+    m_memo.reset();
+  }
 
-      PetscErrorCode ierr = VecCopy(m_serial_model->precipitation(), *m_work0);
-      PISM_CHK(ierr, "VecCopy");
-    }
-  } catch (...) {
-    rank0.failed();
+  std::vector<int> key{surface.state_counter()};
+  if (m_memo.up_to_date(key)) {
+    return;
   }
-  rank0.check();
 
-  m_precipitation->get_from_proc0(*m_work0);
+  if (m_parallel_model) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model->update(surface);
+    m_precipitation->copy_from(m_parallel_model->precipitation());
+#endif
+  } else {
+    surface.put_on_proc0(*m_work0);
+
+    ParallelSection rank0(m_grid->com);
+    try {
+      if (m_grid->rank() == 0) { // processor zero updates the precipitation
+        m_serial_model->update(*m_work0);
+
+        PetscErrorCode ierr = VecCopy(m_serial_model->precipitation(), *m_work0);
+        PISM_CHK(ierr, "VecCopy");
+      }
+    } catch (...) {
+      rank0.failed();
+    }
+    rank0.check();
+
+    m_precipitation->get_from_proc0(*m_work0);
+  }
 
   // convert from mm/s to kg / (m^2 s):
   double water_density = m_config->get_number("constants.fresh_water.density");
   m_precipitation->scale(1e-3 * water_density);
+
+  m_last_surface = &surface;
+  m_memo.set(key);
 }
 
 void OrographicPrecipitation::precip_time_series_impl(int i, int j,
@@ -113,6 +165,16 @@ void OrographicPrecipitation::precip_time_series_impl(int i, int j,
   }
 }
 
+void OrographicPrecipitation::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                            std::vector<double> &result) const {
+  const size_t N = m_ts_times.size();
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    std::fill(result.begin() + c * N, result.begin() + (c + 1) * N,
+              (*m_precipitation)(columns[c].first, columns[c].second));
+  }
+}
+
 void OrographicPrecipitation::begin_pointwise_access_impl() const {
   m_input_model->begin_pointwise_access();
   m_precipitation->begin_access();
@@ -123,5 +185,10 @@ void OrographicPrecipitation::end_pointwise_access_impl() const {
   m_input_model->end_pointwise_access();
 }
 
+//! Orographic precipitation depends on the surface elevation.
+bool OrographicPrecipitation::spatially_uniform_impl() const {
+  return false;
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
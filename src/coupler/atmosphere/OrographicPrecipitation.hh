@@ -1,4 +1,4 @@
-// Copyright (C) 2018 PISM Authors
+// Copyright (C) 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 #define _PAOROGRAPHICPRECIPITATION_H_
 
 #include "pism/coupler/AtmosphereModel.hh"
+#include "pism/util/Memo.hh"
 
 namespace pism {
 
@@ -28,6 +29,7 @@ class Geometry;
 namespace atmosphere {
 
 class OrographicPrecipitationSerial;
+class OrographicPrecipitationParallel;
 
 class OrographicPrecipitation : public AtmosphereModel {
 public:
@@ -44,6 +46,9 @@ private:
   void end_pointwise_access_impl() const;
 
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                     std::vector<double> &result) const;
+  bool spatially_uniform_impl() const;
 
 protected:
   std::string m_reference;
@@ -56,6 +61,19 @@ protected:
 
   //! Serial orographic precipitation model.
   std::unique_ptr<OrographicPrecipitationSerial> m_serial_model;
+
+  //! Distributed orographic precipitation model (requires FFTW's MPI interface). This is
+  //! a shared_ptr because OrographicPrecipitationParallel may be an incomplete type.
+  std::shared_ptr<OrographicPrecipitationParallel> m_parallel_model;
+
+  //! If true, skip the update if the surface elevation did not change.
+  bool m_reuse_surface_transform;
+  //! The surface elevation field used by the last update and its state counter.
+  const IceModelVec2S *m_last_surface;
+  Memo m_memo;
+
+  //! ID of FFTW arrays of the serial model in the memory tracker
+  int m_fftw_memory_id;
 };
 
 } // end of namespace atmosphere
@@ -0,0 +1,123 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <fftw3-mpi.h>
+
+#include "OrographicPrecipitationParallel.hh"
+
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/fftw_utilities.hh"
+#include "pism/util/fftw_mpi_utilities.hh"
+
+namespace pism {
+namespace atmosphere {
+
+/*!
+ * @param[in] grid PISM's grid
+ * @param[in] Nx extended grid size in the X direction
+ * @param[in] Ny extended grid size in the Y direction
+ */
+OrographicPrecipitationParallel::OrographicPrecipitationParallel(IceGrid::ConstPtr grid,
+                                                                 int Nx, int Ny)
+  : m_grid(grid),
+    m_Nx(Nx),
+    m_Ny(Ny),
+    m_model(*grid->ctx()->config(), grid->dx(), grid->dy(), Nx, Ny),
+    m_precipitation(grid, "precipitation", WITHOUT_GHOSTS) {
+
+  const int
+    Mx = grid->Mx(),
+    My = grid->My(),
+    i0_offset = (Nx - Mx) / 2,
+    j0_offset = (Ny - My) / 2;
+
+  // Note that fftw_mpi_init() may be called more than once.
+  fftw_mpi_init();
+
+  ptrdiff_t alloc_local = fftw_mpi_local_size_2d(m_Nx, m_Ny, m_grid->com,
+                                                 &m_n_rows, &m_row_start);
+
+  m_fftw_input  = fftw_alloc_complex(alloc_local);
+  m_fftw_output = fftw_alloc_complex(alloc_local);
+
+  clear_fftw_array(m_fftw_input, m_n_rows, m_Ny);
+  m_dft_forward = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                       m_grid->com, FFTW_FORWARD, FFTW_ESTIMATE);
+  m_dft_inverse = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                       m_grid->com, FFTW_BACKWARD, FFTW_ESTIMATE);
+
+  {
+    PetscErrorCode ierr = 0;
+    ierr = VecCreateMPI(m_grid->com, m_n_rows * m_Ny, PETSC_DETERMINE, m_work.rawptr());
+    PISM_CHK(ierr, "VecCreateMPI");
+
+    ierr = DMDACreateNaturalVector(*m_precipitation.dm(), m_natural.rawptr());
+    PISM_CHK(ierr, "DMDACreateNaturalVector");
+  }
+
+  create_slab_scatter(m_natural, m_work, Mx, My, m_Ny, i0_offset, j0_offset,
+                      m_row_start, m_n_rows, m_center);
+}
+
+OrographicPrecipitationParallel::~OrographicPrecipitationParallel() {
+  fftw_destroy_plan(m_dft_forward);
+  fftw_destroy_plan(m_dft_inverse);
+  fftw_free(m_fftw_input);
+  fftw_free(m_fftw_output);
+}
+
+/*!
+ * Return precipitation (in mm/s, like OrographicPrecipitationSerial::precipitation()).
+ */
+const IceModelVec2S& OrographicPrecipitationParallel::precipitation() const {
+  return m_precipitation;
+}
+
+/*!
+ * Update precipitation.
+ *
+ * @param[in] surface_elevation surface elevation on PISM's grid
+ */
+void OrographicPrecipitationParallel::update(const IceModelVec2S &surface_elevation) {
+
+  // Compute fft2(surface_elevation)
+  {
+    copy_to_slab(surface_elevation, m_center, m_natural, m_work);
+    set_real_part_slab(m_work, 1.0, m_n_rows, m_Ny, m_fftw_input);
+    fftw_execute(m_dft_forward);
+  }
+
+  m_model.precipitation_spectrum(m_fftw_output, m_row_start, m_n_rows, m_fftw_input);
+
+  fftw_execute(m_dft_inverse);
+
+  get_real_part_slab(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_n_rows, m_Ny, m_work);
+  copy_from_slab(m_work, m_center, m_natural, m_precipitation);
+
+  IceModelVec::AccessList list{&m_precipitation};
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    m_precipitation(i, j) = m_model.postprocess(m_precipitation(i, j));
+  }
+}
+
+} // end of namespace atmosphere
+} // end of namespace pism
@@ -0,0 +1,85 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef OROGRAPHICPRECIPITATIONPARALLEL_H
+#define OROGRAPHICPRECIPITATIONPARALLEL_H
+
+#include <cstddef>              // ptrdiff_t
+
+#include <fftw3.h>
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/petscwrappers/VecScatter.hh"
+#include "LinearTheory.hh"
+
+namespace pism {
+namespace atmosphere {
+
+//! Distributed-memory implementation of the model in OrographicPrecipitationSerial.
+/*!
+ * Uses FFTW's MPI interface: the extended grid is split into slabs of rows in the X
+ * direction (see fftw_mpi_utilities.hh). Results agree with OrographicPrecipitationSerial
+ * within round-off.
+ */
+class OrographicPrecipitationParallel {
+public:
+  OrographicPrecipitationParallel(IceGrid::ConstPtr grid, int Nx, int Ny);
+  ~OrographicPrecipitationParallel();
+
+  const IceModelVec2S& precipitation() const;
+
+  void update(const IceModelVec2S &surface_elevation);
+
+private:
+  IceGrid::ConstPtr m_grid;
+
+  // extended grid size
+  int m_Nx;
+  int m_Ny;
+
+  // the range of rows of the extended grid owned by this rank
+  ptrdiff_t m_row_start;
+  ptrdiff_t m_n_rows;
+
+  //! the spectral part of the model
+  LinearTheory m_model;
+
+  //! orographic precipitation
+  IceModelVec2S m_precipitation;
+
+  //! a work vector using the slab decomposition
+  petsc::Vec m_work;
+  //! a work vector using the natural ordering on the PISM grid
+  petsc::Vec m_natural;
+  //! scatter from the PISM grid to the center of the extended grid
+  petsc::VecScatter m_center;
+
+  fftw_complex *m_fftw_input;
+  fftw_complex *m_fftw_output;
+
+  fftw_plan m_dft_forward;
+  fftw_plan m_dft_inverse;
+};
+
+} // end of namespace atmosphere
+} // end of namespace pism
+
+#endif /* OROGRAPHICPRECIPITATIONPARALLEL_H */
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "pism/util/petscwrappers/Vec.hh"
+#include "LinearTheory.hh"
 
 namespace pism {
 
@@ -48,48 +49,10 @@ public:
   void update(Vec surface_elevation);
 
 private:
-  // regularization
-  double m_eps;
-
   // grid size
   int m_Mx;
   int m_My;
 
-  //! truncate
-  bool m_truncate;
-  //! precipitation scale factor
-  double m_precip_scale_factor;
-  //! background precipitation
-  double m_background_precip_pre, m_background_precip_post;
-  //! cloud conversion time
-  double m_tau_c;
-  //! cloud fallout time
-  double m_tau_f;
-  //! water vapor scale height
-  double m_Hw;
-  //! moist stability frequency
-  double m_Nm;
-  //! wind direction
-  double m_wind_direction;
-  //! wind speed
-  double m_wind_speed;
-  //! moist adiabatic lapse rate
-  double m_Theta_m;
-  //! moist lapse rate
-  double m_gamma;
-  //! reference density
-  double m_rho_Sref;
-  //! Coriolis force
-  double m_f;
-  //! uplift sensitivity factor
-  double m_Cw;
-  //! latitude for Coriolis force
-  double m_latitude;
-  //! horizontal wind component
-  double m_u;
-  //! vertical wind component
-  double m_v;
-
   // extended grid size
   int m_Nx;
   int m_Ny;
@@ -98,7 +61,8 @@ private:
   int m_i0_offset;
   int m_j0_offset;
 
-  std::vector<double> m_kx, m_ky;
+  //! the spectral part of the model
+  LinearTheory m_model;
 
   // orographic precipitation
   petsc::Vec m_precipitation;
@@ -19,6 +19,7 @@
 #include "PrecipitationScaling.hh"
 
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/FusedField.hh"
 #include "pism/util/ConfigInterface.hh"
 
 namespace pism {
@@ -37,7 +38,10 @@ PrecipitationScaling::PrecipitationScaling(IceGrid::ConstPtr grid,
 
   m_exp_factor = m_config->get_number("atmosphere.precip_exponential_factor_for_temperature");
 
-  m_precipitation = allocate_precipitation(grid);
+  m_precipitation.reset(new FusedField([grid]() { return allocate_precipitation(grid); },
+                                       [this]() -> const IceModelVec2S& {
+                                         return m_input_model->mean_precipitation();
+                                       }));
 }
 
 PrecipitationScaling::~PrecipitationScaling() {
@@ -57,9 +61,9 @@ void PrecipitationScaling::init_impl(const Geometry &geometry) {
 void PrecipitationScaling::init_timeseries_impl(const std::vector<double> &ts) const {
   AtmosphereModel::init_timeseries_impl(ts);
 
-  m_scaling_values.resize(ts.size());
+  m_forcing->value(ts, m_scaling_values);
   for (unsigned int k = 0; k < ts.size(); ++k) {
-    m_scaling_values[k] = exp(m_exp_factor * m_forcing->value(ts[k]));
+    m_scaling_values[k] = exp(m_exp_factor * m_scaling_values[k]);
   }
 }
 
@@ -67,12 +71,16 @@ void PrecipitationScaling::update_impl(const Geometry &geometry, double t, doubl
   m_input_model->update(geometry, t, dt);
   m_forcing->update(t, dt);
 
-  m_precipitation->copy_from(m_input_model->mean_precipitation());
-  m_precipitation->scale(exp(m_exp_factor * m_forcing->value()));
+  m_precipitation->update(exp(m_exp_factor * m_forcing->value()), 0.0,
+                          input_fused_field("precipitation"));
 }
 
 const IceModelVec2S& PrecipitationScaling::mean_precipitation_impl() const {
-  return *m_precipitation;
+  return m_precipitation->value();
+}
+
+const FusedField* PrecipitationScaling::fused_field_impl(const std::string &name) const {
+  return name == "precipitation" ? m_precipitation.get() : nullptr;
 }
 
 void PrecipitationScaling::precip_time_series_impl(int i, int j, std::vector<double> &result) const {
@@ -83,5 +91,17 @@ void PrecipitationScaling::precip_time_series_impl(int i, int j, std::vector<dou
   }
 }
 
+void PrecipitationScaling::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                         std::vector<double> &result) const {
+  m_input_model->precip_time_series(columns, result);
+
+  const size_t N = m_scaling_values.size();
+  for (size_t c = 0; c < columns.size(); ++c) {
+    for (size_t k = 0; k < N; ++k) {
+      result[c * N + k] *= m_scaling_values[k];
+    }
+  }
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -19,12 +19,15 @@
 #ifndef PRECIPITATIONSCALING_H
 #define PRECIPITATIONSCALING_H
 
+#include <memory>               // std::unique_ptr
+
 #include "pism/coupler/AtmosphereModel.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
 
 namespace pism {
 
 class ScalarForcing;
+class FusedField;
 
 namespace atmosphere {
 
@@ -66,15 +69,18 @@ protected:
   void init_timeseries_impl(const std::vector<double> &ts) const;
 
   const IceModelVec2S& mean_precipitation_impl() const;
+  const FusedField* fused_field_impl(const std::string &name) const;
 
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                     std::vector<double> &result) const;
 
 protected:
   double m_exp_factor;
   std::unique_ptr<ScalarForcing> m_forcing;
   mutable std::vector<double> m_scaling_values;
 
-  IceModelVec2S::Ptr m_precipitation;
+  std::unique_ptr<FusedField> m_precipitation;
 };
 
 } // end of namespace atmosphere
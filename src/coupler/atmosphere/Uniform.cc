@@ -1,4 +1,4 @@
-/* Copyright (C) 2018, 2019 PISM Authors
+/* Copyright (C) 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::fill
+
 #include "Uniform.hh"
 
 #include "pism/geometry/Geometry.hh"
@@ -79,5 +81,29 @@ void Uniform::precip_time_series_impl(int i, int j, std::vector<double> &values)
   }
 }
 
+void Uniform::temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                          std::vector<double> &result) const {
+  const size_t N = m_ts_times.size();
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    std::fill(result.begin() + c * N, result.begin() + (c + 1) * N,
+              (*m_temperature)(columns[c].first, columns[c].second));
+  }
+}
+
+void Uniform::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                            std::vector<double> &result) const {
+  const size_t N = m_ts_times.size();
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    std::fill(result.begin() + c * N, result.begin() + (c + 1) * N,
+              (*m_precipitation)(columns[c].first, columns[c].second));
+  }
+}
+
+bool Uniform::spatially_uniform_impl() const {
+  return true;
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018, 2019 PISM Authors
+/* Copyright (C) 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -42,6 +42,11 @@ private:
   void init_timeseries_impl(const std::vector<double> &ts) const;
   void temp_time_series_impl(int i, int j, std::vector<double> &values) const;
   void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
+  void temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                   std::vector<double> &result) const;
+  void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                     std::vector<double> &result) const;
+  bool spatially_uniform_impl() const;
 
 private:
   IceModelVec2S::Ptr m_precipitation, m_temperature;
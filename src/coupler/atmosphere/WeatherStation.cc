@@ -1,4 +1,4 @@
-/* Copyright (C) 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::copy
+
 #include "WeatherStation.hh"
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/pism_utilities.hh"
@@ -138,5 +140,30 @@ void WeatherStation::temp_time_series_impl(int i, int j, std::vector<double> &re
   result = m_air_temp_values;
 }
 
+//! The time series is the same in all columns.
+void WeatherStation::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                   std::vector<double> &result) const {
+  const size_t N = m_precip_values.size();
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    std::copy(m_precip_values.begin(), m_precip_values.end(), result.begin() + c * N);
+  }
+}
+
+//! The time series is the same in all columns.
+void WeatherStation::temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                 std::vector<double> &result) const {
+  const size_t N = m_air_temp_values.size();
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    std::copy(m_air_temp_values.begin(), m_air_temp_values.end(), result.begin() + c * N);
+  }
+}
+
+//! Time series from a weather station are used in all columns.
+bool WeatherStation::spatially_uniform_impl() const {
+  return true;
+}
+
 } // end of namespace atmosphere
 } // end of namespace pism
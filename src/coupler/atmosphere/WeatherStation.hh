@@ -1,4 +1,4 @@
-/* Copyright (C) 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -52,6 +52,11 @@ protected:
   virtual void init_timeseries_impl(const std::vector<double> &ts) const;
   virtual void precip_time_series_impl(int i, int j, std::vector<double> &values) const;
   virtual void temp_time_series_impl(int i, int j, std::vector<double> &values) const;
+  virtual void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                             std::vector<double> &result) const;
+  virtual void temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                           std::vector<double> &result) const;
+  virtual bool spatially_uniform_impl() const;
 
   virtual MaxTimestep max_timestep_impl(double t) const;
 protected:
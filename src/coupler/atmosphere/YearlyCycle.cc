@@ -1,4 +1,4 @@
-// Copyright (C) 2008-2019 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
+// Copyright (C) 2008-2020 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
 // Gudfinna Adalgeirsdottir and Andy Aschwanden
 //
 // This file is part of PISM.
@@ -20,6 +20,7 @@
 // Implementation of the atmosphere model using constant-in-time precipitation
 // and a cosine yearly cycle for near-surface air temperatures.
 
+#include <algorithm>            // std::fill
 #include <gsl/gsl_math.h>       // M_PI
 
 #include "YearlyCycle.hh"
@@ -138,6 +139,39 @@ void YearlyCycle::temp_time_series_impl(int i, int j, std::vector<double> &resul
   }
 }
 
+/*!
+ * The yearly cycle is the same in all columns, so this uses the table computed in
+ * init_timeseries_impl() and reads 2D fields once per column.
+ */
+void YearlyCycle::temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                              std::vector<double> &result) const {
+  const size_t N = m_cosine_cycle.size();
+  const double *cycle = m_cosine_cycle.data();
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    const int i = columns[c].first, j = columns[c].second;
+
+    const double
+      T_mean      = m_air_temp_mean_annual(i, j),
+      T_amplitude = m_air_temp_mean_summer(i, j) - T_mean;
+
+    double *T = &result[c * N];
+    for (size_t k = 0; k < N; ++k) {
+      T[k] = T_mean + T_amplitude * cycle[k];
+    }
+  }
+}
+
+void YearlyCycle::precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                                std::vector<double> &result) const {
+  const size_t N = m_ts_times.size();
+
+  for (size_t c = 0; c < columns.size(); ++c) {
+    std::fill(result.begin() + c * N, result.begin() + (c + 1) * N,
+              m_precipitation(columns[c].first, columns[c].second));
+  }
+}
+
 void YearlyCycle::begin_pointwise_access_impl() const {
   m_air_temp_mean_annual.begin_access();
   m_air_temp_mean_summer.begin_access();
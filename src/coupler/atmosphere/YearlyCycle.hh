@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -51,6 +51,10 @@ protected:
   virtual void init_timeseries_impl(const std::vector<double> &ts) const;
   virtual void temp_time_series_impl(int i, int j, std::vector<double> &result) const;
   virtual void precip_time_series_impl(int i, int j, std::vector<double> &result) const;
+  virtual void temp_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                           std::vector<double> &result) const;
+  virtual void precip_time_series_block_impl(const std::vector<std::pair<int, int> > &columns,
+                                             std::vector<double> &result) const;
 
   virtual void update_impl(const Geometry &geometry, double t, double dt) = 0;
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2018, 2019 Andy Aschwanden and Constantine Khroulev
+// Copyright (C) 2018, 2019, 2020 Andy Aschwanden and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -27,7 +27,8 @@ namespace pism {
 namespace frontalmelt {
   
 DischargeRouting::DischargeRouting(IceGrid::ConstPtr grid)
-  : FrontalMelt(grid, nullptr) {
+  : FrontalMelt(grid, nullptr),
+    m_front_memo(grid->ctx()->memo(), "frontal_melt.discharge_routing.front") {
 
   m_frontal_melt_rate = allocate_frontal_melt_rate(grid, 1);
 
@@ -87,6 +88,57 @@ void DischargeRouting::initialize(const IceModelVec2S &theta) {
   m_theta_ocean->copy_from(theta);
 }
 
+/*!
+ * Find front cells (see m_front and m_front_ice).
+ *
+ * The cell type does not change very often, so we re-compute these lists only when its
+ * state counter changes.
+ */
+void DischargeRouting::update_front(const IceModelVec2CellType &cell_type) {
+  std::vector<int> key{cell_type.state_counter()};
+  if (m_front_memo.up_to_date(key)) {
+    return;
+  }
+
+  m_front.clear();
+  m_front_ice.clear();
+
+  IceModelVec::AccessList list{&cell_type};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (cell_type.ice_free(i, j)) {
+      if (apply(cell_type, i, j)) {
+        m_front.push_back({i, j});
+      }
+    } else if (cell_type.grounded_ice(i, j) or m_include_floating_ice) {
+      // an icy neighbor of an ice-free ocean cell: this ocean cell is in m_front (possibly
+      // on a different processor)
+      auto M = cell_type.int_star(i, j);
+      if (mask::ice_free_ocean(M.n) or mask::ice_free_ocean(M.e) or
+          mask::ice_free_ocean(M.s) or mask::ice_free_ocean(M.w)) {
+        m_front_ice.push_back({i, j});
+      }
+    }
+  }
+
+  const size_t n = m_front_ice.size();
+  m_water_depth.resize(n);
+  m_discharge_flux.resize(n);
+  m_thermal_forcing.resize(n);
+  m_melt_rate.resize(n);
+
+  m_front_memo.set(key);
+}
+
+/*!
+ * Compute the frontal melt rate at icy cells at the front and set it at adjacent
+ * ice-free ocean cells.
+ *
+ * Front retreat code uses values at ice-free cells; the frontal melt rate is zero
+ * elsewhere.
+ */
 void DischargeRouting::update_impl(const FrontalMeltInputs &inputs, double t, double dt) {
 
   m_theta_ocean->update(t, dt);
@@ -95,78 +147,83 @@ void DischargeRouting::update_impl(const FrontalMeltInputs &inputs, double t, do
 
   const IceModelVec2CellType &cell_type           = inputs.geometry->cell_type;
   const IceModelVec2S        &bed_elevation       = inputs.geometry->bed_elevation;
-  const IceModelVec2S        &ice_thickness       = inputs.geometry->ice_thickness;
   const IceModelVec2S        &sea_level_elevation = inputs.geometry->sea_level_elevation;
   const IceModelVec2S        &water_flux          = *inputs.subglacial_water_flux;
 
+  update_front(cell_type);
+
   IceModelVec::AccessList list
-    {&ice_thickness, &bed_elevation, &cell_type, &sea_level_elevation,
+    {&bed_elevation, &cell_type, &sea_level_elevation,
      &water_flux, m_theta_ocean.get(), m_frontal_melt_rate.get()};
 
   double
     seconds_per_day = 86400,
     grid_spacing    = 0.5 * (m_grid->dx() + m_grid->dy());
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  m_frontal_melt_rate->set(0.0);
 
-    if (cell_type.icy(i, j)) {
-      // Assume for now that thermal forcing is equal to theta_ocean. Also, thermal
-      // forcing is generally not available at the grounding line.
-      double TF = (*m_theta_ocean)(i, j);
-
-      double water_depth = std::max(sea_level_elevation(i, j) - bed_elevation(i, j), 0.0),
-        submerged_front_area = water_depth * grid_spacing;
-
-      // Convert subglacial water flux (m^2/s) to an "effective subglacial freshwater
-      // velocity" or flux per unit area of ice front in m/day (see Xu et al 2013, section
-      // 2, paragraph 11).
-      //
-      // [flux] = m^2 / s, so
-      // [flux * grid_spacing] = m^3 / s, so
-      // [flux * grid_spacing / submerged_front_area] = m / s, and
-      // [flux * grid_spacing  * (s / day) / submerged_front_area] = m / day
-      double Q_sg = water_flux(i, j) * grid_spacing;
-      double q_sg = Q_sg / submerged_front_area * seconds_per_day;
-
-      (*m_frontal_melt_rate)(i, j) = physics.frontal_melt_from_undercutting(water_depth, q_sg, TF);
-      // convert from m / day to m / s
-      (*m_frontal_melt_rate)(i, j) /= seconds_per_day;
-    } else {
-      (*m_frontal_melt_rate)(i, j) = 0.0;
-    }
-  } // end of the loop over grid points
+  // gather inputs at front cells
+  const int n = m_front_ice.size();
+  for (int k = 0; k < n; ++k) {
+    const int i = m_front_ice[k].first, j = m_front_ice[k].second;
+
+    // Assume for now that thermal forcing is equal to theta_ocean. Also, thermal
+    // forcing is generally not available at the grounding line.
+    m_thermal_forcing[k] = (*m_theta_ocean)(i, j);
+
+    double water_depth = std::max(sea_level_elevation(i, j) - bed_elevation(i, j), 0.0),
+      submerged_front_area = water_depth * grid_spacing;
+
+    // Convert subglacial water flux (m^2/s) to an "effective subglacial freshwater
+    // velocity" or flux per unit area of ice front in m/day (see Xu et al 2013, section
+    // 2, paragraph 11).
+    //
+    // [flux] = m^2 / s, so
+    // [flux * grid_spacing] = m^3 / s, so
+    // [flux * grid_spacing / submerged_front_area] = m / s, and
+    // [flux * grid_spacing  * (s / day) / submerged_front_area] = m / day
+    double Q_sg = water_flux(i, j) * grid_spacing;
+
+    m_water_depth[k]    = water_depth;
+    m_discharge_flux[k] = Q_sg / submerged_front_area * seconds_per_day;
+  }
+
+  physics.frontal_melt_from_undercutting(n, m_water_depth.data(), m_discharge_flux.data(),
+                                         m_thermal_forcing.data(), m_melt_rate.data());
+
+  for (int k = 0; k < n; ++k) {
+    const int i = m_front_ice[k].first, j = m_front_ice[k].second;
+
+    // convert from m / day to m / s
+    (*m_frontal_melt_rate)(i, j) = m_melt_rate[k] / seconds_per_day;
+  }
 
   // Set frontal melt rate *near* grounded termini to the average of grounded icy
-  // neighbors: front retreat code uses values at these locations (the rest is for
-  // visualization).
+  // neighbors: front retreat code uses values at these locations.
 
   m_frontal_melt_rate->update_ghosts();
 
   const Direction dirs[] = {North, East, South, West};
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  for (const auto &p : m_front) {
+    const int i = p.first, j = p.second;
 
-    if (apply(cell_type, i, j) and cell_type.ice_free(i, j)) {
+    auto R = m_frontal_melt_rate->star(i, j);
+    auto M = cell_type.int_star(i, j);
 
-      auto R = m_frontal_melt_rate->star(i, j);
-      auto M = cell_type.int_star(i, j);
-
-      int N = 0;
-      double R_sum = 0.0;
-      for (int n = 0; n < 4; ++n) {
-        Direction direction = dirs[n];
-        if (mask::grounded_ice(M[direction]) or
-            (m_include_floating_ice and mask::icy(M[direction]))) {
-          R_sum += R[direction];
-          N++;
-        }
+    int N = 0;
+    double R_sum = 0.0;
+    for (int n = 0; n < 4; ++n) {
+      Direction direction = dirs[n];
+      if (mask::grounded_ice(M[direction]) or
+          (m_include_floating_ice and mask::icy(M[direction]))) {
+        R_sum += R[direction];
+        N++;
       }
+    }
 
-      if (N > 0) {
-        (*m_frontal_melt_rate)(i, j) = R_sum / N;
-      }
+    if (N > 0) {
+      (*m_frontal_melt_rate)(i, j) = R_sum / N;
     }
   }
 }
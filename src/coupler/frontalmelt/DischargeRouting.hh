@@ -1,4 +1,4 @@
-// Copyright (C) 2018 Andy Aschwanden and Constantine Khroulev
+// Copyright (C) 2018, 2020 Andy Aschwanden and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -19,8 +19,12 @@
 #ifndef _PFMDISCHARGE_ROUTING_H_
 #define _PFMDISCHARGE_ROUTING_H_
 
+#include <vector>
+#include <utility>              // std::pair
+
 #include "pism/coupler/FrontalMelt.hh"
 #include "pism/util/iceModelVec2T.hh"
+#include "pism/util/Memo.hh"
 
 namespace pism {
 namespace frontalmelt {
@@ -42,11 +46,23 @@ private:
 
   MaxTimestep max_timestep_impl(double t) const;
 
+  void update_front(const IceModelVec2CellType &cell_type);
+
   // input
   IceModelVec2T::Ptr m_theta_ocean;
 
   // output
   IceModelVec2S::Ptr m_frontal_melt_rate;
+
+  //! icy cells next to ice-free ocean cells in m_front: the melt rate is computed here
+  std::vector<std::pair<int, int> > m_front_ice;
+  //! ice-free ocean cells at the front: the melt rate is set to the average of icy neighbors
+  std::vector<std::pair<int, int> > m_front;
+  //! state counter of the cell type used to compute m_front and m_front_ice
+  Memo m_front_memo;
+
+  // work space for the melt rate computation
+  std::vector<double> m_water_depth, m_discharge_flux, m_thermal_forcing, m_melt_rate;
 };
 
 } // end of namespace frontalmelt
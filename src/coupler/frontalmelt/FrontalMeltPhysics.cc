@@ -1,4 +1,4 @@
-/* Copyright (C) 2018, 2019 PISM Authors
+/* Copyright (C) 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include <cmath> // pow
+#include <algorithm> // std::max
 
 #include "FrontalMeltPhysics.hh"
 
@@ -56,6 +57,39 @@ double FrontalMeltPhysics::frontal_melt_from_undercutting(double h, double q_sg,
   return (m_A * h * pow(q_sg, m_alpha) + m_B) * pow(TF, m_beta);
 }
 
+/*!
+ * Compute frontal melt rates at `n` locations (see the scalar version above).
+ *
+ * The loop body has no branches, which allows the compiler to vectorize it.
+ *
+ * @param[in] n number of locations
+ * @param[in] h water depth, meters
+ * @param[in] q_sg subglacial water flux, m / day
+ * @param[in] TF thermal forcing, Celsius
+ * @param[out] result frontal melt rate, m / day
+ */
+void FrontalMeltPhysics::frontal_melt_from_undercutting(int n,
+                                                        const double *h,
+                                                        const double *q_sg,
+                                                        const double *TF,
+                                                        double *result) const {
+  // local copies: `result` may alias class members as far as the compiler knows
+  const double
+    A     = m_A,
+    B     = m_B,
+    alpha = m_alpha,
+    beta  = m_beta;
+
+  for (int k = 0; k < n; ++k) {
+    const double
+      q = std::max(q_sg[k], 0.0),
+      T = std::max(TF[k], 0.0),
+      melt = (A * h[k] * pow(q, alpha) + B) * pow(T, beta);
+
+    result[k] = (h[k] > 0.0 and q_sg[k] >= 0.0 and TF[k] >= 0.0) ? melt : 0.0;
+  }
+}
+
 /*!
  * Parameterization of the frontal melt rate.
  *
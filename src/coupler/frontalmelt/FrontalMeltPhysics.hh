@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -31,6 +31,12 @@ public:
                                         double discharge_flux,
                                         double potential_temperature) const;
 
+  void frontal_melt_from_undercutting(int n,
+                                      const double *water_depth,
+                                      const double *discharge_flux,
+                                      const double *potential_temperature,
+                                      double *result) const;
+
   double frontal_melt_from_ismip6(double ice_thickness,
                                         double discharge_flux,
                                         double potential_temperature) const;
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -94,6 +94,8 @@ void Given::update_impl(const FrontalMeltInputs &inputs, double t, double dt) {
       (*m_frontal_melt_rate)(i, j) = 0.0;
     }
   }
+  // m_frontal_melt_rate was modified in place
+  m_frontal_melt_rate->inc_state_counter();
 }
 
 MaxTimestep Given::max_timestep_impl(double t) const {
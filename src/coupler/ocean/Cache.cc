@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,7 +17,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <algorithm>            // std::min
+#include <algorithm>            // std::min, std::max, std::swap
 #include <cassert>
 #include <cmath>
 
@@ -49,6 +49,19 @@ Cache::Cache(IceGrid::ConstPtr g, std::shared_ptr<OceanModel> in)
     m_shelf_base_mass_flux           = allocate_shelf_base_mass_flux(g);
     m_melange_back_pressure_fraction = allocate_melange_back_pressure(g);
   }
+
+  m_interpolate    = m_config->get_flag("ocean.cache.interpolate");
+  m_interval_start = m_next_update_time;
+  m_first_update   = true;
+
+  if (m_interpolate) {
+    m_start = {allocate_shelf_base_temperature(g),
+               allocate_shelf_base_mass_flux(g),
+               allocate_melange_back_pressure(g)};
+    m_end   = {allocate_shelf_base_temperature(g),
+               allocate_shelf_base_mass_flux(g),
+               allocate_melange_back_pressure(g)};
+  }
 }
 
 Cache::~Cache() {
@@ -61,33 +74,90 @@ void Cache::init_impl(const Geometry &geometry) {
   m_log->message(2,
                  "* Initializing the 'caching' ocean model modifier...\n");
 
+  if (m_interpolate) {
+    m_log->message(2,
+                   "  Interpolating outputs of the input model in time between updates.\n");
+  }
+
   m_next_update_time = m_grid->ctx()->time()->current();
+  m_interval_start   = m_next_update_time;
+  m_first_update     = true;
 }
 
-void Cache::update_impl(const Geometry &geometry, double t, double dt) {
-  // ignore dt and always use 1 year long time-steps when updating
-  // an input model
-  (void) dt;
+//! Update the input model at time `t`, using a 1 year long time-step.
+void Cache::update_input(const Geometry &geometry, double t) {
+  double
+    one_year_from_now = m_grid->ctx()->time()->increment_date(t, 1.0),
+    update_dt         = one_year_from_now - t;
 
-  if (t >= m_next_update_time or
-      fabs(t - m_next_update_time) < 1.0) {
+  assert(update_dt > 0.0);
 
-    double
-      one_year_from_now = m_grid->ctx()->time()->increment_date(t, 1.0),
-      update_dt         = one_year_from_now - t;
+  m_input_model->update(geometry, t, update_dt);
+}
 
-    assert(update_dt > 0.0);
+//! Copy outputs of the input model to `result`.
+void Cache::copy_outputs(const std::vector<IceModelVec2S::Ptr> &result) const {
+  result[0]->copy_from(m_input_model->shelf_base_temperature());
+  result[1]->copy_from(m_input_model->shelf_base_mass_flux());
+  result[2]->copy_from(m_input_model->melange_back_pressure_fraction());
+}
 
-    m_input_model->update(geometry, t, update_dt);
+//! Outputs of this model (in the order used by copy_outputs()).
+std::vector<IceModelVec2S::Ptr> Cache::outputs() const {
+  return {m_shelf_base_temperature, m_shelf_base_mass_flux, m_melange_back_pressure_fraction};
+}
 
-    m_next_update_time = m_grid->ctx()->time()->increment_date(m_next_update_time,
-                                                               m_update_interval_years);
+/*!
+ * Update the input model at most every `ocean.cache.update_interval` years.
+ *
+ * If `ocean.cache.interpolate` is set, the input model is evaluated at the start and the
+ * end of each update interval (using the ice geometry at its start) and outputs are
+ * interpolated linearly in between. This avoids jumps in outputs at interval boundaries
+ * at the cost of one more update of the input model at the beginning of a run.
+ */
+void Cache::update_impl(const Geometry &geometry, double t, double dt) {
+  // always use 1 year long time-steps when updating an input model (see update_input())
 
-    m_melange_back_pressure_fraction->copy_from(m_input_model->melange_back_pressure_fraction());
+  if (t >= m_next_update_time or
+      fabs(t - m_next_update_time) < 1.0) {
 
-    m_shelf_base_temperature->copy_from(m_input_model->shelf_base_temperature());
+    if (m_interpolate) {
+      if (m_first_update) {
+        // outputs at the start of the first interval
+        update_input(geometry, t);
+        copy_outputs(m_end);
+        m_first_update = false;
+      }
+      // the end of the previous interval is the start of the current one
+      std::swap(m_start, m_end);
+      m_interval_start = t;
+
+      m_next_update_time = m_grid->ctx()->time()->increment_date(m_next_update_time,
+                                                                 m_update_interval_years);
+      update_input(geometry, m_next_update_time);
+      copy_outputs(m_end);
+    } else {
+      update_input(geometry, t);
+
+      m_next_update_time = m_grid->ctx()->time()->increment_date(m_next_update_time,
+                                                                 m_update_interval_years);
+
+      copy_outputs(outputs());
+    }
+  }
 
-    m_shelf_base_mass_flux->copy_from(m_input_model->shelf_base_mass_flux());
+  if (m_interpolate) {
+    // linear interpolation evaluated at the middle of the time step (i.e. the average
+    // over the time step)
+    double lambda = (t + 0.5 * dt - m_interval_start) / (m_next_update_time - m_interval_start);
+    lambda = std::max(0.0, std::min(lambda, 1.0));
+
+    auto result = outputs();
+    for (unsigned int k = 0; k < result.size(); ++k) {
+      result[k]->copy_from(*m_start[k]);
+      result[k]->scale(1.0 - lambda);
+      result[k]->add(lambda, *m_end[k]);
+    }
   }
 }
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -40,9 +40,22 @@ protected:
   const IceModelVec2S& shelf_base_mass_flux_impl() const;
   const IceModelVec2S& melange_back_pressure_fraction_impl() const;
 private:
+  void update_input(const Geometry &geometry, double t);
+  void copy_outputs(const std::vector<IceModelVec2S::Ptr> &result) const;
+  std::vector<IceModelVec2S::Ptr> outputs() const;
+
   double m_next_update_time;
   unsigned int m_update_interval_years;
 
+  //! true if outputs are interpolated in time between updates
+  bool m_interpolate;
+  //! time of the last update (the start of the current update interval)
+  double m_interval_start;
+  bool m_first_update;
+  //! outputs of the input model at the start and the end of the current update interval
+  //! (used if m_interpolate is set)
+  std::vector<IceModelVec2S::Ptr> m_start, m_end;
+
   // storage for melange_back_pressure_fraction is inherited from OceanModel
   IceModelVec2S::Ptr m_shelf_base_temperature;
   IceModelVec2S::Ptr m_shelf_base_mass_flux;
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,7 @@
 
 #include "Delta_SMB.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/FusedField.hh"
 
 namespace pism {
 namespace ocean {
@@ -32,7 +33,10 @@ Delta_SMB::Delta_SMB(IceGrid::ConstPtr g, std::shared_ptr<OceanModel> in)
                                     "kg m-2 year-1",
                                     "ice-shelf-base mass flux offsets"));
 
-  m_shelf_base_mass_flux = allocate_shelf_base_mass_flux(g);
+  m_shelf_base_mass_flux.reset(new FusedField([g]() { return allocate_shelf_base_mass_flux(g); },
+                                              [this]() -> const IceModelVec2S& {
+                                                return m_input_model->shelf_base_mass_flux();
+                                              }));
 }
 
 Delta_SMB::~Delta_SMB() {
@@ -53,12 +57,16 @@ void Delta_SMB::update_impl(const Geometry &geometry, double t, double dt) {
 
   m_forcing->update(t, dt);
 
-  m_shelf_base_mass_flux->copy_from(m_input_model->shelf_base_mass_flux());
-  m_shelf_base_mass_flux->shift(m_forcing->value());
+  m_shelf_base_mass_flux->update(1.0, m_forcing->value(),
+                                 input_fused_field("shelfbmassflux"));
 }
 
 const IceModelVec2S& Delta_SMB::shelf_base_mass_flux_impl() const {
-  return *m_shelf_base_mass_flux;
+  return m_shelf_base_mass_flux->value();
+}
+
+const FusedField* Delta_SMB::fused_field_impl(const std::string &name) const {
+  return name == "shelfbmassflux" ? m_shelf_base_mass_flux.get() : nullptr;
 }
 
 } // end of namespace ocean
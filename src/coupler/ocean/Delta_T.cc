@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,7 @@
 
 #include "Delta_T.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/FusedField.hh"
 
 namespace pism {
 namespace ocean {
@@ -32,7 +33,10 @@ Delta_T::Delta_T(IceGrid::ConstPtr g, std::shared_ptr<OceanModel> in)
                                     "Kelvin",
                                     "ice-shelf-base temperature offsets"));
 
-  m_shelf_base_temperature = allocate_shelf_base_temperature(g);
+  m_shelf_base_temperature.reset(new FusedField([g]() { return allocate_shelf_base_temperature(g); },
+                                                [this]() -> const IceModelVec2S& {
+                                                  return m_input_model->shelf_base_temperature();
+                                                }));
 }
 
 Delta_T::~Delta_T() {
@@ -54,12 +58,16 @@ void Delta_T::update_impl(const Geometry &geometry, double t, double dt) {
 
   m_forcing->update(t, dt);
 
-  m_shelf_base_temperature->copy_from(m_input_model->shelf_base_temperature());
-  m_shelf_base_temperature->shift(m_forcing->value());
+  m_shelf_base_temperature->update(1.0, m_forcing->value(),
+                                   input_fused_field("shelfbtemp"));
 }
 
 const IceModelVec2S& Delta_T::shelf_base_temperature_impl() const {
-  return *m_shelf_base_temperature;
+  return m_shelf_base_temperature->value();
+}
+
+const FusedField* Delta_T::fused_field_impl(const std::string &name) const {
+  return name == "shelfbtemp" ? m_shelf_base_temperature.get() : nullptr;
 }
 
 } // end of namespace ocean
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -19,11 +19,14 @@
 #ifndef _PODTFORCING_H_
 #define _PODTFORCING_H_
 
+#include <memory>               // std::unique_ptr
+
 #include "pism/coupler/OceanModel.hh"
 
 namespace pism {
 
 class ScalarForcing;
+class FusedField;
 
 namespace ocean {
 //! \brief Forcing using shelf base temperature scalar time-dependent offsets.
@@ -39,8 +42,9 @@ private:
   void update_impl(const Geometry &geometry, double t, double dt);
 
   const IceModelVec2S& shelf_base_temperature_impl() const;
+  const FusedField* fused_field_impl(const std::string &name) const;
 
-  IceModelVec2S::Ptr m_shelf_base_temperature;
+  std::unique_ptr<FusedField> m_shelf_base_temperature;
   std::unique_ptr<ScalarForcing> m_forcing;
 };
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,7 @@
 
 #include "Frac_SMB.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/FusedField.hh"
 
 namespace pism {
 namespace ocean {
@@ -31,7 +32,10 @@ Frac_SMB::Frac_SMB(IceGrid::ConstPtr g, std::shared_ptr<OceanModel> in)
                                     "1", "1",
                                     "ice-shelf-base mass flux factor"));
 
-  m_shelf_base_mass_flux = allocate_shelf_base_mass_flux(g);
+  m_shelf_base_mass_flux.reset(new FusedField([g]() { return allocate_shelf_base_mass_flux(g); },
+                                              [this]() -> const IceModelVec2S& {
+                                                return m_input_model->shelf_base_mass_flux();
+                                              }));
 }
 
 Frac_SMB::~Frac_SMB() {
@@ -53,12 +57,16 @@ void Frac_SMB::update_impl(const Geometry &geometry, double t, double dt) {
 
   m_forcing->update(t, dt);
 
-  m_shelf_base_mass_flux->copy_from(m_input_model->shelf_base_mass_flux());
-  m_shelf_base_mass_flux->scale(m_forcing->value());
+  m_shelf_base_mass_flux->update(m_forcing->value(), 0.0,
+                                 input_fused_field("shelfbmassflux"));
 }
 
 const IceModelVec2S& Frac_SMB::shelf_base_mass_flux_impl() const {
-  return *m_shelf_base_mass_flux;
+  return m_shelf_base_mass_flux->value();
+}
+
+const FusedField* Frac_SMB::fused_field_impl(const std::string &name) const {
+  return name == "shelfbmassflux" ? m_shelf_base_mass_flux.get() : nullptr;
 }
 
 } // end of namespace ocean
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,9 @@
 
 #include <gsl/gsl_poly.h>
 #include <cassert>
+#include <cmath>                // std::sqrt, std::copysign
+#include <algorithm>            // std::min, std::max
+#include <vector>
 
 #include "GivenTH.hh"
 #include "pism/util/IceGrid.hh"
@@ -61,7 +64,10 @@ GivenTH::Constants::Constants(const Config &config) {
 }
 
 GivenTH::GivenTH(IceGrid::ConstPtr g)
-  : CompleteOceanModel(g, std::shared_ptr<OceanModel>()) {
+  : CompleteOceanModel(g, std::shared_ptr<OceanModel>()),
+    m_temperature(m_cells, m_shelf_base_temperature,
+                  m_config->get_number("constants.fresh_water.melting_point_temperature")),
+    m_mass_flux(m_cells, m_shelf_base_mass_flux, 0.0) {
 
   ForcingOptions opt(*m_grid->ctx(), "ocean.th");
 
@@ -130,37 +136,59 @@ void GivenTH::update_impl(const Geometry &geometry, double t, double dt) {
 
   Constants c(*m_config);
 
+  // Outputs of this model are used in floating (and, possibly, partially floating) areas
+  // only, so we compute them at these grid points only. Elsewhere shelf base mass flux is
+  // set to zero and shelf base temperature to the melting point temperature of fresh
+  // water.
+  m_cells.update(geometry,
+                 m_config->get_flag("geometry.grounded_cell_fraction") and
+                 m_config->get_flag("energy.basal_melt.use_grounded_cell_fraction"));
+
   const IceModelVec2S &ice_thickness = geometry.ice_thickness;
 
-  IceModelVec2S &temperature = *m_shelf_base_temperature;
-  IceModelVec2S &mass_flux = *m_shelf_base_mass_flux;
+  std::vector<double> &temperature = m_temperature.values();
+  std::vector<double> &mass_flux   = m_mass_flux.values();
+
+  IceModelVec::AccessList list{ &ice_thickness, m_theta_ocean.get(), m_salinity_ocean.get()};
 
-  IceModelVec::AccessList list{ &ice_thickness, m_theta_ocean.get(), m_salinity_ocean.get(),
-      &temperature, &mass_flux};
+  // Cells are processed in blocks (see pointwise_update_n()).
+  const unsigned int
+    block_size = 64,
+    N          = m_cells.size();
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  std::vector<double> S(block_size), Theta(block_size), H(block_size);
 
-    double potential_temperature_celsius = (*m_theta_ocean)(i,j) - 273.15;
+  // convert mass flux from [m s-1] to [kg m-2 s-1]:
+  const double ice_density = m_config->get_number("constants.ice.density");
 
-    double
-      shelf_base_temp_celsius = 0.0,
-      shelf_base_massflux     = 0.0;
+  for (unsigned int start = 0; start < N; start += block_size) {
+    const unsigned int n = std::min(block_size, N - start);
 
-    pointwise_update(c,
-                     (*m_salinity_ocean)(i,j),
-                     potential_temperature_celsius,
-                     ice_thickness(i,j),
-                     &shelf_base_temp_celsius,
-                     &shelf_base_massflux);
+    for (unsigned int k = 0; k < n; ++k) {
+      const int i = m_cells.i(start + k), j = m_cells.j(start + k);
+
+      S[k]     = (*m_salinity_ocean)(i,j);
+      Theta[k] = (*m_theta_ocean)(i,j) - 273.15;
+      H[k]     = ice_thickness(i,j);
+    }
 
-    // Convert from Celsius to Kelvin:
-    temperature(i,j) = shelf_base_temp_celsius + 273.15;
-    mass_flux(i,j)   = shelf_base_massflux;
+    pointwise_update_n(c, n, S.data(), Theta.data(), H.data(),
+                       &temperature[start], &mass_flux[start]);
+
+    for (unsigned int k = start; k < start + n; ++k) {
+      // Convert from Celsius to Kelvin:
+      temperature[k] += 273.15;
+      mass_flux[k]   *= ice_density;
+    }
   }
+}
 
-  // convert mass flux from [m s-1] to [kg m-2 s-1]:
-  m_shelf_base_mass_flux->scale(m_config->get_number("constants.ice.density"));
+const IceModelVec2S& GivenTH::shelf_base_temperature_impl() const {
+  return m_temperature.dense();
+}
+
+const IceModelVec2S& GivenTH::shelf_base_mass_flux_impl() const {
+  return m_mass_flux.dense();
 }
 
 MaxTimestep GivenTH::max_timestep_impl(double t) const {
@@ -172,7 +200,7 @@ MaxTimestep GivenTH::max_timestep_impl(double t) const {
 //* Evaluate the parameterization of the melting point temperature.
 /** The value returned is in degrees Celsius.
  */
-static double melting_point_temperature(GivenTH::Constants c,
+static double melting_point_temperature(const GivenTH::Constants &c,
                                         double salinity, double ice_thickness) {
   return c.a[0] * salinity + c.a[1] + c.a[2] * ice_thickness;
 }
@@ -185,12 +213,27 @@ static double melting_point_temperature(GivenTH::Constants c,
  *
  * @return shelf base melt rate, in [m/s]
  */
-static double shelf_base_melt_rate(GivenTH::Constants c,
+static double shelf_base_melt_rate(const GivenTH::Constants &c,
                                    double sea_water_salinity, double basal_salinity) {
 
   return c.gamma_S * c.sea_water_density * (sea_water_salinity - basal_salinity) / (c.ice_density * basal_salinity);
 }
 
+/*!
+ * The bigger root of the quadratic equation @f$ A x^2 + B x + C = 0 @f$.
+ *
+ * Uses the same numerically stable formula as `gsl_poly_solve_quadratic()`, but without
+ * branches (assumes that @f$ A \ne 0 @f$ and that roots are real).
+ */
+static inline double bigger_root(double A, double B, double C) {
+  const double
+    q  = -0.5 * (B + std::copysign(std::sqrt(B * B - 4.0 * A * C), B)),
+    x0 = q / A,
+    x1 = C / q;
+
+  return std::max(x0, x1);
+}
+
 /** @brief Compute temperature and melt rate at the base of the shelf.
  * Based on [@ref HellmerOlbers1989] and [@ref HollandJenkins1999].
  *
@@ -386,6 +429,93 @@ void GivenTH::pointwise_update(const Constants &constants,
 }
 
 
+/*!
+ * Compute temperature and melt rate at the base of the shelf at `n` points.
+ *
+ * Produces the same results as pointwise_update(), but avoids branches: basal salinity is
+ * computed for all three cases (melt, freeze-on, diffusion-only) and then the first of
+ * them that is consistent with the corresponding basal melt rate is selected (see
+ * subshelf_salinity()). This is less work than it seems because all three cases share
+ * most of the arithmetic and the loop can be vectorized by the compiler.
+ */
+void GivenTH::pointwise_update_n(const Constants &constants,
+                                 unsigned int n,
+                                 const double *sea_water_salinity,
+                                 const double *sea_water_potential_temperature,
+                                 const double *ice_thickness,
+                                 double *shelf_base_temperature_out,
+                                 double *shelf_base_melt_rate_out) {
+  // a local copy: outputs cannot alias it, so constants are not re-loaded in the loop
+  const Constants c = constants;
+
+  // This model works for sea water salinity in the range of [4, 40] psu (see
+  // pointwise_update()).
+  const double
+    min_salinity = c.limit_salinity_range ? 4.0 : -HUGE_VAL,
+    max_salinity = c.limit_salinity_range ? 40.0 : HUGE_VAL;
+
+  const double
+    c_pI    = c.ice_specific_heat_capacity,
+    c_pW    = c.sea_water_specific_heat_capacity,
+    L       = c.water_latent_heat_fusion,
+    T_S     = c.shelf_top_surface_temperature,
+    rho_W   = c.sea_water_density,
+    rho_I   = c.ice_density,
+    kappa   = c.ice_thermal_diffusivity,
+    // coefficients that do not depend on inputs
+    A_melt   = c.a[0] * c.gamma_S * c_pI - c.b[0] * c.gamma_T * c_pW,
+    A_freeze = -c.b[0] * c.gamma_T * c_pW;
+
+  for (unsigned int k = 0; k < n; ++k) {
+    const double
+      S_W     = std::min(std::max(sea_water_salinity[k], min_salinity), max_salinity),
+      Theta_W = sea_water_potential_temperature[k],
+      h       = ice_thickness[k],
+      // the diffusion-only case is undefined if h == 0, but it does not matter: the melt
+      // rate is set to zero in this case (see below)
+      h_d     = h > 0.0 ? h : 1.0,
+      // terms shared by all three cases
+      B_ocean = c.gamma_T * c_pW * (Theta_W - c.b[2] * h - c.b[1]),
+      C0      = -c.gamma_S * S_W * L;
+
+    // melt (see subshelf_salinity_melt())
+    const double S_melt =
+      bigger_root(A_melt,
+                  c.gamma_S * (L - c_pI * (T_S + c.a[0] * S_W - c.a[2] * h - c.a[1])) + B_ocean,
+                  -c.gamma_S * S_W * (L - c_pI * (T_S - c.a[2] * h - c.a[1])));
+
+    // freeze-on (see subshelf_salinity_freeze_on())
+    const double S_freeze = bigger_root(A_freeze, c.gamma_S * L + B_ocean, C0);
+
+    // diffusion only (see subshelf_salinity_diffusion_only())
+    const double
+      B_d    = c.gamma_T * c_pW * (Theta_W - c.b[2] * h_d - c.b[1]),
+      S_diff = bigger_root(-(c.b[0] * c.gamma_T * h_d * rho_W * c_pW -
+                             c.a[0] * rho_I * c_pI * kappa) / (h_d * rho_W),
+                           (rho_I * c_pI * kappa * (T_S - c.a[2] * h_d - c.a[1])) / (h_d * rho_W) +
+                           c.gamma_S * L + B_d,
+                           C0);
+
+    const double
+      melt_rate_melt   = shelf_base_melt_rate(c, S_W, S_melt),
+      melt_rate_freeze = shelf_base_melt_rate(c, S_W, S_freeze);
+
+    double S_B = (melt_rate_melt > 0.0 ? S_melt :
+                  (melt_rate_freeze < 0.0 ? S_freeze : S_diff));
+
+    // Clip basal salinity so that we can use the freezing point temperature
+    // parameterization to recover shelf base temperature.
+    S_B = std::min(std::max(S_B, min_salinity), max_salinity);
+
+    const double melt_rate = shelf_base_melt_rate(c, S_W, S_B);
+
+    shelf_base_temperature_out[k] = melting_point_temperature(c, S_B, h);
+
+    // no melt if there is no ice
+    shelf_base_melt_rate_out[k] = h > 0.0 ? melt_rate : 0.0;
+  }
+}
+
 /** @brief Compute the basal salinity and make sure that it is
  * consistent with the basal melt rate.
  *
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 #define _POGIVENTH_H_
 
 #include "CompleteOceanModel.hh"
+#include "SparseField.hh"
 #include "pism/util/iceModelVec2T.hh"
 
 namespace pism {
@@ -58,44 +59,60 @@ public:
     double ice_thermal_diffusivity;
     bool limit_salinity_range;
   };
+
+  static void pointwise_update(const Constants &constants,
+                               double sea_water_salinity,
+                               double sea_water_potential_temperature,
+                               double ice_thickness,
+                               double *shelf_base_temperature_out,
+                               double *shelf_base_melt_rate_out);
+
+  static void pointwise_update_n(const Constants &constants,
+                                 unsigned int n,
+                                 const double *sea_water_salinity,
+                                 const double *sea_water_potential_temperature,
+                                 const double *ice_thickness,
+                                 double *shelf_base_temperature_out,
+                                 double *shelf_base_melt_rate_out);
 private:
   void update_impl(const Geometry &geometry, double t, double dt);
   void init_impl(const Geometry &geometry);
   MaxTimestep max_timestep_impl(double t) const;
 
+  const IceModelVec2S& shelf_base_temperature_impl() const;
+  const IceModelVec2S& shelf_base_mass_flux_impl() const;
+
   IceModelVec2T::Ptr m_theta_ocean;
   IceModelVec2T::Ptr m_salinity_ocean;
 
-  void pointwise_update(const Constants &constants,
-                        double sea_water_salinity,
-                        double sea_water_potential_temperature,
-                        double ice_thickness,
-                        double *shelf_base_temperature_out,
-                        double *shelf_base_melt_rate_out);
-
-  void subshelf_salinity(const Constants &constants,
-                         double sea_water_salinity,
-                         double sea_water_potential_temperature,
-                         double ice_thickness,
-                         double *shelf_base_salinity);
-
-  void subshelf_salinity_melt(const Constants &constants,
-                              double sea_water_salinity,
-                              double sea_water_potential_temperature,
-                              double ice_thickness,
-                              double *shelf_base_salinity);
-
-  void subshelf_salinity_freeze_on(const Constants &constants,
-                                   double sea_water_salinity,
-                                   double sea_water_potential_temperature,
-                                   double ice_thickness,
-                                   double *shelf_base_salinity);
-
-  void subshelf_salinity_diffusion_only(const Constants &constants,
-                                        double sea_water_salinity,
-                                        double sea_water_potential_temperature,
-                                        double ice_thickness,
-                                        double *shelf_base_salinity);
+  // grid points where outputs are computed and outputs at these points
+  OceanCells m_cells;
+  SparseField m_temperature;
+  SparseField m_mass_flux;
+
+  static void subshelf_salinity(const Constants &constants,
+                                double sea_water_salinity,
+                                double sea_water_potential_temperature,
+                                double ice_thickness,
+                                double *shelf_base_salinity);
+
+  static void subshelf_salinity_melt(const Constants &constants,
+                                     double sea_water_salinity,
+                                     double sea_water_potential_temperature,
+                                     double ice_thickness,
+                                     double *shelf_base_salinity);
+
+  static void subshelf_salinity_freeze_on(const Constants &constants,
+                                          double sea_water_salinity,
+                                          double sea_water_potential_temperature,
+                                          double ice_thickness,
+                                          double *shelf_base_salinity);
+
+  static void subshelf_salinity_diffusion_only(const Constants &constants,
+                                               double sea_water_salinity,
+                                               double sea_water_potential_temperature,
+                                               double ice_thickness,
+                                               double *shelf_base_salinity);
 };
 
 } // end of namespace ocean
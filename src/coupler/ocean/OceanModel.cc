@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -271,5 +271,20 @@ TSDiagnosticList OceanModel::ts_diagnostics_impl() const {
 }
 
 
+/*!
+ * Default implementation: this model is not a scalar modifier (see FusedField).
+ */
+const FusedField* OceanModel::fused_field_impl(const std::string &name) const {
+  (void) name;
+  return nullptr;
+}
+
+const FusedField* OceanModel::input_fused_field(const std::string &name) const {
+  if (m_input_model) {
+    return m_input_model->fused_field_impl(name);
+  }
+  return nullptr;
+}
+
 } // end of namespace ocean
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2019 Constantine Khrulev, Ricarda Winkelmann, Ronja Reese, Torsten
+// Copyright (C) 2012-2020 Constantine Khrulev, Ricarda Winkelmann, Ronja Reese, Torsten
 // Albrecht, and Matthias Mengel
 //
 // This file is part of PISM.
@@ -315,14 +315,13 @@ void Pico::compute_ocean_input_per_basin(const PicoPhysics &physics, const IceMo
                                          const IceModelVec2S &salinity_ocean, const IceModelVec2S &theta_ocean,
                                          std::vector<double> &temperature, std::vector<double> &salinity) {
 
-  std::vector<int> count(m_n_basins, 0);
-
-  temperature.resize(m_n_basins);
-  salinity.resize(m_n_basins);
-  for (int basin_id = 0; basin_id < m_n_basins; basin_id++) {
-    temperature[basin_id] = 0.0;
-    salinity[basin_id]    = 0.0;
-  }
+  // number of cells, sums of salinity and temperature for each basin, stored together to
+  // compute global sums using one reduction
+  std::vector<double> sums(3 * m_n_basins, 0.0);
+  double
+    *count        = &sums[0],
+    *salinity_sum = &sums[m_n_basins],
+    *theta_sum    = &sums[2 * m_n_basins];
 
   IceModelVec::AccessList list{ &theta_ocean, &salinity_ocean, &basin_mask, &continental_shelf_mask };
 
@@ -336,21 +335,25 @@ void Pico::compute_ocean_input_per_basin(const PicoPhysics &physics, const IceMo
       int basin_id = basin_mask.as_int(i, j);
 
       count[basin_id] += 1;
-      salinity[basin_id] += salinity_ocean(i, j);
-      temperature[basin_id] += theta_ocean(i, j);
+      salinity_sum[basin_id] += salinity_ocean(i, j);
+      theta_sum[basin_id] += theta_ocean(i, j);
     }
   }
 
+  {
+    std::vector<double> tmp(sums);
+    GlobalSum(m_grid->com, tmp.data(), sums.data(), sums.size());
+  }
+
+  temperature.resize(m_n_basins);
+  salinity.resize(m_n_basins);
+
   // Divide by number of grid cells if more than zero cells belong to the basin. if no
   // ocean_contshelf_mask values intersect with the basin, count is zero. In such case,
   // use dummy temperature and salinity. This could happen, for example, if the ice shelf
   // front advances beyond the continental shelf break.
   for (int basin_id = 0; basin_id < m_n_basins; basin_id++) {
 
-    count[basin_id]       = GlobalSum(m_grid->com, count[basin_id]);
-    salinity[basin_id]    = GlobalSum(m_grid->com, salinity[basin_id]);
-    temperature[basin_id] = GlobalSum(m_grid->com, temperature[basin_id]);
-
     // if basin is not dummy basin 0 or there are no ocean cells in this basin to take the mean over.
     if (basin_id > 0 && count[basin_id] == 0) {
       m_log->message(2, "PICO ocean WARNING: basin %d contains no cells with ocean data on continental shelf\n"
@@ -365,8 +368,8 @@ void Pico::compute_ocean_input_per_basin(const PicoPhysics &physics, const IceMo
 
     } else {
 
-      salinity[basin_id] /= count[basin_id];
-      temperature[basin_id] /= count[basin_id];
+      salinity[basin_id]    = salinity_sum[basin_id] / count[basin_id];
+      temperature[basin_id] = theta_sum[basin_id] / count[basin_id];
 
       m_log->message(5, "  %d: temp =%.3f, salinity=%.3f\n", basin_id, temperature[basin_id], salinity[basin_id]);
     }
@@ -388,8 +391,13 @@ void Pico::set_ocean_input_fields(const PicoPhysics &physics, const IceModelVec2
 
   IceModelVec::AccessList list{ &ice_thickness, &basin_mask, &Soc_box0, &Toc_box0, &mask, &shelf_mask };
 
-  std::vector<std::vector<int> > n_shelf_cells_per_basin(m_n_shelves, std::vector<int>(m_n_basins, 0));
-  std::vector<int> n_shelf_cells(m_n_shelves, 0);
+  // Number of cells in the intersection of each shelf with each basin (element s *
+  // m_n_basins + b) followed by numbers of cells in each shelf. Stored in one array to
+  // compute global sums using one reduction.
+  std::vector<double> counts(m_n_shelves * (m_n_basins + 1), 0.0);
+  double
+    *n_shelf_cells_per_basin = &counts[0],
+    *n_shelf_cells           = &counts[m_n_shelves * m_n_basins];
 
   // 1) count the number of cells in each shelf
   // 2) count the number of cells in the intersection of each shelf with all the basins
@@ -398,16 +406,12 @@ void Pico::set_ocean_input_fields(const PicoPhysics &physics, const IceModelVec2
       const int i = p.i(), j = p.j();
       int s = shelf_mask.as_int(i, j);
       int b = basin_mask.as_int(i, j);
-      n_shelf_cells_per_basin[s][b]++;
-      n_shelf_cells[s]++;
+      n_shelf_cells_per_basin[s * m_n_basins + b] += 1.0;
+      n_shelf_cells[s] += 1.0;
     }
 
-    for (int s = 0; s < m_n_shelves; s++) {
-      n_shelf_cells[s] = GlobalSum(m_grid->com, n_shelf_cells[s]);
-      for (int b = 0; b < m_n_basins; b++) {
-        n_shelf_cells_per_basin[s][b] = GlobalSum(m_grid->com, n_shelf_cells_per_basin[s][b]);
-      }
-    }
+    std::vector<double> tmp(counts);
+    GlobalSum(m_grid->com, tmp.data(), counts.data(), counts.size());
   }
 
   // now set potential temperature and salinity box 0:
@@ -427,8 +431,8 @@ void Pico::set_ocean_input_fields(const PicoPhysics &physics, const IceModelVec2
 
       // weighted input depending on the number of shelf cells in each basin
       for (int b = 1; b < m_n_basins; b++) { //Note: b=0 yields nan
-        Toc_box0(i, j) += basin_temperature[b] * n_shelf_cells_per_basin[s][b] / (double)n_shelf_cells[s];
-        Soc_box0(i, j) += basin_salinity[b] * n_shelf_cells_per_basin[s][b] / (double)n_shelf_cells[s];
+        Toc_box0(i, j) += basin_temperature[b] * n_shelf_cells_per_basin[s * m_n_basins + b] / n_shelf_cells[s];
+        Soc_box0(i, j) += basin_salinity[b] * n_shelf_cells_per_basin[s * m_n_basins + b] / n_shelf_cells[s];
       }
 
       double theta_pm = physics.theta_pm(Soc_box0(i, j), physics.pressure(ice_thickness(i, j)));
@@ -586,6 +590,10 @@ void Pico::process_other_boxes(const PicoPhysics &physics,
   // get average overturning from box 1 that is used as input later
   compute_box_average(1, m_overturning, shelf_mask, box_mask, overturning);
 
+  // numbers of cells using the Beckmann-Goosse parameterization in each box (reported
+  // after processing all boxes to avoid a reduction per box)
+  std::vector<double> n_beckmann_goosse_cells(m_n_boxes + 1, 0.0);
+
   std::vector<bool> use_beckmann_goosse(m_n_shelves);
 
   IceModelVec::AccessList list{ &ice_thickness, &shelf_mask,      &box_mask,           &T_star,   &Toc,
@@ -594,8 +602,9 @@ void Pico::process_other_boxes(const PicoPhysics &physics,
   // Iterate over all boxes i for i > 1
   for (int box = 2; box <= m_n_boxes; ++box) {
 
-    compute_box_average(box - 1, Toc, shelf_mask, box_mask, temperature);
-    compute_box_average(box - 1, Soc, shelf_mask, box_mask, salinity);
+    // Averages of temperature and salinity over the previous box (one reduction): each box
+    // depends on the previous one, so this takes one reduction per box.
+    compute_box_average(box - 1, Toc, Soc, shelf_mask, box_mask, temperature, salinity);
 
     // find all the shelves where we should fall back to the Beckmann-Goosse
     // parameterization
@@ -610,8 +619,6 @@ void Pico::process_other_boxes(const PicoPhysics &physics,
     std::vector<double> box_area;
     compute_box_area(box, shelf_mask, box_mask, box_area);
 
-    int n_beckmann_goosse_cells = 0;
-
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
@@ -620,7 +627,7 @@ void Pico::process_other_boxes(const PicoPhysics &physics,
       if (box_mask.as_int(i, j) == box and shelf_id > 0) {
 
         if (use_beckmann_goosse[shelf_id]) {
-          n_beckmann_goosse_cells += 1;
+          n_beckmann_goosse_cells[box] += 1.0;
           continue;
         }
 
@@ -645,14 +652,21 @@ void Pico::process_other_boxes(const PicoPhysics &physics,
       }
     } // loop over grid points
 
-    n_beckmann_goosse_cells = GlobalSum(m_grid->com, n_beckmann_goosse_cells);
-    if (n_beckmann_goosse_cells > 0) {
+  } // loop over boxes
+
+  {
+    std::vector<double> tmp(n_beckmann_goosse_cells);
+    GlobalSum(m_grid->com, tmp.data(), n_beckmann_goosse_cells.data(),
+              n_beckmann_goosse_cells.size());
+  }
+
+  for (int box = 2; box <= m_n_boxes; ++box) {
+    if (n_beckmann_goosse_cells[box] > 0) {
       m_log->message(2, "PICO ocean WARNING: box %d, no boundary data from previous box in %d case(s)!\n"
                         "switching to Beckmann Goosse (2003) meltrate calculation\n",
-                     box, n_beckmann_goosse_cells);
+                     box, (int)n_beckmann_goosse_cells[box]);
     }
-
-  } // loop over boxes
+  }
 }
 
 /*!
@@ -731,37 +745,77 @@ void Pico::compute_box_average(int box_id,
                                const IceModelVec2Int &shelf_mask,
                                const IceModelVec2Int &box_mask,
                                std::vector<double> &result) {
+  compute_box_average(box_id, {&field}, shelf_mask, box_mask, {&result});
+}
 
-  IceModelVec::AccessList list{ &field, &shelf_mask, &box_mask };
+/*!
+ * For each shelf, compute averages of two fields over the box with id `box_id`.
+ */
+void Pico::compute_box_average(int box_id,
+                               const IceModelVec2S &field_1,
+                               const IceModelVec2S &field_2,
+                               const IceModelVec2Int &shelf_mask,
+                               const IceModelVec2Int &box_mask,
+                               std::vector<double> &result_1,
+                               std::vector<double> &result_2) {
+  compute_box_average(box_id, {&field_1, &field_2}, shelf_mask, box_mask,
+                      {&result_1, &result_2});
+}
+
+/*!
+ * For each shelf, compute averages of `fields` over the box with id `box_id`.
+ *
+ * Uses one reduction for all fields and shelves.
+ */
+void Pico::compute_box_average(int box_id,
+                               const std::vector<const IceModelVec2S*> &fields,
+                               const IceModelVec2Int &shelf_mask,
+                               const IceModelVec2Int &box_mask,
+                               const std::vector<std::vector<double>*> &results) {
 
-  std::vector<int> n_cells_per_box(m_n_shelves, 0);
+  const int N = fields.size();
 
-  // fill results with zeros
-  result.resize(m_n_shelves);
-  for (int s = 0; s < m_n_shelves; ++s) {
-    result[s] = 0.0;
+  IceModelVec::AccessList list{ &shelf_mask, &box_mask };
+  for (const auto *f : fields) {
+    list.add(*f);
   }
 
-  // compute the sum of field in each shelf's box box_id
+  // number of cells in each shelf's box box_id followed by sums of each field
+  std::vector<double> sums((N + 1) * m_n_shelves, 0.0);
+
+  // compute the sum of fields in each shelf's box box_id
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
     int shelf_id = shelf_mask.as_int(i, j);
 
     if (box_mask.as_int(i, j) == box_id) {
-      n_cells_per_box[shelf_id] += 1;
-      result[shelf_id] += field(i, j);
+      sums[shelf_id] += 1.0;
+      for (int k = 0; k < N; ++k) {
+        sums[(k + 1) * m_n_shelves + shelf_id] += (*fields[k])(i, j);
+      }
     }
   }
 
-  // compute the global sum and average
-  for (int s = 0; s < m_n_shelves; ++s) {
-    auto n_cells = GlobalSum(m_grid->com, n_cells_per_box[s]);
+  // compute global sums
+  {
+    std::vector<double> tmp(sums);
+    GlobalSum(m_grid->com, tmp.data(), sums.data(), sums.size());
+  }
 
-    result[s] = GlobalSum(m_grid->com, result[s]);
+  // compute averages
+  for (int k = 0; k < N; ++k) {
+    std::vector<double> &result = *results[k];
 
-    if (n_cells > 0) {
-      result[s] /= (double)n_cells;
+    result.resize(m_n_shelves);
+    for (int s = 0; s < m_n_shelves; ++s) {
+      const double n_cells = sums[s];
+
+      result[s] = sums[(k + 1) * m_n_shelves + s];
+
+      if (n_cells > 0) {
+        result[s] /= n_cells;
+      }
     }
   }
 }
@@ -778,26 +832,25 @@ void Pico::compute_box_area(int box_id,
                             const IceModelVec2Int &shelf_mask,
                             const IceModelVec2Int &box_mask,
                             std::vector<double> &result) {
-  result.resize(m_n_shelves);
-
   IceModelVec::AccessList list{ &shelf_mask, &box_mask };
 
   auto cell_area = m_grid->cell_area();
 
+  std::vector<double> area(m_n_shelves, 0.0);
+
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
     int shelf_id = shelf_mask.as_int(i, j);
 
     if (shelf_id > 0 and box_mask.as_int(i, j) == box_id) {
-      result[shelf_id] += cell_area;
+      area[shelf_id] += cell_area;
     }
   }
 
-  // compute global sums
-  for (int s = 1; s < m_n_shelves; ++s) {
-    result[s] = GlobalSum(m_grid->com, result[s]);
-  }
+  // compute global sums (one reduction for all shelves)
+  result.resize(m_n_shelves);
+  GlobalSum(m_grid->com, area.data(), result.data(), m_n_shelves);
 }
 
 } // end of namespace ocean
@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2016, 2018 Ricarda Winkelmann, Ronja Reese, Torsten Albrecht
+// Copyright (C) 2012-2016, 2018, 2020 Ricarda Winkelmann, Ronja Reese, Torsten Albrecht
 // and Matthias Mengel
 //
 // This file is part of PISM.
@@ -123,6 +123,20 @@ private:
                            const IceModelVec2Int &box_mask,
                            std::vector<double> &result);
 
+  void compute_box_average(int box_id,
+                           const IceModelVec2S &field_1,
+                           const IceModelVec2S &field_2,
+                           const IceModelVec2Int &shelf_mask,
+                           const IceModelVec2Int &box_mask,
+                           std::vector<double> &result_1,
+                           std::vector<double> &result_2);
+
+  void compute_box_average(int box_id,
+                           const std::vector<const IceModelVec2S*> &fields,
+                           const IceModelVec2Int &shelf_mask,
+                           const IceModelVec2Int &box_mask,
+                           const std::vector<std::vector<double>*> &results);
+
   void compute_box_area(int box_id,
                         const IceModelVec2Int &shelf_mask,
                         const IceModelVec2Int &box_mask,
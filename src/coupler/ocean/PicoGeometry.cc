@@ -1,4 +1,4 @@
-/* Copyright (C) 2018, 2019 PISM Authors
+/* Copyright (C) 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,9 +20,11 @@
 #include <algorithm> // max_element
 
 #include "PicoGeometry.hh"
-#include "pism/util/connected_components.hh"
+#include "pism/util/label_components.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/Profiling.hh"
 
 namespace pism {
 namespace ocean {
@@ -37,7 +39,12 @@ PicoGeometry::PicoGeometry(IceGrid::ConstPtr grid)
       m_ocean_mask(grid, "pico_ocean_mask", WITH_GHOSTS),
       m_lake_mask(grid, "pico_lake_mask", WITHOUT_GHOSTS),
       m_ice_rises(grid, "pico_ice_rise_mask", WITH_GHOSTS),
-      m_tmp(grid, "temporary_storage", WITHOUT_GHOSTS) {
+      m_tmp(grid, "temporary_storage", WITHOUT_GHOSTS),
+      m_label_work(grid, "label_components_work", WITH_GHOSTS, 1),
+      m_cell_type(grid, "pico_cell_type", WITHOUT_GHOSTS),
+      m_bed_above_threshold(grid, "pico_bed_above_threshold", WITHOUT_GHOSTS),
+      m_cell_type_is_valid(false),
+      m_bed_above_threshold_is_valid(false) {
 
   m_boxes.metadata().set_number("_FillValue", 0.0);
 
@@ -45,8 +52,6 @@ PicoGeometry::PicoGeometry(IceGrid::ConstPtr grid)
                                      {OCEAN, RISE, CONTINENTAL, FLOATING});
   m_ice_rises.metadata().set_string("flag_meanings",
                                      "ocean ice_rise continental_ice_sheet, floating_ice");
-
-  m_tmp_p0 = m_tmp.allocate_proc0_copy();
 }
 
 PicoGeometry::~PicoGeometry() {
@@ -69,11 +74,48 @@ const IceModelVec2Int &PicoGeometry::ice_rise_mask() const {
   return m_ice_rises;
 }
 
+/*!
+ * Compare `input` to `cache` and copy `input` to `cache` if they differ.
+ *
+ * Returns true if `cache` was updated (i.e. if `input` changed since the last call).
+ */
+bool PicoGeometry::update_cache(const IceModelVec2S &input, IceModelVec2Int &cache, bool &valid) {
+  int changed = 0;
+
+  if (valid) {
+    IceModelVec::AccessList list{&input, &cache};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (input(i, j) != cache(i, j)) {
+        changed = 1;
+        break;
+      }
+    }
+    changed = GlobalMax(m_grid->com, changed);
+  } else {
+    changed = 1;
+  }
+
+  if (changed != 0) {
+    cache.copy_from(input);
+    valid = true;
+  }
+
+  return changed != 0;
+}
+
 /*!
  * Compute masks needed by the PICO physics code.
  *
  * After this call box_mask(), ice_shelf_mask(), and continental_shelf_mask() will be up
  * to date.
+ *
+ * Results depend on `cell_type` and on the locations where `bed_elevation` is above the
+ * continental shelf depth. This method keeps copies of these inputs and skips
+ * re-computation if they did not change since the last call: the cell type mask usually
+ * stays the same between calving events.
  */
 void PicoGeometry::update(const IceModelVec2S &bed_elevation, const IceModelVec2CellType &cell_type) {
   bool exclude_ice_rises = m_config->get_flag("ocean.pico.exclude_ice_rises");
@@ -82,6 +124,28 @@ void PicoGeometry::update(const IceModelVec2S &bed_elevation, const IceModelVec2
 
   double continental_shelf_depth = m_config->get_number("ocean.pico.continental_shelf_depth");
 
+  {
+    IceModelVec::AccessList list{&bed_elevation, &m_tmp};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_tmp(i, j) = bed_elevation(i, j) > continental_shelf_depth ? 1.0 : 0.0;
+    }
+  }
+
+  bool cell_type_changed = update_cache(cell_type, m_cell_type, m_cell_type_is_valid);
+  bool bed_changed       = update_cache(m_tmp, m_bed_above_threshold, m_bed_above_threshold_is_valid);
+
+  if (not cell_type_changed) {
+    if (bed_changed) {
+      // only the continental shelf mask depends on the bed elevation
+      compute_continental_shelf_mask(bed_elevation, m_ice_rises, continental_shelf_depth,
+                                     m_continental_shelf);
+    }
+    return;
+  }
+
   // these three could be done at the same time
   {
     compute_ice_rises(cell_type, exclude_ice_rises, m_ice_rises);
@@ -115,7 +179,7 @@ void PicoGeometry::update(const IceModelVec2S &bed_elevation, const IceModelVec2
 enum RelabelingType {BY_AREA, AREA_THRESHOLD};
 
 /*!
- * Re-label components in a mask processed by label_connected_components.
+ * Re-label components in a mask processed by label_components().
  *
  * If type is `BY_AREA`, the biggest one gets the value of 2, all the other ones 1, the
  * background is set to zero.
@@ -161,8 +225,12 @@ static void relabel(RelabelingType type,
     }
     loop.check();
 
+    // one reduction for all components
+    std::vector<double> n_cells(area.size());
+    GlobalSum(grid->com, area.data(), n_cells.data(), area.size());
+
     for (unsigned int k = 0; k < area.size(); ++k) {
-      area[k] = grid->cell_area() * GlobalSum(grid->com, area[k]);
+      area[k] = grid->cell_area() * n_cells[k];
     }
   }
 
@@ -207,23 +275,10 @@ static void relabel(RelabelingType type,
 }
 
 /*!
- * Run the serial connected-component labeling algorithm on m_tmp.
+ * Run the connected-component labeling algorithm on m_tmp.
  */
 void PicoGeometry::label_tmp() {
-  m_tmp.put_on_proc0(*m_tmp_p0);
-
-  ParallelSection rank0(m_grid->com);
-  try {
-    if (m_grid->rank() == 0) {
-      petsc::VecArray mask_p0(*m_tmp_p0);
-      label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), false, 0.0);
-    }
-  } catch (...) {
-    rank0.failed();
-  }
-  rank0.check();
-
-  m_tmp.get_from_proc0(*m_tmp_p0);
+  label_components(m_tmp, false, 0.0, m_label_work);
 }
 
 static bool edge_p(int i, int j, int Mx, int My) {
@@ -264,22 +319,7 @@ void PicoGeometry::compute_lakes(const IceModelVec2CellType &cell_type, IceModel
   }
 
   // identify "floating" areas that are not connected to the open ocean as defined above
-  {
-    m_tmp.put_on_proc0(*m_tmp_p0);
-
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_tmp_p0);
-        label_connected_components(mask_p0.get(), My, Mx, true, 2.0);
-      }
-    } catch (...) {
-      rank0.failed();
-    }
-    rank0.check();
-
-    m_tmp.get_from_proc0(*m_tmp_p0);
-  }
+  label_components(m_tmp, true, 2.0, m_label_work);
 
   result.copy_from(m_tmp);
 }
@@ -360,22 +400,7 @@ void PicoGeometry::compute_continental_shelf_mask(const IceModelVec2S &bed_eleva
 
   // use "iceberg identification" to label parts *not* connected to the continental ice
   // sheet
-  {
-    m_tmp.put_on_proc0(*m_tmp_p0);
-
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_tmp_p0);
-        label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), true, 2.0);
-      }
-    } catch (...) {
-      rank0.failed();
-    }
-    rank0.check();
-
-    m_tmp.get_from_proc0(*m_tmp_p0);
-  }
+  label_components(m_tmp, true, 2.0, m_label_work);
 
   // At this point areas with bed > threshold are 1, everything else is zero.
   //
@@ -572,45 +597,114 @@ void PicoGeometry::compute_distances_cf(const IceModelVec2Int &ocean_mask,
  * generic ice shelf locations with zeros, set neighbors of the grounding line to 1, and
  * the rest of the grid with -1 or some other negative number.
  *
- * Note that this implementation updates ghosts *every* iteration. We could speed this
- * up by checking if a point at a boundary of the processor sub-domain was updated and
- * update ghosts in those cases only.
+ * On return each cell in the domain contains one plus the length of the shortest path
+ * (using 4-connected steps within the domain) to the nearest "wave front" cell. Domain
+ * cells not connected to the front remain zero.
+ *
+ * This implementation uses fast sweeping: each pass performs four Gauss-Seidel sweeps in
+ * alternating directions over the processor sub-domain, followed by one ghost update. A
+ * single pass computes distances exactly along paths that do not turn back more than
+ * once and stay within one sub-domain, so the number of passes is usually small (it
+ * grows with the number of sub-domains a shortest path crosses and with the number of
+ * times it changes direction). Each pass is recorded as the profiling event
+ * "ocean.pico.distance_pass".
  */
 void eikonal_equation(IceModelVec2Int &mask) {
 
   assert(mask.stencil_width() > 0);
 
   IceGrid::ConstPtr grid = mask.grid();
+  const Profiling &profiling = grid->ctx()->profiling();
 
-  double current_label = 1;
-  double continue_loop = 1;
-  while (continue_loop != 0) {
+  // a value bigger than any distance
+  const double unknown = 2.0 * (grid->Mx() + 2.0) * (grid->My() + 2.0);
 
-    continue_loop = 0;
+  const int
+    xs = grid->xs(),
+    xm = grid->xm(),
+    ys = grid->ys(),
+    ym = grid->ym();
 
-    for (Points p(*grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  IceModelVec::AccessList list{&mask};
 
-      if (mask.as_int(i, j) == 0) {
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
 
-        auto R = mask.int_star(i, j);
+    if (mask(i, j) == 0.0) {
+      mask(i, j) = unknown;
+    }
+  }
+  mask.update_ghosts();
 
-        if (R.ij == 0 and
-            (R.n == current_label or R.s == current_label or
-             R.e == current_label or R.w == current_label)) {
-          // i.e. this is an shelf cell with no distance assigned yet and with a neighbor
-          // that has a distance assigned
-          mask(i, j) = current_label + 1;
-          continue_loop = 1;
-        }
+  // Update the distance at (i, j) using its neighbors. Returns 1 if the distance changed.
+  auto update = [&mask](int i, int j) {
+    // skip points outside the domain and at the front
+    if (mask(i, j) < 2.0) {
+      return 0;
+    }
+
+    double d = mask(i, j);
+    // negative values (outside the domain) are never smaller than d - 1 >= 1
+    const double neighbors[] = {mask(i + 1, j), mask(i - 1, j), mask(i, j + 1), mask(i, j - 1)};
+    for (auto n : neighbors) {
+      if (n >= 1.0 and n + 1.0 < d) {
+        d = n + 1.0;
       }
-    } // loop over grid points
+    }
+
+    if (d < mask(i, j)) {
+      mask(i, j) = d;
+      return 1;
+    }
+    return 0;
+  };
+
+  int changed = 1;
+  while (changed != 0) {
+    profiling.begin("ocean.pico.distance_pass");
+
+    changed = 0;
+
+    for (int j = ys; j < ys + ym; ++j) {
+      for (int i = xs; i < xs + xm; ++i) {
+        changed |= update(i, j);
+      }
+    }
+
+    for (int j = ys; j < ys + ym; ++j) {
+      for (int i = xs + xm - 1; i >= xs; --i) {
+        changed |= update(i, j);
+      }
+    }
+
+    for (int j = ys + ym - 1; j >= ys; --j) {
+      for (int i = xs; i < xs + xm; ++i) {
+        changed |= update(i, j);
+      }
+    }
+
+    for (int j = ys + ym - 1; j >= ys; --j) {
+      for (int i = xs + xm - 1; i >= xs; --i) {
+        changed |= update(i, j);
+      }
+    }
 
-    current_label++;
     mask.update_ghosts();
 
-    continue_loop = GlobalMax(grid->com, continue_loop);
+    changed = GlobalMax(grid->com, changed);
+
+    profiling.end("ocean.pico.distance_pass");
   }
+
+  // cells not connected to the front
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (mask(i, j) == unknown) {
+      mask(i, j) = 0.0;
+    }
+  }
+  mask.update_ghosts();
 }
 
 void PicoGeometry::compute_box_mask(const IceModelVec2Int &D_gl, const IceModelVec2Int &D_cf,
@@ -621,8 +715,12 @@ void PicoGeometry::compute_box_mask(const IceModelVec2Int &D_gl, const IceModelV
 
   int n_shelves = shelf_mask.range().max + 1;
 
-  std::vector<double> GL_distance_max(n_shelves, 0.0);
-  std::vector<double> CF_distance_max(n_shelves, 0.0);
+  // maximum distances to the grounding line (first n_shelves elements) and to the
+  // calving front (the rest)
+  std::vector<double> distance_max(2 * n_shelves, 0.0);
+  double
+    *GL_distance_max = &distance_max[0],
+    *CF_distance_max = &distance_max[n_shelves];
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
@@ -645,13 +743,13 @@ void PicoGeometry::compute_box_mask(const IceModelVec2Int &D_gl, const IceModelV
     }
   }
 
-  // compute global maximums
-  for (int k = 0; k < n_shelves; ++k) {
-    GL_distance_max[k] = GlobalMax(m_grid->com, GL_distance_max[k]);
-    CF_distance_max[k] = GlobalMax(m_grid->com, CF_distance_max[k]);
+  // compute global maximums (one reduction for all shelves)
+  {
+    std::vector<double> tmp(distance_max);
+    GlobalMax(m_grid->com, tmp.data(), distance_max.data(), distance_max.size());
   }
 
-  double GL_distance_ref = *std::max_element(GL_distance_max.begin(), GL_distance_max.end());
+  double GL_distance_ref = *std::max_element(GL_distance_max, GL_distance_max + n_shelves);
 
   // compute the number of boxes in each shelf
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -68,6 +68,8 @@ private:
   void label_tmp();
   void relabel_by_size(IceModelVec2Int &mask);
 
+  bool update_cache(const IceModelVec2S &input, IceModelVec2Int &cache, bool &valid);
+
   // storage for outputs
   IceModelVec2Int m_continental_shelf;
   IceModelVec2Int m_boxes;
@@ -82,7 +84,14 @@ private:
 
   // temporary storage
   IceModelVec2Int m_tmp;
-  petsc::Vec::Ptr m_tmp_p0;
+  IceModelVec2V m_label_work;
+
+  // copies of inputs used during the last update (used to skip re-computation when
+  // inputs did not change)
+  IceModelVec2Int m_cell_type;
+  IceModelVec2Int m_bed_above_threshold;
+  bool m_cell_type_is_valid;
+  bool m_bed_above_threshold_is_valid;
 };
 
 } // end of namespace ocean
@@ -0,0 +1,87 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include <algorithm>            // std::min
+
+#include "SparseField.hh"
+#include "pism/geometry/Geometry.hh"
+
+namespace pism {
+namespace ocean {
+
+OceanCells::OceanCells() {
+  // empty
+}
+
+void OceanCells::update(const Geometry &geometry, bool use_grounded_cell_fraction) {
+  const IceModelVec2CellType &cell_type = geometry.cell_type;
+  const IceModelVec2S &grounded_fraction = geometry.cell_grounded_fraction;
+
+  IceGrid::ConstPtr grid = cell_type.grid();
+
+  m_i.clear();
+  m_j.clear();
+
+  IceModelVec::AccessList list{&cell_type};
+  if (use_grounded_cell_fraction) {
+    list.add(grounded_fraction);
+  }
+
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (cell_type.ocean(i, j) or
+        (use_grounded_cell_fraction and grounded_fraction(i, j) < 1.0)) {
+      m_i.push_back(i);
+      m_j.push_back(j);
+    }
+  }
+}
+
+SparseField::SparseField(const OceanCells &cells, IceModelVec2S::Ptr storage,
+                         double fill_value)
+  : m_cells(cells), m_fill_value(fill_value), m_dense(storage), m_stale(true) {
+  // empty
+}
+
+std::vector<double>& SparseField::values() {
+  m_values.resize(m_cells.size());
+  m_stale = true;
+  return m_values;
+}
+
+const IceModelVec2S& SparseField::dense() const {
+  if (m_stale) {
+    IceModelVec2S &result = *m_dense;
+
+    result.set(m_fill_value);
+
+    IceModelVec::AccessList list{&result};
+
+    const unsigned int N = std::min((size_t)m_cells.size(), m_values.size());
+    for (unsigned int k = 0; k < N; ++k) {
+      result(m_cells.i(k), m_cells.j(k)) = m_values[k];
+    }
+
+    m_stale = false;
+  }
+  return *m_dense;
+}
+
+} // end of namespace ocean
+} // end of namespace pism
@@ -0,0 +1,88 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef PISM_OCEAN_SPARSEFIELD_H
+#define PISM_OCEAN_SPARSEFIELD_H
+
+#include <vector>
+
+#include "pism/util/iceModelVec.hh"
+
+namespace pism {
+
+class Geometry;
+
+namespace ocean {
+
+/*!
+ * List of grid points (owned by the current process) where outputs of an ocean model are
+ * used: cells that are not grounded (floating ice or ice-free ocean) and, if the basal
+ * melt rate is interpolated using the grounded cell fraction, partially-floating cells.
+ *
+ * See IceModel::combine_basal_melt_rate() and the Dirichlet basal boundary condition for
+ * floating ice in the energy models.
+ */
+class OceanCells {
+public:
+  OceanCells();
+
+  void update(const Geometry &geometry, bool use_grounded_cell_fraction);
+
+  unsigned int size() const {
+    return m_i.size();
+  }
+
+  int i(unsigned int k) const {
+    return m_i[k];
+  }
+
+  int j(unsigned int k) const {
+    return m_j[k];
+  }
+private:
+  std::vector<int> m_i, m_j;
+};
+
+/*!
+ * Compressed storage for an ocean model output: values at grid points listed in an
+ * OceanCells instance. The dense view (an IceModelVec2S set to `fill_value` elsewhere)
+ * is materialized on demand.
+ */
+class SparseField {
+public:
+  SparseField(const OceanCells &cells, IceModelVec2S::Ptr storage, double fill_value);
+
+  //! Values corresponding to points in `cells`. Invalidates the dense view.
+  std::vector<double>& values();
+
+  const IceModelVec2S& dense() const;
+private:
+  const OceanCells &m_cells;
+
+  std::vector<double> m_values;
+
+  double m_fill_value;
+
+  mutable IceModelVec2S::Ptr m_dense;
+  mutable bool m_stale;
+};
+
+} // end of namespace ocean
+} // end of namespace pism
+
+#endif /* PISM_OCEAN_SPARSEFIELD_H */
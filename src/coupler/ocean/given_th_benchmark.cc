@@ -0,0 +1,129 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Compares the speed of GivenTH::pointwise_update_n() to the calls of\n"
+  "GivenTH::pointwise_update() at each point.\n\n";
+
+#include <cmath>
+#include <vector>
+#include <random>
+#include <algorithm>            // std::max, std::min
+
+#include "pism/coupler/ocean/GivenTH.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+
+static double max_difference(const std::vector<double> &a,
+                             const std::vector<double> &b) {
+  double result = 0.0;
+  for (unsigned int k = 0; k < a.size(); ++k) {
+    result = std::max(result, std::fabs(a[k] - b[k]));
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  using namespace pism;
+  using ocean::GivenTH;
+
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "given_th_benchmark");
+    Logger::ConstPtr log = ctx->log();
+
+    const int
+      N          = options::Integer("-N", "number of floating cells", 1000000),
+      repeat     = options::Integer("-repeat", "number of repetitions", 10),
+      block_size = 64;          // see GivenTH::update_impl()
+
+    GivenTH::Constants c(*ctx->config());
+
+    // A distribution resembling Antarctic ice shelves: mostly thin shelves in contact
+    // with cold shelf water and some thick ice near grounding lines, plus 20% of cells
+    // in contact with warm Circumpolar Deep Water (as in the Amundsen Sea). Includes
+    // cells with freeze-on.
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<double> H(N), theta(N), S(N);
+    for (int k = 0; k < N; ++k) {
+      const double s = uniform(generator);
+      H[k] = 50.0 + 1950.0 * s * s;
+
+      if (uniform(generator) < 0.2) {
+        theta[k] = 0.0 + 1.5 * uniform(generator);    // CDW
+        S[k]     = 34.6 + 0.2 * uniform(generator);
+      } else {
+        theta[k] = -2.2 + 1.2 * uniform(generator);   // shelf water
+        S[k]     = 34.2 + 0.6 * uniform(generator);
+      }
+    }
+
+    std::vector<double>
+      T_scalar(N), melt_scalar(N),
+      T_batch(N), melt_batch(N);
+
+    log->message(1, "%d cells, %d repetitions\n\n", N, repeat);
+
+    double t0 = get_time();
+    for (int r = 0; r < repeat; ++r) {
+      for (int k = 0; k < N; ++k) {
+        GivenTH::pointwise_update(c, S[k], theta[k], H[k], &T_scalar[k], &melt_scalar[k]);
+      }
+    }
+    double t1 = get_time();
+    for (int r = 0; r < repeat; ++r) {
+      for (int k = 0; k < N; k += block_size) {
+        const int n = std::min(block_size, N - k);
+        GivenTH::pointwise_update_n(c, n, &S[k], &theta[k], &H[k],
+                                    &T_batch[k], &melt_batch[k]);
+      }
+    }
+    double t2 = get_time();
+
+    int n_freeze_on = 0;
+    for (int k = 0; k < N; ++k) {
+      n_freeze_on += melt_scalar[k] < 0.0 ? 1 : 0;
+    }
+
+    log->message(1,
+                 "pointwise_update():   %f s\n"
+                 "pointwise_update_n(): %f s (speedup: %.2f)\n"
+                 "max. difference: %e Celsius (temperature), %e m/s (melt rate)\n"
+                 "freeze-on in %d cells\n",
+                 t1 - t0, t2 - t1, (t1 - t0) / (t2 - t1),
+                 max_difference(T_scalar, T_batch),
+                 max_difference(melt_scalar, melt_batch),
+                 n_freeze_on);
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -18,7 +18,7 @@
  */
 
 #include <cassert>
-#include <algorithm>            // for std::min
+#include <algorithm>            // for std::min, std::max, std::swap
 
 #include "Cache.hh"
 #include "pism/util/Time.hh"
@@ -52,6 +52,15 @@ Cache::Cache(IceGrid::ConstPtr grid, std::shared_ptr<SurfaceModel> in)
     m_melt                  = allocate_melt(grid);
     m_runoff                = allocate_runoff(grid);
   }
+
+  m_interpolate    = m_config->get_flag("surface.cache.interpolate");
+  m_interval_start = m_next_update_time;
+  m_first_update   = true;
+
+  if (m_interpolate) {
+    m_start = allocate_outputs();
+    m_end   = allocate_outputs();
+  }
 }
 
 Cache::~Cache() {
@@ -63,36 +72,102 @@ void Cache::init_impl(const Geometry &geometry) {
 
   m_log->message(2, "* Initializing the 'caching' surface model modifier...\n");
 
+  if (m_interpolate) {
+    m_log->message(2, "  Interpolating outputs of the input model in time between updates.\n");
+  }
+
   m_next_update_time = m_grid->ctx()->time()->current();
+  m_interval_start   = m_next_update_time;
+  m_first_update     = true;
 }
 
-void Cache::update_impl(const Geometry &geometry, double t, double dt) {
-  // ignore dt and always use 1 year long time-steps when updating
-  // the input model
-  (void) dt;
+//! Update the input model at time `t`, using a 1 year long time-step.
+void Cache::update_input(const Geometry &geometry, double t) {
+  double
+    one_year_from_now = m_grid->ctx()->time()->increment_date(t, 1.0),
+    update_dt         = one_year_from_now - t;
 
-  if (t >= m_next_update_time or fabs(t - m_next_update_time) < 1.0) {
+  assert(update_dt > 0.0);
 
-    double
-      one_year_from_now = m_grid->ctx()->time()->increment_date(t, 1.0),
-      update_dt         = one_year_from_now - t;
+  m_input_model->update(geometry, t, update_dt);
+}
 
-    assert(update_dt > 0.0);
+//! Outputs of this model (in the order used by copy_outputs()).
+std::vector<IceModelVec2S::Ptr> Cache::outputs() const {
+  return {m_mass_flux, m_temperature, m_liquid_water_fraction, m_layer_mass,
+      m_layer_thickness, m_accumulation, m_melt, m_runoff};
+}
 
-    m_input_model->update(geometry, t, update_dt);
+//! Allocate storage for a copy of outputs (see outputs()).
+std::vector<IceModelVec2S::Ptr> Cache::allocate_outputs() const {
+  return {allocate_mass_flux(m_grid), allocate_temperature(m_grid),
+      allocate_liquid_water_fraction(m_grid), allocate_layer_mass(m_grid),
+      allocate_layer_thickness(m_grid), allocate_accumulation(m_grid),
+      allocate_melt(m_grid), allocate_runoff(m_grid)};
+}
 
-    m_next_update_time = m_grid->ctx()->time()->increment_date(m_next_update_time,
-                                                               m_update_interval_years);
+//! Copy outputs of the input model to `result`.
+void Cache::copy_outputs(const std::vector<IceModelVec2S::Ptr> &result) const {
+  result[0]->copy_from(m_input_model->mass_flux());
+  result[1]->copy_from(m_input_model->temperature());
+  result[2]->copy_from(m_input_model->liquid_water_fraction());
+  result[3]->copy_from(m_input_model->layer_mass());
+  result[4]->copy_from(m_input_model->layer_thickness());
+  result[5]->copy_from(m_input_model->accumulation());
+  result[6]->copy_from(m_input_model->melt());
+  result[7]->copy_from(m_input_model->runoff());
+}
+
+/*!
+ * Update the input model at most every `surface.cache.update_interval` years.
+ *
+ * If `surface.cache.interpolate` is set, the input model is evaluated at the start and
+ * the end of each update interval (using the ice geometry at its start) and outputs are
+ * interpolated linearly in between (see ocean::Cache::update_impl()).
+ */
+void Cache::update_impl(const Geometry &geometry, double t, double dt) {
+  // always use 1 year long time-steps when updating the input model (see update_input())
+
+  if (t >= m_next_update_time or fabs(t - m_next_update_time) < 1.0) {
+
+    if (m_interpolate) {
+      if (m_first_update) {
+        // outputs at the start of the first interval
+        update_input(geometry, t);
+        copy_outputs(m_end);
+        m_first_update = false;
+      }
+      // the end of the previous interval is the start of the current one
+      std::swap(m_start, m_end);
+      m_interval_start = t;
+
+      m_next_update_time = m_grid->ctx()->time()->increment_date(m_next_update_time,
+                                                                 m_update_interval_years);
+      update_input(geometry, m_next_update_time);
+      copy_outputs(m_end);
+    } else {
+      update_input(geometry, t);
+
+      m_next_update_time = m_grid->ctx()->time()->increment_date(m_next_update_time,
+                                                                 m_update_interval_years);
+
+      // store outputs of the input model
+      copy_outputs(outputs());
+    }
+  }
 
-    // store outputs of the input model
-    m_mass_flux->copy_from(m_input_model->mass_flux());
-    m_temperature->copy_from(m_input_model->temperature());
-    m_liquid_water_fraction->copy_from(m_input_model->liquid_water_fraction());
-    m_layer_mass->copy_from(m_input_model->layer_mass());
-    m_layer_thickness->copy_from(m_input_model->layer_thickness());
-    m_accumulation->copy_from(m_input_model->accumulation());
-    m_melt->copy_from(m_input_model->melt());
-    m_runoff->copy_from(m_input_model->runoff());
+  if (m_interpolate) {
+    // linear interpolation evaluated at the middle of the time step (i.e. the average
+    // over the time step)
+    double lambda = (t + 0.5 * dt - m_interval_start) / (m_next_update_time - m_interval_start);
+    lambda = std::max(0.0, std::min(lambda, 1.0));
+
+    auto result = outputs();
+    for (unsigned int k = 0; k < result.size(); ++k) {
+      result[k]->copy_from(*m_start[k]);
+      result[k]->scale(1.0 - lambda);
+      result[k]->add(lambda, *m_end[k]);
+    }
   }
 }
 
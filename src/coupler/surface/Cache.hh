@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -45,12 +45,26 @@ protected:
 
   MaxTimestep max_timestep_impl(double t) const;
 protected:
+  void update_input(const Geometry &geometry, double t);
+  void copy_outputs(const std::vector<IceModelVec2S::Ptr> &result) const;
+  std::vector<IceModelVec2S::Ptr> outputs() const;
+  std::vector<IceModelVec2S::Ptr> allocate_outputs() const;
+
   // storage for the rest of the fields is inherited from SurfaceModel
   IceModelVec2S::Ptr m_mass_flux;
   IceModelVec2S::Ptr m_temperature;
 
   double m_next_update_time;
   unsigned int m_update_interval_years;
+
+  //! true if outputs are interpolated in time between updates
+  bool m_interpolate;
+  //! time of the last update (the start of the current update interval)
+  double m_interval_start;
+  bool m_first_update;
+  //! outputs of the input model at the start and the end of the current update interval
+  //! (used if m_interpolate is set)
+  std::vector<IceModelVec2S::Ptr> m_start, m_end;
 };
 
 } // end of namespace surface
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,7 @@
 
 #include "Delta_T.hh"
 #include "pism/coupler/util/ScalarForcing.hh"
+#include "pism/coupler/util/FusedField.hh"
 
 namespace pism {
 namespace surface {
@@ -34,7 +35,10 @@ Delta_T::Delta_T(IceGrid::ConstPtr g, std::shared_ptr<SurfaceModel> in)
                                     "Kelvin",
                                     "ice-surface temperature offsets"));
 
-  m_temperature = allocate_temperature(g);
+  m_temperature.reset(new FusedField([g]() { return allocate_temperature(g); },
+                                     [this]() -> const IceModelVec2S& {
+                                       return m_input_model->temperature();
+                                     }));
 }
 
 Delta_T::~Delta_T() {
@@ -54,12 +58,15 @@ void Delta_T::update_impl(const Geometry &geometry, double t, double dt) {
   m_input_model->update(geometry, t, dt);
   m_forcing->update(t, dt);
 
-  m_temperature->copy_from(m_input_model->temperature());
-  m_temperature->shift(m_forcing->value());
+  m_temperature->update(1.0, m_forcing->value(), input_fused_field("ice_surface_temp"));
 }
 
 const IceModelVec2S &Delta_T::temperature_impl() const {
-  return *m_temperature;
+  return m_temperature->value();
+}
+
+const FusedField* Delta_T::fused_field_impl(const std::string &name) const {
+  return name == "ice_surface_temp" ? m_temperature.get() : nullptr;
 }
 
 } // end of namespace surface
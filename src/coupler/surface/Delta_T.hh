@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -26,6 +26,7 @@
 namespace pism {
 
 class ScalarForcing;
+class FusedField;
 
 namespace surface {
 
@@ -44,10 +45,11 @@ protected:
   void update_impl(const Geometry &geometry, double t, double dt);
 
   virtual const IceModelVec2S& temperature_impl() const;
+  const FusedField* fused_field_impl(const std::string &name) const;
 
   std::unique_ptr<ScalarForcing> m_forcing;
 
-  IceModelVec2S::Ptr m_temperature;
+  std::unique_ptr<FusedField> m_temperature;
 };
 
 } // end of namespace surface
@@ -18,7 +18,6 @@
 
 #include "ElevationChange.hh"
 #include "pism/coupler/util/options.hh"
-#include "pism/coupler/util/lapse_rates.hh"
 #include "pism/util/io/io_helpers.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/pism_options.hh"
@@ -28,7 +27,8 @@ namespace pism {
 namespace surface {
 
 ElevationChange::ElevationChange(IceGrid::ConstPtr g, std::shared_ptr<SurfaceModel> in)
-  : SurfaceModel(g, in) {
+  : SurfaceModel(g, in),
+    m_elevation_difference(g) {
 
   {
     m_smb_lapse_rate = m_config->get_number("surface.elevation_change.smb.lapse_rate",
@@ -113,35 +113,36 @@ void ElevationChange::update_impl(const Geometry &geometry, double t, double dt)
   m_reference_surface->update(t, dt);
   m_reference_surface->interp(t + 0.5*dt);
 
-  const IceModelVec2S &surface = geometry.ice_surface_elevation;
+  const IceModelVec2S &dz = m_elevation_difference.update(geometry.ice_surface_elevation,
+                                                          *m_reference_surface);
 
-  m_temperature->copy_from(m_input_model->temperature());
-  lapse_rate_correction(surface, *m_reference_surface,
-                        m_temp_lapse_rate, *m_temperature);
+  // apply temperature and SMB corrections in one pass
+  {
+    const IceModelVec2S
+      &temperature = m_input_model->temperature(),
+      &mass_flux   = m_input_model->mass_flux();
+
+    IceModelVec::AccessList list{&dz, &temperature, &mass_flux,
+                                 m_temperature.get(), m_mass_flux.get()};
 
-  m_mass_flux->copy_from(m_input_model->mass_flux());
+    const bool scale = m_smb_method == SCALE;
 
-  switch (m_smb_method) {
-  case SCALE:
-    {
-      IceModelVec::AccessList list{&surface, m_reference_surface.get(), m_mass_flux.get()};
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
 
-      for (Points p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
+      double dT = -m_temp_lapse_rate * dz(i, j);
 
-        double dT = -m_temp_lapse_rate * (surface(i, j) - (*m_reference_surface)(i, j));
+      (*m_temperature)(i, j) = temperature(i, j) + dT;
 
-        (*m_mass_flux)(i, j) *= exp(m_smb_exp_factor * dT);
+      if (scale) {
+        (*m_mass_flux)(i, j) = mass_flux(i, j) * exp(m_smb_exp_factor * dT);
+      } else {
+        (*m_mass_flux)(i, j) = mass_flux(i, j) - m_smb_lapse_rate * dz(i, j);
       }
     }
-    break;
-  default:
-  case SHIFT:
-    {
-      lapse_rate_correction(surface, *m_reference_surface,
-                            m_smb_lapse_rate, *m_mass_flux);
-    }
-    break;
+
+    m_temperature->inc_state_counter();
+    m_mass_flux->inc_state_counter();
   }
 
   // This modifier changes m_mass_flux, so we need to compute accumulation, melt, and
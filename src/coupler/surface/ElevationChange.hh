@@ -22,6 +22,7 @@
 #include "pism/coupler/SurfaceModel.hh"
 
 #include "pism/util/iceModelVec2T.hh"
+#include "pism/coupler/util/lapse_rates.hh"
 
 namespace pism {
 namespace surface {
@@ -50,6 +51,7 @@ protected:
   double m_temp_lapse_rate;
 
   IceModelVec2T::Ptr m_reference_surface;
+  ElevationDifference m_elevation_difference;
 
   IceModelVec2S::Ptr m_mass_flux;
   IceModelVec2S::Ptr m_temperature;
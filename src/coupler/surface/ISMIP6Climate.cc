@@ -1,4 +1,4 @@
-// Copyright (C) 2019 PISM Authors
+// Copyright (C) 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -16,6 +16,8 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>            // std::max
+
 #include "ISMIP6Climate.hh"
 
 #include "pism/util/IceGrid.hh"
@@ -30,7 +32,8 @@ ISMIP6::ISMIP6(IceGrid::ConstPtr grid, std::shared_ptr<atmosphere::AtmosphereMod
   : SurfaceModel(grid),
     m_mass_flux_reference(m_grid, "climatic_mass_balance", WITHOUT_GHOSTS),
     m_temperature_reference(m_grid, "ice_surface_temp", WITHOUT_GHOSTS),
-    m_surface_reference(m_grid, "usurf", WITHOUT_GHOSTS)
+    m_surface_reference(m_grid, "usurf", WITHOUT_GHOSTS),
+    m_memo(m_grid->ctx()->memo(), "surface.ismip6")
 {
   (void) input;
 
@@ -68,7 +71,13 @@ ISMIP6::ISMIP6(IceGrid::ConstPtr grid, std::shared_ptr<atmosphere::AtmosphereMod
   ForcingOptions opt(*m_grid->ctx(), "surface.ismip6");
 
   {
-    unsigned int buffer_size = m_config->get_number("input.forcing.buffer_size");
+    // These fields are used to compute averages over [t, t + dt] and max_timestep_impl()
+    // limits time steps to one record interval, so a short buffer combined with
+    // prefetching (input.forcing.prefetch) is enough to stream records from the file.
+    unsigned int buffer_size = m_config->get_number("surface.ismip6.buffer_size");
+    if (buffer_size == 0) {
+      buffer_size = m_config->get_number("input.forcing.buffer_size");
+    }
     unsigned int evaluations_per_year = m_config->get_number("input.forcing.evaluations_per_year");
     bool periodic = opt.period > 0;
 
@@ -164,6 +173,8 @@ void ISMIP6::init_impl(const Geometry &geometry) {
     m_temperature_anomaly->init(opt.filename, opt.period, opt.reference_time);
     m_temperature_gradient->init(opt.filename, opt.period, opt.reference_time);
   }
+
+  m_memo.reset();
 }
 
 void ISMIP6::update_impl(const Geometry &geometry, double t, double dt) {
@@ -196,23 +207,42 @@ void ISMIP6::update_impl(const Geometry &geometry, double t, double dt) {
     dSMBdz.average(t, dt);
   }
 
+  // Reference fields do not change after init(), so outputs have to be re-computed only if
+  // the surface elevation or one of the time-dependent inputs changed. (average() does not
+  // modify fields if the weights of records are the same as in the previous call.)
+  std::vector<int> key{h.state_counter(),
+                       aT.state_counter(), aSMB.state_counter(),
+                       dTdz.state_counter(), dSMBdz.state_counter()};
+  if (m_memo.up_to_date(key)) {
+    return;
+  }
+
   // From http://www.climate-cryosphere.org/wiki/index.php?title=ISMIP6-Projections-Greenland:
   // SMB(x,y,t) = SMB_ref(x,y) + aSMB(x,y,t) + dSMBdz(x,y,t) * [h(x,y,t) - h_ref(x,y)]
 
   IceModelVec::AccessList list{&h, &h_ref,
                                &SMB, &SMB_ref, &aSMB, &dSMBdz,
-                               &T, &T_ref, &aT, &dTdz};
+                               &T, &T_ref, &aT, &dTdz,
+                               m_accumulation.get(), m_melt.get(), m_runoff.get()};
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    SMB(i, j) = SMB_ref(i, j) + aSMB(i, j) + dSMBdz(i, j) * (h(i, j) - h_ref(i, j));
-    T(i, j)   = T_ref(i, j) + aT(i, j) + dTdz(i, j) * (h(i, j) - h_ref(i, j));
+    const double dh = h(i, j) - h_ref(i, j);
+
+    SMB(i, j) = SMB_ref(i, j) + aSMB(i, j) + dSMBdz(i, j) * dh;
+    T(i, j)   = T_ref(i, j) + aT(i, j) + dTdz(i, j) * dh;
+
+    // same as dummy_accumulation(), dummy_melt(), and dummy_runoff(), but in the same pass
+    (*m_accumulation)(i, j) = std::max(SMB(i, j), 0.0);
+    (*m_melt)(i, j)         = std::max(-SMB(i, j), 0.0);
+    (*m_runoff)(i, j)       = (*m_melt)(i, j);
   }
 
-  dummy_accumulation(SMB, *m_accumulation);
-  dummy_melt(SMB, *m_melt);
-  dummy_runoff(SMB, *m_runoff);
+  SMB.inc_state_counter();
+  T.inc_state_counter();
+
+  m_memo.set(key);
 }
 
 MaxTimestep ISMIP6::max_timestep_impl(double t) const {
@@ -1,4 +1,4 @@
-// Copyright (C) 2019 PISM Authors
+// Copyright (C) 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -19,8 +19,11 @@
 #ifndef _PSISMIP6_H_
 #define _PSISMIP6_H_
 
+#include <vector>
+
 #include "pism/coupler/SurfaceModel.hh"
 #include "pism/util/iceModelVec2T.hh"
+#include "pism/util/Memo.hh"
 
 namespace pism {
 namespace surface {
@@ -56,6 +59,9 @@ protected:
   IceModelVec2S::Ptr m_mass_flux;
   IceModelVec2S::Ptr m_temperature;
 
+  // state counters of inputs used to compute outputs
+  Memo m_memo;
+
 };
 
 } // end of namespace surface
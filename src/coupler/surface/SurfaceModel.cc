@@ -1,4 +1,4 @@
-// Copyright (C) 2008-2019 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
+// Copyright (C) 2008-2020 Ed Bueler, Constantine Khroulev, Ricarda Winkelmann,
 // Gudfinna Adalgeirsdottir and Andy Aschwanden
 //
 // This file is part of PISM.
@@ -603,6 +603,21 @@ DiagnosticList SurfaceModel::diagnostics_impl() const {
   return result;
 }
 
+/*!
+ * Default implementation: this model is not a scalar modifier (see FusedField).
+ */
+const FusedField* SurfaceModel::fused_field_impl(const std::string &name) const {
+  (void) name;
+  return nullptr;
+}
+
+const FusedField* SurfaceModel::input_fused_field(const std::string &name) const {
+  if (m_input_model) {
+    return m_input_model->fused_field_impl(name);
+  }
+  return nullptr;
+}
+
 } // end of namespace surface
 } // end of namespace pism
 
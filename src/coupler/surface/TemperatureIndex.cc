@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -16,7 +16,8 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
-#include <algorithm>            // std::min
+#include <algorithm>            // std::min, std::copy
+#include <ctime>                // time()
 
 #include "TemperatureIndex.hh"
 #include "localMassBalance.hh"
@@ -62,7 +63,12 @@ TemperatureIndex::TemperatureIndex(IceGrid::ConstPtr g,
   if (method == "repeatable_random_process") {
     m_mbscheme.reset(new PDDrandMassBalance(m_config, m_sys, PDDrandMassBalance::REPEATABLE));
   } else if (method == "random_process") {
-    m_mbscheme.reset(new PDDrandMassBalance(m_config, m_sys, PDDrandMassBalance::NOT_REPEATABLE));
+    // use the same seed on all processes
+    unsigned int seed = time(0);
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, m_grid->com);
+
+    m_mbscheme.reset(new PDDrandMassBalance(m_config, m_sys, PDDrandMassBalance::NOT_REPEATABLE,
+                                            seed));
   } else {
     m_mbscheme.reset(new PDDMassBalance(m_config, m_sys));
   }
@@ -250,7 +256,7 @@ void TemperatureIndex::update_impl(const Geometry &geometry, double t, double dt
   int N = m_mbscheme->get_timeseries_length(dt);
 
   const double dtseries = dt / N;
-  std::vector<double> ts(N), T(N), S(N), P(N), PDDs(N);
+  std::vector<double> ts(N), S(N);
   for (int k = 0; k < N; ++k) {
     ts[k] = t + k * dtseries;
   }
@@ -293,165 +299,233 @@ void TemperatureIndex::update_impl(const Geometry &geometry, double t, double dt
 
   m_atmosphere->begin_pointwise_access();
 
-  const double ice_density = m_config->get_number("constants.ice.density");
+  // If time series are the same in all columns, get them once and copy them into each
+  // block instead of asking the atmosphere model (and all its modifiers) for every column.
+  const bool spatially_uniform = m_atmosphere->spatially_uniform();
+  std::vector<double> T_uniform, P_uniform;
+  if (spatially_uniform) {
+    m_atmosphere->temp_time_series(m_grid->xs(), m_grid->ys(), T_uniform);
+    m_atmosphere->precip_time_series(m_grid->xs(), m_grid->ys(), P_uniform);
+  }
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  const double ice_density = m_config->get_number("constants.ice.density");
 
-      // the temperature time series from the AtmosphereModel and its modifiers
-      m_atmosphere->temp_time_series(i, j, T);
+  // Columns are processed in blocks: time series for all the columns in a block are
+  // stored one after another, so that the atmosphere model, the PDD computation, and the
+  // partitioning of precipitation use one call (and one tight loop) per block instead of
+  // one per column.
+  const int block_size = 64;
+
+  std::vector<std::pair<int, int> > block;
+  block.reserve(block_size);
+
+  std::vector<LocalMassBalance::DegreeDayFactors> block_ddf(block_size, ddf);
+
+  std::vector<double> T_block, S_block, P_block, PDD_block;
+  T_block.reserve(block_size * N);
+  S_block.reserve(block_size * N);
+  P_block.reserve(block_size * N);
+  PDD_block.reserve(block_size * N);
+
+  // Use degree-day factors, the number of PDDs, and the snow precipitation to get surface
+  // mass balance (and diagnostics: accumulation, melt, runoff) in all columns of the
+  // current block
+  auto process_block = [&]() {
+    if (block.empty()) {
+      return;
+    }
 
-      if (mask.ice_free_ocean(i, j)) {
-        // ignore precipitation over ice-free ocean
-        for (int k = 0; k < N; ++k) {
-          P[k] = 0.0;
-        }
-      } else {
-        // elsewhere, get precipitation from the atmosphere model
-        m_atmosphere->precip_time_series(i, j, P);
+    // temperature and precipitation time series from the AtmosphereModel and its modifiers
+    if (spatially_uniform) {
+      T_block.resize(block.size() * N);
+      P_block.resize(block.size() * N);
+      for (unsigned int c = 0; c < block.size(); ++c) {
+        std::copy(T_uniform.begin(), T_uniform.end(), T_block.begin() + c * N);
+        std::copy(P_uniform.begin(), P_uniform.end(), P_block.begin() + c * N);
       }
+    } else {
+      m_atmosphere->temp_time_series(block, T_block);
+      m_atmosphere->precip_time_series(block, P_block);
+    }
+
+    S_block.resize(T_block.size());
+    PDD_block.resize(T_block.size());
+
+    for (unsigned int c = 0; c < block.size(); ++c) {
+      const int i = block[c].first, j = block[c].second;
 
-      // convert precipitation from "kg m-2 second-1" to "m second-1" (PDDMassBalance expects
-      // accumulation in m/second ice equivalent)
+      double
+        *T_c = &T_block[c * N],
+        *P_c = &P_block[c * N],
+        *S_c = &S_block[c * N];
+
+      // ignore precipitation over ice-free ocean; elsewhere convert precipitation from
+      // "kg m-2 second-1" to "m second-1" (PDDMassBalance expects accumulation in m/second
+      // ice equivalent)
+      const bool ocean = mask.ice_free_ocean(i, j);
       for (int k = 0; k < N; ++k) {
-        P[k] = P[k] / ice_density;
+        P_c[k] = ocean ? 0.0 : P_c[k] / ice_density;
         // kg / (m^2 * second) / (kg / m^3) = m / second
       }
 
       // interpolate temperature standard deviation time series
       if (m_sd_file_set) {
         m_air_temp_sd->interp(i, j, S);
+        for (int k = 0; k < N; ++k) {
+          S_c[k] = S[k];
+        }
       } else {
         double tmp = (*m_air_temp_sd)(i, j);
         for (int k = 0; k < N; ++k) {
-          S[k] = tmp;
+          S_c[k] = tmp;
         }
       }
 
       if (fausto_greve) {
         // we have been asked to set mass balance parameters according to
         //   formula (6) in [\ref Faustoetal2009]; they overwrite ddf set above
-        ddf = fausto_greve->degree_day_factors(i, j, (*latitude)(i, j));
+        block_ddf[c] = fausto_greve->degree_day_factors(i, j, (*latitude)(i, j));
       }
 
       // apply standard deviation lapse rate on top of prescribed values
       if (sigmalapserate != 0.0) {
         double lat = (*latitude)(i, j);
         for (int k = 0; k < N; ++k) {
-          S[k] += sigmalapserate * (lat - sigmabaselat);
+          S_c[k] += sigmalapserate * (lat - sigmabaselat);
         }
-        (*m_air_temp_sd)(i, j) = S[0]; // ensure correct SD reporting
+        (*m_air_temp_sd)(i, j) = S_c[0]; // ensure correct SD reporting
       }
 
       // apply standard deviation param over ice if in use
       if (m_sd_use_param and mask.icy(i, j)) {
         for (int k = 0; k < N; ++k) {
-          S[k] = m_sd_param_a * (T[k] - 273.15) + m_sd_param_b;
-          if (S[k] < 0.0) {
-            S[k] = 0.0 ;
+          S_c[k] = m_sd_param_a * (T_c[k] - 273.15) + m_sd_param_b;
+          if (S_c[k] < 0.0) {
+            S_c[k] = 0.0 ;
           }
         }
-        (*m_air_temp_sd)(i, j) = S[0]; // ensure correct SD reporting
-      }
-
-      // Use temperature time series, the "positive" threshhold, and
-      // the standard deviation of the daily variability to get the
-      // number of positive degree days (PDDs)
-      if (mask.ice_free_ocean(i, j)) {
-        for (int k = 0; k < N; ++k) {
-          PDDs[k] = 0.0;
-        }
-      } else {
-        m_mbscheme->get_PDDs(dtseries, S, T, // inputs
-                             PDDs);          // output
+        (*m_air_temp_sd)(i, j) = S_c[0]; // ensure correct SD reporting
       }
+    }
 
-      // Use temperature time series to remove rainfall from precipitation
-      m_mbscheme->get_snow_accumulation(T,  // air temperature (input)
-                                        P); // precipitation rate (input-output)
+    // Use temperature time series, the "positive" threshhold, and
+    // the standard deviation of the daily variability to get the
+    // number of positive degree days (PDDs)
+    m_mbscheme->set_block(block, ts);
+    m_mbscheme->get_PDDs(dtseries, S_block, T_block, // inputs
+                         PDD_block);                 // output
 
-      // Use degree-day factors, the number of PDDs, and the snow precipitation to get surface mass
-      // balance (and diagnostics: accumulation, melt, runoff)
-      {
-        double next_snow_depth_reset = m_next_balance_year_start;
-
-        // make copies of firn and snow depth values at this point to avoid accessing 2D
-        // fields in the inner loop
-        double
-          ice  = H(i, j),
-          firn = m_firn_depth(i, j),
-          snow = m_snow_depth(i, j);
-
-        // accumulation, melt, runoff over this time-step
-        double
-          A   = 0.0,
-          M   = 0.0,
-          R   = 0.0,
-          SMB = 0.0;
+    // Use temperature time series to remove rainfall from precipitation
+    m_mbscheme->get_snow_accumulation(T_block,  // air temperature (input)
+                                      P_block); // precipitation rate (input-output)
 
-        for (int k = 0; k < N; ++k) {
-          if (ts[k] >= next_snow_depth_reset) {
-            snow = 0.0;
-            while (next_snow_depth_reset <= ts[k]) {
-              next_snow_depth_reset = m_grid->ctx()->time()->increment_date(next_snow_depth_reset, 1);
-            }
-          }
+    for (unsigned int c = 0; c < block.size(); ++c) {
+      const int i = block[c].first, j = block[c].second;
 
-          const double accumulation = P[k] * dtseries;
+      const double
+        *PDDs = &PDD_block[c * N],
+        *P    = &P_block[c * N];
 
-          LocalMassBalance::Changes changes;
-          changes = m_mbscheme->step(ddf, PDDs[k],
-                                     ice, firn, snow, accumulation);
+      const bool ocean = mask.ice_free_ocean(i, j);
 
-          // update ice thickness
-          ice += changes.smb;
-          assert(ice >= 0);
+      double next_snow_depth_reset = m_next_balance_year_start;
 
-          // update firn depth
-          firn += changes.firn_depth;
-          assert(firn >= 0);
+      // make copies of firn and snow depth values at this point to avoid accessing 2D
+      // fields in the inner loop
+      double
+        ice  = H(i, j),
+        firn = m_firn_depth(i, j),
+        snow = m_snow_depth(i, j);
 
-          // update snow depth
-          snow += changes.snow_depth;
-          assert(snow >= 0);
+      // accumulation, melt, runoff over this time-step
+      double
+        A   = 0.0,
+        M   = 0.0,
+        R   = 0.0,
+        SMB = 0.0;
 
-          // update total accumulation, melt, and runoff
-          {
-            A   += accumulation;
-            M   += changes.melt;
-            R   += changes.runoff;
-            SMB += changes.smb;
+      for (int k = 0; k < N; ++k) {
+        if (ts[k] >= next_snow_depth_reset) {
+          snow = 0.0;
+          while (next_snow_depth_reset <= ts[k]) {
+            next_snow_depth_reset = m_grid->ctx()->time()->increment_date(next_snow_depth_reset, 1);
           }
-        } // end of the time-stepping loop
+        }
+
+        const double accumulation = P[k] * dtseries;
 
-        // set firn and snow depths
-        m_firn_depth(i, j) = firn;
-        m_snow_depth(i, j) = snow;
+        // no melt over ice-free ocean
+        LocalMassBalance::Changes changes;
+        changes = m_mbscheme->step(block_ddf[c], ocean ? 0.0 : PDDs[k],
+                                   ice, firn, snow, accumulation);
 
-        // set total accumulation, melt, and runoff, and SMB at this point, converting
-        // from "meters, ice equivalent" to "kg / m^2"
+        // update ice thickness
+        ice += changes.smb;
+        assert(ice >= 0);
+
+        // update firn depth
+        firn += changes.firn_depth;
+        assert(firn >= 0);
+
+        // update snow depth
+        snow += changes.snow_depth;
+        assert(snow >= 0);
+
+        // update total accumulation, melt, and runoff
         {
-          (*m_accumulation)(i, j)          = A * ice_density;
-          (*m_melt)(i, j)                  = M * ice_density;
-          (*m_runoff)(i, j)                = R * ice_density;
-          // m_mass_flux (unlike m_accumulation, m_melt, and m_runoff), is a
-          // rate. m * (kg / m^3) / second = kg / m^2 / second
-          m_mass_flux(i, j) = SMB * ice_density / dt;
+          A   += accumulation;
+          M   += changes.melt;
+          R   += changes.runoff;
+          SMB += changes.smb;
         }
+      } // end of the time-stepping loop
+
+      // set firn and snow depths
+      m_firn_depth(i, j) = firn;
+      m_snow_depth(i, j) = snow;
+
+      // set total accumulation, melt, and runoff, and SMB at this point, converting
+      // from "meters, ice equivalent" to "kg / m^2"
+      {
+        (*m_accumulation)(i, j)          = A * ice_density;
+        (*m_melt)(i, j)                  = M * ice_density;
+        (*m_runoff)(i, j)                = R * ice_density;
+        // m_mass_flux (unlike m_accumulation, m_melt, and m_runoff), is a
+        // rate. m * (kg / m^3) / second = kg / m^2 / second
+        m_mass_flux(i, j) = SMB * ice_density / dt;
       }
 
-      if (mask.ice_free_ocean(i, j)) {
+      if (ocean) {
         m_firn_depth(i, j) = 0.0;  // no firn in the ocean
         m_snow_depth(i, j) = 0.0;  // snow over the ocean does not stick
       }
     }
+
+    block.clear();
+  };
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for (Points p(*m_grid); p; p.next()) {
+      block.push_back({p.i(), p.j()});
+
+      if (block.size() == (size_t)block_size) {
+        process_block();
+      }
+    }
+
+    // remaining columns
+    process_block();
   } catch (...) {
     loop.failed();
   }
   loop.check();
 
+  if (sigmalapserate != 0.0 or m_sd_use_param) {
+    // m_air_temp_sd was modified in place
+    m_air_temp_sd->inc_state_counter();
+  }
+
   m_atmosphere->end_pointwise_access();
 
   m_next_balance_year_start = compute_next_balance_year_start(m_grid->ctx()->time()->current());
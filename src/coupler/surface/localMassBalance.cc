@@ -1,4 +1,4 @@
-// Copyright (C) 2009, 2010, 2011, 2013, 2014, 2015, 2016, 2017, 2018 Ed Bueler and Constantine Khroulev and Andy Aschwanden
+// Copyright (C) 2009, 2010, 2011, 2013, 2014, 2015, 2016, 2017, 2018, 2020 Ed Bueler and Constantine Khroulev and Andy Aschwanden
 //
 // This file is part of PISM.
 //
@@ -17,17 +17,16 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cassert>
-#include <ctime>  // for time(), used to initialize random number gen
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
 #include <gsl/gsl_math.h>       // M_PI
 #include <cmath>                // for erfc() in CalovGreveIntegrand()
 #include <algorithm>
+#include <cstdint>              // uint32_t, uint64_t
 
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/ConfigInterface.hh"
 #include "localMassBalance.hh"
 #include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
 
 namespace pism {
 namespace surface {
@@ -42,7 +41,8 @@ LocalMassBalance::Changes::Changes() {
 
 LocalMassBalance::LocalMassBalance(Config::ConstPtr myconfig, units::System::Ptr system)
   : m_config(myconfig), m_unit_system(system),
-    m_seconds_per_day(86400) {
+    m_seconds_per_day(86400),
+    m_seconds_to_years(system, "seconds", "years") {
   // empty
 }
 
@@ -54,8 +54,16 @@ std::string LocalMassBalance::method() const {
   return m_method;
 }
 
+void LocalMassBalance::set_block(const std::vector<std::pair<int, int> > &columns,
+                                 const std::vector<double> &times) {
+  (void) columns;
+  (void) times;
+  // empty
+}
+
 PDDMassBalance::PDDMassBalance(Config::ConstPtr config, units::System::Ptr system)
-  : LocalMassBalance(config, system) {
+  : LocalMassBalance(config, system),
+    m_max_evals_per_year(config, "surface.pdd.max_evals_per_year") {
   precip_as_snow     = m_config->get_flag("surface.pdd.interpret_precip_as_snow");
   Tmin               = m_config->get_number("surface.pdd.air_temp_all_precip_as_snow");
   Tmax               = m_config->get_number("surface.pdd.air_temp_all_precip_as_rain");
@@ -70,8 +78,8 @@ PDDMassBalance::PDDMassBalance(Config::ConstPtr config, units::System::Ptr syste
     precipitation time-series.
  */
 unsigned int PDDMassBalance::get_timeseries_length(double dt) {
-  const unsigned int    NperYear = static_cast<unsigned int>(m_config->get_number("surface.pdd.max_evals_per_year"));
-  const double dt_years = units::convert(m_unit_system, dt, "seconds", "years");
+  const unsigned int NperYear = static_cast<unsigned int>(m_max_evals_per_year.value());
+  const double dt_years = m_seconds_to_years(dt);
 
   return std::max(1U, static_cast<unsigned int>(ceil(NperYear * dt_years)));
 }
@@ -122,11 +130,28 @@ void PDDMassBalance::get_PDDs(double dt_series,
   assert(S.size() == T.size() and T.size() == PDDs.size());
   assert(dt_series > 0.0);
 
-  const double h_days = dt_series / m_seconds_per_day;
+  const double
+    h_days     = dt_series / m_seconds_per_day,
+    threshold  = pdd_threshold_temp,
+    sqrt_2     = sqrt(2.0),
+    sqrt_2_pi  = sqrt(2.0 * M_PI);
   const size_t N = S.size();
 
-  for (unsigned int k = 0; k < N; ++k) {
-    PDDs[k] = h_days * CalovGreveIntegrand(S[k], T[k] - pdd_threshold_temp);
+  const double
+    *s   = S.data(),
+    *t   = T.data();
+  double *pdd = PDDs.data();
+
+  // Same as CalovGreveIntegrand(), but without branches (the case of sigma == 0 is handled
+  // using a "select" at the end) so that the compiler can vectorize this loop.
+  for (size_t k = 0; k < N; ++k) {
+    const double
+      sigma = s[k],
+      TacC  = t[k] - threshold,
+      Z     = TacC / (sqrt_2 * (sigma == 0.0 ? 1.0 : sigma)),
+      I     = (sigma / sqrt_2_pi) * exp(-Z*Z) + (TacC / 2.0) * erfc(-Z);
+
+    pdd[k] = h_days * (sigma == 0.0 ? std::max(TacC, 0.0) : I);
   }
 }
 
@@ -292,16 +317,81 @@ PDDMassBalance::Changes PDDMassBalance::step(const DegreeDayFactors &ddf,
 }
 
 
+namespace {
+
+/*!
+ * The Philox4x32-10 counter-based random number generator [\ref Salmon2011].
+ *
+ * Maps the counter `ctr` and the key `key` to 4 (pseudo-)random 32-bit integers.
+ */
+void philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t result[4]) {
+  const uint32_t
+    M0 = 0xD2511F53,
+    M1 = 0xCD9E8D57,
+    W0 = 0x9E3779B9,
+    W1 = 0xBB67AE85;
+
+  uint32_t
+    c[4] = {ctr[0], ctr[1], ctr[2], ctr[3]},
+    k[2] = {key[0], key[1]};
+
+  for (int round = 0; round < 10; ++round) {
+    uint64_t
+      p0 = (uint64_t)M0 * c[0],
+      p1 = (uint64_t)M1 * c[2];
+
+    uint32_t
+      hi0 = p0 >> 32, lo0 = (uint32_t)p0,
+      hi1 = p1 >> 32, lo1 = (uint32_t)p1;
+
+    c[0] = hi1 ^ c[1] ^ k[0];
+    c[1] = lo1;
+    c[2] = hi0 ^ c[3] ^ k[1];
+    c[3] = lo0;
+
+    k[0] += W0;
+    k[1] += W1;
+  }
+
+  for (int n = 0; n < 4; ++n) {
+    result[n] = c[n];
+  }
+}
+
+/*!
+ * Normally distributed random number with zero mean and the standard deviation `sigma`
+ * (Box-Muller transform of two uniform random numbers computed using philox4x32()).
+ */
+double gaussian(uint32_t seed, int i, int j, double t, double sigma) {
+  // use the time (in whole seconds) as a 64-bit integer
+  const uint64_t time = (uint64_t)std::llround(t);
+
+  const uint32_t
+    ctr[4] = {(uint32_t)i, (uint32_t)j, (uint32_t)time, (uint32_t)(time >> 32)},
+    key[2] = {seed, 0};
+
+  uint32_t x[4];
+  philox4x32(ctr, key, x);
+
+  // u1 is in (0, 1), u2 is in [0, 1)
+  const double
+    scale = 1.0 / 4294967296.0, // 2^-32
+    u1    = (x[0] + 0.5) * scale,
+    u2    = x[1] * scale;
+
+  return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+} // end of anonymous namespace
+
 /*!
-Initializes the random number generator (RNG).  The RNG is GSL's recommended default,
-which seems to be "mt19937" and is DIEHARD (whatever that means ...). Seed with
-wall clock time in seconds in non-repeatable case, and with 0 in repeatable case.
+ * The seed should be the same on all processes. It is ignored (and set to zero) in the
+ * repeatable case.
  */
 PDDrandMassBalance::PDDrandMassBalance(Config::ConstPtr config, units::System::Ptr system,
-                                       Kind kind)
+                                       Kind kind, uint32_t seed)
   : PDDMassBalance(config, system) {
-  pddRandGen = gsl_rng_alloc(gsl_rng_default);  // so pddRandGen != NULL now
-  gsl_rng_set(pddRandGen, kind == REPEATABLE ? 0 : time(0));
+  m_seed = kind == REPEATABLE ? 0 : seed;
 
   m_method = (kind == NOT_REPEATABLE
               ? "simulation of a random process"
@@ -310,10 +400,7 @@ PDDrandMassBalance::PDDrandMassBalance(Config::ConstPtr config, units::System::P
 
 
 PDDrandMassBalance::~PDDrandMassBalance() {
-  if (pddRandGen != NULL) {
-    gsl_rng_free(pddRandGen);
-    pddRandGen = NULL;
-  }
+  // empty
 }
 
 
@@ -332,11 +419,20 @@ unsigned int PDDrandMassBalance::get_timeseries_length(double dt) {
   return std::max(static_cast<size_t>(ceil(dt / m_seconds_per_day)), (size_t)2);
 }
 
+void PDDrandMassBalance::set_block(const std::vector<std::pair<int, int> > &columns,
+                                   const std::vector<double> &times) {
+  m_columns = columns;
+  m_times   = times;
+}
+
 /** 
  * Computes
  * \f[
  * \text{PDD} = \sum_{i=0}^{N-1} h_{\text{days}} \cdot \text{max}(T_i-T_{\text{threshold}}, 0).
  * \f]
+ *
+ * Random temperature excursions depend on the grid indices of a column and the time of a
+ * sub-interval (see set_block()), not on the order of evaluation.
  * 
  * @param S \f$\sigma\f$ (standard deviation for daily temperature excursions)
  * @param dt_series time-series step, in seconds
@@ -351,16 +447,27 @@ void PDDrandMassBalance::get_PDDs(double dt_series,
   assert(S.size() == T.size() and T.size() == PDDs.size());
   assert(dt_series > 0.0);
 
+  const size_t
+    N       = S.size(),
+    N_times = m_times.size();
+
+  if (N_times == 0 or m_columns.size() * N_times != N) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "time series (length %d) do not match the block"
+                                  " (%d columns, %d times)",
+                                  (int)N, (int)m_columns.size(), (int)N_times);
+  }
+
   const double h_days = dt_series / m_seconds_per_day;
-  const size_t N = S.size();
 
-  for (unsigned int k = 0; k < N; ++k) {
-    // average temperature in k-th interval
-    double T_k = T[k] + gsl_ran_gaussian(pddRandGen, S[k]); // add random: N(0,sigma)
+  for (size_t n = 0; n < N; ++n) {
+    const auto &c = m_columns[n / N_times];
+    const double t = m_times[n % N_times];
 
-    if (T_k > pdd_threshold_temp) {
-      PDDs[k] = h_days * (T_k - pdd_threshold_temp);
-    }
+    // average temperature in n-th interval
+    double T_n = T[n] + gaussian(m_seed, c.first, c.second, t, S[n]); // add random: N(0,sigma)
+
+    PDDs[n] = h_days * std::max(T_n - pdd_threshold_temp, 0.0);
   }
 }
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2015, 2017, 2018 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2015, 2017, 2018, 2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -19,8 +19,9 @@
 #ifndef __localMassBalance_hh
 #define __localMassBalance_hh
 
-
-#include <gsl/gsl_rng.h>
+#include <cstdint>              // uint32_t
+#include <utility>              // std::pair
+#include <vector>
 
 #include "pism/util/iceModelVec.hh"  // only needed for FaustoGrevePDDObject
 
@@ -78,13 +79,28 @@ public:
 
   //! Count positive degree days (PDDs).  Returned value in units of K day.
   /*! Inputs T[0],...,T[N-1] are temperatures (K) at times t, t+dt_series, ..., t+(N-1)dt_series.
-    Inputs `t`, `dt_series` are in seconds.  */
+    Inputs `t`, `dt_series` are in seconds.
+
+    Each PDDs[k] depends on S[k] and T[k] only, so `S`, `T`, and `PDDs` may contain time
+    series for several columns stored one after another ("blocks" of columns, see
+    TemperatureIndex::update_impl()). */
   virtual void get_PDDs(double dt_series,
                         const std::vector<double> &S,
                         const std::vector<double> &T,
                         std::vector<double> &PDDs) = 0;
 
-  /*! Remove rain from precipitation. */
+  /*!
+   * Set grid indices of columns and times corresponding to the block of time series
+   * passed to the next get_PDDs() call (columns ordered as in the block, `times` are
+   * start times of sub-intervals, in seconds).
+   *
+   * Only implementations that need the location (e.g. to generate random numbers that do
+   * not depend on the domain decomposition) use this.
+   */
+  virtual void set_block(const std::vector<std::pair<int, int> > &columns,
+                         const std::vector<double> &times);
+
+  /*! Remove rain from precipitation. Like get_PDDs(), accepts blocks of time series. */
   virtual void get_snow_accumulation(const std::vector<double> &T,
                                      std::vector<double> &precip_rate) = 0;
 
@@ -121,6 +137,7 @@ protected:
   const Config::ConstPtr m_config;
   const units::System::Ptr m_unit_system;
   const double m_seconds_per_day;
+  const units::LinearConverter m_seconds_to_years;
 };
 
 
@@ -160,13 +177,18 @@ protected:
   double Tmin,             //!< the temperature below which all precipitation is snow
     Tmax;             //!< the temperature above which all precipitation is rain
   double pdd_threshold_temp; //!< threshold temperature for the PDD computation
+  //! maximum number of evaluations of the PDD integral per year
+  ConfigParameter<double> m_max_evals_per_year;
 };
 
 
 //! An alternative PDD implementation which simulates a random process to get the number of PDDs.
 /*!
-  Uses a GSL random number generator.  Significantly slower because new random numbers are
-  generated for each grid point.
+  Uses a counter-based random number generator (Philox4x32-10, see [\ref Salmon2011]) keyed
+  on the seed, grid indices of a column and the time of a sub-interval. Random numbers do
+  not depend on the order of evaluation, so results are the same for any number of
+  processes. Significantly slower because new random numbers are generated for each grid
+  point.
 
   The way the number of positive degree-days are used to produce a surface mass balance
   is identical to the base class PDDMassBalance.
@@ -182,17 +204,26 @@ public:
 
   PDDrandMassBalance(Config::ConstPtr config,
                      units::System::Ptr system,
-                     Kind repeatable);
+                     Kind repeatable,
+                     uint32_t seed = 0);
   virtual ~PDDrandMassBalance();
 
   virtual unsigned int get_timeseries_length(double dt);
 
+  void set_block(const std::vector<std::pair<int, int> > &columns,
+                 const std::vector<double> &times);
+
   virtual void get_PDDs(double dt_series,
                         const std::vector<double> &S,
                         const std::vector<double> &T,
                         std::vector<double> &PDDs);
 protected:
-  gsl_rng *pddRandGen;
+  //! seed (the first word of the Philox key)
+  uint32_t m_seed;
+  //! columns corresponding to the current block (see set_block())
+  std::vector<std::pair<int, int> > m_columns;
+  //! times of sub-intervals corresponding to the current block
+  std::vector<double> m_times;
 };
 
 
@@ -0,0 +1,96 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "FusedField.hh"
+
+#include "pism/util/IceGrid.hh"
+
+namespace pism {
+
+FusedField::FusedField(Allocator allocate, Input input)
+  : m_allocate(allocate),
+    m_input(input),
+    m_scale(1.0),
+    m_offset(0.0),
+    m_input_field(nullptr),
+    m_stale(true) {
+  // empty
+}
+
+/*!
+ * Set coefficients of this modifier for the current time step.
+ *
+ * @param[in] scale scaling factor
+ * @param[in] offset offset (added after scaling)
+ * @param[in] input FusedField of the input model or nullptr if the input model does not
+ *                  provide one
+ */
+void FusedField::update(double scale, double offset, const FusedField *input) {
+  m_scale       = scale;
+  m_offset      = offset;
+  m_input_field = input;
+  m_stale       = true;
+}
+
+/*!
+ * Return the output, computing it if necessary.
+ */
+const IceModelVec2S& FusedField::value() const {
+  if (not m_stale) {
+    return *m_value;
+  }
+
+  // compose maps of all modifiers in the chain: if the output of this modifier is
+  // `scale * x + offset`, where `x` is the output of `field`, then...
+  double
+    scale  = 1.0,
+    offset = 0.0;
+  const FusedField *field = this;
+  while (true) {
+    // ... the output of `field` is `field->m_scale * y + field->m_offset`, where `y` is
+    // its input
+    offset += scale * field->m_offset;
+    scale  *= field->m_scale;
+
+    if (field->m_input_field == nullptr) {
+      break;
+    }
+    field = field->m_input_field;
+  }
+
+  const IceModelVec2S &input = field->m_input();
+
+  if (not m_value) {
+    m_value = m_allocate();
+  }
+  IceModelVec2S &result = *m_value;
+
+  IceModelVec::AccessList list{&input, &result};
+
+  for (Points p(*result.grid()); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result(i, j) = scale * input(i, j) + offset;
+  }
+
+  m_stale = false;
+
+  return result;
+}
+
+} // end of namespace pism
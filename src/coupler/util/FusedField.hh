@@ -0,0 +1,68 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef PISM_FUSEDFIELD_H
+#define PISM_FUSEDFIELD_H
+
+#include <functional>
+
+#include "pism/util/iceModelVec.hh"
+
+namespace pism {
+
+/*!
+ * Output of a modifier applying a pointwise map `output = scale * input + offset` with
+ * scalar coefficients (e.g. `delta_T` or `frac_P`) to a field of its input model.
+ *
+ * Such modifiers do not compute their outputs in update(): they only record coefficients
+ * and a pointer to the FusedField of the input model (if the input model is also a
+ * modifier of this kind). The output is computed on first access, in one pass over the
+ * field of the first model in the chain that is *not* a scalar modifier, using composed
+ * coefficients of all the modifiers in between.
+ *
+ * Outputs of intermediate modifiers in a chain such as `given,delta_T,delta_T,...` are
+ * not allocated or computed unless requested (e.g. by a diagnostic).
+ */
+class FusedField {
+public:
+  //! Returns the input field (called only if the input is not a FusedField).
+  typedef std::function<const IceModelVec2S&()> Input;
+  //! Allocates storage for the output.
+  typedef std::function<IceModelVec2S::Ptr()> Allocator;
+
+  FusedField(Allocator allocate, Input input);
+
+  void update(double scale, double offset, const FusedField *input);
+
+  const IceModelVec2S& value() const;
+private:
+  Allocator m_allocate;
+  Input m_input;
+
+  double m_scale;
+  double m_offset;
+  //! scalar modifier in the input model (nullptr if the input model is not one)
+  const FusedField *m_input_field;
+
+  mutable IceModelVec2S::Ptr m_value;
+  mutable bool m_stale;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_FUSEDFIELD_H */
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018, 2019 PISM Authors
+/* Copyright (C) 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -34,7 +34,8 @@ ScalarForcing::ScalarForcing(Context::ConstPtr ctx,
                              const std::string &units,
                              const std::string &glaciological_units,
                              const std::string &long_name)
-  : m_ctx(ctx), m_period(0), m_reference_time(0.0), m_current(0.0) {
+  : m_ctx(ctx), m_period(0), m_reference_time(0.0), m_current(0.0),
+    m_cursor(0) {
 
   Config::ConstPtr config = ctx->config();
 
@@ -99,7 +100,19 @@ double ScalarForcing::value() const {
 double ScalarForcing::value(double t) const {
   t = m_ctx->time()->mod(t - m_reference_time, m_period);
 
-  return (*m_data)(t);
+  return (*m_data)(t, m_cursor);
+}
+
+//! Get values corresponding to times `ts` (sorted in increasing order).
+void ScalarForcing::value(const std::vector<double> &ts, std::vector<double> &result) const {
+  result.resize(ts.size());
+
+  size_t cursor = 0;
+  for (size_t k = 0; k < ts.size(); ++k) {
+    double t = m_ctx->time()->mod(ts[k] - m_reference_time, m_period);
+
+    result[k] = (*m_data)(t, cursor);
+  }
 }
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,7 @@
 #define _SCALARFORCING_H_
 
 #include <memory>               // std::unique_ptr
+#include <vector>
 
 #include "pism/util/Context.hh"
 
@@ -49,6 +50,7 @@ public:
 
   double value() const;
   double value(double t) const;
+  void value(const std::vector<double> &ts, std::vector<double> &result) const;
 protected:
   Context::ConstPtr m_ctx;
 
@@ -62,6 +64,9 @@ protected:
   double m_reference_time;
 
   double m_current;
+
+  // position in m_data found by the last call of value(t) (see Timeseries::operator())
+  mutable size_t m_cursor;
 };
 
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,29 +17,53 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <cmath>                // fabs
-
-#include "pism/util/iceModelVec.hh"
+#include "lapse_rates.hh"
 
 namespace pism {
 
-void lapse_rate_correction(const IceModelVec2S &surface,
-                           const IceModelVec2S &reference_surface,
-                           double lapse_rate,
-                           IceModelVec2S &result) {
-  IceGrid::ConstPtr grid = result.grid();
+ElevationDifference::ElevationDifference(IceGrid::ConstPtr grid)
+  : m_difference(grid, "elevation_difference", WITHOUT_GHOSTS),
+    m_surface(nullptr),
+    m_reference_surface(nullptr),
+    m_memo(grid->ctx()->memo(), "lapse_rates.elevation_difference") {
+  m_difference.set_attrs("internal",
+                         "difference between the ice surface elevation and the reference surface",
+                         "m", "m", "", 0);
+}
 
-  if (fabs(lapse_rate) < 1e-12) {
-    return;
+/*!
+ * Returns `surface - reference_surface`.
+ *
+ * Note: code modifying `surface` point-wise has to call `surface.inc_state_counter()`
+ * (Geometry::ensure_consistency() does); `reference_surface` is usually an IceModelVec2T
+ * updating its state counter every time it is interpolated to a different time.
+ */
+const IceModelVec2S& ElevationDifference::update(const IceModelVec2S &surface,
+                                                 const IceModelVec2S &reference_surface) {
+  if (&surface != m_surface or &reference_surface != m_reference_surface) {
+    m_memo.reset();
   }
 
-  IceModelVec::AccessList list{&surface, &reference_surface, &result};
+  std::vector<int> key{surface.state_counter(), reference_surface.state_counter()};
 
-  for (Points p(*grid); p; p.next()) {
+  if (m_memo.up_to_date(key)) {
+    return m_difference;
+  }
+
+  IceModelVec::AccessList list{&surface, &reference_surface, &m_difference};
+
+  for (Points p(*m_difference.grid()); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    result(i, j) -= lapse_rate * (surface(i,j) - reference_surface(i, j));
+    m_difference(i, j) = surface(i, j) - reference_surface(i, j);
   }
+  m_difference.inc_state_counter();
+
+  m_surface           = &surface;
+  m_reference_surface = &reference_surface;
+  m_memo.set(key);
+
+  return m_difference;
 }
 
 } // end of namespace pism
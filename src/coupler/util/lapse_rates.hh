@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,14 +20,34 @@
 #ifndef LAPSE_RATES_H
 #define LAPSE_RATES_H
 
+#include <vector>
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/Memo.hh"
+
 namespace pism {
 
-class IceModelVec2S;
+/*!
+ * The difference between the ice surface elevation and a reference surface elevation
+ * used by lapse rate corrections.
+ *
+ * Re-computed only if one of the inputs changed (according to their state counters)
+ * since the last call of update(), so a modifier applying several corrections per time
+ * step (or called again with the same inputs) computes it once.
+ */
+class ElevationDifference {
+public:
+  ElevationDifference(IceGrid::ConstPtr grid);
+
+  const IceModelVec2S& update(const IceModelVec2S &surface,
+                              const IceModelVec2S &reference_surface);
+private:
+  IceModelVec2S m_difference;
 
-void lapse_rate_correction(const IceModelVec2S &surface,
-                           const IceModelVec2S &reference_surface,
-                           double lapse_rate,
-                           IceModelVec2S &result);
+  //! inputs used to compute m_difference and their state counters
+  const IceModelVec2S *m_surface, *m_reference_surface;
+  Memo m_memo;
+};
 
 } // end of namespace pism
 
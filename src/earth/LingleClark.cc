@@ -27,7 +27,15 @@
 #include "pism/util/MaxTimestep.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/fftw_utilities.hh"
+#include "pism/util/MemoryTracker.hh"
+#include "pism/pism_config.hh"
 #include "LingleClarkSerial.hh"
+#include "greens.hh"
+#include "lrm_cache.hh"
+
+#if (Pism_USE_FFTW_MPI==1)
+#include "LingleClarkParallel.hh"
+#endif
 
 namespace pism {
 namespace bed {
@@ -37,9 +45,12 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
     m_total_displacement(m_grid, "bed_displacement", WITHOUT_GHOSTS),
     m_relief(m_grid, "bed_relief", WITHOUT_GHOSTS),
     m_load_thickness(grid, "load_thickness", WITHOUT_GHOSTS),
-    m_elastic_displacement(grid, "elastic_bed_displacement", WITHOUT_GHOSTS) {
+    m_elastic_displacement(grid, "elastic_bed_displacement", WITHOUT_GHOSTS),
+    m_lagged_load_thickness(grid, "lagged_load_thickness", WITHOUT_GHOSTS),
+    m_fftw_memory_id(-1) {
 
   m_time_name = m_config->get_string("time.dimension_name") + "_lingle_clark";
+  m_lagged_dt_name = "lingle_clark_lagged_dt";
   m_t_last = m_grid->ctx()->time()->current();
   m_update_interval = m_config->get_number("bed_deformation.lc.update_interval", "seconds");
   m_t_eps = 1.0;
@@ -50,6 +61,15 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
                                   m_update_interval);
   }
 
+  m_asynchronous     = m_config->get_flag("bed_deformation.lc.asynchronous");
+  m_step_in_progress = false;
+  m_lagged_dt        = 0.0;
+
+  m_lagged_load_thickness.set_attrs("model state",
+                                    "load thickness used by the Lingle-Clark update "
+                                    "computed in the background",
+                                    "meters", "meters", "", 0);
+
   // A work vector. This storage is used to put thickness change on rank 0 and to get the plate
   // displacement change back.
   m_total_displacement.set_attrs("internal",
@@ -57,8 +77,6 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
                                  "in the Lingle-Clark bed deformation model",
                                  "meters", "meters", "", 0);
 
-  m_work0 = m_total_displacement.allocate_proc0_copy();
-
   m_relief.set_attrs("internal",
                      "bed relief relative to the modeled bed displacement",
                      "meters", "meters", "", 0);
@@ -69,7 +87,6 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
                                    "elastic part of the displacement in the "
                                    "Lingle-Clark bed deformation model; "
                                    "see :cite:`BLKfastearth`", "meters", "meters", "", 0);
-  m_elastic_displacement0 = m_elastic_displacement.allocate_proc0_copy();
 
   const int
     Mx = m_grid->Mx(),
@@ -102,7 +119,41 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
   // do not point to auxiliary coordinates "lon" and "lat".
   m_viscous_displacement.metadata().set_string("coordinates", "");
 
+  if (m_config->get_string("bed_deformation.model") == "lc_mpi") {
+    if (m_asynchronous) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "bed_deformation.lc.asynchronous is not supported by"
+                         " bed_deformation.model = lc_mpi");
+    }
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model.reset(new LingleClarkParallel(m_grid, m_extended_grid,
+                                                   use_elastic_model));
+    return;
+#else
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "bed_deformation.model = lc_mpi requires FFTW's MPI interface.\n"
+                       "Please re-build PISM with -DPism_USE_FFTW_MPI=ON.");
+#endif
+  }
+
+  // Storage on rank 0 is needed by the serial model only.
+  m_work0                 = m_total_displacement.allocate_proc0_copy();
+  m_elastic_displacement0 = m_elastic_displacement.allocate_proc0_copy();
   m_viscous_displacement0 = m_viscous_displacement.allocate_proc0_copy();
+  if (m_asynchronous) {
+    m_load_thickness0 = m_load_thickness.allocate_proc0_copy();
+  }
+
+  // Integrals defining the elastic load response matrix are independent: compute them
+  // using all processes (unless the matrix is cached).
+  std::vector<double> elastic_response;
+  if (use_elastic_model and
+      not lrm_spectrum_cached(m_grid->com,
+                              m_config->get_string("bed_deformation.lc.lrm_cache_file"),
+                              Nx, Ny, m_grid->dx(), m_grid->dy())) {
+    elastic_load_response(m_grid->com, m_grid->dx(), m_grid->dy(), Nx / 2, Ny / 2,
+                          elastic_response);
+  }
 
   ParallelSection rank0(m_grid->com);
   try {
@@ -110,7 +161,11 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
       m_serial_model.reset(new LingleClarkSerial(m_log, *m_config, use_elastic_model,
                                                  Mx, My,
                                                  m_grid->dx(), m_grid->dy(),
-                                                 Nx, Ny));
+                                                 Nx, Ny, elastic_response));
+
+      // LingleClarkSerial allocates 4 FFTW arrays on the extended grid
+      m_fftw_memory_id = m_grid->ctx()->memory().allocate("lc FFTW arrays",
+                                                          4 * sizeof(fftw_complex) * Nx * Ny);
     }
   } catch (...) {
     rank0.failed();
@@ -119,7 +174,7 @@ LingleClark::LingleClark(IceGrid::ConstPtr grid)
 }
 
 LingleClark::~LingleClark() {
-  // empty
+  m_grid->ctx()->memory().deallocate(m_fftw_memory_id);
 }
 
 /*!
@@ -142,6 +197,26 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
   compute_load(bed_elevation, ice_thickness, sea_level_elevation,
                m_load_thickness);
 
+  if (m_parallel_model) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model->bootstrap(m_load_thickness, bed_uplift);
+
+    m_viscous_displacement.copy_from(m_parallel_model->viscous_displacement());
+    m_elastic_displacement.copy_from(m_parallel_model->elastic_displacement());
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+#endif
+  } else {
+    bootstrap_serial(bed_uplift);
+  }
+
+  // compute bed relief
+  m_topg.add(-1.0, m_total_displacement, m_relief);
+}
+
+/*!
+ * Bootstrap the serial model on rank 0 using m_load_thickness and the bed uplift.
+ */
+void LingleClark::bootstrap_serial(const IceModelVec2S &bed_uplift) {
   petsc::Vec::Ptr thickness0 = m_load_thickness.allocate_proc0_copy();
 
   // initialize the plate displacement
@@ -176,9 +251,6 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
   m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
 
   m_total_displacement.get_from_proc0(*m_work0);
-
-  // compute bed relief
-  m_topg.add(-1.0, m_total_displacement, m_relief);
 }
 
 /*!
@@ -189,6 +261,13 @@ void LingleClark::bootstrap_impl(const IceModelVec2S &bed_elevation,
 IceModelVec2S::Ptr LingleClark::elastic_load_response_matrix() const {
   IceModelVec2S::Ptr result(new IceModelVec2S(m_extended_grid, "lrm", WITHOUT_GHOSTS));
 
+  if (m_parallel_model) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model->compute_load_response_matrix(*result);
+#endif
+    return result;
+  }
+
   int
     Nx = m_extended_grid->Mx(),
     Ny = m_extended_grid->My();
@@ -229,6 +308,12 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
                             const IceModelVec2S &sea_level_elevation) {
   m_log->message(2, "* Initializing the Lingle-Clark bed deformation model...\n");
 
+  if (m_asynchronous) {
+    m_log->message(2,
+                   "  Computing updates in the background: bed elevation lags the load by %3.3f years.\n",
+                   units::convert(m_sys, m_update_interval, "seconds", "years"));
+  }
+
   if (opts.type == INIT_RESTART or opts.type == INIT_BOOTSTRAP) {
     File input_file(m_grid->com, opts.filename, PISM_NETCDF3, PISM_READONLY);
 
@@ -267,8 +352,14 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
                m_load_thickness);
 
   // Now that viscous displacement and elastic displacement are finally initialized,
-  // put them on rank 0 and initialize the serial model itself.
-  {
+  // use them to initialize the model itself.
+  if (m_parallel_model) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model->init(m_viscous_displacement, m_elastic_displacement);
+
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+#endif
+  } else {
     m_viscous_displacement.put_on_proc0(*m_viscous_displacement0);
     m_elastic_displacement.put_on_proc0(*m_work0);
 
@@ -286,12 +377,30 @@ void LingleClark::init_impl(const InputOptions &opts, const IceModelVec2S &ice_t
       rank0.failed();
     }
     rank0.check();
-  }
 
-  m_total_displacement.get_from_proc0(*m_work0);
+    m_total_displacement.get_from_proc0(*m_work0);
+  }
 
   // compute bed relief
   m_topg.add(-1.0, m_total_displacement, m_relief);
+
+  // Re-start the update that was computed in the background when the model state was
+  // saved (if any).
+  m_step_in_progress = false;
+  m_lagged_dt        = 0.0;
+  if (m_asynchronous and opts.type == INIT_RESTART) {
+    File input_file(m_grid->com, opts.filename, PISM_NETCDF3, PISM_READONLY);
+
+    if (input_file.find_variable(m_lagged_dt_name) and
+        input_file.find_variable(m_lagged_load_thickness.get_name())) {
+      input_file.read_variable(m_lagged_dt_name, {0}, {1}, &m_lagged_dt);
+      m_lagged_load_thickness.read(input_file, opts.record);
+
+      if (m_lagged_dt > 0.0) {
+        start_lagged_step();
+      }
+    }
+  }
 }
 
 MaxTimestep LingleClark::max_timestep_impl(double t) const {
@@ -314,6 +423,11 @@ MaxTimestep LingleClark::max_timestep_impl(double t) const {
     dt_max = m_update_interval;
   }
 
+  if (m_asynchronous) {
+    // bed displacement corresponds to the load at the previous update time
+    return MaxTimestep(dt_max, "bed_def lc (lagged by one update interval)");
+  }
+
   return MaxTimestep(dt_max, "bed_def lc");
 }
 
@@ -343,6 +457,36 @@ void LingleClark::step(const IceModelVec2S &ice_thickness,
   compute_load(m_topg, ice_thickness, sea_level_elevation,
                m_load_thickness);
 
+  if (m_parallel_model) {
+#if (Pism_USE_FFTW_MPI==1)
+    m_parallel_model->step(dt, m_load_thickness);
+
+    m_viscous_displacement.copy_from(m_parallel_model->viscous_displacement());
+    m_elastic_displacement.copy_from(m_parallel_model->elastic_displacement());
+    m_total_displacement.copy_from(m_parallel_model->total_displacement());
+#endif
+  } else if (m_asynchronous) {
+    step_asynchronous(dt);
+  } else {
+    step_serial(dt);
+  }
+
+  // Update bed elevation using bed displacement and relief.
+  {
+    m_total_displacement.add(1.0, m_relief, m_topg);
+    // Increment the topg state counter. SIAFD relies on this!
+    m_topg.inc_state_counter();
+  }
+
+  //! Finally, we need to update bed uplift and topg_last.
+  compute_uplift(m_topg, m_topg_last, dt, m_uplift);
+  m_topg_last.copy_from(m_topg);
+}
+
+/*!
+ * Perform a step of the serial model on rank 0 using m_load_thickness.
+ */
+void LingleClark::step_serial(double dt) {
   m_load_thickness.put_on_proc0(*m_work0);
 
   ParallelSection rank0(m_grid->com);
@@ -371,17 +515,70 @@ void LingleClark::step(const IceModelVec2S &ice_thickness,
   m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
 
   m_total_displacement.get_from_proc0(*m_work0);
+}
 
-  // Update bed elevation using bed displacement and relief.
-  {
-    m_total_displacement.add(1.0, m_relief, m_topg);
-    // Increment the topg state counter. SIAFD relies on this!
-    m_topg.inc_state_counter();
+/*!
+ * Perform a step of the serial model in the background.
+ *
+ * Waits for the update started at the previous update time, uses its results, then
+ * starts the next update using the current load. This hides the cost of the serial model
+ * behind the rest of the time step, but bed displacement lags the load by one update
+ * interval (as in coupled climate models using lagged coupling).
+ */
+void LingleClark::step_asynchronous(double dt) {
+
+  ParallelSection rank0(m_grid->com);
+  try {
+    if (m_grid->rank() == 0 and m_step_in_progress) {
+      PetscErrorCode ierr = 0;
+
+      m_serial_model->step_end();
+
+      ierr = VecCopy(m_serial_model->total_displacement(), *m_work0);
+      PISM_CHK(ierr, "VecCopy");
+
+      ierr = VecCopy(m_serial_model->viscous_displacement(), *m_viscous_displacement0);
+      PISM_CHK(ierr, "VecCopy");
+
+      ierr = VecCopy(m_serial_model->elastic_displacement(), *m_elastic_displacement0);
+      PISM_CHK(ierr, "VecCopy");
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+
+  if (m_step_in_progress) {
+    m_viscous_displacement.get_from_proc0(*m_viscous_displacement0);
+
+    m_elastic_displacement.get_from_proc0(*m_elastic_displacement0);
+
+    m_total_displacement.get_from_proc0(*m_work0);
   }
 
-  //! Finally, we need to update bed uplift and topg_last.
-  compute_uplift(m_topg, m_topg_last, dt, m_uplift);
-  m_topg_last.copy_from(m_topg);
+  m_lagged_load_thickness.copy_from(m_load_thickness);
+  m_lagged_dt = dt;
+
+  start_lagged_step();
+}
+
+/*!
+ * Start the update using m_lagged_load_thickness and m_lagged_dt in the background.
+ */
+void LingleClark::start_lagged_step() {
+  m_lagged_load_thickness.put_on_proc0(*m_load_thickness0);
+
+  ParallelSection rank0(m_grid->com);
+  try {
+    if (m_grid->rank() == 0) {
+      m_serial_model->step_begin(m_lagged_dt, *m_load_thickness0);
+    }
+  } catch (...) {
+    rank0.failed();
+  }
+  rank0.check();
+
+  m_step_in_progress = true;
 }
 
 //! Update the Lingle-Clark bed deformation model.
@@ -409,6 +606,18 @@ void LingleClark::define_model_state_impl(const File &output) const {
   m_viscous_displacement.define(output);
   m_elastic_displacement.define(output);
 
+  if (m_asynchronous) {
+    m_lagged_load_thickness.define(output);
+
+    if (not output.find_variable(m_lagged_dt_name)) {
+      output.define_variable(m_lagged_dt_name, PISM_DOUBLE, {});
+
+      output.write_attribute(m_lagged_dt_name, "long_name",
+                             "length of the Lingle-Clark update computed in the background");
+      output.write_attribute(m_lagged_dt_name, "units", "seconds");
+    }
+  }
+
   if (not output.find_variable(m_time_name)) {
     output.define_variable(m_time_name, PISM_DOUBLE, {});
 
@@ -426,6 +635,13 @@ void LingleClark::write_model_state_impl(const File &output) const {
   m_elastic_displacement.write(output);
 
   output.write_variable(m_time_name, {0}, {1}, &m_t_last);
+
+  if (m_asynchronous) {
+    double dt = m_step_in_progress ? m_lagged_dt : 0.0;
+
+    m_lagged_load_thickness.write(output);
+    output.write_variable(m_lagged_dt_name, {0}, {1}, &dt);
+  }
 }
 
 DiagnosticList LingleClark::diagnostics_impl() const {
@@ -28,8 +28,13 @@ namespace pism {
 namespace bed {
 
 class LingleClarkSerial;
+class LingleClarkParallel;
 
-//! A wrapper class around LingleClarkSerial.
+//! A wrapper class around LingleClarkSerial and LingleClarkParallel.
+/*!
+ * Uses LingleClarkParallel (FFTW's MPI interface) if `bed_deformation.model` is set to
+ * `lc_mpi` and LingleClarkSerial (on rank 0) otherwise.
+ */
 class LingleClark : public BedDef {
 public:
   LingleClark(IceGrid::ConstPtr g);
@@ -65,6 +70,11 @@ protected:
                    const IceModelVec2S &sea_level_elevation,
                    double t, double dt);
 
+  void bootstrap_serial(const IceModelVec2S &bed_uplift);
+  void step_serial(double dt);
+  void step_asynchronous(double dt);
+  void start_lagged_step();
+
   //! Total (viscous and elastic) bed displacement.
   IceModelVec2S m_total_displacement;
 
@@ -81,6 +91,11 @@ protected:
   //! Serial viscoelastic bed deformation model.
   std::unique_ptr<LingleClarkSerial> m_serial_model;
 
+  //! Distributed viscoelastic bed deformation model (used instead of m_serial_model if
+  //! set). This is a shared_ptr because LingleClarkParallel is not defined if PISM is
+  //! built without FFTW's MPI interface.
+  std::shared_ptr<LingleClarkParallel> m_parallel_model;
+
   //! extended grid for the viscous plate displacement
   IceGrid::Ptr m_extended_grid;
 
@@ -102,6 +117,23 @@ protected:
   double m_t_eps;
   //! Name of the variable used to store the last update time.
   std::string m_time_name;
+
+  //! If true, the serial model computes each update in the background, using the load
+  //! from the previous update.
+  bool m_asynchronous;
+  //! True if an update is being computed in the background.
+  bool m_step_in_progress;
+  //! Load thickness used by the update computed in the background (part of the model
+  //! state in the asynchronous mode).
+  IceModelVec2S m_lagged_load_thickness;
+  //! Length of the update computed in the background, in seconds.
+  double m_lagged_dt;
+  //! Name of the variable used to store m_lagged_dt.
+  std::string m_lagged_dt_name;
+  //! rank 0 storage for the load (asynchronous mode only)
+  petsc::Vec::Ptr m_load_thickness0;
+  //! ID of FFTW arrays of the serial model in the memory tracker
+  int m_fftw_memory_id;
 };
 
 } // end of namespace bed
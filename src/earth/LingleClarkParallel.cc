@@ -0,0 +1,517 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>                // sqrt
+#include <complex>
+#include <fftw3-mpi.h>
+#include <gsl/gsl_math.h>       // M_PI
+
+#include "matlablike.hh"
+#include "greens.hh"
+#include "lrm_cache.hh"
+#include "LingleClarkParallel.hh"
+
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/fftw_utilities.hh"
+#include "pism/util/fftw_mpi_utilities.hh"
+
+namespace pism {
+namespace bed {
+
+/*!
+ * @param[in] grid PISM's grid
+ * @param[in] extended_grid extended grid used by the viscous part of the model
+ * @param[in] include_elastic include elastic deformation component
+ */
+LingleClarkParallel::LingleClarkParallel(IceGrid::ConstPtr grid,
+                                         IceGrid::ConstPtr extended_grid,
+                                         bool include_elastic)
+  : m_grid(grid),
+    m_extended_grid(extended_grid),
+    m_viscous_displacement(extended_grid, "viscous_displacement", WITHOUT_GHOSTS),
+    m_elastic_displacement(grid, "elastic_displacement", WITHOUT_GHOSTS),
+    m_total_displacement(grid, "total_displacement", WITHOUT_GHOSTS),
+    m_log(grid->ctx()->log()) {
+
+  const Config &config = *grid->ctx()->config();
+
+  m_include_elastic = include_elastic;
+
+  if (include_elastic and config.get_number("bed_deformation.lc.grid_size_factor") < 2) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "bed_deformation.lc.elastic_model"
+                                  " requires bed_deformation.lc.grid_size_factor > 1");
+  }
+
+  // grid parameters
+  m_Mx = grid->Mx();
+  m_My = grid->My();
+  m_dx = grid->dx();
+  m_dy = grid->dy();
+  m_Nx = extended_grid->Mx();
+  m_Ny = extended_grid->My();
+
+  m_load_density   = config.get_number("constants.ice.density");
+  m_mantle_density = config.get_number("bed_deformation.mantle_density");
+  m_eta            = config.get_number("bed_deformation.mantle_viscosity");
+  m_D              = config.get_number("bed_deformation.lithosphere_flexural_rigidity");
+
+  m_standard_gravity = config.get_number("constants.standard_gravity");
+
+  m_lrm_cache_file = config.get_string("bed_deformation.lc.lrm_cache_file");
+
+  // derive more parameters
+  m_Lx        = 0.5 * (m_Nx - 1.0) * m_dx;
+  m_Ly        = 0.5 * (m_Ny - 1.0) * m_dy;
+  m_i0_offset = (m_Nx - m_Mx) / 2;
+  m_j0_offset = (m_Ny - m_My) / 2;
+
+  // FFTW's MPI interface: find the part of the extended grid owned by this rank and
+  // allocate storage. Note that fftw_mpi_init() may be called more than once.
+  fftw_mpi_init();
+
+  ptrdiff_t alloc_local = fftw_mpi_local_size_2d(m_Nx, m_Ny, m_grid->com,
+                                                 &m_n_rows, &m_row_start);
+
+  m_fftw_input  = fftw_alloc_complex(alloc_local);
+  m_fftw_output = fftw_alloc_complex(alloc_local);
+  m_loadhat     = fftw_alloc_complex(alloc_local);
+  m_lrm_hat     = fftw_alloc_complex(alloc_local);
+
+  clear_fftw_array(m_fftw_input, m_n_rows, m_Ny);
+  m_dft_forward = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                       m_grid->com, FFTW_FORWARD, FFTW_ESTIMATE);
+  m_dft_inverse = fftw_mpi_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
+                                       m_grid->com, FFTW_BACKWARD, FFTW_ESTIMATE);
+
+  // Vecs using the slab decomposition. Note that FFTW assigns rows to ranks in order, so
+  // the ownership range of this Vec is [m_row_start * m_Ny, (m_row_start + m_n_rows) * m_Ny).
+  {
+    PetscErrorCode ierr = 0;
+    ierr = VecCreateMPI(m_grid->com, m_n_rows * m_Ny, PETSC_DETERMINE, m_Uv.rawptr());
+    PISM_CHK(ierr, "VecCreateMPI");
+
+    ierr = VecDuplicate(m_Uv, m_work.rawptr());
+    PISM_CHK(ierr, "VecDuplicate");
+
+    ierr = DMDACreateNaturalVector(*m_total_displacement.dm(), m_natural.rawptr());
+    PISM_CHK(ierr, "DMDACreateNaturalVector");
+
+    ierr = DMDACreateNaturalVector(*m_viscous_displacement.dm(), m_extended_natural.rawptr());
+    PISM_CHK(ierr, "DMDACreateNaturalVector");
+  }
+
+  create_slab_scatter(m_natural, m_Uv, m_Mx, m_My, m_Ny, m_i0_offset, m_j0_offset,
+                      m_row_start, m_n_rows, m_center);
+  create_slab_scatter(m_natural, m_Uv, m_Mx, m_My, m_Ny, 0, 0,
+                      m_row_start, m_n_rows, m_corner);
+  create_slab_scatter(m_natural, m_Uv, m_Mx, m_My, m_Ny, m_Nx / 2, m_Ny / 2,
+                      m_row_start, m_n_rows, m_elastic);
+  create_slab_scatter(m_extended_natural, m_Uv, m_Nx, m_Ny, m_Ny, 0, 0,
+                      m_row_start, m_n_rows, m_full);
+
+  precompute_coefficients();
+}
+
+LingleClarkParallel::~LingleClarkParallel() {
+  fftw_destroy_plan(m_dft_forward);
+  fftw_destroy_plan(m_dft_inverse);
+  fftw_free(m_fftw_input);
+  fftw_free(m_fftw_output);
+  fftw_free(m_loadhat);
+  fftw_free(m_lrm_hat);
+}
+
+/*!
+ * Return total displacement.
+ */
+const IceModelVec2S& LingleClarkParallel::total_displacement() const {
+  return m_total_displacement;
+}
+
+/*!
+ * Return viscous plate displacement (on the extended grid).
+ */
+const IceModelVec2S& LingleClarkParallel::viscous_displacement() const {
+  return m_viscous_displacement;
+}
+
+/*!
+ * Return elastic plate displacement.
+ */
+const IceModelVec2S& LingleClarkParallel::elastic_displacement() const {
+  return m_elastic_displacement;
+}
+
+/*!
+ * Compute the rows of the load response matrix owned by this rank.
+ *
+ * Uses the symmetry of the LRM; see LingleClarkSerial::compute_load_response_matrix().
+ */
+void LingleClarkParallel::compute_load_response_matrix(fftw_complex *output) {
+
+  FFTWArray LRM(output, m_n_rows, m_Ny);
+
+  int Nx2 = m_Nx / 2;
+  int Ny2 = m_Ny / 2;
+
+  // one quadrant, computed using all processes
+  std::vector<double> response;
+  elastic_load_response(m_grid->com, m_dx, m_dy, Nx2, Ny2, response);
+
+  for (int r = 0; r < m_n_rows; ++r) {
+    int i = m_row_start + r;
+
+    // rows below Nx2 are mirror images of rows above it
+    const int p = i <= Nx2 ? Nx2 - i : i - Nx2;
+
+    for (int j = 0; j <= Ny2; ++j) {
+      const int q = Ny2 - j;
+
+      LRM(r, j) = response[p * (Ny2 + 1) + q];
+    }
+
+    for (int j = Ny2 + 1; j < m_Ny; ++j) {
+      LRM(r, j) = LRM(r, 2 * Ny2 - j);
+    }
+  }
+}
+
+/*!
+ * Compute the load response matrix on the extended grid.
+ *
+ * This method is used for testing only.
+ */
+void LingleClarkParallel::compute_load_response_matrix(IceModelVec2S &output) {
+  compute_load_response_matrix(m_fftw_input);
+  get_real_part_slab(m_fftw_input, 1.0, m_n_rows, m_Ny, m_work);
+  copy_from_slab(m_work, m_full, m_extended_natural, output);
+}
+
+/**
+ * Pre-compute coefficients used by the model.
+ */
+void LingleClarkParallel::precompute_coefficients() {
+
+  // Coefficients for Fourier spectral method Laplacian
+  m_cx = fftfreq(m_Nx, m_Lx / (m_Nx * M_PI));
+  m_cy = fftfreq(m_Ny, m_Ly / (m_Ny * M_PI));
+
+  if (m_include_elastic) {
+    bool cached = (not m_lrm_cache_file.empty() and
+                   read_lrm_spectrum(m_grid->com, m_lrm_cache_file,
+                                     m_Nx, m_Ny, m_dx, m_dy,
+                                     m_row_start, m_n_rows, m_lrm_hat));
+
+    if (cached) {
+      m_log->message(2, "     read the spherical elastic load response matrix from '%s'\n",
+                     m_lrm_cache_file.c_str());
+    } else {
+      m_log->message(2, "     computing spherical elastic load response matrix ...");
+      {
+        compute_load_response_matrix(m_fftw_input);
+        // Compute fft2(LRM) and save it in m_lrm_hat
+        fftw_execute(m_dft_forward);
+        copy_fftw_array(m_fftw_output, m_lrm_hat, m_n_rows, m_Ny);
+      }
+      m_log->message(2, " done\n");
+
+      if (not m_lrm_cache_file.empty()) {
+        write_lrm_spectrum(m_grid->com, m_lrm_cache_file,
+                           m_Nx, m_Ny, m_dx, m_dy,
+                           m_row_start, m_n_rows, m_lrm_hat);
+        m_log->message(2, "     saved the load response matrix to '%s'\n",
+                       m_lrm_cache_file.c_str());
+      }
+    }
+  }
+}
+
+/*!
+ * Solve the "uplift problem". See LingleClarkSerial::uplift_problem() for details.
+ *
+ * @param[in] load_thickness load thickness, meters
+ * @param[in] bed_uplift bed uplift, m/second
+ * @param[out] output viscous displacement (slab decomposition)
+ */
+void LingleClarkParallel::uplift_problem(const IceModelVec2S &load_thickness,
+                                         const IceModelVec2S &bed_uplift,
+                                         Vec output) {
+
+  // Compute fft2(-load_density * g * load_thickness)
+  {
+    copy_to_slab(load_thickness, m_center, m_natural, m_work);
+    set_real_part_slab(m_work, - m_load_density * m_standard_gravity,
+                       m_n_rows, m_Ny, m_fftw_input);
+    fftw_execute(m_dft_forward);
+    // Save fft2(-load_density * g * load_thickness) in loadhat.
+    copy_fftw_array(m_fftw_output, m_loadhat, m_n_rows, m_Ny);
+  }
+
+  // fft2(uplift)
+  {
+    copy_to_slab(bed_uplift, m_center, m_natural, m_work);
+    set_real_part_slab(m_work, 1.0, m_n_rows, m_Ny, m_fftw_input);
+    fftw_execute(m_dft_forward);
+  }
+
+  {
+    FFTWArray
+      u0_hat(m_fftw_input, m_n_rows, m_Ny),
+      load_hat(m_loadhat, m_n_rows, m_Ny),
+      uplift_hat(m_fftw_output, m_n_rows, m_Ny);
+
+    for (int r = 0; r < m_n_rows; r++) {
+      const double cx = m_cx[m_row_start + r];
+      for (int j = 0; j < m_Ny; j++) {
+        const double
+          C = cx*cx + m_cy[j]*m_cy[j],
+          A = - 2.0 * m_eta * sqrt(C),
+          B = m_mantle_density * m_standard_gravity + m_D * C * C;
+
+        u0_hat(r, j) = (load_hat(r, j) + A * uplift_hat(r, j)) / B;
+      }
+    }
+  }
+
+  fftw_execute(m_dft_inverse);
+  get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), output);
+
+  tweak(load_thickness, output, 0.0);
+}
+
+/*! Initialize using provided load thickness and the bed uplift rate.
+ *
+ * See LingleClarkSerial::bootstrap().
+ *
+ * @param[in] thickness load thickness, meters
+ * @param[in] uplift initial bed uplift on the PISM grid
+ */
+void LingleClarkParallel::bootstrap(const IceModelVec2S &thickness,
+                                    const IceModelVec2S &uplift) {
+
+  // compute viscous displacement
+  uplift_problem(thickness, uplift, m_Uv);
+
+  if (m_include_elastic) {
+    compute_elastic_response(thickness, m_elastic_displacement);
+  } else {
+    m_elastic_displacement.set(0.0);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Initialize using provided plate displacement.
+ *
+ * @param[in] viscous_displacement initial viscous plate displacement (meters) on the extended grid
+ * @param[in] elastic_displacement initial elastic plate displacement (meters) on the regular grid
+ */
+void LingleClarkParallel::init(const IceModelVec2S &viscous_displacement,
+                               const IceModelVec2S &elastic_displacement) {
+
+  copy_to_slab(viscous_displacement, m_full, m_extended_natural, m_Uv);
+
+  if (m_include_elastic) {
+    m_elastic_displacement.copy_from(elastic_displacement);
+  } else {
+    m_elastic_displacement.set(0.0);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Perform a time step. See LingleClarkSerial::step() for details.
+ *
+ * @param[in] dt time step length
+ * @param[in] H load thickness on the physical (Mx*My) grid
+ */
+void LingleClarkParallel::step(double dt, const IceModelVec2S &H) {
+
+  if (dt > 0.0) {
+    // Compute fft2(-load_density * g * dt * H)
+    {
+      copy_to_slab(H, m_center, m_natural, m_work);
+      set_real_part_slab(m_work, - m_load_density * m_standard_gravity * dt,
+                         m_n_rows, m_Ny, m_fftw_input);
+      fftw_execute(m_dft_forward);
+
+      // Save fft2(-load_density * g * H * dt) in loadhat.
+      copy_fftw_array(m_fftw_output, m_loadhat, m_n_rows, m_Ny);
+    }
+
+    // Compute fft2(u).
+    {
+      set_real_part_slab(m_Uv, 1.0, m_n_rows, m_Ny, m_fftw_input);
+      fftw_execute(m_dft_forward);
+    }
+
+    // frhs = right.*fft2(uun) + fft2(dt*sszz);
+    // uun1 = real(ifft2(frhs./left));
+    {
+      FFTWArray input(m_fftw_input, m_n_rows, m_Ny),
+        u_hat(m_fftw_output, m_n_rows, m_Ny), load_hat(m_loadhat, m_n_rows, m_Ny);
+      for (int r = 0; r < m_n_rows; r++) {
+        const double cx = m_cx[m_row_start + r];
+        for (int j = 0; j < m_Ny; j++) {
+          const double
+            C     = cx*cx + m_cy[j]*m_cy[j],
+            part1 = 2.0 * m_eta * sqrt(C),
+            part2 = (dt / 2.0) * (m_mantle_density * m_standard_gravity + m_D * C * C),
+            A = part1 - part2,
+            B = part1 + part2;
+
+          input(r, j) = (load_hat(r, j) + A * u_hat(r, j)) / B;
+        }
+      }
+    }
+
+    fftw_execute(m_dft_inverse);
+    get_real_part_slab(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_n_rows, m_Ny, m_Uv);
+
+    // Now tweak. (See the "correction" in section 5 of BuelerLingleBrown.)
+    //
+    // Here 1e16 approximates t = \infty.
+    tweak(H, m_Uv, 1e16);
+  } else {
+    // zero time step: viscous displacement is zero
+    PetscErrorCode ierr = VecSet(m_Uv, 0.0); PISM_CHK(ierr, "VecSet");
+  }
+
+  // now compute elastic response if desired
+  if (m_include_elastic) {
+    compute_elastic_response(H, m_elastic_displacement);
+  }
+
+  update_displacement();
+}
+
+/*!
+ * Compute elastic response to the load H
+ *
+ * @param[in] H load thickness (ice equivalent meters)
+ * @param[out] dE elastic plate displacement
+ */
+void LingleClarkParallel::compute_elastic_response(const IceModelVec2S &H, IceModelVec2S &dE) {
+
+  // Compute fft2(load_density * H)
+  //
+  // Note that here the load is placed in the corner of the array on the extended grid.
+  {
+    copy_to_slab(H, m_corner, m_natural, m_work);
+    set_real_part_slab(m_work, m_load_density, m_n_rows, m_Ny, m_fftw_input);
+    fftw_execute(m_dft_forward);
+  }
+
+  // fft2(m_response_matrix) * fft2(load_density*H)
+  {
+    FFTWArray
+      input(m_fftw_input, m_n_rows, m_Ny),
+      LRM_hat(m_lrm_hat, m_n_rows, m_Ny),
+      load_hat(m_fftw_output, m_n_rows, m_Ny);
+    for (int r = 0; r < m_n_rows; r++) {
+      for (int j = 0; j < m_Ny; j++) {
+        input(r, j) = LRM_hat(r, j) * load_hat(r, j);
+      }
+    }
+  }
+
+  // Compute the inverse transform and extract the elastic response starting at
+  // (m_Nx / 2, m_Ny / 2).
+  fftw_execute(m_dft_inverse);
+  get_real_part_slab(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_n_rows, m_Ny, m_work);
+  copy_from_slab(m_work, m_elastic, m_natural, dE);
+}
+
+/*!
+ * Compute total displacement by combining viscous and elastic contributions.
+ *
+ * Also copies the viscous displacement to PISM's domain decomposition.
+ */
+void LingleClarkParallel::update_displacement() {
+  copy_from_slab(m_Uv, m_full, m_extended_natural, m_viscous_displacement);
+
+  copy_from_slab(m_Uv, m_center, m_natural, m_total_displacement);
+  m_total_displacement.add(1.0, m_elastic_displacement);
+}
+
+/*!
+ * Modify the plate displacement to correct for the effect of imposing periodic boundary
+ * conditions at a finite distance.
+ *
+ * See LingleClarkSerial::tweak().
+ *
+ * @param[in] load_thickness thickness of the load (used to compute the corresponding disc volume)
+ * @param[in,out] U viscous plate displacement (slab decomposition)
+ * @param[in] time time, seconds (usually 0 or a large number approximating \infty)
+ */
+void LingleClarkParallel::tweak(const IceModelVec2S &load_thickness, Vec U, double time) {
+  PetscErrorCode ierr = 0;
+
+  // find average value along "distant" boundary of [-Lx, Lx]X[-Ly, Ly]
+  double average = 0.0;
+  {
+    petsc::VecArray U_array(U);
+    const double *u = U_array.get();
+
+    // contributions from u(i, 0)
+    for (int r = 0; r < m_n_rows; r++) {
+      average += u[r * m_Ny + 0];
+    }
+
+    // contributions from u(0, j)
+    if (m_row_start == 0 and m_n_rows > 0) {
+      for (int j = 0; j < m_Ny; j++) {
+        average += u[j];
+      }
+    }
+  }
+
+  average = GlobalSum(m_grid->com, average) / (double) (m_Nx + m_Ny);
+
+  double shift = 0.0;
+
+  if (time > 0.0) {
+    const double L_average = (m_Lx + m_Ly) / 2.0;
+    const double R         = L_average * (2.0 / 3.0);
+
+    const double H_sum = load_thickness.sum();
+
+    // compute disc thickness by dividing its volume by the area
+    const double H = (H_sum * m_dx * m_dy) / (M_PI * R * R);
+
+    shift = viscDisc(time,               // time in seconds
+                     H,                  // disc thickness
+                     R,                  // disc radius
+                     L_average,          // compute deflection at this radius
+                     m_mantle_density, m_load_density,    // mantle and load densities
+                     m_standard_gravity, //
+                     m_D,                // flexural rigidity
+                     m_eta);             // mantle viscosity
+  }
+
+  ierr = VecShift(U, shift - average); PISM_CHK(ierr, "VecShift");
+}
+
+} // end of namespace bed
+} // end of namespace pism
@@ -0,0 +1,169 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LINGLECLARKPARALLEL_H
+#define LINGLECLARKPARALLEL_H
+
+#include <vector>
+#include <string>
+#include <cstddef>              // ptrdiff_t
+
+#include <fftw3.h>
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/petscwrappers/VecScatter.hh"
+#include "pism/util/Logger.hh"
+
+namespace pism {
+namespace bed {
+
+//! Distributed-memory implementation of the model in LingleClarkSerial.
+/*!
+ * This class implements the same numerical method as LingleClarkSerial, but uses FFTW's
+ * MPI interface instead of gathering the load on rank 0.
+ *
+ * The extended (spectral) grid is split into slabs: each rank owns a contiguous range of
+ * rows in the X direction (the "slow" index of FFTWArray) and *all* grid points in the Y
+ * direction. Data are moved between PISM's 2D domain decomposition and this slab
+ * decomposition using VecScatters created once in the constructor.
+ *
+ * Results agree with LingleClarkSerial within round-off.
+ */
+class LingleClarkParallel {
+public:
+  LingleClarkParallel(IceGrid::ConstPtr grid,
+                      IceGrid::ConstPtr extended_grid,
+                      bool include_elastic);
+  ~LingleClarkParallel();
+
+  void init(const IceModelVec2S &viscous_displacement,
+            const IceModelVec2S &elastic_displacement);
+
+  void bootstrap(const IceModelVec2S &thickness, const IceModelVec2S &uplift);
+
+  void step(double dt_seconds, const IceModelVec2S &H);
+
+  const IceModelVec2S& total_displacement() const;
+
+  const IceModelVec2S& viscous_displacement() const;
+
+  const IceModelVec2S& elastic_displacement() const;
+
+  void compute_load_response_matrix(IceModelVec2S &output);
+private:
+  void compute_elastic_response(const IceModelVec2S &H, IceModelVec2S &dE);
+
+  void uplift_problem(const IceModelVec2S &load_thickness,
+                      const IceModelVec2S &bed_uplift,
+                      Vec output);
+
+  void compute_load_response_matrix(fftw_complex *output);
+
+  void precompute_coefficients();
+
+  void update_displacement();
+
+  void tweak(const IceModelVec2S &load_thickness, Vec U, double time);
+
+  IceGrid::ConstPtr m_grid;
+  IceGrid::ConstPtr m_extended_grid;
+
+  bool m_include_elastic;
+  // grid size
+  int m_Mx;
+  int m_My;
+  // grid spacing
+  double m_dx;
+  double m_dy;
+  //! load density (for computing load from its thickness)
+  double m_load_density;
+  //! mantle density
+  double m_mantle_density;
+  //! mantle viscosity
+  double m_eta;
+  //! lithosphere flexural rigidity
+  double m_D;
+
+  // acceleration due to gravity
+  double m_standard_gravity;
+
+  // size of the extended grid
+  int m_Nx;
+  int m_Ny;
+
+  // indices into extended grid for the corner of the physical grid
+  int m_i0_offset;
+  int m_j0_offset;
+
+  // half-lengths of the extended (FFT, spectral) computational domain
+  double m_Lx;
+  double m_Ly;
+
+  // the range of rows of the extended grid owned by this rank
+  ptrdiff_t m_row_start;
+  ptrdiff_t m_n_rows;
+
+  // Coefficients of derivatives in Fourier space
+  std::vector<double> m_cx, m_cy;
+
+  //! viscous displacement on the extended grid (slab decomposition)
+  petsc::Vec m_Uv;
+  //! a work vector using the slab decomposition
+  petsc::Vec m_work;
+
+  //! work vectors using the natural ordering on the PISM grid and on the extended grid
+  petsc::Vec m_natural;
+  petsc::Vec m_extended_natural;
+
+  //! scatter from the PISM grid to the center of the extended grid
+  petsc::VecScatter m_center;
+  //! scatter from the PISM grid to the corner of the extended grid
+  petsc::VecScatter m_corner;
+  //! scatter from the PISM grid to the part of the extended grid starting at (Nx/2, Ny/2)
+  petsc::VecScatter m_elastic;
+  //! scatter from the extended grid to the extended grid
+  petsc::VecScatter m_full;
+
+  //! viscous displacement on the extended grid (PISM's domain decomposition)
+  IceModelVec2S m_viscous_displacement;
+  //! elastic plate displacement
+  IceModelVec2S m_elastic_displacement;
+  //! total (viscous and elastic) plate displacement
+  IceModelVec2S m_total_displacement;
+
+  fftw_complex *m_fftw_input;
+  fftw_complex *m_fftw_output;
+  fftw_complex *m_loadhat;
+  fftw_complex *m_lrm_hat;
+
+  //! name of the file used to cache m_lrm_hat (empty if disabled)
+  std::string m_lrm_cache_file;
+
+  fftw_plan m_dft_forward;
+  fftw_plan m_dft_inverse;
+
+  Logger::ConstPtr m_log;
+};
+
+} // end of namespace bed
+} // end of namespace pism
+
+#endif /* LINGLECLARKPARALLEL_H */
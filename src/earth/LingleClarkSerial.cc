@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2009, 2011, 2013, 2014, 2015, 2016, 2017, 2018, 2019 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2009, 2011, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -23,6 +23,7 @@
 
 #include "matlablike.hh"
 #include "greens.hh"
+#include "lrm_cache.hh"
 #include "LingleClarkSerial.hh"
 
 #include "pism/util/pism_utilities.hh"
@@ -43,14 +44,22 @@ namespace bed {
  * @param[in] dy grid spacing in the Y direction
  * @param[in] Nx extended grid size in the X direction
  * @param[in] Ny extended grid size in the Y direction
+ * @param[in] elastic_response one quadrant of the elastic load response matrix computed
+ *                             using elastic_load_response() (computed here if empty and
+ *                             needed)
  */
 LingleClarkSerial::LingleClarkSerial(Logger::ConstPtr log,
                                      const Config &config,
                                      bool include_elastic,
                                      int Mx, int My,
                                      double dx, double dy,
-                                     int Nx, int Ny)
-  : m_log(log) {
+                                     int Nx, int Ny,
+                                     const std::vector<double> &elastic_response)
+  : m_H_array(nullptr),
+    m_Uv_array(nullptr),
+    m_Ue_array(nullptr),
+    m_U_array(nullptr),
+    m_log(log) {
 
   // set parameters
   m_include_elastic = include_elastic;
@@ -82,6 +91,10 @@ LingleClarkSerial::LingleClarkSerial(Logger::ConstPtr log,
 
   m_standard_gravity = config.get_number("constants.standard_gravity");
 
+  m_lrm_cache_file = config.get_string("bed_deformation.lc.lrm_cache_file");
+
+  m_elastic_response = elastic_response;
+
   // derive more parameters
   m_Lx        = 0.5 * (m_Nx - 1.0) * m_dx;
   m_Ly        = 0.5 * (m_Ny - 1.0) * m_dy;
@@ -103,12 +116,17 @@ LingleClarkSerial::LingleClarkSerial(Logger::ConstPtr log,
   ierr = VecCreateSeq(PETSC_COMM_SELF, m_Nx * m_Ny, m_Uv.rawptr());
   PISM_CHK(ierr, "VecCreateSeq");
 
+  // copy of the load thickness used by step_begin()
+  ierr = VecCreateSeq(PETSC_COMM_SELF, m_Mx * m_My, m_H.rawptr());
+  PISM_CHK(ierr, "VecCreateSeq");
+
   // setup fftw stuff: FFTW builds "plans" based on observed performance
   m_fftw_input  = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
   m_fftw_output = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
   m_loadhat     = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
   m_lrm_hat = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * m_Nx * m_Ny);
 
+  fftw_use_threads(config.get_number("fftw.threads"));
   clear_fftw_array(m_fftw_input, m_Nx, m_Ny);
   m_dft_forward = fftw_plan_dft_2d(m_Nx, m_Ny, m_fftw_input, m_fftw_output,
                                    FFTW_FORWARD, FFTW_ESTIMATE);
@@ -126,6 +144,17 @@ LingleClarkSerial::LingleClarkSerial(Logger::ConstPtr log,
 }
 
 LingleClarkSerial::~LingleClarkSerial() {
+  if (m_thread.joinable()) {
+    // finish the step in progress and restore arrays obtained in step_begin() (errors
+    // thrown by the step are ignored: we are shutting down)
+    m_thread.join();
+
+    PetscErrorCode ierr = 0;
+    ierr = VecRestoreArray(m_H, &m_H_array); CHKERRCONTINUE(ierr);
+    ierr = VecRestoreArray(m_Uv, &m_Uv_array); CHKERRCONTINUE(ierr);
+    ierr = VecRestoreArray(m_Ue, &m_Ue_array); CHKERRCONTINUE(ierr);
+    ierr = VecRestoreArray(m_U, &m_U_array); CHKERRCONTINUE(ierr);
+  }
   fftw_destroy_plan(m_dft_forward);
   fftw_destroy_plan(m_dft_inverse);
   fftw_free(m_fftw_input);
@@ -159,23 +188,21 @@ void LingleClarkSerial::compute_load_response_matrix(fftw_complex *output) {
 
   FFTWArray LRM(output, m_Nx, m_Ny);
 
-  greens_elastic G;
-  ge_data ge_data {m_dx, m_dy, 0, 0, &G};
-
   int Nx2 = m_Nx / 2;
   int Ny2 = m_Ny / 2;
 
+  if (m_elastic_response.empty()) {
+    // this model runs on one process
+    elastic_load_response(PETSC_COMM_SELF, m_dx, m_dy, Nx2, Ny2, m_elastic_response);
+  }
+
   // Top half
   for (int j = 0; j <= Ny2; ++j) {
     // Top left quarter
     for (int i = 0; i <= Nx2; ++i) {
-      ge_data.p = Nx2 - i;
-      ge_data.q = Ny2 - j;
+      const int p = Nx2 - i, q = Ny2 - j;
 
-      LRM(i, j) = dblquad_cubature(ge_integrand,
-                                   -m_dx / 2, m_dx / 2,
-                                   -m_dy / 2, m_dy / 2,
-                                   1.0e-8, &ge_data);
+      LRM(i, j) = m_elastic_response[p * (Ny2 + 1) + q];
     }
 
     // Top right quarter
@@ -224,14 +251,32 @@ void LingleClarkSerial::precompute_coefficients() {
 
   // compare geforconv.m
   if (m_include_elastic) {
-    m_log->message(2, "     computing spherical elastic load response matrix ...");
-    {
-      compute_load_response_matrix(m_fftw_input);
-      // Compute fft2(LRM) and save it in m_lrm_hat
-      fftw_execute(m_dft_forward);
-      copy_fftw_array(m_fftw_output, m_lrm_hat, m_Nx, m_Ny);
+    bool cached = (not m_lrm_cache_file.empty() and
+                   read_lrm_spectrum(PETSC_COMM_SELF, m_lrm_cache_file,
+                                     m_Nx, m_Ny, m_dx, m_dy,
+                                     0, m_Nx, m_lrm_hat));
+
+    if (cached) {
+      m_log->message(2, "     read the spherical elastic load response matrix from '%s'\n",
+                     m_lrm_cache_file.c_str());
+    } else {
+      m_log->message(2, "     computing spherical elastic load response matrix ...");
+      {
+        compute_load_response_matrix(m_fftw_input);
+        // Compute fft2(LRM) and save it in m_lrm_hat
+        fftw_execute(m_dft_forward);
+        copy_fftw_array(m_fftw_output, m_lrm_hat, m_Nx, m_Ny);
+      }
+      m_log->message(2, " done\n");
+
+      if (not m_lrm_cache_file.empty()) {
+        write_lrm_spectrum(PETSC_COMM_SELF, m_lrm_cache_file,
+                           m_Nx, m_Ny, m_dx, m_dy,
+                           0, m_Nx, m_lrm_hat);
+        m_log->message(2, "     saved the load response matrix to '%s'\n",
+                       m_lrm_cache_file.c_str());
+      }
     }
-    m_log->message(2, " done\n");
   }
 }
 
@@ -249,8 +294,9 @@ void LingleClarkSerial::precompute_coefficients() {
  * @f$ \diff{u}{t} @f$ itself.
  *
  */
-void LingleClarkSerial::uplift_problem(Vec load_thickness, Vec bed_uplift,
-                                       Vec output) {
+void LingleClarkSerial::uplift_problem(const double *load_thickness,
+                                       const double *bed_uplift,
+                                       double *output) {
 
   // Compute fft2(-load_density * g * load_thickness)
   {
@@ -315,17 +361,24 @@ void LingleClarkSerial::uplift_problem(Vec load_thickness, Vec bed_uplift,
  * Sets m_Uv, m_Ue, m_U.
  */
 void LingleClarkSerial::bootstrap(Vec thickness, Vec uplift) {
+  {
+    petsc::VecArray H(thickness), dbdt(uplift), Uv(m_Uv);
 
-  // compute viscous displacement
-  uplift_problem(thickness, uplift, m_Uv);
+    // compute viscous displacement
+    uplift_problem(H.get(), dbdt.get(), Uv.get());
 
-  if (m_include_elastic) {
-    compute_elastic_response(thickness, m_Ue);
-  } else {
+    if (m_include_elastic) {
+      petsc::VecArray Ue(m_Ue);
+      compute_elastic_response(H.get(), Ue.get());
+    }
+  }
+
+  if (not m_include_elastic) {
     PetscErrorCode ierr = VecSet(m_Ue, 0.0); PISM_CHK(ierr, "VecSet");
   }
 
-  update_displacement(m_Uv, m_Ue, m_U);
+  petsc::VecArray Uv(m_Uv), Ue(m_Ue), U(m_U);
+  update_displacement(Uv.get(), Ue.get(), U.get());
 }
 
 /*!
@@ -348,7 +401,8 @@ void LingleClarkSerial::init(Vec viscous_displacement,
     ierr = VecSet(m_Ue, 0.0); PISM_CHK(ierr, "VecSet");
   }
 
-  update_displacement(m_Uv, m_Ue, m_U);
+  petsc::VecArray Uv(m_Uv), Ue(m_Ue), U(m_U);
+  update_displacement(Uv.get(), Ue.get(), U.get());
 }
 
 /*!
@@ -358,6 +412,97 @@ void LingleClarkSerial::init(Vec viscous_displacement,
  * @param[in] H load thickness on the physical (Mx*My) grid
  */
 void LingleClarkSerial::step(double dt, Vec H) {
+  if (step_in_progress()) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "cannot perform a bed deformation step: the previous one is in progress");
+  }
+
+  petsc::VecArray H_array(H), Uv(m_Uv), Ue(m_Ue), U(m_U);
+
+  step(dt, H_array.get(), Uv.get(), Ue.get(), U.get());
+}
+
+/*!
+ * Start a time step in a separate thread and return immediately.
+ *
+ * The load thickness `H` is copied, so the caller may re-use it. Call step_end() to wait
+ * for the step to finish. Until then total_displacement(), viscous_displacement(), and
+ * elastic_displacement() must not be used.
+ *
+ * The step itself does not use PETSc, so this is safe even if PETSc is not thread-safe.
+ *
+ * @param[in] dt time step length
+ * @param[in] H load thickness on the physical (Mx*My) grid
+ */
+void LingleClarkSerial::step_begin(double dt, Vec H) {
+  PetscErrorCode ierr = 0;
+
+  if (step_in_progress()) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "cannot start a bed deformation step: the previous one is in progress");
+  }
+
+  ierr = VecCopy(H, m_H); PISM_CHK(ierr, "VecCopy");
+
+  // Get pointers to arrays here, in the main thread, so that the thread running
+  // in the background does not have to call PETSc.
+  ierr = VecGetArray(m_H, &m_H_array); PISM_CHK(ierr, "VecGetArray");
+  ierr = VecGetArray(m_Uv, &m_Uv_array); PISM_CHK(ierr, "VecGetArray");
+  ierr = VecGetArray(m_Ue, &m_Ue_array); PISM_CHK(ierr, "VecGetArray");
+  ierr = VecGetArray(m_U, &m_U_array); PISM_CHK(ierr, "VecGetArray");
+
+  m_thread_error = nullptr;
+  m_thread = std::thread([this, dt]() {
+      try {
+        this->step(dt, m_H_array, m_Uv_array, m_Ue_array, m_U_array);
+      } catch (...) {
+        m_thread_error = std::current_exception();
+      }
+    });
+}
+
+/*!
+ * Wait for the step started by step_begin() to finish.
+ *
+ * Re-throws the exception thrown by the step (if any).
+ */
+void LingleClarkSerial::step_end() {
+  PetscErrorCode ierr = 0;
+
+  if (not step_in_progress()) {
+    return;
+  }
+
+  m_thread.join();
+
+  ierr = VecRestoreArray(m_H, &m_H_array); PISM_CHK(ierr, "VecRestoreArray");
+  ierr = VecRestoreArray(m_Uv, &m_Uv_array); PISM_CHK(ierr, "VecRestoreArray");
+  ierr = VecRestoreArray(m_Ue, &m_Ue_array); PISM_CHK(ierr, "VecRestoreArray");
+  ierr = VecRestoreArray(m_U, &m_U_array); PISM_CHK(ierr, "VecRestoreArray");
+
+  if (m_thread_error) {
+    std::rethrow_exception(m_thread_error);
+  }
+}
+
+//! Return `true` if a step started by step_begin() has not been finished by step_end().
+bool LingleClarkSerial::step_in_progress() const {
+  return m_thread.joinable();
+}
+
+/*!
+ * Perform a time step (implementation).
+ *
+ * Does not call PETSc; see step_begin().
+ *
+ * @param[in] dt time step length
+ * @param[in] H load thickness on the physical (Mx*My) grid
+ * @param[in,out] Uv viscous displacement on the extended grid
+ * @param[in,out] Ue elastic displacement
+ * @param[out] U total displacement
+ */
+void LingleClarkSerial::step(double dt, const double *H,
+                             double *Uv, double *Ue, double *U) {
   // solves:
   //     (2 eta |grad| U^{n+1}) + (dt/2) * (rho_r g U^{n+1} + D grad^4 U^{n+1})
   //   = (2 eta |grad| U^n) - (dt/2) * (rho_r g U^n + D grad^4 U^n) - dt * rho g H_start
@@ -387,7 +532,7 @@ void LingleClarkSerial::step(double dt, Vec H) {
     // Compute fft2(u).
     // no need to clear fftw_input: all values are overwritten
     {
-      set_real_part(m_Uv, 1.0, m_Nx, m_Ny, m_Nx, m_Ny, 0, 0, m_fftw_input);
+      set_real_part(Uv, 1.0, m_Nx, m_Ny, m_Nx, m_Ny, 0, 0, m_fftw_input);
       fftw_execute(m_dft_forward);
     }
 
@@ -411,23 +556,25 @@ void LingleClarkSerial::step(double dt, Vec H) {
     }
 
     fftw_execute(m_dft_inverse);
-    get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_Nx, m_Ny, m_Nx, m_Ny, 0, 0, m_Uv);
+    get_real_part(m_fftw_output, 1.0 / (m_Nx * m_Ny), m_Nx, m_Ny, m_Nx, m_Ny, 0, 0, Uv);
 
     // Now tweak. (See the "correction" in section 5 of BuelerLingleBrown.)
     //
     // Here 1e16 approximates t = \infty.
-    tweak(H, m_Uv, m_Nx, m_Ny, 1e16);
+    tweak(H, Uv, m_Nx, m_Ny, 1e16);
   } else {
     // zero time step: viscous displacement is zero
-    PetscErrorCode ierr = VecSet(m_Uv, 0.0); PISM_CHK(ierr, "VecSet");
+    for (int k = 0; k < m_Nx * m_Ny; ++k) {
+      Uv[k] = 0.0;
+    }
   }
 
   // now compute elastic response if desired
   if (m_include_elastic) {
-    compute_elastic_response(H, m_Ue);
+    compute_elastic_response(H, Ue);
   }
 
-  update_displacement(m_Uv, m_Ue, m_U);
+  update_displacement(Uv, Ue, U);
 }
 
 /*!
@@ -436,7 +583,7 @@ void LingleClarkSerial::step(double dt, Vec H) {
  * @param[in] H load thickness (ice equivalent meters)
  * @param[out] dE elastic plate displacement
  */
-void LingleClarkSerial::compute_elastic_response(Vec H, Vec dE) {
+void LingleClarkSerial::compute_elastic_response(const double *H, double *dE) {
 
   // Compute fft2(load_density * H)
   //
@@ -480,18 +627,13 @@ void LingleClarkSerial::compute_elastic_response(Vec H, Vec dE) {
  * @param[in] dE elastic displacement
  * @param[out] dU total displacement
  */
-void LingleClarkSerial::update_displacement(Vec Uv, Vec Ue, Vec U) {
-  // PISM grid
-  petsc::VecArray2D
-    u(U, m_Mx, m_My),
-    u_elastic(Ue, m_Mx, m_My);
-  // extended grid
-  petsc::VecArray2D
-    u_viscous(Uv, m_Nx, m_Ny, m_i0_offset, m_j0_offset);
-
+void LingleClarkSerial::update_displacement(const double *Uv, const double *Ue, double *U) {
   for (int i = 0; i < m_Mx; i++) {
     for (int j = 0; j < m_My; j++) {
-      u(i, j) = u_viscous(i, j) + u_elastic(i, j);
+      // Uv is defined on the extended grid
+      double u_viscous = Uv[(j + m_j0_offset) * m_Nx + (i + m_i0_offset)];
+
+      U[j * m_Mx + i] = u_viscous + Ue[j * m_Mx + i];
     }
   }
 }
@@ -509,9 +651,10 @@ void LingleClarkSerial::update_displacement(Vec Uv, Vec Ue, Vec U) {
  * @param[in] Ny grid size
  * @param[in] time time, seconds (usually 0 or a large number approximating \infty)
  */
-void LingleClarkSerial::tweak(Vec load_thickness, Vec U, int Nx, int Ny, double time) {
-  PetscErrorCode ierr = 0;
-  petsc::VecArray2D u(U, Nx, Ny);
+void LingleClarkSerial::tweak(const double *load_thickness, double *U,
+                              int Nx, int Ny, double time) {
+  // U(i, j)
+  auto u = [U, Nx](int i, int j) { return U[j * Nx + i]; };
 
   // find average value along "distant" boundary of [-Lx, Lx]X[-Ly, Ly]
   // note domain is periodic, so think of cut locus of torus (!)
@@ -537,7 +680,9 @@ void LingleClarkSerial::tweak(Vec load_thickness, Vec U, int Nx, int Ny, double
     const double R         = L_average * (2.0 / 3.0);
 
     double H_sum = 0.0;
-    ierr = VecSum(load_thickness, &H_sum); PISM_CHK(ierr, "VecSum");
+    for (int k = 0; k < m_Mx * m_My; ++k) {
+      H_sum += load_thickness[k];
+    }
 
     // compute disc thickness by dividing its volume by the area
     const double H = (H_sum * m_dx * m_dy) / (M_PI * R * R);
@@ -552,7 +697,9 @@ void LingleClarkSerial::tweak(Vec load_thickness, Vec U, int Nx, int Ny, double
                      m_eta);             // mantle viscosity
   }
 
-  ierr = VecShift(U, shift - average); PISM_CHK(ierr, "VecShift");
+  for (int k = 0; k < Nx * Ny; ++k) {
+    U[k] += shift - average;
+  }
 }
 
 } // end of namespace bed
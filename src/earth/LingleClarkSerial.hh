@@ -1,4 +1,4 @@
-// Copyright (C) 2007--2009, 2011, 2012, 2013, 2014, 2015, 2017, 2018, 2019 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2007--2009, 2011, 2012, 2013, 2014, 2015, 2017, 2018, 2019, 2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -20,10 +20,12 @@
 #define LINGLECLARKSERIAL_H
 
 #include <vector>
+#include <string>
+#include <thread>
+#include <exception>
 
 #include <petscvec.h>
 #include <fftw3.h>
-#include <vector>
 
 #include "pism/util/petscwrappers/Vec.hh"
 #include "pism/util/Logger.hh"
@@ -61,7 +63,8 @@ public:
                     bool include_elastic,
                     int Mx, int My,
                     double dx, double dy,
-                    int Nx, int Ny);
+                    int Nx, int Ny,
+                    const std::vector<double> &elastic_response = {});
   ~LingleClarkSerial();
 
   void init(Vec viscous_displacement,
@@ -71,6 +74,10 @@ public:
 
   void step(double dt_seconds, Vec H);
 
+  void step_begin(double dt_seconds, Vec H);
+  void step_end();
+  bool step_in_progress() const;
+
   Vec total_displacement() const;
 
   Vec viscous_displacement() const;
@@ -79,13 +86,16 @@ public:
 
   void compute_load_response_matrix(fftw_complex *output);
 private:
-  void compute_elastic_response(Vec H, Vec dE);
+  void step(double dt_seconds, const double *H, double *Uv, double *Ue, double *U);
+
+  void compute_elastic_response(const double *H, double *dE);
 
-  void uplift_problem(Vec load_thickness, Vec bed_uplift, Vec output);
+  void uplift_problem(const double *load_thickness, const double *bed_uplift,
+                      double *output);
 
   void precompute_coefficients();
 
-  void update_displacement(Vec V, Vec dE, Vec dU);
+  void update_displacement(const double *Uv, const double *Ue, double *U);
 
   bool m_include_elastic;
   // grid size
@@ -135,10 +145,26 @@ private:
   fftw_complex *m_loadhat;
   fftw_complex *m_lrm_hat;
 
+  //! name of the file used to cache m_lrm_hat (empty if disabled)
+  std::string m_lrm_cache_file;
+
+  //! one quadrant of the elastic load response matrix (see elastic_load_response(); empty
+  //! if not computed yet)
+  std::vector<double> m_elastic_response;
+
   fftw_plan m_dft_forward;
   fftw_plan m_dft_inverse;
 
-  void tweak(Vec load_thickness, Vec U, int Nx, int Ny, double time);
+  void tweak(const double *load_thickness, double *U, int Nx, int Ny, double time);
+
+  //! copy of the load used by a step running in the background
+  petsc::Vec m_H;
+  //! the thread performing a step in the background (see step_begin())
+  std::thread m_thread;
+  //! an exception thrown by m_thread (if any)
+  std::exception_ptr m_thread_error;
+  //! arrays of m_H, m_Uv, m_Ue, m_U used by m_thread
+  double *m_H_array, *m_Uv_array, *m_Ue_array, *m_U_array;
 
   Logger::ConstPtr m_log;
 };
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2007, 2015, 2017, 2018, 2019 Jed Brown and Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2007, 2015, 2017, 2018, 2019, 2020 Jed Brown and Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -23,6 +23,8 @@
 #include <gsl/gsl_integration.h>
 
 #include "greens.hh"
+#include "matlablike.hh"        // dblquad_cubature
+#include "pism/util/error_handling.hh"
 
 namespace pism {
 namespace bed {
@@ -48,6 +50,70 @@ double ge_integrand(unsigned ndim, const double* args, void* data) {
   return G(r);
 }
 
+/*!
+ * Compute the elastic load response of a unit load on a `dx` by `dy` cell at offsets
+ * `(p * dx, q * dy)`, `0 <= p <= P`, `0 <= q <= Q` (one quadrant of the load response
+ * matrix).
+ *
+ * Integrals are independent, so they are distributed (cyclically, to balance the load)
+ * among all processes in `com`. If `dx == dy` the response is symmetric with respect to
+ * swapping `p` and `q`, so only one octant is computed.
+ *
+ * The result (`result[p * (Q + 1) + q]`) is available on all processes.
+ */
+void elastic_load_response(MPI_Comm com, double dx, double dy, int P, int Q,
+                           std::vector<double> &result) {
+  int rank = 0, size = 1;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  const bool symmetric = (dx == dy);
+
+  // true if (p, q) is the mirror image of a cell that is computed
+  auto mirrored = [=](int p, int q) {
+    return symmetric and q > p and q <= P and p <= Q;
+  };
+
+  greens_elastic G;
+  ge_data data{dx, dy, 0, 0, &G};
+
+  std::vector<double> response((P + 1) * (Q + 1), 0.0);
+
+  int n = 0;
+  for (int p = 0; p <= P; ++p) {
+    for (int q = 0; q <= Q; ++q) {
+      if (mirrored(p, q)) {
+        continue;
+      }
+
+      if (n % size == rank) {
+        data.p = p;
+        data.q = q;
+        response[p * (Q + 1) + q] = dblquad_cubature(ge_integrand,
+                                                     -dx / 2, dx / 2,
+                                                     -dy / 2, dy / 2,
+                                                     1.0e-8, &data);
+      }
+      ++n;
+    }
+  }
+
+  result.resize(response.size());
+  int ierr = MPI_Allreduce(response.data(), result.data(), response.size(),
+                           MPI_DOUBLE, MPI_SUM, com);
+  if (ierr != MPI_SUCCESS) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "failed to collect the elastic load response");
+  }
+
+  for (int p = 0; p <= P; ++p) {
+    for (int q = 0; q <= Q; ++q) {
+      if (mirrored(p, q)) {
+        result[p * (Q + 1) + q] = result[q * (Q + 1) + p];
+      }
+    }
+  }
+}
+
 greens_elastic::greens_elastic() {
   acc = gsl_interp_accel_alloc();
   spline = gsl_spline_alloc(gsl_interp_linear, N);
@@ -1,4 +1,4 @@
-// Copyright (C) 2007--2009, 2014, 2015, 2017, 2019 Ed Bueler
+// Copyright (C) 2007--2009, 2014, 2015, 2017, 2019, 2020 Ed Bueler
 //
 // This file is part of PISM.
 //
@@ -19,6 +19,8 @@
 #ifndef __greens_hh
 #define __greens_hh
 
+#include <vector>
+#include <mpi.h>
 #include <gsl/gsl_spline.h>
 
 namespace pism {
@@ -58,6 +60,9 @@ struct ge_data {
   greens_elastic *G;
 };
 
+void elastic_load_response(MPI_Comm com, double dx, double dy, int P, int Q,
+                           std::vector<double> &result);
+
 //! @brief Actually compute the response of the viscous half-space
 //! model in \ref LingleClark, to a disc load.
 double viscDisc(double t, double H0, double R0, double r,
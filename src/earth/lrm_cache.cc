@@ -0,0 +1,148 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstdio>               // std::rename
+#include <unistd.h>             // getpid
+
+#include "lrm_cache.hh"
+
+#include "pism/util/io/File.hh"
+#include "pism/util/io/io_helpers.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+namespace bed {
+
+static const char *lrm_variable = "lrm_hat";
+
+/*!
+ * The spectrum is stored using the memory layout of `fftw_complex` arrays (X is the slow
+ * index, real and imaginary parts are interleaved), so that a block of rows can be read
+ * or written without re-arranging data.
+ */
+static std::vector<std::string> lrm_dimensions() {
+  return {"lrm_x", "lrm_y", "lrm_complex"};
+}
+
+static bool lrm_spectrum_matches(const File &file, int Nx, int Ny, double dx, double dy) {
+  if (not file.find_variable(lrm_variable)) {
+    return false;
+  }
+
+  auto dims = lrm_dimensions();
+  if (file.dimension_length(dims[0]) != (unsigned int)Nx or
+      file.dimension_length(dims[1]) != (unsigned int)Ny or
+      file.dimension_length(dims[2]) != 2) {
+    return false;
+  }
+
+  auto file_dx = file.read_double_attribute(lrm_variable, "dx");
+  auto file_dy = file.read_double_attribute(lrm_variable, "dy");
+  if (file_dx.size() != 1 or file_dy.size() != 1 or
+      file_dx[0] != dx or file_dy[0] != dy) {
+    return false;
+  }
+
+  return true;
+}
+
+bool lrm_spectrum_cached(MPI_Comm com, const std::string &filename,
+                         int Nx, int Ny, double dx, double dy) {
+  if (filename.empty() or not io::file_exists(com, filename)) {
+    return false;
+  }
+
+  File file(com, filename, PISM_NETCDF3, PISM_READONLY);
+
+  return lrm_spectrum_matches(file, Nx, Ny, dx, dy);
+}
+
+bool read_lrm_spectrum(MPI_Comm com, const std::string &filename,
+                       int Nx, int Ny, double dx, double dy,
+                       int row_start, int n_rows,
+                       fftw_complex *output) {
+
+  if (not io::file_exists(com, filename)) {
+    return false;
+  }
+
+  File file(com, filename, PISM_NETCDF3, PISM_READONLY);
+
+  if (not lrm_spectrum_matches(file, Nx, Ny, dx, dy)) {
+    return false;
+  }
+
+  file.read_variable(lrm_variable,
+                     {(unsigned int)row_start, 0, 0},
+                     {(unsigned int)n_rows, (unsigned int)Ny, 2},
+                     reinterpret_cast<double*>(output));
+
+  return true;
+}
+
+void write_lrm_spectrum(MPI_Comm com, const std::string &filename,
+                        int Nx, int Ny, double dx, double dy,
+                        int row_start, int n_rows,
+                        const fftw_complex *input) {
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  // Write to a temporary file and rename it to make sure that concurrent runs sharing a
+  // cache file never see a partially written one.
+  int pid = getpid();
+  MPI_Bcast(&pid, 1, MPI_INT, 0, com);
+  std::string tmp_filename = pism::printf("%s.%d.tmp", filename.c_str(), pid);
+
+  {
+    File file(com, tmp_filename, PISM_NETCDF3, PISM_READWRITE_CLOBBER);
+
+    auto dims = lrm_dimensions();
+    file.define_dimension(dims[0], Nx);
+    file.define_dimension(dims[1], Ny);
+    file.define_dimension(dims[2], 2);
+
+    file.define_variable(lrm_variable, PISM_DOUBLE, dims);
+    file.write_attribute(lrm_variable, "long_name",
+                         "Fourier transform of the elastic load response matrix");
+    file.write_attribute(lrm_variable, "dx", PISM_DOUBLE, {dx});
+    file.write_attribute(lrm_variable, "dy", PISM_DOUBLE, {dy});
+
+    file.write_variable(lrm_variable,
+                        {(unsigned int)row_start, 0, 0},
+                        {(unsigned int)n_rows, (unsigned int)Ny, 2},
+                        reinterpret_cast<const double*>(input));
+    file.close();
+  }
+
+  int stat = 0;
+  if (rank == 0) {
+    stat = std::rename(tmp_filename.c_str(), filename.c_str());
+  }
+  MPI_Bcast(&stat, 1, MPI_INT, 0, com);
+
+  if (stat != 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "can't move '%s' to '%s'",
+                                  tmp_filename.c_str(), filename.c_str());
+  }
+}
+
+} // end of namespace bed
+} // end of namespace pism
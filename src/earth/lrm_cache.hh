@@ -0,0 +1,66 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LRM_CACHE_H
+#define LRM_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+#include <fftw3.h>
+
+namespace pism {
+namespace bed {
+
+/*!
+ * Returns true if `filename` contains the Fourier transform of the elastic load response
+ * matrix computed using the extended grid of size `Nx*Ny` with spacing `dx` and `dy`.
+ */
+bool lrm_spectrum_cached(MPI_Comm com, const std::string &filename,
+                         int Nx, int Ny, double dx, double dy);
+
+/*!
+ * Read the Fourier transform of the elastic load response matrix from `filename`.
+ *
+ * Reads rows `row_start` to `row_start + n_rows - 1` (in the X direction) of the `Nx*Ny`
+ * spectrum on the calling rank.
+ *
+ * Returns false if the file does not exist or was created using a different extended grid
+ * (size `Nx*Ny`, spacing `dx` and `dy`).
+ */
+bool read_lrm_spectrum(MPI_Comm com, const std::string &filename,
+                       int Nx, int Ny, double dx, double dy,
+                       int row_start, int n_rows,
+                       fftw_complex *output);
+
+/*!
+ * Save the Fourier transform of the elastic load response matrix to `filename`.
+ *
+ * Each rank writes rows `row_start` to `row_start + n_rows - 1` of the spectrum.
+ */
+void write_lrm_spectrum(MPI_Comm com, const std::string &filename,
+                        int Nx, int Ny, double dx, double dy,
+                        int row_start, int n_rows,
+                        const fftw_complex *input);
+
+} // end of namespace bed
+} // end of namespace pism
+
+#endif /* LRM_CACHE_H */
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -171,26 +171,51 @@ void BTU_Full::update_impl(const IceModelVec2S &bedrock_top_temperature,
 
   IceModelVec::AccessList list{m_temp.get(), &m_bottom_surface_flux, &bedrock_top_temperature};
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  // columns are solved in batches (see BedrockColumn::solve())
+  const unsigned int batch_size = 16;
 
-      double *T = m_temp->get_column(i, j);
+  std::vector<int> I(batch_size), J(batch_size);
+  std::vector<double> Q_bottom(batch_size), T_top(batch_size);
+  std::vector<double*> T(batch_size);
+  unsigned int n_columns = 0;
 
-      m_column->solve(dt, m_bottom_surface_flux(i, j), bedrock_top_temperature(i, j),
-                      T,  // input
-                      T); // output
+  auto solve_batch = [&]() {
+    m_column->solve(dt, n_columns, Q_bottom.data(), T_top.data(), T.data());
 
-      // Check that T is positive:
+    // Check that T is positive:
+    for (unsigned int l = 0; l < n_columns; ++l) {
       for (unsigned int k = 0; k < m_Mbz; ++k) {
-        if (T[k] <= 0.0) {
+        if (T[l][k] <= 0.0) {
           throw RuntimeError::formatted(PISM_ERROR_LOCATION,
                                         "invalid bedrock temperature: %f Kelvin at %d,%d,%d",
-                                        T[k], i, j, k);
+                                        T[l][k], I[l], J[l], k);
         }
       }
     }
+
+    n_columns = 0;
+  };
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      I[n_columns]        = i;
+      J[n_columns]        = j;
+      Q_bottom[n_columns] = m_bottom_surface_flux(i, j);
+      T_top[n_columns]    = bedrock_top_temperature(i, j);
+      T[n_columns]        = m_temp->get_column(i, j);
+      n_columns += 1;
+
+      if (n_columns == batch_size) {
+        solve_batch();
+      }
+    }
+
+    if (n_columns > 0) {
+      solve_batch();
+    }
   } catch (...) {
     loop.failed();
   }
@@ -267,9 +292,12 @@ void BTU_Full::bootstrap(const IceModelVec2S &bedrock_top_temperature) {
 
     double *Tb = m_temp->get_column(i, j); // Tb points into temp memory
 
+    // temperature change per bedrock layer
+    const double dT = dz * m_bottom_surface_flux(i, j) / m_k;
+
     Tb[k0] = bedrock_top_temperature(i, j);
     for (int k = k0-1; k >= 0; k--) {
-      Tb[k] = Tb[k+1] + dz * m_bottom_surface_flux(i, j) / m_k;
+      Tb[k] = Tb[k+1] + dT;
     }
   }
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -22,13 +22,14 @@
 #include "BedrockColumn.hh"
 
 #include "pism/util/ConfigInterface.hh"
+#include "pism/util/error_handling.hh"
 
 namespace pism {
 namespace energy {
 
 BedrockColumn::BedrockColumn(const std::string& prefix,
                              const Config& config, double dz, unsigned int M)
-  : m_dz(dz), m_M(M), m_system(M, prefix) {
+  : m_dz(dz), m_M(M), m_prefix(prefix), m_dt(-1.0), m_R(0.0) {
 
   assert(M > 1);
 
@@ -38,12 +39,67 @@ BedrockColumn::BedrockColumn(const std::string& prefix,
 
   m_k   = config.get_number("energy.bedrock_thermal.conductivity");
   m_D   = m_k / (rho * c);
+
+  m_lower.resize(M);
+  m_diagonal.resize(M);
+  m_upper.resize(M);
+  m_pivot.resize(M);
+  m_work.resize(M);
 }
 
 BedrockColumn::~BedrockColumn() {
   // empty
 }
 
+/*!
+ * Assemble the matrix of the system corresponding to the time step `dt` and compute its
+ * LU factorization (using the same operations as TridiagonalSystem::solve()).
+ *
+ * Does nothing if the factorization for this `dt` is available.
+ */
+void BedrockColumn::factorize(double dt) {
+  if (dt == m_dt) {
+    return;
+  }
+
+  m_R = m_D * dt / (m_dz * m_dz);
+
+  unsigned int N = m_M - 1;
+
+  m_lower[0]    = 0.0;               // not used
+  m_diagonal[0] = 1.0 + 2.0 * m_R;
+  m_upper[0]    = -2.0 * m_R;
+
+  for (unsigned int k = 1; k < N; ++k) {
+    m_lower[k]    = -m_R;
+    m_diagonal[k] = 1.0 + 2.0 * m_R;
+    m_upper[k]    = -m_R;
+  }
+
+  m_lower[N]    = 0.0;
+  m_diagonal[N] = 1.0;
+  m_upper[N]    = 0.0;               // not used
+
+  m_work[0]  = 0.0;                  // not used
+  m_pivot[0] = m_diagonal[0];
+  for (unsigned int k = 1; k < m_M; ++k) {
+    if (m_pivot[k - 1] == 0.0) {
+      break;
+    }
+    m_work[k]  = m_upper[k - 1] / m_pivot[k - 1];
+    m_pivot[k] = m_diagonal[k] - m_lower[k] * m_work[k];
+  }
+
+  for (unsigned int k = 0; k < m_M; ++k) {
+    if (m_pivot[k] == 0.0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION, "%s: zero pivot at row %d",
+                                    m_prefix.c_str(), k + 1);
+    }
+  }
+
+  m_dt = dt;
+}
+
 /*!
  * Advance the heat equation in time.
  *
@@ -58,29 +114,91 @@ BedrockColumn::~BedrockColumn() {
 void BedrockColumn::solve(double dt, double Q_bottom, double T_top,
                           const double *T_old, double *T_new) {
 
-  double R = m_D * dt / (m_dz * m_dz);
-  double G = -Q_bottom / m_k;
+  factorize(dt);
 
-  m_system.L(0)   = 0.0;                 // not used
-  m_system.D(0)   = 1.0 + 2.0 * R;
-  m_system.U(0)   = -2.0 * R;
-  m_system.RHS(0) = T_old[0] - 2.0 * G * m_dz * R;
+  double G = -Q_bottom / m_k;
 
   unsigned int N = m_M - 1;
 
+  // forward substitution (T_old[k] is used before T_new[k] is set)
+  T_new[0] = (T_old[0] - 2.0 * G * m_dz * m_R) / m_pivot[0];
   for (unsigned int k = 1; k < N; ++k) {
-    m_system.L(k)   = -R;
-    m_system.D(k)   = 1.0 + 2.0 * R;
-    m_system.U(k)   = -R;
-    m_system.RHS(k) = T_old[k];
+    T_new[k] = (T_old[k] - m_lower[k] * T_new[k - 1]) / m_pivot[k];
+  }
+  T_new[N] = (T_top - m_lower[N] * T_new[N - 1]) / m_pivot[N];
+
+  // backward substitution
+  for (int k = m_M - 2; k >= 0; --k) {
+    T_new[k] -= m_work[k + 1] * T_new[k + 1];
+  }
+}
+
+/*!
+ * Advance the heat equation in time in `n_columns` columns at once.
+ *
+ * @param[in] dt time step length
+ * @param[in] n_columns number of columns
+ * @param[in] Q_bottom heat flux into each column through the bottom surface
+ * @param[in] T_top temperature at the top surface of each column
+ * @param[in,out] T pointers to temperatures in columns (replaced with new values)
+ *
+ * Columns are copied into the "structure of arrays" layout so that substitutions
+ * process all columns in one (vectorizable) loop for each row. Results are the same as
+ * the ones computed by the single-column version of solve().
+ */
+void BedrockColumn::solve(double dt, unsigned int n_columns,
+                          const double *Q_bottom, const double *T_top, double **T) {
+
+  factorize(dt);
+
+  const unsigned int W = n_columns, N = m_M - 1;
+
+  m_x.resize(m_M * W);
+  double *x = m_x.data();
+
+  for (unsigned int l = 0; l < W; ++l) {
+    for (unsigned int k = 0; k < N; ++k) {
+      x[k * W + l] = T[l][k];
+    }
+    x[N * W + l] = T_top[l];
   }
 
-  m_system.L(N)   = 0.0;
-  m_system.D(N)   = 1.0;
-  m_system.U(N)   = 0.0;                 // not used
-  m_system.RHS(N) = T_top;
+  // forward substitution
+  {
+    const double b = m_pivot[0];
+    for (unsigned int l = 0; l < W; ++l) {
+      double G = -Q_bottom[l] / m_k;
+      x[l] = (x[l] - 2.0 * G * m_dz * m_R) / b;
+    }
+  }
+  for (unsigned int k = 1; k < m_M; ++k) {
+    const double
+      L = m_lower[k],
+      b = m_pivot[k];
+    double
+      *x_k    = &x[k * W],
+      *x_prev = &x[(k - 1) * W];
+    for (unsigned int l = 0; l < W; ++l) {
+      x_k[l] = (x_k[l] - L * x_prev[l]) / b;
+    }
+  }
 
-  m_system.solve(m_M, T_new);
+  // backward substitution
+  for (int k = m_M - 2; k >= 0; --k) {
+    const double c = m_work[k + 1];
+    double
+      *x_k    = &x[k * W],
+      *x_next = &x[(k + 1) * W];
+    for (unsigned int l = 0; l < W; ++l) {
+      x_k[l] -= c * x_next[l];
+    }
+  }
+
+  for (unsigned int l = 0; l < W; ++l) {
+    for (unsigned int k = 0; k < m_M; ++k) {
+      T[l][k] = x[k * W + l];
+    }
+  }
 }
 
 /*!
@@ -1,4 +1,4 @@
-// Copyright (C) 2019 PISM Authors
+// Copyright (C) 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -19,7 +19,8 @@
 #ifndef BEDROCK_COLUMN_HH
 #define BEDROCK_COLUMN_HH
 
-#include "pism/util/ColumnSystem.hh"
+#include <string>
+#include <vector>
 
 namespace pism {
 
@@ -35,6 +36,11 @@ namespace energy {
  *
  * The implementation uses a second-order discretization in space and the backward-Euler
  * (first-order, fully implicit) time-discretization.
+ *
+ * The material properties and the grid are the same in all columns, so the matrix of the
+ * system depends on the time step length only. Its LU factorization is computed once
+ * and re-used until the time step length changes; solving a system requires one
+ * forward and one backward substitution.
  */
 class BedrockColumn {
 public:
@@ -49,7 +55,12 @@ public:
              const std::vector<double> &T_old,
              std::vector<double> &result);
 
+  void solve(double dt, unsigned int n_columns,
+             const double *Q_bottom, const double *T_top, double **T);
+
 private:
+  void factorize(double dt);
+
   // temperature diffusivity coefficient
   double m_D;
   // thermal conductivity
@@ -59,7 +70,18 @@ private:
   // system size
   unsigned int m_M;
 
-  TridiagonalSystem m_system;
+  std::string m_prefix;
+
+  // time step length used to compute the factorization (negative if not computed)
+  double m_dt;
+  // m_D * m_dt / m_dz^2
+  double m_R;
+  // diagonals of the system
+  std::vector<double> m_lower, m_diagonal, m_upper;
+  // pivots and multipliers of the LU factorization
+  std::vector<double> m_pivot, m_work;
+  // structure-of-arrays storage for batched solves
+  std::vector<double> m_x;
 };
 
 } // end of namespace energy
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -27,6 +27,8 @@
 #include "pism/util/io/File.hh"
 #include "utilities.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
 
 namespace pism {
 namespace energy {
@@ -124,118 +126,197 @@ void CHSystem::update_impl(double t, double dt, const Inputs &inputs) {
   // current time does not matter here
   (void) t;
 
-  EnthalpyConverter::Ptr EC = m_grid->ctx()->enthalpy_converter();
+  inputs.check();
+
+  ColumnUpdate column(*this, dt, inputs, *inputs.volumetric_heating_rate, 1);
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for (Points pt(*m_grid); pt; pt.next()) {
+      column.update(0, pt.i(), pt.j());
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+
+  m_stats.reduced_accuracy_counter += column.reduced_accuracy_counter();
+}
+
+//! Column system and work space used to update one column at a time.
+struct CHSystem::ColumnUpdate::Slot {
+  Slot() : reduced_accuracy_counter(0) {}
+
+  std::unique_ptr<enthSystemCtx> system;
+  //! new enthalpy in a column
+  std::vector<double> Enthnew;
+  //! number of columns with lambda < 1
+  unsigned int reduced_accuracy_counter;
+};
+
+/*!
+ * Prepare to update the CH system using `volumetric_heating_rate` (the rate of energy loss
+ * by the CH system is the negative of this) and `n_slots` column systems.
+ *
+ * All fields are accessed until this object is destroyed.
+ */
+CHSystem::ColumnUpdate::ColumnUpdate(CHSystem &model, double dt, const Inputs &inputs,
+                                     const IceModelVec3 &volumetric_heating_rate,
+                                     unsigned int n_slots)
+  : m_model(model), m_inputs(inputs) {
 
   inputs.check();
 
-  // give them names that are a bit shorter...
-  const IceModelVec3
-    &volumetric_heat = *inputs.volumetric_heating_rate,
-    &u3              = *inputs.u3,
-    &v3              = *inputs.v3,
-    &w3              = *inputs.w3;
+  IceGrid::ConstPtr grid = m_model.grid();
+  const Config &config = *grid->ctx()->config();
+
+  m_EC = grid->ctx()->enthalpy_converter();
 
-  const IceModelVec2CellType &cell_type = *inputs.cell_type;
+  m_margin_threshold        = config.get_number("energy.margin_ice_thickness_limit");
+  m_T_pm                    = config.get_number("constants.fresh_water.melting_point_temperature");
+  m_residual_water_fraction = config.get_number("energy.ch_warming.residual_water_fraction");
+
+  for (unsigned int k = 0; k < n_slots; ++k) {
+    std::unique_ptr<Slot> slot(new Slot());
+
+    slot->system.reset(new enthSystemCtx(grid->z(), "energy.ch_warming",
+                                         grid->dx(), grid->dy(), dt,
+                                         config, m_model.m_ice_enthalpy,
+                                         *inputs.u3, *inputs.v3, *inputs.w3,
+                                         volumetric_heating_rate, m_EC));
+    slot->Enthnew.resize(slot->system->z().size());
+
+    m_slots.emplace_back(std::move(slot));
+  }
+
+  m_list.add({inputs.surface_temp, inputs.shelf_base_temp, inputs.surface_liquid_fraction,
+      inputs.ice_thickness, inputs.basal_frictional_heating, inputs.basal_heat_flux,
+      inputs.cell_type, inputs.u3, inputs.v3, inputs.w3, &volumetric_heating_rate,
+      &m_model.m_ice_enthalpy, &m_model.m_work});
+}
+
+CHSystem::ColumnUpdate::~ColumnUpdate() {
+  // empty
+}
+
+//! Update the CH system in the column `i, j`.
+void CHSystem::ColumnUpdate::update(unsigned int slot, int i, int j) {
+  update_column(slot, i, j, nullptr);
+}
 
+/*!
+ * Update the CH system in the column `i, j`, re-using ice velocity on the fine grid from
+ * `velocity`, an ice enthalpy system initialized for the same column (see
+ * enthSystemCtx::init()).
+ */
+void CHSystem::ColumnUpdate::update(unsigned int slot, int i, int j,
+                                    const enthSystemCtx &velocity) {
+  update_column(slot, i, j, &velocity);
+}
+
+void CHSystem::ColumnUpdate::update_column(unsigned int slot, int i, int j,
+                                           const enthSystemCtx *velocity) {
   const IceModelVec2S
-    &basal_frictional_heating = *inputs.basal_frictional_heating,
-    &basal_heat_flux          = *inputs.basal_heat_flux,
-    &ice_thickness            = *inputs.ice_thickness,
-    &surface_liquid_fraction  = *inputs.surface_liquid_fraction,
-    &shelf_base_temp          = *inputs.shelf_base_temp,
-    &ice_surface_temp         = *inputs.surface_temp;
+    &ice_thickness            = *m_inputs.ice_thickness,
+    &ice_surface_temp         = *m_inputs.surface_temp,
+    &surface_liquid_fraction  = *m_inputs.surface_liquid_fraction,
+    &shelf_base_temp          = *m_inputs.shelf_base_temp,
+    &basal_heat_flux          = *m_inputs.basal_heat_flux,
+    &basal_frictional_heating = *m_inputs.basal_frictional_heating;
 
-  energy::enthSystemCtx system(m_grid->z(), "energy.ch_warming", m_grid->dx(), m_grid->dy(), dt,
-                               *m_config, m_ice_enthalpy, u3, v3, w3, volumetric_heat, EC);
+  const EnthalpyConverter &EC = *m_EC;
 
-  const size_t Mz_fine = system.z().size();
-  const double dz = system.dz();
-  std::vector<double> Enthnew(Mz_fine); // new enthalpy in column
+  Slot &s = *m_slots[slot];
+  enthSystemCtx &system = *s.system;
 
-  IceModelVec::AccessList list{&ice_surface_temp, &shelf_base_temp, &surface_liquid_fraction,
-      &ice_thickness, &basal_frictional_heating, &basal_heat_flux,
-      &cell_type, &u3, &v3, &w3, &volumetric_heat, &m_ice_enthalpy,
-      &m_work};
+  IceModelVec3 &work = m_model.m_work;
 
-  double
-    margin_threshold = m_config->get_number("energy.margin_ice_thickness_limit"),
-    T_pm = m_config->get_number("constants.fresh_water.melting_point_temperature"),
-    residual_water_fraction = m_config->get_number("energy.ch_warming.residual_water_fraction");
+  const double H = ice_thickness(i, j);
 
-  const std::vector<double> &z = m_grid->z();
-  const unsigned int Mz = m_grid->Mz();
+  if (ice_surface_temp(i, j) >= m_T_pm) {
+    // We use surface temperature to determine if we're in a melt season or not. It
+    // probably makes sense to use the surface mass balance instead.
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (Points pt(*m_grid); pt; pt.next()) {
-      const int i = pt.i(), j = pt.j();
-
-      const double H = ice_thickness(i, j);
-
-      if (ice_surface_temp(i, j) >= T_pm) {
-        // We use surface temperature to determine if we're in a melt season or not. It
-        // probably makes sense to use the surface mass balance instead.
-
-        double *column = m_work.get_column(i, j);
-        for (unsigned int k = 0; k < Mz; ++k) {
-          double
-            depth = std::max(H - z[k], 0.0),
-            P     = EC->pressure(depth);
-            column[k] = EC->enthalpy(EC->melting_temperature(P),
-                                     residual_water_fraction,
-                                     P);
-        }
-        continue;
-      }
+    const std::vector<double> &z = m_model.grid()->z();
+    const unsigned int Mz = z.size();
 
-      // enthalpy and pressures at top of ice
-      const double
-        depth_ks = H - system.ks() * dz,
-        p_ks     = EC->pressure(depth_ks); // FIXME issue #15
+    double *column = work.get_column(i, j);
+    for (unsigned int k = 0; k < Mz; ++k) {
+      double
+        depth = std::max(H - z[k], 0.0),
+        P     = EC.pressure(depth);
+      column[k] = EC.enthalpy(EC.melting_temperature(P),
+                              m_residual_water_fraction,
+                              P);
+    }
+    return;
+  }
 
-      const double Enth_ks = EC->enthalpy_permissive(ice_surface_temp(i, j),
-                                                     surface_liquid_fraction(i, j), p_ks);
+  const bool is_marginal = marginal(ice_thickness, i, j, m_margin_threshold);
+  if (velocity != nullptr) {
+    system.init(i, j, is_marginal, H, *velocity);
+  } else {
+    system.init(i, j, is_marginal, H);
+  }
 
-      system.init(i, j,
-                  marginal(ice_thickness, i, j, margin_threshold),
-                  H);
+  // enthalpy and pressures at top of ice
+  const double
+    depth_ks = H - system.ks() * system.dz(),
+    p_ks     = EC.pressure(depth_ks); // FIXME issue #15
 
-      const bool ice_free_column = (system.ks() == 0);
+  const double Enth_ks = EC.enthalpy_permissive(ice_surface_temp(i, j),
+                                                surface_liquid_fraction(i, j), p_ks);
 
-      // deal completely with columns with no ice
-      if (ice_free_column) {
-        m_work.set_column(i, j, Enth_ks);
-        continue;
-      } // end of if (ice_free_column)
+  const bool ice_free_column = (system.ks() == 0);
 
-      if (system.lambda() < 1.0) {
-        m_stats.reduced_accuracy_counter += 1; // count columns with lambda < 1
-      }
+  // deal completely with columns with no ice
+  if (ice_free_column) {
+    work.set_column(i, j, Enth_ks);
+    return;
+  } // end of if (ice_free_column)
 
-      // set boundary conditions and update enthalpy
-      {
-        system.set_surface_dirichlet_bc(Enth_ks);
+  if (system.lambda() < 1.0) {
+    s.reduced_accuracy_counter += 1; // count columns with lambda < 1
+  }
 
-        if (cell_type.ocean(i, j)) {
-          // floating base: Dirichlet application of known temperature from ocean coupler;
-          //   assumes base of ice shelf has zero liquid fraction
-          double Enth0 = EC->enthalpy_permissive(shelf_base_temp(i, j), 0.0, EC->pressure(H));
+  // set boundary conditions and update enthalpy
+  {
+    system.set_surface_dirichlet_bc(Enth_ks);
 
-          system.set_basal_dirichlet_bc(Enth0);
-        } else {
-          // grounded
-          system.set_basal_heat_flux(basal_heat_flux(i, j) + basal_frictional_heating(i, j));
-        }
-        // solve the system
-        system.solve(Enthnew);
-      }
+    if (m_inputs.cell_type->ocean(i, j)) {
+      // floating base: Dirichlet application of known temperature from ocean coupler;
+      //   assumes base of ice shelf has zero liquid fraction
+      double Enth0 = EC.enthalpy_permissive(shelf_base_temp(i, j), 0.0, EC.pressure(H));
 
-      system.fine_to_coarse(Enthnew, i, j, m_work);
+      system.set_basal_dirichlet_bc(Enth0);
+    } else {
+      // grounded
+      system.set_basal_heat_flux(basal_heat_flux(i, j) + basal_frictional_heating(i, j));
     }
-  } catch (...) {
-    loop.failed();
+    // solve the system
+    system.solve(s.Enthnew);
   }
-  loop.check();
+
+  system.fine_to_coarse(s.Enthnew, i, j, work);
+}
+
+//! Number of columns updated with the implicit FD method parameter lambda < 1.
+unsigned int CHSystem::ColumnUpdate::reduced_accuracy_counter() const {
+  unsigned int result = 0;
+  for (const auto &s : m_slots) {
+    result += s->reduced_accuracy_counter;
+  }
+  return result;
+}
+
+/*!
+ * Finish an update done outside of EnergyModel::update() (see EnergyModel::set_ch_system()):
+ * store the new enthalpy of the CH system and communicate ghosts.
+ *
+ * Collective.
+ */
+void CHSystem::ColumnUpdate::finish() {
+  m_model.m_work.update_ghosts(m_model.m_ice_enthalpy);
 }
 
 void CHSystem::define_model_state_impl(const File &output) const {
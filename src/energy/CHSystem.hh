@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,16 +20,55 @@
 #ifndef CHSYSTEM_H
 #define CHSYSTEM_H
 
+#include <memory>               // std::unique_ptr
+#include <vector>
+
 #include "EnergyModel.hh"
+#include "pism/util/EnthalpyConverter.hh"
 
 namespace pism {
 namespace energy {
 
+class enthSystemCtx;
+
 class CHSystem : public EnergyModel {
 public:
   CHSystem(IceGrid::ConstPtr grid, stressbalance::StressBalance *stress_balance);
   virtual ~CHSystem();
 
+  /*!
+   * Updates the enthalpy of the cryo-hydrologic system one column at a time.
+   *
+   * Used by CHSystem::update_impl() and by energy models updating the CH system during
+   * their own sweep over columns (see EnergyModel::set_ch_system()). Each slot has its own
+   * column system, so columns in different slots can be updated concurrently.
+   */
+  class ColumnUpdate {
+  public:
+    ColumnUpdate(CHSystem &model, double dt, const Inputs &inputs,
+                 const IceModelVec3 &volumetric_heating_rate,
+                 unsigned int n_slots);
+    ~ColumnUpdate();
+
+    void update(unsigned int slot, int i, int j);
+    void update(unsigned int slot, int i, int j, const enthSystemCtx &velocity);
+
+    unsigned int reduced_accuracy_counter() const;
+
+    void finish();
+  private:
+    struct Slot;
+
+    void update_column(unsigned int slot, int i, int j, const enthSystemCtx *velocity);
+
+    CHSystem &m_model;
+    Inputs m_inputs;
+    EnthalpyConverter::Ptr m_EC;
+    double m_margin_threshold, m_T_pm, m_residual_water_fraction;
+    IceModelVec::AccessList m_list;
+    std::vector<std::unique_ptr<Slot> > m_slots;
+  };
+
 protected:
   void restart_impl(const File &input_file, int record);
 
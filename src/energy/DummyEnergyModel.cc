@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -54,6 +54,11 @@ void DummyEnergyModel::update_impl(double t, double dt, const Inputs &inputs) {
   (void) inputs;
 }
 
+bool DummyEnergyModel::supports_age_model_impl() const {
+  // this model does not sweep over columns
+  return false;
+}
+
 MaxTimestep DummyEnergyModel::max_timestep_impl(double t) const {
   // silence a compiler warning
   (void) t;
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,11 +17,15 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>             // std::max
+#include <cmath>                 // std::abs
+
 #include "EnergyModel.hh"
 #include "pism/util/MaxTimestep.hh"
 #include "pism/stressbalance/StressBalance.hh"
 #include "pism/util/io/File.hh"
 #include "pism/util/Vars.hh"
+#include "pism/util/RegriddingSource.hh"
 #include "utilities.hh"
 #include "pism/util/EnthalpyConverter.hh"
 #include "bootstrapping.hh"
@@ -55,7 +59,8 @@ Inputs::Inputs() {
   v3                       = NULL;
   w3                       = NULL;
 
-  no_model_mask = NULL;
+  no_model_mask              = NULL;
+  ch_volumetric_heating_rate = NULL;
 }
 
 void Inputs::check() const {
@@ -79,6 +84,7 @@ EnergyModelStats::EnergyModelStats() {
   reduced_accuracy_counter = 0;
   low_temperature_counter  = 0;
   liquified_ice_volume     = 0.0;
+  max_enthalpy_change      = 0.0;
 }
 
 EnergyModelStats& EnergyModelStats::operator+=(const EnergyModelStats &other) {
@@ -86,6 +92,7 @@ EnergyModelStats& EnergyModelStats::operator+=(const EnergyModelStats &other) {
   reduced_accuracy_counter += other.reduced_accuracy_counter;
   low_temperature_counter  += other.low_temperature_counter;
   liquified_ice_volume     += other.liquified_ice_volume;
+  max_enthalpy_change      = std::max(max_enthalpy_change, other.max_enthalpy_change);
   return *this;
 }
 
@@ -123,12 +130,36 @@ void EnergyModelStats::sum(MPI_Comm com) {
   reduced_accuracy_counter = GlobalSum(com, reduced_accuracy_counter);
   low_temperature_counter  = GlobalSum(com, low_temperature_counter);
   liquified_ice_volume     = GlobalSum(com, liquified_ice_volume);
+  max_enthalpy_change      = GlobalMax(com, max_enthalpy_change);
+}
+
+//! Maximum absolute difference between `a` and `b` over the sub-domain owned by this process.
+static double max_difference(const IceModelVec3 &a, const IceModelVec3 &b) {
+  IceGrid::ConstPtr grid = a.grid();
+  const unsigned int Mz = grid->Mz();
+
+  IceModelVec::AccessList list{&a, &b};
+
+  double result = 0.0;
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const double
+      *A = a.get_column(i, j),
+      *B = b.get_column(i, j);
+
+    for (unsigned int k = 0; k < Mz; ++k) {
+      result = std::max(result, std::abs(A[k] - B[k]));
+    }
+  }
+  return result;
 }
 
 
 EnergyModel::EnergyModel(IceGrid::ConstPtr grid,
                          stressbalance::StressBalance *stress_balance)
-  : Component(grid), m_stress_balance(stress_balance) {
+  : Component(grid), m_age_model(nullptr), m_ch_system(nullptr),
+    m_stress_balance(stress_balance) {
 
   const unsigned int WIDE_STENCIL = m_config->get_number("grid.max_stencil_width");
 
@@ -231,13 +262,22 @@ void EnergyModel::regrid_enthalpy() {
   auto regrid_filename = m_config->get_string("input.regrid.file");
   auto regrid_vars     = set_split(m_config->get_string("input.regrid.vars"), ',');
 
+  std::string enthalpy_name = m_ice_enthalpy.metadata().get_name();
+
+  const RegriddingSource *source = m_grid->regridding_source();
+  if (source != nullptr and (regrid_vars.empty() or member(enthalpy_name, regrid_vars))) {
+    const IceModelVec *enthalpy = source->get(enthalpy_name);
+
+    if (enthalpy != nullptr) {
+      m_ice_enthalpy.regrid(*enthalpy);
+      return;
+    }
+  }
 
   if (regrid_filename.empty()) {
     return;
   }
 
-  std::string enthalpy_name = m_ice_enthalpy.metadata().get_name();
-
   if (regrid_vars.empty() or member(enthalpy_name, regrid_vars)) {
     File regrid_file(m_grid->com, regrid_filename, PISM_GUESS, PISM_READONLY);
     init_enthalpy(regrid_file, true, 0);
@@ -283,6 +323,11 @@ void EnergyModel::update(double t, double dt, const Inputs &inputs) {
     // this call should fill m_work with new values of enthalpy
     this->update_impl(t, dt, inputs);
 
+    // used to decide when to update energy next (see IceModel::max_timestep())
+    if (m_config->get_flag("time_stepping.skip.adaptive")) {
+      m_stats.max_enthalpy_change = max_difference(m_work, m_ice_enthalpy);
+    }
+
     m_work.update_ghosts(m_ice_enthalpy);
   }
   profiling.end("ice_energy");
@@ -328,6 +373,60 @@ const std::string& EnergyModel::stdout_flags() const {
   return m_stdout_flags;
 }
 
+/*!
+ * Ask this energy model to update `age` during the same sweep over columns as enthalpy,
+ * re-using ice velocity interpolated onto the fine vertical grid.
+ *
+ * Returns true if this model will update age (the caller should not update it
+ * separately) and false if it does not support this.
+ */
+bool EnergyModel::set_age_model(AgeModel *age) {
+  if (supports_age_model_impl()) {
+    m_age_model = age;
+  } else {
+    m_age_model = nullptr;
+  }
+  return updates_age();
+}
+
+//! Returns true if this model updates age (see set_age_model()).
+bool EnergyModel::updates_age() const {
+  return m_age_model != nullptr;
+}
+
+bool EnergyModel::supports_age_model_impl() const {
+  return false;
+}
+
+/*!
+ * Ask this energy model to update the cryo-hydrologic system `ch_system` during the same
+ * sweep over columns as enthalpy, re-using ice velocity interpolated onto the fine
+ * vertical grid.
+ *
+ * The volumetric heating rate of the CH system has to be set using
+ * Inputs::ch_volumetric_heating_rate.
+ *
+ * Returns true if this model will update the CH system (the caller should not update it
+ * separately) and false if it does not support this.
+ */
+bool EnergyModel::set_ch_system(CHSystem *ch_system) {
+  if (supports_ch_system_impl()) {
+    m_ch_system = ch_system;
+  } else {
+    m_ch_system = nullptr;
+  }
+  return updates_ch_system();
+}
+
+//! Returns true if this model updates the cryo-hydrologic system (see set_ch_system()).
+bool EnergyModel::updates_ch_system() const {
+  return m_ch_system != nullptr;
+}
+
+bool EnergyModel::supports_ch_system_impl() const {
+  return false;
+}
+
 const EnergyModelStats& EnergyModel::stats() const {
   return m_stats;
 }
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -31,9 +31,12 @@ class StressBalance;
 }
 
 class IceModelVec2CellType;
+class AgeModel;
 
 namespace energy {
 
+class CHSystem;
+
 class Inputs {
 public:
   Inputs();
@@ -55,6 +58,8 @@ public:
 
   // inputs used by regional models
   const IceModelVec2Int *no_model_mask;
+  //! volumetric heating rate of the cryo-hydrologic system (see EnergyModel::set_ch_system())
+  const IceModelVec3 *ch_volumetric_heating_rate;
 };
 
 class EnergyModelStats {
@@ -69,6 +74,9 @@ public:
   unsigned int reduced_accuracy_counter;
   unsigned int low_temperature_counter;
   double liquified_ice_volume;
+  //! maximum absolute change in enthalpy during a step, J kg-1 (computed only if
+  //! time_stepping.skip.adaptive is set)
+  double max_enthalpy_change;
 };
 
 class EnergyModel : public Component {
@@ -103,10 +111,19 @@ public:
   const IceModelVec2S & basal_melt_rate() const;
 
   const std::string& stdout_flags() const;
+
+  bool set_age_model(AgeModel *age);
+  bool updates_age() const;
+
+  bool set_ch_system(CHSystem *ch_system);
+  bool updates_ch_system() const;
 protected:
 
   virtual MaxTimestep max_timestep_impl(double t) const;
 
+  virtual bool supports_age_model_impl() const;
+  virtual bool supports_ch_system_impl() const;
+
   virtual void restart_impl(const File &input_file, int record) = 0;
 
   virtual void bootstrap_impl(const File &input_file,
@@ -142,6 +159,10 @@ protected:
 
   EnergyModelStats m_stats;
 
+  //! age model updated in the same sweep over columns (see set_age_model())
+  AgeModel *m_age_model;
+  //! cryo-hydrologic system updated in the same sweep over columns (see set_ch_system())
+  CHSystem *m_ch_system;
 private:
   std::string m_stdout_flags;
   stressbalance::StressBalance *m_stress_balance;
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <memory>               // std::unique_ptr
+
 #include "EnthalpyModel.hh"
 
 #include "DrainageCalculator.hh"
@@ -26,13 +28,19 @@
 #include "pism/util/io/File.hh"
 #include "utilities.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/Tiles.hh"
+#include "pism/util/Profiling.hh"
+#include "pism/age/AgeModel.hh"
+#include "CHSystem.hh"
 
 namespace pism {
 namespace energy {
 
 EnthalpyModel::EnthalpyModel(IceGrid::ConstPtr grid,
                              stressbalance::StressBalance *stress_balance)
-  : EnergyModel(grid, stress_balance) {
+  : EnergyModel(grid, stress_balance),
+    m_active_cells(*grid) {
   // empty
 }
 
@@ -100,7 +108,12 @@ AschwandenBuelerKhroulevBlatter].
 This method updates IceModelVec3 m_work and IceModelVec2S basal_melt_rate.
 No communication of ghosts is done for any of these fields.
 
-We use an instance of enthSystemCtx.
+We use an instance of enthSystemCtx per column to set up the system; systems in several
+columns are then solved together using TridiagonalSystemBatch.
+
+If an age model was provided (see set_age_model()) this method updates age as well,
+re-using ice velocity interpolated onto the fine vertical grid by enthSystemCtx. The
+same applies to the cryo-hydrologic system (see set_ch_system()).
 
 Regarding drainage, see [\ref AschwandenBuelerKhroulevBlatter] and references therein.
  */
@@ -111,6 +124,10 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
 
   EnthalpyConverter::Ptr EC = m_grid->ctx()->enthalpy_converter();
 
+  const Profiling &profiling = m_grid->ctx()->profiling();
+  const int region = profiling.region("energy.enthalpy");
+  Profiling::Scope scope(profiling, region);
+
   const double
     ice_density           = m_config->get_number("constants.ice.density"), // kg m-3
     bulgeEnthMax          = m_config->get_number("energy.enthalpy.cold_bulge_max"), // J kg-1
@@ -138,12 +155,33 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
     &ice_surface_temp         = *inputs.surface_temp,
     &till_water_thickness     = *inputs.till_water_thickness;
 
-  energy::enthSystemCtx system(m_grid->z(), "energy.enthalpy", m_grid->dx(), m_grid->dy(), dt,
-                               *m_config, m_ice_enthalpy, u3, v3, w3, strain_heating3, EC);
+  // Tridiagonal systems in columns are assembled one column at a time, then solved in
+  // batches of batch_size columns (see TridiagonalSystemBatch) and post-processed. Each
+  // column in a batch needs its own enthSystemCtx.
+  const unsigned int batch_size = 16;
+
+  // Icy columns and ice-free columns are processed separately. Columns in the no-model
+  // strip of a regional model (if any) keep their enthalpy and are not processed at all.
+  m_active_cells.update(cell_type, 0, inputs.no_model_mask);
+
+  // Tiles may be processed concurrently, so each thread gets its own column systems
+  // (these are allocated here because Config is not thread-safe) and each tile its own
+  // work space and partial reductions. Column systems are allocated once per thread (not
+  // once per tile) to reduce memory use: all the per-level data are allocated here, so
+  // the loop over columns does not allocate memory.
+  const Tiles &tiles = m_active_cells.tiles();
+  const unsigned int n_threads = tiles.n_threads();
+  std::vector<std::unique_ptr<energy::enthSystemCtx> > systems;
+  for (unsigned int k = 0; k < n_threads * batch_size; ++k) {
+    systems.emplace_back(new energy::enthSystemCtx(m_grid->z(), "energy.enthalpy",
+                                                   m_grid->dx(), m_grid->dy(), dt,
+                                                   *m_config, m_ice_enthalpy,
+                                                   u3, v3, w3, strain_heating3, EC));
+  }
 
-  const size_t Mz_fine = system.z().size();
-  const double dz = system.dz();
-  std::vector<double> Enthnew(Mz_fine); // new enthalpy in column
+  const size_t Mz_fine = systems[0]->z().size();
+  const unsigned int Mz = m_grid->Mz();
+  const double dz = systems[0]->dz();
 
   IceModelVec::AccessList list{&ice_surface_temp, &shelf_base_temp, &surface_liquid_fraction,
       &ice_thickness, &basal_frictional_heating, &basal_heat_flux, &till_water_thickness,
@@ -152,236 +190,535 @@ void EnthalpyModel::update_impl(double t, double dt, const Inputs &inputs) {
 
   double margin_threshold = m_config->get_number("energy.margin_ice_thickness_limit");
 
-  unsigned int liquifiedCount = 0;
+  // age update done as a part of this sweep over columns, one slot per thread
+  std::unique_ptr<AgeModel::ColumnUpdate> age;
+  if (m_age_model != nullptr) {
+    AgeModelInputs age_inputs(&ice_thickness, &u3, &v3, &w3);
+    age_inputs.cell_type = &cell_type;
+
+    age.reset(new AgeModel::ColumnUpdate(*m_age_model, dt, age_inputs, n_threads));
+  }
+
+  // CH system update done as a part of this sweep over columns, one slot per thread
+  std::unique_ptr<CHSystem::ColumnUpdate> ch;
+  if (m_ch_system != nullptr) {
+    if (inputs.ch_volumetric_heating_rate == nullptr) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "ch_volumetric_heating_rate is required to update the CH system");
+    }
+    ch.reset(new CHSystem::ColumnUpdate(*m_ch_system, dt, inputs,
+                                        *inputs.ch_volumetric_heating_rate, n_threads));
+  }
+
+  // Skip columns that are (nearly) steady; see SteadyColumn.
+  const double
+    steady_tolerance    = m_config->get_number("energy.enthalpy.steady_column.tolerance"),
+    steady_max_interval = m_config->get_number("energy.enthalpy.steady_column.max_interval",
+                                               "seconds");
+  const bool skip_steady = steady_tolerance > 0.0;
+  if (skip_steady) {
+    m_steady_columns.resize(m_grid->xm() * m_grid->ym());
+  } else {
+    m_steady_columns.clear();
+  }
+
+  const int xs = m_grid->xs(), xm = m_grid->xm(), ys = m_grid->ys();
+  auto steady = [&](int i, int j) -> SteadyColumn& {
+    return m_steady_columns[(j - ys) * xm + (i - xs)];
+  };
+
+  struct Column {
+    int i, j;
+    double H, Enth_ks;
+    bool is_floating;
+    SteadyColumn state;
+  };
+
+  std::vector<unsigned int>
+    liquified_count_tile(tiles.size(), 0),
+    reduced_accuracy_counter_tile(tiles.size(), 0),
+    bulge_counter_tile(tiles.size(), 0);
+  // number of fine grid levels in assembled column systems (used to estimate the work
+  // done)
+  std::vector<double> levels_tile(tiles.size(), 0.0);
 
   ParallelSection loop(m_grid->com);
   try {
-    for (Points pt(*m_grid); pt; pt.next()) {
-      const int i = pt.i(), j = pt.j();
+    for_each_tile(tiles, [&](const Tile &tile) {
+      // column systems used by this thread
+      const unsigned int thread = tile_thread();
+      std::unique_ptr<energy::enthSystemCtx> *tile_systems = &systems[thread * batch_size];
+
+      TridiagonalSystemBatch batch(Mz_fine, batch_size);
+
+      // columns in the current batch
+      std::vector<Column> columns(batch_size);
+      unsigned int n_columns = 0;
+
+      std::vector<double> Enthnew(Mz_fine); // new enthalpy in column
+
+      unsigned int
+        liquified_count          = 0,
+        reduced_accuracy_counter = 0,
+        bulge_counter            = 0;
+      double levels = 0.0;
+
+      // Post-process (drainage, bulge-limiting, basal melt) the column in the lane `lane`
+      // of the batch and store the result.
+      auto post_process = [&](unsigned int lane) {
+        energy::enthSystemCtx &system = *tile_systems[lane];
+
+        const Column &column = columns[lane];
+        const int i = column.i, j = column.j;
+        const double
+          H       = column.H,
+          Enth_ks = column.Enth_ks;
+        const bool is_floating = column.is_floating;
+
+        system.get_solution(batch, lane, Enthnew);
+
+        // post-process (drainage and bulge-limiting)
+        double Hdrainedtotal = 0.0;
+        double Hfrozen = 0.0;
+        {
+          // drain ice segments by mechanism in [\ref AschwandenBuelerKhroulevBlatter],
+          //   using DrainageCalculator dc
+          for (unsigned int k=0; k < system.ks(); k++) {
+            if (Enthnew[k] > system.Enth_s(k)) { // avoid doing any more work if cold
+
+              const double
+                depth = H - k * dz,
+                p     = EC->pressure(depth), // FIXME issue #15
+                T_m   = EC->melting_temperature(p),
+                L     = EC->L(T_m);
+
+              if (Enthnew[k] >= system.Enth_s(k) + 0.5 * L) {
+                liquified_count++; // count these rare events...
+                Enthnew[k] = system.Enth_s(k) + 0.5 * L; //  but lose the energy
+              }
+
+              double omega = EC->water_fraction(Enthnew[k], p);
+
+              if (omega > target_water_fraction) {
+                double fractiondrained = dc.get_drainage_rate(omega) * dt; // pure number
+
+                fractiondrained  = std::min(fractiondrained,
+                                            omega - target_water_fraction);
+                Hdrainedtotal   += fractiondrained * dz; // always a positive contribution
+                Enthnew[k]      -= fractiondrained * L;
+              }
+            }
+          }
+
+          // apply bulge limiter
+          const double lowerEnthLimit = Enth_ks - bulgeEnthMax;
+          for (unsigned int k=0; k < system.ks(); k++) {
+            if (Enthnew[k] < lowerEnthLimit) {
+              // Count grid points which have very large cold limit advection bulge... enthalpy not
+              // too low.
+              bulge_counter += 1;
+              Enthnew[k] = lowerEnthLimit;
+            }
+          }
+
+          // if there is subglacial water, don't allow ice base enthalpy to be below
+          // pressure-melting; that is, assume subglacial water is at the pressure-
+          // melting temperature and enforce continuity of temperature
+          {
+            if (Enthnew[0] < system.Enth_s(0) && till_water_thickness(i,j) > 0.0) {
+              const double E_difference = system.Enth_s(0) - Enthnew[0];
+
+              const double depth = H,
+                pressure         = EC->pressure(depth),
+                T_m              = EC->melting_temperature(pressure);
+
+              Enthnew[0] = system.Enth_s(0);
+              // This adjustment creates energy out of nothing. We will
+              // freeze some basal water, subtracting an equal amount of
+              // energy, to make up for it.
+              //
+              // Note that [E_difference] = J/kg, so
+              //
+              // U_difference = E_difference * ice_density * dx * dy * (0.5*dz)
+              //
+              // is the amount of energy created (we changed enthalpy of
+              // a block of ice with the volume equal to
+              // dx*dy*(0.5*dz); note that the control volume
+              // corresponding to the grid point at the base of the
+              // column has thickness 0.5*dz, not dz).
+              //
+              // Also, [L] = J/kg, so
+              //
+              // U_freeze_on = L * ice_density * dx * dy * Hfrozen,
+              //
+              // is the amount of energy created by freezing a water
+              // layer of thickness Hfrozen (using units of ice
+              // equivalent thickness).
+              //
+              // Setting U_difference = U_freeze_on and solving for
+              // Hfrozen, we find the thickness of the basal water layer
+              // we need to freeze co restore energy conservation.
+
+              Hfrozen = E_difference * (0.5*dz) / EC->L(T_m);
+            }
+          }
+
+        } // end of post-processing
+
+        // compute basal melt rate
+        {
+          bool base_is_cold = (Enthnew[0] < system.Enth_s(0)) && (till_water_thickness(i,j) == 0.0);
+          // Determine melt rate, but only preliminarily because of
+          // drainage, from heat flux out of bedrock, heat flux into
+          // ice, and frictional heating
+          if (is_floating) {
+            // The floating basal melt rate will be set later; cover
+            // this case and set to zero for now. Note that
+            // Hdrainedtotal is discarded (the ocean model determines
+            // the basal melt).
+            m_basal_melt_rate(i, j) = 0.0;
+          } else {
+            if (base_is_cold) {
+              m_basal_melt_rate(i, j) = 0.0;  // zero melt rate if cold base
+            } else {
+              const double
+                p_0 = EC->pressure(H),
+                p_1 = EC->pressure(H - dz), // FIXME issue #15
+                Tpmp_0 = EC->melting_temperature(p_0);
+
+              const bool k1_istemperate = EC->is_temperate(Enthnew[1], p_1); // level  z = + \Delta z
+              double hf_up = 0.0;
+              if (k1_istemperate) {
+                const double
+                  Tpmp_1 = EC->melting_temperature(p_1);
+
+                hf_up = -system.k_from_T(Tpmp_0) * (Tpmp_1 - Tpmp_0) / dz;
+              } else {
+                double T_0 = EC->temperature(Enthnew[0], p_0);
+                const double K_0 = system.k_from_T(T_0) / EC->c();
+
+                hf_up = -K_0 * (Enthnew[1] - Enthnew[0]) / dz;
+              }
+
+              // compute basal melt rate from flux balance:
+              //
+              // basal_melt_rate = - Mb / rho in [\ref AschwandenBuelerKhroulevBlatter];
+              //
+              // after we compute it we make sure there is no refreeze if
+              // there is no available basal water
+              m_basal_melt_rate(i, j) = (basal_frictional_heating(i, j) + basal_heat_flux(i, j) - hf_up) / (ice_density * EC->L(Tpmp_0));
+
+              if (till_water_thickness(i, j) <= 0 && m_basal_melt_rate(i, j) < 0) {
+                m_basal_melt_rate(i, j) = 0.0;
+              }
+            }
+
+            // Add drained water from the column to basal melt rate.
+            m_basal_melt_rate(i, j) += (Hdrainedtotal - Hfrozen) / dt;
+          } // end of the grounded case
+        } // end of the basal melt rate computation
+
+        system.fine_to_coarse(Enthnew, i, j, m_work);
+
+        if (skip_steady) {
+          const double
+            *E_old = m_ice_enthalpy.get_column(i, j),
+            *E_new = m_work.get_column(i, j);
 
-      const double H = ice_thickness(i, j);
+          double change = 0.0;
+          for (unsigned int k = 0; k < Mz; ++k) {
+            change = std::max(change, std::abs(E_new[k] - E_old[k]));
+          }
 
-      system.init(i, j,
-                  marginal(ice_thickness, i, j, margin_threshold),
-                  H);
+          SteadyColumn &state = steady(i, j);
+          state         = column.state;
+          state.rate    = change / dt;
+          state.elapsed = 0.0;
+          state.valid   = true;
+        }
+      };
 
-      // enthalpy and pressures at top of ice
-      const double
-        depth_ks = H - system.ks() * dz,
-        p_ks     = EC->pressure(depth_ks); // FIXME issue #15
+      // Solve systems in the current batch and post-process results.
+      auto process_batch = [&]() {
+        const int failed = batch.solve(n_columns);
+        if (failed >= 0) {
+          // solve this system again to get an informative error message
+          tile_systems[failed]->solve(Enthnew);
 
-      const double Enth_ks = EC->enthalpy_permissive(ice_surface_temp(i, j),
-                                                     surface_liquid_fraction(i, j), p_ks);
+          throw RuntimeError(PISM_ERROR_LOCATION, "failed to solve a tridiagonal system");
+        }
 
-      const bool ice_free_column = (system.ks() == 0);
+        for (unsigned int lane = 0; lane < n_columns; ++lane) {
+          post_process(lane);
+        }
 
-      // deal completely with columns with no ice; enthalpy and basal_melt_rate need setting
-      if (ice_free_column) {
+        n_columns = 0;
+      };
+
+      // Set enthalpy and basal melt rate in the column (i, j) containing less than one
+      // fine grid layer of ice.
+      auto set_ice_free_column = [&](int i, int j) {
+        // this is what process_column() would do for this column if system.ks() == 0
+        // (i.e. if H < dz), but without initializing the column system
+        const double Enth_ks = EC->enthalpy_permissive(ice_surface_temp(i, j),
+                                                       surface_liquid_fraction(i, j),
+                                                       EC->pressure(ice_thickness(i, j)));
         m_work.set_column(i, j, Enth_ks);
-        // The floating basal melt rate will be set later; cover this
-        // case and set to zero for now. Also, there is no basal melt
-        // rate on ice free land and ice free ocean
         m_basal_melt_rate(i, j) = 0.0;
-        continue;
-      } // end of if (ice_free_column)
 
-      if (system.lambda() < 1.0) {
-        m_stats.reduced_accuracy_counter += 1; // count columns with lambda < 1
-      }
+        if (age) {
+          age->set_ice_free(i, j);
+        }
+
+        if (ch) {
+          ch->update(thread, i, j);
+        }
 
-      const bool
-        is_floating        = cell_type.ocean(i, j),
-        base_is_warm       = system.Enth(0) >= system.Enth_s(0),
-        above_base_is_warm = system.Enth(1) >= system.Enth_s(1);
+        if (skip_steady) {
+          steady(i, j).valid = false;
+        }
+      };
 
-      // set boundary conditions and update enthalpy
-      {
-        system.set_surface_dirichlet_bc(Enth_ks);
+      // Assemble the system in the column (i, j), adding it to the current batch.
+      auto process_column = [&](int i, int j) {
+        const double H = ice_thickness(i, j);
 
-        // determine lowest-level equation at bottom of ice; see
-        // decision chart in the source code browser and page
-        // documenting BOMBPROOF
-        if (is_floating) {
-          // floating base: Dirichlet application of known temperature from ocean
-          //   coupler; assumes base of ice shelf has zero liquid fraction
-          double Enth0 = EC->enthalpy_permissive(shelf_base_temp(i, j), 0.0, EC->pressure(H));
+        if (H / dz < 1.0) {
+          set_ice_free_column(i, j);
+          return;
+        }
 
-          system.set_basal_dirichlet_bc(Enth0);
-        } else {
-          // grounded ice warm and wet
-          if (base_is_warm && (till_water_thickness(i, j) > 0.0)) {
-            if (above_base_is_warm) {
-              // temperate layer at base (Neumann) case:  q . n = 0  (K0 grad E . n = 0)
-              system.set_basal_heat_flux(0.0);
-            } else {
-              // only the base is warm: E = E_s(p) (Dirichlet)
-              // ( Assumes ice has zero liquid fraction. Is this a valid assumption here?
-              system.set_basal_dirichlet_bc(system.Enth_s(0));
+        // properties of this column determining whether it can be skipped
+        SteadyColumn state;
+        if (skip_steady) {
+          state.ks           = static_cast<unsigned int>(floor(H / dz));
+          state.surface_temp = ice_surface_temp(i, j);
+          state.floating     = cell_type.ocean(i, j);
+          state.wet          = till_water_thickness(i, j) > 0.0;
+
+          if (not marginal(ice_thickness, i, j, margin_threshold) and
+              steady(i, j).skip(state, dt, steady_tolerance, steady_max_interval)) {
+            // keep the old enthalpy and basal melt rate
+            steady(i, j).elapsed += dt;
+            m_work.set_column(i, j, m_ice_enthalpy.get_column(i, j));
+
+            if (age) {
+              age->update(thread, i, j, H);
             }
-          } else {
-            // (Neumann) case:  q . n = q_lith . n + F_b
-            // a) cold and dry base, or
-            // b) base that is still warm from the last time step, but without basal water
-            system.set_basal_heat_flux(basal_heat_flux(i, j) + basal_frictional_heating(i, j));
+
+            if (ch) {
+              ch->update(thread, i, j);
+            }
+            return;
           }
         }
 
-        // solve the system
-        system.solve(Enthnew);
+        energy::enthSystemCtx &system = *tile_systems[n_columns];
 
-      }
+        system.init(i, j,
+                    marginal(ice_thickness, i, j, margin_threshold),
+                    H);
 
-      // post-process (drainage and bulge-limiting)
-      double Hdrainedtotal = 0.0;
-      double Hfrozen = 0.0;
-      {
-        // drain ice segments by mechanism in [\ref AschwandenBuelerKhroulevBlatter],
-        //   using DrainageCalculator dc
-        for (unsigned int k=0; k < system.ks(); k++) {
-          if (Enthnew[k] > system.Enth_s(k)) { // avoid doing any more work if cold
-
-            const double
-              depth = H - k * dz,
-              p     = EC->pressure(depth), // FIXME issue #15
-              T_m   = EC->melting_temperature(p),
-              L     = EC->L(T_m);
-
-            if (Enthnew[k] >= system.Enth_s(k) + 0.5 * L) {
-              liquifiedCount++; // count these rare events...
-              Enthnew[k] = system.Enth_s(k) + 0.5 * L; //  but lose the energy
-            }
+        if (age) {
+          // vertical velocity is set to zero in marginal columns if vertical advection
+          // is excluded; the age model has to use the actual one
+          age->update(thread, i, j, H, system,
+                      not system.vertical_advection_excluded());
+        }
 
-            double omega = EC->water_fraction(Enthnew[k], p);
+        if (ch) {
+          ch->update(thread, i, j, system);
+        }
 
-            if (omega > target_water_fraction) {
-              double fractiondrained = dc.get_drainage_rate(omega) * dt; // pure number
+        // enthalpy and pressures at top of ice
+        const double
+          depth_ks = H - system.ks() * dz,
+          p_ks     = EC->pressure(depth_ks); // FIXME issue #15
 
-              fractiondrained  = std::min(fractiondrained,
-                                          omega - target_water_fraction);
-              Hdrainedtotal   += fractiondrained * dz; // always a positive contribution
-              Enthnew[k]      -= fractiondrained * L;
-            }
-          }
-        }
+        const double Enth_ks = EC->enthalpy_permissive(ice_surface_temp(i, j),
+                                                       surface_liquid_fraction(i, j), p_ks);
 
-        // apply bulge limiter
-        const double lowerEnthLimit = Enth_ks - bulgeEnthMax;
-        for (unsigned int k=0; k < system.ks(); k++) {
-          if (Enthnew[k] < lowerEnthLimit) {
-            // Count grid points which have very large cold limit advection bulge... enthalpy not
-            // too low.
-            m_stats.bulge_counter += 1;
-            Enthnew[k] = lowerEnthLimit;
-          }
+        const bool ice_free_column = (system.ks() == 0);
+
+        // deal completely with columns with no ice; enthalpy and basal_melt_rate need setting
+        if (ice_free_column) {
+          m_work.set_column(i, j, Enth_ks);
+          // The floating basal melt rate will be set later; cover this
+          // case and set to zero for now. Also, there is no basal melt
+          // rate on ice free land and ice free ocean
+          m_basal_melt_rate(i, j) = 0.0;
+          return;
+        } // end of if (ice_free_column)
+
+        if (system.lambda() < 1.0) {
+          reduced_accuracy_counter += 1; // count columns with lambda < 1
         }
 
-        // if there is subglacial water, don't allow ice base enthalpy to be below
-        // pressure-melting; that is, assume subglacial water is at the pressure-
-        // melting temperature and enforce continuity of temperature
+        const bool
+          is_floating        = cell_type.ocean(i, j),
+          base_is_warm       = system.Enth(0) >= system.Enth_s(0),
+          above_base_is_warm = system.Enth(1) >= system.Enth_s(1);
+
+        // set boundary conditions and update enthalpy
         {
-          if (Enthnew[0] < system.Enth_s(0) && till_water_thickness(i,j) > 0.0) {
-            const double E_difference = system.Enth_s(0) - Enthnew[0];
-
-            const double depth = H,
-              pressure         = EC->pressure(depth),
-              T_m              = EC->melting_temperature(pressure);
-
-            Enthnew[0] = system.Enth_s(0);
-            // This adjustment creates energy out of nothing. We will
-            // freeze some basal water, subtracting an equal amount of
-            // energy, to make up for it.
-            //
-            // Note that [E_difference] = J/kg, so
-            //
-            // U_difference = E_difference * ice_density * dx * dy * (0.5*dz)
-            //
-            // is the amount of energy created (we changed enthalpy of
-            // a block of ice with the volume equal to
-            // dx*dy*(0.5*dz); note that the control volume
-            // corresponding to the grid point at the base of the
-            // column has thickness 0.5*dz, not dz).
-            //
-            // Also, [L] = J/kg, so
-            //
-            // U_freeze_on = L * ice_density * dx * dy * Hfrozen,
-            //
-            // is the amount of energy created by freezing a water
-            // layer of thickness Hfrozen (using units of ice
-            // equivalent thickness).
-            //
-            // Setting U_difference = U_freeze_on and solving for
-            // Hfrozen, we find the thickness of the basal water layer
-            // we need to freeze co restore energy conservation.
-
-            Hfrozen = E_difference * (0.5*dz) / EC->L(T_m);
+          system.set_surface_dirichlet_bc(Enth_ks);
+
+          // determine lowest-level equation at bottom of ice; see
+          // decision chart in the source code browser and page
+          // documenting BOMBPROOF
+          if (is_floating) {
+            // floating base: Dirichlet application of known temperature from ocean
+            //   coupler; assumes base of ice shelf has zero liquid fraction
+            double Enth0 = EC->enthalpy_permissive(shelf_base_temp(i, j), 0.0, EC->pressure(H));
+
+            system.set_basal_dirichlet_bc(Enth0);
+          } else {
+            // grounded ice warm and wet
+            if (base_is_warm && (till_water_thickness(i, j) > 0.0)) {
+              if (above_base_is_warm) {
+                // temperate layer at base (Neumann) case:  q . n = 0  (K0 grad E . n = 0)
+                system.set_basal_heat_flux(0.0);
+              } else {
+                // only the base is warm: E = E_s(p) (Dirichlet)
+                // ( Assumes ice has zero liquid fraction. Is this a valid assumption here?
+                system.set_basal_dirichlet_bc(system.Enth_s(0));
+              }
+            } else {
+              // (Neumann) case:  q . n = q_lith . n + F_b
+              // a) cold and dry base, or
+              // b) base that is still warm from the last time step, but without basal water
+              system.set_basal_heat_flux(basal_heat_flux(i, j) + basal_frictional_heating(i, j));
+            }
           }
+
+          system.assemble(batch, n_columns);
+          levels += system.ks() + 1;
         }
 
-      } // end of post-processing
-
-      // compute basal melt rate
-      {
-        bool base_is_cold = (Enthnew[0] < system.Enth_s(0)) && (till_water_thickness(i,j) == 0.0);
-        // Determine melt rate, but only preliminarily because of
-        // drainage, from heat flux out of bedrock, heat flux into
-        // ice, and frictional heating
-        if (is_floating) {
-          // The floating basal melt rate will be set later; cover
-          // this case and set to zero for now. Note that
-          // Hdrainedtotal is discarded (the ocean model determines
-          // the basal melt).
-          m_basal_melt_rate(i, j) = 0.0;
+        columns[n_columns] = {i, j, H, Enth_ks, is_floating, state};
+        n_columns += 1;
+
+        if (n_columns == batch_size) {
+          process_batch();
+        }
+      };
+
+      for (auto c : m_active_cells.active(tile)) {
+        process_column(c.i, c.j);
+      }
+
+      for (auto c : m_active_cells.inactive(tile)) {
+        const int i = c.i, j = c.j;
+        const double H = ice_thickness(i, j);
+
+        if (H / dz < 1.0) {
+          set_ice_free_column(i, j);
         } else {
-          if (base_is_cold) {
-            m_basal_melt_rate(i, j) = 0.0;  // zero melt rate if cold base
-          } else {
-            const double
-              p_0 = EC->pressure(H),
-              p_1 = EC->pressure(H - dz), // FIXME issue #15
-              Tpmp_0 = EC->melting_temperature(p_0);
-
-            const bool k1_istemperate = EC->is_temperate(Enthnew[1], p_1); // level  z = + \Delta z
-            double hf_up = 0.0;
-            if (k1_istemperate) {
-              const double
-                Tpmp_1 = EC->melting_temperature(p_1);
+          // an ice-free cell (according to the mask) can still contain a thin layer of
+          // ice
+          process_column(i, j);
+        }
+      }
 
-              hf_up = -system.k_from_T(Tpmp_0) * (Tpmp_1 - Tpmp_0) / dz;
-            } else {
-              double T_0 = EC->temperature(Enthnew[0], p_0);
-              const double K_0 = system.k_from_T(T_0) / EC->c();
+      if (n_columns > 0) {
+        process_batch();
+      }
 
-              hf_up = -K_0 * (Enthnew[1] - Enthnew[0]) / dz;
-            }
+      // keep the old enthalpy and basal melt rate
+      for (auto c : m_active_cells.excluded(tile)) {
+        const int i = c.i, j = c.j;
 
-            // compute basal melt rate from flux balance:
-            //
-            // basal_melt_rate = - Mb / rho in [\ref AschwandenBuelerKhroulevBlatter];
-            //
-            // after we compute it we make sure there is no refreeze if
-            // there is no available basal water
-            m_basal_melt_rate(i, j) = (basal_frictional_heating(i, j) + basal_heat_flux(i, j) - hf_up) / (ice_density * EC->L(Tpmp_0));
+        m_work.set_column(i, j, m_ice_enthalpy.get_column(i, j));
 
-            if (till_water_thickness(i, j) <= 0 && m_basal_melt_rate(i, j) < 0) {
-              m_basal_melt_rate(i, j) = 0.0;
-            }
-          }
+        if (age) {
+          age->update(thread, i, j, ice_thickness(i, j));
+        }
 
-          // Add drained water from the column to basal melt rate.
-          m_basal_melt_rate(i, j) += (Hdrainedtotal - Hfrozen) / dt;
-        } // end of the grounded case
-      } // end of the basal melt rate computation
+        if (ch) {
+          ch->update(thread, i, j);
+        }
 
-      system.fine_to_coarse(Enthnew, i, j, m_work);
-    }
+        if (skip_steady) {
+          steady(i, j).valid = false;
+        }
+      }
+
+      if (age) {
+        age->flush(thread);
+      }
+
+      liquified_count_tile[tile.index]          = liquified_count;
+      reduced_accuracy_counter_tile[tile.index] = reduced_accuracy_counter;
+      bulge_counter_tile[tile.index]            = bulge_counter;
+      levels_tile[tile.index]                   = levels;
+    });
   } catch (...) {
     loop.failed();
   }
   loop.check();
 
+  if (age) {
+    age->finish();
+  }
+
+  if (ch) {
+    ch->finish();
+  }
+
+  unsigned int liquifiedCount = 0;
+  double levels = 0.0;
+  for (unsigned int k = 0; k < tiles.size(); ++k) {
+    liquifiedCount                   += liquified_count_tile[k];
+    m_stats.reduced_accuracy_counter += reduced_accuracy_counter_tile[k];
+    m_stats.bulge_counter            += bulge_counter_tile[k];
+    levels                           += levels_tile[k];
+  }
+
+  // Approximate work per fine grid level in an assembled column: about 60 flops
+  // (interpolation to the fine grid, assembly, solution and post-processing), reading 9
+  // values (enthalpy in the column and its four neighbors, three velocity components and
+  // the strain heating) and writing 1.
+  profiling.add_work(region, 60.0 * levels, 8.0 * 10 * levels);
+
   m_stats.liquified_ice_volume = ((double) liquifiedCount) * dz * m_grid->cell_area();
 }
 
+EnthalpyModel::SteadyColumn::SteadyColumn()
+  : ks(0), surface_temp(0.0), floating(false), wet(false),
+    rate(0.0), elapsed(0.0), valid(false) {
+  // empty
+}
+
+/*!
+ * Returns true if a column in the state `current` can be skipped during a time step of
+ * length `dt`.
+ *
+ * A column can be skipped if it has the same number of levels of ice, the same surface
+ * temperature and the same type of the basal boundary condition as during its last
+ * update and if its enthalpy change estimated using the rate of change during the last
+ * update is below `tolerance`. Columns are updated at least every `max_interval` seconds.
+ */
+bool EnthalpyModel::SteadyColumn::skip(const SteadyColumn &current, double dt,
+                                       double tolerance, double max_interval) const {
+  const double T = elapsed + dt;
+
+  return (valid and
+          ks == current.ks and
+          surface_temp == current.surface_temp and
+          floating == current.floating and
+          wet == current.wet and
+          T <= max_interval and
+          rate * T < tolerance);
+}
+
+bool EnthalpyModel::supports_age_model_impl() const {
+  return true;
+}
+
+bool EnthalpyModel::supports_ch_system_impl() const {
+  return true;
+}
+
 void EnthalpyModel::define_model_state_impl(const File &output) const {
   m_ice_enthalpy.define(output);
   m_basal_melt_rate.define(output);
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -21,6 +21,7 @@
 #define ENTHALPYMODEL_H
 
 #include "EnergyModel.hh"
+#include "pism/util/ActiveCellList.hh"
 
 namespace pism {
 namespace energy {
@@ -50,6 +51,36 @@ protected:
 
   virtual void define_model_state_impl(const File &output) const;
   virtual void write_model_state_impl(const File &output) const;
+
+  virtual bool supports_age_model_impl() const;
+  virtual bool supports_ch_system_impl() const;
+
+  ActiveCellList m_active_cells;
+
+  //! Properties of a column recorded during its last update, used to skip (nearly)
+  //! steady columns (see `energy.enthalpy.steady_column.tolerance`).
+  struct SteadyColumn {
+    SteadyColumn();
+
+    bool skip(const SteadyColumn &current, double dt,
+              double tolerance, double max_interval) const;
+
+    //! number of fine grid levels in the ice
+    unsigned int ks;
+    double surface_temp;
+    bool floating;
+    //! true if there is subglacial water
+    bool wet;
+    //! maximum rate of change of enthalpy during the last update, J kg-1 s-1
+    double rate;
+    //! time since the last update, in seconds
+    double elapsed;
+    bool valid;
+  };
+
+  //! states of columns in the sub-domain owned by this process (if
+  //! `energy.enthalpy.steady_column.tolerance` is positive)
+  std::vector<SteadyColumn> m_steady_columns;
 };
 
 /*! @brief The "dummy" energy balance model. Reads in enthalpy from a file, but does not update it. */
@@ -70,6 +101,8 @@ protected:
 
   using EnergyModel::update_impl;
   void update_impl(double t, double dt, const Inputs &inputs);
+
+  bool supports_age_model_impl() const;
 };
 
 } // end of namespace energy
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -18,6 +18,7 @@
  */
 
 #include <cmath>
+#include <algorithm>            // std::min
 
 #include "pism/energy/bootstrapping.hh"
 
@@ -60,5 +61,53 @@ double ice_temperature_guess_smb(EnthalpyConverter::Ptr EC,
   }
 }
 
+void ice_temperature_guess(const EnthalpyConverter &EC,
+                           double H, const double *z, unsigned int n,
+                           double T_surface, double G, double ice_k,
+                           double *result) {
+  const double
+    beta  = (4.0/21.0) * (G / (2.0 * ice_k * H * H * H)),
+    alpha = (G / (2.0 * H * ice_k)) - 2.0 * H * H * beta;
+
+  for (unsigned int k = 0; k < n; ++k) {
+    const double
+      depth = H - z[k],
+      d2    = depth * depth,
+      Tpmp  = EC.melting_temperature(EC.pressure(depth));
+
+    result[k] = std::min(Tpmp, T_surface + alpha * d2 + beta * d2 * d2);
+  }
+}
+
+void ice_temperature_guess_smb(const EnthalpyConverter &EC,
+                               double H, const double *z, unsigned int n,
+                               double T_surface, double G, double ice_k, double K, double SMB,
+                               double *result) {
+  if (SMB <= 0.0) {
+    // negative or zero surface mass balance: linear temperature profile
+    for (unsigned int k = 0; k < n; ++k) {
+      const double
+        depth = H - z[k],
+        Tpmp  = EC.melting_temperature(EC.pressure(depth));
+
+      result[k] = std::min(Tpmp, G / ice_k * depth + T_surface);
+    }
+  } else {
+    // positive surface mass balance
+    const double
+      C0     = (G * sqrt(M_PI * H * K)) / (ice_k * sqrt(2.0 * SMB)),
+      gamma0 = sqrt(SMB * H / (2.0 * K)),
+      erf0   = erf(gamma0);
+
+    for (unsigned int k = 0; k < n; ++k) {
+      const double
+        depth = H - z[k],
+        Tpmp  = EC.melting_temperature(EC.pressure(depth));
+
+      result[k] = std::min(Tpmp, T_surface + C0 * (erf0 - erf(gamma0 * z[k] / H)));
+    }
+  }
+}
+
 } // end of namespace energy
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -62,6 +62,21 @@ double ice_temperature_guess_smb(EnthalpyConverter::Ptr EC,
                                  double H, double z, double T_surface,
                                  double G, double ice_k, double K, double SMB);
 
+/*!
+ * Column versions of ice_temperature_guess() and ice_temperature_guess_smb(): compute
+ * temperatures at `n` levels `z` (all within the ice), evaluating column-wise constants
+ * once.
+ */
+void ice_temperature_guess(const EnthalpyConverter &EC,
+                           double H, const double *z, unsigned int n,
+                           double T_surface, double G, double ice_k,
+                           double *result);
+
+void ice_temperature_guess_smb(const EnthalpyConverter &EC,
+                               double H, const double *z, unsigned int n,
+                               double T_surface, double G, double ice_k, double K, double SMB,
+                               double *result);
+
 } // end of namespace energy
 } // end of namespace pism
 
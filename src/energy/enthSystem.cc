@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2018 Andreas Aschwanden and Ed Bueler and Constantine Khroulev
+// Copyright (C) 2009-2018, 2020 Andreas Aschwanden and Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -16,6 +16,8 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cassert>
+
 #include "enthSystem.hh"
 #include <gsl/gsl_math.h>       // GSL_NAN, gsl_isnan()
 #include "pism/util/ConfigInterface.hh"
@@ -43,6 +45,8 @@ enthSystemCtx::enthSystemCtx(const std::vector<double>& storage_grid,
   m_strain_heating3(strain_heating3),
   m_EC(EC) {
 
+  m_strain_heating_on_velocity_levels = (strain_heating3.levels().size() != storage_grid.size());
+
   // set some values so we can check if init was called
   m_R_cold   = -1.0;
   m_R_temp   = -1.0;
@@ -120,24 +124,53 @@ void enthSystemCtx::init(int i, int j, bool marginal, double ice_thickness) {
     return;
   }
 
-  coarse_to_fine(m_u3, m_i, m_j, &m_u[0]);
-  coarse_to_fine(m_v3, m_i, m_j, &m_v[0]);
+  velocity_to_fine(m_u3, m_i, m_j, &m_u[0]);
+  velocity_to_fine(m_v3, m_i, m_j, &m_v[0]);
 
   if (m_marginal and m_exclude_vertical_advection) {
     for (unsigned int k = 0; k < m_w.size(); ++k) {
       m_w[k] = 0.0;
     }
   } else {
-    coarse_to_fine(m_w3, m_i, m_j, &m_w[0]);
+    velocity_to_fine(m_w3, m_i, m_j, &m_w[0]);
   }
 
-  coarse_to_fine(m_strain_heating3, m_i, m_j, &m_strain_heating[0]);
-  coarse_to_fine(m_Enth3, m_i, m_j, &m_Enth[0]);
+  init_enthalpy();
+}
+
+/*!
+ * Initialize using ice velocity on the fine grid from `velocity`, a system initialized
+ * for the same column and using the same marginal-column settings (see
+ * columnSystemCtx::copy_velocity()).
+ */
+void enthSystemCtx::init(int i, int j, bool marginal, double ice_thickness,
+                         const enthSystemCtx &velocity) {
+  m_ice_thickness = ice_thickness;
+
+  m_marginal = marginal;
+
+  init_column(i, j, m_ice_thickness);
+
+  if (m_ks == 0) {
+    return;
+  }
 
-  coarse_to_fine(m_Enth3, m_i, m_j+1, &m_E_n[0]);
-  coarse_to_fine(m_Enth3, m_i+1, m_j, &m_E_e[0]);
-  coarse_to_fine(m_Enth3, m_i, m_j-1, &m_E_s[0]);
-  coarse_to_fine(m_Enth3, m_i-1, m_j, &m_E_w[0]);
+  // the vertical velocity in `velocity` is zero if (and only if) it is zero here
+  assert(velocity.vertical_advection_excluded() == vertical_advection_excluded());
+  copy_velocity(velocity, true);
+
+  init_enthalpy();
+}
+
+//! Interpolate enthalpy and strain heating and compute coefficients that depend on them.
+void enthSystemCtx::init_enthalpy() {
+  if (m_strain_heating_on_velocity_levels) {
+    velocity_to_fine(m_strain_heating3, m_i, m_j, &m_strain_heating[0]);
+  } else {
+    coarse_to_fine(m_strain_heating3, m_i, m_j, &m_strain_heating[0]);
+  }
+  coarse_to_fine(m_Enth3, m_i, m_j,
+                 &m_Enth[0], &m_E_n[0], &m_E_e[0], &m_E_s[0], &m_E_w[0]);
 
   compute_enthalpy_CTS();
 
@@ -480,6 +513,51 @@ void enthSystemCtx::solve(std::vector<double> &x) {
 
   TridiagonalSystem &S = *m_solver;
 
+  assemble(&S.L(0), &S.D(0), &S.U(0), &S.RHS(0), 1);
+
+  // Solve it; note drainage is not addressed yet and post-processing may occur
+  try {
+    S.solve(m_ks + 1, x);
+  }
+  catch (RuntimeError &e) {
+    e.add_context("solving the tri-diagonal system (enthSystemCtx) at (%d,%d)\n"
+                  "saving system to m-file... ", m_i, m_j);
+    reportColumnZeroPivotErrorMFile(m_ks + 1);
+    throw;
+  }
+
+  finish(x);
+}
+
+//! Set up the system in the lane `lane` of a batch, to be solved using
+//! TridiagonalSystemBatch::solve().
+/*!
+ * Use get_solution() to retrieve the result. The system will be identical to the one
+ * solved by solve().
+ */
+void enthSystemCtx::assemble(TridiagonalSystemBatch &batch, unsigned int lane) {
+  const unsigned int W = batch.batch_size();
+
+  assemble(&batch.L(0, lane), &batch.D(0, lane), &batch.U(0, lane), &batch.RHS(0, lane), W);
+
+  batch.set_size(lane, m_ks + 1);
+}
+
+//! Copy the solution of the system in the lane `lane` of a batch to `x`.
+void enthSystemCtx::get_solution(const TridiagonalSystemBatch &batch, unsigned int lane,
+                                 std::vector<double> &x) {
+  x.resize(m_z.size());
+
+  for (unsigned int k = 0; k <= m_ks; ++k) {
+    x[k] = batch.x(k, lane);
+  }
+
+  finish(x);
+}
+
+//! Set up the tridiagonal system. Row `k` is stored at `k * stride`.
+void enthSystemCtx::assemble(double *L, double *D, double *U, double *RHS, unsigned int stride) {
+
 #if (Pism_DEBUG==1)
   checkReadyToSolve();
   if (gsl_isnan(m_D0) || gsl_isnan(m_U0) || gsl_isnan(m_B0)) {
@@ -491,9 +569,9 @@ void enthSystemCtx::solve(std::vector<double> &x) {
 
   // k=0 equation is already established
   // L[0] = 0.0;  // not used
-  S.D(0)   = m_D0;
-  S.U(0)   = m_U0;
-  S.RHS(0) = m_B0;
+  D[0]   = m_D0;
+  U[0]   = m_U0;
+  RHS[0] = m_B0;
 
   const double
     one_over_rho = 1.0 / m_ice_density,
@@ -515,9 +593,9 @@ void enthSystemCtx::solve(std::vector<double> &x) {
       A_d = m_w[k] >= 0.0 ? 1.0 - m_lambda : m_lambda - 1.0,
       A_u = m_w[k] >= 0.0 ? 0.5 * m_lambda : 1.0 - 0.5 * m_lambda;
 
-    S.L(k) = - Rminus + nu_w * A_l;
-    S.D(k) = 1.0 + Rminus + Rplus + nu_w * A_d;
-    S.U(k) = - Rplus + nu_w * A_u;
+    L[k * stride] = - Rminus + nu_w * A_l;
+    D[k * stride] = 1.0 + Rminus + Rplus + nu_w * A_d;
+    U[k * stride] = - Rplus + nu_w * A_u;
 
     // horizontal velocity and strain heating
     double upwind_u = 0.0;
@@ -531,31 +609,23 @@ void enthSystemCtx::solve(std::vector<double> &x) {
       Sigma    = m_strain_heating[k];
     }
 
-    S.RHS(k) = m_Enth[k] + m_dt * (one_over_rho * Sigma - upwind_u - upwind_v);
+    RHS[k * stride] = m_Enth[k] + m_dt * (one_over_rho * Sigma - upwind_u - upwind_v);
   }
 
   // Assemble the top surface equation. Values m_{L,D,U,B}_ks are set using set_surface_dirichlet()
   // or set_surface_heat_flux().
   if (m_ks > 0) {
-    S.L(m_ks) = m_L_ks;
+    L[m_ks * stride] = m_L_ks;
   }
-  S.D(m_ks) = m_D_ks;
+  D[m_ks * stride] = m_D_ks;
   if (m_ks < m_z.size() - 1) {
-    S.U(m_ks) = m_U_ks;
-  }
-  S.RHS(m_ks) = m_B_ks;
-
-  // Solve it; note drainage is not addressed yet and post-processing may occur
-  try {
-    S.solve(m_ks + 1, x);
-  }
-  catch (RuntimeError &e) {
-    e.add_context("solving the tri-diagonal system (enthSystemCtx) at (%d,%d)\n"
-                  "saving system to m-file... ", m_i, m_j);
-    reportColumnZeroPivotErrorMFile(m_ks + 1);
-    throw;
+    U[m_ks * stride] = m_U_ks;
   }
+  RHS[m_ks * stride] = m_B_ks;
+}
 
+//! Set enthalpy above the ice and mark the column as done.
+void enthSystemCtx::finish(std::vector<double> &x) {
   // air above
   for (unsigned int k = m_ks+1; k < x.size(); k++) {
     x[k] = m_B_ks;
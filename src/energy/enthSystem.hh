@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016, 2017, 2018 Andreas Aschwanden and Ed Bueler
+// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016, 2017, 2018, 2020 Andreas Aschwanden and Ed Bueler
 //
 // This file is part of PISM.
 //
@@ -52,6 +52,8 @@ public:
   ~enthSystemCtx();
 
   void init(int i, int j, bool ismarginal, double ice_thickness);
+  void init(int i, int j, bool ismarginal, double ice_thickness,
+            const enthSystemCtx &velocity);
 
   double k_from_T(double T) const;
 
@@ -67,10 +69,19 @@ public:
 
   void solve(std::vector<double> &result);
 
+  void assemble(TridiagonalSystemBatch &batch, unsigned int lane);
+  void get_solution(const TridiagonalSystemBatch &batch, unsigned int lane,
+                    std::vector<double> &result);
+
   double lambda() const {
     return m_lambda;
   }
 
+  //! True if the vertical velocity in the current column was replaced by zero.
+  bool vertical_advection_excluded() const {
+    return m_marginal and m_exclude_vertical_advection;
+  }
+
   double Enth(size_t i) const {
     return m_Enth[i];
   }
@@ -108,12 +119,17 @@ protected:
   bool m_exclude_strain_heat;
 
   const IceModelVec3 &m_Enth3, &m_strain_heating3;
+  //! true if strain heating uses levels of 3D velocity (see stress_balance.Mz)
+  bool m_strain_heating_on_velocity_levels;
   EnthalpyConverter::Ptr m_EC;  // conductivity has known dependence on T, not enthalpy
 
+  void init_enthalpy();
   void compute_enthalpy_CTS();
   double compute_lambda();
 
   void assemble_R();
+  void assemble(double *L, double *D, double *U, double *RHS, unsigned int stride);
+  void finish(std::vector<double> &result);
   void checkReadyToSolve();
 };
 
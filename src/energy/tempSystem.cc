@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2011, 2013, 2014, 2015, 2016, 2017, 2018 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2011, 2013, 2014, 2015, 2016, 2017, 2018, 2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -41,6 +41,8 @@ tempSystemCtx::tempSystemCtx(const std::vector<double>& storage_grid,
     m_T3(T3),
     m_strain_heating3(strain_heating3) {
 
+  m_strain_heating_on_velocity_levels = (strain_heating3.levels().size() != storage_grid.size());
+
   // set flags to indicate nothing yet set
   m_surfBCsValid      = false;
   m_basalBCsValid     = false;
@@ -78,16 +80,16 @@ void tempSystemCtx::initThisColumn(int i, int j, bool is_marginal, MaskValue mas
     return;
   }
 
-  coarse_to_fine(m_u3, m_i, m_j, &m_u[0]);
-  coarse_to_fine(m_v3, m_i, m_j, &m_v[0]);
-  coarse_to_fine(m_w3, m_i, m_j, &m_w[0]);
-  coarse_to_fine(m_strain_heating3, m_i, m_j, &m_strain_heating[0]);
-  coarse_to_fine(m_T3, m_i, m_j, &m_T[0]);
-
-  coarse_to_fine(m_T3, m_i, m_j+1, &m_T_n[0]);
-  coarse_to_fine(m_T3, m_i+1, m_j, &m_T_e[0]);
-  coarse_to_fine(m_T3, m_i, m_j-1, &m_T_s[0]);
-  coarse_to_fine(m_T3, m_i-1, m_j, &m_T_w[0]);
+  velocity_to_fine(m_u3, m_i, m_j, &m_u[0]);
+  velocity_to_fine(m_v3, m_i, m_j, &m_v[0]);
+  velocity_to_fine(m_w3, m_i, m_j, &m_w[0]);
+  if (m_strain_heating_on_velocity_levels) {
+    velocity_to_fine(m_strain_heating3, m_i, m_j, &m_strain_heating[0]);
+  } else {
+    coarse_to_fine(m_strain_heating3, m_i, m_j, &m_strain_heating[0]);
+  }
+  coarse_to_fine(m_T3, m_i, m_j,
+                 &m_T[0], &m_T_n[0], &m_T_e[0], &m_T_s[0], &m_T_w[0]);
 
   m_lambda = compute_lambda();
 }
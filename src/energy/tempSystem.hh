@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2011, 2013, 2014, 2015, 2017 Ed Bueler
+// Copyright (C) 2009-2011, 2013, 2014, 2015, 2017, 2020 Ed Bueler
 //
 // This file is part of PISM.
 //
@@ -79,6 +79,8 @@ public:
 protected:
   double m_ice_density, m_ice_c, m_ice_k;
   const IceModelVec3 &m_T3, &m_strain_heating3;
+  //! true if strain heating uses levels of 3D velocity (see stress_balance.Mz)
+  bool m_strain_heating_on_velocity_levels;
 
   std::vector<double>  m_T, m_strain_heating;
   std::vector<double> m_T_n, m_T_e, m_T_s, m_T_w;
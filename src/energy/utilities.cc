@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -82,6 +82,8 @@ void compute_temperature(const IceModelVec3 &enthalpy,
   const unsigned int Mz = grid->Mz();
   const std::vector<double> &z = grid->z();
 
+  std::vector<double> P(Mz);     // pressure in a column
+
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
@@ -92,8 +94,10 @@ void compute_temperature(const IceModelVec3 &enthalpy,
 
     for (unsigned int k = 0; k < Mz; ++k) {
       const double depth = H - z[k]; // FIXME issue #15
-      T[k] = EC->temperature(E[k], EC->pressure(depth));
+      P[k] = EC->pressure(depth);
     }
+
+    EC->temperature(E, P.data(), Mz, T);
   }
 
   result.inc_state_counter();
@@ -150,6 +154,9 @@ void compute_liquid_water_fraction(const IceModelVec3 &enthalpy,
 
   IceModelVec::AccessList list{&result, &enthalpy, &ice_thickness};
 
+  const unsigned int Mz = grid->Mz();
+  std::vector<double> P(Mz);     // pressure in a column
+
   ParallelSection loop(grid->com);
   try {
     for (Points p(*grid); p; p.next()) {
@@ -158,10 +165,12 @@ void compute_liquid_water_fraction(const IceModelVec3 &enthalpy,
       const double *Enthij = enthalpy.get_column(i,j);
       double *omegaij = result.get_column(i,j);
 
-      for (unsigned int k=0; k < grid->Mz(); ++k) {
+      for (unsigned int k=0; k < Mz; ++k) {
         const double depth = ice_thickness(i,j) - grid->z(k); // FIXME issue #15
-        omegaij[k] = EC->water_fraction(Enthij[k],EC->pressure(depth));
+        P[k] = EC->pressure(depth);
       }
+
+      EC->water_fraction(Enthij, P.data(), Mz, omegaij);
     }
   } catch (...) {
     loop.failed();
@@ -261,6 +270,94 @@ double total_ice_enthalpy(double thickness_threshold,
 }
 
 //! Create a temperature field within the ice from provided ice thickness, surface temperature, surface mass balance, and geothermal flux.
+//! Parameters of the bootstrapping heuristic (see bootstrap_ice_temperature()).
+struct BootstrappingParameters {
+  BootstrappingParameters(const Config &config, const Logger &log) {
+    use_smb = config.get_string("bootstrapping.temperature_heuristic") == "smb";
+
+    if (use_smb) {
+      log.message(2,
+                  " - Filling 3D ice temperatures using surface temperature"
+                  " (and mass balance for velocity estimate)...\n");
+
+    } else {
+      log.message(2,
+                  " - Filling 3D ice temperatures using surface temperature"
+                  " (and a quartic guess without SMB)...\n");
+    }
+
+    ice_k       = config.get_number("constants.ice.thermal_conductivity");
+    ice_density = config.get_number("constants.ice.density");
+    K           = ice_k / (ice_density * config.get_number("constants.ice.specific_heat_capacity"));
+    T_min       = config.get_number("energy.minimum_allowed_temperature");
+    T_melting   = config.get_number("constants.fresh_water.melting_point_temperature",
+                                    "Kelvin");
+  }
+
+  bool use_smb;
+  double ice_k, ice_density, K, T_min, T_melting;
+};
+
+//! Fill the ice temperature column `T` at the grid point `(i, j)`.
+static void bootstrap_temperature_column(const BootstrappingParameters &p,
+                                         const EnthalpyConverter &EC,
+                                         const IceGrid &grid,
+                                         int i, int j,
+                                         const IceModelVec2S &ice_thickness,
+                                         const IceModelVec2S &ice_surface_temp,
+                                         const IceModelVec2S &surface_mass_balance,
+                                         const IceModelVec2S &basal_heat_flux,
+                                         double *T) {
+  const double
+    T_surface = std::min(ice_surface_temp(i, j), p.T_melting),
+    H         = ice_thickness(i, j),
+    G         = basal_heat_flux(i, j);
+
+  if (G < 0.0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "geothermal flux G(%d,%d) = %f < 0.0 %s",
+                                  i, j, G,
+                                  basal_heat_flux.metadata().get_string("units").c_str());
+  }
+
+  if (T_surface < p.T_min) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "T_surface(%d,%d) = %f < T_min = %f Kelvin",
+                                  i, j, T_surface, p.T_min);
+  }
+
+  const unsigned int ks = grid.kBelowHeight(H);
+  const double *z = grid.z().data();
+
+  // within ice
+  if (p.use_smb) { // method 1:  includes surface mass balance in estimate
+
+    // Convert SMB from "kg m-2 s-1" to "m second-1".
+    const double SMB = surface_mass_balance(i, j) / p.ice_density;
+
+    ice_temperature_guess_smb(EC, H, z, ks, T_surface, G, p.ice_k, p.K, SMB, T);
+
+  } else { // method 2: a quartic guess; does not use SMB
+
+    ice_temperature_guess(EC, H, z, ks, T_surface, G, p.ice_k, T);
+
+  }
+
+  // Make sure that resulting temperatures are not too low.
+  for (unsigned int k = 0; k < ks; k++) {
+    if (T[k] < p.T_min) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "T(%d,%d,%d) = %f < T_min = %f Kelvin",
+                                    i, j, k, T[k], p.T_min);
+    }
+  }
+
+  // above ice
+  for (unsigned int k = ks; k < grid.Mz(); k++) {
+    T[k] = T_surface;
+  }
+}
+
 /*!
 In bootstrapping we need to determine initial values for the temperature within
 the ice (and the bedrock).  There are various data available at bootstrapping,
@@ -335,31 +432,9 @@ void bootstrap_ice_temperature(const IceModelVec2S &ice_thickness,
 
   IceGrid::ConstPtr      grid   = result.grid();
   Context::ConstPtr      ctx    = grid->ctx();
-  Config::ConstPtr       config = ctx->config();
-  Logger::ConstPtr       log    = ctx->log();
   EnthalpyConverter::Ptr EC     = ctx->enthalpy_converter();
 
-  const bool use_smb  = config->get_string("bootstrapping.temperature_heuristic") == "smb";
-
-  if (use_smb) {
-    log->message(2,
-                 " - Filling 3D ice temperatures using surface temperature"
-                 " (and mass balance for velocity estimate)...\n");
-
-  } else {
-    log->message(2,
-                 " - Filling 3D ice temperatures using surface temperature"
-                 " (and a quartic guess without SMB)...\n");
-  }
-
-  const double
-    ice_k       = config->get_number("constants.ice.thermal_conductivity"),
-    ice_density = config->get_number("constants.ice.density"),
-    ice_c       = config->get_number("constants.ice.specific_heat_capacity"),
-    K           = ice_k / (ice_density * ice_c),
-    T_min       = config->get_number("energy.minimum_allowed_temperature"),
-    T_melting   = config->get_number("constants.fresh_water.melting_point_temperature",
-                                     "Kelvin");
+  BootstrappingParameters parameters(*ctx->config(), *ctx->log());
 
   IceModelVec::AccessList list{&ice_surface_temp, &surface_mass_balance,
       &ice_thickness, &basal_heat_flux, &result};
@@ -369,81 +444,71 @@ void bootstrap_ice_temperature(const IceModelVec2S &ice_thickness,
     for (Points p(*grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      const double
-        T_surface = std::min(ice_surface_temp(i, j), T_melting),
-        H         = ice_thickness(i, j),
-        G         = basal_heat_flux(i, j);
-
-      if (G < 0.0) {
-        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                      "geothermal flux G(%d,%d) = %f < 0.0 %s",
-                                      i, j, G,
-                                      basal_heat_flux.metadata().get_string("units").c_str());
-      }
+      bootstrap_temperature_column(parameters, *EC, *grid, i, j,
+                                   ice_thickness, ice_surface_temp,
+                                   surface_mass_balance, basal_heat_flux,
+                                   result.get_column(i, j));
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
 
-      if (T_surface < T_min) {
-        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                      "T_surface(%d,%d) = %f < T_min = %f Kelvin",
-                                      i, j, T_surface, T_min);
-      }
+  result.update_ghosts();
+}
 
-      const unsigned int ks = grid->kBelowHeight(H);
+/*!
+ * Fill the ice enthalpy using the heuristic of bootstrap_ice_temperature() and zero liquid
+ * water fraction (as in compute_enthalpy_cold()).
+ *
+ * Computes enthalpy column by column in one pass, so that the temperature of a column is
+ * converted while it is still in cache.
+ */
+void bootstrap_ice_enthalpy(const IceModelVec2S &ice_thickness,
+                            const IceModelVec2S &ice_surface_temp,
+                            const IceModelVec2S &surface_mass_balance,
+                            const IceModelVec2S &basal_heat_flux,
+                            IceModelVec3 &result) {
 
-      double *T = result.get_column(i, j);
+  IceGrid::ConstPtr      grid   = result.grid();
+  Context::ConstPtr      ctx    = grid->ctx();
+  EnthalpyConverter::Ptr EC     = ctx->enthalpy_converter();
 
-      // within ice
-      if (use_smb) { // method 1:  includes surface mass balance in estimate
+  BootstrappingParameters parameters(*ctx->config(), *ctx->log());
 
-        // Convert SMB from "kg m-2 s-1" to "m second-1".
-        const double SMB = surface_mass_balance(i, j) / ice_density;
+  const unsigned int Mz = grid->Mz();
+  const std::vector<double> &z = grid->z();
 
-        for (unsigned int k = 0; k < ks; k++) {
-          const double z = grid->z(k);
-          T[k] = ice_temperature_guess_smb(EC, H, z, T_surface, G, ice_k, K, SMB);
-        }
+  std::vector<double> T(Mz), P(Mz);
 
-      } else { // method 2: a quartic guess; does not use SMB
+  IceModelVec::AccessList list{&ice_surface_temp, &surface_mass_balance,
+      &ice_thickness, &basal_heat_flux, &result};
 
-        for (unsigned int k = 0; k < ks; k++) {
-          const double z = grid->z(k);
-          T[k] = ice_temperature_guess(EC, H, z, T_surface, G, ice_k);
-        }
+  ParallelSection loop(grid->com);
+  try {
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
 
-      }
+      bootstrap_temperature_column(parameters, *EC, *grid, i, j,
+                                   ice_thickness, ice_surface_temp,
+                                   surface_mass_balance, basal_heat_flux,
+                                   T.data());
 
-      // Make sure that resulting temperatures are not too low.
-      for (unsigned int k = 0; k < ks; k++) {
-        if (T[k] < T_min) {
-          throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                        "T(%d,%d,%d) = %f < T_min = %f Kelvin",
-                                        i, j, k, T[k], T_min);
-        }
+      const double H = ice_thickness(i, j);
+      for (unsigned int k = 0; k < Mz; ++k) {
+        P[k] = EC->pressure(H - z[k]); // FIXME issue #15
       }
 
-      // above ice
-      for (unsigned int k = ks; k < grid->Mz(); k++) {
-        T[k] = T_surface;
-      }
+      EC->enthalpy_permissive(T.data(), P.data(), Mz, result.get_column(i, j));
     }
   } catch (...) {
     loop.failed();
   }
   loop.check();
 
-  result.update_ghosts();
-}
-
-void bootstrap_ice_enthalpy(const IceModelVec2S &ice_thickness,
-                            const IceModelVec2S &ice_surface_temp,
-                            const IceModelVec2S &surface_mass_balance,
-                            const IceModelVec2S &basal_heat_flux,
-                            IceModelVec3 &result) {
-
-  bootstrap_ice_temperature(ice_thickness, ice_surface_temp,
-                            surface_mass_balance, basal_heat_flux,
-                            result);
+  result.inc_state_counter();
 
-  compute_enthalpy_cold(result, ice_thickness, result);
+  result.update_ghosts();
 }
 
 } // end of namespace energy
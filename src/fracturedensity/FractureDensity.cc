@@ -22,6 +22,7 @@
 #include "pism/stressbalance/StressBalance.hh"
 #include "pism/util/pism_options.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/GhostUpdateBatch.hh"
 
 namespace pism {
 
@@ -85,6 +86,47 @@ FractureDensity::FractureDensity(IceGrid::ConstPtr grid,
   m_deviatoric_stresses.set_attrs("internal",
                                   "deviatoric shear stress",
                                   "Pa", "Pa", "", 2);
+
+  //options
+  /////////////////////////////////////////////////////////
+  m_soft_residual = options::Real("-fracture_softening", "soft_residual", 1.0);
+  // assume linear response function: E_fr = (1-(1-soft_residual)*phi) -> 1-phi
+  //
+  // more: T. Albrecht, A. Levermann; Fracture-induced softening for
+  // large-scale ice dynamics; (2013), The Cryosphere Discussions 7;
+  // 4501-4544; DOI:10.5194/tcd-7-4501-2013
+
+  // get four options for calculation of fracture density.
+  // 1st: fracture growth constant gamma
+  // 2nd: fracture initiation stress threshold sigma_cr
+  // 3rd: healing rate constant gamma_h
+  // 4th: healing strain rate threshold
+  // more: T. Albrecht, A. Levermann; Fracture field for large-scale
+  // ice dynamics; (2012), Journal of Glaciology, Vol. 58, No. 207,
+  // 165-176, DOI: 10.3189/2012JoG11J191.
+
+  m_gamma                = 1.0;
+  m_initiation_threshold = 7.0e4;
+  m_gamma_healing        = 0.0;
+  m_healing_threshold    = 2.0e-10;
+  {
+    options::RealList fractures("-fracture_parameters",
+                                "gamma, initThreshold, gammaheal, healThreshold",
+                                {m_gamma, m_initiation_threshold,
+                                 m_gamma_healing, m_healing_threshold});
+    if (fractures->size() != 4) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "option -fracture_parameters requires exactly 4 arguments");
+    }
+    m_gamma                = fractures[0];
+    m_initiation_threshold = fractures[1];
+    m_gamma_healing        = fractures[2];
+    m_healing_threshold    = fractures[3];
+  }
+
+  m_log->message(3, "PISM-PIK INFO: fracture density is found with parameters:\n"
+                    " gamma=%.2f, sigma_cr=%.2f, gammah=%.2f, healing_cr=%.1e and soft_res=%f \n",
+                 m_gamma, m_initiation_threshold, m_gamma_healing, m_healing_threshold,
+                 m_soft_residual);
 }
 
 FractureDensity::~FractureDensity() {
@@ -131,23 +173,15 @@ void FractureDensity::write_model_state_impl(const File &output) const {
   m_age.write(output);
 }
 
+/*!
+ * Update the fracture density using strain rates and deviatoric stresses computed from
+ * `velocity` and the vertically-averaged ice `hardness`.
+ */
 void FractureDensity::update(double dt,
                              const Geometry &geometry,
                              const IceModelVec2V &velocity,
                              const IceModelVec2S &hardness,
                              const IceModelVec2S &bc_mask) {
-  const double
-    dx = m_grid->dx(),
-    dy = m_grid->dy();
-  const int
-    Mx = m_grid->Mx(),
-    My = m_grid->My();
-
-  IceModelVec2S
-    &D     = m_density,
-    &D_new = m_density_new,
-    &A     = m_age,
-    &A_new = m_age_new;
 
   m_velocity.copy_from(velocity);
 
@@ -161,48 +195,45 @@ void FractureDensity::update(double dt,
                                      geometry.cell_type,
                                      m_deviatoric_stresses);
 
-  IceModelVec::AccessList list{&m_velocity, &m_strain_rates, &m_deviatoric_stresses,
-                               &D, &D_new, &geometry.cell_type, &bc_mask, &A, &A_new,
-                               &m_growth_rate, &m_healing_rate, &m_flow_enhancement,
-                               &m_toughness};
-
-  D_new.copy_from(D);
-
-  //options
-  /////////////////////////////////////////////////////////
-  double soft_residual = options::Real("-fracture_softening", "soft_residual", 1.0);
-  // assume linear response function: E_fr = (1-(1-soft_residual)*phi) -> 1-phi
-  //
-  // more: T. Albrecht, A. Levermann; Fracture-induced softening for
-  // large-scale ice dynamics; (2013), The Cryosphere Discussions 7;
-  // 4501-4544; DOI:10.5194/tcd-7-4501-2013
+  update(dt, geometry, velocity, m_strain_rates, m_deviatoric_stresses, bc_mask);
+}
 
-  // get four options for calculation of fracture density.
-  // 1st: fracture growth constant gamma
-  // 2nd: fracture initiation stress threshold sigma_cr
-  // 3rd: healing rate constant gamma_h
-  // 4th: healing strain rate threshold
-  // more: T. Albrecht, A. Levermann; Fracture field for large-scale
-  // ice dynamics; (2012), Journal of Glaciology, Vol. 58, No. 207,
-  // 165-176, DOI: 10.3189/2012JoG11J191.
+/*!
+ * Update the fracture density using precomputed principal strain rates and deviatoric
+ * stresses (see stressbalance::StressBalance::principal_strain_rates() and
+ * stressbalance::StressBalance::deviatoric_stresses()).
+ */
+void FractureDensity::update(double dt,
+                             const Geometry &geometry,
+                             const IceModelVec2V &velocity,
+                             const IceModelVec2 &strain_rates,
+                             const IceModelVec2 &deviatoric_stresses,
+                             const IceModelVec2S &bc_mask) {
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy();
+  const int
+    Mx = m_grid->Mx(),
+    My = m_grid->My();
 
-  double gamma = 1.0, initThreshold = 7.0e4, gammaheal = 0.0, healThreshold = 2.0e-10;
-  {
-    options::RealList fractures("-fracture_parameters",
-                                "gamma, initThreshold, gammaheal, healThreshold",
-                                {gamma, initThreshold, gammaheal, healThreshold});
-    if (fractures->size() != 4) {
-      throw RuntimeError(PISM_ERROR_LOCATION, "option -fracture_parameters requires exactly 4 arguments");
-    }
-    gamma         = fractures[0];
-    initThreshold = fractures[1];
-    gammaheal     = fractures[2];
-    healThreshold = fractures[3];
-  }
+  IceModelVec2S
+    &D     = m_density,
+    &D_new = m_density_new,
+    &A     = m_age,
+    &A_new = m_age_new;
 
-  m_log->message(3, "PISM-PIK INFO: fracture density is found with parameters:\n"
-                    " gamma=%.2f, sigma_cr=%.2f, gammah=%.2f, healing_cr=%.1e and soft_res=%f \n",
-                 gamma, initThreshold, gammaheal, healThreshold, soft_residual);
+  const double
+    soft_residual = m_soft_residual,
+    gamma         = m_gamma,
+    initThreshold = m_initiation_threshold,
+    gammaheal     = m_gamma_healing,
+    healThreshold = m_healing_threshold;
+
+  // Velocity is used at (i, j) only, so it does not need ghosts.
+  IceModelVec::AccessList list{&velocity, &strain_rates, &deviatoric_stresses,
+                               &D, &D_new, &geometry.cell_type, &bc_mask, &A, &A_new,
+                               &m_growth_rate, &m_healing_rate, &m_flow_enhancement,
+                               &m_toughness};
 
   bool do_fracground = m_config->get_flag("fracture_density.include_grounded_ice");
 
@@ -223,10 +254,40 @@ void FractureDensity::update(double dt,
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
+    // Values in ice-free cells, at the boundary of the computational domain and in
+    // grounded cells at the in-flow boundary do not depend on the stress state: set them
+    // and skip the (expensive) evaluation of the fracture initiation criterion.
+    {
+      const bool
+        zero = (geometry.cell_type.ice_free(i, j) or
+                i == 0 or j == 0 or i == Mx - 1 or j == My - 1),
+        inflow_boundary = (geometry.cell_type.grounded(i, j) and not do_fracground and
+                           bc_mask(i, j) > 0.5);
+
+      if (zero or inflow_boundary) {
+        if (constant_fd) { // no fd evolution
+          D_new(i, j) = D(i, j);
+        } else {
+          D_new(i, j) = zero ? 0.0 : fdBoundaryValue;
+        }
+
+        A_new(i, j)              = 0.0;
+        m_growth_rate(i, j)      = 0.0;
+        m_healing_rate(i, j)     = 0.0;
+        m_flow_enhancement(i, j) = 1.0;
+        m_toughness(i, j)        = 0.0;
+
+        continue;
+      }
+    }
+
+    D_new(i, j) = D(i, j);
+    A_new(i, j) = A(i, j);
+
     double tempFD = 0.0;
 
-    double u = m_velocity(i, j).u;
-    double v = m_velocity(i, j).v;
+    double u = velocity(i, j).u;
+    double v = velocity(i, j).v;
 
     if (fd2d_scheme) {
       if (u >= dx * v / dy and v >= 0.0) { //1
@@ -260,9 +321,9 @@ void FractureDensity::update(double dt,
     ///von mises criterion
 
     double
-      txx    = m_deviatoric_stresses(i, j, 0),
-      tyy    = m_deviatoric_stresses(i, j, 1),
-      txy    = m_deviatoric_stresses(i, j, 2),
+      txx    = deviatoric_stresses(i, j, 0),
+      tyy    = deviatoric_stresses(i, j, 1),
+      txy    = deviatoric_stresses(i, j, 2),
       T1     = 0.5 * (txx + tyy) + sqrt(0.25 * PetscSqr(txx - tyy) + PetscSqr(txy)), //Pa
       T2     = 0.5 * (txx + tyy) - sqrt(0.25 * PetscSqr(txx - tyy) + PetscSqr(txy)), //Pa
       sigmat = sqrt(PetscSqr(T1) + PetscSqr(T2) - T1 * T2);
@@ -326,13 +387,13 @@ void FractureDensity::update(double dt,
     //////////////////////////////////////////////////////////////////////////////
 
     //fracture density
-    double fdnew = gamma * (m_strain_rates(i, j, 0) - 0.0) * (1 - D_new(i, j));
+    double fdnew = gamma * (strain_rates(i, j, 0) - 0.0) * (1 - D_new(i, j));
     if (sigmat > initThreshold) {
       D_new(i, j) += fdnew * dt;
     }
 
     //healing
-    double fdheal = gammaheal * (m_strain_rates(i, j, 0) - healThreshold);
+    double fdheal = gammaheal * (strain_rates(i, j, 0) - healThreshold);
     if (geometry.cell_type.icy(i, j)) {
       if (constant_healing) {
         fdheal = gammaheal * (-healThreshold);
@@ -341,7 +402,7 @@ void FractureDensity::update(double dt,
         } else {
           D_new(i, j) += fdheal * dt;
         }
-      } else if (m_strain_rates(i, j, 0) < healThreshold) {
+      } else if (strain_rates(i, j, 0) < healThreshold) {
         if (fracture_weighted_healing) {
           D_new(i, j) += fdheal * dt * (1 - D(i, j));
         } else {
@@ -367,7 +428,7 @@ void FractureDensity::update(double dt,
 
       // fracture healing rate
       if (geometry.cell_type.icy(i, j)) {
-        if (constant_healing or (m_strain_rates(i, j, 0) < healThreshold)) {
+        if (constant_healing or (strain_rates(i, j, 0) < healThreshold)) {
           if (fracture_weighted_healing) {
             m_healing_rate(i, j) = fdheal * (1 - D(i, j));
           } else {
@@ -399,43 +460,20 @@ void FractureDensity::update(double dt,
       }
     }
 
-    // boundary condition
-    if (geometry.cell_type.grounded(i, j) and not do_fracground) {
-
-      if (bc_mask(i, j) > 0.5) {
-        D_new(i, j) = fdBoundaryValue;
-
-        {
-          A_new(i, j)              = 0.0;
-          m_growth_rate(i, j)      = 0.0;
-          m_healing_rate(i, j)     = 0.0;
-          m_flow_enhancement(i, j) = 1.0;
-          m_toughness(i, j)        = 0.0;
-        }
-      }
-    }
-
-    // ice free regions and boundary of computational domain
-    if (geometry.cell_type.ice_free(i, j) or i == 0 or j == 0 or i == Mx - 1 or j == My - 1) {
-
-      D_new(i, j) = 0.0;
-
-      {
-        A_new(i, j)              = 0.0;
-        m_growth_rate(i, j)      = 0.0;
-        m_healing_rate(i, j)     = 0.0;
-        m_flow_enhancement(i, j) = 1.0;
-        m_toughness(i, j)        = 0.0;
-      }
-    }
-
     if (constant_fd) { // no fd evolution
       D_new(i, j) = D(i, j);
     }
   }
 
-  A_new.update_ghosts(A);
-  D_new.update_ghosts(D);
+  // copy new values and update ghosts of both fields at the same time
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    A(i, j) = A_new(i, j);
+    D(i, j) = D_new(i, j);
+  }
+
+  GhostUpdateBatch{&A, &D}.update();
 }
 
 DiagnosticList FractureDensity::diagnostics_impl() const {
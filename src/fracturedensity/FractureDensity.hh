@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -45,6 +45,13 @@ public:
               const IceModelVec2S &hardness,
               const IceModelVec2S &inflow_boundary_mask);
 
+  void update(double dt,
+              const Geometry &geometry,
+              const IceModelVec2V &velocity,
+              const IceModelVec2 &strain_rates,
+              const IceModelVec2 &deviatoric_stresses,
+              const IceModelVec2S &inflow_boundary_mask);
+
   const IceModelVec2S& density() const;
   const IceModelVec2S& growth_rate() const;
   const IceModelVec2S& healing_rate() const;
@@ -78,6 +85,12 @@ private:
   IceModelVec2V m_velocity;
 
   std::shared_ptr<const rheology::FlowLaw> m_flow_law;
+
+  //! residual softening (see the `-fracture_softening` option)
+  double m_soft_residual;
+  //! parameters set using `-fracture_parameters`: growth constant, initiation stress
+  //! threshold, healing rate constant, healing strain rate threshold
+  double m_gamma, m_initiation_threshold, m_gamma_healing, m_healing_threshold;
 };
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -86,10 +86,9 @@ MaxTimestep FrontRetreat::max_timestep(const IceModelVec2CellType &cell_type,
   // About 9 hours which corresponds to 10000 km year-1 on a 10 km grid
   double dt_min = convert(sys, 0.001, "years", "seconds");
 
-  double
-    retreat_rate_max  = 0.0,
-    retreat_rate_mean = 0.0;
-  int N_cells = 0;
+  // number of front cells and the sum of retreat rates
+  double sums[2] = {0.0, 0.0};
+  double retreat_rate_max = 0.0;
 
   IceModelVec::AccessList list{&cell_type, &bc_mask, &retreat_rate};
 
@@ -103,15 +102,23 @@ MaxTimestep FrontRetreat::max_timestep(const IceModelVec2CellType &cell_type,
 
       const double C = retreat_rate(i, j);
 
-      N_cells           += 1;
-      retreat_rate_mean += C;
-      retreat_rate_max   = std::max(C, retreat_rate_max);
+      sums[0]         += 1.0;
+      sums[1]         += C;
+      retreat_rate_max = std::max(C, retreat_rate_max);
     }
   }
 
-  N_cells           = GlobalSum(grid->com, N_cells);
-  retreat_rate_mean = GlobalSum(grid->com, retreat_rate_mean);
-  retreat_rate_max  = GlobalMax(grid->com, retreat_rate_max);
+  // one reduction for both sums
+  {
+    double tmp[2];
+    GlobalSum(grid->com, sums, tmp, 2);
+    sums[0] = tmp[0];
+    sums[1] = tmp[1];
+  }
+  retreat_rate_max = GlobalMax(grid->com, retreat_rate_max);
+
+  const int N_cells = sums[0];
+  double retreat_rate_mean = sums[1];
 
   if (N_cells > 0.0) {
     retreat_rate_mean /= N_cells;
@@ -145,6 +152,9 @@ MaxTimestep FrontRetreat::max_timestep(const IceModelVec2CellType &cell_type,
  * particular parameterization does not apply. (For example: some calving models apply at
  * shelf calving fronts, others may apply at grounded termini but not at ice shelves,
  * etc).
+ *
+ * Ice geometry is not modified in cells where the retreat rate is zero, so we skip these
+ * cells. If the retreat rate is zero at all front cells this method returns early.
  */
 void FrontRetreat::update_geometry(double dt,
                                    const Geometry &geometry,
@@ -165,6 +175,30 @@ void FrontRetreat::update_geometry(double dt,
     compute_modified_mask(geometry.cell_type, m_cell_type);
   }
 
+  // Find front cells with a non-zero retreat rate.
+  m_front.clear();
+  {
+    IceModelVec::AccessList list{&m_cell_type, &bc_mask, &retreat_rate};
+
+    for (Points pt(*m_grid); pt; pt.next()) {
+      const int i = pt.i(), j = pt.j();
+
+      if (m_cell_type.ice_free_ocean(i, j) and
+          m_cell_type.next_to_ice(i, j) and
+          bc_mask(i, j) < 0.5 and
+          retreat_rate(i, j) != 0.0) {
+        // NB: this condition has to match the one in max_timestep() (except for the
+        // check of the retreat rate)
+        m_front.push_back({i, j});
+      }
+    }
+  }
+
+  if (GlobalMax(m_grid->com, (int)m_front.size()) == 0) {
+    // nothing to do
+    return;
+  }
+
   const double dx = m_grid->dx();
 
   m_tmp.set(0.0);
@@ -176,76 +210,78 @@ void FrontRetreat::update_geometry(double dt,
   // Prepare to loop over neighbors: directions
   const Direction dirs[] = {North, East, South, West};
 
-  // Step 1: Apply the computed horizontal retreat rate:
-  for (Points pt(*m_grid); pt; pt.next()) {
-    const int i = pt.i(), j = pt.j();
-
-    // apply retreat rate at the margin (i.e. to partially-filled cells) only
-    if (m_cell_type.ice_free_ocean(i, j) and
-        m_cell_type.next_to_ice(i, j) and
-        bc_mask(i, j) < 0.5) {
-      // NB: this condition has to match the one in max_timestep()
-
-      const double
-        rate     = retreat_rate(i, j),
-        Href_old = Href(i, j);
-
-      // Compute the number of floating neighbors and the neighbor-averaged ice thickness:
-      double H_threshold = part_grid_threshold_thickness(m_cell_type.int_star(i, j),
-                                                         ice_thickness.star(i, j),
-                                                         surface_elevation.star(i, j),
-                                                         bed(i, j));
-
-      // Calculate mass loss with respect to the associated ice thickness and the grid size:
-      const double Href_change = -dt * rate * H_threshold / dx; // in m
-
-      if (Href_old + Href_change >= 0.0) {
-        // Href is high enough to absorb the mass loss
-        Href(i, j) = Href_old + Href_change;
-      } else {
-        Href(i, j) = 0.0;
-        // Href + Href_change is negative: need to distribute mass loss to neighboring points
-
-        // Find the number of neighbors to distribute to.
-        //
-        // We consider floating cells and grounded cells with the base below sea level. In other
-        // words, additional mass losses are distributed to shelf calving fronts and grounded marine
-        // termini.
-        int N = 0;
-        {
-          auto
-            M  = m_cell_type.int_star(i, j),
-            BC = bc_mask.int_star(i, j);
-
-          auto
-            b  = bed.star(i, j),
-            sl = sea_level.star(i, j);
-
-          for (int n = 0; n < 4; ++n) {
-            Direction direction = dirs[n];
-            int m = M[direction];
-            int bc = BC[direction];
-
-            // note: this is where the modified cell type mask is used to prevent
-            // wrap-around
-            if (bc == 0 and     // distribute to regular (*not* Dirichlet B.C.) neighbors only
-                (mask::floating_ice(m) or
-                 (mask::grounded_ice(m) and b[direction] < sl[direction]))) {
-              N += 1;
-            }
+  // true if at least one front cell has to distribute mass loss to its neighbors
+  int redistribute = 0;
+
+  // Step 1: Apply the computed horizontal retreat rate at the margin (i.e. to
+  // partially-filled cells):
+  for (const auto &pt : m_front) {
+    const int i = pt.first, j = pt.second;
+
+    const double
+      rate     = retreat_rate(i, j),
+      Href_old = Href(i, j);
+
+    // Compute the number of floating neighbors and the neighbor-averaged ice thickness:
+    double H_threshold = part_grid_threshold_thickness(m_cell_type.int_star(i, j),
+                                                       ice_thickness.star(i, j),
+                                                       surface_elevation.star(i, j),
+                                                       bed(i, j));
+
+    // Calculate mass loss with respect to the associated ice thickness and the grid size:
+    const double Href_change = -dt * rate * H_threshold / dx; // in m
+
+    if (Href_old + Href_change >= 0.0) {
+      // Href is high enough to absorb the mass loss
+      Href(i, j) = Href_old + Href_change;
+    } else {
+      Href(i, j) = 0.0;
+      // Href + Href_change is negative: need to distribute mass loss to neighboring points
+
+      // Find the number of neighbors to distribute to.
+      //
+      // We consider floating cells and grounded cells with the base below sea level. In other
+      // words, additional mass losses are distributed to shelf calving fronts and grounded marine
+      // termini.
+      int N = 0;
+      {
+        auto
+          M  = m_cell_type.int_star(i, j),
+          BC = bc_mask.int_star(i, j);
+
+        auto
+          b  = bed.star(i, j),
+          sl = sea_level.star(i, j);
+
+        for (int n = 0; n < 4; ++n) {
+          Direction direction = dirs[n];
+          int m = M[direction];
+          int bc = BC[direction];
+
+          // note: this is where the modified cell type mask is used to prevent
+          // wrap-around
+          if (bc == 0 and     // distribute to regular (*not* Dirichlet B.C.) neighbors only
+              (mask::floating_ice(m) or
+               (mask::grounded_ice(m) and b[direction] < sl[direction]))) {
+            N += 1;
           }
         }
+      }
 
-        if (N > 0) {
-          m_tmp(i, j) = (Href_old + Href_change) / (double)N;
-        } else {
-          // No shelf calving front of grounded terminus to distribute to: retreat stops here.
-          m_tmp(i, j) = 0.0;
-        }
+      if (N > 0) {
+        m_tmp(i, j) = (Href_old + Href_change) / (double)N;
+        redistribute = 1;
+      } else {
+        // No shelf calving front of grounded terminus to distribute to: retreat stops here.
+        m_tmp(i, j) = 0.0;
       }
+    }
+  }   // end of loop over front cells
 
-    } // end of "if ice free ocean next to ice and not a BC location "
-  }   // end of loop over grid points
+  if (GlobalMax(m_grid->com, redistribute) == 0) {
+    // Step 2 below would not change anything
+    return;
+  }
 
   // Step 2: update ice thickness and Href in neighboring cells if we need to propagate mass losses.
   m_tmp.update_ghosts();
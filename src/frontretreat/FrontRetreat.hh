@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,6 +20,9 @@
 #ifndef FRONTRETREAT_H
 #define FRONTRETREAT_H
 
+#include <vector>
+#include <utility>              // std::pair
+
 #include "pism/util/Component.hh"
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/IceModelVec2CellType.hh"
@@ -62,6 +65,9 @@ private:
   // Temporary storage for distributing ice loss to "full" (as opposed to "partially
   // filled") cells near the front
   IceModelVec2S m_tmp;
+
+  // Front cells (owned by this process) with a non-zero retreat rate
+  std::vector<std::pair<int, int> > m_front;
 };
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -31,7 +31,7 @@ namespace calving {
 CalvingAtThickness::CalvingAtThickness(IceGrid::ConstPtr g)
   : Component(g),
     m_calving_threshold(m_grid, "thickness_calving_threshold", WITHOUT_GHOSTS),
-    m_old_mask(m_grid, "old_mask", WITH_GHOSTS, 1) {
+    m_old_mask(m_grid, "old_mask", 1) {
 
   m_calving_threshold.set_attrs("diagnostic",
                                 "threshold used by the 'calving at threshold' calving method",
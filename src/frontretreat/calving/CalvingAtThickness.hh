@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -23,6 +23,7 @@
 #include "pism/util/Component.hh"
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/CellTypeMask.hh"
 
 namespace pism {
 namespace calving {
@@ -42,7 +43,7 @@ public:
 protected:
   virtual DiagnosticList diagnostics_impl() const;
   IceModelVec2S m_calving_threshold;
-  IceModelVec2CellType m_old_mask;
+  CellTypeMask m_old_mask;
 };
 
 } // end of namespace calving
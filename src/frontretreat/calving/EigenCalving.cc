@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -64,9 +64,6 @@ void EigenCalving::init() {
 void EigenCalving::update(const IceModelVec2CellType &cell_type,
                           const IceModelVec2V &ice_velocity) {
 
-  // make a copy with a wider stencil
-  m_cell_type.copy_from(cell_type);
-
   // Distance (grid cells) from calving front where strain rate is evaluated
   int offset = m_stencil_width;
 
@@ -74,19 +71,21 @@ void EigenCalving::update(const IceModelVec2CellType &cell_type,
   // regime
   const double eigenCalvOffset = 0.0;
 
-  stressbalance::compute_2D_principal_strain_rates(ice_velocity, m_cell_type,
-                                                   m_strain_rates);
-  m_strain_rates.update_ghosts();
+  // find calving front cells and compute strain rates near them
+  compute_strain_rates(cell_type, ice_velocity);
+
+  // the calving rate is zero away from the front
+  m_calving_rate.set(0.0);
 
   IceModelVec::AccessList list{&m_cell_type, &m_calving_rate, &m_strain_rates};
 
   // Compute the horizontal calving rate
-  for (Points pt(*m_grid); pt; pt.next()) {
-    const int i = pt.i(), j = pt.j();
+  for (const auto &pt : m_front) {
+    const int i = pt.first, j = pt.second;
 
     // Find partially filled or empty grid boxes on the icefree ocean, which
     // have floating ice neighbors after the mass continuity step
-    if (m_cell_type.ice_free_ocean(i, j) and m_cell_type.next_to_floating_ice(i, j)) {
+    if (m_cell_type.next_to_floating_ice(i, j)) {
 
       // Average of strain-rate eigenvalues in adjacent floating grid cells to be used for
       // eigen-calving:
@@ -130,10 +129,8 @@ void EigenCalving::update(const IceModelVec2CellType &cell_type,
         m_calving_rate(i, j) = 0.0;
       }
 
-    } else { // end of "if (ice_free_ocean and next_to_floating)"
-      m_calving_rate(i, j) = 0.0;
-    }
-  } // end of the loop over grid points
+    } // end of "if (next_to_floating)"
+  } // end of the loop over calving front cells
 }
 
 DiagnosticList EigenCalving::diagnostics_impl() const {
@@ -29,7 +29,10 @@ namespace calving {
 
 HayhurstCalving::HayhurstCalving(IceGrid::ConstPtr grid)
   : Component(grid),
-    m_calving_rate(grid, "hayhurst_calving_rate", WITH_GHOSTS)
+    m_calving_rate(grid, "hayhurst_calving_rate", WITH_GHOSTS),
+    m_ice_density(m_config, "constants.ice.density"),
+    m_water_density(m_config, "constants.sea_water.density"),
+    m_gravity(m_config, "constants.standard_gravity")
 {
   m_calving_rate.set_attrs("diagnostic",
                            "horizontal calving rate due to Hayhurst calving",
@@ -74,9 +77,9 @@ void HayhurstCalving::update(const IceModelVec2CellType &cell_type,
   using std::min;
 
   const double
-    ice_density   = m_config->get_number("constants.ice.density"),
-    water_density = m_config->get_number("constants.sea_water.density"),
-    gravity       = m_config->get_number("constants.standard_gravity"),
+    ice_density   = m_ice_density.value(),
+    water_density = m_water_density.value(),
+    gravity       = m_gravity.value(),
     // convert "Pa" to "MPa" and "m yr-1" to "m s-1"
     unit_scaling  = pow(1e-6, m_exponent_r) * convert(m_sys, 1.0, "m year-1", "m second-1");
 
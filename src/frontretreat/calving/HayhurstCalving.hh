@@ -48,6 +48,8 @@ protected:
 
   double m_B_tilde, m_exponent_r, m_sigma_threshold;
 
+  ConfigParameter<double> m_ice_density, m_water_density, m_gravity;
+
 };
 
 } // end of namespace calving
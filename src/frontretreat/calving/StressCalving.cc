@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -18,6 +18,7 @@
  */
 
 #include "StressCalving.hh"
+#include "pism/stressbalance/StressBalance.hh"
 
 namespace pism {
 namespace calving {
@@ -43,10 +44,53 @@ StressCalving::StressCalving(IceGrid::ConstPtr grid,
   m_calving_rate.create(m_grid, "calving_rate", WITHOUT_GHOSTS);
   m_calving_rate.set_attrs("internal", "horizontal calving rate", "m s-1", "m year-1", "", 0);
 
-  m_cell_type.create(m_grid, "cell_type", WITH_GHOSTS);
+  // calving laws use the cell type at the distance of m_stencil_width from the front
+  m_cell_type.create(m_grid, "cell_type", WITH_GHOSTS, m_stencil_width);
   m_cell_type.set_attrs("internal", "cell type mask", "", "", "", 0);
 }
 
+/*!
+ * Find calving front cells, then compute principal strain rates in the band of icy cells
+ * where calving laws use them (see m_front and m_band).
+ *
+ * Calving fronts usually occupy a small fraction of the grid, so this is much cheaper
+ * than computing strain rates everywhere. Each process computes strain rates in its band
+ * and updates ghosts, so values needed by neighbors are computed by their owners.
+ *
+ * Strain rates outside of the band are not updated.
+ */
+void StressCalving::compute_strain_rates(const IceModelVec2CellType &cell_type,
+                                         const IceModelVec2V &ice_velocity) {
+  // make a copy with a wider stencil
+  m_cell_type.copy_from(cell_type);
+
+  const int w = m_stencil_width;
+
+  m_front.clear();
+  m_band.clear();
+  {
+    IceModelVec::AccessList list{&m_cell_type};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (m_cell_type.ice_free_ocean(i, j)) {
+        if (m_cell_type.next_to_ice(i, j)) {
+          m_front.push_back({i, j});
+        }
+      } else if (m_cell_type.icy(i, j) and
+                 (m_cell_type.ice_free_ocean(i + w, j) or m_cell_type.ice_free_ocean(i - w, j) or
+                  m_cell_type.ice_free_ocean(i, j + w) or m_cell_type.ice_free_ocean(i, j - w))) {
+        m_band.push_back({i, j});
+      }
+    }
+  }
+
+  stressbalance::compute_2D_principal_strain_rates(ice_velocity, m_cell_type, m_band,
+                                                   m_strain_rates);
+  m_strain_rates.update_ghosts();
+}
+
 const IceModelVec2S &StressCalving::calving_rate() const {
   return m_calving_rate;
 }
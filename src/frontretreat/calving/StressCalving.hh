@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,6 +20,9 @@
 #ifndef STRESSCALVING_H
 #define STRESSCALVING_H
 
+#include <vector>
+#include <utility>              // std::pair
+
 #include "pism/util/Component.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 
@@ -36,8 +39,18 @@ public:
   const IceModelVec2S &calving_rate() const;
 
 protected:
+  void compute_strain_rates(const IceModelVec2CellType &cell_type,
+                            const IceModelVec2V &ice_velocity);
+
   const int m_stencil_width;
 
+  //! ice-free ocean cells next to ice (calving front cells) owned by this process
+  std::vector<std::pair<int, int> > m_front;
+
+  //! icy cells (owned by this process) at the distance of `m_stencil_width` from an
+  //! ice-free ocean cell (in `x` or `y` direction): strain rates are needed here only
+  std::vector<std::pair<int, int> > m_band;
+
   IceModelVec2 m_strain_rates;
 
   IceModelVec2S m_calving_rate;
@@ -106,12 +106,11 @@ void vonMisesCalving::update(const IceModelVec2CellType &cell_type,
   // Distance (grid cells) from calving front where strain rate is evaluated
   int offset = m_stencil_width;
 
-  // make a copy with a wider stencil
-  m_cell_type.copy_from(cell_type);
+  // find calving front cells and compute strain rates near them
+  compute_strain_rates(cell_type, ice_velocity);
 
-  stressbalance::compute_2D_principal_strain_rates(ice_velocity, m_cell_type,
-                                                   m_strain_rates);
-  m_strain_rates.update_ghosts();
+  // the calving rate is zero away from the front
+  m_calving_rate.set(0.0);
 
   IceModelVec::AccessList list{&ice_enthalpy, &ice_thickness, &m_cell_type, &ice_velocity,
                                &m_strain_rates, &m_calving_rate, &m_calving_threshold};
@@ -120,74 +119,68 @@ void vonMisesCalving::update(const IceModelVec2CellType &cell_type,
 
   double glen_exponent = m_flow_law->exponent();
 
-  for (Points pt(*m_grid); pt; pt.next()) {
-    const int i = pt.i(), j = pt.j();
-
-    // Find partially filled or empty grid boxes on the icefree ocean, which
-    // have floating ice neighbors after the mass continuity step
-    if (m_cell_type.ice_free_ocean(i, j) and m_cell_type.next_to_ice(i, j)) {
-
-      double
-        velocity_magnitude = 0.0,
-        hardness           = 0.0;
-      // Average of strain-rate eigenvalues in adjacent floating grid cells.
-      double
-        eigen1             = 0.0,
-        eigen2             = 0.0;
-      {
-        int N = 0;
-        for (int p = -1; p < 2; p += 2) {
-          const int I = i + p * offset;
-          if (m_cell_type.icy(I, j)) {
-            velocity_magnitude += ice_velocity(I, j).magnitude();
-            {
-              double H = ice_thickness(I, j);
-              unsigned int k = m_grid->kBelowHeight(H);
-              hardness += averaged_hardness(*m_flow_law, H, k, &z[0], ice_enthalpy.get_column(I, j));
-            }
-            eigen1 += m_strain_rates(I, j, 0);
-            eigen2 += m_strain_rates(I, j, 1);
-            N += 1;
+  // Partially filled or empty grid boxes on the icefree ocean, which have ice neighbors
+  // after the mass continuity step
+  for (const auto &pt : m_front) {
+    const int i = pt.first, j = pt.second;
+
+    double
+      velocity_magnitude = 0.0,
+      hardness           = 0.0;
+    // Average of strain-rate eigenvalues in adjacent floating grid cells.
+    double
+      eigen1             = 0.0,
+      eigen2             = 0.0;
+    {
+      int N = 0;
+      for (int p = -1; p < 2; p += 2) {
+        const int I = i + p * offset;
+        if (m_cell_type.icy(I, j)) {
+          velocity_magnitude += ice_velocity(I, j).magnitude();
+          {
+            double H = ice_thickness(I, j);
+            unsigned int k = m_grid->kBelowHeight(H);
+            hardness += averaged_hardness(*m_flow_law, H, k, &z[0], ice_enthalpy.get_column(I, j));
           }
+          eigen1 += m_strain_rates(I, j, 0);
+          eigen2 += m_strain_rates(I, j, 1);
+          N += 1;
         }
+      }
 
-        for (int q = -1; q < 2; q += 2) {
-          const int J = j + q * offset;
-          if (m_cell_type.icy(i, J)) {
-            velocity_magnitude += ice_velocity(i, J).magnitude();
-            {
-              double H = ice_thickness(i, J);
-              unsigned int k = m_grid->kBelowHeight(H);
-              hardness += averaged_hardness(*m_flow_law, H, k, &z[0], ice_enthalpy.get_column(i, J));
-            }
-            eigen1 += m_strain_rates(i, J, 0);
-            eigen2 += m_strain_rates(i, J, 1);
-            N += 1;
+      for (int q = -1; q < 2; q += 2) {
+        const int J = j + q * offset;
+        if (m_cell_type.icy(i, J)) {
+          velocity_magnitude += ice_velocity(i, J).magnitude();
+          {
+            double H = ice_thickness(i, J);
+            unsigned int k = m_grid->kBelowHeight(H);
+            hardness += averaged_hardness(*m_flow_law, H, k, &z[0], ice_enthalpy.get_column(i, J));
           }
-        }
-
-        if (N > 0) {
-          eigen1             /= N;
-          eigen2             /= N;
-          hardness           /= N;
-          velocity_magnitude /= N;
+          eigen1 += m_strain_rates(i, J, 0);
+          eigen2 += m_strain_rates(i, J, 1);
+          N += 1;
         }
       }
 
-      // [\ref Morlighem2016] equation 6
-      const double effective_tensile_strain_rate = sqrt(0.5 * (PetscSqr(max(0.0, eigen1)) +
-                                                               PetscSqr(max(0.0, eigen2))));
-      // [\ref Morlighem2016] equation 7
-      const double sigma_tilde = sqrt(3.0) * hardness * pow(effective_tensile_strain_rate,
-                                                            1.0 / glen_exponent);
+      if (N > 0) {
+        eigen1             /= N;
+        eigen2             /= N;
+        hardness           /= N;
+        velocity_magnitude /= N;
+      }
+    }
 
-      // Calving law [\ref Morlighem2016] equation 4
-      m_calving_rate(i, j) = velocity_magnitude * sigma_tilde / m_calving_threshold(i, j);
+    // [\ref Morlighem2016] equation 6
+    const double effective_tensile_strain_rate = sqrt(0.5 * (PetscSqr(max(0.0, eigen1)) +
+                                                             PetscSqr(max(0.0, eigen2))));
+    // [\ref Morlighem2016] equation 7
+    const double sigma_tilde = sqrt(3.0) * hardness * pow(effective_tensile_strain_rate,
+                                                          1.0 / glen_exponent);
 
-    } else { // end of "if (ice_free_ocean and next_to_floating)"
-      m_calving_rate(i, j) = 0.0;
-    }
-  }   // end of loop over grid points
+    // Calving law [\ref Morlighem2016] equation 4
+    m_calving_rate(i, j) = velocity_magnitude * sigma_tilde / m_calving_threshold(i, j);
+  }   // end of loop over calving front cells
 }
 
 const IceModelVec2S& vonMisesCalving::threshold() const {
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,22 +17,35 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <vector>
+
 #include "IcebergRemover.hh"
-#include "pism/util/connected_components.hh"
+#include "pism/util/label_components.hh"
 #include "pism/util/Mask.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/ConfigInterface.hh"
 
 namespace pism {
 namespace calving {
 
 IcebergRemover::IcebergRemover(IceGrid::ConstPtr g)
   : Component(g),
-    m_iceberg_mask(m_grid, "iceberg_mask", WITHOUT_GHOSTS){
+    m_iceberg_mask(m_grid, "iceberg_mask", WITH_GHOSTS, 1),
+    m_label_work(m_grid, "label_components_work", WITH_GHOSTS, 1),
+    m_previous_mask_valid(false),
+    m_updates_since_labeling(0) {
+
+  m_incremental       = m_config->get_flag("geometry.remove_icebergs_incremental");
+  m_fill_limit        = m_config->get_number("geometry.remove_icebergs_fill_limit");
+  m_labeling_interval = m_config->get_number("geometry.remove_icebergs_full_interval");
 
-  m_mask_p0 = m_iceberg_mask.allocate_proc0_copy();
+  if (m_incremental) {
+    m_previous_mask.create(m_grid, "previous_iceberg_mask", WITH_GHOSTS, 1);
+  }
 }
 
 IcebergRemover::~IcebergRemover() {
@@ -40,66 +53,191 @@ IcebergRemover::~IcebergRemover() {
 }
 
 void IcebergRemover::init() {
+  m_previous_mask_valid = false;
 }
 
-/**
- * Use PISM's ice cover mask to update ice thickness, removing "icebergs".
+namespace {
+const int
+  mask_grounded_ice = 1,
+  mask_floating_ice = 2;
+} // end of anonymous namespace
+
+/*!
+ * Prepare the mask that will be handed to the connected component labeling code:
+ * grounded ice is marked with `mask_grounded_ice`, floating ice with `mask_floating_ice`.
  *
- * @param[in,out] pism_mask PISM's ice cover mask
- * @param[in,out] ice_thickness ice thickness
+ * Icy Dirichlet B.C. cells are marked as "grounded" because we don't want them removed.
  */
-void IcebergRemover::update(const IceModelVec2Int &bc_mask,
-                            IceModelVec2CellType &mask,
-                            IceModelVec2S &ice_thickness) {
+void IcebergRemover::prepare_mask(const IceModelVec2Int &bc_mask,
+                                  const IceModelVec2CellType &cell_type,
+                                  IceModelVec2Int &result) const {
+  IceModelVec::AccessList list{&cell_type, &result, &bc_mask};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (bc_mask(i, j) > 0.5 and cell_type.icy(i, j)) {
+      result(i, j) = mask_grounded_ice;
+    } else if (cell_type.grounded_ice(i, j)) {
+      result(i, j) = mask_grounded_ice;
+    } else if (cell_type.floating_ice(i, j)) {
+      result(i, j) = mask_floating_ice;
+    } else {
+      result(i, j) = 0.0;
+    }
+  }
+
+  result.update_ghosts();
+}
+
+/*!
+ * Returns false if the current mask (m_iceberg_mask) is guaranteed to contain no
+ * icebergs, given that the mask after the previous update (m_previous_mask) did not
+ * contain any.
+ *
+ * Every connected component of the current mask that includes neither a changed cell nor
+ * a neighbor of a changed cell is a component of the previous mask, so it is connected to
+ * grounded ice. For all other components we run a flood fill starting from icy cells
+ * next to changes, stopping as soon as it reaches a grounded cell.
+ *
+ * The flood fill is restricted to the sub-domain of the current process and visits at
+ * most `geometry.remove_icebergs_fill_limit` cells. If it fails to reach grounded ice
+ * for any reason we have to assume that icebergs may be present.
+ *
+ * Collective.
+ */
+bool IcebergRemover::icebergs_may_be_present() const {
   const int
-    mask_grounded_ice = 1,
-    mask_floating_ice = 2;
+    Mx = m_grid->Mx(),
+    My = m_grid->My(),
+    xs = m_grid->xs(),
+    xm = m_grid->xm(),
+    ys = m_grid->ys(),
+    ym = m_grid->ym();
 
-  // prepare the mask that will be handed to the connected component
-  // labeling code:
-  {
-    m_iceberg_mask.set(0.0);
+  const int
+    di[] = {-1, 1, 0, 0},
+    dj[] = {0, 0, -1, 1};
 
-    IceModelVec::AccessList list{&mask, &m_iceberg_mask, &bc_mask};
+  const IceModelVec2Int
+    &mask     = m_iceberg_mask,
+    &previous = m_previous_mask;
 
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  IceModelVec::AccessList list{&mask, &previous};
 
-      if (mask.grounded_ice(i,j) == true) {
-        m_iceberg_mask(i,j) = mask_grounded_ice;
-      } else if (mask.floating_ice(i,j) == true) {
-        m_iceberg_mask(i,j) = mask_floating_ice;
-      }
+  // cells known to be connected to grounded ice
+  std::vector<bool> connected(xm * ym, false);
+  // index of the flood fill that visited a cell (-1 if none did)
+  std::vector<int> seen(xm * ym, -1);
+
+  auto changed = [&](int i, int j) {
+    // ghosts of PISM's DMs are periodic: ignore neighbors outside the grid
+    if (i < 0 or i >= Mx or j < 0 or j >= My) {
+      return false;
     }
+    return mask.as_int(i, j) != previous.as_int(i, j);
+  };
 
-    // Mark icy Dirichlet B.C. cells as "grounded" because we don't want them removed.
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  int failed = 0;
+  std::vector<std::pair<int, int> > queue;
+  int n_fills = 0;
+  for (Points p(*m_grid); p and failed == 0; p.next()) {
+    const int i = p.i(), j = p.j();
 
-      if (bc_mask(i, j) > 0.5 and mask.icy(i, j)) {
-        m_iceberg_mask(i, j) = mask_grounded_ice;
-      }
+    if (mask.as_int(i, j) == 0 or connected[(j - ys) * xm + (i - xs)]) {
+      continue;
     }
-  }
 
-  // identify icebergs using serial code on processor 0:
-  {
-    m_iceberg_mask.put_on_proc0(*m_mask_p0);
+    if (not (changed(i, j) or changed(i - 1, j) or changed(i + 1, j) or
+             changed(i, j - 1) or changed(i, j + 1))) {
+      continue;
+    }
 
-    ParallelSection rank0(m_grid->com);
-    try {
-      if (m_grid->rank() == 0) {
-        petsc::VecArray mask_p0(*m_mask_p0);
-        label_connected_components(mask_p0.get(), m_grid->My(), m_grid->Mx(), true, mask_grounded_ice);
+    // flood fill starting at (i, j)
+    const int fill = n_fills++;
+    bool success = false;
+    queue = {{i, j}};
+    seen[(j - ys) * xm + (i - xs)] = fill;
+
+    for (size_t k = 0; k < queue.size(); ++k) {
+      const int I = queue[k].first, J = queue[k].second;
+      const int K = (J - ys) * xm + (I - xs);
+
+      if (mask.as_int(I, J) == mask_grounded_ice or connected[K]) {
+        success = true;
+        break;
+      }
+
+      if ((int)queue.size() > m_fill_limit) {
+        break;
+      }
+
+      bool outside = false;
+      for (int n = 0; n < 4; ++n) {
+        const int II = I + di[n], JJ = J + dj[n];
+
+        if (II < 0 or II >= Mx or JJ < 0 or JJ >= My or
+            mask.as_int(II, JJ) == 0) {
+          continue;
+        }
+
+        if (II < xs or II >= xs + xm or JJ < ys or JJ >= ys + ym) {
+          // the component extends beyond this sub-domain
+          outside = true;
+          break;
+        }
+
+        const int KK = (JJ - ys) * xm + (II - xs);
+        if (seen[KK] != fill) {
+          seen[KK] = fill;
+          queue.push_back({II, JJ});
+        }
+      }
+
+      if (outside) {
+        break;
       }
-    } catch (...) {
-      rank0.failed();
     }
-    rank0.check();
 
-    m_iceberg_mask.get_from_proc0(*m_mask_p0);
+    if (success) {
+      for (const auto &q : queue) {
+        connected[(q.second - ys) * xm + (q.first - xs)] = true;
+      }
+    } else {
+      failed = 1;
+    }
   }
 
+  return GlobalMax(m_grid->com, failed) > 0;
+}
+
+/**
+ * Use PISM's ice cover mask to update ice thickness, removing "icebergs".
+ *
+ * @param[in,out] pism_mask PISM's ice cover mask
+ * @param[in,out] ice_thickness ice thickness
+ */
+void IcebergRemover::update(const IceModelVec2Int &bc_mask,
+                            IceModelVec2CellType &mask,
+                            IceModelVec2S &ice_thickness) {
+
+  prepare_mask(bc_mask, mask, m_iceberg_mask);
+
+  if (m_incremental) {
+    bool skip = (m_previous_mask_valid and
+                 m_updates_since_labeling < m_labeling_interval and
+                 not icebergs_may_be_present());
+
+    if (skip) {
+      m_previous_mask.copy_from(m_iceberg_mask);
+      m_updates_since_labeling += 1;
+      return;
+    }
+  }
+
+  // identify icebergs
+  label_components(m_iceberg_mask, true, mask_grounded_ice, m_label_work);
+
   // correct ice thickness and the cell type mask using the resulting
   // "iceberg" mask:
   {
@@ -119,6 +257,12 @@ void IcebergRemover::update(const IceModelVec2Int &bc_mask,
   // elevation can be updated redundantly)
   mask.update_ghosts();
   ice_thickness.update_ghosts();
+
+  if (m_incremental) {
+    prepare_mask(bc_mask, mask, m_previous_mask);
+    m_previous_mask_valid = true;
+    m_updates_since_labeling = 0;
+  }
 }
 
 } // end of namespace calving
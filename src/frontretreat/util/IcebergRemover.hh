@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -43,8 +43,13 @@ namespace calving {
  * They are observed to cause unrealistically large velocities that
  * may affect ice velocities elsewhere.
  *
- * This class uses a serial connected component labeling algorithm to
+ * This class uses a connected component labeling algorithm to
  * remove "icebergs".
+ *
+ * In the incremental mode (geometry.remove_icebergs_incremental) the labeling is skipped
+ * if it can be shown that all components affected by changes in the ice cover since the
+ * previous update are still connected to grounded ice (see
+ * icebergs_may_be_present()).
  */
 class IcebergRemover : public Component
 {
@@ -57,8 +62,26 @@ public:
               IceModelVec2CellType &pism_mask,
               IceModelVec2S &ice_thickness);
 protected:
-  IceModelVec2S m_iceberg_mask;
-  petsc::Vec::Ptr m_mask_p0;
+  void prepare_mask(const IceModelVec2Int &bc_mask,
+                    const IceModelVec2CellType &cell_type,
+                    IceModelVec2Int &result) const;
+
+  bool icebergs_may_be_present() const;
+
+  IceModelVec2Int m_iceberg_mask;
+  //! temporary storage used by label_components()
+  IceModelVec2V m_label_work;
+
+  //! the mask prepared by prepare_mask() after the previous update (incremental mode only)
+  IceModelVec2Int m_previous_mask;
+  //! true if m_previous_mask is up to date
+  bool m_previous_mask_valid;
+  //! number of updates since the last full labeling
+  int m_updates_since_labeling;
+
+  bool m_incremental;
+  int m_fill_limit;
+  int m_labeling_interval;
 };
 
 } // end of namespace calving
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,10 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <array>
+#include <vector>
+#include <utility>              // std::pair
+
 #include "remove_narrow_tongues.hh"
 
 #include "pism/util/IceGrid.hh"
@@ -24,6 +28,86 @@
 
 namespace pism {
 
+namespace {
+
+// Bits used to encode "ice-free" neighbors of a cell.
+enum {N_BIT = 1, E_BIT = 2, S_BIT = 4, W_BIT = 8,
+      NE_BIT = 16, NW_BIT = 32, SE_BIT = 64, SW_BIT = 128};
+
+/*!
+ * Lookup table mapping an 8-bit pattern of ice-free neighbors to "true" if the center
+ * cell is the tip of a one-cell-wide tongue.
+ */
+const std::array<bool, 256>& tongue_tip_table() {
+  static const std::array<bool, 256> table = []() {
+    // Patterns corresponding to tongues pointing east, south, west and north: the "ice
+    // free" bits that have to be set and the bit (the tongue itself) that has to be
+    // cleared.
+    const int tongues[4][2] = {{NW_BIT | SW_BIT | N_BIT | S_BIT | E_BIT, W_BIT},
+                               {NW_BIT | NE_BIT | W_BIT | E_BIT | S_BIT, N_BIT},
+                               {NE_BIT | SE_BIT | W_BIT | S_BIT | N_BIT, E_BIT},
+                               {SW_BIT | SE_BIT | W_BIT | E_BIT | N_BIT, S_BIT}};
+
+    std::array<bool, 256> result{};
+    for (int pattern = 0; pattern < 256; ++pattern) {
+      for (const auto &t : tongues) {
+        if ((pattern & t[0]) == t[0] and (pattern & t[1]) == 0) {
+          result[pattern] = true;
+        }
+      }
+    }
+    return result;
+  }();
+
+  return table;
+}
+
+//! Encode ice-free neighbors of (i, j) as a bit mask. `ice_free` is a predicate.
+template<class F>
+inline int neighbor_pattern(int i, int j, F ice_free) {
+  return
+    (ice_free(i, j + 1)     ? N_BIT  : 0) |
+    (ice_free(i + 1, j)     ? E_BIT  : 0) |
+    (ice_free(i, j - 1)     ? S_BIT  : 0) |
+    (ice_free(i - 1, j)     ? W_BIT  : 0) |
+    (ice_free(i + 1, j + 1) ? NE_BIT : 0) |
+    (ice_free(i - 1, j + 1) ? NW_BIT : 0) |
+    (ice_free(i + 1, j - 1) ? SE_BIT : 0) |
+    (ice_free(i - 1, j - 1) ? SW_BIT : 0);
+}
+
+/*!
+ * Find icy cells that have at least three ice-free neighbors among the four "direct"
+ * ones. This is a necessary condition for a cell to be a tip of a tongue, so this front
+ * band contains all the cells that may need to be removed.
+ */
+void front_band(const IceModelVec2CellType &mask,
+                std::vector<std::pair<int, int> > &result) {
+  IceGrid::ConstPtr grid = mask.grid();
+
+  result.clear();
+
+  IceModelVec::AccessList list{&mask};
+
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (mask.ice_free(i, j)) {
+      continue;
+    }
+
+    const int n_ice_free =
+      (int)mask.ice_free(i, j + 1) + (int)mask.ice_free(i + 1, j) +
+      (int)mask.ice_free(i, j - 1) + (int)mask.ice_free(i - 1, j);
+
+    if (n_ice_free >= 3) {
+      result.push_back({i, j});
+    }
+  }
+}
+
+} // end of anonymous namespace
+
 /** Remove tips of one-cell-wide ice tongues ("noses")..
  *
  * The center icy cell in ice tongues like this one (and equivalent)
@@ -52,6 +136,10 @@ namespace pism {
  * This means that we can update `ice_thickness` in place without
  * introducing a dependence on the grid traversal order.
  *
+ * Only cells in the "front band" (icy cells with at least three ice-free direct
+ * neighbors) are examined. Neighbors of these cells are encoded as a bit mask and tested
+ * using a lookup table.
+ *
  * @param[in,out] mask cell type mask
  * @param[in,out] ice_thickness modeled ice thickness
  *
@@ -66,69 +154,39 @@ void remove_narrow_tongues(const Geometry &geometry,
 
   IceGrid::ConstPtr grid = mask.grid();
 
-  IceModelVec::AccessList list{&mask, &bed, &sea_level, &ice_thickness};
+  // cells that may be tips of tongues
+  std::vector<std::pair<int, int> > band;
+  front_band(mask, band);
 
-  for (Points p(*grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-    if (mask.ice_free(i,j) or
-        (mask.grounded_ice(i,j) and bed(i,j) >= sea_level(i, j))) {
-      continue;
-    }
+  const auto &is_tip = tongue_tip_table();
+
+  auto ice_free_ocean = [&mask](int i, int j) {
+    return mask.ice_free_ocean(i, j);
+  };
+  auto ice_free = [&mask](int i, int j) {
+    return mask.ice_free(i, j);
+  };
+
+  IceModelVec::AccessList list{&mask, &bed, &sea_level, &ice_thickness};
 
-    bool
-      ice_free_N  = false, ice_free_E  = false,
-      ice_free_S  = false, ice_free_W  = false,
-      ice_free_NE = false, ice_free_NW = false,
-      ice_free_SE = false, ice_free_SW = false;
+  for (const auto &p : band) {
+    const int i = p.first, j = p.second;
 
-    if (mask.grounded_ice(i,j)) {
+    int pattern = 0;
+    if (mask.grounded_ice(i, j)) {
+      if (bed(i, j) >= sea_level(i, j)) {
+        continue;
+      }
       // if (i,j) is grounded ice then we will remove it if it has
       // exclusively ice-free ocean neighbors
-      ice_free_N  = mask.ice_free_ocean(i, j + 1);
-      ice_free_E  = mask.ice_free_ocean(i + 1, j);
-      ice_free_S  = mask.ice_free_ocean(i, j - 1);
-      ice_free_W  = mask.ice_free_ocean(i - 1, j);
-      ice_free_NE = mask.ice_free_ocean(i + 1, j + 1);
-      ice_free_NW = mask.ice_free_ocean(i - 1, j + 1);
-      ice_free_SE = mask.ice_free_ocean(i + 1, j - 1);
-      ice_free_SW = mask.ice_free_ocean(i - 1, j - 1);
-    } else if (mask.floating_ice(i,j)) {
+      pattern = neighbor_pattern(i, j, ice_free_ocean);
+    } else {
       // if (i,j) is floating then we will remove it if its neighbors are
       // ice-free, whether ice-free ocean or ice-free ground
-      ice_free_N  = mask.ice_free(i, j + 1);
-      ice_free_E  = mask.ice_free(i + 1, j);
-      ice_free_S  = mask.ice_free(i, j - 1);
-      ice_free_W  = mask.ice_free(i - 1, j);
-      ice_free_NE = mask.ice_free(i + 1, j + 1);
-      ice_free_NW = mask.ice_free(i - 1, j + 1);
-      ice_free_SE = mask.ice_free(i + 1, j - 1);
-      ice_free_SW = mask.ice_free(i - 1, j - 1);
+      pattern = neighbor_pattern(i, j, ice_free);
     }
 
-    if ((not ice_free_W and
-         ice_free_NW    and
-         ice_free_SW    and
-         ice_free_N     and
-         ice_free_S     and
-         ice_free_E)    or
-        (not ice_free_N and
-         ice_free_NW    and
-         ice_free_NE    and
-         ice_free_W     and
-         ice_free_E     and
-         ice_free_S)    or
-        (not ice_free_E and
-         ice_free_NE    and
-         ice_free_SE    and
-         ice_free_W     and
-         ice_free_S     and
-         ice_free_N)    or
-        (not ice_free_S and
-         ice_free_SW    and
-         ice_free_SE    and
-         ice_free_W     and
-         ice_free_E     and
-         ice_free_N)) {
+    if (is_tip[pattern]) {
       ice_thickness(i, j) = 0.0;
     }
   }
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -23,6 +23,7 @@
 #include "pism/util/IceModelVec2CellType.hh"
 #include "pism/util/Mask.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/GhostUpdateBatch.hh"
 #include "pism/geometry/grounded_cell_fraction.hh"
 
 namespace pism {
@@ -39,7 +40,11 @@ Geometry::Geometry(IceGrid::ConstPtr grid)
     ice_area_specific_volume(grid, "ice_area_specific_volume", WITH_GHOSTS),
     cell_type(grid, "mask", WITH_GHOSTS, m_stencil_width),
     cell_grounded_fraction(grid, "cell_grounded_fraction", WITHOUT_GHOSTS),
-    ice_surface_elevation(grid, "usurf", WITH_GHOSTS, m_stencil_width) {
+    ice_surface_elevation(grid, "usurf", WITH_GHOSTS, m_stencil_width),
+    m_ice_free_thickness_threshold(-1.0),
+    m_cell_type_revision(-1),
+    m_surface_elevation_revision(-1),
+    m_grounded_fraction_revision(-1) {
 
   latitude.set_attrs("mapping", "latitude", "degree_north", "degree_north", "latitude", 0);
   latitude.set_time_independent(true);
@@ -124,64 +129,139 @@ void Geometry::ensure_consistency(double ice_free_thickness_threshold) {
 
   check_minimum_ice_thickness(ice_thickness);
 
+  // re-compute everything if this is the first call or if one of redundant fields was
+  // modified elsewhere
+  const bool outdated = (m_consistent_state.empty() or
+                         cell_type.state_counter() != m_cell_type_revision or
+                         ice_surface_elevation.state_counter() != m_surface_elevation_revision or
+                         cell_grounded_fraction.state_counter() != m_grounded_fraction_revision);
+  if (outdated) {
+    m_consistent_state.resize(4 * grid->xm() * grid->ym());
+  }
+
+  // the cell type depends on the ice-free thickness threshold, other fields don't
+  const bool threshold_changed = (ice_free_thickness_threshold != m_ice_free_thickness_threshold);
+
   IceModelVec::AccessList list{&sea_level_elevation, &bed_elevation,
       &ice_thickness, &ice_area_specific_volume,
       &cell_type, &ice_surface_elevation};
 
-  // first ensure that ice_area_specific_volume is 0 if ice_thickness > 0.
+  // first ensure that ice_area_specific_volume is 0 if ice_thickness > 0, then find grid
+  // points where the state changed since the last call
+  std::vector<int> changed;
   {
-    ParallelSection loop(grid->com);
-    try {
-      for (Points p(*grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
-
-        if (ice_thickness(i, j) > 0.0 and ice_area_specific_volume(i, j) > 0.0) {
-          ice_thickness(i, j) += ice_area_specific_volume(i, j);
-          ice_area_specific_volume(i, j) = 0.0;
-        }
+    const int xs = grid->xs(), ys = grid->ys(), xm = grid->xm();
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (ice_thickness(i, j) > 0.0 and ice_area_specific_volume(i, j) > 0.0) {
+        ice_thickness(i, j) += ice_area_specific_volume(i, j);
+        ice_area_specific_volume(i, j) = 0.0;
+      }
+
+      const int k = (j - ys) * xm + (i - xs);
+      double *state = &m_consistent_state[4 * k];
+
+      if (outdated or
+          state[0] != ice_thickness(i, j) or
+          state[1] != ice_area_specific_volume(i, j) or
+          state[2] != bed_elevation(i, j) or
+          state[3] != sea_level_elevation(i, j)) {
+        state[0] = ice_thickness(i, j);
+        state[1] = ice_area_specific_volume(i, j);
+        state[2] = bed_elevation(i, j);
+        state[3] = sea_level_elevation(i, j);
+
+        changed.push_back(k);
       }
-    } catch (...) {
-      loop.failed();
     }
-    loop.check();
   }
 
-  // compute cell type and surface elevation
-  {
-    GeometryCalculator gc(*config);
-    gc.set_icefree_thickness(ice_free_thickness_threshold);
-
-    ParallelSection loop(grid->com);
-    try {
-      for (Points p(*grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
-
-        int mask = 0;
-        gc.compute(sea_level_elevation(i, j), bed_elevation(i, j), ice_thickness(i, j),
-                   &mask, &ice_surface_elevation(i, j));
-        cell_type(i, j) = mask;
+  const bool state_changed = GlobalSum(grid->com, (int)changed.size()) > 0;
+
+  // ice_thickness and ice_area_specific_volume are final: update their ghosts while
+  // computing the cell type (which uses values at owned grid points only). This is done
+  // even if nothing changed: callers rely on this call to update ghosts of fields they
+  // modified and the comparison above covers owned grid points only.
+  GhostUpdateBatch thickness_ghosts{&ice_thickness, &ice_area_specific_volume};
+  thickness_ghosts.begin();
+
+  if (not (state_changed or threshold_changed)) {
+    thickness_ghosts.end();
+    return;
+  }
+
+  GeometryCalculator gc(*config);
+  gc.set_icefree_thickness(ice_free_thickness_threshold);
+
+  if (state_changed) {
+    const int xs = grid->xs(), ys = grid->ys(), xm = grid->xm();
+
+    auto update = [&](int i, int j) {
+      int mask = 0;
+      gc.compute(sea_level_elevation(i, j), bed_elevation(i, j), ice_thickness(i, j),
+                 &mask, &ice_surface_elevation(i, j));
+      cell_type(i, j) = mask;
+    };
+
+    if (threshold_changed) {
+      // update all owned grid points, one row at a time
+      for (int j = ys; j < ys + grid->ym(); ++j) {
+        gc.compute_row(&sea_level_elevation(xs, j), &bed_elevation(xs, j),
+                       &ice_thickness(xs, j), xm,
+                       &cell_type(xs, j), &ice_surface_elevation(xs, j));
+      }
+    } else {
+      for (int k : changed) {
+        update(xs + k % xm, ys + k / xm);
       }
-    } catch (...) {
-      loop.failed();
     }
-    loop.check();
+
+    thickness_ghosts.end();
+
+    GhostUpdateBatch{&cell_type, &ice_surface_elevation}.update();
+
+    const double
+      ice_density = config->get_number("constants.ice.density"),
+      ocean_density = config->get_number("constants.sea_water.density");
+
+    compute_grounded_cell_fraction(ice_density,
+                                   ocean_density,
+                                   sea_level_elevation,
+                                   ice_thickness,
+                                   bed_elevation,
+                                   cell_grounded_fraction);
+  } else {
+    // only the ice-free thickness threshold changed: the surface elevation and the
+    // grounded cell fraction are still valid
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      cell_type(i, j) = gc.mask(sea_level_elevation(i, j), bed_elevation(i, j),
+                                ice_thickness(i, j));
+    }
+
+    thickness_ghosts.end();
+
+    cell_type.update_ghosts();
   }
 
-  ice_thickness.update_ghosts();
-  ice_area_specific_volume.update_ghosts();
-  cell_type.update_ghosts();
-  ice_surface_elevation.update_ghosts();
+  // mark as modified: fields derived from the cell type are re-computed when it changes
+  cell_type.inc_state_counter();
+  if (state_changed) {
+    // fields derived from the surface elevation (e.g. lapse rate corrections) have to be
+    // re-computed, too
+    ice_surface_elevation.inc_state_counter();
+    // code modifying ice thickness does not always do this (see
+    // IceGrid::surface_interpolation())
+    ice_thickness.inc_state_counter();
+  }
 
-  const double
-    ice_density = config->get_number("constants.ice.density"),
-    ocean_density = config->get_number("constants.sea_water.density");
-
-  compute_grounded_cell_fraction(ice_density,
-                                 ocean_density,
-                                 sea_level_elevation,
-                                 ice_thickness,
-                                 bed_elevation,
-                                 cell_grounded_fraction);
+  m_ice_free_thickness_threshold = ice_free_thickness_threshold;
+  m_cell_type_revision           = cell_type.state_counter();
+  m_surface_elevation_revision   = ice_surface_elevation.state_counter();
+  m_grounded_fraction_revision   = cell_grounded_fraction.state_counter();
 }
 
 /*! Compute the elevation of the bottom surface of the ice.
@@ -373,6 +453,105 @@ double sea_level_rise_potential(const Geometry &geometry, double thickness_thres
   return sea_level_change;
 }
 
+GeometryTotals::GeometryTotals()
+  : volume(0.0),
+    volume_glacierized(0.0),
+    volume_glacierized_grounded(0.0),
+    volume_glacierized_floating(0.0),
+    volume_not_displacing_seawater(0.0),
+    area_glacierized(0.0),
+    area_glacierized_grounded(0.0),
+    area_glacierized_floating(0.0) {
+  // empty
+}
+
+/*!
+ * Compute ice volumes and areas using one pass over the grid and one reduction.
+ *
+ * Results are the same as ones computed using ice_volume(), ice_area(),
+ * ice_area_grounded(), ice_area_floating() and ice_volume_not_displacing_seawater()
+ * (with the threshold `thickness_threshold` for "glacierized" quantities).
+ */
+GeometryTotals geometry_totals(const Geometry &geometry, double thickness_threshold) {
+  auto grid = geometry.ice_thickness.grid();
+  auto config = grid->ctx()->config();
+
+  const double
+    sea_water_density = config->get_number("constants.sea_water.density"),
+    ice_density       = config->get_number("constants.ice.density"),
+    cell_area         = grid->cell_area();
+
+  const bool part_grid = config->get_flag("geometry.part_grid.enabled");
+
+  IceModelVec::AccessList list{&geometry.cell_type, &geometry.ice_thickness,
+      &geometry.bed_elevation, &geometry.sea_level_elevation};
+
+  if (part_grid) {
+    list.add(geometry.ice_area_specific_volume);
+  }
+
+  // local contributions, in the order of GeometryTotals members
+  enum {VOLUME = 0, VOLUME_GLACIERIZED, VOLUME_GROUNDED, VOLUME_FLOATING, VOLUME_NDSW,
+        AREA, AREA_GROUNDED, AREA_FLOATING, N_TOTALS};
+  double local[N_TOTALS] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const double
+      H         = geometry.ice_thickness(i, j),
+      V         = H * cell_area,
+      V_href    = part_grid ? geometry.ice_area_specific_volume(i, j) * cell_area : 0.0,
+      bed       = geometry.bed_elevation(i, j),
+      sea_level = geometry.sea_level_elevation(i, j);
+
+    const bool
+      grounded = geometry.cell_type.grounded(i, j),
+      floating = geometry.cell_type.ocean(i, j);
+
+    local[VOLUME] += V + V_href;
+
+    if (H >= thickness_threshold) {
+      local[VOLUME_GLACIERIZED] += V;
+      local[AREA]               += cell_area;
+
+      if (grounded) {
+        local[VOLUME_GROUNDED] += V;
+        local[AREA_GROUNDED]   += cell_area;
+      }
+
+      if (floating) {
+        local[VOLUME_FLOATING] += V;
+        local[AREA_FLOATING]   += cell_area;
+      }
+    }
+    local[VOLUME_GLACIERIZED] += V_href;
+
+    if (grounded and H > thickness_threshold) {
+      if (bed > sea_level) {
+        local[VOLUME_NDSW] += V;
+      } else {
+        const double max_floating_volume = (sea_level - bed) * cell_area * (sea_water_density / ice_density);
+        local[VOLUME_NDSW] += V - max_floating_volume;
+      }
+    }
+  } // end of the loop over grid points
+
+  double total[N_TOTALS];
+  GlobalSum(grid->com, local, total, N_TOTALS);
+
+  GeometryTotals result;
+  result.volume                         = total[VOLUME];
+  result.volume_glacierized             = total[VOLUME_GLACIERIZED];
+  result.volume_glacierized_grounded    = total[VOLUME_GROUNDED];
+  result.volume_glacierized_floating    = total[VOLUME_FLOATING];
+  result.volume_not_displacing_seawater = total[VOLUME_NDSW];
+  result.area_glacierized               = total[AREA];
+  result.area_glacierized_grounded      = total[AREA_GROUNDED];
+  result.area_glacierized_floating      = total[AREA_FLOATING];
+
+  return result;
+}
 
 /*!
  * @brief Set no_model_mask variable to have value 1 in strip of width 'strip' m around
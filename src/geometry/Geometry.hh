@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,6 +20,8 @@
 #ifndef GEOMETRY_H
 #define GEOMETRY_H
 
+#include <vector>
+
 #include "pism/util/IceGrid.hh"
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/IceModelVec2CellType.hh"
@@ -35,6 +37,11 @@ public:
   /*!
    * Ensures consistency of ice geometry by re-computing cell type, cell grounded fraction, and ice
    * surface elevation.
+   *
+   * Redundant fields are re-computed only at grid points where ice thickness, ice area
+   * specific volume, bed elevation, or sea level elevation changed since the last call.
+   * If nothing changed the only communication is one global reduction and the update of
+   * ghosts of ice thickness and ice area specific volume.
    */
   void ensure_consistency(double ice_free_thickness_threshold);
 
@@ -57,6 +64,16 @@ public:
   IceModelVec2CellType cell_type;
   IceModelVec2S cell_grounded_fraction;
   IceModelVec2S ice_surface_elevation;
+private:
+  // ice thickness, ice area specific volume, bed elevation, and sea level elevation at
+  // grid points owned by this process used by the last ensure_consistency() call
+  std::vector<double> m_consistent_state;
+  // ice-free thickness threshold used by the last ensure_consistency() call
+  double m_ice_free_thickness_threshold;
+  // state counters of redundant fields after the last ensure_consistency() call
+  int m_cell_type_revision;
+  int m_surface_elevation_revision;
+  int m_grounded_fraction_revision;
 };
 
 void ice_bottom_surface(const Geometry &geometry, IceModelVec2S &result);
@@ -69,6 +86,30 @@ double ice_volume_not_displacing_seawater(const Geometry &geometry,
                                           double thickness_threshold);
 double sea_level_rise_potential(const Geometry &geometry, double thickness_threshold);
 
+//! Totals used by scalar diagnostics (see geometry_totals()).
+struct GeometryTotals {
+  GeometryTotals();
+
+  //! ice volume, including seasonal cover, m^3
+  double volume;
+  //! ice volume in glacierized areas, m^3
+  double volume_glacierized;
+  //! grounded ice volume in glacierized areas, m^3
+  double volume_glacierized_grounded;
+  //! floating ice volume in glacierized areas, m^3
+  double volume_glacierized_floating;
+  //! volume of the ice not displacing sea water (glacierized areas only), m^3
+  double volume_not_displacing_seawater;
+  //! glacierized area, m^2
+  double area_glacierized;
+  //! grounded glacierized area, m^2
+  double area_glacierized_grounded;
+  //! floating glacierized area, m^2
+  double area_glacierized_floating;
+};
+
+GeometryTotals geometry_totals(const Geometry &geometry, double thickness_threshold);
+
 void set_no_model_strip(const IceGrid &grid, double width, IceModelVec2Int &result);
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,6 +20,7 @@
 #include "GeometryEvolution.hh"
 
 #include "pism/util/iceModelVec.hh"
+#include "pism/util/IceModelVecView.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/Mask.hh"
 
@@ -27,6 +28,10 @@
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/Tiles.hh"
+#include "pism/util/petscwrappers/KSP.hh"
+#include "pism/util/petscwrappers/Mat.hh"
+#include "pism/util/error_handling.hh"
 
 namespace pism {
 
@@ -42,6 +47,17 @@ struct GeometryEvolution::Impl {
 
   const Profiling &profile;
 
+  //! IDs of profiling regions
+  struct {
+    int ghosted_copies;
+    int interface_fluxes;
+    int update_in_place;
+    int compute_changes;
+    int ensure_nonnegativity;
+    int source_terms;
+    int implicit_diffusion;
+  } regions;
+
   GeometryCalculator gc;
 
   double ice_density;
@@ -52,6 +68,9 @@ struct GeometryEvolution::Impl {
   //! True if the part-grid scheme is enabled.
   bool use_part_grid;
 
+  //! True if the diffusive (SIA) flux is treated implicitly.
+  bool implicit_diffusion;
+
   //! Flux divergence (used to track thickness changes due to flow).
   IceModelVec2S flux_divergence;
 
@@ -70,7 +89,8 @@ struct GeometryEvolution::Impl {
   //! Change in the ice area-specific volume due to flow during the last time step.
   IceModelVec2S ice_area_specific_volume_change;
 
-  //! Flux through cell interfaces. Ghosted.
+  //! Flux through cell interfaces. Ghosted; only the west and south ghosts are valid
+  //! (these are needed to compute the flux divergence).
   IceModelVec2Stag flux_staggered;
 
   // Work space
@@ -84,6 +104,16 @@ struct GeometryEvolution::Impl {
   IceModelVec2S        residual;             // ghosted; temporary storage
   IceModelVec2S        thickness;            // ghosted; temporary storage
   IceModelVec2Int      velocity_bc_mask;
+
+  // Implicit treatment of the diffusive flux (allocated if implicit_diffusion is set)
+  IceModelVec2Stag     diffusivity;          // ghosted; linearized diffusivity
+  IceModelVec2Stag     explicit_flux;        // ghosted; diffusive flux treated explicitly
+  IceModelVec2Stag     implicit_flux;        // ghosted; diffusive flux at the end of the step
+  IceModelVec2S        implicit_rhs;         // right hand side
+  IceModelVec2S        implicit_thickness;   // solution
+  IceModelVec2S        implicit_thickness_ghosted;
+  petsc::Mat           A;
+  petsc::KSP           ksp;
 };
 
 GeometryEvolution::Impl::Impl(IceGrid::ConstPtr grid)
@@ -109,6 +139,17 @@ GeometryEvolution::Impl::Impl(IceGrid::ConstPtr grid)
 
   Config::ConstPtr config = grid->ctx()->config();
 
+  // register profiling regions once (see Profiling::region())
+  {
+    regions.ghosted_copies       = profile.region("ge.update_ghosted_copies");
+    regions.interface_fluxes     = profile.region("ge.interface_fluxes");
+    regions.update_in_place      = profile.region("ge.update_in_place");
+    regions.compute_changes      = profile.region("ge.compute_changes");
+    regions.ensure_nonnegativity = profile.region("ge.ensure_nonnegativity");
+    regions.source_terms         = profile.region("ge.source_terms");
+    regions.implicit_diffusion   = profile.region("ge.implicit_diffusion");
+  }
+
   gc.set_icefree_thickness(config->get_number("geometry.ice_free_thickness_standard"));
 
   // constants
@@ -116,11 +157,14 @@ GeometryEvolution::Impl::Impl(IceGrid::ConstPtr grid)
     ice_density   = config->get_number("constants.ice.density");
     use_bmr       = config->get_flag("geometry.update.use_basal_melt_rate");
     use_part_grid = config->get_flag("geometry.part_grid.enabled");
+
+    implicit_diffusion = config->get_flag("geometry.update.implicit_diffusion.enabled");
   }
 
   // reported quantities
   {
-    // This is the only reported field that is ghosted (we need ghosts to compute flux divergence).
+    // This is the only reported field that is ghosted (we need ghosts to compute flux
+    // divergence). Only the west and south ghosts are valid (see flow_step()).
     flux_staggered.set_attrs("diagnostic", "fluxes through cell interfaces (sides)"
                              " on the staggered grid",
                              "m2 s-1", "m2 year-1", "", 0);
@@ -179,6 +223,47 @@ GeometryEvolution::Impl::Impl(IceGrid::ConstPtr grid)
                                " (1 at velocity B.C. location, 0 elsewhere)",
                                "", "", "", 0);
   }
+
+  if (implicit_diffusion) {
+    diffusivity.create(grid, "linearized_diffusivity", WITH_GHOSTS);
+    diffusivity.set_attrs("internal", "linearized SIA diffusivity", "m2 s-1", "m2 s-1", "", 0);
+
+    explicit_flux.create(grid, "explicit_diffusive_flux", WITH_GHOSTS);
+    explicit_flux.set_attrs("internal", "part of the diffusive flux treated explicitly",
+                            "m2 s-1", "m2 s-1", "", 0);
+
+    implicit_flux.create(grid, "implicit_diffusive_flux", WITH_GHOSTS);
+    implicit_flux.set_attrs("internal", "diffusive flux at the end of the time step",
+                            "m2 s-1", "m2 s-1", "", 0);
+
+    implicit_rhs.create(grid, "implicit_rhs", WITHOUT_GHOSTS);
+    implicit_rhs.set_attrs("internal", "right hand side of the implicit diffusion system",
+                           "meters", "meters", "", 0);
+
+    implicit_thickness.create(grid, "implicit_thickness", WITHOUT_GHOSTS);
+    implicit_thickness.set_attrs("internal", "ice thickness at the end of the step"
+                                 " (due to diffusion only)", "meters", "meters", "", 0);
+
+    implicit_thickness_ghosted.create(grid, "implicit_thickness_ghosted", WITH_GHOSTS);
+    implicit_thickness_ghosted.set_attrs("internal", "ghosted copy of implicit_thickness",
+                                         "meters", "meters", "", 0);
+
+    PetscErrorCode ierr = DMCreateMatrix(*implicit_rhs.dm(), A.rawptr());
+    PISM_CHK(ierr, "DMCreateMatrix");
+
+    ierr = KSPCreate(grid->com, ksp.rawptr());
+    PISM_CHK(ierr, "KSPCreate");
+
+    ierr = KSPSetOptionsPrefix(ksp, "geometry_implicit_");
+    PISM_CHK(ierr, "KSPSetOptionsPrefix");
+
+    // use the thickness at the beginning of the step as the initial guess
+    ierr = KSPSetInitialGuessNonzero(ksp, PETSC_TRUE);
+    PISM_CHK(ierr, "KSPSetInitialGuessNonzero");
+
+    ierr = KSPSetFromOptions(ksp);
+    PISM_CHK(ierr, "KSPSetFromOptions");
+  }
 }
 
 GeometryEvolution::GeometryEvolution(IceGrid::ConstPtr grid)
@@ -231,7 +316,7 @@ const IceModelVec2S& GeometryEvolution::conservation_error() const {
  * @param[in] geometry ice geometry
  * @param[in] dt time step, seconds
  * @param[in] advective_velocity advective (SSA) velocity
- * @param[in] diffusive_flux diffusive (SIA) flux
+ * @param[in] diffusive_flux diffusive (SIA) flux; if it has ghosts, they have to be valid
  * @param[in] velocity_bc_mask advective velocity Dirichlet B.C. mask
  * @param[in] velocity_bc_values advective velocity Dirichlet B.C. values
  * @param[in] thickness_bc_mask ice thickness Dirichlet B.C. mask
@@ -244,7 +329,11 @@ void GeometryEvolution::flow_step(const Geometry &geometry, double dt,
                                   const IceModelVec2Int  &velocity_bc_mask,
                                   const IceModelVec2Int  &thickness_bc_mask) {
 
-  m_impl->profile.begin("ge.update_ghosted_copies");
+  // number of grid points in the sub-domain (used to estimate the work done in each
+  // sub-step; see Profiling::add_work())
+  const double points = m_grid->xm() * m_grid->ym();
+
+  m_impl->profile.begin(m_impl->regions.ghosted_copies);
   {
     // make ghosted copies of input fields
     m_impl->ice_thickness.copy_from(geometry.ice_thickness);
@@ -261,45 +350,69 @@ void GeometryEvolution::flow_step(const Geometry &geometry, double dt,
                        m_impl->cell_type,          // out (ghosts are updated)
                        m_impl->surface_elevation); // out (ghosts are updated)
   }
-  m_impl->profile.end("ge.update_ghosted_copies");
+  m_impl->profile.end(m_impl->regions.ghosted_copies);
+
+  const IceModelVec2Stag *flux = &diffusive_flux;
+  if (m_impl->implicit_diffusion) {
+    m_impl->profile.begin(m_impl->regions.implicit_diffusion);
+    implicit_diffusive_flux(dt,
+                            m_impl->cell_type,         // in (uses ghosts)
+                            m_impl->ice_thickness,     // in (uses ghosts)
+                            m_impl->surface_elevation, // in (uses ghosts)
+                            diffusive_flux,            // in
+                            thickness_bc_mask,         // in
+                            m_impl->implicit_flux);    // out
+    m_impl->profile.end(m_impl->regions.implicit_diffusion);
+    flux = &m_impl->implicit_flux;
+  }
 
   // Derived classes can include modifications for regional runs.
-  m_impl->profile.begin("ge.interface_fluxes");
+  m_impl->profile.begin(m_impl->regions.interface_fluxes);
   compute_interface_fluxes(m_impl->cell_type,          // in (uses ghosts)
                            m_impl->ice_thickness,      // in (uses ghosts)
                            m_impl->input_velocity,     // in (uses ghosts)
                            m_impl->velocity_bc_mask,   // in (uses ghosts)
-                           diffusive_flux,             // in
+                           *flux,                      // in (uses ghosts if available)
                            m_impl->flux_staggered);    // out
-  m_impl->profile.end("ge.interface_fluxes");
-
-  m_impl->flux_staggered.update_ghosts();
-
-  m_impl->profile.begin("ge.flux_divergence");
-  compute_flux_divergence(m_impl->flux_staggered,   // in (uses ghosts)
-                          thickness_bc_mask,        // in
-                          m_impl->flux_divergence); // out
-  m_impl->profile.end("ge.flux_divergence");
+  m_impl->profile.end(m_impl->regions.interface_fluxes);
+  // two interfaces per grid point, each: about 10 flops, reading 8 and writing 1 value
+  m_impl->profile.add_work(m_impl->regions.interface_fluxes,
+                           2 * 10.0 * points, 2 * 8.0 * 9 * points);
+
+  // Fluxes through the west and south interfaces of the sub-domain are computed locally
+  // if ghosts of the diffusive flux are available, so ghosts of interface fluxes have to
+  // be communicated only if they are not.
+  if (flux->stencil_width() == 0) {
+    m_impl->flux_staggered.update_ghosts();
+  }
 
   // This is where part_grid is implemented.
-  m_impl->profile.begin("ge.update_in_place");
+  m_impl->profile.begin(m_impl->regions.update_in_place);
   update_in_place(dt,                            // in
                   m_impl->bed_elevation,         // in
                   m_impl->sea_level,             // in
-                  m_impl->flux_divergence,       // in
+                  m_impl->flux_staggered,        // in (uses west and south ghosts)
+                  thickness_bc_mask,             // in
+                  m_impl->flux_divergence,       // out
                   m_impl->ice_thickness,         // in/out
                   m_impl->area_specific_volume); // in/out
-  m_impl->profile.end("ge.update_in_place");
+  m_impl->profile.end(m_impl->regions.update_in_place);
+  // about 15 flops, reading 9 and writing 3 values per grid point
+  m_impl->profile.add_work(m_impl->regions.update_in_place,
+                           15.0 * points, 8.0 * 12 * points);
 
   // Compute ice thickness and area specific volume changes.
-  m_impl->profile.begin("ge.compute_changes");
+  m_impl->profile.begin(m_impl->regions.compute_changes);
   {
     m_impl->ice_thickness.add(-1.0, geometry.ice_thickness,
                               m_impl->thickness_change);
     m_impl->area_specific_volume.add(-1.0, geometry.ice_area_specific_volume,
                                      m_impl->ice_area_specific_volume_change);
   }
-  m_impl->profile.end("ge.compute_changes");
+  m_impl->profile.end(m_impl->regions.compute_changes);
+  // two differences, reading 4 and writing 2 values per grid point
+  m_impl->profile.add_work(m_impl->regions.compute_changes,
+                           2.0 * points, 8.0 * 6 * points);
 
   // Computes the numerical conservation error and corrects ice_thickness_change and
   // ice_area_specific_volume_change. We can do this here because
@@ -308,13 +421,13 @@ void GeometryEvolution::flow_step(const Geometry &geometry, double dt,
   // Note that here we use the "old" ice geometry.
   //
   // This computation is purely local.
-  m_impl->profile.begin("ge.ensure_nonnegativity");
+  m_impl->profile.begin(m_impl->regions.ensure_nonnegativity);
   ensure_nonnegativity(geometry.ice_thickness,                  // in
                        geometry.ice_area_specific_volume,       // in
                        m_impl->thickness_change,                // in/out
                        m_impl->ice_area_specific_volume_change, // in/out
                        m_impl->conservation_error);             // out
-  m_impl->profile.end("ge.ensure_nonnegativity");
+  m_impl->profile.end(m_impl->regions.ensure_nonnegativity);
 
   // Now the caller can compute
   //
@@ -329,7 +442,7 @@ void GeometryEvolution::source_term_step(const Geometry &geometry, double dt,
                                          const IceModelVec2S    &surface_mass_balance_rate,
                                          const IceModelVec2S    &basal_melt_rate) {
 
-  m_impl->profile.begin("ge.source_terms");
+  m_impl->profile.begin(m_impl->regions.source_terms);
   compute_surface_and_basal_mass_balance(dt,                        // in
                                          thickness_bc_mask,         // in
                                          geometry.ice_thickness,    // in
@@ -338,7 +451,7 @@ void GeometryEvolution::source_term_step(const Geometry &geometry, double dt,
                                          basal_melt_rate,           // in
                                          m_impl->effective_SMB,     // out
                                          m_impl->effective_BMB);    // out
-  m_impl->profile.end("ge.source_terms");
+  m_impl->profile.end(m_impl->regions.source_terms);
 
 }
 
@@ -524,6 +637,236 @@ static double limit_diffusive_flux(int current, int neighbor, double flux) {
                                 current, neighbor);
 }
 
+/*!
+ * Compute the diffusive flux at the end of the time step using the linearized backward
+ * Euler scheme.
+ *
+ * We write the diffusive (SIA) flux `Q` at each cell interface as `Q = -D (s_n - s) / dx
+ * + R`, where `D >= 0` is the "linearized diffusivity" computed using the surface
+ * elevation at the beginning of the step and `R` is the part of the flux that cannot be
+ * written in this form (e.g. an up-gradient flux). Then we solve
+ *
+ * `H^* + dt div(-D grad(H^* + z) + R) = H`,
+ *
+ * where `H^*` is the ice thickness at the end of the step due to diffusion only and `z =
+ * s - H` is kept fixed, and return fluxes computed using `H^*`.
+ *
+ * The ice thickness is then updated using these fluxes (see flow_step()), so this scheme
+ * is mass-conserving and is not limited by the diffusivity time step restriction. Cells
+ * with `thickness_bc_mask == 1` keep their thickness in the linear system.
+ *
+ * The linear system is solved by a PETSc KSP using the options prefix
+ * `-geometry_implicit_`.
+ */
+void GeometryEvolution::implicit_diffusive_flux(double dt,
+                                                const IceModelVec2CellType &cell_type,
+                                                const IceModelVec2S        &ice_thickness,
+                                                const IceModelVec2S        &surface_elevation,
+                                                const IceModelVec2Stag     &diffusive_flux,
+                                                const IceModelVec2Int      &thickness_bc_mask,
+                                                IceModelVec2Stag           &output) {
+  PetscErrorCode ierr;
+
+  IceModelVec2Stag
+    &D = m_impl->diffusivity,
+    &R = m_impl->explicit_flux;
+  IceModelVec2S
+    &b     = m_impl->implicit_rhs,
+    &H_new = m_impl->implicit_thickness;
+
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy(),
+    spacing[2] = {dx, dy};
+
+  // compute linearized diffusivity and the explicit flux
+  {
+    IceModelVec::AccessList list{&cell_type, &surface_elevation, &diffusive_flux, &D, &R};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      for (int n = 0; n < 2; ++n) {
+        const int
+          i_n = i + 1 - n,
+          j_n = j + n;
+
+        const double
+          Q  = limit_diffusive_flux(cell_type(i, j), cell_type(i_n, j_n),
+                                    diffusive_flux(i, j, n)),
+          ds = surface_elevation(i_n, j_n) - surface_elevation(i, j);
+
+        if (Q * ds < 0.0) {
+          D(i, j, n) = - Q * spacing[n] / ds;
+          R(i, j, n) = 0.0;
+        } else {
+          D(i, j, n) = 0.0;
+          R(i, j, n) = Q;
+        }
+      }
+    }
+  }
+  D.update_ghosts();
+  R.update_ghosts();
+
+  // assemble the system
+  {
+    ierr = MatZeroEntries(m_impl->A);
+    PISM_CHK(ierr, "MatZeroEntries");
+
+    IceModelVec::AccessList list{&ice_thickness, &surface_elevation, &thickness_bc_mask,
+                                 &D, &R, &b, &H_new};
+
+    const double
+      Cx = dt / (dx * dx),
+      Cy = dt / (dy * dy);
+
+    ParallelSection loop(m_grid->com);
+    try {
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        MatStencil row, col[5];
+        row.i = i;
+        row.j = j;
+        row.c = 0;
+
+        H_new(i, j) = ice_thickness(i, j);
+
+        if (thickness_bc_mask.as_int(i, j) == 1) {
+          const double one = 1.0;
+          ierr = MatSetValuesStencil(m_impl->A, 1, &row, 1, &row, &one, INSERT_VALUES);
+          PISM_CHK(ierr, "MatSetValuesStencil");
+
+          b(i, j) = ice_thickness(i, j);
+          continue;
+        }
+
+        auto z = [&](int ii, int jj) {
+          return surface_elevation(ii, jj) - ice_thickness(ii, jj);
+        };
+
+        const double
+          D_e = D(i, j, 0),
+          D_w = D(i - 1, j, 0),
+          D_n = D(i, j, 1),
+          D_s = D(i, j - 1, 1),
+          z_c = z(i, j);
+
+        // neighbors: east, west, north, south, and the current cell
+        const int
+          di[5] = {1, -1, 0,  0, 0},
+          dj[5] = {0,  0, 1, -1, 0};
+        const double values[5] = {-Cx * D_e, -Cx * D_w, -Cy * D_n, -Cy * D_s,
+          1.0 + Cx * (D_e + D_w) + Cy * (D_n + D_s)};
+
+        for (int k = 0; k < 5; ++k) {
+          col[k].i = i + di[k];
+          col[k].j = j + dj[k];
+          col[k].c = 0;
+        }
+
+        ierr = MatSetValuesStencil(m_impl->A, 1, &row, 5, col, values, INSERT_VALUES);
+        PISM_CHK(ierr, "MatSetValuesStencil");
+
+        b(i, j) = (ice_thickness(i, j)
+                   + Cx * (D_e * (z(i + 1, j) - z_c) - D_w * (z_c - z(i - 1, j)))
+                   + Cy * (D_n * (z(i, j + 1) - z_c) - D_s * (z_c - z(i, j - 1)))
+                   - dt * ((R(i, j, 0) - R(i - 1, j, 0)) / dx +
+                           (R(i, j, 1) - R(i, j - 1, 1)) / dy));
+      }
+    } catch (...) {
+      loop.failed();
+    }
+    loop.check();
+
+    ierr = MatAssemblyBegin(m_impl->A, MAT_FINAL_ASSEMBLY);
+    PISM_CHK(ierr, "MatAssemblyBegin");
+
+    ierr = MatAssemblyEnd(m_impl->A, MAT_FINAL_ASSEMBLY);
+    PISM_CHK(ierr, "MatAssemblyEnd");
+  }
+
+  // solve
+  {
+    ierr = KSPSetOperators(m_impl->ksp, m_impl->A, m_impl->A);
+    PISM_CHK(ierr, "KSPSetOperators");
+
+    ierr = KSPSolve(m_impl->ksp, b.vec(), H_new.vec());
+    PISM_CHK(ierr, "KSPSolve");
+
+    KSPConvergedReason reason;
+    ierr = KSPGetConvergedReason(m_impl->ksp, &reason);
+    PISM_CHK(ierr, "KSPGetConvergedReason");
+
+    if (reason < 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "implicit mass continuity: KSP solver failed (reason: %s)",
+                                    KSPConvergedReasons[reason]);
+    }
+  }
+
+  // compute fluxes using the new thickness and the old "base" elevation z = s - H
+  //
+  // Fluxes through the west and south interfaces of the sub-domain are computed too (see
+  // compute_interface_fluxes()).
+  {
+    IceModelVec2S &H = m_impl->implicit_thickness_ghosted;
+    H.copy_from(H_new);
+
+    IceModelVec::AccessList list{&H, &ice_thickness, &surface_elevation, &D, &R, &output};
+
+    View2<const double>
+      H_view(H),
+      H_old(ice_thickness),
+      s_old(surface_elevation);
+    View2<const double, 2>
+      D_view(D),
+      R_view(R);
+    View2<double, 2> Q(output);
+
+    const int
+      xs = m_grid->xs(),
+      xm = m_grid->xm(),
+      ys = m_grid->ys(),
+      ym = m_grid->ym();
+
+    for (int j = ys - 1; j < ys + ym; ++j) {
+      for (int i = xs - 1; i < xs + xm; ++i) {
+        for (int n = 0; n < 2; ++n) {
+          const int
+            i_n = i + 1 - n,
+            j_n = j + n;
+
+          const double
+            s   = H_view(i, j) + s_old(i, j) - H_old(i, j),
+            s_n = H_view(i_n, j_n) + s_old(i_n, j_n) - H_old(i_n, j_n);
+
+          Q(i, j, n) = - D_view(i, j, n) * (s_n - s) / spacing[n] + R_view(i, j, n);
+        }
+      }
+    }
+  }
+}
+
+/*!
+ * Tiles covering grid points at which interface fluxes are computed (see
+ * GeometryEvolution::compute_interface_fluxes()).
+ *
+ * If `diffusive_flux` has ghosts this includes the column and the row of ghost points
+ * west and south of the sub-domain, i.e. all interfaces of cells in the sub-domain.
+ */
+static Tiles interface_tiles(const IceGrid &grid, const IceModelVec2Stag &diffusive_flux) {
+  const int
+    w  = diffusive_flux.stencil_width() > 0 ? 1 : 0,
+    xs = grid.xs(),
+    xm = grid.xm(),
+    ys = grid.ys(),
+    ym = grid.ym();
+
+  return Tiles(grid, xs - w, xs + xm - 1, ys - w, ys + ym - 1);
+}
+
 /*!
  * Combine advective velocity and the diffusive flux on the staggered grid with the ice thickness to
  * compute the total flux through cell interfaces.
@@ -531,6 +874,10 @@ static double limit_diffusive_flux(int current, int neighbor, double flux) {
  * Uses first-order upwinding to compute the advective flux.
  *
  * Limits the diffusive flux to prevent SIA-driven flow in the ocean and ice-free areas.
+ *
+ * If `diffusive_flux` has ghosts, fluxes through the west and south interfaces of the
+ * sub-domain are computed as well (see interface_tiles()), so that the flux divergence
+ * can be computed without communication. Ghosts of `output` are not updated.
  */
 void GeometryEvolution::compute_interface_fluxes(const IceModelVec2CellType &cell_type,
                                                  const IceModelVec2S        &ice_thickness,
@@ -542,127 +889,98 @@ void GeometryEvolution::compute_interface_fluxes(const IceModelVec2CellType &cel
   IceModelVec::AccessList list{&cell_type, &velocity, &velocity_bc_mask, &ice_thickness,
       &diffusive_flux, &output};
 
+  const Tiles tiles = interface_tiles(*m_grid, diffusive_flux);
+
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int
-        i  = p.i(),
-        j  = p.j(),
-        M  = cell_type(i, j),
-        BC = velocity_bc_mask.as_int(i, j);
-
-      const double H = ice_thickness(i, j);
-      const Vector2 V  = velocity(i, j);
-
-      for (int n = 0; n < 2; ++n) {
+    for_each_tile(tiles, [&](const Tile &tile) {
+      for (PointsInTile p(tile); p; p.next()) {
         const int
-          oi  = 1 - n,               // offset in the i direction
-          oj  = n,                   // offset in the j direction
-          i_n = i + oi,              // i index of a neighbor
-          j_n = j + oj;              // j index of a neighbor
-
-        const int M_n = cell_type(i_n, j_n);
+          i  = p.i(),
+          j  = p.j(),
+          M  = cell_type(i, j),
+          BC = velocity_bc_mask.as_int(i, j);
 
-        // advective velocity at the current interface
-        double v = 0.0;
-        {
-          const Vector2 V_n  = velocity(i_n, j_n);
+        const double H = ice_thickness(i, j);
+        const Vector2 V  = velocity(i, j);
 
-          // Regular case
-          {
-            if (icy(M) and icy(M_n)) {
-              // Case 1: both sides of the interface are icy
-              v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
-
-            } else if (icy(M) and ice_free(M_n)) {
-              // Case 2: icy cell next to an ice-free cell
-              v = (n == 0 ? V.u : V.v);
-
-            } else if (ice_free(M) and icy(M_n)) {
-              // Case 3: ice-free cell next to icy cell
-              v = (n == 0 ? V_n.u : V_n.v);
-
-            } else if (ice_free(M) and ice_free(M_n)) {
-              // Case 4: both sides of the interface are ice-free
-              v = 0.0;
+        for (int n = 0; n < 2; ++n) {
+          const int
+            oi  = 1 - n,               // offset in the i direction
+            oj  = n,                   // offset in the j direction
+            i_n = i + oi,              // i index of a neighbor
+            j_n = j + oj;              // j index of a neighbor
 
-            }
-          }
+          const int M_n = cell_type(i_n, j_n);
 
-          // The Dirichlet B.C. case:
+          // advective velocity at the current interface
+          double v = 0.0;
           {
-            const int BC_n = velocity_bc_mask.as_int(i_n, j_n);
+            const Vector2 V_n  = velocity(i_n, j_n);
 
-            if (BC == 1 and BC_n == 1) {
-              // Case 1: both sides of the interface are B.C. locations: average from
-              // the regular grid onto the staggered grid.
-              v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
+            // Regular case
+            {
+              if (icy(M) and icy(M_n)) {
+                // Case 1: both sides of the interface are icy
+                v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
 
-            } else if (BC == 1 and BC_n == 0) {
-              // Case 2: at a Dirichlet B.C. location next to a regular location
-              v = (n == 0 ? V.u : V.v);
+              } else if (icy(M) and ice_free(M_n)) {
+                // Case 2: icy cell next to an ice-free cell
+                v = (n == 0 ? V.u : V.v);
 
-            } else if (BC == 0 and BC_n == 1) {
+              } else if (ice_free(M) and icy(M_n)) {
+                // Case 3: ice-free cell next to icy cell
+                v = (n == 0 ? V_n.u : V_n.v);
 
-              // Case 3: at a regular location next to a Dirichlet B.C. location
-              v = (n == 0 ? V_n.u : V_n.v);
+              } else if (ice_free(M) and ice_free(M_n)) {
+                // Case 4: both sides of the interface are ice-free
+                v = 0.0;
 
-            } else {
-              // Case 4: elsewhere.
-              // No Dirichlet B.C. adjustment here.
+              }
             }
 
-          } // end of the Dirichlet B.C. case
+            // The Dirichlet B.C. case:
+            {
+              const int BC_n = velocity_bc_mask.as_int(i_n, j_n);
 
-          // finally, limit advective velocities
-          v = limit_advective_velocity(M, M_n, v);
-        }
+              if (BC == 1 and BC_n == 1) {
+                // Case 1: both sides of the interface are B.C. locations: average from
+                // the regular grid onto the staggered grid.
+                v = (n == 0 ? 0.5 * (V.u + V_n.u) : 0.5 * (V.v + V_n.v));
 
-        // advective flux
-        const double
-          H_n         = ice_thickness(i_n, j_n),
-          Q_advective = v * (v > 0.0 ? H : H_n); // first order upwinding
+              } else if (BC == 1 and BC_n == 0) {
+                // Case 2: at a Dirichlet B.C. location next to a regular location
+                v = (n == 0 ? V.u : V.v);
 
-        // diffusive flux
-        const double
-          Q_diffusive = limit_diffusive_flux(M, M_n, diffusive_flux(i, j, n));
+              } else if (BC == 0 and BC_n == 1) {
 
-        output(i, j, n) = Q_diffusive + Q_advective;
-      } // end of the loop over neighbors (n)
-    }
-  } catch (...) {
-    loop.failed();
-  }
-  loop.check();
-}
+                // Case 3: at a regular location next to a Dirichlet B.C. location
+                v = (n == 0 ? V_n.u : V_n.v);
 
-/*!
- * Compute flux divergence using cell interface fluxes on the staggered grid.
- *
- * The flux divergence at *ice thickness* Dirichlet B.C. locations is set to zero.
- */
-void GeometryEvolution::compute_flux_divergence(const IceModelVec2Stag &flux,
-                                                const IceModelVec2Int &thickness_bc_mask,
-                                                IceModelVec2S &output) {
-  const double
-    dx = m_grid->dx(),
-    dy = m_grid->dy();
+              } else {
+                // Case 4: elsewhere.
+                // No Dirichlet B.C. adjustment here.
+              }
 
-  IceModelVec::AccessList list{&flux, &thickness_bc_mask, &output};
+            } // end of the Dirichlet B.C. case
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+            // finally, limit advective velocities
+            v = limit_advective_velocity(M, M_n, v);
+          }
 
-      if (thickness_bc_mask(i, j) > 0.5) {
-        output(i, j) = 0.0;
-      } else {
-        StarStencil<double> Q = flux.star(i, j);
+          // advective flux
+          const double
+            H_n         = ice_thickness(i_n, j_n),
+            Q_advective = v * (v > 0.0 ? H : H_n); // first order upwinding
 
-        output(i, j) = (Q.e - Q.w) / dx + (Q.n - Q.s) / dy;
+          // diffusive flux
+          const double
+            Q_diffusive = limit_diffusive_flux(M, M_n, diffusive_flux(i, j, n));
+
+          output(i, j, n) = Q_diffusive + Q_advective;
+        } // end of the loop over neighbors (n)
       }
-    }
+    });
   } catch (...) {
     loop.failed();
   }
@@ -677,26 +995,34 @@ void GeometryEvolution::compute_flux_divergence(const IceModelVec2Stag &flux,
  * ice thickness and area_specific_volume, use this old code, then compute differences to get changes.
  * Compute ice thickness changes due to the flow of the ice.
  *
+ * The flux divergence is computed in the same sweep over the grid. It is set to zero at
+ * *ice thickness* Dirichlet B.C. locations.
+ *
+ * Uses `cell_type` and `surface_elevation` in m_impl: these have to correspond to
+ * `ice_thickness` (see flow_step()).
+ *
  * @param[in] dt time step, seconds
  * @param[in] bed_elevation bed elevation, meters
  * @param[in] sea_level sea level elevation
- * @param[in] ice_thickness ice thickness
- * @param[in] area_specific_volume area-specific volume (m3/m2)
- * @param[in] flux_divergence flux divergence
- * @param[out] thickness_change ice thickness change due to flow
- * @param[out] area_specific_volume_change area specific volume change due to flow
+ * @param[in] flux fluxes through cell interfaces (uses west and south ghosts)
+ * @param[in] thickness_bc_mask ice thickness Dirichlet B.C. mask
+ * @param[out] flux_divergence flux divergence
+ * @param[in,out] ice_thickness ice thickness
+ * @param[in,out] area_specific_volume area-specific volume (m3/m2)
  */
 void GeometryEvolution::update_in_place(double dt,
                                         const IceModelVec2S &bed_topography,
                                         const IceModelVec2S &sea_level,
-                                        const IceModelVec2S &flux_divergence,
+                                        const IceModelVec2Stag &flux,
+                                        const IceModelVec2Int &thickness_bc_mask,
+                                        IceModelVec2S &flux_divergence,
                                         IceModelVec2S &ice_thickness,
                                         IceModelVec2S &area_specific_volume) {
+  const double
+    dx = m_grid->dx(),
+    dy = m_grid->dy();
 
-  m_impl->gc.compute(sea_level, bed_topography, ice_thickness,
-                     m_impl->cell_type, m_impl->surface_elevation);
-
-  IceModelVec::AccessList list{&ice_thickness, &flux_divergence};
+  IceModelVec::AccessList list{&ice_thickness, &flux, &thickness_bc_mask, &flux_divergence};
 
   if (m_impl->use_part_grid) {
     m_impl->residual.set(0.0);
@@ -715,50 +1041,62 @@ void GeometryEvolution::update_in_place(double dt,
   const double Lz = m_grid->Lz();
 #endif
 
+  const Tiles tiles(*m_grid);
+
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-
-      double divQ = flux_divergence(i, j);
+    for_each_tile(tiles, [&](const Tile &tile) {
+      for (PointsInTile p(tile); p; p.next()) {
+        const int i = p.i(), j = p.j();
 
-      if (m_impl->use_part_grid) {
-        if (m_impl->cell_type.ice_free_ocean(i, j) and m_impl->cell_type.next_to_ice(i, j)) {
-          // Add the flow contribution to this partially filled cell.
-          area_specific_volume(i, j) += -divQ * dt;
+        double divQ = 0.0;
+        if (thickness_bc_mask(i, j) > 0.5) {
+          divQ = 0.0;
+        } else {
+          StarStencil<double> Q = flux.star(i, j);
 
-          double threshold = part_grid_threshold_thickness(m_impl->cell_type.int_star(i, j),
-                                                           m_impl->thickness.star(i, j),
-                                                           m_impl->surface_elevation.star(i, j),
-                                                           bed_topography(i, j));
+          divQ = (Q.e - Q.w) / dx + (Q.n - Q.s) / dy;
+        }
+        flux_divergence(i, j) = divQ;
+
+        if (m_impl->use_part_grid) {
+          if (m_impl->cell_type.ice_free_ocean(i, j) and m_impl->cell_type.next_to_ice(i, j)) {
+            // Add the flow contribution to this partially filled cell.
+            area_specific_volume(i, j) += -divQ * dt;
+
+            double threshold = part_grid_threshold_thickness(m_impl->cell_type.int_star(i, j),
+                                                             m_impl->thickness.star(i, j),
+                                                             m_impl->surface_elevation.star(i, j),
+                                                             bed_topography(i, j));
+
+            // if threshold is zero, turn all the area specific volume into ice thickness, with zero
+            // residual
+            if (threshold == 0.0) {
+              threshold = area_specific_volume(i, j);
+            }
 
-          // if threshold is zero, turn all the area specific volume into ice thickness, with zero
-          // residual
-          if (threshold == 0.0) {
-            threshold = area_specific_volume(i, j);
-          }
+            if (area_specific_volume(i, j) >= threshold) {
+              ice_thickness(i, j)        += threshold;
+              m_impl->residual(i, j)      = area_specific_volume(i, j) - threshold;
+              area_specific_volume(i, j)  = 0.0;
+            }
 
-          if (area_specific_volume(i, j) >= threshold) {
-            ice_thickness(i, j)        += threshold;
-            m_impl->residual(i, j)      = area_specific_volume(i, j) - threshold;
-            area_specific_volume(i, j)  = 0.0;
+            // In this case the flux goes into the area_specific_volume variable and does not directly
+            // contribute to ice thickness at this location.
+            divQ = 0.0;
           }
+        } // end of if (use_part_grid)
 
-          // In this case the flux goes into the area_specific_volume variable and does not directly
-          // contribute to ice thickness at this location.
-          divQ = 0.0;
-        }
-      } // end of if (use_part_grid)
-
-      ice_thickness(i, j) += - dt * divQ;
+        ice_thickness(i, j) += - dt * divQ;
 
 #if (Pism_DEBUG==1)
-      if (ice_thickness(i, j) > Lz) {
-        throw RuntimeError::formatted(PISM_ERROR_LOCATION, "ice thickness exceeds Lz at i=%d, j=%d (H=%f, Lz=%f)",
-                                      i, j, ice_thickness(i, j), Lz);
-      }
+        if (ice_thickness(i, j) > Lz) {
+          throw RuntimeError::formatted(PISM_ERROR_LOCATION, "ice thickness exceeds Lz at i=%d, j=%d (H=%f, Lz=%f)",
+                                        i, j, ice_thickness(i, j), Lz);
+        }
 #endif
-    }
+      }
+    });
   } catch (...) {
     loop.failed();
   }
@@ -775,171 +1113,309 @@ void GeometryEvolution::update_in_place(double dt,
     See [@ref Albrechtetal2011].
   */
   if (m_impl->use_part_grid) {
-    const int max_n_iterations = m_config->get_number("geometry.part_grid.max_iterations");
-
-    bool done = false;
-    for (int i = 0; i < max_n_iterations and not done; ++i) {
-      m_log->message(4, "redistribution iteration %d\n", i);
-
-      // this call may set done to true
-      residual_redistribution_iteration(bed_topography,
-                                        sea_level,
-                                        m_impl->surface_elevation,
-                                        ice_thickness,
-                                        m_impl->cell_type,
-                                        area_specific_volume,
-                                        m_impl->residual,
-                                        done);
-    }
-
-    if (not done) {
-      m_log->message(2,
-                     "WARNING: not done redistributing mass after %d iterations, remaining residual: %f m^3.\n",
-                     max_n_iterations, m_impl->residual.sum() * m_grid->cell_area());
-
-      // Add residual to ice thickness, preserving total ice mass. (This is not great, but
-      // better than losing mass.)
-      ice_thickness.add(1.0, m_impl->residual);
-      m_impl->residual.set(0.0);
-    }
+    redistribute_residual(bed_topography,
+                          sea_level,
+                          m_impl->surface_elevation,
+                          ice_thickness,
+                          m_impl->cell_type,
+                          area_specific_volume,
+                          m_impl->residual);
   }
 }
 
-//! @brief Perform one iteration of the residual mass redistribution.
 /*!
-  @param[in] bed_topography bed elevation
-  @param[in] sea_level sea level elevation
-  @param[in,out] ice_surface_elevation surface elevation; used as temp. storage
-  @param[in,out] ice_thickness ice thickness; updated
-  @param[in,out] cell_type cell type mask; used as temp. storage
-  @param[in,out] area_specific_volume area specific volume; updated
-  @param[in,out] residual ice volume that still needs to be distributed; updated
-  @param[in,out] done result flag: true if this iteration should be the last one
+ * @brief Redistribute residual ice mass from the subgrid-scale parameterization.
+ *
+ * Each iteration spreads the residual of cells that were filled among their ice-free
+ * ocean neighbors, then fills partially filled cells (cells with positive area specific
+ * volume) that reached the threshold thickness. Iterations stop when no residual remains
+ * or after `geometry.part_grid.max_iterations` iterations.
+ *
+ * Only cells with positive residual or area specific volume and their neighbors are
+ * visited. The cell type, the surface elevation and the copy of the ice thickness used to
+ * compute threshold thickness are updated where the ice thickness changed and at ghost
+ * points instead of everywhere; this does not change results.
+ *
+ * @param[in] bed_topography bed elevation
+ * @param[in] sea_level sea level elevation
+ * @param[in,out] ice_surface_elevation surface elevation; used as temp. storage
+ * @param[in,out] ice_thickness ice thickness; updated
+ * @param[in,out] cell_type cell type mask corresponding to `ice_thickness` (including ghosts);
+ *                used as temp. storage
+ * @param[in,out] area_specific_volume area specific volume; updated
+ * @param[in,out] residual ice volume that still needs to be distributed; set to zero
  */
-void GeometryEvolution::residual_redistribution_iteration(const IceModelVec2S  &bed_topography,
-                                                          const IceModelVec2S  &sea_level,
-                                                          IceModelVec2S        &ice_surface_elevation,
-                                                          IceModelVec2S        &ice_thickness,
-                                                          IceModelVec2CellType &cell_type,
-                                                          IceModelVec2S        &area_specific_volume,
-                                                          IceModelVec2S        &residual,
-                                                          bool &done) {
+void GeometryEvolution::redistribute_residual(const IceModelVec2S  &bed_topography,
+                                              const IceModelVec2S  &sea_level,
+                                              IceModelVec2S        &ice_surface_elevation,
+                                              IceModelVec2S        &ice_thickness,
+                                              IceModelVec2CellType &cell_type,
+                                              IceModelVec2S        &area_specific_volume,
+                                              IceModelVec2S        &residual) {
+
+  const int max_n_iterations = m_config->get_number("geometry.part_grid.max_iterations");
+
+  const GeometryCalculator &gc = m_impl->gc;
+
+  // Copy of the ice thickness. We need this copy to make sure that modifying
+  // ice_thickness below does not affect the computation of the threshold thickness.
+  // (Note that part_grid_threshold_thickness uses neighboring values of the mask, ice
+  // thickness, and surface elevation.)
+  IceModelVec2S &thickness = m_impl->thickness;
+
+  const int
+    xs = m_grid->xs(),
+    xm = m_grid->xm(),
+    ys = m_grid->ys(),
+    ym = m_grid->ym();
+
+  struct Point {
+    int i, j;
+  };
 
-  m_impl->gc.compute_mask(sea_level, bed_topography, ice_thickness, cell_type);
+  auto owned = [&](int i, int j) {
+    return i >= xs and i < xs + xm and j >= ys and j < ys + ym;
+  };
 
-  const Direction directions[4] = {North, East, South, West};
+  // Ghost points. Only star stencils are used here, so one layer of ghosts is enough.
+  std::vector<Point> ghosts;
+  for (int j = ys - 1; j <= ys + ym; ++j) {
+    if (j < ys or j == ys + ym) {
+      for (int i = xs - 1; i <= xs + xm; ++i) {
+        ghosts.push_back({i, j});
+      }
+    } else {
+      ghosts.push_back({xs - 1, j});
+      ghosts.push_back({xs + xm, j});
+    }
+  }
 
-  // First step: distribute residual mass
-  {
-    // will be destroyed at the end of the block
-    IceModelVec::AccessList list{&cell_type, &ice_thickness, &area_specific_volume, &residual};
+  IceModelVec::AccessList list{&bed_topography, &sea_level, &ice_surface_elevation,
+      &ice_thickness, &cell_type, &area_specific_volume, &residual, &thickness};
 
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+  // Re-compute the cell type, the surface elevation and the copy of the ice thickness at
+  // a point where the ice thickness changed.
+  auto update_geometry = [&](const Point &p) {
+    const double
+      H  = ice_thickness(p.i, p.j),
+      b  = bed_topography(p.i, p.j),
+      sl = sea_level(p.i, p.j);
 
-      if (residual(i, j) <= 0.0) {
-        continue;
+    cell_type(p.i, p.j)             = gc.mask(sl, b, H);
+    ice_surface_elevation(p.i, p.j) = gc.surface(sl, b, H);
+    thickness(p.i, p.j)             = H;
+  };
+
+  // Flags of points in the sub-domain owned by this process:
+  enum {PARTIAL = 1, RECEIVER = 2};
+  std::vector<char> flags(xm * ym, 0);
+  auto flag = [&](const Point &p) -> char& {
+    return flags[(p.j - ys) * xm + (p.i - xs)];
+  };
+
+  std::vector<Point>
+    sources,   // owned points with positive residual
+    partial,   // owned points with positive area specific volume (flagged PARTIAL)
+    receivers, // points receiving the residual of their neighbors (flagged RECEIVER)
+    changed;   // owned points where ice thickness changed
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (residual(i, j) > 0.0) {
+      sources.push_back({i, j});
+    }
+
+    if (area_specific_volume(i, j) > 0.0) {
+      partial.push_back({i, j});
+      flag(partial.back()) |= PARTIAL;
+    }
+  }
+
+  const Direction directions[4] = {North, East, South, West};
+
+  bool done = false;
+  for (int n = 0; n < max_n_iterations and not done; ++n) {
+    m_log->message(4, "redistribution iteration %d\n", n);
+
+    // cell_type corresponds to ice_thickness at the beginning of the first iteration;
+    // later it has to be updated where ice thickness changed during the last iteration
+    if (n > 0) {
+      for (const auto &p : changed) {
+        update_geometry(p);
+      }
+      for (const auto &p : ghosts) {
+        update_geometry(p);
       }
+    }
+    changed.clear();
+
+    // First step: distribute residual mass
+    {
+      for (const auto &p : sources) {
+        const int i = p.i, j = p.j;
 
-      StarStencil<int> m = cell_type.int_star(i, j);
+        StarStencil<int> m = cell_type.int_star(i, j);
 
-      int N = 0; // number of empty or partially filled neighbors
-      for (unsigned int n = 0; n < 4; ++n) {
-        const Direction direction = directions[n];
-        if (ice_free_ocean(m[direction])) {
-          N++;
+        int N = 0; // number of empty or partially filled neighbors
+        for (unsigned int d = 0; d < 4; ++d) {
+          const Direction direction = directions[d];
+          if (ice_free_ocean(m[direction])) {
+            N++;
+          }
         }
-      }
 
-      if (N > 0)  {
-        // Remaining ice mass will be redistributed equally among all adjacent
-        // ice-free-ocean cells (is there a more physical way?)
-        residual(i, j) /= N;
-      } else {
-        // Conserve mass, but (possibly) create a "ridge" at the shelf
-        // front
-        ice_thickness(i, j) += residual(i, j);
-        residual(i, j) = 0.0;
+        if (N > 0)  {
+          // Remaining ice mass will be redistributed equally among all adjacent
+          // ice-free-ocean cells (is there a more physical way?)
+          residual(i, j) /= N;
+        } else {
+          // Conserve mass, but (possibly) create a "ridge" at the shelf
+          // front
+          ice_thickness(i, j) += residual(i, j);
+          residual(i, j) = 0.0;
+
+          changed.push_back(p);
+        }
       }
-    }
 
-    residual.update_ghosts();
+      residual.update_ghosts();
 
-    // update area_specific_volume using adjusted residuals
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+      // find ice-free ocean cells next to cells (owned or not) with positive residual
+      auto add_receivers = [&](const Point &p) {
+        if (residual(p.i, p.j) <= 0.0) {
+          return;
+        }
+
+        const Point neighbors[4] = {{p.i + 1, p.j}, {p.i - 1, p.j},
+                                    {p.i, p.j + 1}, {p.i, p.j - 1}};
+        for (const auto &q : neighbors) {
+          if (owned(q.i, q.j) and not (flag(q) & RECEIVER) and
+              cell_type.ice_free_ocean(q.i, q.j)) {
+            flag(q) |= RECEIVER;
+            receivers.push_back(q);
+          }
+        }
+      };
+      for (const auto &p : sources) {
+        add_receivers(p);
+      }
+      for (const auto &p : ghosts) {
+        add_receivers(p);
+      }
+
+      // update area_specific_volume using adjusted residuals
+      for (const auto &p : receivers) {
+        const int i = p.i, j = p.j;
 
-      if (cell_type.ice_free_ocean(i, j)) {
         area_specific_volume(i, j) += (residual(i + 1, j) +
                                        residual(i - 1, j) +
                                        residual(i, j + 1) +
                                        residual(i, j - 1));
+
+        flag(p) &= ~RECEIVER;
+
+        if (area_specific_volume(i, j) > 0.0 and not (flag(p) & PARTIAL)) {
+          partial.push_back(p);
+          flag(p) |= PARTIAL;
+        }
       }
+      receivers.clear();
 
+      // residual is zero everywhere except at sources
+      for (const auto &p : sources) {
+        residual(p.i, p.j) = 0.0;
+      }
+      for (const auto &p : ghosts) {
+        residual(p.i, p.j) = 0.0;
+      }
+      sources.clear();
     }
 
-    residual.set(0.0);
-  }
+    ice_thickness.update_ghosts();
+
+    // The loop above updated ice_thickness, so we need to re-calculate the mask, the
+    // surface elevation, and the copy of the ice thickness:
+    if (n == 0) {
+      // the surface elevation and the copy of the ice thickness correspond to the ice
+      // thickness at the beginning of the time step
+      thickness.copy_from(ice_thickness);
+      gc.compute(sea_level, bed_topography, ice_thickness, cell_type, ice_surface_elevation);
+    } else {
+      for (const auto &p : changed) {
+        update_geometry(p);
+      }
+      for (const auto &p : ghosts) {
+        update_geometry(p);
+      }
+    }
+    changed.clear();
 
-  ice_thickness.update_ghosts();
+    double remaining_residual = 0.0;
 
-  // Store ice thickness. We need this copy to make sure that modifying ice_thickness in the loop
-  // below does not affect the computation of the threshold thickness. (Note that
-  // part_grid_threshold_thickness uses neighboring values of the mask, ice thickness, and surface
-  // elevation.)
-  m_impl->thickness.copy_from(ice_thickness);
+    // Second step: we need to redistribute residual ice volume if
+    // neighbors which gained redistributed ice also become full.
+    {
+      std::vector<Point> still_partial;
+      for (const auto &p : partial) {
+        const int i = p.i, j = p.j;
 
-  // The loop above updated ice_thickness, so we need to re-calculate the mask and the
-  // surface elevation:
-  m_impl->gc.compute(sea_level, bed_topography, ice_thickness, cell_type, ice_surface_elevation);
+        if (area_specific_volume(i, j) <= 0.0) {
+          flag(p) &= ~PARTIAL;
+          continue;
+        }
 
-  double remaining_residual = 0.0;
+        double threshold = part_grid_threshold_thickness(cell_type.int_star(i, j),
+                                                         thickness.star(i, j),
+                                                         ice_surface_elevation.star(i, j),
+                                                         bed_topography(i, j));
 
-  // Second step: we need to redistribute residual ice volume if
-  // neighbors which gained redistributed ice also become full.
-  {
-    // will be destroyed at the end of the block
-    IceModelVec::AccessList list{&m_impl->thickness, &ice_thickness,
-        &ice_surface_elevation, &bed_topography, &cell_type};
+        // if threshold is zero, turn all the area specific volume into ice thickness, with zero
+        // residual
+        if (threshold == 0.0) {
+          threshold = area_specific_volume(i, j);
+        }
 
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+        if (area_specific_volume(i, j) >= threshold) {
+          ice_thickness(i, j)        += threshold;
+          residual(i, j)              = area_specific_volume(i, j) - threshold;
+          area_specific_volume(i, j)  = 0.0;
 
-      if (area_specific_volume(i, j) <= 0.0) {
-        continue;
-      }
-
-      double threshold = part_grid_threshold_thickness(cell_type.int_star(i, j),
-                                                       m_impl->thickness.star(i, j),
-                                                       ice_surface_elevation.star(i, j),
-                                                       bed_topography(i, j));
+          remaining_residual += residual(i, j);
 
-      // if threshold is zero, turn all the area specific volume into ice thickness, with zero
-      // residual
-      if (threshold == 0.0) {
-        threshold = area_specific_volume(i, j);
+          flag(p) &= ~PARTIAL;
+          changed.push_back(p);
+          if (residual(i, j) > 0.0) {
+            sources.push_back(p);
+          }
+        } else {
+          still_partial.push_back(p);
+        }
       }
+      partial.swap(still_partial);
+    }
 
-      if (area_specific_volume(i, j) >= threshold) {
-        ice_thickness(i, j)        += threshold;
-        residual(i, j)              = area_specific_volume(i, j) - threshold;
-        area_specific_volume(i, j)  = 0.0;
+    // check if redistribution should be run once more
+    remaining_residual = GlobalSum(m_grid->com, remaining_residual);
 
-        remaining_residual += residual(i, j);
-      }
+    if (remaining_residual > 0.0) {
+      done = false;
+    } else {
+      done = true;
     }
+
+    ice_thickness.update_ghosts();
   }
 
-  // check if redistribution should be run once more
-  remaining_residual = GlobalSum(m_grid->com, remaining_residual);
+  if (not done) {
+    m_log->message(2,
+                   "WARNING: not done redistributing mass after %d iterations, remaining residual: %f m^3.\n",
+                   max_n_iterations, residual.sum() * m_grid->cell_area());
 
-  if (remaining_residual > 0.0) {
-    done = false;
-  } else {
-    done = true;
+    // Add residual to ice thickness, preserving total ice mass. (This is not great, but
+    // better than losing mass.)
+    ice_thickness.add(1.0, residual);
+    residual.set(0.0);
   }
-
-  ice_thickness.update_ghosts();
 }
 
 /*!
@@ -1172,27 +1648,32 @@ void RegionalGeometryEvolution::compute_interface_fluxes(const IceModelVec2CellT
 
   IceModelVec::AccessList list{&m_no_model_mask, &output};
 
+  // modify fluxes at the same interfaces
+  const Tiles tiles = interface_tiles(*m_grid, diffusive_flux);
+
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
+    for_each_tile(tiles, [&](const Tile &tile) {
+      for (PointsInTile p(tile); p; p.next()) {
+        const int i = p.i(), j = p.j();
 
-      const int M = m_no_model_mask.as_int(i, j);
+        const int M = m_no_model_mask.as_int(i, j);
 
-      for (unsigned int n = 0; n < 2; ++n) {
-        const int
-          oi  = 1 - n,               // offset in the i direction
-          oj  = n,                   // offset in the j direction
-          i_n = i + oi,              // i index of a neighbor
-          j_n = j + oj;              // j index of a neighbor
+        for (unsigned int n = 0; n < 2; ++n) {
+          const int
+            oi  = 1 - n,               // offset in the i direction
+            oj  = n,                   // offset in the j direction
+            i_n = i + oi,              // i index of a neighbor
+            j_n = j + oj;              // j index of a neighbor
 
-        const int M_n = m_no_model_mask.as_int(i_n, j_n);
+          const int M_n = m_no_model_mask.as_int(i_n, j_n);
 
-        if (not (M == 0 and M_n == 0)) {
-          output(i, j, n) = 0.0;
+          if (not (M == 0 and M_n == 0)) {
+            output(i, j, n) = 0.0;
+          }
         }
       }
-    }
+    });
   } catch (...) {
     loop.failed();
   }
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -78,18 +78,19 @@ protected:
   void update_in_place(double dt,
                        const IceModelVec2S& bed_elevation,
                        const IceModelVec2S& sea_level,
-                       const IceModelVec2S& flux_divergence,
+                       const IceModelVec2Stag& flux,
+                       const IceModelVec2Int& thickness_bc_mask,
+                       IceModelVec2S& flux_divergence,
                        IceModelVec2S& ice_thickness,
                        IceModelVec2S& area_specific_volume);
 
-  void residual_redistribution_iteration(const IceModelVec2S& bed_topography,
-                                         const IceModelVec2S& sea_level,
-                                         IceModelVec2S& ice_surface_elevation,
-                                         IceModelVec2S& ice_thickness,
-                                         IceModelVec2CellType& cell_type,
-                                         IceModelVec2S& Href,
-                                         IceModelVec2S& H_residual,
-                                         bool &done);
+  void redistribute_residual(const IceModelVec2S& bed_topography,
+                             const IceModelVec2S& sea_level,
+                             IceModelVec2S& ice_surface_elevation,
+                             IceModelVec2S& ice_thickness,
+                             IceModelVec2CellType& cell_type,
+                             IceModelVec2S& Href,
+                             IceModelVec2S& H_residual);
 
   virtual void compute_interface_fluxes(const IceModelVec2CellType &cell_type,
                                         const IceModelVec2S        &ice_thickness,
@@ -98,9 +99,13 @@ protected:
                                         const IceModelVec2Stag     &diffusive_flux,
                                         IceModelVec2Stag           &output);
 
-  virtual void compute_flux_divergence(const IceModelVec2Stag &flux_staggered,
-                                       const IceModelVec2Int &thickness_bc_mask,
-                                       IceModelVec2S &flux_fivergence);
+  void implicit_diffusive_flux(double dt,
+                               const IceModelVec2CellType &cell_type,
+                               const IceModelVec2S        &ice_thickness,
+                               const IceModelVec2S        &surface_elevation,
+                               const IceModelVec2Stag     &diffusive_flux,
+                               const IceModelVec2Int      &thickness_bc_mask,
+                               IceModelVec2Stag           &output);
 
   virtual void ensure_nonnegativity(const IceModelVec2S &ice_thickness,
                                     const IceModelVec2S &area_specific_volume,
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,9 +17,6 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <cassert>
-#include <cmath>                // fabs
-
 #include "grounded_cell_fraction.hh"
 
 #include "pism/util/error_handling.hh"
@@ -28,203 +25,58 @@
 
 namespace pism {
 
-struct Point {
-  double x;
-  double y;
-};
-
 /*!
  * Consider the right triangle A(0,0) - B(1,0) - C(0,1).
  *
  * Define a linear function z = a + (b - a) * x + (c - a) * y, where a, b, and c are its
  * values at points A, B, and C, respectively.
  *
- * Our goal is to find the fraction of the area of ABC in where z > 0.
+ * Our goal is to find the fraction of the triangle ABC in where z > 0.
  *
- * We note that z(x,y) is continuous, so unless a, b, and c have the same sign the line
+ * This corresponds to the grounded area fraction if z is the flotation criterion
+ * function.
  *
- * z = 0
+ * Unless a, b, and c have the same sign, one of the nodes (call it P, with the value p)
+ * has the sign different from the other two (Q and R, with values q and r). The line z =
+ * 0 intersects PQ and PR at the fractions p / (p - q) and p / (p - r) of their lengths, so
+ * the sub-triangle on P's side of this line covers the fraction
  *
- * will intersect exactly two of the sides (possibly at a node of ABC).
+ * p^2 / ((p - q) * (p - r))
  *
- * So, if the line (z = 0) does not intersect BC, for example, then it has to intersect AB
- * and AC.
+ * of the area of PQR. (This fraction does not depend on the shape of the triangle: for
+ * any two triangles on a plane there exists an affine map that takes one to the other and
+ * affine maps preserve ratios of areas of figures.)
  *
- * This method can be applied to arbitrary triangles. It does not even matter if values at
- * triangle nodes (a, b, c) are listed in the same order. (For any two triangles on a
- * plane there exists an affine map that takes one to the other. Also, affine maps
- * preserve ratios of areas of figures.)
- */
-
-/*!
- * Compute the area of a triangle on a plane using the "shoelace formula."
- */
-static inline double triangle_area(const Point &a, const Point &b, const Point &c) {
-  // note: fabs should not be needed since we traverse all triangle nodes
-  // counter-clockwise, but it is good to be safe
-  return 0.5 * fabs((a.x - c.x) * (b.y - a.y) - (a.x - b.x) * (c.y - a.y));
-}
-
-/*!
- * Compute the coordinates of the intersection of (z = 0) with the side AB.
- */
-Point intersect_ab(double a, double b) {
-  if (a != b) {
-    return {a / (a - b), 0.0};
-  } else {
-    return {-1.0, -1.0};        // no intersection
-  }
-}
-
-/*!
- * Compute the coordinates of the intersection of (z = 0) with the side BC.
- */
-Point intersect_bc(double b, double c) {
-  if (b != c) {
-    return {c / (c - b), b / (b - c)};
-  } else {
-    return {-1.0, -1.0};        // no intersection
-  }
-}
-
-/*!
- * Compute the coordinates of the intersection of (z = 0) with the side AC.
- */
-Point intersect_ac(double a, double c) {
-  if (a != c) {
-    return {0.0, a / (a - c)};
-  } else {
-    return {-1.0, -1.0};        // no intersection
-  }
-}
-
-/*!
- * Return true if a point p is not a valid point on a side of the triangle
- * (0,0)-(1,0)-(0,1).
- *
- * This is not a complete test (for example, it does not check if y = 1 - x for points on
- * the hypotenuse). The point of this is to exclude the kinds of invalid points we are
- * likely to see, not all of them.
+ * The denominator is positive because p - q and p - r have the sign of p (a node where z
+ * = 0 counts as "floating," i.e. has the sign of the negative values).
  *
- * Note that we use (-1, -1) to indicate "invalid" points in the rest of the code and
- * these are easy to detect: they require only one comparison.
- */
-bool invalid(const Point &p) {
-  if (p.x < 0.0 or p.x > 1.0 or p.y < 0.0 or p.y > 1.0) {
-    return true;
-  } else {
-    return false;
-  }
-}
-
-/*!
- * Return true if two points are the same.
- */
-static bool same(const Point &a, const Point &b) {
-  double threshold = 1e-12;
-  return fabs(a.x - b.x) < threshold and fabs(a.y - b.y) < threshold;
-}
-
-/*!
- * Consider the right triangle A(0,0) - B(1,0) - C(0,1).
- *
- * Define a linear function z = a + (b - a) * x + (c - a) * y, where a, b, and c are its
- * values at points A, B, and C, respectively.
- *
- * Our goal is to find the fraction of the triangle ABC in where z > 0.
- *
- * This corresponds to the grounded area fraction if z is the flotation criterion
- * function.
+ * This computation uses selections instead of branches so that loops calling this function
+ * can be vectorized.
  */
 double grounded_area_fraction(double a, double b, double c) {
+  const bool
+    A = a > 0.0,
+    B = b > 0.0,
+    C = c > 0.0;
 
-  if (a > 0.0 and b > 0.0 and c > 0.0) {
-    return 1.0;
-  }
-
-  if (a <= 0.0 and b <= 0.0 and c <= 0.0) {
-    return 0.0;
-  }
-
-  // the area of the triangle (0,0)-(1,0)-(0,1)
-  const double total_area = 0.5;
-
-  const Point
-    ab = intersect_ab(a, b),
-    bc = intersect_bc(b, c),
-    ac = intersect_ac(a, c);
-
-  if (invalid(bc)) {
-    assert(not (invalid(ab) or invalid(ac)));
-
-    double ratio = triangle_area({0.0, 0.0}, ab, ac) / total_area;
-    assert((ratio >= 0.0) and (ratio <= 1.0));
-
-    if (a > 0.0) {
-      return ratio;
-    } else {
-      return 1.0 - ratio;
-    }
-  }
-
-  if (invalid(ac)) {
-    assert(not (invalid(ab) or invalid(bc)));
-
-    double ratio = triangle_area({1.0, 0.0}, bc, ab) / total_area;
-    assert((ratio >= 0.0) and (ratio <= 1.0));
-
-    if (b > 0.0) {
-      return ratio;
-    } else {
-      return 1.0 - ratio;
-    }
-  }
-
-  if (invalid(ab)) {
-    assert(not (invalid(bc) or invalid(ac)));
-
-    double ratio = triangle_area({0.0, 1.0}, ac, bc) / total_area;
-    assert((ratio >= 0.0) and (ratio <= 1.0));
-
-    if (c > 0.0) {
-      return ratio;
-    } else {
-      return 1.0 - ratio;
-    }
-  }
+  const bool same_sign = (A == B) and (B == C);
 
-  // Note that we know that ab, bc, and ac are all valid.
+  // find the node P that has the sign different from the other two
+  const bool
+    P_is_C = (A == B),
+    P_is_B = (A == C);
 
-  // the a == 0 case, the line F = 0 goes through A
-  if (same(ab, ac)) {
-    double ratio = triangle_area({1.0, 0.0}, bc, ab) / total_area;
-    assert((ratio >= 0.0) and (ratio <= 1.0));
+  const double
+    p = P_is_C ? c : (P_is_B ? b : a),
+    q = P_is_C ? a : (P_is_B ? a : b),
+    r = P_is_C ? b : c;
 
-    if (b > 0.0) {
-      return ratio;
-    } else {
-      return 1.0 - ratio;
-    }
-  }
+  // the denominator is not used if all values have the same sign (and may be zero)
+  const double ratio = (p * p) / (same_sign ? 1.0 : (p - q) * (p - r));
 
-  // the b == 0 case and the c == 0 case
-  if (same(ab, bc) or same(ac, bc)) {
-    double ratio = triangle_area({0.0, 0.0}, ab, ac) / total_area;
-    assert((ratio >= 0.0) and (ratio <= 1.0));
+  const double fraction = p > 0.0 ? ratio : 1.0 - ratio;
 
-    if (a > 0.0) {
-      return ratio;
-    } else {
-      return 1.0 - ratio;
-    }
-  }
-
-  // Note: the case of F=0 coinciding with a side of the triangle is covered by if clauses
-  // above. For example, when F=0 coincides with AC, we have a = c = 0 and intersect_ac(a, c)
-  // returns an invalid intersection point.
-
-  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
-                                "the logic in grounded_area_fraction failed! Please submit a bug report.");
+  return same_sign ? (A ? 1.0 : 0.0) : fraction;
 }
 
 /*!
@@ -313,14 +165,14 @@ void compute_grounded_cell_fraction(double ice_density,
         f_n = 0.5 * (f.ij + f.n),
         f_w = 0.5 * (f.ij + f.w);
 
-      double fraction = 0.125 * (grounded_area_fraction(f_o, f_ne, f_n) +
-                                 grounded_area_fraction(f_o, f_n,  f_nw) +
-                                 grounded_area_fraction(f_o, f_nw, f_w) +
-                                 grounded_area_fraction(f_o, f_w,  f_sw) +
-                                 grounded_area_fraction(f_o, f_sw, f_s) +
-                                 grounded_area_fraction(f_o, f_s,  f_se) +
-                                 grounded_area_fraction(f_o, f_se, f_e) +
-                                 grounded_area_fraction(f_o, f_e,  f_ne));
+      // nodes of the eight triangles sharing the node "o", counter-clockwise
+      const double nodes[9] = {f_ne, f_n, f_nw, f_w, f_sw, f_s, f_se, f_e, f_ne};
+
+      double fraction = 0.0;
+      for (int k = 0; k < 8; ++k) {
+        fraction += grounded_area_fraction(f_o, nodes[k], nodes[k + 1]);
+      }
+      fraction *= 0.125;
 
       result(i, j) = clip(fraction, 0.0, 1.0);
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2019 PISM Authors
+// Copyright (C) 2012-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -26,6 +26,8 @@
 #include "pism/util/pism_options.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/GhostUpdateBatch.hh"
+#include "pism/util/Profiling.hh"
 #include "pism/geometry/Geometry.hh"
 
 namespace pism {
@@ -34,7 +36,13 @@ namespace hydrology {
 Distributed::Distributed(IceGrid::ConstPtr g)
   : Routing(g),
     m_P(m_grid, "bwp", WITH_GHOSTS, 1),
-    m_Pnew(m_grid, "Pnew_internal", WITHOUT_GHOSTS) {
+    m_Pnew(m_grid, "Pnew_internal", WITHOUT_GHOSTS),
+    m_Glen_exponent(m_config, "stress_balance.sia.Glen_exponent"),
+    m_ice_softness(m_config, "flow_law.isothermal_Glen.ice_softness"),
+    m_cavitation_opening_coefficient(m_config, "hydrology.cavitation_opening_coefficient"),
+    m_creep_closure_coefficient(m_config, "hydrology.creep_closure_coefficient"),
+    m_roughness_scale(m_config, "hydrology.roughness_scale"),
+    m_regularizing_porosity(m_config, "hydrology.regularizing_porosity") {
 
   // additional variables beyond hydrology::Routing
   m_P.set_attrs("model_state",
@@ -46,6 +54,21 @@ Distributed::Distributed(IceGrid::ConstPtr g)
                    "new transportable subglacial water pressure during update",
                    "Pa", "Pa", "", 0);
   m_Pnew.metadata().set_number("valid_min", 0.0);
+
+  if (m_implicit) {
+    m_P_implicit.create(m_grid, "P_implicit", WITH_GHOSTS);
+    m_P_implicit.set_attrs("internal",
+                           "current iterate of the implicit water pressure solver",
+                           "Pa", "Pa", "", 0);
+
+    m_P_callback_data.model = this;
+
+    create_implicit_solver(m_P_implicit, "hydrology_P_",
+                           (DMDASNESFunction)P_residual_callback, &m_P_callback_data,
+                           m_P_da, m_P_snes, m_P_solution);
+
+    m_P_callback_data.da = m_P_da;
+  }
 }
 
 Distributed::~Distributed() {
@@ -238,12 +261,12 @@ void Distributed::update_P(double dt,
                            IceModelVec2S &P_new) const {
 
   const double
-    n    = m_config->get_number("stress_balance.sia.Glen_exponent"),
-    A    = m_config->get_number("flow_law.isothermal_Glen.ice_softness"),
-    c1   = m_config->get_number("hydrology.cavitation_opening_coefficient"),
-    c2   = m_config->get_number("hydrology.creep_closure_coefficient"),
-    Wr   = m_config->get_number("hydrology.roughness_scale"),
-    phi0 = m_config->get_number("hydrology.regularizing_porosity");
+    n    = m_Glen_exponent.value(),
+    A    = m_ice_softness.value(),
+    c1   = m_cavitation_opening_coefficient.value(),
+    c2   = m_creep_closure_coefficient.value(),
+    Wr   = m_roughness_scale.value(),
+    phi0 = m_regularizing_porosity.value();
 
   // update Pnew from time step
   const double
@@ -303,6 +326,197 @@ void Distributed::update_P(double dt,
 }
 
 
+/*!
+ * Residual of the backward Euler discretization of the pressure equation (compare
+ * update_P()), using the water thickness at the end of the step (m_W).
+ *
+ * The closure term uses \f$\max(P_o - P, 0)\f$ so that the residual is defined for all
+ * iterates; the result is projected onto \f$0 \le P \le P_o\f$ by implicit_P_step().
+ */
+void Distributed::implicit_P_residual(const double *const *x, double **F) {
+  const Inputs &inputs = *m_implicit_inputs;
+  const double dt = m_implicit_dt;
+
+  const IceModelVec2CellType &cell_type = inputs.geometry->cell_type;
+  const IceModelVec2S &sliding_speed = *inputs.ice_sliding_speed;
+
+  const double
+    n    = m_Glen_exponent.value(),
+    A    = m_ice_softness.value(),
+    c1   = m_cavitation_opening_coefficient.value(),
+    c2   = m_creep_closure_coefficient.value(),
+    Wr   = m_roughness_scale.value(),
+    phi0 = m_regularizing_porosity.value(),
+    CC   = (m_rg * dt) / phi0;
+
+  {
+    IceModelVec::AccessList list{&m_P_implicit};
+
+    for (PointsWithGhosts p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_P_implicit(i, j) = x[j][i];
+    }
+  }
+
+  // the velocity depends on the gradient of P (and so does the conductivity, unless it
+  // is lagged)
+  potential_terms(m_P_implicit, inputs.no_model_mask);
+
+  IceModelVec::AccessList list{&m_P, &m_W, &m_Wtill, &m_Wtillnew, &sliding_speed,
+                               &m_surface_input_rate, &m_basal_melt_rate, &cell_type,
+                               &m_Pover, &m_conductivity_factor, &m_potential_gradient};
+  if (m_implicit_lagged) {
+    list.add({&m_Wstag, &m_Kstag});
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const double
+      P   = x[j][i],
+      P_o = m_Pover(i, j),
+      w   = m_W(i, j);
+
+    if (cell_type.ice_free_land(i, j)) {
+      F[j][i] = P;
+    } else if (cell_type.ocean(i, j) or w <= 0.0) {
+      F[j][i] = P - P_o;
+    } else {
+      double
+        Open  = c1 * sliding_speed(i, j) * std::max(0.0, Wr - w),
+        Close = c2 * A * pow(std::max(P_o - P, 0.0), n) * w;
+
+      double divflux = implicit_flow_rate(m_W, cell_type, i, j);
+
+      double Wtill_change = m_Wtillnew(i, j) - m_Wtill(i, j);
+      double total_input = m_surface_input_rate(i, j) + m_basal_melt_rate(i, j);
+      double ZZ = Close - Open + total_input - Wtill_change / dt;
+
+      F[j][i] = P - (m_P(i, j) + CC * (divflux + ZZ));
+    }
+  }
+}
+
+PetscErrorCode Distributed::P_residual_callback(DMDALocalInfo *info,
+                                                const double *const *x, double **F,
+                                                PCallbackData *data) {
+  try {
+    (void) info;
+    data->model->implicit_P_residual(x, F);
+  } catch (...) {
+    MPI_Comm com = MPI_COMM_SELF;
+    PetscErrorCode ierr = PetscObjectGetComm((PetscObject)data->da, &com); CHKERRQ(ierr);
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
+/*!
+ * Compute m_Pnew by taking a backward Euler step of length `dt`. Uses the water
+ * thickness at the end of the step (m_W, with ghosts).
+ */
+void Distributed::implicit_P_step(double dt, const Inputs &inputs) {
+  m_implicit_dt     = dt;
+  m_implicit_inputs = &inputs;
+
+  // use the current pressure as the initial guess
+  m_Pnew.copy_from(m_P);
+  PetscErrorCode ierr = VecCopy(m_Pnew.vec(), m_P_solution);
+  PISM_CHK(ierr, "VecCopy");
+
+  implicit_solve(m_P_snes, m_P_solution, "water pressure");
+
+  ierr = VecCopy(m_P_solution, m_Pnew.vec());
+  PISM_CHK(ierr, "VecCopy");
+
+  // projection to enforce  0 <= P <= P_o
+  IceModelVec::AccessList list{&m_Pnew, &m_Pover};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    m_Pnew(i, j) = clip(m_Pnew(i, j), 0.0, m_Pover(i, j));
+  }
+}
+
+/*!
+ * Take implicit time steps limited by hydrology.maximum_time_step only, solving for W
+ * (using P at the beginning of a step) and then for P (using the new W).
+ */
+void Distributed::implicit_update(double t, double dt, const Inputs &inputs) {
+  const double
+    t_final = t + dt,
+    dt_max  = m_max_time_step.value();
+
+  const IceModelVec2CellType &cell_type = inputs.geometry->cell_type;
+
+  double hdt = 0.0;
+  unsigned int step_counter = 0;
+  for (double ht = t; ht < t_final; ht += hdt) {
+    step_counter++;
+
+    // see update_impl()
+    bool enforce_upper = (step_counter == 1);
+    check_P_bounds(m_P, m_Pover, enforce_upper);
+
+    implicit_coefficients(inputs);
+    potential_terms(m_P, inputs.no_model_mask);
+
+    hdt = std::min(t_final - ht, dt_max);
+
+    m_Qstag_average.add(hdt, m_Qstag);
+
+    m_log->message(3, "  implicit hydrology step %05d, dt = %f s\n", step_counter, hdt);
+
+    update_Wtill(hdt,
+                 m_Wtill,
+                 m_surface_input_rate,
+                 m_basal_melt_rate,
+                 m_Wtillnew);
+    enforce_bounds(cell_type,
+                   inputs.no_model_mask,
+                   0.0,        // do not limit maximum thickness
+                   m_Wtillnew,
+                   m_grounded_margin_change,
+                   m_grounding_line_change,
+                   m_conservation_error_change,
+                   m_no_model_mask_change);
+
+    implicit_W_step(hdt, inputs);
+    enforce_bounds(cell_type,
+                   inputs.no_model_mask,
+                   0.0, // do  not limit maximum thickness
+                   m_Wnew,
+                   m_grounded_margin_change,
+                   m_grounding_line_change,
+                   m_conservation_error_change,
+                   m_no_model_mask_change);
+
+    // transfer new into old (updates ghosts of m_W, used by implicit_P_step())
+    m_W.copy_from(m_Wnew);
+    m_Wtill.copy_from(m_Wtillnew);
+
+    implicit_P_step(hdt, inputs);
+
+    m_P.copy_from(m_Pnew);
+  }
+
+  staggered_to_regular(cell_type, m_Qstag_average,
+                       m_include_floating_ice.value(),
+                       m_Q);
+  m_Q.scale(1.0 / dt);
+
+  m_solver_stats.steps = step_counter;
+
+  m_log->message(2,
+                 "  took %d implicit hydrology steps (%d nonlinear, %d linear iterations)\n",
+                 step_counter, m_solver_stats.nonlinear_iterations,
+                 m_solver_stats.linear_iterations);
+}
+
+
 //! Update the model state variables W,P by running the subglacial hydrology model.
 /*!
   Runs the hydrology model from time t to time t + dt.  Here [t,dt]
@@ -319,17 +533,25 @@ void Distributed::update_impl(double t, double dt, const Inputs& inputs) {
 
   const double
     t_final = t + dt,
-    dt_max  = m_config->get_number("hydrology.maximum_time_step", "seconds"),
-    phi0    = m_config->get_number("hydrology.regularizing_porosity");
+    dt_max  = m_max_time_step.value(),
+    phi0    = m_regularizing_porosity.value();
 
   m_Qstag_average.set(0.0);
 
+  m_solver_stats.reset();
+  const double start_time = MPI_Wtime();
+
   // make sure W,P have valid ghosts before starting hydrology steps
-  m_W.update_ghosts();
-  m_P.update_ghosts();
+  GhostUpdateBatch{&m_W, &m_P}.update();
+
+  if (m_implicit) {
+    implicit_update(t, dt, inputs);
+    m_solver_stats.wall_time = MPI_Wtime() - start_time;
+    return;
+  }
 
 #if (Pism_DEBUG==1)
-  double tillwat_max = m_config->get_number("hydrology.tillwat_max");
+  double tillwat_max = m_tillwat_max.value();
 #endif
 
   unsigned int step_counter = 0;
@@ -413,6 +635,7 @@ void Distributed::update_impl(double t, double dt, const Inputs& inputs) {
              m_Pnew);
 
     // update Wnew from W, Wtill, Wtillnew, Wstag, Q, input_rate
+    m_grid->ctx()->profiling().begin("routing_W");
     update_W(hdt,
              m_surface_input_rate,
              m_basal_melt_rate,
@@ -429,6 +652,7 @@ void Distributed::update_impl(double t, double dt, const Inputs& inputs) {
                    m_grounding_line_change,
                    m_conservation_error_change,
                    m_no_model_mask_change);
+    m_grid->ctx()->profiling().end("routing_W");
 
     // transfer new into old
     m_W.copy_from(m_Wnew);
@@ -441,6 +665,9 @@ void Distributed::update_impl(double t, double dt, const Inputs& inputs) {
                        m_Q);
   m_Q.scale(1.0 / dt);
 
+  m_solver_stats.steps     = step_counter;
+  m_solver_stats.wall_time = MPI_Wtime() - start_time;
+
   m_log->message(2,
                  "  took %d hydrology sub-steps with average dt = %.6f years (%.6f s)\n",
                  step_counter,
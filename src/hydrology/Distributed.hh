@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2019 PISM Authors
+// Copyright (C) 2012-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -89,9 +89,39 @@ protected:
                 const IceModelVec2Stag &K,
                 const IceModelVec2Stag &Q,
                 IceModelVec2S &P_new) const;
+
+  void implicit_update(double t, double dt, const Inputs &inputs);
+
+  void implicit_P_residual(const double *const *x, double **F);
+
+  void implicit_P_step(double dt, const Inputs &inputs);
 protected:
   IceModelVec2S m_P;
   IceModelVec2S m_Pnew;
+
+  // SNES solving for P (see hydrology.routing.implicit.enabled)
+  struct PCallbackData {
+    DM da;
+    Distributed *model;
+  };
+  PCallbackData m_P_callback_data;
+  petsc::DM m_P_da;
+  petsc::SNES m_P_snes;
+  petsc::Vec m_P_solution;
+  //! ghosted copy of the current iterate
+  IceModelVec2S m_P_implicit;
+
+  static PetscErrorCode P_residual_callback(DMDALocalInfo *info,
+                                            const double *const *x, double **F,
+                                            PCallbackData *data);
+
+  // parameters used by update_P()
+  ConfigParameter<double> m_Glen_exponent;
+  ConfigParameter<double> m_ice_softness;
+  ConfigParameter<double> m_cavitation_opening_coefficient;
+  ConfigParameter<double> m_creep_closure_coefficient;
+  ConfigParameter<double> m_roughness_scale;
+  ConfigParameter<double> m_regularizing_porosity;
 private:
   void initialization_message() const;
 };
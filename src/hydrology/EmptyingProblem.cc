@@ -17,6 +17,10 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::sort, std::max
+#include <cmath>                // std::abs
+#include <limits>               // std::numeric_limits
+
 #include "EmptyingProblem.hh"
 
 #include "pism/geometry/Geometry.hh"
@@ -121,10 +125,12 @@ EmptyingProblem::EmptyingProblem(IceGrid::ConstPtr grid)
     m_Vstag(grid, "V_staggered", WITH_GHOSTS),
     m_Qsum(grid, "flux_total", WITH_GHOSTS, 1),
     m_domain_mask(grid, "domain_mask", WITH_GHOSTS, 1),
+    m_domain_mask_new(grid, "domain_mask_new", WITH_GHOSTS, 1),
     m_Q(grid, "_water_flux", WITHOUT_GHOSTS),
     m_q_sg(grid, "_effective_water_velocity", WITHOUT_GHOSTS),
     m_adjustment(grid, "hydraulic_potential_adjustment", WITHOUT_GHOSTS),
-    m_sinks(grid, "sinks", WITHOUT_GHOSTS) {
+    m_sinks(grid, "sinks", WITHOUT_GHOSTS),
+    m_S(grid, "time_integrated_water_thickness", WITH_GHOSTS, 1) {
 
   m_potential.set_attrs("diagnostic", "estimate of the steady state hydraulic potential in the steady hydrology model",
                         "Pa", "Pa", "", 0);
@@ -156,6 +162,12 @@ EmptyingProblem::EmptyingProblem(IceGrid::ConstPtr grid)
                          " when computing an estimate of the steady-state hydraulic potential",
                          "Pa", "Pa", "", 0);
 
+  m_S.set_attrs("internal",
+                "time integral of the water thickness in the emptying problem",
+                "m s", "m s", "", 0);
+
+  m_flow_accumulation = m_config->get_string("hydrology.steady.method") == "flow_accumulation";
+
   m_eps_gradient = 1e-2;
   m_speed = 1.0;
 
@@ -180,15 +192,14 @@ void EmptyingProblem::update(const Geometry &geometry,
                              const IceModelVec2S &water_input_rate,
                              bool recompute_potential) {
 
+  m_solver_stats.reset();
+  const double start_time = MPI_Wtime();
+
   const double
-    eps = 1e-16,
     cell_area    = m_grid->cell_area(),
     u_max        = m_speed,
     v_max        = m_speed,
-    dt           = 0.5 / (u_max / m_dx + v_max / m_dy), // CFL condition
-    volume_ratio = m_config->get_number("hydrology.steady.volume_ratio");
-
-  const int n_iterations = m_config->get_number("hydrology.steady.n_iterations");
+    dt           = 0.5 / (u_max / m_dx + v_max / m_dy); // CFL condition
 
   if (recompute_potential) {
     ice_bottom_surface(geometry, m_bottom_surface);
@@ -240,9 +251,116 @@ void EmptyingProblem::update(const Geometry &geometry,
   if (volume_0 == 0.0) {
     m_Q.set(0.0);
     m_q_sg.set(0.0);
+    m_solver_stats.wall_time = MPI_Wtime() - start_time;
+    return;
+  }
+
+  if (m_flow_accumulation) {
+    if (recompute_potential or m_order.empty()) {
+      compute_order(m_potential);
+    }
+  }
+
+  double volume = m_flow_accumulation ? accumulate_flow(dt) : relax(dt, volume_0);
+
+  double epsilon = volume / volume_0;
+
+  m_solver_stats.steps = 1;
+
+  if (epsilon >= 1.0) {
+    // all the water ended up in sinks
+    m_Q.set(0.0);
+    m_q_sg.set(0.0);
+    m_solver_stats.wall_time = MPI_Wtime() - start_time;
     return;
   }
 
+  m_Qsum.update_ghosts();
+  staggered_to_regular(geometry.cell_type, m_Qsum,
+                       true,    // include floating ice
+                       m_Q);
+  m_Q.scale(1.0 / (m_tau * (1.0 - epsilon)));
+
+  diagnostics::effective_water_velocity(geometry, m_Q, m_q_sg);
+
+  m_solver_stats.wall_time = MPI_Wtime() - start_time;
+}
+
+/*!
+ * Statistics of the last update(): pseudo-time steps (or flow accumulation sweeps) and
+ * the history of the remaining volume relative to the initial volume (or the number of
+ * cells changed during each sweep), and the wall-clock time.
+ */
+const SolverStats& EmptyingProblem::solver_stats() const {
+  return m_solver_stats;
+}
+
+/*!
+ * Compute the maximum change of the (unmodified) hydraulic potential since the last update
+ * with `recompute_potential == true`.
+ *
+ * Returns infinity if the domain changed. Used to decide if the modified potential (which
+ * is expensive to compute) can be re-used.
+ *
+ * Note: overwrites the ice bottom surface elevation, which is re-computed by update()
+ * anyway.
+ */
+double EmptyingProblem::potential_change(const Geometry &geometry,
+                                         const IceModelVec2Int *no_model_mask) {
+
+  ice_bottom_surface(geometry, m_bottom_surface);
+
+  compute_raw_potential(geometry.ice_thickness, m_bottom_surface, m_tmp);
+
+  compute_mask(geometry.cell_type, no_model_mask, m_domain_mask_new);
+
+  IceModelVec::AccessList list{&m_tmp, &m_potential, &m_adjustment,
+                               &m_domain_mask, &m_domain_mask_new};
+
+  double
+    change       = 0.0,
+    mask_changed = 0.0;
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (m_domain_mask_new.as_int(i, j) != m_domain_mask.as_int(i, j)) {
+      mask_changed = 1.0;
+    }
+
+    if (m_domain_mask_new(i, j) > 0.5) {
+      // m_adjustment is the difference between the modified and the raw potential
+      double psi_old = m_potential(i, j) - m_adjustment(i, j);
+
+      change = std::max(change, std::abs(m_tmp(i, j) - psi_old));
+    }
+  }
+
+  double local[2] = {change, mask_changed}, global[2] = {0.0, 0.0};
+  GlobalMax(m_grid->com, local, global, 2);
+
+  if (global[1] > 0.0) {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  return global[0];
+}
+
+/*!
+ * Advance the emptying problem in (pseudo-) time until the remaining volume drops below
+ * `hydrology.steady.volume_ratio` times the initial volume `volume_0`, accumulating the
+ * water flux in `m_Qsum`.
+ *
+ * Returns the remaining volume.
+ */
+double EmptyingProblem::relax(double dt, double volume_0) {
+
+  const double
+    eps          = 1e-16,
+    cell_area    = m_grid->cell_area(),
+    volume_ratio = m_config->get_number("hydrology.steady.volume_ratio");
+
+  const int n_iterations = m_config->get_number("hydrology.steady.n_iterations");
+
   double volume = 0.0;
   int step_counter = 0;
 
@@ -287,6 +405,9 @@ void EmptyingProblem::update(const Geometry &geometry,
     m_W.copy_from(m_tmp);
     volume = cell_area * GlobalSum(m_grid->com, volume);
 
+    m_solver_stats.nonlinear_iterations += 1;
+    m_solver_stats.residuals.push_back(volume / volume_0);
+
     if (volume / volume_0 <= volume_ratio) {
       break;
     }
@@ -296,15 +417,148 @@ void EmptyingProblem::update(const Geometry &geometry,
   m_log->message(3, "Emptying problem: stopped after %d iterations. V = %f\n",
                  step_counter, volume / volume_0);
 
-  double epsilon = volume / volume_0;
+  return volume;
+}
 
-  m_Qsum.update_ghosts();
-  staggered_to_regular(geometry.cell_type, m_Qsum,
-                       true,    // include floating ice
-                       m_Q);
-  m_Q.scale(1.0 / (m_tau * (1.0 - epsilon)));
+/*!
+ * Sort cells owned by this process so that the hydraulic potential `psi` is decreasing.
+ *
+ * Water flows from cells with higher potential to cells with lower potential, so in this
+ * order all upstream cells (within a sub-domain) precede their downstream neighbors.
+ */
+void EmptyingProblem::compute_order(const IceModelVec2S &psi) {
+  m_order.clear();
+  m_order.reserve(m_grid->xm() * m_grid->ym());
 
-  diagnostics::effective_water_velocity(geometry, m_Q, m_q_sg);
+  for (Points p(*m_grid); p; p.next()) {
+    m_order.push_back({p.i(), p.j()});
+  }
+
+  IceModelVec::AccessList list{&psi};
+
+  std::sort(m_order.begin(), m_order.end(),
+            [&psi](const std::pair<int, int> &a, const std::pair<int, int> &b) {
+              return psi(a.first, a.second) > psi(b.first, b.second);
+            });
+}
+
+/*!
+ * Compute the limit (as the number of iterations goes to infinity) of the flux
+ * accumulated by relax() directly.
+ *
+ * Let `S` be the time integral of the water thickness `W` in relax(). Summing its updates
+ * over all iterations, in each cell with a positive outflow rate `r` (all the water
+ * eventually leaves such cells)
+ *
+ * `r S = W_0 + (inflow from upstream neighbors computed using their values of S)`,
+ *
+ * cells outside the domain contribute `dt W_0` once, and "sinks" (cells without outflow)
+ * keep all the water that reaches them. The flow graph is acyclic, so `S` can be
+ * computed in one sweep in the order of decreasing hydraulic potential (see
+ * compute_order()). Sub-domains are coupled by ghost exchanges; sweeps are repeated until
+ * values in all sub-domains stop changing, which takes (roughly) one sweep per sub-domain
+ * boundary crossed by the longest flow path.
+ *
+ * Expects the initial water thickness in `m_W`; on return `m_W` contains the water left
+ * in sinks and `m_Qsum` the accumulated flux.
+ *
+ * Returns the remaining volume.
+ */
+double EmptyingProblem::accumulate_flow(double dt) {
+  const int n_iterations = m_config->get_number("hydrology.steady.n_iterations");
+
+  IceModelVec::AccessList list{&m_S, &m_W, &m_Vstag, &m_domain_mask};
+
+  m_S.set(0.0);
+
+  int sweep_counter = 0;
+  for (sweep_counter = 0; sweep_counter < n_iterations; ++sweep_counter) {
+    int n_changed = 0;
+
+    for (const auto &c : m_order) {
+      const int i = c.first, j = c.second;
+
+      double S = 0.0;
+      if (m_domain_mask(i, j) > 0.5) {
+        auto v = m_Vstag.star(i, j);
+        auto s = m_S.star(i, j);
+
+        double
+          outflow = ((std::max(v.e, 0.0) + std::max(-v.w, 0.0)) / m_dx +
+                     (std::max(v.n, 0.0) + std::max(-v.s, 0.0)) / m_dy),
+          inflow  = (((v.e < 0.0 ? - v.e * s.e : 0.0) + (v.w > 0.0 ? v.w * s.w : 0.0)) / m_dx +
+                     ((v.n < 0.0 ? - v.n * s.n : 0.0) + (v.s > 0.0 ? v.s * s.s : 0.0)) / m_dy);
+
+        // S is not used in sinks
+        S = outflow > 0.0 ? (m_W(i, j) + inflow) / outflow : 0.0;
+      } else {
+        // water leaving cells outside the domain is removed after one step
+        S = dt * m_W(i, j);
+      }
+
+      if (S != m_S(i, j)) {
+        m_S(i, j) = S;
+        n_changed += 1;
+      }
+    }
+
+    m_S.update_ghosts();
+
+    m_solver_stats.nonlinear_iterations += 1;
+
+    // a single sweep is enough if there is only one sub-domain
+    if (m_grid->size() == 1) {
+      break;
+    }
+
+    n_changed = GlobalSum(m_grid->com, n_changed);
+    m_solver_stats.residuals.push_back(n_changed);
+
+    if (n_changed == 0) {
+      break;
+    }
+  }
+
+  if (sweep_counter == n_iterations) {
+    m_log->message(2, "WARNING: emptying problem: flow accumulation did not converge"
+                   " after %d sweeps.\n", sweep_counter);
+  } else {
+    m_log->message(3, "Emptying problem: flow accumulation took %d sweeps.\n",
+                   sweep_counter + 1);
+  }
+
+  // accumulated flux and water left in sinks
+  double volume = 0.0;
+
+  list.add(m_Qsum);
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    auto v = m_Vstag.star(i, j);
+    auto s = m_S.star(i, j);
+
+    m_Qsum(i, j, 0) = v.e * (v.e >= 0.0 ? s.ij : s.e);
+    m_Qsum(i, j, 1) = v.n * (v.n >= 0.0 ? s.ij : s.n);
+
+    double remaining = 0.0;
+    if (m_domain_mask(i, j) > 0.5) {
+      double
+        outflow = ((std::max(v.e, 0.0) + std::max(-v.w, 0.0)) / m_dx +
+                   (std::max(v.n, 0.0) + std::max(-v.s, 0.0)) / m_dy),
+        inflow  = (((v.e < 0.0 ? - v.e * s.e : 0.0) + (v.w > 0.0 ? v.w * s.w : 0.0)) / m_dx +
+                   ((v.n < 0.0 ? - v.n * s.n : 0.0) + (v.s > 0.0 ? v.s * s.s : 0.0)) / m_dy);
+
+      if (not (outflow > 0.0)) {
+        remaining = m_W(i, j) + inflow;
+      }
+    }
+    m_W(i, j) = remaining;
+
+    volume += remaining;
+  }
+  m_W.update_ghosts();
+
+  return m_grid->cell_area() * GlobalSum(m_grid->com, volume);
 }
 
 /*! Compute the unmodified hydraulic potential (with sinks).
@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,9 +20,13 @@
 #ifndef EMPTYINGPROBLEM_H
 #define EMPTYINGPROBLEM_H
 
+#include <utility>              // std::pair
+#include <vector>
+
 #include "pism/util/Component.hh"
 #include "pism/util/petscwrappers/KSP.hh"
 #include "pism/util/petscwrappers/Mat.hh"
+#include "pism/util/SolverStats.hh"
 
 namespace pism {
 
@@ -40,6 +44,9 @@ public:
               const IceModelVec2S &water_input_rate,
               bool recompute_potential = true);
 
+  double potential_change(const Geometry &geometry,
+                          const IceModelVec2Int *no_model_mask);
+
   // output
   const IceModelVec2V& flux() const;
 
@@ -52,6 +59,7 @@ public:
 
   DiagnosticList diagnostics() const;
 
+  const SolverStats& solver_stats() const;
 protected:
 
   virtual void compute_raw_potential(const IceModelVec2S &ice_thickness,
@@ -71,6 +79,12 @@ protected:
                     const IceModelVec2Int *no_model_mask,
                     IceModelVec2Int &result) const;
 
+  double relax(double dt, double volume_0);
+
+  void compute_order(const IceModelVec2S &psi);
+
+  double accumulate_flow(double dt);
+
   IceModelVec2S m_potential;
   IceModelVec2S m_tmp;
   IceModelVec2S m_bottom_surface;
@@ -78,18 +92,29 @@ protected:
   IceModelVec2Stag m_Vstag;
   IceModelVec2Stag m_Qsum;
   IceModelVec2Int m_domain_mask;
+  IceModelVec2Int m_domain_mask_new;
 
   IceModelVec2V m_Q;
   IceModelVec2V m_q_sg;
   IceModelVec2S m_adjustment;
   IceModelVec2Int m_sinks;
 
+  //! time-integrated water thickness (used by accumulate_flow())
+  IceModelVec2S m_S;
+  //! cells owned by this process, sorted so that the hydraulic potential is decreasing
+  std::vector<std::pair<int, int> > m_order;
+  //! true if the flux is computed using accumulate_flow() instead of relax()
+  bool m_flow_accumulation;
+
   double m_dx;
   double m_dy;
 
   double m_eps_gradient;
   double m_speed;
   double m_tau;
+
+  //! iterations and the wall-clock time of the last update()
+  SolverStats m_solver_stats;
 };
 
 } // end of namespace hydrology
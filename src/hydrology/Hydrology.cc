@@ -677,6 +677,8 @@ void Hydrology::compute_basal_melt_rate(const IceModelVec2CellType &mask,
   @param[in,out] grounding_line_change change in water thickness at the grounding line
   @param[in,out] conservation_error_change change in water thickness due to mass conservation errors
   @param[in,out] no_model_mask_change change in water thickness outside the modeling domain (regional models)
+  @param[in] width width of the strip of ghost points processed in addition to owned
+                   points; changes in ghost points are not added to `*_change` fields
 */
 void Hydrology::enforce_bounds(const IceModelVec2CellType &cell_type,
                                const IceModelVec2Int *no_model_mask,
@@ -685,7 +687,8 @@ void Hydrology::enforce_bounds(const IceModelVec2CellType &cell_type,
                                IceModelVec2S &grounded_margin_change,
                                IceModelVec2S &grounding_line_change,
                                IceModelVec2S &conservation_error_change,
-                               IceModelVec2S &no_model_mask_change) {
+                               IceModelVec2S &no_model_mask_change,
+                               unsigned int width) {
 
   bool include_floating = m_config->get_flag("hydrology.routing.include_floating_ice");
 
@@ -697,29 +700,42 @@ void Hydrology::enforce_bounds(const IceModelVec2CellType &cell_type,
     fresh_water_density = m_config->get_number("constants.fresh_water.density"),
     kg_per_m            = m_grid->cell_area() * fresh_water_density; // kg m-1
 
-  for (Points p(*m_grid); p; p.next()) {
+  const int
+    xs = m_grid->xs(),
+    xe = m_grid->xs() + m_grid->xm(),
+    ys = m_grid->ys(),
+    ye = m_grid->ys() + m_grid->ym();
+
+  // changes are recorded in owned points only (ghosts are processed redundantly)
+  auto record = [&](IceModelVec2S &change, int i, int j, double amount) {
+    if (width == 0 or (i >= xs and i < xe and j >= ys and j < ye)) {
+      change(i, j) += amount;
+    }
+  };
+
+  for (PointsWithGhosts p(*m_grid, width); p; p.next()) {
     const int i = p.i(), j = p.j();
 
     if (water_thickness(i, j) < 0.0) {
-      conservation_error_change(i, j) += -water_thickness(i, j) * kg_per_m;
+      record(conservation_error_change, i, j, -water_thickness(i, j) * kg_per_m);
       water_thickness(i, j) = 0.0;
     }
 
     if (max_thickness > 0.0 and water_thickness(i, j) > max_thickness) {
       double excess = water_thickness(i, j) - max_thickness;
 
-      conservation_error_change(i, j) += -excess * kg_per_m;
+      record(conservation_error_change, i, j, -excess * kg_per_m);
       water_thickness(i, j) = max_thickness;
     }
 
     if (cell_type.ice_free_land(i, j)) {
-      grounded_margin_change(i, j) += -water_thickness(i, j) * kg_per_m;
+      record(grounded_margin_change, i, j, -water_thickness(i, j) * kg_per_m);
       water_thickness(i, j) = 0.0;
     }
 
     if ((include_floating and cell_type.ice_free_ocean(i, j)) or
         (not include_floating and cell_type.ocean(i, j))) {
-      grounding_line_change(i, j) += -water_thickness(i, j) * kg_per_m;
+      record(grounding_line_change, i, j, -water_thickness(i, j) * kg_per_m);
       water_thickness(i, j) = 0.0;
     }
   }
@@ -729,11 +745,11 @@ void Hydrology::enforce_bounds(const IceModelVec2CellType &cell_type,
 
     list.add(M);
 
-    for (Points p(*m_grid); p; p.next()) {
+    for (PointsWithGhosts p(*m_grid, width); p; p.next()) {
       const int i = p.i(), j = p.j();
 
       if (M(i, j)) {
-        no_model_mask_change(i, j) += -water_thickness(i, j) * kg_per_m;
+        record(no_model_mask_change, i, j, -water_thickness(i, j) * kg_per_m);
 
         water_thickness(i, j) = 0.0;
       }
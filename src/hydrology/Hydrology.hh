@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2019 PISM Authors
+// Copyright (C) 2012-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -208,7 +208,8 @@ protected:
                       IceModelVec2S &grounded_margin_change,
                       IceModelVec2S &grounding_line_change,
                       IceModelVec2S &conservation_error_change,
-                      IceModelVec2S &no_model_mask_change);
+                      IceModelVec2S &no_model_mask_change,
+                      unsigned int width = 0);
 private:
   virtual void initialization_message() const = 0;
 };
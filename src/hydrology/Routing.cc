@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2019 PISM Authors
+// Copyright (C) 2012-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -17,6 +17,8 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cassert>
+#include <cmath>                // std::abs
+#include <utility>              // std::swap
 
 #include "Routing.hh"
 #include "pism/util/IceModelVec2CellType.hh"
@@ -30,6 +32,8 @@
 #include "pism/util/Vars.hh"
 #include "pism/geometry/Geometry.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/TerminationReason.hh"
+#include "pism/util/IceModelVecView.hh"
 
 namespace pism {
 namespace hydrology {
@@ -139,7 +143,8 @@ class WallMelt : public Diag<Routing>
 {
 public:
   WallMelt(const Routing *m)
-    : Diag<Routing>(m) {
+    : Diag<Routing>(m),
+      m_bed_elevation(m_grid->variables(), "bedrock_altitude") {
     m_vars = {SpatialVariableMetadata(m_sys, "wallmelt")};
     set_attrs("wall melt into subglacial hydrology layer"
               " from (turbulent) dissipation of energy in transportable water",
@@ -151,11 +156,11 @@ protected:
     IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "wallmelt", WITHOUT_GHOSTS));
     result->metadata() = m_vars[0];
 
-    const IceModelVec2S &bed_elevation = *m_grid->variables().get_2d_scalar("bedrock_altitude");
-
-    wall_melt(*model, bed_elevation, *result);
+    wall_melt(*model, *m_bed_elevation, *result);
     return result;
   }
+private:
+  VarRef<IceModelVec2S> m_bed_elevation;
 };
 
 //! @brief Diagnostically reports the staggered-grid components of the velocity of the
@@ -225,7 +230,10 @@ class HydraulicPotential : public Diag<Routing>
 {
 public:
   HydraulicPotential(const Routing *m)
-    : Diag<Routing>(m) {
+    : Diag<Routing>(m),
+      m_sea_level(m_grid->variables(), "sea_level"),
+      m_bed_elevation(m_grid->variables(), "bedrock_altitude"),
+      m_ice_thickness(m_grid->variables(), "land_ice_thickness") {
 
     m_vars = {SpatialVariableMetadata(m_sys, "hydraulic_potential")};
 
@@ -239,19 +247,17 @@ protected:
     IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "hydraulic_potential", WITHOUT_GHOSTS));
     result->metadata(0) = m_vars[0];
 
-    const IceModelVec2S        &sea_level     = *m_grid->variables().get_2d_scalar("sea_level");
-    const IceModelVec2S        &bed_elevation = *m_grid->variables().get_2d_scalar("bedrock_altitude");
-    const IceModelVec2S        &ice_thickness = *m_grid->variables().get_2d_scalar("land_ice_thickness");
-
     hydraulic_potential(model->subglacial_water_thickness(),
                         model->subglacial_water_pressure(),
-                        sea_level,
-                        bed_elevation,
-                        ice_thickness,
+                        *m_sea_level,
+                        *m_bed_elevation,
+                        *m_ice_thickness,
                         *result);
 
     return result;
   }
+private:
+  VarRef<IceModelVec2S> m_sea_level, m_bed_elevation, m_ice_thickness;
 };
 
 } // end of namespace diagnostics
@@ -268,6 +274,14 @@ Routing::Routing(IceGrid::ConstPtr grid)
     m_R(grid, "potential_workspace", WITH_GHOSTS, 1), /* box stencil used */
     m_dx(grid->dx()),
     m_dy(grid->dy()),
+    m_conductivity(m_config, "hydrology.hydraulic_conductivity"),
+    m_thickness_power(m_config, "hydrology.thickness_power_in_flux"),
+    m_gradient_power(m_config, "hydrology.gradient_power_in_flux"),
+    m_tillwat_max(m_config, "hydrology.tillwat_max"),
+    m_tillwat_decay_rate(m_config, "hydrology.tillwat_decay_rate", "m / second"),
+    m_max_time_step(m_config, "hydrology.maximum_time_step", "seconds"),
+    m_include_floating_ice(m_config, "hydrology.routing.include_floating_ice"),
+    m_add_input_to_till(m_config, "hydrology.add_water_input_to_till_storage"),
     m_bottom_surface(grid, "ice_bottom_surface_elevation", WITH_GHOSTS) {
 
   m_W.metadata().set_string("pism_intent", "model_state");
@@ -315,13 +329,107 @@ Routing::Routing(IceGrid::ConstPtr grid)
   m_Wtillnew.metadata().set_number("valid_min", 0.0);
 
   {
-    double alpha = m_config->get_number("hydrology.thickness_power_in_flux");
+    double ratio = m_config->get_number("hydrology.routing.multirate_ratio");
+    if (ratio < 1.0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "hydrology.routing.multirate_ratio = %f < 1 is not allowed",
+                                    ratio);
+    }
+    m_multirate_ratio = static_cast<unsigned int>(ratio);
+  }
+
+  if (m_multirate_ratio > 1) {
+    m_cell_mode.create(grid, "multirate_cell_mode", WITH_GHOSTS);
+    m_cell_mode.set_attrs("internal", "multirate time stepping: cell mode", "", "", "", 0);
+
+    m_edge_flags.create(grid, "multirate_edge_flags", 1);
+
+    m_flux.create(grid, "total_water_flux", WITH_GHOSTS);
+    m_flux.set_attrs("internal", "total water flux through cell interfaces",
+                     "m2 s-1", "m2 s-1", "", 0);
+
+    m_flux_start.create(grid, "total_water_flux_start", WITHOUT_GHOSTS);
+    m_flux_start.set_attrs("internal",
+                           "total water flux through cell interfaces at the beginning"
+                           " of a multirate step",
+                           "m2 s-1", "m2 s-1", "", 0);
+
+    m_flux_integral.create(grid, "total_water_flux_integral", WITH_GHOSTS);
+    m_flux_integral.set_attrs("internal",
+                              "time integral of the total water flux during a multirate step",
+                              "m2", "m2", "", 0);
+  }
+
+  m_implicit          = m_config->get_flag("hydrology.routing.implicit.enabled");
+  m_implicit_lagged   = m_config->get_string("hydrology.routing.implicit.conductivity") == "lagged";
+  m_implicit_dt       = 0.0;
+  m_implicit_inputs   = nullptr;
+
+  {
+    int steps = m_config->get_number("hydrology.routing.steps_per_exchange");
+    if (steps < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "hydrology.routing.steps_per_exchange = %d < 1 is not allowed",
+                                    steps);
+    }
+
+    if (steps > 1 and (m_multirate_ratio > 1 or m_implicit)) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "hydrology.routing.steps_per_exchange > 1 requires explicit time"
+                         " stepping with hydrology.routing.multirate_ratio = 1");
+    }
+    m_steps_per_exchange = steps;
+  }
+
+  if (m_multirate_ratio == 1 or m_implicit) {
+    // the fused sub-step kernel uses these in m_steps_per_exchange rows of ghosts
+    const unsigned int width = m_steps_per_exchange;
+
+    // cell face-centered (staggered) factor depending on the gradient of the hydraulic
+    // potential in the conductivity
+    m_conductivity_factor.create(grid, "conductivity_factor", 2, width);
+
+    // cell face-centered (staggered) components of minus the gradient of the simplified
+    // hydraulic potential (Pa m-1)
+    m_potential_gradient.create(grid, "potential_gradient", 2, width);
+  }
+
+  if (m_steps_per_exchange > 1) {
+    const unsigned int width = m_steps_per_exchange;
+
+    m_wide.W.create(grid, "W_wide_halo", WITH_GHOSTS, width);
+    m_wide.W_new.create(grid, "W_new_wide_halo", WITH_GHOSTS, width);
+    m_wide.Wtill.create(grid, "Wtill_wide_halo", WITH_GHOSTS, width);
+    m_wide.Wtill_new.create(grid, "Wtill_new_wide_halo", WITH_GHOSTS, width);
+    m_wide.surface_input_rate.create(grid, "surface_input_rate_wide_halo", WITH_GHOSTS, width);
+    m_wide.basal_melt_rate.create(grid, "basal_melt_rate_wide_halo", WITH_GHOSTS, width);
+    m_wide.cell_type.create(grid, "cell_type_wide_halo", WITH_GHOSTS, width);
+    m_wide.no_model_mask.create(grid, "no_model_mask_wide_halo", WITH_GHOSTS, width);
+  }
+
+  if (m_implicit) {
+    m_W_implicit.create(grid, "W_implicit", WITH_GHOSTS);
+    m_W_implicit.set_attrs("internal",
+                           "current iterate of the implicit water thickness solver",
+                           "m", "m", "", 0);
+
+    m_W_callback_data.model = this;
+
+    create_implicit_solver(m_W_implicit, "hydrology_W_",
+                           (DMDASNESFunction)W_residual_callback, &m_W_callback_data,
+                           m_W_da, m_W_snes, m_W_solution);
+
+    m_W_callback_data.da = m_W_da;
+  }
+
+  {
+    double alpha = m_thickness_power.value();
     if (alpha < 1.0) {
       throw RuntimeError::formatted(PISM_ERROR_LOCATION,
                                     "alpha = %f < 1 which is not allowed", alpha);
     }
 
-    if (m_config->get_number("hydrology.tillwat_max") < 0.0) {
+    if (m_tillwat_max.value() < 0.0) {
       throw RuntimeError(PISM_ERROR_LOCATION,
                          "hydrology::Routing: hydrology.tillwat_max is negative.\n"
                          "This is not allowed.");
@@ -386,6 +494,14 @@ const IceModelVec2S& Routing::subglacial_water_pressure() const {
   return m_Pover;
 }
 
+/*!
+ * Statistics of the last update: the number of sub-steps, nonlinear and linear iterations
+ * (implicit time stepping only) and the wall-clock time.
+ */
+const SolverStats& Routing::solver_stats() const {
+  return m_solver_stats;
+}
+
 const IceModelVec2Stag& Routing::velocity_staggered() const {
   return m_Vstag;
 }
@@ -396,15 +512,23 @@ const IceModelVec2Stag& Routing::velocity_staggered() const {
   either ice-free or floating areas. */
 void Routing::water_thickness_staggered(const IceModelVec2S &W,
                                         const IceModelVec2CellType &mask,
-                                        IceModelVec2Stag &result) {
+                                        IceModelVec2Stag &result,
+                                        const IceModelVec2Int *active) {
 
-  bool include_floating = m_config->get_flag("hydrology.routing.include_floating_ice");
+  bool include_floating = m_include_floating_ice.value();
 
   IceModelVec::AccessList list{ &mask, &W, &result };
+  if (active) {
+    list.add(*active);
+  }
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
+    if (active and active->as_int(i, j) == 0) {
+      continue;
+    }
+
     if (include_floating) {
       // east
       if (mask.icy(i, j)) {
@@ -457,14 +581,18 @@ void Routing::compute_conductivity(const IceModelVec2Stag &W,
                                    const IceModelVec2S &P,
                                    const IceModelVec2S &bed_elevation,
                                    IceModelVec2Stag &result,
-                                   double &KW_max) const {
+                                   double &KW_max,
+                                   const IceModelVec2Int *active) const {
   const double
-    k     = m_config->get_number("hydrology.hydraulic_conductivity"),
-    alpha = m_config->get_number("hydrology.thickness_power_in_flux"),
-    beta  = m_config->get_number("hydrology.gradient_power_in_flux"),
+    k     = m_conductivity.value(),
+    alpha = m_thickness_power.value(),
+    beta  = m_gradient_power.value(),
     betapow = (beta - 2.0) / 2.0;
 
   IceModelVec::AccessList list({&result, &W});
+  if (active) {
+    list.add(*active);
+  }
 
   KW_max = 0.0;
 
@@ -483,6 +611,10 @@ void Routing::compute_conductivity(const IceModelVec2Stag &W,
       for (Points p(*m_grid); p; p.next()) {
         const int i = p.i(), j = p.j();
 
+        if (active and active->as_int(i, j) == 0) {
+          continue;
+        }
+
         double dRdx, dRdy;
         dRdx = (m_R(i + 1, j) - m_R(i, j)) / m_dx;
         dRdy = (m_R(i + 1, j + 1) + m_R(i, j + 1) - m_R(i + 1, j - 1) - m_R(i, j - 1)) / (4.0 * m_dy);
@@ -501,6 +633,10 @@ void Routing::compute_conductivity(const IceModelVec2Stag &W,
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
+      if (active and active->as_int(i, j) == 0) {
+        continue;
+      }
+
       for (int o = 0; o < 2; ++o) {
         const double Pi = result(i, j, o);
 
@@ -517,6 +653,10 @@ void Routing::compute_conductivity(const IceModelVec2Stag &W,
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
+      if (active and active->as_int(i, j) == 0) {
+        continue;
+      }
+
       for (int o = 0; o < 2; ++o) {
         result(i, j, o) = k * pow(W(i, j, o), alpha - 1.0);
 
@@ -633,15 +773,23 @@ void Routing::compute_velocity(const IceModelVec2Stag &W,
                                const IceModelVec2S &bed,
                                const IceModelVec2Stag &K,
                                const IceModelVec2Int *no_model_mask,
-                               IceModelVec2Stag &result) const {
+                               IceModelVec2Stag &result,
+                               const IceModelVec2Int *active) const {
   IceModelVec2S &P = m_R;
   P.copy_from(pressure);  // yes, it updates ghosts
 
   IceModelVec::AccessList list{&P, &W, &K, &bed, &result};
+  if (active) {
+    list.add(*active);
+  }
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
+    if (active and active->as_int(i, j) == 0) {
+      continue;
+    }
+
     if (W(i, j, 0) > 0.0) {
       double
         P_x = (P(i + 1, j) - P(i, j)) / m_dx,
@@ -689,16 +837,34 @@ void Routing::compute_velocity(const IceModelVec2Stag &W,
 */
 void Routing::advective_fluxes(const IceModelVec2Stag &V,
                                const IceModelVec2S &W,
-                               IceModelVec2Stag &result) const {
+                               IceModelVec2Stag &result,
+                               const IceModelVec2Int *active) const {
   IceModelVec::AccessList list{&W, &V, &result};
+  if (active) {
+    list.add(*active);
+  }
 
   assert(W.stencil_width() >= 1);
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  View2<const double> w(W);
+  View2<const double, 2> v(V);
+  View2<double, 2> Q(result);
 
-    result(i, j, 0) = V(i, j, 0) * (V(i, j, 0) >= 0.0 ? W(i, j) :  W(i + 1, j));
-    result(i, j, 1) = V(i, j, 1) * (V(i, j, 1) >= 0.0 ? W(i, j) :  W(i, j + 1));
+  const int
+    xs = m_grid->xs(),
+    xe = m_grid->xs() + m_grid->xm(),
+    ys = m_grid->ys(),
+    ye = m_grid->ys() + m_grid->ym();
+
+  for (int j = ys; j < ye; ++j) {
+    for (int i = xs; i < xe; ++i) {
+      if (active and active->as_int(i, j) == 0) {
+        continue;
+      }
+
+      Q(i, j, 0) = v(i, j, 0) * (v(i, j, 0) >= 0.0 ? w(i, j) : w(i + 1, j));
+      Q(i, j, 1) = v(i, j, 1) * (v(i, j, 1) >= 0.0 ? w(i, j) : w(i, j + 1));
+    }
   }
 
   result.update_ghosts();
@@ -720,11 +886,16 @@ double Routing::max_timestep_W_cfl() const {
   // V could be zero if P is constant and bed is flat
   std::vector<double> tmp = m_Vstag.absmaxcomponents();
 
+  return max_timestep_W_cfl(tmp[0], tmp[1]);
+}
+
+//! Same as max_timestep_W_cfl(), using given maximum velocity components.
+double Routing::max_timestep_W_cfl(double u_max, double v_max) const {
   // add a safety margin
   double alpha = 0.95;
   double eps = 1e-6;
 
-  return alpha * 0.5 / (tmp[0]/m_dx + tmp[1]/m_dy + eps);
+  return alpha * 0.5 / (u_max/m_dx + v_max/m_dy + eps);
 }
 
 
@@ -746,24 +917,28 @@ double Routing::max_timestep_W_cfl() const {
   3. does not check mask because the enforce_bounds() call addresses that.
 
   Otherwise this is the same physical model with the same configurable parameters.
+
+  Also updates `width` rows and columns of ghosts of `Wtill_new` (requires at least this
+  many ghosts in all arguments).
 */
 void Routing::update_Wtill(double dt,
                            const IceModelVec2S &Wtill,
                            const IceModelVec2S &surface_input_rate,
                            const IceModelVec2S &basal_melt_rate,
-                           IceModelVec2S &Wtill_new) {
+                           IceModelVec2S &Wtill_new,
+                           unsigned int width) {
   const double
-    tillwat_max = m_config->get_number("hydrology.tillwat_max"),
-    C           = m_config->get_number("hydrology.tillwat_decay_rate", "m / second");
+    tillwat_max = m_tillwat_max.value(),
+    C           = m_tillwat_decay_rate.value();
 
   IceModelVec::AccessList list{&Wtill, &Wtill_new, &basal_melt_rate};
 
-  bool add_surface_input = m_config->get_flag("hydrology.add_water_input_to_till_storage");
+  bool add_surface_input = m_add_input_to_till.value();
   if (add_surface_input) {
     list.add(surface_input_rate);
   }
 
-  for (Points p(*m_grid); p; p.next()) {
+  for (PointsWithGhosts p(*m_grid, width); p; p.next()) {
     const int i = p.i(), j = p.j();
 
     double input_rate = basal_melt_rate(i, j);
@@ -841,6 +1016,998 @@ void Routing::update_W(double dt,
   m_flow_change.add(1.0, m_flow_change_incremental);
   m_input_change.add(dt, surface_input_rate);
   m_input_change.add(dt, basal_melt_rate);
+
+  // Approximate work per grid point: 44 flops, reading 27 and writing 6 values (in
+  // W_change_due_to_flow(), the loop above and the three updates of diagnostics).
+  {
+    const Profiling &profiling = m_grid->ctx()->profiling();
+    const double points = m_grid->xm() * m_grid->ym();
+    profiling.add_work(profiling.region("routing_W"), 44.0 * points, 8.0 * 33 * points);
+  }
+}
+
+/*!
+ * Compute the total (advective and diffusive) water flux through cell interfaces.
+ *
+ * This is the flux used by W_change_due_to_flow(): the change in W due to flow is `-dt
+ * div(result)`. Ghosts of `result` are updated.
+ */
+void Routing::total_flux(const IceModelVec2S    &W,
+                         const IceModelVec2Stag &Wstag,
+                         const IceModelVec2Stag &K,
+                         const IceModelVec2Stag &Q,
+                         IceModelVec2Stag &result,
+                         const IceModelVec2Int *active) const {
+
+  IceModelVec::AccessList list{&W, &Wstag, &K, &Q, &result};
+  if (active) {
+    list.add(*active);
+  }
+
+  View2<const double> w(W);
+  View2<const double, 2>
+    ws(Wstag),
+    k(K),
+    q(Q);
+  View2<double, 2> F(result);
+
+  const int
+    xs = m_grid->xs(),
+    xe = m_grid->xs() + m_grid->xm(),
+    ys = m_grid->ys(),
+    ye = m_grid->ys() + m_grid->ym();
+
+  for (int j = ys; j < ye; ++j) {
+    for (int i = xs; i < xe; ++i) {
+      if (active and active->as_int(i, j) == 0) {
+        continue;
+      }
+
+      const double
+        De = m_rg * k(i, j, 0) * ws(i, j, 0),
+        Dn = m_rg * k(i, j, 1) * ws(i, j, 1);
+
+      F(i, j, 0) = q(i, j, 0) - De * (w(i + 1, j) - w(i, j)) / m_dx;
+      F(i, j, 1) = q(i, j, 1) - Dn * (w(i, j + 1) - w(i, j)) / m_dy;
+    }
+  }
+
+  result.update_ghosts();
+}
+
+/*!
+ * Mark cells that have to be updated using time steps shorter than `dt_slow` as "fast".
+ *
+ * A cell interface is "fast" if the CFL or the diffusion time step restriction computed
+ * using values at this interface (see max_timestep_W_cfl() and max_timestep_W_diff()) is
+ * shorter than `dt_slow`. A cell is "fast" if at least one of its interfaces is.
+ *
+ * Sets m_cell_mode to 2 in fast cells, 1 in their neighbors, and 0 elsewhere (ghosts are
+ * updated).
+ */
+void Routing::mark_fast_cells(double dt_slow) {
+  const double
+    alpha       = 0.95,
+    eps         = 1e-6,
+    cfl_factor  = 1.0 / m_dx + 1.0 / m_dy,
+    diff_factor = 1.0 / (m_dx * m_dx) + 1.0 / (m_dy * m_dy);
+
+  {
+    IceModelVec::AccessList list{&m_Vstag, &m_Kstag, &m_Wstag, &m_edge_flags};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      int flags = 0;
+      for (int n = 0; n < 2; ++n) {
+        const double
+          dt_cfl = alpha * 0.5 / (std::abs(m_Vstag(i, j, n)) * cfl_factor + eps),
+          D      = m_rg * m_Kstag(i, j, n) * m_Wstag(i, j, n);
+
+        if (dt_cfl < dt_slow or 0.25 > dt_slow * D * diff_factor) {
+          flags |= (1 << n);
+        }
+      }
+      m_edge_flags(i, j) = flags;
+    }
+  }
+  m_edge_flags.update_ghosts();
+
+  IceModelVec::AccessList list{&m_edge_flags, &m_cell_mode};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const bool fast = (m_edge_flags(i, j) != 0 or
+                       (m_edge_flags(i - 1, j) & 1) != 0 or
+                       (m_edge_flags(i, j - 1) & 2) != 0);
+
+    m_cell_mode(i, j) = fast ? 2 : 0;
+  }
+  m_cell_mode.update_ghosts();
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    auto M = m_cell_mode.int_star(i, j);
+
+    if (M.ij == 0 and (M.e == 2 or M.w == 2 or M.n == 2 or M.s == 2)) {
+      m_cell_mode(i, j) = 1;
+    }
+  }
+  m_cell_mode.update_ghosts();
+}
+
+/*!
+ * Update W and Wtill in fast (if `fast` is true) or slow cells using the time step `dt`
+ * and the flux `scale * flux`.
+ *
+ * Updates ghosts of m_W.
+ */
+void Routing::multirate_update(double dt, double scale, const IceModelVec2Stag &flux,
+                               bool fast, const Inputs &inputs) {
+  const double
+    tillwat_max = m_tillwat_max.value(),
+    C           = m_tillwat_decay_rate.value();
+
+  const bool add_surface_input = m_add_input_to_till.value();
+
+  // see update_Wtill()
+  {
+    IceModelVec::AccessList list{&m_cell_mode, &m_Wtill, &m_Wtillnew,
+                                 &m_surface_input_rate, &m_basal_melt_rate};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if ((m_cell_mode.as_int(i, j) == 2) != fast) {
+        continue;
+      }
+
+      double input_rate = m_basal_melt_rate(i, j);
+      if (add_surface_input) {
+        input_rate += m_surface_input_rate(i, j);
+      }
+
+      m_Wtillnew(i, j) = clip(m_Wtill(i, j) + dt * (input_rate - C), 0, tillwat_max);
+    }
+  }
+
+  enforce_bounds(inputs.geometry->cell_type,
+                 inputs.no_model_mask,
+                 0.0,        // do not limit maximum thickness
+                 m_Wtillnew,
+                 m_grounded_margin_change,
+                 m_grounding_line_change,
+                 m_conservation_error_change,
+                 m_no_model_mask_change);
+
+  // see update_W()
+  {
+    IceModelVec::AccessList list{&m_cell_mode, &m_Wtill, &m_Wtillnew,
+                                 &m_surface_input_rate, &m_basal_melt_rate,
+                                 &m_W, &flux, &m_flow_change, &m_input_change};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if ((m_cell_mode.as_int(i, j) == 2) != fast) {
+        continue;
+      }
+
+      const double
+        input_rate   = m_surface_input_rate(i, j) + m_basal_melt_rate(i, j),
+        Wtill_change = m_Wtillnew(i, j) - m_Wtill(i, j),
+        divF         = ((flux(i, j, 0) - flux(i - 1, j, 0)) / m_dx +
+                        (flux(i, j, 1) - flux(i, j - 1, 1)) / m_dy),
+        flow_change  = - scale * divF;
+
+      m_W(i, j) = (m_W(i, j) + (dt * input_rate - Wtill_change) + flow_change);
+
+      m_flow_change(i, j)  += flow_change;
+      m_input_change(i, j) += dt * input_rate;
+    }
+  }
+
+  enforce_bounds(inputs.geometry->cell_type,
+                 inputs.no_model_mask,
+                 0.0,        // do not limit maximum thickness
+                 m_W,
+                 m_grounded_margin_change,
+                 m_grounding_line_change,
+                 m_conservation_error_change,
+                 m_no_model_mask_change);
+
+  m_W.update_ghosts();
+  m_Wtill.copy_from(m_Wtillnew);
+}
+
+/*!
+ * Take a multirate step of length `dt_slow`.
+ *
+ * "Fast" cells (see mark_fast_cells()) take sub-steps satisfying the CFL and diffusion
+ * time step restrictions (`dt_fast` is the length of the first one). All other cells take
+ * one step of length `dt_slow`, using the total flux at the beginning of the step through
+ * interfaces between slow cells and the time integral of the flux through interfaces of
+ * fast cells. This way both sides of each interface see the same amount of water passing
+ * through it and the scheme conserves water.
+ *
+ * Quantities needed to compute fluxes are updated only in fast cells and their neighbors.
+ * Assumes that m_Wstag, m_Kstag, m_Vstag, and m_Qstag were computed using the current W.
+ *
+ * Returns the number of sub-steps taken by fast cells.
+ */
+unsigned int Routing::multirate_step(double dt_fast, double dt_slow, const Inputs &inputs) {
+
+  mark_fast_cells(dt_slow);
+
+  total_flux(m_W, m_Wstag, m_Kstag, m_Qstag, m_flux);
+  m_flux_start.copy_from(m_flux);
+  m_flux_integral.set(0.0);
+
+  double
+    t  = 0.0,
+    dt = dt_fast;
+  unsigned int counter = 0;
+
+  while (t < dt_slow) {
+    if (counter > 0) {
+      water_thickness_staggered(m_W, inputs.geometry->cell_type, m_Wstag, &m_cell_mode);
+
+      double maxKW = 0.0;
+      compute_conductivity(m_Wstag, subglacial_water_pressure(), m_bottom_surface,
+                           m_Kstag, maxKW, &m_cell_mode);
+
+      compute_velocity(m_Wstag, subglacial_water_pressure(), m_bottom_surface,
+                       m_Kstag, inputs.no_model_mask, m_Vstag, &m_cell_mode);
+
+      advective_fluxes(m_Vstag, m_W, m_Qstag, &m_cell_mode);
+
+      total_flux(m_W, m_Wstag, m_Kstag, m_Qstag, m_flux, &m_cell_mode);
+
+      dt = std::min(max_timestep_W_cfl(), max_timestep_W_diff(maxKW));
+    }
+    dt = std::min(dt, dt_slow - t);
+
+    // accumulate fluxes through interfaces of fast cells
+    {
+      IceModelVec::AccessList list{&m_cell_mode, &m_flux, &m_flux_integral};
+
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        auto M = m_cell_mode.int_star(i, j);
+
+        if (M.ij == 2 or M.e == 2) {
+          m_flux_integral(i, j, 0) += dt * m_flux(i, j, 0);
+        }
+
+        if (M.ij == 2 or M.n == 2) {
+          m_flux_integral(i, j, 1) += dt * m_flux(i, j, 1);
+        }
+      }
+    }
+
+    multirate_update(dt, dt, m_flux, true, inputs);
+
+    t += dt;
+    counter += 1;
+  }
+
+  // fluxes through interfaces between slow cells
+  {
+    IceModelVec::AccessList list{&m_cell_mode, &m_flux_start, &m_flux_integral};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      auto M = m_cell_mode.int_star(i, j);
+
+      if (not (M.ij == 2 or M.e == 2)) {
+        m_flux_integral(i, j, 0) = dt_slow * m_flux_start(i, j, 0);
+      }
+
+      if (not (M.ij == 2 or M.n == 2)) {
+        m_flux_integral(i, j, 1) = dt_slow * m_flux_start(i, j, 1);
+      }
+    }
+  }
+  m_flux_integral.update_ghosts();
+
+  multirate_update(dt_slow, 1.0, m_flux_integral, false, inputs);
+
+  return counter;
+}
+
+/*!
+ * Compute edge-centered quantities that depend on the hydraulic potential only, using the
+ * water pressure `P`.
+ *
+ * In this model the water pressure is equal to the overburden pressure and the bed
+ * elevation does not change during an update, so the factor \f$|\nabla R|^{\beta-2}\f$
+ * in the conductivity and the gradient of \f$R = P + \rho_w g b\f$ can be computed *once*
+ * per update_impl() call instead of once per sub-step. Compare compute_conductivity()
+ * and compute_velocity().
+ */
+void Routing::potential_terms(const IceModelVec2S &P, const IceModelVec2Int *no_model_mask) {
+  const double
+    beta    = m_gradient_power.value(),
+    betapow = (beta - 2.0) / 2.0,
+    // see compute_conductivity()
+    eps     = beta < 2.0 ? 1.0 : 0.0;
+
+  // R  <-- P + rhow g b
+  P.add(m_rg, m_bottom_surface, m_R);  // yes, it updates ghosts
+
+  IceModelVec::AccessList list{&m_R, &m_conductivity_factor, &m_potential_gradient};
+  if (no_model_mask) {
+    list.add(*no_model_mask);
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double
+      R_x = (m_R(i + 1, j) - m_R(i, j)) / m_dx,
+      R_y = (m_R(i, j + 1) - m_R(i, j)) / m_dy;
+
+    if (beta != 2.0) {
+      double dRdy = (m_R(i + 1, j + 1) + m_R(i, j + 1) -
+                     m_R(i + 1, j - 1) - m_R(i, j - 1)) / (4.0 * m_dy);
+      m_conductivity_factor(i, j, 0) = pow(R_x * R_x + dRdy * dRdy + eps * eps, betapow);
+
+      double dRdx = (m_R(i + 1, j + 1) + m_R(i + 1, j) -
+                     m_R(i - 1, j + 1) - m_R(i - 1, j)) / (4.0 * m_dx);
+      m_conductivity_factor(i, j, 1) = pow(dRdx * dRdx + R_y * R_y + eps * eps, betapow);
+    } else {
+      m_conductivity_factor(i, j, 0) = 1.0;
+      m_conductivity_factor(i, j, 1) = 1.0;
+    }
+
+    m_potential_gradient(i, j, 0) = - R_x;
+    m_potential_gradient(i, j, 1) = - R_y;
+
+    if (no_model_mask) {
+      auto M = no_model_mask->int_star(i, j);
+
+      if (M.ij or M.e) {
+        m_potential_gradient(i, j, 0) = 0.0;
+      }
+
+      if (M.ij or M.n) {
+        m_potential_gradient(i, j, 1) = 0.0;
+      }
+    }
+  }
+
+  m_conductivity_factor.update_ghosts();
+  m_potential_gradient.update_ghosts();
+}
+
+/*!
+ * Compute the staggered water thickness `Ws`, the conductivity `K`, the velocity `V`, and
+ * the advective flux `Q` at the interface `o` (0 -- east, 1 -- north) of the cell `(i, j)`.
+ *
+ * Uses the same formulas as water_thickness_staggered(), compute_conductivity(),
+ * compute_velocity(), and advective_fluxes(). Works in the ghost cells of width 1, so
+ * neighbors can compute fluxes through "their" interfaces without communication.
+ *
+ * Requires access to `W`, `cell_type`, m_conductivity_factor, and m_potential_gradient.
+ */
+void Routing::fused_edge(const IceModelVec2S &W, const IceModelVec2CellType &cell_type,
+                         int i, int j, int o,
+                         double &Ws, double &K, double &V, double &Q) const {
+  const int
+    i1 = o == 0 ? i + 1 : i,
+    j1 = o == 0 ? j : j + 1;
+
+  bool a = false, b = false;
+  if (m_include_floating_ice.value()) {
+    a = cell_type.icy(i, j);
+    b = cell_type.icy(i1, j1);
+  } else {
+    a = cell_type.grounded_ice(i, j);
+    b = cell_type.grounded_ice(i1, j1);
+  }
+
+  if (a) {
+    Ws = b ? 0.5 * (W(i, j) + W(i1, j1)) : W(i, j);
+  } else {
+    Ws = b ? W(i1, j1) : 0.0;
+  }
+
+  K = (m_conductivity.value() * pow(Ws, m_thickness_power.value() - 1.0) *
+       m_conductivity_factor(i, j, o));
+
+  V = Ws > 0.0 ? K * m_potential_gradient(i, j, o) : 0.0;
+
+  Q = V * (V >= 0.0 ? W(i, j) : W(i1, j1));
+}
+
+/*!
+ * Compute the water velocity m_Vstag and the advective flux m_Qstag (without updating
+ * ghosts) and the maximum time steps allowed by the CFL and diffusion criteria.
+ *
+ * Uses one reduction and no ghost exchanges. Requires valid ghosts of `W`.
+ */
+void Routing::fused_fluxes(const IceModelVec2S &W, const IceModelVec2CellType &cell_type,
+                           double &dt_cfl, double &dt_diff) {
+
+  IceModelVec::AccessList list{&W, &cell_type, &m_conductivity_factor,
+                               &m_potential_gradient, &m_Vstag, &m_Qstag};
+
+  // maximum |u|, |v|, and K W
+  double max_local[3] = {0.0, 0.0, 0.0};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    for (int o = 0; o < 2; ++o) {
+      double Ws, K, V, Q;
+      fused_edge(W, cell_type, i, j, o, Ws, K, V, Q);
+
+      m_Vstag(i, j, o) = V;
+      m_Qstag(i, j, o) = Q;
+
+      max_local[o] = std::max(max_local[o], std::abs(V));
+      max_local[2] = std::max(max_local[2], K * Ws);
+    }
+  }
+
+  double max_global[3];
+  GlobalMax(m_grid->com, max_local, max_global, 3);
+
+  dt_cfl  = max_timestep_W_cfl(max_global[0], max_global[1]);
+  dt_diff = max_timestep_W_diff(max_global[2]);
+}
+
+/*!
+ * Compute W_new (see update_W()) re-computing fluxes through all four interfaces of each
+ * cell, so that the only ghost exchange during a sub-step is the one updating ghosts of W.
+ *
+ * Updates m_flow_change and m_input_change.
+ *
+ * If `width` is positive, also computes `W_new` in `width` rows and columns of ghosts
+ * (redundantly, to avoid a ghost exchange; see wide_halo_update()). This requires valid
+ * ghosts of width `width + 1` in `W` and `width` in other arguments. Changes in ghosts
+ * are not added to m_flow_change and m_input_change.
+ */
+void Routing::fused_update_W(double dt,
+                             const IceModelVec2S &W,
+                             const IceModelVec2CellType &cell_type,
+                             const IceModelVec2S &Wtill,
+                             const IceModelVec2S &Wtill_new,
+                             const IceModelVec2S &surface_input_rate,
+                             const IceModelVec2S &basal_melt_rate,
+                             IceModelVec2S &W_new,
+                             unsigned int width) {
+  const double
+    wux = 1.0 / (m_dx * m_dx),
+    wuy = 1.0 / (m_dy * m_dy);
+
+  IceModelVec::AccessList list{&W, &cell_type, &m_conductivity_factor,
+                               &m_potential_gradient, &Wtill, &Wtill_new,
+                               &surface_input_rate, &basal_melt_rate,
+                               &m_flow_change, &m_input_change, &W_new};
+
+  const int
+    xs = m_grid->xs(),
+    xe = m_grid->xs() + m_grid->xm(),
+    ys = m_grid->ys(),
+    ye = m_grid->ys() + m_grid->ym();
+
+  for (PointsWithGhosts p(*m_grid, width); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double
+      Ws_e, K_e, V_e, Q_e,
+      Ws_w, K_w, V_w, Q_w,
+      Ws_n, K_n, V_n, Q_n,
+      Ws_s, K_s, V_s, Q_s;
+
+    fused_edge(W, cell_type, i,     j,     0, Ws_e, K_e, V_e, Q_e);
+    fused_edge(W, cell_type, i - 1, j,     0, Ws_w, K_w, V_w, Q_w);
+    fused_edge(W, cell_type, i,     j,     1, Ws_n, K_n, V_n, Q_n);
+    fused_edge(W, cell_type, i,     j - 1, 1, Ws_s, K_s, V_s, Q_s);
+
+    const double divQ = (Q_e - Q_w) / m_dx + (Q_n - Q_s) / m_dy;
+
+    const double
+      De = m_rg * K_e * Ws_e,
+      Dw = m_rg * K_w * Ws_w,
+      Dn = m_rg * K_n * Ws_n,
+      Ds = m_rg * K_s * Ws_s;
+
+    auto w = W.star(i, j);
+    const double diffW = (wux * (De * (w.e - w.ij) - Dw * (w.ij - w.w)) +
+                          wuy * (Dn * (w.n - w.ij) - Ds * (w.ij - w.s)));
+
+    const double flow_change = dt * (- divQ + diffW);
+
+    double input_rate = surface_input_rate(i, j) + basal_melt_rate(i, j);
+
+    double Wtill_change = Wtill_new(i, j) - Wtill(i, j);
+    W_new(i, j) = (W(i, j) + (dt * input_rate - Wtill_change) + flow_change);
+
+    if (width == 0 or (i >= xs and i < xe and j >= ys and j < ye)) {
+      m_flow_change(i, j)  += flow_change;
+      m_input_change(i, j) += dt * input_rate;
+    }
+  }
+
+  // Approximate work per grid point: about 100 flops (fluxes through four interfaces
+  // account for most of them), reading 24 and writing 3 values.
+  {
+    const Profiling &profiling = m_grid->ctx()->profiling();
+    const double points = (m_grid->xm() + 2.0 * width) * (m_grid->ym() + 2.0 * width);
+    profiling.add_work(profiling.region("routing_W"), 100.0 * points, 8.0 * 27 * points);
+  }
+}
+
+/*!
+ * Explicit update from `t` to `t + dt` using the fused sub-step kernel and ghosts of width
+ * `k` = m_steps_per_exchange, taking `k` sub-steps per ghost exchange.
+ *
+ * If `W` has valid ghosts of width `r`, fused_update_W() can compute `W_new` in owned
+ * points and `r - 1` rows and columns of ghosts without communication. Starting with `r
+ * == k`, each sub-step shrinks the valid part of the ghost region by one, and ghosts of
+ * `W` have to be updated after `k` sub-steps instead of after each one. All other fields
+ * either do not change during an update (their ghosts are updated once, at the
+ * beginning), or are updated pointwise in all ghosts (Wtill).
+ *
+ * Each sub-step still uses one reduction to compute the time step length. Results are the
+ * same (up to rounding) as without communication-avoiding sub-steps.
+ *
+ * Requires the fused sub-step kernel (hydrology.routing.multirate_ratio == 1) and
+ * sub-domains that are at least `k` grid points wide.
+ */
+void Routing::wide_halo_update(double t, double dt, const Inputs &inputs) {
+  const double
+    t_final = t + dt,
+    dt_max  = m_max_time_step.value();
+
+  const unsigned int k = m_steps_per_exchange;
+
+  const IceModelVec2Int *no_model_mask = nullptr;
+  if (inputs.no_model_mask) {
+    m_wide.no_model_mask.copy_from(*inputs.no_model_mask);
+    no_model_mask = &m_wide.no_model_mask;
+  }
+
+  // fields that do not change during the update: ghosts are updated once
+  m_wide.cell_type.copy_from(inputs.geometry->cell_type);
+  m_wide.surface_input_rate.copy_from(m_surface_input_rate);
+  m_wide.basal_melt_rate.copy_from(m_basal_melt_rate);
+
+  m_wide.W.copy_from(m_W);
+  m_wide.Wtill.copy_from(m_Wtill);
+
+  const IceModelVec2CellType &cell_type = m_wide.cell_type;
+
+  // buffers are swapped after each sub-step: copying would update ghosts
+  IceModelVec2S
+    *W         = &m_wide.W,
+    *W_new     = &m_wide.W_new,
+    *Wtill     = &m_wide.Wtill,
+    *Wtill_new = &m_wide.Wtill_new;
+
+  // width of the valid part of the ghost region of m_wide.W
+  unsigned int width = k;
+
+  double hdt = 0.0;
+  unsigned int step_counter = 0, exchange_counter = 0;
+  for (double ht = t; ht < t_final; ht += hdt) {
+    step_counter++;
+
+    if (width == 0) {
+      W->update_ghosts();
+      exchange_counter++;
+      width = k;
+    }
+
+    double dt_cfl = 0.0, dt_diff_w = 0.0;
+
+    // ghosts of m_Vstag and m_Qstag are not updated
+    m_grid->ctx()->profiling().begin("routing_flux");
+    fused_fluxes(*W, cell_type, dt_cfl, dt_diff_w);
+    m_grid->ctx()->profiling().end("routing_flux");
+
+    // ghosts of m_Qstag_average are updated after the time-stepping loop
+    m_Qstag_average.add(hdt, m_Qstag);
+
+    hdt = std::min(t_final - ht, dt_max);
+    hdt = std::min(hdt, dt_cfl);
+    hdt = std::min(hdt, dt_diff_w);
+
+    m_log->message(3, "  hydrology step %05d, dt = %f s\n", step_counter, hdt);
+
+    // Wtill is updated pointwise, so it is updated in all ghosts during each sub-step and
+    // never needs a ghost exchange
+    m_grid->ctx()->profiling().begin("routing_Wtill");
+    update_Wtill(hdt,
+                 *Wtill,
+                 m_wide.surface_input_rate,
+                 m_wide.basal_melt_rate,
+                 *Wtill_new,
+                 k);
+    enforce_bounds(cell_type,
+                   no_model_mask,
+                   0.0,        // do not limit maximum thickness
+                   *Wtill_new,
+                   m_grounded_margin_change,
+                   m_grounding_line_change,
+                   m_conservation_error_change,
+                   m_no_model_mask_change,
+                   k);
+    m_grid->ctx()->profiling().end("routing_Wtill");
+
+    width -= 1;
+
+    m_grid->ctx()->profiling().begin("routing_W");
+    fused_update_W(hdt, *W, cell_type, *Wtill, *Wtill_new,
+                   m_wide.surface_input_rate, m_wide.basal_melt_rate,
+                   *W_new, width);
+    enforce_bounds(cell_type,
+                   no_model_mask,
+                   0.0,        // do not limit maximum thickness
+                   *W_new,
+                   m_grounded_margin_change,
+                   m_grounding_line_change,
+                   m_conservation_error_change,
+                   m_no_model_mask_change,
+                   width);
+
+    std::swap(W, W_new);
+    m_grid->ctx()->profiling().end("routing_W");
+
+    std::swap(Wtill, Wtill_new);
+  }
+
+  // updates ghosts of m_W
+  m_W.copy_from(*W);
+  m_Wtill.copy_from(*Wtill);
+
+  m_Qstag_average.update_ghosts();
+
+  staggered_to_regular(inputs.geometry->cell_type, m_Qstag_average,
+                       m_include_floating_ice.value(),
+                       m_Q);
+  m_Q.scale(1.0 / dt);
+
+  m_solver_stats.steps = step_counter;
+
+  m_log->message(2,
+                 "  took %d hydrology sub-steps with average dt = %.6f years (%.3f s or %.3f hours)\n"
+                 "  and %d ghost exchanges (%d sub-steps per exchange)\n",
+                 step_counter,
+                 units::convert(m_sys, dt / step_counter, "seconds", "years"),
+                 dt / step_counter,
+                 (dt / step_counter) / 3600.0,
+                 exchange_counter + 1, k);
+}
+
+/*!
+ * Create a SNES solving a problem defined on the grid of `example`, with the residual
+ * `residual` (called with the context `ctx`) and the command-line options prefix `prefix`.
+ *
+ * Each solver gets its own copy of the DM because residual callbacks are attached to it
+ * and DMs are shared by all fields with the same number of degrees of freedom and stencil
+ * width. The Jacobian is approximated using finite differences and coloring.
+ */
+void Routing::create_implicit_solver(const IceModelVec2S &example, const std::string &prefix,
+                                     DMDASNESFunction residual, void *ctx,
+                                     petsc::DM &da, petsc::SNES &snes, petsc::Vec &solution) {
+  PetscErrorCode ierr;
+
+  ierr = DMClone(*example.dm(), da.rawptr());
+  PISM_CHK(ierr, "DMClone");
+
+  ierr = DMDASNESSetFunctionLocal(da, INSERT_VALUES, residual, ctx);
+  PISM_CHK(ierr, "DMDASNESSetFunctionLocal");
+
+  ierr = DMCreateGlobalVector(da, solution.rawptr());
+  PISM_CHK(ierr, "DMCreateGlobalVector");
+
+  ierr = SNESCreate(m_grid->com, snes.rawptr());
+  PISM_CHK(ierr, "SNESCreate");
+
+  ierr = SNESSetDM(snes, da);
+  PISM_CHK(ierr, "SNESSetDM");
+
+  ierr = SNESSetOptionsPrefix(snes, prefix.c_str());
+  PISM_CHK(ierr, "SNESSetOptionsPrefix");
+
+  ierr = SNESSetFromOptions(snes);
+  PISM_CHK(ierr, "SNESSetFromOptions");
+}
+
+//! Solve a nonlinear system using `snes`, starting from `solution`. Stops if it fails.
+void Routing::implicit_solve(::SNES snes, Vec solution, const std::string &name) {
+  PetscErrorCode ierr = SNESSolve(snes, NULL, solution);
+  PISM_CHK(ierr, "SNESSolve");
+
+  PetscInt nonlinear_iterations = 0, linear_iterations = 0;
+
+  ierr = SNESGetIterationNumber(snes, &nonlinear_iterations);
+  PISM_CHK(ierr, "SNESGetIterationNumber");
+
+  ierr = SNESGetLinearSolveIterations(snes, &linear_iterations);
+  PISM_CHK(ierr, "SNESGetLinearSolveIterations");
+
+  m_solver_stats.nonlinear_iterations += nonlinear_iterations;
+  m_solver_stats.linear_iterations    += linear_iterations;
+
+  SNESConvergedReason snes_reason;
+  ierr = SNESGetConvergedReason(snes, &snes_reason);
+  PISM_CHK(ierr, "SNESGetConvergedReason");
+
+  SNESTerminationReason reason(snes_reason);
+  if (reason.failed()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "hydrology: implicit %s solver failed: %s",
+                                  name.c_str(), reason.description().c_str());
+  }
+}
+
+/*!
+ * Returns false in cells where enforce_bounds() removes water: ice-free land, the ocean
+ * (or ice-free ocean if hydrology.routing.include_floating_ice is set), and the "no
+ * model" area.
+ */
+bool Routing::implicit_active(const IceModelVec2CellType &cell_type,
+                              const IceModelVec2Int *no_model_mask, int i, int j) const {
+  if (no_model_mask and no_model_mask->as_int(i, j) != 0) {
+    return false;
+  }
+
+  if (m_include_floating_ice.value()) {
+    return cell_type.icy(i, j);
+  }
+  return cell_type.grounded_ice(i, j);
+}
+
+/*!
+ * Compute the diffusivity `D` and the advective flux `Q` at the interface `o` (0 -- east,
+ * 1 -- north) of the cell `(i, j)`, using the water thickness `W`.
+ *
+ * If the conductivity is lagged, uses m_Wstag and m_Kstag computed at the beginning of a
+ * time step (see implicit_coefficients()); otherwise the same as fused_edge().
+ */
+void Routing::implicit_edge(const IceModelVec2S &W, const IceModelVec2CellType &cell_type,
+                            int i, int j, int o, double &D, double &Q) const {
+  double Ws = 0.0, K = 0.0, V = 0.0;
+
+  if (m_implicit_lagged) {
+    const int
+      i1 = o == 0 ? i + 1 : i,
+      j1 = o == 0 ? j : j + 1;
+
+    Ws = m_Wstag(i, j, o);
+    K  = m_Kstag(i, j, o);
+    V  = Ws > 0.0 ? K * m_potential_gradient(i, j, o) : 0.0;
+    Q  = V * (V >= 0.0 ? W(i, j) : W(i1, j1));
+  } else {
+    fused_edge(W, cell_type, i, j, o, Ws, K, V, Q);
+  }
+
+  D = m_rg * K * Ws;
+}
+
+/*!
+ * Compute the rate of change of the water thickness due to flow in the cell `(i, j)`,
+ * using the same discretization as W_change_due_to_flow().
+ */
+double Routing::implicit_flow_rate(const IceModelVec2S &W,
+                                   const IceModelVec2CellType &cell_type,
+                                   int i, int j) const {
+  double
+    De, Qe, Dw, Qw, Dn, Qn, Ds, Qs;
+
+  implicit_edge(W, cell_type, i,     j,     0, De, Qe);
+  implicit_edge(W, cell_type, i - 1, j,     0, Dw, Qw);
+  implicit_edge(W, cell_type, i,     j,     1, Dn, Qn);
+  implicit_edge(W, cell_type, i,     j - 1, 1, Ds, Qs);
+
+  const double divQ = (Qe - Qw) / m_dx + (Qn - Qs) / m_dy;
+
+  auto w = W.star(i, j);
+  const double diffW = ((De * (w.e - w.ij) - Dw * (w.ij - w.w)) / (m_dx * m_dx) +
+                        (Dn * (w.n - w.ij) - Ds * (w.ij - w.s)) / (m_dy * m_dy));
+
+  return - divQ + diffW;
+}
+
+/*!
+ * Compute the staggered water thickness, the conductivity, the velocity, and the advective
+ * flux using the current W and P.
+ *
+ * The first two are used by implicit_edge() if the conductivity is lagged, the last one
+ * to compute the average flux.
+ */
+void Routing::implicit_coefficients(const Inputs &inputs) {
+  double maxKW = 0.0;
+
+  water_thickness_staggered(m_W, inputs.geometry->cell_type, m_Wstag);
+
+  compute_conductivity(m_Wstag, subglacial_water_pressure(), m_bottom_surface,
+                       m_Kstag, maxKW);
+
+  compute_velocity(m_Wstag, subglacial_water_pressure(), m_bottom_surface,
+                   m_Kstag, inputs.no_model_mask, m_Vstag);
+
+  advective_fluxes(m_Vstag, m_W, m_Qstag);
+}
+
+/*!
+ * Residual of the backward Euler discretization of the water thickness equation
+ *
+ * @f[ W - W_{\text{old}} - \Delta t \left( -\nabla\cdot \mathbf{V} W + \nabla\cdot(D \nabla
+ * W) + \frac{m}{\rho_w} \right) + \Delta W_{\text{till}} = 0. @f]
+ *
+ * The iterate is set to zero in cells where enforce_bounds() removes water, so these cells
+ * accumulate the water that flows into them (to be removed and accounted for later).
+ */
+void Routing::implicit_W_residual(const double *const *x, double **F) {
+  const Inputs &inputs = *m_implicit_inputs;
+  const double dt = m_implicit_dt;
+
+  const IceModelVec2CellType &cell_type = inputs.geometry->cell_type;
+  const IceModelVec2Int *no_model_mask = inputs.no_model_mask;
+
+  IceModelVec2S &W = m_W_implicit;
+
+  IceModelVec::AccessList list{&W, &cell_type};
+  if (no_model_mask) {
+    list.add(*no_model_mask);
+  }
+
+  for (PointsWithGhosts p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    W(i, j) = implicit_active(cell_type, no_model_mask, i, j) ? x[j][i] : 0.0;
+  }
+
+  list.add({&m_W, &m_Wtill, &m_Wtillnew, &m_surface_input_rate, &m_basal_melt_rate,
+            &m_conductivity_factor, &m_potential_gradient});
+  if (m_implicit_lagged) {
+    list.add({&m_Wstag, &m_Kstag});
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double
+      input_rate   = m_surface_input_rate(i, j) + m_basal_melt_rate(i, j),
+      Wtill_change = m_Wtillnew(i, j) - m_Wtill(i, j),
+      flow_rate    = implicit_flow_rate(W, cell_type, i, j);
+
+    F[j][i] = x[j][i] - (m_W(i, j) + (dt * input_rate - Wtill_change) + dt * flow_rate);
+  }
+}
+
+PetscErrorCode Routing::W_residual_callback(DMDALocalInfo *info,
+                                            const double *const *x, double **F,
+                                            CallbackData *data) {
+  try {
+    (void) info;
+    data->model->implicit_W_residual(x, F);
+  } catch (...) {
+    MPI_Comm com = MPI_COMM_SELF;
+    PetscErrorCode ierr = PetscObjectGetComm((PetscObject)data->da, &com); CHKERRQ(ierr);
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
+/*!
+ * Compute m_Wnew by taking a backward Euler step of length `dt`. Uses m_Wtillnew.
+ *
+ * Updates m_flow_change and m_input_change.
+ */
+void Routing::implicit_W_step(double dt, const Inputs &inputs) {
+  m_implicit_dt     = dt;
+  m_implicit_inputs = &inputs;
+
+  // use the current water thickness as the initial guess
+  m_Wnew.copy_from(m_W);
+  PetscErrorCode ierr = VecCopy(m_Wnew.vec(), m_W_solution);
+  PISM_CHK(ierr, "VecCopy");
+
+  implicit_solve(m_W_snes, m_W_solution, "water thickness");
+
+  ierr = VecCopy(m_W_solution, m_Wnew.vec());
+  PISM_CHK(ierr, "VecCopy");
+
+  IceModelVec::AccessList list{&m_W, &m_Wnew, &m_Wtill, &m_Wtillnew,
+                               &m_surface_input_rate, &m_basal_melt_rate,
+                               &m_flow_change, &m_input_change};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double
+      input_change = dt * (m_surface_input_rate(i, j) + m_basal_melt_rate(i, j)),
+      Wtill_change = m_Wtillnew(i, j) - m_Wtill(i, j);
+
+    m_flow_change(i, j)  += m_Wnew(i, j) - m_W(i, j) - input_change + Wtill_change;
+    m_input_change(i, j) += input_change;
+  }
+}
+
+/*!
+ * Take implicit time steps limited by hydrology.maximum_time_step only.
+ *
+ * The water pressure does not change during an update, so potential_terms() is called
+ * once.
+ */
+void Routing::implicit_update(double t, double dt, const Inputs &inputs) {
+  const double
+    t_final = t + dt,
+    dt_max  = m_max_time_step.value();
+
+  const IceModelVec2CellType &cell_type = inputs.geometry->cell_type;
+
+  potential_terms(subglacial_water_pressure(), inputs.no_model_mask);
+
+  double hdt = 0.0;
+  unsigned int step_counter = 0;
+  for (double ht = t; ht < t_final; ht += hdt) {
+    step_counter++;
+
+    implicit_coefficients(inputs);
+
+    hdt = std::min(t_final - ht, dt_max);
+
+    m_Qstag_average.add(hdt, m_Qstag);
+
+    m_log->message(3, "  implicit hydrology step %05d, dt = %f s\n", step_counter, hdt);
+
+    m_grid->ctx()->profiling().begin("routing_Wtill");
+    update_Wtill(hdt,
+                 m_Wtill,
+                 m_surface_input_rate,
+                 m_basal_melt_rate,
+                 m_Wtillnew);
+    enforce_bounds(cell_type,
+                   inputs.no_model_mask,
+                   0.0,        // do not limit maximum thickness
+                   m_Wtillnew,
+                   m_grounded_margin_change,
+                   m_grounding_line_change,
+                   m_conservation_error_change,
+                   m_no_model_mask_change);
+    m_grid->ctx()->profiling().end("routing_Wtill");
+
+    m_grid->ctx()->profiling().begin("routing_W");
+    implicit_W_step(hdt, inputs);
+    enforce_bounds(cell_type,
+                   inputs.no_model_mask,
+                   0.0,        // do not limit maximum thickness
+                   m_Wnew,
+                   m_grounded_margin_change,
+                   m_grounding_line_change,
+                   m_conservation_error_change,
+                   m_no_model_mask_change);
+
+    // transfer new into old (updates ghosts of m_W)
+    m_W.copy_from(m_Wnew);
+    m_grid->ctx()->profiling().end("routing_W");
+
+    m_Wtill.copy_from(m_Wtillnew);
+  }
+
+  staggered_to_regular(cell_type, m_Qstag_average,
+                       m_include_floating_ice.value(),
+                       m_Q);
+  m_Q.scale(1.0 / dt);
+
+  m_solver_stats.steps = step_counter;
+
+  m_log->message(2,
+                 "  took %d implicit hydrology steps (%d nonlinear, %d linear iterations)\n",
+                 step_counter, m_solver_stats.nonlinear_iterations,
+                 m_solver_stats.linear_iterations);
 }
 
 //! Update the model state variables W and Wtill by applying the subglacial hydrology model equations.
@@ -854,6 +2021,9 @@ void Routing::update_W(double dt,
 */
 void Routing::update_impl(double t, double dt, const Inputs& inputs) {
 
+  m_solver_stats.reset();
+  const double start_time = MPI_Wtime();
+
   ice_bottom_surface(*inputs.geometry, m_bottom_surface);
 
   double
@@ -862,14 +2032,32 @@ void Routing::update_impl(double t, double dt, const Inputs& inputs) {
 
   const double
     t_final = t + dt,
-    dt_max  = m_config->get_number("hydrology.maximum_time_step", "seconds");
+    dt_max  = m_max_time_step.value();
 
   m_Qstag_average.set(0.0);
 
   // make sure W has valid ghosts before starting hydrology steps
   m_W.update_ghosts();
 
-  unsigned int step_counter = 0;
+  if (m_implicit) {
+    implicit_update(t, dt, inputs);
+    m_solver_stats.wall_time = MPI_Wtime() - start_time;
+    return;
+  }
+
+  // use the fused sub-step kernel unless multirate time stepping is enabled
+  const bool fused = m_multirate_ratio == 1;
+  if (fused) {
+    potential_terms(subglacial_water_pressure(), inputs.no_model_mask);
+  }
+
+  if (m_steps_per_exchange > 1) {
+    wide_halo_update(t, dt, inputs);
+    m_solver_stats.wall_time = MPI_Wtime() - start_time;
+    return;
+  }
+
+  unsigned int step_counter = 0, fast_step_counter = 0;
   for (; ht < t_final; ht += hdt) {
     step_counter++;
 
@@ -877,9 +2065,62 @@ void Routing::update_impl(double t, double dt, const Inputs& inputs) {
     double huge_number = 1e6;
     check_bounds(m_W, huge_number);
 
-    check_bounds(m_Wtill, m_config->get_number("hydrology.tillwat_max"));
+    check_bounds(m_Wtill, m_tillwat_max.value());
 #endif
 
+    if (fused) {
+      double dt_cfl = 0.0, dt_diff_w = 0.0;
+
+      // ghosts of m_Vstag and m_Qstag are not updated
+      m_grid->ctx()->profiling().begin("routing_flux");
+      fused_fluxes(m_W, inputs.geometry->cell_type, dt_cfl, dt_diff_w);
+      m_grid->ctx()->profiling().end("routing_flux");
+
+      // ghosts of m_Qstag_average are updated after the time-stepping loop
+      m_Qstag_average.add(hdt, m_Qstag);
+
+      hdt = std::min(t_final - ht, dt_max);
+      hdt = std::min(hdt, dt_cfl);
+      hdt = std::min(hdt, dt_diff_w);
+
+      m_log->message(3, "  hydrology step %05d, dt = %f s\n", step_counter, hdt);
+
+      m_grid->ctx()->profiling().begin("routing_Wtill");
+      update_Wtill(hdt,
+                   m_Wtill,
+                   m_surface_input_rate,
+                   m_basal_melt_rate,
+                   m_Wtillnew);
+      enforce_bounds(inputs.geometry->cell_type,
+                     inputs.no_model_mask,
+                     0.0,        // do not limit maximum thickness
+                     m_Wtillnew,
+                     m_grounded_margin_change,
+                     m_grounding_line_change,
+                     m_conservation_error_change,
+                     m_no_model_mask_change);
+      m_grid->ctx()->profiling().end("routing_Wtill");
+
+      m_grid->ctx()->profiling().begin("routing_W");
+      fused_update_W(hdt, m_W, inputs.geometry->cell_type, m_Wtill, m_Wtillnew,
+                     m_surface_input_rate, m_basal_melt_rate, m_Wnew);
+      enforce_bounds(inputs.geometry->cell_type,
+                     inputs.no_model_mask,
+                     0.0,        // do not limit maximum thickness
+                     m_Wnew,
+                     m_grounded_margin_change,
+                     m_grounding_line_change,
+                     m_conservation_error_change,
+                     m_no_model_mask_change);
+
+      // the only ghost exchange during a sub-step (updates ghosts of m_W)
+      m_W.copy_from(m_Wnew);
+      m_grid->ctx()->profiling().end("routing_W");
+
+      m_Wtill.copy_from(m_Wtillnew);
+      continue;
+    }
+
     // updates ghosts of m_Wstag
     water_thickness_staggered(m_W,
                               inputs.geometry->cell_type,
@@ -924,6 +2165,20 @@ void Routing::update_impl(double t, double dt, const Inputs& inputs) {
 
     m_log->message(3, "  hydrology step %05d, dt = %f s\n", step_counter, hdt);
 
+    // let cells with less restrictive local stability criteria take longer steps
+    if (m_multirate_ratio > 1) {
+      const double dt_slow = std::min(std::min(t_final - ht, dt_max),
+                                      m_multirate_ratio * hdt);
+      if (dt_slow > hdt) {
+        m_grid->ctx()->profiling().begin("routing_multirate");
+        fast_step_counter += multirate_step(hdt, dt_slow, inputs);
+        m_grid->ctx()->profiling().end("routing_multirate");
+
+        hdt = dt_slow;
+        continue;
+      }
+    }
+
     // update Wtillnew from Wtill and input_rate
     {
       m_grid->ctx()->profiling().begin("routing_Wtill");
@@ -974,17 +2229,28 @@ void Routing::update_impl(double t, double dt, const Inputs& inputs) {
     m_Wtill.copy_from(m_Wtillnew);
   } // end of the time-stepping loop
 
+  m_Qstag_average.update_ghosts();
+
   staggered_to_regular(inputs.geometry->cell_type, m_Qstag_average,
                        m_config->get_flag("hydrology.routing.include_floating_ice"),
                        m_Q);
   m_Q.scale(1.0 / dt);
 
+  m_solver_stats.steps     = step_counter;
+  m_solver_stats.wall_time = MPI_Wtime() - start_time;
+
   m_log->message(2,
                  "  took %d hydrology sub-steps with average dt = %.6f years (%.3f s or %.3f hours)\n",
                  step_counter,
                  units::convert(m_sys, dt / step_counter, "seconds", "years"),
                  dt / step_counter,
                  (dt / step_counter) / 3600.0);
+
+  if (fast_step_counter > 0) {
+    m_log->message(2,
+                   "  (multirate time stepping: fast cells took %d sub-steps)\n",
+                   fast_step_counter);
+  }
 }
 
 std::map<std::string, Diagnostic::Ptr> Routing::diagnostics_impl() const {
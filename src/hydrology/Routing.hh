@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2019 PISM Authors
+// Copyright (C) 2012-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,12 @@
 #define _ROUTING_H_
 
 #include "Hydrology.hh"
+#include "pism/util/petscwrappers/DM.hh"
+#include "pism/util/petscwrappers/SNES.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/SolverStats.hh"
+#include "pism/util/WorkArray2.hh"
+#include "pism/util/IceModelVec2CellType.hh"
 
 namespace pism {
 
@@ -85,6 +91,8 @@ public:
   virtual ~Routing();
 
   const IceModelVec2S& subglacial_water_pressure() const;
+
+  const SolverStats& solver_stats() const;
   const IceModelVec2Stag& velocity_staggered() const;
 
 protected:
@@ -107,6 +115,7 @@ protected:
 
   double max_timestep_W_diff(double KW_max) const;
   double max_timestep_W_cfl() const;
+  double max_timestep_W_cfl(double u_max, double v_max) const;
 protected:
 
   // edge-centered (staggered) advection flux
@@ -132,28 +141,44 @@ protected:
   double m_dx, m_dy;
   double m_rg;
 
+  // parameters used in every hydrology sub-step
+  ConfigParameter<double> m_conductivity;
+  ConfigParameter<double> m_thickness_power;
+  ConfigParameter<double> m_gradient_power;
+  ConfigParameter<double> m_tillwat_max;
+  ConfigParameter<double> m_tillwat_decay_rate;
+  ConfigParameter<double> m_max_time_step;
+  ConfigParameter<bool> m_include_floating_ice;
+  ConfigParameter<bool> m_add_input_to_till;
+
   IceModelVec2S m_bottom_surface;
 
+  // "active" (optional) restricts computations to cells where it is positive (see
+  // multirate_step())
   void water_thickness_staggered(const IceModelVec2S &W,
                                  const IceModelVec2CellType &mask,
-                                 IceModelVec2Stag &result);
+                                 IceModelVec2Stag &result,
+                                 const IceModelVec2Int *active = nullptr);
 
   void compute_conductivity(const IceModelVec2Stag &W,
                             const IceModelVec2S &P,
                             const IceModelVec2S &bed,
                             IceModelVec2Stag &result,
-                            double &maxKW) const;
+                            double &maxKW,
+                            const IceModelVec2Int *active = nullptr) const;
 
   void compute_velocity(const IceModelVec2Stag &W,
                         const IceModelVec2S &P,
                         const IceModelVec2S &bed,
                         const IceModelVec2Stag &K,
                         const IceModelVec2Int *no_model_mask,
-                        IceModelVec2Stag &result) const;
+                        IceModelVec2Stag &result,
+                        const IceModelVec2Int *active = nullptr) const;
 
   void advective_fluxes(const IceModelVec2Stag &V,
                         const IceModelVec2S &W,
-                        IceModelVec2Stag &result) const;
+                        IceModelVec2Stag &result,
+                        const IceModelVec2Int *active = nullptr) const;
 
   void W_change_due_to_flow(double dt,
                             const IceModelVec2S    &W,
@@ -176,7 +201,127 @@ protected:
                     const IceModelVec2S &Wtill,
                     const IceModelVec2S &surface_input_rate,
                     const IceModelVec2S &basal_melt_rate,
-                    IceModelVec2S &Wtill_new);
+                    IceModelVec2S &Wtill_new,
+                    unsigned int width = 0);
+
+  // multirate time stepping (see hydrology.routing.multirate_ratio)
+  unsigned int m_multirate_ratio;
+
+  //! 0 in "slow" cells, 1 in slow cells next to "fast" ones, 2 in "fast" cells
+  IceModelVec2Int m_cell_mode;
+  //! bit 0 (1): the east interface is "fast", bit 1 (2): the north interface is "fast"
+  WorkArray2Mask m_edge_flags;
+  //! total water flux through cell interfaces
+  IceModelVec2Stag m_flux;
+  //! total water flux through cell interfaces at the beginning of a multirate step
+  IceModelVec2Stag m_flux_start;
+  //! time integral of the total water flux during a multirate step
+  IceModelVec2Stag m_flux_integral;
+
+  void total_flux(const IceModelVec2S    &W,
+                  const IceModelVec2Stag &Wstag,
+                  const IceModelVec2Stag &K,
+                  const IceModelVec2Stag &Q,
+                  IceModelVec2Stag &result,
+                  const IceModelVec2Int *active = nullptr) const;
+
+  void mark_fast_cells(double dt_slow);
+
+  void multirate_update(double dt, double scale, const IceModelVec2Stag &flux,
+                        bool fast, const Inputs &inputs);
+
+  unsigned int multirate_step(double dt_fast, double dt_slow, const Inputs &inputs);
+
+  // fused sub-step kernel (used if multirate time stepping is disabled)
+
+  //! edge-centered factor \f$|\nabla R|^{\beta-2}\f$ in the conductivity
+  WorkArray2R m_conductivity_factor;
+  //! edge-centered components of \f$-\nabla R\f$ (zero next to no_model_mask cells)
+  WorkArray2R m_potential_gradient;
+
+  void potential_terms(const IceModelVec2S &P, const IceModelVec2Int *no_model_mask);
+
+  void fused_edge(const IceModelVec2S &W, const IceModelVec2CellType &cell_type,
+                  int i, int j, int o,
+                  double &Ws, double &K, double &V, double &Q) const;
+
+  void fused_fluxes(const IceModelVec2S &W, const IceModelVec2CellType &cell_type,
+                    double &dt_cfl, double &dt_diff);
+
+  void fused_update_W(double dt,
+                      const IceModelVec2S &W,
+                      const IceModelVec2CellType &cell_type,
+                      const IceModelVec2S &Wtill,
+                      const IceModelVec2S &Wtill_new,
+                      const IceModelVec2S &surface_input_rate,
+                      const IceModelVec2S &basal_melt_rate,
+                      IceModelVec2S &W_new,
+                      unsigned int width = 0);
+
+  // communication-avoiding sub-steps (see hydrology.routing.steps_per_exchange)
+  unsigned int m_steps_per_exchange;
+
+  //! copies of fields used by fused sub-steps, with ghosts of width m_steps_per_exchange
+  struct WideHalo {
+    IceModelVec2S W, W_new, Wtill, Wtill_new, surface_input_rate, basal_melt_rate;
+    IceModelVec2CellType cell_type;
+    IceModelVec2Int no_model_mask;
+  };
+  WideHalo m_wide;
+
+  void wide_halo_update(double t, double dt, const Inputs &inputs);
+
+  // implicit (backward Euler) time stepping (see hydrology.routing.implicit.enabled)
+  bool m_implicit;
+  //! true if the conductivity is computed using W (and P) at the beginning of a step
+  bool m_implicit_lagged;
+
+  //! time step length and inputs used by residual evaluations
+  double m_implicit_dt;
+  const Inputs *m_implicit_inputs;
+
+  //! sub-steps, nonlinear and linear iterations and the wall-clock time of the current
+  //! update
+  SolverStats m_solver_stats;
+
+  // SNES solving for W; uses its own copy of the DM to avoid sharing callbacks
+  struct CallbackData {
+    DM da;
+    Routing *model;
+  };
+  CallbackData m_W_callback_data;
+  petsc::DM m_W_da;
+  petsc::SNES m_W_snes;
+  petsc::Vec m_W_solution;
+  //! ghosted copy of the current iterate (zero where water is removed by enforce_bounds())
+  IceModelVec2S m_W_implicit;
+
+  void create_implicit_solver(const IceModelVec2S &example, const std::string &prefix,
+                              DMDASNESFunction residual, void *ctx,
+                              petsc::DM &da, petsc::SNES &snes, petsc::Vec &solution);
+
+  void implicit_solve(::SNES snes, Vec solution, const std::string &name);
+
+  bool implicit_active(const IceModelVec2CellType &cell_type,
+                       const IceModelVec2Int *no_model_mask, int i, int j) const;
+
+  void implicit_edge(const IceModelVec2S &W, const IceModelVec2CellType &cell_type,
+                     int i, int j, int o, double &D, double &Q) const;
+
+  double implicit_flow_rate(const IceModelVec2S &W, const IceModelVec2CellType &cell_type,
+                            int i, int j) const;
+
+  void implicit_coefficients(const Inputs &inputs);
+
+  void implicit_W_residual(const double *const *x, double **F);
+
+  void implicit_W_step(double dt, const Inputs &inputs);
+
+  virtual void implicit_update(double t, double dt, const Inputs &inputs);
+
+  static PetscErrorCode W_residual_callback(DMDALocalInfo *info,
+                                            const double *const *x, double **F,
+                                            CallbackData *data);
 
 private:
   virtual void initialization_message() const;
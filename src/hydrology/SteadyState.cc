@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,12 +17,16 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <algorithm>            // std::max
+#include <cmath>                // std::abs
+
 #include "SteadyState.hh"
 
 #include "EmptyingProblem.hh"
 
 #include "pism/util/Time.hh"    // m_grid->ctx()->time()->current()
 #include "pism/util/Profiling.hh"
+#include "pism/util/pism_utilities.hh" // GlobalMax
 
 /* FIXMEs
  *
@@ -51,8 +55,27 @@ void SteadyState::initialization_message() const {
                  "* Initializing the \"steady state\" subglacial hydrology model ...\n");
 }
 
+/*!
+ * Compute the maximum absolute difference between `a` and `b`.
+ */
+static double max_difference(const IceModelVec2S &a, const IceModelVec2S &b) {
+  IceGrid::ConstPtr grid = a.grid();
+
+  IceModelVec::AccessList list{&a, &b};
+
+  double result = 0.0;
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    result = std::max(result, std::abs(a(i, j) - b(i, j)));
+  }
+
+  return GlobalMax(grid->com, result);
+}
+
 SteadyState::SteadyState(IceGrid::ConstPtr grid)
-  : NullTransport(grid) {
+  : NullTransport(grid),
+    m_input_rate_last(grid, "water_input_rate_last", WITHOUT_GHOSTS) {
 
   m_time_name = m_config->get_string("time.dimension_name") + "_hydrology_steady";
   m_t_last = m_grid->ctx()->time()->current();
@@ -60,6 +83,14 @@ SteadyState::SteadyState(IceGrid::ConstPtr grid)
   m_t_eps = 1.0;
   m_bootstrap = false;
 
+  m_incremental = m_config->get_flag("hydrology.steady.incremental.enabled");
+  m_potential_change_threshold = m_config->get_number("hydrology.steady.incremental.potential_change_threshold");
+  m_have_potential = false;
+  m_skipped_updates = 0;
+
+  m_input_rate_last.set_attrs("internal", "water input rate used during the last flux update",
+                              "m s-1", "m s-1", "", 0);
+
   m_emptying_problem.reset(new EmptyingProblem(grid));
 
   if (m_config->get_flag("hydrology.add_water_input_to_till_storage")) {
@@ -85,16 +116,44 @@ void SteadyState::update_impl(double t, double dt, const Inputs& inputs) {
   if (t >= t_next or std::abs(t_next - t) < m_t_eps or
       m_bootstrap) {
 
-    m_log->message(3, " Updating the steady-state subglacial water flux...\n");
+    bool
+      recompute_potential = true,
+      skip                = false;
+
+    if (m_incremental and m_have_potential and not m_bootstrap) {
+      double change = m_emptying_problem->potential_change(*inputs.geometry,
+                                                           inputs.no_model_mask);
 
-    m_grid->ctx()->profiling().begin("steady_emptying");
+      if (change < m_potential_change_threshold) {
+        recompute_potential = false;
+        // the flux depends on the input rate and the potential only
+        skip = max_difference(m_surface_input_rate, m_input_rate_last) == 0.0;
+      }
+
+      m_log->message(3, " Hydraulic potential changed by %f Pa since the last update.\n",
+                     change);
+    }
 
-    m_emptying_problem->update(*inputs.geometry,
-                               inputs.no_model_mask,
-                               m_surface_input_rate);
+    if (skip) {
+      m_log->message(3, " Skipping the update of the steady-state subglacial water flux...\n");
 
-    m_grid->ctx()->profiling().end("steady_emptying");
-    m_Q.copy_from(m_emptying_problem->flux());
+      m_skipped_updates += 1;
+    } else {
+      m_log->message(3, " Updating the steady-state subglacial water flux...\n");
+
+      m_grid->ctx()->profiling().begin("steady_emptying");
+
+      m_emptying_problem->update(*inputs.geometry,
+                                 inputs.no_model_mask,
+                                 m_surface_input_rate,
+                                 recompute_potential);
+
+      m_grid->ctx()->profiling().end("steady_emptying");
+      m_Q.copy_from(m_emptying_problem->flux());
+
+      m_input_rate_last.copy_from(m_surface_input_rate);
+      m_have_potential = true;
+    }
 
     m_t_last = t;
     m_bootstrap = false;
@@ -107,6 +166,39 @@ std::map<std::string, Diagnostic::Ptr> SteadyState::diagnostics_impl() const {
   return combine(m_emptying_problem->diagnostics(), hydro_diagnostics);
 }
 
+//! Number of water flux updates skipped because the potential and the input did not change.
+int SteadyState::skipped_updates() const {
+  return m_skipped_updates;
+}
+
+namespace diagnostics {
+
+//! Number of skipped steady-state water flux updates (see SteadyState::update_impl()).
+class SkippedFluxUpdates : public TSDiag<TSSnapshotDiagnostic, SteadyState> {
+public:
+  SkippedFluxUpdates(const SteadyState *m)
+    : TSDiag<TSSnapshotDiagnostic, SteadyState>(m, "steady_state_flux_skipped_updates") {
+
+    set_units("1", "1");
+    m_ts.variable().set_string("long_name",
+                               "number of skipped updates of the steady state subglacial water flux");
+    m_ts.variable().set_number("valid_min", 0.0);
+  }
+
+  double compute() {
+    return model->skipped_updates();
+  }
+};
+
+} // end of namespace diagnostics
+
+TSDiagnosticList SteadyState::ts_diagnostics_impl() const {
+  return {
+    {"steady_state_flux_skipped_updates",
+     TSDiagnostic::Ptr(new diagnostics::SkippedFluxUpdates(this))}
+  };
+}
+
 MaxTimestep SteadyState::max_timestep_impl(double t) const {
 
   // compute the maximum time step coming from the forcing (water input rate)
@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -36,6 +36,8 @@ public:
   SteadyState(IceGrid::ConstPtr g);
   virtual ~SteadyState();
 
+  int skipped_updates() const;
+
 protected:
   void initialization_message() const;
 
@@ -50,6 +52,7 @@ protected:
   void update_impl(double t, double dt, const Inputs& inputs);
 
   std::map<std::string, Diagnostic::Ptr> diagnostics_impl() const;
+  TSDiagnosticList ts_diagnostics_impl() const;
 
   MaxTimestep max_timestep_impl(double t) const;
   void define_model_state_impl(const File &output) const;
@@ -73,6 +76,17 @@ protected:
 
   //! Set to true in bootstrap_impl() if update_impl() has to bootstrap m_Q.
   bool m_bootstrap;
+
+  //! True if the hydraulic potential computed by m_emptying_problem can be re-used
+  bool m_incremental;
+  //! Maximum change in the hydraulic potential (Pa) that allows re-using it
+  double m_potential_change_threshold;
+  //! Set to true once m_emptying_problem has computed the hydraulic potential
+  bool m_have_potential;
+  //! Water input rate used during the last water flux update
+  IceModelVec2S m_input_rate_last;
+  //! Number of skipped water flux updates
+  int m_skipped_updates;
 };
 
 } // end of namespace hydrology
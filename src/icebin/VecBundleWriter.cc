@@ -4,6 +4,7 @@
 #include <pism/util/Time.hh>
 #include <pism/util/io/File.hh>
 #include <pism/util/io/io_helpers.hh>
+#include <pism/util/error_handling.hh>
 #include <pism/icebin/VecBundleWriter.hh>
 
 using namespace pism;
@@ -16,12 +17,17 @@ VecBundleWriter::VecBundleWriter(pism::IceGrid::Ptr _grid, std::string const &_f
     : m_grid(_grid), fname(_fname), vecs(_vecs) {
 }
 
+VecBundleWriter::~VecBundleWriter() {
+  // empty (m_file is closed by its destructor)
+}
+
 void VecBundleWriter::init() {
-  pism::File file(m_grid->com,
-                  fname,
-                  string_to_backend(m_grid->ctx()->config()->get_string("output.format")),
-                  PISM_READWRITE_MOVE,
-                  m_grid->ctx()->pio_iosys_id());
+  m_file.reset(new pism::File(m_grid->com,
+                              fname,
+                              string_to_backend(m_grid->ctx()->config()->get_string("output.format")),
+                              PISM_READWRITE_MOVE,
+                              m_grid->ctx()->pio_iosys_id()));
+  pism::File &file = *m_file;
 
   io::define_time(file,
                   m_grid->ctx()->config()->get_string("time.dimension_name"),
@@ -36,17 +42,29 @@ void VecBundleWriter::init() {
 
 /** Dump the value of the Vectors at curent PISM simulation time. */
 void VecBundleWriter::write(double time_s) {
-  pism::File file(m_grid->com,
-                  fname,
-                  string_to_backend(m_grid->ctx()->config()->get_string("output.format")),
-                  PISM_READWRITE, // append to file
-                  m_grid->ctx()->pio_iosys_id());
+  if (not m_file) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "VecBundleWriter: '%s' is not open (call init() first)",
+                                  fname.c_str());
+  }
+  pism::File &file = *m_file;
 
   io::append_time(file, m_grid->ctx()->config()->get_string("time.dimension_name"), time_s);
 
   for (pism::IceModelVec const *vec : vecs) {
     vec->write(file);
   }
+
+  // make data available to readers of this file between coupling intervals (this call
+  // does not block when using an asynchronous output format)
+  file.sync();
+}
+
+void VecBundleWriter::close() {
+  if (m_file) {
+    m_file->close();
+    m_file.reset();
+  }
 }
 
 } // end of namespace icebin
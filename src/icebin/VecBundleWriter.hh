@@ -7,26 +7,40 @@
 #include <pism/util/IceGrid.hh>
 // --------------------------------
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace pism {
+
+class File;
+
 namespace icebin {
 
 
-/** Sets up to easily write out a bundle of PISM variables to a file. */
+/** Sets up to easily write out a bundle of PISM variables to a file.
+
+The file stays open between calls of write(), so with an asynchronous
+output format (-o_format netcdf3_async) data are copied into staging
+buffers and written by a background thread while the model continues:
+vectors can be modified as soon as write() returns. */
 class VecBundleWriter {
   pism::IceGrid::ConstPtr m_grid;
   std::string const fname;                     // Name of the file to write
   std::vector<pism::IceModelVec const *> vecs; // The vectors we will write
+  std::unique_ptr<pism::File> m_file;          // Open in init(), closed in close()
 
 public:
   VecBundleWriter(pism::IceGrid::Ptr grid, std::string const &_fname, std::vector<pism::IceModelVec const *> &_vecs);
+  ~VecBundleWriter();
 
   void init();
 
   /** Dump the value of the Vectors at curent PISM simulation time. */
   void write(double time_s);
+
+  /** Close the file (waits for pending writes). */
+  void close();
 };
 } // end of namespace icebin
 } // end of namespace pism
@@ -19,6 +19,7 @@
 #include <cmath>
 #include <cstring>
 #include <algorithm>
+#include <map>
 #include <petscsys.h>
 
 #include "pism/pism_config.hh"
@@ -50,6 +51,7 @@
 #include "pism/util/pism_signal.h"
 #include "pism/util/Vars.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/TaskGraph.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/age/AgeModel.hh"
 #include "pism/energy/EnergyModel.hh"
@@ -74,7 +76,9 @@ IceModel::IceModel(IceGrid::Ptr g, Context::Ptr context)
     m_thickness_change(g),
     m_ts_times(new std::vector<double>()),
     m_extra_bounds("time_bounds", m_config->get_string("time.dimension_name"), m_sys),
-    m_timestamp("timestamp", m_config->get_string("time.dimension_name"), m_sys) {
+    m_timestamp("timestamp", m_config->get_string("time.dimension_name"), m_sys),
+    m_step_listener(nullptr),
+    m_step_listener_interval(1) {
 
   // time-independent info
   {
@@ -106,6 +110,8 @@ IceModel::IceModel(IceGrid::Ptr g, Context::Ptr context)
   m_save_snapshots = false;
   // Do not save time-series by default:
   m_save_extra     = false;
+  m_extra_interpolate = false;
+  m_extra_buffer_time = 0.0;
 
   m_fracture = nullptr;
 
@@ -154,6 +160,11 @@ void IceModel::reset_counters() {
   dt_TempAge       = 0.0;
   m_dt             = 0.0;
   m_skip_countdown = 0;
+  m_skipped_steps  = 0;
+  m_temperature_change_rate = -1.0;
+  m_step_counter            = 0;
+  m_update_at_depth_counter = 0;
+  m_3d_velocity_is_stale = false;
 
   m_timestep_hit_multiples_last_time = m_time->current();
 }
@@ -161,6 +172,13 @@ void IceModel::reset_counters() {
 
 IceModel::~IceModel() {
 
+  try {
+    // remove the extra file created in advance for a record that was not reached
+    discard_extra_file();
+  } catch (...) {
+    // destructors should not throw
+  }
+
   delete m_beddef;
 
   delete m_btu;
@@ -407,6 +425,17 @@ void IceModel::step(bool do_mass_continuity,
 
   const bool updateAtDepth  = (m_skip_countdown == 0);
 
+  // 3D velocities are used by the energy balance and age models; if neither is active,
+  // they may be updated only when they are written to an output file. This is always
+  // done if the stress balance model is "sliding only": then re-constructing 3D
+  // velocities later is cheap and gives the same result.
+  bool update_3d_velocity = updateAtDepth;
+  if (m_config->get_flag("stress_balance.on_demand_3d_velocity") or
+      m_stress_balance->sliding_only()) {
+    update_3d_velocity = updateAtDepth and (m_age_model != nullptr or
+                                            m_config->get_flag("energy.enabled"));
+  }
+
   // Combine basal melt rate in grounded (computed during the energy
   // step) and floating (provided by an ocean model) areas.
   //
@@ -421,8 +450,14 @@ void IceModel::step(bool do_mass_continuity,
 
   try {
     profiling.begin("stress_balance");
-    m_stress_balance->update(stress_balance_inputs(), updateAtDepth);
+    m_stress_balance->update(stress_balance_inputs(), updateAtDepth, update_3d_velocity);
     profiling.end("stress_balance");
+
+    if (update_3d_velocity) {
+      m_3d_velocity_is_stale = false;
+    } else if (updateAtDepth) {
+      m_3d_velocity_is_stale = true;
+    }
   } catch (RuntimeError &e) {
     std::string output_file = m_config->get_string("output.file_name");
 
@@ -470,13 +505,18 @@ void IceModel::step(bool do_mass_continuity,
 
   dt_TempAge += m_dt;
 
-  //! \li update the age of the ice (if appropriate)
-  if (m_age_model and updateAtDepth) {
+  //! \li update the age of the ice (if appropriate; the energy model may update age
+  //! instead, see EnergyModel::set_age_model())
+  if (m_age_model and updateAtDepth and m_energy_model->updates_age()) {
+    // age is updated during the energy step below
+    m_stdout_flags += "a";
+  } else if (m_age_model and updateAtDepth) {
     AgeModelInputs inputs;
     inputs.ice_thickness = &m_geometry.ice_thickness;
     inputs.u3            = &m_stress_balance->velocity_u();
     inputs.v3            = &m_stress_balance->velocity_v();
     inputs.w3            = &m_stress_balance->velocity_w();
+    inputs.cell_type     = &m_geometry.cell_type;
 
     profiling.begin("age");
     m_age_model->update(current_time, dt_TempAge, inputs);
@@ -494,6 +534,13 @@ void IceModel::step(bool do_mass_continuity,
     energy_step();
     profiling.end("energy");
     m_stdout_flags += "E";
+
+    if (m_config->get_flag("time_stepping.skip.adaptive") and dt_TempAge > 0.0) {
+      const double c = m_config->get_number("constants.ice.specific_heat_capacity");
+
+      m_temperature_change_rate = (m_energy_model->stats().max_enthalpy_change /
+                                   (c * dt_TempAge));
+    }
   } else {
     m_stdout_flags += "$";
   }
@@ -574,6 +621,8 @@ void IceModel::step(bool do_mass_continuity,
   if (do_mass_continuity) {
     // compute and apply effective surface and basal mass balance
 
+    Profiling::Scope scope(profiling, "mass_balance");
+
     m_geometry_evolution->source_term_step(m_geometry, m_dt,
                                            thickness_bc_mask,
                                            m_surface->mass_flux(),
@@ -642,9 +691,15 @@ void IceModel::step(bool do_mass_continuity,
   // Done with the step; now adopt the new time.
   m_time->step(m_dt);
 
+  m_step_counter += 1;
   if (updateAtDepth) {
     t_TempAge  = m_time->current();
     dt_TempAge = 0.0;
+
+    m_skipped_steps = 0;
+    m_update_at_depth_counter += 1;
+  } else {
+    m_skipped_steps += 1;
   }
 
   // Check if the ice thickness exceeded the height of the computational box and stop if it did.
@@ -742,6 +797,62 @@ void IceModel::run_to(double run_end) {
   run();
 }
 
+StepListener::~StepListener() {
+  // empty
+}
+
+/*!
+ * Run to `time`, calling `listener.after_steps()` every `interval` time steps and after
+ * the last step.
+ *
+ * This allows coupling code to exchange data with PISM (or start its own work) without
+ * returning to the caller after each short run_to() call.
+ */
+void IceModel::run_with_listener(double time, StepListener &listener,
+                                 unsigned int interval) {
+  if (interval == 0) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "the listener interval has to be positive");
+  }
+
+  m_step_listener          = &listener;
+  m_step_listener_interval = interval;
+
+  try {
+    run_to(time);
+  } catch (...) {
+    m_step_listener = nullptr;
+    throw;
+  }
+
+  m_step_listener = nullptr;
+}
+
+
+/*!
+ * Add stages of IceModel::step() to `graph`.
+ *
+ * A stage depends on stages computing its inputs and on stages reading fields it
+ * modifies. For example, the age and energy models use the same velocity field but do not
+ * depend on each other, while mass transport has to wait for all models using the ice
+ * geometry at the beginning of the step.
+ */
+static void add_step_tasks(TaskGraph &graph) {
+  graph.add("stress_balance", {});
+  graph.add("basal_yield_stress", {"stress_balance"});
+  graph.add("age", {"stress_balance"});
+  graph.add("energy", {"stress_balance"});
+  graph.add("fracture_density", {"stress_balance"});
+  graph.add("mass_transport", {"stress_balance", "basal_yield_stress", "age", "energy",
+                               "fracture_density"});
+  graph.add("front_retreat", {"mass_transport"});
+  graph.add("sea_level", {"front_retreat"});
+  graph.add("ocean", {"sea_level"});
+  graph.add("surface", {"sea_level"});
+  graph.add("mass_balance", {"ocean", "surface"});
+  graph.add("basal_hydrology", {"mass_balance"});
+  // the bed deformation model updates its own copy of the bed elevation
+  graph.add("bed_deformation", {"mass_balance"});
+}
 
 /**
  * Run the time-stepping loop from the current time until the time
@@ -757,6 +868,7 @@ void IceModel::run() {
   bool do_skip = m_config->get_flag("time_stepping.skip.enabled");
 
   int stepcount = m_config->get_flag("time_stepping.count_steps") ? 0 : -1;
+  const int max_steps = m_config->get_number("time_stepping.maximum_steps");
 
   // de-allocate diagnostics that are not needed
   prune_diagnostics();
@@ -773,9 +885,7 @@ void IceModel::run() {
   // This is needed to compute rates of change of the ice mass, volume, etc.
   {
     const double time = m_time->current();
-    for (auto d : m_ts_diagnostics) {
-      d.second->update(time, time);
-    }
+    update_ts_diagnostics(time, time);
   }
 
   m_log->message(2, "running forward ...\n");
@@ -788,6 +898,12 @@ void IceModel::run() {
   t_TempAge = m_time->current();
   dt_TempAge = 0.0;
 
+  m_step_counter            = 0;
+  m_update_at_depth_counter = 0;
+
+  TaskGraph step_graph(profiling);
+  add_step_tasks(step_graph);
+
   // main loop for time evolution
   // IceModel::step calls Time::step(dt), ensuring that this while loop
   // will terminate
@@ -796,9 +912,15 @@ void IceModel::run() {
 
     m_stdout_flags.erase();  // clear it out
 
+    profiling.begin("step");
     step(do_mass_conserve, do_skip);
+    profiling.end("step");
+
+    step_graph.update();
 
+    profiling.begin("diagnostics");
     update_diagnostics(m_dt);
+    profiling.end("diagnostics");
 
     // report a summary for major steps or the last one
     bool updateAtDepth = m_skip_countdown == 0;
@@ -817,16 +939,47 @@ void IceModel::run() {
     write_backup();
     profiling.end("io");
 
+    if (m_step_listener != nullptr and m_step_counter % m_step_listener_interval == 0) {
+      m_step_listener->after_steps(m_time->current(), m_step_counter);
+    }
+
     if (stepcount >= 0) {
       stepcount++;
     }
     if (process_signals() != 0) {
       break;
     }
+
+    if (max_steps > 0 and (int)m_step_counter >= max_steps) {
+      m_log->message(2, "Reached the maximum number of time steps (%d). Stopping...\n",
+                     max_steps);
+      break;
+    }
   } // end of the time-stepping loop
 
   profiling.stage_end("time-stepping loop");
 
+  if (m_step_listener != nullptr and m_step_counter % m_step_listener_interval != 0) {
+    // report the state after the last (incomplete) batch of steps
+    m_step_listener->after_steps(m_time->current(), m_step_counter);
+  }
+
+  if (do_skip) {
+    m_log->message(2,
+                   "energy, age, and SSA were updated during %d of %d time steps\n",
+                   m_update_at_depth_counter, m_step_counter);
+  }
+
+  {
+    double
+      total         = GlobalMax(m_grid->com, step_graph.total_time()),
+      critical_path = GlobalMax(m_grid->com, step_graph.critical_path_time());
+
+    m_log->message(2,
+                   "time spent in sub-models: %.1f s; critical path: %.1f s (%s)\n",
+                   total, critical_path, join(step_graph.critical_path(), " -> ").c_str());
+  }
+
   if (stepcount >= 0) {
     m_log->message(1,
                "count_time_steps:  run() took %d steps\n"
@@ -836,10 +989,59 @@ void IceModel::run() {
   }
 }
 
+typedef std::map<std::string, std::vector<Profiling::RegionSummary> > RegionTree;
+
+static void print_regions(const Logger &log, const RegionTree &children,
+                          const std::string &parent, double total, int depth) {
+  auto c = children.find(parent);
+  if (c == children.end()) {
+    return;
+  }
+
+  for (const auto &r : c->second) {
+    log.message(2, "  %*s%-*s %9.3f s %5.1f%%\n",
+                2 * depth, "", 36 - 2 * depth, r.name.c_str(),
+                r.time_max, total > 0.0 ? 100.0 * r.time_max / total : 0.0);
+    print_regions(log, children, r.name, total, depth + 1);
+  }
+}
+
+/*!
+ * Print wall-clock times (maximum over processes) of profiling regions nested in
+ * `region`, longest first.
+ *
+ * Collective.
+ */
+static void print_startup_profile(MPI_Comm com, const Profiling &profiling,
+                                  const Logger &log, const std::string &region) {
+  RegionTree children;
+  double total = 0.0;
+  for (const auto &r : profiling.summary(com)) {
+    if (r.name == region) {
+      total = r.time_max;
+    }
+    children[r.parent].push_back(r);
+  }
+
+  for (auto &c : children) {
+    std::sort(c.second.begin(), c.second.end(),
+              [](const Profiling::RegionSummary &a, const Profiling::RegionSummary &b) {
+                return a.time_max > b.time_max;
+              });
+  }
+
+  log.message(2, "Startup profile (wall-clock time, maximum over processes):\n");
+  print_regions(log, children, region, total, 0);
+  log.message(2, "  %-36s %9.3f s\n", "total", total);
+}
+
 //! Manage the initialization of the IceModel object.
 /*!
 Please see the documenting comments of the functions called below to find
 explanations of their intended uses.
+
+Each stage is a profiling region; set `output.startup_profile` to print the time spent
+in each one.
  */
 void IceModel::init() {
   // Get the start time in seconds and ensure that it is consistent
@@ -853,21 +1055,31 @@ void IceModel::init() {
   //! The IceModel initialization sequence is this:
 
   //! 1) Initialize model time:
+  profiling.begin("init_time");
   time_setup();
+  profiling.end("init_time");
 
   //! 2) Process the options:
+  profiling.begin("init_options");
   process_options();
+  profiling.end("init_options");
 
   //! 3) Memory allocation:
+  profiling.begin("init_storage");
   allocate_storage();
+  profiling.end("init_storage");
 
   //! 4) Allocate PISM components modeling some physical processes.
+  profiling.begin("init_submodels");
   allocate_submodels();
+  profiling.end("init_submodels");
 
   //! 6) Initialize coupler models and fill the model state variables
   //! (from a PISM output file, from a bootstrapping file using some
   //! modeling choices or using formulas). Calls IceModel::regrid()
+  profiling.begin("init_model_state");
   model_state_setup();
+  profiling.end("init_model_state");
 
   //! 7) Report grid parameters:
   m_grid->report_parameters();
@@ -875,9 +1087,15 @@ void IceModel::init() {
   //! 8) Miscellaneous stuff: set up the bed deformation model, initialize the
   //! basal till model, initialize snapshots. This has to happen *after*
   //! regridding.
+  profiling.begin("init_misc");
   misc_setup();
+  profiling.end("init_misc");
 
   profiling.end("initialization");
+
+  if (m_config->get_flag("output.startup_profile")) {
+    print_startup_profile(m_grid->com, profiling, *m_log, "initialization");
+  }
 }
 
 const Geometry& IceModel::geometry() const {
@@ -888,6 +1106,11 @@ const GeometryEvolution& IceModel::geometry_evolution() const {
   return *m_geometry_evolution;
 }
 
+//! Totals used by scalar diagnostics (valid while these diagnostics are updated).
+const GeometryTotals& IceModel::geometry_totals() const {
+  return m_geometry_totals;
+}
+
 const stressbalance::StressBalance* IceModel::stress_balance() const {
   return this->m_stress_balance.get();
 }
@@ -967,20 +1190,34 @@ void warn_about_missing(const Logger &log,
 }
 
 /*!
- * De-allocate diagnostics that were not requested.
+ * Names of spatially-variable diagnostics requested using viewers, -extra_vars, -backup,
+ * -save_vars, and regular output.
  *
- * Checks viewers, -extra_vars, -backup, -save_vars, and regular output.
+ * Call this after init_snapshots(), init_backups(), and init_extras().
  *
  * FIXME: I need to make sure that these reporting mechanisms are active. It is possible that
  * variables are on a list, but that list is not actually used.
  */
+std::set<std::string> IceModel::requested_diagnostics() const {
+  auto result = set_split(m_config->get_string("output.runtime.viewer.variables"), ',');
+  result = combine(result, m_output_vars);
+  result = combine(result, m_snapshot_vars);
+  result = combine(result, m_extra_vars);
+  result = combine(result, m_backup_vars);
+
+  return result;
+}
+
+/*!
+ * De-allocate diagnostics that were not requested.
+ *
+ * Diagnostics provided by IceModel are allocated only if requested (see
+ * init_diagnostics()), so this mostly reports missing diagnostics and selects scalar
+ * diagnostics.
+ */
 void IceModel::prune_diagnostics() {
 
-  // get the list of available diagnostics
-  std::set<std::string> available;
-  for (auto d : m_diagnostics) {
-    available.insert(d.first);
-  }
+  const auto &available = m_available_diagnostics;
 
   auto m_extra_stop = m_config->get_flag("output.extra.stop_missing");
   warn_about_missing(*m_log, m_output_vars,   "output",     available, false);
@@ -988,24 +1225,28 @@ void IceModel::prune_diagnostics() {
   warn_about_missing(*m_log, m_backup_vars,   "backup",     available, false);
   warn_about_missing(*m_log, m_extra_vars,    "diagnostic", available, m_extra_stop);
 
-  // get the list of requested diagnostics
-  auto requested = set_split(m_config->get_string("output.runtime.viewer.variables"), ',');
-  requested = combine(requested, m_output_vars);
-  requested = combine(requested, m_snapshot_vars);
-  requested = combine(requested, m_extra_vars);
-  requested = combine(requested, m_backup_vars);
-
   // de-allocate diagnostics that were not requested
-  for (auto v : available) {
-    if (requested.find(v) == requested.end()) {
-      m_diagnostics.erase(v);
+  auto requested = requested_diagnostics();
+  for (auto d = m_diagnostics.begin(); d != m_diagnostics.end();) {
+    if (requested.find(d->first) == requested.end()) {
+      d = m_diagnostics.erase(d);
+    } else {
+      ++d;
     }
   }
 
   // scalar time series
   std::vector<std::string> missing;
   if (not m_ts_filename.empty() and m_ts_vars.empty()) {
-    // use all diagnostics
+    // use all diagnostics except for performance metrics (they are not reproducible; see
+    // output.timeseries.performance_variables)
+    for (auto d = m_ts_diagnostics.begin(); d != m_ts_diagnostics.end();) {
+      if (d->first.find("perf_") == 0) {
+        d = m_ts_diagnostics.erase(d);
+      } else {
+        ++d;
+      }
+    }
   } else {
     TSDiagnosticList diagnostics;
     for (auto v : m_ts_vars) {
@@ -1024,6 +1265,8 @@ void IceModel::prune_diagnostics() {
                                   "requested scalar diagnostics %s are not available",
                                   join(missing, ",").c_str());
   }
+
+  share_diagnostic_accumulators();
 }
 
 /*!
@@ -1034,13 +1277,39 @@ void IceModel::prune_diagnostics() {
  * Call this after prune_diagnostics() to avoid unnecessary work.
  */
 void IceModel::update_diagnostics(double dt) {
+  // ISMIP6 aliases map several names to the same diagnostic: update each one once
+  std::set<const Diagnostic*> updated;
   for (auto d : m_diagnostics) {
-    d.second->update(dt);
+    if (updated.insert(d.second.get()).second) {
+      d.second->update(dt);
+    }
   }
 
   const double time = m_time->current();
+  update_ts_diagnostics(time - dt, time);
+}
+
+/*!
+ * Update scalar diagnostics, computing totals used by several of them (ice volume, area,
+ * etc) using one pass over the grid.
+ */
+void IceModel::update_ts_diagnostics(double t0, double t1) {
+  if (m_ts_diagnostics.empty()) {
+    return;
+  }
+
+  m_geometry_totals = pism::geometry_totals(m_geometry,
+                                            m_config->get_number("output.ice_free_thickness_standard"));
+
+  size_t buffered = 0;
   for (auto d : m_ts_diagnostics) {
-    d.second->update(time - dt, time);
+    d.second->update(t0, t1);
+    buffered = std::max(buffered, d.second->buffered_records());
+  }
+
+  // write all the time-series at once when buffers are full
+  if (buffered >= (size_t)m_config->get_number("output.timeseries.buffer_size")) {
+    flush_timeseries();
   }
 }
 
@@ -103,6 +103,29 @@ class IceModelVec2T;
 class Component;
 class FrontRetreat;
 class PrescribedRetreat;
+class RegriddingSource;
+
+namespace io {
+class DeltaEncoder;
+}
+
+//! Interface of objects notified by IceModel::run_with_listener() every few time steps.
+/*!
+ * Use this to couple PISM to other models. Python code can implement it using a derived
+ * class (the Python bindings release the GIL while PISM is running, so Python threads
+ * started by a listener run concurrently with PISM's time stepping).
+ */
+class StepListener {
+public:
+  virtual ~StepListener();
+
+  //! Called every `interval` time steps and after the last step.
+  /*!
+   * @param[in] time current model time, in seconds
+   * @param[in] step_counter number of steps taken since the beginning of the run
+   */
+  virtual void after_steps(double time, unsigned int step_counter) = 0;
+};
 
 //! The base class for PISM. Contains all essential variables, parameters, and flags for modelling
 //! an ice sheet.
@@ -124,13 +147,20 @@ public:
   /** Advance the current PISM run to a specific time */
   virtual void run_to(double time);
 
+  /** Advance to `time`, calling `listener` every `interval` time steps */
+  void run_with_listener(double time, StepListener &listener, unsigned int interval);
+
   virtual void save_results();
 
-  void list_diagnostics() const;
-  void list_diagnostics_json() const;
+  void save_checkpoint(const std::string &filename);
+
+  void list_diagnostics();
+  void list_diagnostics_json();
   std::map<std::string, std::vector<VariableMetadata>> describe_diagnostics() const;
   std::map<std::string, std::vector<VariableMetadata>> describe_ts_diagnostics() const;
 
+  std::shared_ptr<const RegriddingSource> regridding_source() const;
+
   const IceModelVec2S &calving() const;
   const IceModelVec2S &frontal_melt() const;
   const IceModelVec2S &forced_retreat() const;
@@ -149,6 +179,7 @@ public:
 
   const Geometry& geometry() const;
   const GeometryEvolution& geometry_evolution() const;
+  const GeometryTotals& geometry_totals() const;
 
   double dt() const;
 
@@ -175,11 +206,18 @@ protected:
   virtual void model_state_setup();
   virtual void misc_setup();
   virtual void init_diagnostics();
+  virtual DiagnosticFactoryList diagnostic_factories();
+  virtual TSDiagnosticFactoryList ts_diagnostic_factories();
+  std::set<std::string> requested_diagnostics() const;
+  std::set<std::string> requested_ts_diagnostics(bool &all) const;
+  void all_diagnostics(DiagnosticList &result, TSDiagnosticList &ts_result);
   virtual void init_calving();
   virtual void init_frontal_melt();
   virtual void init_front_retreat();
   virtual void prune_diagnostics();
+  void share_diagnostic_accumulators();
   virtual void update_diagnostics(double dt);
+  virtual void update_ts_diagnostics(double t0, double t1);
   virtual void reset_diagnostics();
 
   virtual void step(bool do_mass_continuity, bool do_skip);
@@ -206,7 +244,8 @@ protected:
                               OutputKind kind,
                               const std::set<std::string> &variables,
                               double time,
-                              IO_Type default_diagnostics_type = PISM_FLOAT);
+                              IO_Type default_diagnostics_type = PISM_FLOAT,
+                              IceGrid::ConstPtr output_grid = nullptr);
 
   virtual void define_model_state(const File &file);
   virtual void write_model_state(const File &file);
@@ -225,6 +264,10 @@ protected:
                                   IO_Type default_type);
   virtual void write_diagnostics(const File &file,
                                  const std::set<std::string> &variables);
+  virtual void write_coarsened_diagnostics(const File &file,
+                                           const std::set<std::string> &variables,
+                                           IceGrid::ConstPtr output_grid,
+                                           IO_Type default_type);
 
   //! Computational grid
   const IceGrid::Ptr m_grid;
@@ -304,6 +347,18 @@ protected:
   double dt_TempAge;
 
   unsigned int m_skip_countdown;
+  //! number of consecutive steps that skipped energy and age updates
+  unsigned int m_skipped_steps;
+  //! estimated maximum rate of change of ice temperature, K s-1 (used if
+  //! time_stepping.skip.adaptive is set; negative if unknown)
+  double m_temperature_change_rate;
+  //! numbers of time steps and energy and age updates during run()
+  unsigned int m_step_counter;
+  unsigned int m_update_at_depth_counter;
+
+  //! true if 3D velocities were not updated during the last "full" stress balance update
+  //! (see stress_balance.on_demand_3d_velocity)
+  bool m_3d_velocity_is_stale;
 
   std::string m_adaptive_timestep_reason;
 
@@ -315,6 +370,7 @@ protected:
   virtual MaxTimestep max_timestep_diffusivity();
   virtual void max_timestep(double &dt_result, unsigned int &skip_counter);
   virtual unsigned int skip_counter(double input_dt, double input_dt_diffusivity);
+  virtual unsigned int adaptive_skip_counter(double dt, unsigned int skip_counter);
 
   // see energy.cc
   virtual void bedrock_thermal_model_step();
@@ -389,6 +445,10 @@ protected:
   std::map<std::string,Diagnostic::Ptr> m_diagnostics;
   //! Requested scalar diagnostics.
   std::map<std::string,TSDiagnostic::Ptr> m_ts_diagnostics;
+  //! Names of all available spatially-variable diagnostics.
+  std::set<std::string> m_available_diagnostics;
+  //! Totals used by scalar diagnostics, updated before they are evaluated.
+  GeometryTotals m_geometry_totals;
 
   // Set of variables to put in the output file:
   std::set<std::string> m_output_vars;
@@ -421,16 +481,36 @@ protected:
   std::set<std::string> m_extra_vars;
   TimeBoundsMetadata m_extra_bounds;
   std::unique_ptr<File> m_extra_file;
+  //! coarse grid used to write the extra file (null if output.extra.coarsening_factor is 1)
+  IceGrid::Ptr m_extra_grid;
+  //! true if spatial time-series are interpolated in time (see output.extra.interpolate)
+  bool m_extra_interpolate;
+  //! requested diagnostics computed at the end of the previous time step (used to
+  //! interpolate in time)
+  std::map<std::string, IceModelVec::Ptr> m_extra_buffer;
+  //! model time corresponding to m_extra_buffer
+  double m_extra_buffer_time;
   void init_extras();
   void write_extras();
+  void write_extra_record(double time, double weight);
+  void write_interpolated_extras();
+  void write_interpolated_diagnostics(const File &file, double weight);
+  void buffer_extras();
+  void prepare_extra_file(const std::string &filename, IO_Mode mode);
+  void discard_extra_file();
   MaxTimestep extras_max_timestep(double my_t);
 
   // automatic backups
   std::string m_backup_filename;
   double m_last_backup_time;
   std::set<std::string> m_backup_vars;
+  //! differences from the last full backup (see `output.backup_deltas`)
+  std::shared_ptr<io::DeltaEncoder> m_backup_delta;
+  int m_backup_delta_count;
   void init_backups();
   void write_backup();
+  void write_backup_file(const std::string &filename,
+                         std::shared_ptr<io::DeltaEncoder> encoder);
 
   // last time at which PISM hit a multiple of X years, see the configuration parameter
   // time_stepping.hit_multiples
@@ -444,6 +524,10 @@ protected:
 private:
   TimeseriesMetadata m_timestamp;
   double m_start_time;    // this is used in the wall-clock-time backup code
+
+  //! listener notified by run() (set by run_with_listener())
+  StepListener *m_step_listener;
+  unsigned int m_step_listener_interval;
 };
 
 MaxTimestep reporting_max_timestep(const std::vector<double> &times, double t,
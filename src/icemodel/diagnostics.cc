@@ -18,7 +18,7 @@
 
 #include <cassert>
 #include <algorithm>
-
+#include <typeindex>
 #include "pism/icemodel/IceModel.hh"
 #include "pism/age/AgeModel.hh"
 #include "pism/energy/EnergyModel.hh"
@@ -31,6 +31,8 @@
 #include "pism/stressbalance/ShallowStressBalance.hh"
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/util/Diagnostic.hh"
+#include "pism/util/Profiling.hh"
+#include "pism/util/MemoryTracker.hh"
 #include "pism/util/Vars.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/iceModelVec3Custom.hh"
@@ -363,6 +365,9 @@ IceModelVec::Ptr Temperature::compute_impl() const {
   double *Tij;
   const double *Enthij; // columns of these values
 
+  const unsigned int Mz = m_grid->Mz();
+  std::vector<double> P(Mz);     // pressure in a column
+
   IceModelVec::AccessList list{result.get(), &enthalpy, &thickness};
 
   ParallelSection loop(m_grid->com);
@@ -372,10 +377,11 @@ IceModelVec::Ptr Temperature::compute_impl() const {
 
       Tij = result->get_column(i,j);
       Enthij = enthalpy.get_column(i,j);
-      for (unsigned int k=0; k <m_grid->Mz(); ++k) {
+      for (unsigned int k=0; k < Mz; ++k) {
         const double depth = thickness(i,j) - m_grid->z(k);
-        Tij[k] = EC->temperature(Enthij[k], EC->pressure(depth));
+        P[k] = EC->pressure(depth);
       }
+      EC->temperature(Enthij, P.data(), Mz, Tij);
     }
   } catch (...) {
     loop.failed();
@@ -975,8 +981,7 @@ public:
     m_ts.variable().set_number("valid_min", 0.0);
   }
   double compute() {
-    return ice_volume(model->geometry(),
-                      m_config->get_number("output.ice_free_thickness_standard"));
+    return model->geometry_totals().volume_glacierized;
   }
 };
 
@@ -993,7 +998,7 @@ public:
   }
 
   double compute() {
-    return ice_volume(model->geometry(), 0.0);
+    return model->geometry_totals().volume;
   }
 };
 
@@ -1010,8 +1015,14 @@ public:
   }
 
   double compute() {
-    return sea_level_rise_potential(model->geometry(),
-                                    m_config->get_number("output.ice_free_thickness_standard"));
+    const double
+      water_density = m_config->get_number("constants.fresh_water.density"),
+      ice_density   = m_config->get_number("constants.ice.density"),
+      ocean_area    = m_config->get_number("constants.global_ocean_area"),
+      volume        = model->geometry_totals().volume_not_displacing_seawater;
+
+    // see sea_level_rise_potential()
+    return (ice_density / water_density) * volume / ocean_area;
   }
 };
 
@@ -1027,8 +1038,7 @@ public:
   }
 
   double compute() {
-    return ice_volume(model->geometry(),
-                      m_config->get_number("output.ice_free_thickness_standard"));
+    return model->geometry_totals().volume_glacierized;
   }
 };
 
@@ -1045,7 +1055,7 @@ public:
   }
 
   double compute() {
-    return ice_volume(model->geometry(), 0.0);
+    return model->geometry_totals().volume;
   }
 };
 
@@ -1062,7 +1072,7 @@ public:
   }
 
   double compute() {
-    return ice_area(model->geometry(), m_config->get_number("output.ice_free_thickness_standard"));
+    return model->geometry_totals().area_glacierized;
   }
 };
 
@@ -1082,11 +1092,9 @@ public:
   double compute() {
 
     const double
-      thickness_standard = m_config->get_number("output.ice_free_thickness_standard"),
-      ice_density        = m_config->get_number("constants.ice.density"),
-      ice_volume         = ice_volume_not_displacing_seawater(model->geometry(),
-                                                              thickness_standard),
-      ice_mass           = ice_volume * ice_density;
+      ice_density = m_config->get_number("constants.ice.density"),
+      ice_volume  = model->geometry_totals().volume_not_displacing_seawater,
+      ice_mass    = ice_volume * ice_density;
 
     return ice_mass;
   }
@@ -1105,10 +1113,8 @@ public:
   }
 
   double compute() {
-    double
-      ice_density        = m_config->get_number("constants.ice.density"),
-      thickness_standard = m_config->get_number("output.ice_free_thickness_standard");
-    return ice_volume(model->geometry(), thickness_standard) * ice_density;
+    const double ice_density = m_config->get_number("constants.ice.density");
+    return model->geometry_totals().volume_glacierized * ice_density;
   }
 };
 
@@ -1130,7 +1136,7 @@ public:
   }
 
   double compute() {
-    return (ice_volume(model->geometry(), 0.0) *
+    return (model->geometry_totals().volume *
             m_config->get_number("constants.ice.density"));
   }
 };
@@ -1147,10 +1153,8 @@ public:
   }
 
   double compute() {
-    double
-      ice_density         = m_config->get_number("constants.ice.density"),
-      thickness_threshold = m_config->get_number("output.ice_free_thickness_standard");
-    return ice_volume(model->geometry(), thickness_threshold) * ice_density;
+    const double ice_density = m_config->get_number("constants.ice.density");
+    return model->geometry_totals().volume_glacierized * ice_density;
   }
 };
 
@@ -1209,7 +1213,7 @@ public:
 
   double compute() {
     const double ice_density = m_config->get_number("constants.ice.density");
-    return ice_volume(model->geometry(), 0.0) * ice_density;
+    return model->geometry_totals().volume * ice_density;
   }
 };
 
@@ -1372,8 +1376,7 @@ public:
   }
 
   double compute() {
-    return ice_area_grounded(model->geometry(),
-                             m_config->get_number("output.ice_free_thickness_standard"));
+    return model->geometry_totals().area_glacierized_grounded;
   }
 };
 
@@ -1395,8 +1398,7 @@ public:
   }
 
   double compute() {
-    return ice_area_floating(model->geometry(),
-                             m_config->get_number("output.ice_free_thickness_standard"));
+    return model->geometry_totals().area_glacierized_floating;
   }
 };
 
@@ -1413,28 +1415,7 @@ public:
   }
 
   double compute() {
-    const IceModelVec2CellType &cell_type = model->geometry().cell_type;
-
-    const IceModelVec2S &ice_thickness = model->geometry().ice_thickness;
-
-    const double
-      thickness_threshold = m_config->get_number("output.ice_free_thickness_standard"),
-      cell_area           = m_grid->cell_area();
-
-    IceModelVec::AccessList list{&ice_thickness, &cell_type};
-
-    double volume = 0.0;
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-
-      const double H = ice_thickness(i, j);
-
-      if (cell_type.grounded(i, j) and H >= thickness_threshold) {
-        volume += cell_area * H;
-      }
-    }
-
-    return GlobalSum(m_grid->com, volume);
+    return model->geometry_totals().volume_glacierized_grounded;
   }
 };
 
@@ -1451,28 +1432,7 @@ public:
   }
 
   double compute() {
-    const IceModelVec2CellType &cell_type = model->geometry().cell_type;
-
-    const IceModelVec2S &ice_thickness = model->geometry().ice_thickness;
-
-    const double
-      thickness_threshold = m_config->get_number("output.ice_free_thickness_standard"),
-      cell_area           = m_grid->cell_area();
-
-    IceModelVec::AccessList list{&ice_thickness, &cell_type};
-
-    double volume = 0.0;
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-
-      const double H = ice_thickness(i, j);
-
-      if (cell_type.ocean(i, j) and H >= thickness_threshold) {
-        volume += cell_area * H;
-      }
-    }
-
-    return GlobalSum(m_grid->com, volume);
+    return model->geometry_totals().volume_glacierized_floating;
   }
 };
 
@@ -1541,6 +1501,114 @@ public:
   }
 };
 
+//! \brief Reports the wall-clock time spent in a profiling region (see Profiling::region()).
+/*!
+ * Averaged over reporting intervals, i.e. this is the wall-clock time per unit of model
+ * time. Uses the maximum over all processes of the time spent during each time step.
+ *
+ * If `region` is empty, reports the total wall-clock time.
+ */
+class PerfWallClockTime : public TSDiag<TSFluxDiagnostic, IceModel>
+{
+public:
+  PerfWallClockTime(const IceModel *m, const std::string &name, const std::string &region,
+                    const std::string &long_name)
+    : TSDiag<TSFluxDiagnostic, IceModel>(m, name),
+      m_region(region.empty() ? -1 : m->ctx()->profiling().region(region.c_str())) {
+
+    m_last_value = current_value();
+
+    set_units("s s-1", "s year-1");
+    m_ts.variable().set_string("long_name", long_name);
+    m_ts.variable().set_string("comment", "wall-clock time per unit of model time");
+    m_ts.variable().set_number("valid_min", 0.0);
+  }
+
+  double compute() {
+    double
+      value  = current_value(),
+      change = value - m_last_value;
+
+    m_last_value = value;
+
+    return GlobalMax(m_grid->com, change);
+  }
+private:
+  double current_value() const {
+    return m_region >= 0 ? model->ctx()->profiling().time(m_region) : MPI_Wtime();
+  }
+
+  int m_region;
+  double m_last_value;
+};
+
+//! \brief Reports the number of time steps, averaged over reporting intervals.
+class PerfTimeSteps : public TSDiag<TSFluxDiagnostic, IceModel>
+{
+public:
+  PerfTimeSteps(const IceModel *m)
+    : TSDiag<TSFluxDiagnostic, IceModel>(m, "perf_time_steps") {
+
+    set_units("s-1", "year-1");
+    m_ts.variable().set_string("long_name", "number of time steps per unit of model time");
+    m_ts.variable().set_number("valid_min", 0.0);
+  }
+
+  double compute() {
+    return 1.0;
+  }
+};
+
+//! \brief Reports the number of iterations used by the shallow stress balance solver.
+class PerfStressBalanceIterations : public TSDiag<TSFluxDiagnostic, IceModel>
+{
+public:
+  PerfStressBalanceIterations(const IceModel *m, bool linear)
+    : TSDiag<TSFluxDiagnostic, IceModel>(m, linear ?
+                                         "perf_ssa_linear_iterations" :
+                                         "perf_ssa_nonlinear_iterations"),
+      m_linear(linear) {
+
+    set_units("s-1", "year-1");
+    m_ts.variable().set_string("long_name",
+                               linear ?
+                               "number of linear solver iterations per unit of model time" :
+                               "number of nonlinear iterations per unit of model time");
+    m_ts.variable().set_string("comment",
+                               "divide by perf_time_steps to get the number per time step");
+    m_ts.variable().set_number("valid_min", 0.0);
+  }
+
+  double compute() {
+    const stressbalance::ShallowStressBalance *ssb = model->stress_balance()->shallow();
+
+    return m_linear ? ssb->linear_iterations() : ssb->nonlinear_iterations();
+  }
+private:
+  bool m_linear;
+};
+
+//! \brief Reports the peak resident set size (the maximum over all processes).
+class PerfPeakMemory : public TSDiag<TSSnapshotDiagnostic, IceModel>
+{
+public:
+  PerfPeakMemory(const IceModel *m)
+    : TSDiag<TSSnapshotDiagnostic, IceModel>(m, "perf_peak_rss") {
+
+    set_units("1", "1");
+    m_ts.variable().set_string("long_name",
+                               "peak resident set size of a process, in MiB"
+                               " (maximum over all processes)");
+    m_ts.variable().set_number("valid_min", 0.0);
+  }
+
+  double compute() {
+    double rss = MemoryTracker::peak_resident_set_size() / (1024.0 * 1024.0);
+
+    return GlobalMax(m_grid->com, rss);
+  }
+};
+
 /*!
  * Return total mass change due to one of the terms in the mass continuity equation.
  *
@@ -1880,6 +1948,10 @@ protected:
     return result;
   }
 
+  bool time_averaged_impl() const {
+    return true;
+  }
+
   void reset_impl() {
     m_interval_length = 0.0;
     m_last_thickness.copy_from(model->geometry().ice_thickness);
@@ -2339,8 +2411,6 @@ IceModelVec::Ptr IceHardness::compute_impl() const {
   IceModelVec3::Ptr result(new IceModelVec3(m_grid, "hardness", WITHOUT_GHOSTS));
   result->metadata(0) = m_vars[0];
 
-  EnthalpyConverter::Ptr EC = m_grid->ctx()->enthalpy_converter();
-
   const IceModelVec3  &ice_enthalpy  = model->energy_balance_model()->enthalpy();
   const IceModelVec2S &ice_thickness = model->geometry().ice_thickness;
 
@@ -2349,24 +2419,17 @@ IceModelVec::Ptr IceHardness::compute_impl() const {
   IceModelVec::AccessList list{&ice_enthalpy, &ice_thickness, result.get()};
 
   const unsigned int Mz = m_grid->Mz();
+  const std::vector<double> &z = m_grid->z();
+  std::vector<double> pressure(Mz);
 
   ParallelSection loop(m_grid->com);
   try {
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
-      const double *E = ice_enthalpy.get_column(i, j);
-      const double H = ice_thickness(i, j);
-
-      double *hardness = result->get_column(i, j);
-
-      for (unsigned int k = 0; k < Mz; ++k) {
-        const double depth = H - m_grid->z(k);
 
-        // EC->pressure() handles negative depths correctly
-        const double pressure = EC->pressure(depth);
-
-        hardness[k] = flow_law.hardness(E[k], pressure);
-      }
+      rheology::hardness_column(flow_law, ice_thickness(i, j), z.data(), Mz,
+                                ice_enthalpy.get_column(i, j), pressure.data(),
+                                result->get_column(i, j));
     }
   } catch (...) {
     loop.failed();
@@ -2410,19 +2473,34 @@ IceModelVec::Ptr IceViscosity::compute_impl() const {
 
   using mask::ice_free;
 
-  EnthalpyConverter::Ptr EC = m_grid->ctx()->enthalpy_converter();
-
   const rheology::FlowLaw &flow_law = *model->stress_balance()->modifier()->flow_law();
 
   const IceModelVec2S &ice_thickness = model->geometry().ice_thickness;
 
   const IceModelVec3
     &ice_enthalpy     = model->energy_balance_model()->enthalpy(),
-    &U                = model->stress_balance()->velocity_u(),
-    &V                = model->stress_balance()->velocity_v(),
+    &U_input          = model->stress_balance()->velocity_u(),
+    &V_input          = model->stress_balance()->velocity_v(),
     &W_without_ghosts = model->stress_balance()->velocity_w();
 
-  W_without_ghosts.update_ghosts(W);
+  // 3D velocity may use a subset of grid levels (see stress_balance.Mz)
+  const bool all_levels = (U_input.levels().size() == m_grid->Mz());
+
+  IceModelVec3 U_tmp, V_tmp;
+  if (all_levels) {
+    W_without_ghosts.update_ghosts(W);
+  } else {
+    U_tmp.create(m_grid, "uvel", WITH_GHOSTS);
+    V_tmp.create(m_grid, "vvel", WITH_GHOSTS);
+
+    stressbalance::velocity_to_grid_levels(U_input, U_tmp);
+    stressbalance::velocity_to_grid_levels(V_input, V_tmp);
+    stressbalance::velocity_to_grid_levels(W_without_ghosts, W);
+  }
+
+  const IceModelVec3
+    &U = all_levels ? U_input : U_tmp,
+    &V = all_levels ? V_input : V_tmp;
 
   const unsigned int Mz = m_grid->Mz();
   const double
@@ -2434,6 +2512,8 @@ IceModelVec::Ptr IceViscosity::compute_impl() const {
 
   IceModelVec::AccessList list{&U, &V, &W, &ice_enthalpy, &ice_thickness, &mask, result.get()};
 
+  std::vector<double> pressure(Mz), hardness_column(Mz);
+
   ParallelSection loop(m_grid->com);
   try {
     for (Points p(*m_grid); p; p.next()) {
@@ -2477,6 +2557,9 @@ IceModelVec::Ptr IceViscosity::compute_impl() const {
         continue;
       }
 
+      rheology::hardness_column(flow_law, H, z.data(), Mz, E,
+                                pressure.data(), hardness_column.data());
+
       for (unsigned int k = 0; k < Mz; ++k) {
         const double depth = H - z[k];
 
@@ -2485,10 +2568,7 @@ IceModelVec::Ptr IceViscosity::compute_impl() const {
           continue;
         }
 
-        // EC->pressure() handles negative depths correctly
-        const double pressure = EC->pressure(depth);
-
-        const double hardness = flow_law.hardness(E[k], pressure);
+        const double hardness = hardness_column[k];
 
         double u_x = 0.0, v_x = 0.0, w_x = 0.0;
         if (west + east > 0) {
@@ -2588,6 +2668,10 @@ protected:
 
     return result;
   }
+
+  const IceModelVec* borrow_impl() const {
+    return &model->geometry().ice_thickness;
+  }
 };
 
 /*! @brief Report ice top surface elevation */
@@ -2642,6 +2726,10 @@ protected:
 
     return result;
   }
+
+  const IceModelVec* borrow_impl() const {
+    return &model->geometry().ice_surface_elevation;
+  }
 };
 
 /*! @brief Report grounding line flux. */
@@ -2679,55 +2767,160 @@ protected:
   }
 };
 
+//! Returns a function creating the diagnostic `D` using constructor arguments `args`.
+template<class D, typename... Args>
+DiagnosticFactory create(Args... args) {
+  return [=]() { return Diagnostic::Ptr(new D(args...)); };
+}
+
+//! Returns a function creating the scalar diagnostic `D` using constructor arguments `args`.
+template<class D, typename... Args>
+TSDiagnosticFactory create_ts(Args... args) {
+  return [=]() { return TSDiagnostic::Ptr(new D(args...)); };
+}
+
+//! Returns a function wrapping a field with dedicated storage (see Diagnostic::wrap()).
+template<class F>
+DiagnosticFactory wrap(const F &field) {
+  const F *f = &field;
+  return [f]() { return Diagnostic::wrap(*f); };
+}
+
+/*!
+ * Create diagnostics listed in `requested` (all diagnostics if `requested` is NULL) using
+ * `factories`.
+ *
+ * `aliases` maps alternative names to names of diagnostics in `factories`. A diagnostic
+ * requested using several names is created once.
+ *
+ * Names that are not in `factories` are ignored: these diagnostics may be provided by
+ * sub-models.
+ */
+template<class D>
+std::map<std::string, std::shared_ptr<D> >
+create_diagnostics(const std::map<std::string, std::function<std::shared_ptr<D>()> > &factories,
+                   const std::map<std::string, std::string> &aliases,
+                   const std::set<std::string> *requested) {
+  std::set<std::string> names;
+  if (requested != nullptr) {
+    names = *requested;
+  } else {
+    for (const auto &f : factories) {
+      names.insert(f.first);
+    }
+    for (const auto &a : aliases) {
+      names.insert(a.first);
+    }
+  }
+
+  std::map<std::string, std::shared_ptr<D> > created, result;
+  for (const auto &name : names) {
+    auto a = aliases.find(name);
+    const std::string &target = a != aliases.end() ? a->second : name;
+
+    auto f = factories.find(target);
+    if (f == factories.end()) {
+      continue;
+    }
+
+    if (created.find(target) == created.end()) {
+      created[target] = f->second();
+    }
+    result[name] = created[target];
+  }
+
+  return result;
+}
+
+//! ISMIP6 names of spatially-variable diagnostics.
+std::map<std::string, std::string> ismip6_aliases(const Config &config) {
+  if (not config.get_flag("output.ISMIP6")) {
+    return {};
+  }
+
+  return {
+    {"base",        "ice_base_elevation"},
+    {"lithk",       "thk"},
+    {"dlithkdt",    "dHdt"},
+    {"orog",        "usurf"},
+    {"acabf",       "tendency_of_ice_amount_due_to_surface_mass_flux"},
+    {"libmassbfgr", "basal_mass_flux_grounded"},
+    {"libmassbffl", "basal_mass_flux_floating"},
+    {"lifmassbf",   "tendency_of_ice_amount_due_to_discharge"},
+    {"licalvf",     "tendency_of_ice_amount_due_to_calving"},
+    {"ligroundf",   "grounding_line_flux"},
+  };
+}
+
+//! ISMIP6 names of scalar diagnostics.
+std::map<std::string, std::string> ismip6_ts_aliases(const Config &config) {
+  if (not config.get_flag("output.ISMIP6")) {
+    return {};
+  }
+
+  return {
+    {"iareafl",         "ice_area_glacierized_floating"},
+    {"iareagr",         "ice_area_glacierized_grounded"},
+    {"lim",             "ice_mass"},
+    {"tendacabf",       "tendency_of_ice_mass_due_to_surface_mass_flux"},
+    {"tendlibmassbf",   "tendency_of_ice_mass_due_to_basal_mass_flux"},
+    {"tendlibmassbffl", "basal_mass_flux_floating"},
+    {"tendlicalvf",     "tendency_of_ice_mass_due_to_calving"},
+    {"tendlifmassbf",   "tendency_of_ice_mass_due_to_discharge"},
+    {"tendligroundf",   "grounding_line_flux"},
+  };
+}
 
 } // end of namespace diagnostics
 
-void IceModel::init_diagnostics() {
+/*!
+ * Functions creating spatially-variable diagnostics provided by IceModel (not by its
+ * sub-models).
+ */
+DiagnosticFactoryList IceModel::diagnostic_factories() {
 
   using namespace diagnostics;
 
-  typedef Diagnostic      d;
-  typedef Diagnostic::Ptr f;    // "f" for "field"
-  m_diagnostics = {
+  DiagnosticFactoryList result = {
     // geometry
-    {"cell_grounded_fraction",              d::wrap(m_geometry.cell_grounded_fraction)},
-    {"height_above_flotation",              f(new HeightAboveFloatation(this))},
-    {"ice_area_specific_volume",            d::wrap(m_geometry.ice_area_specific_volume)},
-    {"ice_mass",                            f(new IceMass(this))},
-    {"lat",                                 d::wrap(m_geometry.latitude)},
-    {"lon",                                 d::wrap(m_geometry.longitude)},
-    {"mask",                                d::wrap(m_geometry.cell_type)},
-    {"thk",                                 f(new IceThickness(this))},
-    {"topg_sl_adjusted",                    f(new BedTopographySeaLevelAdjusted(this))},
-    {"usurf",                               f(new IceSurfaceElevation(this))},
-    {"ice_base_elevation",                  f(new IceBottomSurfaceElevation(this))},
-    {floating_ice_sheet_area_fraction_name, f(new IceAreaFractionFloating(this))},
-    {grounded_ice_sheet_area_fraction_name, f(new IceAreaFractionGrounded(this))},
-    {land_ice_area_fraction_name,           f(new IceAreaFraction(this))},
+    {"cell_grounded_fraction",              wrap(m_geometry.cell_grounded_fraction)},
+    {"height_above_flotation",              create<HeightAboveFloatation>(this)},
+    {"ice_area_specific_volume",            wrap(m_geometry.ice_area_specific_volume)},
+    {"ice_mass",                            create<IceMass>(this)},
+    {"lat",                                 wrap(m_geometry.latitude)},
+    {"lon",                                 wrap(m_geometry.longitude)},
+    {"mask",                                wrap(m_geometry.cell_type)},
+    {"thk",                                 create<IceThickness>(this)},
+    {"topg_sl_adjusted",                    create<BedTopographySeaLevelAdjusted>(this)},
+    {"usurf",                               create<IceSurfaceElevation>(this)},
+    {"ice_base_elevation",                  create<IceBottomSurfaceElevation>(this)},
+    {floating_ice_sheet_area_fraction_name, create<IceAreaFractionFloating>(this)},
+    {grounded_ice_sheet_area_fraction_name, create<IceAreaFractionGrounded>(this)},
+    {land_ice_area_fraction_name,           create<IceAreaFraction>(this)},
 
     // temperature, enthalpy, and liquid water fraction
-    {"enthalpybase", f(new IceEnthalpyBasal(this))},
-    {"enthalpysurf", f(new IceEnthalpySurface(this))},
-    {"bedtoptemp",   d::wrap(m_bedtoptemp)},
-    {"cts",          f(new CTS(this))},
-    {"liqfrac",      f(new LiquidFraction(this))},
-    {"temp",         f(new Temperature(this))},
-    {"temp_pa",      f(new TemperaturePA(this))},
-    {"tempbase",     f(new TemperatureBasal(this, BOTH))},
-    {"temppabase",   f(new TemperaturePABasal(this))},
-    {"tempsurf",     f(new TemperatureSurface(this))},
+    {"enthalpybase", create<IceEnthalpyBasal>(this)},
+    {"enthalpysurf", create<IceEnthalpySurface>(this)},
+    {"bedtoptemp",   wrap(m_bedtoptemp)},
+    {"cts",          create<CTS>(this)},
+    {"liqfrac",      create<LiquidFraction>(this)},
+    {"temp",         create<Temperature>(this)},
+    {"temp_pa",      create<TemperaturePA>(this)},
+    {"tempbase",     create<TemperatureBasal>(this, BOTH)},
+    {"temppabase",   create<TemperaturePABasal>(this)},
+    {"tempsurf",     create<TemperatureSurface>(this)},
 
     // rheology-related stuff
-    {"tempicethk",          f(new TemperateIceThickness(this))},
-    {"tempicethk_basal",    f(new TemperateIceThicknessBasal(this))},
-    {"hardav",              f(new HardnessAverage(this))},
-    {"hardness",            f(new IceHardness(this))},
-    {"effective_viscosity", f(new IceViscosity(this))},
+    {"tempicethk",          create<TemperateIceThickness>(this)},
+    {"tempicethk_basal",    create<TemperateIceThicknessBasal>(this)},
+    {"hardav",              create<HardnessAverage>(this)},
+    {"hardness",            create<IceHardness>(this)},
+    {"effective_viscosity", create<IceViscosity>(this)},
 
     // boundary conditions
-    {"ssa_bc_mask",                    d::wrap(m_ssa_dirichlet_bc_mask)},
-    {"ssa_bc_vel",                     d::wrap(m_ssa_dirichlet_bc_values)},
-    {"ice_margin_pressure_difference", f(new IceMarginPressureDifference(this))},
+    {"ssa_bc_mask",                    wrap(m_ssa_dirichlet_bc_mask)},
+    {"ssa_bc_vel",                     wrap(m_ssa_dirichlet_bc_values)},
+    {"ice_margin_pressure_difference", create<IceMarginPressureDifference>(this)},
 
     // balancing the books
     // tendency_of_ice_amount = (tendency_of_ice_amount_due_to_flow +
@@ -2735,13 +2928,13 @@ void IceModel::init_diagnostics() {
     //                           tendency_of_ice_amount_due_to_surface_mass_balance +
     //                           tendency_of_ice_amount_due_to_basal_mass_balance +
     //                           tendency_of_ice_amount_due_to_discharge)
-    {"tendency_of_ice_amount",                           f(new TendencyOfIceAmount(this,          AMOUNT))},
-    {"tendency_of_ice_amount_due_to_flow",               f(new TendencyOfIceAmountDueToFlow(this, AMOUNT))},
-    {"tendency_of_ice_amount_due_to_conservation_error", f(new ConservationErrorFlux(this,        AMOUNT))},
-    {"tendency_of_ice_amount_due_to_surface_mass_flux",  f(new SurfaceFlux(this,                  AMOUNT))},
-    {"tendency_of_ice_amount_due_to_basal_mass_flux",    f(new BasalFlux(this,                    AMOUNT))},
-    {"tendency_of_ice_amount_due_to_discharge",          f(new DischargeFlux(this,                AMOUNT))},
-    {"tendency_of_ice_amount_due_to_calving",            f(new CalvingFlux(this,                  AMOUNT))},
+    {"tendency_of_ice_amount",                           create<TendencyOfIceAmount>(this,          AMOUNT)},
+    {"tendency_of_ice_amount_due_to_flow",               create<TendencyOfIceAmountDueToFlow>(this, AMOUNT)},
+    {"tendency_of_ice_amount_due_to_conservation_error", create<ConservationErrorFlux>(this,        AMOUNT)},
+    {"tendency_of_ice_amount_due_to_surface_mass_flux",  create<SurfaceFlux>(this,                  AMOUNT)},
+    {"tendency_of_ice_amount_due_to_basal_mass_flux",    create<BasalFlux>(this,                    AMOUNT)},
+    {"tendency_of_ice_amount_due_to_discharge",          create<DischargeFlux>(this,                AMOUNT)},
+    {"tendency_of_ice_amount_due_to_calving",            create<CalvingFlux>(this,                  AMOUNT)},
 
     // same, in terms of mass
     // tendency_of_ice_mass = (tendency_of_ice_mass_due_to_flow +
@@ -2749,115 +2942,204 @@ void IceModel::init_diagnostics() {
     //                         tendency_of_ice_mass_due_to_surface_mass_flux +
     //                         tendency_of_ice_mass_due_to_basal_mass_balance +
     //                         tendency_of_ice_mass_due_to_discharge)
-    {"tendency_of_ice_mass",                           f(new TendencyOfIceAmount(this,          MASS))},
-    {"tendency_of_ice_mass_due_to_flow",               f(new TendencyOfIceAmountDueToFlow(this, MASS))},
-    {"tendency_of_ice_mass_due_to_conservation_error", f(new ConservationErrorFlux(this,        MASS))},
-    {"tendency_of_ice_mass_due_to_surface_mass_flux",  f(new SurfaceFlux(this,                  MASS))},
-    {"tendency_of_ice_mass_due_to_basal_mass_flux",    f(new BasalFlux(this,                    MASS))},
-    {"tendency_of_ice_mass_due_to_discharge",          f(new DischargeFlux(this,                MASS))},
-    {"tendency_of_ice_mass_due_to_calving",            f(new CalvingFlux(this,                  MASS))},
+    {"tendency_of_ice_mass",                           create<TendencyOfIceAmount>(this,          MASS)},
+    {"tendency_of_ice_mass_due_to_flow",               create<TendencyOfIceAmountDueToFlow>(this, MASS)},
+    {"tendency_of_ice_mass_due_to_conservation_error", create<ConservationErrorFlux>(this,        MASS)},
+    {"tendency_of_ice_mass_due_to_surface_mass_flux",  create<SurfaceFlux>(this,                  MASS)},
+    {"tendency_of_ice_mass_due_to_basal_mass_flux",    create<BasalFlux>(this,                    MASS)},
+    {"tendency_of_ice_mass_due_to_discharge",          create<DischargeFlux>(this,                MASS)},
+    {"tendency_of_ice_mass_due_to_calving",            create<CalvingFlux>(this,                  MASS)},
 
     // other rates and fluxes
-    {"basal_mass_flux_grounded", f(new BMBSplit(this, GROUNDED))},
-    {"basal_mass_flux_floating", f(new BMBSplit(this, SHELF))},
-    {"dHdt",                     f(new ThicknessRateOfChange(this))},
-    {"bmelt",                    d::wrap(m_basal_melt_rate)},
-    {"grounding_line_flux",      f(new GroundingLineFlux(this))},
+    {"basal_mass_flux_grounded", create<BMBSplit>(this, GROUNDED)},
+    {"basal_mass_flux_floating", create<BMBSplit>(this, SHELF)},
+    {"dHdt",                     create<ThicknessRateOfChange>(this)},
+    {"bmelt",                    wrap(m_basal_melt_rate)},
+    {"grounding_line_flux",      create<GroundingLineFlux>(this)},
 
     // misc
-    {"rank", f(new Rank(this))},
+    {"rank", create<Rank>(this)},
   };
 
 #if (Pism_USE_PROJ==1)
   std::string proj = m_grid->get_mapping_info().proj;
   if (not proj.empty()) {
-    m_diagnostics["lat_bnds"] = f(new LatLonBounds(this, "lat", proj));
-    m_diagnostics["lon_bnds"] = f(new LatLonBounds(this, "lon", proj));
+    result["lat_bnds"] = create<LatLonBounds>(this, "lat", proj);
+    result["lon_bnds"] = create<LatLonBounds>(this, "lon", proj);
   }
 #endif
 
-  // add ISMIP6 variable names
   if (m_config->get_flag("output.ISMIP6")) {
-    m_diagnostics["base"]        = m_diagnostics["ice_base_elevation"];
-    m_diagnostics["lithk"]       = m_diagnostics["thk"];
-    m_diagnostics["dlithkdt"]    = m_diagnostics["dHdt"];
-    m_diagnostics["orog"]        = m_diagnostics["usurf"];
-    m_diagnostics["acabf"]       = m_diagnostics["tendency_of_ice_amount_due_to_surface_mass_flux"];
-    m_diagnostics["libmassbfgr"] = m_diagnostics["basal_mass_flux_grounded"];
-    m_diagnostics["libmassbffl"] = m_diagnostics["basal_mass_flux_floating"];
-    m_diagnostics["lifmassbf"]   = m_diagnostics["tendency_of_ice_amount_due_to_discharge"];
-    m_diagnostics["licalvf"]     = m_diagnostics["tendency_of_ice_amount_due_to_calving"];
-    m_diagnostics["litempbotgr"] = f(new TemperatureBasal(this, GROUNDED));
-    m_diagnostics["litempbotfl"] = f(new TemperatureBasal(this, SHELF));
-    m_diagnostics["ligroundf"]   = m_diagnostics["grounding_line_flux"];
-  }
-
-  typedef TSDiagnostic::Ptr s; // "s" for "scalar"
-  m_ts_diagnostics = {
+    result["litempbotgr"] = create<TemperatureBasal>(this, GROUNDED);
+    result["litempbotfl"] = create<TemperatureBasal>(this, SHELF);
+  }
+
+  return result;
+}
+
+//! Functions creating scalar diagnostics provided by IceModel (not by its sub-models).
+TSDiagnosticFactoryList IceModel::ts_diagnostic_factories() {
+
+  using namespace diagnostics;
+
+  return {
     // area
-    {"ice_area_glacierized",                s(new scalar::IceAreaGlacierized(this))},
-    {"ice_area_glacierized_cold_base",      s(new scalar::IceAreaGlacierizedColdBase(this))},
-    {"ice_area_glacierized_grounded",       s(new scalar::IceAreaGlacierizedGrounded(this))},
-    {"ice_area_glacierized_floating",       s(new scalar::IceAreaGlacierizedShelf(this))},
-    {"ice_area_glacierized_temperate_base", s(new scalar::IceAreaGlacierizedTemperateBase(this))},
+    {"ice_area_glacierized",                create_ts<scalar::IceAreaGlacierized>(this)},
+    {"ice_area_glacierized_cold_base",      create_ts<scalar::IceAreaGlacierizedColdBase>(this)},
+    {"ice_area_glacierized_grounded",       create_ts<scalar::IceAreaGlacierizedGrounded>(this)},
+    {"ice_area_glacierized_floating",       create_ts<scalar::IceAreaGlacierizedShelf>(this)},
+    {"ice_area_glacierized_temperate_base", create_ts<scalar::IceAreaGlacierizedTemperateBase>(this)},
     // mass
-    {"ice_mass_glacierized",             s(new scalar::IceMassGlacierized(this))},
-    {"ice_mass",                         s(new scalar::IceMass(this))},
-    {"tendency_of_ice_mass_glacierized", s(new scalar::IceMassRateOfChangeGlacierized(this))},
-    {"limnsw",                           s(new scalar::IceMassNotDisplacingSeaWater(this))},
+    {"ice_mass_glacierized",             create_ts<scalar::IceMassGlacierized>(this)},
+    {"ice_mass",                         create_ts<scalar::IceMass>(this)},
+    {"tendency_of_ice_mass_glacierized", create_ts<scalar::IceMassRateOfChangeGlacierized>(this)},
+    {"limnsw",                           create_ts<scalar::IceMassNotDisplacingSeaWater>(this)},
     // volume
-    {"ice_volume_glacierized",             s(new scalar::IceVolumeGlacierized(this))},
-    {"ice_volume_glacierized_cold",        s(new scalar::IceVolumeGlacierizedCold(this))},
-    {"ice_volume_glacierized_grounded",    s(new scalar::IceVolumeGlacierizedGrounded(this))},
-    {"ice_volume_glacierized_floating",    s(new scalar::IceVolumeGlacierizedShelf(this))},
-    {"ice_volume_glacierized_temperate",   s(new scalar::IceVolumeGlacierizedTemperate(this))},
-    {"ice_volume",                         s(new scalar::IceVolume(this))},
-    {"ice_volume_cold",                    s(new scalar::IceVolumeCold(this))},
-    {"ice_volume_temperate",               s(new scalar::IceVolumeTemperate(this))},
-    {"tendency_of_ice_volume_glacierized", s(new scalar::IceVolumeRateOfChangeGlacierized(this))},
-    {"tendency_of_ice_volume",             s(new scalar::IceVolumeRateOfChange(this))},
-    {"sea_level_rise_potential",           s(new scalar::SeaLevelRisePotential(this))},
+    {"ice_volume_glacierized",             create_ts<scalar::IceVolumeGlacierized>(this)},
+    {"ice_volume_glacierized_cold",        create_ts<scalar::IceVolumeGlacierizedCold>(this)},
+    {"ice_volume_glacierized_grounded",    create_ts<scalar::IceVolumeGlacierizedGrounded>(this)},
+    {"ice_volume_glacierized_floating",    create_ts<scalar::IceVolumeGlacierizedShelf>(this)},
+    {"ice_volume_glacierized_temperate",   create_ts<scalar::IceVolumeGlacierizedTemperate>(this)},
+    {"ice_volume",                         create_ts<scalar::IceVolume>(this)},
+    {"ice_volume_cold",                    create_ts<scalar::IceVolumeCold>(this)},
+    {"ice_volume_temperate",               create_ts<scalar::IceVolumeTemperate>(this)},
+    {"tendency_of_ice_volume_glacierized", create_ts<scalar::IceVolumeRateOfChangeGlacierized>(this)},
+    {"tendency_of_ice_volume",             create_ts<scalar::IceVolumeRateOfChange>(this)},
+    {"sea_level_rise_potential",           create_ts<scalar::SeaLevelRisePotential>(this)},
     // energy
-    {"ice_enthalpy_glacierized", s(new scalar::IceEnthalpyGlacierized(this))},
-    {"ice_enthalpy",         s(new scalar::IceEnthalpy(this))},
+    {"ice_enthalpy_glacierized", create_ts<scalar::IceEnthalpyGlacierized>(this)},
+    {"ice_enthalpy",         create_ts<scalar::IceEnthalpy>(this)},
     // time-stepping
-    {"max_diffusivity", s(new scalar::MaxDiffusivity(this))},
-    {"max_hor_vel",     s(new scalar::MaxHorizontalVelocity(this))},
-    {"dt",              s(new scalar::TimeStepLength(this))},
+    {"max_diffusivity", create_ts<scalar::MaxDiffusivity>(this)},
+    {"max_hor_vel",     create_ts<scalar::MaxHorizontalVelocity>(this)},
+    {"dt",              create_ts<scalar::TimeStepLength>(this)},
+    // performance
+    {"perf_wall_clock_time", create_ts<scalar::PerfWallClockTime>(this, "perf_wall_clock_time", "",
+                                                                  "wall-clock time")},
+    {"perf_step_time", create_ts<scalar::PerfWallClockTime>(this, "perf_step_time", "step",
+                                                            "wall-clock time spent in time steps")},
+    {"perf_stress_balance_time", create_ts<scalar::PerfWallClockTime>(this, "perf_stress_balance_time",
+                                                                      "stress_balance",
+                                                                      "wall-clock time spent in the stress balance model")},
+    {"perf_energy_time", create_ts<scalar::PerfWallClockTime>(this, "perf_energy_time", "energy",
+                                                              "wall-clock time spent in the energy balance model")},
+    {"perf_mass_transport_time", create_ts<scalar::PerfWallClockTime>(this, "perf_mass_transport_time",
+                                                                      "mass_transport",
+                                                                      "wall-clock time spent in the mass transport model")},
+    {"perf_io_time", create_ts<scalar::PerfWallClockTime>(this, "perf_io_time", "io",
+                                                          "wall-clock time spent writing output files")},
+    {"perf_time_steps",               create_ts<scalar::PerfTimeSteps>(this)},
+    {"perf_ssa_nonlinear_iterations", create_ts<scalar::PerfStressBalanceIterations>(this, false)},
+    {"perf_ssa_linear_iterations",    create_ts<scalar::PerfStressBalanceIterations>(this, true)},
+    {"perf_peak_rss",                 create_ts<scalar::PerfPeakMemory>(this)},
     // balancing the books
-    {"tendency_of_ice_mass",                           s(new scalar::IceMassRateOfChange(this))},
-    {"tendency_of_ice_mass_due_to_flow",               s(new scalar::IceMassRateOfChangeDueToFlow(this))},
-    {"tendency_of_ice_mass_due_to_conservation_error", s(new scalar::IceMassFluxConservationError(this))},
-    {"tendency_of_ice_mass_due_to_basal_mass_flux",    s(new scalar::IceMassFluxBasal(this))},
-    {"tendency_of_ice_mass_due_to_surface_mass_flux",  s(new scalar::IceMassFluxSurface(this))},
-    {"tendency_of_ice_mass_due_to_discharge",          s(new scalar::IceMassFluxDischarge(this))},
-    {"tendency_of_ice_mass_due_to_calving",            s(new scalar::IceMassFluxCalving(this))},
+    {"tendency_of_ice_mass",                           create_ts<scalar::IceMassRateOfChange>(this)},
+    {"tendency_of_ice_mass_due_to_flow",               create_ts<scalar::IceMassRateOfChangeDueToFlow>(this)},
+    {"tendency_of_ice_mass_due_to_conservation_error", create_ts<scalar::IceMassFluxConservationError>(this)},
+    {"tendency_of_ice_mass_due_to_basal_mass_flux",    create_ts<scalar::IceMassFluxBasal>(this)},
+    {"tendency_of_ice_mass_due_to_surface_mass_flux",  create_ts<scalar::IceMassFluxSurface>(this)},
+    {"tendency_of_ice_mass_due_to_discharge",          create_ts<scalar::IceMassFluxDischarge>(this)},
+    {"tendency_of_ice_mass_due_to_calving",            create_ts<scalar::IceMassFluxCalving>(this)},
     // other fluxes
-    {"basal_mass_flux_grounded", s(new scalar::IceMassFluxBasalGrounded(this))},
-    {"basal_mass_flux_floating", s(new scalar::IceMassFluxBasalFloating(this))},
-    {"grounding_line_flux",      s(new scalar::IceMassFluxAtGroundingLine(this))},
+    {"basal_mass_flux_grounded", create_ts<scalar::IceMassFluxBasalGrounded>(this)},
+    {"basal_mass_flux_floating", create_ts<scalar::IceMassFluxBasalFloating>(this)},
+    {"grounding_line_flux",      create_ts<scalar::IceMassFluxAtGroundingLine>(this)},
   };
+}
 
-  // add ISMIP6 variable names
-  if (m_config->get_flag("output.ISMIP6")) {
-    m_ts_diagnostics["iareafl"]         = m_ts_diagnostics["ice_area_glacierized_floating"];
-    m_ts_diagnostics["iareagr"]         = m_ts_diagnostics["ice_area_glacierized_grounded"];
-    m_ts_diagnostics["lim"]             = m_ts_diagnostics["ice_mass"];
-    m_ts_diagnostics["tendacabf"]       = m_ts_diagnostics["tendency_of_ice_mass_due_to_surface_mass_flux"];
-    m_ts_diagnostics["tendlibmassbf"]   = m_ts_diagnostics["tendency_of_ice_mass_due_to_basal_mass_flux"];
-    m_ts_diagnostics["tendlibmassbffl"] = m_ts_diagnostics["basal_mass_flux_floating"];
-    m_ts_diagnostics["tendlicalvf"]     = m_ts_diagnostics["tendency_of_ice_mass_due_to_calving"];
-    m_ts_diagnostics["tendlifmassbf"]   = m_ts_diagnostics["tendency_of_ice_mass_due_to_discharge"];
-    m_ts_diagnostics["tendligroundf"]   = m_ts_diagnostics["grounding_line_flux"];
+/*!
+ * Allocate requested diagnostics.
+ *
+ * Diagnostics provided by IceModel are created only if requested (see
+ * requested_diagnostics() and requested_ts_diagnostics()). Diagnostics provided by
+ * sub-models are allocated by sub-models; we keep requested ones.
+ */
+void IceModel::init_diagnostics() {
+
+  auto requested = requested_diagnostics();
+
+  bool all_ts = false;
+  auto ts_requested = requested_ts_diagnostics(all_ts);
+
+  {
+    auto factories = diagnostic_factories();
+    auto aliases   = diagnostics::ismip6_aliases(*m_config);
+
+    m_diagnostics = diagnostics::create_diagnostics(factories, aliases, &requested);
+
+    m_available_diagnostics.clear();
+    for (const auto &f : factories) {
+      m_available_diagnostics.insert(f.first);
+    }
+    for (const auto &a : aliases) {
+      m_available_diagnostics.insert(a.first);
+    }
   }
 
+  m_ts_diagnostics = diagnostics::create_diagnostics(ts_diagnostic_factories(),
+                                                     diagnostics::ismip6_ts_aliases(*m_config),
+                                                     all_ts ? nullptr : &ts_requested);
+
   // get diagnostics from submodels
   for (auto m : m_submodels) {
-    m_diagnostics = pism::combine(m_diagnostics, m.second->diagnostics());
+    for (auto d : m.second->diagnostics()) {
+      m_available_diagnostics.insert(d.first);
+
+      if (requested.find(d.first) != requested.end() and
+          m_diagnostics.find(d.first) == m_diagnostics.end()) {
+        m_diagnostics[d.first] = d.second;
+      }
+    }
     m_ts_diagnostics = pism::combine(m_ts_diagnostics, m.second->ts_diagnostics());
   }
 }
 
+/*!
+ * Make "mass" versions of requested flux diagnostics use accumulators of corresponding
+ * "amount" versions (if both are requested).
+ *
+ * This halves the number of full-grid updates needed to compute these time averages.
+ */
+void IceModel::share_diagnostic_accumulators() {
+  using diagnostics::FluxDiagnostic;
+
+  std::map<std::type_index, std::shared_ptr<const FluxDiagnostic>> amounts;
+  for (const auto &d : m_diagnostics) {
+    auto flux = std::dynamic_pointer_cast<const FluxDiagnostic>(d.second);
+    if (flux and flux->kind() == diagnostics::AMOUNT) {
+      amounts[typeid(*flux)] = flux;
+    }
+  }
+
+  for (const auto &d : m_diagnostics) {
+    auto flux = std::dynamic_pointer_cast<FluxDiagnostic>(d.second);
+    if (flux and flux->kind() == diagnostics::MASS) {
+      auto source = amounts.find(typeid(*flux));
+      if (source != amounts.end()) {
+        flux->share_accumulator(source->second);
+      }
+    }
+  }
+}
+
+/*!
+ * Allocate all available diagnostics (used to list them).
+ */
+void IceModel::all_diagnostics(DiagnosticList &result, TSDiagnosticList &ts_result) {
+  result = diagnostics::create_diagnostics(diagnostic_factories(),
+                                           diagnostics::ismip6_aliases(*m_config),
+                                           nullptr);
+
+  ts_result = diagnostics::create_diagnostics(ts_diagnostic_factories(),
+                                              diagnostics::ismip6_ts_aliases(*m_config),
+                                              nullptr);
+
+  for (auto m : m_submodels) {
+    result    = pism::combine(result, m.second->diagnostics());
+    ts_result = pism::combine(ts_result, m.second->ts_diagnostics());
+  }
+}
+
 typedef std::map<std::string, std::vector<VariableMetadata>> Metadata;
 
 static void print_diagnostics(const Logger &log, const Metadata &list) {
@@ -2961,32 +3243,38 @@ static Metadata ts_diag_metadata(const std::map<std::string,TSDiagnostic::Ptr> &
   return result;
 }
 
-void IceModel::list_diagnostics_json() const {
+void IceModel::list_diagnostics_json() {
+  DiagnosticList diags;
+  TSDiagnosticList ts_diags;
+  all_diagnostics(diags, ts_diags);
 
   m_log->message(1, "{\n");
 
   m_log->message(1, "\"spatial\" :\n");
-  print_diagnostics_json(*m_log, diag_metadata(m_diagnostics));
+  print_diagnostics_json(*m_log, diag_metadata(diags));
 
   m_log->message(1, ",\n");        // separator
 
   m_log->message(1, "\"scalar\" :\n");
-  print_diagnostics_json(*m_log, ts_diag_metadata(m_ts_diagnostics));
+  print_diagnostics_json(*m_log, ts_diag_metadata(ts_diags));
 
   m_log->message(1, "}\n");
 }
 
-void IceModel::list_diagnostics() const {
+void IceModel::list_diagnostics() {
+  DiagnosticList diags;
+  TSDiagnosticList ts_diags;
+  all_diagnostics(diags, ts_diags);
 
   m_log->message(1, "\n");
   m_log->message(1, "======== Available 2D and 3D diagnostics ========\n");
 
-  print_diagnostics(*m_log, diag_metadata(m_diagnostics));
+  print_diagnostics(*m_log, diag_metadata(diags));
 
   // scalar time-series
   m_log->message(1, "======== Available time-series ========\n");
 
-  print_diagnostics(*m_log, ts_diag_metadata(m_ts_diagnostics));
+  print_diagnostics(*m_log, ts_diag_metadata(ts_diags));
 }
 
 /*!
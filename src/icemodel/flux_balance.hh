@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -103,6 +103,10 @@ protected:
     return result;
   }
 
+  bool time_averaged_impl() const {
+    return true;
+  }
+
   void reset_impl() {
     m_interval_length = 0.0;
 
@@ -131,18 +135,112 @@ protected:
   double m_interval_length;
 };
 
+/*!
+ * Base class of time-averaged fluxes reported both as ice "amount" (kg m-2 s-1) and as ice
+ * "mass" (kg s-1).
+ *
+ * The two versions of a flux differ by a constant factor (cell area), so if both are
+ * requested the "mass" version re-uses the accumulator of the "amount" version (see
+ * share_accumulator()) instead of accumulating the same field again at every time step.
+ */
+class FluxDiagnostic : public DiagAverageRate<IceModel>
+{
+public:
+  FluxDiagnostic(const IceModel *m, const std::string &name, AmountKind kind)
+    : DiagAverageRate<IceModel>(m, name, TOTAL_CHANGE),
+    m_kind(kind) {
+    m_factor = m_config->get_number("constants.ice.density");
+  }
+
+  AmountKind kind() const {
+    return m_kind;
+  }
+
+  /*!
+   * Use the accumulator of `source` (the "amount" version of the same flux) instead of
+   * maintaining a separate one.
+   *
+   * From now on `m_accumulator` contains the difference between this accumulator and the
+   * scaled accumulator of `source` (usually zero; it may be non-zero after re-starting
+   * from a file that did not contain both accumulators).
+   */
+  void share_accumulator(std::shared_ptr<const FluxDiagnostic> source) {
+    if (m_kind != MASS or source->kind() != AMOUNT) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "%s cannot use the accumulator of %s",
+                                    m_accumulator.get_name().c_str(),
+                                    source->m_accumulator.get_name().c_str());
+    }
+
+    if (m_source == source) {
+      return;
+    }
+
+    if (m_source) {
+      m_accumulator.add(m_grid->cell_area(), m_source->m_accumulator);
+    }
+    m_accumulator.add(-m_grid->cell_area(), source->m_accumulator);
+
+    m_source = source;
+  }
+protected:
+  //! Add `C` times the flux during the last time step to `m_accumulator`.
+  virtual void accumulate(double C) = 0;
+
+  void update_impl(double dt) {
+    if (not m_source) {
+      accumulate(m_factor * (m_kind == AMOUNT ? 1.0 : m_grid->cell_area()));
+    }
+
+    m_interval_length += dt;
+  }
+
+  IceModelVec::Ptr compute_impl() const {
+    auto result = DiagAverageRate<IceModel>::compute_impl();
+
+    if (m_source and m_interval_length > 0.0) {
+      result->add(m_grid->cell_area() / m_interval_length, m_source->m_accumulator);
+    }
+
+    return result;
+  }
+
+  void write_state_impl(const File &output) const {
+    if (not m_source) {
+      DiagAverageRate<IceModel>::write_state_impl(output);
+      return;
+    }
+
+    // save the accumulator this diagnostic would have if it did not share one
+    IceModelVec2S accumulator(m_grid, m_accumulator.get_name(), WITHOUT_GHOSTS);
+    accumulator.metadata() = m_accumulator.metadata();
+    accumulator.copy_from(m_accumulator);
+    accumulator.add(m_grid->cell_area(), m_source->m_accumulator);
+    accumulator.write(output);
+
+    const unsigned int
+      time_length = output.dimension_length(m_time_since_reset.get_dimension_name()),
+      t_start = time_length > 0 ? time_length - 1 : 0;
+    io::write_timeseries(output, m_time_since_reset, t_start, m_interval_length, PISM_DOUBLE);
+  }
+
+  AmountKind m_kind;
+  //! the "amount" version of this flux (if its accumulator is shared)
+  std::shared_ptr<const FluxDiagnostic> m_source;
+};
+
 //! @brief Computes tendency_of_ice_amount_due_to_flow, the rate of change of ice amount due to
 //! flow.
 /*! @brief Report rate of change of ice amount due to flow. */
-class TendencyOfIceAmountDueToFlow : public DiagAverageRate<IceModel>
+class TendencyOfIceAmountDueToFlow : public FluxDiagnostic
 {
 public:
   TendencyOfIceAmountDueToFlow(const IceModel *m, AmountKind kind)
-    : DiagAverageRate<IceModel>(m,
-                                kind == AMOUNT
-                                ? "tendency_of_ice_amount_due_to_flow"
-                                : "tendency_of_ice_mass_due_to_flow", TOTAL_CHANGE),
-    m_kind(kind) {
+    : FluxDiagnostic(m,
+                     kind == AMOUNT
+                     ? "tendency_of_ice_amount_due_to_flow"
+                     : "tendency_of_ice_mass_due_to_flow",
+                     kind) {
 
     std::string
       name              = "tendency_of_ice_amount_due_to_flow",
@@ -161,8 +259,6 @@ public:
       external_units    = "Gt year-1";
     }
 
-    m_factor = m_config->get_number("constants.ice.density");
-
     m_vars = {SpatialVariableMetadata(m_sys, name)};
     m_accumulator.metadata().set_string("units", accumulator_units);
 
@@ -173,41 +269,31 @@ public:
   }
 
 protected:
-  void update_impl(double dt) {
+  void accumulate(double C) {
     const IceModelVec2S
       &dH = model->geometry_evolution().thickness_change_due_to_flow(),
       &dV = model->geometry_evolution().area_specific_volume_change_due_to_flow();
 
-    auto cell_area = m_grid->cell_area();
-
     IceModelVec::AccessList list{&m_accumulator, &dH, &dV};
 
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      double C = m_factor * (m_kind == AMOUNT ? 1.0 : cell_area);
-
       m_accumulator(i, j) += C * (dH(i, j) + dV(i, j));
     }
-
-    m_interval_length += dt;
   }
-  AmountKind m_kind;
 };
 
 /*! @brief Report surface mass balance flux, averaged over the reporting interval */
-class SurfaceFlux : public DiagAverageRate<IceModel>
+class SurfaceFlux : public FluxDiagnostic
 {
 public:
   SurfaceFlux(const IceModel *m, AmountKind kind)
-    : DiagAverageRate<IceModel>(m,
-                                kind == AMOUNT
-                                ? "tendency_of_ice_amount_due_to_surface_mass_flux"
-                                : "tendency_of_ice_mass_due_to_surface_mass_flux",
-                                TOTAL_CHANGE),
-    m_kind(kind) {
-    m_factor = m_config->get_number("constants.ice.density");
-
+    : FluxDiagnostic(m,
+                     kind == AMOUNT
+                     ? "tendency_of_ice_amount_due_to_surface_mass_flux"
+                     : "tendency_of_ice_mass_due_to_surface_mass_flux",
+                     kind) {
     auto ismip6 = m_config->get_flag("output.ISMIP6");
 
     std::string
@@ -237,40 +323,30 @@ public:
   }
 
 protected:
-  void update_impl(double dt) {
+  void accumulate(double C) {
     const IceModelVec2S
       &SMB = model->geometry_evolution().top_surface_mass_balance();
 
-    auto cell_area = m_grid->cell_area();
-
     IceModelVec::AccessList list{&m_accumulator, &SMB};
 
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      double C = m_factor * (m_kind == AMOUNT ? 1.0 : cell_area);
-
       m_accumulator(i, j) += C * SMB(i, j);
     }
-
-    m_interval_length += dt;
   }
-  AmountKind m_kind;
 };
 
 /*! @brief Report basal mass balance flux, averaged over the reporting interval */
-class BasalFlux : public DiagAverageRate<IceModel>
+class BasalFlux : public FluxDiagnostic
 {
 public:
   BasalFlux(const IceModel *m, AmountKind kind)
-    : DiagAverageRate<IceModel>(m,
-                                kind == AMOUNT
-                                ? "tendency_of_ice_amount_due_to_basal_mass_flux"
-                                : "tendency_of_ice_mass_due_to_basal_mass_flux",
-                                TOTAL_CHANGE),
-    m_kind(kind) {
-    m_factor = m_config->get_number("constants.ice.density");
-
+    : FluxDiagnostic(m,
+                     kind == AMOUNT
+                     ? "tendency_of_ice_amount_due_to_basal_mass_flux"
+                     : "tendency_of_ice_mass_due_to_basal_mass_flux",
+                     kind) {
     std::string
       name              = "tendency_of_ice_amount_due_to_basal_mass_flux",
       accumulator_units = "kg m-2",
@@ -297,39 +373,29 @@ public:
   }
 
 protected:
-  void update_impl(double dt) {
+  void accumulate(double C) {
     const IceModelVec2S
       &BMB = model->geometry_evolution().bottom_surface_mass_balance();
 
-    auto cell_area = m_grid->cell_area();
-
     IceModelVec::AccessList list{&m_accumulator, &BMB};
 
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      double C = m_factor * (m_kind == AMOUNT ? 1.0 : cell_area);
-
       m_accumulator(i, j) += C * BMB(i, j);
     }
-
-    m_interval_length += dt;
   }
-  AmountKind m_kind;
 };
 
-class ConservationErrorFlux : public DiagAverageRate<IceModel>
+class ConservationErrorFlux : public FluxDiagnostic
 {
 public:
   ConservationErrorFlux(const IceModel *m, AmountKind kind)
-    : DiagAverageRate<IceModel>(m,
-                                kind == AMOUNT
-                                ? "tendency_of_ice_amount_due_to_conservation_error"
-                                : "tendency_of_ice_mass_due_to_conservation_error" ,
-                                TOTAL_CHANGE),
-    m_kind(kind) {
-    m_factor = m_config->get_number("constants.ice.density");
-
+    : FluxDiagnostic(m,
+                     kind == AMOUNT
+                     ? "tendency_of_ice_amount_due_to_conservation_error"
+                     : "tendency_of_ice_mass_due_to_conservation_error",
+                     kind) {
     std::string
       name              = "tendency_of_ice_amount_due_to_conservation_error",
       accumulator_units = "kg m-2",
@@ -357,40 +423,30 @@ public:
   }
 
 protected:
-  void update_impl(double dt) {
+  void accumulate(double C) {
     const IceModelVec2S
       &error = model->geometry_evolution().conservation_error();
 
     IceModelVec::AccessList list{&m_accumulator, &error};
 
-    auto cell_area = m_grid->cell_area();
-
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      double C = m_factor * (m_kind == AMOUNT ? 1.0 : cell_area);
-
       m_accumulator(i, j) += C * error(i, j);
     }
-
-    m_interval_length += dt;
   }
-  AmountKind m_kind;
 };
 
 /*! @brief Report discharge (calving and frontal melt) flux. */
-class DischargeFlux : public DiagAverageRate<IceModel>
+class DischargeFlux : public FluxDiagnostic
 {
 public:
   DischargeFlux(const IceModel *m, AmountKind kind)
-    : DiagAverageRate<IceModel>(m,
-                                kind == AMOUNT
-                                ? "tendency_of_ice_amount_due_to_discharge"
-                                : "tendency_of_ice_mass_due_to_discharge",
-                                TOTAL_CHANGE),
-    m_kind(kind) {
-
-    m_factor = m_config->get_number("constants.ice.density");
+    : FluxDiagnostic(m,
+                     kind == AMOUNT
+                     ? "tendency_of_ice_amount_due_to_discharge"
+                     : "tendency_of_ice_mass_due_to_discharge",
+                     kind) {
 
     auto ismip6 = m_config->get_flag("output.ISMIP6");
 
@@ -421,41 +477,31 @@ public:
   }
 
 protected:
-  void update_impl(double dt) {
+  void accumulate(double C) {
     const IceModelVec2S &calving = model->calving();
     const IceModelVec2S &frontal_melt = model->frontal_melt();
     const IceModelVec2S &forced_retreat = model->forced_retreat();
 
     IceModelVec::AccessList list{&m_accumulator, &calving, &frontal_melt, &forced_retreat};
 
-    auto cell_area = m_grid->cell_area();
-
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      double C = m_factor * (m_kind == AMOUNT ? 1.0 : cell_area);
-
       m_accumulator(i, j) += C * (calving(i, j) + frontal_melt(i, j) + forced_retreat(i, j));
     }
-
-    m_interval_length += dt;
   }
-  AmountKind m_kind;
 };
 
 /*! @brief Report discharge (calving and frontal melt) flux. */
-class CalvingFlux : public DiagAverageRate<IceModel>
+class CalvingFlux : public FluxDiagnostic
 {
 public:
   CalvingFlux(const IceModel *m, AmountKind kind)
-    : DiagAverageRate<IceModel>(m,
-                                kind == AMOUNT
-                                ? "tendency_of_ice_amount_due_to_calving"
-                                : "tendency_of_ice_mass_due_to_calving",
-                                TOTAL_CHANGE),
-    m_kind(kind) {
-
-    m_factor = m_config->get_number("constants.ice.density");
+    : FluxDiagnostic(m,
+                     kind == AMOUNT
+                     ? "tendency_of_ice_amount_due_to_calving"
+                     : "tendency_of_ice_mass_due_to_calving",
+                     kind) {
 
     auto ismip6 = m_config->get_flag("output.ISMIP6");
 
@@ -486,24 +532,17 @@ public:
   }
 
 protected:
-  void update_impl(double dt) {
+  void accumulate(double C) {
     const IceModelVec2S &calving = model->calving();
 
     IceModelVec::AccessList list{&m_accumulator, &calving};
 
-    auto cell_area = m_grid->cell_area();
-
     for (Points p(*m_grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      double C = m_factor * (m_kind == AMOUNT ? 1.0 : cell_area);
-
       m_accumulator(i, j) += C * calving(i, j);
     }
-
-    m_interval_length += dt;
   }
-  AmountKind m_kind;
 };
 
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2011-2019 Torsten Albrecht and Constantine Khroulev
+// Copyright (C) 2011-2020 Torsten Albrecht and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -19,6 +19,7 @@
 #include "IceModel.hh"
 
 #include "pism/energy/EnergyModel.hh"
+#include "pism/stressbalance/StressBalance.hh"
 #include "pism/stressbalance/ShallowStressBalance.hh"
 #include "pism/fracturedensity/FractureDensity.hh"
 
@@ -61,20 +62,18 @@ void IceModel::update_fracture_density() {
     } // end of the loop over grid points
   }
 
-  // compute the vertically-averaged ice hardness
-  auto &hardness = m_work2d[1];
-  {
-    rheology::averaged_hardness_vec(*m_stress_balance->shallow()->flow_law(),
-                                    m_geometry.ice_thickness,
-                                    m_energy_model->enthalpy(),
-                                    hardness);
-  }
+  // strain rates and deviatoric stresses are computed by the stress balance model (and
+  // shared with other components using them)
+  const auto &strain_rates = m_stress_balance->principal_strain_rates(m_geometry.cell_type);
+  const auto &deviatoric_stresses = m_stress_balance->deviatoric_stresses(m_geometry.cell_type,
+                                                                          m_geometry.ice_thickness,
+                                                                          m_energy_model->enthalpy());
 
   // This model has the same time-step restriction as the mass transport code so we don't
   // check if this time step is short enough.
   m_fracture->update(m_dt, m_geometry,
                      m_stress_balance->shallow()->velocity(),
-                     hardness, bc_mask);
+                     strain_rates, deviatoric_stresses, bc_mask);
 }
 
 } // end of namespace pism
@@ -16,6 +16,8 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>            // std::min
+
 #include "IceModel.hh"
 
 #include "pism/util/IceGrid.hh"
@@ -40,6 +42,41 @@
 
 namespace pism {
 
+/*!
+ * Apply the retreat rate `retreat_rate` during the time step `dt`.
+ *
+ * If `subcycle` is true, take sub-steps satisfying the front retreat CFL criterion,
+ * updating the cell type mask after each one, so that a fast-moving front does not have to
+ * restrict the time step of the whole model.
+ */
+static void apply_retreat_rate(FrontRetreat &front_retreat,
+                               double dt,
+                               bool subcycle,
+                               const IceModelVec2Int &bc_mask,
+                               const IceModelVec2S &retreat_rate,
+                               double thickness_threshold,
+                               Geometry &geometry) {
+  double t = 0.0;
+  while (t < dt) {
+    double step = dt - t;
+    if (subcycle) {
+      step = std::min(step,
+                      front_retreat.max_timestep(geometry.cell_type,
+                                                 bc_mask, retreat_rate).value());
+    }
+
+    front_retreat.update_geometry(step, geometry, bc_mask, retreat_rate,
+                                  geometry.ice_area_specific_volume,
+                                  geometry.ice_thickness);
+    t += step;
+
+    if (t < dt) {
+      // the next sub-step uses the new position of the front
+      geometry.ensure_consistency(thickness_threshold);
+    }
+  }
+}
+
 void IceModel::front_retreat_step() {
   const bool
     add_values    = true,
@@ -88,6 +125,12 @@ void IceModel::front_retreat_step() {
     &old_H    = m_work2d[0],
     &old_Href = m_work2d[1];
 
+  const bool subcycle = (m_config->get_flag("geometry.front_retreat.use_cfl") and
+                         m_config->get_flag("geometry.front_retreat.subcycle"));
+
+  const double thickness_threshold =
+    m_config->get_number("stress_balance.ice_free_thickness_standard");
+
   // frontal melt
   if (m_frontal_melt) {
     assert(m_front_retreat);
@@ -96,10 +139,8 @@ void IceModel::front_retreat_step() {
     old_Href.copy_from(m_geometry.ice_area_specific_volume);
 
     // apply frontal melt rate
-    m_front_retreat->update_geometry(m_dt, m_geometry, m_ssa_dirichlet_bc_mask,
-                                     m_frontal_melt->retreat_rate(),
-                                     m_geometry.ice_area_specific_volume,
-                                     m_geometry.ice_thickness);
+    apply_retreat_rate(*m_front_retreat, m_dt, subcycle, m_ssa_dirichlet_bc_mask,
+                       m_frontal_melt->retreat_rate(), thickness_threshold, m_geometry);
 
     compute_geometry_change(m_geometry.ice_thickness,
                             m_geometry.ice_area_specific_volume,
@@ -135,12 +176,8 @@ void IceModel::front_retreat_step() {
         retreat_rate.add(1.0, m_vonmises_calving->calving_rate());
       }
 
-      m_front_retreat->update_geometry(m_dt, m_geometry, m_ssa_dirichlet_bc_mask,
-                                       retreat_rate,
-                                       m_geometry.ice_area_specific_volume,
-                                       m_geometry.ice_thickness);
-
-      auto thickness_threshold = m_config->get_number("stress_balance.ice_free_thickness_standard");
+      apply_retreat_rate(*m_front_retreat, m_dt, subcycle, m_ssa_dirichlet_bc_mask,
+                         retreat_rate, thickness_threshold, m_geometry);
 
       m_geometry.ensure_consistency(thickness_threshold);
 
@@ -43,6 +43,7 @@
 #include "pism/util/Time.hh"
 #include "pism/util/error_handling.hh"
 #include "pism/util/io/File.hh"
+#include "pism/util/io/NC3AsyncFile.hh"
 #include "pism/util/pism_options.hh"
 #include "pism/coupler/OceanModel.hh"
 #include "pism/coupler/SurfaceModel.hh"
@@ -57,6 +58,9 @@
 #include "pism/earth/BedDef.hh"
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/util/Vars.hh"
+#include "pism/util/RegriddingSource.hh"
+#include "pism/util/MemoryTracker.hh"
+#include "pism/util/Profiling.hh"
 #include "pism/util/io/io_helpers.hh"
 #include "pism/util/projection.hh"
 #include "pism/util/pism_utilities.hh"
@@ -340,9 +344,9 @@ void IceModel::restart_2d(const File &input_file, unsigned int last_record) {
 
   m_log->message(2, "initializing 2D fields from NetCDF file '%s'...\n", filename.c_str());
 
-  for (auto variable : m_model_state) {
-    variable->read(input_file, last_record);
-  }
+  // read all fields at once to allow combining reads (see read_fields())
+  std::vector<IceModelVec*> fields(m_model_state.begin(), m_model_state.end());
+  read_fields(input_file, last_record, fields);
 }
 
 void IceModel::bootstrap_2d(const File &input_file) {
@@ -446,6 +450,21 @@ void IceModel::regrid() {
   auto filename    = m_config->get_string("input.regrid.file");
   auto regrid_vars = set_split(m_config->get_string("input.regrid.vars"), ',');
 
+  // Interpolate from a model on a different grid (see refine()):
+  const RegriddingSource *source = m_grid->regridding_source();
+  if (source != nullptr) {
+    m_log->message(2, "interpolating model state variables ...\n");
+
+    for (auto v : m_model_state) {
+      const IceModelVec *field = source->get(v->get_name());
+
+      if (field != nullptr and (regrid_vars.empty() or member(v->get_name(), regrid_vars))) {
+        v->regrid(*field);
+      }
+    }
+    return;
+  }
+
   // Return if no regridding is requested:
   if (filename.empty()) {
      return;
@@ -647,30 +666,69 @@ void IceModel::allocate_basal_yield_stress() {
   setting up the coupling or filling model-state variables.
  */
 void IceModel::allocate_submodels() {
+  // Each sub-model owns fields it allocates (see MemoryTracker and the -memory_report
+  // option).
+  const MemoryTracker &memory = m_ctx->memory();
 
-  allocate_geometry_evolution();
+  {
+    MemoryTracker::Owner owner(memory, "geometry_evolution");
+    allocate_geometry_evolution();
+  }
 
-  allocate_iceberg_remover();
+  {
+    MemoryTracker::Owner owner(memory, "iceberg_remover");
+    allocate_iceberg_remover();
+  }
 
-  allocate_stressbalance();
+  {
+    MemoryTracker::Owner owner(memory, "stress_balance");
+    allocate_stressbalance();
+  }
 
   // this has to happen *after* allocate_stressbalance()
   {
+    MemoryTracker::Owner owner(memory, "age");
     allocate_age_model();
+  }
+  {
+    MemoryTracker::Owner owner(memory, "energy");
     allocate_energy_model();
+  }
+
+  // Update age in the same sweep over columns as enthalpy, if the energy model supports
+  // this (IceModel::step() updates age separately otherwise).
+  if (m_age_model and m_age_model->column_based()) {
+    m_energy_model->set_age_model(m_age_model.get());
+  }
+
+  {
+    MemoryTracker::Owner owner(memory, "hydrology");
     allocate_subglacial_hydrology();
   }
 
   // this has to happen *after* allocate_subglacial_hydrology()
-  allocate_basal_yield_stress();
+  {
+    MemoryTracker::Owner owner(memory, "basal_yield_stress");
+    allocate_basal_yield_stress();
+  }
 
-  allocate_bedrock_thermal_unit();
+  {
+    MemoryTracker::Owner owner(memory, "bedrock_thermal_unit");
+    allocate_bedrock_thermal_unit();
+  }
 
-  allocate_bed_deformation();
+  {
+    MemoryTracker::Owner owner(memory, "bed_deformation");
+    allocate_bed_deformation();
+  }
 
-  allocate_couplers();
+  {
+    MemoryTracker::Owner owner(memory, "couplers");
+    allocate_couplers();
+  }
 
   if (m_config->get_flag("fracture_density.enabled")) {
+    MemoryTracker::Owner owner(memory, "fracture_density");
     m_fracture.reset(new FractureDensity(m_grid, m_stress_balance->shallow()->flow_law()));
     m_submodels["fracture_density"] = m_fracture.get();
   }
@@ -764,6 +822,11 @@ void IceModel::misc_setup() {
     }
   }
 
+  if (m_config->get_string("output.format") == "netcdf3_async") {
+    const double MiB = 1024.0 * 1024.0;
+    io::NC3AsyncFile::set_memory_budget(m_config->get_number("output.async.memory_budget") * MiB);
+  }
+
   m_output_vars = output_variables(m_config->get_string("output.size"));
 
 #if (Pism_USE_PROJ==1)
@@ -779,11 +842,15 @@ void IceModel::misc_setup() {
   init_calving();
   init_frontal_melt();
   init_front_retreat();
-  init_diagnostics();
   init_snapshots();
   init_backups();
-  init_timeseries();
   init_extras();
+  {
+    // uses lists of variables set by init_snapshots(), init_backups(), init_extras()
+    Profiling::Scope diagnostics(m_ctx->profiling(), "init_diagnostics");
+    init_diagnostics();
+  }
+  init_timeseries();
 
   // a report on whether PISM-PIK modifications of IceModel are in use
   {
@@ -974,7 +1041,7 @@ void IceModel::allocate_bed_deformation() {
   else if (model == "iso") {
     m_beddef = new bed::PointwiseIsostasy(m_grid);
   }
-  else if (model == "lc") {
+  else if (model == "lc" or model == "lc_mpi") {
     m_beddef = new bed::LingleClark(m_grid);
   }
 
@@ -25,6 +25,7 @@
 #include "IceModel.hh"
 
 #include "pism/util/IceGrid.hh"
+#include "pism/util/Coarsening.hh"
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/Diagnostic.hh"
 #include "pism/util/Time.hh"
@@ -34,6 +35,7 @@
 
 #include "pism/util/Vars.hh"
 #include "pism/util/io/io_helpers.hh"
+#include "pism/util/io/Patches.hh"
 #include "pism/util/Profiling.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/projection.hh"
@@ -136,6 +138,10 @@ void IceModel::save_results() {
               PISM_READWRITE_MOVE,
               m_ctx->pio_iosys_id());
 
+    if (m_config->get_flag("output.patches")) {
+      file.set_patch_writer(std::make_shared<io::PatchWriter>(file, *m_grid));
+    }
+
     write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
 
     write_run_stats(file);
@@ -176,7 +182,21 @@ void IceModel::save_variables(const File &file,
                               OutputKind kind,
                               const std::set<std::string> &variables,
                               double time,
-                              IO_Type default_diagnostics_type) {
+                              IO_Type default_diagnostics_type,
+                              IceGrid::ConstPtr output_grid) {
+
+  if (m_3d_velocity_is_stale) {
+    // 3D velocities were not updated because nothing else needed them (see
+    // stress_balance.on_demand_3d_velocity). Update them now, using the current
+    // geometry, so that the output file contains velocities consistent with it. The
+    // shallow stress balance is not re-solved: 3D velocities are re-constructed from its
+    // current velocity.
+    m_stress_balance->update_3d(stress_balance_inputs());
+    m_3d_velocity_is_stale = false;
+  }
+  // strain heating is not updated during time steps if the energy balance model is
+  // disabled
+  m_stress_balance->update_strain_heating(stress_balance_inputs());
 
   // define the time dimension if necessary (no-op if it is already defined)
   io::define_time(file, *m_grid->ctx());
@@ -195,7 +215,11 @@ void IceModel::save_variables(const File &file,
   if (kind == INCLUDE_MODEL_STATE) {
     define_model_state(file);
   }
-  define_diagnostics(file, variables, default_diagnostics_type);
+  if (not output_grid) {
+    define_diagnostics(file, variables, default_diagnostics_type);
+  }
+  // Coarsened diagnostics are defined when they are written: the coarse grid does not
+  // know their metadata before they are computed.
 
   // Done defining variables
 
@@ -238,7 +262,11 @@ void IceModel::save_variables(const File &file,
   if (kind == INCLUDE_MODEL_STATE) {
     write_model_state(file);
   }
-  write_diagnostics(file, variables);
+  if (output_grid) {
+    write_coarsened_diagnostics(file, variables, output_grid, default_diagnostics_type);
+  } else {
+    write_diagnostics(file, variables);
+  }
 
   // find out how much time passed since the beginning of the run and save it to the output file
   {
@@ -247,6 +275,10 @@ void IceModel::save_variables(const File &file,
     io::write_timeseries(file, m_timestamp, start,
                          wall_clock_hours(m_grid->com, m_start_time));
   }
+
+  // complete all writes of this output event at once (the PnetCDF backend uses
+  // non-blocking writes)
+  file.wait_all();
 }
 
 void IceModel::define_diagnostics(const File &file, const std::set<std::string> &variables,
@@ -267,7 +299,27 @@ void IceModel::write_diagnostics(const File &file, const std::set<std::string> &
     auto diag = m_diagnostics.find(variable);
 
     if (diag != m_diagnostics.end()) {
-      diag->second->compute()->write(file);
+      diag->second->write(file);
+    }
+  }
+}
+
+/*!
+ * Write block means of diagnostics listed in `variables` on the grid `output_grid` (see
+ * coarse_grid()).
+ */
+void IceModel::write_coarsened_diagnostics(const File &file,
+                                           const std::set<std::string> &variables,
+                                           IceGrid::ConstPtr output_grid,
+                                           IO_Type default_type) {
+  for (auto variable : variables) {
+    auto diag = m_diagnostics.find(variable);
+
+    if (diag != m_diagnostics.end()) {
+      auto field = coarsen(*diag->second->compute(), output_grid);
+
+      field->define(file, default_type);
+      field->write(file);
     }
   }
 }
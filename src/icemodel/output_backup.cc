@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2019 PISM Authors
+/* Copyright (C) 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -21,6 +21,8 @@
 
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/io/Patches.hh"
+#include "pism/util/io/DeltaEncoder.hh"
 
 namespace pism {
 
@@ -36,6 +38,65 @@ void IceModel::init_backups() {
 
   m_backup_vars = output_variables(m_config->get_string("output.backup_size"));
   m_last_backup_time = 0.0;
+
+  m_backup_delta.reset();
+  m_backup_delta_count = 0;
+}
+
+/*!
+ * Write a backup to `filename`.
+ *
+ * If `encoder` is not NULL spatial variables are written as differences from its base
+ * file (or recorded, if the base file is being written).
+ */
+void IceModel::write_backup_file(const std::string &filename,
+                                 std::shared_ptr<io::DeltaEncoder> encoder) {
+  File file(m_grid->com,
+            filename,
+            string_to_backend(m_config->get_string("output.format")),
+            PISM_READWRITE_MOVE,
+            m_ctx->pio_iosys_id());
+
+  if (m_config->get_flag("output.patches")) {
+    file.set_patch_writer(std::make_shared<io::PatchWriter>(file, *m_grid));
+  }
+
+  write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
+  write_run_stats(file);
+
+  if (encoder) {
+    file.set_delta_encoder(encoder);
+
+    const std::string &base = encoder->base_filename();
+    if (filename != base) {
+      // the base file is in the same directory
+      auto slash = base.rfind('/');
+      file.write_attribute("PISM_GLOBAL", "pism_delta_base",
+                           slash == std::string::npos ? base : base.substr(slash + 1));
+    }
+  }
+
+  save_variables(file, INCLUDE_MODEL_STATE, m_backup_vars, m_time->current());
+}
+
+/*!
+ * Save a checkpoint (variables selected using `output.backup_size`) to `filename` and
+ * flush time-series.
+ *
+ * Unlike write_backup() this writes a complete file every time and does not depend on the
+ * wall clock time.
+ */
+void IceModel::save_checkpoint(const std::string &filename) {
+  const Profiling &profiling = m_ctx->profiling();
+
+  m_log->message(2, "  [%s] Saving a checkpoint to '%s'...\n",
+                 timestamp(m_grid->com).c_str(), filename.c_str());
+
+  profiling.begin("io.backup");
+  write_backup_file(filename, nullptr);
+  profiling.end("io.backup");
+
+  flush_timeseries();
 }
 
   //! Write a backup (i.e. an intermediate result of a run).
@@ -62,16 +123,25 @@ void IceModel::write_backup() {
   double backup_start_time = get_time();
   profiling.begin("io.backup");
   {
-    File file(m_grid->com,
-              m_backup_filename,
-              string_to_backend(m_config->get_string("output.format")),
-              PISM_READWRITE_MOVE,
-              m_ctx->pio_iosys_id());
+    int n_deltas = m_config->get_number("output.backup_deltas");
+
+    if (n_deltas > 0 and (not m_backup_delta or m_backup_delta_count >= n_deltas)) {
+      // write a new full backup to use as the base for the following ones
+      std::string base = filename_add_suffix(m_backup_filename, "_base", "");
+
+      m_backup_delta = std::make_shared<io::DeltaEncoder>(base);
+      write_backup_file(base, m_backup_delta);
+      m_backup_delta->stop_recording();
 
-    write_metadata(file, WRITE_MAPPING, PREPEND_HISTORY);
-    write_run_stats(file);
+      m_backup_delta_count = 0;
+    }
 
-    save_variables(file, INCLUDE_MODEL_STATE, m_backup_vars, m_time->current());
+    if (n_deltas > 0) {
+      write_backup_file(m_backup_filename, m_backup_delta);
+      m_backup_delta_count += 1;
+    } else {
+      write_backup_file(m_backup_filename, nullptr);
+    }
   }
   profiling.end("io.backup");
   double backup_end_time = get_time();
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::min, std::max
 #include <netcdf.h>
 #ifdef NC_HAVE_META_H
 #include <netcdf_meta.h>
@@ -27,6 +28,10 @@
 #include "pism/util/pism_options.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/Coarsening.hh"
+#include "pism/util/io/io_helpers.hh"
+#include "pism/util/io/NC3AsyncFile.hh"
+#include "pism/util/petscwrappers/Vec.hh"
 
 namespace pism {
 
@@ -34,6 +39,7 @@ namespace pism {
 MaxTimestep IceModel::extras_max_timestep(double my_t) {
 
   if ((not m_save_extra) or
+      m_extra_interpolate or
       (not m_config->get_flag("time_stepping.hit_extra_times"))) {
     return MaxTimestep("reporting (-extra_times)");
   }
@@ -227,22 +233,352 @@ void IceModel::init_extras() {
     m_log->message(2,
                    "PISM WARNING: output.extra.vars was not set. Writing the model state...\n");
   } // end of the else clause after "if (extra_vars_set)"
+
+  int coarsening_factor = m_config->get_number("output.extra.coarsening_factor");
+  if (coarsening_factor < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "output.extra.coarsening_factor has to be positive (got %d)",
+                                  coarsening_factor);
+  }
+
+  if (coarsening_factor > 1) {
+    if (m_extra_vars.empty()) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "output.extra.coarsening_factor requires output.extra.vars:"
+                         " the model state cannot be coarsened");
+    }
+
+    m_extra_grid = coarse_grid(*m_grid, coarsening_factor);
+
+    m_log->message(2, "coarsening spatial time-series by the factor of %d (%d x %d grid)\n",
+                   coarsening_factor, m_extra_grid->Mx(), m_extra_grid->My());
+  }
+
+  m_extra_interpolate = m_config->get_flag("output.extra.interpolate");
+  if (m_extra_interpolate) {
+    if (m_extra_vars.empty()) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "output.extra.interpolate requires output.extra.vars:"
+                         " the model state cannot be interpolated in time");
+    }
+
+    m_log->message(2, "interpolating spatial time-series in time\n");
+  }
+}
+
+//! Name of the file containing the record saved at `date` if output.extra.split is set.
+static std::string split_extra_filename(const std::string &prefix, const std::string &date) {
+  return pism::printf("%s_%s.nc", prefix.c_str(), date.c_str());
+}
+
+/*!
+ * Open (or create) the extra file and write metadata that does not depend on the record:
+ * the time dimension, time bounds, the configuration, and the mapping.
+ */
+void IceModel::prepare_extra_file(const std::string &filename, IO_Mode mode) {
+  m_extra_file.reset(new File(m_grid->com,
+                              filename,
+                              string_to_backend(m_config->get_string("output.format")),
+                              mode,
+                              m_ctx->pio_iosys_id()));
+
+  io::define_time(*m_extra_file, *m_ctx);
+  m_extra_file->write_attribute(m_config->get_string("time.dimension_name"),
+                                "bounds", "time_bounds");
+
+  io::define_time_bounds(m_extra_bounds, *m_extra_file);
+
+  write_metadata(*m_extra_file, WRITE_MAPPING, PREPEND_HISTORY);
+
+  m_extra_file_is_ready = true;
+}
+
+/*!
+ * Close and remove the file created in advance for the next record if output.extra.split
+ * is set (see write_extras()).
+ */
+void IceModel::discard_extra_file() {
+  if (not (m_split_extra and m_extra_file)) {
+    return;
+  }
+
+  std::string filename = m_extra_file->filename();
+
+  m_extra_file.reset(nullptr);
+  m_extra_file_is_ready = false;
+
+  io::NC3AsyncFile::wait(filename);
+  io::remove_if_exists(m_grid->com, filename);
+}
+
+/*!
+ * Interpolate in time: `current` <- `weight` * `current` + (1 - `weight`) * `previous`.
+ *
+ * Integer-valued fields (masks) and points where one of the two values is the fill value
+ * (e.g. ice velocity in ice-free areas) use the value at the nearest time step instead.
+ */
+static void interpolate_in_time(IceModelVec &previous, double weight, IceModelVec &current) {
+  const bool nearest = dynamic_cast<IceModelVec2Int*>(&current) != nullptr;
+
+  const SpatialVariableMetadata &metadata = current.metadata(0);
+  const bool has_fill_value = metadata.has_attribute("_FillValue");
+  const double fill_value = has_fill_value ? metadata.get_number("_FillValue") : 0.0;
+
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(current.vec(), &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  petsc::VecArray P(previous.vec()), C(current.vec());
+  const double *p = P.get();
+  double *c = C.get();
+
+  for (PetscInt k = 0; k < size; ++k) {
+    if (nearest or (has_fill_value and (p[k] == fill_value or c[k] == fill_value))) {
+      c[k] = weight < 0.5 ? p[k] : c[k];
+    } else {
+      c[k] = weight * c[k] + (1.0 - weight) * p[k];
+    }
+  }
+}
+
+/*!
+ * Write requested diagnostics interpolated in time between the end of the previous time
+ * step (see buffer_extras()) and the current time.
+ *
+ * Time-averaged diagnostics are not interpolated: they are averages over time steps making
+ * up the current reporting interval.
+ */
+void IceModel::write_interpolated_diagnostics(const File &file, double weight) {
+  for (auto variable : m_extra_vars) {
+    auto diag = m_diagnostics.find(variable);
+
+    if (diag == m_diagnostics.end()) {
+      continue;
+    }
+
+    IceModelVec::Ptr field = diag->second->compute();
+
+    auto previous = m_extra_buffer.find(variable);
+    if (previous != m_extra_buffer.end()) {
+      interpolate_in_time(*previous->second, weight, *field);
+    }
+
+    if (m_extra_grid) {
+      auto coarse = coarsen(*field, m_extra_grid);
+
+      coarse->define(file, PISM_FLOAT);
+      coarse->write(file);
+    } else {
+      field->write(file);
+    }
+  }
+}
+
+/*!
+ * Save requested diagnostics at the end of the current time step so that the next record
+ * can be interpolated in time (see output.extra.interpolate).
+ */
+void IceModel::buffer_extras() {
+  if (m_next_extra >= m_extra_times.size()) {
+    // no more records to write
+    m_extra_buffer.clear();
+    return;
+  }
+
+  if (m_3d_velocity_is_stale) {
+    // see save_variables()
+    m_stress_balance->update_3d(stress_balance_inputs());
+    m_3d_velocity_is_stale = false;
+  }
+  m_stress_balance->update_strain_heating(stress_balance_inputs());
+
+  for (auto variable : m_extra_vars) {
+    auto diag = m_diagnostics.find(variable);
+
+    if (diag != m_diagnostics.end() and not diag->second->time_averaged()) {
+      m_extra_buffer[variable] = diag->second->compute();
+    }
+  }
+
+  m_extra_buffer_time = m_time->current();
+}
+
+/*!
+ * Write spatially-variable diagnostic quantities for all requested times passed during
+ * the last time step, interpolating in time. See output.extra.interpolate.
+ *
+ * Time steps are not modified to hit requested times in this case (see
+ * extras_max_timestep()), so one step may cover several requested times.
+ */
+void IceModel::write_interpolated_extras() {
+  const double
+    t_previous = m_extra_buffer_time,
+    t_current  = m_time->current();
+
+  bool record_written = false;
+
+  while (m_next_extra < m_extra_times.size() and
+         (m_extra_times[m_next_extra] <= t_current or
+          fabs(t_current - m_extra_times[m_next_extra]) < 1.0)) {
+    const double time = m_extra_times[m_next_extra];
+    const unsigned int current_extra = m_next_extra;
+
+    m_next_extra++;
+
+    if (current_extra == 0) {
+      // The first time defines the left end-point of the first reporting interval (see
+      // write_extras()).
+      m_last_extra = time;
+
+      if (not m_config->get_flag("output.ISMIP6")) {
+        continue;
+      }
+    }
+
+    if (time < m_time->start()) {
+      // this record was written before the run was re-started (see write_extras())
+      continue;
+    }
+
+    double weight = 1.0;
+    if (not m_extra_buffer.empty() and t_current > t_previous) {
+      weight = std::min(std::max((time - t_previous) / (t_current - t_previous), 0.0), 1.0);
+    }
+
+    write_extra_record(time, weight);
+    record_written = true;
+  }
+
+  if (record_written) {
+    // reset accumulators in diagnostics that compute time averaged quantities
+    reset_diagnostics();
+  }
+
+  buffer_extras();
+}
+
+/*!
+ * Write the record corresponding to `time` to the extra file.
+ *
+ * Diagnostics are interpolated in time (see write_interpolated_diagnostics()) if `weight`
+ * is less than one.
+ */
+void IceModel::write_extra_record(double time, double weight) {
+  std::string filename;
+
+  if (m_split_extra) {
+    // each time-series record is written to a separate file
+    filename = split_extra_filename(m_extra_filename, m_time->date(time));
+
+    if (m_extra_file and m_extra_file->filename() != filename) {
+      // the file created in advance does not match the current time (this happens if
+      // time steps do not hit requested times)
+      discard_extra_file();
+    }
+  } else {
+    filename = m_extra_filename;
+  }
+
+  m_log->message(3,
+                 "saving spatial time-series to %s at %s\n",
+                 filename.c_str(), m_time->date(time).c_str());
+
+  // default behavior is to move the file aside if it exists already; option allows appending
+  bool append = m_config->get_flag("output.extra.append");
+  IO_Mode mode = m_extra_file_is_ready or append ? PISM_READWRITE : PISM_READWRITE_MOVE;
+
+  const Profiling &profiling = m_ctx->profiling();
+  profiling.begin("io.extra_file");
+  {
+    if (not m_extra_file) {
+      prepare_extra_file(filename, mode);
+    }
+
+    std::string time_name = m_config->get_string("time.dimension_name");
+
+    write_run_stats(*m_extra_file);
+
+    // use the mid-point of the current reporting interval
+    const double record_time = 0.5 * (m_last_extra + time);
+
+    if (weight < 1.0) {
+      // Define interpolated diagnostics first so that save_variables() sets their
+      // "coordinates" attribute. Coarsened diagnostics are defined when they are written.
+      io::define_time(*m_extra_file, *m_ctx);
+      if (not m_extra_grid) {
+        define_diagnostics(*m_extra_file, m_extra_vars, PISM_FLOAT);
+      }
+
+      save_variables(*m_extra_file, JUST_DIAGNOSTICS, {}, record_time, PISM_FLOAT, m_extra_grid);
+
+      write_interpolated_diagnostics(*m_extra_file, weight);
+    } else {
+      save_variables(*m_extra_file,
+                     m_extra_vars.empty() ? INCLUDE_MODEL_STATE : JUST_DIAGNOSTICS,
+                     m_extra_vars,
+                     record_time,
+                     PISM_FLOAT,
+                     m_extra_grid);
+    }
+
+    // Get the length of the time dimension *after* it is appended to.
+    unsigned int time_length = m_extra_file->dimension_length(time_name);
+    size_t time_start = time_length > 0 ? static_cast<size_t>(time_length - 1) : 0;
+
+    io::write_time_bounds(*m_extra_file, m_extra_bounds,
+                          time_start, {m_last_extra, time});
+    // make sure all changes are written
+    m_extra_file->sync();
+  }
+  profiling.end("io.extra_file");
+
+  flush_timeseries();
+
+  if (m_split_extra) {
+    // each record is saved to a new file, so we can close this one
+    m_extra_file.reset(nullptr);
+    m_extra_file_is_ready = false;
+
+    // create the file for the next record in the background
+    if (m_config->get_string("output.format") == "netcdf3_async" and
+        m_next_extra < m_extra_times.size() and
+        m_extra_times[m_next_extra] <= m_time->end()) {
+      std::string next = split_extra_filename(m_extra_filename,
+                                              m_time->date(m_extra_times[m_next_extra]));
+      prepare_extra_file(next, append ? PISM_READWRITE : PISM_READWRITE_MOVE);
+    }
+  }
+
+  m_last_extra = time;
 }
 
 //! Write spatially-variable diagnostic quantities.
+/*!
+ * If output.extra.split is set and output.format is "netcdf3_async", the file for the
+ * next record is created (and its metadata is written) by a background thread right after
+ * the current record is written. This way the cost of creating a file per record is
+ * hidden behind the computation.
+ *
+ * If output.extra.interpolate is set, writes all records passed during the last time step
+ * (see write_interpolated_extras()).
+ */
 void IceModel::write_extras() {
   double saving_after = -1.0e30; // initialize to avoid compiler warning; this
                                  // value is never used, because saving_after
                                  // is only used if save_now == true, and in
                                  // this case saving_after is guaranteed to be
                                  // initialized. See the code below.
-  char filename[PETSC_MAX_PATH_LEN];
   unsigned int current_extra;
   // determine if the user set the -save_at and -save_to options
   if (not m_save_extra) {
     return;
   }
 
+  if (m_extra_interpolate) {
+    write_interpolated_extras();
+    return;
+  }
+
   double current_time = m_time->current();
 
   // do we need to save *now*?
@@ -294,75 +630,7 @@ void IceModel::write_extras() {
     return;
   }
 
-  if (m_split_extra) {
-    m_extra_file_is_ready = false;        // each time-series record is written to a separate file
-    snprintf(filename, PETSC_MAX_PATH_LEN, "%s_%s.nc",
-             m_extra_filename.c_str(), m_time->date().c_str());
-  } else {
-    strncpy(filename, m_extra_filename.c_str(), PETSC_MAX_PATH_LEN);
-  }
-
-  m_log->message(3,
-                 "saving spatial time-series to %s at %s\n",
-                 filename, m_time->date().c_str());
-
-  // default behavior is to move the file aside if it exists already; option allows appending
-  bool append = m_config->get_flag("output.extra.append");
-  IO_Mode mode = m_extra_file_is_ready or append ? PISM_READWRITE : PISM_READWRITE_MOVE;
-
-  const Profiling &profiling = m_ctx->profiling();
-  profiling.begin("io.extra_file");
-  {
-    if (not m_extra_file) {
-      m_extra_file.reset(new File(m_grid->com,
-                                  filename,
-                                  string_to_backend(m_config->get_string("output.format")),
-                                  mode,
-                                  m_ctx->pio_iosys_id()));
-    }
-
-    std::string time_name = m_config->get_string("time.dimension_name");
-
-    if (not m_extra_file_is_ready) {
-      // Prepare the file:
-      io::define_time(*m_extra_file, *m_ctx);
-      m_extra_file->write_attribute(time_name, "bounds", "time_bounds");
-
-      io::define_time_bounds(m_extra_bounds, *m_extra_file);
-
-      write_metadata(*m_extra_file, WRITE_MAPPING, PREPEND_HISTORY);
-
-      m_extra_file_is_ready = true;
-    }
-
-    write_run_stats(*m_extra_file);
-
-    save_variables(*m_extra_file,
-                   m_extra_vars.empty() ? INCLUDE_MODEL_STATE : JUST_DIAGNOSTICS,
-                   m_extra_vars,
-                   0.5 * (m_last_extra + current_time), // use the mid-point of the
-                                                        // current reporting interval
-                   PISM_FLOAT);
-
-    // Get the length of the time dimension *after* it is appended to.
-    unsigned int time_length = m_extra_file->dimension_length(time_name);
-    size_t time_start = time_length > 0 ? static_cast<size_t>(time_length - 1) : 0;
-
-    io::write_time_bounds(*m_extra_file, m_extra_bounds,
-                          time_start, {m_last_extra, current_time});
-    // make sure all changes are written
-    m_extra_file->sync();
-  }
-  profiling.end("io.extra_file");
-
-  flush_timeseries();
-
-  if (m_split_extra) {
-    // each record is saved to a new file, so we can close this one
-    m_extra_file.reset(nullptr);
-  }
-
-  m_last_extra = current_time;
+  write_extra_record(current_time, 1.0);
 
   // reset accumulators in diagnostics that compute time averaged quantities
   reset_diagnostics();
@@ -1,4 +1,4 @@
-/* Copyright (C) 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -38,9 +38,38 @@ static std::set<std::string> process_ts_shortcuts(const Config &config,
     }
   }
 
+  if (result.find("perf") != result.end()) {
+    result.erase("perf");
+    for (auto v : set_split(config.get_string("output.timeseries.performance_variables"), ',')) {
+      result.insert(v);
+    }
+  }
+
   return result;
 }
 
+/*!
+ * Names of requested scalar diagnostics.
+ *
+ * Sets `all` to true if all scalar diagnostics are requested (i.e. -ts_file is set but
+ * -ts_vars is not).
+ */
+std::set<std::string> IceModel::requested_ts_diagnostics(bool &all) const {
+  all = false;
+
+  if (m_config->get_string("output.timeseries.filename").empty()) {
+    return {};
+  }
+
+  auto result = set_split(m_config->get_string("output.timeseries.variables"), ',');
+  if (result.empty()) {
+    all = true;
+    return result;
+  }
+
+  return process_ts_shortcuts(*m_config, result);
+}
+
 //! Initializes the code writing scalar time-series.
 void IceModel::init_timeseries() {
 
@@ -115,18 +144,41 @@ MaxTimestep IceModel::ts_max_timestep(double my_t) {
   return reporting_max_timestep(*m_ts_times, my_t, "reporting (-ts_times)");
 }
 
-//! Flush scalar time-series.
+/*!
+ * Flush scalar time-series.
+ *
+ * Opens the output file once to write all buffered records and update run_stats. Writes
+ * are performed by a background thread if output.format is "netcdf3_async".
+ */
 void IceModel::flush_timeseries() {
+  if (m_ts_diagnostics.empty()) {
+    return;
+  }
+
+  IO_Backend backend = PISM_NETCDF3;
+  if (m_config->get_string("output.format") == "netcdf3_async") {
+    backend = PISM_NETCDF3_ASYNC;
+  }
+
+  File file(m_grid->com, m_ts_filename, backend, PISM_READWRITE);
+
   // flush all the time-series buffers:
-  for (auto d : m_ts_diagnostics) {
-    d.second->flush();
+  {
+    std::string time_name = m_config->get_string("time.dimension_name");
+
+    unsigned int n_records = file.dimension_length(time_name);
+    double last_time = 0.0;
+    if (n_records > 0) {
+      last_time = vector_max(file.read_dimension(time_name));
+    }
+
+    for (auto d : m_ts_diagnostics) {
+      d.second->flush(file, n_records, last_time);
+    }
   }
 
   // update run_stats in the time series output file
-  if (not m_ts_diagnostics.empty()) {
-    File file(m_grid->com, m_ts_filename, PISM_NETCDF3, PISM_READWRITE);
-    write_run_stats(file);
-  }
+  write_run_stats(file);
 }
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -18,12 +18,14 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>            // std::upper_bound
 
 #include <petscsys.h>
 
 #include "IceModel.hh"
 
 #include "pism/stressbalance/StressBalance.hh"
+#include "pism/stressbalance/SSB_Modifier.hh"
 
 #include "pism/util/IceGrid.hh"
 #include "pism/util/ConfigInterface.hh"
@@ -56,13 +58,20 @@ unsigned int count_CFL_violations(const IceModelVec3 &u3,
 
   IceModelVec::AccessList list{&ice_thickness, &u3, &v3};
 
+  // 3D velocity may use a subset (indices K) of grid levels (see stress_balance.Mz)
+  const std::vector<unsigned int> K = stressbalance::velocity_level_indices(*grid);
+  const bool all_levels = (K.size() == grid->Mz());
+
   unsigned int CFL_violation_count = 0;
   ParallelSection loop(grid->com);
   try {
     for (Points p(*grid); p; p.next()) {
       const int i = p.i(), j = p.j();
 
-      const int ks = grid->kBelowHeight(ice_thickness(i,j));
+      int ks = grid->kBelowHeight(ice_thickness(i,j));
+      if (not all_levels) {
+        ks = (std::upper_bound(K.begin(), K.end(), (unsigned int)ks) - K.begin()) - 1;
+      }
 
       const double
         *u = u3.get_column(i, j),
@@ -92,8 +101,14 @@ void IceModel::print_summary(bool tempAndAge) {
     &u3 = m_stress_balance->velocity_u(),
     &v3 = m_stress_balance->velocity_v();
 
-  unsigned int n_CFL_violations = count_CFL_violations(u3, v3, m_geometry.ice_thickness,
-                                                       tempAndAge ? dt_TempAge : m_dt);
+  // 3D velocities are not up to date if they were skipped during the last "full" stress
+  // balance update (see stress_balance.on_demand_3d_velocity); nothing used them, so
+  // there is nothing to report
+  unsigned int n_CFL_violations = 0;
+  if (not m_3d_velocity_is_stale) {
+    n_CFL_violations = count_CFL_violations(u3, v3, m_geometry.ice_thickness,
+                                            tempAndAge ? dt_TempAge : m_dt);
+  }
 
   // report CFL violations
   if (n_CFL_violations > 0.0) {
@@ -0,0 +1,86 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "IceModel.hh"
+
+#include "pism/util/RegriddingSource.hh"
+#include "pism/util/Diagnostic.hh"
+#include "pism/util/pism_utilities.hh"
+
+namespace pism {
+
+namespace {
+
+//! Model state of an IceModel instance (and its sub-models) used to initialize a model on
+//! a different grid.
+class ModelState : public RegriddingSource {
+public:
+  ModelState(const std::set<IceModelVec*> &model_state,
+             const std::map<std::string, const Component*> &submodels)
+    : m_submodels(submodels) {
+    for (auto v : model_state) {
+      m_model_state[v->get_name()] = v;
+    }
+  }
+protected:
+  const IceModelVec* get_impl(const std::string &name) const {
+    // fields owned by IceModel
+    auto v = m_model_state.find(name);
+    if (v != m_model_state.end()) {
+      return v->second;
+    }
+
+    // fields computed earlier
+    auto f = m_fields.find(name);
+    if (f != m_fields.end()) {
+      return f->second.get();
+    }
+
+    // state variables of sub-models are available as diagnostics
+    for (auto m : m_submodels) {
+      auto diagnostics = m.second->diagnostics();
+
+      auto d = diagnostics.find(name);
+      if (d != diagnostics.end()) {
+        m_fields[name] = d->second->compute();
+        return m_fields[name].get();
+      }
+    }
+
+    return nullptr;
+  }
+private:
+  std::map<std::string, const IceModelVec*> m_model_state;
+  std::map<std::string, const Component*> m_submodels;
+  mutable std::map<std::string, IceModelVec::Ptr> m_fields;
+};
+
+} // end of anonymous namespace
+
+/*!
+ * Returns the current model state, to be used by a model on a refined grid (see
+ * IceGrid::set_regridding_source()).
+ *
+ * The result uses fields owned by this model, so it should not outlive it.
+ */
+std::shared_ptr<const RegriddingSource> IceModel::regridding_source() const {
+  return std::make_shared<ModelState>(m_model_state, m_submodels);
+}
+
+} // end of namespace pism
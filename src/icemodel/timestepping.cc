@@ -48,6 +48,10 @@ Note adapt_ratio * 2 is multiplied by dx^2/(2*maxD) so dt <= adapt_ratio *
 dx^2/maxD (if dx=dy).
 
 Reference: [\ref MortonMayers] pp 62--63.
+
+If the diffusive flux is treated implicitly (geometry.update.implicit_diffusion.enabled)
+this restriction is relaxed by the factor geometry.update.implicit_diffusion.dt_factor: the
+time step is then limited by accuracy rather than stability.
  */
 MaxTimestep IceModel::max_timestep_diffusivity() {
   double D_max = m_stress_balance->max_diffusivity();
@@ -59,7 +63,12 @@ MaxTimestep IceModel::max_timestep_diffusivity() {
       adaptive_timestepping_ratio = m_config->get_number("time_stepping.adaptive_ratio"),
       grid_factor                 = 1.0 / (dx*dx) + 1.0 / (dy*dy);
 
-    return MaxTimestep(adaptive_timestepping_ratio * 2.0 / (D_max * grid_factor),
+    double factor = 1.0;
+    if (m_config->get_flag("geometry.update.implicit_diffusion.enabled")) {
+      factor = m_config->get_number("geometry.update.implicit_diffusion.dt_factor");
+    }
+
+    return MaxTimestep(factor * adaptive_timestepping_ratio * 2.0 / (D_max * grid_factor),
                        "diffusivity");
   } else {
     return MaxTimestep(m_config->get_number("time_stepping.maximum_time_step", "seconds"),
@@ -98,6 +107,60 @@ unsigned int IceModel::skip_counter(double input_dt, double input_dt_diffusivity
   return 0;
 }
 
+/*!
+ * Compute the skip counter using the estimated change in ice temperature (see
+ * time_stepping.skip.adaptive).
+ *
+ * Energy and age are updated during the next step unless skipping it keeps
+ *
+ * - the estimated temperature change accumulated since the last update below
+ *   time_stepping.skip.max_temperature_change,
+ * - the time step of the next energy and age update below the 3D CFL restriction, and
+ * - the number of consecutive skipped steps below time_stepping.skip.max.
+ *
+ * The decision is made every step. The counter is decremented during the mass continuity
+ * step, so 0 means "update during the next step" and 2 means "skip the next step".
+ *
+ * @param[in] dt length of the current time step
+ * @param[in] skip_counter skip counter at the beginning of the current step (zero if
+ *                         energy and age are updated during this step)
+ *
+ * @return new skip counter
+ */
+unsigned int IceModel::adaptive_skip_counter(double dt, unsigned int skip_counter) {
+  const unsigned int skip_max = static_cast<int>(m_config->get_number("time_stepping.skip.max"));
+  const double dT_max = m_config->get_number("time_stepping.skip.max_temperature_change");
+
+  // time since the last energy and age update and the number of skipped steps at the end
+  // of this step
+  const double elapsed = skip_counter == 0 ? 0.0 : dt_TempAge + dt;
+  const unsigned int skipped = skip_counter == 0 ? 0 : m_skipped_steps + 1;
+
+  if (not m_config->get_flag("time_stepping.skip.enabled") or
+      m_temperature_change_rate < 0.0 or
+      skipped + 1 > skip_max or
+      m_time->end() - m_time->current() <= dt) {
+    return 0;
+  }
+
+  // assume that the next two steps have the same length as this one
+  if (m_temperature_change_rate * (elapsed + dt) > dT_max) {
+    return 0;
+  }
+
+  const bool use_3d_cfl = (m_age_model != nullptr or m_config->get_flag("energy.enabled"));
+  if (use_3d_cfl) {
+    const double conservativeFactor = 0.95;
+    const double dt_cfl = m_stress_balance->max_timestep_cfl_3d().dt_max.value();
+
+    if (elapsed + 2.0 * dt > conservativeFactor * dt_cfl) {
+      return 0;
+    }
+  }
+
+  return 2;
+}
+
 //! Use various stability criteria to determine the time step for an evolution run.
 /*!
 The main loop in run() approximates many physical processes.  Several of these approximations,
@@ -119,8 +182,10 @@ void IceModel::max_timestep(double &dt_result, unsigned int &skip_counter_result
     restrictions.push_back(m.second->max_timestep(current_time));
   }
 
-  // mechanisms that use a retreat rate
+  // mechanisms that use a retreat rate (if sub-cycling, front retreat satisfies its CFL
+  // criterion by taking sub-steps instead; see front_retreat_step())
   if (m_config->get_flag("geometry.front_retreat.use_cfl") and
+      not m_config->get_flag("geometry.front_retreat.subcycle") and
       (m_eigen_calving or m_vonmises_calving or m_hayhurst_calving or m_frontal_melt)) {
     // at least one of front retreat mechanisms is active
 
@@ -215,7 +280,9 @@ void IceModel::max_timestep(double &dt_result, unsigned int &skip_counter_result
                                 " (overrides " + dt_other.description() + ")");
 
   // the "skipping" mechanism
-  {
+  if (m_config->get_flag("time_stepping.skip.adaptive")) {
+    skip_counter_result = adaptive_skip_counter(dt_result, skip_counter_result);
+  } else {
     if (dt_max.description() == "diffusivity" and skip_counter_result == 0) {
       skip_counter_result = skip_counter(dt_other.value(), dt_max.value());
     }
@@ -1,4 +1,4 @@
-// Copyright (C) 2012,2013,2014,2015,2016,2017  David Maxwell and Constantine Khroulev
+// Copyright (C) 2012,2013,2014,2015,2016,2017,2020  David Maxwell and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -270,6 +270,13 @@ protected:
   ///  Value of \f$J_S\f$ at the current iterate.
   double m_val_state;
 
+  /// Design variable (without ghosts) at the last successful objective and gradient
+  /// evaluation.
+  DesignVec m_d_evaluated;
+  /// True if `m_d_evaluated`, `m_grad`, `m_val_design`, and `m_val_state` correspond to
+  /// the same design variable.
+  bool m_evaluation_cached;
+
   /// Implementation of \f$J_D\f$.
   IPFunctional<IceModelVec2S> &m_designFunctional;
   /// Implementation of \f$J_S\f$.
@@ -298,6 +305,7 @@ IPTaoTikhonovProblem<ForwardProblem>::IPTaoTikhonovProblem(ForwardProblem &forwa
                                                            IPFunctional<DesignVec> &designFunctional,
                                                            IPFunctional<StateVec> &stateFunctional)
   : m_forward(forward), m_d0(d0), m_u_obs(u_obs), m_eta(eta),
+    m_evaluation_cached(false),
     m_designFunctional(designFunctional), m_stateFunctional(stateFunctional) {
 
   m_grid = m_d0.grid();
@@ -330,6 +338,9 @@ IPTaoTikhonovProblem<ForwardProblem>::IPTaoTikhonovProblem(ForwardProblem &forwa
   m_grad->create(m_grid, "gradient", WITHOUT_GHOSTS, design_stencil_width);
 
   m_adjointRHS.create(m_grid,"work vector", WITHOUT_GHOSTS, design_stencil_width);
+
+  m_d_evaluated.create(m_grid, "design variable (last evaluation)", WITHOUT_GHOSTS,
+                       design_stencil_width);
 }
 
 template<class ForwardProblem>
@@ -404,6 +415,24 @@ template<class ForwardProblem>
 void IPTaoTikhonovProblem<ForwardProblem>::evaluateObjectiveAndGradient(Tao tao, Vec x,
                                                                         double *value, Vec gradient) {
   PetscErrorCode ierr;
+
+  // TAO may request the objective and gradient at the point it evaluated last (e.g. when
+  // a line search restarts). Re-use the result instead of solving the forward problem.
+  if (m_evaluation_cached) {
+    PetscBool same = PETSC_FALSE;
+    ierr = VecEqual(x, m_d_evaluated.vec(), &same);
+    PISM_CHK(ierr, "VecEqual");
+
+    if (same) {
+      ierr = VecCopy(m_grad->vec(), gradient);
+      PISM_CHK(ierr, "VecCopy");
+
+      *value = m_val_design / m_eta + m_val_state;
+      return;
+    }
+  }
+  m_evaluation_cached = false;
+
   // Variable 'x' has no ghosts.  We need ghosts for computation with the design variable.
   m_d->copy_from_vec(x);
 
@@ -418,15 +447,18 @@ void IPTaoTikhonovProblem<ForwardProblem>::evaluateObjectiveAndGradient(Tao tao,
     return;
   }
 
+  // Values and gradients of both functionals are computed in one pass over the grid.
+  double valDesign, valState;
+
   m_d_diff->copy_from(*m_d);
   m_d_diff->add(-1, m_d0);
-  m_designFunctional.gradientAt(*m_d_diff, *m_grad_design);
+  m_designFunctional.valueAndGradientAt(*m_d_diff, &valDesign, *m_grad_design);
 
   m_u_diff->copy_from(*m_forward.solution());
   m_u_diff->add(-1, m_u_obs);
 
   // The following computes the reduced gradient.
-  m_stateFunctional.gradientAt(*m_u_diff, m_adjointRHS);
+  m_stateFunctional.valueAndGradientAt(*m_u_diff, &valState, m_adjointRHS);
   m_forward.apply_linearization_transpose(m_adjointRHS, *m_grad_state);
 
   m_grad->copy_from(*m_grad_design);
@@ -436,14 +468,13 @@ void IPTaoTikhonovProblem<ForwardProblem>::evaluateObjectiveAndGradient(Tao tao,
   ierr = VecCopy(m_grad->vec(), gradient);
   PISM_CHK(ierr, "VecCopy");
 
-  double valDesign, valState;
-  m_designFunctional.valueAt(*m_d_diff, &valDesign);
-  m_stateFunctional.valueAt(*m_u_diff, &valState);
-
   m_val_design = valDesign;
   m_val_state = valState;
 
   *value = valDesign / m_eta + valState;
+
+  m_d_evaluated.copy_from_vec(x);
+  m_evaluation_cached = true;
 }
 
 } // end of namespace inverse
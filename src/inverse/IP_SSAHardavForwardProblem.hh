@@ -169,6 +169,8 @@ public:
 
 protected:
 
+  void rebuild_preconditioner();
+
   IceModelVec2S   *m_zeta;                   ///< Current value of zeta, provided from caller.
   IceModelVec2S   m_dzeta_local;             ///< Storage for d_zeta with ghosts, if needed when an argument d_zeta is ghost-less.
 
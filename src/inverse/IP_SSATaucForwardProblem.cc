@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2014, 2015, 2016, 2017, 2019  David Maxwell and Constantine Khroulev
+// Copyright (C) 2012, 2014, 2015, 2016, 2017, 2019, 2020  David Maxwell and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -532,6 +532,29 @@ void IP_SSATaucForwardProblem::apply_jacobian_design_transpose(IceModelVec2V &u,
   }
 }
 
+/*! Sets up the preconditioner of the state Jacobian \f$J_{\rm State}\f$ after it was
+  re-assembled.
+
+  The preconditioner is then re-used by all forward and adjoint solves in
+  apply_linearization() and apply_linearization_transpose() (i.e. by all Krylov
+  iterations of a Gauss-Newton step) until the design variable changes.
+*/
+void IP_SSATaucForwardProblem::rebuild_preconditioner() {
+  PetscErrorCode ierr;
+
+  ierr = KSPSetReusePreconditioner(m_ksp, PETSC_FALSE);
+  PISM_CHK(ierr, "KSPSetReusePreconditioner");
+
+  ierr = KSPSetOperators(m_ksp, m_J_state, m_J_state);
+  PISM_CHK(ierr, "KSPSetOperators");
+
+  ierr = KSPSetUp(m_ksp);
+  PISM_CHK(ierr, "KSPSetUp");
+
+  ierr = KSPSetReusePreconditioner(m_ksp, PETSC_TRUE);
+  PISM_CHK(ierr, "KSPSetReusePreconditioner");
+}
+
 /*!\brief Applies the linearization of the forward map (i.e. the reduced gradient \f$DF\f$ described in
 the class-level documentation.) */
 /*! As described previously,
@@ -552,15 +575,15 @@ void IP_SSATaucForwardProblem::apply_linearization(IceModelVec2S &dzeta, IceMode
   if (m_rebuild_J_state) {
     this->assemble_jacobian_state(m_velocity, m_J_state);
     m_rebuild_J_state = false;
+
+    rebuild_preconditioner();
   }
 
   this->apply_jacobian_design(m_velocity, dzeta, m_du_global);
   m_du_global.scale(-1);
 
-  // call PETSc to solve linear system by iterative method.
-  ierr = KSPSetOperators(m_ksp, m_J_state, m_J_state);
-  PISM_CHK(ierr, "KSPSetOperators");
-
+  // call PETSc to solve linear system by iterative method (re-using the preconditioner
+  // built in rebuild_preconditioner()).
   ierr = KSPSolve(m_ksp, m_du_global.vec(), m_du_global.vec());
   PISM_CHK(ierr, "KSPSolve"); // SOLVE
 
@@ -607,6 +630,8 @@ void IP_SSATaucForwardProblem::apply_linearization_transpose(IceModelVec2V &du,
   if (m_rebuild_J_state) {
     this->assemble_jacobian_state(m_velocity, m_J_state);
     m_rebuild_J_state = false;
+
+    rebuild_preconditioner();
   }
 
   // Aliases to help with notation consistency below.
@@ -624,10 +649,8 @@ void IP_SSATaucForwardProblem::apply_linearization_transpose(IceModelVec2V &du,
 
   m_du_global.end_access();
 
-  // call PETSc to solve linear system by iterative method.
-  ierr = KSPSetOperators(m_ksp, m_J_state, m_J_state);
-  PISM_CHK(ierr, "KSPSetOperators");
-
+  // call PETSc to solve linear system by iterative method (re-using the preconditioner
+  // built in rebuild_preconditioner()).
   ierr = KSPSolve(m_ksp, m_du_global.vec(), m_du_global.vec());
   PISM_CHK(ierr, "KSPSolve"); // SOLVE
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019  David Maxwell and Constantine Khroulev
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020  David Maxwell and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -267,21 +267,18 @@ TerminationReason::Ptr IP_SSATaucTikhonovGNSolver::evaluate_objective_and_gradie
   m_u_diff.copy_from(*m_ssaforward.solution());
   m_u_diff.add(-1,m_u_obs);
 
-  m_designFunctional.gradientAt(m_d_diff,m_grad_design);
+  double valDesign, valState;
+  m_designFunctional.valueAndGradientAt(m_d_diff, &valDesign, m_grad_design);
 
   // The following computes the reduced gradient.
   StateVec &adjointRHS = m_tmp_S1Global;
-  m_stateFunctional.gradientAt(m_u_diff,adjointRHS);  
+  m_stateFunctional.valueAndGradientAt(m_u_diff, &valState, adjointRHS);
   m_ssaforward.apply_linearization_transpose(adjointRHS,m_grad_state);
 
   m_gradient.copy_from(m_grad_design);
   m_gradient.scale(m_alpha);    
   m_gradient.add(1,m_grad_state);
 
-  double valDesign, valState;
-  m_designFunctional.valueAt(m_d_diff,&valDesign);
-  m_stateFunctional.valueAt(m_u_diff,&valState);
-
   m_val_design = valDesign;
   m_val_state = valState;
   
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017  David Maxwell
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2020  David Maxwell
 //
 // This file is part of PISM.
 //
@@ -66,6 +66,14 @@ public:
   */
   virtual void gradientAt(IMVecType &x, IMVecType &gradient) = 0;
 
+  //! Computes both the value and the gradient of the functional at the vector x.
+  /*! Equivalent to calling valueAt() and gradientAt(). Subclasses should override this
+    to compute both in one pass over the grid. */
+  virtual void valueAndGradientAt(IMVecType &x, double *OUTPUT, IMVecType &gradient) {
+    this->valueAt(x, OUTPUT);
+    this->gradientAt(x, gradient);
+  }
+
 protected:
   IceGrid::ConstPtr m_grid;
 
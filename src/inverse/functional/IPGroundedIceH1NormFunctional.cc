@@ -1,4 +1,4 @@
-// Copyright (C) 2013, 2014, 2015, 2016, 2017  David Maxwell and Constantine Khroulev
+// Copyright (C) 2013, 2014, 2015, 2016, 2017, 2020  David Maxwell and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -216,6 +216,95 @@ void IPGroundedIceH1NormFunctional2S::gradientAt(IceModelVec2S &x, IceModelVec2S
   } // i
 }
 
+void IPGroundedIceH1NormFunctional2S::valueAndGradientAt(IceModelVec2S &x, double *OUTPUT,
+                                                         IceModelVec2S &gradient) {
+
+  const unsigned int Nk     = fem::q1::n_chi;
+  const unsigned int Nq     = m_quadrature.n();
+  const unsigned int Nq_max = fem::MAX_QUADRATURE_SIZE;
+
+  // The value of the objective
+  double value = 0;
+
+  // Clear the gradient before doing anything with it!
+  gradient.set(0);
+
+  double x_e[Nk];
+  double x_q[Nq_max], dxdx_q[Nq_max], dxdy_q[Nq_max];
+
+  double gradient_e[Nk];
+
+  IceModelVec::AccessList list{&x, &gradient, &m_ice_mask};
+
+  // An Nq by Nk array of test function values.
+  const fem::Germs *test = m_quadrature.test_function_values();
+
+  // Jacobian times weights for quadrature.
+  const double* W = m_quadrature.weights();
+
+  fem::DirichletData_Scalar dirichletBC(m_dirichletIndices, NULL);
+
+  // Loop through all local and ghosted elements. Only LOCAL elements contribute to the
+  // value.
+  const int
+    xs = m_element_index.xs,
+    xm = m_element_index.xm,
+    ys = m_element_index.ys,
+    ym = m_element_index.ym,
+    lxs = m_element_index.lxs,
+    lxm = m_element_index.lxm,
+    lys = m_element_index.lys,
+    lym = m_element_index.lym;
+
+  for (int j=ys; j<ys+ym; j++) {
+    for (int i=xs; i<xs+xm; i++) {
+      bool all_grounded_ice = (m_ice_mask.grounded_ice(i, j) and
+                               m_ice_mask.grounded_ice(i+1, j) and
+                               m_ice_mask.grounded_ice(i, j+1) and
+                               m_ice_mask.grounded_ice(i+1, j+1));
+
+      if (! all_grounded_ice) {
+        continue;
+      }
+
+      const bool local = (i >= lxs and i < lxs + lxm and j >= lys and j < lys + lym);
+
+      // Reset the DOF map for this element.
+      m_element.reset(i, j);
+
+      // Obtain values of x at the quadrature points for the element.
+      m_element.nodal_values(x, x_e);
+      if (dirichletBC) {
+        dirichletBC.constrain(m_element);
+        dirichletBC.enforce_homogeneous(m_element, x_e);
+      }
+      quadrature_point_values(m_quadrature, x_e, x_q, dxdx_q, dxdy_q);
+
+      // Zero out the element-local residual in prep for updating it.
+      for (unsigned int k=0; k<Nk; k++) {
+        gradient_e[k] = 0;
+      }
+
+      for (unsigned int q=0; q<Nq; q++) {
+        const double &x_qq=x_q[q];
+        const double &dxdx_qq=dxdx_q[q], &dxdy_qq=dxdy_q[q];
+
+        if (local) {
+          value += W[q]*(m_cL2*x_qq*x_qq + m_cH1*(dxdx_qq*dxdx_qq + dxdy_qq*dxdy_qq));
+        }
+
+        for (unsigned int k=0; k<Nk; k++) {
+          gradient_e[k] += 2*W[q]*(m_cL2*x_qq*test[q][k].val +
+                                   m_cH1*(dxdx_qq*test[q][k].dx + dxdy_qq*test[q][k].dy));
+        } // k
+      } // q
+      m_element.add_contribution(gradient_e, gradient);
+    } // j
+  } // i
+
+  GlobalSum(m_grid->com, &value, OUTPUT, 1);
+}
+
 void IPGroundedIceH1NormFunctional2S::assemble_form(Mat form) {
 
   const unsigned int Nk = fem::q1::n_chi;
@@ -1,4 +1,4 @@
-// Copyright (C) 2013, 2014, 2015, 2016, 2017  David Maxwell
+// Copyright (C) 2013, 2014, 2015, 2016, 2017, 2020  David Maxwell
 //
 // This file is part of PISM.
 //
@@ -126,5 +126,46 @@ void IPLogRatioFunctional::gradientAt(IceModelVec2V &x, IceModelVec2V &gradient)
   }
 }
 
+void IPLogRatioFunctional::valueAndGradientAt(IceModelVec2V &x, double *OUTPUT,
+                                              IceModelVec2V &gradient)  {
+  gradient.set(0);
+
+  // The value of the objective
+  double value = 0;
+
+  double w = 1.;
+
+  IceModelVec::AccessList list{&x, &gradient, &m_u_observed};
+
+  if (m_weights) {
+    list.add(*m_weights);
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (m_weights) {
+      w = (*m_weights)(i, j);
+    }
+    Vector2 &x_ij = x(i, j);
+    Vector2 &u_obs_ij = m_u_observed(i, j);
+    Vector2 u_model_ij = x_ij+u_obs_ij;
+
+    double obsMagSq = u_obs_ij.u*u_obs_ij.u + u_obs_ij.v*u_obs_ij.v + m_eps*m_eps;
+    double modelMagSq = (u_model_ij.u*u_model_ij.u + u_model_ij.v*u_model_ij.v)+m_eps*m_eps;
+    double v = log(modelMagSq/obsMagSq);
+    value += w*v*v;
+
+    double dJdw =  2*w*v/modelMagSq;
+
+    gradient(i, j).u = dJdw*2*u_model_ij.u/m_normalization;
+    gradient(i, j).v = dJdw*2*u_model_ij.v/m_normalization;
+  }
+
+  value /= m_normalization;
+
+  GlobalSum(m_grid->com, &value, OUTPUT, 1);
+}
+
 } // end of namespace inverse
 } // end of namespace pism
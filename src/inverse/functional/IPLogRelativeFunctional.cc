@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2014, 2015, 2016, 2017  David Maxwell
+// Copyright (C) 2012, 2014, 2015, 2016, 2017, 2020  David Maxwell
 //
 // This file is part of PISM.
 //
@@ -114,5 +114,42 @@ void IPLogRelativeFunctional::gradientAt(IceModelVec2V &x, IceModelVec2V &gradie
   }
 }
 
+void IPLogRelativeFunctional::valueAndGradientAt(IceModelVec2V &x, double *OUTPUT,
+                                                 IceModelVec2V &gradient)  {
+  gradient.set(0);
+
+  // The value of the objective
+  double value = 0;
+
+  double w = 1;
+
+  IceModelVec::AccessList list{&x, &gradient, &m_u_observed};
+  if (m_weights) {
+    list.add(*m_weights);
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    Vector2 &x_ij = x(i, j);
+    Vector2 &u_obs_ij = m_u_observed(i, j);
+    if (m_weights) {
+      w = (*m_weights)(i, j);
+    }
+    double obsMagSq = u_obs_ij.u*u_obs_ij.u + u_obs_ij.v*u_obs_ij.v + m_eps*m_eps;
+    double modelMagSq = obsMagSq + w*(x_ij.u*x_ij.u + x_ij.v*x_ij.v);
+    value += log(modelMagSq/obsMagSq);
+
+    double dJdxsq =  w/modelMagSq;
+
+    gradient(i, j).u = dJdxsq*2*x_ij.u/m_normalization;
+    gradient(i, j).v = dJdxsq*2*x_ij.v/m_normalization;
+  }
+
+  value /= m_normalization;
+
+  GlobalSum(m_grid->com, &value, OUTPUT, 1);
+}
+
 } // end of namespace inverse
 } // end of namespace pism
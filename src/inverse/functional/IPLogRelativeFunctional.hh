@@ -1,4 +1,4 @@
-// Copyright (C) 2013, 2014, 2015  David Maxwell and Constantine Khroulev
+// Copyright (C) 2013, 2014, 2015, 2020  David Maxwell and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -44,6 +44,7 @@ public:
 
   virtual void valueAt(IceModelVec2V &x, double *OUTPUT);
   virtual void gradientAt(IceModelVec2V &x, IceModelVec2V &gradient);
+  virtual void valueAndGradientAt(IceModelVec2V &x, double *OUTPUT, IceModelVec2V &gradient);
 
 protected:
   IceModelVec2V &m_u_observed;
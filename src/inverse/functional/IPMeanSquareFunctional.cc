@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2014, 2015, 2016, 2017  David Maxwell
+// Copyright (C) 2012, 2014, 2015, 2016, 2017, 2020  David Maxwell
 //
 // This file is part of PISM.
 //
@@ -133,6 +133,39 @@ void IPMeanSquareFunctional2V::gradientAt(IceModelVec2V &x, IceModelVec2V &gradi
   }
 }
 
+void IPMeanSquareFunctional2V::valueAndGradientAt(IceModelVec2V &x, double *OUTPUT,
+                                                  IceModelVec2V &gradient)  {
+  gradient.set(0);
+
+  // The value of the objective
+  double value = 0;
+
+  double w = 1.;
+
+  IceModelVec::AccessList list{&x, &gradient};
+
+  if (m_weights) {
+    list.add(*m_weights);
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (m_weights) {
+      w = (*m_weights)(i, j);
+    }
+
+    Vector2 &x_ij = x(i, j);
+    value += (x_ij.u*x_ij.u + x_ij.v*x_ij.v)*w;
+
+    gradient(i, j).u = 2*x_ij.u*w / m_normalization;
+    gradient(i, j).v = 2*x_ij.v*w / m_normalization;
+  }
+  value /= m_normalization;
+
+  GlobalSum(m_grid->com, &value, OUTPUT, 1);
+}
+
 //! Implicitly set the normalization constant for the functional.
 /*! The normalization constant is selected so that if an input
 IceModelVec2S has entries all equal to \a scale, then the funtional value will be 1. I.e.
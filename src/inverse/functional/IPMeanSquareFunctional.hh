@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015  David Maxwell
+// Copyright (C) 2012, 2013, 2014, 2015, 2020  David Maxwell
 //
 // This file is part of PISM.
 //
@@ -74,6 +74,7 @@ public:
   virtual void valueAt(IceModelVec2V &x, double *OUTPUT);
   virtual void dot(IceModelVec2V &a, IceModelVec2V &b, double *OUTPUT);
   virtual void gradientAt(IceModelVec2V &x, IceModelVec2V &gradient);
+  virtual void valueAndGradientAt(IceModelVec2V &x, double *OUTPUT, IceModelVec2V &gradient);
 
 protected:
   IceModelVec2S *m_weights;
@@ -1,4 +1,4 @@
-// Copyright (C) 2013, 2014, 2015  David Maxwell and Constantine Khroulev
+// Copyright (C) 2013, 2014, 2015, 2020  David Maxwell and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -37,6 +37,7 @@ public:
 
   virtual void valueAt(IceModelVec2S &x, double *OUTPUT);
   virtual void gradientAt(IceModelVec2S &x, IceModelVec2S &gradient);
+  virtual void valueAndGradientAt(IceModelVec2S &x, double *OUTPUT, IceModelVec2S &gradient);
 
 protected:
 
@@ -0,0 +1,443 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Times PISM's computational kernels (stress balance, energy, hydrology, bed\n"
+  "deformation, I/O) using synthetic inputs on grids of given sizes and saves\n"
+  "results to a JSON file.\n\n";
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <set>
+#include <vector>
+#include <algorithm>            // std::min, std::max
+
+#include "pism/stressbalance/StressBalance.hh"
+#include "pism/stressbalance/ShallowStressBalance.hh"
+#include "pism/stressbalance/sia/SIAFD.hh"
+#include "pism/stressbalance/ssa/SSAFD.hh"
+#include "pism/stressbalance/ssa/SSAFEM.hh"
+#include "pism/energy/EnthalpyModel.hh"
+#include "pism/hydrology/Routing.hh"
+#include "pism/earth/LingleClark.hh"
+#include "pism/geometry/Geometry.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/EnthalpyConverter.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/SolverStats.hh"
+#include "pism/util/Time.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/io/File.hh"
+#include "pism/util/io/io_helpers.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+
+namespace pism {
+
+//! Timing of one kernel on one grid.
+struct Timing {
+  std::string kernel;
+  int Mx, My, Mz;
+  int calls;
+  //! wall-clock time per call (maximum over processes), in seconds
+  double time_min, time_mean, time_max;
+  //! number of grid points (columns for 2D kernels) processed per second
+  double points_per_second;
+  //! solver statistics of the last call (if applicable)
+  SolverStats stats;
+};
+
+/*!
+ * Call `kernel` once (to exclude setup costs and first-touch effects), then `repeat`
+ * times, recording the time of each call.
+ */
+static Timing benchmark(const IceGrid &grid, const std::string &name, int repeat,
+                        bool three_d, std::function<void()> kernel) {
+  kernel();
+
+  std::vector<double> times;
+  for (int k = 0; k < repeat; ++k) {
+    MPI_Barrier(grid.com);
+    double t0 = get_time();
+    kernel();
+    times.push_back(GlobalMax(grid.com, get_time() - t0));
+  }
+
+  Timing result;
+  result.kernel    = name;
+  result.Mx        = grid.Mx();
+  result.My        = grid.My();
+  result.Mz        = grid.Mz();
+  result.calls     = repeat;
+  result.time_min  = *std::min_element(times.begin(), times.end());
+  result.time_max  = *std::max_element(times.begin(), times.end());
+  result.time_mean = 0.0;
+  for (double t : times) {
+    result.time_mean += t / repeat;
+  }
+
+  const double N = (double)grid.Mx() * grid.My() * (three_d ? grid.Mz() : 1);
+  result.points_per_second = N / std::max(result.time_min, 1e-12);
+
+  return result;
+}
+
+/*!
+ * Ice geometry resembling the steady state of the EISMINT II experiment A (a dome with
+ * the margin at 600 km on a flat bed), using the Vialov profile.
+ *
+ * Surface temperature and the geothermal flux are the ones used in EISMINT II.
+ */
+static void eismint2_inputs(const IceGrid &grid,
+                            Geometry &geometry,
+                            IceModelVec2S &surface_temperature,
+                            IceModelVec2S &basal_heat_flux) {
+  const double
+    H0    = 3000.0,             // m
+    L     = 600e3,              // m
+    T_min = 238.15,             // K
+    S_T   = 1.67e-5;            // K/m
+
+  geometry.bed_elevation.set(0.0);
+  geometry.sea_level_elevation.set(-1000.0);
+  basal_heat_flux.set(0.042);
+
+  IceModelVec::AccessList list{&geometry.ice_thickness, &surface_temperature};
+
+  for (Points p(grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const double r = radius(grid, i, j);
+
+    geometry.ice_thickness(i, j) =
+      r < L ? H0 * pow(1.0 - pow(r / L, 4.0 / 3.0), 3.0 / 8.0) : 0.0;
+    surface_temperature(i, j) = T_min + S_T * r;
+  }
+
+  geometry.ice_thickness.update_ghosts();
+
+  auto config = grid.ctx()->config();
+  geometry.ensure_consistency(config->get_number("geometry.ice_free_thickness_standard"));
+}
+
+//! Isothermal columns at the surface temperature.
+static void set_enthalpy(const IceGrid &grid,
+                         const EnthalpyConverter &EC,
+                         const IceModelVec2S &ice_thickness,
+                         const IceModelVec2S &surface_temperature,
+                         IceModelVec3 &enthalpy) {
+  IceModelVec::AccessList list{&ice_thickness, &surface_temperature, &enthalpy};
+
+  for (Points p(grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    double *E = enthalpy.get_column(i, j);
+    for (unsigned int k = 0; k < grid.Mz(); ++k) {
+      const double depth = std::max(ice_thickness(i, j) - grid.z(k), 0.0);
+      E[k] = EC.enthalpy(surface_temperature(i, j), 0.0, EC.pressure(depth));
+    }
+  }
+
+  enthalpy.update_ghosts();
+}
+
+static void save_json(MPI_Comm com, const std::string &filename,
+                      const std::vector<Timing> &timings) {
+  int rank = 0, size = 1;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  int success = 1;
+  if (rank == 0) {
+    FILE *f = fopen(filename.c_str(), "w");
+
+    if (f == nullptr) {
+      success = 0;
+    } else {
+      fprintf(f, "{\n  \"n_processes\": %d,\n  \"kernels\": [", size);
+      for (unsigned int k = 0; k < timings.size(); ++k) {
+        const Timing &t = timings[k];
+        fprintf(f,
+                "%s\n    {\"name\": \"%s\", \"Mx\": %d, \"My\": %d, \"Mz\": %d, \"calls\": %d,"
+                " \"time_min\": %.6f, \"time_mean\": %.6f, \"time_max\": %.6f,"
+                " \"points_per_second\": %.6e, \"steps\": %u,"
+                " \"nonlinear_iterations\": %u, \"linear_iterations\": %u}",
+                k > 0 ? "," : "",
+                t.kernel.c_str(), t.Mx, t.My, t.Mz, t.calls,
+                t.time_min, t.time_mean, t.time_max,
+                t.points_per_second, t.stats.steps,
+                t.stats.nonlinear_iterations, t.stats.linear_iterations);
+      }
+      fprintf(f, "\n  ]\n}\n");
+
+      success = fclose(f) == 0 ? 1 : 0;
+    }
+  }
+
+  MPI_Bcast(&success, 1, MPI_INT, 0, com);
+  if (success == 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to write benchmark results to '%s'",
+                                  filename.c_str());
+  }
+}
+
+//! Time all requested kernels on the grid with `M` by `M` points.
+static std::vector<Timing> run_benchmarks(Context::Ptr ctx, int M, int repeat,
+                                          const std::set<std::string> &kernels) {
+  using namespace stressbalance;
+
+  Config::Ptr config = ctx->config();
+  EnthalpyConverter::Ptr EC = ctx->enthalpy_converter();
+
+  // the EISMINT II domain
+  GridParameters P(config);
+  P.Lx = 750e3;
+  P.Ly = P.Lx;
+  P.Mx = M;
+  P.My = M;
+  P.z = IceGrid::compute_vertical_levels(5000.0, config->get_number("grid.Mz"), EQUAL);
+  P.ownership_ranges_from_options(ctx->size());
+
+  IceGrid::Ptr grid(new IceGrid(ctx, P));
+
+  const int WIDE_STENCIL = config->get_number("grid.max_stencil_width");
+
+  Geometry geometry(grid);
+
+  IceModelVec2S
+    surface_temperature(grid, "surface_temperature", WITHOUT_GHOSTS),
+    basal_heat_flux(grid, "basal_heat_flux", WITHOUT_GHOSTS),
+    basal_melt_rate(grid, "basal_melt_rate", WITHOUT_GHOSTS),
+    sliding_speed(grid, "sliding_speed", WITHOUT_GHOSTS),
+    tauc(grid, "tauc", WITHOUT_GHOSTS),
+    zero(grid, "zero", WITHOUT_GHOSTS);
+
+  IceModelVec2V zero_velocity(grid, "zero_velocity", WITHOUT_GHOSTS);
+
+  IceModelVec3
+    enthalpy(grid, "enthalpy", WITH_GHOSTS, WIDE_STENCIL),
+    age(grid, "age", WITHOUT_GHOSTS);
+
+  enthalpy.set_attrs("model_state",
+                     "ice enthalpy (includes sensible heat, latent heat, pressure)",
+                     "J kg-1", "J kg-1", "", 0);
+
+  eismint2_inputs(*grid, geometry, surface_temperature, basal_heat_flux);
+  set_enthalpy(*grid, *EC, geometry.ice_thickness, surface_temperature, enthalpy);
+
+  age.set(0.0);
+  zero.set(0.0);
+  zero_velocity.set(0.0);
+  tauc.set(5e4);
+  basal_melt_rate.set(units::convert(ctx->unit_system(), 0.01, "m year-1", "m second-1"));
+  sliding_speed.set(units::convert(ctx->unit_system(), 100.0, "m year-1", "m second-1"));
+
+  const double
+    t    = ctx->time()->current(),
+    year = units::convert(ctx->unit_system(), 1.0, "year", "second");
+
+  Inputs inputs;
+  inputs.geometry              = &geometry;
+  inputs.basal_melt_rate       = &basal_melt_rate;
+  inputs.basal_yield_stress    = &tauc;
+  inputs.melange_back_pressure = &zero;
+  inputs.enthalpy              = &enthalpy;
+  inputs.age                   = &age;
+
+  std::vector<Timing> result;
+
+  // The SIA stress balance provides velocities and strain heating for the energy
+  // model.
+  StressBalance sia(grid, new ZeroSliding(grid), new SIAFD(grid));
+  sia.init();
+  sia.update(inputs, true);
+
+  if (kernels.find("sia") != kernels.end()) {
+    result.push_back(benchmark(*grid, "sia", repeat, true,
+                               [&]() { sia.update(inputs, true); }));
+  }
+
+  for (std::string method : {"ssafd", "ssafem"}) {
+    if (kernels.find(method) == kernels.end()) {
+      continue;
+    }
+
+    std::unique_ptr<SSA> ssa;
+    if (method == "ssafd") {
+      ssa.reset(new SSAFD(grid));
+    } else {
+      ssa.reset(new SSAFEM(grid));
+    }
+    ssa->init();
+
+    // start each solve from zero so that repeated calls do the same amount of work
+    Timing T = benchmark(*grid, method, repeat, false,
+                         [&]() {
+                           ssa->set_initial_guess(zero_velocity);
+                           ssa->update(inputs, true);
+                         });
+    T.stats = ssa->solver_stats();
+    result.push_back(T);
+  }
+
+  if (kernels.find("enthalpy") != kernels.end()) {
+    energy::EnthalpyModel model(grid, &sia);
+    model.initialize(zero, geometry.ice_thickness, surface_temperature, zero, basal_heat_flux);
+
+    energy::Inputs energy_inputs;
+    energy_inputs.cell_type                = &geometry.cell_type;
+    energy_inputs.basal_frictional_heating = &sia.basal_frictional_heating();
+    energy_inputs.basal_heat_flux          = &basal_heat_flux;
+    energy_inputs.ice_thickness            = &geometry.ice_thickness;
+    energy_inputs.surface_liquid_fraction  = &zero;
+    energy_inputs.shelf_base_temp          = &surface_temperature;
+    energy_inputs.surface_temp             = &surface_temperature;
+    energy_inputs.till_water_thickness     = &zero;
+    energy_inputs.volumetric_heating_rate  = &sia.volumetric_strain_heating();
+    energy_inputs.u3                       = &sia.velocity_u();
+    energy_inputs.v3                       = &sia.velocity_v();
+    energy_inputs.w3                       = &sia.velocity_w();
+
+    result.push_back(benchmark(*grid, "enthalpy", repeat, true,
+                               [&]() { model.update(t, year, energy_inputs); }));
+  }
+
+  if (kernels.find("routing") != kernels.end()) {
+    hydrology::Routing model(grid);
+    model.init(zero, zero, zero);
+
+    hydrology::Inputs hydrology_inputs;
+    hydrology_inputs.geometry          = &geometry;
+    hydrology_inputs.basal_melt_rate   = &basal_melt_rate;
+    hydrology_inputs.ice_sliding_speed = &sliding_speed;
+
+    // one "hydrology" step of 10 days (the model takes sub-steps)
+    const double dt = 10.0 * units::convert(ctx->unit_system(), 1.0, "day", "second");
+
+    Timing T = benchmark(*grid, "routing", repeat, false,
+                         [&]() { model.update(t, dt, hydrology_inputs); });
+    T.stats = model.solver_stats();
+    result.push_back(T);
+  }
+
+  if (kernels.find("lingle_clark") != kernels.end()) {
+    bed::LingleClark model(grid);
+    model.bootstrap(geometry.bed_elevation, zero, geometry.ice_thickness,
+                    geometry.sea_level_elevation);
+
+    result.push_back(benchmark(*grid, "lingle_clark", repeat, false,
+                               [&]() {
+                                 model.step(geometry.ice_thickness,
+                                            geometry.sea_level_elevation,
+                                            100.0 * year);
+                               }));
+  }
+
+  if (kernels.find("io") != kernels.end()) {
+    const std::string filename = "pism_bench_io.nc";
+    const IO_Backend backend = string_to_backend(config->get_string("output.format"));
+
+    std::vector<IceModelVec*> fields{&geometry.ice_thickness, &geometry.bed_elevation,
+                                     &enthalpy};
+
+    result.push_back(benchmark(*grid, "io_write", repeat, true,
+                               [&]() {
+                                 File file(grid->com, filename, backend, PISM_READWRITE_CLOBBER);
+                                 io::define_time(file, *ctx);
+                                 io::append_time(file, *config, t);
+                                 for (auto f : fields) {
+                                   f->define(file);
+                                 }
+                                 for (auto f : fields) {
+                                   f->write(file);
+                                 }
+                               }));
+
+    result.push_back(benchmark(*grid, "io_read", repeat, true,
+                               [&]() {
+                                 File file(grid->com, filename, PISM_GUESS, PISM_READONLY);
+                                 for (auto f : fields) {
+                                   f->read(file, 0);
+                                 }
+                               }));
+  }
+
+  return result;
+}
+
+} // end of namespace pism
+
+int main(int argc, char *argv[]) {
+  using namespace pism;
+
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "pism_bench");
+    Logger::ConstPtr log = ctx->log();
+    Config::Ptr config = ctx->config();
+
+    const std::string all_kernels = "sia,ssafd,ssafem,enthalpy,routing,lingle_clark,io";
+
+    options::IntegerList sizes("-sizes", "Grid sizes (Mx = My) to use", {61, 121});
+    options::StringSet kernels("-kernels", "Kernels to time", all_kernels);
+
+    const int repeat = options::Integer("-repeat", "Number of timed calls of each kernel", 3);
+
+    options::String output("-json", "Name of the JSON file to save results to",
+                          "pism_bench.json");
+
+    for (const auto &k : kernels.value()) {
+      if (not member(k, set_split(all_kernels, ','))) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "invalid -kernels argument: '%s' (choose from %s)",
+                                      k.c_str(), all_kernels.c_str());
+      }
+    }
+
+    // sliding in SSA test cases is pseudo-plastic
+    config->set_flag("basal_resistance.pseudo_plastic.enabled", true);
+
+    std::vector<Timing> timings;
+    for (int M : sizes.value()) {
+      for (const auto &T : run_benchmarks(ctx, M, repeat, kernels)) {
+        log->message(1, "%-14s %5d x %5d x %4d: %10.4f s per call, %.3e points per second\n",
+                     T.kernel.c_str(), T.Mx, T.My, T.Mz, T.time_min, T.points_per_second);
+        timings.push_back(T);
+      }
+    }
+
+    save_json(com, output, timings);
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
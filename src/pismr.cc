@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2011, 2013, 2014, 2015, 2016, 2017 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2011, 2013, 2014, 2015, 2016, 2017, 2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -21,6 +21,10 @@ static char help[] =
   "The basic PISM executable for evolution runs.\n";
 
 #include <memory>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <vector>
 #include <petscsys.h>           // PETSC_COMM_WORLD
 
 #include "pism/util/IceGrid.hh"
@@ -32,12 +36,131 @@ static char help[] =
 #include "pism/util/error_handling.hh"
 #include "pism/util/Context.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/MemoryTracker.hh"
+#include "pism/util/Memo.hh"
+#include "pism/util/Coarsening.hh"
+#include "pism/util/Time.hh"
 
 #include "pism/regional/IceGrid_Regional.hh"
 #include "pism/regional/IceRegionalModel.hh"
 
 using namespace pism;
 
+/*!
+ * Read a line from `input` on rank 0 of `com` and broadcast it.
+ *
+ * Returns false at the end of input. `input` is not used on other ranks.
+ */
+static bool read_command(MPI_Comm com, std::istream *input, std::string &result) {
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  int length = -1;
+  if (rank == 0 and std::getline(*input, result)) {
+    length = result.size();
+  }
+
+  MPI_Bcast(&length, 1, MPI_INT, 0, com);
+  if (length < 0) {
+    return false;
+  }
+
+  std::vector<char> buffer(result.begin(), result.end());
+  buffer.resize(length + 1, '\0');
+  MPI_Bcast(buffer.data(), length + 1, MPI_CHAR, 0, com);
+
+  result = buffer.data();
+
+  return true;
+}
+
+/*!
+ * Run `model` following commands read from `filename` (usually a named pipe), one per
+ * line:
+ *
+ * - `run_to TIME`: continue the run to `TIME` (in the format of `-ye`),
+ * - `checkpoint FILE`: save a checkpoint to `FILE` (see IceModel::save_checkpoint()),
+ * - `exit`: stop reading commands.
+ *
+ * Empty lines and lines starting with `#` are ignored. Reaching the end of the file is
+ * equivalent to `exit`.
+ *
+ * Commands are read by rank 0 of `com` (the communicator of an ensemble member) and
+ * broadcast. `member_file` maps checkpoint file names to names used by this member.
+ *
+ * This keeps an initialized model in memory between parts of a long run, avoiding
+ * re-initialization costs of chained restarts.
+ */
+static void run_commands(MPI_Comm com, const std::string &filename, IceModel &model,
+                         std::function<std::string(const std::string&)> member_file) {
+  Context::ConstPtr ctx = model.ctx();
+  Logger::ConstPtr log = ctx->log();
+
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  std::unique_ptr<std::ifstream> input;
+  {
+    int success = 1;
+    if (rank == 0) {
+      // only rank 0 opens the file: opening a named pipe blocks until a writer appears
+      input.reset(new std::ifstream(filename));
+      success = input->good() ? 1 : 0;
+    }
+    MPI_Bcast(&success, 1, MPI_INT, 0, com);
+
+    if (success == 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "failed to open '%s' to read commands",
+                                    filename.c_str());
+    }
+  }
+
+  log->message(2, "* Reading commands from '%s'...\n", filename.c_str());
+
+  std::string line;
+  while (read_command(com, input.get(), line)) {
+    std::istringstream stream(line);
+    std::string command, argument;
+    stream >> command >> argument;
+
+    if (command.empty() or command[0] == '#') {
+      continue;
+    }
+
+    if (command == "exit") {
+      break;
+    }
+
+    if (argument.empty()) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "command '%s' requires an argument", command.c_str());
+    }
+
+    if (command == "run_to") {
+      auto times = ctx->time()->parse_times(argument);
+      if (times.size() != 1) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "invalid time '%s' in 'run_to'", argument.c_str());
+      }
+
+      if (times[0] <= ctx->time()->current()) {
+        log->message(2, "* Model time is at or past %s: nothing to do\n",
+                     ctx->time()->date(times[0]).c_str());
+        continue;
+      }
+
+      log->message(2, "* Running to %s...\n", ctx->time()->date(times[0]).c_str());
+      model.run_to(times[0]);
+    } else if (command == "checkpoint") {
+      model.save_checkpoint(member_file(argument));
+    } else {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "unknown command '%s'", command.c_str());
+    }
+  }
+}
+
 int main(int argc, char *argv[]) {
 
   MPI_Comm com = MPI_COMM_WORLD;
@@ -45,8 +168,55 @@ int main(int argc, char *argv[]) {
 
   com = PETSC_COMM_WORLD;
 
+  MPI_Comm member_com = MPI_COMM_NULL;
+
   try {
-    Context::Ptr ctx = context_from_options(com, "pismr");
+    // In the ensemble mode processes are split into groups, one per ensemble member, and
+    // each member runs on its own communicator.
+    const int ensemble_size = options::Integer("-ensemble_size",
+                                               "Number of ensemble members run by this job", 1);
+
+    // In ParallelIO's asynchronous mode some processes are dedicated to writing output.
+    // Note: this is read here and not from the configuration database because the
+    // communicator has to be split before a context is created.
+    const int n_io_tasks = options::Integer("-pio_async_io_tasks",
+                                            "Number of processes dedicated to I/O"
+                                            " (ParallelIO's asynchronous mode)", 0);
+    if (n_io_tasks > 0) {
+      if (ensemble_size > 1) {
+        throw RuntimeError(PISM_ERROR_LOCATION,
+                           "-pio_async_io_tasks cannot be combined with -ensemble_size");
+      }
+
+      com = pio_async_init(com, n_io_tasks);
+
+      if (com == MPI_COMM_NULL) {
+        // this is an I/O task and all compute tasks are done
+        return 0;
+      }
+    }
+    int member = -1;
+    if (ensemble_size > 1) {
+      int rank = 0, size = 0;
+      MPI_Comm_rank(com, &rank);
+      MPI_Comm_size(com, &size);
+
+      if (size < ensemble_size) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "cannot run %d ensemble members using %d processes",
+                                      ensemble_size, size);
+      }
+
+      member = (rank * ensemble_size) / size;
+      MPI_Comm_split(com, member, rank, &member_com);
+    } else if (ensemble_size < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "invalid -ensemble_size %d", ensemble_size);
+    } else {
+      MPI_Comm_dup(com, &member_com);
+    }
+
+    Context::Ptr ctx = context_from_options(member_com, "pismr", member);
     Logger::Ptr log = ctx->log();
 
     std::string usage =
@@ -71,24 +241,77 @@ int main(int argc, char *argv[]) {
     options::String profiling_log = options::String("-profile",
                                                     "Save detailed profiling data to a file.");
 
+    options::String profiling_regions = options::String("-profile_regions",
+                                                        "Save the summary of time spent in"
+                                                        " profiling regions to a JSON file.");
+
+    bool profiling_counters = options::Bool("-profile_counters",
+                                            "Record hardware performance counters in"
+                                            " profiling regions (see -profile_regions).");
+
+    options::String commands = options::String("-commands",
+                                               "Read commands (run_to TIME, checkpoint FILE,"
+                                               " exit) from this file (e.g. a named pipe)"
+                                               " instead of running to the end time.");
+
+    bool memory_report = options::Bool("-memory_report",
+                                       "Print the summary of memory use at the end of the run"
+                                       " and NUMA placement of fields after initialization.");
+
+    bool memo_report = options::Bool("-memo_report",
+                                     "Print the number of re-computations avoided by"
+                                     " memoization at the end of the run.");
+
     Config::Ptr config = ctx->config();
 
+    // each member writes to its own files
+    auto member_file = [member](const std::string &filename) {
+      if (member < 0 or filename.empty()) {
+        return filename;
+      }
+      return filename_add_suffix(filename, "_member", std::to_string(member));
+    };
+
+    if (member >= 0) {
+      for (const auto &name : {"output.file_name", "output.extra.file",
+                               "output.snapshot.file", "output.timeseries.filename"}) {
+        config->set_string(name, member_file(config->get_string(name)));
+      }
+    }
+
     if (profiling_log.is_set()) {
       ctx->profiling().start();
     }
 
+    if (profiling_counters) {
+      ctx->profiling().enable_counters();
+    }
+
     IceGrid::Ptr grid;
     std::unique_ptr<IceModel> model;
 
-    if (options::Bool("-regional", "enable regional (outlet glacier) mode")) {
-      grid = regional_grid_from_options(ctx);
-      model.reset(new IceRegionalModel(grid, ctx));
-    } else {
-      grid = IceGrid::FromOptions(ctx);
-      model.reset(new IceModel(grid, ctx));
-    }
+    const bool regional = options::Bool("-regional", "enable regional (outlet glacier) mode");
 
-    model->init();
+    auto create_model = [&ctx, regional](IceGrid::Ptr g) {
+      // fields allocated by IceModel and not by one of its sub-models
+      MemoryTracker::Owner owner(ctx->memory(), "ice_model");
+
+      std::unique_ptr<IceModel> result;
+      if (regional) {
+        result.reset(new IceRegionalModel(g, ctx));
+      } else {
+        result.reset(new IceModel(g, ctx));
+      }
+      result->init();
+      return result;
+    };
+
+    grid = regional ? regional_grid_from_options(ctx) : IceGrid::FromOptions(ctx);
+    model = create_model(grid);
+
+    if (memory_report) {
+      ctx->memory().report_numa(*log, ctx->com());
+    }
 
     const bool
       list_ascii = options::Bool("-list_diagnostics",
@@ -101,7 +324,52 @@ int main(int argc, char *argv[]) {
     } else if (list_json) {
       model->list_diagnostics_json();
     } else {
-      model->run();
+      auto refinement_times = ctx->time()->parse_times(config->get_string("grid.refinement.times"));
+
+      if (not refinement_times.empty() and commands.is_set()) {
+        throw RuntimeError(PISM_ERROR_LOCATION,
+                           "grid refinement (-refine_times) cannot be combined with -commands");
+      }
+
+      if (not refinement_times.empty() and not config->get_flag("input.bootstrap")) {
+        throw RuntimeError(PISM_ERROR_LOCATION,
+                           "grid refinement (-refine_times) requires bootstrapping");
+      }
+
+      const double run_end = ctx->time()->end();
+
+      for (double t : refinement_times) {
+        if (t <= ctx->time()->current() or t >= run_end) {
+          continue;
+        }
+
+        model->run_to(t);
+
+        // Initialize a model on the refined grid, using fields of the current model
+        // instead of -regrid_file. Bootstrapping provides fields that are not model state
+        // variables.
+        grid = refined_grid(*grid, config->get_number("grid.refinement.factor"));
+        grid->set_regridding_source(model->regridding_source());
+
+        log->message(2, "* Refining the grid to %d x %d at %s...\n",
+                     grid->Mx(), grid->My(), ctx->time()->date(t).c_str());
+
+        auto fine_model = create_model(grid);
+
+        grid->set_regridding_source(nullptr);
+        model = std::move(fine_model);
+
+        // initialization resets the model time
+        ctx->time()->set_start(t);
+        ctx->time()->set(t);
+        ctx->time()->set_end(run_end);
+      }
+
+      if (commands.is_set()) {
+        run_commands(ctx->com(), member_file(commands), *model, member_file);
+      } else {
+        model->run();
+      }
 
       log->message(2, "... done with run\n");
 
@@ -110,13 +378,43 @@ int main(int argc, char *argv[]) {
     print_unused_parameters(*log, 3, *config);
 
     if (profiling_log.is_set()) {
-      ctx->profiling().report(profiling_log);
+      ctx->profiling().report(ctx->com(), member_file(profiling_log));
+    }
+
+    if (profiling_regions.is_set()) {
+      ctx->profiling().report_regions(ctx->com(), member_file(profiling_regions));
+    }
+
+    if (memory_report) {
+      ctx->memory().report(*log, ctx->com());
     }
+
+    if (memo_report) {
+      ctx->memo().report(*log);
+    }
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    try {
+      pio_async_finalize();
+    } catch (...) {
+      // ignore errors: we are stopping anyway
+    }
+    return 1;
+  }
+
+  try {
+    // stop I/O tasks (if any) after the context and grids using them are gone
+    pio_async_finalize();
   }
   catch (...) {
     handle_fatal_errors(com);
     return 1;
   }
 
+  if (member_com != MPI_COMM_NULL) {
+    MPI_Comm_free(&member_com);
+  }
+
   return 0;
 }
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2017, 2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2017, 2019, 2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -22,7 +22,10 @@ static char help[] =
 "  and numerical solution.\n"
 "  Currently implements tests A, B, C, D, E, F, G, H, K, L.\n\n";
 
+#include <cmath>
+#include <cstdio>
 #include <string>
+#include <algorithm>            // std::sort
 
 #include "pism/util/IceGrid.hh"
 #include "pism/util/Config.hh"
@@ -34,6 +37,8 @@ static char help[] =
 #include "pism/util/Logger.hh"
 #include "pism/util/Time.hh"
 #include "pism/util/EnthalpyConverter.hh"
+#include "pism/util/Profiling.hh"
+#include "pism/util/pism_utilities.hh"
 
 using namespace pism;
 
@@ -133,7 +138,22 @@ GridParameters pismv_grid_defaults(Config::Ptr config,
   return P;
 }
 
-IceGrid::Ptr pismv_grid(Context::Ptr ctx, char testname) {
+/*!
+ * Scale the grid with the number of processes, keeping the number of grid points per
+ * process constant (for weak scaling studies).
+ */
+static void weak_scaling_grid(GridParameters &P, unsigned int n_processes, char testname) {
+  if (testname == 'V') {
+    // a flow line setup: scale the grid in the x direction only
+    P.Mx = (P.Mx - 1) * n_processes + 1;
+  } else {
+    const double s = sqrt((double)n_processes);
+    P.Mx = (unsigned int)round((P.Mx - 1) * s) + 1;
+    P.My = (unsigned int)round((P.My - 1) * s) + 1;
+  }
+}
+
+IceGrid::Ptr pismv_grid(Context::Ptr ctx, char testname, bool weak_scaling) {
   auto config = ctx->config();
 
   auto input_file = config->get_string("input.file");
@@ -151,6 +171,9 @@ IceGrid::Ptr pismv_grid(Context::Ptr ctx, char testname) {
     // use defaults set by pismv_grid_defaults()
     GridParameters P = pismv_grid_defaults(ctx->config(), testname);
     P.horizontal_size_from_options();
+    if (weak_scaling) {
+      weak_scaling_grid(P, ctx->size(), testname);
+    }
     P.horizontal_extent_from_options();
     P.vertical_grid_from_options(ctx->config());
     P.ownership_ranges_from_options(ctx->size());
@@ -159,6 +182,86 @@ IceGrid::Ptr pismv_grid(Context::Ptr ctx, char testname) {
   }
 }
 
+/*!
+ * Report the time per step and the time spent in profiling regions during a scaling
+ * study, flagging regions with the load imbalance (the ratio of the maximum and the mean
+ * time over processes) above `imbalance_threshold`.
+ *
+ * Parallel efficiency requires runs using different numbers of processes; see
+ * util/pism_scaling.py.
+ */
+static void scaling_report(const Context &ctx, const IceGrid &grid,
+                           const std::string &mode, const std::string &test,
+                           double wall_time, double imbalance_threshold,
+                           const std::string &filename) {
+  Logger::ConstPtr log = ctx.log();
+
+  auto regions = ctx.profiling().summary(grid.com);
+
+  double steps = 0.0;
+  for (const auto &r : regions) {
+    if (r.name == "step") {
+      steps = r.calls;
+    }
+  }
+
+  const double time_per_step = steps > 0.0 ? wall_time / steps : 0.0;
+
+  log->message(1,
+               "\nScaling study (%s, test %s): %d processes, %d x %d x %d grid"
+               " (%.0f columns per process)\n"
+               "%.0f steps took %.3f s (%.4f s per step)\n",
+               mode.c_str(), test.c_str(), grid.size(), grid.Mx(), grid.My(), grid.Mz(),
+               (double)grid.Mx() * grid.My() / grid.size(),
+               steps, wall_time, time_per_step);
+
+  // regions taking at least 1% of the run time, most expensive first
+  std::vector<Profiling::RegionSummary> expensive;
+  for (const auto &r : regions) {
+    if (r.time_max >= 0.01 * wall_time) {
+      expensive.push_back(r);
+    }
+  }
+  std::sort(expensive.begin(), expensive.end(),
+            [](const Profiling::RegionSummary &a, const Profiling::RegionSummary &b) {
+              return a.time_max > b.time_max;
+            });
+
+  log->message(1, "  %-30s %10s %10s %10s\n", "region", "max (s)", "mean (s)", "imbalance");
+  for (const auto &r : expensive) {
+    log->message(1, "  %-30s %10.3f %10.3f %10.3f%s\n",
+                 r.name.c_str(), r.time_max, r.time_mean, r.imbalance,
+                 r.imbalance > imbalance_threshold ? "  <- load imbalance" : "");
+  }
+
+  int success = 1;
+  if (grid.rank() == 0) {
+    FILE *f = fopen(filename.c_str(), "w");
+
+    if (f == nullptr) {
+      success = 0;
+    } else {
+      fprintf(f,
+              "{\n  \"test\": \"%s\",\n  \"mode\": \"%s\",\n  \"n_processes\": %d,\n"
+              "  \"Mx\": %d,\n  \"My\": %d,\n  \"Mz\": %d,\n  \"steps\": %.0f,\n"
+              "  \"wall_time\": %.6f,\n  \"time_per_step\": %.6f,\n  \"regions\": [",
+              test.c_str(), mode.c_str(), grid.size(), grid.Mx(), grid.My(), grid.Mz(),
+              steps, wall_time, time_per_step);
+      Profiling::write_regions(f, regions);
+      fprintf(f, "\n  ]\n}\n");
+
+      success = fclose(f) == 0 ? 1 : 0;
+    }
+  }
+
+  MPI_Bcast(&success, 1, MPI_INT, 0, grid.com);
+  if (success == 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to write scaling study results to '%s'",
+                                  filename.c_str());
+  }
+}
+
 int main(int argc, char *argv[]) {
   MPI_Comm com = MPI_COMM_WORLD;
 
@@ -190,15 +293,47 @@ int main(int argc, char *argv[]) {
     std::string testname = options::Keyword("-test", "Specifies PISM verification test",
                                             "A,B,C,D,F,G,H,K,L,V", "A");
 
-    IceGrid::Ptr g = pismv_grid(ctx, testname[0]);
+    // scaling studies: take a fixed number of steps on a grid that is fixed (strong
+    // scaling) or grows with the number of processes (weak scaling)
+    std::string scaling = options::Keyword("-scaling",
+                                           "Scaling study mode",
+                                           "none,weak,strong", "none");
+
+    const int scaling_steps = options::Integer("-scaling_steps",
+                                               "Number of time steps to take in a scaling study",
+                                               10);
+
+    const double imbalance_threshold = options::Real("-scaling_imbalance_threshold",
+                                                     "Report regions with the load imbalance"
+                                                     " above this threshold", 1.2);
+
+    options::String scaling_file("-scaling_report",
+                                 "Name of the file to save scaling study results to",
+                                 "pismv_scaling.json");
+
+    if (scaling != "none") {
+      config->set_number("time_stepping.maximum_steps", scaling_steps);
+    }
+
+    IceGrid::Ptr g = pismv_grid(ctx, testname[0], scaling == "weak");
 
     IceCompModel m(g, ctx, testname[0]);
 
     m.init();
 
+    MPI_Barrier(com);
+    const double start = get_time();
+
     m.run();
     log->message(2, "done with run\n");
 
+    if (scaling != "none") {
+      const double wall_time = GlobalMax(com, get_time() - start);
+
+      scaling_report(*ctx, *g, scaling, testname, wall_time, imbalance_threshold,
+                     scaling_file);
+    }
+
     m.reportErrors();
 
     // provide a default output file name if no -o option is given.
@@ -4,5 +4,8 @@
 %}
 
 %shared_ptr(pism::AgeModel)
+// used by energy models updating age during the same sweep over columns
+%ignore pism::AgeModel::ColumnUpdate;
+%ignore pism::AgeColumnSystem::init(int, int, double, const columnSystemCtx &, bool);
 %include "age/AgeModel.hh"
 %include "age/AgeColumnSystem.hh"
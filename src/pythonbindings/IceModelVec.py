@@ -19,3 +19,50 @@ def numpy(self):
         return numpy.array(tmp.get()).reshape(self.shape())
     else:
         return None
+
+
+def local_array(self, read_only=False):
+    """Return a context manager providing a NumPy view of the local part of this field.
+
+    The array shares memory with the underlying PETSc Vec: no data are copied or
+    communicated. It covers the sub-domain owned by this process and ghosts (if any)
+    and has the shape (ym + 2*w, xm + 2*w) for scalar 2D fields and
+    (ym + 2*w, xm + 2*w, N) otherwise (N is the number of degrees of freedom or levels).
+    Here w is the stencil width, so the value at the grid point (i, j) is
+    array[j - ys + w, i - xs + w].
+
+    Usage:
+
+        with field.local_array() as a:
+            a[:] = 2.0 * a
+
+    The state counter of the field is incremented on exit unless read_only is True.
+    Call update_ghosts() after modifying the owned part of a field with ghosts.
+    """
+    import contextlib
+    import numpy as np
+
+    grid = self.grid()
+    w = self.stencil_width()
+    N = max(self.ndof(), len(self.levels()))
+
+    shape = [grid.ym() + 2 * w, grid.xm() + 2 * w]
+    if N > 1:
+        shape.append(N)
+
+    @contextlib.contextmanager
+    def access():
+        self.begin_access()
+        try:
+            with self.vec() as data:
+                view = np.asarray(data).reshape(shape)
+                if read_only:
+                    view.flags.writeable = False
+                yield view
+        finally:
+            self.end_access()
+
+        if not read_only:
+            self.inc_state_counter()
+
+    return access()
@@ -16,7 +16,7 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
-%module(directors="1") cpp
+%module(directors="1", threads="1") cpp
 %feature("autodoc", "2");
 
 /* Don't warn about
@@ -26,6 +26,30 @@
  */
 #pragma SWIG nowarn=312,325,503,512
 
+/* Thread support: director methods (e.g. StepListener implemented in Python) acquire the
+ * GIL when called from C++. Wrapped methods keep the GIL by default (most of them are
+ * cheap, so releasing it would only add overhead); long-running calls listed below
+ * release it, allowing other Python threads to run concurrently with PISM.
+ */
+%nothreadallow;
+%feature("nothreadallow", "0") pism::IceModel::init;
+%feature("nothreadallow", "0") pism::IceModel::run;
+%feature("nothreadallow", "0") pism::IceModel::run_to;
+%feature("nothreadallow", "0") pism::IceModel::run_with_listener;
+%feature("nothreadallow", "0") pism::stressbalance::StressBalance::update;
+%feature("nothreadallow", "0") pism::stressbalance::ShallowStressBalance::update;
+%feature("nothreadallow", "0") pism::stressbalance::SSB_Modifier::update;
+%feature("nothreadallow", "0") pism::energy::EnergyModel::update;
+%feature("nothreadallow", "0") pism::AgeModel::update;
+%feature("nothreadallow", "0") pism::hydrology::Hydrology::update;
+%feature("nothreadallow", "0") pism::bed::BedDef::update;
+%feature("nothreadallow", "0") pism::GeometryEvolution::flow_step;
+%feature("nothreadallow", "0") pism::Poisson::solve;
+%feature("nothreadallow", "0") pism::taoutil::TaoBasicSolver::solve;
+%feature("nothreadallow", "0") pism::inverse::IP_SSATaucTikhonovGNSolver::solve;
+%feature("nothreadallow", "0") pism::inverse::IP_SSATaucForwardProblem::linearize_at;
+%feature("nothreadallow", "0") pism::inverse::IP_SSAHardavForwardProblem::linearize_at;
+
 %{
 // The material in this section is included verbatim in the C++ source code generated by SWIG.
 // The necessary header files required to compile must be included.
@@ -58,6 +82,8 @@
 #include "util/Context.hh"
 #include "util/Logger.hh"
 #include "util/Profiling.hh"
+#include "util/MemoryTracker.hh"
+#include "util/SolverStats.hh"
 
 #include "util/projection.hh"
 #include "energy/bootstrapping.hh"
@@ -196,6 +222,7 @@
 
 %shared_ptr(pism::Logger);
 %shared_ptr(pism::StringLogger);
+%shared_ptr(pism::AsyncLogger);
 %include "util/Logger.hh"
 
 %include pism_options.i
@@ -206,6 +233,8 @@
 %ignore pism::units::Unit::operator=;
 %rename(UnitSystem) pism::units::System;
 %rename(UnitConverter) pism::units::Converter;
+%rename(UnitLinearConverter) pism::units::LinearConverter;
+%ignore pism::units::converter;
 %shared_ptr(pism::units::System);
 %feature("valuewrapper") pism::units::System;
 %feature("valuewrapper") pism::units::Unit;
@@ -214,6 +243,8 @@
 %shared_ptr(pism::MaxTimestep)
 %include "util/MaxTimestep.hh"
 
+%include "util/SolverStats.hh"
+
 %include pism_DM.i
 %include pism_Vec.i
 /* End of independent PISM classes. */
@@ -232,6 +263,8 @@
 /* EnthalpyConverter uses Config, so we need to wrap Config first (see above). */
 %shared_ptr(pism::EnthalpyConverter);
 %shared_ptr(pism::ColdEnthalpyConverter);
+%ignore pism::EnthalpyConverter::temperature(const double *, const double *, unsigned int, double *) const;
+%ignore pism::EnthalpyConverter::water_fraction(const double *, const double *, unsigned int, double *) const;
 %include "util/EnthalpyConverter.hh"
 
 %shared_ptr(pism::Time);
@@ -240,6 +273,8 @@
 %include "util/Time_Calendar.hh"
 
 %include "util/Profiling.hh"
+%ignore pism::MemoryTracker::Owner;
+%include "util/MemoryTracker.hh"
 %shared_ptr(pism::Context);
 %include "util/Context.hh"
 
@@ -370,3 +405,6 @@ pism_class(pism::RegionalYieldStress, "pism/regional/RegionalYieldStress.hh")
 
 pism_class(pism::FractureDensity, "pism/fracturedensity/FractureDensity.hh")
 %include "util/label_components.hh"
+
+/* IceModel uses most of the classes above, so it has to be wrapped last. */
+%include pism_IceModel.i
@@ -8,4 +8,5 @@
 #include "util/ColumnInterpolation.hh"
 %}
 
+%ignore pism::ColumnInterpolation::coarse_to_fine(const double *const *, unsigned int, unsigned int, double *const *) const;
 %include "util/ColumnInterpolation.hh"
@@ -21,5 +21,9 @@
     }
 }
 
+// storage management is internal
+%ignore pism::IceGrid::vec_pool;
+%ignore pism::IceGrid::surface_interpolation;
+
 %shared_ptr(pism::IceGrid);
 %include "util/IceGrid.hh"
@@ -0,0 +1,11 @@
+%{
+#include "icemodel/IceModel.hh"
+%}
+
+/* Allow implementing StepListener in Python. */
+%feature("director") pism::StepListener;
+
+/* RegriddingSource is not wrapped. */
+%ignore pism::IceModel::regridding_source;
+
+%include "icemodel/IceModel.hh"
@@ -3,6 +3,7 @@
 #include "util/IceModelVec2CellType.hh"
 #include "util/iceModelVec2T.hh"
 #include "util/iceModelVec3Custom.hh"
+#include "util/LevelView.hh"
 
 using namespace pism;
 %}
@@ -143,3 +144,8 @@ std::vector<double> interp(int i, int j) {
 %include "util/Vector2.hh"
 
 %include "util/iceModelVec3Custom.hh"
+
+%ignore pism::level_interpolation_weight;
+%ignore pism::LevelView::level;
+%rename(value) pism::LevelView::operator();
+%include "util/LevelView.hh"
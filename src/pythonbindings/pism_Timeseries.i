@@ -18,4 +18,7 @@ using pism::TimeseriesMetadata;
     }
 };
 
+// evaluate() provides the same functionality
+%ignore pism::Timeseries::operator()(double, size_t&) const;
+
 %include "util/Timeseries.hh"
@@ -13,6 +13,9 @@
 %ignore pism::Vars::get_3d_scalar;
 %ignore pism::Vars::keys;
 
+/* typed handles are for C++ code only */
+%ignore pism::VarRef;
+
 /* replace with methods that use shared pointers */
 %rename(add) pism::Vars::add_shared;
 %rename(is_available) pism::Vars::is_available_shared;
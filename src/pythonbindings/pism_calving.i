@@ -4,6 +4,7 @@
 #include "frontretreat/calving/FloatKill.hh"
 #include "frontretreat/calving/HayhurstCalving.hh"
 #include "frontretreat/calving/vonMisesCalving.hh"
+#include "frontretreat/util/IcebergRemover.hh"
 %}
 
 %shared_ptr(pism::calving::CalvingAtThickness)
@@ -29,3 +30,7 @@
 %shared_ptr(pism::calving::vonMisesCalving)
 %rename(CalvingvonMisesCalving) pism::calving::vonMisesCalving;
 %include "frontretreat/calving/vonMisesCalving.hh"
+
+%shared_ptr(pism::calving::IcebergRemover)
+%rename(IcebergRemover) pism::calving::IcebergRemover;
+%include "frontretreat/util/IcebergRemover.hh"
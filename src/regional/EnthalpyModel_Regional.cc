@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017, 2019 PISM Authors
+/* Copyright (C) 2016, 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -70,30 +70,18 @@ void EnthalpyModel_Regional::initialize_impl(const IceModelVec2S &basal_melt_rat
 void EnthalpyModel_Regional::update_impl(double t, double dt,
                                          const Inputs &inputs) {
 
-  unsigned int Mz = m_grid->Mz();
-
+  // EnthalpyModel::update_impl() skips columns in the no-model strip (see
+  // ActiveCellList), keeping the old enthalpy there.
   EnthalpyModel::update_impl(t, dt, inputs);
 
   const IceModelVec2Int &no_model_mask = *inputs.no_model_mask;
 
-  // The update_impl() call above sets m_work; ghosts are communicated
-  // later (in EnergyModel::update()).
-  IceModelVec::AccessList list{&no_model_mask, &m_work, &m_ice_enthalpy,
-      &m_basal_melt_rate, &m_basal_melt_rate_stored};
+  IceModelVec::AccessList list{&no_model_mask, &m_basal_melt_rate, &m_basal_melt_rate_stored};
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
     if (no_model_mask(i, j) > 0.5) {
-      double *new_enthalpy = m_work.get_column(i, j);
-      double *old_enthalpy = m_ice_enthalpy.get_column(i, j);
-
-      // enthalpy
-      for (unsigned int k = 0; k < Mz; ++k) {
-        new_enthalpy[k] = old_enthalpy[k];
-      }
-
-      // basal melt rate
       m_basal_melt_rate(i, j) = m_basal_melt_rate_stored(i, j);
     }
   }
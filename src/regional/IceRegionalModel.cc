@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -193,6 +193,12 @@ void IceRegionalModel::allocate_energy_model() {
     m_ch_system.reset(new energy::CHSystem(m_grid, m_stress_balance.get()));
     m_submodels["cryo-hydrologic warming"] = m_ch_system.get();
   }
+
+  // Update the CH system in the same sweep over columns as the ice enthalpy, if the
+  // energy model supports this (see energy_step()).
+  if (m_ch_system and m_energy_model->set_ch_system(m_ch_system.get())) {
+    m_ch_heating_rate.reset(new IceModelVec3(m_grid, "ch_heating_rate", WITHOUT_GHOSTS));
+  }
 }
 
 void IceRegionalModel::allocate_stressbalance() {
@@ -291,6 +297,14 @@ void IceRegionalModel::energy_step() {
     const IceModelVec3 *strain_heating = inputs.volumetric_heating_rate;
     inputs.volumetric_heating_rate = m_ch_warming_flux.get();
 
+    // strain heating may use a subset of grid levels (see stress_balance.Mz)
+    IceModelVec3 strain_heating_grid;
+    if (strain_heating->levels().size() != m_grid->Mz()) {
+      strain_heating_grid.create(m_grid, "strain_heating", WITHOUT_GHOSTS);
+      stressbalance::velocity_to_grid_levels(*strain_heating, strain_heating_grid);
+      strain_heating = &strain_heating_grid;
+    }
+
     energy::cryo_hydrologic_warming_flux(m_config->get_number("constants.ice.thermal_conductivity"),
                                          m_config->get_number("energy.ch_warming.average_channel_spacing"),
                                          m_geometry.ice_thickness,
@@ -298,14 +312,26 @@ void IceRegionalModel::energy_step() {
                                          m_ch_system->enthalpy(),
                                          *m_ch_warming_flux);
 
-    // Convert to the loss of energy by the CH system:
-    m_ch_warming_flux->scale(-1.0);
+    if (m_energy_model->updates_ch_system()) {
+      // The energy model updates the CH system during its sweep over columns.
+
+      // Loss of energy by the CH system:
+      m_ch_heating_rate->copy_from(*m_ch_warming_flux);
+      m_ch_heating_rate->scale(-1.0);
+      inputs.ch_volumetric_heating_rate = m_ch_heating_rate.get();
 
-    m_ch_system->update(t_TempAge, dt_TempAge, inputs);
+      // Add CH warming flux to the strain heating term:
+      m_ch_warming_flux->add(1.0, *strain_heating);
+    } else {
+      // Convert to the loss of energy by the CH system:
+      m_ch_warming_flux->scale(-1.0);
+
+      m_ch_system->update(t_TempAge, dt_TempAge, inputs);
 
-    // Add CH warming flux to the strain heating term:
-    m_ch_warming_flux->scale(-1.0);
-    m_ch_warming_flux->add(1.0, *strain_heating);
+      // Add CH warming flux to the strain heating term:
+      m_ch_warming_flux->scale(-1.0);
+      m_ch_warming_flux->add(1.0, *strain_heating);
+    }
 
     m_energy_model->update(t_TempAge, dt_TempAge, inputs);
 
@@ -410,14 +436,22 @@ protected:
   }
 };
 
-void IceRegionalModel::init_diagnostics() {
-  IceModel::init_diagnostics();
+DiagnosticFactoryList IceRegionalModel::diagnostic_factories() {
+  auto result = IceModel::diagnostic_factories();
 
   if (m_ch_system) {
-    m_diagnostics["ch_temp"]      = Diagnostic::Ptr(new CHTemperature(this));
-    m_diagnostics["ch_liqfrac"]   = Diagnostic::Ptr(new CHLiquidWaterFraction(this));
-    m_diagnostics["ch_heat_flux"] = Diagnostic::Ptr(new CHHeatFlux(this));
+    result["ch_temp"] = [this]() {
+      return Diagnostic::Ptr(new CHTemperature(this));
+    };
+    result["ch_liqfrac"] = [this]() {
+      return Diagnostic::Ptr(new CHLiquidWaterFraction(this));
+    };
+    result["ch_heat_flux"] = [this]() {
+      return Diagnostic::Ptr(new CHHeatFlux(this));
+    };
   }
+
+  return result;
 }
 
 void IceRegionalModel::hydrology_step() {
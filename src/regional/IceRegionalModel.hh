@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -55,7 +55,7 @@ protected:
   energy::Inputs energy_model_inputs();
   YieldStressInputs yield_stress_inputs();
 
-  void init_diagnostics();
+  DiagnosticFactoryList diagnostic_factories();
 
 private:
   IceModelVec2Int m_no_model_mask;
@@ -64,6 +64,9 @@ private:
 
   std::shared_ptr<energy::CHSystem> m_ch_system;
   IceModelVec3::Ptr m_ch_warming_flux;
+  //! volumetric heating rate of the CH system, used if the energy model updates the CH
+  //! system (see energy::EnergyModel::set_ch_system())
+  IceModelVec3::Ptr m_ch_heating_rate;
 };
 
 } // end of namespace pism
@@ -0,0 +1,91 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>
+#include <algorithm>            // std::max
+
+#include "ArrheniusTable.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace rheology {
+
+/*!
+ * Allocate and fill the table.
+ *
+ * Let @f$ f(T) = A \exp(-Q / (R T)) @f$ and @f$ a(T) = Q / (R T^2) @f$. Then
+ *
+ * @f[ f'' / f = a (a - 2 / T), @f]
+ *
+ * so @f$ |f''| \le c f @f$ with @f$ c = a(T_{\min}) (a(T_{\min}) + 2 / T_{\min}) @f$. The
+ * error of linear interpolation on an interval of length @f$ h @f$ is bounded by
+ * @f$ h^2 / 8 \max |f''| @f$ and @f$ f @f$ grows by at most a factor of
+ * @f$ \exp(a(T_{\min}) h) @f$ over such an interval, so the relative error is at most
+ *
+ * @f[ \frac{h^2}{8} c \exp(a(T_{\min}) h). @f]
+ *
+ * We pick @f$ h @f$ so that this does not exceed `tolerance`.
+ */
+ArrheniusTable::ArrheniusTable(double A, double Q, double R,
+                               double T_min, double T_max, double tolerance)
+  : m_T_min(T_min), m_T_max(T_max) {
+
+  if (not (T_min > 0.0 and T_max > T_min)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid temperature range [%f, %f]", T_min, T_max);
+  }
+
+  if (not (tolerance > 0.0)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid tolerance: %e", tolerance);
+  }
+
+  const double
+    a  = Q / (R * T_min * T_min),
+    c  = a * (a + 2.0 / T_min),
+    h0 = std::sqrt(8.0 * tolerance / c),
+    h  = h0 * std::exp(-0.5 * a * h0);
+
+  const double N = std::ceil((T_max - T_min) / h);
+
+  // 2^24 intervals use 128 MiB
+  if (N > 16777216.0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "tolerance %e requires a lookup table with %e entries;"
+                                  " please increase it", tolerance, N + 1.0);
+  }
+
+  const unsigned int n = std::max(static_cast<unsigned int>(N), 1u);
+  const double dT = (T_max - T_min) / n;
+
+  m_one_over_dT = 1.0 / dT;
+
+  m_values.resize(n + 1);
+  for (unsigned int k = 0; k <= n; ++k) {
+    const double T = T_min + k * dT;
+    m_values[k] = A * std::exp(-Q / (R * T));
+  }
+}
+
+unsigned int ArrheniusTable::size() const {
+  return m_values.size();
+}
+
+} // end of namespace rheology
+} // end of namespace pism
@@ -0,0 +1,69 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_ARRHENIUSTABLE_H
+#define PISM_ARRHENIUSTABLE_H
+
+#include <vector>
+
+namespace pism {
+namespace rheology {
+
+//! Lookup table for the Arrhenius factor @f$ A \exp(-Q / (R T)) @f$.
+/*!
+ * Uses piecewise-linear interpolation on a uniform grid in @f$ [T_{\min}, T_{\max}] @f$.
+ * The grid spacing is chosen using the a priori bound for the interpolation error, so that
+ * the relative error does not exceed a given tolerance.
+ */
+class ArrheniusTable {
+public:
+  ArrheniusTable(double A, double Q, double R,
+                 double T_min, double T_max, double tolerance);
+
+  //! Return true if `T` is within the range covered by the table.
+  bool contains(double T) const {
+    return T >= m_T_min and T <= m_T_max;
+  }
+
+  //! Evaluate the Arrhenius factor. Requires contains(T).
+  double operator()(double T) const {
+    const double x = (T - m_T_min) * m_one_over_dT;
+
+    unsigned int k = static_cast<unsigned int>(x);
+    if (k >= m_values.size() - 1) {
+      k = m_values.size() - 2;
+    }
+
+    const double lambda = x - k;
+
+    return m_values[k] + lambda * (m_values[k + 1] - m_values[k]);
+  }
+
+  unsigned int size() const;
+private:
+  double m_T_min;
+  double m_T_max;
+  double m_one_over_dT;
+  std::vector<double> m_values;
+};
+
+} // end of namespace rheology
+} // end of namespace pism
+
+#endif /* PISM_ARRHENIUSTABLE_H */
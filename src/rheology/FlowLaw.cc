@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2018 Jed Brown, Ed Bueler, and Constantine Khroulev
+// Copyright (C) 2004-2018, 2020 Jed Brown, Ed Bueler, and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -26,6 +26,7 @@
 #include "pism/util/IceGrid.hh"
 
 #include "pism/util/error_handling.hh"
+#include "ArrheniusTable.hh"
 
 namespace pism {
 namespace rheology {
@@ -58,12 +59,38 @@ FlowLaw::FlowLaw(const std::string &prefix, const Config &config,
   m_schoofLen = config.get_number("flow_law.Schoof_regularizing_length", "m"); // convert to meters
   m_schoofVel = config.get_number("flow_law.Schoof_regularizing_velocity", "m second-1"); // convert to m second-1
   m_schoofReg = PetscSqr(m_schoofVel/m_schoofLen);
+
+  if (m_n == 1.0 or m_n == 3.0 or m_n == 4.0) {
+    m_integer_exponent = static_cast<int>(m_n);
+  } else {
+    m_integer_exponent = 0;
+  }
 }
 
 FlowLaw::~FlowLaw() {
   // empty
 }
 
+//! Use lookup tables with the maximum relative error `tolerance` to compute the
+//! Paterson-Budd Arrhenius factor (see softness_paterson_budd()).
+/*!
+ * Does nothing if `tolerance` is zero. FlowLawFactory calls this for flow laws that use
+ * the Paterson-Budd Arrhenius factor.
+ */
+void FlowLaw::use_arrhenius_tables(double tolerance) {
+  if (not (tolerance > 0.0)) {
+    m_arrhenius_cold.reset();
+    m_arrhenius_warm.reset();
+    return;
+  }
+
+  // the cold table covers 100 degrees below the critical temperature
+  m_arrhenius_cold.reset(new ArrheniusTable(m_A_cold, m_Q_cold, m_ideal_gas_constant,
+                                            m_crit_temp - 100.0, m_crit_temp, tolerance));
+  m_arrhenius_warm.reset(new ArrheniusTable(m_A_warm, m_Q_warm, m_ideal_gas_constant,
+                                            m_crit_temp, m_melting_point_temp, tolerance));
+}
+
 std::string FlowLaw::name() const {
   return m_name;
 }
@@ -86,7 +113,18 @@ double FlowLaw::enhancement_factor_interglacial() const {
 
 //! Return the softness parameter A(T) for a given temperature T.
 /*! This is not a natural part of all FlowLaw instances.   */
+/*!
+ * Uses lookup tables if `flow_law.Paterson_Budd.lookup_table_tolerance` is positive and
+ * `T_pa` is in the range they cover.
+ */
 double FlowLaw::softness_paterson_budd(double T_pa) const {
+  if (m_arrhenius_cold) {
+    const ArrheniusTable &table = T_pa < m_crit_temp ? *m_arrhenius_cold : *m_arrhenius_warm;
+    if (table.contains(T_pa)) {
+      return table(T_pa);
+    }
+  }
+
   const double A = T_pa < m_crit_temp ? m_A_cold : m_A_warm;
   const double Q = T_pa < m_crit_temp ? m_Q_cold : m_Q_warm;
 
@@ -101,7 +139,7 @@ double FlowLaw::flow(double stress, double enthalpy,
 
 double FlowLaw::flow_impl(double stress, double enthalpy,
                           double pressure, double /* gs */) const {
-  return softness(enthalpy, pressure) * pow(stress, m_n-1);
+  return softness(enthalpy, pressure) * stress_factor(stress);
 }
 
 void FlowLaw::flow_n(const double *stress, const double *enthalpy,
@@ -140,7 +178,52 @@ void FlowLaw::hardness_n_impl(const double *enthalpy, const double *pressure,
 }
 
 double FlowLaw::hardness_impl(double E, double p) const {
-  return pow(softness(E, p), m_hardness_power);
+  return hardness_from_softness(softness(E, p));
+}
+
+template<int N>
+static void apply_stress_factor_n(const double *stress, unsigned int n, double *result) {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] *= integer_power<N - 1>(stress[k]);
+  }
+}
+
+/*!
+ * Multiply `result` (softness) by the stress-dependent factor in the flow law, i.e.
+ * compute @f$ A(E, p) \sigma^{n-1} @f$.
+ *
+ * This is used by implementations of flow_n() that compute softness for a whole column
+ * first. Loops below have no branches or function calls (except for `pow()`), so
+ * compilers can vectorize them.
+ */
+void FlowLaw::apply_stress_factor(const double *stress, unsigned int n, double *result) const {
+  switch (m_integer_exponent) {
+  case 1:
+    // nothing to do
+    break;
+  case 3:
+    apply_stress_factor_n<3>(stress, n, result);
+    break;
+  case 4:
+    apply_stress_factor_n<4>(stress, n, result);
+    break;
+  default:
+    {
+      const double power = m_n - 1.0;
+      for (unsigned int k = 0; k < n; ++k) {
+        result[k] *= pow(stress[k], power);
+      }
+    }
+  }
+}
+
+/*!
+ * Convert softness values in `result` to hardness: @f$ B = A^{-1/n} @f$.
+ */
+void FlowLaw::softness_to_hardness(unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = hardness_from_softness(result[k]);
+  }
 }
 
 //! \brief Computes the regularized effective viscosity and its derivative with respect to the
@@ -263,6 +346,25 @@ double averaged_hardness(const FlowLaw &ice,
   return B;
 }
 
+//! Computes ice hardness at levels `zlevels[0], ..., zlevels[n - 1]` in a column.
+/*!
+ * Uses the atmospheric pressure at levels above the ice surface. `pressure` is work space
+ * of length `n`. This is the kernel shared by the volumetric strain heating computation
+ * and diagnostics using ice hardness.
+ */
+void hardness_column(const FlowLaw &ice, double thickness,
+                     const double *zlevels, unsigned int n,
+                     const double *enthalpy, double *pressure, double *result) {
+  const EnthalpyConverter &EC = *ice.EC();
+
+  for (unsigned int k = 0; k < n; ++k) {
+    // EC.pressure() handles negative depths correctly
+    pressure[k] = EC.pressure(thickness - zlevels[k]);
+  }
+
+  ice.hardness_n(enthalpy, pressure, n, result);
+}
+
 bool FlowLawUsesGrainSize(const FlowLaw &flow_law) {
   static const double gs[] = {1e-4, 1e-3, 1e-2, 1}, s=1e4, E=400000, p=1e6;
   double ref = flow_law.flow(s, E, p, gs[0]);
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2018 Jed Brown, Ed Bueler, and Constantine Khroulev
+// Copyright (C) 2004-2018, 2020 Jed Brown, Ed Bueler, and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -20,6 +20,8 @@
 #define __flowlaws_hh
 
 #include <string>
+#include <memory>
+#include <cmath>
 
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/util/Vector2.hh"
@@ -54,6 +56,19 @@ static inline double secondInvariant_2D(const Vector2 &U_x, const Vector2 &U_y)
 //! Ice flow laws.
 namespace rheology {
 
+class ArrheniusTable;
+
+//! Compute @f$ x^N @f$ for a non-negative integer `N` known at compile time.
+template<int N>
+inline double integer_power(double x) {
+  return x * integer_power<N - 1>(x);
+}
+
+template<>
+inline double integer_power<0>(double) {
+  return 1.0;
+}
+
 //! Abstract class containing the constitutive relation for the flow of ice (of
 //! the Paterson-Budd type).
 /*!
@@ -89,6 +104,8 @@ public:
 
   EnthalpyConverter::Ptr EC() const;
 
+  void use_arrhenius_tables(double tolerance);
+
   double hardness(double E, double p) const;
   void hardness_n(const double *enthalpy, const double *pressure,
                   unsigned int n, double *result) const;
@@ -121,6 +138,45 @@ protected:
 
   double softness_paterson_budd(double T_pa) const;
 
+  void apply_stress_factor(const double *stress, unsigned int n, double *result) const;
+  void softness_to_hardness(unsigned int n, double *result) const;
+
+  //! Compute @f$ \sigma^{n-1} @f$, avoiding `pow()` for common integer exponents.
+  double stress_factor(double stress) const {
+    switch (m_integer_exponent) {
+    case 1:
+      return 1.0;
+    case 3:
+      return integer_power<2>(stress);
+    case 4:
+      return integer_power<3>(stress);
+    default:
+      return pow(stress, m_n - 1.0);
+    }
+  }
+
+  //! Compute hardness @f$ B = A^{-1/n} @f$ given softness @f$ A @f$.
+  double hardness_from_softness(double A) const {
+    switch (m_integer_exponent) {
+    case 1:
+      return 1.0 / A;
+    case 3:
+      return 1.0 / cbrt(A);
+    case 4:
+      return 1.0 / sqrt(sqrt(A));
+    default:
+      return pow(A, m_hardness_power);
+    }
+  }
+
+  //! Glen exponent if it is equal to 1, 3, or 4; zero otherwise.
+  int m_integer_exponent;
+
+  //! lookup tables for the Paterson-Budd Arrhenius factor (cold and warm cases; NULL if
+  //! disabled or not used by this flow law; see use_arrhenius_tables())
+  std::shared_ptr<ArrheniusTable> m_arrhenius_cold;
+  std::shared_ptr<ArrheniusTable> m_arrhenius_warm;
+
   //! regularizing length
   double m_schoofLen;
   //! regularizing velocity
@@ -167,6 +223,10 @@ void averaged_hardness_vec(const FlowLaw &ice,
                            const IceModelVec3  &enthalpy,
                            IceModelVec2S &result);
 
+void hardness_column(const FlowLaw &ice, double ice_thickness,
+                     const double *zlevels, unsigned int n,
+                     const double *enthalpy, double *pressure, double *result);
+
 // Helper functions:
 bool FlowLawUsesGrainSize(const FlowLaw &flow_law);
 
@@ -33,6 +33,15 @@
 namespace pism {
 namespace rheology {
 
+//! Set up lookup tables for the Paterson-Budd Arrhenius factor if they are enabled.
+/*!
+ * Only flow laws that use FlowLaw::softness_paterson_budd() need these tables.
+ */
+static FlowLaw* with_arrhenius_tables(FlowLaw *flow_law, const Config &config) {
+  flow_law->use_arrhenius_tables(config.get_number("flow_law.Paterson_Budd.lookup_table_tolerance"));
+  return flow_law;
+}
+
 FlowLaw* create_isothermal_glen(const std::string &pre,
                                 const Config &config, EnthalpyConverter::Ptr EC) {
   return new (IsothermalGlen)(pre, config, EC);
@@ -40,12 +49,12 @@ FlowLaw* create_isothermal_glen(const std::string &pre,
 
 FlowLaw* create_pb(const std::string &pre,
                    const Config &config, EnthalpyConverter::Ptr EC) {
-  return new (PatersonBudd)(pre, config, EC);
+  return with_arrhenius_tables(new (PatersonBudd)(pre, config, EC), config);
 }
 
 FlowLaw* create_gpbld(const std::string &pre,
                       const Config &config, EnthalpyConverter::Ptr EC) {
-  return new (GPBLD)(pre, config, EC);
+  return with_arrhenius_tables(new (GPBLD)(pre, config, EC), config);
 }
 
 FlowLaw* create_hooke(const std::string &pre,
@@ -65,7 +74,7 @@ FlowLaw* create_arrwarm(const std::string &pre,
 
 FlowLaw* create_goldsby_kohlstedt(const std::string &pre,
                                   const Config &config, EnthalpyConverter::Ptr EC) {
-  return new (GoldsbyKohlstedt)(pre, config, EC);
+  return with_arrhenius_tables(new (GoldsbyKohlstedt)(pre, config, EC), config);
 }
 
 FlowLawFactory::FlowLawFactory(const std::string &prefix,
@@ -60,5 +60,31 @@ double GPBLD::softness_impl(double enthalpy, double pressure) const {
   }
 }
 
+/*!
+ * Compute the flow law for a column.
+ *
+ * Evaluates softness for all points first (without virtual function calls) and then
+ * multiplies by the stress-dependent factor: this is faster than calling flow() at each
+ * point.
+ */
+void GPBLD::flow_n_impl(const double *stress, const double *E,
+                        const double *pressure, const double * /* grainsize */,
+                        unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = GPBLD::softness_impl(E[k], pressure[k]);
+  }
+
+  apply_stress_factor(stress, n, result);
+}
+
+void GPBLD::hardness_n_impl(const double *enthalpy, const double *pressure,
+                            unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = GPBLD::softness_impl(enthalpy[k], pressure[k]);
+  }
+
+  softness_to_hardness(n, result);
+}
+
 } // end of namespace rheology
 } // end of namespace pism
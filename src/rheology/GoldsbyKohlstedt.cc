@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016 PISM Authors
+/* Copyright (C) 2015, 2016, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -110,43 +110,79 @@ double GoldsbyKohlstedt::softness_impl(double , double) const {
   This is the (forward) Goldsby-Kohlstedt flow law.  See:
   D. L. Goldsby & D. L. Kohlstedt (2001), "Superplastic deformation
   of ice: experimental observations", J. Geophys. Res. 106(M6), 11017-11030.
+
+  Powers of the stress and the grain size are combined with the Arrhenius factors of
+  creep mechanisms, so each mechanism needs one `exp()` (and the point needs two
+  `log()` calls) instead of an `exp()` and a `pow()` per mechanism. Cold/warm switches
+  are written as selections so that flow_n_impl() can be vectorized.
 */
 double GoldsbyKohlstedt::flow_from_temp(double stress, double temp,
                                         double pressure, double gs) const {
-  double eps_diff, eps_disl, eps_basal, eps_gbs, diff_D_b;
+  // avoid log(0) below; the result is set to zero at the end
+  const bool zero_stress = fabs(stress) < 1e-10;
+
+  const double
+    T          = temp + (m_beta_CC_grad / (m_rho * m_standard_gravity)) * pressure,
+    pV         = pressure * m_V_act_vol,
+    RT         = m_ideal_gas_constant * T,
+    x          = -1.0 / RT,
+    log_stress = log(zero_stress ? 1.0 : stress),
+    log_gs     = log(gs);
 
-  if (fabs(stress) < 1e-10) {
-    return 0;
-  }
-  const double T = temp + (m_beta_CC_grad / (m_rho * m_standard_gravity)) * pressure;
-  const double pV = pressure * m_V_act_vol;
-  const double RT = m_ideal_gas_constant * T;
   // Diffusional Flow
-  const double diff_D_v = m_diff_D_0v * exp(-m_diff_Q_v/RT);
-  diff_D_b = m_diff_D_0b * exp(-m_diff_Q_b/RT);
-  if (T > m_diff_crit_temp) {
-    diff_D_b *= 1000; // Coble creep scaling
-  }
-  eps_diff = 42 * m_diff_V_m *
+  const double
+    diff_D_v = m_diff_D_0v * exp(m_diff_Q_v * x),
+    // Coble creep scaling
+    diff_D_b = (T > m_diff_crit_temp ? 1000.0 : 1.0) * m_diff_D_0b * exp(m_diff_Q_b * x),
+    eps_diff = 42 * m_diff_V_m *
     (diff_D_v + M_PI * m_diff_delta * diff_D_b / gs) / (RT*(gs*gs));
+
   // Dislocation Creep
-  if (T > m_disl_crit_temp) {
-    eps_disl = m_disl_A_warm * pow(stress, m_disl_n-1) * exp(-(m_disl_Q_warm + pV)/RT);
-  } else {
-    eps_disl = m_disl_A_cold * pow(stress, m_disl_n-1) * exp(-(m_disl_Q_cold + pV)/RT);
-  }
+  const bool disl_warm = T > m_disl_crit_temp;
+  const double eps_disl = (disl_warm ? m_disl_A_warm : m_disl_A_cold) *
+    exp((m_disl_n - 1) * log_stress + ((disl_warm ? m_disl_Q_warm : m_disl_Q_cold) + pV) * x);
+
   // Basal Slip
-  eps_basal = m_basal_A * pow(stress, m_basal_n-1) * exp(-(m_basal_Q + pV)/RT);
+  const double eps_basal = m_basal_A *
+    exp((m_basal_n - 1) * log_stress + (m_basal_Q + pV) * x);
+
   // Grain Boundary Sliding
-  if (T > m_gbs_crit_temp) {
-    eps_gbs = m_gbs_A_warm * (pow(stress, m_gbs_n-1) / pow(gs, m_p_grain_sz_exp)) *
-      exp(-(m_gbs_Q_warm + pV)/RT);
-  } else {
-    eps_gbs = m_gbs_A_cold * (pow(stress, m_gbs_n-1) / pow(gs, m_p_grain_sz_exp)) *
-      exp(-(m_gbs_Q_cold + pV)/RT);
+  const bool gbs_warm = T > m_gbs_crit_temp;
+  const double eps_gbs = (gbs_warm ? m_gbs_A_warm : m_gbs_A_cold) *
+    exp((m_gbs_n - 1) * log_stress - m_p_grain_sz_exp * log_gs +
+        ((gbs_warm ? m_gbs_Q_warm : m_gbs_Q_cold) + pV) * x);
+
+  const double result = eps_diff + eps_disl + (eps_basal * eps_gbs) / (eps_basal + eps_gbs);
+
+  return zero_stress ? 0.0 : result;
+}
+
+/*!
+ * Compute the flow law for a column.
+ *
+ * Converts enthalpy to temperature for all points first (storing temperatures in
+ * `result`) and then evaluates the flow law without virtual function calls.
+ */
+void GoldsbyKohlstedt::flow_n_impl(const double *stress, const double *E,
+                                   const double *pressure, const double *grainsize,
+                                   unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_EC->temperature(E[k], pressure[k]);
   }
 
-  return eps_diff + eps_disl + (eps_basal * eps_gbs) / (eps_basal + eps_gbs);
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = GoldsbyKohlstedt::flow_from_temp(stress[k], result[k], pressure[k], grainsize[k]);
+  }
+}
+
+void GoldsbyKohlstedt::hardness_n_impl(const double *enthalpy, const double *pressure,
+                                       unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = softness_paterson_budd(m_EC->pressure_adjusted_temperature(enthalpy[k],
+                                                                           pressure[k]));
+  }
+
+  softness_to_hardness(n, result);
 }
 
 
@@ -207,6 +243,9 @@ GoldsbyKohlstedtStripped::GoldsbyKohlstedtStripped(const std::string &prefix,
   m_name = "Goldsby-Kohlstedt / Paterson-Budd (hybrid, simplified)";
 
   m_d_grain_size_stripped = 3.0e-3;  // m; = 3mm  (see Peltier et al 2000 paper)
+
+  // the grain size is fixed, so the grain size factor in the GBS term is too
+  m_log_grain_size_term = m_p_grain_sz_exp * log(m_d_grain_size_stripped);
 }
 
 
@@ -214,36 +253,45 @@ double GoldsbyKohlstedtStripped::flow_from_temp(double stress, double temp, doub
   // note value of gs is ignored
   // note pressure only effects the temperature; the "P V" term is dropped
   // note no diffusional flow
-  double eps_disl, eps_basal, eps_gbs;
+  const bool zero_stress = fabs(stress) < 1e-10;
+
+  const double
+    T          = temp + (m_beta_CC_grad / (m_rho * m_standard_gravity)) * pressure,
+    x          = -1.0 / (m_ideal_gas_constant * T),
+    log_stress = log(zero_stress ? 1.0 : stress);
 
-  if (fabs(stress) < 1e-10) {
-    return 0;
-  }
-  const double T = temp + (m_beta_CC_grad / (m_rho * m_standard_gravity)) * pressure;
-  const double RT = m_ideal_gas_constant * T;
   // NO Diffusional Flow
   // Dislocation Creep
-  if (T > m_disl_crit_temp) {
-    eps_disl = m_disl_A_warm * pow(stress, m_disl_n-1) * exp(-m_disl_Q_warm/RT);
-  } else {
-    eps_disl = m_disl_A_cold * pow(stress, m_disl_n-1) * exp(-m_disl_Q_cold/RT);
-  }
+  const bool disl_warm = T > m_disl_crit_temp;
+  const double eps_disl = (disl_warm ? m_disl_A_warm : m_disl_A_cold) *
+    exp((m_disl_n - 1) * log_stress + (disl_warm ? m_disl_Q_warm : m_disl_Q_cold) * x);
+
   // Basal Slip
-  eps_basal = m_basal_A * pow(stress, m_basal_n-1) * exp(-m_basal_Q/RT);
+  const double eps_basal = m_basal_A * exp((m_basal_n - 1) * log_stress + m_basal_Q * x);
+
   // Grain Boundary Sliding
-  if (T > m_gbs_crit_temp) {
-    eps_gbs = m_gbs_A_warm *
-      (pow(stress, m_gbs_n-1) / pow(m_d_grain_size_stripped, m_p_grain_sz_exp)) *
-      exp(-m_gbs_Q_warm/RT);
-  } else {
-    eps_gbs = m_gbs_A_cold *
-      (pow(stress, m_gbs_n-1) / pow(m_d_grain_size_stripped, m_p_grain_sz_exp)) *
-      exp(-m_gbs_Q_cold/RT);
-  }
+  const bool gbs_warm = T > m_gbs_crit_temp;
+  const double eps_gbs = (gbs_warm ? m_gbs_A_warm : m_gbs_A_cold) *
+    exp((m_gbs_n - 1) * log_stress - m_log_grain_size_term +
+        (gbs_warm ? m_gbs_Q_warm : m_gbs_Q_cold) * x);
 
-  return eps_disl + (eps_basal * eps_gbs) / (eps_basal + eps_gbs);
+  const double result = eps_disl + (eps_basal * eps_gbs) / (eps_basal + eps_gbs);
+
+  return zero_stress ? 0.0 : result;
 }
 
+void GoldsbyKohlstedtStripped::flow_n_impl(const double *stress, const double *E,
+                                           const double *pressure, const double *grainsize,
+                                           unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_EC->temperature(E[k], pressure[k]);
+  }
+
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = GoldsbyKohlstedtStripped::flow_from_temp(stress[k], result[k],
+                                                         pressure[k], grainsize[k]);
+  }
+}
 
 } // end of namespace rheology
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016 PISM Authors
+/* Copyright (C) 2015, 2016, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -53,6 +53,11 @@ protected:
 
   virtual double flow_impl(double stress, double E,
                            double pressure, double grainsize) const;
+  virtual void flow_n_impl(const double *stress, const double *E,
+                           const double *pressure, const double *grainsize,
+                           unsigned int n, double *result) const;
+  virtual void hardness_n_impl(const double *enthalpy, const double *pressure,
+                               unsigned int n, double *result) const;
 
   // NB! not virtual
   double softness_impl(double E, double p) const __attribute__((noreturn));
@@ -86,8 +91,13 @@ public:
 protected:
   virtual double flow_from_temp(double stress, double temp,
                                 double pressure, double gs) const;
+  virtual void flow_n_impl(const double *stress, const double *E,
+                           const double *pressure, const double *grainsize,
+                           unsigned int n, double *result) const;
 
   double m_d_grain_size_stripped;
+  //! @f$ p \log d @f$, where @f$ d @f$ is the (fixed) grain size
+  double m_log_grain_size_term;
 };
 
 } // end of namespace rheology
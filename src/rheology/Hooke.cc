@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -48,5 +48,40 @@ double Hooke::softness_from_temp(double T_pa) const {
                          + 3.0 * m_C_Hooke * pow(m_Tr_Hooke - T_pa, -m_K_Hooke));
 }
 
+/*!
+ * Compute the flow law for a column.
+ *
+ * Evaluates softness for all points first (calling the Hooke formula directly, without
+ * virtual function calls) and then multiplies by the stress-dependent factor.
+ */
+void Hooke::flow_n_impl(const double *stress, const double *E,
+                        const double *pressure, const double * /* grainsize */,
+                        unsigned int n, double *result) const {
+  const double C = m_beta_CC_grad / (m_rho * m_standard_gravity);
+
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_EC->temperature(E[k], pressure[k]);
+  }
+
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = Hooke::softness_from_temp(result[k] + C * pressure[k]);
+  }
+
+  apply_stress_factor(stress, n, result);
+}
+
+void Hooke::hardness_n_impl(const double *enthalpy, const double *pressure,
+                            unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_EC->pressure_adjusted_temperature(enthalpy[k], pressure[k]);
+  }
+
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = Hooke::softness_from_temp(result[k]);
+  }
+
+  softness_to_hardness(n, result);
+}
+
 } // end of namespace rheology
 } // end of namespace pism
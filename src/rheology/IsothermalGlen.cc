@@ -35,7 +35,7 @@ IsothermalGlen::IsothermalGlen(const std::string &prefix,
 }
 
 double IsothermalGlen::flow_impl(double stress, double, double, double) const {
-  return m_softness_A * pow(stress, m_n-1);
+  return m_softness_A * stress_factor(stress);
 }
 
 double IsothermalGlen::softness_impl(double, double) const {
@@ -46,8 +46,25 @@ double IsothermalGlen::hardness_impl(double, double) const {
   return m_hardness_B;
 }
 
+void IsothermalGlen::flow_n_impl(const double *stress, const double *,
+                                 const double *, const double *,
+                                 unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_softness_A;
+  }
+
+  apply_stress_factor(stress, n, result);
+}
+
+void IsothermalGlen::hardness_n_impl(const double *, const double *,
+                                     unsigned int n, double *result) const {
+  for (unsigned int k = 0; k < n; ++k) {
+    result[k] = m_hardness_B;
+  }
+}
+
 double IsothermalGlen::flow_from_temp(double stress, double, double, double) const {
-  return m_softness_A * pow(stress,m_n-1);
+  return m_softness_A * stress_factor(stress);
 }
 
 } // end of namespace rheology
@@ -55,7 +55,7 @@ double PatersonBudd::flow_from_temp(double stress, double temp,
                                     double pressure, double /*gs*/) const {
   // pressure-adjusted temperature:
   const double T_pa = temp + (m_beta_CC_grad / (m_rho * m_standard_gravity)) * pressure;
-  return softness_from_temp(T_pa) * pow(stress, m_n-1);
+  return softness_from_temp(T_pa) * stress_factor(stress);
 }
 
 double PatersonBudd::softness_from_temp(double T_pa) const {
@@ -63,7 +63,7 @@ double PatersonBudd::softness_from_temp(double T_pa) const {
 }
 
 double PatersonBudd::hardness_from_temp(double T_pa) const {
-  return pow(softness_from_temp(T_pa), m_hardness_power);
+  return hardness_from_softness(softness_from_temp(T_pa));
 }
 
 } // end of namespace rheology
@@ -47,7 +47,7 @@ double PatersonBuddCold::softness_from_temp(double T_pa) const {
 // ignores pressure and uses non-pressure-adjusted temperature
 double PatersonBuddCold::flow_from_temp(double stress, double temp,
                                         double , double) const {
-  return softness_from_temp(temp) * pow(stress,m_n-1);
+  return softness_from_temp(temp) * stress_factor(stress);
 }
 
 
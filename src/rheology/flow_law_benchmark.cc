@@ -0,0 +1,141 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+static char help[] =
+  "Compares the speed of FlowLaw::flow_n() and FlowLaw::hardness_n() to the\n"
+  "calls of FlowLaw::flow() and FlowLaw::hardness() at each point.\n\n";
+
+#include <cmath>
+#include <vector>
+#include <algorithm>            // std::max
+
+#include "pism/rheology/FlowLawFactory.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/EnthalpyConverter.hh"
+#include "pism/util/Logger.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/pism_options.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/petscwrappers/PetscInitializer.hh"
+
+static double max_relative_difference(const std::vector<double> &a,
+                                      const std::vector<double> &b) {
+  double result = 0.0;
+  for (unsigned int k = 0; k < a.size(); ++k) {
+    result = std::max(result, std::fabs(a[k] - b[k]) / std::max(std::fabs(a[k]), 1e-300));
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  using namespace pism;
+
+  MPI_Comm com = MPI_COMM_WORLD;
+  petsc::Initializer petsc(argc, argv, help);
+
+  com = PETSC_COMM_WORLD;
+
+  try {
+    Context::Ptr ctx = context_from_options(com, "flow_law_benchmark");
+    Logger::ConstPtr log = ctx->log();
+    EnthalpyConverter::Ptr EC = ctx->enthalpy_converter();
+
+    const int
+      N      = options::Integer("-N", "number of points in a column", 1001),
+      repeat = options::Integer("-repeat", "number of repetitions", 1000);
+
+    // ice with temperatures from -30 to 0 Celsius and water fractions from 0 to 2%
+    // (about one third of the column is temperate), 3000 m thick
+    const double
+      H       = 3000.0,
+      T_melt  = EC->melting_temperature(0.0),
+      T_min   = T_melt - 30.0,
+      tau_max = 2e5;            // Pa
+
+    std::vector<double> P(N), E(N), S(N), gs(N, 1e-3);
+    for (int k = 0; k < N; ++k) {
+      const double s = k / (N - 1.0);
+
+      P[k] = EC->pressure(H * (1.0 - s));
+      S[k] = tau_max * (1.0 - s);
+
+      if (s < 1.0 / 3.0) {
+        E[k] = EC->enthalpy(EC->melting_temperature(P[k]), 0.02 * (1.0 - 3.0 * s), P[k]);
+      } else {
+        const double T = T_min + (T_melt - T_min) * (1.0 - s) * 1.5;
+        E[k] = EC->enthalpy(std::min(T, EC->melting_temperature(P[k])), 0.0, P[k]);
+      }
+    }
+
+    std::vector<double> scalar(N), batch(N);
+
+    auto flow_law = rheology::FlowLawFactory("stress_balance.sia.",
+                                             ctx->config(), EC).create();
+
+    log->message(1, "Flow law: %s, %d points, %d repetitions\n\n",
+                 flow_law->name().c_str(), N, repeat);
+
+    // flow()
+    {
+      double t0 = get_time();
+      for (int r = 0; r < repeat; ++r) {
+        for (int k = 0; k < N; ++k) {
+          scalar[k] = flow_law->flow(S[k], E[k], P[k], gs[k]);
+        }
+      }
+      double t1 = get_time();
+      for (int r = 0; r < repeat; ++r) {
+        flow_law->flow_n(S.data(), E.data(), P.data(), gs.data(), N, batch.data());
+      }
+      double t2 = get_time();
+
+      log->message(1,
+                   "flow():       %f s\n"
+                   "flow_n():     %f s (speedup: %.2f, max. relative difference: %e)\n\n",
+                   t1 - t0, t2 - t1, (t1 - t0) / (t2 - t1),
+                   max_relative_difference(scalar, batch));
+    }
+
+    // hardness()
+    {
+      double t0 = get_time();
+      for (int r = 0; r < repeat; ++r) {
+        for (int k = 0; k < N; ++k) {
+          scalar[k] = flow_law->hardness(E[k], P[k]);
+        }
+      }
+      double t1 = get_time();
+      for (int r = 0; r < repeat; ++r) {
+        flow_law->hardness_n(E.data(), P.data(), N, batch.data());
+      }
+      double t2 = get_time();
+
+      log->message(1,
+                   "hardness():   %f s\n"
+                   "hardness_n(): %f s (speedup: %.2f, max. relative difference: %e)\n",
+                   t1 - t0, t2 - t1, (t1 - t0) / (t2 - t1),
+                   max_relative_difference(scalar, batch));
+    }
+  }
+  catch (...) {
+    handle_fatal_errors(com);
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,4 +1,4 @@
-// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 Constantine Khroulev and Ed Bueler
+// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 Constantine Khroulev and Ed Bueler
 //
 // This file is part of PISM.
 //
@@ -16,26 +16,98 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cmath>                // std::round
+
 #include "SSB_Modifier.hh"
 #include "pism/rheology/FlowLawFactory.hh"
 #include "pism/rheology/FlowLaw.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/ColumnInterpolation.hh"
+#include "pism/util/error_handling.hh"
 #include "pism/util/Vars.hh"
+#include "pism/util/GhostUpdateBatch.hh"
 #include "pism/stressbalance/StressBalance.hh"
 
 namespace pism {
 namespace stressbalance {
 
+std::vector<unsigned int> velocity_level_indices(const IceGrid &grid) {
+  const int
+    Mz        = grid.Mz(),
+    Mz_coarse = grid.ctx()->config()->get_number("stress_balance.Mz");
+
+  if (Mz_coarse < 0 or Mz_coarse == 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "stress_balance.Mz = %d is invalid (has to be 0 or at least 2)",
+                                  Mz_coarse);
+  }
+
+  std::vector<unsigned int> result;
+
+  if (Mz_coarse == 0 or Mz_coarse >= Mz) {
+    for (int k = 0; k < Mz; ++k) {
+      result.push_back(k);
+    }
+    return result;
+  }
+
+  // Levels are distinct because (Mz - 1) / (Mz_coarse - 1) > 1.
+  const double step = (Mz - 1.0) / (Mz_coarse - 1.0);
+  for (int m = 0; m < Mz_coarse; ++m) {
+    result.push_back(static_cast<unsigned int>(std::round(m * step)));
+  }
+
+  return result;
+}
+
+std::vector<double> velocity_levels(const IceGrid &grid) {
+  const std::vector<double> &z = grid.z();
+
+  std::vector<double> result;
+  for (auto k : velocity_level_indices(grid)) {
+    result.push_back(z[k]);
+  }
+  return result;
+}
+
+void velocity_to_grid_levels(const IceModelVec3 &input, IceModelVec3 &result) {
+  IceGrid::ConstPtr grid = result.grid();
+
+  const std::vector<double> z = input.levels();
+
+  if (z.size() == grid->Mz()) {
+    result.copy_from(input);
+    return;
+  }
+
+  ColumnInterpolation interp(z, grid->z());
+  const unsigned int ks = grid->Mz() - 1;
+
+  IceModelVec::AccessList list{&input, &result};
+
+  for (Points p(*grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    interp.coarse_to_fine(input.get_column(i, j), ks, result.get_column(i, j));
+  }
+
+  result.update_ghosts();
+}
+
 SSB_Modifier::SSB_Modifier(IceGrid::ConstPtr g)
   : Component(g),
     m_EC(g->ctx()->enthalpy_converter()),
-    m_diffusive_flux(m_grid, "diffusive_flux", WITH_GHOSTS, 1),
-    m_u(m_grid, "uvel", WITH_GHOSTS),
-    m_v(m_grid, "vvel", WITH_GHOSTS),
-    m_strain_heating(m_grid, "strainheat", WITHOUT_GHOSTS) {
+    m_diffusive_flux(m_grid, "diffusive_flux", WITH_GHOSTS, 1) {
   m_D_max = 0.0;
 
+  const std::vector<double> levels = velocity_levels(*m_grid);
+
+  m_u.create(m_grid, "uvel", WITH_GHOSTS, levels);
+  m_v.create(m_grid, "vvel", WITH_GHOSTS, levels);
+  m_strain_heating.create(m_grid, "strainheat", WITHOUT_GHOSTS, levels);
+
   m_u.set_attrs("diagnostic", "horizontal velocity of ice in the X direction",
                 "m s-1", "m year-1", "land_ice_x_velocity", 0);
 
@@ -86,6 +158,10 @@ std::string SSB_Modifier::stdout_report() const {
   return "";
 }
 
+bool SSB_Modifier::depth_independent() const {
+  return false;
+}
+
 std::shared_ptr<const rheology::FlowLaw> SSB_Modifier::flow_law() const {
   return m_flow_law;
 }
@@ -99,21 +175,24 @@ ConstantInColumn::ConstantInColumn(IceGrid::ConstPtr g)
   rheology::FlowLawFactory ice_factory("stress_balance.sia.", m_config, m_EC);
 
   m_flow_law = ice_factory.create();
+
+  // this modifier does not add a diffusive flux
+  m_diffusive_flux.set(0.0);
 }
 
 ConstantInColumn::~ConstantInColumn() {
   // empty
 }
 
+bool ConstantInColumn::depth_independent() const {
+  return true;
+}
+
 
 //! \brief Distribute the input velocity throughout the column.
 /*!
- * Things to update:
- * - 3D-distributed horizontal velocity
- * - maximum horizontal velocity
- * - diffusive ice flux
- * - maximum diffusivity
- * - strain heating (strain_heating)
+ * Updates the 3D-distributed horizontal velocity only: the diffusive flux and the
+ * maximum diffusivity are always zero (see the constructor).
  */
 void ConstantInColumn::update(const IceModelVec2V &sliding_velocity,
                               const Inputs &inputs,
@@ -136,12 +215,7 @@ void ConstantInColumn::update(const IceModelVec2V &sliding_velocity,
   }
 
   // Communicate to get ghosts (needed to compute w):
-  m_u.update_ghosts();
-  m_v.update_ghosts();
-
-  // diffusive flux and maximum diffusivity
-  m_diffusive_flux.set(0.0);
-  m_D_max = 0.0;
+  GhostUpdateBatch{&m_u, &m_v}.update();
 }
 
 } // end of namespace stressbalance
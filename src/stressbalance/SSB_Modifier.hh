@@ -1,4 +1,4 @@
-// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 Constantine Khroulev and Ed Bueler
+// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 Constantine Khroulev and Ed Bueler
 //
 // This file is part of PISM.
 //
@@ -35,6 +35,21 @@ namespace stressbalance {
 
 class Inputs;
 
+/*!
+ * Indices of the levels of the vertical grid used to store 3D velocity and strain heating
+ * (see the configuration parameter `stress_balance.Mz`).
+ *
+ * These levels are a subset of the levels of `grid` and always include the base and the
+ * top of the computational domain.
+ */
+std::vector<unsigned int> velocity_level_indices(const IceGrid &grid);
+
+//! Levels used to store 3D velocity and strain heating (see velocity_level_indices()).
+std::vector<double> velocity_levels(const IceGrid &grid);
+
+//! Interpolate `input` (stored using velocity_levels()) to levels of the grid.
+void velocity_to_grid_levels(const IceModelVec3 &input, IceModelVec3 &result);
+
 //! Shallow stress balance modifier (such as the non-sliding SIA).
 class SSB_Modifier : public Component {
 public:
@@ -61,6 +76,9 @@ public:
 
   virtual std::string stdout_report() const;
 
+  //! True if the 3D velocity is the same at all depths (a copy of the sliding velocity).
+  virtual bool depth_independent() const;
+
   std::shared_ptr<const rheology::FlowLaw> flow_law() const;
 
 protected:
@@ -83,6 +101,8 @@ public:
   virtual void update(const IceModelVec2V &sliding_velocity,
                       const Inputs &inputs,
                       bool full_update);
+
+  virtual bool depth_independent() const;
 };
 
 } // end of namespace stressbalance
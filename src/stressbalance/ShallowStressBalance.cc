@@ -105,6 +105,117 @@ const IceBasalResistancePlasticLaw* ShallowStressBalance::sliding_law() const {
   return m_basal_sliding_law;
 }
 
+//! Number of nonlinear iterations used by the last update() (0 if it did not solve).
+unsigned int ShallowStressBalance::nonlinear_iterations() const {
+  return m_solver_stats.nonlinear_iterations;
+}
+
+//! Total number of linear solver iterations used by the last update().
+unsigned int ShallowStressBalance::linear_iterations() const {
+  return m_solver_stats.linear_iterations;
+}
+
+/*!
+ * Statistics of the last update(): the number of solves and iterations, the wall-clock
+ * time, and the convergence history (if recorded by the solver).
+ */
+const SolverStats& ShallowStressBalance::solver_stats() const {
+  return m_solver_stats;
+}
+
+/*!
+ * Save the current velocity (the solution at the model time `time`) to extrapolate
+ * initial guesses for later solves.
+ *
+ * Keeps 2 solutions for `linear` and 3 for `quadratic` extrapolation. A solution
+ * computed at the same time as the most recent saved one replaces it.
+ */
+void ShallowStressBalance::record_velocity(double time) {
+  const std::string method = m_config->get_string("stress_balance.ssa.initial_guess_extrapolation");
+
+  unsigned int N = 0;
+  if (method == "linear") {
+    N = 2;
+  } else if (method == "quadratic") {
+    N = 3;
+  }
+
+  if (N == 0) {
+    return;
+  }
+
+  if (not m_velocity_history_times.empty() and
+      not (time > m_velocity_history_times.back())) {
+    m_velocity_history_times.pop_back();
+    IceModelVec2V::Ptr v = m_velocity_history.back();
+    m_velocity_history.pop_back();
+
+    v->copy_from(m_velocity);
+    m_velocity_history.push_back(v);
+    m_velocity_history_times.push_back(time);
+    return;
+  }
+
+  IceModelVec2V::Ptr v;
+  if (m_velocity_history.size() >= N) {
+    // re-use the storage of the oldest solution
+    v = m_velocity_history.front();
+    m_velocity_history.pop_front();
+    m_velocity_history_times.pop_front();
+  } else {
+    v.reset(new IceModelVec2V(m_grid, "velocity_history", WITHOUT_GHOSTS));
+  }
+
+  v->copy_from(m_velocity);
+  m_velocity_history.push_back(v);
+  m_velocity_history_times.push_back(time);
+}
+
+/*!
+ * Extrapolate saved velocity solutions (see record_velocity()) to the model time `time`
+ * using the Lagrange interpolating polynomial and put the result in `result`.
+ *
+ * Returns `false` (and leaves `result` unchanged) if fewer than two solutions are
+ * available or if `time` is not after the time of the most recent one.
+ */
+bool ShallowStressBalance::extrapolate_velocity(double time, IceModelVec2V &result) const {
+  const unsigned int N = m_velocity_history.size();
+
+  if (N < 2 or not (time > m_velocity_history_times.back())) {
+    return false;
+  }
+
+  const std::deque<double> &t = m_velocity_history_times;
+
+  std::vector<double> w(N, 1.0);
+  for (unsigned int k = 0; k < N; ++k) {
+    for (unsigned int m = 0; m < N; ++m) {
+      if (m != k) {
+        w[k] *= (time - t[m]) / (t[k] - t[m]);
+      }
+    }
+  }
+
+  IceModelVec::AccessList list{&result};
+  for (auto v : m_velocity_history) {
+    list.add(*v);
+  }
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    Vector2 u(0.0, 0.0);
+    for (unsigned int k = 0; k < N; ++k) {
+      u += w[k] * (*m_velocity_history[k])(i, j);
+    }
+    result(i, j) = u;
+  }
+
+  result.update_ghosts();
+
+  return true;
+}
+
 //! \brief Get the thickness-advective 2D velocity.
 const IceModelVec2V& ShallowStressBalance::velocity() const {
   return m_velocity;
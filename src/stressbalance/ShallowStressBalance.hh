@@ -1,4 +1,4 @@
-// Copyright (C) 2010--2019 Constantine Khroulev and Ed Bueler
+// Copyright (C) 2010--2020 Constantine Khroulev and Ed Bueler
 //
 // This file is part of PISM.
 //
@@ -19,9 +19,12 @@
 #ifndef _SHALLOWSTRESSBALANCE_H_
 #define _SHALLOWSTRESSBALANCE_H_
 
+#include <deque>
+
 #include "pism/util/Component.hh"
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/EnthalpyConverter.hh"
+#include "pism/util/SolverStats.hh"
 
 namespace pism {
 namespace rheology {
@@ -75,17 +78,32 @@ public:
   EnthalpyConverter::Ptr enthalpy_converter() const;
 
   const IceBasalResistancePlasticLaw* sliding_law() const;
+
+  unsigned int nonlinear_iterations() const;
+  unsigned int linear_iterations() const;
+  const SolverStats& solver_stats() const;
 protected:
   virtual void init_impl();
   
   virtual DiagnosticList diagnostics_impl() const;
 
+  void record_velocity(double time);
+  bool extrapolate_velocity(double time, IceModelVec2V &result) const;
+
   IceBasalResistancePlasticLaw *m_basal_sliding_law;
   std::shared_ptr<rheology::FlowLaw> m_flow_law;
   EnthalpyConverter::Ptr m_EC;
 
   IceModelVec2V m_velocity;
   IceModelVec2S m_basal_frictional_heating;
+
+  // Recent velocity solutions (most recent last) and corresponding model times. Used to
+  // extrapolate the initial guess (see stress_balance.ssa.initial_guess_extrapolation).
+  std::deque<IceModelVec2V::Ptr> m_velocity_history;
+  std::deque<double> m_velocity_history_times;
+
+  //! iterations, residuals and the wall-clock time of the last update()
+  SolverStats m_solver_stats;
 };
 
 //! Returns zero velocity field, zero friction heating, and zero for D^2.
@@ -1,4 +1,4 @@
-// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 Constantine Khroulev and Ed Bueler
+// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 Constantine Khroulev and Ed Bueler
 //
 // This file is part of PISM.
 //
@@ -16,6 +16,8 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>            // std::upper_bound
+
 #include "StressBalance.hh"
 #include "ShallowStressBalance.hh"
 #include "SSB_Modifier.hh"
@@ -139,10 +141,40 @@ StressBalance::StressBalance(IceGrid::ConstPtr g,
                              ShallowStressBalance *sb,
                              SSB_Modifier *ssb_mod)
   : Component(g),
-    m_w(m_grid, "wvel_rel", WITHOUT_GHOSTS),
-    m_strain_heating(m_grid, "strain_heating", WITHOUT_GHOSTS),
+    m_strain_heating_is_stale(false),
     m_shallow_stress_balance(sb),
-    m_modifier(ssb_mod) {
+    m_modifier(ssb_mod),
+    m_diagnostic_cache_thickness_counter(-1),
+    m_ice_thickness(m_grid->variables(), "land_ice_thickness"),
+    m_velocity_revision(0),
+    m_principal_strain_rates(m_grid, "principal_strain_rates", WITHOUT_GHOSTS, 2, 2),
+    m_principal_strain_rates_memo(m_grid->ctx()->memo(), "stress_balance.principal_strain_rates"),
+    m_deviatoric_stresses(m_grid, "deviatoric_stresses", WITHOUT_GHOSTS, 0, 3),
+    m_deviatoric_stresses_memo(m_grid->ctx()->memo(), "stress_balance.deviatoric_stresses") {
+
+  m_principal_strain_rates.metadata(0).set_name("eigen1");
+  m_principal_strain_rates.set_attrs("internal",
+                                     "major principal component of horizontal strain-rate",
+                                     "second-1", "second-1", "", 0);
+  m_principal_strain_rates.metadata(1).set_name("eigen2");
+  m_principal_strain_rates.set_attrs("internal",
+                                     "minor principal component of horizontal strain-rate",
+                                     "second-1", "second-1", "", 1);
+
+  m_deviatoric_stresses.metadata(0).set_name("sigma_xx");
+  m_deviatoric_stresses.set_attrs("internal", "deviatoric stress in x direction",
+                                  "Pa", "Pa", "", 0);
+  m_deviatoric_stresses.metadata(1).set_name("sigma_yy");
+  m_deviatoric_stresses.set_attrs("internal", "deviatoric stress in y direction",
+                                  "Pa", "Pa", "", 1);
+  m_deviatoric_stresses.metadata(2).set_name("sigma_xy");
+  m_deviatoric_stresses.set_attrs("internal", "deviatoric shear stress",
+                                  "Pa", "Pa", "", 2);
+
+  const std::vector<double> levels = velocity_levels(*m_grid);
+
+  m_w.create(m_grid, "wvel_rel", WITHOUT_GHOSTS, levels);
+  m_strain_heating.create(m_grid, "strain_heating", WITHOUT_GHOSTS, levels);
 
   m_w.set_attrs("diagnostic",
                 "vertical velocity of ice, relative to base of ice directly below",
@@ -166,38 +198,26 @@ void StressBalance::init() {
 }
 
 //! \brief Performs the shallow stress balance computation.
-void StressBalance::update(const Inputs &inputs, bool full_update) {
+void StressBalance::update(const Inputs &inputs, bool full_update, bool update_3d_velocity) {
 
   const Profiling &profiling = m_grid->ctx()->profiling();
 
+  // ice velocities are about to change
+  m_diagnostic_cache.clear();
+  m_velocity_revision += 1;
+
   try {
     profiling.begin("stress_balance.shallow");
     m_shallow_stress_balance->update(inputs, full_update);
     profiling.end("stress_balance.shallow");
 
-    profiling.begin("stress_balance.modifier");
-    m_modifier->update(m_shallow_stress_balance->velocity(),
-                       inputs, full_update);
-    profiling.end("stress_balance.modifier");
-
-    if (full_update) {
-      const IceModelVec3 &u = m_modifier->velocity_u();
-      const IceModelVec3 &v = m_modifier->velocity_v();
-
-      profiling.begin("stress_balance.strain_heat");
-      this->compute_volumetric_strain_heating(inputs);
-      profiling.end("stress_balance.strain_heat");
-
-      profiling.begin("stress_balance.vertical_velocity");
-      this->compute_vertical_velocity(inputs.geometry->cell_type,
-                                      u, v, inputs.basal_melt_rate, m_w);
-      profiling.end("stress_balance.vertical_velocity");
-
-      m_cfl_3d = ::pism::max_timestep_cfl_3d(inputs.geometry->ice_thickness,
-                                             inputs.geometry->cell_type,
-                                             m_modifier->velocity_u(),
-                                             m_modifier->velocity_v(),
-                                             m_w);
+    if (full_update and update_3d_velocity) {
+      // strain heating is used by the energy balance model only
+      update_3d_fields(inputs, m_config->get_flag("energy.enabled"));
+    } else {
+      profiling.begin("stress_balance.modifier");
+      m_modifier->update(m_shallow_stress_balance->velocity(), inputs, false);
+      profiling.end("stress_balance.modifier");
     }
 
     m_cfl_2d = ::pism::max_timestep_cfl_2d(inputs.geometry->ice_thickness,
@@ -210,6 +230,83 @@ void StressBalance::update(const Inputs &inputs, bool full_update) {
   }
 }
 
+/*!
+ * Re-construct 3D velocities from the velocity of the shallow stress balance model and
+ * update fields that depend on them.
+ *
+ * This is used to update 3D fields "lazily", e.g. right before writing them to an output
+ * file (see stress_balance.on_demand_3d_velocity). The shallow stress balance is not
+ * re-solved, so calling this does not change the model state. In the SSA-only case this
+ * is cheap: the SSA velocity is copied to all levels of each column.
+ */
+void StressBalance::update_3d(const Inputs &inputs) {
+  // 3D ice velocities and quantities derived from them are about to change (the
+  // sliding velocity is not, so m_velocity_revision stays the same)
+  m_diagnostic_cache.clear();
+
+  try {
+    update_3d_fields(inputs, true);
+  } catch (RuntimeError &e) {
+    e.add_context("updating 3D ice velocity");
+    throw;
+  }
+}
+
+/*!
+ * Update strain heating using current 3D velocities if it was not updated during the
+ * last full update (i.e. if the energy balance model is disabled).
+ *
+ * This is used to update strain heating right before writing it to an output file.
+ */
+void StressBalance::update_strain_heating(const Inputs &inputs) {
+  if (not m_strain_heating_is_stale) {
+    return;
+  }
+
+  m_diagnostic_cache.clear();
+
+  try {
+    this->compute_volumetric_strain_heating(inputs);
+    m_strain_heating_is_stale = false;
+  } catch (RuntimeError &e) {
+    e.add_context("updating strain heating");
+    throw;
+  }
+}
+
+bool StressBalance::sliding_only() const {
+  return m_modifier->depth_independent();
+}
+
+//! Update the modifier (including its 3D part), strain heating (if
+//! `update_strain_heating` is set), vertical velocity and the 3D CFL data.
+void StressBalance::update_3d_fields(const Inputs &inputs, bool update_strain_heating) {
+  const Profiling &profiling = m_grid->ctx()->profiling();
+
+  profiling.begin("stress_balance.modifier");
+  m_modifier->update(m_shallow_stress_balance->velocity(), inputs, true);
+  profiling.end("stress_balance.modifier");
+
+  const IceModelVec3 &u = m_modifier->velocity_u();
+  const IceModelVec3 &v = m_modifier->velocity_v();
+
+  if (update_strain_heating) {
+    profiling.begin("stress_balance.strain_heat");
+    this->compute_volumetric_strain_heating(inputs);
+    profiling.end("stress_balance.strain_heat");
+  }
+  m_strain_heating_is_stale = not update_strain_heating;
+
+  profiling.begin("stress_balance.vertical_velocity");
+  this->compute_vertical_velocity(inputs.geometry->cell_type,
+                                  u, v, inputs.basal_melt_rate, m_w);
+  profiling.end("stress_balance.vertical_velocity");
+
+  m_cfl_3d = ::pism::max_timestep_cfl_3d(inputs.geometry->ice_thickness,
+                                         inputs.geometry->cell_type,
+                                         u, v, m_w);
+}
+
 CFLData StressBalance::max_timestep_cfl_2d() const {
   return m_cfl_2d;
 }
@@ -294,8 +391,9 @@ void StressBalance::compute_vertical_velocity(const IceModelVec2CellType &mask,
     list.add(*basal_melt_rate);
   }
 
-  const std::vector<double> &z = m_grid->z();
-  const unsigned int Mz = m_grid->Mz();
+  // the result uses levels of the 3D velocity (see velocity_levels())
+  const std::vector<double> z = u.levels();
+  const unsigned int Mz = z.size();
 
   const double
     dx = m_grid->dx(),
@@ -508,7 +606,6 @@ void StressBalance::compute_volumetric_strain_heating(const Inputs &inputs) {
   PetscErrorCode ierr;
 
   const rheology::FlowLaw &flow_law = *m_shallow_stress_balance->flow_law();
-  EnthalpyConverter::Ptr EC = m_shallow_stress_balance->enthalpy_converter();
 
   const IceModelVec3
     &u = m_modifier->velocity_u(),
@@ -527,9 +624,12 @@ void StressBalance::compute_volumetric_strain_heating(const Inputs &inputs) {
 
   IceModelVec::AccessList list{&mask, enthalpy, &m_strain_heating, &thickness, &u, &v};
 
-  const std::vector<double> &z = m_grid->z();
-  const unsigned int Mz = m_grid->Mz();
-  std::vector<double> depth(Mz), pressure(Mz), hardness(Mz);
+  // strain heating uses levels of the 3D velocity, a subset (indices K) of grid levels
+  const std::vector<double> z = u.levels();
+  const std::vector<unsigned int> K = velocity_level_indices(*m_grid);
+  const unsigned int Mz = z.size();
+  const bool all_levels = (Mz == m_grid->Mz());
+  std::vector<double> pressure(Mz), hardness(Mz), D2_column(Mz), E_coarse(Mz);
 
   ParallelSection loop(m_grid->com);
   try {
@@ -538,6 +638,10 @@ void StressBalance::compute_volumetric_strain_heating(const Inputs &inputs) {
 
       double H = thickness(i, j);
       int ks = m_grid->kBelowHeight(H);
+      if (not all_levels) {
+        // the highest level of the 3D velocity that is at or below the grid level ks
+        ks = (std::upper_bound(K.begin(), K.end(), (unsigned int)ks) - K.begin()) - 1;
+      }
       const double
         *u_ij, *u_w, *u_n, *u_e, *u_s,
         *v_ij, *v_w, *v_n, *v_e, *v_s;
@@ -593,40 +697,42 @@ void StressBalance::compute_volumetric_strain_heating(const Inputs &inputs) {
       v_n  = v.get_column(i,     j + 1);
 
       E_ij = enthalpy->get_column(i, j);
-      Sigma = m_strain_heating.get_column(i, j);
-
-      for (int k = 0; k <= ks; ++k) {
-        depth[k] = H - z[k];
+      if (not all_levels) {
+        for (int k = 0; k <= ks; ++k) {
+          E_coarse[k] = E_ij[K[k]];
+        }
+        E_ij = E_coarse.data();
       }
+      Sigma = m_strain_heating.get_column(i, j);
 
       // pressure added by the ice (i.e. pressure difference between the
       // current level and the top of the column)
-      EC->pressure(depth, ks, pressure); // FIXME issue #15
-
-      flow_law.hardness_n(E_ij, &pressure[0], ks + 1, &hardness[0]);
+      rheology::hardness_column(flow_law, H, z.data(), ks + 1, E_ij,
+                                pressure.data(), hardness.data()); // FIXME issue #15
 
-      for (int k = 0; k <= ks; ++k) {
-        double dz;
-
-        double u_z = 0.0, v_z = 0.0,
+      // D^2 at level k; the bottom level uses one-sided differences for u_z and v_z
+      auto D2_k = [&](int k, int k_below, int k_above) {
+        const double
+          dz  = z[k_above] - z[k_below],
+          u_z = (u_ij[k_above] - u_ij[k_below]) / dz,
+          v_z = (v_ij[k_above] - v_ij[k_below]) / dz,
           u_x = D_x * (west  * (u_ij[k] - u_w[k]) + east  * (u_e[k] - u_ij[k])),
           u_y = D_y * (south * (u_ij[k] - u_s[k]) + north * (u_n[k] - u_ij[k])),
           v_x = D_x * (west  * (v_ij[k] - v_w[k]) + east  * (v_e[k] - v_ij[k])),
           v_y = D_y * (south * (v_ij[k] - v_s[k]) + north * (v_n[k] - v_ij[k]));
 
-        if (k > 0) {
-          dz = z[k+1] - z[k-1];
-          u_z = (u_ij[k+1] - u_ij[k-1]) / dz;
-          v_z = (v_ij[k+1] - v_ij[k-1]) / dz;
-        } else {
-          // use one-sided differences for u_z and v_z on the bottom level
-          dz = z[1] - z[0];
-          u_z = (u_ij[1] - u_ij[0]) / dz;
-          v_z = (v_ij[1] - v_ij[0]) / dz;
-        }
+        return D2(u_x, u_y, u_z, v_x, v_y, v_z);
+      };
 
-        Sigma[k] = 2.0 * e_to_a_power * hardness[k] * pow(D2(u_x, u_y, u_z, v_x, v_y, v_z), exponent);
-      } // k-loop
+      // This loop has no branches, so compilers can vectorize it.
+      D2_column[0] = D2_k(0, 0, 1);
+      for (int k = 1; k <= ks; ++k) {
+        D2_column[k] = D2_k(k, k - 1, k + 1);
+      }
+
+      for (int k = 0; k <= ks; ++k) {
+        Sigma[k] = 2.0 * e_to_a_power * hardness[k] * pow(D2_column[k], exponent);
+      }
 
       int remaining_levels = Mz - (ks + 1);
       if (remaining_levels > 0) {
@@ -653,6 +759,82 @@ const SSB_Modifier* StressBalance::modifier() const {
   return m_modifier;
 }
 
+/*!
+ * Return the field `name` computed by `compute()`, re-using the result computed earlier
+ * if possible.
+ *
+ * This is used by diagnostics sharing intermediate fields (such as the vertically-averaged
+ * velocity), so that each of these is computed at most once per output event. Cached
+ * fields are discarded when velocities are updated (see update()) and when the ice
+ * thickness changes. Callers must not modify fields returned by this method.
+ */
+IceModelVec::Ptr StressBalance::cached_diagnostic(const std::string &name,
+                                                  std::function<IceModelVec::Ptr()> compute) const {
+  int thickness_counter = m_ice_thickness->state_counter();
+
+  if (thickness_counter != m_diagnostic_cache_thickness_counter) {
+    m_diagnostic_cache.clear();
+    m_diagnostic_cache_thickness_counter = thickness_counter;
+  }
+
+  auto it = m_diagnostic_cache.find(name);
+  if (it != m_diagnostic_cache.end()) {
+    return it->second;
+  }
+
+  auto result = compute();
+  m_diagnostic_cache[name] = result;
+
+  return result;
+}
+
+/*!
+ * Principal strain rates computed using the sliding (SSA) velocity (see
+ * compute_2D_principal_strain_rates()).
+ *
+ * The result is computed at most once per stress balance update: it is re-computed only
+ * if velocities were updated or the state counter of `cell_type` changed since the last
+ * call. This allows sharing it among components using strain rates (such as the fracture
+ * density model).
+ */
+const IceModelVec2& StressBalance::principal_strain_rates(const IceModelVec2CellType &cell_type) const {
+  std::vector<int> key{m_velocity_revision, cell_type.state_counter()};
+
+  if (not m_principal_strain_rates_memo.up_to_date(key)) {
+    compute_2D_principal_strain_rates(m_shallow_stress_balance->velocity(), cell_type,
+                                      m_principal_strain_rates);
+    m_principal_strain_rates_memo.set(key);
+  }
+
+  return m_principal_strain_rates;
+}
+
+/*!
+ * Deviatoric stresses computed using the sliding (SSA) velocity and the
+ * vertically-averaged ice hardness (see compute_2D_stresses()).
+ *
+ * Re-computed only if velocities were updated or one of the inputs changed (according to
+ * their state counters) since the last call. See principal_strain_rates().
+ */
+const IceModelVec2& StressBalance::deviatoric_stresses(const IceModelVec2CellType &cell_type,
+                                                       const IceModelVec2S &ice_thickness,
+                                                       const IceModelVec3 &ice_enthalpy) const {
+  std::vector<int> key{m_velocity_revision, cell_type.state_counter(),
+                       ice_thickness.state_counter(), ice_enthalpy.state_counter()};
+
+  if (not m_deviatoric_stresses_memo.up_to_date(key)) {
+    const rheology::FlowLaw &flow_law = *m_shallow_stress_balance->flow_law();
+
+    IceModelVec2S hardness(m_grid, "hardness", WITHOUT_GHOSTS);
+    averaged_hardness_vec(flow_law, ice_thickness, ice_enthalpy, hardness);
+
+    compute_2D_stresses(flow_law, m_shallow_stress_balance->velocity(), hardness, cell_type,
+                        m_deviatoric_stresses);
+    m_deviatoric_stresses_memo.set(key);
+  }
+
+  return m_deviatoric_stresses;
+}
 
 void StressBalance::define_model_state_impl(const File &output) const {
   m_shallow_stress_balance->define_model_state(output);
@@ -664,6 +846,79 @@ void StressBalance::write_model_state_impl(const File &output) const {
   m_modifier->write_model_state(output);
 }
 
+/*!
+ * Compute eigenvalues of the horizontal, vertically-integrated strain rate tensor at the
+ * grid point (i, j). See compute_2D_principal_strain_rates().
+ */
+static void principal_strain_rates(const IceModelVec2V &V,
+                                   const IceModelVec2CellType &mask,
+                                   double dx, double dy,
+                                   int i, int j,
+                                   double &eigen1, double &eigen2) {
+  using mask::ice_free;
+
+  if (mask.ice_free(i,j)) {
+    eigen1 = 0.0;
+    eigen2 = 0.0;
+    return;
+  }
+
+  StarStencil<int> m = mask.int_star(i,j);
+  StarStencil<Vector2> U = V.star(i,j);
+
+  // strain in units s-1
+  double u_x = 0, u_y = 0, v_x = 0, v_y = 0,
+    east = 1, west = 1, south = 1, north = 1;
+
+  // Computes u_x using second-order centered finite differences written as
+  // weighted sums of first-order one-sided finite differences.
+  //
+  // Given the cell layout
+  // *----n----*
+  // |         |
+  // |         |
+  // w         e
+  // |         |
+  // |         |
+  // *----s----*
+  // east == 0 if the east neighbor of the current cell is ice-free. In
+  // this case we use the left- (west-) sided difference.
+  //
+  // If both neighbors in the east-west (x) direction are ice-free the
+  // x-derivative is set to zero (see u_x, v_x initialization above).
+  //
+  // Similarly in other directions.
+  if (ice_free(m.e)) {
+    east = 0;
+  }
+  if (ice_free(m.w)) {
+    west = 0;
+  }
+  if (ice_free(m.n)) {
+    north = 0;
+  }
+  if (ice_free(m.s)) {
+    south = 0;
+  }
+
+  if (west + east > 0) {
+    u_x = 1.0 / (dx * (west + east)) * (west * (U.ij.u - U[West].u) + east * (U[East].u - U.ij.u));
+    v_x = 1.0 / (dx * (west + east)) * (west * (U.ij.v - U[West].v) + east * (U[East].v - U.ij.v));
+  }
+
+  if (south + north > 0) {
+    u_y = 1.0 / (dy * (south + north)) * (south * (U.ij.u - U[South].u) + north * (U[North].u - U.ij.u));
+    v_y = 1.0 / (dy * (south + north)) * (south * (U.ij.v - U[South].v) + north * (U[North].v - U.ij.v));
+  }
+
+  const double A = 0.5 * (u_x + v_y),  // A = (1/2) trace(D)
+    B   = 0.5 * (u_x - v_y),
+    Dxy = 0.5 * (v_x + u_y),  // B^2 = A^2 - u_x v_y
+    q   = sqrt(B*B + Dxy*Dxy);
+  eigen1 = A + q;
+  eigen2 = A - q; // q >= 0 so e1 >= e2
+}
+
 //! \brief Compute eigenvalues of the horizontal, vertically-integrated strain rate tensor.
 /*!
 Calculates all components \f$D_{xx}, D_{yy}, D_{xy}=D_{yx}\f$ of the
@@ -685,8 +940,6 @@ void compute_2D_principal_strain_rates(const IceModelVec2V &V,
                                        const IceModelVec2CellType &mask,
                                        IceModelVec2 &result) {
 
-  using mask::ice_free;
-
   IceGrid::ConstPtr grid = result.grid();
   double    dx = grid->dx(), dy = grid->dy();
 
@@ -699,67 +952,35 @@ void compute_2D_principal_strain_rates(const IceModelVec2V &V,
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    if (mask.ice_free(i,j)) {
-      result(i,j,0) = 0.0;
-      result(i,j,1) = 0.0;
-      continue;
-    }
-
-    StarStencil<int> m = mask.int_star(i,j);
-    StarStencil<Vector2> U = V.star(i,j);
+    principal_strain_rates(V, mask, dx, dy, i, j, result(i,j,0), result(i,j,1));
+  }
+}
 
-    // strain in units s-1
-    double u_x = 0, u_y = 0, v_x = 0, v_y = 0,
-      east = 1, west = 1, south = 1, north = 1;
+/*!
+ * Compute eigenvalues of the horizontal, vertically-integrated strain rate tensor at
+ * `points` (owned by the current process) only. Does not modify `result` elsewhere.
+ *
+ * This is useful when strain rates are needed in a narrow band (for example near calving
+ * fronts).
+ */
+void compute_2D_principal_strain_rates(const IceModelVec2V &V,
+                                       const IceModelVec2CellType &mask,
+                                       const std::vector<std::pair<int, int> > &points,
+                                       IceModelVec2 &result) {
 
-    // Computes u_x using second-order centered finite differences written as
-    // weighted sums of first-order one-sided finite differences.
-    //
-    // Given the cell layout
-    // *----n----*
-    // |         |
-    // |         |
-    // w         e
-    // |         |
-    // |         |
-    // *----s----*
-    // east == 0 if the east neighbor of the current cell is ice-free. In
-    // this case we use the left- (west-) sided difference.
-    //
-    // If both neighbors in the east-west (x) direction are ice-free the
-    // x-derivative is set to zero (see u_x, v_x initialization above).
-    //
-    // Similarly in other directions.
-    if (ice_free(m.e)) {
-      east = 0;
-    }
-    if (ice_free(m.w)) {
-      west = 0;
-    }
-    if (ice_free(m.n)) {
-      north = 0;
-    }
-    if (ice_free(m.s)) {
-      south = 0;
-    }
+  IceGrid::ConstPtr grid = result.grid();
+  double    dx = grid->dx(), dy = grid->dy();
 
-    if (west + east > 0) {
-      u_x = 1.0 / (dx * (west + east)) * (west * (U.ij.u - U[West].u) + east * (U[East].u - U.ij.u));
-      v_x = 1.0 / (dx * (west + east)) * (west * (U.ij.v - U[West].v) + east * (U[East].v - U.ij.v));
-    }
+  if (result.ndof() != 2) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "result.dof() == 2 is required");
+  }
 
-    if (south + north > 0) {
-      u_y = 1.0 / (dy * (south + north)) * (south * (U.ij.u - U[South].u) + north * (U[North].u - U.ij.u));
-      v_y = 1.0 / (dy * (south + north)) * (south * (U.ij.v - U[South].v) + north * (U[North].v - U.ij.v));
-    }
+  IceModelVec::AccessList list{&V, &mask, &result};
 
-    const double A = 0.5 * (u_x + v_y),  // A = (1/2) trace(D)
-      B   = 0.5 * (u_x - v_y),
-      Dxy = 0.5 * (v_x + u_y),  // B^2 = A^2 - u_x v_y
-      q   = sqrt(B*B + Dxy*Dxy);
-    result(i,j,0) = A + q;
-    result(i,j,1) = A - q; // q >= 0 so e1 >= e2
+  for (const auto &p : points) {
+    const int i = p.first, j = p.second;
 
+    principal_strain_rates(V, mask, dx, dy, i, j, result(i,j,0), result(i,j,1));
   }
 }
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 Constantine Khroulev and Ed Bueler
+// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 Constantine Khroulev and Ed Bueler
 //
 // This file is part of PISM.
 //
@@ -19,8 +19,13 @@
 #ifndef _PISMSTRESSBALANCE_H_
 #define _PISMSTRESSBALANCE_H_
 
+#include <functional>
+#include <map>
+
 #include "pism/util/Component.hh"     // derives from Component
 #include "pism/util/iceModelVec.hh"
+#include "pism/util/Vars.hh"
+#include "pism/util/Memo.hh"
 #include "pism/stressbalance/timestepping.hh"
 
 namespace pism {
@@ -86,7 +91,21 @@ public:
 
   //! \brief Update all the fields if (full_update), only update diffusive flux
   //! and max. diffusivity otherwise.
-  void update(const Inputs &inputs, bool full_update);
+  //!
+  //! If `update_3d_velocity` is false, a "full" update solves the shallow stress balance
+  //! but does not update 3D velocities and strain heating. Strain heating is not updated
+  //! if the energy balance model is disabled (see update_strain_heating()).
+  void update(const Inputs &inputs, bool full_update, bool update_3d_velocity = true);
+
+  //! \brief Update 3D velocities, strain heating and the vertical velocity using the
+  //! current velocity of the shallow stress balance model (without re-solving it).
+  void update_3d(const Inputs &inputs);
+
+  //! \brief Update strain heating if it was skipped during the last update.
+  void update_strain_heating(const Inputs &inputs);
+
+  //! \brief True if the 3D velocity is the sliding velocity copied to all levels.
+  bool sliding_only() const;
 
   //! \brief Get the thickness-advective (SSA) 2D velocity.
   const IceModelVec2V& advective_velocity() const;
@@ -120,6 +139,15 @@ public:
 
   //! \brief Returns a pointer to a stress balance modifier implementation.
   const SSB_Modifier* modifier() const;
+
+  IceModelVec::Ptr cached_diagnostic(const std::string &name,
+                                     std::function<IceModelVec::Ptr()> compute) const;
+
+  const IceModelVec2& principal_strain_rates(const IceModelVec2CellType &cell_type) const;
+
+  const IceModelVec2& deviatoric_stresses(const IceModelVec2CellType &cell_type,
+                                          const IceModelVec2S &ice_thickness,
+                                          const IceModelVec3 &ice_enthalpy) const;
 protected:
   virtual DiagnosticList diagnostics_impl() const;
   virtual TSDiagnosticList ts_diagnostics_impl() const;
@@ -134,12 +162,39 @@ protected:
                                          IceModelVec3 &result);
   virtual void compute_volumetric_strain_heating(const Inputs &inputs);
 
+  void update_3d_fields(const Inputs &inputs, bool update_strain_heating);
+
   CFLData m_cfl_2d, m_cfl_3d;
 
   IceModelVec3 m_w, m_strain_heating;
+  bool m_strain_heating_is_stale;
 
   ShallowStressBalance *m_shallow_stress_balance;
   SSB_Modifier *m_modifier;
+
+  //! fields shared by several diagnostics (see cached_diagnostic())
+  mutable std::map<std::string, IceModelVec::Ptr> m_diagnostic_cache;
+  //! state counter of the ice thickness used to compute cached fields
+  mutable int m_diagnostic_cache_thickness_counter;
+  //! ice thickness (used to invalidate cached fields)
+  VarRef<IceModelVec2S> m_ice_thickness;
+
+  //! incremented every time velocities are updated
+  int m_velocity_revision;
+
+  //! principal strain rates computed using the sliding (SSA) velocity (see
+  //! principal_strain_rates())
+  mutable IceModelVec2 m_principal_strain_rates;
+  //! velocity revision and the cell type state counter used to compute
+  //! m_principal_strain_rates
+  mutable Memo m_principal_strain_rates_memo;
+
+  //! deviatoric stresses computed using the sliding (SSA) velocity (see
+  //! deviatoric_stresses())
+  mutable IceModelVec2 m_deviatoric_stresses;
+  //! velocity revision and state counters of inputs used to compute
+  //! m_deviatoric_stresses
+  mutable Memo m_deviatoric_stresses_memo;
 };
 
 std::shared_ptr<StressBalance> create(const std::string &model_name,
@@ -150,6 +205,11 @@ void compute_2D_principal_strain_rates(const IceModelVec2V &velocity,
                                        const IceModelVec2CellType &mask,
                                        IceModelVec2 &result);
 
+void compute_2D_principal_strain_rates(const IceModelVec2V &velocity,
+                                       const IceModelVec2CellType &mask,
+                                       const std::vector<std::pair<int, int> > &points,
+                                       IceModelVec2 &result);
+
 void compute_2D_stresses(const rheology::FlowLaw &flow_law,
                          const IceModelVec2V &velocity,
                          const IceModelVec2S &hardness,
@@ -1,4 +1,4 @@
-// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 Constantine Khroulev
+// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -25,12 +25,39 @@
 #include "pism/util/error_handling.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/LevelView.hh"
 #include "pism/rheology/FlowLaw.hh"
 #include "pism/rheology/FlowLawFactory.hh"
 
 namespace pism {
 namespace stressbalance {
 
+/*!
+ * Compute the diagnostic `D` or re-use the result computed earlier (see
+ * StressBalance::cached_diagnostic()). The result must not be modified.
+ */
+template<class D>
+static IceModelVec::Ptr shared(const StressBalance *model, const std::string &name) {
+  return model->cached_diagnostic(name, [model]() { return D(model).compute(); });
+}
+
+/*!
+ * Return `input` if it uses levels of the grid. Otherwise interpolate it to grid levels
+ * (see velocity_levels()), storing the result in `storage`, and return `storage`.
+ */
+static const IceModelVec3& on_grid_levels(const IceModelVec3 &input, IceModelVec3 &storage) {
+  IceGrid::ConstPtr grid = input.grid();
+
+  if (input.levels().size() == grid->Mz()) {
+    return input;
+  }
+
+  storage.create(grid, input.get_name(), WITHOUT_GHOSTS);
+  velocity_to_grid_levels(input, storage);
+
+  return storage;
+}
+
 DiagnosticList StressBalance::diagnostics_impl() const {
   DiagnosticList result = {
     {"bfrict",              Diagnostic::Ptr(new PSB_bfrict(this))},
@@ -96,13 +123,13 @@ IceModelVec::Ptr PSB_velbar::compute_impl() const {
   // get the thickness
   const IceModelVec2S* thickness = m_grid->variables().get_2d_scalar("land_ice_thickness");
 
-  // Compute the vertically-integrated horizontal ice flux:
-  IceModelVec2V::Ptr result = IceModelVec2V::ToVector(PSB_flux(model).compute());
-
-  // Override metadata set by the flux computation
+  IceModelVec2V::Ptr result(new IceModelVec2V(m_grid, "velbar", WITHOUT_GHOSTS));
   result->metadata(0) = m_vars[0];
   result->metadata(1) = m_vars[1];
 
+  // Copy the vertically-integrated horizontal ice flux:
+  result->copy_from(*IceModelVec2V::ToVector(shared<PSB_flux>(model, "flux")));
+
   IceModelVec::AccessList list{thickness, result.get()};
 
   for (Points p(*m_grid); p; p.next()) {
@@ -140,7 +167,7 @@ IceModelVec::Ptr PSB_velbar_mag::compute_impl() const {
   result->metadata(0) = m_vars[0];
 
   // compute vertically-averaged horizontal velocity:
-  IceModelVec2V::Ptr velbar = IceModelVec2V::ToVector(PSB_velbar(model).compute());
+  IceModelVec2V::Ptr velbar = IceModelVec2V::ToVector(shared<PSB_velbar>(model, "velbar"));
 
   // compute its magnitude:
   result->set_to_magnitude(*velbar);
@@ -179,9 +206,10 @@ IceModelVec::Ptr PSB_flux::compute_impl() const {
   // get the thickness
   const IceModelVec2S *thickness = m_grid->variables().get_2d_scalar("land_ice_thickness");
 
+  IceModelVec3 u_tmp, v_tmp;
   const IceModelVec3
-    &u3 = model->velocity_u(),
-    &v3 = model->velocity_v();
+    &u3 = on_grid_levels(model->velocity_u(), u_tmp),
+    &v3 = on_grid_levels(model->velocity_v(), v_tmp);
 
   IceModelVec::AccessList list{&u3, &v3, thickness, result.get()};
 
@@ -289,7 +317,7 @@ IceModelVec::Ptr PSB_velbase_mag::compute_impl() const {
   IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "velbase_mag", WITHOUT_GHOSTS));
   result->metadata(0) = m_vars[0];
 
-  result->set_to_magnitude(*IceModelVec2V::ToVector(PSB_velbase(model).compute()));
+  result->set_to_magnitude(*IceModelVec2V::ToVector(shared<PSB_velbase>(model, "velbase")));
 
   double fill_value = to_internal(m_fill_value);
 
@@ -326,7 +354,7 @@ IceModelVec::Ptr PSB_velsurf_mag::compute_impl() const {
   IceModelVec2S::Ptr result(new IceModelVec2S(m_grid, "velsurf_mag", WITHOUT_GHOSTS));
   result->metadata(0) = m_vars[0];
 
-  result->set_to_magnitude(*IceModelVec2V::ToVector(PSB_velsurf(model).compute()));
+  result->set_to_magnitude(*IceModelVec2V::ToVector(shared<PSB_velsurf>(model, "velsurf")));
 
   const IceModelVec2CellType &mask = *m_grid->variables().get_2d_cell_type("mask");
 
@@ -382,13 +410,25 @@ IceModelVec::Ptr PSB_velsurf::compute_impl() const {
     &u3 = model->velocity_u(),
     &v3 = model->velocity_v();
 
-  const IceModelVec2S *thickness = m_grid->variables().get_2d_scalar("land_ice_thickness");
+  if (u3.levels().size() == m_grid->Mz()) {
+    // shared by u3, v3, and other fields interpolated at the ice surface
+    const LevelInterpolation &surface = m_grid->surface_interpolation();
 
-  u3.getSurfaceValues(tmp, *thickness);
-  result->set_component(0, tmp);
+    u3.getSurfaceValues(tmp, surface);
+    result->set_component(0, tmp);
 
-  v3.getSurfaceValues(tmp, *thickness);
-  result->set_component(1, tmp);
+    v3.getSurfaceValues(tmp, surface);
+    result->set_component(1, tmp);
+  } else {
+    // u3 and v3 use a subset of grid levels (see velocity_levels())
+    const IceModelVec2S &H = *m_grid->variables().get_2d_scalar("land_ice_thickness");
+
+    u3.getSurfaceValues(tmp, H);
+    result->set_component(0, tmp);
+
+    v3.getSurfaceValues(tmp, H);
+    result->set_component(1, tmp);
+  }
 
   const IceModelVec2CellType &mask = *m_grid->variables().get_2d_cell_type("mask");
 
@@ -431,10 +471,11 @@ IceModelVec::Ptr PSB_wvel::compute(bool zero_above_ice) const {
   const IceModelVec2S        &thickness = *m_grid->variables().get_2d_scalar("land_ice_thickness");
   const IceModelVec2CellType &mask      = *m_grid->variables().get_2d_cell_type("mask");
 
+  IceModelVec3 u_tmp, v_tmp, w_tmp;
   const IceModelVec3
-    &u3 = model->velocity_u(),
-    &v3 = model->velocity_v(),
-    &w3 = model->velocity_w();
+    &u3 = on_grid_levels(model->velocity_u(), u_tmp),
+    &v3 = on_grid_levels(model->velocity_v(), v_tmp),
+    &w3 = on_grid_levels(model->velocity_w(), w_tmp);
 
   IceModelVec::AccessList list{&thickness, &mask, bed, &u3, &v3, &w3, uplift, result3.get()};
 
@@ -527,11 +568,11 @@ IceModelVec::Ptr PSB_wvelsurf::compute_impl() const {
   result->metadata() = m_vars[0];
 
   // here "false" means "don't fill w3 above the ice surface with zeros"
-  IceModelVec3::Ptr w3 = IceModelVec3::To3DScalar(PSB_wvel(model).compute(false));
-
-  const IceModelVec2S *thickness = m_grid->variables().get_2d_scalar("land_ice_thickness");
+  auto wvel = model->cached_diagnostic("wvel_unmasked",
+                                       [this]() { return PSB_wvel(model).compute(false); });
+  IceModelVec3::Ptr w3 = IceModelVec3::To3DScalar(wvel);
 
-  w3->getSurfaceValues(*result, *thickness);
+  w3->getSurfaceValues(*result, m_grid->surface_interpolation());
 
   const IceModelVec2CellType &mask = *m_grid->variables().get_2d_cell_type("mask");
 
@@ -573,7 +614,9 @@ IceModelVec::Ptr PSB_wvelbase::compute_impl() const {
   result->metadata() = m_vars[0];
 
   // here "false" means "don't fill w3 above the ice surface with zeros"
-  IceModelVec3::Ptr w3 = IceModelVec3::To3DScalar(PSB_wvel(model).compute(false));
+  auto wvel = model->cached_diagnostic("wvel_unmasked",
+                                       [this]() { return PSB_wvel(model).compute(false); });
+  IceModelVec3::Ptr w3 = IceModelVec3::To3DScalar(wvel);
 
   w3->getHorSlice(*result, 0.0);
 
@@ -674,6 +717,10 @@ IceModelVec::Ptr PSB_bfrict::compute_impl() const {
   return result;
 }
 
+const IceModelVec* PSB_bfrict::borrow_impl() const {
+  return &model->basal_frictional_heating();
+}
+
 
 PSB_uvel::PSB_uvel(const StressBalance *m)
   : Diag<StressBalance>(m) {
@@ -686,11 +733,15 @@ PSB_uvel::PSB_uvel(const StressBalance *m)
 }
 
 /*!
- * Copy F to result and set it to zero above the surface of the ice.
+ * Copy `input` to `result` (interpolating to grid levels if necessary) and set it to zero
+ * above the surface of the ice.
  */
-static void zero_above_ice(const IceModelVec3 &F, const IceModelVec2S &H,
+static void zero_above_ice(const IceModelVec3 &input, const IceModelVec2S &H,
                            IceModelVec3 &result) {
 
+  IceModelVec3 tmp;
+  const IceModelVec3 &F = on_grid_levels(input, tmp);
+
   IceModelVec::AccessList list{&F, &H, &result};
 
   IceGrid::ConstPtr grid = result.grid();
@@ -793,7 +844,7 @@ IceModelVec::Ptr PSB_strainheat::compute_impl() const {
   IceModelVec3::Ptr result(new IceModelVec3(m_grid, "strainheat", WITHOUT_GHOSTS));
   result->metadata() = m_vars[0];
 
-  result->copy_from(model->volumetric_strain_heating());
+  velocity_to_grid_levels(model->volumetric_strain_heating(), *result);
 
   return result;
 }
@@ -811,7 +862,7 @@ PSB_strain_rates::PSB_strain_rates(const StressBalance *m)
 }
 
 IceModelVec::Ptr PSB_strain_rates::compute_impl() const {
-  IceModelVec2V::Ptr velbar = IceModelVec2V::ToVector(PSB_velbar(model).compute());
+  IceModelVec2V::Ptr velbar = IceModelVec2V::ToVector(shared<PSB_velbar>(model, "velbar"));
 
   IceModelVec2::Ptr result(new IceModelVec2(m_grid, "strain_rates", WITHOUT_GHOSTS, 1, 2));
   result->metadata(0) = m_vars[0];
@@ -860,7 +911,7 @@ IceModelVec::Ptr PSB_deviatoric_stresses::compute_impl() const {
                         hardness);
 
   // copy_from updates ghosts
-  velocity.copy_from(*IceModelVec2V::ToVector(PSB_velbar(model).compute()));
+  velocity.copy_from(*IceModelVec2V::ToVector(shared<PSB_velbar>(model, "velbar")));
 
   stressbalance::compute_2D_stresses(*model->shallow()->flow_law(),
                                      velocity, hardness, cell_type, *result);
@@ -1051,10 +1102,10 @@ IceModelVec::Ptr PSB_vonmises_stress::compute_impl() const {
 
   IceModelVec2S &vonmises_stress = *result;
 
-  IceModelVec2V::Ptr velbar = IceModelVec2V::ToVector(PSB_velbar(model).compute());
+  IceModelVec2V::Ptr velbar = IceModelVec2V::ToVector(shared<PSB_velbar>(model, "velbar"));
   IceModelVec2V &velocity = *velbar;
 
-  IceModelVec2::Ptr eigen12 = IceModelVec2::To2D(PSB_strain_rates(model).compute());
+  IceModelVec2::Ptr eigen12 = IceModelVec2::To2D(shared<PSB_strain_rates>(model, "strain_rates"));
   IceModelVec2 &strain_rates = *eigen12;
 
   const IceModelVec2S &ice_thickness = *m_grid->variables().get_2d_scalar("land_ice_thickness");
@@ -1,4 +1,4 @@
-// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017 Constantine Khroulev
+// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2020 Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -148,6 +148,7 @@ public:
   PSB_bfrict(const StressBalance *m);
 protected:
   virtual IceModelVec::Ptr compute_impl() const;
+  virtual const IceModelVec* borrow_impl() const;
 };
 
 //! \brief Computes the x-component of the horizontal ice velocity.
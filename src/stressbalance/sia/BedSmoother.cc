@@ -1,4 +1,4 @@
-// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -27,6 +27,7 @@
 #include "pism/util/error_handling.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Logger.hh"
+#include "pism/util/GhostUpdateBatch.hh"
 
 namespace pism {
 namespace stressbalance {
@@ -59,16 +60,11 @@ BedSmoother::BedSmoother(IceGrid::ConstPtr g, int MAX_GHOSTS)
     m_C4.set_attrs("bed_smoother_tool",
                    "polynomial coeff of H^-4, in bed roughness parameterization",
                    "m4", "m4", "", 0);
-
-    // allocate Vecs that live on processor 0:
-    m_topgp0 = m_topgsmooth.allocate_proc0_copy();
-    m_topgsmoothp0 = m_topgsmooth.allocate_proc0_copy();
-    m_maxtlp0 = m_maxtl.allocate_proc0_copy();
-    m_C2p0 = m_C2.allocate_proc0_copy();
-    m_C3p0 = m_C3.allocate_proc0_copy();
-    m_C4p0 = m_C4.allocate_proc0_copy();
   }
 
+  // Note: copies of these fields on processor 0 are allocated by preprocess_bed() if the
+  // smoothing window is too wide for the distributed implementation.
+
   m_Glen_exponent = m_config->get_number("stress_balance.sia.Glen_exponent"); // choice is SIA; see #285
   m_smoothing_range = m_config->get_number("stress_balance.sia.bed_smoother.range");
 
@@ -139,6 +135,38 @@ void BedSmoother::preprocess_bed(const IceModelVec2S &topg,
   m_Nx = Nx;
   m_Ny = Ny;
 
+  const int width = std::max(m_Nx, m_Ny);
+
+  if (halo_fits(width)) {
+    if (not m_topg_halo or (int)m_topg_halo->stencil_width() < width) {
+      m_topg_halo.reset(new IceModelVec2S(m_grid, "topg_halo", WITH_GHOSTS, width));
+    }
+
+    m_topg_halo->copy_from(topg);
+    m_topg_halo->update_ghosts();
+
+    // these calls fill ghosts in all the fields they compute
+    smooth_the_bed();
+    compute_coefficients();
+    return;
+  }
+
+  // The smoothing window is wider than some sub-domains: fall back to the serial
+  // implementation.
+  if (not m_topgp0) {
+    m_grid->ctx()->log()->message(2,
+                                  "  BedSmoother: the smoothing window (%d x %d grid points) is too wide\n"
+                                  "  for this domain decomposition; smoothing on processor 0...\n",
+                                  2 * m_Nx + 1, 2 * m_Ny + 1);
+
+    m_topgp0       = m_topgsmooth.allocate_proc0_copy();
+    m_topgsmoothp0 = m_topgsmooth.allocate_proc0_copy();
+    m_maxtlp0      = m_maxtl.allocate_proc0_copy();
+    m_C2p0         = m_C2.allocate_proc0_copy();
+    m_C3p0         = m_C3.allocate_proc0_copy();
+    m_C4p0         = m_C4.allocate_proc0_copy();
+  }
+
   topg.put_on_proc0(*m_topgp0);
   smooth_the_bed_on_proc0();
   // next call *does indeed* fill ghosts in topgsmooth
@@ -153,6 +181,112 @@ void BedSmoother::preprocess_bed(const IceModelVec2S &topg,
 }
 
 
+/*!
+ * Returns true if every sub-domain is at least `width` grid points wide in both
+ * directions, i.e. if ghosts of this width can be exchanged with the nearest neighbors.
+ */
+bool BedSmoother::halo_fits(int width) const {
+  int local_size = std::min(m_grid->xm(), m_grid->ym());
+
+  return GlobalMin(m_grid->com, local_size) >= width;
+}
+
+//! Computes the smoothed bed by a simple average over a rectangle of grid points.
+/*!
+ * Uses ghosts of `m_topg_halo` to access the values in the smoothing window, so no
+ * communication is needed except for updating ghosts of the result.
+ *
+ * Produces the same result as smooth_the_bed_on_proc0().
+ */
+void BedSmoother::smooth_the_bed() {
+
+  const int Mx = (int)m_grid->Mx();
+  const int My = (int)m_grid->My();
+
+  const IceModelVec2S &b0 = *m_topg_halo;
+
+  IceModelVec::AccessList list{&b0, &m_topgsmooth};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    // average only over those points which are in the grid; do not wrap periodically
+    double sum = 0.0, count = 0.0;
+    for (int r = -m_Nx; r <= m_Nx; r++) {
+      for (int s = -m_Ny; s <= m_Ny; s++) {
+        if ((i+r >= 0) and (i+r < Mx) and (j+s >= 0) and (j+s < My)) {
+          sum   += b0(i+r, j+s);
+          count += 1.0;
+        }
+      }
+    }
+    // unprotected division by count but r=0,s=0 case guarantees count>=1
+    m_topgsmooth(i, j) = sum / count;
+  }
+
+  m_topgsmooth.update_ghosts();
+}
+
+//! Computes coefficients of the Taylor series approximating theta.
+/*!
+ * Distributed version of compute_coefficients_on_proc0(). Call smooth_the_bed() first.
+ */
+void BedSmoother::compute_coefficients() {
+
+  const int Mx = (int)m_grid->Mx();
+  const int My = (int)m_grid->My();
+
+  // scale the coeffs in Taylor series
+  const double
+    n = m_Glen_exponent,
+    k  = (n + 2) / n,
+    s2 = k * (2 * n + 2) / (2 * n),
+    s3 = s2 * (3 * n + 2) / (3 * n),
+    s4 = s3 * (4 * n + 2) / (4 * n);
+
+  const IceModelVec2S &b0 = *m_topg_halo;
+
+  IceModelVec::AccessList list{&b0, &m_topgsmooth, &m_maxtl, &m_C2, &m_C3, &m_C4};
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    // average only over those points which are in the grid
+    // do not wrap periodically
+    double
+      topgs     = m_topgsmooth(i, j),
+      maxtltemp = 0.0,
+      sum2      = 0.0,
+      sum3      = 0.0,
+      sum4      = 0.0,
+      count     = 0.0;
+
+    for (int r = -m_Nx; r <= m_Nx; r++) {
+      for (int s = -m_Ny; s <= m_Ny; s++) {
+        if ((i+r >= 0) && (i+r < Mx) && (j+s >= 0) && (j+s < My)) {
+          // tl is elevation of local topography at a pt in patch
+          const double tl  = b0(i+r, j+s) - topgs;
+          maxtltemp = std::max(maxtltemp, tl);
+          // accumulate 2nd, 3rd, and 4th powers with only 3 multiplications
+          const double tl2 = tl * tl;
+          sum2 += tl2;
+          sum3 += tl2 * tl;
+          sum4 += tl2 * tl2;
+          count += 1.0;
+        }
+      }
+    }
+    m_maxtl(i, j) = maxtltemp;
+
+    // unprotected division by count but r=0,s=0 case guarantees count>=1
+    m_C2(i, j) = (sum2 / count) * s2;
+    m_C3(i, j) = (sum3 / count) * s3;
+    m_C4(i, j) = (sum4 / count) * s4;
+  }
+
+  GhostUpdateBatch{&m_maxtl, &m_C2, &m_C3, &m_C4}.update();
+}
+
 //! Computes the smoothed bed by a simple average over a rectangle of grid points.
 void BedSmoother::smooth_the_bed_on_proc0() {
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2004--2019 Jed Brown, Craig Lingle, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004--2020 Jed Brown, Craig Lingle, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,7 @@
 
 #include <cstdlib>
 #include <cassert>
+#include <algorithm>            // std::min
 
 #include "SIAFD.hh"
 #include "BedSmoother.hh"
@@ -30,6 +31,10 @@
 #include "pism/util/error_handling.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/Tiles.hh"
+#include "pism/util/GhostUpdateBatch.hh"
+#include "pism/util/StencilCursor.hh"
+#include "pism/util/IceModelVecView.hh"
 #include "pism/util/IceModelVec2CellType.hh"
 #include "pism/geometry/Geometry.hh"
 #include "pism/stressbalance/StressBalance.hh"
@@ -47,10 +52,9 @@ SIAFD::SIAFD(IceGrid::ConstPtr g)
     m_h_x(m_grid, "h_x", WITH_GHOSTS),
     m_h_y(m_grid, "h_y", WITH_GHOSTS),
     m_D(m_grid, "diffusivity", WITH_GHOSTS),
-    m_delta_0(m_grid, "delta_0", WITH_GHOSTS),
-    m_delta_1(m_grid, "delta_1", WITH_GHOSTS),
     m_work_3d_0(m_grid, "work_3d_0", WITH_GHOSTS),
-    m_work_3d_1(m_grid, "work_3d_1", WITH_GHOSTS)
+    m_work_3d_1(m_grid, "work_3d_1", WITH_GHOSTS),
+    m_active_cells(*m_grid)
 {
   // bed smoother
   m_bed_smoother = new BedSmoother(m_grid, m_stencil_width);
@@ -148,8 +152,7 @@ void SIAFD::update(const IceModelVec2V &sliding_velocity,
 
   if (full_update) {
     profiling.begin("sia.3d_velocity");
-    compute_3d_horizontal_velocity(*inputs.geometry, m_h_x, m_h_y, sliding_velocity,
-                                   m_u, m_v);
+    compute_3d_horizontal_velocity(*inputs.geometry, m_h_x, m_h_y, sliding_velocity, m_u, m_v);
     profiling.end("sia.3d_velocity");
   }
 }
@@ -252,42 +255,44 @@ void SIAFD::surface_gradient_eta(const IceModelVec2S &ice_thickness,
   assert(h_x.stencil_width() >= 1);
   assert(h_y.stencil_width() >= 1);
 
-  for (PointsWithGhosts p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
-    auto b = bed_elevation.box(i, j);
-    auto e = eta.box(i, j);
-
-    // i-offset
-    {
-      double mean_eta = 0.5 * (e.e + e.ij);
-      if (mean_eta > 0.0) {
-        double factor = invpow * pow(mean_eta, dinvpow);
-        h_x(i, j, 0) = factor * (e.e - e.ij) / dx;
-        h_y(i, j, 0) = factor * (e.ne + e.n - e.se - e.s) / (4.0 * dy);
-      } else {
-        h_x(i, j, 0) = 0.0;
-        h_y(i, j, 0) = 0.0;
+  StencilCursor bed(bed_elevation), eta_row(eta);
+  for (Rows r(*m_grid, {&bed, &eta_row}, 1); r; r.next()) {
+    const int j = r.j();
+    for (int i = r.i_first(); i <= r.i_last(); ++i) {
+      auto b = bed.box(i);
+      auto e = eta_row.box(i);
+
+      // i-offset
+      {
+        double mean_eta = 0.5 * (e.e + e.ij);
+        if (mean_eta > 0.0) {
+          double factor = invpow * pow(mean_eta, dinvpow);
+          h_x(i, j, 0) = factor * (e.e - e.ij) / dx;
+          h_y(i, j, 0) = factor * (e.ne + e.n - e.se - e.s) / (4.0 * dy);
+        } else {
+          h_x(i, j, 0) = 0.0;
+          h_y(i, j, 0) = 0.0;
+        }
+        // now add bed slope to get actual h_x, h_y
+        h_x(i, j, 0) += (b.e - b.ij) / dx;
+        h_y(i, j, 0) += (b.ne + b.n - b.se - b.s) / (4.0 * dy);
       }
-      // now add bed slope to get actual h_x, h_y
-      h_x(i, j, 0) += (b.e - b.ij) / dx;
-      h_y(i, j, 0) += (b.ne + b.n - b.se - b.s) / (4.0 * dy);
-    }
 
-    // j-offset
-    {
-      double mean_eta = 0.5 * (e.n + e.ij);
-      if (mean_eta > 0.0) {
-        double factor = invpow * pow(mean_eta, dinvpow);
-        h_x(i, j, 1) = factor * (e.ne + e.e - e.nw - e.w) / (4.0 * dx);
-        h_y(i, j, 1) = factor * (e.n - e.ij) / dy;
-      } else {
-        h_x(i, j, 1) = 0.0;
-        h_y(i, j, 1) = 0.0;
+      // j-offset
+      {
+        double mean_eta = 0.5 * (e.n + e.ij);
+        if (mean_eta > 0.0) {
+          double factor = invpow * pow(mean_eta, dinvpow);
+          h_x(i, j, 1) = factor * (e.ne + e.e - e.nw - e.w) / (4.0 * dx);
+          h_y(i, j, 1) = factor * (e.n - e.ij) / dy;
+        } else {
+          h_x(i, j, 1) = 0.0;
+          h_y(i, j, 1) = 0.0;
+        }
+        // now add bed slope to get actual h_x, h_y
+        h_x(i, j, 1) += (b.ne + b.e - b.nw - b.w) / (4.0 * dx);
+        h_y(i, j, 1) += (b.n - b.ij) / dy;
       }
-      // now add bed slope to get actual h_x, h_y
-      h_x(i, j, 1) += (b.ne + b.e - b.nw - b.w) / (4.0 * dx);
-      h_y(i, j, 1) += (b.n - b.ij) / dy;
     }
   } // end of the loop over grid points
 }
@@ -309,17 +314,19 @@ void SIAFD::surface_gradient_mahaffy(const IceModelVec2S &ice_surface_elevation,
   // surface elevation needs more ghosts
   assert(h.stencil_width()   >= 2);
 
-  for (PointsWithGhosts p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
-
-    // I-offset
-    h_x(i, j, 0) = (h(i + 1, j) - h(i, j)) / dx;
-    h_y(i, j, 0) = (+ h(i + 1, j + 1) + h(i, j + 1)
-                    - h(i + 1, j - 1) - h(i, j - 1)) / (4.0*dy);
-    // J-offset
-    h_y(i, j, 1) = (h(i, j + 1) - h(i, j)) / dy;
-    h_x(i, j, 1) = (+ h(i + 1, j + 1) + h(i + 1, j)
-                    - h(i - 1, j + 1) - h(i - 1, j)) / (4.0*dx);
+  StencilCursor s(h);
+  for (Rows r(*m_grid, {&s}, 1); r; r.next()) {
+    const int j = r.j();
+    for (int i = r.i_first(); i <= r.i_last(); ++i) {
+      auto S = s.box(i);
+
+      // I-offset
+      h_x(i, j, 0) = (S.e - S.ij) / dx;
+      h_y(i, j, 0) = (+ S.ne + S.n - S.se - S.s) / (4.0*dy);
+      // J-offset
+      h_y(i, j, 1) = (S.n - S.ij) / dy;
+      h_x(i, j, 1) = (+ S.ne + S.e - S.nw - S.w) / (4.0*dx);
+    }
   }
 }
 
@@ -495,8 +502,7 @@ void SIAFD::surface_gradient_haseloff(const IceModelVec2S &ice_surface_elevation
     } // end of "y-derivative, i-offset"
   }
 
-  h_x.update_ghosts();
-  h_y.update_ghosts();
+  GhostUpdateBatch{&h_x, &h_y}.update();
 }
 
 
@@ -531,9 +537,18 @@ void SIAFD::surface_gradient_haseloff(const IceModelVec2S &ice_surface_elevation
  * \f$F(z)\f$ (which is computationally expensive) in the horizontal ice
  * velocity (see compute_3d_horizontal_velocity()) computation.
  *
- * This method computes \f$D\f$ and stores \f$\delta\f$ in delta[0,1] if full_update is true.
+ * This method computes \f$D\f$ and, if full_update is true,
+ *
+ * \f[ I(z) = \int_b^z\delta(s)ds, \f]
+ *
+ * storing it in work_3d[0,1]. \f$I\f$ is used to compute the SIA component of the 3D
+ * horizontal ice velocity.
+ *
+ * The trapezoidal rule is used to approximate integrals.
  *
- * The trapezoidal rule is used to approximate the integral.
+ * Both staggered grid offsets are processed while visiting a grid point, so that its
+ * enthalpy (and age) columns are read from memory once, and \f$I\f$ is computed while
+ * \f$\delta\f$ is still in cache instead of storing \f$\delta\f$ in a 3D field.
  *
  * \param[in]  full_update the flag specitying if we're doing a "full" update.
  * \param[in]  h_x x-component of the surface gradient, on the staggered grid
@@ -556,7 +571,7 @@ void SIAFD::compute_diffusivity(bool full_update,
     &H = geometry.ice_thickness;
 
   const IceModelVec2CellType &mask = geometry.cell_type;
-  IceModelVec3* delta[] = {&m_delta_0, &m_delta_1};
+  IceModelVec3* I[] = {&m_work_3d_0, &m_work_3d_1};
 
   result.set(0.0);
 
@@ -572,8 +587,6 @@ void SIAFD::compute_diffusivity(bool full_update,
     limit_diffusivity            = m_config->get_flag("stress_balance.sia.limit_diffusivity"),
     use_age                      = compute_grain_size_using_age or e_age_coupling;
 
-  rheology::grain_size_vostok gs_vostok;
-
   // get "theta" from Schoof (2003) bed smoothness calculation and the
   // thickness relative to the smoothed bed; each IceModelVec2S involved must
   // have stencil width WIDE_GHOSTS for this too work
@@ -589,9 +602,9 @@ void SIAFD::compute_diffusivity(bool full_update,
   }
 
   if (full_update) {
-    list.add({delta[0], delta[1]});
-    assert(m_delta_0.stencil_width()  >= 1);
-    assert(m_delta_1.stencil_width()  >= 1);
+    list.add({I[0], I[1]});
+    assert(I[0]->stencil_width()  >= 1);
+    assert(I[1]->stencil_width()  >= 1);
   }
 
   assert(theta.stencil_width()      >= 2);
@@ -607,143 +620,206 @@ void SIAFD::compute_diffusivity(bool full_update,
     My = m_grid->My(),
     Mz = m_grid->Mz();
 
-  std::vector<double> depth(Mz), stress(Mz), pressure(Mz), E(Mz), flow(Mz);
-  std::vector<double> delta_ij(Mz);
-  std::vector<double> A(Mz), ice_grain_size(Mz, m_config->get_number("constants.ice.grain_size", "m"));
-  std::vector<double> e_factor(Mz, enhancement_factor);
-
-  double D_max = 0.0;
-  int high_diffusivity_counter = 0;
-  for (int o=0; o<2; o++) {
-    ParallelSection loop(m_grid->com);
-    try {
-      for (PointsWithGhosts p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
+  std::vector<double> level_spacing(Mz);
+  for (unsigned int k = 1; k < Mz; ++k) {
+    level_spacing[k] = z[k] - z[k - 1];
+  }
 
-        // staggered point: o=0 is i+1/2, o=1 is j+1/2, (i, j) and (i+oi, j+oj)
-        //   are regular grid neighbors of a staggered point:
-        const int oi = 1 - o, oj = o;
+  const double grain_size = m_config->get_number("constants.ice.grain_size", "m");
 
-        const double
-          thk = 0.5 * (thk_smooth(i, j) + thk_smooth(i+oi, j+oj));
+  const Profiling &profiling = m_grid->ctx()->profiling();
+  const int region = profiling.region("sia.diffusivity");
+  Profiling::Scope scope(profiling, region);
+
+  // Tiles may be processed concurrently, so each tile gets its own work space and
+  // partial reductions.
+  const Tiles tiles(*m_grid, 1);
+  std::vector<double> D_max_tile(tiles.size(), 0.0);
+  std::vector<int> high_diffusivity_counter_tile(tiles.size(), 0);
+  // number of ice levels processed (used to estimate the work done)
+  std::vector<double> levels_tile(tiles.size(), 0.0);
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for_each_tile(tiles, [&](const Tile &tile) {
+      rheology::grain_size_vostok gs_vostok;
+
+      std::vector<double> depth(Mz), stress(Mz), pressure(Mz), E(Mz), flow(Mz);
+      std::vector<double> delta_ij(Mz);
+      std::vector<double> A(Mz), ice_grain_size(Mz, grain_size);
+      std::vector<double> e_factor(Mz, enhancement_factor);
+
+      double D_max = 0.0;
+      int high_diffusivity_counter = 0;
+      double levels = 0.0;
+
+      for (PointsInTile p(tile); p; p.next()) {
+        const int i = p.i(), j = p.j();
 
-        // zero thickness case:
-        if (thk == 0.0) {
-          result(i, j, o) = 0.0;
-          if (full_update) {
-            delta[o]->set_column(i, j, 0.0);
-          }
-          continue;
-        }
+        for (int o = 0; o < 2; o++) {
 
-        const int ks = m_grid->kBelowHeight(thk);
+          // staggered point: o=0 is i+1/2, o=1 is j+1/2, (i, j) and (i+oi, j+oj)
+          //   are regular grid neighbors of a staggered point:
+          const int oi = 1 - o, oj = o;
 
-        for (int k = 0; k <= ks; ++k) {
-          depth[k] = thk - z[k];
-        }
+          const double
+            thk = 0.5 * (thk_smooth(i, j) + thk_smooth(i+oi, j+oj));
 
-        // pressure added by the ice (i.e. pressure difference between the
-        // current level and the top of the column)
-        m_EC->pressure(depth, ks, pressure); // FIXME issue #15
+          // zero thickness case:
+          if (thk == 0.0) {
+            result(i, j, o) = 0.0;
+            if (full_update) {
+              I[o]->set_column(i, j, 0.0);
+            }
+            continue;
+          }
 
-        if (use_age) {
-          const double
-            *age_ij     = age->get_column(i, j),
-            *age_offset = age->get_column(i+oi, j+oj);
+          const int ks = m_grid->kBelowHeight(thk);
+          levels += ks + 1;
 
           for (int k = 0; k <= ks; ++k) {
-            A[k] = 0.5 * (age_ij[k] + age_offset[k]);
+            depth[k] = thk - z[k];
           }
 
-          if (compute_grain_size_using_age) {
+          // pressure added by the ice (i.e. pressure difference between the
+          // current level and the top of the column)
+          m_EC->pressure(depth, ks, pressure); // FIXME issue #15
+
+          if (use_age) {
+            const double
+              *age_ij     = age->get_column(i, j),
+              *age_offset = age->get_column(i+oi, j+oj);
+
             for (int k = 0; k <= ks; ++k) {
-              // convert age from seconds to years:
-              ice_grain_size[k] = gs_vostok(A[k] * m_seconds_per_year);
+              A[k] = 0.5 * (age_ij[k] + age_offset[k]);
+            }
+
+            if (compute_grain_size_using_age) {
+              for (int k = 0; k <= ks; ++k) {
+                // convert age from seconds to years:
+                ice_grain_size[k] = gs_vostok(A[k] * m_seconds_per_year);
+              }
+            }
+
+            if (e_age_coupling) {
+              for (int k = 0; k <= ks; ++k) {
+                const double accumulation_time = current_time - A[k];
+                if (interglacial(accumulation_time)) {
+                  e_factor[k] = enhancement_factor_interglacial;
+                } else {
+                  e_factor[k] = enhancement_factor;
+                }
+              }
             }
           }
 
-          if (e_age_coupling) {
+          {
+            const double
+              *E_ij     = enthalpy->get_column(i, j),
+              *E_offset = enthalpy->get_column(i+oi, j+oj);
             for (int k = 0; k <= ks; ++k) {
-              const double accumulation_time = current_time - A[k];
-              if (interglacial(accumulation_time)) {
-                e_factor[k] = enhancement_factor_interglacial;
-              } else {
-                e_factor[k] = enhancement_factor;
-              }
+              E[k] = 0.5 * (E_ij[k] + E_offset[k]);
             }
           }
-        }
 
-        {
-          const double
-            *E_ij     = enthalpy->get_column(i, j),
-            *E_offset = enthalpy->get_column(i+oi, j+oj);
+          const double alpha = sqrt(PetscSqr(h_x(i, j, o)) + PetscSqr(h_y(i, j, o)));
           for (int k = 0; k <= ks; ++k) {
-            E[k] = 0.5 * (E_ij[k] + E_offset[k]);
+            stress[k] = alpha * pressure[k];
           }
-        }
 
-        const double alpha = sqrt(PetscSqr(h_x(i, j, o)) + PetscSqr(h_y(i, j, o)));
-        for (int k = 0; k <= ks; ++k) {
-          stress[k] = alpha * pressure[k];
-        }
+          m_flow_law->flow_n(&stress[0], &E[0], &pressure[0], &ice_grain_size[0], ks + 1,
+                             &flow[0]);
 
-        m_flow_law->flow_n(&stress[0], &E[0], &pressure[0], &ice_grain_size[0], ks + 1,
-                           &flow[0]);
+          const double theta_local = 0.5 * (theta(i, j) + theta(i+oi, j+oj));
+          for (int k = 0; k <= ks; ++k) {
+            delta_ij[k] = e_factor[k] * theta_local * 2.0 * pressure[k] * flow[k];
+          }
 
-        const double theta_local = 0.5 * (theta(i, j) + theta(i+oi, j+oj));
-        for (int k = 0; k <= ks; ++k) {
-          delta_ij[k] = e_factor[k] * theta_local * 2.0 * pressure[k] * flow[k];
-        }
+          double D = 0.0;  // diffusivity for deformational SIA flow
+          {
+            for (int k = 1; k <= ks; ++k) {
+              // trapezoidal rule
+              const double dz = z[k] - z[k-1];
+              D += 0.5 * dz * ((depth[k] + dz) * delta_ij[k-1] + depth[k] * delta_ij[k]);
+            }
+            // finish off D with (1/2) dz (0 + (H-z[ks])*delta_ij[ks]), but dz=H-z[ks]:
+            const double dz = thk - z[ks];
+            D += 0.5 * dz * dz * delta_ij[ks];
+          }
 
-        double D = 0.0;  // diffusivity for deformational SIA flow
-        {
-          for (int k = 1; k <= ks; ++k) {
-            // trapezoidal rule
-            const double dz = z[k] - z[k-1];
-            D += 0.5 * dz * ((depth[k] + dz) * delta_ij[k-1] + depth[k] * delta_ij[k]);
+          // Override diffusivity at the edges of the domain. (At these
+          // locations PISM uses ghost cells *beyond* the boundary of
+          // the computational domain. This does not matter if the ice
+          // does not extend all the way to the domain boundary, as in
+          // whole-ice-sheet simulations. In a regional setup, though,
+          // this adjustment lets us avoid taking very small time-steps
+          // because of the possible thickness and bed elevation
+          // "discontinuities" at the boundary.)
+          if (i < 0 || i >= (int)Mx - 1 ||
+              j < 0 || j >= (int)My - 1) {
+            D = 0.0;
           }
-          // finish off D with (1/2) dz (0 + (H-z[ks])*delta_ij[ks]), but dz=H-z[ks]:
-          const double dz = thk - z[ks];
-          D += 0.5 * dz * dz * delta_ij[ks];
-        }
 
-        // Override diffusivity at the edges of the domain. (At these
-        // locations PISM uses ghost cells *beyond* the boundary of
-        // the computational domain. This does not matter if the ice
-        // does not extend all the way to the domain boundary, as in
-        // whole-ice-sheet simulations. In a regional setup, though,
-        // this adjustment lets us avoid taking very small time-steps
-        // because of the possible thickness and bed elevation
-        // "discontinuities" at the boundary.)
-        if (i < 0 || i >= (int)Mx - 1 ||
-            j < 0 || j >= (int)My - 1) {
-          D = 0.0;
-        }
+          if (limit_diffusivity and D >= D_limit) {
+            D = D_limit;
+            high_diffusivity_counter += 1;
+          }
 
-        if (limit_diffusivity and D >= D_limit) {
-          D = D_limit;
-          high_diffusivity_counter += 1;
-        }
+          D_max = std::max(D_max, D);
 
-        D_max = std::max(D_max, D);
+          result(i, j, o) = D;
 
-        result(i, j, o) = D;
+          // if doing the full update, compute I
+          if (full_update) {
+            double *I_ij = I[o]->get_column(i, j);
+
+            // within the ice:
+            I_ij[0] = 0.0;
+            double I_current = 0.0;
+            for (int k = 1; k <= ks; ++k) {
+              // trapezoidal rule
+              I_current += 0.5 * level_spacing[k] * (delta_ij[k - 1] + delta_ij[k]);
+              I_ij[k] = I_current;
+            }
 
-        // if doing the full update, fill the delta column above the ice and
-        // store it:
-        if (full_update) {
-          for (unsigned int k = ks + 1; k < Mz; ++k) {
-            delta_ij[k] = 0.0;
+            // above the ice:
+            for (unsigned int k = ks + 1; k < Mz; ++k) {
+              I_ij[k] = I_current;
+            }
           }
-          delta[o]->set_column(i, j, &delta_ij[0]);
-        }
+        } // o-loop
       } // i, j-loop
-    } catch (...) {
-      loop.failed();
-    }
-    loop.check();
-  } // o-loop
+
+      D_max_tile[tile.index]                    = D_max;
+      high_diffusivity_counter_tile[tile.index] = high_diffusivity_counter;
+      levels_tile[tile.index]                   = levels;
+    });
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+
+  double D_max = 0.0, levels = 0.0;
+  int high_diffusivity_counter = 0;
+  for (unsigned int k = 0; k < tiles.size(); ++k) {
+    D_max = std::max(D_max, D_max_tile[k]);
+    high_diffusivity_counter += high_diffusivity_counter_tile[k];
+    levels += levels_tile[k];
+  }
+
+  // Approximate work per ice level at a staggered grid point: about 40 flops (the flow
+  // law accounts for most of them) and 8 bytes per 3D value read or written (enthalpy and
+  // optionally age in two columns, I). Each staggered point also reads 6 and writes 1 2D
+  // values.
+  {
+    const double
+      points          = 2.0 * m_grid->xm() * m_grid->ym(),
+      flops_per_level = full_update ? 43.0 : 40.0,
+      bytes_per_level = 8.0 * (2 + (use_age ? 2 : 0) + (full_update ? 1 : 0));
+    profiling.add_work(region,
+                       flops_per_level * levels + 10.0 * points,
+                       bytes_per_level * levels + 8.0 * 7 * points);
+  }
 
   m_D_max = GlobalMax(m_grid->com, D_max);
 
@@ -775,98 +851,25 @@ void SIAFD::compute_diffusive_flux(const IceModelVec2Stag &h_x, const IceModelVe
 
   IceModelVec::AccessList list{&diffusivity, &h_x, &h_y, &result};
 
-  for (int o = 0; o < 2; o++) {
-    ParallelSection loop(m_grid->com);
-    try {
-      for (PointsWithGhosts p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
-
-        const double slope = (o == 0) ? h_x(i, j, o) : h_y(i, j, o);
-
-        result(i, j, o) = - diffusivity(i, j, o) * slope;
-      }
-    } catch (...) {
-      loop.failed();
+  View2<const double, 2>
+    D(diffusivity),
+    hx(h_x),
+    hy(h_y);
+  View2<double, 2> Q(result);
+
+  const int
+    w  = std::min(result.stencil_width(), 1u),
+    xs = m_grid->xs() - w,
+    xe = m_grid->xs() + m_grid->xm() + w,
+    ys = m_grid->ys() - w,
+    ye = m_grid->ys() + m_grid->ym() + w;
+
+  for (int j = ys; j < ye; ++j) {
+    for (int i = xs; i < xe; ++i) {
+      Q(i, j, 0) = - D(i, j, 0) * hx(i, j, 0);
+      Q(i, j, 1) = - D(i, j, 1) * hy(i, j, 1);
     }
-    loop.check();
-  } // o-loop
-}
-
-//! \brief Compute I.
-/*!
- * This computes
- * \f[ I(z) = \int_b^z\delta(s)ds.\f]
- *
- * Uses the trapezoidal rule to approximate the integral.
- *
- * See compute_diffusive_flux() for the definition of \f$\delta\f$.
- *
- * The result is stored in work_3d[0,1] and is used to compute the SIA component
- * of the 3D-distributed horizontal ice velocity.
- */
-void SIAFD::compute_I(const Geometry &geometry) {
-
-  IceModelVec2S &thk_smooth = m_work_2d_0;
-  IceModelVec3* I[] = {&m_work_3d_0, &m_work_3d_1};
-  IceModelVec3* delta[] = {&m_delta_0, &m_delta_1};
-
-  const IceModelVec2S
-    &h = geometry.ice_surface_elevation,
-    &H = geometry.ice_thickness;
-
-  const IceModelVec2CellType &mask = geometry.cell_type;
-
-  m_bed_smoother->smoothed_thk(h, H, mask, thk_smooth);
-
-  IceModelVec::AccessList list{delta[0], delta[1], I[0], I[1], &thk_smooth};
-
-  assert(I[0]->stencil_width()     >= 1);
-  assert(I[1]->stencil_width()     >= 1);
-  assert(delta[0]->stencil_width() >= 1);
-  assert(delta[1]->stencil_width() >= 1);
-  assert(thk_smooth.stencil_width() >= 2);
-
-  const unsigned int Mz = m_grid->Mz();
-
-  std::vector<double> dz(Mz);
-  for (unsigned int k = 1; k < Mz; ++k) {
-    dz[k] = m_grid->z(k) - m_grid->z(k - 1);
   }
-
-  for (int o = 0; o < 2; ++o) {
-    ParallelSection loop(m_grid->com);
-    try {
-      for (PointsWithGhosts p(*m_grid); p; p.next()) {
-        const int i = p.i(), j = p.j();
-
-        const int oi = 1 - o, oj = o;
-        const double
-          thk = 0.5 * (thk_smooth(i, j) + thk_smooth(i + oi, j + oj));
-
-        const double *delta_ij = delta[o]->get_column(i, j);
-        double       *I_ij     = I[o]->get_column(i, j);
-
-        const unsigned int ks = m_grid->kBelowHeight(thk);
-
-        // within the ice:
-        I_ij[0] = 0.0;
-        double I_current = 0.0;
-        for (unsigned int k = 1; k <= ks; ++k) {
-          // trapezoidal rule
-          I_current += 0.5 * dz[k] * (delta_ij[k - 1] + delta_ij[k]);
-          I_ij[k] = I_current;
-        }
-
-        // above the ice:
-        for (unsigned int k = ks + 1; k < Mz; ++k) {
-          I_ij[k] = I_current;
-        }
-      }
-    } catch (...) {
-      loop.failed();
-    }
-    loop.check();
-  } // o-loop
 }
 
 //! \brief Compute horizontal components of the SIA velocity (in 3D).
@@ -875,7 +878,7 @@ void SIAFD::compute_I(const Geometry &geometry) {
  *
  * \f[ \mathbf{U}(z) = -2 \nabla h \int_b^z F(s)P(s)ds + \mathbf{U}_b,\f]
  *
- * which can be written in terms of \f$I(z)\f$ defined in compute_I():
+ * which can be written in terms of \f$I(z)\f$ computed by compute_diffusivity():
  *
  * \f[ \mathbf{U}(z) = -I(z) \nabla h + \mathbf{U}_b. \f]
  *
@@ -893,17 +896,22 @@ void SIAFD::compute_3d_horizontal_velocity(const Geometry &geometry,
                                            const IceModelVec2V &sliding_velocity,
                                            IceModelVec3 &u_out, IceModelVec3 &v_out) {
 
-  compute_I(geometry);
-  // after the compute_I() call work_3d[0,1] contains I on the staggered grid
+  // compute_diffusivity() stored I (on the staggered grid) in work_3d[0,1]
   IceModelVec3* I[] = {&m_work_3d_0, &m_work_3d_1};
 
-  IceModelVec::AccessList list{&u_out, &v_out, &h_x, &h_y, &sliding_velocity, I[0], I[1]};
+  const IceModelVec2S &H = geometry.ice_thickness;
 
-  const unsigned int Mz = m_grid->Mz();
+  // cells that are icy or next to an icy cell
+  m_active_cells.update(geometry.cell_type, 1);
 
-  for (Points p(*m_grid); p; p.next()) {
-    const int i = p.i(), j = p.j();
+  IceModelVec::AccessList list{&u_out, &v_out, &h_x, &h_y, &sliding_velocity, I[0], I[1], &H};
+
+  // u_out and v_out may use a subset (indices K) of levels of I (see velocity_levels())
+  const std::vector<unsigned int> K = velocity_level_indices(*m_grid);
+  const unsigned int Mz = K.size();
+  const bool all_levels = (Mz == m_grid->Mz());
 
+  auto velocity = [&](int i, int j) {
     const double
       *I_e = I[0]->get_column(i, j),
       *I_w = I[0]->get_column(i - 1, j),
@@ -931,6 +939,17 @@ void SIAFD::compute_3d_horizontal_velocity(const Geometry &geometry,
       *u_ij = u_out.get_column(i, j),
       *v_ij = v_out.get_column(i, j);
 
+    if (not all_levels) {
+      for (unsigned int m = 0; m < Mz; ++m) {
+        const unsigned int k = K[m];
+        u_ij[m] = sliding_velocity_u - 0.25 * (I_e[k] * h_x_e + I_w[k] * h_x_w +
+                                               I_n[k] * h_x_n + I_s[k] * h_x_s);
+        v_ij[m] = sliding_velocity_v - 0.25 * (I_e[k] * h_y_e + I_w[k] * h_y_w +
+                                               I_n[k] * h_y_n + I_s[k] * h_y_s);
+      }
+      return;
+    }
+
     // split into two loops to encourage auto-vectorization
     for (unsigned int k = 0; k < Mz; ++k) {
       u_ij[k] = sliding_velocity_u - 0.25 * (I_e[k] * h_x_e + I_w[k] * h_x_w +
@@ -940,11 +959,33 @@ void SIAFD::compute_3d_horizontal_velocity(const Geometry &geometry,
       v_ij[k] = sliding_velocity_v - 0.25 * (I_e[k] * h_y_e + I_w[k] * h_y_w +
                                              I_n[k] * h_y_n + I_s[k] * h_y_s);
     }
-  }
+  };
+
+  for_each_tile(m_active_cells.tiles(), [&](const Tile &tile) {
+      for (auto c : m_active_cells.active(tile)) {
+        velocity(c.i, c.j);
+      }
+
+      for (auto c : m_active_cells.inactive(tile)) {
+        const int i = c.i, j = c.j;
+
+        if (H(i, j) == 0.0 and
+            H(i + 1, j) == 0.0 and H(i - 1, j) == 0.0 and
+            H(i, j + 1) == 0.0 and H(i, j - 1) == 0.0) {
+          // compute_diffusivity() sets I to zero at cell interfaces with no ice on either
+          // side, so the velocity is equal to the sliding velocity
+          u_out.set_column(i, j, sliding_velocity(i, j).u);
+          v_out.set_column(i, j, sliding_velocity(i, j).v);
+        } else {
+          // an ice-free cell (according to the mask) can still contain a thin layer of
+          // ice
+          velocity(i, j);
+        }
+      }
+    });
 
   // Communicate to get ghosts:
-  u_out.update_ghosts();
-  v_out.update_ghosts();
+  GhostUpdateBatch{&u_out, &v_out}.update();
 }
 
 //! Determine if `accumulation_time` corresponds to an interglacial period.
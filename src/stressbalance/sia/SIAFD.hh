@@ -20,6 +20,7 @@
 #define _SIAFD_H_
 
 #include "pism/stressbalance/SSB_Modifier.hh"      // derives from SSB_Modifier
+#include "pism/util/ActiveCellList.hh"
 
 namespace pism {
 
@@ -99,8 +100,6 @@ protected:
                                               const IceModelVec2V &vel_input,
                                               IceModelVec3 &u_out, IceModelVec3 &v_out);
 
-  virtual void compute_I(const Geometry &geometry);
-
   bool interglacial(double accumulation_time);
 
   const unsigned int m_stencil_width;
@@ -110,13 +109,13 @@ protected:
   IceModelVec2S m_work_2d_1;
   //! temporary storage for the surface gradient and the diffusivity
   IceModelVec2Stag m_h_x, m_h_y, m_D;
-  //! temporary storage for delta on the staggered grid
-  IceModelVec3 m_delta_0;
-  IceModelVec3 m_delta_1;
   //! temporary storage used to store I and strain_heating on the staggered grid
   IceModelVec3 m_work_3d_0;
   IceModelVec3 m_work_3d_1;
 
+  //! columns next to icy cells (used to compute 3D velocity)
+  ActiveCellList m_active_cells;
+
   BedSmoother *m_bed_smoother;
 
   // profiling
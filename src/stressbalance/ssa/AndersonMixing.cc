@@ -0,0 +1,191 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cmath>
+#include <algorithm>            // std::max
+
+#include "AndersonMixing.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace stressbalance {
+
+AndersonMixing::AndersonMixing(MPI_Comm com, unsigned int depth)
+  : m_com(com), m_depth(depth) {
+  if (depth < 1) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "Anderson mixing depth has to be positive");
+  }
+}
+
+//! Forget all previous iterates (e.g. at the beginning of a new solve).
+void AndersonMixing::reset() {
+  m_f.clear();
+  m_g.clear();
+  m_dF.clear();
+  m_dG.clear();
+}
+
+//! Number of previous iterates used to compute the next one.
+unsigned int AndersonMixing::history_size() const {
+  return m_dF.size();
+}
+
+/*!
+ * Compute the next iterate.
+ *
+ * @param[in] f residual @f$ f_k = G(x_k) - x_k @f$
+ * @param[in,out] g on input: @f$ G(x_k) @f$, on output: the next iterate
+ *
+ * Returns `true` if previous iterates were used, `false` if `g` was not modified (the
+ * first iteration or a singular least squares problem; in the latter case the history is
+ * discarded).
+ */
+bool AndersonMixing::update(const std::vector<double> &f, std::vector<double> &g) {
+  const size_t N = f.size();
+
+  if (g.size() != N) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "sizes of f (%d) and g (%d) do not match",
+                                  (int)N, (int)g.size());
+  }
+
+  if (not m_f.empty()) {
+    std::vector<double> df(N), dg(N);
+    for (size_t n = 0; n < N; ++n) {
+      df[n] = f[n] - m_f[n];
+      dg[n] = g[n] - m_g[n];
+    }
+
+    m_dF.push_back(df);
+    m_dG.push_back(dg);
+
+    if (m_dF.size() > m_depth) {
+      m_dF.pop_front();
+      m_dG.pop_front();
+    }
+  }
+
+  m_f = f;
+  m_g = g;
+
+  if (m_dF.empty()) {
+    return false;
+  }
+
+  std::vector<double> gamma;
+  if (not least_squares(f, gamma)) {
+    // start over, keeping the current iterate
+    m_dF.clear();
+    m_dG.clear();
+    return false;
+  }
+
+  for (unsigned int k = 0; k < gamma.size(); ++k) {
+    const std::vector<double> &dg = m_dG[k];
+    for (size_t n = 0; n < N; ++n) {
+      g[n] -= gamma[k] * dg[n];
+    }
+  }
+
+  return true;
+}
+
+/*!
+ * Minimize @f$ \| f - \Delta F\, \gamma \|_2 @f$ by solving normal equations (the
+ * number of unknowns is small) using the Cholesky factorization.
+ *
+ * Returns `false` if the problem is (numerically) singular.
+ */
+bool AndersonMixing::least_squares(const std::vector<double> &f,
+                                   std::vector<double> &gamma) const {
+  const unsigned int M = m_dF.size();
+  const size_t N = f.size();
+
+  // local contributions to the lower triangle of dF^T dF (stored row-major) and to
+  // dF^T f
+  std::vector<double> local(M * M + M, 0.0), global(M * M + M, 0.0);
+  for (unsigned int r = 0; r < M; ++r) {
+    for (unsigned int c = 0; c <= r; ++c) {
+      double sum = 0.0;
+      for (size_t n = 0; n < N; ++n) {
+        sum += m_dF[r][n] * m_dF[c][n];
+      }
+      local[r * M + c] = sum;
+    }
+
+    double sum = 0.0;
+    for (size_t n = 0; n < N; ++n) {
+      sum += m_dF[r][n] * f[n];
+    }
+    local[M * M + r] = sum;
+  }
+
+  GlobalSum(m_com, local.data(), global.data(), local.size());
+
+  double *A = &global[0], *b = &global[M * M];
+
+  // Cholesky factorization A = L L^T (L overwrites the lower triangle of A)
+  double max_diagonal = 0.0;
+  for (unsigned int r = 0; r < M; ++r) {
+    max_diagonal = std::max(max_diagonal, A[r * M + r]);
+  }
+  const double eps = 1e-12 * max_diagonal;
+
+  for (unsigned int r = 0; r < M; ++r) {
+    for (unsigned int c = 0; c <= r; ++c) {
+      double sum = A[r * M + c];
+      for (unsigned int k = 0; k < c; ++k) {
+        sum -= A[r * M + k] * A[c * M + k];
+      }
+
+      if (r == c) {
+        if (not (sum > eps)) {
+          return false;
+        }
+        A[r * M + r] = std::sqrt(sum);
+      } else {
+        A[r * M + c] = sum / A[c * M + c];
+      }
+    }
+  }
+
+  // solve L y = b, then L^T gamma = y
+  gamma.resize(M);
+  for (unsigned int r = 0; r < M; ++r) {
+    double sum = b[r];
+    for (unsigned int k = 0; k < r; ++k) {
+      sum -= A[r * M + k] * gamma[k];
+    }
+    gamma[r] = sum / A[r * M + r];
+  }
+
+  for (int r = M - 1; r >= 0; --r) {
+    double sum = gamma[r];
+    for (unsigned int k = r + 1; k < M; ++k) {
+      sum -= A[k * M + r] * gamma[k];
+    }
+    gamma[r] = sum / A[r * M + r];
+  }
+
+  return true;
+}
+
+} // end of namespace stressbalance
+} // end of namespace pism
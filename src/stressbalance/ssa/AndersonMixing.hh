@@ -0,0 +1,68 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_ANDERSONMIXING_H
+#define PISM_ANDERSONMIXING_H
+
+#include <vector>
+#include <deque>
+#include <mpi.h>
+
+namespace pism {
+namespace stressbalance {
+
+//! Anderson acceleration of a fixed-point iteration @f$ x_{k+1} = G(x_k) @f$.
+/*!
+ * Given @f$ g_k = G(x_k) @f$ and the residual @f$ f_k = g_k - x_k @f$, the next iterate
+ * is
+ *
+ * @f[ x_{k+1} = g_k - \Delta G\, \gamma, @f]
+ *
+ * where @f$ \gamma @f$ minimizes @f$ \| f_k - \Delta F\, \gamma \|_2 @f$ and columns of
+ * @f$ \Delta F @f$ and @f$ \Delta G @f$ are differences of the last `depth` residuals and
+ * values of @f$ G @f$.
+ *
+ * Each processor stores the part of the state it owns; inner products are summed over
+ * all processors in `com`, so all processors have to call update() together.
+ */
+class AndersonMixing {
+public:
+  AndersonMixing(MPI_Comm com, unsigned int depth);
+
+  void reset();
+
+  bool update(const std::vector<double> &f, std::vector<double> &g);
+
+  unsigned int history_size() const;
+private:
+  bool least_squares(const std::vector<double> &f, std::vector<double> &gamma) const;
+
+  MPI_Comm m_com;
+  unsigned int m_depth;
+
+  // residual and the value of G from the previous iteration
+  std::vector<double> m_f, m_g;
+  // differences of residuals and of values of G (most recent last)
+  std::deque<std::vector<double> > m_dF, m_dG;
+};
+
+} // end of namespace stressbalance
+} // end of namespace pism
+
+#endif /* PISM_ANDERSONMIXING_H */
@@ -1,4 +1,4 @@
-// Copyright (C) 2004--2019 Constantine Khroulev, Ed Bueler, Jed Brown, Torsten Albrecht
+// Copyright (C) 2004--2020 Constantine Khroulev, Ed Bueler, Jed Brown, Torsten Albrecht
 //
 // This file is part of PISM.
 //
@@ -27,6 +27,7 @@
 #include "pism/util/pism_options.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/Time.hh"
 #include "pism/stressbalance/StressBalance.hh"
 #include "pism/geometry/Geometry.hh"
 
@@ -77,6 +78,8 @@ SSA::SSA(IceGrid::ConstPtr g)
 {
   strength_extension = new SSAStrengthExtension(*m_config);
 
+  m_skipped_solve_count = 0;
+
   const unsigned int WIDE_STENCIL = m_config->get_number("grid.max_stencil_width");
 
   // grounded_dragging_floating integer mask
@@ -112,6 +115,10 @@ SSA::SSA(IceGrid::ConstPtr g)
 
   m_da = m_velocity_global.dm();
 
+  if (m_config->get_string("stress_balance.ssa.initial_guess_extrapolation") != "none") {
+    m_velocity_extrapolated.create(m_grid, "velocity_extrapolated", WITH_GHOSTS, WIDE_STENCIL);
+  }
+
   {
     rheology::FlowLawFactory ice_factory("stress_balance.ssa.", m_config, m_EC);
     ice_factory.remove(ICE_GOLDSBY_KOHLSTEDT);
@@ -174,8 +181,26 @@ void SSA::update(const Inputs &inputs, bool full_update) {
                     m_mask);
   }
 
+  // iterations and residuals are recorded by solve()
+  m_solver_stats.reset();
+
   if (full_update) {
-    solve(inputs);
+    const double time = m_grid->ctx()->time()->current();
+
+    if (skip_solve(inputs)) {
+      m_skipped_solve_count += 1;
+    } else {
+      m_skipped_solve_count = 0;
+
+      extrapolate_initial_guess(inputs, time);
+
+      double start = MPI_Wtime();
+      solve(inputs);
+      m_solver_stats.wall_time = MPI_Wtime() - start;
+      m_solver_stats.steps = 1;
+    }
+
+    record_velocity(time);
     compute_basal_frictional_heating(m_velocity,
                                      *inputs.basal_yield_stress,
                                      m_mask,
@@ -346,6 +371,97 @@ std::string SSA::stdout_report() const {
 }
 
 
+/*!
+ * Replace the initial guess (the previous solution) with the velocity extrapolated from
+ * recent solutions to the model time `time` if this reduces the norm of the residual.
+ *
+ * Does nothing if stress_balance.ssa.initial_guess_extrapolation is "none" or if fewer
+ * than two solutions are available.
+ */
+void SSA::extrapolate_initial_guess(const Inputs &inputs, double time) {
+  if (not extrapolate_velocity(time, m_velocity_extrapolated)) {
+    return;
+  }
+
+  // exchanges m_velocity and m_velocity_extrapolated
+  auto swap = [this]() {
+    IceModelVec::AccessList list{&m_velocity, &m_velocity_extrapolated};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      Vector2 tmp = m_velocity(i, j);
+      m_velocity(i, j) = m_velocity_extrapolated(i, j);
+      m_velocity_extrapolated(i, j) = tmp;
+    }
+
+    m_velocity.update_ghosts();
+    m_velocity_extrapolated.update_ghosts();
+  };
+
+  const double residual_previous = initial_guess_residual(inputs);
+
+  swap();
+
+  const double residual_extrapolated = initial_guess_residual(inputs);
+
+  if (residual_extrapolated < residual_previous) {
+    m_log->message(3,
+                   "  SSA: using the extrapolated initial guess (residual %e instead of %e)\n",
+                   residual_extrapolated, residual_previous);
+  } else {
+    m_log->message(3,
+                   "  SSA: the extrapolated initial guess is worse (residual %e instead of %e);"
+                   " using the previous solution\n",
+                   residual_extrapolated, residual_previous);
+    swap();
+  }
+
+  // solvers that keep their state in m_velocity_global start from this guess
+  m_velocity_global.copy_from(m_velocity);
+}
+
+/*!
+ * Returns `true` if the current velocity (the previous solution) is accurate enough to be
+ * used with current inputs, i.e. the norm of its residual relative to the norm of the
+ * residual of zero velocity is below stress_balance.ssa.skip_solve.tolerance.
+ *
+ * At most stress_balance.ssa.skip_solve.max_count consecutive solves are skipped.
+ */
+bool SSA::skip_solve(const Inputs &inputs) {
+  const double tolerance = m_config->get_number("stress_balance.ssa.skip_solve.tolerance");
+  const int max_count = m_config->get_number("stress_balance.ssa.skip_solve.max_count");
+
+  if (not (tolerance > 0.0) or m_skipped_solve_count >= max_count) {
+    return false;
+  }
+
+  const double
+    residual      = initial_guess_residual(inputs),
+    residual_zero = zero_velocity_residual(inputs);
+
+  if (not (residual_zero > 0.0)) {
+    // zero velocity is a solution: solve as usual
+    return false;
+  }
+
+  const double relative_residual = residual / residual_zero;
+
+  if (relative_residual < tolerance) {
+    m_stdout_ssa = pism::printf("  SSA: skipping the solve (relative residual %e)\n",
+                                relative_residual);
+    m_log->message(3, m_stdout_ssa);
+    // solvers that keep their state in m_velocity_global use the current velocity
+    m_velocity_global.copy_from(m_velocity);
+    return true;
+  }
+
+  m_log->message(3, "  SSA: relative residual of the previous solution is %e; solving\n",
+                 relative_residual);
+
+  return false;
+}
+
 //! \brief Set the initial guess of the SSA velocity.
 void SSA::set_initial_guess(const IceModelVec2V &guess) {
   m_velocity.copy_from(guess);
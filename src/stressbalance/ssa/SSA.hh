@@ -137,6 +137,16 @@ protected:
 
   virtual void solve(const Inputs &inputs) = 0;
 
+  void extrapolate_initial_guess(const Inputs &inputs, double time);
+
+  //! Norm of the residual of the SSA system corresponding to the current velocity.
+  virtual double initial_guess_residual(const Inputs &inputs) = 0;
+
+  //! Norm of the residual of the SSA system corresponding to zero velocity.
+  virtual double zero_velocity_residual(const Inputs &inputs) = 0;
+
+  bool skip_solve(const Inputs &inputs);
+
   IceModelVec2CellType m_mask;
   IceModelVec2V m_taud;
 
@@ -146,6 +156,12 @@ protected:
   petsc::DM::Ptr  m_da;               // dof=2 DA
   IceModelVec2V m_velocity_global; // global vector for solution
 
+  // storage for the extrapolated initial guess
+  IceModelVec2V m_velocity_extrapolated;
+
+  // number of consecutive skipped solves (see skip_solve())
+  int m_skipped_solve_count;
+
   // profiling
   int m_event_ssa;
 };
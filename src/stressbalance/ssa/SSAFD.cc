@@ -1,4 +1,4 @@
-// Copyright (C) 2004--2019 Constantine Khroulev, Ed Bueler and Jed Brown
+// Copyright (C) 2004--2020 Constantine Khroulev, Ed Bueler and Jed Brown
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,11 @@
 
 #include <cassert>
 #include <stdexcept>
+#include <memory>               // std::unique_ptr
+#include <initializer_list>
+#include <algorithm>            // std::min_element, std::min, std::max
+
+#include <petscpcmg.h>
 
 #include "SSAFD.hh"
 #include "SSAFD_diagnostics.hh"
@@ -32,6 +37,9 @@
 #include "pism/stressbalance/StressBalance.hh"
 #include "pism/geometry/Geometry.hh"
 #include "pism/util/pism_utilities.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/Profiling.hh"
+#include "AndersonMixing.hh"
 
 namespace pism {
 namespace stressbalance {
@@ -52,6 +60,51 @@ SSA* SSAFDFactory(IceGrid::ConstPtr g) {
   return new SSAFD(g);
 }
 
+/*!
+ * Matrix type corresponding to a stress_balance.ssa.fd.device setting.
+ */
+static std::string device_matrix_type(const std::string &device) {
+  if (device == "cuda") {
+    return "aijcusparse";
+  }
+
+  if (device == "hip") {
+    return "aijhipsparse";
+  }
+
+  if (device == "kokkos") {
+    return "aijkokkos";
+  }
+
+  if (device == "none") {
+    return MATAIJ;
+  }
+
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "invalid stress_balance.ssa.fd.device: '%s'", device.c_str());
+}
+
+//! Copy values of `source` to `destination` (vectors with the same layout but possibly
+//! different types).
+static void copy_values(Vec source, Vec destination) {
+  PetscInt n_source = 0, n_destination = 0;
+
+  PetscErrorCode ierr = VecGetLocalSize(source, &n_source);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  ierr = VecGetLocalSize(destination, &n_destination);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  if (n_source != n_destination) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "vector sizes do not match (%d and %d)",
+                                  (int)n_source, (int)n_destination);
+  }
+
+  petsc::VecArray S(source), D(destination);
+  std::copy(S.get(), S.get() + n_source, D.get());
+}
+
 /*!
 Because the FD implementation of the SSA uses Picard iteration, a PETSc KSP
 and Mat are used directly.  In particular we set up \f$A\f$
@@ -95,6 +148,17 @@ SSAFD::SSAFD(IceGrid::ConstPtr g)
 
   m_scaling = 1.0e9;  // comparable to typical beta for an ice stream;
 
+  m_row_offsets_computed = false;
+
+  m_subdomain_frozen       = false;
+  m_frozen_rows_assembled  = false;
+  if (m_config->get_flag("stress_balance.ssa.fd.local_convergence")) {
+    m_nuH_frozen.create(m_grid, "nuH_frozen", WITHOUT_GHOSTS);
+    m_nuH_frozen.set_attrs("internal",
+                           "ice thickness times effective viscosity (frozen)",
+                           "Pa s m", "Pa s m", "", 0);
+  }
+
   // The nuH viewer:
   m_view_nuh = false;
   m_nuh_viewer_size = 300;
@@ -102,12 +166,31 @@ SSAFD::SSAFD(IceGrid::ConstPtr g)
   // PETSc objects and settings
   {
     PetscErrorCode ierr;
-    ierr = DMSetMatType(*m_da, MATAIJ);
+    const std::string device = m_config->get_string("stress_balance.ssa.fd.device");
+    m_use_device = (device != "none");
+
+    ierr = DMSetMatType(*m_da, device_matrix_type(device).c_str());
     PISM_CHK(ierr, "DMSetMatType");
 
     ierr = DMCreateMatrix(*m_da, m_A.rawptr());
     PISM_CHK(ierr, "DMCreateMatrix");
 
+    if (m_use_device) {
+      // other users of this DM expect host matrices
+      ierr = DMSetMatType(*m_da, MATAIJ);
+      PISM_CHK(ierr, "DMSetMatType");
+
+      // vectors of the type matching the matrix type
+      ierr = MatCreateVecs(m_A, m_x_device.rawptr(), m_b_device.rawptr());
+      PISM_CHK(ierr, "MatCreateVecs");
+
+      if (m_config->get_flag("stress_balance.ssa.fd.mixed_precision.enabled")) {
+        throw RuntimeError(PISM_ERROR_LOCATION,
+                           "stress_balance.ssa.fd.mixed_precision.enabled"
+                           " is not supported with stress_balance.ssa.fd.device");
+      }
+    }
+
     ierr = KSPCreate(m_grid->com, m_KSP.rawptr());
     PISM_CHK(ierr, "KSPCreate");
 
@@ -122,6 +205,22 @@ SSAFD::SSAFD(IceGrid::ConstPtr g)
     // Use the initial residual norm.
     ierr = KSPConvergedDefaultSetUIRNorm(m_KSP);
     PISM_CHK(ierr, "KSPConvergedDefaultSetUIRNorm");
+
+    if (m_config->get_flag("stress_balance.ssa.fd.mixed_precision.enabled")) {
+      const PetscInt n_local = 2 * m_grid->xm() * m_grid->ym();
+
+      ierr = MatCreateShell(m_grid->com, n_local, n_local, PETSC_DETERMINE, PETSC_DETERMINE,
+                            this, m_A_single_shell.rawptr());
+      PISM_CHK(ierr, "MatCreateShell");
+
+      ierr = MatShellSetOperation(m_A_single_shell, MATOP_MULT,
+                                  (void(*)(void))single_precision_mult_callback);
+      PISM_CHK(ierr, "MatShellSetOperation");
+
+      m_single_input.create(m_grid, "single_precision_input", WITH_GHOSTS, 1);
+      m_refinement_residual.create(m_grid, "refinement_residual", WITHOUT_GHOSTS);
+      m_refinement_correction.create(m_grid, "refinement_correction", WITHOUT_GHOSTS);
+    }
   }
 }
 
@@ -207,6 +306,103 @@ void SSAFD::pc_setup_asm() {
   PISM_CHK(ierr, "KSPSetFromOptions");
 }
 
+/*!
+ * Set up a multigrid preconditioner: algebraic (`type == "gamg"`) or geometric (`type ==
+ * "mg"`).
+ *
+ * The geometric version uses the hierarchy of DMDAs obtained by coarsening the SSA DM
+ * (`stress_balance.ssa.fd.mg.levels` levels). Coarse grid operators are computed by the
+ * Galerkin process (@f$ R A P @f$) from the assembled matrix, so they include Dirichlet,
+ * ice-free and calving front rows without re-assembling the SSA system on coarse grids.
+ *
+ * @note Uses `PetscErrorCode` *intentionally*.
+ */
+void SSAFD::pc_setup_multigrid(const std::string &type) {
+  PetscErrorCode ierr;
+  PC pc;
+
+  ierr = KSPSetType(m_KSP, KSPGMRES);
+  PISM_CHK(ierr, "KSPSetType");
+
+  ierr = KSPSetOperators(m_KSP, m_A, m_A);
+  PISM_CHK(ierr, "KSPSetOperators");
+
+  ierr = KSPGetPC(m_KSP, &pc);
+  PISM_CHK(ierr, "KSPGetPC");
+
+  if (type == "gamg") {
+    ierr = PCSetType(pc, PCGAMG);
+    PISM_CHK(ierr, "PCSetType");
+  } else if (type == "mg") {
+    const int n_levels = m_config->get_number("stress_balance.ssa.fd.mg.levels");
+
+    if (n_levels < 2) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "stress_balance.ssa.fd.mg.levels has to be at least 2 (got %d)",
+                                    n_levels);
+    }
+
+    // The grid is periodic, so coarsening by 2 requires even numbers of points. Each
+    // sub-domain of the coarsest grid has to be at least as wide as the stencil.
+    {
+      const int factor = 1 << (n_levels - 1);
+
+      PetscInt stencil_width = 1;
+      ierr = DMDAGetInfo(*m_da,
+                         NULL,         // dimensions
+                         NULL, NULL, NULL, // M, N, P
+                         NULL, NULL, NULL, // m, n, p
+                         NULL,             // dof
+                         &stencil_width,
+                         NULL, NULL, NULL, // boundary types
+                         NULL);            // stencil type
+      PISM_CHK(ierr, "DMDAGetInfo");
+
+      int too_small = (m_grid->xm() / factor < stencil_width or
+                       m_grid->ym() / factor < stencil_width) ? 1 : 0;
+      too_small = GlobalSum(m_grid->com, too_small);
+
+      if (m_grid->Mx() % factor != 0 or m_grid->My() % factor != 0 or too_small > 0) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "cannot use %d multigrid levels with a %d x %d grid;\n"
+                                      "Mx and My have to be divisible by %d and each"
+                                      " sub-domain has to contain at least %d x %d points",
+                                      n_levels, (int)m_grid->Mx(), (int)m_grid->My(),
+                                      factor, (int)(factor * stencil_width),
+                                      (int)(factor * stencil_width));
+      }
+    }
+
+    // PCMG gets the grid hierarchy from the DM, but the KSP should use the matrix
+    // assembled by assemble_matrix().
+    ierr = KSPSetDM(m_KSP, *m_da);
+    PISM_CHK(ierr, "KSPSetDM");
+
+    ierr = KSPSetDMActive(m_KSP, PETSC_FALSE);
+    PISM_CHK(ierr, "KSPSetDMActive");
+
+    ierr = PCSetType(pc, PCMG);
+    PISM_CHK(ierr, "PCSetType");
+
+    ierr = PCMGSetLevels(pc, n_levels, NULL);
+    PISM_CHK(ierr, "PCMGSetLevels");
+
+#if PETSC_VERSION_GE(3,8,0)
+    ierr = PCMGSetGalerkin(pc, PC_MG_GALERKIN_BOTH);
+#else
+    ierr = PCMGSetGalerkin(pc, PETSC_TRUE);
+#endif
+    PISM_CHK(ierr, "PCMGSetGalerkin");
+  } else {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid multigrid preconditioner type: %s", type.c_str());
+  }
+
+  // Process options:
+  ierr = KSPSetFromOptions(m_KSP);
+  PISM_CHK(ierr, "KSPSetFromOptions");
+}
+
 void SSAFD::init_impl() {
   SSA::init_impl();
 
@@ -489,6 +685,10 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
                             bool include_basal_shear, Mat A) {
   PetscErrorCode ierr = 0;
 
+  const Profiling &profiling = m_grid->ctx()->profiling();
+  const int region = profiling.region("ssa.assemble_matrix");
+  Profiling::Scope scope(profiling, region);
+
   // shortcut:
   const IceModelVec2V &vel = m_velocity;
 
@@ -512,8 +712,36 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
   // FIXME: bedrock_boundary is a misleading name
   const bool bedrock_boundary = m_config->get_flag("stress_balance.ssa.dirichlet_bc");
 
-  ierr = MatZeroEntries(A);
-  PISM_CHK(ierr, "MatZeroEntries");
+  const bool in_place_assembly_requested =
+    m_config->get_flag("stress_balance.ssa.fd.in_place_assembly") and A == m_A;
+
+  // In-place assembly sets all coefficients in all rows, so we don't need to zero them
+  // first. Note that the first assembly uses MatSetValuesStencil() to fill in the
+  // non-zero structure.
+  const bool in_place_assembly = in_place_assembly_requested and not m_row_offsets.empty();
+
+  // Rows in a sub-domain where nuH is frozen (see freeze_converged_subdomain()) do not
+  // change once they are assembled using frozen values: keep them.
+  const bool keep_rows = in_place_assembly and m_frozen_rows_assembled;
+
+  if (not in_place_assembly) {
+    ierr = MatZeroEntries(A);
+    PISM_CHK(ierr, "MatZeroEntries");
+  }
+
+  // Sets the diagonal entries of both rows corresponding to (i, j) to m_scaling (and all
+  // other entries to zero).
+  auto set_diagonal_entries = [&](int i, int j) {
+    if (in_place_assembly) {
+      double diagonal1[18] = {0.0}, diagonal2[18] = {0.0};
+      diagonal1[4]  = m_scaling;
+      diagonal2[13] = m_scaling;
+      set_matrix_rows(A, i, j, diagonal1, diagonal2);
+    } else {
+      set_diagonal_matrix_entry(A, i, j, 0, m_scaling);
+      set_diagonal_matrix_entry(A, i, j, 1, m_scaling);
+    }
+  };
 
   IceModelVec::AccessList list{&m_nuH, &tauc, &vel, &m_mask, &bed, &surface};
 
@@ -535,17 +763,31 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
   double lateral_drag_viscosity=m_config->get_number("stress_balance.ssa.fd.lateral_drag.viscosity");
   double HminFrozen=0.0;
 
+  // basal drag coefficients in the sub-domain owned by this process, computed one row at
+  // a time (see IceBasalResistancePlasticLaw::drag_n())
+  const int
+    xs = m_grid->xs(),
+    xm = m_grid->xm(),
+    ys = m_grid->ys(),
+    ym = m_grid->ym();
+  std::vector<double> basal_drag;
+  if (include_basal_shear and not keep_rows) {
+    basal_drag.resize(xm * ym);
+    for (int j = ys; j < ys + ym; ++j) {
+      m_basal_sliding_law->drag_n(&tauc(xs, j), &vel(xs, j), xm, &basal_drag[(j - ys) * xm]);
+    }
+  }
+
   /* matrix assembly loop */
   ParallelSection loop(m_grid->com);
   try {
-    for (Points p(*m_grid); p; p.next()) {
+    for (Points p(*m_grid); p and not keep_rows; p.next()) {
       const int i = p.i(), j = p.j();
 
       // Handle the easy case: provided Dirichlet boundary conditions
       if (inputs.bc_values && inputs.bc_mask && inputs.bc_mask->as_int(i,j) == 1) {
         // set diagonal entry to one (scaled); RHS entry will be known velocity;
-        set_diagonal_matrix_entry(A, i, j, 0, m_scaling);
-        set_diagonal_matrix_entry(A, i, j, 1, m_scaling);
+        set_diagonal_entries(i, j);
         continue;
       }
 
@@ -622,8 +864,7 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
         // at both ice/ice-free-ocean and ice/ice-free-bedrock interfaces below
         // to be consistent.
         if (ice_free(M.ij)) {
-          set_diagonal_matrix_entry(A, i, j, 0, m_scaling);
-          set_diagonal_matrix_entry(A, i, j, 1, m_scaling);
+          set_diagonal_entries(i, j);
           continue;
         }
 
@@ -753,8 +994,9 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
       double beta_u = 0.0, beta_v = 0.0;
       if (include_basal_shear) {
         double beta = 0.0;
+        const double drag = basal_drag[(j - ys) * xm + (i - xs)];
         if (grounded_ice(M_ij)) {
-          beta = m_basal_sliding_law->drag(tauc(i,j), vel(i,j).u, vel(i,j).v);
+          beta = drag;
         } else if (ice_free_land(M_ij)) {
           // apply drag even in this case, to help with margins; note ice free
           // areas already have a strength extension
@@ -763,7 +1005,7 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
         if (sub_gl) {
           // reduce the basal drag at grid cells that are partially grounded:
           if (icy(M_ij)) {
-            beta = grounded_fraction(i,j) * m_basal_sliding_law->drag(tauc(i,j), vel(i,j).u, vel(i,j).v);
+            beta = grounded_fraction(i,j) * drag;
           }
         }
         beta_u = beta;
@@ -812,6 +1054,11 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
         }
       }
 
+      if (in_place_assembly) {
+        set_matrix_rows(A, i, j, eq1, eq2);
+        continue;
+      }
+
       row.i = i;
       row.j = j;
       for (int m = 0; m < n_nonzeros; m++) {
@@ -835,11 +1082,24 @@ void SSAFD::assemble_matrix(const Inputs &inputs,
   }
   loop.check();
 
+  // Approximate work per grid point: about 120 flops computing stencil coefficients,
+  // reading 16 2D values and writing two rows of 18 coefficients.
+  if (not keep_rows) {
+    const double points = xm * ym;
+    profiling.add_work(region, 120.0 * points, 8.0 * (16 + 2 * 18) * points);
+  }
+
   ierr = MatAssemblyBegin(A, MAT_FINAL_ASSEMBLY);
   PISM_CHK(ierr, "MatAssemblyBegin");
 
   ierr = MatAssemblyEnd(A, MAT_FINAL_ASSEMBLY);
   PISM_CHK(ierr, "MatAssemblyEnd");
+
+  if (in_place_assembly_requested and not m_row_offsets_computed) {
+    compute_row_offsets(A);
+  }
+
+  m_frozen_rows_assembled = in_place_assembly and m_subdomain_frozen;
 #if (Pism_DEBUG==1)
   ierr = MatSetOption(A,MAT_NEW_NONZERO_LOCATION_ERR,PETSC_TRUE);
   PISM_CHK(ierr, "MatSetOption");
@@ -955,15 +1215,69 @@ void SSAFD::solve(const Inputs &inputs) {
   }
 }
 
+/*!
+ * Compute the norm of the residual @f$ A(u) u - b @f$ of the linear system at the first
+ * Picard iteration, using the current velocity @f$ u @f$.
+ */
+double SSAFD::initial_guess_residual(const Inputs &inputs) {
+  PetscErrorCode ierr;
+
+  const double nuH_regularization = m_config->get_number("stress_balance.ssa.epsilon");
+
+  assemble_rhs(inputs);
+  compute_hardav_staggered(inputs);
+
+  if (m_config->get_flag("stress_balance.calving_front_stress_bc")) {
+    compute_nuH_staggered_cfbc(*inputs.geometry, nuH_regularization, m_nuH);
+  } else {
+    compute_nuH_staggered(*inputs.geometry, nuH_regularization, m_nuH);
+  }
+
+  assemble_matrix(inputs, true, m_A);
+
+  m_velocity_global.copy_from(m_velocity);
+
+  IceModelVec2V residual(m_grid, "residual", WITHOUT_GHOSTS);
+
+  multiply(m_velocity_global.vec(), residual.vec());
+
+  ierr = VecAXPY(residual.vec(), -1.0, m_b.vec());
+  PISM_CHK(ierr, "VecAXPY");
+
+  double result = 0.0;
+  ierr = VecNorm(residual.vec(), NORM_2, &result);
+  PISM_CHK(ierr, "VecNorm");
+
+  return result;
+}
+
+//! Norm of the right hand side of the SSA system.
+double SSAFD::zero_velocity_residual(const Inputs &inputs) {
+  assemble_rhs(inputs);
+
+  double result = 0.0;
+  PetscErrorCode ierr = VecNorm(m_b.vec(), NORM_2, &result);
+  PISM_CHK(ierr, "VecNorm");
+
+  return result;
+}
+
 void SSAFD::picard_iteration(const Inputs &inputs,
                              double nuH_regularization,
                              double nuH_iter_failure_underrelax) {
 
-  if (m_default_pc_failure_count < m_default_pc_failure_max_count) {
-    // Give BJACOBI another shot if we haven't tried it enough yet
+  const std::string preconditioner = m_config->get_string("stress_balance.ssa.fd.preconditioner");
+
+  if (preconditioner != "asm" and
+      m_default_pc_failure_count < m_default_pc_failure_max_count) {
+    // Give the chosen preconditioner another shot if we haven't tried it enough yet
 
     try {
-      pc_setup_bjacobi();
+      if (preconditioner == "bjacobi") {
+        pc_setup_bjacobi();
+      } else {
+        pc_setup_multigrid(preconditioner);
+      }
       picard_manager(inputs, nuH_regularization,
                      nuH_iter_failure_underrelax);
 
@@ -991,7 +1305,64 @@ void SSAFD::picard_iteration(const Inputs &inputs,
   }
 }
 
+namespace {
+
+//! Saves tolerances of a KSP and restores them when it goes out of scope.
+class KSPTolerances {
+public:
+  KSPTolerances(::KSP ksp)
+    : m_ksp(ksp) {
+    PetscErrorCode ierr = KSPGetTolerances(m_ksp, &m_rtol, &m_abstol, &m_dtol, &m_max_it);
+    PISM_CHK(ierr, "KSPGetTolerances");
+  }
+
+  ~KSPTolerances() {
+    // errors are ignored: don't throw from a destructor
+    KSPSetTolerances(m_ksp, m_rtol, m_abstol, m_dtol, m_max_it);
+  }
+
+  //! The saved relative tolerance.
+  double rtol() const {
+    return m_rtol;
+  }
+
+  void set_rtol(double rtol) {
+    PetscErrorCode ierr = KSPSetTolerances(m_ksp, rtol, m_abstol, m_dtol, m_max_it);
+    PISM_CHK(ierr, "KSPSetTolerances");
+  }
+private:
+  ::KSP m_ksp;
+  PetscReal m_rtol, m_abstol, m_dtol;
+  PetscInt m_max_it;
+};
+
+//! Sets flags to `false` when it goes out of scope.
+class ResetFlags {
+public:
+  ResetFlags(std::initializer_list<bool*> flags)
+    : m_flags(flags) {
+    for (auto f : m_flags) {
+      *f = false;
+    }
+  }
+
+  ~ResetFlags() {
+    for (auto f : m_flags) {
+      *f = false;
+    }
+  }
+private:
+  std::vector<bool*> m_flags;
+};
+
+} // end of anonymous namespace
+
 //! \brief Manages the Picard iteration loop.
+/*!
+ * With stress_balance.ssa.fd.inexact_picard.enabled the relative tolerance of a linear
+ * solve is proportional to the relative change in nuH during the previous iteration, so
+ * early (inaccurate) Picard iterations use cheaper linear solves.
+ */
 void SSAFD::picard_manager(const Inputs &inputs,
                            double nuH_regularization,
                            double nuH_iter_failure_underrelax) {
@@ -1004,7 +1375,11 @@ void SSAFD::picard_manager(const Inputs &inputs,
 
   unsigned int max_iterations = static_cast<int>(m_config->get_number("stress_balance.ssa.fd.max_iterations"));
   double ssa_relative_tolerance = m_config->get_number("stress_balance.ssa.fd.relative_convergence");
+  double pc_lag_threshold = m_config->get_number("stress_balance.ssa.fd.preconditioner_lag_threshold");
+  const bool mixed_precision = m_config->get_flag("stress_balance.ssa.fd.mixed_precision.enabled");
   char tempstr[100] = "";
+  // number of iterations that used Anderson acceleration
+  int accelerated_iterations = 0;
   bool verbose = m_log->get_threshold() >= 2,
     very_verbose = m_log->get_threshold() > 2;
 
@@ -1022,6 +1397,34 @@ void SSAFD::picard_manager(const Inputs &inputs,
   }
   update_nuH_viewers();
 
+  // sum of relative changes of nuH since the preconditioner was built (an upper bound
+  // of the relative change)
+  double nuH_change_since_pc_setup = 0.0;
+
+  const bool inexact = m_config->get_flag("stress_balance.ssa.fd.inexact_picard.enabled");
+  const double
+    inexact_factor   = m_config->get_number("stress_balance.ssa.fd.inexact_picard.factor"),
+    inexact_max_rtol = m_config->get_number("stress_balance.ssa.fd.inexact_picard.max_rtol");
+
+  // restores the KSP tolerance on return
+  KSPTolerances ksp_tolerances(m_KSP);
+
+  // Freeze nuH in sub-domains where it converged (see freeze_converged_subdomain()). Flags
+  // are reset on return.
+  const bool local_convergence = m_config->get_flag("stress_balance.ssa.fd.local_convergence");
+  ResetFlags reset_flags{&m_subdomain_frozen, &m_frozen_rows_assembled};
+
+  std::unique_ptr<AndersonMixing> anderson;
+  if (m_config->get_flag("stress_balance.ssa.fd.anderson.enabled")) {
+    int depth = m_config->get_number("stress_balance.ssa.fd.anderson.depth");
+    if (depth < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "stress_balance.ssa.fd.anderson.depth has to be positive (got %d)",
+                                    depth);
+    }
+    anderson.reset(new AndersonMixing(m_grid->com, depth));
+  }
+
   // outer loop
   for (unsigned int k = 0; k < max_iterations; ++k) {
 
@@ -1045,12 +1448,45 @@ void SSAFD::picard_manager(const Inputs &inputs,
     ierr = KSPSetOperators(m_KSP, m_A, m_A);
     PISM_CHK(ierr, "KSPSetOperator");
 
-    ierr = KSPSolve(m_KSP, m_b.vec(), m_velocity_global.vec());
-    PISM_CHK(ierr, "KSPSolve");
+    // Re-use the preconditioner built during an earlier iteration if nuH did not change
+    // much since then. Always re-build it during the first iteration.
+    {
+      bool reuse_pc = k > 0 and nuH_change_since_pc_setup < pc_lag_threshold;
+
+      ierr = KSPSetReusePreconditioner(m_KSP, reuse_pc ? PETSC_TRUE : PETSC_FALSE);
+      PISM_CHK(ierr, "KSPSetReusePreconditioner");
+
+      if (not reuse_pc) {
+        nuH_change_since_pc_setup = 0.0;
+      }
+
+      if (very_verbose and reuse_pc) {
+        m_stdout_ssa += "(PC re-used)";
+      }
+    }
+
+    if (inexact) {
+      double rtol = inexact_max_rtol;
+      if (k > 0) {
+        // relative change in nuH during the previous iteration
+        rtol = std::min(inexact_factor * m_solver_stats.residuals.back(), inexact_max_rtol);
+      }
+      ksp_tolerances.set_rtol(std::max(rtol, ksp_tolerances.rtol()));
+    }
+
+    if (mixed_precision) {
+      solve_mixed_precision(reason, ksp_iterations);
+    } else {
+      ksp_solve(m_b.vec(), m_velocity_global.vec());
+
+      ierr = KSPGetConvergedReason(m_KSP, &reason);
+      PISM_CHK(ierr, "KSPGetConvergedReason");
+
+      ierr = KSPGetIterationNumber(m_KSP, &ksp_iterations);
+      PISM_CHK(ierr, "KSPGetIterationNumber");
+    }
 
     // Check if diverged; report to standard out about iteration
-    ierr = KSPGetConvergedReason(m_KSP, &reason);
-    PISM_CHK(ierr, "KSPGetConvergedReason");
 
     if (reason < 0) {
       // KSP diverged
@@ -1066,10 +1502,8 @@ void SSAFD::picard_manager(const Inputs &inputs,
     }
 
     // report on KSP success; the "inner" iteration is done
-    ierr = KSPGetIterationNumber(m_KSP, &ksp_iterations);
-    PISM_CHK(ierr, "KSPGetIterationNumber");
-
     ksp_iterations_total += ksp_iterations;
+    m_solver_stats.linear_iterations += ksp_iterations;
 
     if (very_verbose) {
       snprintf(tempstr, 100, "S:%d,%d: ", (int)ksp_iterations, reason);
@@ -1117,8 +1551,21 @@ void SSAFD::picard_manager(const Inputs &inputs,
       m_nuH.scale(nuH_iter_failure_underrelax);
       m_nuH.add(1.0 - nuH_iter_failure_underrelax, m_nuH_old);
     }
+
+    if (local_convergence) {
+      restore_frozen_nuH();
+    }
+
     compute_nuH_norm(nuH_norm, nuH_norm_change);
 
+    if (local_convergence) {
+      freeze_converged_subdomain(ssa_relative_tolerance);
+    }
+
+    if (nuH_norm > 0.0) {
+      nuH_change_since_pc_setup += nuH_norm_change / nuH_norm;
+    }
+
     update_nuH_viewers();
 
     if (very_verbose) {
@@ -1127,6 +1574,13 @@ void SSAFD::picard_manager(const Inputs &inputs,
 
       m_stdout_ssa += tempstr;
 
+      if (local_convergence) {
+        int n_frozen = GlobalSum(m_grid->com, m_subdomain_frozen ? 1 : 0);
+        snprintf(tempstr, 100, "      nuH frozen in %d of %d sub-domains\n",
+                 n_frozen, (int)m_grid->size());
+        m_stdout_ssa += tempstr;
+      }
+
       // assume that high verbosity shows interest in immediate
       // feedback about SSA iterations
       m_log->message(2, m_stdout_ssa);
@@ -1135,11 +1589,27 @@ void SSAFD::picard_manager(const Inputs &inputs,
     }
 
     outer_iterations = k + 1;
+    m_solver_stats.nonlinear_iterations += 1;
+    m_solver_stats.residuals.push_back(nuH_norm > 0.0 ? nuH_norm_change / nuH_norm : 0.0);
 
     if (nuH_norm == 0 || nuH_norm_change / nuH_norm < ssa_relative_tolerance) {
       goto done;
     }
 
+    if (anderson and anderson_step(*anderson)) {
+      accelerated_iterations += 1;
+
+      if (local_convergence) {
+        restore_frozen_nuH();
+      }
+
+      if (very_verbose) {
+        snprintf(tempstr, 100, "      Anderson acceleration using %d previous iterates\n",
+                 (int)anderson->history_size());
+        m_log->message(2, tempstr);
+      }
+    }
+
   } // outer loop (k)
 
   // If we're here, it means that we exceeded max_iterations and still
@@ -1164,12 +1634,147 @@ void SSAFD::picard_manager(const Inputs &inputs,
     m_stdout_ssa += tempstr;
   }
 
+  if (verbose and anderson) {
+    snprintf(tempstr, 100, "       (%d of them accelerated)\n", accelerated_iterations);
+
+    m_stdout_ssa += tempstr;
+  }
+
   if (verbose) {
     m_stdout_ssa = "  SSA: " + m_stdout_ssa;
   }
 }
 
+/*!
+ * Replace `m_nuH` (the result of a Picard iteration) with the Anderson-accelerated
+ * iterate.
+ *
+ * Uses `m_nuH_old`, which contains the difference of nuH from the previous iterate and
+ * m_nuH after compute_nuH_norm().
+ *
+ * Keeps the Picard iterate (and discards the history) if the accelerated one is not
+ * positive everywhere.
+ *
+ * Returns `true` if `m_nuH` was modified.
+ */
+bool SSAFD::anderson_step(AndersonMixing &anderson) {
+
+  const int N = 2 * m_grid->xm() * m_grid->ym();
+  std::vector<double> f(N), g(N);
+
+  IceModelVec::AccessList list{&m_nuH, &m_nuH_old};
+
+  int n = 0;
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    for (int c = 0; c < 2; ++c) {
+      g[n] = m_nuH(i, j, c);
+      f[n] = - m_nuH_old(i, j, c);
+      ++n;
+    }
+  }
+
+  if (not anderson.update(f, g)) {
+    return false;
+  }
+
+  double min_nuH = g.empty() ? 1.0 : *std::min_element(g.begin(), g.end());
+  min_nuH = GlobalMin(m_grid->com, min_nuH);
+
+  if (not (min_nuH > 0.0)) {
+    anderson.reset();
+    return false;
+  }
+
+  n = 0;
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    for (int c = 0; c < 2; ++c) {
+      m_nuH(i, j, c) = g[n];
+      ++n;
+    }
+  }
+
+  m_nuH.update_ghosts();
+
+  return true;
+}
+
 //! Old SSAFD recovery strategy: increase the SSA regularization parameter.
+/*!
+ * Freeze nuH in the sub-domain owned by this process if its relative change during the
+ * last Picard iteration is below `tolerance`.
+ *
+ * Uses `m_nuH_old`, which contains the change in nuH after compute_nuH_norm().
+ *
+ * Frozen nuH is not updated during the rest of the current Picard iteration, so the
+ * global change in nuH (used to test convergence) is determined by sub-domains that did
+ * not converge yet, usually near shear margins and grounding lines. If
+ * `stress_balance.ssa.fd.in_place_assembly` is set, matrix rows in frozen sub-domains are
+ * assembled once more (using frozen nuH) and then re-used (see assemble_matrix()). Note
+ * that this also freezes basal drag in these rows.
+ */
+void SSAFD::freeze_converged_subdomain(double tolerance) {
+  if (m_subdomain_frozen) {
+    return;
+  }
+
+  double change[2] = {0.0, 0.0}, norm[2] = {0.0, 0.0};
+  {
+    IceModelVec::AccessList list{&m_nuH, &m_nuH_old};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      for (int c = 0; c < 2; ++c) {
+        change[c] += fabs(m_nuH_old(i, j, c));
+        norm[c]   += fabs(m_nuH(i, j, c));
+      }
+    }
+  }
+
+  // the same norm as in compute_nuH_norm(), restricted to this sub-domain
+  const double
+    local_change = sqrt(PetscSqr(change[0]) + PetscSqr(change[1])),
+    local_norm   = sqrt(PetscSqr(norm[0]) + PetscSqr(norm[1]));
+
+  if (local_norm > 0.0 and local_change / local_norm < tolerance) {
+    IceModelVec::AccessList list{&m_nuH, &m_nuH_frozen};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_nuH_frozen(i, j, 0) = m_nuH(i, j, 0);
+      m_nuH_frozen(i, j, 1) = m_nuH(i, j, 1);
+    }
+
+    m_subdomain_frozen = true;
+  }
+}
+
+/*!
+ * Replace nuH in the frozen sub-domain owned by this process (if any) with frozen values
+ * and update ghosts.
+ *
+ * Has to be called by all processes.
+ */
+void SSAFD::restore_frozen_nuH() {
+  if (m_subdomain_frozen) {
+    IceModelVec::AccessList list{&m_nuH, &m_nuH_frozen};
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      m_nuH(i, j, 0) = m_nuH_frozen(i, j, 0);
+      m_nuH(i, j, 1) = m_nuH_frozen(i, j, 1);
+    }
+  }
+
+  m_nuH.update_ghosts();
+}
+
 void SSAFD::picard_strategy_regularization(const Inputs &inputs) {
   // this has no units; epsilon goes up by this ratio when previous value failed
   const double DEFAULT_EPSILON_MULTIPLIER_SSA = 4.0;
@@ -1677,6 +2282,400 @@ void SSAFD::set_diagonal_matrix_entry(Mat A, int i, int j, int component,
   PISM_CHK(ierr, "MatSetValuesStencil");
 }
 
+/*!
+ * Find positions of coefficients of rows of `A` (in the order used by assemble_matrix())
+ * in the storage of these rows, as needed by MatSetValuesRow().
+ *
+ * The non-zero structure of the SSAFD matrix is determined by the DMDA (all 18 entries
+ * of each row are stored, even if some are zero) and does not depend on the cell type
+ * mask, so this has to be done only once, after the first assembly.
+ *
+ * Leaves m_row_offsets empty (i.e. disables in-place assembly) if `A` is not an AIJ
+ * matrix or if some rows don't have 18 distinct entries (this happens on grids with
+ * fewer than 3 points in a direction).
+ */
+void SSAFD::compute_row_offsets(Mat A) {
+  PetscErrorCode ierr;
+
+  const int n_nonzeros = 18, dof = 2;
+
+  m_row_offsets_computed = true;
+  m_matrix_rows.clear();
+  m_row_offsets.clear();
+
+  PetscBool aij = PETSC_FALSE;
+  ierr = PetscObjectTypeCompareAny((PetscObject)A, &aij, MATSEQAIJ, MATMPIAIJ, "");
+  PISM_CHK(ierr, "PetscObjectTypeCompareAny");
+
+  ISLocalToGlobalMapping ltog;
+  ierr = DMGetLocalToGlobalMapping(*m_da, &ltog);
+  PISM_CHK(ierr, "DMGetLocalToGlobalMapping");
+
+  PetscInt gxs, gys, gxm, gym;
+  ierr = DMDAGetGhostCorners(*m_da, &gxs, &gys, NULL, &gxm, &gym, NULL);
+  PISM_CHK(ierr, "DMDAGetGhostCorners");
+
+  // Offsets of column indices, in the same order as in assemble_matrix().
+  const int
+    dI[] = {-1, 0, 1, -1, 0, 1, -1,  0,  1, -1, 0, 1, -1, 0, 1, -1,  0,  1},
+    dJ[] = { 1, 1, 1,  0, 0, 0, -1, -1, -1,  1, 1, 1,  0, 0, 0, -1, -1, -1},
+    C[]  = { 0, 0, 0,  0, 0, 0,  0,  0,  0,  1, 1, 1,  1, 1, 1,  1,  1,  1};
+
+  // local (ghosted) index of the component c at (i, j)
+  auto local_index = [=](int i, int j, int c) {
+    return ((j - gys) * gxm + (i - gxs)) * dof + c;
+  };
+
+  const int N = m_grid->xm() * m_grid->ym();
+  std::vector<PetscInt> rows(dof * N), offsets(dof * N * n_nonzeros);
+
+  int failures = aij ? 0 : 1;
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (failures > 0) {
+      break;
+    }
+
+    const int n = (j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs());
+
+    for (int c = 0; c < dof; ++c) {
+      // the row index followed by column indices
+      PetscInt local[n_nonzeros + 1], global[n_nonzeros + 1];
+
+      local[0] = local_index(i, j, c);
+      for (int m = 0; m < n_nonzeros; ++m) {
+        local[m + 1] = local_index(i + dI[m], j + dJ[m], C[m]);
+      }
+
+      ierr = ISLocalToGlobalMappingApply(ltog, n_nonzeros + 1, local, global);
+      PISM_CHK(ierr, "ISLocalToGlobalMappingApply");
+
+      const int r = dof * n + c;
+      rows[r] = global[0];
+
+      PetscInt n_columns = 0;
+      const PetscInt *columns = NULL;
+      ierr = MatGetRow(A, global[0], &n_columns, &columns, NULL);
+      PISM_CHK(ierr, "MatGetRow");
+
+      if (n_columns != n_nonzeros) {
+        failures += 1;
+      } else {
+        // a column may appear in the stencil only once
+        bool used[n_nonzeros] = {false};
+
+        for (int m = 0; m < n_nonzeros; ++m) {
+          int k = 0;
+          while (k < n_columns and columns[k] != global[m + 1]) {
+            ++k;
+          }
+
+          if (k == n_columns or used[k]) {
+            failures += 1;
+            break;
+          }
+          used[k] = true;
+          offsets[r * n_nonzeros + m] = k;
+        }
+      }
+
+      ierr = MatRestoreRow(A, global[0], &n_columns, &columns, NULL);
+      PISM_CHK(ierr, "MatRestoreRow");
+    }
+  }
+
+  // Use in-place assembly on all processors or none of them. (This way all processors
+  // call MatZeroEntries() in assemble_matrix().)
+  if (GlobalSum(m_grid->com, failures) > 0) {
+    m_log->message(2,
+                   "PISM WARNING: the SSAFD matrix does not support in-place assembly;"
+                   " using MatSetValuesStencil()\n");
+    return;
+  }
+
+  m_matrix_rows = rows;
+  m_row_offsets = offsets;
+}
+
+/*!
+ * Set coefficients of both rows of `A` corresponding to the grid point (i, j), writing
+ * them directly into the storage of these rows.
+ *
+ * `eq1` and `eq2` contain 18 coefficients each, in the order used by assemble_matrix().
+ *
+ * Requires offsets computed by compute_row_offsets().
+ */
+void SSAFD::set_matrix_rows(Mat A, int i, int j,
+                            const double *eq1, const double *eq2) {
+  const int n_nonzeros = 18, dof = 2;
+  const int n = (j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs());
+
+  const double *eq[] = {eq1, eq2};
+
+  for (int c = 0; c < dof; ++c) {
+    const int r = dof * n + c;
+    const PetscInt *offsets = &m_row_offsets[r * n_nonzeros];
+
+    double values[n_nonzeros];
+    for (int m = 0; m < n_nonzeros; ++m) {
+      values[offsets[m]] = eq[c][m];
+    }
+
+    PetscErrorCode ierr = MatSetValuesRow(A, m_matrix_rows[r], values);
+    PISM_CHK(ierr, "MatSetValuesRow");
+  }
+}
+
+/*!
+ * Copy coefficients of the assembled matrix `A` to m_A_single (in single precision).
+ *
+ * Returns `false` if the structure of `A` does not match the stencil used by
+ * assemble_matrix() (see compute_row_offsets()).
+ */
+bool SSAFD::update_single_precision_matrix(Mat A) {
+  const int n_nonzeros = 18;
+
+  if (not m_row_offsets_computed) {
+    compute_row_offsets(A);
+  }
+
+  if (m_row_offsets.empty()) {
+    return false;
+  }
+
+  const int n_rows = m_matrix_rows.size();
+
+  m_A_single.resize(n_rows * n_nonzeros);
+
+  for (int r = 0; r < n_rows; ++r) {
+    const PetscInt *offsets = &m_row_offsets[r * n_nonzeros];
+
+    PetscInt n_columns = 0;
+    const PetscScalar *values = NULL;
+    PetscErrorCode ierr = MatGetRow(A, m_matrix_rows[r], &n_columns, NULL, &values);
+    PISM_CHK(ierr, "MatGetRow");
+
+    for (int m = 0; m < n_nonzeros; ++m) {
+      m_A_single[r * n_nonzeros + m] = values[offsets[m]];
+    }
+
+    ierr = MatRestoreRow(A, m_matrix_rows[r], &n_columns, NULL, &values);
+    PISM_CHK(ierr, "MatRestoreRow");
+  }
+
+  return true;
+}
+
+//! Compute `y = A x` using the single precision copy of the SSAFD matrix.
+/*!
+ * Coefficients are stored in single precision (halving the memory traffic), while
+ * products are accumulated in double precision.
+ */
+void SSAFD::multiply_single_precision(Vec x, Vec y) {
+  const int n_nonzeros = 18, dof = 2;
+
+  // Offsets of column indices, in the same order as in assemble_matrix().
+  const int
+    dI[] = {-1, 0, 1, -1, 0, 1, -1,  0,  1},
+    dJ[] = { 1, 1, 1,  0, 0, 0, -1, -1, -1};
+
+  m_single_input.copy_from_vec(x);
+
+  IceModelVec::AccessList list{&m_single_input};
+
+  petsc::VecArray y_array(y);
+  double *Y = y_array.get();
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    const int n = (j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs());
+
+    // the first 9 coefficients multiply u, the last 9 multiply v
+    Vector2 X[9];
+    for (int m = 0; m < 9; ++m) {
+      X[m] = m_single_input(i + dI[m], j + dJ[m]);
+    }
+
+    for (int c = 0; c < dof; ++c) {
+      const float *a = &m_A_single[(dof * n + c) * n_nonzeros];
+
+      double sum = 0.0;
+      for (int m = 0; m < 9; ++m) {
+        sum += a[m] * X[m].u + a[m + 9] * X[m].v;
+      }
+      Y[dof * n + c] = sum;
+    }
+  }
+}
+
+PetscErrorCode SSAFD::single_precision_mult_callback(Mat A, Vec x, Vec y) {
+  void *ctx = NULL;
+  PetscErrorCode ierr = MatShellGetContext(A, &ctx); CHKERRQ(ierr);
+  SSAFD *ssa = static_cast<SSAFD*>(ctx);
+
+  try {
+    ssa->multiply_single_precision(x, y);
+  } catch (...) {
+    MPI_Comm com = ssa->m_grid->com;
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
+//! Solve `m_A x = b` (using device vectors if m_A is a device matrix).
+void SSAFD::ksp_solve(Vec b, Vec x) {
+  PetscErrorCode ierr;
+
+  if (m_use_device) {
+    copy_values(b, m_b_device);
+    copy_values(x, m_x_device);
+
+    ierr = KSPSolve(m_KSP, m_b_device, m_x_device);
+    PISM_CHK(ierr, "KSPSolve");
+
+    copy_values(m_x_device, x);
+  } else {
+    ierr = KSPSolve(m_KSP, b, x);
+    PISM_CHK(ierr, "KSPSolve");
+  }
+}
+
+//! Compute `y = m_A x` (using device vectors if m_A is a device matrix).
+void SSAFD::multiply(Vec x, Vec y) {
+  PetscErrorCode ierr;
+
+  if (m_use_device) {
+    copy_values(x, m_x_device);
+
+    ierr = MatMult(m_A, m_x_device, m_b_device);
+    PISM_CHK(ierr, "MatMult");
+
+    copy_values(m_b_device, y);
+  } else {
+    ierr = MatMult(m_A, x, y);
+    PISM_CHK(ierr, "MatMult");
+  }
+}
+
+/*!
+ * Solve the linear system `m_A x = m_b` using iterative refinement.
+ *
+ * The outer iteration computes the residual using m_A (in double precision) and
+ * corrects the solution in m_velocity_global. Corrections are computed by the inner
+ * KSP solve that uses the single precision copy of m_A as the operator and m_A to
+ * build the preconditioner, with the relative tolerance
+ * stress_balance.ssa.fd.mixed_precision.inner_rtol.
+ *
+ * The outer iteration stops when the residual is reduced by the factor set using the
+ * KSP relative tolerance (`-ssafd_ksp_rtol`), i.e. the stopping criterion is the
+ * same as when the system is solved in double precision.
+ */
+void SSAFD::solve_mixed_precision(KSPConvergedReason &reason, PetscInt &iterations) {
+  PetscErrorCode ierr;
+
+  const double inner_rtol = m_config->get_number("stress_balance.ssa.fd.mixed_precision.inner_rtol");
+  const int max_refinements = m_config->get_number("stress_balance.ssa.fd.mixed_precision.max_refinements");
+
+  iterations = 0;
+
+  if (not update_single_precision_matrix(m_A)) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "the SSAFD matrix does not support the mixed precision mode");
+  }
+
+  PetscReal rtol, abstol, dtol;
+  PetscInt max_it;
+  ierr = KSPGetTolerances(m_KSP, &rtol, &abstol, &dtol, &max_it);
+  PISM_CHK(ierr, "KSPGetTolerances");
+
+  ierr = KSPSetOperators(m_KSP, m_A_single_shell, m_A);
+  PISM_CHK(ierr, "KSPSetOperators");
+
+  // corrections are computed starting from zero
+  ierr = KSPSetInitialGuessNonzero(m_KSP, PETSC_FALSE);
+  PISM_CHK(ierr, "KSPSetInitialGuessNonzero");
+
+  ierr = KSPSetTolerances(m_KSP, inner_rtol, abstol, dtol, max_it);
+  PISM_CHK(ierr, "KSPSetTolerances");
+
+  Vec
+    x = m_velocity_global.vec(),
+    r = m_refinement_residual.vec(),
+    d = m_refinement_correction.vec();
+
+  // r = b - A x
+  auto compute_residual = [&]() {
+    double norm = 0.0;
+
+    ierr = MatMult(m_A, x, r);
+    PISM_CHK(ierr, "MatMult");
+
+    ierr = VecAYPX(r, -1.0, m_b.vec());
+    PISM_CHK(ierr, "VecAYPX");
+
+    ierr = VecNorm(r, NORM_2, &norm);
+    PISM_CHK(ierr, "VecNorm");
+
+    return norm;
+  };
+
+  const double residual_initial = compute_residual();
+  double residual = residual_initial;
+
+  reason = KSP_DIVERGED_ITS;
+  try {
+    for (int k = 0; k < max_refinements; ++k) {
+      if (residual <= std::max(rtol * residual_initial, abstol)) {
+        reason = KSP_CONVERGED_RTOL;
+        break;
+      }
+
+      ierr = KSPSolve(m_KSP, r, d);
+      PISM_CHK(ierr, "KSPSolve");
+
+      KSPConvergedReason inner_reason;
+      ierr = KSPGetConvergedReason(m_KSP, &inner_reason);
+      PISM_CHK(ierr, "KSPGetConvergedReason");
+
+      PetscInt inner_iterations = 0;
+      ierr = KSPGetIterationNumber(m_KSP, &inner_iterations);
+      PISM_CHK(ierr, "KSPGetIterationNumber");
+      iterations += inner_iterations;
+
+      if (inner_reason < 0 and inner_reason != KSP_DIVERGED_ITS) {
+        reason = inner_reason;
+        break;
+      }
+
+      // x = x + d
+      ierr = VecAXPY(x, 1.0, d);
+      PISM_CHK(ierr, "VecAXPY");
+
+      residual = compute_residual();
+    }
+
+    if (reason == KSP_DIVERGED_ITS and
+        residual <= std::max(rtol * residual_initial, abstol)) {
+      reason = KSP_CONVERGED_RTOL;
+    }
+  } catch (...) {
+    // restore settings before re-throwing
+    KSPSetTolerances(m_KSP, rtol, abstol, dtol, max_it);
+    KSPSetInitialGuessNonzero(m_KSP, PETSC_TRUE);
+    throw;
+  }
+
+  ierr = KSPSetTolerances(m_KSP, rtol, abstol, dtol, max_it);
+  PISM_CHK(ierr, "KSPSetTolerances");
+
+  ierr = KSPSetInitialGuessNonzero(m_KSP, PETSC_TRUE);
+  PISM_CHK(ierr, "KSPSetInitialGuessNonzero");
+}
+
 //! \brief Checks if a cell is near or at the ice front.
 /*!
  * You need to create IceModelVec::AccessList object and add mask to it.
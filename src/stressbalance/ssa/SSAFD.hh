@@ -1,4 +1,4 @@
-// Copyright (C) 2004--2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004--2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -19,16 +19,21 @@
 #ifndef _SSAFD_H_
 #define _SSAFD_H_
 
+#include <vector>
+
 #include "SSA.hh"
 
 #include "pism/util/error_handling.hh"
 #include "pism/util/petscwrappers/Viewer.hh"
 #include "pism/util/petscwrappers/KSP.hh"
 #include "pism/util/petscwrappers/Mat.hh"
+#include "pism/util/petscwrappers/Vec.hh"
 
 namespace pism {
 namespace stressbalance {
 
+class AndersonMixing;
+
 //! PISM's SSA solver: the finite difference implementation.
 class SSAFD : public SSA
 {
@@ -45,9 +50,15 @@ protected:
   virtual void pc_setup_bjacobi();
 
   virtual void pc_setup_asm();
+
+  virtual void pc_setup_multigrid(const std::string &type);
   
   virtual void solve(const Inputs &inputs);
 
+  virtual double initial_guess_residual(const Inputs &inputs);
+
+  virtual double zero_velocity_residual(const Inputs &inputs);
+
   virtual void picard_iteration(const Inputs &inputs,
                                 double nuH_regularization,
                                 double nuH_iter_failure_underrelax);
@@ -71,6 +82,12 @@ protected:
   virtual void compute_nuH_norm(double &norm,
                                 double &norm_change);
 
+  bool anderson_step(AndersonMixing &anderson);
+
+  void freeze_converged_subdomain(double tolerance);
+
+  void restore_frozen_nuH();
+
   virtual void assemble_matrix(const Inputs &inputs,
                                bool include_basal_shear, Mat A);
 
@@ -83,6 +100,20 @@ protected:
   void set_diagonal_matrix_entry(Mat A, int i, int j, int component,
                                          double value);
 
+  void compute_row_offsets(Mat A);
+
+  void set_matrix_rows(Mat A, int i, int j, const double *eq1, const double *eq2);
+
+  bool update_single_precision_matrix(Mat A);
+
+  void multiply_single_precision(Vec x, Vec y);
+
+  void solve_mixed_precision(KSPConvergedReason &reason, PetscInt &iterations);
+
+  void ksp_solve(Vec b, Vec x);
+
+  void multiply(Vec x, Vec y);
+
   virtual bool is_marginal(int i, int j, bool ssa_dirichlet_bc);
 
   virtual void fracture_induced_softening(const IceModelVec2S *fracture_density);
@@ -95,8 +126,34 @@ protected:
   IceModelVec2V m_b;            // right hand side
   double m_scaling;
 
+  // Global indices of rows of m_A (two per grid point) and positions of their
+  // coefficients in the row storage. Used by set_matrix_rows(); empty unless
+  // stress_balance.ssa.fd.in_place_assembly is set.
+  std::vector<PetscInt> m_matrix_rows, m_row_offsets;
+  bool m_row_offsets_computed;
+
+  // Single precision copy of m_A (18 coefficients per row in the order used by
+  // assemble_matrix()) used by the inner solve in the mixed precision mode (see
+  // solve_mixed_precision()).
+  std::vector<float> m_A_single;
+  petsc::Mat m_A_single_shell;
+  // work space for the mixed precision mode
+  IceModelVec2V m_single_input, m_refinement_residual, m_refinement_correction;
+
+  // true if m_A is a device (GPU) matrix (see stress_balance.ssa.fd.device)
+  bool m_use_device;
+  // vectors compatible with m_A in the device mode
+  petsc::Vec m_x_device, m_b_device;
+
   IceModelVec2V m_velocity_old;
 
+  // Used if stress_balance.ssa.fd.local_convergence is set: nuH in the sub-domain owned by
+  // this process, frozen once it converged during the current Picard iteration.
+  IceModelVec2Stag m_nuH_frozen;
+  bool m_subdomain_frozen;
+  // true if matrix rows in this sub-domain were assembled using frozen nuH
+  bool m_frozen_rows_assembled;
+
   unsigned int m_default_pc_failure_count,
     m_default_pc_failure_max_count;
   
@@ -104,6 +161,8 @@ protected:
   petsc::Viewer::Ptr m_nuh_viewer;
   int m_nuh_viewer_size;
 
+  static PetscErrorCode single_precision_mult_callback(Mat A, Vec x, Vec y);
+
   class KSPFailure : public RuntimeError {
   public:
     KSPFailure(const char* reason);
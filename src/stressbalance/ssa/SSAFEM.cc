@@ -1,4 +1,4 @@
-// Copyright (C) 2009--2019 Jed Brown and Ed Bueler and Constantine Khroulev and David Maxwell
+// Copyright (C) 2009--2020 Jed Brown and Ed Bueler and Constantine Khroulev and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -16,6 +16,9 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>            // std::min
+#include <mutex>
+
 #include "pism/util/IceGrid.hh"
 #include "SSAFEM.hh"
 #include "pism/util/FETools.hh"
@@ -85,6 +88,48 @@ SSAFEM::SSAFEM(IceGrid::ConstPtr g)
   ierr = SNESSetDM(m_snes, *m_da);
   PISM_CHK(ierr, "SNESSetDM");
 
+  m_matrix_free = m_config->get_flag("stress_balance.ssa.fem.matrix_free_jacobian");
+  if (m_matrix_free) {
+    // Use a shell matrix as both the Jacobian and the preconditioning matrix. The
+    // Jacobian callback (set above) computes the linearization instead of assembling a
+    // matrix (see compute_linearization()).
+    const PetscInt n_local = 2 * m_grid->xm() * m_grid->ym();
+
+    ierr = MatCreateShell(m_grid->com, n_local, n_local, PETSC_DETERMINE, PETSC_DETERMINE,
+                          this, m_jacobian_shell.rawptr());
+    PISM_CHK(ierr, "MatCreateShell");
+
+    ierr = MatShellSetOperation(m_jacobian_shell, MATOP_MULT,
+                                (void(*)(void))jacobian_mult_callback);
+    PISM_CHK(ierr, "MatShellSetOperation");
+
+    ierr = SNESSetJacobian(m_snes, m_jacobian_shell, m_jacobian_shell, NULL, NULL);
+    PISM_CHK(ierr, "SNESSetJacobian");
+
+    // The preconditioner uses inverses of 2x2 diagonal blocks of the Jacobian.
+    KSP ksp;
+    ierr = SNESGetKSP(m_snes, &ksp);
+    PISM_CHK(ierr, "SNESGetKSP");
+
+    PC pc;
+    ierr = KSPGetPC(ksp, &pc);
+    PISM_CHK(ierr, "KSPGetPC");
+
+    ierr = PCSetType(pc, PCSHELL);
+    PISM_CHK(ierr, "PCSetType");
+
+    ierr = PCShellSetContext(pc, this);
+    PISM_CHK(ierr, "PCShellSetContext");
+
+    ierr = PCShellSetApply(pc, preconditioner_callback);
+    PISM_CHK(ierr, "PCShellSetApply");
+
+    ierr = PCShellSetName(pc, "SSAFEM point block Jacobi");
+    PISM_CHK(ierr, "PCShellSetName");
+
+    m_jacobian_input.create(m_grid, "jacobian_input", WITH_GHOSTS, 1);
+  }
+
   // Default of maximum 200 iterations; possibly overridden by command line options
   int snes_max_it = 200;
   ierr = SNESSetTolerances(m_snes, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT,
@@ -94,6 +139,19 @@ SSAFEM::SSAFEM(IceGrid::ConstPtr g)
   ierr = SNESSetFromOptions(m_snes);
   PISM_CHK(ierr, "SNESSetFromOptions");
 
+  // record residual norms (see SolverStats)
+  {
+    PetscInt max_it = 0;
+    ierr = SNESGetTolerances(m_snes, NULL, NULL, NULL, &max_it, NULL);
+    PISM_CHK(ierr, "SNESGetTolerances");
+
+    m_residual_history.resize(max_it + 1);
+
+    ierr = SNESSetConvergenceHistory(m_snes, m_residual_history.data(), NULL,
+                                     m_residual_history.size(), PETSC_TRUE);
+    PISM_CHK(ierr, "SNESSetConvergenceHistory");
+  }
+
   // Allocate m_coefficients, which contains coefficient data at the nodes of all the elements.
   m_coefficients.create(m_grid, "ssa_coefficients", WITH_GHOSTS, 1);
 
@@ -175,6 +233,50 @@ void SSAFEM::solve(const Inputs &inputs) {
   }
 }
 
+//! Compute the norm of the SNES residual corresponding to the current velocity.
+double SSAFEM::initial_guess_residual(const Inputs &inputs) {
+  PetscErrorCode ierr;
+
+  cache_inputs(inputs);
+
+  m_epsilon_ssa = m_config->get_number("stress_balance.ssa.epsilon");
+
+  m_velocity_global.copy_from(m_velocity);
+
+  IceModelVec2V residual(m_grid, "residual", WITHOUT_GHOSTS);
+
+  ierr = SNESComputeFunction(m_snes, m_velocity_global.vec(), residual.vec());
+  PISM_CHK(ierr, "SNESComputeFunction");
+
+  double result = 0.0;
+  ierr = VecNorm(residual.vec(), NORM_2, &result);
+  PISM_CHK(ierr, "VecNorm");
+
+  return result;
+}
+
+double SSAFEM::zero_velocity_residual(const Inputs &inputs) {
+  PetscErrorCode ierr;
+
+  cache_inputs(inputs);
+
+  m_epsilon_ssa = m_config->get_number("stress_balance.ssa.epsilon");
+
+  IceModelVec2V
+    zero(m_grid, "zero_velocity", WITHOUT_GHOSTS),
+    residual(m_grid, "residual", WITHOUT_GHOSTS);
+  zero.set(0.0);
+
+  ierr = SNESComputeFunction(m_snes, zero.vec(), residual.vec());
+  PISM_CHK(ierr, "SNESComputeFunction");
+
+  double result = 0.0;
+  ierr = VecNorm(residual.vec(), NORM_2, &result);
+  PISM_CHK(ierr, "VecNorm");
+
+  return result;
+}
+
 TerminationReason::Ptr SSAFEM::solve_with_reason(const Inputs &inputs) {
 
   // Set up the system to solve.
@@ -218,12 +320,38 @@ TerminationReason::Ptr SSAFEM::solve_nocache() {
   ierr = SNESSolve(m_snes, NULL, m_velocity_global.vec());
   PISM_CHK(ierr, "SNESSolve");
 
+  {
+    PetscInt nonlinear_iterations = 0, linear_iterations = 0;
+
+    ierr = SNESGetIterationNumber(m_snes, &nonlinear_iterations);
+    PISM_CHK(ierr, "SNESGetIterationNumber");
+
+    ierr = SNESGetLinearSolveIterations(m_snes, &linear_iterations);
+    PISM_CHK(ierr, "SNESGetLinearSolveIterations");
+
+    m_solver_stats.nonlinear_iterations += nonlinear_iterations;
+    m_solver_stats.linear_iterations    += linear_iterations;
+
+    PetscReal *history = NULL;
+    PetscInt history_length = 0;
+    ierr = SNESGetConvergenceHistory(m_snes, &history, NULL, &history_length);
+    PISM_CHK(ierr, "SNESGetConvergenceHistory");
+
+    m_solver_stats.residuals.insert(m_solver_stats.residuals.end(),
+                                    history, history + history_length);
+  }
+
   // See if it worked.
   SNESConvergedReason snes_reason;
   ierr = SNESGetConvergedReason(m_snes, &snes_reason); PISM_CHK(ierr, "SNESGetConvergedReason");
 
   TerminationReason::Ptr reason(new SNESTerminationReason(snes_reason));
-  if (not reason->failed()) {
+  if (reason->failed()) {
+    // Start the next solve from the last converged solution instead of the iterate of
+    // the solve that failed. (Inverse methods try other values of coefficients after a
+    // failure.)
+    m_velocity_global.copy_from(m_velocity);
+  } else {
 
     // Extract the solution back from SSAX to velocity and communicate.
     m_velocity.copy_from(m_velocity_global);
@@ -474,34 +602,23 @@ void SSAFEM::driving_stress(const fem::Quadrature &Q,
 }
 
 
-/** @brief Compute the "(regularized effective viscosity) x (ice thickness)" and effective viscous
- *  bed strength from the current solution, at a single quadrature point.
+/** @brief Compute the "(regularized effective viscosity) x (ice thickness)" from the current
+ *  solution, at a single quadrature point.
  *
  * @param[in] thickness ice thickness
  * @param[in] hardness ice hardness
- * @param[in] mask cell type mask
- * @param[in] tauc basal yield stress
- * @param[in] U the value of the solution
  * @param[in] U_x x-derivatives of velocity components
  * @param[in] U_y y-derivatives of velocity components
  * @param[out] nuH product of the ice viscosity and thickness @f$ \nu H @f$
  * @param[out] dnuH derivative of @f$ \nu H @f$ with respect to the
  *                  second invariant @f$ \gamma @f$. Set to NULL if
  *                  not desired.
- * @param[out] beta basal drag coefficient @f$ \beta @f$
- * @param[out] dbeta derivative of @f$ \beta @f$ with respect to the
- *                   second invariant @f$ \gamma @f$. Set to NULL if
- *                   not desired.
  */
-void SSAFEM::PointwiseNuHAndBeta(double thickness,
-                                 double hardness,
-                                 int mask,
-                                 double tauc,
-                                 const Vector2 &U,
-                                 const Vector2 &U_x,
-                                 const Vector2 &U_y,
-                                 double *nuH, double *dnuH,
-                                 double *beta, double *dbeta) {
+void SSAFEM::PointwiseNuH(double thickness,
+                          double hardness,
+                          const Vector2 &U_x,
+                          const Vector2 &U_y,
+                          double *nuH, double *dnuH) {
 
   if (thickness < strength_extension->get_min_thickness()) {
     *nuH = strength_extension->get_notional_strength();
@@ -518,18 +635,39 @@ void SSAFEM::PointwiseNuHAndBeta(double thickness,
       *dnuH *= thickness;
     }
   }
+}
 
-  if (mask::grounded_ice(mask)) {
-    m_basal_sliding_law->drag_with_derivative(tauc, U.u, U.v, beta, dbeta);
-  } else {
-    *beta = 0;
+/** @brief Compute the effective viscous bed strength from the current solution at all
+ *  quadrature points of an element.
+ *
+ * Evaluates the sliding law using one (virtual) call per element.
+ *
+ * @param[in] n number of quadrature points
+ * @param[in] mask cell type mask
+ * @param[in] tauc basal yield stress
+ * @param[in] U the value of the solution
+ * @param[out] beta basal drag coefficient @f$ \beta @f$
+ * @param[out] dbeta derivative of @f$ \beta @f$ with respect to the
+ *                   second invariant @f$ \gamma @f$. Set to NULL if
+ *                   not desired.
+ */
+void SSAFEM::basal_drag(unsigned int n,
+                        const int *mask,
+                        const double *tauc,
+                        const Vector2 *U,
+                        double *beta, double *dbeta) {
 
-    if (mask::ice_free_land(mask)) {
-      *beta = m_beta_ice_free_bedrock;
+  m_basal_sliding_law->drag_with_derivative_n(tauc, U, n, beta, dbeta);
+
+  for (unsigned int q = 0; q < n; ++q) {
+    if (mask::grounded_ice(mask[q])) {
+      continue;
     }
 
+    beta[q] = mask::ice_free_land(mask[q]) ? m_beta_ice_free_bedrock : 0.0;
+
     if (dbeta) {
-      *dbeta = 0;
+      dbeta[q] = 0;
     }
   }
 }
@@ -715,128 +853,178 @@ void SSAFEM::compute_local_function(Vector2 const *const *const velocity_global,
   // Start access to Dirichlet data if present.
   fem::DirichletData_Vector dirichlet_data(m_bc_mask, m_bc_values, m_dirichletScale);
 
-  // Storage for the current solution and its derivatives at quadrature points.
-  Vector2 U[Nq_max], U_x[Nq_max], U_y[Nq_max];
-
-  // Iterate over the elements.
+  // Velocity and its derivatives are evaluated at quadrature points of batches of
+  // elements in a row (see fem::BatchQuadrature).
+  const fem::BatchQuadrature batch(m_quadrature);
   const int
-    xs = m_element_index.xs,
-    xm = m_element_index.xm,
-    ys = m_element_index.ys,
-    ym = m_element_index.ym;
+    batch_size      = fem::BatchQuadrature::max_size,
+    nodal_size      = fem::BatchQuadrature::nodal_size,
+    quadrature_size = fem::BatchQuadrature::quadrature_size;
+
+  // Add contributions of elements in a tile. Tiles of the same colour do not share nodes,
+  // so different threads can process them at the same time.
+  auto assemble = [&](const Tile &tile) {
+    // Storage for the current solution and its derivatives at quadrature points.
+    Vector2 U[Nq_max], U_x[Nq_max], U_y[Nq_max];
+
+    // The map from global to element degrees of freedom.
+    fem::ElementMap element(*m_grid);
+
+    for (int j = tile.j_first; j <= tile.j_last; j++) {
+      for (int i0 = tile.i_first; i0 <= tile.i_last; i0 += batch_size) {
+        const int N = std::min(batch_size, tile.i_last + 1 - i0);
+
+        // Values of the solution and its derivatives at quadrature points of elements
+        // in this batch.
+        double
+          u_q[quadrature_size], u_q_x[quadrature_size], u_q_y[quadrature_size],
+          v_q[quadrature_size], v_q_x[quadrature_size], v_q_y[quadrature_size];
+        {
+          // Obtain the value of the solution at the nodes adjacent to elements.
+          double u_nodal[nodal_size], v_nodal[nodal_size];
+          batch.nodal_values(velocity_global, i0, j, N, u_nodal, v_nodal);
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (int j = ys; j < ys + ym; j++) {
-      for (int i = xs; i < xs + xm; i++) {
-        // Initialize the map from global to element degrees of freedom.
-        m_element.reset(i, j);
-        int node_type[Nk];
-        m_element.nodal_values(m_node_type, node_type);
+          // These values now need to be adjusted if some nodes have Dirichlet data.
+          if (dirichlet_data) {
+            for (int b = 0; b < N; ++b) {
+              element.reset(i0 + b, j);
 
-        // an element is "interior" if all its nodes are interior or boundary
-        const bool interior_element = (node_type[0] < NODE_EXTERIOR and
-                                       node_type[1] < NODE_EXTERIOR and
-                                       node_type[2] < NODE_EXTERIOR and
-                                       node_type[3] < NODE_EXTERIOR);
+              Vector2 velocity_nodal[Nk];
+              for (unsigned int k = 0; k < Nk; ++k) {
+                velocity_nodal[k] = Vector2(u_nodal[k * batch_size + b],
+                                            v_nodal[k * batch_size + b]);
+              }
 
-        if (use_cfbc and (not interior_element)) {
-          // an exterior element in the CFBC case
-          continue;
+              // Set elements of velocity_nodal that correspond to Dirichlet nodes to
+              // prescribed values.
+              dirichlet_data.enforce(element, velocity_nodal);
+
+              for (unsigned int k = 0; k < Nk; ++k) {
+                u_nodal[k * batch_size + b] = velocity_nodal[k].u;
+                v_nodal[k * batch_size + b] = velocity_nodal[k].v;
+              }
+            }
+          }
+
+          // Compute the solution values and its gradient at the quadrature points.
+          batch.quadrature_point_values(u_nodal, u_q, u_q_x, u_q_y);
+          batch.quadrature_point_values(v_nodal, v_q, v_q_x, v_q_y);
         }
 
-        // Note: without CFBC all elements are "interior".
+        for (int b = 0; b < N; ++b) {
+          const int i = i0 + b;
 
-        fem::Quadrature &Q = m_quadrature;
+          // Initialize the map from global to element degrees of freedom.
+          element.reset(i, j);
+          int node_type[Nk];
+          element.nodal_values(m_node_type, node_type);
 
-        // Number of quadrature points.
-        const unsigned int Nq = Q.n();
+          // an element is "interior" if all its nodes are interior or boundary
+          const bool interior_element = (node_type[0] < NODE_EXTERIOR and
+                                         node_type[1] < NODE_EXTERIOR and
+                                         node_type[2] < NODE_EXTERIOR and
+                                         node_type[3] < NODE_EXTERIOR);
 
-        // An Nq by Nk array of test function values.
-        const fem::Germs *test = Q.test_function_values();
+          if (use_cfbc and (not interior_element)) {
+            // an exterior element in the CFBC case
+            continue;
+          }
 
-        // Jacobian times weights for quadrature.
-        const double* W = Q.weights();
+          // Note: without CFBC all elements are "interior".
 
-        // Storage for the solution and residuals at element nodes.
-        Vector2 residual[Nk];
+          fem::Quadrature &Q = m_quadrature;
 
-        int    mask[Nq_max];
-        double thickness[Nq_max];
-        double tauc[Nq_max];
-        double hardness[Nq_max];
-        Vector2 tau_d[Nq_max];
+          // Number of quadrature points.
+          const unsigned int Nq = Q.n();
 
-        {
-          Coefficients coeffs[Nk];
-          m_element.nodal_values(m_coefficients, coeffs);
+          // An Nq by Nk array of test function values.
+          const fem::Germs *test = Q.test_function_values();
 
-          quad_point_values(Q, coeffs, mask, thickness, tauc, hardness);
+          // Jacobian times weights for quadrature.
+          const double* W = Q.weights();
 
-          if (use_explicit_driving_stress) {
-            explicit_driving_stress(Q, coeffs, tau_d);
-          } else {
-            driving_stress(Q, coeffs, tau_d);
-          }
-        }
+          // Storage for the residuals at element nodes.
+          Vector2 residual[Nk];
 
-        {
-          // Obtain the value of the solution at the nodes adjacent to the element.
-          Vector2 velocity_nodal[Nk];
-          m_element.nodal_values(velocity_global, velocity_nodal);
+          int    mask[Nq_max];
+          double thickness[Nq_max];
+          double tauc[Nq_max];
+          double hardness[Nq_max];
+          Vector2 tau_d[Nq_max];
+
+          {
+            Coefficients coeffs[Nk];
+            element.nodal_values(m_coefficients, coeffs);
+
+            quad_point_values(Q, coeffs, mask, thickness, tauc, hardness);
+
+            if (use_explicit_driving_stress) {
+              explicit_driving_stress(Q, coeffs, tau_d);
+            } else {
+              driving_stress(Q, coeffs, tau_d);
+            }
+          }
 
-          // These values now need to be adjusted if some nodes in the element have Dirichlet data.
           if (dirichlet_data) {
-            // Set elements of velocity_nodal that correspond to Dirichlet nodes to prescribed
-            // values.
-            dirichlet_data.enforce(m_element, velocity_nodal);
-            // mark Dirichlet nodes in m_element so that they are not touched by
+            // mark Dirichlet nodes in element so that they are not touched by
             // add_contribution() below
-            dirichlet_data.constrain(m_element);
+            dirichlet_data.constrain(element);
           }
 
-          // Compute the solution values and its gradient at the quadrature points.
-          quadrature_point_values(Q, velocity_nodal, // input
-                                  U, U_x, U_y);   // outputs
-        }
+          for (unsigned int q = 0; q < Nq; q++) {
+            const int n = q * batch_size + b;
+            U[q]   = Vector2(u_q[n], v_q[n]);
+            U_x[q] = Vector2(u_q_x[n], v_q_x[n]);
+            U_y[q] = Vector2(u_q_y[n], v_q_y[n]);
+          }
 
-        // Zero out the element-local residual in preparation for updating it.
-        for (unsigned int k = 0; k < Nk; k++) {
-          residual[k].u = 0;
-          residual[k].v = 0;
-        }
+          // Zero out the element-local residual in preparation for updating it.
+          for (unsigned int k = 0; k < Nk; k++) {
+            residual[k].u = 0;
+            residual[k].v = 0;
+          }
 
-        // loop over quadrature points:
-        for (unsigned int q = 0; q < Nq; q++) {
+          double beta[Nq_max];
+          basal_drag(Nq, mask, tauc, U, beta, NULL);
 
-          double eta = 0.0, beta = 0.0;
-          PointwiseNuHAndBeta(thickness[q], hardness[q], mask[q], tauc[q],
-                              U[q], U_x[q], U_y[q], // inputs
-                              &eta, NULL, &beta, NULL);              // outputs
+          // loop over quadrature points:
+          for (unsigned int q = 0; q < Nq; q++) {
 
-          // The next few lines compute the actual residual for the element.
-          const Vector2 tau_b = U[q] * (- beta); // basal shear stress
+            double eta = 0.0;
+            PointwiseNuH(thickness[q], hardness[q], U_x[q], U_y[q], // inputs
+                         &eta, NULL);                               // outputs
 
-          const double
-            jw           = W[q],
-            u_x          = U_x[q].u,
-            v_y          = U_y[q].v,
-            u_y_plus_v_x = U_y[q].u + U_x[q].v;
+            // The next few lines compute the actual residual for the element.
+            const Vector2 tau_b = U[q] * (- beta[q]); // basal shear stress
 
-          // Loop over test functions.
-          for (unsigned int k = 0; k < Nk; k++) {
-            const fem::Germ &psi = test[q][k];
+            const double
+              jw           = W[q],
+              u_x          = U_x[q].u,
+              v_y          = U_y[q].v,
+              u_y_plus_v_x = U_y[q].u + U_x[q].v;
 
-            residual[k].u += jw * (eta * (psi.dx * (4.0 * u_x + 2.0 * v_y) + psi.dy * u_y_plus_v_x)
-                                   - psi.val * (tau_b.u + tau_d[q].u));
-            residual[k].v += jw * (eta * (psi.dx * u_y_plus_v_x + psi.dy * (2.0 * u_x + 4.0 * v_y))
-                                   - psi.val * (tau_b.v + tau_d[q].v));
-          } // k (test functions)
-        }   // q (quadrature points)
+            // Loop over test functions.
+            for (unsigned int k = 0; k < Nk; k++) {
+              const fem::Germ &psi = test[q][k];
+
+              residual[k].u += jw * (eta * (psi.dx * (4.0 * u_x + 2.0 * v_y) + psi.dy * u_y_plus_v_x)
+                                     - psi.val * (tau_b.u + tau_d[q].u));
+              residual[k].v += jw * (eta * (psi.dx * u_y_plus_v_x + psi.dy * (2.0 * u_x + 4.0 * v_y))
+                                     - psi.val * (tau_b.v + tau_d[q].v));
+            } // k (test functions)
+          }   // q (quadrature points)
 
-        m_element.add_contribution(residual, residual_global);
+          element.add_contribution(residual, residual_global);
+        } // b-loop (elements in a batch)
       } // i-loop
     } // j-loop
+  };
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for (unsigned int c = 0; c < fem::ElementIterator::n_colours; ++c) {
+      for_each_tile(m_element_index.tiles(*m_grid, c), assemble);
+    }
   } catch (...) {
     loop.failed();
   }
@@ -919,25 +1107,23 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
   // Start access to Dirichlet data if present.
   fem::DirichletData_Vector dirichlet_data(m_bc_mask, m_bc_values, m_dirichletScale);
 
-  // Storage for the current solution at quadrature points.
-  Vector2 U[Nq_max], U_x[Nq_max], U_y[Nq_max];
+  // Compute element Jacobians in a tile. Element matrices are computed concurrently but
+  // added to the Jacobian one at a time.
+  std::mutex jacobian_mutex;
+  auto assemble = [&](const Tile &tile) {
+    // Storage for the current solution at quadrature points.
+    Vector2 U[Nq_max], U_x[Nq_max], U_y[Nq_max];
 
-  // Loop through all the elements.
-  int
-    xs = m_element_index.xs,
-    xm = m_element_index.xm,
-    ys = m_element_index.ys,
-    ym = m_element_index.ym;
+    // The map from global to element degrees of freedom.
+    fem::ElementMap element(*m_grid);
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (int j = ys; j < ys + ym; j++) {
-      for (int i = xs; i < xs + xm; i++) {
+    for (int j = tile.j_first; j <= tile.j_last; j++) {
+      for (int i = tile.i_first; i <= tile.i_last; i++) {
         // Initialize the map from global to element degrees of freedom.
-        m_element.reset(i, j);
+        element.reset(i, j);
 
         int node_type[Nk];
-        m_element.nodal_values(m_node_type, node_type);
+        element.nodal_values(m_node_type, node_type);
         // an element is "interior" if all its nodes are interior or boundary
         const bool interior_element = (node_type[0] < NODE_EXTERIOR and
                                        node_type[1] < NODE_EXTERIOR and
@@ -968,7 +1154,7 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
 
         {
           Coefficients coeffs[Nk];
-          m_element.nodal_values(m_coefficients, coeffs);
+          element.nodal_values(m_coefficients, coeffs);
 
           quad_point_values(Q, coeffs,
                             mask, thickness, tauc, hardness);
@@ -978,13 +1164,13 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
           // Values of the solution at the nodes of the current element.
           Vector2 velocity_nodal[Nk];
           // Obtain the value of the solution at the adjacent nodes to the element.
-          m_element.nodal_values(velocity_global, velocity_nodal);
+          element.nodal_values(velocity_global, velocity_nodal);
 
           // These values now need to be adjusted if some nodes in the element have
           // Dirichlet data.
           if (dirichlet_data) {
-            dirichlet_data.enforce(m_element, velocity_nodal);
-            dirichlet_data.constrain(m_element);
+            dirichlet_data.enforce(element, velocity_nodal);
+            dirichlet_data.constrain(element);
           }
           // Compute the values of the solution at the quadrature points.
           quadrature_point_values(Q, velocity_nodal, U, U_x, U_y);
@@ -995,9 +1181,12 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
         // entries in the local Jacobian.
         double K[2*Nk][2*Nk];
         // Build the element-local Jacobian.
-        ierr = PetscMemzero(K, sizeof(K));
+        PetscErrorCode ierr = PetscMemzero(K, sizeof(K));
         PISM_CHK(ierr, "PetscMemzero");
 
+        double beta_q[Nq_max], dbeta_q[Nq_max];
+        basal_drag(Nq, mask, tauc, U, beta_q, dbeta_q);
+
         for (unsigned int q = 0; q < Nq; q++) {
           const double
             jw           = W[q],
@@ -1005,12 +1194,13 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
             v            = U[q].v,
             u_x          = U_x[q].u,
             v_y          = U_y[q].v,
-            u_y_plus_v_x = U_y[q].u + U_x[q].v;
+            u_y_plus_v_x = U_y[q].u + U_x[q].v,
+            beta         = beta_q[q],
+            dbeta        = dbeta_q[q];
 
-          double eta = 0.0, deta = 0.0, beta = 0.0, dbeta = 0.0;
-          PointwiseNuHAndBeta(thickness[q], hardness[q], mask[q], tauc[q],
-                              U[q], U_x[q], U_y[q],
-                              &eta, &deta, &beta, &dbeta);
+          double eta = 0.0, deta = 0.0;
+          PointwiseNuH(thickness[q], hardness[q], U_x[q], U_y[q],
+                       &eta, &deta);
 
           for (unsigned int l = 0; l < Nk; l++) { // Trial functions
 
@@ -1061,9 +1251,20 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
             } // l
           } // k
         } // q
-        m_element.add_contribution(&K[0][0], Jac);
+        {
+          // MatSetValues...() is not thread-safe
+          std::lock_guard<std::mutex> guard(jacobian_mutex);
+          element.add_contribution(&K[0][0], Jac);
+        }
       } // j
     } // i
+  };
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for (unsigned int c = 0; c < fem::ElementIterator::n_colours; ++c) {
+      for_each_tile(m_element_index.tiles(*m_grid, c), assemble);
+    }
   } catch (...) {
     loop.failed();
   }
@@ -1102,6 +1303,359 @@ void SSAFEM::compute_local_jacobian(Vector2 const *const *const velocity_global,
   monitor_jacobian(Jac);
 }
 
+/*!
+ * Compute and store the linearization of the SSA at `velocity_global` (values of
+ * @f$ \nu H @f$, @f$ \beta @f$, their derivatives and velocity derivatives at all
+ * quadrature points) for apply_jacobian(), and inverses of 2x2 diagonal blocks of the
+ * Jacobian for apply_preconditioner().
+ *
+ * The Jacobian defined by these is the same as the one assembled by
+ * compute_local_jacobian().
+ */
+void SSAFEM::compute_linearization(Vector2 const *const *const velocity_global) {
+
+  const unsigned int Nk = fem::q1::n_chi;
+  const unsigned int Nq = m_quadrature.n();
+
+  const bool use_cfbc = m_config->get_flag("stress_balance.calving_front_stress_bc");
+
+  const int
+    xs = m_element_index.xs,
+    xm = m_element_index.xm,
+    ys = m_element_index.ys,
+    ym = m_element_index.ym;
+
+  m_linearization.resize(xm * ym * Nq);
+  m_element_active.resize(xm * ym);
+
+  // 2x2 diagonal blocks (row-major), one per owned node
+  std::vector<double> &D = m_block_diagonal_inverse;
+  D.assign(4 * m_grid->xm() * m_grid->ym(), 0.0);
+
+  // index of an owned node (i, j)
+  auto node_index = [this](int i, int j) {
+    return (j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs());
+  };
+
+  auto owned = [this](int i, int j) {
+    return (i >= m_grid->xs() and i < m_grid->xs() + m_grid->xm() and
+            j >= m_grid->ys() and j < m_grid->ys() + m_grid->ym());
+  };
+
+  IceModelVec::AccessList list{&m_node_type, &m_coefficients};
+  if (m_bc_mask != NULL) {
+    list.add(*m_bc_mask);
+  }
+
+  fem::DirichletData_Vector dirichlet_data(m_bc_mask, m_bc_values, m_dirichletScale);
+
+  fem::Quadrature &Q = m_quadrature;
+  const fem::Germs *test = Q.test_function_values();
+  const double *W = Q.weights();
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for (int j = ys; j < ys + ym; j++) {
+      for (int i = xs; i < xs + xm; i++) {
+        const int e = (j - ys) * xm + (i - xs);
+
+        m_element.reset(i, j);
+
+        int node_type[Nk];
+        m_element.nodal_values(m_node_type, node_type);
+
+        const bool interior_element = (node_type[0] < NODE_EXTERIOR and
+                                       node_type[1] < NODE_EXTERIOR and
+                                       node_type[2] < NODE_EXTERIOR and
+                                       node_type[3] < NODE_EXTERIOR);
+
+        m_element_active[e] = not (use_cfbc and (not interior_element));
+
+        if (not m_element_active[e]) {
+          continue;
+        }
+
+        int    mask[fem::MAX_QUADRATURE_SIZE];
+        double thickness[fem::MAX_QUADRATURE_SIZE];
+        double tauc[fem::MAX_QUADRATURE_SIZE];
+        double hardness[fem::MAX_QUADRATURE_SIZE];
+        {
+          Coefficients coeffs[Nk];
+          m_element.nodal_values(m_coefficients, coeffs);
+
+          quad_point_values(Q, coeffs, mask, thickness, tauc, hardness);
+        }
+
+        Vector2
+          U[fem::MAX_QUADRATURE_SIZE],
+          U_x[fem::MAX_QUADRATURE_SIZE],
+          U_y[fem::MAX_QUADRATURE_SIZE];
+        {
+          Vector2 velocity_nodal[Nk];
+          m_element.nodal_values(velocity_global, velocity_nodal);
+
+          if (dirichlet_data) {
+            dirichlet_data.enforce(m_element, velocity_nodal);
+          }
+
+          quadrature_point_values(Q, velocity_nodal, U, U_x, U_y);
+        }
+
+        // rows of Dirichlet nodes are not affected by element contributions
+        bool skip_row[Nk] = {false, false, false, false};
+        for (unsigned int k = 0; k < Nk; ++k) {
+          int ii = 0, jj = 0;
+          m_element.local_to_global(k, ii, jj);
+          skip_row[k] = (not owned(ii, jj) or
+                         (m_bc_mask != NULL and m_bc_mask->as_int(ii, jj) == 1));
+        }
+
+        double beta[fem::MAX_QUADRATURE_SIZE], dbeta[fem::MAX_QUADRATURE_SIZE];
+        basal_drag(Nq, mask, tauc, U, beta, dbeta);
+
+        for (unsigned int q = 0; q < Nq; q++) {
+          Linearization &L = m_linearization[e * Nq + q];
+
+          PointwiseNuH(thickness[q], hardness[q], U_x[q], U_y[q],
+                       &L.eta, &L.deta);
+          L.beta  = beta[q];
+          L.dbeta = dbeta[q];
+
+          L.U            = U[q];
+          L.u_x          = U_x[q].u;
+          L.v_y          = U_y[q].v;
+          L.u_y_plus_v_x = U_y[q].u + U_x[q].v;
+
+          const double
+            jw = W[q],
+            u  = L.U.u,
+            v  = L.U.v,
+            u_x = L.u_x,
+            v_y = L.v_y,
+            u_y_plus_v_x = L.u_y_plus_v_x;
+
+          // diagonal blocks (see compute_local_jacobian() with l == k)
+          for (unsigned int k = 0; k < Nk; k++) {
+            if (skip_row[k]) {
+              continue;
+            }
+
+            const fem::Germ &psi = test[q][k];
+
+            const double
+              gamma_u = (2.0 * u_x + v_y) * psi.dx + 0.5 * u_y_plus_v_x * psi.dy,
+              gamma_v = 0.5 * u_y_plus_v_x * psi.dx + (u_x + 2.0 * v_y) * psi.dy,
+              eta_u   = L.deta * gamma_u,
+              eta_v   = L.deta * gamma_v,
+              taub_xu = -L.dbeta * u * u * psi.val - L.beta * psi.val,
+              taub_xv = -L.dbeta * u * v * psi.val,
+              taub_yu = -L.dbeta * v * u * psi.val,
+              taub_yv = -L.dbeta * v * v * psi.val - L.beta * psi.val;
+
+            int ii = 0, jj = 0;
+            m_element.local_to_global(k, ii, jj);
+            double *B = &D[4 * node_index(ii, jj)];
+
+            B[0] += jw * (eta_u * (psi.dx * (4 * u_x + 2 * v_y) + psi.dy * u_y_plus_v_x)
+                          + L.eta * (4 * psi.dx * psi.dx + psi.dy * psi.dy) - psi.val * taub_xu);
+            B[1] += jw * (eta_v * (psi.dx * (4 * u_x + 2 * v_y) + psi.dy * u_y_plus_v_x)
+                          + L.eta * (2 * psi.dx * psi.dy + psi.dy * psi.dx) - psi.val * taub_xv);
+            B[2] += jw * (eta_u * (psi.dx * u_y_plus_v_x + psi.dy * (2 * u_x + 4 * v_y))
+                          + L.eta * (psi.dx * psi.dy + 2 * psi.dy * psi.dx) - psi.val * taub_yu);
+            B[3] += jw * (eta_v * (psi.dx * u_y_plus_v_x + psi.dy * (2 * u_x + 4 * v_y))
+                          + L.eta * (psi.dx * psi.dx + 4 * psi.dy * psi.dy) - psi.val * taub_yv);
+          }
+        } // q
+      } // i
+    } // j
+
+    // Add Dirichlet rows (as in compute_local_jacobian()) and invert diagonal blocks.
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      double *B = &D[4 * node_index(i, j)];
+
+      if (m_bc_mask != NULL and m_bc_mask->as_int(i, j) == 1) {
+        B[0] += m_dirichletScale;
+        B[3] += m_dirichletScale;
+      }
+
+      if (use_cfbc and m_node_type.as_int(i, j) == NODE_EXTERIOR) {
+        B[0] += m_dirichletScale;
+        B[3] += m_dirichletScale;
+      }
+
+      const double det = B[0] * B[3] - B[1] * B[2];
+
+      if (det == 0.0) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "singular diagonal block of the SSA Jacobian"
+                                      " at i = %d, j = %d", i, j);
+      }
+
+      const double
+        a = B[0],
+        b = B[1],
+        c = B[2],
+        d = B[3];
+
+      B[0] =  d / det;
+      B[1] = -b / det;
+      B[2] = -c / det;
+      B[3] =  a / det;
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+}
+
+/*!
+ * Compute `y = J x`, where `J` is the Jacobian defined by the linearization computed by
+ * compute_linearization().
+ */
+void SSAFEM::apply_jacobian(Vec x, Vec y) {
+  const unsigned int Nk = fem::q1::n_chi;
+  const unsigned int Nq = m_quadrature.n();
+
+  const bool use_cfbc = m_config->get_flag("stress_balance.calving_front_stress_bc");
+
+  const int
+    xs = m_element_index.xs,
+    xm = m_element_index.xm,
+    ys = m_element_index.ys,
+    ym = m_element_index.ym;
+
+  m_jacobian_input.copy_from_vec(x);
+
+  PetscErrorCode ierr = VecSet(y, 0.0);
+  PISM_CHK(ierr, "VecSet");
+
+  petsc::DMDAVecArray y_array(m_da, y);
+  Vector2 **result = (Vector2**)y_array.get();
+
+  IceModelVec::AccessList list{&m_jacobian_input, &m_node_type};
+  if (m_bc_mask != NULL) {
+    list.add(*m_bc_mask);
+  }
+
+  // only the Dirichlet mask is used here
+  fem::DirichletData_Vector dirichlet_data(m_bc_mask, NULL, m_dirichletScale);
+
+  fem::Quadrature &Q = m_quadrature;
+  const fem::Germs *test = Q.test_function_values();
+  const double *W = Q.weights();
+
+  ParallelSection loop(m_grid->com);
+  try {
+    for (int j = ys; j < ys + ym; j++) {
+      for (int i = xs; i < xs + xm; i++) {
+        const int e = (j - ys) * xm + (i - xs);
+
+        if (not m_element_active[e]) {
+          continue;
+        }
+
+        m_element.reset(i, j);
+
+        Vector2
+          dU[fem::MAX_QUADRATURE_SIZE],
+          dU_x[fem::MAX_QUADRATURE_SIZE],
+          dU_y[fem::MAX_QUADRATURE_SIZE];
+        {
+          Vector2 x_nodal[Nk];
+          m_element.nodal_values(m_jacobian_input, x_nodal);
+
+          // Dirichlet columns (and rows) of the Jacobian contain no element contributions
+          if (dirichlet_data) {
+            dirichlet_data.enforce_homogeneous(m_element, x_nodal);
+            dirichlet_data.constrain(m_element);
+          }
+
+          quadrature_point_values(Q, x_nodal, dU, dU_x, dU_y);
+        }
+
+        Vector2 y_nodal[Nk];
+
+        for (unsigned int q = 0; q < Nq; q++) {
+          const Linearization &L = m_linearization[e * Nq + q];
+
+          const double
+            jw   = W[q],
+            u_x  = L.u_x,
+            v_y  = L.v_y,
+            u_y_plus_v_x = L.u_y_plus_v_x,
+            du   = dU[q].u,
+            dv   = dU[q].v,
+            du_x = dU_x[q].u,
+            dv_y = dU_y[q].v,
+            du_y_plus_dv_x = dU_y[q].u + dU_x[q].v;
+
+          // change in nu*H
+          const double deta = L.deta * ((2.0 * u_x + v_y) * du_x +
+                                        0.5 * u_y_plus_v_x * du_y_plus_dv_x +
+                                        (u_x + 2.0 * v_y) * dv_y);
+
+          // change in the basal shear stress
+          const double
+            U_dot_dU = L.U.u * du + L.U.v * dv,
+            dtaub_x  = -L.dbeta * L.U.u * U_dot_dU - L.beta * du,
+            dtaub_y  = -L.dbeta * L.U.v * U_dot_dU - L.beta * dv;
+
+          for (unsigned int k = 0; k < Nk; k++) {
+            const fem::Germ &psi = test[q][k];
+
+            y_nodal[k].u += jw * (deta * (psi.dx * (4.0 * u_x + 2.0 * v_y) + psi.dy * u_y_plus_v_x)
+                                  + L.eta * (psi.dx * (4.0 * du_x + 2.0 * dv_y) + psi.dy * du_y_plus_dv_x)
+                                  - psi.val * dtaub_x);
+            y_nodal[k].v += jw * (deta * (psi.dx * u_y_plus_v_x + psi.dy * (2.0 * u_x + 4.0 * v_y))
+                                  + L.eta * (psi.dx * du_y_plus_dv_x + psi.dy * (2.0 * du_x + 4.0 * dv_y))
+                                  - psi.val * dtaub_y);
+          }
+        } // q
+
+        m_element.add_contribution(y_nodal, result);
+      } // i
+    } // j
+
+    // Dirichlet rows (identity blocks scaled by m_dirichletScale)
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (m_bc_mask != NULL and m_bc_mask->as_int(i, j) == 1) {
+        result[j][i] += m_dirichletScale * m_jacobian_input(i, j);
+      }
+
+      if (use_cfbc and m_node_type.as_int(i, j) == NODE_EXTERIOR) {
+        result[j][i] += m_dirichletScale * m_jacobian_input(i, j);
+      }
+    }
+  } catch (...) {
+    loop.failed();
+  }
+  loop.check();
+}
+
+//! Apply the point block Jacobi preconditioner (inverses of 2x2 diagonal blocks of the Jacobian).
+void SSAFEM::apply_preconditioner(Vec x, Vec y) {
+  petsc::VecArray x_array(x), y_array(y);
+
+  const double *X = x_array.get();
+  double *Y = y_array.get();
+
+  const std::vector<double> &B = m_block_diagonal_inverse;
+  const int N = B.size() / 4;
+
+  for (int n = 0; n < N; ++n) {
+    const double
+      x0 = X[2 * n + 0],
+      x1 = X[2 * n + 1];
+
+    Y[2 * n + 0] = B[4 * n + 0] * x0 + B[4 * n + 1] * x1;
+    Y[2 * n + 1] = B[4 * n + 2] * x0 + B[4 * n + 3] * x1;
+  }
+}
+
 void SSAFEM::monitor_jacobian(Mat Jac) {
   PetscErrorCode ierr;
   bool mon_jac = options::Bool("-ssa_monitor_jacobian", "monitor the SSA Jacobian");
@@ -1167,7 +1721,14 @@ PetscErrorCode SSAFEM::jacobian_callback(DMDALocalInfo *info,
   try {
     (void) A;
     (void) info;
-    fe->ssa->compute_local_jacobian(velocity, J);
+    if (fe->ssa->m_matrix_free) {
+      fe->ssa->compute_linearization(velocity);
+
+      PetscErrorCode ierr = MatAssemblyBegin(J, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+      ierr = MatAssemblyEnd(J, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    } else {
+      fe->ssa->compute_local_jacobian(velocity, J);
+    }
   } catch (...) {
     MPI_Comm com = MPI_COMM_SELF;
     PetscErrorCode ierr = PetscObjectGetComm((PetscObject)fe->da, &com); CHKERRQ(ierr);
@@ -1177,5 +1738,35 @@ PetscErrorCode SSAFEM::jacobian_callback(DMDALocalInfo *info,
   return 0;
 }
 
+PetscErrorCode SSAFEM::jacobian_mult_callback(Mat A, Vec x, Vec y) {
+  void *ctx = NULL;
+  PetscErrorCode ierr = MatShellGetContext(A, &ctx); CHKERRQ(ierr);
+  SSAFEM *ssa = static_cast<SSAFEM*>(ctx);
+
+  try {
+    ssa->apply_jacobian(x, y);
+  } catch (...) {
+    MPI_Comm com = ssa->m_grid->com;
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
+PetscErrorCode SSAFEM::preconditioner_callback(PC pc, Vec x, Vec y) {
+  void *ctx = NULL;
+  PetscErrorCode ierr = PCShellGetContext(pc, &ctx); CHKERRQ(ierr);
+  SSAFEM *ssa = static_cast<SSAFEM*>(ctx);
+
+  try {
+    ssa->apply_preconditioner(x, y);
+  } catch (...) {
+    MPI_Comm com = ssa->m_grid->com;
+    handle_fatal_errors(com);
+    SETERRQ(com, 1, "A PISM callback failed");
+  }
+  return 0;
+}
+
 } // end of namespace stressbalance
 } // end of namespace pism
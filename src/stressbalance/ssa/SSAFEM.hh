@@ -1,4 +1,4 @@
-// Copyright (C) 2009--2017 Jed Brown and Ed Bueler and Constantine Khroulev and David Maxwell
+// Copyright (C) 2009--2017, 2020 Jed Brown and Ed Bueler and Constantine Khroulev and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -19,9 +19,12 @@
 #ifndef _SSAFEM_H_
 #define _SSAFEM_H_
 
+#include <vector>
+
 #include "SSA.hh"
 #include "pism/util/FETools.hh"
 #include "pism/util/petscwrappers/SNES.hh"
+#include "pism/util/petscwrappers/Mat.hh"
 #include "pism/util/TerminationReason.hh"
 #include "pism/util/Mask.hh"
 
@@ -90,23 +93,46 @@ protected:
                       const Coefficients *x,
                       Vector2 *driving_stress) const;
 
-  void PointwiseNuHAndBeta(double thickness,
-                           double hardness,
-                           int mask,
-                           double tauc,
-                           const Vector2 &U,
-                           const Vector2 &U_x,
-                           const Vector2 &U_y,
-                           double *nuH, double *dnuH,
-                           double *beta, double *dbeta);
+  void PointwiseNuH(double thickness,
+                    double hardness,
+                    const Vector2 &U_x,
+                    const Vector2 &U_y,
+                    double *nuH, double *dnuH);
+
+  void basal_drag(unsigned int n,
+                  const int *mask,
+                  const double *tauc,
+                  const Vector2 *U,
+                  double *beta, double *dbeta);
 
   void compute_local_function(Vector2 const *const *const velocity,
                               Vector2 **residual);
 
   void compute_local_jacobian(Vector2 const *const *const velocity, Mat J);
 
+  //! Linearization of the SSA at a quadrature point (used by the matrix-free Jacobian).
+  struct Linearization {
+    //! @f$ \nu H @f$ and its derivative with respect to the second invariant
+    double eta, deta;
+    //! basal drag coefficient and its derivative
+    double beta, dbeta;
+    //! velocity and its derivatives
+    Vector2 U;
+    double u_x, v_y, u_y_plus_v_x;
+  };
+
+  void compute_linearization(Vector2 const *const *const velocity);
+
+  void apply_jacobian(Vec x, Vec y);
+
+  void apply_preconditioner(Vec x, Vec y);
+
   virtual void solve(const Inputs &inputs);
 
+  virtual double initial_guess_residual(const Inputs &inputs);
+
+  virtual double zero_velocity_residual(const Inputs &inputs);
+
   TerminationReason::Ptr solve_with_reason(const Inputs &inputs);
 
   TerminationReason::Ptr solve_nocache();
@@ -126,6 +152,8 @@ protected:
   CallbackData m_callback_data;
 
   petsc::SNES m_snes;
+  //! storage for the SNES residual norm history (see SSAFEM::solve_nocache())
+  std::vector<PetscReal> m_residual_history;
 
   //! Storage for node types (interior, boundary, exterior).
   IceModelVec2Int m_node_type;
@@ -136,6 +164,20 @@ protected:
   double m_beta_ice_free_bedrock;
   double m_epsilon_ssa;
 
+  //! True if the Jacobian is applied without assembling it.
+  bool m_matrix_free;
+  //! Shell matrix applying the Jacobian (matrix-free mode only).
+  petsc::Mat m_jacobian_shell;
+  //! Linearization at quadrature points of all elements (matrix-free mode only).
+  std::vector<Linearization> m_linearization;
+  //! Flags marking elements that contribute to the Jacobian (matrix-free mode only).
+  std::vector<char> m_element_active;
+  //! Inverses of 2x2 diagonal blocks of the Jacobian, one per owned node (matrix-free mode
+  //! only).
+  std::vector<double> m_block_diagonal_inverse;
+  //! Ghosted copy of the input of apply_jacobian().
+  IceModelVec2V m_jacobian_input;
+
   fem::ElementIterator m_element_index;
   fem::ElementMap m_element;
   fem::Q1Quadrature4 m_quadrature;
@@ -160,6 +202,9 @@ static PetscErrorCode function_callback(DMDALocalInfo *info,
   static PetscErrorCode jacobian_callback(DMDALocalInfo *info,
                                           Vector2 const *const *const xg,
                                           Mat A, Mat J, CallbackData *fe);
+
+  static PetscErrorCode jacobian_mult_callback(Mat A, Vec x, Vec y);
+  static PetscErrorCode preconditioner_callback(PC pc, Vec x, Vec y);
 };
 
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2016, 2017 PISM Authors
+/* Copyright (C) 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::upper_bound
+
 #include "timestepping.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/iceModelVec.hh"
@@ -56,6 +58,10 @@ CFLData max_timestep_cfl_3d(const IceModelVec2S &ice_thickness,
     one_over_dx = 1.0 / grid->dx(),
     one_over_dy = 1.0 / grid->dy();
 
+  // 3D velocity may use a subset of grid levels (see stress_balance.Mz)
+  const std::vector<double> z = u3.levels();
+  const bool all_levels = (z.size() == grid->Mz());
+
   double u_max = 0.0, v_max = 0.0, w_max = 0.0;
   ParallelSection loop(grid->com);
   try {
@@ -63,7 +69,10 @@ CFLData max_timestep_cfl_3d(const IceModelVec2S &ice_thickness,
       const int i = p.i(), j = p.j();
 
       if (cell_type.icy(i, j)) {
-        const int ks = grid->kBelowHeight(ice_thickness(i, j));
+        const double H = ice_thickness(i, j);
+        const int ks = all_levels ?
+          grid->kBelowHeight(H) :
+          std::max(int(std::upper_bound(z.begin(), z.end(), H) - z.begin()) - 1, 0);
         const double
           *u = u3.get_column(i, j),
           *v = v3.get_column(i, j),
@@ -0,0 +1,118 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ActiveCellList.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+ActiveCellList::ActiveCellList(const IceGrid &grid)
+  : m_tiles(grid),
+    m_active(m_tiles.size()),
+    m_inactive(m_tiles.size()),
+    m_excluded(m_tiles.size()) {
+  // empty
+}
+
+/*!
+ * Re-build lists using `cell_type`, which has to have at least `margin_width` ghosts if
+ * `margin_width` is positive.
+ *
+ * Points where `no_model_mask` is set (if it is not NULL) are added to the list of
+ * excluded points.
+ */
+void ActiveCellList::update(const IceModelVec2CellType &cell_type, unsigned int margin_width,
+                            const IceModelVec2Int *no_model_mask) {
+
+  if (cell_type.stencil_width() < margin_width) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "%s has stencil width %d, expected at least %d",
+                                  cell_type.get_name().c_str(),
+                                  cell_type.stencil_width(), margin_width);
+  }
+
+  IceModelVec::AccessList list{&cell_type};
+  if (no_model_mask) {
+    list.add(*no_model_mask);
+  }
+
+  const int w = margin_width;
+
+  for_each_tile(m_tiles, [&](const Tile &tile) {
+      auto &active   = m_active[tile.index];
+      auto &inactive = m_inactive[tile.index];
+      auto &excluded = m_excluded[tile.index];
+
+      // clear() preserves capacity
+      active.clear();
+      inactive.clear();
+      excluded.clear();
+
+      for (PointsInTile p(tile); p; p.next()) {
+        const int i = p.i(), j = p.j();
+
+        if (no_model_mask and (*no_model_mask)(i, j) > 0.5) {
+          excluded.push_back({i, j});
+          continue;
+        }
+
+        bool icy = false;
+        for (int b = -w; b <= w and not icy; ++b) {
+          for (int a = -w; a <= w and not icy; ++a) {
+            icy = cell_type.icy(i + a, j + b);
+          }
+        }
+
+        if (icy) {
+          active.push_back({i, j});
+        } else {
+          inactive.push_back({i, j});
+        }
+      }
+    });
+}
+
+const Tiles& ActiveCellList::tiles() const {
+  return m_tiles;
+}
+
+const std::vector<ActiveCellList::Cell>& ActiveCellList::active(const Tile &tile) const {
+  return m_active[tile.index];
+}
+
+const std::vector<ActiveCellList::Cell>& ActiveCellList::inactive(const Tile &tile) const {
+  return m_inactive[tile.index];
+}
+
+const std::vector<ActiveCellList::Cell>& ActiveCellList::excluded(const Tile &tile) const {
+  return m_excluded[tile.index];
+}
+
+unsigned int ActiveCellList::n_active() const {
+  unsigned int result = 0;
+  for (const auto &a : m_active) {
+    result += a.size();
+  }
+  return result;
+}
+
+} // end of namespace pism
@@ -0,0 +1,84 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_ACTIVECELLLIST_H
+#define PISM_ACTIVECELLLIST_H
+
+#include <vector>
+
+#include "pism/util/Tiles.hh"
+
+namespace pism {
+
+class IceGrid;
+class IceModelVec2CellType;
+class IceModelVec2Int;
+
+//! Lists of "active" (icy) and "inactive" grid points in each Tile.
+/*!
+ * Column kernels that do something non-trivial only in icy columns (and, possibly, next
+ * to them) can iterate over lists of active and inactive points instead of checking the
+ * mask at every grid point of a tile.
+ *
+ * A point is active if there is an icy cell within `margin_width` grid points (in both
+ * directions) of it. Points in each list are in the order of PointsInTile.
+ *
+ * Points where `no_model_mask` (if provided) is set belong to neither list: they are
+ * "excluded" (the no-model strip of a regional model, where the model state is
+ * prescribed) and kernels should not do any work there.
+ *
+ * Create an ActiveCellList once (lists keep their storage) and call update() when the
+ * cell type changes.
+ *
+ * Usage:
+ *
+ *     for_each_tile(cells.tiles(), [&](const Tile &tile) {
+ *       for (auto c : cells.active(tile)) {
+ *         const int i = c.i, j = c.j;
+ *         ...
+ *       }
+ *     });
+ */
+class ActiveCellList {
+public:
+  struct Cell {
+    int i, j;
+  };
+
+  ActiveCellList(const IceGrid &grid);
+
+  void update(const IceModelVec2CellType &cell_type, unsigned int margin_width = 0,
+              const IceModelVec2Int *no_model_mask = nullptr);
+
+  const Tiles& tiles() const;
+
+  const std::vector<Cell>& active(const Tile &tile) const;
+  const std::vector<Cell>& inactive(const Tile &tile) const;
+  const std::vector<Cell>& excluded(const Tile &tile) const;
+
+  //! Number of active points owned by this processor.
+  unsigned int n_active() const;
+private:
+  Tiles m_tiles;
+  std::vector<std::vector<Cell> > m_active, m_inactive, m_excluded;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_ACTIVECELLLIST_H */
@@ -0,0 +1,58 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "CellTypeMask.hh"
+#include "pism/util/iceModelVec.hh"
+
+namespace pism {
+
+CellTypeMask::CellTypeMask()
+  : WorkArray2Mask() {
+  // empty
+}
+
+CellTypeMask::CellTypeMask(IceGrid::ConstPtr grid, const std::string &name,
+                           unsigned int stencil_width)
+  : WorkArray2Mask(grid, name, 1, stencil_width) {
+  // empty
+}
+
+void CellTypeMask::create(IceGrid::ConstPtr grid, const std::string &name,
+                          unsigned int stencil_width) {
+  WorkArray2Mask::create(grid, name, 1, stencil_width);
+}
+
+/*!
+ * Copy values owned by this process from `input` and update ghosts.
+ *
+ * `input` does not have to be ghosted.
+ */
+void CellTypeMask::copy_from(const IceModelVec2Int &input) {
+  IceModelVec::AccessList list{&input};
+
+  for (Points p(*input.grid()); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    (*this)(i, j) = input.as_int(i, j);
+  }
+
+  update_ghosts();
+}
+
+} // end of namespace pism
@@ -0,0 +1,254 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::max
+
+#include "Coarsening.hh"
+#include "pism/util/iceModelVec3Custom.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+/*!
+ * Ownership ranges of the coarse grid: the coarse cell `c` belongs to the process owning
+ * the fine cell `c * factor`.
+ */
+static std::vector<unsigned int> coarse_ranges(const PetscInt *fine, PetscInt size,
+                                               unsigned int factor) {
+  const PetscInt k = factor;
+
+  std::vector<unsigned int> result(size);
+
+  PetscInt start = 0;
+  for (PetscInt p = 0; p < size; ++p) {
+    PetscInt end = start + fine[p];
+
+    // number of c such that start <= c * k < end
+    PetscInt count = (end + k - 1) / k - (start + k - 1) / k;
+
+    // each process needs k - 1 ghosts: PETSc requires sub-domains at least this wide
+    if (count == 0 or fine[p] < k - 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "cannot coarsen by the factor of %d:"
+                                    " a sub-domain is too narrow (%d grid points)",
+                                    (int)factor, (int)fine[p]);
+    }
+
+    result[p] = count;
+    start = end;
+  }
+
+  return result;
+}
+
+IceGrid::Ptr coarse_grid(const IceGrid &grid, unsigned int factor) {
+  try {
+    if (factor == 0 or grid.Mx() % factor != 0 or grid.My() % factor != 0) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "grid size (Mx = %d, My = %d) is not divisible by %d",
+                                    grid.Mx(), grid.My(), factor);
+    }
+
+    GridParameters P(grid.ctx()->config());
+
+    // the coarse grid covers the union of fine grid cells
+    P.Lx           = 0.5 * grid.Mx() * grid.dx();
+    P.Ly           = 0.5 * grid.My() * grid.dy();
+    P.x0           = grid.x0();
+    P.y0           = grid.y0();
+    P.Mx           = grid.Mx() / factor;
+    P.My           = grid.My() / factor;
+    P.registration = CELL_CENTER;
+    P.periodicity  = grid.periodicity();
+    P.z            = grid.z();
+
+    {
+      petsc::DM::Ptr da = grid.get_dm(1, 0);
+
+      PetscInt px = 0, py = 0;
+      PetscErrorCode ierr = DMDAGetInfo(*da,
+                                        NULL,             // dimensions
+                                        NULL, NULL, NULL, // M, N, P
+                                        &px, &py, NULL,   // m, n, p
+                                        NULL,             // dof
+                                        NULL,             // stencil width
+                                        NULL, NULL, NULL, // boundary types
+                                        NULL);            // stencil type
+      PISM_CHK(ierr, "DMDAGetInfo");
+
+      const PetscInt *lx = NULL, *ly = NULL;
+      ierr = DMDAGetOwnershipRanges(*da, &lx, &ly, NULL);
+      PISM_CHK(ierr, "DMDAGetOwnershipRanges");
+
+      P.procs_x = coarse_ranges(lx, px, factor);
+      P.procs_y = coarse_ranges(ly, py, factor);
+    }
+
+    P.validate();
+
+    return IceGrid::Ptr(new IceGrid(grid.ctx(), P));
+  } catch (RuntimeError &e) {
+    e.add_context("creating a grid coarsened by the factor of %d", factor);
+    throw;
+  }
+}
+
+IceGrid::Ptr refined_grid(const IceGrid &grid, unsigned int factor) {
+  try {
+    if (factor == 0) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "the refinement factor has to be positive");
+    }
+
+    GridParameters P(grid.ctx()->config());
+
+    P.Lx           = grid.Lx();
+    P.Ly           = grid.Ly();
+    P.x0           = grid.x0();
+    P.y0           = grid.y0();
+    P.registration = grid.registration();
+    P.periodicity  = grid.periodicity();
+    P.z            = grid.z();
+
+    if (grid.registration() == CELL_CENTER) {
+      P.Mx = grid.Mx() * factor;
+      P.My = grid.My() * factor;
+    } else {
+      // keep grid points at the edges of the domain
+      P.Mx = (grid.Mx() - 1) * factor + 1;
+      P.My = (grid.My() - 1) * factor + 1;
+    }
+
+    P.ownership_ranges_from_options(grid.ctx()->size());
+
+    P.validate();
+
+    return IceGrid::Ptr(new IceGrid(grid.ctx(), P));
+  } catch (RuntimeError &e) {
+    e.add_context("creating a grid refined by the factor of %d", factor);
+    throw;
+  }
+}
+
+IceModelVec::Ptr coarsen(const IceModelVec &input, IceGrid::ConstPtr grid) {
+  IceGrid::ConstPtr fine_grid = input.grid();
+
+  const unsigned int k = fine_grid->Mx() / grid->Mx();
+
+  if (k == 0 or fine_grid->Mx() != k * grid->Mx() or fine_grid->My() != k * grid->My()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot coarsen %s: incompatible grids",
+                                  input.get_name().c_str());
+  }
+
+  // see IceModelVec::copy_to_vec()
+  const unsigned int
+    N     = std::max((size_t)input.ndof(), input.levels().size()),
+    n_dof = input.ndof();
+
+  // copy input, with k - 1 ghosts: the block covered by a coarse cell extends up to k - 1
+  // fine cells beyond the sub-domain owned by a process
+  petsc::DM::Ptr da = fine_grid->get_dm(N, k - 1);
+  petsc::TemporaryGlobalVec global(da);
+  input.copy_to_vec(da, global);
+
+  petsc::Vec local;
+  {
+    PetscErrorCode ierr = DMCreateLocalVector(*da, local.rawptr());
+    PISM_CHK(ierr, "DMCreateLocalVector");
+
+    ierr = DMGlobalToLocalBegin(*da, global, INSERT_VALUES, local);
+    PISM_CHK(ierr, "DMGlobalToLocalBegin");
+
+    ierr = DMGlobalToLocalEnd(*da, global, INSERT_VALUES, local);
+    PISM_CHK(ierr, "DMGlobalToLocalEnd");
+  }
+
+  IceModelVec::Ptr result;
+  if (input.ndims() == 3) {
+    const VariableMetadata &z = input.metadata(0).get_z();
+
+    result.reset(new IceModelVec3Custom(grid, input.get_name(), z.get_name(),
+                                        input.levels(), z.get_all_strings()));
+  } else {
+    result.reset(new IceModelVec2(grid, input.get_name(), WITHOUT_GHOSTS, 0, n_dof));
+  }
+
+  for (unsigned int j = 0; j < n_dof; ++j) {
+    result->metadata(j) = input.metadata(j);
+  }
+
+  // fill values (internal units); all levels of a 3D field share its metadata
+  std::vector<double> fill_value(N, 0.0);
+  std::vector<bool> has_fill_value(N, false);
+  for (unsigned int d = 0; d < N; ++d) {
+    const SpatialVariableMetadata &m = input.metadata(n_dof > 1 ? d : 0);
+
+    has_fill_value[d] = m.has_attribute("_FillValue");
+    if (has_fill_value[d]) {
+      fill_value[d] = m.get_number("_FillValue");
+    }
+  }
+
+  const bool sub_sample = dynamic_cast<const IceModelVec2Int*>(&input) != nullptr;
+
+  petsc::DMDAVecArrayDOF
+    input_array(da, local),
+    output_array(result->dm(), result->vec());
+
+  double
+    ***a = static_cast<double***>(input_array.get()),
+    ***b = static_cast<double***>(output_array.get());
+
+  for (Points p(*grid); p; p.next()) {
+    const int
+      I  = p.i(),
+      J  = p.j(),
+      i0 = I * k,
+      j0 = J * k;
+
+    for (unsigned int d = 0; d < N; ++d) {
+      if (sub_sample) {
+        b[J][I][d] = a[j0][i0][d];
+        continue;
+      }
+
+      double sum = 0.0;
+      int n = 0;
+      for (unsigned int m = 0; m < k; ++m) {
+        for (unsigned int l = 0; l < k; ++l) {
+          double v = a[j0 + m][i0 + l][d];
+
+          if (has_fill_value[d] and v == fill_value[d]) {
+            continue;
+          }
+
+          sum += v;
+          n += 1;
+        }
+      }
+
+      b[J][I][d] = n > 0 ? sum / n : fill_value[d];
+    }
+  }
+
+  return result;
+}
+
+} // end of namespace pism
@@ -0,0 +1,56 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_COARSENING_H
+#define PISM_COARSENING_H
+
+#include "pism/util/IceGrid.hh"
+#include "pism/util/iceModelVec.hh"
+
+namespace pism {
+
+/*!
+ * Create a grid covering the same domain as `grid`, with cells that are `factor` times
+ * bigger in both horizontal directions.
+ *
+ * The coarse cell `(I, J)` covers fine cells `(I * factor + a, J * factor + b)`, `0 <= a,
+ * b < factor`. It is owned by the process owning the fine cell `(I * factor, J *
+ * factor)`, so coarsening requires communication with immediate neighbors only.
+ */
+IceGrid::Ptr coarse_grid(const IceGrid &grid, unsigned int factor);
+
+/*!
+ * Create a grid covering the same domain as `grid`, with grid spacing `factor` times
+ * smaller in both horizontal directions and the same vertical grid.
+ *
+ * Fields are transferred to this grid using IceModelVec::regrid(const IceModelVec&).
+ */
+IceGrid::Ptr refined_grid(const IceGrid &grid, unsigned int factor);
+
+/*!
+ * Compute block means of `input` on `grid` (created using coarse_grid()).
+ *
+ * Fine grid values equal to `_FillValue` (if set) are ignored. Integer-valued fields
+ * (IceModelVec2Int) are sub-sampled instead.
+ */
+IceModelVec::Ptr coarsen(const IceModelVec &input, IceGrid::ConstPtr grid);
+
+} // end of namespace pism
+
+#endif /* PISM_COARSENING_H */
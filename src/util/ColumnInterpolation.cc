@@ -1,4 +1,4 @@
-/* Copyright (C) 2014, 2015 PISM Authors
+/* Copyright (C) 2014, 2015, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,6 +20,7 @@
 #include "ColumnInterpolation.hh"
 
 #include <cmath>
+#include <algorithm>            // std::min
 
 namespace pism {
 
@@ -44,79 +45,133 @@ void ColumnInterpolation::coarse_to_fine(const double *input, unsigned int ks, d
   }
 }
 
-void ColumnInterpolation::coarse_to_fine_linear(const double *input, unsigned int ks,
-                                                double *result) const {
-  const unsigned int Mzfine = Mz_fine();
-  const unsigned int Mzcoarse = Mz_coarse();
-
-  for (unsigned int k = 0; k < Mzfine; ++k) {
-    if (k > ks) {
-      result[k] = input[m_coarse2fine[k]];
-      continue;
+/*!
+ * Interpolate `n_columns` columns sharing the same `ks` (e.g. several fields in one
+ * column or the same field in neighboring columns).
+ *
+ * With linear interpolation all columns are processed in one loop for each fine level.
+ */
+void ColumnInterpolation::coarse_to_fine(const double *const *input, unsigned int n_columns,
+                                         unsigned int ks, double *const *result) const {
+  if (not m_use_linear_interpolation) {
+    for (unsigned int c = 0; c < n_columns; ++c) {
+      coarse_to_fine_quadratic(input[c], ks, result[c]);
     }
+    return;
+  }
+
+  const unsigned int
+    Mzfine   = Mz_fine(),
+    Mzcoarse = Mz_coarse(),
+    K        = std::min(ks + 1, Mzfine),
+    N        = std::min(K, m_c2f_end);
 
-    unsigned int m = m_coarse2fine[k];
+  for (unsigned int k = 0; k < N; ++k) {
+    const unsigned int m = m_coarse2fine[k];
+    const double incr = m_c2f_weight[k];
 
+    for (unsigned int c = 0; c < n_columns; ++c) {
+      const double *f = input[c];
+      result[c][k] = f[m] + incr * (f[m + 1] - f[m]);
+    }
+  }
+
+  for (unsigned int c = 0; c < n_columns; ++c) {
     // extrapolate (if necessary):
-    if (m == Mzcoarse - 1) {
-      result[k] = input[Mzcoarse - 1];
-      continue;
+    for (unsigned int k = N; k < K; ++k) {
+      result[c][k] = input[c][Mzcoarse - 1];
+    }
+
+    for (unsigned int k = K; k < Mzfine; ++k) {
+      result[c][k] = input[c][m_coarse2fine[k]];
     }
+  }
+}
+
+void ColumnInterpolation::coarse_to_fine_linear(const double *input, unsigned int ks,
+                                                double *result) const {
+  const unsigned int
+    Mzfine   = Mz_fine(),
+    Mzcoarse = Mz_coarse(),
+    K        = std::min(ks + 1, Mzfine),
+    N        = std::min(K, m_c2f_end);
+
+  for (unsigned int k = 0; k < N; ++k) {
+    const unsigned int m = m_coarse2fine[k];
+    result[k] = input[m] + m_c2f_weight[k] * (input[m + 1] - input[m]);
+  }
+
+  // extrapolate (if necessary):
+  for (unsigned int k = N; k < K; ++k) {
+    result[k] = input[Mzcoarse - 1];
+  }
 
-    const double incr = (m_z_fine[k] - m_z_coarse[m]) / (m_z_coarse[m + 1] - m_z_coarse[m]);
-    result[k] = input[m] + incr * (input[m + 1] - input[m]);
+  for (unsigned int k = K; k < Mzfine; ++k) {
+    result[k] = input[m_coarse2fine[k]];
   }
 }
 
+/*!
+ * Quadratic interpolation (levels `0, ..., ks` only).
+ *
+ * Each piece of the interpolant is written as `s * (a + b * s) + c`, where `s` is the
+ * distance from the bottom of the piece, and its coefficients are computed once per
+ * call.
+ */
 void ColumnInterpolation::coarse_to_fine_quadratic(const double *input, unsigned int ks,
                                                    double *result) const {
-  unsigned int k = 0, m = 0;
-  const unsigned int Mz = Mz_coarse();
-  for (m = 0; m < Mz - 2 and k <= ks; ++m) {
-
-    const double
-      z0      = m_z_coarse[m],
-      z1      = m_z_coarse[m + 1],
-      dz_inv  = m_constants[3 * m + 0], // = 1.0 / (z1 - z0)
-      dz1_inv = m_constants[3 * m + 1], // = 1.0 / (z2 - z0)
-      dz2_inv = m_constants[3 * m + 2], // = 1.0 / (z2 - z1)
-      f0      = input[m],
-      f1      = input[m + 1],
-      f2      = input[m + 2];
-
-    const double
-      d1 = (f1 - f0) * dz_inv,
-      d2 = (f2 - f0) * dz1_inv,
-      b  = (d2 - d1) * dz2_inv,
-      a  = d1 - b * (z1 - z0),
-      c  = f0;
-
-    for (; m_z_fine[k] < z1 and k <= ks; ++k) {
-      const double s = m_z_fine[k] - z0;
-
-      result[k] = s * (a + b * s) + c;
+  const unsigned int
+    Mz = Mz_coarse(),
+    K  = std::min(ks + 1, Mz_fine());
+
+  unsigned int piece = Mz;      // invalid, i.e. not computed yet
+  double a = 0.0, b = 0.0, c = 0.0;
+
+  for (unsigned int k = 0; k < K; ++k) {
+    const unsigned int m = m_c2f_piece[k];
+
+    if (m != piece) {
+      piece = m;
+
+      if (m < Mz - 2) {
+        const double
+          z0      = m_z_coarse[m],
+          z1      = m_z_coarse[m + 1],
+          dz_inv  = m_constants[3 * m + 0], // = 1.0 / (z1 - z0)
+          dz1_inv = m_constants[3 * m + 1], // = 1.0 / (z2 - z0)
+          dz2_inv = m_constants[3 * m + 2], // = 1.0 / (z2 - z1)
+          f0      = input[m],
+          f1      = input[m + 1],
+          f2      = input[m + 2];
+
+        const double
+          d1 = (f1 - f0) * dz_inv,
+          d2 = (f2 - f0) * dz1_inv;
+
+        b = (d2 - d1) * dz2_inv;
+        a = d1 - b * (z1 - z0);
+        c = f0;
+      } else if (m == Mz - 2) {
+        // linear interpolation between the remaining 2 coarse levels
+        const double
+          z0 = m_z_coarse[m],
+          z1 = m_z_coarse[m + 1],
+          f0 = input[m],
+          f1 = input[m + 1];
+
+        a = (f1 - f0) / (z1 - z0);
+        b = 0.0;
+        c = f0;
+      } else {
+        // constant extrapolation
+        a = 0.0;
+        b = 0.0;
+        c = input[Mz - 1];
+      }
     }
-  } // m-loop
-
-  // check if we got to the end of the m-loop and use linear
-  // interpolation between the remaining 2 coarse levels
-  if (m == Mz - 2) {
-    const double
-      z0 = m_z_coarse[m],
-      z1 = m_z_coarse[m + 1],
-      f0 = input[m],
-      f1 = input[m + 1],
-      lambda = (f1 - f0) / (z1 - z0);
-
-    for (; m_z_fine[k] < z1; ++k) {
-      result[k] = f0 + lambda * (m_z_fine[k] - z0);
-    }
-  }
 
-  // fill the rest using constant extrapolation
-  const double f0 = input[Mz - 1];
-  for (; k <= ks; ++k) {
-    result[k] = f0;
+    const double s = m_c2f_s[k];
+    result[k] = s * (a + b * s) + c;
   }
 }
 
@@ -132,8 +187,7 @@ void ColumnInterpolation::fine_to_coarse(const double *input, double *result) co
   for (unsigned int k = 0; k < N - 1; ++k) {
     const int m = m_fine2coarse[k];
 
-    const double increment = (m_z_coarse[k] - m_z_fine[m]) / (m_z_fine[m + 1] - m_z_fine[m]);
-    result[k] = input[m] + increment * (input[m + 1] - input[m]);
+    result[k] = input[m] + m_f2c_weight[k] * (input[m + 1] - input[m]);
   }
 
   result[N - 1] = input[m_fine2coarse[N - 1]];
@@ -207,6 +261,55 @@ void ColumnInterpolation::init_interpolation() {
   // fine -> coarse
   m_fine2coarse = init_interpolation_indexes(m_z_fine, m_z_coarse);
 
+  const unsigned int
+    Mzfine   = Mz_fine(),
+    Mzcoarse = Mz_coarse();
+
+  // linear interpolation weights (coarse -> fine)
+  m_c2f_weight.resize(Mzfine, 0.0);
+  m_c2f_end = Mzfine;
+  for (unsigned int k = 0; k < Mzfine; ++k) {
+    const unsigned int m = m_coarse2fine[k];
+
+    if (m == Mzcoarse - 1) {
+      m_c2f_end = k;
+      break;
+    }
+
+    m_c2f_weight[k] = (m_z_fine[k] - m_z_coarse[m]) / (m_z_coarse[m + 1] - m_z_coarse[m]);
+  }
+
+  // linear interpolation weights (fine -> coarse)
+  m_f2c_weight.resize(Mzcoarse, 0.0);
+  for (unsigned int k = 0; k + 1 < Mzcoarse; ++k) {
+    const unsigned int m = m_fine2coarse[k];
+
+    if (m + 1 < Mzfine) {
+      m_f2c_weight[k] = (m_z_coarse[k] - m_z_fine[m]) / (m_z_fine[m + 1] - m_z_fine[m]);
+    }
+  }
+
+  // pieces of the quadratic interpolant (coarse -> fine)
+  m_c2f_piece.resize(Mzfine);
+  m_c2f_s.resize(Mzfine);
+  {
+    unsigned int m = 0;
+    for (unsigned int k = 0; k < Mzfine; ++k) {
+      while (m < Mzcoarse - 2 and not (m_z_fine[k] < m_z_coarse[m + 1])) {
+        ++m;
+      }
+
+      if (m == Mzcoarse - 2 and not (m_z_fine[k] < m_z_coarse[m + 1])) {
+        // above the top coarse level
+        m_c2f_piece[k] = Mzcoarse - 1;
+        m_c2f_s[k]     = 0.0;
+      } else {
+        m_c2f_piece[k] = m;
+        m_c2f_s[k]     = m_z_fine[k] - m_z_coarse[m];
+      }
+    }
+  }
+
   // decide if we're going to use linear or quadratic interpolation
   double dz_min = m_z_coarse.back();
   double dz_max = 0.0;
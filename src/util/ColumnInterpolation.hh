@@ -1,4 +1,4 @@
-/* Copyright (C) 2014, 2015 PISM Authors
+/* Copyright (C) 2014, 2015, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -32,6 +32,9 @@ public:
   void coarse_to_fine(const double *input, unsigned int ks, double *result) const;
   void fine_to_coarse(const double *input, double *result) const;
 
+  void coarse_to_fine(const double *const *input, unsigned int n_columns, unsigned int ks,
+                      double *const *result) const;
+
   // These two methods allocate fresh storage for the output.
   std::vector<double> coarse_to_fine(const std::vector<double> &input, unsigned int ks) const;
   std::vector<double> fine_to_coarse(const std::vector<double> &input) const;
@@ -53,6 +56,22 @@ private:
   std::vector<unsigned int> m_coarse2fine, m_fine2coarse;
   bool m_use_linear_interpolation;
 
+  // Precomputed stencils (these do not depend on ks, which only truncates them):
+
+  // linear interpolation weights for fine levels below m_c2f_end; fine levels at and
+  // above m_c2f_end are above the top coarse level
+  std::vector<double> m_c2f_weight;
+  unsigned int m_c2f_end;
+
+  // quadratic interpolation: the piece of the interpolant used at each fine level (a
+  // parabola for pieces 0, ..., Mz_coarse() - 3, a linear function for Mz_coarse() - 2
+  // and a constant for Mz_coarse() - 1) and the distance from the bottom of the piece
+  std::vector<unsigned int> m_c2f_piece;
+  std::vector<double> m_c2f_s;
+
+  // linear interpolation weights (fine -> coarse)
+  std::vector<double> m_f2c_weight;
+
   void init_interpolation();
   void coarse_to_fine_linear(const double *input, unsigned int ks, double *result) const;
   void coarse_to_fine_quadratic(const double *input, unsigned int ks, double *result) const;
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 PISM Authors
+// Copyright (C) 2004-2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -16,6 +16,7 @@
 // along with PISM; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <algorithm>            // std::copy
 #include <cassert>
 #include <fstream>
 #include <iostream>
@@ -240,6 +241,117 @@ std::string TridiagonalSystem::prefix() const {
   return m_prefix;
 }
 
+//! Allocate storage for `batch_size` systems of size at most `max_size`.
+TridiagonalSystemBatch::TridiagonalSystemBatch(unsigned int max_size, unsigned int batch_size)
+  : m_max_system_size(max_size), m_batch_size(batch_size) {
+  assert(m_max_system_size >= 1 && m_max_system_size < 1e6);
+  assert(m_batch_size >= 1);
+
+  const size_t N = m_max_system_size * m_batch_size;
+
+  m_size.resize(m_batch_size, 0);
+  m_L.resize(N);
+  m_D.resize(N);
+  m_U.resize(N);
+  m_rhs.resize(N);
+  m_work.resize(N);
+  m_x.resize(N);
+  m_b.resize(m_batch_size);
+}
+
+unsigned int TridiagonalSystemBatch::batch_size() const {
+  return m_batch_size;
+}
+
+//! Set the size of the system `lane`. Has to be called *after* setting its rows.
+/*!
+ * Rows `system_size` and above are replaced by the identity and the upper-diagonal entry of
+ * the last row is set to zero, decoupling padding from the system itself.
+ */
+void TridiagonalSystemBatch::set_size(unsigned int lane, unsigned int system_size) {
+  assert(lane < m_batch_size);
+  assert(system_size >= 1 and system_size <= m_max_system_size);
+
+  m_size[lane] = system_size;
+
+  U(system_size - 1, lane) = 0.0;
+  for (unsigned int k = system_size; k < m_max_system_size; ++k) {
+    L(k, lane)   = 0.0;
+    D(k, lane)   = 1.0;
+    U(k, lane)   = 0.0;
+    RHS(k, lane) = 0.0;
+  }
+}
+
+//! Solve systems in lanes `0, ..., n_systems - 1`.
+/*!
+ * Returns the index of the first system with a zero pivot or -1 if all systems were solved.
+ * (Use TridiagonalSystem to solve a system that failed to get a detailed error message.)
+ */
+int TridiagonalSystemBatch::solve(unsigned int n_systems) {
+  assert(n_systems <= m_batch_size);
+
+  const unsigned int W = m_batch_size;
+
+  unsigned int max_size = 0;
+  for (unsigned int l = 0; l < n_systems; ++l) {
+    max_size = std::max(max_size, m_size[l]);
+  }
+
+  double
+    *L    = m_L.data(),
+    *D    = m_D.data(),
+    *U    = m_U.data(),
+    *rhs  = m_rhs.data(),
+    *work = m_work.data(),
+    *x    = m_x.data(),
+    *b    = m_b.data();
+
+  int zero_pivot = 0;
+
+  for (unsigned int l = 0; l < n_systems; ++l) {
+    b[l]  = D[l];
+    x[l]  = rhs[l] / b[l];
+    zero_pivot |= (b[l] == 0.0);
+  }
+
+  for (unsigned int k = 1; k < max_size; ++k) {
+    const unsigned int r = k * W, r_prev = (k - 1) * W;
+    for (unsigned int l = 0; l < n_systems; ++l) {
+      work[r + l] = U[r_prev + l] / b[l];
+
+      b[l] = D[r + l] - L[r + l] * work[r + l];
+
+      zero_pivot |= (b[l] == 0.0);
+
+      x[r + l] = (rhs[r + l] - L[r + l] * x[r_prev + l]) / b[l];
+    }
+  }
+
+  if (zero_pivot) {
+    // find the first system that failed
+    for (unsigned int l = 0; l < n_systems; ++l) {
+      for (unsigned int k = 0; k < m_size[l]; ++k) {
+        const double b_k = (k == 0 ?
+                            D[l] :
+                            D[k * W + l] - L[k * W + l] * work[k * W + l]);
+        if (b_k == 0.0) {
+          return l;
+        }
+      }
+    }
+  }
+
+  for (int k = (int)max_size - 2; k >= 0; --k) {
+    const unsigned int r = k * W, r_next = (k + 1) * W;
+    for (unsigned int l = 0; l < n_systems; ++l) {
+      x[r + l] -= work[r_next + l] * x[r_next + l];
+    }
+  }
+
+  return -1;
+}
+
 //! A column system is a kind of a tridiagonal system.
 columnSystemCtx::columnSystemCtx(const std::vector<double>& storage_grid,
                                  const std::string &prefix,
@@ -257,6 +369,7 @@ columnSystemCtx::columnSystemCtx(const std::vector<double>& storage_grid,
   m_solver = new TridiagonalSystem(m_z.size(), prefix);
 
   m_interp = new ColumnInterpolation(storage_grid, m_z);
+  m_velocity_interp = new ColumnInterpolation(u3.levels(), m_z);
 
   m_u.resize(m_z.size());
   m_v.resize(m_z.size());
@@ -266,6 +379,7 @@ columnSystemCtx::columnSystemCtx(const std::vector<double>& storage_grid,
 columnSystemCtx::~columnSystemCtx() {
   delete m_solver;
   delete m_interp;
+  delete m_velocity_interp;
 }
 
 unsigned int columnSystemCtx::ks() const {
@@ -292,6 +406,32 @@ void columnSystemCtx::coarse_to_fine(const IceModelVec3 &coarse, int i, int j,
   m_interp->coarse_to_fine(array, m_ks, fine);
 }
 
+//! Interpolate `coarse` in the column `i, j` and its four neighbors (in one call).
+void columnSystemCtx::coarse_to_fine(const IceModelVec3 &coarse, int i, int j,
+                                     double *fine, double *fine_n, double *fine_e,
+                                     double *fine_s, double *fine_w) const {
+  const double *input[] = {coarse.get_column(i, j),
+                           coarse.get_column(i, j + 1),
+                           coarse.get_column(i + 1, j),
+                           coarse.get_column(i, j - 1),
+                           coarse.get_column(i - 1, j)};
+  double *const result[] = {fine, fine_n, fine_e, fine_s, fine_w};
+
+  m_interp->coarse_to_fine(input, 5, m_ks, result);
+}
+
+/*!
+ * Interpolate `input` (a 3D velocity component or a field using the same vertical levels)
+ * in the column `i, j` to the fine grid.
+ *
+ * 3D velocity may use a subset of levels of the storage grid (see the configuration
+ * parameter `stress_balance.Mz`).
+ */
+void columnSystemCtx::velocity_to_fine(const IceModelVec3 &input, int i, int j,
+                                       double *fine) const {
+  m_velocity_interp->coarse_to_fine(input.get_column(i, j), m_ks, fine);
+}
+
 void columnSystemCtx::init_fine_grid(const std::vector<double>& storage_grid) {
   // Compute m_dz as the minimum vertical spacing in the coarse
   // grid:
@@ -313,6 +453,28 @@ void columnSystemCtx::init_fine_grid(const std::vector<double>& storage_grid) {
   // Note that it *is* allowed to go over Lz.
 }
 
+/*!
+ * Copy ice velocity on the fine grid from `source`, a system (using the same storage
+ * grid) initialized for the same column. Skips the vertical component if `copy_w` is
+ * false.
+ *
+ * Call this after init_column().
+ */
+void columnSystemCtx::copy_velocity(const columnSystemCtx &source, bool copy_w) {
+  assert(source.m_i == m_i and source.m_j == m_j and source.m_ks == m_ks);
+  assert(source.m_z.size() == m_z.size());
+
+  const unsigned int N = m_ks + 1;
+
+  std::copy(source.m_u.begin(), source.m_u.begin() + N, m_u.begin());
+  std::copy(source.m_v.begin(), source.m_v.begin() + N, m_v.begin());
+  if (copy_w) {
+    std::copy(source.m_w.begin(), source.m_w.begin() + N, m_w.begin());
+  } else {
+    velocity_to_fine(m_w3, m_i, m_j, &m_w[0]);
+  }
+}
+
 void columnSystemCtx::init_column(int i, int j,
                                   double ice_thickness) {
   m_i  = i;
@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016, 2019 PISM Authors
+// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -131,6 +131,48 @@ private:
   std::string m_prefix;
 };
 
+//! A batch of independent tridiagonal systems stored in the "structure of arrays" layout.
+/*!
+  Entries of the row `k` of the system `lane` are stored at `k * batch_size() + lane`, so
+  that the Thomas algorithm processes all systems in a batch in one (vectorizable) loop
+  over lanes for each row.
+
+  Systems in a batch may have different sizes: rows past the end of a system are
+  replaced by the identity. This does not change results, i.e. each system is solved
+  using exactly the same operations as in TridiagonalSystem::solve().
+*/
+class TridiagonalSystemBatch {
+public:
+  TridiagonalSystemBatch(unsigned int max_size, unsigned int batch_size);
+
+  unsigned int batch_size() const;
+
+  void set_size(unsigned int lane, unsigned int system_size);
+
+  int solve(unsigned int n_systems);
+
+  double& L(size_t k, size_t lane) {
+    return m_L[k * m_batch_size + lane];
+  }
+  double& D(size_t k, size_t lane) {
+    return m_D[k * m_batch_size + lane];
+  }
+  double& U(size_t k, size_t lane) {
+    return m_U[k * m_batch_size + lane];
+  }
+  double& RHS(size_t k, size_t lane) {
+    return m_rhs[k * m_batch_size + lane];
+  }
+  //! Solution in row `k` of the system `lane` (valid after solve()).
+  double x(size_t k, size_t lane) const {
+    return m_x[k * m_batch_size + lane];
+  }
+private:
+  unsigned int m_max_system_size, m_batch_size;
+  std::vector<unsigned int> m_size;
+  std::vector<double> m_L, m_D, m_U, m_rhs, m_work, m_x, m_b;
+};
+
 class IceModelVec3;
 class ColumnInterpolation;
 
@@ -153,10 +195,14 @@ public:
   const std::vector<double>& z() const;
   void fine_to_coarse(const std::vector<double> &fine, int i, int j,
                       IceModelVec3& coarse) const;
+
+  void copy_velocity(const columnSystemCtx &source, bool copy_w);
 protected:
   TridiagonalSystem *m_solver;
 
   ColumnInterpolation *m_interp;
+  //! interpolation from levels of 3D velocity fields (see stress_balance.Mz) to the fine grid
+  ColumnInterpolation *m_velocity_interp;
 
   //! current system size; corresponds to the highest vertical level within the ice
   unsigned int m_ks;
@@ -184,6 +230,11 @@ protected:
   void init_fine_grid(const std::vector<double>& storage_grid);
 
   void coarse_to_fine(const IceModelVec3 &coarse, int i, int j, double* fine) const;
+  void coarse_to_fine(const IceModelVec3 &coarse, int i, int j,
+                      double *fine, double *fine_n, double *fine_e,
+                      double *fine_s, double *fine_w) const;
+
+  void velocity_to_fine(const IceModelVec3 &input, int i, int j, double *fine) const;
 };
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2008-2019 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2008-2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -29,6 +29,7 @@
 #include "ConfigInterface.hh"
 #include "MaxTimestep.hh"
 #include "pism/util/Time.hh"
+#include "pism/util/RegriddingSource.hh"
 
 namespace pism {
 
@@ -150,6 +151,9 @@ void Component::write_model_state_impl(const File &output) const {
  *            variable is only regridded if both `-regrid_file` and
  *            `-regrid_vars` are set *and* the name of the variable is
  *            found in the set of names given with `-regrid_vars`.
+ *
+ * If the grid has a regridding source (see IceGrid::set_regridding_source()), interpolate
+ * from it instead, regardless of `flag`.
  */
 void Component::regrid(const std::string &module_name, IceModelVec &variable,
                        RegriddingFlag flag) {
@@ -157,19 +161,43 @@ void Component::regrid(const std::string &module_name, IceModelVec &variable,
   auto regrid_file = m_config->get_string("input.regrid.file");
   auto regrid_vars = set_split(m_config->get_string("input.regrid.vars"), ',');
 
-  if (regrid_file.empty()) {
+  const RegriddingSource *source = m_grid->regridding_source();
+
+  if (regrid_file.empty() and source == nullptr) {
     return;
   }
 
   SpatialVariableMetadata &m = variable.metadata();
 
-  if (((not regrid_vars.empty()) and member(m.get_string("short_name"), regrid_vars)) or
+  const std::string name = m.get_string("short_name");
+
+  // when refining a grid all model state variables available in the source are
+  // interpolated by default
+  if (source != nullptr and (regrid_vars.empty() or member(name, regrid_vars))) {
+    const IceModelVec *field = source->get(name);
+
+    if (field != nullptr) {
+      m_log->message(2,
+                     "  %s: interpolating '%s' from the %d x %d grid ...\n",
+                     module_name.c_str(), name.c_str(),
+                     field->grid()->Mx(), field->grid()->My());
+
+      variable.regrid(*field);
+      return;
+    }
+  }
+
+  if (regrid_file.empty()) {
+    return;
+  }
+
+  if (((not regrid_vars.empty()) and member(name, regrid_vars)) or
       (regrid_vars.empty() and flag == REGRID_WITHOUT_REGRID_VARS)) {
 
     m_log->message(2,
                "  %s: regridding '%s' from file '%s' ...\n",
                module_name.c_str(),
-               m.get_string("short_name").c_str(), regrid_file.c_str());
+               name.c_str(), regrid_file.c_str());
 
     variable.regrid(regrid_file, CRITICAL);
   }
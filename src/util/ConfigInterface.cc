@@ -53,7 +53,8 @@ struct Config::Impl {
 };
 
 Config::Config(units::System::Ptr system)
-  : m_impl(new Impl(system)) {
+  : m_impl(new Impl(system)),
+    m_revision(0) {
   // empty
 }
 
@@ -69,6 +70,7 @@ void Config::read(MPI_Comm com, const std::string &filename) {
 
 void Config::read(const File &file) {
   this->read_impl(file);
+  m_revision += 1;
 
   m_impl->filename = file.filename();
 }
@@ -177,7 +179,8 @@ std::vector<double> Config::get_numbers(const std::string &name,
   auto input_units = this->units(name);
 
   try {
-    units::Converter converter(m_impl->unit_system, input_units, units);
+    const units::Converter &converter = *units::converter(m_impl->unit_system,
+                                                          input_units, units);
     for (unsigned int k = 0; k < value.size(); ++k) {
       value[k] = converter(value[k]);
     }
@@ -204,6 +207,7 @@ void Config::set_number(const std::string &name, double value,
   }
 
   this->set_number_impl(name, value);
+  m_revision += 1;
 }
 
 void Config::set_numbers(const std::string &name,
@@ -222,6 +226,7 @@ void Config::set_numbers(const std::string &name,
   }
 
   this->set_numbers_impl(name, values);
+  m_revision += 1;
 }
 
 Config::Strings Config::all_strings() const {
@@ -251,6 +256,7 @@ void Config::set_string(const std::string &name,
   }
 
   this->set_string_impl(name, value);
+  m_revision += 1;
 }
 
 Config::Flags Config::all_flags() const {
@@ -279,6 +285,7 @@ void Config::set_flag(const std::string& name, bool value,
   }
 
   this->set_flag_impl(name, value);
+  m_revision += 1;
 }
 
 static bool special_parameter(const std::string &name) {
@@ -777,7 +784,13 @@ void set_config_from_options(Config &config) {
 }
 
 //! Create a configuration database using command-line options.
-Config::Ptr config_from_options(MPI_Comm com, const Logger &log, units::System::Ptr sys) {
+/*!
+ * If `ensemble_member` is not negative, parameters stored in the variable
+ * `pism_overrides_N` (N is the member index) in the file specified using
+ * `-ensemble_config` override both `-config_override` and command-line options.
+ */
+Config::Ptr config_from_options(MPI_Comm com, const Logger &log, units::System::Ptr sys,
+                                int ensemble_member) {
 
   DefaultConfig::Ptr config(new DefaultConfig(com, "pism_config", "-config", sys)),
     overrides(new DefaultConfig(com, "pism_overrides", "-config_override", sys));
@@ -786,6 +799,21 @@ Config::Ptr config_from_options(MPI_Comm com, const Logger &log, units::System::
   config->import_from(*overrides);
   set_config_from_options(*config);
 
+  if (ensemble_member >= 0) {
+    options::String ensemble_config("-ensemble_config",
+                                    "Name of the file containing parameters of ensemble members");
+    if (ensemble_config.is_set()) {
+      auto name = pism::printf("pism_overrides_%d", ensemble_member);
+
+      NetCDFConfig member(com, name, sys);
+      member.read(com, ensemble_config);
+      config->import_from(member);
+
+      log.message(2, "Ensemble member %d: read parameters from %s in '%s'.\n",
+                  ensemble_member, name.c_str(), ensemble_config->c_str());
+    }
+  }
+
   return config;
 }
 
@@ -814,6 +842,33 @@ void ConfigWithPrefix::reset_prefix(const std::string &prefix) {
   m_prefix = prefix;
 }
 
+template<>
+void ConfigParameter<double>::update(Config::UseFlag flag) const {
+  if (m_units.empty()) {
+    m_value = m_config->get_number(m_name, flag);
+  } else {
+    m_value = m_config->get_number(m_name, m_units, flag);
+  }
+  m_revision = m_config->revision();
+}
+
+template<>
+void ConfigParameter<bool>::update(Config::UseFlag flag) const {
+  m_value    = m_config->get_flag(m_name, flag);
+  m_revision = m_config->revision();
+}
+
+template<typename T>
+ConfigParameter<T>::ConfigParameter(Config::ConstPtr config, const std::string &name,
+                                    const std::string &units)
+  : m_config(config), m_name(name), m_units(units) {
+  // only the first lookup counts as a "use" of this parameter
+  update(Config::REMEMBER_THIS_USE);
+}
+
+template class ConfigParameter<double>;
+template class ConfigParameter<bool>;
+
 std::set<std::string> Config::keys() const {
   std::set<std::string> result;
 
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -120,6 +120,11 @@ public:
   std::string type(const std::string &parameter) const;
   std::string option(const std::string &parameter) const;
   std::string choices(const std::string &parameter) const;
+
+  //! Revision number of the database. Incremented every time a parameter changes.
+  int revision() const {
+    return m_revision;
+  }
   // Implementations
 protected:
   virtual void read_impl(const File &nc) = 0;
@@ -146,6 +151,39 @@ protected:
 private:
   struct Impl;
   Impl *m_impl;
+  int m_revision;
+};
+
+//! A handle to a number or a flag in a configuration database.
+/*!
+ * Looks up a parameter once (and records its use) when created, then returns the cached
+ * value. The cache is refreshed only if the database changed since the last lookup (see
+ * Config::revision()), so reading a parameter takes an integer comparison instead of a
+ * string lookup. Use these in methods that are called every time step.
+ *
+ * `T` is `double` or `bool`.
+ */
+template<typename T>
+class ConfigParameter {
+public:
+  //! Create a handle to `name`, converting to `units` if set (numbers only).
+  ConfigParameter(Config::ConstPtr config, const std::string &name,
+                  const std::string &units = "");
+
+  T value() const {
+    if (m_revision != m_config->revision()) {
+      update(Config::FORGET_THIS_USE);
+    }
+    return m_value;
+  }
+private:
+  void update(Config::UseFlag flag) const;
+
+  Config::ConstPtr m_config;
+  std::string m_name;
+  std::string m_units;
+  mutable T m_value;
+  mutable int m_revision;
 };
 
 class ConfigWithPrefix {
@@ -166,7 +204,8 @@ private:
   Config::ConstPtr m_config;
 };
 
-Config::Ptr config_from_options(MPI_Comm com, const Logger &log, units::System::Ptr unit_system);
+Config::Ptr config_from_options(MPI_Comm com, const Logger &log, units::System::Ptr unit_system,
+                                int ensemble_member = -1);
 
 //! Set configuration parameters using command-line options.
 void set_config_from_options(Config &config);
@@ -1,4 +1,4 @@
-/* Copyright (C) 2014, 2015, 2017, 2019 PISM Authors
+/* Copyright (C) 2014, 2015, 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,14 +17,19 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <vector>
+
 #include "Context.hh"
 #include "Profiling.hh"
+#include "MemoryTracker.hh"
+#include "Memo.hh"
 #include "Units.hh"
 #include "Config.hh"
 #include "Time.hh"
 #include "Logger.hh"
 #include "pism/util/EnthalpyConverter.hh"
 #include "pism/util/error_handling.hh"
+#include "pism/util/io/File.hh"
 #include "pism/pism_config.hh"
 
 #if (Pism_USE_PIO==1)
@@ -35,6 +40,9 @@
 
 namespace pism {
 
+//! ParallelIO I/O system using dedicated I/O tasks (see pio_async_init()).
+static int g_pio_async_iosys_id = -1;
+
 class Context::Impl {
 public:
   Impl(MPI_Comm c,
@@ -55,6 +63,8 @@ public:
   TimePtr time;
   std::string prefix;
   Profiling profiling;
+  MemoryTracker memory;
+  MemoStatistics memo;
   LoggerPtr logger;
   int pio_iosys_id;
 };
@@ -70,7 +80,9 @@ Context::Context(MPI_Comm c, UnitsSystemPtr sys,
 Context::~Context() {
 
 #if (Pism_USE_PIO==1)
+  // the asynchronous I/O system is shared and de-allocated by pio_async_finalize()
   if (m_impl->pio_iosys_id != -1 and
+      m_impl->pio_iosys_id != g_pio_async_iosys_id and
       PIOc_free_iosystem(m_impl->pio_iosys_id) != PIO_NOERR) {
     m_impl->logger->message(1, "Error: failed to de-allocate a ParallelIO I/O system\n");
   }
@@ -127,6 +139,14 @@ const Profiling& Context::profiling() const {
   return m_impl->profiling;
 }
 
+const MemoryTracker& Context::memory() const {
+  return m_impl->memory;
+}
+
+const MemoStatistics& Context::memo() const {
+  return m_impl->memo;
+}
+
 Context::ConstLoggerPtr Context::log() const {
   return m_impl->logger;
 }
@@ -140,6 +160,10 @@ Context::LoggerPtr Context::log() {
  */
 int Context::pio_iosys_id() const {
 #if (Pism_USE_PIO==1)
+  if (m_impl->pio_iosys_id == -1 and g_pio_async_iosys_id != -1) {
+    m_impl->pio_iosys_id = g_pio_async_iosys_id;
+  }
+
   if (m_impl->pio_iosys_id == -1) {
     int ierr = PIOc_set_iosystem_error_handling(PIO_DEFAULT, PIO_BCAST_ERROR, NULL);
     if (ierr != 0) {
@@ -168,7 +192,98 @@ int Context::pio_iosys_id() const {
   return m_impl->pio_iosys_id;
 }
 
-Context::Ptr context_from_options(MPI_Comm com, const std::string &prefix) {
+/*!
+ * Start ParallelIO in the asynchronous mode, using the last `n_io_tasks` processes in
+ * `com` as dedicated I/O tasks.
+ *
+ * Returns the communicator containing the remaining (compute) processes. Contexts using
+ * this communicator send all ParallelIO output to I/O tasks.
+ *
+ * On I/O tasks this call returns MPI_COMM_NULL, but only after *all* compute tasks called
+ * pio_async_finalize().
+ */
+MPI_Comm pio_async_init(MPI_Comm com, int n_io_tasks) {
+#if (Pism_USE_PIO==1)
+  int size = 0;
+  MPI_Comm_size(com, &size);
+
+  if (n_io_tasks < 1 or n_io_tasks >= size) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot use %d of %d processes as ParallelIO I/O tasks",
+                                  n_io_tasks, size);
+  }
+
+  if (g_pio_async_iosys_id != -1) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "ParallelIO is already running in the asynchronous mode");
+  }
+
+  std::vector<int> io_tasks(n_io_tasks), compute_tasks(size - n_io_tasks);
+  for (int k = 0; k < n_io_tasks; ++k) {
+    io_tasks[k] = size - n_io_tasks + k;
+  }
+  for (int k = 0; k < size - n_io_tasks; ++k) {
+    compute_tasks[k] = k;
+  }
+
+  int n_compute_tasks = size - n_io_tasks;
+  int *compute_task_list = compute_tasks.data();
+  MPI_Comm io_comm = MPI_COMM_NULL, compute_comm = MPI_COMM_NULL;
+  int iosys_id = -1;
+
+  int ierr = PIOc_set_iosystem_error_handling(PIO_DEFAULT, PIO_BCAST_ERROR, NULL);
+  if (ierr != 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "Failed to initialize ParallelIO");
+  }
+
+  // I/O tasks stay in this call, servicing requests of compute tasks, until compute tasks
+  // de-allocate the I/O system
+  ierr = PIOc_init_async(com, n_io_tasks, io_tasks.data(),
+                         1, &n_compute_tasks, &compute_task_list,
+                         &io_comm, &compute_comm, PIO_REARR_BOX, &iosys_id);
+  if (ierr != PIO_NOERR) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "Failed to initialize ParallelIO in the asynchronous mode");
+  }
+
+  if (io_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&io_comm);
+  }
+
+  if (compute_comm != MPI_COMM_NULL) {
+    g_pio_async_iosys_id = iosys_id;
+  }
+
+  return compute_comm;
+#else
+  (void) com;
+  (void) n_io_tasks;
+  throw RuntimeError(PISM_ERROR_LOCATION,
+                     "ParallelIO's asynchronous mode requires PISM built with ParallelIO");
+#endif
+}
+
+/*!
+ * Stop ParallelIO I/O tasks started by pio_async_init().
+ *
+ * Call on all compute tasks after all contexts (and grids) using ParallelIO are
+ * destroyed. Does nothing if the asynchronous mode is not used.
+ */
+void pio_async_finalize() {
+#if (Pism_USE_PIO==1)
+  if (g_pio_async_iosys_id != -1) {
+    int ierr = PIOc_free_iosystem(g_pio_async_iosys_id);
+    g_pio_async_iosys_id = -1;
+    if (ierr != PIO_NOERR) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "failed to de-allocate the asynchronous ParallelIO I/O system");
+    }
+  }
+#endif
+}
+
+Context::Ptr context_from_options(MPI_Comm com, const std::string &prefix,
+                                  int ensemble_member) {
   // unit system
   units::System::Ptr sys(new units::System);
 
@@ -176,9 +291,15 @@ Context::Ptr context_from_options(MPI_Comm com, const std::string &prefix) {
   Logger::Ptr logger = logger_from_options(com);
 
   // configuration parameters
-  Config::Ptr config = config_from_options(com, *logger, sys);
+  Config::Ptr config = config_from_options(com, *logger, sys, ensemble_member);
   print_config(*logger, 3, *config);
 
+  // the backend used to read input files
+  {
+    std::string format = config->get_string("input.format");
+    set_input_backend(format == "guess" ? PISM_GUESS : string_to_backend(format));
+  }
+
   // time manager
   Time::Ptr time = time_from_options(com, config, sys);
 
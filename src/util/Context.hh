@@ -1,4 +1,4 @@
-/* Copyright (C) 2014, 2015, 2016, 2019 PISM Authors
+/* Copyright (C) 2014, 2015, 2016, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -35,6 +35,8 @@ class Config;
 class EnthalpyConverter;
 class Time;
 class Profiling;
+class MemoryTracker;
+class MemoStatistics;
 class Logger;
 
 class Context {
@@ -66,6 +68,8 @@ public:
   ConstTimePtr time() const;
   const std::string& prefix() const;
   const Profiling& profiling() const;
+  const MemoryTracker& memory() const;
+  const MemoStatistics& memo() const;
 
   ConstLoggerPtr log() const;
   LoggerPtr log();
@@ -83,7 +87,12 @@ private:
 };
 
 //! Create a default context using options.
-Context::Ptr context_from_options(MPI_Comm com, const std::string &prefix);
+Context::Ptr context_from_options(MPI_Comm com, const std::string &prefix,
+                                  int ensemble_member = -1);
+
+MPI_Comm pio_async_init(MPI_Comm com, int n_io_tasks);
+
+void pio_async_finalize();
 
 } // end of namespace pism
 
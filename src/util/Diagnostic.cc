@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2019 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -177,6 +177,50 @@ IceModelVec::Ptr Diagnostic::compute() const {
   return result;
 }
 
+/*!
+ * Return the model field containing this diagnostic quantity (if available) or NULL.
+ *
+ * The returned field is "borrowed": it is owned by the model and may change during the
+ * next time step. Its values use internal units of metadata() and its metadata may differ
+ * from metadata of the diagnostic.
+ */
+const IceModelVec* Diagnostic::borrow() const {
+  return this->borrow_impl();
+}
+
+//! Diagnostics have to be computed unless they override this method.
+const IceModelVec* Diagnostic::borrow_impl() const {
+  return nullptr;
+}
+
+/*!
+ * Return true if this diagnostic reports a quantity averaged over the reporting interval
+ * (i.e. it depends on the time of the last call of reset()).
+ */
+bool Diagnostic::time_averaged() const {
+  return this->time_averaged_impl();
+}
+
+bool Diagnostic::time_averaged_impl() const {
+  return false;
+}
+
+/*!
+ * Write a diagnostic quantity to `file`.
+ *
+ * Writes model storage directly (using metadata of the diagnostic) if the diagnostic is
+ * available without computing it (see borrow()), avoiding a temporary copy.
+ */
+void Diagnostic::write(const File &file) const {
+  const IceModelVec *storage = this->borrow();
+
+  if (storage != nullptr) {
+    storage->write(file, m_vars);
+  } else {
+    this->compute()->write(file);
+  }
+}
+
 TSDiagnostic::TSDiagnostic(IceGrid::ConstPtr g, const std::string &name)
   : m_grid(g),
     m_config(g->ctx()->config()),
@@ -347,6 +391,7 @@ void TSDiagnostic::define(const File &file) const {
   io::define_time_bounds(m_ts.bounds(), file, PISM_DOUBLE);
 }
 
+//! Write buffered values to the output file, opening it.
 void TSDiagnostic::flush() {
 
   if (m_ts.times().empty()) {
@@ -359,15 +404,31 @@ void TSDiagnostic::flush() {
 
   unsigned int len = file.dimension_length(dimension_name);
 
-  if (len > 0) {
-    double last_time = vector_max(file.read_dimension(dimension_name));
+  double last_time = len > 0 ? vector_max(file.read_dimension(dimension_name)) : 0.0;
 
-    if (last_time < m_ts.times().front()) {
-      m_start = len;
-    }
+  flush(file, len, last_time);
+}
+
+/*!
+ * Write buffered values to `file` (open for writing).
+ *
+ * `n_records` and `last_time` are the number of records in the file and the last time
+ * saved *before* writing any of the diagnostics saved to it, which allows writing many
+ * diagnostics using one open file.
+ *
+ * Times and time bounds are written by the first diagnostic that adds records.
+ */
+void TSDiagnostic::flush(const File &file, unsigned int n_records, double last_time) {
+
+  if (m_ts.times().empty()) {
+    return;
   }
 
-  if (len == m_start) {
+  if (n_records > 0 and last_time < m_ts.times().front()) {
+    m_start = n_records;
+  }
+
+  if (file.dimension_length(m_ts.dimension().get_name()) == m_start) {
     io::write_timeseries(file, m_ts.dimension(), m_start, m_ts.times());
     io::write_time_bounds(file, m_ts.bounds(), m_start, m_ts.time_bounds());
   }
@@ -378,6 +439,11 @@ void TSDiagnostic::flush() {
   m_ts.reset();
 }
 
+//! Number of values stored in the buffer (not flushed yet).
+size_t TSDiagnostic::buffered_records() const {
+  return m_ts.times().size();
+}
+
 void TSDiagnostic::init(const File &output_file,
                         std::shared_ptr<std::vector<double>> requested_times) {
   m_output_filename = output_file.filename();
@@ -1,4 +1,4 @@
-// Copyright (C) 2010--2019 PISM Authors
+// Copyright (C) 2010--2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -19,6 +19,7 @@
 #ifndef __Diagnostic_hh
 #define __Diagnostic_hh
 
+#include <functional>
 #include <memory>
 #include <map>
 #include <string>
@@ -72,6 +73,12 @@ public:
   //! @brief Compute a diagnostic quantity and return a pointer to a newly-allocated IceModelVec.
   IceModelVec::Ptr compute() const;
 
+  const IceModelVec* borrow() const;
+
+  bool time_averaged() const;
+
+  void write(const File &file) const;
+
   unsigned int n_variables() const;
 
   SpatialVariableMetadata& metadata(unsigned int N = 0);
@@ -97,6 +104,8 @@ protected:
   virtual void reset_impl();
 
   virtual IceModelVec::Ptr compute_impl() const = 0;
+  virtual const IceModelVec* borrow_impl() const;
+  virtual bool time_averaged_impl() const;
 
   double to_internal(double x) const;
   double to_external(double x) const;
@@ -115,6 +124,10 @@ protected:
 
 typedef std::map<std::string, Diagnostic::Ptr> DiagnosticList;
 
+//! Creates a diagnostic; used to allocate only diagnostics that were requested.
+typedef std::function<Diagnostic::Ptr()> DiagnosticFactory;
+typedef std::map<std::string, DiagnosticFactory> DiagnosticFactoryList;
+
 /*!
  * Helper template wrapping quantities with dedicated storage in diagnostic classes.
  *
@@ -144,6 +157,11 @@ protected:
 
     return result;
   }
+
+  const IceModelVec* borrow_impl() const {
+    return &m_input;
+  }
+
   const T &m_input;
 };
 
@@ -235,6 +253,10 @@ protected:
     m_interval_length = 0.0;
   }
 
+  virtual bool time_averaged_impl() const {
+    return true;
+  }
+
   virtual IceModelVec::Ptr compute_impl() const {
     IceModelVec2S::Ptr result(new IceModelVec2S(Diagnostic::m_grid,
                                                 "diagnostic", WITHOUT_GHOSTS));
@@ -276,6 +298,9 @@ public:
   void update(double t0, double t1);
 
   void flush();
+  void flush(const File &file, unsigned int n_records, double last_time);
+
+  size_t buffered_records() const;
 
   void init(const File &output_file,
             std::shared_ptr<std::vector<double>> requested_times);
@@ -327,6 +352,9 @@ protected:
 
 typedef std::map<std::string, TSDiagnostic::Ptr> TSDiagnosticList;
 
+typedef std::function<TSDiagnostic::Ptr()> TSDiagnosticFactory;
+typedef std::map<std::string, TSDiagnosticFactory> TSDiagnosticFactoryList;
+
 //! Scalar diagnostic reporting a snapshot of a quantity modeled by PISM.
 /*!
  * The method compute() should return the instantaneous "snapshot" value.
@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016 Andreas Aschwanden, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2009-2011, 2013, 2014, 2015, 2016, 2020 Andreas Aschwanden, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -22,6 +22,8 @@
 #include <vector>
 #include <memory>
 
+#include "pism/pism_config.hh"  // Pism_DEBUG
+
 namespace pism {
 
 class Config;
@@ -64,10 +66,15 @@ public:
 
   double water_fraction(double E, double P) const;
 
+  void temperature(const double *E, const double *P, unsigned int n, double *result) const;
+  void water_fraction(const double *E, const double *P, unsigned int n, double *result) const;
+
   double enthalpy(double T, double omega, double P) const;
   double enthalpy_cts(double P) const;
   double enthalpy_liquid(double P) const;
   double enthalpy_permissive(double T, double omega, double P) const;
+  void enthalpy_permissive(const double *T, const double *P, unsigned int n,
+                           double *result) const;
 
   double c() const;
   double L(double T_m) const;
@@ -139,5 +146,7 @@ public:
 
 } // end of namespace pism
 
+#include "EnthalpyConverter_inline.hh"
+
 #endif // __enthalpyConverter_hh
 
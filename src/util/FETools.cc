@@ -21,12 +21,15 @@
 #include <cassert>              // assert
 #include <cstring>              // memset
 #include <cstdlib>              // malloc, free
+#include <algorithm>            // std::min
 
 #include "FETools.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/Logger.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
 
 #include "pism/util/error_handling.hh"
 
@@ -251,9 +254,190 @@ void ElementMap::add_contribution(const double *K, Mat J) const {
   PISM_CHK(ierr, "MatSetValuesBlockedStencil");
 }
 
+/*!
+ * Split elements into tiles of size `grid.tiles.size` and return tiles of the colour
+ * `colour` (0 to `n_colours - 1`).
+ *
+ * Tiles with indices (`n`, `m`) have the colour `n % 2 + 2 * (m % 2)`, so different tiles
+ * of the same colour do not share nodes. This makes it possible to process tiles of one
+ * colour concurrently (see for_each_tile()) and add contributions to nodal values without
+ * synchronization. Colours have to be processed one after another.
+ *
+ * With one thread the colour 0 contains all the elements (as one tile) and all other
+ * colours are empty. This preserves the order of operations (and results) of a loop over
+ * all elements.
+ */
+Tiles ElementIterator::tiles(const IceGrid &grid, unsigned int colour) const {
+  if (colour >= n_colours) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid element colour: %d", colour);
+  }
+
+  const int
+    i_last = xs + xm - 1,
+    j_last = ys + ym - 1;
+
+  // the list of all elements as one tile (with one thread) or tiles of this colour
+  Tiles all(grid, xs, i_last, ys, j_last);
+
+  if (all.n_threads() == 1) {
+    return colour == 0 ? all : Tiles(grid, std::vector<Tile>());
+  }
+
+  const int size = grid.ctx()->config()->get_number("grid.tiles.size");
+
+  std::vector<Tile> result;
+  for (int m = 0; ys + m * size <= j_last; ++m) {
+    for (int n = 0; xs + n * size <= i_last; ++n) {
+      if ((unsigned int)(n % 2 + 2 * (m % 2)) != colour) {
+        continue;
+      }
+
+      Tile t;
+      t.index   = result.size();
+      t.i_first = xs + n * size;
+      t.i_last  = std::min(t.i_first + size - 1, i_last);
+      t.j_first = ys + m * size;
+      t.j_last  = std::min(t.j_first + size - 1, j_last);
+
+      result.push_back(t);
+    }
+  }
+
+  return Tiles(grid, result);
+}
+
 const int ElementMap::m_i_offset[4] = {0, 1, 1, 0};
 const int ElementMap::m_j_offset[4] = {0, 0, 1, 1};
 
+const int BatchQuadrature::m_i_offset[q1::n_chi] = {0, 1, 1, 0};
+const int BatchQuadrature::m_j_offset[q1::n_chi] = {0, 0, 1, 1};
+
+BatchQuadrature::BatchQuadrature(const Quadrature &Q)
+  : m_Nq(Q.n()) {
+
+  if (m_Nq > MAX_QUADRATURE_SIZE) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "quadrature size (%d) exceeds the maximum (%d)",
+                                  (int)m_Nq, (int)MAX_QUADRATURE_SIZE);
+  }
+
+  for (unsigned int q = 0; q < MAX_QUADRATURE_SIZE; ++q) {
+    for (unsigned int k = 0; k < q1::n_chi; ++k) {
+      Germ psi = {0.0, 0.0, 0.0};
+      if (q < m_Nq) {
+        psi = Q.test_function_values(q, k);
+      }
+      m_val[q][k] = psi.val;
+      m_dx[q][k]  = psi.dx;
+      m_dy[q][k]  = psi.dy;
+    }
+  }
+}
+
+/*!
+ * Extract nodal values of elements (`i`, `j`), ..., (`i` + `N` - 1, `j`) from
+ * `x_global` into `result` (an array of `nodal_size` values).
+ *
+ * Values corresponding to elements past the end of the batch are set to zero.
+ */
+void BatchQuadrature::nodal_values(double const* const* x_global, int i, int j, int N,
+                                   double *result) const {
+  assert(N >= 0 and N <= max_size);
+
+  for (unsigned int k = 0; k < q1::n_chi; ++k) {
+    const double *x = &x_global[j + m_j_offset[k]][i + m_i_offset[k]];
+    double *r = &result[k * max_size];
+
+    for (int b = 0; b < N; ++b) {
+      r[b] = x[b];
+    }
+    for (int b = N; b < max_size; ++b) {
+      r[b] = 0.0;
+    }
+  }
+}
+
+/*!
+ * Extract nodal values of elements (`i`, `j`), ..., (`i` + `N` - 1, `j`) from
+ * `x_global`, storing components in `u` and `v` (arrays of `nodal_size` values).
+ */
+void BatchQuadrature::nodal_values(Vector2 const* const* x_global, int i, int j, int N,
+                                   double *u, double *v) const {
+  assert(N >= 0 and N <= max_size);
+
+  for (unsigned int k = 0; k < q1::n_chi; ++k) {
+    const Vector2 *x = &x_global[j + m_j_offset[k]][i + m_i_offset[k]];
+    double
+      *U = &u[k * max_size],
+      *V = &v[k * max_size];
+
+    for (int b = 0; b < N; ++b) {
+      U[b] = x[b].u;
+      V[b] = x[b].v;
+    }
+    for (int b = N; b < max_size; ++b) {
+      U[b] = 0.0;
+      V[b] = 0.0;
+    }
+  }
+}
+
+/*!
+ * Compute values of a finite element function with nodal values `x` at quadrature
+ * points of all elements in a batch.
+ */
+void BatchQuadrature::quadrature_point_values(const double *x, double *vals) const {
+  for (unsigned int q = 0; q < m_Nq; ++q) {
+    double *V = &vals[q * max_size];
+
+    for (int b = 0; b < max_size; ++b) {
+      V[b] = 0.0;
+    }
+
+    for (unsigned int k = 0; k < q1::n_chi; ++k) {
+      const double c = m_val[q][k];
+      const double *X = &x[k * max_size];
+      for (int b = 0; b < max_size; ++b) {
+        V[b] += c * X[b];
+      }
+    }
+  }
+}
+
+/*!
+ * Compute values and partial derivatives of a finite element function with nodal values
+ * `x` at quadrature points of all elements in a batch.
+ */
+void BatchQuadrature::quadrature_point_values(const double *x, double *vals,
+                                              double *dx, double *dy) const {
+  for (unsigned int q = 0; q < m_Nq; ++q) {
+    double
+      *V  = &vals[q * max_size],
+      *DX = &dx[q * max_size],
+      *DY = &dy[q * max_size];
+
+    for (int b = 0; b < max_size; ++b) {
+      V[b]  = 0.0;
+      DX[b] = 0.0;
+      DY[b] = 0.0;
+    }
+
+    for (unsigned int k = 0; k < q1::n_chi; ++k) {
+      const double
+        c_val = m_val[q][k],
+        c_dx  = m_dx[q][k],
+        c_dy  = m_dy[q][k];
+      const double *X = &x[k * max_size];
+
+      for (int b = 0; b < max_size; ++b) {
+        V[b]  += c_val * X[b];
+        DX[b] += c_dx * X[b];
+        DY[b] += c_dy * X[b];
+      }
+    }
+  }
+}
+
 Quadrature::Quadrature(unsigned int N)
   : m_Nq(N) {
 
@@ -589,9 +773,7 @@ P1Quadrature3::P1Quadrature3(unsigned int N,
 
 DirichletData::DirichletData()
   : m_indices(NULL), m_weight(1.0) {
-  for (unsigned int k = 0; k < q1::n_chi; ++k) {
-    m_indices_e[k] = 0;
-  }
+  // empty
 }
 
 DirichletData::~DirichletData() {
@@ -636,9 +818,10 @@ void DirichletData::finish(const IceModelVec *values) {
 
 //! @brief Constrain `element`, i.e. ensure that quadratures do not contribute to Dirichlet nodes by marking corresponding rows and columns as "invalid".
 void DirichletData::constrain(ElementMap &element) {
-  element.nodal_values(*m_indices, m_indices_e);
+  double indices_e[q1::n_chi];
+  element.nodal_values(*m_indices, indices_e);
   for (unsigned int k = 0; k < q1::n_chi; k++) {
-    if (m_indices_e[k] > 0.5) { // Dirichlet node
+    if (indices_e[k] > 0.5) { // Dirichlet node
       // Mark any kind of Dirichlet node as not to be touched
       element.mark_row_invalid(k);
       element.mark_col_invalid(k);
@@ -658,9 +841,10 @@ DirichletData_Scalar::DirichletData_Scalar(const IceModelVec2Int *indices,
 void DirichletData_Scalar::enforce(const ElementMap &element, double* x_nodal) {
   assert(m_values != NULL);
 
-  element.nodal_values(*m_indices, m_indices_e);
+  double indices_e[q1::n_chi];
+  element.nodal_values(*m_indices, indices_e);
   for (unsigned int k = 0; k < q1::n_chi; k++) {
-    if (m_indices_e[k] > 0.5) { // Dirichlet node
+    if (indices_e[k] > 0.5) { // Dirichlet node
       int i = 0, j = 0;
       element.local_to_global(k, i, j);
       x_nodal[k] = (*m_values)(i, j);
@@ -669,9 +853,10 @@ void DirichletData_Scalar::enforce(const ElementMap &element, double* x_nodal) {
 }
 
 void DirichletData_Scalar::enforce_homogeneous(const ElementMap &element, double* x_nodal) {
-  element.nodal_values(*m_indices, m_indices_e);
+  double indices_e[q1::n_chi];
+  element.nodal_values(*m_indices, indices_e);
   for (unsigned int k = 0; k < q1::n_chi; k++) {
-    if (m_indices_e[k] > 0.5) { // Dirichlet node
+    if (indices_e[k] > 0.5) { // Dirichlet node
       x_nodal[k] = 0.;
     }
   }
@@ -754,9 +939,10 @@ DirichletData_Vector::DirichletData_Vector(const IceModelVec2Int *indices,
 void DirichletData_Vector::enforce(const ElementMap &element, Vector2* x_nodal) {
   assert(m_values != NULL);
 
-  element.nodal_values(*m_indices, m_indices_e);
+  double indices_e[q1::n_chi];
+  element.nodal_values(*m_indices, indices_e);
   for (unsigned int k = 0; k < q1::n_chi; k++) {
-    if (m_indices_e[k] > 0.5) { // Dirichlet node
+    if (indices_e[k] > 0.5) { // Dirichlet node
       int i = 0, j = 0;
       element.local_to_global(k, i, j);
       x_nodal[k] = (*m_values)(i, j);
@@ -765,9 +951,10 @@ void DirichletData_Vector::enforce(const ElementMap &element, Vector2* x_nodal)
 }
 
 void DirichletData_Vector::enforce_homogeneous(const ElementMap &element, Vector2* x_nodal) {
-  element.nodal_values(*m_indices, m_indices_e);
+  double indices_e[q1::n_chi];
+  element.nodal_values(*m_indices, indices_e);
   for (unsigned int k = 0; k < q1::n_chi; k++) {
-    if (m_indices_e[k] > 0.5) { // Dirichlet node
+    if (indices_e[k] > 0.5) { // Dirichlet node
       x_nodal[k].u = 0.0;
       x_nodal[k].v = 0.0;
     }
@@ -30,6 +30,7 @@
 #include <petscmat.h>
 
 #include "pism/util/Vector2.hh"
+#include "pism/util/Tiles.hh"
 
 namespace pism {
 class IceModelVec;
@@ -398,6 +399,11 @@ public:
     return (i-xs) + (j-ys)*xm;
   }
 
+  //! Number of colours used by tiles().
+  static const unsigned int n_colours = 4;
+
+  Tiles tiles(const IceGrid &grid, unsigned int colour) const;
+
   //! x-coordinate of the first element to loop over.
   int xs;
   //! total number of elements to loop over in the x-direction.
@@ -602,7 +608,61 @@ void quadrature_point_values(Quadrature &Q, const T *x, T *vals, T *dx, T *dy) {
   }
 }
 
+//! Evaluates Q1 finite element functions at quadrature points of several elements at once.
+/*!
+ * Processes "batches" of up to `max_size` consecutive elements in a grid row, i.e.
+ * elements (i, j), (i + 1, j), ..., (i + N - 1, j).
+ *
+ * Values of shape functions and their derivatives are copied from a Quadrature into
+ * tables stored by value. Element data are stored with the element index `b` varying
+ * fastest: nodal values use the layout `[k * max_size + b]` and values at quadrature
+ * points use `[q * max_size + b]`. Inner loops run over elements in a batch with unit
+ * stride and a fixed trip count, which allows the compiler to vectorize them.
+ *
+ * Nodes of an element are ordered as in ElementMap.
+ */
+class BatchQuadrature {
+public:
+  //! Maximum number of elements in a batch.
+  static const int max_size = 8;
+  //! Size of an array of nodal values of a batch.
+  static const int nodal_size = q1::n_chi * max_size;
+  //! Size of an array of values at quadrature points of a batch.
+  static const int quadrature_size = MAX_QUADRATURE_SIZE * max_size;
+
+  BatchQuadrature(const Quadrature &Q);
+
+  //! Quadrature size (the number of points).
+  unsigned int n() const {
+    return m_Nq;
+  }
+
+  void nodal_values(double const* const* x_global, int i, int j, int N,
+                    double *result) const;
+
+  void nodal_values(Vector2 const* const* x_global, int i, int j, int N,
+                    double *u, double *v) const;
+
+  void quadrature_point_values(const double *x, double *vals) const;
+
+  void quadrature_point_values(const double *x, double *vals, double *dx, double *dy) const;
+private:
+  unsigned int m_Nq;
+
+  //! Values of shape functions and their derivatives, indexed by `[q][k]`.
+  double m_val[MAX_QUADRATURE_SIZE][q1::n_chi];
+  double m_dx[MAX_QUADRATURE_SIZE][q1::n_chi];
+  double m_dy[MAX_QUADRATURE_SIZE][q1::n_chi];
+
+  static const int m_i_offset[q1::n_chi];
+  static const int m_j_offset[q1::n_chi];
+};
+
 //* Parts shared by scalar and 2D vector Dirichlet data classes.
+/*!
+ * Methods processing one element do not modify these objects, so they can be used by
+ * several threads at once (see ElementIterator::tiles()).
+ */
 class DirichletData {
 public:
   void constrain(ElementMap &element);
@@ -617,7 +677,6 @@ protected:
   void finish(const IceModelVec *values);
 
   const IceModelVec2Int *m_indices;
-  double m_indices_e[q1::n_chi];
   double m_weight;
 };
 
@@ -0,0 +1,228 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "GhostUpdateBatch.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+
+namespace pism {
+
+GhostUpdateBatch::GhostUpdateBatch(std::initializer_list<IceModelVec*> fields)
+  : m_in_progress(false) {
+  for (auto *f : fields) {
+    add(*f);
+  }
+}
+
+GhostUpdateBatch::~GhostUpdateBatch() {
+  if (m_in_progress) {
+    try {
+      end();
+    } catch (...) {
+      // destructors should not throw
+    }
+  }
+}
+
+//! Number of values per grid point in the local vector of `field`.
+static unsigned int block_size(const IceModelVec &field) {
+  return field.ndof() * field.levels().size();
+}
+
+//! Add `field` to the batch. Fields without ghosts are ignored.
+void GhostUpdateBatch::add(IceModelVec &field) {
+  if (m_in_progress) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot add %s: ghost update is in progress",
+                                  field.get_name().c_str());
+  }
+
+  const unsigned int width = field.stencil_width();
+
+  if (width == 0) {
+    return;
+  }
+
+  for (auto &group : m_groups) {
+    if (group.stencil_width != width) {
+      continue;
+    }
+
+    if (group.fields[0]->grid() != field.grid()) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "%s and %s use different grids",
+                                    group.fields[0]->get_name().c_str(),
+                                    field.get_name().c_str());
+    }
+
+    const unsigned int N = group.block_size + block_size(field);
+    if (N > (unsigned int)IceGrid::max_dm_dof) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "cannot add %s: too many values per grid point (%d)",
+                                    field.get_name().c_str(), (int)N);
+    }
+
+    group.fields.push_back(&field);
+    group.block_size = N;
+    return;
+  }
+
+  Group group;
+  group.stencil_width = width;
+  group.block_size    = block_size(field);
+  group.fields        = {&field};
+  group.buffer        = NULL;
+
+  m_groups.push_back(group);
+}
+
+//! Start updating ghosts.
+/*!
+ * Fields in the batch should not be modified until end() is called.
+ *
+ * Only one batch should be in progress at a time.
+ */
+void GhostUpdateBatch::begin() {
+  PetscErrorCode ierr;
+
+  if (m_in_progress) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "ghost update is already in progress");
+  }
+
+  for (auto &group : m_groups) {
+    if (group.fields.size() == 1) {
+      // nothing to aggregate: update in place
+      group.dm     = group.fields[0]->dm();
+      group.buffer = group.fields[0]->vec();
+    } else {
+      if (not group.dm) {
+        group.dm = group.fields[0]->grid()->get_dm(group.block_size, group.stencil_width);
+      }
+
+      ierr = DMGetLocalVector(*group.dm, &group.buffer);
+      PISM_CHK(ierr, "DMGetLocalVector");
+
+      pack(group);
+    }
+
+    ierr = DMLocalToLocalBegin(*group.dm, group.buffer, INSERT_VALUES, group.buffer);
+    PISM_CHK(ierr, "DMLocalToLocalBegin");
+  }
+
+  m_in_progress = true;
+}
+
+//! Finish updating ghosts.
+void GhostUpdateBatch::end() {
+  PetscErrorCode ierr;
+
+  if (not m_in_progress) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "ghost update was not started");
+  }
+
+  m_in_progress = false;
+
+  for (auto &group : m_groups) {
+    ierr = DMLocalToLocalEnd(*group.dm, group.buffer, INSERT_VALUES, group.buffer);
+    PISM_CHK(ierr, "DMLocalToLocalEnd");
+
+    if (group.fields.size() > 1) {
+      unpack(group);
+
+      ierr = DMRestoreLocalVector(*group.dm, &group.buffer);
+      PISM_CHK(ierr, "DMRestoreLocalVector");
+    }
+
+    group.buffer = NULL;
+  }
+}
+
+//! Update ghosts (without overlapping communication and computation).
+void GhostUpdateBatch::update() {
+  begin();
+  end();
+}
+
+/*!
+ * Copy values of fields in `group` to the work vector.
+ *
+ * All fields in a group have the same stencil width, so their local vectors cover the
+ * same grid points. Values of the field `n` at a grid point are stored after values of
+ * fields `0, ..., n - 1` at this point.
+ */
+void GhostUpdateBatch::pack(Group &group) {
+  const int N = group.block_size;
+
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(group.buffer, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  const int n_points = size / N;
+
+  petsc::VecArray buffer(group.buffer);
+  double *b = buffer.get();
+
+  int offset = 0;
+  for (auto *field : group.fields) {
+    const int n = block_size(*field);
+
+    petsc::VecArray field_array(field->vec());
+    const double *x = field_array.get();
+
+    for (int p = 0; p < n_points; ++p) {
+      for (int k = 0; k < n; ++k) {
+        b[p * N + offset + k] = x[p * n + k];
+      }
+    }
+    offset += n;
+  }
+}
+
+//! Copy values from the work vector back to fields in `group`.
+void GhostUpdateBatch::unpack(Group &group) {
+  const int N = group.block_size;
+
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(group.buffer, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  const int n_points = size / N;
+
+  petsc::VecArray buffer(group.buffer);
+  const double *b = buffer.get();
+
+  int offset = 0;
+  for (auto *field : group.fields) {
+    const int n = block_size(*field);
+
+    petsc::VecArray field_array(field->vec());
+    double *x = field_array.get();
+
+    for (int p = 0; p < n_points; ++p) {
+      for (int k = 0; k < n; ++k) {
+        x[p * n + k] = b[p * N + offset + k];
+      }
+    }
+    offset += n;
+  }
+}
+
+} // end of namespace pism
@@ -0,0 +1,87 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_GHOSTUPDATEBATCH_H
+#define PISM_GHOSTUPDATEBATCH_H
+
+#include <vector>
+#include <initializer_list>
+
+#include <petscvec.h>
+
+#include "pism/util/petscwrappers/DM.hh"
+
+namespace pism {
+
+class IceModelVec;
+
+//! Updates ghosts of several fields at once.
+/*!
+ * Calling IceModelVec::update_ghosts() for each of `N` fields sends `N` messages to each
+ * neighbor and waits for each of them. A GhostUpdateBatch copies fields that have the
+ * same stencil width into one work vector (interleaving their values), so their ghosts
+ * are updated using *one* message per neighbor.
+ *
+ * Usage:
+ *
+ *     GhostUpdateBatch ghosts{&a, &b, &c};
+ *     ghosts.begin();
+ *     // do something that does not use ghosts of a, b, c and does not modify a, b, c
+ *     ghosts.end();
+ *
+ * or simply `GhostUpdateBatch{&a, &b, &c}.update();`.
+ *
+ * Values of fields are copied in begin() and ghosts are set in end(), so it is safe to
+ * *read* fields in the batch between begin() and end(): this can be used to overlap
+ * communication with computations in the interior of the sub-domain.
+ *
+ * Fields without ghosts are ignored.
+ */
+class GhostUpdateBatch {
+public:
+  GhostUpdateBatch(std::initializer_list<IceModelVec*> fields = {});
+  ~GhostUpdateBatch();
+
+  void add(IceModelVec &field);
+
+  void begin();
+  void end();
+
+  void update();
+private:
+  // fields sharing the stencil width (and so the layout of local vectors)
+  struct Group {
+    unsigned int stencil_width;
+    // total number of values per grid point
+    unsigned int block_size;
+    std::vector<IceModelVec*> fields;
+    petsc::DM::Ptr dm;
+    Vec buffer;
+  };
+
+  void pack(Group &group);
+  void unpack(Group &group);
+
+  std::vector<Group> m_groups;
+  bool m_in_progress;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_GHOSTUPDATEBATCH_H */
@@ -0,0 +1,118 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "HardwareCounters.hh"
+#include "pism/pism_config.hh"
+#include "error_handling.hh"
+
+#if (Pism_USE_PERF_EVENT==1)
+#include <cerrno>
+#include <cstring>              // strerror, memset
+#include <unistd.h>             // syscall, read, close, sysconf
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace pism {
+
+#if (Pism_USE_PERF_EVENT==1)
+
+HardwareCounters::HardwareCounters() {
+  m_fd.fill(-1);
+
+  const uint64_t config[N_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                       PERF_COUNT_HW_INSTRUCTIONS,
+                                       PERF_COUNT_HW_CACHE_MISSES};
+
+  for (int k = 0; k < N_COUNTERS; ++k) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = config[k];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    // count threads created later (group reads are not supported with inherit, so each
+    // counter is read separately)
+    attr.inherit        = 1;
+
+    // this process, any CPU, no group
+    long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) {
+      int error = errno;
+      for (int j = 0; j < k; ++j) {
+        close(m_fd[j]);
+      }
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "failed to open hardware performance counters: %s\n"
+                                    "(check /proc/sys/kernel/perf_event_paranoid)",
+                                    strerror(error));
+    }
+    m_fd[k] = fd;
+  }
+}
+
+HardwareCounters::~HardwareCounters() {
+  for (int fd : m_fd) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+void HardwareCounters::read(Values &result) const {
+  for (int k = 0; k < N_COUNTERS; ++k) {
+    uint64_t value = 0;
+    if (::read(m_fd[k], &value, sizeof(value)) != sizeof(value)) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "failed to read a hardware performance counter");
+    }
+    result[k] = value;
+  }
+}
+
+//! Size of a cache line in bytes (64 if not known).
+double HardwareCounters::cache_line_size() {
+  long size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+  return size > 0 ? size : 64.0;
+}
+
+#else
+
+HardwareCounters::HardwareCounters() {
+  m_fd.fill(-1);
+  throw RuntimeError(PISM_ERROR_LOCATION,
+                     "PISM was built without hardware performance counter support"
+                     " (re-build with Pism_USE_PERF_EVENT)");
+}
+
+HardwareCounters::~HardwareCounters() {
+  // empty
+}
+
+void HardwareCounters::read(Values &result) const {
+  result.fill(0);
+}
+
+double HardwareCounters::cache_line_size() {
+  return 64.0;
+}
+
+#endif
+
+} // end of namespace pism
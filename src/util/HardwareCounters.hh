@@ -0,0 +1,63 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_HARDWARECOUNTERS_H
+#define PISM_HARDWARECOUNTERS_H
+
+#include <array>
+#include <cstdint>
+
+namespace pism {
+
+/*!
+ * Hardware performance counters of the calling process (Linux perf_event).
+ *
+ * Counts CPU cycles, retired instructions and last level cache misses in the calling
+ * thread and threads it creates *after* the counters are opened (e.g. OpenMP threads).
+ * Each last level cache miss moves one cache line to or from memory, so the number of
+ * misses times the cache line size approximates the memory traffic.
+ *
+ * Generic perf_event events do not include floating point operations (these are
+ * processor-specific), so flop counts are supplied by the code (see
+ * Profiling::add_work()).
+ *
+ * Requires PISM built with `Pism_USE_PERF_EVENT`; otherwise the constructor throws.
+ */
+class HardwareCounters {
+public:
+  HardwareCounters();
+  ~HardwareCounters();
+
+  enum Counter {CYCLES = 0, INSTRUCTIONS, CACHE_MISSES, N_COUNTERS};
+
+  typedef std::array<uint64_t, N_COUNTERS> Values;
+
+  void read(Values &result) const;
+
+  static double cache_line_size();
+private:
+  HardwareCounters(const HardwareCounters &);
+  HardwareCounters& operator=(const HardwareCounters &);
+
+  std::array<int, N_COUNTERS> m_fd;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_HARDWARECOUNTERS_H */
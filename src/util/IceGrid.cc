@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -17,6 +17,7 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cassert>
+#include <algorithm>            // std::max
 
 #include <map>
 #include <numeric>
@@ -32,8 +33,12 @@
 #include "error_handling.hh"
 #include "pism/util/io/File.hh"
 #include "pism/util/Vars.hh"
+#include "pism/util/RegriddingSource.hh"
+#include "pism/util/iceModelVec.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/projection.hh"
+#include "pism/util/VecPool.hh"
+#include "pism/util/LevelView.hh"
 #include "pism/pism_config.hh"
 
 #if (Pism_USE_PIO==1)
@@ -107,21 +112,39 @@ struct IceGrid::Impl {
   // avoid re-allocating it many times.
   petsc::DM::Ptr dm_scalar_global;
 
+  // Commonly used DMs created during grid construction (see prebuild_dms()). Creating a
+  // DM is collective and expensive on large numbers of processes, so we keep them for the
+  // lifetime of the grid instead of re-creating them every time all fields using one of
+  // them are de-allocated.
+  std::vector<petsc::DM::Ptr> prebuilt_dms;
+
   //! @brief A dictionary with pointers to IceModelVecs, for passing
   //! them from the one component to another (e.g. from IceModel to
   //! surface and ocean models).
   Vars variables;
 
+  //! fields of a model on a different grid used to initialize models on this grid
+  std::shared_ptr<const RegriddingSource> regridding_source;
+
   //! GSL binary search accelerator used to speed up kBelowHeight().
   gsl_interp_accel *bsearch_accel;
 
   //! ParallelIO I/O decompositions.
   std::map<int, int> io_decompositions;
+
+  //! storage of de-allocated fields, kept for re-use
+  std::unique_ptr<VecPool> vec_pool;
+
+  //! interpolation weights at the ice surface (see IceGrid::surface_interpolation())
+  std::unique_ptr<LevelInterpolation> surface_interpolation;
+  //! state counter of the ice thickness used to compute surface_interpolation
+  int surface_interpolation_revision;
 };
 
 IceGrid::Impl::Impl(Context::ConstPtr context)
-  : ctx(context), mapping_info("mapping", ctx->unit_system()) {
-  // empty
+  : ctx(context), mapping_info("mapping", ctx->unit_system()),
+    surface_interpolation_revision(-1) {
+  vec_pool.reset(new VecPool(ctx->memory(), ctx->config()->get_number("grid.vec_pool_size")));
 }
 
 //! Convert a string to Periodicity.
@@ -263,10 +286,8 @@ IceGrid::IceGrid(Context::ConstPtr context, const GridParameters &p)
     m_impl->compute_horizontal_coordinates();
 
     {
-      unsigned int stencil_width = (unsigned int)context->config()->get_number("grid.max_stencil_width");
-
       try {
-        petsc::DM::Ptr tmp = this->get_dm(1, stencil_width);
+        prebuild_dms();
       } catch (RuntimeError &e) {
         e.add_context("distributing a %d x %d grid across %d processors.",
                       Mx(), My(), size());
@@ -293,13 +314,38 @@ IceGrid::IceGrid(Context::ConstPtr context, const GridParameters &p)
   }
 }
 
-//! Create a grid using one of variables in `var_names` in `file`.
+/*!
+ * Create DMs used by most fields on this grid: scalar 2D fields with and without ghosts,
+ * 2D vector fields and 3D fields with the default stencil width.
+ *
+ * The DM with the maximum stencil width is created first: this fails if sub-domains are
+ * too narrow.
+ */
+void IceGrid::prebuild_dms() {
+  const int
+    max_width = m_impl->ctx->config()->get_number("grid.max_stencil_width"),
+    Mz        = m_impl->z.size();
+
+  const std::vector<std::pair<int, int> > dms{{1, max_width}, {1, 0}, {2, 1}, {Mz, 1}};
+
+  for (const auto &dm : dms) {
+    m_impl->prebuilt_dms.push_back(get_dm(dm.first, dm.second));
+  }
+}
+
+/*!
+ * Create a grid using one of variables in `var_names` in `file`.
+ *
+ * The file is opened using the backend chosen by `input.format`: with "mpiio" the header
+ * is read once (on rank 0) and broadcast, so reading grid information does not involve
+ * collective operations for each metadata query.
+ */
 IceGrid::Ptr IceGrid::FromFile(Context::ConstPtr ctx,
                                const std::string &filename,
                                const std::vector<std::string> &var_names,
                                GridRegistration r) {
 
-  File file(ctx->com(), filename, PISM_NETCDF3, PISM_READONLY);
+  File file(ctx->com(), filename, PISM_GUESS, PISM_READONLY);
 
   for (auto name : var_names) {
     if (file.find_variable(name)) {
@@ -844,6 +890,35 @@ petsc::DM::Ptr IceGrid::get_dm(int da_dof, int stencil_width) const {
   return result;
 }
 
+//! Return the pool of storage of de-allocated fields (see VecPool).
+VecPool& IceGrid::vec_pool() const {
+  return *m_impl->vec_pool;
+}
+
+//! Return weights of interpolation at the ice surface in columns of 3D fields using z().
+/*!
+ * Weights are computed using the ice thickness field `land_ice_thickness` (see
+ * variables()) and re-computed only if its state counter changed, so they are shared by
+ * all 3D fields interpolated at the ice surface during a time step.
+ *
+ * Geometry::ensure_consistency() increments the state counter of the ice thickness if
+ * the geometry changed.
+ */
+const LevelInterpolation& IceGrid::surface_interpolation() const {
+  const IceModelVec2S &ice_thickness = *variables().get_2d_scalar("land_ice_thickness");
+
+  if (not m_impl->surface_interpolation) {
+    m_impl->surface_interpolation.reset(new LevelInterpolation(*this, z()));
+  }
+
+  if (ice_thickness.state_counter() != m_impl->surface_interpolation_revision) {
+    m_impl->surface_interpolation->update(ice_thickness);
+    m_impl->surface_interpolation_revision = ice_thickness.state_counter();
+  }
+
+  return *m_impl->surface_interpolation;
+}
+
 //! Return grid periodicity.
 Periodicity IceGrid::periodicity() const {
   return m_impl->periodicity;
@@ -905,6 +980,21 @@ const Vars& IceGrid::variables() const {
   return m_impl->variables;
 }
 
+/*!
+ * Set the source of model state variables used by models on this grid during
+ * initialization. Use an empty pointer to stop using it.
+ *
+ * See RegriddingSource.
+ */
+void IceGrid::set_regridding_source(std::shared_ptr<const RegriddingSource> source) {
+  m_impl->regridding_source = source;
+}
+
+//! Returns the source of model state variables (NULL if not set).
+const RegriddingSource* IceGrid::regridding_source() const {
+  return m_impl->regridding_source.get();
+}
+
 //! Global starting index of this processor's subset.
 int IceGrid::xs() const {
   return m_impl->xs;
@@ -1250,7 +1340,7 @@ GridParameters::GridParameters(Context::ConstPtr ctx,
                                const std::string &filename,
                                const std::string &variable_name,
                                GridRegistration r) {
-  File file(ctx->com(), filename, PISM_NETCDF3, PISM_READONLY);
+  File file(ctx->com(), filename, PISM_GUESS, PISM_READONLY);
   init_from_file(ctx, file, variable_name, r);
 }
 
@@ -1333,6 +1423,146 @@ void GridParameters::validate() const {
   }
 }
 
+/*!
+ * Compute ownership ranges splitting a grid dimension into `N` parts that are at least
+ * `min_width` points wide and have approximately equal sums of `cost`.
+ *
+ * Falls back to equal parts if `cost` is zero everywhere.
+ */
+static std::vector<unsigned int> weighted_ownership_ranges(const std::vector<double> &cost,
+                                                           unsigned int N,
+                                                           unsigned int min_width) {
+  const unsigned int M = cost.size();
+
+  const double total = std::accumulate(cost.begin(), cost.end(), 0.0);
+
+  if (not (total > 0.0) or M < N * min_width) {
+    return ownership_ranges(M, N);
+  }
+
+  std::vector<unsigned int> result(N);
+
+  unsigned int start = 0;
+  double sum = 0.0;             // sum of cost[0, ..., start - 1]
+  for (unsigned int k = 0; k < N - 1; ++k) {
+    const double target = total * (k + 1) / N;
+
+    // leave at least min_width points for each of the remaining parts
+    const unsigned int end_max = M - min_width * (N - k - 1);
+
+    unsigned int end = start;
+    while (end < end_max and
+           (end - start < min_width or sum + 0.5 * cost[end] < target)) {
+      sum += cost[end];
+      end += 1;
+    }
+
+    result[k] = end - start;
+    start = end;
+  }
+  result[N - 1] = M - start;
+
+  return result;
+}
+
+/*!
+ * Re-distribute `grid` so that all processors own approximately the same number of
+ * ice-covered columns, using ice thickness in `filename`. Ice-free columns count as
+ * `grid.partitioning.ice_free_weight` of an ice-covered one.
+ *
+ * Does nothing unless `grid.partitioning.method` is "ice_thickness". Ownership ranges set
+ * using `-procs_x` and `-procs_y` take precedence.
+ *
+ * This uses a tensor product decomposition (as required by PETSc's DMDA), so ownership
+ * ranges in the X (Y) direction balance the cost summed over grid columns (rows).
+ */
+static IceGrid::Ptr balance_ownership_ranges(IceGrid::Ptr grid, const std::string &filename) {
+  Context::ConstPtr ctx = grid->ctx();
+  Config::ConstPtr config = ctx->config();
+
+  if (config->get_string("grid.partitioning.method") != "ice_thickness") {
+    return grid;
+  }
+
+  options::IntegerList procs_x("-procs_x", "Processor ownership ranges (x direction)", {});
+  options::IntegerList procs_y("-procs_y", "Processor ownership ranges (y direction)", {});
+
+  if (procs_x.is_set() and procs_y.is_set()) {
+    return grid;
+  }
+
+  ctx->log()->message(2,
+                      "* Balancing the domain decomposition using ice thickness in '%s'...\n",
+                      filename.c_str());
+
+  const double ice_free_weight = config->get_number("grid.partitioning.ice_free_weight");
+
+  const unsigned int
+    Mx = grid->Mx(),
+    My = grid->My();
+
+  std::vector<double> cost_x(Mx, 0.0), cost_y(My, 0.0);
+  {
+    IceModelVec2S ice_thickness(grid, "thk", WITHOUT_GHOSTS);
+    ice_thickness.set_attrs("internal", "land ice thickness",
+                            "m", "m", "land_ice_thickness", 0);
+    ice_thickness.regrid(filename, OPTIONAL, 0.0);
+
+    IceModelVec::AccessList list(ice_thickness);
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      const double cost = ice_thickness(i, j) > 0.0 ? 1.0 : ice_free_weight;
+
+      cost_x[i] += cost;
+      cost_y[j] += cost;
+    }
+  }
+
+  std::vector<double> total_x(Mx), total_y(My);
+  GlobalSum(grid->com, cost_x.data(), total_x.data(), Mx);
+  GlobalSum(grid->com, cost_y.data(), total_y.data(), My);
+
+  GridParameters p(config);
+  p.Lx           = grid->Lx();
+  p.Ly           = grid->Ly();
+  p.x0           = grid->x0();
+  p.y0           = grid->y0();
+  p.Mx           = Mx;
+  p.My           = My;
+  p.registration = grid->registration();
+  p.periodicity  = grid->periodicity();
+  p.z            = grid->z();
+  // get the number of processors in each direction (-Nx, -Ny), -procs_x and -procs_y
+  p.ownership_ranges_from_options(ctx->size());
+
+  const unsigned int min_width = std::max((int)config->get_number("grid.max_stencil_width"), 1);
+
+  if (not procs_x.is_set()) {
+    p.procs_x = weighted_ownership_ranges(total_x, p.procs_x.size(), min_width);
+  }
+
+  if (not procs_y.is_set()) {
+    p.procs_y = weighted_ownership_ranges(total_y, p.procs_y.size(), min_width);
+  }
+
+  auto to_string = [](const std::vector<unsigned int> &ranges) {
+    std::vector<std::string> result;
+    for (auto r : ranges) {
+      result.push_back(std::to_string(r));
+    }
+    return join(result, ",");
+  };
+
+  ctx->log()->message(3,
+                      "  procs_x: %s\n"
+                      "  procs_y: %s\n",
+                      to_string(p.procs_x).c_str(), to_string(p.procs_y).c_str());
+
+  return IceGrid::Ptr(new IceGrid(ctx, p));
+}
+
 //! Create a grid using command-line options and (possibly) an input file.
 /** Processes options -i, -bootstrap, -Mx, -My, -Mz, -Lx, -Ly, -Lz, -x_range, -y_range.
  */
@@ -1359,7 +1589,9 @@ IceGrid::Ptr IceGrid::FromOptions(Context::ConstPtr ctx) {
     options::ignored(*log, "-z_spacing");
 
     // get grid from a PISM input file
-    return IceGrid::FromFile(ctx, input_file, {"enthalpy", "temp"}, r);
+    IceGrid::Ptr result = IceGrid::FromFile(ctx, input_file, {"enthalpy", "temp"}, r);
+
+    return balance_ownership_ranges(result, input_file);
   } else if (not input_file.empty() and bootstrap) {
     // bootstrapping; get domain size defaults from an input file, allow overriding all grid
     // parameters using command-line options
@@ -1400,6 +1632,8 @@ IceGrid::Ptr IceGrid::FromOptions(Context::ConstPtr ctx) {
 
     IceGrid::Ptr result(new IceGrid(ctx, input_grid));
 
+    result = balance_ownership_ranges(result, input_file);
+
     units::System::Ptr sys = ctx->unit_system();
     units::Converter km(sys, "m", "km");
 
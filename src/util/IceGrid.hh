@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -35,9 +35,12 @@ namespace units {
 class System;
 }
 class Vars;
+class RegriddingSource;
 class Logger;
 
 class MappingInfo;
+class VecPool;
+class LevelInterpolation;
 
 typedef enum {UNKNOWN = 0, EQUAL, QUADRATIC} SpacingType;
 typedef enum {NOT_PERIODIC = 0, X_PERIODIC = 1, Y_PERIODIC = 2, XY_PERIODIC = 3} Periodicity;
@@ -237,6 +240,8 @@ public:
   static Ptr FromOptions(Context::ConstPtr ctx);
 
   petsc::DM::Ptr get_dm(int dm_dof, int stencil_width) const;
+  VecPool& vec_pool() const;
+  const LevelInterpolation& surface_interpolation() const;
 
   void report_parameters() const;
 
@@ -295,6 +300,9 @@ public:
   Vars& variables();
   const Vars& variables() const;
 
+  void set_regridding_source(std::shared_ptr<const RegriddingSource> source);
+  const RegriddingSource* regridding_source() const;
+
   int pio_io_decomposition(int dof, int output_datatype) const;
 
   //! Maximum number of degrees of freedom supported by PISM.
@@ -309,6 +317,8 @@ private:
   struct Impl;
   Impl *m_impl;
 
+  void prebuild_dms();
+
   // Hide copy constructor / assignment operator.
   IceGrid(const IceGrid &);
   IceGrid & operator=(const IceGrid &);
@@ -376,7 +386,7 @@ public:
   operator bool() const {
     return not m_done;
   }
-private:
+protected:
   int m_i, m_j;
   int m_i_first, m_i_last, m_j_first, m_j_last;
   bool m_done;
@@ -393,6 +403,100 @@ public:
   Points(const IceGrid &g) : PointsWithGhosts(g, 0) {}
 };
 
+/** Iterator class for traversing grid points owned by this processor that are at least
+ * `stencil_width` points away from the edge of its sub-domain.
+ *
+ * A stencil of this width centered at any of these points does not use ghosts, so this
+ * can be used to compute in the interior while ghosts are being updated:
+ *
+ *     f.update_ghosts_begin();
+ *     for (InteriorPoints p(grid, 1); p; p.next()) { ... }
+ *     f.update_ghosts_end();
+ *     for (BoundaryPoints p(grid, 1); p; p.next()) { ... }
+ *
+ * (see IceModelVec::update_ghosts_begin()).
+ */
+class InteriorPoints : public PointsWithGhosts {
+public:
+  InteriorPoints(const IceGrid &g, unsigned int stencil_width)
+    : PointsWithGhosts(g, 0) {
+    const int w = stencil_width;
+
+    m_i_first += w;
+    m_i_last  -= w;
+    m_j_first += w;
+    m_j_last  -= w;
+
+    m_i = m_i_first;
+    m_j = m_j_first;
+    // the interior is empty if the sub-domain is too small
+    m_done = (m_i_first > m_i_last or m_j_first > m_j_last);
+  }
+};
+
+/** Iterator class for traversing grid points owned by this processor that are less than
+ * `stencil_width` points away from the edge of its sub-domain, i.e. points *not* visited
+ * by InteriorPoints.
+ */
+class BoundaryPoints {
+public:
+  BoundaryPoints(const IceGrid &g, unsigned int stencil_width) {
+    const int w = stencil_width;
+
+    m_i_first = g.xs();
+    m_i_last  = g.xs() + g.xm() - 1;
+    m_j_first = g.ys();
+    m_j_last  = g.ys() + g.ym() - 1;
+
+    m_interior_i_first = m_i_first + w;
+    m_interior_i_last  = m_i_last - w;
+    m_interior_j_first = m_j_first + w;
+    m_interior_j_last  = m_j_last - w;
+
+    m_i = m_i_first;
+    m_j = m_j_first;
+    // all points are in the interior if stencil_width is zero
+    m_done = (w == 0);
+  }
+
+  int i() const {
+    return m_i;
+  }
+  int j() const {
+    return m_j;
+  }
+
+  void next() {
+    assert(not m_done);
+    m_i += 1;
+    if (interior(m_i, m_j)) {
+      m_i = m_interior_i_last + 1; // skip the interior part of this row
+    }
+    if (m_i > m_i_last) {
+      m_i = m_i_first;        // wrap around
+      m_j += 1;
+    }
+    if (m_j > m_j_last) {
+      m_j = m_j_first;        // ensure that indexes are valid
+      m_done = true;
+    }
+  }
+
+  operator bool() const {
+    return not m_done;
+  }
+private:
+  bool interior(int i, int j) const {
+    return (i >= m_interior_i_first and i <= m_interior_i_last and
+            j >= m_interior_j_first and j <= m_interior_j_last);
+  }
+
+  int m_i, m_j;
+  int m_i_first, m_i_last, m_j_first, m_j_last;
+  int m_interior_i_first, m_interior_i_last, m_interior_j_first, m_interior_j_last;
+  bool m_done;
+};
+
 } // end of namespace pism
 
 #endif  /* __grid_hh */
@@ -0,0 +1,170 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_ICEMODELVECVIEW_H
+#define PISM_ICEMODELVECVIEW_H
+
+#include <type_traits>   // std::remove_const
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/pism_config.hh"  // Pism_DEBUG
+
+namespace pism {
+
+/*!
+ * Direct access to values of a 2D field stored in the contiguous local array (owned
+ * points and ghosts) of an IceModelVec.
+ *
+ * `T` is the type of a value (`double` for an IceModelVec2S, `Vector2` for an
+ * IceModelVec2V; use `const double`, etc for read-only access) and `N` is the number of
+ * values of type `T` at each grid point (e.g. 2 for an IceModelVec2Stag).
+ *
+ * `operator()(i, j)` computes an index in the local array and does not dereference row
+ * pointers, so loops over `i` using it can be vectorized. Indexes are checked only if PISM
+ * is built with `Pism_DEBUG`.
+ *
+ * A view is valid while the field is accessed (between begin_access() and end_access(),
+ * usually in the scope of an AccessList):
+ *
+ *     IceModelVec::AccessList list{&H, &result};
+ *     View2<const double> H_view(H);
+ *     View2<double> result_view(result);
+ */
+template<typename T, int N>
+class View2 {
+public:
+  template<class F>
+  View2(F &field)
+    : m_data(nullptr) {
+
+    if (field.ndof() * sizeof(double) != N * sizeof(T)) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "cannot create a view of %s: it has %d degrees of freedom",
+                                    field.get_name().c_str(), field.ndof());
+    }
+
+    const IceGrid &grid = *field.grid();
+    const int w = field.stencil_width();
+
+    m_i_first = grid.xs() - w;
+    m_i_last  = grid.xs() + grid.xm() + w - 1;
+    m_j_first = grid.ys() - w;
+    m_j_last  = grid.ys() + grid.ym() + w - 1;
+
+    m_stride = (m_i_last - m_i_first + 1) * N;
+    m_offset = -(m_j_first * m_stride + m_i_first * N);
+
+    m_data = reinterpret_cast<T*>(field.local_array());
+  }
+
+  inline T& operator()(int i, int j, int k = 0) const {
+#if (Pism_DEBUG==1)
+    check_indices(i, j, k);
+#endif
+    return m_data[j * m_stride + i * N + k + m_offset];
+  }
+
+  inline StarStencil<typename std::remove_const<T>::type> star(int i, int j) const {
+    const View2 &self = *this;
+
+    StarStencil<typename std::remove_const<T>::type> result;
+    result.ij = self(i, j);
+    result.e  = self(i + 1, j);
+    result.w  = self(i - 1, j);
+    result.n  = self(i, j + 1);
+    result.s  = self(i, j - 1);
+
+    return result;
+  }
+private:
+  void check_indices(int i, int j, int k) const {
+    if (i < m_i_first or i > m_i_last or
+        j < m_j_first or j > m_j_last or
+        k < 0 or k >= N) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "view index (%d, %d, %d) is out of bounds", i, j, k);
+    }
+  }
+
+  T *m_data;
+  int m_stride, m_offset;
+  int m_i_first, m_i_last, m_j_first, m_j_last;
+};
+
+/*!
+ * Direct access to columns of an IceModelVec3D (see View2).
+ *
+ * `column(i, j)` replaces IceModelVec3D::get_column(), which is not inlined and goes
+ * through an array of pointers to columns.
+ */
+template<typename T>
+class View3 {
+public:
+  template<class F>
+  View3(F &field)
+    : m_data(nullptr) {
+
+    const IceGrid &grid = *field.grid();
+    const int w = field.stencil_width();
+
+    m_i_first = grid.xs() - w;
+    m_i_last  = grid.xs() + grid.xm() + w - 1;
+    m_j_first = grid.ys() - w;
+    m_j_last  = grid.ys() + grid.ym() + w - 1;
+
+    m_n_levels = field.levels().size();
+    m_stride   = (m_i_last - m_i_first + 1) * m_n_levels;
+    m_offset   = -(m_j_first * m_stride + m_i_first * m_n_levels);
+
+    m_data = reinterpret_cast<T*>(field.local_array());
+  }
+
+  inline T* column(int i, int j) const {
+#if (Pism_DEBUG==1)
+    check_indices(i, j, 0);
+#endif
+    return &m_data[j * m_stride + i * m_n_levels + m_offset];
+  }
+
+  inline T& operator()(int i, int j, int k) const {
+#if (Pism_DEBUG==1)
+    check_indices(i, j, k);
+#endif
+    return m_data[j * m_stride + i * m_n_levels + k + m_offset];
+  }
+private:
+  void check_indices(int i, int j, int k) const {
+    if (i < m_i_first or i > m_i_last or
+        j < m_j_first or j > m_j_last or
+        k < 0 or k >= m_n_levels) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "view index (%d, %d, %d) is out of bounds", i, j, k);
+    }
+  }
+
+  T *m_data;
+  int m_n_levels, m_stride, m_offset;
+  int m_i_first, m_i_last, m_j_first, m_j_last;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_ICEMODELVECVIEW_H */
@@ -0,0 +1,223 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::min, std::upper_bound
+
+#include "LevelView.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+void level_interpolation_weight(const std::vector<double> &levels, double z,
+                                unsigned int &k, double &lambda) {
+  const unsigned int N = levels.size();
+
+  if (z >= levels.back()) {
+    k      = N - 1;
+    lambda = 0.0;
+  } else if (z <= levels.front()) {
+    k      = 0;
+    lambda = 0.0;
+  } else {
+    // levels[k] <= z < levels[k + 1]
+    k = (std::upper_bound(levels.begin(), levels.end(), z) - levels.begin()) - 1;
+
+    lambda = (z - levels[k]) / (levels[k + 1] - levels[k]);
+  }
+}
+
+/*!
+ * Allocate storage for a level-major copy of `input`, covering the sub-domain owned by
+ * the current processor extended by `stencil_width` ghosts.
+ *
+ * Does not copy values: call update().
+ */
+LevelView::LevelView(const IceModelVec3D &input, unsigned int stencil_width)
+  : m_grid(input.grid()),
+    m_levels(input.levels()),
+    m_stencil_width(stencil_width) {
+
+  const int w = stencil_width;
+
+  m_i_first = m_grid->xs() - w;
+  m_j_first = m_grid->ys() - w;
+  m_nx      = m_grid->xm() + 2 * w;
+  m_ny      = m_grid->ym() + 2 * w;
+
+  m_level_size = m_nx * m_ny;
+
+  m_data.resize(m_level_size * m_levels.size());
+}
+
+//! Copy values from `input` (transposing them).
+void LevelView::update(const IceModelVec3D &input) {
+
+  if (input.levels().size() != m_levels.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "%s has %d levels, expected %d",
+                                  input.get_name().c_str(),
+                                  (int)input.levels().size(), (int)m_levels.size());
+  }
+
+  if (input.stencil_width() < m_stencil_width) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "%s has stencil width %d, expected at least %d",
+                                  input.get_name().c_str(),
+                                  input.stencil_width(), m_stencil_width);
+  }
+
+  IceModelVec::AccessList list{&input};
+
+  const unsigned int Mz = m_levels.size();
+
+  // Columns are transposed in blocks to read several columns (and write several values
+  // in each level) at a time.
+  const int block_size = 16;
+  const double *column[block_size];
+
+  for (int jj = 0; jj < m_ny; ++jj) {
+    const int j = m_j_first + jj;
+
+    for (int ii = 0; ii < m_nx; ii += block_size) {
+      const int n = std::min(block_size, m_nx - ii);
+
+      for (int b = 0; b < n; ++b) {
+        column[b] = input.get_column(m_i_first + ii + b, j);
+      }
+
+      for (unsigned int k = 0; k < Mz; ++k) {
+        double *row = &m_data[k * m_level_size + jj * m_nx + ii];
+        for (int b = 0; b < n; ++b) {
+          row[b] = column[b][k];
+        }
+      }
+    }
+  }
+}
+
+unsigned int LevelView::n_levels() const {
+  return m_levels.size();
+}
+
+const std::vector<double>& LevelView::levels() const {
+  return m_levels;
+}
+
+//! Copy the level `k` to `output`.
+void LevelView::get_level(unsigned int k, IceModelVec2S &output) const {
+  if (k >= m_levels.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid level index: %d", k);
+  }
+
+  IceModelVec::AccessList list{&output};
+
+  const double *L = level(k);
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    output(i, j) = L[index(i, j)];
+  }
+}
+
+//! Compute the horizontal slice at the height `z` (using linear interpolation).
+/*!
+ * Gives the same results as IceModelVec3::getHorSlice().
+ */
+void LevelView::get_slice(double z, IceModelVec2S &output) const {
+  unsigned int k = 0;
+  double lambda = 0.0;
+  level_interpolation_weight(m_levels, z, k, lambda);
+
+  const unsigned int k1 = std::min(k + 1, (unsigned int)m_levels.size() - 1);
+
+  IceModelVec::AccessList list{&output};
+
+  const double
+    *L0 = level(k),
+    *L1 = level(k1);
+
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+    const int n = index(i, j);
+
+    output(i, j) = L0[n] + lambda * (L1[n] - L0[n]);
+  }
+}
+
+LevelInterpolation::LevelInterpolation(const IceGrid &grid, const std::vector<double> &levels)
+  : m_grid(grid),
+    m_levels(levels) {
+
+  const size_t size = grid.xm() * grid.ym();
+
+  m_k.resize(size, 0);
+  m_lambda.resize(size, 0.0);
+}
+
+//! Re-compute interpolation weights using heights `height` (above the base of the ice).
+void LevelInterpolation::update(const IceModelVec2S &height) {
+  IceModelVec::AccessList list{&height};
+
+  const int xs = m_grid.xs(), ys = m_grid.ys(), xm = m_grid.xm();
+
+  for (Points p(m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+    const int n = (j - ys) * xm + (i - xs);
+
+    level_interpolation_weight(m_levels, height(i, j), m_k[n], m_lambda[n]);
+  }
+}
+
+//! Interpolate `input` using weights computed by the last update() call.
+/*!
+ * Gives the same results as IceModelVec3::getSurfaceValues() with the same heights.
+ */
+void LevelInterpolation::interpolate(const IceModelVec3D &input, IceModelVec2S &output) const {
+
+  if (input.levels() != m_levels) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot interpolate %s: vertical levels do not match",
+                                  input.get_name().c_str());
+  }
+
+  IceModelVec::AccessList list{&input, &output};
+
+  const int xs = m_grid.xs(), ys = m_grid.ys(), xm = m_grid.xm();
+  const unsigned int k_max = m_levels.size() - 1;
+
+  for (Points p(m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+    const int n = (j - ys) * xm + (i - xs);
+
+    const double *column = input.get_column(i, j);
+    const unsigned int
+      k  = m_k[n],
+      k1 = std::min(k + 1, k_max);
+
+    output(i, j) = column[k] + m_lambda[n] * (column[k1] - column[k]);
+  }
+}
+
+const std::vector<double>& LevelInterpolation::levels() const {
+  return m_levels;
+}
+
+} // end of namespace pism
@@ -0,0 +1,117 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_LEVELVIEW_H
+#define PISM_LEVELVIEW_H
+
+#include <vector>
+
+#include "pism/util/IceGrid.hh"
+
+namespace pism {
+
+class IceModelVec2S;
+class IceModelVec3D;
+
+/*!
+ * Find `k` and `lambda` such that the value of a piecewise-linear function `f` defined on
+ * `levels` at `z` is `f[k] + lambda * (f[k1] - f[k])`, where `k1 = min(k + 1, N - 1)`.
+ *
+ * Values outside of the range covered by `levels` are extrapolated as constants.
+ */
+void level_interpolation_weight(const std::vector<double> &levels, double z,
+                                unsigned int &k, double &lambda);
+
+//! Level-major ("transposed") copy of a 3D field.
+/*!
+ * IceModelVec3D stores each column contiguously. This suits column solvers, but kernels
+ * sweeping horizontally through one level at a time have to read one value per column. A
+ * LevelView stores each level contiguously instead, so these kernels can use contiguous
+ * rows.
+ *
+ * The layout is chosen at allocation time: create a LevelView (once) and call update() to
+ * transpose the current values of a field. A LevelView is a copy: it is not updated when
+ * the field changes.
+ *
+ * Values at points `(i, j)` of the sub-domain owned by the current processor (extended by
+ * `stencil_width` ghosts) in the level `k` are stored at `level(k)[index(i, j)]`.
+ */
+class LevelView {
+public:
+  LevelView(const IceModelVec3D &input, unsigned int stencil_width = 0);
+
+  void update(const IceModelVec3D &input);
+
+  unsigned int n_levels() const;
+  const std::vector<double>& levels() const;
+
+  //! Values in the level `k`.
+  const double* level(unsigned int k) const {
+    return &m_data[k * m_level_size];
+  }
+
+  //! Index of `(i, j)` within a level.
+  int index(int i, int j) const {
+    return (j - m_j_first) * m_nx + (i - m_i_first);
+  }
+
+  double operator()(int i, int j, int k) const {
+    return m_data[k * m_level_size + index(i, j)];
+  }
+
+  void get_level(unsigned int k, IceModelVec2S &output) const;
+  void get_slice(double z, IceModelVec2S &output) const;
+private:
+  IceGrid::ConstPtr m_grid;
+  std::vector<double> m_levels;
+  unsigned int m_stencil_width;
+  int m_i_first, m_j_first, m_nx, m_ny;
+  size_t m_level_size;
+  std::vector<double> m_data;
+};
+
+//! Indexes and weights of linear interpolation in columns at a given height at each point.
+/*!
+ * IceModelVec3::getSurfaceValues() searches the levels in each column of each field. If
+ * several fields are interpolated at the same (spatially variable) height above the base
+ * of the ice, a LevelInterpolation can be computed once and used for all of them.
+ *
+ * Weights are stored for grid points owned by the current processor. See also
+ * IceGrid::surface_interpolation().
+ */
+class LevelInterpolation {
+public:
+  LevelInterpolation(const IceGrid &grid, const std::vector<double> &levels);
+
+  void update(const IceModelVec2S &height);
+
+  void interpolate(const IceModelVec3D &input, IceModelVec2S &output) const;
+
+  const std::vector<double>& levels() const;
+private:
+  const IceGrid &m_grid;
+  std::vector<double> m_levels;
+  // index of the level below the height and the interpolation weight, at each point
+  std::vector<unsigned int> m_k;
+  std::vector<double> m_lambda;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_LEVELVIEW_H */
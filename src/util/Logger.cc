@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2017 PISM Authors
+/* Copyright (C) 2015, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,6 +20,12 @@
 #include <unistd.h>
 #include <sstream>
 #include <stdarg.h>
+#include <cstdio>
+#include <cstring>              // strlen
+#include <algorithm>            // std::min
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <petscsys.h>
 
 #include "Logger.hh"
@@ -33,6 +39,8 @@ struct Logger::Impl {
   MPI_Comm com;
   bool enabled;
   int threshold;
+  //! serializes calls of message_impl(), error_impl() and debug_impl()
+  std::mutex mutex;
 };
 
 Logger::Logger(MPI_Comm com, int threshold)
@@ -59,6 +67,7 @@ void Logger::message(int threshold, const char format[], ...) const {
   vsnprintf(buffer, sizeof(buffer), format, argp);
   va_end(argp);
 
+  std::lock_guard<std::mutex> lock(m_impl->mutex);
   message_impl(buffer);
 }
 
@@ -67,6 +76,7 @@ void Logger::message(int threshold, const std::string &buffer) const {
     return;
   }
 
+  std::lock_guard<std::mutex> lock(m_impl->mutex);
   message_impl(buffer.c_str());
 }
 
@@ -83,6 +93,7 @@ void Logger::error(const char format[], ...) const {
   vsnprintf(buffer, sizeof(buffer), format, argp);
   va_end(argp);
 
+  std::lock_guard<std::mutex> lock(m_impl->mutex);
   error_impl(buffer);
 }
 
@@ -91,6 +102,27 @@ void Logger::error_impl(const char buffer[]) const {
   PISM_CHK(ierr, "PetscFPrintf");
 }
 
+void Logger::debug(const char format[], ...) const {
+  char buffer[8192];
+  va_list argp;
+
+  va_start(argp, format);
+  vsnprintf(buffer, sizeof(buffer), format, argp);
+  va_end(argp);
+
+  std::lock_guard<std::mutex> lock(m_impl->mutex);
+  debug_impl(buffer);
+}
+
+void Logger::debug_impl(const char buffer[]) const {
+  (void) buffer;
+  // the default implementation does nothing
+}
+
+void Logger::flush() const {
+  // empty (the default implementation prints messages right away)
+}
+
 void Logger::set_threshold(int level) {
   m_impl->threshold = level;
 }
@@ -105,8 +137,200 @@ void Logger::enable() const {
   m_impl->enabled = true;
 }
 
+namespace {
+
+//! A ring buffer holding text waiting to be written to `file`.
+struct Channel {
+  Channel(FILE *f, size_t size)
+    : file(f), data(size), start(0), used(0), n_dropped(0) {
+    // empty
+  }
+
+  //! Add `text` to the buffer. Drops it if there is not enough space.
+  void push(const char *text) {
+    size_t length = strlen(text);
+
+    if (length > data.size() - used) {
+      n_dropped += 1;
+      return;
+    }
+
+    for (size_t k = 0; k < length; ++k) {
+      data[(start + used + k) % data.size()] = text[k];
+    }
+    used += length;
+  }
+
+  bool pending() const {
+    return used > 0 or n_dropped > 0;
+  }
+
+  FILE *file;
+  std::vector<char> data;
+  //! position of the first character waiting to be written
+  size_t start;
+  //! number of characters waiting to be written
+  size_t used;
+  //! number of messages dropped because the buffer was full
+  unsigned int n_dropped;
+};
+
+} // end of anonymous namespace
+
+struct AsyncLogger::Impl {
+  Impl()
+    : stop(false), busy(false), rank(0) {
+    // empty
+  }
+
+  bool pending() const {
+    return (output and output->pending()) or (debug and debug->pending());
+  }
+
+  void run();
+
+  std::mutex mutex;
+  //! signals that there are messages to write
+  std::condition_variable have_data;
+  //! signals that all messages were written
+  std::condition_variable done;
+
+  std::unique_ptr<Channel> output, debug;
+  bool stop;
+  //! true while the background thread is writing
+  bool busy;
+  int rank;
+  std::thread thread;
+};
+
+//! The background thread: write buffered text until asked to stop.
+void AsyncLogger::Impl::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    have_data.wait(lock, [this]() { return stop or pending(); });
+
+    if (stop and not pending()) {
+      break;
+    }
+
+    for (Channel *c : {output.get(), debug.get()}) {
+      while (c != nullptr and c->pending()) {
+        // a contiguous part of the buffer; it stays "used" (so it is not overwritten)
+        // until it is written
+        size_t n = std::min(c->used, c->data.size() - c->start);
+        const char *text = &c->data[c->start];
+        unsigned int n_dropped = c->n_dropped;
+        c->n_dropped = 0;
+
+        busy = true;
+        lock.unlock();
+        {
+          if (n_dropped > 0) {
+            fprintf(c->file, "PISM WARNING: %u log messages were dropped (the buffer is full)\n",
+                    n_dropped);
+          }
+          fwrite(text, 1, n, c->file);
+          fflush(c->file);
+        }
+        lock.lock();
+        busy = false;
+
+        c->start = (c->start + n) % c->data.size();
+        c->used -= n;
+      }
+    }
+
+    done.notify_all();
+  }
+}
+
+AsyncLogger::AsyncLogger(MPI_Comm com, int threshold, size_t buffer_size,
+                         const std::string &debug_prefix)
+  : Logger(com, threshold), m_impl(new Impl) {
+
+  MPI_Comm_rank(com, &m_impl->rank);
+
+  if (m_impl->rank == 0) {
+    m_impl->output.reset(new Channel(stdout, buffer_size));
+  }
+
+  if (not debug_prefix.empty()) {
+    std::string filename = pism::printf("%s.%d.log", debug_prefix.c_str(), m_impl->rank);
+
+    FILE *file = fopen(filename.c_str(), "w");
+    if (file == nullptr) {
+      delete m_impl;
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION, "failed to open '%s'",
+                                    filename.c_str());
+    }
+    m_impl->debug.reset(new Channel(file, buffer_size));
+  }
+
+  m_impl->thread = std::thread(&AsyncLogger::Impl::run, m_impl);
+}
+
+AsyncLogger::~AsyncLogger() {
+  {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->stop = true;
+  }
+  m_impl->have_data.notify_one();
+  m_impl->thread.join();
+
+  if (m_impl->debug) {
+    fclose(m_impl->debug->file);
+  }
+
+  delete m_impl;
+}
+
+void AsyncLogger::message_impl(const char buffer[]) const {
+  if (not m_impl->output) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->output->push(buffer);
+  }
+  m_impl->have_data.notify_one();
+}
+
+void AsyncLogger::debug_impl(const char buffer[]) const {
+  if (not m_impl->debug) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->debug->push(buffer);
+  }
+  m_impl->have_data.notify_one();
+}
+
+void AsyncLogger::error_impl(const char buffer[]) const {
+  // print pending messages first
+  flush();
+
+  Logger::error_impl(buffer);
+}
+
+void AsyncLogger::flush() const {
+  std::unique_lock<std::mutex> lock(m_impl->mutex);
+  m_impl->done.wait(lock, [this]() { return not (m_impl->pending() or m_impl->busy); });
+}
+
 Logger::Ptr logger_from_options(MPI_Comm com) {
-  Logger::Ptr result(new Logger(com, 2));
+  Logger::Ptr result;
+
+  if (options::Bool("-log_async", "print messages using a background thread")) {
+    options::String debug_prefix("-log_debug", "prefix of per-process debugging logs", "");
+
+    result.reset(new AsyncLogger(com, 2, 1024 * 1024, debug_prefix));
+  } else {
+    result.reset(new Logger(com, 2));
+  }
 
   options::Integer verbosity("-verbose", "set logger verbosity threshold",
                              result->get_threshold());
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016 PISM Authors
+/* Copyright (C) 2015, 2016, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -36,6 +36,9 @@ typedef enum {WARNING=1, DEBUG2=2, DEBUG3=3, TRACE=4} LoggerLevel;
  * This class was created to make it possible to silence PISM's output when it is used as a library
  * and make it possible to separate outputs from different PISM (IceModel, etc) instances running
  * side by side.
+ *
+ * Messages are formatted by the calling thread; calls of message_impl() and error_impl()
+ * are serialized, so a logger can be used from several threads.
  */
 class Logger {
 public:
@@ -72,10 +75,20 @@ public:
   void disable() const;
   //! (Re-)enable the logger.
   void enable() const;
+
+  //! Print a message to the per-process debugging log (if any).
+  /** Unlike message(), this is *not* collective: each process writes its own messages.
+   * The base class implementation does nothing.
+   */
+  void debug(const char format[], ...) const __attribute__((format(printf, 2, 3)));
+
+  //! Wait for all messages to be printed.
+  virtual void flush() const;
 protected:
   //! Do the hard work. Override this in a derived class to customize.
   virtual void message_impl(const char buffer[]) const;
   virtual void error_impl(const char buffer[]) const;
+  virtual void debug_impl(const char buffer[]) const;
   private:
   struct Impl;
   Impl *m_impl;
@@ -100,6 +113,34 @@ private:
   Impl *m_impl;
 };
 
+//! A logger that prints messages using a background thread.
+/**
+ * Messages are copied into a ring buffer of a fixed size and written by a background
+ * thread, so logging does not wait for the terminal (or the file `stdout` is redirected
+ * to). If the buffer is full the message is dropped (the number of dropped messages is
+ * reported later): logging never blocks.
+ *
+ * If `debug_prefix` is not empty each process writes messages passed to debug() to the
+ * file `debug_prefix.N.log`, where `N` is its rank.
+ *
+ * Errors are printed synchronously after pending messages.
+ */
+class AsyncLogger : public Logger {
+public:
+  AsyncLogger(MPI_Comm com, int threshold, size_t buffer_size = 1024 * 1024,
+              const std::string &debug_prefix = "");
+  virtual ~AsyncLogger();
+
+  void flush() const;
+protected:
+  virtual void message_impl(const char buffer[]) const;
+  virtual void error_impl(const char buffer[]) const;
+  virtual void debug_impl(const char buffer[]) const;
+private:
+  struct Impl;
+  Impl *m_impl;
+};
+
 Logger::Ptr logger_from_options(MPI_Comm com);
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2014, 2015, 2016, 2017, 2018 Constantine Khroulev and David Maxwell
+// Copyright (C) 2011, 2014, 2015, 2016, 2017, 2018, 2020 Constantine Khroulev and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -28,8 +28,36 @@ void GeometryCalculator::compute(const IceModelVec2S& sea_level,
                                  const IceModelVec2S& thickness,
                                  IceModelVec2Int& out_mask,
                                  IceModelVec2S& out_surface) const {
-  compute_mask(sea_level, bed, thickness, out_mask);
-  compute_surface(sea_level, bed, thickness, out_surface);
+
+  const unsigned int stencil = out_mask.stencil_width();
+
+  if (out_surface.stencil_width() != stencil) {
+    // outputs need different numbers of ghosts: compute them separately
+    compute_mask(sea_level, bed, thickness, out_mask);
+    compute_surface(sea_level, bed, thickness, out_surface);
+    return;
+  }
+
+  IceModelVec::AccessList list{&sea_level, &bed, &thickness, &out_mask, &out_surface};
+
+  const IceGrid &grid = *bed.grid();
+
+  assert(sea_level.stencil_width() >= stencil);
+  assert(bed.stencil_width()       >= stencil);
+  assert(thickness.stencil_width() >= stencil);
+
+  // compute both outputs in one pass, one row (including ghosts) at a time
+  const int
+    w  = stencil,
+    xs = grid.xs() - w,
+    xm = grid.xm() + 2 * w,
+    ys = grid.ys() - w,
+    ym = grid.ym() + 2 * w;
+
+  for (int j = ys; j < ys + ym; ++j) {
+    compute_row(&sea_level(xs, j), &bed(xs, j), &thickness(xs, j), xm,
+                &out_mask(xs, j), &out_surface(xs, j));
+  }
 }
 
 void GeometryCalculator::compute_mask(const IceModelVec2S &sea_level,
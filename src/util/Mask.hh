@@ -1,4 +1,4 @@
-// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018 Constantine Khroulev and David Maxwell
+// Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2020 Constantine Khroulev and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -95,33 +95,10 @@ public:
 
   inline void compute(double sea_level, double bed, double thickness,
                       int *out_mask, double *out_surface) const {
-    const double hgrounded = bed + thickness; // FIXME issue #15
-    const double hfloating = sea_level + m_alpha*thickness;
-
-    const bool
-      is_floating = (hfloating > hgrounded),
-      ice_free    = (thickness <= m_icefree_thickness);
-
     int mask_result;
     double surface_result;
 
-    if (is_floating && (not m_is_dry_simulation)) {
-      surface_result = hfloating;
-
-      if (ice_free) {
-        mask_result = MASK_ICE_FREE_OCEAN;
-      } else {
-        mask_result = MASK_FLOATING;
-      }
-    } else {  // Grounded
-      surface_result = hgrounded;
-
-      if (ice_free) {
-        mask_result = MASK_ICE_FREE_BEDROCK;
-      } else {
-        mask_result = MASK_GROUNDED;
-      }
-    }
+    cell(sea_level, bed, thickness, mask_result, surface_result);
 
     if (out_surface != NULL) {
       *out_surface = surface_result;
@@ -144,7 +121,39 @@ public:
     return result;
   }
 
+  /*!
+   * Compute the cell type and the surface elevation at `n` consecutive grid points (e.g.
+   * a row of a 2D field) in one pass.
+   *
+   * The loop body does not branch, so compilers can vectorize it.
+   */
+  inline void compute_row(const double *sea_level, const double *bed, const double *thickness,
+                          int n, double *out_mask, double *out_surface) const {
+    for (int k = 0; k < n; ++k) {
+      int mask_result;
+      cell(sea_level[k], bed[k], thickness[k], mask_result, out_surface[k]);
+      out_mask[k] = mask_result;
+    }
+  }
+
 protected:
+  //! Cell type and surface elevation at a grid point (without branches).
+  inline void cell(double sea_level, double bed, double thickness,
+                   int &mask, double &surface) const {
+    const double hgrounded = bed + thickness; // FIXME issue #15
+    const double hfloating = sea_level + m_alpha*thickness;
+
+    const bool
+      is_floating = (hfloating > hgrounded) and (not m_is_dry_simulation),
+      ice_free    = (thickness <= m_icefree_thickness);
+
+    surface = is_floating ? hfloating : hgrounded;
+
+    mask = (is_floating ?
+            (ice_free ? MASK_ICE_FREE_OCEAN : MASK_FLOATING) :
+            (ice_free ? MASK_ICE_FREE_BEDROCK : MASK_GROUNDED));
+  }
+
   double m_alpha;
   double m_icefree_thickness;
   bool m_is_dry_simulation;
@@ -0,0 +1,93 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Memo.hh"
+#include "Logger.hh"
+
+namespace pism {
+
+MemoStatistics::MemoStatistics() {
+  // empty
+}
+
+void MemoStatistics::record(const std::string &name, bool reused) const {
+  // note: std::map::operator[] value-initializes (zeros) new entries
+  Counts &counts = m_counts[name];
+  if (reused) {
+    counts.reused += 1;
+  } else {
+    counts.computed += 1;
+  }
+}
+
+unsigned int MemoStatistics::computed(const std::string &name) const {
+  auto it = m_counts.find(name);
+  return it != m_counts.end() ? it->second.computed : 0;
+}
+
+unsigned int MemoStatistics::reused(const std::string &name) const {
+  auto it = m_counts.find(name);
+  return it != m_counts.end() ? it->second.reused : 0;
+}
+
+/*!
+ * Print the number of times memoized results were computed and re-used.
+ *
+ * Memoized computations are collective, so counts are the same on all processes.
+ */
+void MemoStatistics::report(const Logger &log) const {
+  log.message(2, "Memoized computations:\n");
+  log.message(2, "  %-44s %10s %10s\n", "name", "computed", "re-used");
+  for (const auto &c : m_counts) {
+    log.message(2, "  %-44s %10u %10u\n",
+                c.first.c_str(), c.second.computed, c.second.reused);
+  }
+}
+
+Memo::Memo(const MemoStatistics &statistics, const std::string &name)
+  : m_statistics(statistics), m_name(name), m_valid(false) {
+  // empty
+}
+
+/*!
+ * Returns true if the result computed using inputs described by `key` is available
+ * (i.e. set() was called with the same key and reset() was not called since).
+ *
+ * Callers are expected to re-compute the result if this returns false.
+ */
+bool Memo::up_to_date(const std::vector<int> &key) {
+  bool result = m_valid and key == m_key;
+
+  m_statistics.record(m_name, result);
+
+  return result;
+}
+
+//! Record the key describing inputs used to compute the current result.
+void Memo::set(const std::vector<int> &key) {
+  m_key   = key;
+  m_valid = true;
+}
+
+//! Mark the current result as out of date.
+void Memo::reset() {
+  m_valid = false;
+}
+
+} // end of namespace pism
@@ -0,0 +1,89 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_MEMO_H
+#define PISM_MEMO_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pism {
+
+class Logger;
+
+//! Counts evaluations of memoized computations (see Memo).
+class MemoStatistics {
+public:
+  MemoStatistics();
+
+  void record(const std::string &name, bool reused) const;
+
+  unsigned int computed(const std::string &name) const;
+  unsigned int reused(const std::string &name) const;
+
+  void report(const Logger &log) const;
+private:
+  struct Counts {
+    unsigned int computed;
+    unsigned int reused;
+  };
+  mutable std::map<std::string, Counts> m_counts;
+};
+
+/*!
+ * Helps skip re-computing a result if its inputs did not change.
+ *
+ * Inputs are described by a "key": a list of integers such as state counters of
+ * IceModelVec inputs (see IceModelVec::state_counter()). A typical use:
+ *
+ * @code
+ * std::vector<int> key{surface.state_counter(), reference_surface.state_counter()};
+ *
+ * if (not m_memo.up_to_date(key)) {
+ *   // compute the result
+ *   m_memo.set(key);
+ * }
+ * @endcode
+ *
+ * The key is recorded *after* the computation, so a result is not considered up to date
+ * if its computation failed.
+ *
+ * Each Memo has a name; the number of times results were computed and re-used is
+ * recorded in Context::memo() for all Memo instances with the same name.
+ */
+class Memo {
+public:
+  Memo(const MemoStatistics &statistics, const std::string &name);
+
+  bool up_to_date(const std::vector<int> &key);
+
+  void set(const std::vector<int> &key);
+
+  void reset();
+private:
+  const MemoStatistics &m_statistics;
+  std::string m_name;
+  std::vector<int> m_key;
+  bool m_valid;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_MEMO_H */
@@ -0,0 +1,376 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::sort, std::min
+#include <set>
+
+#include <cstdint>              // uintptr_t
+#include <sys/resource.h>       // getrusage
+#include <petscsys.h>           // PetscMemoryGetCurrentUsage
+
+#ifdef __linux__
+#include <sched.h>              // sched_getaffinity
+#include <sys/syscall.h>        // SYS_getcpu, SYS_move_pages
+#include <unistd.h>             // syscall, sysconf
+#if defined(SYS_getcpu) && defined(SYS_move_pages)
+#define PISM_NUMA_QUERIES 1
+#endif
+#endif
+
+#include "MemoryTracker.hh"
+#include "Logger.hh"
+#include "pism_utilities.hh"
+#include "error_handling.hh"
+
+namespace pism {
+
+namespace {
+
+//! NUMA node of the CPU the current process is running on (-1 if not known).
+int current_numa_node() {
+#if (PISM_NUMA_QUERIES==1)
+  unsigned int cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return node;
+  }
+#endif
+  return -1;
+}
+
+//! Number of CPUs the current process is allowed to run on (-1 if not known).
+int allowed_cpus() {
+#if (PISM_NUMA_QUERIES==1)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    return CPU_COUNT(&set);
+  }
+#endif
+  return -1;
+}
+
+} // end of anonymous namespace
+
+MemoryTracker::MemoryTracker()
+  : m_next_id(0) {
+  m_total.current = 0;
+  m_total.peak    = 0;
+}
+
+/*!
+ * Register an allocation of `bytes` bytes called `name` (with `dof` degrees of freedom and
+ * the stencil width `stencil_width`, if it is a field).
+ *
+ * If `data` is not null, it should point to the beginning of the allocated storage (it is
+ * used by report_numa()).
+ *
+ * Returns the ID to use with deallocate().
+ */
+int MemoryTracker::allocate(const std::string &name, size_t bytes,
+                            int dof, int stencil_width,
+                            const void *data) const {
+  Allocation a;
+  a.owner         = m_owners.empty() ? "other" : m_owners.back();
+  a.name          = name;
+  a.bytes         = bytes;
+  a.dof           = dof;
+  a.stencil_width = stencil_width;
+  a.data          = data;
+
+  int id = m_next_id++;
+  m_allocations[id] = a;
+
+  update(a.owner, bytes);
+
+  return id;
+}
+
+//! Remove the allocation `id` (see allocate()). Ignores unknown IDs.
+void MemoryTracker::deallocate(int id) const {
+  auto a = m_allocations.find(id);
+  if (a == m_allocations.end()) {
+    return;
+  }
+
+  update(a->second.owner, -(long int)a->second.bytes);
+
+  m_allocations.erase(a);
+}
+
+void MemoryTracker::update(const std::string &owner, long int change) const {
+  auto &usage = m_usage[owner];          // zero-initialized if new
+
+  usage.current += change;
+  usage.peak = std::max(usage.peak, usage.current);
+
+  m_total.current += change;
+  m_total.peak = std::max(m_total.peak, m_total.current);
+}
+
+//! Total size of tracked allocations.
+size_t MemoryTracker::current() const {
+  return m_total.current;
+}
+
+//! Peak total size of tracked allocations.
+size_t MemoryTracker::peak() const {
+  return m_total.peak;
+}
+
+//! Total size of allocations owned by `owner`.
+size_t MemoryTracker::current(const std::string &owner) const {
+  auto u = m_usage.find(owner);
+  return u != m_usage.end() ? u->second.current : 0;
+}
+
+//! Peak total size of allocations owned by `owner`.
+size_t MemoryTracker::peak(const std::string &owner) const {
+  auto u = m_usage.find(owner);
+  return u != m_usage.end() ? u->second.peak : 0;
+}
+
+//! Resident set size of the current process.
+size_t MemoryTracker::resident_set_size() {
+  PetscLogDouble result = 0.0;
+  PetscErrorCode ierr = PetscMemoryGetCurrentUsage(&result);
+  PISM_CHK(ierr, "PetscMemoryGetCurrentUsage");
+  return result;
+}
+
+//! Peak resident set size of the current process.
+size_t MemoryTracker::peak_resident_set_size() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;         // bytes
+#else
+  return usage.ru_maxrss * 1024;  // kilobytes
+#endif
+}
+
+/*!
+ * Print the summary of memory use by owner (maximum over all processes and total) and
+ * the largest allocations on process 0 (at verbosity 3).
+ *
+ * The difference between the resident set size and tracked allocations is reported as
+ * "untracked". It includes solvers (KSP, SNES and their matrices and preconditioners),
+ * DMs, and libraries.
+ *
+ * Collective.
+ */
+void MemoryTracker::report(const Logger &log, MPI_Comm com) const {
+  const double MiB = 1024.0 * 1024.0;
+
+  std::set<std::string> local_owners;
+  for (const auto &u : m_usage) {
+    local_owners.insert(u.first);
+  }
+  auto owners = global_union(com, local_owners);
+
+  const int N = owners.size();
+
+  // owners, then tracked total, the resident set size, and untracked memory
+  std::vector<double> current(N + 3, 0.0), peak(N + 3, 0.0);
+  for (int k = 0; k < N; ++k) {
+    current[k] = this->current(owners[k]) / MiB;
+    peak[k]    = this->peak(owners[k]) / MiB;
+  }
+  current[N]     = m_total.current / MiB;
+  peak[N]        = m_total.peak / MiB;
+  current[N + 1] = resident_set_size() / MiB;
+  peak[N + 1]    = peak_resident_set_size() / MiB;
+  current[N + 2] = std::max(current[N + 1] - current[N], 0.0);
+  peak[N + 2]    = std::max(peak[N + 1] - peak[N], 0.0);
+
+  owners.push_back("tracked (total)");
+  owners.push_back("resident set size");
+  owners.push_back("untracked (solvers, libraries, etc)");
+
+  std::vector<double> current_max(N + 3), peak_max(N + 3), current_sum(N + 3);
+  GlobalMax(com, current.data(), current_max.data(), N + 3);
+  GlobalMax(com, peak.data(), peak_max.data(), N + 3);
+  GlobalSum(com, current.data(), current_sum.data(), N + 3);
+
+  log.message(2, "Memory use (MiB; maximum over processes and total over all processes):\n");
+  log.message(2, "  %-36s %10s %10s %12s\n", "owner", "current", "peak", "current total");
+  for (int k = 0; k < N + 3; ++k) {
+    log.message(2, "  %-36s %10.1f %10.1f %12.1f\n",
+                owners[k].c_str(), current_max[k], peak_max[k], current_sum[k]);
+  }
+
+  if (log.get_threshold() >= 3) {
+    std::vector<const Allocation*> allocations;
+    for (const auto &a : m_allocations) {
+      allocations.push_back(&a.second);
+    }
+    std::sort(allocations.begin(), allocations.end(),
+              [](const Allocation *a, const Allocation *b) {
+                return a->bytes > b->bytes;
+              });
+
+    const size_t n_largest = std::min(allocations.size(), (size_t)20);
+
+    log.message(3, "Largest allocations on process 0:\n");
+    log.message(3, "  %-30s %-20s %5s %7s %10s\n", "name", "owner", "dof", "stencil", "MiB");
+    for (size_t k = 0; k < n_largest; ++k) {
+      const Allocation &a = *allocations[k];
+      log.message(3, "  %-30s %-20s %5d %7d %10.2f\n",
+                  a.name.c_str(), a.owner.c_str(), a.dof, a.stencil_width, a.bytes / MiB);
+    }
+  }
+}
+
+/*!
+ * Fraction of pages of the allocation `a` located on the NUMA node `node`.
+ *
+ * Checks at most 64 pages spread evenly over the allocation. Pages that were not touched
+ * yet are ignored. Returns -1 if the placement is not known.
+ */
+double MemoryTracker::local_fraction(const Allocation &a, int node) const {
+#if (PISM_NUMA_QUERIES==1)
+  if (a.data == nullptr or a.bytes == 0 or node < 0) {
+    return -1.0;
+  }
+
+  const uintptr_t
+    page_size = sysconf(_SC_PAGESIZE),
+    start     = (uintptr_t)a.data / page_size * page_size,
+    end       = (uintptr_t)a.data + a.bytes,
+    n_pages   = (end - start + page_size - 1) / page_size;
+
+  const size_t N = std::min(n_pages, (uintptr_t)64);
+
+  std::vector<void*> pages(N);
+  std::vector<int> status(N, -1);
+  for (size_t k = 0; k < N; ++k) {
+    pages[k] = (void*)(start + (k * n_pages / N) * page_size);
+  }
+
+  // with nodes == NULL move_pages() only reports the node of each page
+  if (syscall(SYS_move_pages, 0, N, pages.data(), nullptr, status.data(), 0) != 0) {
+    return -1.0;
+  }
+
+  int n_touched = 0, n_local = 0;
+  for (auto s : status) {
+    if (s >= 0) {
+      n_touched += 1;
+      n_local += (s == node);
+    }
+  }
+
+  return n_touched > 0 ? (double)n_local / n_touched : -1.0;
+#else
+  (void) a;
+  (void) node;
+  return -1.0;
+#endif
+}
+
+/*!
+ * Report the NUMA placement of tracked allocations and the CPU affinity of processes.
+ *
+ * For each process, finds the NUMA node of the CPU it is running on and the fraction of
+ * tracked memory located on this node, then prints the minimum and the mean over
+ * processes. Prints the placement of the largest allocations on process 0 at verbosity 3.
+ *
+ * Storage of a field is touched first by the process that owns it, so it is usually
+ * placed on the right node. Memory ends up on a "remote" node if the operating system
+ * moves a process after its memory was allocated, i.e. if processes are not bound to
+ * cores or NUMA domains.
+ *
+ * Collective.
+ */
+void MemoryTracker::report_numa(const Logger &log, MPI_Comm com) const {
+  const int node = current_numa_node();
+
+  double local_bytes = 0.0, known_bytes = 0.0;
+  for (const auto &a : m_allocations) {
+    double f = local_fraction(a.second, node);
+    if (f >= 0.0) {
+      local_bytes += f * a.second.bytes;
+      known_bytes += a.second.bytes;
+    }
+  }
+
+  // -1 means "not known"
+  double local = known_bytes > 0.0 ? local_bytes / known_bytes : -1.0;
+
+  double
+    n_known    = GlobalSum(com, local >= 0.0 ? 1.0 : 0.0),
+    local_min  = GlobalMin(com, local >= 0.0 ? local : 1.0),
+    local_sum  = GlobalSum(com, local >= 0.0 ? local : 0.0),
+    cpus_max   = GlobalMax(com, allowed_cpus());
+
+  if (n_known == 0.0) {
+    log.message(2, "NUMA placement of fields is not available.\n");
+    return;
+  }
+
+  log.message(2,
+              "NUMA placement of fields (fraction on the node of the owning process):\n"
+              "  minimum over processes: %5.1f%%\n"
+              "  mean over processes:    %5.1f%%\n",
+              100.0 * local_min, 100.0 * local_sum / n_known);
+
+  if (cpus_max > 1.0) {
+    log.message(2,
+                "  Some processes may run on any of up to %d CPUs. Bind each process to a\n"
+                "  core or a NUMA domain (e.g. mpiexec --bind-to core) to keep their memory\n"
+                "  local.\n", (int)cpus_max);
+  }
+
+  if (log.get_threshold() >= 3) {
+    std::vector<const Allocation*> allocations;
+    for (const auto &a : m_allocations) {
+      allocations.push_back(&a.second);
+    }
+    std::sort(allocations.begin(), allocations.end(),
+              [](const Allocation *a, const Allocation *b) {
+                return a->bytes > b->bytes;
+              });
+
+    const size_t n_largest = std::min(allocations.size(), (size_t)20);
+
+    log.message(3, "NUMA placement of the largest allocations on process 0 (node %d):\n", node);
+    log.message(3, "  %-30s %-20s %8s\n", "name", "owner", "local");
+    for (size_t k = 0; k < n_largest; ++k) {
+      const Allocation &a = *allocations[k];
+      double f = local_fraction(a, node);
+      if (f >= 0.0) {
+        log.message(3, "  %-30s %-20s %7.1f%%\n", a.name.c_str(), a.owner.c_str(), 100.0 * f);
+      } else {
+        log.message(3, "  %-30s %-20s %8s\n", a.name.c_str(), a.owner.c_str(), "-");
+      }
+    }
+  }
+}
+
+MemoryTracker::Owner::Owner(const MemoryTracker &tracker, const std::string &name)
+  : m_tracker(tracker) {
+  m_tracker.m_owners.push_back(name);
+}
+
+MemoryTracker::Owner::~Owner() {
+  m_tracker.m_owners.pop_back();
+}
+
+} // end of namespace pism
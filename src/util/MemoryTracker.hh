@@ -0,0 +1,99 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_MEMORYTRACKER_H
+#define PISM_MEMORYTRACKER_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+namespace pism {
+
+class Logger;
+
+//! Keeps track of large allocations (fields, FFTW work arrays, etc).
+/*!
+ * Each allocation is tagged by its "owner", usually the name of a sub-model: the owner is
+ * set using MemoryTracker::Owner while the sub-model is allocated.
+ *
+ * All sizes are in bytes and refer to the current process.
+ */
+class MemoryTracker {
+public:
+  MemoryTracker();
+
+  int allocate(const std::string &name, size_t bytes,
+               int dof = 1, int stencil_width = 0,
+               const void *data = nullptr) const;
+  void deallocate(int id) const;
+
+  size_t current() const;
+  size_t peak() const;
+
+  size_t current(const std::string &owner) const;
+  size_t peak(const std::string &owner) const;
+
+  void report(const Logger &log, MPI_Comm com) const;
+  void report_numa(const Logger &log, MPI_Comm com) const;
+
+  static size_t resident_set_size();
+  static size_t peak_resident_set_size();
+
+  //! Sets the owner of allocations made during its lifetime.
+  class Owner {
+  public:
+    Owner(const MemoryTracker &tracker, const std::string &name);
+    ~Owner();
+  private:
+    const MemoryTracker &m_tracker;
+  };
+private:
+  struct Allocation {
+    std::string owner;
+    std::string name;
+    size_t bytes;
+    int dof;
+    int stencil_width;
+    // start of the storage (used to find its NUMA placement); may be null
+    const void *data;
+  };
+
+  double local_fraction(const Allocation &a, int node) const;
+
+  struct Usage {
+    size_t current;
+    size_t peak;
+  };
+
+  void update(const std::string &owner, long int change) const;
+
+  mutable std::map<int, Allocation> m_allocations;
+  mutable int m_next_id;
+  mutable std::map<std::string, Usage> m_usage;
+  mutable Usage m_total;
+  mutable std::vector<std::string> m_owners;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_MEMORYTRACKER_H */
@@ -17,8 +17,11 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <cmath>                // std::isnan
+
 #include "Poisson.hh"
 #include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
 
 namespace pism {
 
@@ -27,7 +30,8 @@ Poisson::Poisson(IceGrid::ConstPtr grid)
     m_log(grid->ctx()->log()),
     m_b(grid, "poisson_rhs", WITHOUT_GHOSTS),
     m_x(grid, "poisson_x", WITHOUT_GHOSTS),
-    m_mask(grid, "poisson_mask", WITH_GHOSTS){
+    m_mask(grid, "poisson_mask", WITH_GHOSTS),
+    m_matrix_is_valid(false) {
 
   m_da = m_x.dm();
 
@@ -46,7 +50,19 @@ Poisson::Poisson(IceGrid::ConstPtr grid)
     ierr = KSPSetOptionsPrefix(m_KSP, "poisson_");
     PISM_CHK(ierr, "KSPSetOptionsPrefix");
 
-    // Process options:
+    // Defaults: GMRES preconditioned by algebraic multigrid. The number of iterations
+    // needed by the default (ILU) preconditioner grows quickly with the grid size.
+    ierr = KSPSetType(m_KSP, KSPGMRES);
+    PISM_CHK(ierr, "KSPSetType");
+
+    PC pc;
+    ierr = KSPGetPC(m_KSP, &pc);
+    PISM_CHK(ierr, "KSPGetPC");
+
+    ierr = PCSetType(pc, PCGAMG);
+    PISM_CHK(ierr, "PCSetType");
+
+    // Process options (-poisson_ksp_type, -poisson_pc_type, etc):
     ierr = KSPSetFromOptions(m_KSP);
     PISM_CHK(ierr, "KSPSetFromOptions");
   }
@@ -58,14 +74,23 @@ Poisson::Poisson(IceGrid::ConstPtr grid)
  * with the constant right hand side `rhs`.
  *
  * Set the mask to 2 to use zero Neumann BC.
+ *
+ * The matrix (and the preconditioner) built during the previous call are re-used if the
+ * mask did not change. Set `reuse_matrix` to skip this check and use the previous
+ * solution as the initial guess.
  */
 int Poisson::solve(const IceModelVec2Int& mask, const IceModelVec2S& bc, double rhs,
                    bool reuse_matrix) {
 
   PetscErrorCode ierr;
 
-  // make a ghosted copy of the mask
-  m_mask.copy_from(mask);
+  if (not reuse_matrix and mask_changed(mask)) {
+    // make a ghosted copy of the mask
+    m_mask.copy_from(mask);
+
+    assemble_matrix(m_mask, m_A);
+    m_matrix_is_valid = true;
+  }
 
   if (reuse_matrix) {
     // Use non-zero initial guess. I assume that re-using the matrix means that the BC and
@@ -76,13 +101,12 @@ int Poisson::solve(const IceModelVec2Int& mask, const IceModelVec2S& bc, double
   } else {
     ierr = KSPSetInitialGuessNonzero(m_KSP, PETSC_FALSE);
     PISM_CHK(ierr, "KSPSetInitialGuessNonzero");
-
-    assemble_matrix(m_mask, m_A);
   }
 
   assemble_rhs(rhs, m_mask, bc, m_b);
 
-  // Call PETSc to solve linear system by iterative method.
+  // Call PETSc to solve linear system by iterative method. PETSc re-builds the
+  // preconditioner only if m_A was re-assembled.
   ierr = KSPSetOperators(m_KSP, m_A, m_A);
   PISM_CHK(ierr, "KSPSetOperator");
 
@@ -117,6 +141,32 @@ const IceModelVec2S& Poisson::solution() const {
   return m_x;
 }
 
+/*!
+ * Returns true if `mask` differs from the one used to assemble the matrix.
+ *
+ * Compares values instead of using IceModelVec::state_counter(): code modifying a mask
+ * using IceModelVec::AccessList (e.g. Python scripts) does not increment the counter.
+ */
+bool Poisson::mask_changed(const IceModelVec2Int &mask) const {
+  if (not m_matrix_is_valid) {
+    return true;
+  }
+
+  IceModelVec::AccessList list{&mask, &m_mask};
+
+  int changed = 0;
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    if (mask.as_int(i, j) != m_mask.as_int(i, j)) {
+      changed = 1;
+      break;
+    }
+  }
+
+  return GlobalMax(m_grid->com, changed) > 0;
+}
+
 // Maxima code deriving the discretization
 //
 // /* Shift in x and y directions. */
@@ -270,4 +320,55 @@ void Poisson::assemble_rhs(double rhs,
   }
 }
 
+/*!
+ * Replace missing values (NaNs) in `field` with the solution of the Laplace equation,
+ * using valid values as Dirichlet boundary conditions ("harmonic fill").
+ *
+ * Sets `field` to `default_value` if it does not contain any valid values.
+ *
+ * Returns the number of values replaced.
+ */
+int fill_missing_harmonic(IceModelVec2S &field, double default_value) {
+  IceGrid::ConstPtr grid = field.grid();
+
+  IceModelVec2Int mask(grid, "missing_values_mask", WITHOUT_GHOSTS);
+  IceModelVec2S bc(grid, "missing_values_bc", WITHOUT_GHOSTS);
+
+  int n_missing = 0;
+  {
+    IceModelVec::AccessList list{&field, &mask, &bc};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      if (std::isnan(field(i, j))) {
+        mask(i, j) = 1.0;
+        bc(i, j)   = 0.0;
+        n_missing += 1;
+      } else {
+        mask(i, j) = 0.0;
+        bc(i, j)   = field(i, j);
+      }
+    }
+  }
+
+  n_missing = GlobalSum(grid->com, n_missing);
+
+  if (n_missing == 0) {
+    return 0;
+  }
+
+  if (n_missing == (int)(grid->Mx() * grid->My())) {
+    field.set(default_value);
+    return n_missing;
+  }
+
+  Poisson solver(grid);
+  solver.solve(mask, bc, 0.0);
+
+  field.copy_from(solver.solution());
+
+  return n_missing;
+}
+
 } // end of namespace pism
@@ -34,6 +34,7 @@ public:
 
   const IceModelVec2S &solution() const;
 private:
+  bool mask_changed(const IceModelVec2Int &mask) const;
   void assemble_matrix(const IceModelVec2Int &mask, Mat A);
   void assemble_rhs(double rhs,
                     const IceModelVec2Int &mask,
@@ -48,6 +49,10 @@ private:
   IceModelVec2S m_b;
   IceModelVec2S m_x;
   IceModelVec2Int m_mask;
+  //! true if m_A was assembled using the mask stored in m_mask
+  bool m_matrix_is_valid;
 };
 
+int fill_missing_harmonic(IceModelVec2S &field, double default_value);
+
 } // end of namespace pism
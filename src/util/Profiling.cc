@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016 PISM Authors
+/* Copyright (C) 2015, 2016, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,10 +17,15 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <cstdio>
+#include <iterator>             // std::next
+#include <set>
 #include <petscviewer.h>
 
 #include "Profiling.hh"
 #include "error_handling.hh"
+#include "pism_utilities.hh"
+#include "MemoryTracker.hh"
 
 namespace pism {
 
@@ -40,12 +45,37 @@ void Profiling::start() const {
 #endif
 }
 
+/*!
+ * Start recording hardware counters (see HardwareCounters) in all regions.
+ *
+ * Reading counters adds a system call per counter at the beginning and the end of each
+ * region. Call this before creating threads (e.g. before the first OpenMP parallel
+ * region) so that counters include work done by all threads.
+ *
+ * Throws if hardware counters are not available or if a region is active.
+ */
+void Profiling::enable_counters() const {
+  if (not m_active.empty()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot enable hardware counters in the region \"%s\"",
+                                  m_regions[m_active.back()].name.c_str());
+  }
+
+  if (not m_counters) {
+    m_counters = std::make_shared<HardwareCounters>();
+  }
+}
+
+bool Profiling::counters_enabled() const {
+  return (bool)m_counters;
+}
+
 //! Save detailed profiling data to a Python script.
-void Profiling::report(const std::string &filename) const {
+void Profiling::report(MPI_Comm com, const std::string &filename) const {
   PetscErrorCode ierr;
   PetscViewer log_viewer;
 
-  ierr = PetscViewerCreate(PETSC_COMM_WORLD, &log_viewer);
+  ierr = PetscViewerCreate(com, &log_viewer);
   PISM_CHK(ierr, "PetscViewerCreate");
 
   ierr = PetscViewerSetType(log_viewer, PETSCVIEWERASCII);
@@ -71,34 +101,276 @@ void Profiling::report(const std::string &filename) const {
 }
 
 
+//! Get the ID of the region `name`, registering it if necessary.
+int Profiling::region(const char *name) const {
+  auto r = m_region_ids.find(name);
+  if (r != m_region_ids.end()) {
+    return r->second;
+  }
+
+  // not registered yet
+  Region result;
+  result.name   = name;
+  result.event  = 0;
+  result.parent = -1;
+  result.time   = 0.0;
+  result.start  = 0.0;
+  result.calls  = 0;
+  result.flops  = 0.0;
+  result.bytes  = 0.0;
+  result.counters.fill(0);
+  result.counters_start.fill(0);
+
+  PetscErrorCode ierr = PetscLogEventRegister(name, m_classid, &result.event);
+  PISM_CHK(ierr, "PetscLogEventRegister");
+
+  int id = m_regions.size();
+  m_regions.push_back(result);
+  m_region_ids[name] = id;
+
+  return id;
+}
+
+//! Total wall-clock time (in seconds) spent in the region `id` on this process.
+double Profiling::time(int id) const {
+  return m_regions.at(id).time;
+}
+
+/*!
+ * Add `flops` floating point operations and `bytes` of memory reads and writes to the
+ * work done in the region `id`.
+ *
+ * These are (rough) operation counts of a kernel, usually the number of grid points (or
+ * grid points times vertical levels) processed times per-point costs.
+ */
+void Profiling::add_work(int id, double flops, double bytes) const {
+  Region &r = m_regions.at(id);
+  r.flops += flops;
+  r.bytes += bytes;
+}
+
 void Profiling::begin(const char * name) const {
-  PetscLogEvent event = 0;
-  PetscErrorCode ierr;
+  begin(region(name));
+}
 
-  if (m_events.find(name) == m_events.end()) {
-    // not registered yet
-    ierr = PetscLogEventRegister(name, m_classid, &event);
-    PISM_CHK(ierr, "PetscLogEventRegister");
-    m_events[name] = event;
-  } else {
-    event = m_events[name];
+void Profiling::end(const char * name) const {
+  auto r = m_region_ids.find(name);
+  if (r == m_region_ids.end()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "cannot end event \"%s\" because it was not started",
+                                  name);
+  }
+  end(r->second);
+}
+
+void Profiling::begin(int id) const {
+  Region &r = m_regions.at(id);
+
+  if (r.calls == 0 and not m_active.empty()) {
+    r.parent = m_active.back();
   }
-  ierr = PetscLogEventBegin(event, 0, 0, 0, 0);
+
+  m_active.push_back(id);
+  r.calls += 1;
+  r.start = MPI_Wtime();
+
+  if (m_counters) {
+    m_counters->read(r.counters_start);
+  }
+
+  PetscErrorCode ierr = PetscLogEventBegin(r.event, 0, 0, 0, 0);
   PISM_CHK(ierr, "PetscLogEventBegin");
 }
 
-void Profiling::end(const char * name) const {
-  PetscLogEvent event = 0;
-  if (m_events.find(name) == m_events.end()) {
+void Profiling::end(int id) const {
+  Region &r = m_regions.at(id);
+
+  // regions are usually ended in the reverse order, so the search is short
+  auto k = m_active.rbegin();
+  while (k != m_active.rend() and *k != id) {
+    ++k;
+  }
+
+  if (k == m_active.rend()) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION, "cannot end event \"%s\" because it was not started",
-                                  name);
-  } else {
-    event = m_events[name];
+                                  r.name.c_str());
   }
-  PetscErrorCode ierr = PetscLogEventEnd(event, 0, 0, 0, 0);
+  m_active.erase(std::next(k).base());
+
+  r.time += MPI_Wtime() - r.start;
+
+  if (m_counters) {
+    HardwareCounters::Values counters;
+    m_counters->read(counters);
+    for (unsigned int k = 0; k < counters.size(); ++k) {
+      r.counters[k] += counters[k] - r.counters_start[k];
+    }
+  }
+
+  PetscErrorCode ierr = PetscLogEventEnd(r.event, 0, 0, 0, 0);
   PISM_CHK(ierr, "PetscLogEventEnd");
 }
 
+Profiling::Scope::Scope(const Profiling &profiling, int region)
+  : m_profiling(profiling), m_region(region) {
+  m_profiling.begin(m_region);
+}
+
+Profiling::Scope::Scope(const Profiling &profiling, const char *name)
+  : m_profiling(profiling), m_region(profiling.region(name)) {
+  m_profiling.begin(m_region);
+}
+
+Profiling::Scope::~Scope() {
+  try {
+    m_profiling.end(m_region);
+  } catch (...) {
+    // don't ever throw from here
+    handle_fatal_errors(PETSC_COMM_WORLD);
+  }
+}
+
+/*!
+ * Summary of region timings (minimum, maximum and mean over processes in `com`).
+ *
+ * The load imbalance of a region is the ratio of the maximum and the mean time spent in
+ * it (1 if all processes take the same time).
+ *
+ * Work (see add_work()) and hardware counters are summed over processes. The arithmetic
+ * intensity uses measured memory traffic if hardware counters are enabled and reported
+ * bytes otherwise. Rates use the maximum time.
+ *
+ * Collective. Results are the same on all processes.
+ */
+std::vector<Profiling::RegionSummary> Profiling::summary(MPI_Comm com) const {
+  int size = 1;
+  MPI_Comm_size(com, &size);
+
+  std::set<std::string> local_names;
+  for (const auto &r : m_region_ids) {
+    local_names.insert(r.first);
+  }
+  auto names = global_union(com, local_names);
+  const int N = names.size();
+
+  std::vector<double> time(N, 0.0), calls(N, 0.0);
+  std::vector<std::string> parents(N);
+  // flops, bytes and hardware counters
+  const int n_work = 2 + HardwareCounters::N_COUNTERS;
+  std::vector<double> work(N * n_work, 0.0);
+  for (int k = 0; k < N; ++k) {
+    auto r = m_region_ids.find(names[k]);
+    if (r != m_region_ids.end()) {
+      const Region &R = m_regions[r->second];
+      time[k]    = R.time;
+      calls[k]   = R.calls;
+      parents[k] = R.parent >= 0 ? m_regions[R.parent].name : "";
+
+      double *W = &work[k * n_work];
+      W[0] = R.flops;
+      W[1] = R.bytes;
+      for (int c = 0; c < HardwareCounters::N_COUNTERS; ++c) {
+        W[2 + c] = R.counters[c];
+      }
+    }
+  }
+
+  std::vector<double> time_min(N), time_max(N), time_sum(N), calls_max(N);
+  MPI_Allreduce(time.data(), time_min.data(), N, MPI_DOUBLE, MPI_MIN, com);
+  MPI_Allreduce(time.data(), time_max.data(), N, MPI_DOUBLE, MPI_MAX, com);
+  MPI_Allreduce(time.data(), time_sum.data(), N, MPI_DOUBLE, MPI_SUM, com);
+  MPI_Allreduce(calls.data(), calls_max.data(), N, MPI_DOUBLE, MPI_MAX, com);
+
+  std::vector<double> work_sum(work.size());
+  MPI_Allreduce(work.data(), work_sum.data(), work.size(), MPI_DOUBLE, MPI_SUM, com);
+
+  const double line_size = HardwareCounters::cache_line_size();
+
+  std::vector<RegionSummary> result(N);
+  for (int k = 0; k < N; ++k) {
+    RegionSummary &r = result[k];
+
+    r.name      = names[k];
+    r.parent    = parents[k];
+    r.calls     = calls_max[k];
+    r.time_min  = time_min[k];
+    r.time_max  = time_max[k];
+    r.time_mean = time_sum[k] / size;
+    r.imbalance = r.time_mean > 0.0 ? r.time_max / r.time_mean : 1.0;
+
+    const double *W = &work_sum[k * n_work];
+    r.flops          = W[0];
+    r.bytes          = W[1];
+    r.cycles         = W[2 + HardwareCounters::CYCLES];
+    r.instructions   = W[2 + HardwareCounters::INSTRUCTIONS];
+    r.memory_traffic = W[2 + HardwareCounters::CACHE_MISSES] * line_size;
+
+    const double traffic = m_counters ? r.memory_traffic : r.bytes;
+    r.intensity = traffic > 0.0 ? r.flops / traffic : 0.0;
+    r.bandwidth = r.time_max > 0.0 ? traffic / r.time_max : 0.0;
+    r.flop_rate = r.time_max > 0.0 ? r.flops / r.time_max : 0.0;
+  }
+
+  return result;
+}
+
+/*!
+ * Save the summary of region timings (see summary()) and the peak resident set size (in
+ * bytes, maximum over processes) to a JSON file.
+ *
+ * Collective.
+ */
+void Profiling::report_regions(MPI_Comm com, const std::string &filename) const {
+  int rank = 0, size = 1;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  auto regions = summary(com);
+
+  double rss = MemoryTracker::peak_resident_set_size(), peak_rss = 0.0;
+  MPI_Allreduce(&rss, &peak_rss, 1, MPI_DOUBLE, MPI_MAX, com);
+
+  int success = 1;
+  if (rank == 0) {
+    FILE *f = fopen(filename.c_str(), "w");
+
+    if (f == nullptr) {
+      success = 0;
+    } else {
+      fprintf(f, "{\n  \"n_processes\": %d,\n  \"peak_resident_set_size\": %.0f,\n"
+              "  \"regions\": [", size, peak_rss);
+      write_regions(f, regions);
+      fprintf(f, "\n  ]\n}\n");
+
+      success = fclose(f) == 0 ? 1 : 0;
+    }
+  }
+
+  MPI_Bcast(&success, 1, MPI_INT, 0, com);
+  if (success == 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "failed to write profiling data to '%s'",
+                                  filename.c_str());
+  }
+}
+
+//! Write elements of a JSON array describing `regions` to `f`.
+void Profiling::write_regions(FILE *f, const std::vector<RegionSummary> &regions) {
+  for (unsigned int k = 0; k < regions.size(); ++k) {
+    const RegionSummary &r = regions[k];
+
+    fprintf(f,
+            "%s\n    {\"name\": \"%s\", \"parent\": \"%s\", \"calls\": %.0f,"
+            " \"time_min\": %.6f, \"time_max\": %.6f, \"time_mean\": %.6f,"
+            " \"imbalance\": %.4f, \"flops\": %.0f, \"bytes\": %.0f,"
+            " \"cycles\": %.0f, \"instructions\": %.0f, \"memory_traffic\": %.0f,"
+            " \"intensity\": %.4f, \"bandwidth\": %.6e, \"flop_rate\": %.6e}",
+            k > 0 ? "," : "",
+            r.name.c_str(), r.parent.c_str(), r.calls,
+            r.time_min, r.time_max, r.time_mean, r.imbalance,
+            r.flops, r.bytes, r.cycles, r.instructions, r.memory_traffic,
+            r.intensity, r.bandwidth, r.flop_rate);
+  }
+}
+
 void Profiling::stage_begin(const char * name) const {
   PetscLogStage stage = 0;
   PetscErrorCode ierr;
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015 PISM Authors
+/* Copyright (C) 2015, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -20,25 +20,122 @@
 #ifndef _PROFILING_H_
 #define _PROFILING_H_
 
+#include <cstdio>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 #include <petsclog.h>
 
+#include "HardwareCounters.hh"
+
 namespace pism {
 
+//! Profiling "regions" (PETSc log events and stages).
+/*!
+ * Each region is a PETSc log event. In addition, PISM records the wall-clock time spent in
+ * each region and the number of calls, which can be summarized across processes (see
+ * report_regions()).
+ *
+ * Regions can be nested: the parent of a region is the region that was active when it
+ * was entered for the first time.
+ *
+ * Use region() to get the integer ID of a region once and begin(int) and end(int) (or
+ * Profiling::Scope) in frequently called code to avoid looking the region up by name.
+ *
+ * Computational kernels can report the (approximate) number of floating point operations
+ * they perform and bytes they read and write (see add_work()). If hardware counters are
+ * enabled (see enable_counters()), each region also records the number of cycles,
+ * instructions and last level cache misses. Together these give the arithmetic intensity
+ * and the achieved memory bandwidth of each kernel.
+ */
 class Profiling {
 public:
   Profiling();
   void start() const;
-  void report(const std::string &filename) const;
+  void report(MPI_Comm com, const std::string &filename) const;
+  void report_regions(MPI_Comm com, const std::string &filename) const;
+
+  void enable_counters() const;
+  bool counters_enabled() const;
+
+  //! Time spent in a region by processes in a communicator.
+  struct RegionSummary {
+    std::string name;
+    std::string parent;
+    //! maximum number of calls over all processes
+    double calls;
+    double time_min;
+    double time_max;
+    double time_mean;
+    //! ratio of the maximum and the mean time
+    double imbalance;
+    //! floating point operations reported using add_work() (sum over all processes)
+    double flops;
+    //! bytes read and written reported using add_work() (sum over all processes)
+    double bytes;
+    //! hardware counters (sums over all processes; zero if counters are disabled)
+    double cycles;
+    double instructions;
+    //! memory traffic (last level cache misses times the cache line size), in bytes
+    double memory_traffic;
+    //! flops per byte of memory traffic (measured if available, otherwise reported)
+    double intensity;
+    //! bytes per second of memory traffic (using the maximum time)
+    double bandwidth;
+    //! floating point operations per second (using the maximum time)
+    double flop_rate;
+  };
+  std::vector<RegionSummary> summary(MPI_Comm com) const;
+  static void write_regions(FILE *f, const std::vector<RegionSummary> &regions);
+
+  int region(const char *name) const;
+  double time(int region) const;
+  void add_work(int region, double flops, double bytes) const;
+
   void begin(const char *name) const;
   void end(const char *name) const;
+  void begin(int region) const;
+  void end(int region) const;
   void stage_begin(const char *name) const;
   void stage_end(const char *name) const;
+
+  //! Calls begin() in the constructor and end() in the destructor.
+  class Scope {
+  public:
+    Scope(const Profiling &profiling, int region);
+    Scope(const Profiling &profiling, const char *name);
+    ~Scope();
+  private:
+    const Profiling &m_profiling;
+    int m_region;
+  };
 private:
+  struct Region {
+    std::string name;
+    PetscLogEvent event;
+    //! ID of the parent region (-1 if none)
+    int parent;
+    //! total wall-clock time spent in this region, in seconds
+    double time;
+    //! wall-clock time at the beginning of the current call
+    double start;
+    unsigned long int calls;
+    //! reported work (see add_work())
+    double flops;
+    double bytes;
+    //! hardware counter totals and values at the beginning of the current call
+    HardwareCounters::Values counters;
+    HardwareCounters::Values counters_start;
+  };
+
   PetscClassId m_classid;
-  mutable std::map<std::string, PetscLogEvent> m_events;
+  mutable std::vector<Region> m_regions;
+  mutable std::map<std::string, int> m_region_ids;
+  //! IDs of active regions
+  mutable std::vector<int> m_active;
   mutable std::map<std::string, PetscLogStage> m_stages;
+  mutable std::shared_ptr<HardwareCounters> m_counters;
 };
 
 } // end of namespace pism
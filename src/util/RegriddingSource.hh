@@ -0,0 +1,53 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_REGRIDDINGSOURCE_H
+#define PISM_REGRIDDINGSOURCE_H
+
+#include <string>
+
+namespace pism {
+
+class IceModelVec;
+
+//! Fields of a model running on a different grid, used instead of `-regrid_file`.
+/*!
+ * Set using IceGrid::set_regridding_source(). Component::regrid() and
+ * IceModel::regrid() interpolate model state variables from this source if it is set (see
+ * IceModelVec::regrid(const IceModelVec&)), so a model can be initialized from the
+ * state of another model without writing it to a file.
+ */
+class RegriddingSource {
+public:
+  virtual ~RegriddingSource() = default;
+
+  //! Returns the field `name` or NULL if it is not available.
+  /*!
+   * The result remains valid while this object exists.
+   */
+  const IceModelVec* get(const std::string &name) const {
+    return this->get_impl(name);
+  }
+protected:
+  virtual const IceModelVec* get_impl(const std::string &name) const = 0;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_REGRIDDINGSOURCE_H */
@@ -0,0 +1,55 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_SOLVERSTATS_H
+#define PISM_SOLVERSTATS_H
+
+#include <vector>
+
+namespace pism {
+
+//! The cost of the last update of a model using an iterative solver.
+struct SolverStats {
+  SolverStats() {
+    reset();
+  }
+
+  void reset() {
+    steps                = 0;
+    nonlinear_iterations = 0;
+    linear_iterations    = 0;
+    wall_time            = 0.0;
+    residuals.clear();
+  }
+
+  //! number of solves (or sub-steps)
+  unsigned int steps;
+  //! total number of nonlinear (or pseudo-time) iterations
+  unsigned int nonlinear_iterations;
+  //! total number of linear solver iterations
+  unsigned int linear_iterations;
+  //! wall-clock time spent in the update on this process, in seconds
+  double wall_time;
+  //! the convergence criterion after each nonlinear iteration (if recorded by the model)
+  std::vector<double> residuals;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_SOLVERSTATS_H */
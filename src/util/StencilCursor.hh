@@ -0,0 +1,203 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_STENCILCURSOR_H
+#define PISM_STENCILCURSOR_H
+
+#include <initializer_list>
+#include <vector>
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+/*!
+ * Read-only access to an IceModelVec2S one grid row at a time.
+ *
+ * Keeps pointers to the current row and the rows to the south and north of it, so that
+ * star and box stencils are read using pointer arithmetic instead of two-level indexing
+ * (and without index checks, except in debug builds). Use with Rows:
+ *
+ *     IceModelVec::AccessList list{&H, &b, &result};
+ *
+ *     StencilCursor h(H), bed(b);
+ *     for (Rows r(*grid, {&h, &bed}); r; r.next()) {
+ *       const int j = r.j();
+ *       for (int i = r.i_first(); i <= r.i_last(); ++i) {
+ *         auto S = h.star(i);
+ *         result(i, j) = ... bed[i] ...;
+ *       }
+ *     }
+ *
+ * The inner loop does not depend on the iterator state, which makes it easier for
+ * compilers to vectorize it.
+ *
+ * The field has to be accessed (e.g. using an AccessList) before a cursor is created.
+ * Rows to the south and north are available only if the field is ghosted.
+ */
+class StencilCursor {
+public:
+  StencilCursor(const IceModelVec2S &field)
+    : m_array(static_cast<const double**>(field.m_array)),
+      m_south(nullptr), m_row(nullptr), m_north(nullptr) {
+
+    if (m_array == nullptr) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "%s: begin_access() was not called",
+                                    field.get_name().c_str());
+    }
+
+    IceGrid::ConstPtr grid = field.grid();
+    const int w = field.stencil_width();
+    m_i_first = grid->xs() - w;
+    m_i_last  = grid->xs() + grid->xm() + w - 1;
+    m_j_first = grid->ys() - w;
+    m_j_last  = grid->ys() + grid->ym() + w - 1;
+    m_j = m_j_first;
+  }
+
+  //! Move to the row `j`.
+  inline void set_row(int j) {
+#if (Pism_DEBUG==1)
+    if (j < m_j_first or j > m_j_last) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "row %d is out of bounds [%d, %d]",
+                                    j, m_j_first, m_j_last);
+    }
+#endif
+    m_j     = j;
+    m_row   = m_array[j];
+    m_south = j > m_j_first ? m_array[j - 1] : nullptr;
+    m_north = j < m_j_last  ? m_array[j + 1] : nullptr;
+  }
+
+  //! Value at `(i, j)`, where `j` is the current row.
+  inline double operator[](int i) const {
+#if (Pism_DEBUG==1)
+    check(i, m_row);
+#endif
+    return m_row[i];
+  }
+
+  //! Value in the row to the north of the current one.
+  inline double north(int i) const {
+#if (Pism_DEBUG==1)
+    check(i, m_north);
+#endif
+    return m_north[i];
+  }
+
+  //! Value in the row to the south of the current one.
+  inline double south(int i) const {
+#if (Pism_DEBUG==1)
+    check(i, m_south);
+#endif
+    return m_south[i];
+  }
+
+  //! Same as IceModelVec2S::star(i, j), where `j` is the current row.
+  inline StarStencil<double> star(int i) const {
+    StarStencil<double> result;
+
+    result.ij = (*this)[i];
+    result.e  = (*this)[i + 1];
+    result.w  = (*this)[i - 1];
+    result.n  = north(i);
+    result.s  = south(i);
+
+    return result;
+  }
+
+  //! Same as IceModelVec2S::box(i, j), where `j` is the current row.
+  inline BoxStencil<double> box(int i) const {
+    const int E = i + 1, W = i - 1;
+
+    return {(*this)[i], north(i), north(W), (*this)[W], south(W),
+            south(i), south(E), (*this)[E], north(E)};
+  }
+private:
+  void check(int i, const double *row) const {
+    if (row == nullptr or i < m_i_first or i > m_i_last) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "(%d, %d) is out of bounds (or the row is not available)",
+                                    i, m_j);
+    }
+  }
+
+  const double **m_array;
+  int m_i_first, m_i_last, m_j_first, m_j_last;
+  int m_j;
+  const double *m_south, *m_row, *m_north;
+};
+
+/*!
+ * Iterator traversing rows of the local part of the grid (including `stencil_width`
+ * ghosts) and moving all the cursors it was given to the current row.
+ */
+class Rows {
+public:
+  Rows(const IceGrid &grid, std::initializer_list<StencilCursor*> cursors,
+       unsigned int stencil_width = 0)
+    : m_cursors(cursors) {
+    const int w = stencil_width;
+    m_i_first = grid.xs() - w;
+    m_i_last  = grid.xs() + grid.xm() + w - 1;
+    m_j       = grid.ys() - w;
+    m_j_last  = grid.ys() + grid.ym() + w - 1;
+
+    set_row();
+  }
+
+  int j() const {
+    return m_j;
+  }
+
+  int i_first() const {
+    return m_i_first;
+  }
+
+  int i_last() const {
+    return m_i_last;
+  }
+
+  void next() {
+    m_j += 1;
+    set_row();
+  }
+
+  operator bool() const {
+    return m_j <= m_j_last;
+  }
+private:
+  void set_row() {
+    if (m_j <= m_j_last) {
+      for (auto c : m_cursors) {
+        c->set_row(m_j);
+      }
+    }
+  }
+
+  std::vector<StencilCursor*> m_cursors;
+  int m_i_first, m_i_last, m_j, m_j_last;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_STENCILCURSOR_H */
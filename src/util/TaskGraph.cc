@@ -0,0 +1,156 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::reverse
+
+#include "TaskGraph.hh"
+#include "Profiling.hh"
+#include "error_handling.hh"
+
+namespace pism {
+
+TaskGraph::TaskGraph(const Profiling &profiling)
+  : m_profiling(profiling),
+    m_total_time(0.0),
+    m_critical_path_time(0.0) {
+  // empty
+}
+
+/*!
+ * Add the task `name` (a profiling region) depending on tasks in `dependencies`.
+ *
+ * Dependencies have to be added first, so the graph is acyclic.
+ */
+void TaskGraph::add(const std::string &name, const std::vector<std::string> &dependencies) {
+  if (m_task_ids.find(name) != m_task_ids.end()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "task '%s' was added already", name.c_str());
+  }
+
+  Task task;
+  task.name      = name;
+  task.region    = m_profiling.region(name.c_str());
+  task.last_time = m_profiling.time(task.region);
+  task.time      = 0.0;
+
+  for (const auto &d : dependencies) {
+    auto k = m_task_ids.find(d);
+    if (k == m_task_ids.end()) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "task '%s' depends on '%s', which was not added yet",
+                                    name.c_str(), d.c_str());
+    }
+    task.dependencies.push_back(k->second);
+  }
+
+  m_task_ids[name] = m_tasks.size();
+  m_tasks.push_back(task);
+}
+
+//! Record times spent in all tasks since the last call.
+void TaskGraph::update() {
+  std::vector<double> step_time(m_tasks.size());
+
+  for (unsigned int k = 0; k < m_tasks.size(); ++k) {
+    Task &task = m_tasks[k];
+
+    double time = m_profiling.time(task.region);
+
+    step_time[k]   = time - task.last_time;
+    task.last_time = time;
+    task.time     += step_time[k];
+
+    m_total_time += step_time[k];
+  }
+
+  double length = 0.0;
+  longest_path(step_time, length);
+
+  m_critical_path_time += length;
+}
+
+//! Total time spent in all tasks on this process.
+double TaskGraph::total_time() const {
+  return m_total_time;
+}
+
+/*!
+ * Sum of lengths of critical paths of all steps on this process, i.e. the time spent in
+ * all tasks if independent tasks overlapped perfectly.
+ */
+double TaskGraph::critical_path_time() const {
+  return m_critical_path_time;
+}
+
+//! The critical path computed using total times spent in each task.
+std::vector<std::string> TaskGraph::critical_path() const {
+  std::vector<double> time;
+  for (const auto &task : m_tasks) {
+    time.push_back(task.time);
+  }
+
+  double length = 0.0;
+  std::vector<std::string> result;
+  for (int k : longest_path(time, length)) {
+    result.push_back(m_tasks[k].name);
+  }
+  return result;
+}
+
+/*!
+ * Find the longest path through the graph if the task `k` takes `time[k]` seconds.
+ *
+ * Tasks are stored in a topological order, so the earliest finishing time of each task
+ * can be computed in one pass.
+ */
+std::vector<int> TaskGraph::longest_path(const std::vector<double> &time,
+                                         double &length) const {
+  const int N = m_tasks.size();
+
+  std::vector<double> finish(N, 0.0);
+  std::vector<int> previous(N, -1);
+
+  int last = -1;
+  for (int k = 0; k < N; ++k) {
+    double start = 0.0;
+    for (int d : m_tasks[k].dependencies) {
+      if (previous[k] < 0 or finish[d] > start) {
+        start       = finish[d];
+        previous[k] = d;
+      }
+    }
+    finish[k] = start + time[k];
+
+    if (last < 0 or finish[k] > finish[last]) {
+      last = k;
+    }
+  }
+
+  length = last >= 0 ? finish[last] : 0.0;
+
+  std::vector<int> result;
+  for (int k = last; k >= 0; k = previous[k]) {
+    result.push_back(k);
+  }
+  std::reverse(result.begin(), result.end());
+
+  return result;
+}
+
+} // end of namespace pism
@@ -0,0 +1,78 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_TASKGRAPH_H
+#define PISM_TASKGRAPH_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pism {
+
+class Profiling;
+
+//! Data dependencies between the stages of a time step.
+/*!
+ * Each task is a profiling region (see Profiling::region()). A task depends on tasks that
+ * produce its inputs and on tasks reading fields it modifies.
+ *
+ * Call update() after each time step to record the time spent in each task during this
+ * step. The critical path (the longest chain of dependent tasks) is the lower bound on
+ * the time a step would take if independent tasks overlapped.
+ */
+class TaskGraph {
+public:
+  TaskGraph(const Profiling &profiling);
+
+  void add(const std::string &name, const std::vector<std::string> &dependencies);
+
+  void update();
+
+  double total_time() const;
+  double critical_path_time() const;
+  std::vector<std::string> critical_path() const;
+private:
+  struct Task {
+    std::string name;
+    //! profiling region ID
+    int region;
+    //! indices of tasks this task depends on (all smaller than the index of this task)
+    std::vector<int> dependencies;
+    //! region time at the end of the previous step
+    double last_time;
+    //! total time spent in this task since the graph was created
+    double time;
+  };
+
+  std::vector<int> longest_path(const std::vector<double> &time, double &length) const;
+
+  const Profiling &m_profiling;
+  std::vector<Task> m_tasks;
+  std::map<std::string, int> m_task_ids;
+
+  //! sum of times spent in all tasks
+  double m_total_time;
+  //! sum of lengths of critical paths of all steps
+  double m_critical_path_time;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_TASKGRAPH_H */
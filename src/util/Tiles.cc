@@ -0,0 +1,116 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::min, std::max
+
+#include "Tiles.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+//! Get the number of threads from `grid.tiles.threads` (1 if PISM is built without OpenMP).
+static int tiles_n_threads(const IceGrid &grid) {
+  const int n_threads = grid.ctx()->config()->get_number("grid.tiles.threads");
+
+  if (n_threads < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "grid.tiles.threads has to be positive (got %d)", n_threads);
+  }
+
+#if (Pism_USE_OPENMP==1)
+  return n_threads;
+#else
+  return 1;
+#endif
+}
+
+/*!
+ * Split the sub-domain owned by the current processor, extended by `stencil_width` ghost
+ * points, into tiles of size `grid.tiles.size` (tiles at the upper edges may be smaller).
+ */
+Tiles::Tiles(const IceGrid &grid, unsigned int stencil_width)
+  : Tiles(grid,
+          grid.xs() - (int)stencil_width, grid.xs() + grid.xm() + (int)stencil_width - 1,
+          grid.ys() - (int)stencil_width, grid.ys() + grid.ym() + (int)stencil_width - 1) {
+  // empty
+}
+
+/*!
+ * Split the rectangle `[i_first, i_last] x [j_first, j_last]` into tiles.
+ *
+ * The rectangle may be empty (e.g. the interior of a small sub-domain, see
+ * InteriorPoints); then there are no tiles.
+ */
+Tiles::Tiles(const IceGrid &grid, int i_first, int i_last, int j_first, int j_last) {
+  Config::ConstPtr config = grid.ctx()->config();
+
+  const int tile_size = config->get_number("grid.tiles.size");
+
+  if (tile_size < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "grid.tiles.size has to be positive (got %d)", tile_size);
+  }
+
+  m_n_threads = tiles_n_threads(grid);
+
+  // With one thread we use one tile to preserve the order of traversal (and avoid the
+  // overhead).
+  const int size = m_n_threads > 1 ? tile_size : std::max({i_last - i_first, j_last - j_first, 0}) + 1;
+
+  unsigned int index = 0;
+  for (int j = j_first; j <= j_last; j += size) {
+    for (int i = i_first; i <= i_last; i += size) {
+      Tile t;
+      t.index   = index;
+      t.i_first = i;
+      t.i_last  = std::min(i + size - 1, i_last);
+      t.j_first = j;
+      t.j_last  = std::min(j + size - 1, j_last);
+
+      m_tiles.push_back(t);
+      index += 1;
+    }
+  }
+}
+
+/*!
+ * Use an explicitly provided list of tiles (e.g. a subset of tiles with a given "colour",
+ * see fem::ElementIterator::tiles()).
+ */
+Tiles::Tiles(const IceGrid &grid, const std::vector<Tile> &tiles)
+  : m_tiles(tiles) {
+  m_n_threads = tiles_n_threads(grid);
+}
+
+unsigned int Tiles::size() const {
+  return m_tiles.size();
+}
+
+const Tile& Tiles::operator[](unsigned int k) const {
+  return m_tiles[k];
+}
+
+int Tiles::n_threads() const {
+  return m_n_threads;
+}
+
+} // end of namespace pism
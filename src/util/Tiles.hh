@@ -0,0 +1,172 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_TILES_H
+#define PISM_TILES_H
+
+#include <vector>
+#include <exception>
+#include <cassert>
+
+#include "pism/pism_config.hh"
+
+#if (Pism_USE_OPENMP==1)
+#include <omp.h>
+#endif
+
+namespace pism {
+
+class IceGrid;
+
+//! A rectangular part of a processor sub-domain.
+struct Tile {
+  //! index of this tile in the list of tiles (use to store per-tile results)
+  unsigned int index;
+  int i_first, i_last, j_first, j_last;
+};
+
+/** Iterator class for traversing points in a Tile.
+ *
+ * Usage:
+ *
+ * `for (PointsInTile p(tile); p; p.next()) { ... }`
+ */
+class PointsInTile {
+public:
+  PointsInTile(const Tile &tile)
+    : m_i(tile.i_first), m_j(tile.j_first),
+      m_i_first(tile.i_first), m_i_last(tile.i_last),
+      m_j_first(tile.j_first), m_j_last(tile.j_last),
+      m_done(tile.i_first > tile.i_last or tile.j_first > tile.j_last) {
+    // empty
+  }
+
+  int i() const {
+    return m_i;
+  }
+  int j() const {
+    return m_j;
+  }
+
+  void next() {
+    assert(not m_done);
+    m_i += 1;
+    if (m_i > m_i_last) {
+      m_i = m_i_first;        // wrap around
+      m_j += 1;
+    }
+    if (m_j > m_j_last) {
+      m_j = m_j_first;        // ensure that indexes are valid
+      m_done = true;
+    }
+  }
+
+  operator bool() const {
+    return not m_done;
+  }
+private:
+  int m_i, m_j;
+  int m_i_first, m_i_last, m_j_first, m_j_last;
+  bool m_done;
+};
+
+//! Splits the processor sub-domain (possibly including ghosts) into tiles.
+/*!
+ * Tiles can be processed concurrently by several threads (see for_each_tile()). This
+ * requires PISM built with OpenMP (`Pism_USE_OPENMP`); the number of threads is set using
+ * `grid.tiles.threads` and the size of a tile using `grid.tiles.size`.
+ *
+ * Without OpenMP or with one thread tiles are processed in order. Since every point
+ * belongs to exactly one tile, kernels that do not combine values from different points
+ * produce the same results in all cases.
+ */
+class Tiles {
+public:
+  Tiles(const IceGrid &grid, unsigned int stencil_width = 0);
+  Tiles(const IceGrid &grid, int i_first, int i_last, int j_first, int j_last);
+  Tiles(const IceGrid &grid, const std::vector<Tile> &tiles);
+
+  unsigned int size() const;
+  const Tile& operator[](unsigned int k) const;
+
+  //! Number of threads used to process these tiles.
+  int n_threads() const;
+private:
+  std::vector<Tile> m_tiles;
+  int m_n_threads;
+};
+
+/*!
+ * Index of the calling thread (`0, ..., tiles.n_threads() - 1`) when called from within
+ * for_each_tile().
+ *
+ * Use this to select work space (e.g. column systems) allocated once per thread instead
+ * of once per tile.
+ */
+inline unsigned int tile_thread() {
+#if (Pism_USE_OPENMP==1)
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+/*!
+ * Call `f(tile)` for each tile in `tiles`, using `tiles.n_threads()` threads.
+ *
+ * `f` has to be safe to call concurrently for different tiles. In particular, it should
+ * not modify data shared between tiles (use `Tile::index` to store per-tile results), it
+ * should allocate its own work space, and it should not read configuration parameters
+ * (Config keeps track of parameters that were used and is not thread-safe).
+ *
+ * If `f` throws, the first exception is re-thrown (by the calling thread) after all tiles
+ * are processed, so this can be used within a ParallelSection.
+ */
+template<class F>
+void for_each_tile(const Tiles &tiles, const F &f) {
+  const int N = tiles.size();
+
+  std::exception_ptr error;
+
+#if (Pism_USE_OPENMP==1)
+#pragma omp parallel for schedule(dynamic) num_threads(tiles.n_threads()) if (tiles.n_threads() > 1)
+#endif
+  for (int k = 0; k < N; ++k) {
+    try {
+      f(tiles[k]);
+    } catch (...) {
+#if (Pism_USE_OPENMP==1)
+#pragma omp critical (pism_for_each_tile)
+#endif
+      {
+        if (not error) {
+          error = std::current_exception();
+        }
+      }
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // end of namespace pism
+
+#endif /* PISM_TILES_H */
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -60,7 +60,9 @@ Time_Calendar::Time_Calendar(MPI_Comm c, Config::ConstPtr conf,
                              const std::string &calendar_string,
                              units::System::Ptr units_system)
   : Time(conf, calendar_string, units_system),
-    m_com(c) {
+    m_com(c),
+    m_year_start(0.0),
+    m_next_year_start(0.0) {
 
   std::string ref_date = m_config->get_string("time.reference_date");
 
@@ -157,6 +159,9 @@ void Time_Calendar::init_from_input_file(const File &nc,
       m_time_units = units::Unit(m_unit_system, "seconds " + date_string);
     }
 
+    // the calendar and the reference date may have changed
+    m_next_year_start = m_year_start;
+
     // Read time information from the file. (PISM output files don't have time bounds, so we don't
     // bother checking for them.)
     std::vector<double> time;
@@ -226,6 +231,9 @@ void Time_Calendar::init_from_file(const std::string &filename, const Logger &lo
       m_time_units = units::Unit(m_unit_system, "seconds " + date_string);
     }
 
+    // the calendar and the reference date may have changed
+    m_next_year_start = m_year_start;
+
     // Read time information from the file.
     std::vector<double> time;
     std::string time_bounds_name = file.read_text_attribute(time_name, "bounds");
@@ -262,9 +270,20 @@ double Time_Calendar::mod(double time, unsigned int) const {
   return time;
 }
 
-double Time_Calendar::year_fraction(double T) const {
+/*!
+ * Compute the beginning of the calendar year containing `T` and the beginning of the
+ * following year.
+ *
+ * Most calls use times within the same year as the previous call, so the result is
+ * re-used until `T` leaves this year.
+ */
+void Time_Calendar::update_year_bounds(double T) const {
+  if (T >= m_year_start and T < m_next_year_start) {
+    return;
+  }
+
   int year, month, day, hour, minute;
-  double second, year_start, next_year_start;
+  double second;
 
   utCalendar2_cal(T, m_time_units.get(),
                   &year, &month, &day, &hour, &minute, &second,
@@ -274,17 +293,21 @@ double Time_Calendar::year_fraction(double T) const {
                      1, 1,            // month, day
                      0, 0, 0,         // hour, minute, second
                      m_time_units.get(),
-                     &year_start,
+                     &m_year_start,
                      m_calendar_string.c_str());
 
   utInvCalendar2_cal(year + 1,
                      1, 1,           // month, day
                      0, 0, 0,        // hour, minute, second
                      m_time_units.get(),
-                     &next_year_start,
+                     &m_next_year_start,
                      m_calendar_string.c_str());
+}
+
+double Time_Calendar::year_fraction(double T) const {
+  update_year_bounds(T);
 
-  return (T - year_start) / (next_year_start - year_start);
+  return (T - m_year_start) / (m_next_year_start - m_year_start);
 }
 
 std::string Time_Calendar::date(double T) const {
@@ -314,22 +337,9 @@ std::string Time_Calendar::end_date() const {
 }
 
 double Time_Calendar::calendar_year_start(double T) const {
-  int year, month, day, hour, minute;
-  double second, result;
+  update_year_bounds(T);
 
-  // Get the date corresponding to time T:
-  utCalendar2_cal(T, m_time_units.get(),
-                  &year, &month, &day, &hour, &minute, &second,
-                  m_calendar_string.c_str());
-
-  // Get the time in seconds corresponding to the beginning of the
-  // year.
-  utInvCalendar2_cal(year,
-                     1, 1, 0, 0, 0.0, // month, day, hour, minute, second
-                     m_time_units.get(), &result,
-                     m_calendar_string.c_str());
-
-  return result;
+  return m_year_start;
 }
 
 
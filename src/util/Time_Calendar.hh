@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2017 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2017, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -91,7 +91,15 @@ protected:
 
   void compute_times_yearly(std::vector<double> &result) const;
 private:
+  void update_year_bounds(double T) const;
+
   MPI_Comm m_com;
+
+  //! the beginning of the calendar year containing the time used in the last call of
+  //! update_year_bounds()
+  mutable double m_year_start;
+  //! the beginning of the following year
+  mutable double m_next_year_start;
   // Hide copy constructor / assignment operator.
   Time_Calendar(Time_Calendar const &);
   Time_Calendar & operator=(Time_Calendar const &);
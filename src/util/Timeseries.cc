@@ -207,6 +207,37 @@ void Timeseries::scale(double scaling_factor) {
   uses linear interpolation otherwise.
  */
 double Timeseries::operator()(double t) const {
+  size_t cursor = 0;
+  return (*this)(t, cursor);
+}
+
+/*!
+ * Find `k` such that `m_time[k] <= t < m_time[k + 1]` (`k = 0` if `t < m_time[0]` and `k
+ * = m_time.size() - 1` if `t >= m_time.back()`), same as `gsl_interp_bsearch()`.
+ *
+ * Checks `cursor` and `cursor + 1` first, so this is O(1) if `t` is in the same or the
+ * next interval as in the previous call.
+ */
+size_t Timeseries::bracket(double t, size_t cursor) const {
+  const size_t N = m_time.size();
+
+  for (size_t k = cursor; k < N and k <= cursor + 1; ++k) {
+    if (m_time[k] <= t and (k + 1 == N or t < m_time[k + 1])) {
+      return k;
+    }
+  }
+
+  return gsl_interp_bsearch(m_time.data(), t, 0, N);
+}
+
+//! Get a value of timeseries at time `t`, using and updating `cursor`.
+/*! Same as `operator()(t)`, but re-uses the index `cursor` found in the previous call,
+  making this O(1) per call when evaluating at increasing times. Set `cursor` to zero
+  before the first call.
+ */
+double Timeseries::operator()(double t, size_t &cursor) const {
+
+  cursor = bracket(t, cursor);
 
   if (m_use_bounds) {
     // piecewise-constant case
@@ -217,7 +248,7 @@ double Timeseries::operator()(double t) const {
     } else if (t >= m_time.back()) {
       k = m_time.size() - 1;
     } else {
-      k = gsl_interp_bsearch(m_time.data(), t, 0, m_time.size()) + 1;
+      k = cursor + 1;
     }
 
     return m_values[k];
@@ -229,7 +260,7 @@ double Timeseries::operator()(double t) const {
       return m_values[0];
     }
 
-    size_t k = gsl_interp_bsearch(m_time.data(), t, 0, m_time.size());
+    size_t k = cursor;
 
     // extrapolation on the right
     if (k + 1 >= m_time.size()) {
@@ -242,6 +273,16 @@ double Timeseries::operator()(double t) const {
   }
 }
 
+//! Get values of timeseries at `times` (preferably sorted in increasing order).
+void Timeseries::evaluate(const std::vector<double> &times, std::vector<double> &result) const {
+  result.resize(times.size());
+
+  size_t cursor = 0;
+  for (size_t k = 0; k < times.size(); ++k) {
+    result[k] = (*this)(times[k], cursor);
+  }
+}
+
 //! Get a value of timeseries by index.
 /*!
   Stops if the index is out of range.
@@ -263,9 +304,10 @@ double Timeseries::operator[](unsigned int j) const {
 double Timeseries::average(double t, double dt, unsigned int N) const {
   std::vector<double> V(N+1);
 
+  size_t cursor = 0;
   for (unsigned int i = 0; i < N+1; ++i) {
     double t_i = t + (dt / N) * i;
-    V[i] = (*this)(t_i);
+    V[i] = (*this)(t_i, cursor);
   }
 
   double sum = 0;
@@ -1,4 +1,4 @@
-// Copyright (C) 2009, 2011, 2012, 2013, 2014, 2015, 2016, 2017 Constantine Khroulev
+// Copyright (C) 2009, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2020 Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -66,6 +66,16 @@ class Logger;
   to get the value corresponding to the time "time", in this case in years. The
   value returned will be computed using linear interpolation.
 
+  When evaluating at a monotonically increasing sequence of times, pass a "cursor" (an
+  index, initially zero) to remember the position in the time-series between calls or
+  use evaluate() to get values corresponding to many times at once:
+  \code
+  size_t cursor = 0;
+  for (auto t : times) {
+    double offset = (*delta_T)(t, cursor);
+  }
+  \endcode
+
   It is also possible to get an n-th value from a time-series: just use square brackets:
   \code
   double offset = (*delta_T)[10];
@@ -80,6 +90,8 @@ public:
   void read(const File &nc, const Time &time_manager, const Logger &log);
   void write(const File &nc) const;
   double operator()(double time) const;
+  double operator()(double time, size_t &cursor) const;
+  void evaluate(const std::vector<double> &times, std::vector<double> &result) const;
   double operator[](unsigned int j) const;
   double average(double t, double dt, unsigned int N) const;
   void append(double value, double a, double b);
@@ -118,6 +130,8 @@ private:
   std::vector<double> m_values;
   std::vector<double> m_time_bounds;
 
+  size_t bracket(double t, size_t cursor) const;
+
   void set_bounds_units();
   void private_constructor(MPI_Comm com, const std::string &dimension_name);
   void report_range(const Logger &log);
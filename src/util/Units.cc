@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,6 +17,9 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>            // std::max
+#include <cmath>                // std::abs
+
 #include "Units.hh"
 
 #include "pism/util/error_handling.hh"
@@ -60,13 +63,40 @@ System::System(const std::string &path) {
 /*!
  * Example: convert(1, "m year-1", "m second-1").
  *
- * Please avoid using in computationally-intensive code.
+ * Uses a converter cached by converter(), so unit specifications are parsed only the
+ * first time a particular conversion is requested. Still, please use LinearConverter in
+ * computationally-intensive code.
  */
 double convert(System::Ptr system, double input,
                const std::string &spec1, const std::string &spec2) {
-  Converter c(Unit(system, spec1), Unit(system, spec2));
+  return (*converter(system, spec1, spec2))(input);
+}
 
-  return c(input);
+//! \brief Returns a converter from `spec1` to `spec2`.
+/*!
+ * Converters are created when first requested and stored in the unit system, so this
+ * avoids parsing unit specifications and building UDUNITS converters repeatedly.
+ *
+ * Thread-safe.
+ */
+std::shared_ptr<const Converter> converter(System::Ptr system,
+                                           const std::string &spec1,
+                                           const std::string &spec2) {
+  auto key = std::make_pair(spec1, spec2);
+
+  std::lock_guard<std::mutex> guard(system->m_converters_mutex);
+
+  auto &result = system->m_converters[key];
+  if (not result) {
+    try {
+      result.reset(new Converter(system, spec1, spec2));
+    } catch (...) {
+      system->m_converters.erase(key);
+      throw;
+    }
+  }
+
+  return result;
 }
 
 Unit::Unit(System::Ptr system, const std::string &spec)
@@ -180,6 +210,37 @@ void Converter::convert_doubles(double *data, size_t length) const {
   cv_convert_doubles(m_converter, data, length, data);
 }
 
+LinearConverter::LinearConverter()
+  : m_slope(1.0), m_intercept(0.0) {
+  // empty
+}
+
+LinearConverter::LinearConverter(System::Ptr sys, const std::string &u1, const std::string &u2) {
+  Converter c(sys, u1, u2);
+
+  m_intercept = c(0.0);
+  m_slope     = c(1.0) - m_intercept;
+
+  // check if this conversion is affine
+  const double
+    x     = 1000.0,
+    exact = c(x),
+    error = std::abs(m_slope * x + m_intercept - exact);
+  if (error > 1e-12 * std::max(std::abs(exact), 1.0)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "conversion from '%s' to '%s' is not affine",
+                                  u1.c_str(), u2.c_str());
+  }
+}
+
+double LinearConverter::slope() const {
+  return m_slope;
+}
+
+double LinearConverter::intercept() const {
+  return m_intercept;
+}
+
 } // end of namespace units
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013, 2014, 2015, 2016, 2017 PISM Authors
+/* Copyright (C) 2013, 2014, 2015, 2016, 2017, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -22,6 +22,8 @@
 
 #include <string>
 #include <memory>
+#include <map>
+#include <mutex>
 
 #include <udunits2.h>
 
@@ -43,13 +45,23 @@ namespace units {
  * having a "dangling" pointer.)
  */
 
+class Converter;
+
 class System {
 public:
   System(const std::string &path = "");
   typedef std::shared_ptr<System> Ptr;
 private:
   friend class Unit;
+  friend std::shared_ptr<const Converter> converter(Ptr system,
+                                                    const std::string &spec1,
+                                                    const std::string &spec2);
   std::shared_ptr<ut_system> m_system;
+
+  // converters created by converter(), keyed by pairs of unit specifications
+  std::map<std::pair<std::string, std::string>, std::shared_ptr<const Converter> > m_converters;
+  std::mutex m_converters_mutex;
+
   System(const System &);
   System& operator=(System const &);
 };
@@ -57,6 +69,10 @@ private:
 double convert(System::Ptr system, double input,
                const std::string &spec1, const std::string &spec2);
 
+std::shared_ptr<const Converter> converter(System::Ptr system,
+                                           const std::string &spec1,
+                                           const std::string &spec2);
+
 class Unit {
 public:
   Unit(System::Ptr system, const std::string &spec);
@@ -109,6 +125,29 @@ private:
   Converter& operator=(Converter const &);
 };
 
+/** Affine unit converter: `output = slope * input + intercept`.
+ *
+ * Unlike Converter this class can be copied and evaluating it does not call UDUNITS, so
+ * it can be stored as a data member and used in loops.
+ *
+ * Throws pism::RuntimeError() if the conversion is not possible or not affine.
+ */
+class LinearConverter {
+public:
+  LinearConverter();
+  LinearConverter(System::Ptr sys, const std::string &u1, const std::string &u2);
+
+  inline double operator()(double input) const {
+    return m_slope * input + m_intercept;
+  }
+
+  double slope() const;
+  double intercept() const;
+private:
+  double m_slope;
+  double m_intercept;
+};
+
 } // end of namespace units
 
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2009--2011, 2013, 2014, 2015, 2016, 2017 Constantine Khroulev
+// Copyright (C) 2009--2011, 2013, 2014, 2015, 2016, 2017, 2020 Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -27,7 +27,16 @@ using std::dynamic_pointer_cast;
 
 namespace pism {
 
-Vars::Vars() {
+Vars::Vars()
+  : m_revision(0) {
+}
+
+/*!
+ * Returns the number of changes to the dictionary: if `revision()` did not change, a
+ * pointer returned by `get()` and friends is still valid (see VarRef).
+ */
+int Vars::revision() const {
+  return m_revision;
 }
 
 bool Vars::is_available(const std::string &name) const {
@@ -55,6 +64,7 @@ void Vars::add(const IceModelVec &v, const std::string &name) {
                                   name.c_str());
   }
   m_variables[name] = &v;
+  m_revision += 1;
 }
 
 //!Add an IceModelVec to the dictionary.
@@ -82,6 +92,7 @@ void Vars::add(const IceModelVec &v) {
 
   if (m_variables[name] == NULL) {
     m_variables[name] = &v;
+    m_revision += 1;
   } else {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION, "Vars::add(): an IceModelVec with the name '%s'"
                                   " was added already.",
@@ -111,6 +122,7 @@ void Vars::remove(const std::string &name) {
       m_standard_names.erase(name);
     }
   }
+  m_revision += 1;
 }
 
 //! \brief Returns a pointer to an IceModelVec containing variable `name` or
@@ -130,7 +142,7 @@ const IceModelVec* Vars::get_internal(const std::string &name) const {
 
   auto j = m_standard_names.find(name);
   if (j != m_standard_names.end()) {
-    std::string short_name = j->second;
+    const std::string &short_name = j->second;
 
     auto k = m_variables.find(short_name);
     if (k != m_variables.end()) {
@@ -233,6 +245,7 @@ void Vars::add_shared(VecPtr variable) {
 
   if (m_variables_shared.find(name) == m_variables_shared.end()) {
     m_variables_shared[name] = variable;
+    m_revision += 1;
   } else {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION, "Vars::add_shared(): an IceModelVec with the name '%s'"
                                   " was added already.",
@@ -249,6 +262,7 @@ void Vars::add_shared(VecPtr variable, const std::string &name) {
                                   name.c_str());
   }
   m_variables_shared[name] = variable;
+  m_revision += 1;
 }
 
 
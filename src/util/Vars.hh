@@ -1,4 +1,4 @@
-// Copyright (C) 2009, 2010, 2013, 2014, 2015, 2016, 2017 Constantine Khroulev
+// Copyright (C) 2009, 2010, 2013, 2014, 2015, 2016, 2017, 2020 Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -24,6 +24,8 @@
 #include <string>
 #include <memory>
 
+#include "error_handling.hh"
+
 namespace pism {
 
 class IceModelVec;
@@ -72,7 +74,12 @@ public:
   Vec3Ptr get_3d_scalar_shared(const std::string &name) const;
 
   std::set<std::string> keys_shared() const;
+
+  int revision() const;
 private:
+  //! incremented every time a variable is added or removed
+  int m_revision;
+
   const IceModelVec* get_internal(const std::string &name) const;
   mutable std::map<std::string, const IceModelVec*> m_variables;
   //! stores standard names of variables that
@@ -93,6 +100,58 @@ private:
   Vars & operator=(Vars const &);
 };
 
+/*!
+ * A typed handle referring to a variable stored in Vars.
+ *
+ * Looks the variable up the first time it is used and caches the pointer until a variable
+ * is added to or removed from the dictionary, so that repeated access does not involve
+ * string comparisons and `dynamic_cast`.
+ *
+ * Usage:
+ *
+ *     VarRef<IceModelVec2S> thickness(grid->variables(), "land_ice_thickness");
+ *     ...
+ *     double H = (*thickness)(i, j);
+ */
+template<class T>
+class VarRef {
+public:
+  VarRef(const Vars &vars, const std::string &name)
+    : m_vars(vars), m_name(name), m_ptr(nullptr), m_revision(-1) {
+    // empty
+  }
+
+  const T* get() const {
+    if (m_revision != m_vars.revision()) {
+      m_ptr = dynamic_cast<const T*>(m_vars.get(m_name));
+      if (m_ptr == nullptr) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "variable '%s' has an unexpected type",
+                                      m_name.c_str());
+      }
+      m_revision = m_vars.revision();
+    }
+    return m_ptr;
+  }
+
+  const T& operator*() const {
+    return *get();
+  }
+
+  const T* operator->() const {
+    return get();
+  }
+
+  const std::string& name() const {
+    return m_name;
+  }
+private:
+  const Vars &m_vars;
+  std::string m_name;
+  mutable const T *m_ptr;
+  mutable int m_revision;
+};
+
 } // end of namespace pism
 
 #endif // __Vars_hh
@@ -0,0 +1,129 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "VecPool.hh"
+#include "pism/util/MemoryTracker.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+VecPool::VecPool(const MemoryTracker &tracker, unsigned int size)
+  : m_tracker(tracker), m_size(size) {
+  // empty
+}
+
+VecPool::~VecPool() {
+  for (auto &e : m_entries) {
+    release(e);
+  }
+}
+
+//! Free storage of the entry `e`.
+void VecPool::release(Entry &e) {
+  m_tracker.deallocate(e.memory_id);
+  PetscErrorCode ierr = VecDestroy(&e.vec); CHKERRCONTINUE(ierr);
+}
+
+//! Free Vecs created using DMs that were destroyed (these can never be re-used).
+void VecPool::release_expired() {
+  auto e = m_entries.begin();
+  while (e != m_entries.end()) {
+    if (e->dm.expired()) {
+      release(*e);
+      e = m_entries.erase(e);
+    } else {
+      ++e;
+    }
+  }
+}
+
+/*!
+ * Get a pooled Vec created using `dm` (a local Vec if `ghosted` is true) and set all its
+ * elements (including ghosts) to zero, as in a new Vec.
+ *
+ * Returns NULL if the pool does not contain a suitable Vec. The caller owns the result.
+ */
+::Vec VecPool::get(petsc::DM::Ptr dm, bool ghosted) {
+  release_expired();
+
+  for (auto e = m_entries.begin(); e != m_entries.end(); ++e) {
+    if (e->dm.lock() == dm and e->ghosted == ghosted) {
+      ::Vec result = e->vec;
+
+      m_tracker.deallocate(e->memory_id);
+      m_entries.erase(e);
+
+      PetscErrorCode ierr = VecSet(result, 0.0);
+      PISM_CHK(ierr, "VecSet");
+
+      return result;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * Add `v` (a Vec created using `dm` and DMCreateGlobalVector() or DMCreateLocalVector() if
+ * `ghosted` is true) to the pool.
+ *
+ * Returns true if the pool took ownership of `v` and false if it is full or `v` is still
+ * referenced by other PETSc objects (then the caller has to destroy `v`).
+ */
+bool VecPool::put(::Vec v, petsc::DM::Ptr dm, bool ghosted) {
+  release_expired();
+
+  if (not dm) {
+    return false;
+  }
+
+  // a Vec referenced elsewhere (e.g. by a KSP) must not be shared with a new field
+  PetscInt references = 0;
+  PetscErrorCode ierr = PetscObjectGetReference((PetscObject)v, &references);
+  PISM_CHK(ierr, "PetscObjectGetReference");
+  if (references != 1) {
+    return false;
+  }
+
+  unsigned int n = 0;
+  for (const auto &e : m_entries) {
+    n += (e.dm.lock() == dm and e.ghosted == ghosted);
+  }
+  if (n >= m_size) {
+    return false;
+  }
+
+  PetscInt size = 0;
+  ierr = VecGetLocalSize(v, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  Entry e;
+  e.vec     = v;
+  e.dm      = dm;
+  e.ghosted = ghosted;
+  {
+    MemoryTracker::Owner owner(m_tracker, "Vec pool");
+    e.memory_id = m_tracker.allocate("pooled Vec", size * sizeof(double));
+  }
+
+  m_entries.push_back(e);
+
+  return true;
+}
+
+} // end of namespace pism
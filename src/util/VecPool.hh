@@ -0,0 +1,78 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_VECPOOL_H
+#define PISM_VECPOOL_H
+
+#include <vector>
+
+#include <petscvec.h>
+
+#include "pism/util/petscwrappers/DM.hh"
+
+namespace pism {
+
+class MemoryTracker;
+
+/*!
+ * Keeps storage of de-allocated fields for re-use by new fields with the same layout.
+ *
+ * Many fields are short-lived (for example, diagnostics computed when writing output) and
+ * allocating and freeing their storage (PETSc Vecs) every time is expensive: large
+ * allocations are returned to the operating system and each new Vec page-faults again.
+ *
+ * The pool keeps at most `size` unused Vecs per layout (a DM and "ghosted" or not). A
+ * pooled Vec can be re-used only by a field using the same DM (see IceGrid::get_dm()).
+ * The pool does not keep DMs alive: Vecs created using a DM that was destroyed (i.e. no
+ * longer used by any field or cached by IceGrid) are freed.
+ *
+ * Vecs referenced by other PETSc objects (a KSP or a SNES, for example) are not pooled.
+ *
+ * All methods are collective: IceModelVecs are created and destroyed in the same order on
+ * all processes, so all processes make the same decisions.
+ */
+class VecPool {
+public:
+  VecPool(const MemoryTracker &tracker, unsigned int size);
+  ~VecPool();
+
+  ::Vec get(petsc::DM::Ptr dm, bool ghosted);
+  bool put(::Vec v, petsc::DM::Ptr dm, bool ghosted);
+private:
+  VecPool(const VecPool &);
+  VecPool& operator=(const VecPool &);
+
+  struct Entry {
+    ::Vec vec;
+    petsc::DM::WeakPtr dm;
+    bool ghosted;
+    int memory_id;
+  };
+
+  void release(Entry &e);
+  void release_expired();
+
+  const MemoryTracker &m_tracker;
+  unsigned int m_size;
+  std::vector<Entry> m_entries;
+};
+
+} // end of namespace pism
+
+#endif /* PISM_VECPOOL_H */
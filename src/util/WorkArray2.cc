@@ -0,0 +1,249 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>            // std::copy, std::fill
+#include <cstdint>              // int8_t
+
+#include "WorkArray2.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/MemoryTracker.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+
+namespace {
+
+template<typename T>
+MPI_Datatype mpi_type();
+
+template<>
+MPI_Datatype mpi_type<float>() {
+  return MPI_FLOAT;
+}
+
+template<>
+MPI_Datatype mpi_type<double>() {
+  return MPI_DOUBLE;
+}
+
+template<>
+MPI_Datatype mpi_type<int8_t>() {
+  return MPI_SIGNED_CHAR;
+}
+
+} // end of anonymous namespace
+
+template<typename T>
+WorkArray2<T>::WorkArray2()
+  : m_dof(0), m_width(0),
+    m_i0(0), m_j0(0), m_nx(0), m_ny(0),
+    m_west(0), m_east(0), m_south(0), m_north(0),
+    m_memory_id(-1) {
+  // empty
+}
+
+template<typename T>
+WorkArray2<T>::WorkArray2(IceGrid::ConstPtr grid, const std::string &name,
+                          unsigned int dof, unsigned int stencil_width)
+  : WorkArray2() {
+  create(grid, name, dof, stencil_width);
+}
+
+template<typename T>
+WorkArray2<T>::~WorkArray2() {
+  if (m_grid and m_memory_id >= 0) {
+    m_grid->ctx()->memory().deallocate(m_memory_id);
+  }
+}
+
+template<typename T>
+void WorkArray2<T>::create(IceGrid::ConstPtr grid, const std::string &name,
+                           unsigned int dof, unsigned int stencil_width) {
+
+  if (dof == 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "work array '%s' has to have at least one degree of freedom",
+                                  name.c_str());
+  }
+
+  // Get ranks of neighbors from a DM with the same stencil width. Note that creating this
+  // DM fails if sub-domains are narrower than the stencil width.
+  {
+    petsc::DM::Ptr da = grid->get_dm(1, stencil_width);
+
+    const PetscMPIInt *neighbors = NULL;
+    PetscErrorCode ierr = DMDAGetNeighbors(*da, &neighbors);
+    PISM_CHK(ierr, "DMDAGetNeighbors");
+
+    // neighbors are listed "row by row", starting from the south-west corner
+    m_south = neighbors[1];
+    m_west  = neighbors[3];
+    m_east  = neighbors[5];
+    m_north = neighbors[7];
+  }
+
+  m_grid  = grid;
+  m_name  = name;
+  m_dof   = dof;
+  m_width = stencil_width;
+
+  const int w = m_width;
+  m_i0 = grid->xs() - w;
+  m_j0 = grid->ys() - w;
+  m_nx = grid->xm() + 2 * w;
+  m_ny = grid->ym() + 2 * w;
+
+  m_data.resize(m_nx * m_ny * m_dof);
+  set(0.0);
+
+  // the largest message is a strip of width w along the x direction, including corners
+  m_send.resize(w * std::max(m_nx, m_ny) * m_dof);
+  m_receive.resize(m_send.size());
+
+  const MemoryTracker &tracker = grid->ctx()->memory();
+  if (m_memory_id >= 0) {
+    tracker.deallocate(m_memory_id);
+  }
+  m_memory_id = tracker.allocate(m_name, (m_data.size() + 2 * m_send.size()) * sizeof(T),
+                                 m_dof, m_width, m_data.data());
+}
+
+template<typename T>
+bool WorkArray2<T>::was_created() const {
+  return (bool)m_grid;
+}
+
+template<typename T>
+unsigned int WorkArray2<T>::ndof() const {
+  return m_dof;
+}
+
+template<typename T>
+unsigned int WorkArray2<T>::stencil_width() const {
+  return m_width;
+}
+
+//! Set all values, including ghosts.
+template<typename T>
+void WorkArray2<T>::set(double value) {
+  std::fill(m_data.begin(), m_data.end(), (T)value);
+}
+
+template<typename T>
+void WorkArray2<T>::begin_access() const {
+  // empty
+}
+
+template<typename T>
+void WorkArray2<T>::end_access() const {
+  // empty
+}
+
+//! Send `count` values in `send` to `destination` and receive `count` values from `source`.
+template<typename T>
+void WorkArray2<T>::exchange(int destination, int source, int tag,
+                             const T *send, T *receive, int count) const {
+  int ierr = MPI_Sendrecv(const_cast<T*>(send), count, mpi_type<T>(), destination, tag,
+                          receive, count, mpi_type<T>(), source, tag,
+                          m_grid->com, MPI_STATUS_IGNORE);
+  if (ierr != MPI_SUCCESS) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to update ghosts of '%s'", m_name.c_str());
+  }
+}
+
+/*!
+ * Update ghosts using values owned by neighboring processes.
+ *
+ * Ghosts are updated in two phases: first in the x direction (owned rows only), then in
+ * the y direction (rows of the whole local part, including ghosts in the x direction).
+ * This fills corners without communicating with diagonal neighbors.
+ */
+template<typename T>
+void WorkArray2<T>::update_ghosts() {
+  const int
+    w  = m_width,
+    xm = m_nx - 2 * w,
+    ym = m_ny - 2 * w,
+    d  = m_dof;
+
+  if (w == 0) {
+    return;
+  }
+
+  // Copies a block of columns [i_start, i_start + w) in owned rows to or from a buffer.
+  auto columns = [&](int i_start, T *buffer, bool pack) {
+    int n = 0;
+    for (int j = w; j < w + ym; ++j) {
+      T *row = &m_data[(j * m_nx + i_start) * d];
+      if (pack) {
+        std::copy(row, row + w * d, &buffer[n]);
+      } else {
+        std::copy(&buffer[n], &buffer[n] + w * d, row);
+      }
+      n += w * d;
+    }
+  };
+
+  const int column_count = ym * w * d;
+
+  // send owned columns next to the western boundary to the west, receive from the east
+  columns(w, m_send.data(), true);
+  exchange(m_west, m_east, 0, m_send.data(), m_receive.data(), column_count);
+  columns(w + xm, m_receive.data(), false);
+
+  // send owned columns next to the eastern boundary to the east, receive from the west
+  columns(xm, m_send.data(), true);
+  exchange(m_east, m_west, 1, m_send.data(), m_receive.data(), column_count);
+  columns(0, m_receive.data(), false);
+
+  // rows (including ghosts in the x direction) are contiguous, so no packing is needed
+  const int row_count = w * m_nx * d;
+
+  T
+    *south_owned = &m_data[(w * m_nx) * d],
+    *north_owned = &m_data[(ym * m_nx) * d],
+    *south_ghost = &m_data[0],
+    *north_ghost = &m_data[((w + ym) * m_nx) * d];
+
+  // send to the south, receive from the north
+  exchange(m_south, m_north, 2, south_owned, m_receive.data(), row_count);
+  std::copy(m_receive.data(), m_receive.data() + row_count, north_ghost);
+
+  // send to the north, receive from the south
+  exchange(m_north, m_south, 3, north_owned, m_receive.data(), row_count);
+  std::copy(m_receive.data(), m_receive.data() + row_count, south_ghost);
+}
+
+template<typename T>
+void WorkArray2<T>::check_array_indices(int i, int j, int k) const {
+  if (i < m_i0 or i >= m_i0 + m_nx or
+      j < m_j0 or j >= m_j0 + m_ny or
+      k < 0 or k >= (int)m_dof) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "%s(%d, %d, %d) is out of bounds",
+                                  m_name.c_str(), i, j, k);
+  }
+}
+
+template class WorkArray2<float>;
+template class WorkArray2<double>;
+template class WorkArray2<int8_t>;
+
+} // end of namespace pism
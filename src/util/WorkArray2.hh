@@ -0,0 +1,134 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_WORKARRAY2_H
+#define PISM_WORKARRAY2_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "pism/util/iceModelVec.hh"   // PetscAccessible
+#include "pism/util/IceGrid.hh"
+#include "pism/pism_config.hh"
+
+namespace pism {
+
+/*!
+ * A ghosted 2D work array storing `dof` values of type `T` per grid point.
+ *
+ * Unlike IceModelVec this class does not use PETSc Vecs, so it can store values in single
+ * precision. This halves the memory footprint and the amount of data sent during ghost
+ * updates. Use it for *internal* work arrays (e.g. quantities at cell faces with `dof ==
+ * 2`) that feed explicit updates and don't need full precision. Work arrays are not
+ * saved, regridded, or exposed as diagnostics.
+ *
+ * `WorkArray2<int8_t>` (WorkArray2Mask) stores integer masks using one byte per grid point
+ * instead of eight in an IceModelVec2Int.
+ *
+ * Values are stored interleaved (all `dof` values at a grid point are adjacent), using
+ * the layout of an IceModelVec2 with the same stencil width. The domain is periodic, as
+ * in DMs created by IceGrid.
+ *
+ * Derives from PetscAccessible so it can be added to an AccessList; begin_access() and
+ * end_access() do nothing.
+ */
+template<typename T>
+class WorkArray2 : public PetscAccessible {
+public:
+  WorkArray2();
+  WorkArray2(IceGrid::ConstPtr grid, const std::string &name,
+             unsigned int dof, unsigned int stencil_width = 1);
+  ~WorkArray2();
+
+  void create(IceGrid::ConstPtr grid, const std::string &name,
+              unsigned int dof, unsigned int stencil_width = 1);
+
+  bool was_created() const;
+
+  unsigned int ndof() const;
+  unsigned int stencil_width() const;
+
+  void set(double value);
+
+  void update_ghosts();
+
+  void begin_access() const;
+  void end_access() const;
+
+  inline T& operator()(int i, int j, int k = 0);
+  inline const T& operator()(int i, int j, int k = 0) const;
+private:
+  WorkArray2(const WorkArray2 &);
+  WorkArray2& operator=(const WorkArray2 &);
+
+  void exchange(int destination, int source, int tag,
+                const T *send, T *receive, int count) const;
+
+  void check_array_indices(int i, int j, int k) const;
+
+  IceGrid::ConstPtr m_grid;
+  std::string m_name;
+
+  unsigned int m_dof;
+  unsigned int m_width;
+
+  // starting indexes and the size of the local part of the array (including ghosts)
+  int m_i0, m_j0, m_nx, m_ny;
+
+  // ranks of neighbors to the west, east, south, and north
+  int m_west, m_east, m_south, m_north;
+
+  std::vector<T> m_data;
+
+  // ghost update buffers
+  std::vector<T> m_send, m_receive;
+
+  int m_memory_id;
+};
+
+//! Single precision work arrays if PISM was built with `Pism_SINGLE_PRECISION_WORK_ARRAYS`.
+#if (Pism_SINGLE_PRECISION_WORK_ARRAYS==1)
+typedef WorkArray2<float> WorkArray2R;
+#else
+typedef WorkArray2<double> WorkArray2R;
+#endif
+
+//! Compact (one byte per grid point) storage for integer masks with values in [-128, 127].
+typedef WorkArray2<int8_t> WorkArray2Mask;
+
+template<typename T>
+inline T& WorkArray2<T>::operator()(int i, int j, int k) {
+#if (Pism_DEBUG==1)
+  check_array_indices(i, j, k);
+#endif
+  return m_data[((j - m_j0) * m_nx + (i - m_i0)) * m_dof + k];
+}
+
+template<typename T>
+inline const T& WorkArray2<T>::operator()(int i, int j, int k) const {
+#if (Pism_DEBUG==1)
+  check_array_indices(i, j, k);
+#endif
+  return m_data[((j - m_j0) * m_nx + (i - m_i0)) * m_dof + k];
+}
+
+} // end of namespace pism
+
+#endif /* PISM_WORKARRAY2_H */
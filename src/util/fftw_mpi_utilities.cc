@@ -0,0 +1,131 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <vector>
+#include <complex>
+
+#include "fftw_mpi_utilities.hh"
+
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/util/petscwrappers/IS.hh"
+
+namespace pism {
+
+void create_slab_scatter(Vec natural, Vec slab,
+                         int Mx, int My, int Ny, int i0, int j0,
+                         int row_start, int n_rows,
+                         petsc::VecScatter &result) {
+  PetscErrorCode ierr = 0;
+
+  std::vector<PetscInt> from, to;
+  for (int i = row_start; i < row_start + n_rows; ++i) {
+    int ii = i - i0;
+    if (ii < 0 or ii >= Mx) {
+      continue;
+    }
+    for (int jj = 0; jj < My; ++jj) {
+      from.push_back(jj * Mx + ii);
+      to.push_back(i * Ny + (jj + j0));
+    }
+  }
+
+  petsc::IS is_from, is_to;
+
+  ierr = ISCreateGeneral(PETSC_COMM_SELF, from.size(), from.data(),
+                         PETSC_COPY_VALUES, is_from.rawptr());
+  PISM_CHK(ierr, "ISCreateGeneral");
+
+  ierr = ISCreateGeneral(PETSC_COMM_SELF, to.size(), to.data(),
+                         PETSC_COPY_VALUES, is_to.rawptr());
+  PISM_CHK(ierr, "ISCreateGeneral");
+
+  ierr = VecScatterCreate(natural, is_from, slab, is_to, result.rawptr());
+  PISM_CHK(ierr, "VecScatterCreate");
+}
+
+void copy_to_slab(const IceModelVec2S &input, ::VecScatter scatter,
+                  Vec natural, Vec output) {
+  PetscErrorCode ierr = 0;
+
+  auto dm = input.dm();
+  petsc::TemporaryGlobalVec tmp(dm);
+  input.copy_to_vec(dm, tmp);
+
+  ierr = DMDAGlobalToNaturalBegin(*dm, tmp, INSERT_VALUES, natural);
+  PISM_CHK(ierr, "DMDAGlobalToNaturalBegin");
+
+  ierr = DMDAGlobalToNaturalEnd(*dm, tmp, INSERT_VALUES, natural);
+  PISM_CHK(ierr, "DMDAGlobalToNaturalEnd");
+
+  ierr = VecSet(output, 0.0);
+  PISM_CHK(ierr, "VecSet");
+
+  ierr = VecScatterBegin(scatter, natural, output, INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterBegin");
+
+  ierr = VecScatterEnd(scatter, natural, output, INSERT_VALUES, SCATTER_FORWARD);
+  PISM_CHK(ierr, "VecScatterEnd");
+}
+
+void copy_from_slab(Vec input, ::VecScatter scatter, Vec natural,
+                    IceModelVec2S &output) {
+  PetscErrorCode ierr = 0;
+
+  ierr = VecScatterBegin(scatter, input, natural, INSERT_VALUES, SCATTER_REVERSE);
+  PISM_CHK(ierr, "VecScatterBegin");
+
+  ierr = VecScatterEnd(scatter, input, natural, INSERT_VALUES, SCATTER_REVERSE);
+  PISM_CHK(ierr, "VecScatterEnd");
+
+  auto dm = output.dm();
+  petsc::TemporaryGlobalVec tmp(dm);
+
+  ierr = DMDANaturalToGlobalBegin(*dm, natural, INSERT_VALUES, tmp);
+  PISM_CHK(ierr, "DMDANaturalToGlobalBegin");
+
+  ierr = DMDANaturalToGlobalEnd(*dm, natural, INSERT_VALUES, tmp);
+  PISM_CHK(ierr, "DMDANaturalToGlobalEnd");
+
+  output.copy_from_vec(tmp);
+}
+
+void set_real_part_slab(Vec input, double normalization, int n_rows, int Ny,
+                        fftw_complex *output) {
+  petsc::VecArray input_array(input);
+  const double *in = input_array.get();
+  std::complex<double> *out = reinterpret_cast<std::complex<double>*>(output);
+
+  for (int k = 0; k < n_rows * Ny; ++k) {
+    out[k] = in[k] * normalization;
+  }
+}
+
+void get_real_part_slab(fftw_complex *input, double normalization, int n_rows, int Ny,
+                        Vec output) {
+  petsc::VecArray output_array(output);
+  double *out = output_array.get();
+  std::complex<double> *in = reinterpret_cast<std::complex<double>*>(input);
+
+  for (int k = 0; k < n_rows * Ny; ++k) {
+    out[k] = in[k].real() * normalization;
+  }
+}
+
+} // end of namespace pism
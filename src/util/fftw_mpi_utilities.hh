@@ -0,0 +1,75 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_FFTW_MPI_UTILITIES_H
+#define PISM_FFTW_MPI_UTILITIES_H
+
+// Utilities for distributed models using FFTW's MPI interface and extended computational
+// grids.
+//
+// FFTW's MPI interface splits a 2D array into slabs: each rank owns a contiguous range of
+// rows in the X direction (the "slow" index of FFTWArray) and all grid points in the Y
+// direction. These functions move data between PISM's 2D domain decomposition and this
+// slab decomposition. They do not depend on FFTW's MPI library itself.
+
+#include <fftw3.h>
+
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/petscwrappers/VecScatter.hh"
+
+namespace pism {
+
+class IceModelVec2S;
+
+//! Create a scatter from the Vec `natural` (natural ordering, Mx*My grid) to the slab
+//! decomposed Vec `slab` (extended Nx*Ny grid).
+/*!
+ * The Mx*My grid is embedded in the extended grid with its corner at (i0, j0). This rank
+ * owns rows `row_start` to `row_start + n_rows - 1` of the extended grid.
+ */
+void create_slab_scatter(Vec natural, Vec slab,
+                         int Mx, int My, int Ny, int i0, int j0,
+                         int row_start, int n_rows,
+                         petsc::VecScatter &result);
+
+//! Copy `input` to the slab-decomposed Vec `output` using `scatter`.
+/*!
+ * Sets elements of `output` not touched by the scatter to zero. `natural` is a work Vec
+ * using the natural ordering of `input`.
+ */
+void copy_to_slab(const IceModelVec2S &input, ::VecScatter scatter,
+                  Vec natural, Vec output);
+
+//! Copy the part of the slab-decomposed Vec `input` selected by `scatter` to `output`.
+void copy_from_slab(Vec input, ::VecScatter scatter, Vec natural,
+                    IceModelVec2S &output);
+
+//! Set the real part of the local slab `output` (`n_rows*Ny` elements) to `input *
+//! normalization`. Sets the imaginary part to zero.
+void set_real_part_slab(Vec input, double normalization, int n_rows, int Ny,
+                        fftw_complex *output);
+
+//! Get the real part of the local slab `input`, multiply by `normalization` and put it in
+//! `output`.
+void get_real_part_slab(fftw_complex *input, double normalization, int n_rows, int Ny,
+                        Vec output);
+
+} // end of namespace pism
+
+#endif /* PISM_FFTW_MPI_UTILITIES_H */
@@ -1,4 +1,4 @@
-/* Copyright (C) 2018, 2019 PISM Authors
+/* Copyright (C) 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -22,9 +22,14 @@
 #include "fftw_utilities.hh"
 
 #include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/error_handling.hh"
+#include "pism/pism_config.hh"
 
 namespace pism {
 
+//! Number of threads used in FFTW plans and helpers below (see fftw_use_threads()).
+static int fftw_n_threads = 1;
+
   // Access the central part of an array "a" of size My*Mx, using offsets i_offset and
   // j_offset specifying the corner of the part to be accessed.
 FFTWArray::FFTWArray(fftw_complex *a, int Mx, int My, int i_offset, int j_offset)
@@ -65,9 +70,48 @@ std::vector<double> fftfreq(int M, double d) {
   return result;
 }
 
+/*!
+ * Use `n_threads` threads in FFTW plans created after this call and in helpers that
+ * process whole FFTW arrays (clear_fftw_array(), copy_fftw_array(), set_real_part(),
+ * get_real_part()).
+ *
+ * Meant for serial models that compute FFTs on rank 0 while other ranks wait.
+ *
+ * Requires PISM built with `Pism_USE_FFTW_THREADS` if `n_threads > 1`. Helpers use
+ * threads only if PISM was built with OpenMP.
+ */
+void fftw_use_threads(int n_threads) {
+  if (n_threads < 1) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "the number of FFTW threads has to be positive (got %d)",
+                                  n_threads);
+  }
+
+#if (Pism_USE_FFTW_THREADS==1)
+  static bool initialized = false;
+  if (not initialized) {
+    if (fftw_init_threads() == 0) {
+      throw RuntimeError(PISM_ERROR_LOCATION, "failed to initialize FFTW threads");
+    }
+    initialized = true;
+  }
+  fftw_plan_with_nthreads(n_threads);
+#else
+  if (n_threads > 1) {
+    throw RuntimeError(PISM_ERROR_LOCATION,
+                       "multi-threaded FFTW requires PISM built with Pism_USE_FFTW_THREADS");
+  }
+#endif
+
+  fftw_n_threads = n_threads;
+}
+
 //! \brief Fill `input` with zeros.
 void clear_fftw_array(fftw_complex *input, int Nx, int Ny) {
   FFTWArray fftw_in(input, Nx, Ny);
+#if (Pism_USE_OPENMP==1)
+#pragma omp parallel for num_threads(fftw_n_threads)
+#endif
   for (int i = 0; i < Nx; ++i) {
     for (int j = 0; j < Ny; ++j) {
       fftw_in(i, j) = 0.0;
@@ -77,7 +121,15 @@ void clear_fftw_array(fftw_complex *input, int Nx, int Ny) {
 
 //! @brief Copy `source` to `destination`.
 void copy_fftw_array(fftw_complex *source, fftw_complex *destination, int Nx, int Ny) {
+#if (Pism_USE_OPENMP==1)
+  // copy blocks of rows (in the X direction) in parallel
+#pragma omp parallel for num_threads(fftw_n_threads)
+  for (int i = 0; i < Nx; ++i) {
+    memcpy(destination + i * Ny, source + i * Ny, Ny * sizeof(fftw_complex));
+  }
+#else
   memcpy(destination, source, Nx * Ny * sizeof(fftw_complex));
+#endif
 }
 
 //! Set the real part of output to input. Input has the size of My*Mx, embedded in the
@@ -92,12 +144,24 @@ void set_real_part(Vec input,
                    int Nx, int Ny,
                    int i0, int j0,
                    fftw_complex *output) {
-  petsc::VecArray2D in(input, Mx, My);
+  petsc::VecArray in(input);
+  set_real_part(in.get(), normalization, Mx, My, Nx, Ny, i0, j0, output);
+}
+
+void set_real_part(const double *input,
+                   double normalization,
+                   int Mx, int My,
+                   int Nx, int Ny,
+                   int i0, int j0,
+                   fftw_complex *output) {
   FFTWArray out(output, Nx, Ny, i0, j0);
 
+#if (Pism_USE_OPENMP==1)
+#pragma omp parallel for num_threads(fftw_n_threads)
+#endif
   for (int j = 0; j < My; ++j) {
     for (int i = 0; i < Mx; ++i) {
-      out(i, j) = in(i, j) * normalization;
+      out(i, j) = input[j * Mx + i] * normalization;
     }
   }
 }
@@ -113,11 +177,23 @@ void get_real_part(fftw_complex *input,
                    int Nx, int Ny,
                    int i0, int j0,
                    Vec output) {
-  petsc::VecArray2D out(output, Mx, My);
+  petsc::VecArray out(output);
+  get_real_part(input, normalization, Mx, My, Nx, Ny, i0, j0, out.get());
+}
+
+void get_real_part(fftw_complex *input,
+                   double normalization,
+                   int Mx, int My,
+                   int Nx, int Ny,
+                   int i0, int j0,
+                   double *output) {
   FFTWArray in(input, Nx, Ny, i0, j0);
+#if (Pism_USE_OPENMP==1)
+#pragma omp parallel for num_threads(fftw_n_threads)
+#endif
   for (int j = 0; j < My; ++j) {
     for (int i = 0; i < Mx; ++i) {
-      out(i, j) = in(i, j).real() * normalization;
+      output[j * Mx + i] = in(i, j).real() * normalization;
     }
   }
 }
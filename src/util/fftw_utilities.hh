@@ -1,4 +1,4 @@
-/* Copyright (C) 2018 PISM Authors
+/* Copyright (C) 2018, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -55,6 +55,8 @@ private:
 
 std::vector<double> fftfreq(int M, double normalization);
 
+void fftw_use_threads(int n_threads);
+
 //! Fill `input` with zeros.
 void clear_fftw_array(fftw_complex *input, int Nx, int Ny);
 
@@ -85,4 +87,23 @@ void get_real_part(fftw_complex *input,
                    int i0, int j0,
                    Vec output);
 
+//! Versions of set_real_part() and get_real_part() using arrays of size Mx*My stored
+//! using the natural ordering (input[j * Mx + i]).
+/*!
+ * These do not use PETSc and may be called from a thread other than the main one.
+ */
+void set_real_part(const double *input,
+                   double normalization,
+                   int Mx, int My,
+                   int Nx, int Ny,
+                   int i0, int j0,
+                   fftw_complex *output);
+
+void get_real_part(fftw_complex *input,
+                   double normalization,
+                   int Mx, int My,
+                   int Nx, int Ny,
+                   int i0, int j0,
+                   double *output);
+
 } // end of namespace pism
@@ -1,4 +1,4 @@
-// Copyright (C) 2008--2019 Ed Bueler, Constantine Khroulev, and David Maxwell
+// Copyright (C) 2008--2020 Ed Bueler, Constantine Khroulev, and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -17,6 +17,11 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cassert>
+#include <cstdint>              // uintptr_t
+
+#ifdef __linux__
+#include <sys/mman.h>           // madvise
+#endif
 
 #include "pism_utilities.hh"
 #include "iceModelVec.hh"
@@ -30,12 +35,39 @@
 #include "io/io_helpers.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/MemoryTracker.hh"
 #include "pism/util/petscwrappers/VecScatter.hh"
 #include "pism/util/Mask.hh"
 #include "pism/util/IceModelVec2CellType.hh"
+#include "pism/util/VecPool.hh"
 
 namespace pism {
 
+namespace {
+
+//! Ask the kernel to back `[data, data + bytes)` by transparent huge pages (if possible).
+void advise_huge_pages(void *data, size_t bytes) {
+#ifdef MADV_HUGEPAGE
+  // the size of a huge page on x86-64
+  const uintptr_t huge_page = 2 * 1024 * 1024;
+
+  // only whole huge pages within the allocation can be used
+  const uintptr_t
+    begin = ((uintptr_t)data + huge_page - 1) / huge_page * huge_page,
+    end   = ((uintptr_t)data + bytes) / huge_page * huge_page;
+
+  if (end > begin) {
+    // failure is not an error: transparent huge pages may be disabled
+    (void) madvise((void*)begin, end - begin, MADV_HUGEPAGE);
+  }
+#else
+  (void) data;
+  (void) bytes;
+#endif
+}
+
+} // end of anonymous namespace
+
 IceModelVec::IceModelVec() {
   m_access_counter = 0;
   m_array = NULL;
@@ -47,6 +79,9 @@ IceModelVec::IceModelVec() {
 
   m_has_ghosts = true;
 
+  m_memory_id = -1;
+  m_pooled = false;
+
   m_name = "unintialized variable";
 
   // would resize "vars", but "grid" is not initialized, and so we
@@ -102,6 +137,126 @@ void IceModelVec::inc_state_counter() {
 
 IceModelVec::~IceModelVec() {
   assert(m_access_counter == 0);
+
+  if (m_grid and m_memory_id >= 0) {
+    m_grid->ctx()->memory().deallocate(m_memory_id);
+  }
+
+  try {
+    if (m_pooled and m_v != NULL and m_grid->vec_pool().put(m_v, m_da, m_has_ghosts)) {
+      // the pool owns the storage now
+      *m_v.rawptr() = NULL;
+    }
+  } catch (...) {
+    // ignore errors: the storage is freed by the destructor of m_v
+  }
+}
+
+//! Allocate storage (`m_v`) using `m_da`, re-using a pooled Vec if possible (see VecPool).
+/*!
+ * Called by create() and allocate() methods of derived classes once `m_da`, `m_has_ghosts`
+ * and `m_name` are set. If `huge_pages` is true, new storage is backed by transparent huge
+ * pages (if supported).
+ */
+void IceModelVec::allocate_storage(bool huge_pages) {
+  assert(m_v == NULL);
+
+  ::Vec v = m_grid->vec_pool().get(m_da, m_has_ghosts);
+
+  if (v != NULL) {
+    *m_v.rawptr() = v;
+  } else {
+    PetscErrorCode ierr;
+    if (m_has_ghosts) {
+      ierr = DMCreateLocalVector(*m_da, m_v.rawptr());
+      PISM_CHK(ierr, "DMCreateLocalVector");
+    } else {
+      ierr = DMCreateGlobalVector(*m_da, m_v.rawptr());
+      PISM_CHK(ierr, "DMCreateGlobalVector");
+    }
+
+    first_touch(huge_pages);
+  }
+
+  // return storage to the pool when this field is destroyed
+  m_pooled = true;
+
+  track_memory();
+}
+
+//! Replace the storage of this field with memory first touched by all threads of this process.
+/*!
+ * PETSc zeroes Vec storage using the calling thread, which puts all of it on the NUMA node
+ * of this thread. If tiles are processed by several threads (`grid.tiles.threads`), touch
+ * it using all of them instead, spreading it over their NUMA nodes.
+ *
+ * If `huge_pages` is true, ask the kernel to back the new storage by transparent huge pages
+ * before touching it.
+ */
+void IceModelVec::first_touch(bool huge_pages) {
+  int n_threads = 1;
+#if (Pism_USE_OPENMP==1)
+  n_threads = m_grid->ctx()->config()->get_number("grid.tiles.threads");
+#endif
+
+#ifndef MADV_HUGEPAGE
+  huge_pages = false;
+#endif
+
+  if (n_threads <= 1 and not huge_pages) {
+    return;
+  }
+
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(m_v, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  PetscScalar *array = nullptr;
+  ierr = PetscMalloc1(size, &array);
+  PISM_CHK(ierr, "PetscMalloc1");
+
+  if (huge_pages) {
+    advise_huge_pages(array, size * sizeof(PetscScalar));
+  }
+
+#if (Pism_USE_OPENMP==1)
+#pragma omp parallel for schedule(static) num_threads(n_threads) if (n_threads > 1)
+#endif
+  for (PetscInt k = 0; k < size; ++k) {
+    array[k] = 0.0;
+  }
+
+  // frees the old storage; m_v takes ownership of `array`
+  ierr = VecReplaceArray(m_v, array);
+  PISM_CHK(ierr, "VecReplaceArray");
+}
+
+//! Register the storage of this field with the memory tracker of the context.
+/*!
+ * Called by create() and allocate() methods of derived classes once `m_v` is allocated.
+ */
+void IceModelVec::track_memory() {
+  const MemoryTracker &tracker = m_grid->ctx()->memory();
+
+  if (m_memory_id >= 0) {
+    tracker.deallocate(m_memory_id);
+  }
+
+  PetscInt size = 0;
+  PetscErrorCode ierr = VecGetLocalSize(m_v, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  const int dof = std::max((size_t)m_dof, m_zlevels.size());
+
+  // the address of the storage is used to report its NUMA placement
+  const PetscScalar *data = nullptr;
+  ierr = VecGetArrayRead(m_v, &data);
+  PISM_CHK(ierr, "VecGetArrayRead");
+  ierr = VecRestoreArrayRead(m_v, &data);
+  PISM_CHK(ierr, "VecRestoreArrayRead");
+
+  m_memory_id = tracker.allocate(m_name, size * sizeof(double), dof, m_da_stencil_width,
+                                 data);
 }
 
 //! Returns true if create() was called and false otherwise.
@@ -515,7 +670,8 @@ const SpatialVariableMetadata& IceModelVec::metadata(unsigned int N) const {
 }
 
 //! Writes an IceModelVec to a NetCDF file.
-void IceModelVec::write_impl(const File &file) const {
+void IceModelVec::write_impl(const File &file,
+                             const std::vector<SpatialVariableMetadata> &metadata) const {
 
   if (m_dof != 1) {
     throw RuntimeError(PISM_ERROR_LOCATION, "This method (IceModelVec::write_impl) only supports"
@@ -529,11 +685,11 @@ void IceModelVec::write_impl(const File &file) const {
 
     petsc::VecArray tmp_array(tmp);
 
-    io::write_spatial_variable(metadata(0), *m_grid,  file,
+    io::write_spatial_variable(metadata[0], *m_grid,  file,
                                tmp_array.get());
   } else {
     petsc::VecArray v_array(m_v);
-    io::write_spatial_variable(metadata(0), *m_grid, file,
+    io::write_spatial_variable(metadata[0], *m_grid, file,
                                v_array.get());
   }
 }
@@ -628,17 +784,38 @@ void  IceModelVec::end_access() const {
 
 //! Updates ghost points.
 void  IceModelVec::update_ghosts() {
-  PetscErrorCode ierr;
+  update_ghosts_begin();
+  update_ghosts_end();
+}
+
+//! Starts updating ghost points.
+/*!
+ * Use this with update_ghosts_end() to overlap communication with computation: code
+ * between these two calls may read values at grid points owned by this processor but
+ * should not use ghosts or modify this field.
+ *
+ * See InteriorPoints and BoundaryPoints.
+ */
+void IceModelVec::update_ghosts_begin() {
   if (not m_has_ghosts) {
     return;
   }
 
   assert(m_v != NULL);
 
-  ierr = DMLocalToLocalBegin(*m_da, m_v, INSERT_VALUES, m_v);
+  PetscErrorCode ierr = DMLocalToLocalBegin(*m_da, m_v, INSERT_VALUES, m_v);
   PISM_CHK(ierr, "DMLocalToLocalBegin");
-  
-  ierr = DMLocalToLocalEnd(*m_da, m_v, INSERT_VALUES, m_v);
+}
+
+//! Finishes updating ghost points (see update_ghosts_begin()).
+void IceModelVec::update_ghosts_end() {
+  if (not m_has_ghosts) {
+    return;
+  }
+
+  assert(m_v != NULL);
+
+  PetscErrorCode ierr = DMLocalToLocalEnd(*m_da, m_v, INSERT_VALUES, m_v);
   PISM_CHK(ierr, "DMLocalToLocalEnd");
 }
 
@@ -691,6 +868,32 @@ void  IceModelVec::set(const double c) {
   inc_state_counter();          // mark as modified
 }
 
+//! Address of the first value in the local array (including ghosts) of this field.
+/*!
+ * Values are stored contiguously, row by row, with all values at a grid point adjacent.
+ * Valid between begin_access() and end_access(). Used by View2 and View3.
+ */
+double* IceModelVec::local_array() const {
+  if (m_array == NULL) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "%s: begin_access() was not called",
+                                  m_name.c_str());
+  }
+
+  const int
+    w  = stencil_width(),
+    i0 = m_grid->xs() - w,
+    j0 = m_grid->ys() - w;
+
+  if (m_begin_end_access_use_dof) {
+    return &static_cast<double***>(m_array)[j0][i0][0];
+  }
+
+  // Row pointers of arrays returned by DMDAVecGetArray() point to the (possibly
+  // fictitious) value at i == 0 in each row.
+  const unsigned int N = std::max((size_t)m_dof, m_zlevels.size());
+  return static_cast<double**>(m_array)[j0] + i0 * N;
+}
+
 void IceModelVec::check_array_indices(int i, int j, unsigned int k) const {
   double ghost_width = 0;
   if (m_has_ghosts) {
@@ -892,20 +1095,138 @@ void IceModelVec::regrid(const File &file, RegriddingFlag flag,
   }
 }
 
+/*!
+ * Interpolate `source`, a field with the same number of components defined on a different
+ * grid, onto the grid of this field (e.g. to refine a grid without writing model state to
+ * a file).
+ */
+void IceModelVec::regrid(const IceModelVec &source) {
+  if (source.ndof() != m_dof or source.ndims() != ndims()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot interpolate '%s' from '%s': incompatible fields",
+                                  m_name.c_str(), source.get_name().c_str());
+  }
+
+  m_grid->ctx()->log()->message(3, "  [%s] Interpolating %s...\n",
+                                timestamp(m_grid->com).c_str(), m_name.c_str());
+
+  const bool allow_extrapolation = m_grid->ctx()->config()->get_flag("grid.allow_extrapolation");
+
+  m_grid->ctx()->profiling().begin("io.regridding");
+  {
+    if (m_has_ghosts) {
+      petsc::TemporaryGlobalVec tmp(m_da);
+      {
+        petsc::VecArray tmp_array(tmp);
+        io::regrid_spatial_variable(source, *m_grid, levels(), m_interpolation_type,
+                                    allow_extrapolation, tmp_array.get());
+      }
+      global_to_local(m_da, tmp, m_v);
+    } else {
+      petsc::VecArray v_array(m_v);
+      io::regrid_spatial_variable(source, *m_grid, levels(), m_interpolation_type,
+                                  allow_extrapolation, v_array.get());
+    }
+    inc_state_counter();          // mark as modified
+  }
+  m_grid->ctx()->profiling().end("io.regridding");
+}
+
 void IceModelVec::read(const File &file, const unsigned int time) {
   this->read_impl(file, time);
   inc_state_counter();          // mark as modified
 }
 
 void IceModelVec::write(const File &file) const {
-  define(file);
+  write(file, m_metadata);
+}
+
+/*!
+ * Read record `time` of `fields` from `file`.
+ *
+ * Reads of all single-component fields are started before waiting for any of them
+ * (see io::read_spatial_variables()), which is faster than calling IceModelVec::read()
+ * for each field if the I/O backend supports non-blocking reads. Fields with more than
+ * one component are read one at a time.
+ */
+void read_fields(const File &file, unsigned int time,
+                 const std::vector<IceModelVec*> &fields) {
+
+  std::vector<IceModelVec*> batch;
+  std::vector<SpatialVariableMetadata> variables;
+
+  for (auto f : fields) {
+    if (f->ndof() != 1) {
+      f->read(file, time);
+    } else {
+      f->m_grid->ctx()->log()->message(3, "  Reading %s...\n", f->m_name.c_str());
+      batch.push_back(f);
+      variables.push_back(f->metadata(0));
+    }
+  }
+
+  if (batch.empty()) {
+    return;
+  }
+
+  IceGrid::ConstPtr grid = batch[0]->m_grid;
+
+  // temporary global Vecs used to read ghosted fields
+  std::vector<std::unique_ptr<petsc::TemporaryGlobalVec> > tmp(batch.size());
+  {
+    std::vector<std::unique_ptr<petsc::VecArray> > arrays;
+    std::vector<double*> outputs;
+    for (unsigned int k = 0; k < batch.size(); ++k) {
+      IceModelVec *f = batch[k];
+      if (f->m_has_ghosts) {
+        tmp[k].reset(new petsc::TemporaryGlobalVec(f->m_da));
+        arrays.emplace_back(new petsc::VecArray(*tmp[k]));
+      } else {
+        arrays.emplace_back(new petsc::VecArray(f->m_v));
+      }
+      outputs.push_back(arrays.back()->get());
+    }
+
+    io::read_spatial_variables(variables, *grid, file, time, outputs);
+  }
+
+  for (unsigned int k = 0; k < batch.size(); ++k) {
+    IceModelVec *f = batch[k];
+    if (f->m_has_ghosts) {
+      f->global_to_local(f->m_da, *tmp[k], f->m_v);
+    }
+    f->inc_state_counter();          // mark as modified
+  }
+}
+
+/*!
+ * Write this field using `metadata` (one object per degree of freedom) instead of its own
+ * metadata.
+ *
+ * This makes it possible to write a model field as a diagnostic quantity with a different
+ * name and attributes without copying it (see Diagnostic::write()). Values are in the
+ * units `metadata` uses internally (attribute "units").
+ */
+void IceModelVec::write(const File &file,
+                        const std::vector<SpatialVariableMetadata> &metadata) const {
+  if (metadata.size() != m_dof) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot write '%s' (dof = %d) using %d metadata objects",
+                                  m_name.c_str(), (int)m_dof, (int)metadata.size());
+  }
+
+  for (const auto &m : metadata) {
+    IO_Type type = m.get_output_type();
+    type = type == PISM_NAT ? PISM_DOUBLE : type;
+    io::define_spatial_variable(m, *m_grid, file, type);
+  }
 
   m_grid->ctx()->log()->message(3, "  [%s] Writing %s...",
                                timestamp(m_grid->com).c_str(),
                                m_name.c_str());
 
   double start_time = get_time();
-  write_impl(file);
+  write_impl(file, metadata);
   double end_time = get_time();
 
   const double
@@ -1302,7 +1623,7 @@ void IceModelVec::print_checksum(const char *prefix) const {
 
 void convert_vec(Vec v, units::System::Ptr system,
                  const std::string &spec1, const std::string &spec2) {
-  units::Converter c(system, spec1, spec2);
+  const units::Converter &c = *units::converter(system, spec1, spec2);
 
   // has to be a PetscInt because of the VecGetLocalSize() call
   PetscInt data_size = 0;
@@ -1,4 +1,4 @@
-// Copyright (C) 2008--2019 Ed Bueler, Constantine Khroulev, and David Maxwell
+// Copyright (C) 2008--2020 Ed Bueler, Constantine Khroulev, and David Maxwell
 //
 // This file is part of PISM.
 //
@@ -42,6 +42,11 @@ namespace pism {
 class IceGrid;
 class File;
 
+class LevelInterpolation;
+
+template<typename T, int N = 1> class View2;
+template<typename T> class View3;
+
 //! What "kind" of a vector to create: with or without ghosts.
 enum IceModelVecKind {WITHOUT_GHOSTS=0, WITH_GHOSTS=1};
 
@@ -160,7 +165,8 @@ T interpolate(const F &field, double x, double y) {
 
   PISM can read variables either from files with data on a grid matching the
   current grid (read()) or, using bilinear interpolation, from files
-  containing data on a different (but compatible) grid (regrid()).
+  containing data on a different (but compatible) grid (regrid()). regrid() can also
+  interpolate a field defined on a different grid directly.
 
   To write a field to a "prepared" NetCDF file, use write(). (A file is prepared
   if it contains all the necessary dimensions, coordinate variables and global
@@ -260,15 +266,19 @@ public:
 
   void  write(const std::string &filename) const;
   void  write(const File &nc) const;
+  void  write(const File &nc, const std::vector<SpatialVariableMetadata> &metadata) const;
 
   void  regrid(const std::string &filename, RegriddingFlag flag,
                double default_value = 0.0);
   void  regrid(const File &nc, RegriddingFlag flag,
                double default_value = 0.0);
+  void  regrid(const IceModelVec &source);
 
   virtual void  begin_access() const;
   virtual void  end_access() const;
   virtual void  update_ghosts();
+  void update_ghosts_begin();
+  void update_ghosts_end();
   virtual void  update_ghosts(IceModelVec &destination) const;
 
   petsc::Vec::Ptr allocate_proc0_copy() const;
@@ -294,7 +304,8 @@ protected:
   virtual void read_impl(const File &nc, unsigned int time);
   virtual void regrid_impl(const File &nc, RegriddingFlag flag,
                                      double default_value = 0.0);
-  virtual void write_impl(const File &nc) const;
+  virtual void write_impl(const File &nc,
+                          const std::vector<SpatialVariableMetadata> &metadata) const;
 
   std::vector<double> m_zlevels;
 
@@ -320,6 +331,12 @@ protected:
 
   mutable void *m_array;  // will be cast to double** or double*** in derived classes
 
+  template<typename T, int N> friend class View2;
+  template<typename T> friend class View3;
+  friend void read_fields(const File &file, unsigned int time,
+                          const std::vector<IceModelVec*> &fields);
+  double* local_array() const;
+
   mutable int m_access_counter;           // used in begin_access() and end_access()
   int m_state_counter;            //!< Internal IceModelVec "revision number"
 
@@ -336,6 +353,14 @@ protected:
                unsigned int count=1) const;
   void set_dof(petsc::DM::Ptr da_source, Vec source, unsigned int n,
                unsigned int count=1);
+
+  void allocate_storage(bool huge_pages);
+  void first_touch(bool huge_pages);
+  void track_memory();
+  //! ID of the storage of this field in the memory tracker (see MemoryTracker)
+  int m_memory_id;
+  //! true if the storage should be returned to the pool (see VecPool)
+  bool m_pooled;
 private:
   size_t size() const;
   // disable copy constructor and the assignment operator:
@@ -391,7 +416,8 @@ protected:
   virtual void read_impl(const File &nc, const unsigned int time);
   virtual void regrid_impl(const File &nc, RegriddingFlag flag,
                                      double default_value = 0.0);
-  virtual void write_impl(const File &nc) const;
+  virtual void write_impl(const File &nc,
+                          const std::vector<SpatialVariableMetadata> &metadata) const;
 };
 
 //! A "fat" storage vector for combining related fields (such as SSAFEM coefficients).
@@ -435,6 +461,7 @@ class IceModelVec2V;
 class IceModelVec2S : public IceModelVec2 {
   friend class IceModelVec2V;
   friend class IceModelVec2Stag;
+  friend class StencilCursor;
 public:
   IceModelVec2S();
   IceModelVec2S(IceGrid::ConstPtr grid, const std::string &name,
@@ -480,6 +507,9 @@ public:
   inline const double& operator()(int i, int j) const;
   inline StarStencil<double> star(int i, int j) const;
   inline BoxStencil<double> box(int i, int j) const;
+protected:
+  virtual void regrid_impl(const File &nc, RegriddingFlag flag,
+                           double default_value = 0.0);
 };
 
 
@@ -497,6 +527,9 @@ public:
   inline int as_int(int i, int j) const;
   inline StarStencil<int> int_star(int i, int j) const;
   inline BoxStencil<int> int_box(int i, int j) const;
+protected:
+  virtual void regrid_impl(const File &nc, RegriddingFlag flag,
+                           double default_value = 0.0);
 };
 
 /** Class for storing and accessing 2D vector fields used in IceModel.
@@ -609,10 +642,14 @@ public:
   void create(IceGrid::ConstPtr mygrid, const std::string &short_name,
               IceModelVecKind ghostedp,
               unsigned int stencil_width = 1);
+  void create(IceGrid::ConstPtr mygrid, const std::string &short_name,
+              IceModelVecKind ghostedp, const std::vector<double> &levels,
+              unsigned int stencil_width = 1);
 
   void  getHorSlice(Vec &gslice, double z) const; // used in iMmatlab.cc
   void  getHorSlice(IceModelVec2S &gslice, double z) const;
   void  getSurfaceValues(IceModelVec2S &gsurf, const IceModelVec2S &myH) const;
+  void  getSurfaceValues(IceModelVec2S &gsurf, const LevelInterpolation &weights) const;
 
   void sumColumns(IceModelVec2S &output, double A, double B) const;
 };
@@ -628,6 +665,9 @@ public:
 void convert_vec(Vec v, units::System::Ptr system,
                  const std::string &spec1, const std::string &spec2);
 
+void read_fields(const File &file, unsigned int time,
+                 const std::vector<IceModelVec*> &fields);
+
 class IceModelVec2CellType;
 
 /*!
@@ -1,4 +1,4 @@
-// Copyright (C) 2008--2019 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2008--2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,7 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <cmath>                // NAN
 
 #include <cassert>
 
@@ -37,6 +38,7 @@ using std::dynamic_pointer_cast;
 
 #include "pism_utilities.hh"
 #include "io/io_helpers.hh"
+#include "Poisson.hh"
 #include "pism/util/Logger.hh"
 
 namespace pism {
@@ -138,13 +140,14 @@ void IceModelVec2S::mask_by(const IceModelVec2S &M, double fill) {
   inc_state_counter();          // mark as modified
 }
 
-void IceModelVec2::write_impl(const File &file) const {
+void IceModelVec2::write_impl(const File &file,
+                              const std::vector<SpatialVariableMetadata> &metadata) const {
 
   assert(m_v != NULL);
 
   // The simplest case:
   if ((m_dof == 1) and (not m_has_ghosts)) {
-    IceModelVec::write_impl(file);
+    IceModelVec::write_impl(file, metadata);
     return;
   }
 
@@ -163,7 +166,7 @@ void IceModelVec2::write_impl(const File &file) const {
     IceModelVec2::get_dof(da2, tmp, j);
 
     petsc::VecArray tmp_array(tmp);
-    io::write_spatial_variable(m_metadata[j], *m_grid, file,
+    io::write_spatial_variable(metadata[j], *m_grid, file,
                            tmp_array.get());
   }
 }
@@ -443,7 +446,6 @@ void IceModelVec2::set_component(unsigned int n, const IceModelVec2S &source) {
 void IceModelVec2::create(IceGrid::ConstPtr grid, const std::string & name,
                            IceModelVecKind ghostedp,
                            unsigned int stencil_width, int dof) {
-  PetscErrorCode ierr;
   assert(m_v == NULL);
 
   m_dof  = dof;
@@ -458,17 +460,11 @@ void IceModelVec2::create(IceGrid::ConstPtr grid, const std::string & name,
   // initialize the da member:
   m_da = m_grid->get_dm(this->m_dof, this->m_da_stencil_width);
 
-  if (ghostedp) {
-    ierr = DMCreateLocalVector(*m_da, m_v.rawptr());
-    PISM_CHK(ierr, "DMCreateLocalVector");
-  } else {
-    ierr = DMCreateGlobalVector(*m_da, m_v.rawptr());
-    PISM_CHK(ierr, "DMCreateGlobalVector");
-  }
-
   m_has_ghosts = (ghostedp == WITH_GHOSTS);
   m_name       = name;
 
+  allocate_storage(false);
+
   if (m_dof == 1) {
     m_metadata.push_back(SpatialVariableMetadata(m_grid->ctx()->unit_system(),
                                                  name));
@@ -493,6 +489,34 @@ void IceModelVec2S::copy_from(const IceModelVec &source) {
   copy_2d<IceModelVec2S>(&source, this);
 }
 
+/*!
+ * Replace missing values using the "harmonic fill" (see fill_missing_harmonic()) if
+ * `input.regrid.fill_missing` is set to "harmonic".
+ */
+void IceModelVec2S::regrid_impl(const File &file, RegriddingFlag flag,
+                                double default_value) {
+  const bool harmonic_fill =
+    (flag == OPTIONAL_FILL_MISSING or flag == CRITICAL_FILL_MISSING) and
+    m_grid->ctx()->config()->get_string("input.regrid.fill_missing") == "harmonic";
+
+  if (not harmonic_fill) {
+    IceModelVec2::regrid_impl(file, flag, default_value);
+    return;
+  }
+
+  // keep missing values (as NaNs) and fill them using valid values nearby
+  IceModelVec2::regrid_impl(file, flag, NAN);
+
+  int n_missing = fill_missing_harmonic(*this, default_value);
+
+  if (n_missing > 0) {
+    m_grid->ctx()->log()->message(2,
+                                  "  Filled %d missing values in '%s' by solving"
+                                  " the Laplace equation.\n",
+                                  n_missing, m_name.c_str());
+  }
+}
+
 // IceModelVec2Stag
 
 IceModelVec2Stag::IceModelVec2Stag()
@@ -588,5 +612,11 @@ IceModelVec2Int::IceModelVec2Int(IceGrid::ConstPtr grid, const std::string &name
   m_interpolation_type = NEAREST;
 }
 
+//! Masks are never filled using the "harmonic fill".
+void IceModelVec2Int::regrid_impl(const File &file, RegriddingFlag flag,
+                                  double default_value) {
+  IceModelVec2::regrid_impl(file, flag, default_value);
+}
+
 
 } // end of namespace pism
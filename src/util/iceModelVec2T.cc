@@ -1,4 +1,4 @@
-// Copyright (C) 2009--2019 Constantine Khroulev
+// Copyright (C) 2009--2020 Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,8 @@
 
 #include <petsc.h>
 #include <cassert>
+#include <map>
+#include <tuple>
 
 #include "iceModelVec2T.hh"
 #include "pism/util/io/File.hh"
@@ -30,9 +32,80 @@
 #include "io/io_helpers.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/interpolation.hh"
+#include "pism/util/MemoryTracker.hh"
 
 namespace pism {
 
+//! Storage for records of an IceModelVec2T.
+struct IceModelVec2T::Storage {
+  Storage(IceGrid::ConstPtr grid, const std::string &name,
+          unsigned int n_records, int stencil_width);
+  ~Storage();
+
+  void*** begin_access();
+  void end_access();
+
+  IceGrid::ConstPtr grid;
+  petsc::DM::Ptr da;
+  //! a 3D Vec used to store records
+  petsc::Vec v;
+  void ***array;
+  int access_counter;
+  //! ID of this storage in the memory tracker
+  int memory_id;
+  //! true if records were read from a file
+  bool filled;
+};
+
+IceModelVec2T::Storage::Storage(IceGrid::ConstPtr g, const std::string &name,
+                                unsigned int n_records, int stencil_width)
+  : grid(g), array(nullptr), access_counter(0), memory_id(-1), filled(false) {
+
+  da = grid->get_dm(n_records, stencil_width);
+
+  PetscErrorCode ierr = DMCreateGlobalVector(*da, v.rawptr());
+  PISM_CHK(ierr, "DMCreateGlobalVector");
+
+  PetscInt size = 0;
+  ierr = VecGetLocalSize(v, &size);
+  PISM_CHK(ierr, "VecGetLocalSize");
+
+  const PetscScalar *data = nullptr;
+  ierr = VecGetArrayRead(v, &data);
+  PISM_CHK(ierr, "VecGetArrayRead");
+  ierr = VecRestoreArrayRead(v, &data);
+  PISM_CHK(ierr, "VecRestoreArrayRead");
+
+  memory_id = grid->ctx()->memory().allocate(name + " (records)",
+                                             size * sizeof(double),
+                                             n_records, stencil_width, data);
+}
+
+IceModelVec2T::Storage::~Storage() {
+  grid->ctx()->memory().deallocate(memory_id);
+}
+
+//! Access records. Storage may be shared, so this keeps its own access counter.
+void*** IceModelVec2T::Storage::begin_access() {
+  if (access_counter == 0) {
+    PetscErrorCode ierr = DMDAVecGetArrayDOF(*da, v, &array);
+    PISM_CHK(ierr, "DMDAVecGetArrayDOF");
+  }
+  access_counter += 1;
+
+  return array;
+}
+
+void IceModelVec2T::Storage::end_access() {
+  access_counter -= 1;
+
+  if (access_counter == 0) {
+    PetscErrorCode ierr = DMDAVecRestoreArrayDOF(*da, v, &array);
+    PISM_CHK(ierr, "DMDAVecRestoreArrayDOF");
+    array = nullptr;
+  }
+}
+
 
 /*!
  * Allocate an instance that will be used to load and use a forcing field from a file.
@@ -64,6 +137,12 @@ IceModelVec2T::Ptr IceModelVec2T::ForcingField(IceGrid::ConstPtr grid,
 
   if (not periodic) {
     n_records = std::min(n_records, max_buffer_size);
+
+    if (grid->ctx()->config()->get_flag("input.forcing.low_memory")) {
+      // two records are enough for both piecewise-constant and linear interpolation;
+      // averages are computed incrementally
+      n_records = std::min(n_records, 2);
+    }
   }
   // In the periodic case we try to keep all the records in RAM.
 
@@ -100,10 +179,17 @@ IceModelVec2T::IceModelVec2T(IceGrid::ConstPtr grid, const std::string &short_na
     m_n_records(n_records),
     m_N(0),
     m_n_evaluations_per_year(n_evaluations_per_year),
+    m_n_prefetch(0),
+    m_lazy(false),
+    m_low_memory(false),
+    m_update_pending(false),
+    m_pending_t(0.0),
+    m_pending_dt(0.0),
     m_first(-1),
     m_interp_type(interpolation_type),
     m_period(0),
-    m_reference_time(0.0)
+    m_reference_time(0.0),
+    m_weights_state(-1)
 {
   m_report_range = false;
 
@@ -122,12 +208,11 @@ IceModelVec2T::IceModelVec2T(IceGrid::ConstPtr grid, const std::string &short_na
   }
   // LCOV_EXCL_STOP
 
-  // initialize the m_da3 member:
-  m_da3 = m_grid->get_dm(n_records, this->m_da_stencil_width);
+  m_n_prefetch = std::max((int)m_grid->ctx()->config()->get_number("input.forcing.prefetch"), 0);
+  m_lazy       = m_grid->ctx()->config()->get_flag("input.forcing.lazy");
+  m_low_memory = m_grid->ctx()->config()->get_flag("input.forcing.low_memory");
 
-  // allocate the 3D Vec:
-  PetscErrorCode ierr = DMCreateGlobalVector(*m_da3, m_v3.rawptr());
-  PISM_CHK(ierr, "DMCreateGlobalVector");
+  m_storage.reset(new Storage(m_grid, short_name, n_records, m_da_stencil_width));
 }
 
 IceModelVec2T::~IceModelVec2T() {
@@ -145,8 +230,7 @@ double*** IceModelVec2T::get_array3() {
 
 void IceModelVec2T::begin_access() const {
   if (m_access_counter == 0) {
-    PetscErrorCode ierr = DMDAVecGetArrayDOF(*m_da3, m_v3, &m_array3);
-    PISM_CHK(ierr, "DMDAVecGetArrayDOF");
+    m_array3 = m_storage->begin_access();
   }
 
   // this call will increment the m_access_counter
@@ -159,8 +243,7 @@ void IceModelVec2T::end_access() const {
   IceModelVec2S::end_access();
 
   if (m_access_counter == 0) {
-    PetscErrorCode ierr = DMDAVecRestoreArrayDOF(*m_da3, m_v3, &m_array3);
-    PISM_CHK(ierr, "DMDAVecRestoreArrayDOF");
+    m_storage->end_access();
     m_array3 = NULL;
   }
 }
@@ -262,8 +345,60 @@ void IceModelVec2T::init(const std::string &fname, unsigned int period, double r
                          "buffer has to be big enough to hold all records of periodic data");
     }
 
-    // read periodic data right away (we need to hold it all in memory anyway)
-    update(0);
+    if (m_grid->ctx()->config()->get_flag("input.forcing.share_buffers")) {
+      share_storage();
+    }
+
+    if (m_lazy) {
+      // read all records when these data are used for the first time
+      m_update_pending = true;
+    } else {
+      // read periodic data right away (we need to hold it all in memory anyway)
+      update(0);
+    }
+  }
+}
+
+/*!
+ * Use the same storage for records in all instances reading the same periodic field (all
+ * records of a periodic field are kept in memory, so its records never change once they
+ * are read).
+ *
+ * Instances are considered equivalent if they use the same grid, file, variable (name,
+ * standard name, and internal units), buffer size, period, reference time, and spatial
+ * interpolation method. Storage is freed when the last instance using it is destroyed.
+ */
+void IceModelVec2T::share_storage() {
+  typedef std::tuple<const IceGrid*, std::string, std::string, std::string, std::string,
+                     unsigned int, unsigned int, double, int> Key;
+
+  static std::map<Key, std::weak_ptr<Storage> > cache;
+
+  // remove entries that are no longer used
+  for (auto it = cache.begin(); it != cache.end();) {
+    if (it->second.expired()) {
+      it = cache.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  const SpatialVariableMetadata &m = m_metadata[0];
+
+  Key key{m_grid.get(), m_filename, m.get_name(), m.get_string("standard_name"),
+          m.get_string("units"), m_n_records, m_period, m_reference_time,
+          (int)m_interpolation_type};
+
+  auto storage = cache[key].lock();
+  if (storage) {
+    m_storage = storage;
+
+    m_grid->ctx()->log()->message(3,
+                                  "  sharing storage for records of %s (%s) read from %s\n",
+                                  m.get_name().c_str(), m.get_string("long_name").c_str(),
+                                  m_filename.c_str());
+  } else {
+    cache[key] = m_storage;
   }
 }
 
@@ -273,6 +408,7 @@ void IceModelVec2T::init_constant(double value) {
   // set constant value everywhere
   set(value);
   set_record(0);
+  m_weights.clear();
 
   // set the time to zero
   m_time = {0.0};
@@ -284,6 +420,10 @@ void IceModelVec2T::init_constant(double value) {
 }
 
 //! Read some data to make sure that the interval (t, t + dt) is covered.
+/*!
+ * If `input.forcing.lazy` is set, reading is deferred until these data are used (see
+ * init_interpolation()), so fields that are never used are never read.
+ */
 void IceModelVec2T::update(double t, double dt) {
 
   if (m_filename.empty()) {
@@ -291,6 +431,32 @@ void IceModelVec2T::update(double t, double dt) {
     return;
   }
 
+  if (m_lazy) {
+    m_update_pending = true;
+    m_pending_t      = t;
+    m_pending_dt     = dt;
+    return;
+  }
+
+  update_buffer(t, dt);
+}
+
+//! Perform the update requested by the last update() call if it was deferred.
+void IceModelVec2T::read_pending() {
+  if (not m_update_pending) {
+    return;
+  }
+  m_update_pending = false;
+
+  if (m_period != 0) {
+    update(0);
+  } else {
+    update_buffer(m_pending_t, m_pending_dt);
+  }
+}
+
+void IceModelVec2T::update_buffer(double t, double dt) {
+
   if (m_time_bounds.size() == 0) {
     update(0);
     return;
@@ -311,6 +477,9 @@ void IceModelVec2T::update(double t, double dt) {
 
     // just return if we have all the data we need:
     if (t >= t0 and t + dt <= t1) {
+      if (m_n_prefetch > 0) {
+        prefetch(t);
+      }
       return;
     }
   }
@@ -325,6 +494,11 @@ void IceModelVec2T::update(double t, double dt) {
   // check if all the records necessary to cover this interval fit in the
   // buffer:
   if (N > m_n_records) {
+    if (m_low_memory) {
+      // read records starting from the first one needed: average() reads the rest
+      update(first);
+      return;
+    }
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
                                   "cannot read %d records of %s (buffer size: %d)",
                                   N, m_name.c_str(), m_n_records);
@@ -345,6 +519,14 @@ void IceModelVec2T::update(unsigned int start) {
 
   unsigned int missing = std::min(m_n_records, time_size - start);
 
+  if (m_period != 0 and m_storage->filled and m_first < 0) {
+    // all records were read by another instance sharing storage with this one
+    m_first = 0;
+    m_N     = time_size;
+    get_record(m_N - 1);
+    return;
+  }
+
   if (start == static_cast<unsigned int>(m_first)) {
     // nothing to do
     return;
@@ -373,6 +555,55 @@ void IceModelVec2T::update(unsigned int start) {
 
   m_N = kept + missing;
 
+  read(start, missing, kept);
+}
+
+/*!
+ * Read records that will be needed soon, replacing records that are no longer needed
+ * (the ones before the record containing `t`), to avoid re-filling the whole buffer at
+ * once when the model time leaves the interval covered by records in memory.
+ *
+ * Reads `m_n_prefetch` records at a time, as soon as this many buffer slots are
+ * available (or fewer if the file does not have this many records left).
+ */
+void IceModelVec2T::prefetch(double t) {
+  unsigned int
+    time_size = m_time.size(),
+    last      = m_first + (m_N - 1);
+
+  if (last + 1 >= time_size) {
+    // all remaining records are in memory
+    return;
+  }
+
+  Interpolation I(m_interp_type, m_time, {t});
+
+  unsigned int
+    first     = std::max(I.left(0), m_first), // never re-read discarded records
+    remaining = time_size - (last + 1),
+    kept      = last - first + 1,
+    count     = std::min(m_n_records - kept, remaining);
+
+  if (count == 0 or count < std::min(m_n_prefetch, remaining)) {
+    // not enough free slots yet
+    return;
+  }
+  count = std::min(count, m_n_prefetch);
+
+  discard(first - m_first);
+  m_first = first;
+
+  m_N = kept + count;
+
+  read(last + 1, count, kept);
+}
+
+/*!
+ * Read `count` records starting from `start` (in-file index) and save them in the buffer
+ * starting at `position`.
+ */
+void IceModelVec2T::read(unsigned int start, unsigned int count, unsigned int position) {
+
   Time::ConstPtr t = m_grid->ctx()->time();
 
   Logger::ConstPtr log = m_grid->ctx()->log();
@@ -380,11 +611,11 @@ void IceModelVec2T::update(unsigned int start) {
     log->message(4,
                "  reading \"%s\" into buffer\n"
                "          (short_name = %s): %d records, time intervals (%s, %s) through (%s, %s)...\n",
-               metadata().get_string("long_name").c_str(), m_name.c_str(), missing,
+               metadata().get_string("long_name").c_str(), m_name.c_str(), count,
                t->date(m_time_bounds[start*2]).c_str(),
                t->date(m_time_bounds[start*2 + 1]).c_str(),
-               t->date(m_time_bounds[(start + missing - 1)*2]).c_str(),
-               t->date(m_time_bounds[(start + missing - 1)*2 + 1]).c_str());
+               t->date(m_time_bounds[(start + count - 1)*2]).c_str(),
+               t->date(m_time_bounds[(start + count - 1)*2 + 1]).c_str());
     m_report_range = false;
   } else {
     m_report_range = true;
@@ -394,21 +625,41 @@ void IceModelVec2T::update(unsigned int start) {
 
   const bool allow_extrapolation = m_grid->ctx()->config()->get_flag("grid.allow_extrapolation");
 
-  for (unsigned int j = 0; j < missing; ++j) {
-    {
-      petsc::VecArray tmp_array(m_v);
-      io::regrid_spatial_variable(m_metadata[0], *m_grid, file, start + j, CRITICAL,
-                                  m_report_range, allow_extrapolation,
-                                  0.0, m_interpolation_type, tmp_array.get());
-    }
+  // read all records using one hyperslab call: records are stored one after another
+  const int
+    xs = m_grid->xs(),
+    xm = m_grid->xm(),
+    ys = m_grid->ys(),
+    ym = m_grid->ym();
+  std::vector<double> records(count * xm * ym);
+
+  io::regrid_spatial_variable(m_metadata[0], *m_grid, file, start, count, CRITICAL,
+                              m_report_range, allow_extrapolation,
+                              0.0, m_interpolation_type, records.data());
 
+  for (unsigned int k = 0; k < count; ++k) {
     m_grid->ctx()->log()->message(5, " %s: reading entry #%02d, year %s...\n",
                                   m_name.c_str(),
-                                  start + j,
-                                  t->date(m_time[start + j]).c_str());
+                                  start + k,
+                                  t->date(m_time[start + k]).c_str());
+  }
+
+  // copy records into the buffer
+  double ***a3 = get_array3();
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
 
-    set_record(kept + j);
+    const double *value = &records[(j - ys) * xm + (i - xs)];
+    for (unsigned int k = 0; k < count; ++k) {
+      a3[j][i][position + k] = value[k * xm * ym];
+    }
   }
+  end_access();
+
+  m_storage->filled = true;
+
+  // the 2D field contains the last record read (used if there is only one record)
+  get_record(position + count - 1);
 }
 
 //! Discard the first N records, shifting the rest of them towards the "beginning".
@@ -446,6 +697,7 @@ void IceModelVec2T::set_record(int n) {
 
 //! Sets the (internal) Vec v to the contents of the nth record.
 void IceModelVec2T::get_record(int n) {
+  m_weights.clear();
 
   double  **a2 = get_array();
   double ***a3 = get_array3();
@@ -493,7 +745,7 @@ void IceModelVec2T::interp(double t) {
 
   init_interpolation({t});
 
-  get_record(m_interp->left(0));
+  set_from_weights({{m_first + m_interp->left(0), 1.0}});
 }
 
 
@@ -511,6 +763,7 @@ void IceModelVec2T::average(double t, double dt) {
 
   // if only one record, nothing to do
   if (m_time.size() == 1) {
+    read_pending();
     return;
   }
 
@@ -526,14 +779,244 @@ void IceModelVec2T::average(double t, double dt) {
     ts[k] = t + k * ts_dt;
   }
 
+  if (m_low_memory and m_period == 0) {
+    average_incrementally(ts);
+    return;
+  }
+
   init_interpolation(ts);
 
-  double **a2 = get_array();         // calls begin_access()
+  // Weights of records: the rectangle rule (uses the fact that points are equally-spaced
+  // in time) applied to values computed using linear or piecewise-constant interpolation.
+  std::map<int, double> weights;
+  if (m_N == 1) {
+    weights[m_first] = 1.0;
+  } else {
+    for (int k = 0; k < M; ++k) {
+      const double alpha = m_interp->alpha(k);
+
+      if (alpha != 1.0) {
+        weights[m_first + m_interp->left(k)] += (1.0 - alpha) / M;
+      }
+      if (alpha != 0.0) {
+        weights[m_first + m_interp->right(k)] += alpha / M;
+      }
+    }
+  }
+
+  set_from_weights(weights);
+}
+
+/*!
+ * Set the 2D field to the weighted sum of records (`weights` maps in-file record indices
+ * to weights).
+ *
+ * Does nothing if the field already contains the sum computed using the same weights
+ * and was not modified since. This makes repeated update() calls within the same
+ * forcing interval (piecewise-constant interpolation) or requests for the same time
+ * cheap.
+ */
+void IceModelVec2T::set_from_weights(const std::map<int, double> &weights) {
+
+  if (weights == m_weights and state_counter() == m_weights_state) {
+    return;
+  }
+
+  // convert to indices of records stored in memory
+  std::vector<int> index;
+  std::vector<double> weight;
+  for (const auto &w : weights) {
+    index.push_back(w.first - m_first);
+    weight.push_back(w.second);
+  }
+  const unsigned int N = index.size();
+
+  double  **a2 = get_array();
+  double ***a3 = get_array3();
+
+  // Special cases: a copy of one record (piecewise-constant interpolation within a
+  // record interval) and a linear combination of two records (linear interpolation
+  // within an interval) cover most calls.
+  if (N == 1 and weight[0] == 1.0) {
+    const int L = index[0];
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+      a2[j][i] = a3[j][i][L];
+    }
+  } else if (N == 2) {
+    const int L = index[0], R = index[1];
+    const double w_L = weight[0], w_R = weight[1];
+
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+      a2[j][i] = w_L * a3[j][i][L] + w_R * a3[j][i][R];
+    }
+  } else {
+    for (Points p(*m_grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      const double *values = a3[j][i];
+      double result = 0.0;
+      for (unsigned int k = 0; k < N; ++k) {
+        result += weight[k] * values[index[k]];
+      }
+      a2[j][i] = result;
+    }
+  }
+  end_access();
+  end_access();
+
+  inc_state_counter();
+
+  m_weights       = weights;
+  m_weights_state = state_counter();
+}
+
+/*!
+ * Compute the average of values at times `ts` (the low-memory mode).
+ *
+ * Weights are computed using in-file record indices. Records are read a buffer at a time
+ * and the weighted sum is accumulated in the 2D field, so the buffer does not have to
+ * hold all the records covering the averaging interval.
+ */
+void IceModelVec2T::average_incrementally(const std::vector<double> &ts) {
+
+  read_pending();
+
+  const unsigned int M = ts.size();
+
+  Interpolation I(m_interp_type, m_time, ts);
+
+  // weights of records (in-file indices): see average()
+  std::map<int, double> weights;
+  for (unsigned int k = 0; k < M; ++k) {
+    const double alpha = I.alpha(k);
+
+    if (alpha != 1.0) {
+      weights[I.left(k)] += (1.0 - alpha) / M;
+    }
+    if (alpha != 0.0) {
+      weights[I.right(k)] += alpha / M;
+    }
+  }
+
+  const int
+    first = weights.begin()->first,
+    last  = weights.rbegin()->first;
+
+  if (first >= m_first and last < m_first + (int)m_N) {
+    // all the records we need are in memory
+    set_from_weights(weights);
+    return;
+  }
+
+  if (weights == m_weights and state_counter() == m_weights_state) {
+    return;
+  }
+
+  set(0.0);
+
+  auto w = weights.begin();
+  while (w != weights.end()) {
+    // read as many records as possible starting from the first one not used yet
+    update(w->first);
+
+    const int buffer_end = m_first + m_N;
+
+    double  **a2 = get_array();
+    double ***a3 = get_array3();
+    for (; w != weights.end() and w->first < buffer_end; ++w) {
+      const int n = w->first - m_first;
+      const double weight = w->second;
+
+      for (Points p(*m_grid); p; p.next()) {
+        const int i = p.i(), j = p.j();
+        a2[j][i] += weight * a3[j][i][n];
+      }
+    }
+    end_access();
+    end_access();
+  }
+
+  inc_state_counter();
+
+  m_weights       = weights;
+  m_weights_state = state_counter();
+}
+
+/*!
+ * Make sure that all the records needed to interpolate to times `ts` are in memory (the
+ * low-memory mode), growing the buffer if necessary.
+ */
+void IceModelVec2T::read_records_for(const std::vector<double> &ts) {
+  Interpolation I(m_interp_type, m_time, ts);
+
+  int first = m_time.size(), last = 0;
+  for (unsigned int k = 0; k < ts.size(); ++k) {
+    first = std::min(first, I.left(k));
+    last  = std::max(last, I.right(k));
+  }
+
+  if (m_first >= 0 and first >= m_first and last < m_first + (int)m_N) {
+    return;
+  }
+
+  const unsigned int N = last - first + 1;
+  if (N > m_n_records) {
+    grow(N);
+  }
+
+  if (first == m_first) {
+    // update() does nothing in this case: keep records in memory and read the rest
+    const unsigned int count = std::min(m_n_records, (unsigned int)m_time.size() - first) - m_N;
+    read(m_first + m_N, count, m_N);
+    m_N += count;
+  } else {
+    update(first);
+  }
+}
+
+/*!
+ * Re-allocate storage so that it can hold `n_records` records, keeping records that are
+ * in memory.
+ */
+void IceModelVec2T::grow(unsigned int n_records) {
+  if (n_records > IceGrid::max_dm_dof) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot allocate storage for %d records of %s"
+                                  " (exceeds the maximum of %d)",
+                                  n_records, m_name.c_str(), IceGrid::max_dm_dof);
+  }
+
+  if (m_access_counter != 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot re-allocate storage of %s while it is in use",
+                                  m_name.c_str());
+  }
+
+  m_grid->ctx()->log()->message(3, "  increasing the buffer size of %s to %d records\n",
+                                m_name.c_str(), n_records);
+
+  std::shared_ptr<Storage> storage(new Storage(m_grid, m_name, n_records,
+                                               m_da_stencil_width));
+
+  double ***a3_old = reinterpret_cast<double***>(m_storage->begin_access());
+  double ***a3_new = reinterpret_cast<double***>(storage->begin_access());
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
-    a2[j][i] = average(i, j);
+
+    for (unsigned int k = 0; k < m_N; ++k) {
+      a3_new[j][i][k] = a3_old[j][i][k];
+    }
   }
-  end_access();
+  storage->end_access();
+  m_storage->end_access();
+
+  storage->filled = m_storage->filled;
+
+  m_storage   = storage;
+  m_n_records = n_records;
 }
 
 /**
@@ -545,6 +1028,12 @@ void IceModelVec2T::average(double t, double dt) {
  */
 void IceModelVec2T::init_interpolation(const std::vector<double> &ts) {
 
+  read_pending();
+
+  if (m_low_memory and m_period == 0 and m_time.size() > 1) {
+    read_records_for(ts);
+  }
+
   assert(m_first >= 0);
 
   auto time = m_grid->ctx()->time();
@@ -580,34 +1069,4 @@ void IceModelVec2T::interp(int i, int j, std::vector<double> &result) {
   m_interp->interpolate(a3[j][i], result.data());
 }
 
-//! \brief Finds the average value at i,j over the interval (t, t +
-//! dt) using the rectangle rule.
-/*!
-  Can (and should) be optimized. Later, though.
- */
-double IceModelVec2T::average(int i, int j) {
-  unsigned int M = m_interp->alpha().size();
-  double result = 0.0;
-
-  if (m_N == 1) {
-    double ***a3 = (double***) m_array3;
-    result = a3[j][i][0];
-  } else {
-    std::vector<double> values(M);
-
-    interp(i, j, values);
-
-    // rectangular rule (uses the fact that points are equally-spaced
-    // in time)
-    result = 0;
-    for (unsigned int k = 0; k < M; ++k) {
-      result += values[k];
-    }
-    result /= (double)M;
-  }
-  return result;
-}
-
-
-
 } // end of namespace pism
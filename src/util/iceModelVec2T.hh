@@ -1,4 +1,4 @@
-// Copyright (C) 2009--2019 Constantine Khroulev
+// Copyright (C) 2009--2020 Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -19,6 +19,8 @@
 #ifndef __IceModelVec2T_hh
 #define __IceModelVec2T_hh
 
+#include <map>
+
 #include "iceModelVec.hh"
 #include "MaxTimestep.hh"
 
@@ -37,8 +39,17 @@ namespace pism {
 
   IceModelVec2T is always global (%i.e. has no ghosts).
 
-  Both versions of interp() use piecewise-constant interpolation and
-  extrapolate (by a constant) outside the available range.
+  interp(double t) uses piecewise-constant interpolation; average() uses the
+  interpolation type selected when creating a field. Both extrapolate (by a constant)
+  outside the available range.
+
+  interp(double t) and average() compute weights of records once per call and set the
+  2D field to the weighted sum of records. This sum is not recomputed if weights did not
+  change (see set_from_weights()).
+
+  If `input.forcing.low_memory` is set, non-periodic fields start with a buffer of two
+  records. average() then accumulates the weighted sum reading records as needed, and
+  init_interpolation() grows the buffer if the requested times need more records.
 */
 class IceModelVec2T : public IceModelVec2S {
 public:
@@ -80,8 +91,11 @@ private:
   std::vector<double> m_time,             //!< all the times available in filename
     m_time_bounds;                //!< time bounds
   std::string m_filename;         //!< file to read (regrid) from
-  petsc::DM::Ptr m_da3;
-  petsc::Vec m_v3;                       //!< a 3D Vec used to store records
+
+  struct Storage;
+  //! storage for records (may be shared with other instances reading the same periodic
+  //! field, see init())
+  std::shared_ptr<Storage> m_storage;
   mutable void ***m_array3;
 
   //! maximum number of records to store in memory
@@ -93,6 +107,19 @@ private:
   //! number of evaluations per year used to compute temporal averages
   unsigned int m_n_evaluations_per_year;
 
+  //! number of records to read ahead (0 if prefetching is disabled)
+  unsigned int m_n_prefetch;
+
+  //! true if reading is deferred until data are used
+  bool m_lazy;
+  //! true if records are read as needed instead of keeping a long buffer (non-periodic
+  //! fields only, see input.forcing.low_memory)
+  bool m_low_memory;
+  //! true if an update() call was deferred
+  bool m_update_pending;
+  //! the time interval requested by the deferred update() call
+  double m_pending_t, m_pending_dt;
+
   //! in-file index of the first record stored in memory ("int" to allow first==-1 as an
   //! "invalid" first value)
   int m_first;
@@ -102,10 +129,24 @@ private:
   unsigned int m_period;        // in years
   double m_reference_time;      // in seconds
 
+  //! weights of records (in-file indices) used to compute the current 2D field (empty if
+  //! it was set in some other way)
+  std::map<int, double> m_weights;
+  //! state counter of the 2D field computed using m_weights
+  int m_weights_state;
+
   double*** get_array3();
+  void share_storage();
   void update(unsigned int start);
+  void update_buffer(double t, double dt);
+  void read_pending();
+  void prefetch(double t);
+  void read(unsigned int start, unsigned int count, unsigned int position);
   void discard(int N);
-  double average(int i, int j);
+  void set_from_weights(const std::map<int, double> &weights);
+  void average_incrementally(const std::vector<double> &ts);
+  void read_records_for(const std::vector<double> &ts);
+  void grow(unsigned int n_records);
   void set_record(int n);
   void get_record(int n);
 };
@@ -1,4 +1,4 @@
-// Copyright (C) 2008--2018 Ed Bueler and Constantine Khroulev
+// Copyright (C) 2008--2020 Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -19,6 +19,7 @@
 #include <cstring>
 #include <cstdlib>
 #include <cassert>
+#include <algorithm>             // std::min
 
 #include <memory>
 using std::dynamic_pointer_cast;
@@ -28,6 +29,7 @@ using std::dynamic_pointer_cast;
 #include "iceModelVec.hh"
 #include "IceGrid.hh"
 #include "ConfigInterface.hh"
+#include "LevelView.hh"
 
 #include "error_handling.hh"
 
@@ -76,7 +78,6 @@ IceModelVec3::Ptr IceModelVec3::To3DScalar(IceModelVec::Ptr input) {
 void IceModelVec3D::allocate(IceGrid::ConstPtr grid, const std::string &name,
                              IceModelVecKind ghostedp, const std::vector<double> &levels,
                              unsigned int stencil_width) {
-  PetscErrorCode ierr;
   m_grid = grid;
 
   m_zlevels = levels;
@@ -86,16 +87,10 @@ void IceModelVec3D::allocate(IceGrid::ConstPtr grid, const std::string &name,
 
   m_has_ghosts = (ghostedp == WITH_GHOSTS);
 
-  if (m_has_ghosts == true) {
-    ierr = DMCreateLocalVector(*m_da, m_v.rawptr());
-    PISM_CHK(ierr, "DMCreateLocalVector");
-  } else {
-    ierr = DMCreateGlobalVector(*m_da, m_v.rawptr());
-    PISM_CHK(ierr, "DMCreateGlobalVector");
-  }
-
   m_name = name;
 
+  allocate_storage(m_grid->ctx()->config()->get_flag("grid.transparent_huge_pages"));
+
   m_metadata.push_back(SpatialVariableMetadata(m_grid->ctx()->unit_system(),
                                                name, m_zlevels));
 }
@@ -185,20 +180,29 @@ void  IceModelVec3::getHorSlice(Vec &gslice, double z) const {
 
   petsc::DM::Ptr da2 = m_grid->get_dm(1, m_grid->ctx()->config()->get_number("grid.max_stencil_width"));
 
+#if (Pism_DEBUG==1)
+  if (not isLegalLevel(z)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "level %f is not legal; name = %s",
+                                  z, m_name.c_str());
+  }
+#endif
+
+  // find the interval containing z once instead of at every grid point
+  unsigned int k = 0;
+  double lambda = 0.0;
+  level_interpolation_weight(m_zlevels, z, k, lambda);
+  const unsigned int k1 = std::min(k + 1, (unsigned int)m_zlevels.size() - 1);
+
   IceModelVec::AccessList list(*this);
   petsc::DMDAVecArray slice(da2, gslice);
   double **slice_val = (double**)slice.get();
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-      slice_val[j][i] = getValZ(i,j,z);
-    }
-  } catch (...) {
-    loop.failed();
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+    const double *column = get_column(i, j);
+
+    slice_val[j][i] = column[k] + lambda * (column[k1] - column[k]);
   }
-  loop.check();
 }
 
 //! Copies a horizontal slice at level z of an IceModelVec3 into an IceModelVec2S gslice.
@@ -207,18 +211,27 @@ void  IceModelVec3::getHorSlice(Vec &gslice, double z) const {
  * coordinate system, not in reality.
  */
 void  IceModelVec3::getHorSlice(IceModelVec2S &gslice, double z) const {
+#if (Pism_DEBUG==1)
+  if (not isLegalLevel(z)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "level %f is not legal; name = %s",
+                                  z, m_name.c_str());
+  }
+#endif
+
+  // find the interval containing z once instead of at every grid point
+  unsigned int k = 0;
+  double lambda = 0.0;
+  level_interpolation_weight(m_zlevels, z, k, lambda);
+  const unsigned int k1 = std::min(k + 1, (unsigned int)m_zlevels.size() - 1);
+
   IceModelVec::AccessList list{this, &gslice};
 
-  ParallelSection loop(m_grid->com);
-  try {
-    for (Points p(*m_grid); p; p.next()) {
-      const int i = p.i(), j = p.j();
-      gslice(i, j) = getValZ(i, j, z);
-    }
-  } catch (...) {
-    loop.failed();
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+    const double *column = get_column(i, j);
+
+    gslice(i, j) = column[k] + lambda * (column[k1] - column[k]);
   }
-  loop.check();
 }
 
 
@@ -239,6 +252,12 @@ void IceModelVec3::getSurfaceValues(IceModelVec2S &surface_values,
   loop.check();
 }
 
+//! Copies values at heights used to compute `weights` (see IceGrid::surface_interpolation()).
+void IceModelVec3::getSurfaceValues(IceModelVec2S &surface_values,
+                                    const LevelInterpolation &weights) const {
+  weights.interpolate(*this, surface_values);
+}
+
 double* IceModelVec3D::get_column(int i, int j) {
 #if (Pism_DEBUG==1)
   check_array_indices(i, j, 0);
@@ -270,6 +289,17 @@ void  IceModelVec3::create(IceGrid::ConstPtr grid, const std::string &name,
                           grid->z(), stencil_width);
 }
 
+//! Allocate a field using vertical levels `levels` instead of levels of the grid.
+/*!
+ * Used to store 3D fields on a coarser vertical grid (see stressbalance::velocity_levels()).
+ */
+void  IceModelVec3::create(IceGrid::ConstPtr grid, const std::string &name,
+                           IceModelVecKind ghostedp, const std::vector<double> &levels,
+                           unsigned int stencil_width) {
+
+  IceModelVec3D::allocate(grid, name, ghostedp, levels, stencil_width);
+}
+
 /** Sum a 3-D vector in the Z direction to create a 2-D vector.
 
 Note that this sums up all the values in a column, including ones
@@ -293,7 +323,7 @@ Computes output = A*output + B*sum_columns(input) + C
 
 @see https://github.com/pism/pism/issues/229 */
 void IceModelVec3::sumColumns(IceModelVec2S &output, double A, double B) const {
-  const unsigned int Mz = m_grid->Mz();
+  const unsigned int Mz = m_zlevels.size();
 
   AccessList access{this, &output};
 
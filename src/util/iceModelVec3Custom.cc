@@ -54,6 +54,8 @@ IceModelVec3Custom::IceModelVec3Custom(IceGrid::ConstPtr grid,
   PetscErrorCode ierr = DMCreateGlobalVector(*m_da, m_v.rawptr());
   PISM_CHK(ierr, "DMCreateGlobalVector");
 
+  track_memory();
+
   m_metadata.push_back(SpatialVariableMetadata(m_grid->ctx()->unit_system(),
                                                m_name, m_zlevels));
   m_metadata[0].get_z().set_name(z_name);
@@ -0,0 +1,98 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "DeltaEncoder.hh"
+#include "File.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+//! Create an encoder recording the base file `base_filename`.
+DeltaEncoder::DeltaEncoder(const std::string &base_filename)
+  : m_base_filename(base_filename),
+    m_recording(true) {
+  // empty
+}
+
+const std::string& DeltaEncoder::base_filename() const {
+  return m_base_filename;
+}
+
+//! Stop recording the base file: variables written after this are encoded.
+void DeltaEncoder::stop_recording() {
+  m_recording = false;
+}
+
+/*!
+ * Process the sub-domain `data` of the variable `variable_name` written to a file.
+ *
+ * Returns true and sets `result` to the difference from the base file if the variable
+ * should be written as a difference.
+ */
+bool DeltaEncoder::encode(const std::string &variable_name, const double *data, size_t size,
+                          std::vector<double> &result) {
+  if (m_recording) {
+    m_base[variable_name].assign(data, data + size);
+    return false;
+  }
+
+  auto base = m_base.find(variable_name);
+  if (base == m_base.end() or base->second.size() != size) {
+    return false;
+  }
+
+  result.resize(size);
+  for (size_t k = 0; k < size; ++k) {
+    result[k] = data[k] - base->second[k];
+  }
+  return true;
+}
+
+/*!
+ * Returns the name of the base file if the variable `variable_name` in `file` is stored as
+ * a difference (see DeltaEncoder) or an empty string otherwise.
+ *
+ * A relative name of the base file is interpreted as relative to the directory containing
+ * `file`.
+ */
+std::string delta_base_filename(const File &file, const std::string &variable_name) {
+  if (file.read_text_attribute(variable_name, "pism_encoding") != "delta") {
+    return "";
+  }
+
+  std::string base = file.read_text_attribute("PISM_GLOBAL", "pism_delta_base");
+  if (base.empty()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "'%s' in '%s' is stored as a difference"
+                                  " but the base file is not known",
+                                  variable_name.c_str(), file.filename().c_str());
+  }
+
+  std::string filename = file.filename();
+  auto slash = filename.rfind('/');
+  if (base[0] != '/' and slash != std::string::npos) {
+    base = filename.substr(0, slash + 1) + base;
+  }
+
+  return base;
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -0,0 +1,68 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PISM_DELTAENCODER_H
+#define PISM_DELTAENCODER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pism {
+
+class File;
+
+namespace io {
+
+/*!
+ * Writes spatial variables as differences from a "base" file written earlier (see
+ * File::set_delta_encoder()).
+ *
+ * While recording the base file the encoder keeps a copy of the sub-domain of each
+ * spatial variable written to it (in internal units). Variables written to other files
+ * after that are replaced by differences from these copies. Differences are mostly zero
+ * if fields change slowly, so they compress well (see `output.compression.*`).
+ *
+ * A file containing differences records the name of the base file in the global
+ * attribute `pism_delta_base`; each variable stored as a difference has the attribute
+ * `pism_encoding = "delta"`. PISM adds values from the base file when reading these
+ * variables (see delta_base_filename()).
+ */
+class DeltaEncoder {
+public:
+  DeltaEncoder(const std::string &base_filename);
+
+  const std::string& base_filename() const;
+
+  void stop_recording();
+
+  bool encode(const std::string &variable_name, const double *data, size_t size,
+              std::vector<double> &result);
+private:
+  std::string m_base_filename;
+  bool m_recording;
+  std::map<std::string, std::vector<double> > m_base;
+};
+
+std::string delta_base_filename(const File &file, const std::string &variable_name);
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* PISM_DELTAENCODER_H */
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -18,6 +18,7 @@
 
 #include <cassert>
 #include <cstdio>
+#include <map>
 #include <memory>
 using std::shared_ptr;
 
@@ -30,6 +31,11 @@ using std::shared_ptr;
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/Time.hh"
 #include "NC3File.hh"
+#include "NC3AsyncFile.hh"
+#include "MPIIOFile.hh"
+#include "Patches.hh"
+#include "DeltaEncoder.hh"
+#include "LocalInterpCtx.hh"
 
 #include "pism/pism_config.hh"
 
@@ -50,16 +56,89 @@ using std::shared_ptr;
 
 namespace pism {
 
+namespace {
+
+//! Metadata of a file opened for reading, filled as queries are answered.
+/*!
+ * Each query of a NetCDF file (existence of a variable, its dimensions, attributes, etc)
+ * involves a call to the I/O library (and, with NC3File, a broadcast from rank 0). Files
+ * opened for reading do not change, so we save answers and re-use them.
+ */
+struct Catalog {
+  Catalog()
+    : enabled(false), n_variables(-1), unlimited_dimension_known(false),
+      standard_names_known(false) {
+    // empty
+  }
+
+  //! true if the file was opened in read-only mode
+  bool enabled;
+
+  typedef std::pair<std::string, std::string> Key;
+
+  std::map<std::string, bool> variable_exists;
+  std::map<std::string, std::vector<std::string> > dimensions;
+  std::map<std::string, bool> dimension_exists;
+  std::map<std::string, unsigned int> dimension_length;
+  std::map<std::string, AxisType> dimension_type;
+  std::map<std::string, unsigned int> n_attributes;
+  std::map<Key, IO_Type> attribute_type;
+  std::map<Key, std::string> text_attribute;
+  std::map<Key, std::vector<double> > double_attribute;
+  std::map<unsigned int, std::string> variable_name;
+  int n_variables;
+
+  bool unlimited_dimension_known;
+  std::string unlimited_dimension;
+
+  //! standard_name -> names of variables with this standard name (in the order of
+  //! appearance in the file)
+  bool standard_names_known;
+  std::map<std::string, std::vector<std::string> > standard_names;
+};
+
+//! Use the cached value `cache[key]` if caching is enabled. Otherwise call `compute`.
+template<typename K, typename V, typename F>
+V cached(bool enabled, std::map<K, V> &cache, const K &key, F compute) {
+  if (not enabled) {
+    return compute();
+  }
+
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    return it->second;
+  }
+
+  V result = compute();
+  cache[key] = result;
+  return result;
+}
+
+} // end of anonymous namespace
+
 struct File::Impl {
   MPI_Comm com;
   IO_Backend backend;
   io::NCFile::Ptr nc;
+  std::shared_ptr<io::PatchWriter> patch_writer;
+  std::shared_ptr<io::DeltaEncoder> delta_encoder;
+  std::shared_ptr<io::PatchReader> patch_reader;
+  //! true if we checked if this file has patch files
+  bool patch_reader_checked;
+  std::shared_ptr<RegriddingCache> regridding_cache;
+  Catalog catalog;
 };
 
 IO_Backend string_to_backend(const std::string &backend) {
   if (backend == "netcdf3") {
     return PISM_NETCDF3;
   }
+  if (backend == "netcdf3_async") {
+    return PISM_NETCDF3_ASYNC;
+  }
+  if (backend == "mpiio") {
+    return PISM_MPIIO;
+  }
   if (backend == "netcdf4_parallel") {
     return PISM_NETCDF4_PARALLEL;
   }
@@ -82,8 +161,27 @@ IO_Backend string_to_backend(const std::string &backend) {
                                 "unknown or unsupported I/O backend: %s", backend.c_str());
 }
 
+static IO_Backend g_input_backend = PISM_GUESS;
+
+/*!
+ * Set the backend used to read files opened using PISM_GUESS (see `input.format`).
+ *
+ * PISM_MPIIO is used with non-NetCDF-4 files only. Use PISM_GUESS to choose the best
+ * available backend.
+ */
+void set_input_backend(IO_Backend backend) {
+  g_input_backend = backend;
+}
+
 // Chooses the best available I/O backend for reading from 'filename'.
-static IO_Backend choose_backend(MPI_Comm com, const std::string &filename) {
+static IO_Backend choose_backend(MPI_Comm com, const std::string &filename, IO_Mode mode) {
+
+  // the input backend (if set) is used for reading only
+  const IO_Backend input_backend = mode == PISM_READONLY ? g_input_backend : PISM_GUESS;
+
+  if (input_backend != PISM_GUESS and input_backend != PISM_MPIIO) {
+    return input_backend;
+  }
 
   std::string format;
   {
@@ -101,6 +199,9 @@ static IO_Backend choose_backend(MPI_Comm com, const std::string &filename) {
     return PISM_NETCDF4_PARALLEL;
 #endif
   } else {
+    if (input_backend == PISM_MPIIO) {
+      return PISM_MPIIO;
+    }
 #if (Pism_USE_PNETCDF==1)
     return PISM_PNETCDF;
 #endif
@@ -117,6 +218,12 @@ static io::NCFile::Ptr create_backend(MPI_Comm com, IO_Backend backend, int iosy
   if (backend == PISM_NETCDF3) {
     return io::NCFile::Ptr(new io::NC3File(com));
   }
+  if (backend == PISM_NETCDF3_ASYNC) {
+    return io::NCFile::Ptr(new io::NC3AsyncFile(com));
+  }
+  if (backend == PISM_MPIIO) {
+    return io::NCFile::Ptr(new io::MPIIOFile(com));
+  }
 #if (Pism_USE_PARALLEL_NETCDF4==1)
   if (backend == PISM_NETCDF4_PARALLEL) {
     return io::NCFile::Ptr(new io::NC4_Par(com));
@@ -155,13 +262,14 @@ File::File(MPI_Comm com, const std::string &filename, IO_Backend backend, IO_Mod
   }
 
   if (backend == PISM_GUESS) {
-    m_impl->backend = choose_backend(com, filename);
+    m_impl->backend = choose_backend(com, filename, mode);
   } else {
     m_impl->backend = backend;
   }
 
   m_impl->com = com;
   m_impl->nc  = create_backend(m_impl->com, m_impl->backend, iosysid);
+  m_impl->patch_reader_checked = false;
 
   this->open(filename, mode);
 }
@@ -189,12 +297,20 @@ IO_Backend File::backend() const {
 
 void File::open(const std::string &filename, IO_Mode mode) {
   try {
+    // make sure that writes to this file made using NC3AsyncFile are done
+    io::NC3AsyncFile::wait(filename);
+
+
+    // forget metadata of a previously opened file, if any
+    m_impl->catalog = Catalog();
 
     // opening for reading
     if (mode == PISM_READONLY) {
 
       m_impl->nc->open(filename, mode);
 
+      m_impl->catalog.enabled = true;
+
     } else if (mode == PISM_READWRITE_CLOBBER or mode == PISM_READWRITE_MOVE) {
 
       if (mode == PISM_READWRITE_MOVE) {
@@ -233,6 +349,15 @@ void File::remove_attribute(const std::string &variable_name, const std::string
 
 void File::close() {
   try {
+    if (m_impl->patch_writer) {
+      m_impl->patch_writer->close();
+      m_impl->patch_writer.reset();
+    }
+    m_impl->patch_reader.reset();
+    m_impl->patch_reader_checked = false;
+    m_impl->regridding_cache.reset();
+    m_impl->catalog = Catalog();
+
     m_impl->nc->close();
   } catch (RuntimeError &e) {
     e.add_context("closing \"" + filename() + "\"");
@@ -276,8 +401,16 @@ std::string File::filename() const {
 //! \brief Get the number of records. Uses the length of an unlimited dimension.
 unsigned int File::nrecords() const {
   try {
+    auto &catalog = m_impl->catalog;
+
     std::string dim;
-    m_impl->nc->inq_unlimdim(dim);
+    if (catalog.enabled and catalog.unlimited_dimension_known) {
+      dim = catalog.unlimited_dimension;
+    } else {
+      m_impl->nc->inq_unlimdim(dim);
+      catalog.unlimited_dimension       = dim;
+      catalog.unlimited_dimension_known = true;
+    }
 
     if (dim.empty()) {
       return 1;                 // one record
@@ -332,36 +465,44 @@ VariableLookupData File::find_variable(const std::string &short_name, const std:
     result.exists = false;
 
     if (not std_name.empty()) {
+      auto &catalog = m_impl->catalog;
 
-      int n_variables = nvariables();
+      if (not (catalog.enabled and catalog.standard_names_known)) {
+        catalog.standard_names.clear();
 
-      for (int j = 0; j < n_variables; ++j) {
-        std::string
-          name      = variable_name(j),
-          attribute = read_text_attribute(name, "standard_name");
+        int n_variables = nvariables();
 
-        if (attribute.empty()) {
-          continue;
-        }
+        for (int j = 0; j < n_variables; ++j) {
+          std::string
+            name      = variable_name(j),
+            attribute = read_text_attribute(name, "standard_name");
 
-        if (attribute == std_name) {
-          if (not result.exists) {
-            result.exists = true;
-            result.found_using_standard_name = true;
-            result.name = name;
-          } else {
-            throw RuntimeError::formatted(PISM_ERROR_LOCATION, "inconsistency in '%s': variables '%s' and '%s'\n"
-                                          "have the same standard_name (%s)",
-                                          filename().c_str(), result.name.c_str(),
-                                          name.c_str(), attribute.c_str());
+          if (not attribute.empty()) {
+            catalog.standard_names[attribute].push_back(name);
           }
         }
+        catalog.standard_names_known = true;
+      }
 
-      } // end of the for loop
+      auto names = catalog.standard_names.find(std_name);
+      if (names != catalog.standard_names.end()) {
+        auto &list = names->second;
+
+        if (list.size() > 1) {
+          throw RuntimeError::formatted(PISM_ERROR_LOCATION, "inconsistency in '%s': variables '%s' and '%s'\n"
+                                        "have the same standard_name (%s)",
+                                        filename().c_str(), list[0].c_str(),
+                                        list[1].c_str(), std_name.c_str());
+        }
+
+        result.exists = true;
+        result.found_using_standard_name = true;
+        result.name = list[0];
+      }
     } // end of if (not std_name.empty())
 
     if (not result.exists) {
-      m_impl->nc->inq_varid(short_name, result.exists);
+      result.exists = find_variable(short_name);
       if (result.exists) {
         result.name = short_name;
       } else {
@@ -382,9 +523,12 @@ VariableLookupData File::find_variable(const std::string &short_name, const std:
 //! \brief Checks if a variable exists.
 bool File::find_variable(const std::string &name) const {
   try {
-    bool exists = false;
-    m_impl->nc->inq_varid(name, exists);
-    return exists;
+    return cached(m_impl->catalog.enabled, m_impl->catalog.variable_exists, name,
+                  [&]() {
+                    bool exists = false;
+                    m_impl->nc->inq_varid(name, exists);
+                    return exists;
+                  });
   } catch (RuntimeError &e) {
     e.add_context("searching for variable '%s' in '%s'", name.c_str(), filename().c_str());
     throw;
@@ -393,9 +537,12 @@ bool File::find_variable(const std::string &name) const {
 
 std::vector<std::string> File::dimensions(const std::string &variable_name) const {
   try {
-    std::vector<std::string> result;
-    m_impl->nc->inq_vardimid(variable_name, result);
-    return result;
+    return cached(m_impl->catalog.enabled, m_impl->catalog.dimensions, variable_name,
+                  [&]() {
+                    std::vector<std::string> result;
+                    m_impl->nc->inq_vardimid(variable_name, result);
+                    return result;
+                  });
   } catch (RuntimeError &e) {
     e.add_context("getting dimensions of variable '%s' in '%s'", variable_name.c_str(),
                   filename().c_str());
@@ -407,9 +554,12 @@ std::vector<std::string> File::dimensions(const std::string &variable_name) cons
 //! \brief Checks if a dimension exists.
 bool File::find_dimension(const std::string &name) const {
   try {
-    bool exists = false;
-    m_impl->nc->inq_dimid(name, exists);
-    return exists;
+    return cached(m_impl->catalog.enabled, m_impl->catalog.dimension_exists, name,
+                  [&]() {
+                    bool exists = false;
+                    m_impl->nc->inq_dimid(name, exists);
+                    return exists;
+                  });
   } catch (RuntimeError &e) {
     e.add_context("searching for dimension '%s' in '%s'", name.c_str(), filename().c_str());
     throw;
@@ -423,9 +573,12 @@ bool File::find_dimension(const std::string &name) const {
 unsigned int File::dimension_length(const std::string &name) const {
   try {
     if (find_dimension(name)) {
-      unsigned int result = 0;
-      m_impl->nc->inq_dimlen(name, result);
-      return result;
+      return cached(m_impl->catalog.enabled, m_impl->catalog.dimension_length, name,
+                    [&]() {
+                      unsigned int result = 0;
+                      m_impl->nc->inq_dimlen(name, result);
+                      return result;
+                    });
     } else {
       return 0;
     }
@@ -441,6 +594,12 @@ unsigned int File::dimension_length(const std::string &name) const {
  */
 AxisType File::dimension_type(const std::string &name,
                               units::System::Ptr unit_system) const {
+  return cached(m_impl->catalog.enabled, m_impl->catalog.dimension_type, name,
+                [&]() { return this->compute_dimension_type(name, unit_system); });
+}
+
+AxisType File::compute_dimension_type(const std::string &name,
+                                      units::System::Ptr unit_system) const {
   try {
     if (not find_variable(name)) {
       throw RuntimeError(PISM_ERROR_LOCATION, "coordinate variable " + name + " is missing");
@@ -542,6 +701,57 @@ void File::define_variable(const std::string &name, IO_Type nctype, const std::v
   }
 }
 
+//! Set chunk sizes of a variable (ignored by backends that do not support chunking).
+void File::define_variable_chunking(const std::string &name,
+                                    const std::vector<size_t> &chunk_sizes) const {
+  try {
+    std::vector<size_t> tmp = chunk_sizes;
+    m_impl->nc->def_var_chunking(name, tmp);
+  } catch (RuntimeError &e) {
+    e.add_context("setting chunk sizes of '%s' in '%s'", name.c_str(), filename().c_str());
+    throw;
+  }
+}
+
+//! Compress a variable (ignored by backends that do not support compression).
+/*!
+ * `codec` is one of "none", "deflate", "zstd".
+ */
+void File::define_variable_compression(const std::string &name, const std::string &codec,
+                                       int level, bool shuffle) const {
+  try {
+    if (codec == "none") {
+      return;
+    }
+
+    if (codec == "deflate") {
+      m_impl->nc->def_var_deflate(name, shuffle ? 1 : 0, 1, level);
+    } else if (codec == "zstd") {
+      if (shuffle) {
+        // enable the shuffle filter without deflate compression
+        m_impl->nc->def_var_deflate(name, 1, 0, 0);
+      }
+      m_impl->nc->def_var_zstandard(name, level);
+    } else {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION, "unknown compression codec: '%s'",
+                                    codec.c_str());
+    }
+  } catch (RuntimeError &e) {
+    e.add_context("setting compression of '%s' in '%s'", name.c_str(), filename().c_str());
+    throw;
+  }
+}
+
+//! Use lossy quantization for a variable (ignored by backends that do not support it).
+void File::define_variable_quantization(const std::string &name, int significant_digits) const {
+  try {
+    m_impl->nc->def_var_quantize(name, significant_digits);
+  } catch (RuntimeError &e) {
+    e.add_context("setting quantization of '%s' in '%s'", name.c_str(), filename().c_str());
+    throw;
+  }
+}
+
 //! \brief Get dimension data (a coordinate variable).
 std::vector<double>  File::read_dimension(const std::string &name) const {
   try {
@@ -621,9 +831,13 @@ std::vector<double> File::read_double_attribute(const std::string &var_name, con
     } else {
       // In this case att_type might be PISM_NAT (if an attribute does not
       // exist), but read_double_attribute can handle that.
-      std::vector<double> result;
-      m_impl->nc->get_att_double(var_name, att_name, result);
-      return result;
+      return cached(m_impl->catalog.enabled, m_impl->catalog.double_attribute,
+                    Catalog::Key(var_name, att_name),
+                    [&]() {
+                      std::vector<double> result;
+                      m_impl->nc->get_att_double(var_name, att_name, result);
+                      return result;
+                    });
     }
   } catch (RuntimeError &e) {
     e.add_context("reading double attribute '%s:%s' from '%s'",
@@ -642,9 +856,13 @@ std::string File::read_text_attribute(const std::string &var_name, const std::st
                                     "attribute %s is not a string", att_name.c_str());
     }
 
-    std::string result;
-    m_impl->nc->get_att_text(var_name, att_name, result);
-    return result;
+    return cached(m_impl->catalog.enabled, m_impl->catalog.text_attribute,
+                  Catalog::Key(var_name, att_name),
+                  [&]() {
+                    std::string result;
+                    m_impl->nc->get_att_text(var_name, att_name, result);
+                    return result;
+                  });
   } catch (RuntimeError &e) {
     e.add_context("reading text attribute '%s:%s' from %s", var_name.c_str(), att_name.c_str(), filename().c_str());
     throw;
@@ -653,9 +871,12 @@ std::string File::read_text_attribute(const std::string &var_name, const std::st
 
 unsigned int File::nattributes(const std::string &var_name) const {
   try {
-    int result = 0;
-    m_impl->nc->inq_varnatts(var_name, result);
-    return result;
+    return cached(m_impl->catalog.enabled, m_impl->catalog.n_attributes, var_name,
+                  [&]() {
+                    int result = 0;
+                    m_impl->nc->inq_varnatts(var_name, result);
+                    return (unsigned int)result;
+                  });
   } catch (RuntimeError &e) {
     e.add_context("getting the number of attributes of variable '%s' in '%s'", var_name.c_str(), filename().c_str());
     throw;
@@ -677,9 +898,13 @@ std::string File::attribute_name(const std::string &var_name, unsigned int n) co
 
 IO_Type File::attribute_type(const std::string &var_name, const std::string &att_name) const {
   try {
-    IO_Type result;
-    m_impl->nc->inq_atttype(var_name, att_name, result);
-    return result;
+    return cached(m_impl->catalog.enabled, m_impl->catalog.attribute_type,
+                  Catalog::Key(var_name, att_name),
+                  [&]() {
+                    IO_Type result;
+                    m_impl->nc->inq_atttype(var_name, att_name, result);
+                    return result;
+                  });
   } catch (RuntimeError &e) {
     e.add_context("getting the type of an attribute of variable '%s' in '%s'", var_name.c_str(), filename().c_str());
     throw;
@@ -699,6 +924,39 @@ void File::read_variable(const std::string &variable_name,
   }
 }
 
+/*!
+ * Start reading a variable. Values in `ip` are available after the following call of
+ * wait_all().
+ *
+ * I/O backends that do not support non-blocking reads read immediately.
+ */
+void File::read_variable_nonblocking(const std::string &variable_name,
+                                     const std::vector<unsigned int> &start,
+                                     const std::vector<unsigned int> &count,
+                                     double *ip) const {
+  try {
+    m_impl->nc->iget_vara_double(variable_name, start, count, ip);
+  } catch (RuntimeError &e) {
+    e.add_context("reading variable '%s' from '%s'", variable_name.c_str(), filename().c_str());
+    throw;
+  }
+}
+
+/*!
+ * Complete all reads started using read_variable_nonblocking() and all pending writes.
+ *
+ * I/O backends that support non-blocking writes (PnetCDF) may delay writes until this
+ * call, sync() or close().
+ */
+void File::wait_all() const {
+  try {
+    m_impl->nc->wait_all();
+  } catch (RuntimeError &e) {
+    e.add_context("completing pending reads and writes (file '%s')", filename().c_str());
+    throw;
+  }
+}
+
 
 void File::write_variable(const std::string &variable_name,
                           const std::vector<unsigned int> &start,
@@ -730,6 +988,57 @@ void File::write_distributed_array(const std::string &variable_name,
 }
 
 
+//! Write patches of spatial variables written to this file using `writer`.
+void File::set_patch_writer(std::shared_ptr<io::PatchWriter> writer) {
+  m_impl->patch_writer = writer;
+}
+
+//! Returns the patch writer (NULL if patch files are not written).
+io::PatchWriter* File::patch_writer() const {
+  return m_impl->patch_writer.get();
+}
+
+//! Write spatial variables as differences from a base file using `encoder`.
+void File::set_delta_encoder(std::shared_ptr<io::DeltaEncoder> encoder) {
+  m_impl->delta_encoder = encoder;
+}
+
+//! Returns the delta encoder (NULL if variables are written as is).
+io::DeltaEncoder* File::delta_encoder() const {
+  return m_impl->delta_encoder.get();
+}
+
+//! Returns the patch reader (NULL if this file does not have valid patch files).
+/*!
+ * Collective: the first call checks if this file has patch files that can be used by all
+ * processes.
+ */
+const io::PatchReader* File::patch_reader() const {
+  try {
+    if (not m_impl->patch_reader_checked) {
+      m_impl->patch_reader_checked = true;
+
+      auto id = read_text_attribute("PISM_GLOBAL", "pism_patch_id");
+      if (not id.empty()) {
+        m_impl->patch_reader = io::PatchReader::open(m_impl->com, filename(), id);
+      }
+    }
+  } catch (RuntimeError &e) {
+    e.add_context("opening patch files of '%s'", filename().c_str());
+    throw;
+  }
+
+  return m_impl->patch_reader.get();
+}
+
+//! Returns the cache of interpolation contexts used to regrid variables from this file.
+RegriddingCache& File::regridding_cache() const {
+  if (not m_impl->regridding_cache) {
+    m_impl->regridding_cache.reset(new RegriddingCache());
+  }
+  return *m_impl->regridding_cache;
+}
+
 void File::read_variable_transposed(const std::string &variable_name,
                                     const std::vector<unsigned int> &start,
                                     const std::vector<unsigned int> &count,
@@ -743,10 +1052,17 @@ void File::read_variable_transposed(const std::string &variable_name,
 }
 
 unsigned int File::nvariables() const {
+  auto &catalog = m_impl->catalog;
+
+  if (catalog.enabled and catalog.n_variables >= 0) {
+    return catalog.n_variables;
+  }
+
   int n_vars = 0;
 
   try {
     m_impl->nc->inq_nvars(n_vars);
+    catalog.n_variables = n_vars;
   } catch (RuntimeError &e) {
     e.add_context("getting the number of variables in '%s'", filename().c_str());
     throw;
@@ -758,7 +1074,12 @@ unsigned int File::nvariables() const {
 std::string File::variable_name(unsigned int id) const {
   std::string result;
   try {
-    m_impl->nc->inq_varname(id, result);
+    result = cached(m_impl->catalog.enabled, m_impl->catalog.variable_name, id,
+                    [&]() {
+                      std::string name;
+                      m_impl->nc->inq_varname(id, name);
+                      return name;
+                    });
   } catch (RuntimeError &e) {
     e.add_context("getting the name of %d-th variable in '%s'", id, filename().c_str());
     throw;
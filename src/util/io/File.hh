@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include <mpi.h>
 
 #include "pism/util/Units.hh"
@@ -31,12 +32,21 @@ namespace pism {
 enum AxisType {X_AXIS, Y_AXIS, Z_AXIS, T_AXIS, UNKNOWN_AXIS};
 
 class IceGrid;
+class RegriddingCache;
+
+namespace io {
+class PatchWriter;
+class PatchReader;
+class DeltaEncoder;
+}
 
 /*!
  * Convert a string to PISM's backend type.
  */
 IO_Backend string_to_backend(const std::string &backend);
 
+void set_input_backend(IO_Backend backend);
+
 struct VariableLookupData {
   bool exists;
   bool found_using_standard_name;
@@ -99,6 +109,14 @@ public:
   void define_variable(const std::string &name, IO_Type nctype,
                        const std::vector<std::string> &dims) const;
 
+  void define_variable_chunking(const std::string &name,
+                                const std::vector<size_t> &chunk_sizes) const;
+
+  void define_variable_compression(const std::string &name, const std::string &codec,
+                                   int level, bool shuffle) const;
+
+  void define_variable_quantization(const std::string &name, int significant_digits) const;
+
   VariableLookupData find_variable(const std::string &short_name, const std::string &std_name) const;
 
   bool find_variable(const std::string &short_name) const;
@@ -108,6 +126,13 @@ public:
                        const std::vector<unsigned int> &count,
                        double *ip) const;
 
+  void read_variable_nonblocking(const std::string &variable_name,
+                                 const std::vector<unsigned int> &start,
+                                 const std::vector<unsigned int> &count,
+                                 double *ip) const;
+
+  void wait_all() const;
+
   void read_variable_transposed(const std::string &variable_name,
                                 const std::vector<unsigned int> &start,
                                 const std::vector<unsigned int> &count,
@@ -123,6 +148,22 @@ public:
                                unsigned int z_count,
                                const double *input) const;
 
+  // patch files (see io::patch_filename())
+
+  void set_patch_writer(std::shared_ptr<io::PatchWriter> writer);
+
+  io::PatchWriter* patch_writer() const;
+
+  const io::PatchReader* patch_reader() const;
+
+  // differences from a base file (see io::DeltaEncoder)
+
+  void set_delta_encoder(std::shared_ptr<io::DeltaEncoder> encoder);
+
+  io::DeltaEncoder* delta_encoder() const;
+
+  RegriddingCache& regridding_cache() const;
+
   // attributes
 
   void remove_attribute(const std::string &variable_name, const std::string &att_name) const;
@@ -149,6 +190,9 @@ private:
 
   void open(const std::string &filename, IO_Mode mode);
 
+  AxisType compute_dimension_type(const std::string &name,
+                                  units::System::Ptr unit_system) const;
+
   // disable copying and assignments
   File(const File &other);
   File & operator=(const File &);
@@ -140,4 +140,46 @@ LocalInterpCtx::LocalInterpCtx(const grid_info &input, const IceGrid &grid,
   }
 }
 
+std::string RegriddingCache::key(const File &file, const std::string &variable_name,
+                                  GridRegistration registration) const {
+  return join(file.dimensions(variable_name), ",") + ";" + registration_to_string(registration);
+}
+
+//! Get input grid information for `variable_name` (computed once per list of dimensions).
+const grid_info& RegriddingCache::input_grid(const File &file,
+                                             const std::string &variable_name,
+                                             units::System::Ptr unit_system,
+                                             GridRegistration registration) {
+  auto k = key(file, variable_name, registration);
+
+  auto &result = m_grids[k];
+  if (not result) {
+    result.reset(new grid_info(file, variable_name, unit_system, registration));
+  }
+
+  return *result;
+}
+
+//! Get the interpolation context used to regrid `variable_name` to `grid` and `z_output`.
+LocalInterpCtx& RegriddingCache::context(const File &file,
+                                         const std::string &variable_name,
+                                         const IceGrid &grid,
+                                         const std::vector<double> &z_output,
+                                         InterpolationType type) {
+  std::string k = pism::printf("%s;%p;%d", key(file, variable_name, grid.registration()).c_str(),
+                               (const void*)&grid, (int)type);
+  for (auto z : z_output) {
+    k += pism::printf(";%.17g", z);
+  }
+
+  auto &result = m_contexts[k];
+  if (not result) {
+    const grid_info &input = input_grid(file, variable_name, grid.ctx()->unit_system(),
+                                        grid.registration());
+    result.reset(new LocalInterpCtx(input, grid, z_output, type));
+  }
+
+  return *result;
+}
+
 } // end of namespace pism
@@ -21,14 +21,18 @@
 
 #include <vector>
 #include <memory>
+#include <map>
+#include <string>
 
 #include "pism/util/interpolation.hh"
 #include "pism/util/io/IO_Flags.hh"
+#include "pism/util/IceGrid.hh"     // GridRegistration
 
 namespace pism {
 
 class IceGrid;
 class grid_info;
+class File;
 
 //! The "local interpolation context" describes the processor's part of the source NetCDF file (for regridding).
 /*!
@@ -59,6 +63,29 @@ public:
   std::vector<double> buffer;
 };
 
+//! Input grid information and interpolation contexts used to regrid variables from a file.
+/*!
+ * Variables in a file usually share dimensions, so grid_info and LocalInterpCtx instances
+ * are computed once per list of dimensions (and target grid, vertical levels, interpolation
+ * type) and re-used for all the variables read from the same File.
+ */
+class RegriddingCache {
+public:
+  const grid_info& input_grid(const File &file, const std::string &variable_name,
+                              units::System::Ptr unit_system,
+                              GridRegistration registration);
+
+  LocalInterpCtx& context(const File &file, const std::string &variable_name,
+                          const IceGrid &grid, const std::vector<double> &z_output,
+                          InterpolationType type);
+private:
+  std::string key(const File &file, const std::string &variable_name,
+                  GridRegistration registration) const;
+
+  std::map<std::string, std::shared_ptr<grid_info> > m_grids;
+  std::map<std::string, std::shared_ptr<LocalInterpCtx> > m_contexts;
+};
+
 } // end of namespace pism
 
 #endif // __lic_hh
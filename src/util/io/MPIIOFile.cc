@@ -0,0 +1,828 @@
+/* Copyright (C) 2020 PISM Authors
+ *
+ * This file is part of PISM.
+ *
+ * PISM is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PISM; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstring>              // memcpy
+#include <climits>              // INT_MAX
+#include <algorithm>            // std::min
+
+#include "MPIIOFile.hh"
+
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+namespace {
+
+// Tags and external data types of the classic NetCDF format (see "NetCDF Classic and
+// 64-bit Offset Format" in the NetCDF User's Guide and the CDF-5 format specification).
+enum Tag {ABSENT = 0, NC_DIMENSION = 10, NC_VARIABLE = 11, NC_ATTRIBUTE = 12};
+
+enum ExternalType {NC_BYTE = 1, NC_CHAR, NC_SHORT, NC_INT, NC_FLOAT, NC_DOUBLE,
+                   NC_UBYTE, NC_USHORT, NC_UINT, NC_INT64, NC_UINT64};
+
+struct Attribute {
+  std::string name;
+  int type;
+  std::string text;
+  std::vector<double> values;
+};
+
+struct Dimension {
+  std::string name;
+  uint64_t length;
+};
+
+struct Variable {
+  std::string name;
+  std::vector<uint64_t> dimids;
+  std::vector<Attribute> attributes;
+  int type;
+  uint64_t begin;
+};
+
+size_t type_size(int type) {
+  switch (type) {
+  case NC_BYTE:
+  case NC_CHAR:
+  case NC_UBYTE:
+    return 1;
+  case NC_SHORT:
+  case NC_USHORT:
+    return 2;
+  case NC_INT:
+  case NC_UINT:
+  case NC_FLOAT:
+    return 4;
+  case NC_DOUBLE:
+  case NC_INT64:
+  case NC_UINT64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+//! Convert a big-endian value of the type `type` stored at `p`.
+double decode(const unsigned char *p, int type) {
+  uint64_t bits = 0;
+  for (size_t k = 0; k < type_size(type); ++k) {
+    bits = (bits << 8) | p[k];
+  }
+
+  switch (type) {
+  case NC_BYTE:
+    return static_cast<int8_t>(bits);
+  case NC_CHAR:
+  case NC_UBYTE:
+    return static_cast<uint8_t>(bits);
+  case NC_SHORT:
+    return static_cast<int16_t>(bits);
+  case NC_USHORT:
+    return static_cast<uint16_t>(bits);
+  case NC_INT:
+    return static_cast<int32_t>(bits);
+  case NC_UINT:
+    return static_cast<uint32_t>(bits);
+  case NC_FLOAT:
+    {
+      uint32_t tmp = bits;
+      float result;
+      memcpy(&result, &tmp, sizeof(float));
+      return result;
+    }
+  case NC_DOUBLE:
+    {
+      double result;
+      memcpy(&result, &bits, sizeof(double));
+      return result;
+    }
+  case NC_INT64:
+    return static_cast<int64_t>(bits);
+  case NC_UINT64:
+  default:
+    return static_cast<double>(bits);
+  }
+}
+
+//! Reads header entries from a buffer, keeping track of whether the buffer was long enough.
+class Parser {
+public:
+  Parser(const std::vector<unsigned char> &buffer, int version)
+    : m_buffer(buffer), m_position(0), m_complete(true), m_version(version) {
+    // empty
+  }
+
+  //! Returns a pointer to the next `n` bytes (NULL if the buffer is too short) and skips
+  //! them (with padding to a 4-byte boundary if `padded` is true).
+  const unsigned char* bytes(uint64_t n, bool padded = false) {
+    uint64_t length = padded ? ((n + 3) / 4) * 4 : n;
+
+    if (not m_complete or m_position + length > m_buffer.size()) {
+      m_complete = false;
+      return nullptr;
+    }
+
+    const unsigned char *result = m_buffer.data() + m_position;
+    m_position += length;
+    return result;
+  }
+
+  uint64_t integer(size_t size) {
+    const unsigned char *p = bytes(size);
+    if (p == nullptr) {
+      return 0;
+    }
+
+    uint64_t result = 0;
+    for (size_t k = 0; k < size; ++k) {
+      result = (result << 8) | p[k];
+    }
+    return result;
+  }
+
+  //! 32-bit integers (64-bit in CDF-5) used for lengths and counts
+  uint64_t non_neg() {
+    return integer(m_version == 5 ? 8 : 4);
+  }
+
+  //! 32-bit offset in the classic format, 64-bit otherwise
+  uint64_t offset() {
+    return integer(m_version == 1 ? 4 : 8);
+  }
+
+  std::string name() {
+    uint64_t length = non_neg();
+    const unsigned char *p = bytes(length, true);
+    return p != nullptr ? std::string(reinterpret_cast<const char*>(p), length) : "";
+  }
+
+  //! Read a list tag and the number of elements. Returns false if the list is invalid.
+  bool list(int tag, uint64_t &n_elements) {
+    int t      = integer(4);
+    n_elements = non_neg();
+
+    return (t == tag or (t == ABSENT and n_elements == 0));
+  }
+
+  std::vector<Attribute> attributes(bool &valid) {
+    uint64_t n = 0;
+    valid = list(NC_ATTRIBUTE, n);
+
+    std::vector<Attribute> result;
+    for (uint64_t k = 0; k < n and valid and m_complete; ++k) {
+      Attribute a;
+      a.name = name();
+      a.type = integer(4);
+
+      uint64_t length = non_neg();
+      size_t size = type_size(a.type);
+      if (m_complete and size == 0) {
+        valid = false;
+        break;
+      }
+
+      const unsigned char *p = bytes(length * size, true);
+      if (p == nullptr) {
+        break;
+      }
+
+      if (a.type == NC_CHAR) {
+        a.text = std::string(reinterpret_cast<const char*>(p), length);
+        // text attributes may be zero-padded
+        a.text = a.text.c_str();
+      } else {
+        for (uint64_t j = 0; j < length; ++j) {
+          a.values.push_back(decode(p + j * size, a.type));
+        }
+      }
+
+      result.push_back(a);
+    }
+    return result;
+  }
+
+  bool complete() const {
+    return m_complete;
+  }
+private:
+  const std::vector<unsigned char> &m_buffer;
+  uint64_t m_position;
+  bool m_complete;
+  int m_version;
+};
+
+enum ParsingResult {COMPLETE, INCOMPLETE, INVALID};
+
+} // end of anonymous namespace
+
+struct MPIIOFile::Header {
+  int version;
+  uint64_t n_records;
+  //! index of the unlimited dimension or -1
+  int unlimited;
+  //! size of one record, in bytes
+  uint64_t record_size;
+  std::vector<Dimension> dimensions;
+  std::vector<Attribute> attributes;
+  std::vector<Variable> variables;
+
+  //! Returns a variable index or -1 if not found.
+  int variable(const std::string &name) const {
+    for (unsigned int k = 0; k < variables.size(); ++k) {
+      if (variables[k].name == name) {
+        return k;
+      }
+    }
+    return -1;
+  }
+
+  //! Returns the length of the dimension `index`.
+  uint64_t length(uint64_t index) const {
+    return (int)index == unlimited ? n_records : dimensions[index].length;
+  }
+
+  bool is_record_variable(const Variable &v) const {
+    return not v.dimids.empty() and (int)v.dimids[0] == unlimited;
+  }
+
+  //! Size of a variable (of one record of a record variable), in bytes.
+  uint64_t size(const Variable &v) const {
+    uint64_t result = type_size(v.type);
+    for (unsigned int k = is_record_variable(v) ? 1 : 0; k < v.dimids.size(); ++k) {
+      result *= dimensions[v.dimids[k]].length;
+    }
+    return result;
+  }
+};
+
+static ParsingResult parse(const std::vector<unsigned char> &buffer, uint64_t file_size,
+                           MPIIOFile::Header &header) {
+  if (buffer.size() < 4) {
+    return buffer.size() < file_size ? INCOMPLETE : INVALID;
+  }
+
+  if (buffer[0] != 'C' or buffer[1] != 'D' or buffer[2] != 'F' or
+      not (buffer[3] == 1 or buffer[3] == 2 or buffer[3] == 5)) {
+    return INVALID;
+  }
+
+  header = MPIIOFile::Header();
+  header.version = buffer[3];
+
+  Parser p(buffer, header.version);
+  p.bytes(4);
+
+  header.n_records = p.non_neg();
+  const uint64_t streaming = header.version == 5 ? ~uint64_t(0) : 0xFFFFFFFF;
+
+  bool valid = true;
+
+  // dimensions
+  uint64_t n = 0;
+  valid = p.list(NC_DIMENSION, n);
+  header.unlimited = -1;
+  for (uint64_t k = 0; k < n and valid and p.complete(); ++k) {
+    Dimension d;
+    d.name   = p.name();
+    d.length = p.non_neg();
+
+    if (d.length == 0) {
+      header.unlimited = k;
+    }
+    header.dimensions.push_back(d);
+  }
+
+  // global attributes
+  if (valid) {
+    header.attributes = p.attributes(valid);
+  }
+
+  // variables
+  if (valid) {
+    valid = p.list(NC_VARIABLE, n);
+  }
+  for (uint64_t k = 0; k < n and valid and p.complete(); ++k) {
+    Variable v;
+    v.name = p.name();
+
+    uint64_t n_dims = p.non_neg();
+    for (uint64_t j = 0; j < n_dims and p.complete(); ++j) {
+      uint64_t id = p.non_neg();
+      if (p.complete() and id >= header.dimensions.size()) {
+        valid = false;
+      }
+      v.dimids.push_back(id);
+    }
+
+    if (valid) {
+      v.attributes = p.attributes(valid);
+    }
+    v.type = p.integer(4);
+    p.non_neg();                // vsize; may be wrong for large variables
+    v.begin = p.offset();
+
+    if (p.complete() and type_size(v.type) == 0) {
+      valid = false;
+    }
+    header.variables.push_back(v);
+  }
+
+  if (not valid) {
+    return INVALID;
+  }
+
+  if (not p.complete()) {
+    return buffer.size() < file_size ? INCOMPLETE : INVALID;
+  }
+
+  // compute the record size (records are padded to a 4-byte boundary unless there is
+  // exactly one record variable)
+  std::vector<const Variable*> record_variables;
+  for (const auto &v : header.variables) {
+    if (header.is_record_variable(v)) {
+      record_variables.push_back(&v);
+    }
+  }
+
+  header.record_size = 0;
+  for (const auto *v : record_variables) {
+    uint64_t size = header.size(*v);
+    header.record_size += record_variables.size() == 1 ? size : ((size + 3) / 4) * 4;
+  }
+
+  if (header.n_records == streaming) {
+    // the number of records was not written; compute it using the file size
+    header.n_records = 0;
+    if (not record_variables.empty() and header.record_size > 0) {
+      uint64_t begin = record_variables[0]->begin;
+      for (const auto *v : record_variables) {
+        begin = std::min(begin, v->begin);
+      }
+      header.n_records = file_size > begin ? (file_size - begin) / header.record_size : 0;
+    }
+  }
+
+  return COMPLETE;
+}
+
+static void check(const ErrorLocation &where, int return_code) {
+  if (return_code != MPI_SUCCESS) {
+    char message[MPI_MAX_ERROR_STRING];
+    int length = 0;
+    MPI_Error_string(return_code, message, &length);
+    throw RuntimeError(where, std::string(message, length));
+  }
+}
+
+MPIIOFile::MPIIOFile(MPI_Comm com)
+  : NCFile(com), m_file(MPI_FILE_NULL) {
+  // MPI-IO does not use the NetCDF library
+  m_use_lock = false;
+}
+
+MPIIOFile::~MPIIOFile() {
+  if (m_file != MPI_FILE_NULL) {
+    MPI_File_close(&m_file);
+  }
+}
+
+void MPIIOFile::read_only() const {
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "cannot modify '%s': the MPI-IO backend is read-only",
+                                m_filename.c_str());
+}
+
+void MPIIOFile::open_impl(const std::string &filename, IO_Mode mode) {
+  if (mode != PISM_READONLY) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "cannot open '%s' for writing: the MPI-IO backend is read-only",
+                                  filename.c_str());
+  }
+
+  int stat = MPI_File_open(m_com, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &m_file);
+  check(PISM_ERROR_LOCATION, stat);
+
+  MPI_Offset file_size = 0;
+  stat = MPI_File_get_size(m_file, &file_size);
+  check(PISM_ERROR_LOCATION, stat);
+
+  int rank = 0;
+  MPI_Comm_rank(m_com, &rank);
+
+  // rank 0 reads the header, increasing the buffer size until it is large enough
+  std::vector<unsigned char> buffer;
+  int length = 0;
+  m_header = std::make_shared<Header>();
+  if (rank == 0) {
+    MPI_Offset size = std::min(file_size, (MPI_Offset)8192);
+    ParsingResult result = INCOMPLETE;
+    while (result == INCOMPLETE and size <= INT_MAX) {
+      buffer.resize(size);
+
+      MPI_Status status;
+      stat = MPI_File_read_at(m_file, 0, buffer.data(), size, MPI_BYTE, &status);
+      if (stat != MPI_SUCCESS) {
+        break;
+      }
+
+      result = parse(buffer, file_size, *m_header);
+      size = std::min(2 * size, file_size);
+    }
+    length = result == COMPLETE ? buffer.size() : -1;
+  }
+
+  MPI_Bcast(&length, 1, MPI_INT, 0, m_com);
+
+  if (length < 0) {
+    MPI_File_close(&m_file);
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "'%s' is not a NetCDF file in the classic, 64-bit offset"
+                                  " or CDF-5 format",
+                                  filename.c_str());
+  }
+
+  buffer.resize(length);
+  MPI_Bcast(buffer.data(), length, MPI_BYTE, 0, m_com);
+
+  if (rank != 0) {
+    parse(buffer, file_size, *m_header);
+  }
+}
+
+void MPIIOFile::create_impl(const std::string &filename) {
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "cannot create '%s': the MPI-IO backend is read-only",
+                                filename.c_str());
+}
+
+void MPIIOFile::sync_impl() const {
+  // empty (files are not modified)
+}
+
+void MPIIOFile::close_impl() {
+  int stat = MPI_File_close(&m_file);
+  check(PISM_ERROR_LOCATION, stat);
+
+  m_file = MPI_FILE_NULL;
+  m_header.reset();
+}
+
+void MPIIOFile::enddef_impl() const {
+  // empty
+}
+
+void MPIIOFile::redef_impl() const {
+  // empty
+}
+
+void MPIIOFile::def_dim_impl(const std::string &name, size_t length) const {
+  (void) name;
+  (void) length;
+  read_only();
+}
+
+void MPIIOFile::inq_dimid_impl(const std::string &dimension_name, bool &exists) const {
+  exists = false;
+  for (const auto &d : m_header->dimensions) {
+    if (d.name == dimension_name) {
+      exists = true;
+      return;
+    }
+  }
+}
+
+void MPIIOFile::inq_dimlen_impl(const std::string &dimension_name, unsigned int &result) const {
+  for (unsigned int k = 0; k < m_header->dimensions.size(); ++k) {
+    if (m_header->dimensions[k].name == dimension_name) {
+      result = m_header->length(k);
+      return;
+    }
+  }
+
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION, "dimension '%s' not found in '%s'",
+                                dimension_name.c_str(), m_filename.c_str());
+}
+
+void MPIIOFile::inq_unlimdim_impl(std::string &result) const {
+  int k = m_header->unlimited;
+  result = k >= 0 ? m_header->dimensions[k].name : "";
+}
+
+void MPIIOFile::def_var_impl(const std::string &name, IO_Type nctype,
+                             const std::vector<std::string> &dims) const {
+  (void) name;
+  (void) nctype;
+  (void) dims;
+  read_only();
+}
+
+void MPIIOFile::get_vara_double_impl(const std::string &variable_name,
+                                     const std::vector<unsigned int> &start,
+                                     const std::vector<unsigned int> &count,
+                                     double *ip) const {
+  std::vector<unsigned int> imap;
+  get_var_double(variable_name, start, count, imap, ip);
+}
+
+void MPIIOFile::get_varm_double_impl(const std::string &variable_name,
+                                     const std::vector<unsigned int> &start,
+                                     const std::vector<unsigned int> &count,
+                                     const std::vector<unsigned int> &imap,
+                                     double *ip) const {
+  get_var_double(variable_name, start, count, imap, ip);
+}
+
+/*!
+ * Read a hyperslab of a variable, storing the element with the index `idx` (relative to
+ * `start`) in `ip[sum(idx[k] * imap[k])]`. Uses the C order if `imap` is empty.
+ *
+ * Each process reads its hyperslab using collective MPI-IO calls (one per record of a
+ * record variable), so all processes have to call this method.
+ */
+void MPIIOFile::get_var_double(const std::string &variable_name,
+                               const std::vector<unsigned int> &start,
+                               const std::vector<unsigned int> &count,
+                               const std::vector<unsigned int> &imap,
+                               double *ip) const {
+  int index = m_header->variable(variable_name);
+  if (index < 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "variable '%s' not found in '%s'",
+                                  variable_name.c_str(), m_filename.c_str());
+  }
+
+  const Variable &var = m_header->variables[index];
+  const size_t n_dims = var.dimids.size();
+
+  if (start.size() != n_dims or count.size() != n_dims or
+      (not imap.empty() and imap.size() != n_dims)) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "invalid start, count or imap when reading '%s'",
+                                  variable_name.c_str());
+  }
+
+  uint64_t n_values = 1;
+  for (size_t k = 0; k < n_dims; ++k) {
+    if ((uint64_t)start[k] + count[k] > m_header->length(var.dimids[k])) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "index exceeds dimension bound when reading '%s'",
+                                    variable_name.c_str());
+    }
+    n_values *= count[k];
+  }
+
+  const bool record = m_header->is_record_variable(var);
+  const size_t first = record ? 1 : 0;
+  const int size = type_size(var.type);
+
+  // hyperslab of one record (or of the whole variable)
+  std::vector<int> sizes, sub_sizes, starts;
+  uint64_t slab_size = size;
+  for (size_t k = first; k < n_dims; ++k) {
+    uint64_t length = m_header->length(var.dimids[k]);
+    if (length > INT_MAX) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "'%s' is too large for the MPI-IO backend",
+                                    variable_name.c_str());
+    }
+    sizes.push_back(length);
+    sub_sizes.push_back(count[k]);
+    starts.push_back(start[k]);
+    slab_size *= count[k];
+  }
+
+  if (slab_size > INT_MAX) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "hyperslab of '%s' is too large for the MPI-IO backend",
+                                  variable_name.c_str());
+  }
+
+  // all processes have to make the same number of collective calls
+  unsigned int
+    local_records = n_values > 0 ? (record ? count[0] : 1) : 0,
+    n_records     = 0;
+  MPI_Allreduce(&local_records, &n_records, 1, MPI_UNSIGNED, MPI_MAX, m_com);
+
+  MPI_Datatype element, filetype = MPI_DATATYPE_NULL;
+  MPI_Type_contiguous(size, MPI_BYTE, &element);
+  if (local_records > 0) {
+    if (sizes.empty()) {
+      MPI_Type_dup(element, &filetype);
+    } else {
+      MPI_Type_create_subarray(sizes.size(), sizes.data(), sub_sizes.data(), starts.data(),
+                               MPI_ORDER_C, element, &filetype);
+    }
+    MPI_Type_commit(&filetype);
+  }
+
+  std::vector<unsigned char> buffer(n_values * size);
+  int stat = MPI_SUCCESS;
+  for (unsigned int r = 0; r < n_records and stat == MPI_SUCCESS; ++r) {
+    MPI_Status status;
+    if (r < local_records) {
+      MPI_Offset offset = var.begin;
+      if (record) {
+        offset += (start[0] + r) * m_header->record_size;
+      }
+
+      stat = MPI_File_set_view(m_file, offset, MPI_BYTE, filetype, "native", MPI_INFO_NULL);
+      if (stat == MPI_SUCCESS) {
+        stat = MPI_File_read_all(m_file, buffer.data() + r * slab_size, slab_size,
+                                 MPI_BYTE, &status);
+      }
+    } else {
+      // this process does not need this record
+      stat = MPI_File_set_view(m_file, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+      if (stat == MPI_SUCCESS) {
+        stat = MPI_File_read_all(m_file, nullptr, 0, MPI_BYTE, &status);
+      }
+    }
+  }
+
+  if (filetype != MPI_DATATYPE_NULL) {
+    MPI_Type_free(&filetype);
+  }
+  MPI_Type_free(&element);
+
+  check(PISM_ERROR_LOCATION, stat);
+
+  // convert
+  std::vector<unsigned int> idx(n_dims, 0);
+  for (uint64_t k = 0; k < n_values; ++k) {
+    uint64_t target = k;
+    if (not imap.empty()) {
+      target = 0;
+      for (size_t d = 0; d < n_dims; ++d) {
+        target += idx[d] * imap[d];
+      }
+
+      // increment the multi-index (C order)
+      for (int d = n_dims - 1; d >= 0; --d) {
+        idx[d] += 1;
+        if (idx[d] < count[d]) {
+          break;
+        }
+        idx[d] = 0;
+      }
+    }
+
+    ip[target] = decode(buffer.data() + k * size, var.type);
+  }
+}
+
+void MPIIOFile::put_vara_double_impl(const std::string &variable_name,
+                                     const std::vector<unsigned int> &start,
+                                     const std::vector<unsigned int> &count,
+                                     const double *op) const {
+  (void) variable_name;
+  (void) start;
+  (void) count;
+  (void) op;
+  read_only();
+}
+
+void MPIIOFile::inq_nvars_impl(int &result) const {
+  result = m_header->variables.size();
+}
+
+void MPIIOFile::inq_vardimid_impl(const std::string &variable_name,
+                                  std::vector<std::string> &result) const {
+  int index = m_header->variable(variable_name);
+  if (index < 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "variable '%s' not found in '%s'",
+                                  variable_name.c_str(), m_filename.c_str());
+  }
+
+  result.clear();
+  for (auto id : m_header->variables[index].dimids) {
+    result.push_back(m_header->dimensions[id].name);
+  }
+}
+
+//! Attributes of a variable (use "PISM_GLOBAL" for global attributes).
+static const std::vector<Attribute>& attributes(const MPIIOFile::Header &header,
+                                                const std::string &variable_name,
+                                                const std::string &filename) {
+  if (variable_name == "PISM_GLOBAL") {
+    return header.attributes;
+  }
+
+  int index = header.variable(variable_name);
+  if (index < 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "variable '%s' not found in '%s'",
+                                  variable_name.c_str(), filename.c_str());
+  }
+  return header.variables[index].attributes;
+}
+
+//! Returns a pointer to an attribute or NULL if not found.
+static const Attribute* find_attribute(const MPIIOFile::Header &header,
+                                       const std::string &variable_name,
+                                       const std::string &att_name,
+                                       const std::string &filename) {
+  for (const auto &a : attributes(header, variable_name, filename)) {
+    if (a.name == att_name) {
+      return &a;
+    }
+  }
+  return nullptr;
+}
+
+void MPIIOFile::inq_varnatts_impl(const std::string &variable_name, int &result) const {
+  result = attributes(*m_header, variable_name, m_filename).size();
+}
+
+void MPIIOFile::inq_varid_impl(const std::string &variable_name, bool &exists) const {
+  exists = m_header->variable(variable_name) >= 0;
+}
+
+void MPIIOFile::inq_varname_impl(unsigned int j, std::string &result) const {
+  if (j >= m_header->variables.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid variable index: %d", (int)j);
+  }
+  result = m_header->variables[j].name;
+}
+
+void MPIIOFile::get_att_double_impl(const std::string &variable_name,
+                                    const std::string &att_name,
+                                    std::vector<double> &result) const {
+  const Attribute *a = find_attribute(*m_header, variable_name, att_name, m_filename);
+  result = a != nullptr ? a->values : std::vector<double>();
+}
+
+void MPIIOFile::get_att_text_impl(const std::string &variable_name,
+                                  const std::string &att_name, std::string &result) const {
+  const Attribute *a = find_attribute(*m_header, variable_name, att_name, m_filename);
+  result = a != nullptr ? a->text : "";
+}
+
+void MPIIOFile::put_att_double_impl(const std::string &variable_name,
+                                    const std::string &att_name,
+                                    IO_Type xtype, const std::vector<double> &data) const {
+  (void) variable_name;
+  (void) att_name;
+  (void) xtype;
+  (void) data;
+  read_only();
+}
+
+void MPIIOFile::put_att_text_impl(const std::string &variable_name,
+                                  const std::string &att_name,
+                                  const std::string &value) const {
+  (void) variable_name;
+  (void) att_name;
+  (void) value;
+  read_only();
+}
+
+void MPIIOFile::inq_attname_impl(const std::string &variable_name, unsigned int n,
+                                 std::string &result) const {
+  const auto &list = attributes(*m_header, variable_name, m_filename);
+  if (n >= list.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "invalid attribute index: %d", (int)n);
+  }
+  result = list[n].name;
+}
+
+void MPIIOFile::inq_atttype_impl(const std::string &variable_name,
+                                 const std::string &att_name, IO_Type &result) const {
+  const Attribute *a = find_attribute(*m_header, variable_name, att_name, m_filename);
+
+  result = PISM_NAT;
+  if (a != nullptr and a->type >= NC_BYTE and a->type <= NC_DOUBLE) {
+    // types from NC_BYTE to NC_DOUBLE match corresponding IO_Type values
+    result = static_cast<IO_Type>(a->type);
+  }
+}
+
+void MPIIOFile::set_fill_impl(int fillmode, int &old_modep) const {
+  (void) fillmode;
+  (void) old_modep;
+  read_only();
+}
+
+void MPIIOFile::del_att_impl(const std::string &variable_name,
+                             const std::string &att_name) const {
+  (void) variable_name;
+  (void) att_name;
+  read_only();
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -0,0 +1,1205 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "NC3AsyncFile.hh"
+
+// The following is a stupid kludge necessary to make NetCDF 4.x work in
+// serial mode in an MPI program:
+#ifndef MPI_INCLUDED
+#define MPI_INCLUDED 1
+#endif
+#include <netcdf.h>
+#include <cstdio>               // stderr, fprintf
+#include <cstring>              // memcpy
+#include <algorithm>            // std::max
+#include <deque>
+#include <map>
+#include <thread>
+#include <condition_variable>
+
+#include "pism/util/pism_utilities.hh" // join
+#include "pism/util/error_handling.hh"
+
+#include "pism_type_conversion.hh" // This has to be included *after* netcdf.h.
+
+namespace pism {
+namespace io {
+
+static void check(const ErrorLocation &where, int return_code) {
+  if (return_code != NC_NOERR) {
+    throw RuntimeError(where, nc_strerror(return_code));
+  }
+}
+
+//! call MPI_Abort() if a NetCDF call failed
+static void check_and_abort(MPI_Comm com, const ErrorLocation &where, int return_code) {
+  if (return_code != NC_NOERR) {
+    fprintf(stderr, "%s:%d: %s\n", where.filename, where.line_number, nc_strerror(return_code));
+    MPI_Abort(com, -1);
+  }
+}
+
+namespace {
+
+//! The thread executing NetCDF calls on behalf of NC3AsyncFile instances on rank 0.
+/*!
+ * Operations are executed in the order they were submitted, one at a time, while holding
+ * netcdf_mutex().
+ *
+ * After a failure all remaining operations are skipped; the next call from the main
+ * thread stops the run.
+ */
+class Writer {
+public:
+  static Writer& get() {
+    static Writer writer;
+    return writer;
+  }
+
+  ~Writer() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_work.notify_all();
+
+    if (m_thread.joinable()) {
+      m_thread.join();
+    }
+  }
+
+  void set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+  }
+
+  //! Wait until `size` bytes of staging space are available and reserve them.
+  /*!
+   * The space is released when the operation submitted with the same `size` is done. An
+   * operation larger than the budget is allowed if nothing else is staged.
+   */
+  void reserve(MPI_Comm com, size_t size) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    check(com);
+
+    m_done.wait(lock, [this, size]() {
+        return m_staged == 0 or m_staged + size <= m_budget or m_error != NC_NOERR;
+      });
+    check(com);
+
+    m_staged += size;
+  }
+
+  //! Queue `operation` on `filename`, releasing `size` bytes of staging space when done.
+  unsigned long submit(MPI_Comm com, const std::string &filename, size_t size,
+                       std::function<int()> operation) {
+    unsigned long id = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      check(com);
+
+      if (not m_thread.joinable()) {
+        m_thread = std::thread(&Writer::loop, this);
+      }
+
+      m_submitted += 1;
+      id = m_submitted;
+
+      m_queue.push_back({id, filename, size, operation});
+      m_last[filename] = id;
+    }
+    m_work.notify_one();
+
+    return id;
+  }
+
+  //! Execute `operation` after all pending operations are done; returns its status.
+  int run(MPI_Comm com, const std::string &filename, std::function<int()> operation) {
+    int stat = NC_NOERR;
+
+    auto id = submit(com, filename, 0,
+                     [&stat, &operation]() {
+                       stat = operation();
+                       // failures of this operation are reported by the caller
+                       return NC_NOERR;
+                     });
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this, id]() { return m_completed >= id; });
+    check(com);
+
+    return stat;
+  }
+
+  //! Wait until all operations on `filename` are done.
+  void wait(const std::string &filename) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto it = m_last.find(filename);
+    if (it == m_last.end()) {
+      return;
+    }
+
+    auto id = it->second;
+    m_done.wait(lock, [this, id]() { return m_completed >= id; });
+  }
+private:
+  Writer()
+    : m_submitted(0),
+      m_completed(0),
+      m_staged(0),
+      m_budget(1024 * 1024 * 1024),
+      m_error(NC_NOERR),
+      m_stop(false) {
+    // make sure that the mutex is created before (and so destroyed after) this object
+    netcdf_mutex();
+  }
+
+  //! Stop the run if an operation failed. Has to be called with m_mutex locked.
+  void check(MPI_Comm com) {
+    if (m_error != NC_NOERR) {
+      // the error message was printed by the writer thread
+      MPI_Abort(com, -1);
+    }
+  }
+
+  void loop() {
+    while (true) {
+      Operation op;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_work.wait(lock, [this]() { return m_stop or not m_queue.empty(); });
+
+        if (m_queue.empty()) {
+          return;
+        }
+
+        op = m_queue.front();
+        m_queue.pop_front();
+      }
+
+      int stat = NC_NOERR;
+      // m_error is modified by this thread only
+      if (m_error == NC_NOERR) {
+        std::lock_guard<std::recursive_mutex> lock(netcdf_mutex());
+        stat = op.operation();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (stat != NC_NOERR) {
+          fprintf(stderr, "PISM ERROR: failed to write to '%s': %s\n",
+                  op.filename.c_str(), nc_strerror(stat));
+          m_error = stat;
+        }
+
+        m_staged -= op.size;
+        m_completed = op.id;
+
+        if (m_last[op.filename] == op.id) {
+          m_last.erase(op.filename);
+        }
+      }
+      m_done.notify_all();
+    }
+  }
+
+  struct Operation {
+    unsigned long id;
+    std::string filename;
+    size_t size;
+    std::function<int()> operation;
+  };
+
+  std::mutex m_mutex;
+  // signals new operations and m_stop
+  std::condition_variable m_work;
+  // signals completed operations
+  std::condition_variable m_done;
+
+  std::deque<Operation> m_queue;
+  // ID of the last operation on a given file
+  std::map<std::string, unsigned long> m_last;
+  unsigned long m_submitted, m_completed;
+  // number of bytes in staging buffers and the maximum
+  size_t m_staged, m_budget;
+  int m_error;
+  bool m_stop;
+
+  std::thread m_thread;
+};
+
+struct Attribute {
+  std::string name;
+  IO_Type type;
+  std::vector<double> values;
+  std::string text;
+};
+
+struct Variable {
+  std::string name;
+  std::vector<std::string> dimensions;
+  std::vector<Attribute> attributes;
+
+  Attribute* find_attribute(const std::string &att_name) {
+    for (auto &a : attributes) {
+      if (a.name == att_name) {
+        return &a;
+      }
+    }
+    return nullptr;
+  }
+
+  //! Add or replace an attribute (replacing keeps its position, as in NetCDF).
+  void set_attribute(const Attribute &a) {
+    Attribute *existing = find_attribute(a.name);
+    if (existing) {
+      *existing = a;
+    } else {
+      attributes.push_back(a);
+    }
+  }
+};
+
+struct Dimension {
+  std::string name;
+  unsigned int length;
+  bool unlimited;
+};
+
+//! Metadata of a file. Every rank keeps a copy.
+struct Contents {
+  Contents()
+    : fill_mode(NC_FILL) {
+    global.name = "PISM_GLOBAL";
+  }
+
+  std::vector<Dimension> dimensions;
+  std::vector<Variable> variables;
+  Variable global;
+  int fill_mode;
+};
+
+//! Data of one put_vara_double() call gathered on rank 0.
+struct Record {
+  int ndims;
+  // start and count (ndims values) of each chunk
+  std::vector<size_t> start, count;
+  // values of all chunks
+  std::vector<double> data;
+};
+
+static int get_varid(int ncid, const std::string &variable_name, int &varid) {
+  if (variable_name == "PISM_GLOBAL") {
+    varid = NC_GLOBAL;
+    return NC_NOERR;
+  }
+  return nc_inq_varid(ncid, variable_name.c_str(), &varid);
+}
+
+static int read_attributes(int ncid, int varid, int natts, Variable &variable) {
+  for (int k = 0; k < natts; ++k) {
+    std::vector<char> name(NC_MAX_NAME + 1, 0);
+    int stat = nc_inq_attname(ncid, varid, k, name.data());
+    if (stat != NC_NOERR) {
+      return stat;
+    }
+
+    nc_type type = NC_NAT;
+    size_t length = 0;
+    stat = nc_inq_att(ncid, varid, name.data(), &type, &length);
+    if (stat != NC_NOERR) {
+      return stat;
+    }
+
+    Attribute a;
+    a.name = name.data();
+    a.type = nc_type_to_pism_type(type);
+
+    if (type == NC_CHAR) {
+      std::vector<char> buffer(length + 1, 0);
+      stat = nc_get_att_text(ncid, varid, name.data(), buffer.data());
+      a.text = buffer.data();
+    } else if (type == NC_STRING) {
+      std::vector<char*> buffer(length + 1, 0);
+      stat = nc_get_att_string(ncid, varid, name.data(), buffer.data());
+      if (stat == NC_NOERR) {
+        std::vector<std::string> strings(buffer.begin(), buffer.begin() + length);
+        a.text = join(strings, ",");
+        stat = nc_free_string(length, buffer.data());
+      }
+    } else if (length > 0) {
+      a.values.resize(length);
+      stat = nc_get_att_double(ncid, varid, name.data(), a.values.data());
+    }
+
+    if (stat != NC_NOERR) {
+      return stat;
+    }
+
+    variable.attributes.push_back(a);
+  }
+  return NC_NOERR;
+}
+
+//! Read metadata of the file `ncid` (on rank 0).
+static int read_contents(int ncid, Contents &result) {
+  int ndims = 0, nvars = 0, natts = 0, unlimdimid = -1;
+  int stat = nc_inq(ncid, &ndims, &nvars, &natts, &unlimdimid);
+  if (stat != NC_NOERR) {
+    return stat;
+  }
+
+  for (int d = 0; d < ndims; ++d) {
+    std::vector<char> name(NC_MAX_NAME + 1, 0);
+    size_t length = 0;
+    stat = nc_inq_dim(ncid, d, name.data(), &length);
+    if (stat != NC_NOERR) {
+      return stat;
+    }
+    result.dimensions.push_back({name.data(), static_cast<unsigned int>(length),
+                                 d == unlimdimid});
+  }
+
+  for (int v = 0; v < nvars; ++v) {
+    std::vector<char> name(NC_MAX_NAME + 1, 0);
+    std::vector<int> dimids(NC_MAX_VAR_DIMS);
+    int var_ndims = 0, var_natts = 0;
+    stat = nc_inq_var(ncid, v, name.data(), NULL, &var_ndims, dimids.data(), &var_natts);
+    if (stat != NC_NOERR) {
+      return stat;
+    }
+
+    Variable variable;
+    variable.name = name.data();
+    for (int k = 0; k < var_ndims; ++k) {
+      std::vector<char> dimname(NC_MAX_NAME + 1, 0);
+      stat = nc_inq_dimname(ncid, dimids[k], dimname.data());
+      if (stat != NC_NOERR) {
+        return stat;
+      }
+      variable.dimensions.push_back(dimname.data());
+    }
+
+    stat = read_attributes(ncid, v, var_natts, variable);
+    if (stat != NC_NOERR) {
+      return stat;
+    }
+
+    result.variables.push_back(variable);
+  }
+
+  return read_attributes(ncid, NC_GLOBAL, natts, result.global);
+}
+
+//! Buffer used to broadcast Contents.
+class Buffer {
+public:
+  Buffer() : m_position(0) {}
+
+  void put(int value) {
+    put(&value, sizeof(int));
+  }
+  void put(const std::string &value) {
+    put((int)value.size());
+    put(value.data(), value.size());
+  }
+  void put(const std::vector<double> &value) {
+    put((int)value.size());
+    put(value.data(), value.size() * sizeof(double));
+  }
+
+  void get(int &value) {
+    get(&value, sizeof(int));
+  }
+  void get(std::string &value) {
+    int size = 0;
+    get(size);
+    value.resize(size);
+    get(&value[0], size);
+  }
+  void get(std::vector<double> &value) {
+    int size = 0;
+    get(size);
+    value.resize(size);
+    get(value.data(), size * sizeof(double));
+  }
+
+  std::vector<char> data;
+private:
+  void put(const void *input, size_t size) {
+    const char *p = static_cast<const char*>(input);
+    data.insert(data.end(), p, p + size);
+  }
+  void get(void *output, size_t size) {
+    if (size > 0) {
+      memcpy(output, &data[m_position], size);
+    }
+    m_position += size;
+  }
+  size_t m_position;
+};
+
+static void pack(const Variable &variable, Buffer &buffer) {
+  buffer.put(variable.name);
+
+  buffer.put((int)variable.dimensions.size());
+  for (const auto &d : variable.dimensions) {
+    buffer.put(d);
+  }
+
+  buffer.put((int)variable.attributes.size());
+  for (const auto &a : variable.attributes) {
+    buffer.put(a.name);
+    buffer.put((int)a.type);
+    buffer.put(a.values);
+    buffer.put(a.text);
+  }
+}
+
+static void unpack(Buffer &buffer, Variable &variable) {
+  buffer.get(variable.name);
+
+  int n = 0;
+  buffer.get(n);
+  variable.dimensions.resize(n);
+  for (auto &d : variable.dimensions) {
+    buffer.get(d);
+  }
+
+  buffer.get(n);
+  variable.attributes.resize(n);
+  for (auto &a : variable.attributes) {
+    int type = 0;
+    buffer.get(a.name);
+    buffer.get(type);
+    buffer.get(a.values);
+    buffer.get(a.text);
+    a.type = static_cast<IO_Type>(type);
+  }
+}
+
+//! Broadcast `contents` from rank 0 to all other ranks in `com`.
+static void broadcast(MPI_Comm com, Contents &contents) {
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  Buffer buffer;
+  if (rank == 0) {
+    buffer.put((int)contents.dimensions.size());
+    for (const auto &d : contents.dimensions) {
+      buffer.put(d.name);
+      buffer.put((int)d.length);
+      buffer.put((int)d.unlimited);
+    }
+
+    buffer.put((int)contents.variables.size());
+    for (const auto &v : contents.variables) {
+      pack(v, buffer);
+    }
+
+    pack(contents.global, buffer);
+  }
+
+  int size = buffer.data.size();
+  MPI_Bcast(&size, 1, MPI_INT, 0, com);
+  buffer.data.resize(size);
+  MPI_Bcast(buffer.data.data(), size, MPI_CHAR, 0, com);
+
+  if (rank != 0) {
+    int n = 0;
+    buffer.get(n);
+    contents.dimensions.resize(n);
+    for (auto &d : contents.dimensions) {
+      int length = 0, unlimited = 0;
+      buffer.get(d.name);
+      buffer.get(length);
+      buffer.get(unlimited);
+      d.length    = length;
+      d.unlimited = unlimited;
+    }
+
+    buffer.get(n);
+    contents.variables.resize(n);
+    for (auto &v : contents.variables) {
+      unpack(buffer, v);
+    }
+
+    contents.global = Variable();
+    unpack(buffer, contents.global);
+  }
+}
+
+} // end of anonymous namespace
+
+struct NC3AsyncFile::Impl {
+  int rank;
+  std::string filename;
+  // NetCDF ID of the file; used by the writer thread only
+  std::shared_ptr<int> ncid;
+  Contents contents;
+
+  //! Find a variable ("PISM_GLOBAL" refers to global attributes).
+  Variable* find_variable(const std::string &name) {
+    if (name == "PISM_GLOBAL") {
+      return &contents.global;
+    }
+    for (auto &v : contents.variables) {
+      if (v.name == name) {
+        return &v;
+      }
+    }
+    return nullptr;
+  }
+
+  Dimension* find_dimension(const std::string &name) {
+    for (auto &d : contents.dimensions) {
+      if (d.name == name) {
+        return &d;
+      }
+    }
+    return nullptr;
+  }
+};
+
+NC3AsyncFile::NC3AsyncFile(MPI_Comm c)
+  : NCFile(c), m_impl(new Impl) {
+  // NetCDF calls are made by the writer thread (which locks netcdf_mutex() itself)
+  m_use_lock = false;
+
+  m_impl->rank = 0;
+  MPI_Comm_rank(m_com, &m_impl->rank);
+}
+
+NC3AsyncFile::~NC3AsyncFile() {
+  if (m_file_id >= 0) {
+    if (m_impl->rank == 0) {
+      submit([](int ncid) { return nc_close(ncid); });
+      fprintf(stderr, "NC3AsyncFile::~NC3AsyncFile: NetCDF file %s is still open\n",
+              m_impl->filename.c_str());
+    }
+    m_file_id = -1;
+  }
+  delete m_impl;
+}
+
+//! Set the maximum total size of data waiting to be written (on this MPI process).
+void NC3AsyncFile::set_memory_budget(size_t bytes) {
+  Writer::get().set_budget(bytes);
+}
+
+//! Wait until all pending operations on `filename` are done.
+/*!
+ * Use this before accessing `filename` in some other way (e.g. to move or remove it).
+ */
+void NC3AsyncFile::wait(const std::string &filename) {
+  Writer::get().wait(filename);
+}
+
+//! Queue an operation on the current file (on rank 0).
+void NC3AsyncFile::submit(std::function<int(int)> operation, size_t size) const {
+  if (m_impl->rank == 0) {
+    auto ncid = m_impl->ncid;
+    Writer::get().submit(m_com, m_impl->filename, size,
+                         [ncid, operation]() { return operation(*ncid); });
+  }
+}
+
+// open/create/close
+
+//! Open an existing file, waiting for pending operations on it.
+void NC3AsyncFile::open_impl(const std::string &fname, IO_Mode mode) {
+  int stat = NC_NOERR;
+
+  int open_mode = mode == PISM_READONLY ? NC_NOWRITE : NC_WRITE;
+
+  auto ncid = std::make_shared<int>(-1);
+  Contents contents;
+
+  if (m_impl->rank == 0) {
+    stat = Writer::get().run(m_com, fname,
+                             [&]() {
+                               int s = nc_open(fname.c_str(), open_mode, ncid.get());
+                               if (s == NC_NOERR) {
+                                 s = read_contents(*ncid, contents);
+                                 if (s != NC_NOERR) {
+                                   nc_close(*ncid);
+                                 }
+                               }
+                               return s;
+                             });
+  }
+
+  MPI_Bcast(&stat, 1, MPI_INT, 0, m_com);
+  check(PISM_ERROR_LOCATION, stat);
+
+  broadcast(m_com, contents);
+
+  m_impl->filename = fname;
+  m_impl->ncid     = ncid;
+  m_impl->contents = contents;
+  m_file_id        = 0;
+}
+
+//! \brief Create a NetCDF file.
+void NC3AsyncFile::create_impl(const std::string &fname) {
+  m_impl->filename = fname;
+  m_impl->ncid     = std::make_shared<int>(-1);
+  m_impl->contents = Contents();
+
+  if (m_impl->rank == 0) {
+    auto ncid = m_impl->ncid;
+    Writer::get().submit(m_com, fname, 0,
+                         [ncid, fname]() {
+                           return nc_create(fname.c_str(), NC_CLOBBER | NC_64BIT_OFFSET,
+                                            ncid.get());
+                         });
+  }
+
+  m_file_id = 0;
+}
+
+//! \brief Close a NetCDF file (does not wait for pending writes).
+void NC3AsyncFile::close_impl() {
+  if (m_file_id < 0) {
+    check(PISM_ERROR_LOCATION, NC_EBADID);
+  }
+
+  submit([](int ncid) { return nc_close(ncid); });
+
+  m_impl->contents = Contents();
+  m_file_id = -1;
+}
+
+void NC3AsyncFile::sync_impl() const {
+  submit([](int ncid) { return nc_sync(ncid); });
+}
+
+//! \brief Exit define mode.
+void NC3AsyncFile::enddef_impl() const {
+  submit([](int ncid) {
+      int header_size = 200 * 1024;
+      return nc__enddef(ncid, header_size, 4, 0, 4);
+    });
+}
+
+//! \brief Enter define mode.
+void NC3AsyncFile::redef_impl() const {
+  submit([](int ncid) { return nc_redef(ncid); });
+}
+
+//! \brief Define a dimension.
+void NC3AsyncFile::def_dim_impl(const std::string &name, size_t length) const {
+  if (m_impl->find_dimension(name)) {
+    check(PISM_ERROR_LOCATION, NC_ENAMEINUSE);
+  }
+
+  bool unlimited = (length == PISM_UNLIMITED);
+  m_impl->contents.dimensions.push_back({name, static_cast<unsigned int>(length), unlimited});
+
+  submit([name, length](int ncid) {
+      int dimid = 0;
+      return nc_def_dim(ncid, name.c_str(), length, &dimid);
+    });
+}
+
+void NC3AsyncFile::inq_dimid_impl(const std::string &dimension_name, bool &exists) const {
+  exists = m_impl->find_dimension(dimension_name) != nullptr;
+}
+
+//! \brief Get a dimension length.
+void NC3AsyncFile::inq_dimlen_impl(const std::string &dimension_name, unsigned int &result) const {
+  auto dim = m_impl->find_dimension(dimension_name);
+  if (not dim) {
+    check(PISM_ERROR_LOCATION, NC_EBADDIM);
+  }
+  result = dim->length;
+}
+
+//! \brief Get an unlimited dimension.
+void NC3AsyncFile::inq_unlimdim_impl(std::string &result) const {
+  result = "";
+  for (const auto &d : m_impl->contents.dimensions) {
+    if (d.unlimited) {
+      result = d.name;
+      break;
+    }
+  }
+}
+
+//! \brief Define a variable.
+void NC3AsyncFile::def_var_impl(const std::string &name,
+                                IO_Type nctype,
+                                const std::vector<std::string> &dims) const {
+  if (m_impl->find_variable(name)) {
+    check(PISM_ERROR_LOCATION, NC_ENAMEINUSE);
+  }
+
+  for (const auto &d : dims) {
+    if (not m_impl->find_dimension(d)) {
+      check(PISM_ERROR_LOCATION, NC_EBADDIM);
+    }
+  }
+
+  Variable variable;
+  variable.name       = name;
+  variable.dimensions = dims;
+  m_impl->contents.variables.push_back(variable);
+
+  nc_type type = pism_type_to_nc_type(nctype);
+
+  submit([name, type, dims](int ncid) {
+      std::vector<int> dimids;
+      for (const auto &d : dims) {
+        int dimid = 0;
+        int stat = nc_inq_dimid(ncid, d.c_str(), &dimid);
+        if (stat != NC_NOERR) {
+          return stat;
+        }
+        dimids.push_back(dimid);
+      }
+
+      int varid = 0;
+      return nc_def_var(ncid, name.c_str(), type, static_cast<int>(dims.size()),
+                        dimids.data(), &varid);
+    });
+}
+
+void NC3AsyncFile::get_varm_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start,
+                                        const std::vector<unsigned int> &count,
+                                        const std::vector<unsigned int> &imap, double *op) const {
+  return this->get_var_double(variable_name,
+                              start, count, imap, op, true);
+}
+
+void NC3AsyncFile::get_vara_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start,
+                                        const std::vector<unsigned int> &count,
+                                        double *op) const {
+  std::vector<unsigned int> dummy;
+  return this->get_var_double(variable_name,
+                              start, count, dummy, op, false);
+}
+
+//! \brief Get variable data (waits for pending operations).
+/*!
+ * Uses the same communication pattern as NC3File::get_var_double().
+ */
+void NC3AsyncFile::get_var_double(const std::string &variable_name,
+                                  const std::vector<unsigned int> &start_input,
+                                  const std::vector<unsigned int> &count_input,
+                                  const std::vector<unsigned int> &imap_input, double *ip,
+                                  bool transposed) const {
+  std::vector<unsigned int> start = start_input;
+  std::vector<unsigned int> count = count_input;
+  std::vector<unsigned int> imap = imap_input;
+  const int start_tag = 1,
+    count_tag = 2,
+    data_tag =  3,
+    imap_tag =  4,
+    chunk_size_tag = 5;
+  int com_size, ndims = static_cast<int>(start.size());
+  std::vector<double> processor_0_buffer;
+  MPI_Status mpi_stat;
+  unsigned int local_chunk_size = 1,
+    processor_0_chunk_size = 0;
+
+  if (not transposed) {
+    imap.resize(ndims);
+  }
+
+  MPI_Comm_size(m_com, &com_size);
+
+  for (int k = 0; k < ndims; ++k) {
+    local_chunk_size *= count[k];
+  }
+
+  MPI_Reduce(&local_chunk_size, &processor_0_chunk_size, 1, MPI_UNSIGNED, MPI_MAX, 0, m_com);
+
+  if (m_impl->rank == 0) {
+    processor_0_buffer.resize(processor_0_chunk_size);
+
+    auto ncid = m_impl->ncid;
+
+    for (int r = 0; r < com_size; ++r) {
+
+      if (r != 0) {
+        MPI_Recv(&start[0],         ndims, MPI_UNSIGNED, r, start_tag,      m_com, &mpi_stat);
+        MPI_Recv(&count[0],         ndims, MPI_UNSIGNED, r, count_tag,      m_com, &mpi_stat);
+        MPI_Recv(&imap[0],          ndims, MPI_UNSIGNED, r, imap_tag,       m_com, &mpi_stat);
+        MPI_Recv(&local_chunk_size, 1,     MPI_UNSIGNED, r, chunk_size_tag, m_com, &mpi_stat);
+      }
+
+      int stat = Writer::get().run(m_com, m_impl->filename,
+                                   [&]() {
+                                     std::vector<size_t> nc_start(ndims), nc_count(ndims);
+                                     std::vector<ptrdiff_t> nc_imap(ndims), nc_stride(ndims);
+                                     for (int k = 0; k < ndims; ++k) {
+                                       nc_start[k]  = start[k];
+                                       nc_count[k]  = count[k];
+                                       nc_imap[k]   = imap[k];
+                                       nc_stride[k] = 1;
+                                     }
+
+                                     int varid = 0;
+                                     int s = nc_inq_varid(*ncid, variable_name.c_str(), &varid);
+                                     if (s != NC_NOERR) {
+                                       return s;
+                                     }
+
+                                     if (transposed) {
+                                       return nc_get_varm_double(*ncid, varid,
+                                                                 &nc_start[0], &nc_count[0],
+                                                                 &nc_stride[0], &nc_imap[0],
+                                                                 &processor_0_buffer[0]);
+                                     }
+                                     return nc_get_vara_double(*ncid, varid,
+                                                               &nc_start[0], &nc_count[0],
+                                                               &processor_0_buffer[0]);
+                                   });
+      check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
+
+      if (r != 0) {
+        MPI_Send(&processor_0_buffer[0], local_chunk_size, MPI_DOUBLE, r, data_tag, m_com);
+      } else {
+        for (unsigned int k = 0; k < local_chunk_size; ++k) {
+          ip[k] = processor_0_buffer[k];
+        }
+      }
+    } // end of the for loop
+
+  } else {
+    MPI_Send(&start[0],          ndims, MPI_UNSIGNED, 0, start_tag,      m_com);
+    MPI_Send(&count[0],          ndims, MPI_UNSIGNED, 0, count_tag,      m_com);
+    MPI_Send(&imap[0],           ndims, MPI_UNSIGNED, 0, imap_tag,       m_com);
+    MPI_Send(&local_chunk_size,  1,     MPI_UNSIGNED, 0, chunk_size_tag, m_com);
+
+    MPI_Recv(ip, local_chunk_size, MPI_DOUBLE, 0, data_tag, m_com, &mpi_stat);
+  }
+}
+
+//! \brief Write variable data.
+/*!
+ * Data are gathered on rank 0 (as in NC3File::put_vara_double_impl()) and copied into a
+ * staging buffer; the writer thread writes them to the file.
+ */
+void NC3AsyncFile::put_vara_double_impl(const std::string &variable_name,
+                                        const std::vector<unsigned int> &start_input,
+                                        const std::vector<unsigned int> &count_input,
+                                        const double *op) const {
+  // make copies of start and count so that we can use them in MPI_Recv() calls below
+  std::vector<unsigned int> start = start_input;
+  std::vector<unsigned int> count = count_input;
+  const int start_tag = 1,
+    count_tag = 2,
+    data_tag =  3,
+    chunk_size_tag = 4;
+  int com_size = 0, ndims = static_cast<int>(start.size());
+  MPI_Status mpi_stat;
+  unsigned int local_chunk_size = 1;
+
+  auto variable = m_impl->find_variable(variable_name);
+  if (variable == nullptr or variable == &m_impl->contents.global) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+
+  MPI_Comm_size(m_com, &com_size);
+
+  for (int k = 0; k < ndims; ++k) {
+    local_chunk_size *= count[k];
+  }
+
+  // update the length of the unlimited dimension (using all chunks so that all ranks
+  // agree)
+  for (unsigned int k = 0; k < variable->dimensions.size() and k < start.size(); ++k) {
+    auto dim = m_impl->find_dimension(variable->dimensions[k]);
+    if (dim and dim->unlimited) {
+      unsigned int end = count[k] > 0 ? start[k] + count[k] : 0, global_end = 0;
+      MPI_Allreduce(&end, &global_end, 1, MPI_UNSIGNED, MPI_MAX, m_com);
+      dim->length = std::max(dim->length, global_end);
+    }
+  }
+
+  // compute the total size of the data; this is the size of the staging buffer
+  unsigned long int local_size = local_chunk_size, total_size = 0;
+  MPI_Reduce(&local_size, &total_size, 1, MPI_UNSIGNED_LONG, MPI_SUM, 0, m_com);
+
+  if (m_impl->rank == 0) {
+    const size_t size = total_size * sizeof(double);
+
+    // wait for space in staging buffers
+    Writer::get().reserve(m_com, size);
+
+    std::shared_ptr<Record> record(new Record);
+    record->ndims = ndims;
+    record->data.resize(total_size);
+
+    size_t offset = 0;
+    for (int r = 0; r < com_size; ++r) {
+      if (r != 0) {
+        MPI_Recv(&start[0],         ndims, MPI_UNSIGNED, r, start_tag,      m_com, &mpi_stat);
+        MPI_Recv(&count[0],         ndims, MPI_UNSIGNED, r, count_tag,      m_com, &mpi_stat);
+        MPI_Recv(&local_chunk_size, 1,     MPI_UNSIGNED, r, chunk_size_tag, m_com, &mpi_stat);
+
+        MPI_Recv(record->data.data() + offset, local_chunk_size, MPI_DOUBLE, r, data_tag,
+                 m_com, &mpi_stat);
+      } else {
+        for (unsigned int k = 0; k < local_chunk_size; ++k) {
+          record->data[offset + k] = op[k];
+        }
+      }
+
+      for (int k = 0; k < ndims; ++k) {
+        record->start.push_back(start[k]);
+        record->count.push_back(count[k]);
+      }
+      offset += local_chunk_size;
+    }
+
+    submit([variable_name, record](int ncid) {
+        int varid = 0;
+        int stat = nc_inq_varid(ncid, variable_name.c_str(), &varid);
+        if (stat != NC_NOERR) {
+          return stat;
+        }
+
+        const int N = record->ndims;
+        const size_t n_chunks = N > 0 ? record->start.size() / N : 1;
+        const double *data = record->data.data();
+
+        for (size_t c = 0; c < n_chunks; ++c) {
+          size_t chunk_size = 1;
+          for (int k = 0; k < N; ++k) {
+            chunk_size *= record->count[c * N + k];
+          }
+
+          if (chunk_size > 0) {
+            stat = nc_put_vara_double(ncid, varid,
+                                      &record->start[c * N], &record->count[c * N], data);
+            if (stat != NC_NOERR) {
+              return stat;
+            }
+          }
+          data += chunk_size;
+        }
+        return NC_NOERR;
+      }, size);
+  } else {
+    MPI_Send(&start[0],          ndims, MPI_UNSIGNED, 0, start_tag,      m_com);
+    MPI_Send(&count[0],          ndims, MPI_UNSIGNED, 0, count_tag,      m_com);
+    MPI_Send(&local_chunk_size,  1,     MPI_UNSIGNED, 0, chunk_size_tag, m_com);
+
+    MPI_Send(const_cast<double*>(op), local_chunk_size, MPI_DOUBLE, 0, data_tag, m_com);
+  }
+}
+
+//! \brief Get the number of variables.
+void NC3AsyncFile::inq_nvars_impl(int &result) const {
+  result = m_impl->contents.variables.size();
+}
+
+//! \brief Get dimensions a variable depends on.
+void NC3AsyncFile::inq_vardimid_impl(const std::string &variable_name,
+                                     std::vector<std::string> &result) const {
+  auto variable = m_impl->find_variable(variable_name);
+  if (variable == nullptr or variable == &m_impl->contents.global) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+  result = variable->dimensions;
+}
+
+//! \brief Get the number of attributes of a variable.
+/*!
+ * Use "PISM_GLOBAL" as the "variable_name" to get the number of global attributes.
+ */
+void NC3AsyncFile::inq_varnatts_impl(const std::string &variable_name, int &result) const {
+  auto variable = m_impl->find_variable(variable_name);
+  if (not variable) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+  result = variable->attributes.size();
+}
+
+//! \brief Finds a variable and sets the "exists" flag.
+void NC3AsyncFile::inq_varid_impl(const std::string &variable_name, bool &exists) const {
+  exists = (variable_name != "PISM_GLOBAL" and
+            m_impl->find_variable(variable_name) != nullptr);
+}
+
+void NC3AsyncFile::inq_varname_impl(unsigned int j, std::string &result) const {
+  if (j >= m_impl->contents.variables.size()) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+  result = m_impl->contents.variables[j].name;
+}
+
+//! \brief Gets a double attribute.
+void NC3AsyncFile::get_att_double_impl(const std::string &variable_name,
+                                       const std::string &att_name,
+                                       std::vector<double> &result) const {
+  result.clear();
+
+  auto variable = m_impl->find_variable(variable_name);
+  if (not variable) {
+    return;
+  }
+
+  auto attribute = variable->find_attribute(att_name);
+  if (not attribute) {
+    return;
+  }
+
+  if (attribute->type == PISM_CHAR) {
+    check(PISM_ERROR_LOCATION, NC_ECHAR);
+  }
+
+  result = attribute->values;
+}
+
+//! \brief Gets a text attribute.
+void NC3AsyncFile::get_att_text_impl(const std::string &variable_name,
+                                     const std::string &att_name, std::string &result) const {
+  auto variable = m_impl->find_variable(variable_name);
+  if (not variable) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+
+  auto attribute = variable->find_attribute(att_name);
+  if (attribute and attribute->type == PISM_CHAR) {
+    result = attribute->text;
+  } else {
+    result = "";
+  }
+}
+
+//! \brief Writes a double attribute.
+void NC3AsyncFile::put_att_double_impl(const std::string &variable_name, const std::string &att_name,
+                                       IO_Type xtype, const std::vector<double> &data) const {
+  auto variable = m_impl->find_variable(variable_name);
+  if (not variable) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+
+  Attribute attribute;
+  attribute.name   = att_name;
+  attribute.type   = xtype;
+  attribute.values = data;
+  variable->set_attribute(attribute);
+
+  nc_type type = pism_type_to_nc_type(xtype);
+
+  submit([variable_name, att_name, type, data](int ncid) {
+      int varid = 0;
+      int stat = get_varid(ncid, variable_name, varid);
+      if (stat != NC_NOERR) {
+        return stat;
+      }
+      return nc_put_att_double(ncid, varid, att_name.c_str(), type, data.size(), data.data());
+    });
+}
+
+//! \brief Writes a text attribute.
+void NC3AsyncFile::put_att_text_impl(const std::string &variable_name, const std::string &att_name,
+                                     const std::string &value) const {
+  auto variable = m_impl->find_variable(variable_name);
+  if (not variable) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+
+  Attribute attribute;
+  attribute.name = att_name;
+  attribute.type = PISM_CHAR;
+  attribute.text = value;
+  variable->set_attribute(attribute);
+
+  submit([variable_name, att_name, value](int ncid) {
+      int varid = 0;
+      int stat = get_varid(ncid, variable_name, varid);
+      if (stat != NC_NOERR) {
+        return stat;
+      }
+      return nc_put_att_text(ncid, varid, att_name.c_str(), value.size(), value.c_str());
+    });
+}
+
+//! \brief Gets the name of a numbered attribute.
+void NC3AsyncFile::inq_attname_impl(const std::string &variable_name, unsigned int n,
+                                    std::string &result) const {
+  auto variable = m_impl->find_variable(variable_name);
+  if (not variable) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+
+  if (n >= variable->attributes.size()) {
+    check(PISM_ERROR_LOCATION, NC_ENOTATT);
+  }
+
+  result = variable->attributes[n].name;
+}
+
+//! \brief Gets the type of an attribute.
+void NC3AsyncFile::inq_atttype_impl(const std::string &variable_name, const std::string &att_name,
+                                    IO_Type &result) const {
+  auto variable = m_impl->find_variable(variable_name);
+  if (not variable) {
+    check(PISM_ERROR_LOCATION, NC_ENOTVAR);
+  }
+
+  auto attribute = variable->find_attribute(att_name);
+  result = attribute ? attribute->type : PISM_NAT;
+}
+
+//! \brief Sets the fill mode.
+void NC3AsyncFile::set_fill_impl(int fillmode, int &old_modep) const {
+  old_modep = m_impl->contents.fill_mode;
+  m_impl->contents.fill_mode = fillmode;
+
+  submit([fillmode](int ncid) {
+      int old_mode = 0;
+      return nc_set_fill(ncid, fillmode, &old_mode);
+    });
+}
+
+void NC3AsyncFile::del_att_impl(const std::string &variable_name, const std::string &att_name) const {
+  auto variable = m_impl->find_variable(variable_name);
+  if (not variable) {
+    return;
+  }
+
+  auto &attributes = variable->attributes;
+  auto it = std::find_if(attributes.begin(), attributes.end(),
+                         [&att_name](const Attribute &a) { return a.name == att_name; });
+  if (it == attributes.end()) {
+    check(PISM_ERROR_LOCATION, NC_ENOTATT);
+  }
+  attributes.erase(it);
+
+  submit([variable_name, att_name](int ncid) {
+      int varid = 0;
+      int stat = get_varid(ncid, variable_name, varid);
+      if (stat != NC_NOERR) {
+        return stat;
+      }
+      return nc_del_att(ncid, varid, att_name.c_str());
+    });
+}
+
+} // end of namespace io
+} // end of namespace pism
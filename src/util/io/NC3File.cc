@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -25,10 +25,12 @@
 #endif
 #include <netcdf.h>
 #include <cstring>              // memset
+#include <algorithm>            // std::copy, std::min, std::max
 #include <cstdio>               // stderr, fprintf
 
 #include "pism/util/pism_utilities.hh" // join
 #include "pism/util/error_handling.hh"
+#include "pism/util/IceGrid.hh"
 
 #include "pism_type_conversion.hh" // This has to be included *after* netcdf.h.
 
@@ -51,19 +53,28 @@ static void check_and_abort(MPI_Comm com, const ErrorLocation &where, int return
 }
 
 NC3File::NC3File(MPI_Comm c)
-  : NCFile(c), m_rank(0) {
+  : NCFile(c), m_rank(0), m_row_comm(MPI_COMM_NULL), m_leader_comm(MPI_COMM_NULL) {
   MPI_Comm_rank(m_com, &m_rank);
 }
 
 NC3File::~NC3File() {
   if (m_file_id >= 0) {
     if (m_rank == 0) {
+      std::lock_guard<std::recursive_mutex> lock(netcdf_mutex());
       nc_close(m_file_id);
       fprintf(stderr, "NC3File::~NC3File: NetCDF file %s is still open\n",
               m_filename.c_str());
     }
     m_file_id = -1;
   }
+
+  if (m_row_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_row_comm);
+  }
+
+  if (m_leader_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_leader_comm);
+  }
 }
 
 // open/create/close
@@ -289,25 +300,156 @@ void NC3File::get_vara_double_impl(const std::string &variable_name,
                               start, count, dummy, op, false);
 }
 
+namespace {
+
+//! Hyperslabs requested by a group of processes, read using one NetCDF call.
+struct ReadGroup {
+  //! the first process in the group
+  int first;
+  //! the number of processes
+  int size;
+  //! the union of hyperslabs of all processes in the group
+  std::vector<unsigned int> start, count;
+  //! the dimension along which hyperslabs differ (-1 if they are the same so far)
+  int dim;
+  //! true if the group contains one process requesting nothing
+  bool empty;
+};
+
+/*!
+ * Group consecutive processes requesting hyperslabs which differ along at most one
+ * dimension and form a contiguous range along it (e.g. processes in a row of the
+ * processor grid when reading a part of a spatial field).
+ *
+ * `start` and `count` contain requests of all processes, `ndims` entries per process.
+ */
+std::vector<ReadGroup> read_groups(const std::vector<unsigned int> &start,
+                                   const std::vector<unsigned int> &count,
+                                   int ndims, int com_size) {
+  std::vector<ReadGroup> result;
+
+  for (int r = 0; r < com_size; ++r) {
+    const unsigned int
+      *s = &start[r * ndims],
+      *c = &count[r * ndims];
+
+    bool empty = false;
+    for (int k = 0; k < ndims; ++k) {
+      empty = empty or c[k] == 0;
+    }
+
+    // processes requesting nothing are not grouped with others
+    if (not result.empty() and not result.back().empty and not empty) {
+      ReadGroup &g = result.back();
+
+      // find dimensions along which this request differs from the group's union
+      int n_different = 0, dim = -1;
+      for (int k = 0; k < ndims; ++k) {
+        if (s[k] != g.start[k] or c[k] != g.count[k]) {
+          n_different += 1;
+          dim = k;
+        }
+      }
+
+      bool join = n_different == 0;
+      if (n_different == 1 and (g.dim == -1 or g.dim == dim)) {
+        const unsigned int
+          end       = s[dim] + c[dim],
+          group_end = g.start[dim] + g.count[dim];
+
+        // ranges have to overlap or touch
+        join = s[dim] <= group_end and end >= g.start[dim];
+
+        if (join) {
+          unsigned int new_start = std::min(s[dim], g.start[dim]);
+          g.count[dim] = std::max(end, group_end) - new_start;
+          g.start[dim] = new_start;
+          g.dim        = dim;
+        }
+      }
+
+      if (join) {
+        g.size += 1;
+        continue;
+      }
+    }
+
+    ReadGroup g;
+    g.first = r;
+    g.size  = 1;
+    g.start.assign(s, s + ndims);
+    g.count.assign(c, c + ndims);
+    g.dim   = -1;
+    g.empty = empty;
+    result.push_back(g);
+  }
+
+  return result;
+}
+
+/*!
+ * Copy the hyperslab (`start`, `count`) from `input` containing the hyperslab
+ * (`input_start`, `input_count`) to `output`, using `imap` to arrange values in `output`
+ * (C order if `imap` is empty).
+ */
+void extract(const double *input,
+             const std::vector<unsigned int> &input_start,
+             const std::vector<unsigned int> &input_count,
+             const unsigned int *start, const unsigned int *count,
+             const unsigned int *imap, double *output) {
+  const int ndims = input_start.size();
+
+  size_t size = 1;
+  std::vector<size_t> stride(ndims, 1);
+  for (int k = ndims - 1; k >= 0; --k) {
+    size *= count[k];
+    if (k < ndims - 1) {
+      stride[k] = stride[k + 1] * input_count[k + 1];
+    }
+  }
+
+  std::vector<unsigned int> idx(ndims, 0);
+  for (size_t n = 0; n < size; ++n) {
+    size_t source = 0, target = imap != nullptr ? 0 : n;
+    for (int k = 0; k < ndims; ++k) {
+      source += (start[k] - input_start[k] + idx[k]) * stride[k];
+      if (imap != nullptr) {
+        target += idx[k] * imap[k];
+      }
+    }
+
+    output[target] = input[source];
+
+    // increment the multi-index (C order)
+    for (int k = ndims - 1; k >= 0; --k) {
+      idx[k] += 1;
+      if (idx[k] < count[k]) {
+        break;
+      }
+      idx[k] = 0;
+    }
+  }
+}
+
+} // end of anonymous namespace
+
 //! \brief Get variable data.
+/*!
+ * Processor 0 collects hyperslabs requested by all processes and reads them, grouping
+ * requests of consecutive processes that can be covered by one hyperslab (see
+ * read_groups()). This way each process receives only the part of the variable it needs
+ * (e.g. the bounding box computed by LocalInterpCtx when regridding) while processor 0
+ * makes one NetCDF call per row of the processor grid instead of one per process.
+ */
 void NC3File::get_var_double(const std::string &variable_name,
-                            const std::vector<unsigned int> &start_input,
-                            const std::vector<unsigned int> &count_input,
+                            const std::vector<unsigned int> &start,
+                            const std::vector<unsigned int> &count,
                             const std::vector<unsigned int> &imap_input, double *ip,
                             bool transposed) const {
-  std::vector<unsigned int> start = start_input;
-  std::vector<unsigned int> count = count_input;
   std::vector<unsigned int> imap = imap_input;
-  const int start_tag = 1,
-    count_tag = 2,
-    data_tag =  3,
-    imap_tag =  4,
-    chunk_size_tag = 5;
+  const int data_tag = 3;
   int stat = NC_NOERR, com_size, ndims = static_cast<int>(start.size());
-  std::vector<double> processor_0_buffer;
   MPI_Status mpi_stat;
-  unsigned int local_chunk_size = 1,
-    processor_0_chunk_size = 0;
 
   if (not transposed) {
     imap.resize(ndims);
@@ -317,77 +459,78 @@ void NC3File::get_var_double(const std::string &variable_name,
   MPI_Comm_size(m_com, &com_size);
 
   // compute the size of a local chunk
+  unsigned int local_chunk_size = 1;
   for (int k = 0; k < ndims; ++k) {
     local_chunk_size *= count[k];
   }
 
-  // compute the maximum and send it to processor 0; this is the size of the
-  // buffer processor 0 will need
-  MPI_Reduce(&local_chunk_size, &processor_0_chunk_size, 1, MPI_UNSIGNED, MPI_MAX, 0, m_com);
-
-  // now we need to send start, count and imap data to processor 0 and receive data
+  // collect all requests on processor 0
+  std::vector<unsigned int> starts, counts, imaps;
   if (m_rank == 0) {
-    // Note: this could be optimized: if processor_0_chunk_size <=
-    // max(local_chunk_size) we can avoid allocating this buffer. The inner for
-    // loop will have to be re-ordered, though.
-    processor_0_buffer.resize(processor_0_chunk_size);
+    starts.resize(ndims * com_size);
+    counts.resize(ndims * com_size);
+    imaps.resize(ndims * com_size);
+  }
 
-    // MPI calls below require C datatypes (so that we don't have to worry
-    // about sizes of size_t and ptrdiff_t), so we make local copies of start,
-    // count, and imap to use in the nc_get_varm_double() call.
-    std::vector<size_t> nc_start(ndims), nc_count(ndims);
-    std::vector<ptrdiff_t> nc_imap(ndims), nc_stride(ndims);
-    int varid;
+  if (ndims > 0) {
+    // MPI_Gather does not accept const pointers in older MPI implementations
+    std::vector<unsigned int> s = start, c = count;
+    MPI_Gather(s.data(),    ndims, MPI_UNSIGNED, starts.data(), ndims, MPI_UNSIGNED, 0, m_com);
+    MPI_Gather(c.data(),    ndims, MPI_UNSIGNED, counts.data(), ndims, MPI_UNSIGNED, 0, m_com);
+    MPI_Gather(imap.data(), ndims, MPI_UNSIGNED, imaps.data(),  ndims, MPI_UNSIGNED, 0, m_com);
+  }
 
+  if (m_rank == 0) {
+    int varid;
     stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid);
     check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
 
-    for (int r = 0; r < com_size; ++r) {
+    std::vector<double> group_buffer, buffer;
 
-      if (r != 0) {
-        // Note: start, count, imap, and local_chunk_size on processor zero are
-        // used *before* they get overwritten by these calls
-        MPI_Recv(&start[0],         ndims, MPI_UNSIGNED, r, start_tag,      m_com, &mpi_stat);
-        MPI_Recv(&count[0],         ndims, MPI_UNSIGNED, r, count_tag,      m_com, &mpi_stat);
-        MPI_Recv(&imap[0],          ndims, MPI_UNSIGNED, r, imap_tag,       m_com, &mpi_stat);
-        MPI_Recv(&local_chunk_size, 1,     MPI_UNSIGNED, r, chunk_size_tag, m_com, &mpi_stat);
-      }
-
-      // This for loop uses start, count and imap passed in as arguments when r
-      // == 0. For r > 0 they are overwritten by MPI_Recv calls above.
+    for (const auto &g : read_groups(starts, counts, ndims, com_size)) {
+      // MPI calls above require C datatypes (so that we don't have to worry about sizes
+      // of size_t and ptrdiff_t), so we make local copies of start and count to use in
+      // the nc_get_vara_double() call.
+      std::vector<size_t> nc_start(ndims), nc_count(ndims);
+      size_t group_size = 1;
       for (int k = 0; k < ndims; ++k) {
-        nc_start[k]  = start[k];
-        nc_count[k]  = count[k];
-        nc_imap[k]   = imap[k];
-        nc_stride[k] = 1;       // fill with ones; this way it works even with
-                                // NetCDF versions with a bug affecting the
-                                // stride == NULL case.
+        nc_start[k] = g.start[k];
+        nc_count[k] = g.count[k];
+        group_size *= g.count[k];
       }
 
-      if (transposed) {
-        stat = nc_get_varm_double(m_file_id, varid, &nc_start[0], &nc_count[0], &nc_stride[0], &nc_imap[0],
-                                  &processor_0_buffer[0]);
-      } else {
-        stat = nc_get_vara_double(m_file_id, varid, &nc_start[0], &nc_count[0],
-                                  &processor_0_buffer[0]);
+      if (group_size > 0) {
+        group_buffer.resize(group_size);
+        stat = nc_get_vara_double(m_file_id, varid, nc_start.data(), nc_count.data(),
+                                  group_buffer.data());
+        check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
       }
-      check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
 
-      if (r != 0) {
-        MPI_Send(&processor_0_buffer[0], local_chunk_size, MPI_DOUBLE, r, data_tag, m_com);
-      } else {
-        for (unsigned int k = 0; k < local_chunk_size; ++k) {
-          ip[k] = processor_0_buffer[k];
+      for (int r = g.first; r < g.first + g.size; ++r) {
+        const unsigned int
+          *s = &starts[r * ndims],
+          *c = &counts[r * ndims];
+
+        size_t chunk_size = 1;
+        for (int k = 0; k < ndims; ++k) {
+          chunk_size *= c[k];
         }
-      }
-    } // end of the for loop
 
-  } else {
-    MPI_Send(&start[0],          ndims, MPI_UNSIGNED, 0, start_tag,      m_com);
-    MPI_Send(&count[0],          ndims, MPI_UNSIGNED, 0, count_tag,      m_com);
-    MPI_Send(&imap[0],           ndims, MPI_UNSIGNED, 0, imap_tag,       m_com);
-    MPI_Send(&local_chunk_size,  1,     MPI_UNSIGNED, 0, chunk_size_tag, m_com);
+        // data owned by processor 0 are copied directly into ip
+        buffer.resize(chunk_size);
+        double *output = r == 0 ? ip : buffer.data();
 
+        if (chunk_size > 0) {
+          extract(group_buffer.data(), g.start, g.count, s, c,
+                  transposed ? &imaps[r * ndims] : nullptr, output);
+        }
+
+        if (r != 0) {
+          MPI_Send(output, chunk_size, MPI_DOUBLE, r, data_tag, m_com);
+        }
+      }
+    }
+  } else {
     MPI_Recv(ip, local_chunk_size, MPI_DOUBLE, 0, data_tag, m_com, &mpi_stat);
   }
 }
@@ -445,12 +588,11 @@ void NC3File::put_vara_double_impl(const std::string &variable_name,
         MPI_Recv(&local_chunk_size, 1,     MPI_UNSIGNED, r, chunk_size_tag, m_com, &mpi_stat);
 
         MPI_Recv(&processor_0_buffer[0], local_chunk_size, MPI_DOUBLE, r, data_tag, m_com, &mpi_stat);
-      } else {
-        for (unsigned int k = 0; k < local_chunk_size; ++k) {
-          processor_0_buffer[k] = op[k];
-        }
       }
 
+      // data owned by processor 0 are written directly from op
+      const double *buffer = r == 0 ? op : &processor_0_buffer[0];
+
       // This for loop uses start and count passed in as arguments when r == 0. For r > 0
       // they are overwritten by MPI_Recv calls above.
       for (int k = 0; k < ndims; ++k) {
@@ -461,8 +603,7 @@ void NC3File::put_vara_double_impl(const std::string &variable_name,
                                 // stride == NULL case.
       }
 
-      stat = nc_put_vara_double(m_file_id, varid, &nc_start[0], &nc_count[0],
-                                &processor_0_buffer[0]);
+      stat = nc_put_vara_double(m_file_id, varid, &nc_start[0], &nc_count[0], buffer);
       check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
     } // end of the for loop
   } else {
@@ -474,6 +615,166 @@ void NC3File::put_vara_double_impl(const std::string &variable_name,
   }
 }
 
+/*!
+ * Create communicators used to aggregate data in write_darray_impl() (if the grid or its
+ * distribution changed).
+ *
+ * Processes owning the same rows of the grid form a "row"; the process owning the first
+ * column is its "leader". Processor 0 is the leader of the first row.
+ */
+void NC3File::update_aggregation(const IceGrid &grid) {
+  std::vector<int> layout = {grid.xs(), grid.xm(), grid.ys(), grid.ym(),
+                             (int)grid.Mx(), (int)grid.My()};
+
+  // all processes have to agree
+  int changed = (layout != m_aggregation_layout), global_changed = 0;
+  MPI_Allreduce(&changed, &global_changed, 1, MPI_INT, MPI_MAX, m_com);
+
+  if (global_changed == 0) {
+    return;
+  }
+
+  if (m_row_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_row_comm);
+  }
+
+  if (m_leader_comm != MPI_COMM_NULL) {
+    MPI_Comm_free(&m_leader_comm);
+  }
+
+  MPI_Comm_split(m_com, grid.ys(), grid.xs(), &m_row_comm);
+
+  bool leader = (grid.xs() == 0);
+  MPI_Comm_split(m_com, leader ? 0 : MPI_UNDEFINED, grid.ys(), &m_leader_comm);
+
+  m_aggregation_layout = layout;
+}
+
+//! \brief Write a distributed array using aggregation.
+/*!
+ * Instead of sending each sub-domain to processor 0,
+ *
+ * 1. gather each row of sub-domains on its leader (using `MPI_Gatherv`),
+ * 2. re-arrange it into a slab covering whole rows of the grid,
+ * 3. send slabs to processor 0, which writes each one using a single NetCDF call.
+ *
+ * This way processor 0 receives one message per row of the processor grid (instead of
+ * one per processor) and writes contiguous parts of a variable.
+ */
+void NC3File::write_darray_impl(const std::string &variable_name,
+                                const IceGrid &grid,
+                                unsigned int z_count,
+                                unsigned int record,
+                                const double *input) {
+  std::vector<std::string> dims;
+  this->inq_vardimid(variable_name, dims);
+
+  unsigned int ndims = dims.size();
+
+  bool time_dependent = ((z_count  > 1 and ndims == 4) or
+                         (z_count == 1 and ndims == 3));
+
+  update_aggregation(grid);
+
+  const int
+    Mx = grid.Mx(),
+    Mz = z_count,
+    xm = grid.xm(),
+    ym = grid.ym();
+
+  const int header_tag = 1, data_tag = 2;
+
+  // Step 1: gather a row of sub-domains on its leader
+  int row_rank = 0, row_size = 1;
+  MPI_Comm_rank(m_row_comm, &row_rank);
+  MPI_Comm_size(m_row_comm, &row_size);
+
+  int patch[2] = {grid.xs(), xm};
+  std::vector<int> patches(2 * row_size), sizes(row_size), offsets(row_size);
+  MPI_Gather(patch, 2, MPI_INT, patches.data(), 2, MPI_INT, 0, m_row_comm);
+
+  std::vector<double> buffer;
+  if (row_rank == 0) {
+    int offset = 0;
+    for (int r = 0; r < row_size; ++r) {
+      sizes[r]   = patches[2 * r + 1] * ym * Mz;
+      offsets[r] = offset;
+      offset += sizes[r];
+    }
+    buffer.resize(offset);
+  }
+
+  MPI_Gatherv(const_cast<double*>(input), xm * ym * Mz, MPI_DOUBLE,
+              buffer.data(), sizes.data(), offsets.data(), MPI_DOUBLE, 0, m_row_comm);
+
+  if (row_rank != 0) {
+    // done: leaders write the rest
+    return;
+  }
+
+  // Step 2: re-arrange data into a slab (layout: y, x, z)
+  std::vector<double> slab(ym * Mx * Mz);
+  for (int r = 0; r < row_size; ++r) {
+    const int x0 = patches[2 * r], n = patches[2 * r + 1];
+    const double *patch_data = &buffer[offsets[r]];
+
+    for (int j = 0; j < ym; ++j) {
+      std::copy(patch_data + j * n * Mz, patch_data + (j + 1) * n * Mz,
+                &slab[(j * Mx + x0) * Mz]);
+    }
+  }
+  buffer.clear();
+
+  // Step 3: send slabs to processor 0
+  int leader_rank = 0, leader_size = 1;
+  MPI_Comm_rank(m_leader_comm, &leader_rank);
+  MPI_Comm_size(m_leader_comm, &leader_size);
+
+  if (leader_rank != 0) {
+    int header[2] = {grid.ys(), ym};
+    MPI_Send(header, 2, MPI_INT, 0, header_tag, m_leader_comm);
+    MPI_Send(slab.data(), slab.size(), MPI_DOUBLE, 0, data_tag, m_leader_comm);
+    return;
+  }
+
+  int varid = -1;
+  int stat = nc_inq_varid(m_file_id, variable_name.c_str(), &varid);
+  check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
+
+  MPI_Status mpi_stat;
+  for (int r = 0; r < leader_size; ++r) {
+    int header[2] = {grid.ys(), ym};
+
+    if (r != 0) {
+      MPI_Recv(header, 2, MPI_INT, r, header_tag, m_leader_comm, &mpi_stat);
+      slab.resize(header[1] * Mx * Mz);
+      MPI_Recv(slab.data(), slab.size(), MPI_DOUBLE, r, data_tag, m_leader_comm, &mpi_stat);
+    }
+
+    std::vector<size_t> start, count;
+
+    if (time_dependent) {
+      start.push_back(record);
+      count.push_back(1);
+    }
+
+    // y
+    start.push_back(header[0]);
+    count.push_back(header[1]);
+
+    // x
+    start.push_back(0);
+    count.push_back(Mx);
+
+    // z (not used when writing 2D fields)
+    start.push_back(0);
+    count.push_back(Mz);
+
+    stat = nc_put_vara_double(m_file_id, varid, start.data(), count.data(), slab.data());
+    check_and_abort(m_com, PISM_ERROR_LOCATION, stat);
+  }
+}
+
 //! \brief Get the number of variables.
 void NC3File::inq_nvars_impl(int &result) const {
   int stat = NC_NOERR;
@@ -70,6 +70,12 @@ protected:
                       const std::vector<unsigned int> &count,
                       const double *op) const;
 
+  void write_darray_impl(const std::string &variable_name,
+                         const IceGrid &grid,
+                         unsigned int z_count,
+                         unsigned int record,
+                         const double *input);
+
   void get_varm_double_impl(const std::string &variable_name,
                       const std::vector<unsigned int> &start,
                       const std::vector<unsigned int> &count,
@@ -106,6 +112,13 @@ protected:
 private:
   int m_rank;
 
+  // communicators used to aggregate data in write_darray_impl()
+  MPI_Comm m_row_comm, m_leader_comm;
+  // sub-domain and grid size used to create them
+  std::vector<int> m_aggregation_layout;
+
+  void update_aggregation(const IceGrid &grid);
+
   void get_var_double(const std::string &variable_name,
                      const std::vector<unsigned int> &start,
                      const std::vector<unsigned int> &count,
@@ -27,6 +27,11 @@
 #define MPI_INCLUDED 1
 #endif
 #include <netcdf.h>
+#include <netcdf_meta.h>         // NC_HAS_ZSTD
+
+#if defined(NC_HAS_ZSTD) && (NC_HAS_ZSTD==1)
+#include <netcdf_filter.h>       // nc_def_var_zstandard
+#endif
 
 #include "pism_type_conversion.hh"
 #include "pism/util/pism_utilities.hh"
@@ -156,6 +161,37 @@ void NC4File::def_var_chunking_impl(const std::string &name,
   check(PISM_ERROR_LOCATION, stat);
 }
 
+void NC4File::def_var_deflate_impl(const std::string &name, int shuffle, int deflate,
+                                   int level) const {
+  int stat = nc_def_var_deflate(m_file_id, get_varid(name), shuffle, deflate, level);
+  check(PISM_ERROR_LOCATION, stat);
+}
+
+void NC4File::def_var_zstandard_impl(const std::string &name, int level) const {
+#if defined(NC_HAS_ZSTD) && (NC_HAS_ZSTD==1)
+  int stat = nc_def_var_zstandard(m_file_id, get_varid(name), level);
+  check(PISM_ERROR_LOCATION, stat);
+#else
+  (void) level;
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "cannot compress '%s': NetCDF was built without Zstandard support",
+                                name.c_str());
+#endif
+}
+
+void NC4File::def_var_quantize_impl(const std::string &name, int significant_digits) const {
+#if defined(NC_QUANTIZE_BITGROOM)
+  int stat = nc_def_var_quantize(m_file_id, get_varid(name), NC_QUANTIZE_BITGROOM,
+                                 significant_digits);
+  check(PISM_ERROR_LOCATION, stat);
+#else
+  (void) significant_digits;
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "cannot quantize '%s': this requires NetCDF 4.9.0 or later",
+                                name.c_str());
+#endif
+}
+
 void NC4File::get_varm_double_impl(const std::string &variable_name,
                                   const std::vector<unsigned int> &start,
                                   const std::vector<unsigned int> &count,
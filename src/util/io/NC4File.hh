@@ -56,6 +56,13 @@ protected:
   virtual void def_var_chunking_impl(const std::string &name,
                                     std::vector<size_t> &dimensions) const;
 
+  virtual void def_var_deflate_impl(const std::string &name, int shuffle, int deflate,
+                                    int level) const;
+
+  virtual void def_var_zstandard_impl(const std::string &name, int level) const;
+
+  virtual void def_var_quantize_impl(const std::string &name, int significant_digits) const;
+
   virtual void def_var_impl(const std::string &name,
                            IO_Type nctype, const std::vector<std::string> &dims) const;
 
@@ -26,6 +26,7 @@
 extern "C" {
 #include <netcdf.h>
 #include <netcdf_par.h>
+#include <netcdf_meta.h>        // NC_HAS_PAR_FILTERS
 }
 
 namespace pism {
@@ -61,6 +62,39 @@ void NC4_Par::create_impl(const std::string &fname) {
   check(PISM_ERROR_LOCATION, stat);
 }
 
+// Writing compressed variables in parallel requires NetCDF 4.7.4 or later (and collective
+// access, see set_access_mode()).
+#if defined(NC_HAS_PAR_FILTERS) && (NC_HAS_PAR_FILTERS==1)
+#define PISM_PAR_FILTERS 1
+#else
+#define PISM_PAR_FILTERS 0
+#endif
+
+void NC4_Par::def_var_deflate_impl(const std::string &name, int shuffle, int deflate,
+                                   int level) const {
+#if (PISM_PAR_FILTERS==1)
+  NC4File::def_var_deflate_impl(name, shuffle, deflate, level);
+#else
+  (void) shuffle;
+  (void) deflate;
+  (void) level;
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "cannot compress '%s': parallel compression requires NetCDF 4.7.4 or later",
+                                name.c_str());
+#endif
+}
+
+void NC4_Par::def_var_zstandard_impl(const std::string &name, int level) const {
+#if (PISM_PAR_FILTERS==1)
+  NC4File::def_var_zstandard_impl(name, level);
+#else
+  (void) level;
+  throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                "cannot compress '%s': parallel compression requires NetCDF 4.7.4 or later",
+                                name.c_str());
+#endif
+}
+
 void NC4_Par::set_access_mode(int varid, bool transposed) const {
   int stat;
 
@@ -36,6 +36,11 @@ protected:
 
   virtual void create_impl(const std::string &filename);
 
+  virtual void def_var_deflate_impl(const std::string &name, int shuffle, int deflate,
+                                    int level) const;
+
+  virtual void def_var_zstandard_impl(const std::string &name, int level) const;
+
   virtual void set_access_mode(int varid, bool mapped) const;
 };
 
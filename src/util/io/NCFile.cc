@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -33,8 +33,30 @@
 namespace pism {
 namespace io {
 
+std::recursive_mutex& netcdf_mutex() {
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+
+namespace {
+
+//! Locks netcdf_mutex() if `enabled` is true.
+class Lock {
+public:
+  Lock(bool enabled)
+    : m_lock(netcdf_mutex(), std::defer_lock) {
+    if (enabled) {
+      m_lock.lock();
+    }
+  }
+private:
+  std::unique_lock<std::recursive_mutex> m_lock;
+};
+
+} // end of anonymous namespace
+
 NCFile::NCFile(MPI_Comm c)
-  : m_com(c), m_file_id(-1), m_define_mode(false) {
+  : m_com(c), m_file_id(-1), m_use_lock(true), m_define_mode(false) {
 }
 
 NCFile::~NCFile() {
@@ -52,31 +74,57 @@ void NCFile::def_var_chunking_impl(const std::string &name,
   // the default implementation does nothing
 }
 
+void NCFile::def_var_deflate_impl(const std::string &name, int shuffle, int deflate,
+                                  int level) const {
+  (void) name;
+  (void) shuffle;
+  (void) deflate;
+  (void) level;
+  // the default implementation does nothing (compression is not supported)
+}
+
+void NCFile::def_var_zstandard_impl(const std::string &name, int level) const {
+  (void) name;
+  (void) level;
+  // the default implementation does nothing (compression is not supported)
+}
+
+void NCFile::def_var_quantize_impl(const std::string &name, int significant_digits) const {
+  (void) name;
+  (void) significant_digits;
+  // the default implementation does nothing (quantization is not supported)
+}
+
 
 void NCFile::open(const std::string &filename, IO_Mode mode) {
+  Lock lock(m_use_lock);
   this->open_impl(filename, mode);
   m_filename = filename;
   m_define_mode = false;
 }
 
 void NCFile::create(const std::string &filename) {
+  Lock lock(m_use_lock);
   this->create_impl(filename);
   m_filename = filename;
   m_define_mode = true;
 }
 
 void NCFile::sync() const {
+  Lock lock(m_use_lock);
   enddef();
   this->sync_impl();
 }
 
 void NCFile::close() {
+  Lock lock(m_use_lock);
   this->close_impl();
   m_filename.clear();
   m_file_id = -1;
 }
 
 void NCFile::enddef() const {
+  Lock lock(m_use_lock);
   if (m_define_mode) {
     this->enddef_impl();
     m_define_mode = false;
@@ -84,6 +132,7 @@ void NCFile::enddef() const {
 }
 
 void NCFile::redef() const {
+  Lock lock(m_use_lock);
   if (not m_define_mode) {
     this->redef_impl();
     m_define_mode = true;
@@ -91,38 +140,63 @@ void NCFile::redef() const {
 }
 
 void NCFile::def_dim(const std::string &name, size_t length) const {
+  Lock lock(m_use_lock);
   redef();
   this->def_dim_impl(name, length);
 }
 
 void NCFile::inq_dimid(const std::string &dimension_name, bool &exists) const {
+  Lock lock(m_use_lock);
   this->inq_dimid_impl(dimension_name,exists);
 }
 
 void NCFile::inq_dimlen(const std::string &dimension_name, unsigned int &result) const {
+  Lock lock(m_use_lock);
   this->inq_dimlen_impl(dimension_name,result);
 }
 
 void NCFile::inq_unlimdim(std::string &result) const {
+  Lock lock(m_use_lock);
   this->inq_unlimdim_impl(result);
 }
 
 void NCFile::def_var(const std::string &name, IO_Type nctype,
                     const std::vector<std::string> &dims) const {
+  Lock lock(m_use_lock);
   redef();
   this->def_var_impl(name, nctype, dims);
 }
 
 void NCFile::def_var_chunking(const std::string &name,
                               std::vector<size_t> &dimensions) const {
+  Lock lock(m_use_lock);
   this->def_var_chunking_impl(name, dimensions);
 }
 
+void NCFile::def_var_deflate(const std::string &name, int shuffle, int deflate, int level) const {
+  Lock lock(m_use_lock);
+  redef();
+  this->def_var_deflate_impl(name, shuffle, deflate, level);
+}
+
+void NCFile::def_var_zstandard(const std::string &name, int level) const {
+  Lock lock(m_use_lock);
+  redef();
+  this->def_var_zstandard_impl(name, level);
+}
+
+void NCFile::def_var_quantize(const std::string &name, int significant_digits) const {
+  Lock lock(m_use_lock);
+  redef();
+  this->def_var_quantize_impl(name, significant_digits);
+}
+
 
 void NCFile::get_vara_double(const std::string &variable_name,
                             const std::vector<unsigned int> &start,
                             const std::vector<unsigned int> &count,
                             double *ip) const {
+  Lock lock(m_use_lock);
 #if (Pism_DEBUG==1)
   if (start.size() != count.size()) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
@@ -138,6 +212,7 @@ void NCFile::put_vara_double(const std::string &variable_name,
                             const std::vector<unsigned int> &start,
                             const std::vector<unsigned int> &count,
                             const double *op) const {
+  Lock lock(m_use_lock);
 #if (Pism_DEBUG==1)
   if (start.size() != count.size()) {
     throw RuntimeError::formatted(PISM_ERROR_LOCATION,
@@ -150,11 +225,53 @@ void NCFile::put_vara_double(const std::string &variable_name,
 }
 
 
+/*!
+ * Start reading a hyperslab of `variable_name` into `ip`.
+ *
+ * The read is complete (and `ip` can be used) only after the following call of
+ * wait_all(). Backends supporting non-blocking reads can combine all reads started before
+ * wait_all() into fewer (larger) I/O requests.
+ */
+void NCFile::iget_vara_double(const std::string &variable_name,
+                              const std::vector<unsigned int> &start,
+                              const std::vector<unsigned int> &count,
+                              double *ip) const {
+  Lock lock(m_use_lock);
+#if (Pism_DEBUG==1)
+  if (start.size() != count.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "start and count arrays have to have the same size");
+  }
+#endif
+
+  enddef();
+  this->iget_vara_double_impl(variable_name, start, count, ip);
+}
+
+//! Wait for all reads started using iget_vara_double() and all pending writes.
+void NCFile::wait_all() const {
+  Lock lock(m_use_lock);
+  this->wait_all_impl();
+}
+
+//! The default implementation reads immediately.
+void NCFile::iget_vara_double_impl(const std::string &variable_name,
+                                   const std::vector<unsigned int> &start,
+                                   const std::vector<unsigned int> &count,
+                                   double *ip) const {
+  this->get_vara_double_impl(variable_name, start, count, ip);
+}
+
+void NCFile::wait_all_impl() const {
+  // the default implementation does nothing (iget_vara_double_impl() reads immediately)
+}
+
 void NCFile::write_darray(const std::string &variable_name,
                           const IceGrid &grid,
                           unsigned int z_count,
                           unsigned int record,
                           const double *input) {
+  Lock lock(m_use_lock);
   enddef();
   this->write_darray_impl(variable_name, grid, z_count, record, input);
 }
@@ -204,6 +321,7 @@ void NCFile::get_varm_double(const std::string &variable_name,
                             const std::vector<unsigned int> &count,
                             const std::vector<unsigned int> &imap,
                             double *ip) const {
+  Lock lock(m_use_lock);
 
 #if (Pism_DEBUG==1)
   if (start.size() != count.size() or
@@ -218,34 +336,41 @@ void NCFile::get_varm_double(const std::string &variable_name,
 }
 
 void NCFile::inq_nvars(int &result) const {
+  Lock lock(m_use_lock);
   this->inq_nvars_impl(result);
 }
 
 void NCFile::inq_vardimid(const std::string &variable_name, std::vector<std::string> &result) const {
+  Lock lock(m_use_lock);
   this->inq_vardimid_impl(variable_name, result);
 }
 
 void NCFile::inq_varnatts(const std::string &variable_name, int &result) const {
+  Lock lock(m_use_lock);
   this->inq_varnatts_impl(variable_name, result);
 }
 
 void NCFile::inq_varid(const std::string &variable_name, bool &result) const {
+  Lock lock(m_use_lock);
   this->inq_varid_impl(variable_name, result);
 }
 
 void NCFile::inq_varname(unsigned int j, std::string &result) const {
+  Lock lock(m_use_lock);
   this->inq_varname_impl(j, result);
 }
 
 void NCFile::get_att_double(const std::string &variable_name,
                             const std::string &att_name,
                             std::vector<double> &result) const {
+  Lock lock(m_use_lock);
   this->get_att_double_impl(variable_name, att_name, result);
 }
 
 void NCFile::get_att_text(const std::string &variable_name,
                           const std::string &att_name,
                           std::string &result) const {
+  Lock lock(m_use_lock);
   this->get_att_text_impl(variable_name, att_name, result);
 }
 
@@ -253,33 +378,39 @@ void NCFile::put_att_double(const std::string &variable_name,
                             const std::string &att_name,
                             IO_Type xtype,
                             const std::vector<double> &data) const {
+  Lock lock(m_use_lock);
   this->put_att_double_impl(variable_name, att_name, xtype, data);
 }
 
 void NCFile::put_att_text(const std::string &variable_name,
                           const std::string &att_name,
                           const std::string &value) const {
+  Lock lock(m_use_lock);
   this->put_att_text_impl(variable_name, att_name, value);
 }
 
 void NCFile::inq_attname(const std::string &variable_name,
                          unsigned int n,
                          std::string &result) const {
+  Lock lock(m_use_lock);
   this->inq_attname_impl(variable_name, n, result);
 }
 
 void NCFile::inq_atttype(const std::string &variable_name,
                          const std::string &att_name,
                          IO_Type &result) const {
+  Lock lock(m_use_lock);
   this->inq_atttype_impl(variable_name, att_name, result);
 }
 
 void NCFile::set_fill(int fillmode, int &old_modep) const {
+  Lock lock(m_use_lock);
   redef();
   this->set_fill_impl(fillmode, old_modep);
 }
 
 void NCFile::del_att(const std::string &variable_name, const std::string &att_name) const {
+  Lock lock(m_use_lock);
   this->del_att_impl(variable_name, att_name);
 }
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -22,6 +22,7 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <mutex>
 
 #include <mpi.h>
 
@@ -34,6 +35,13 @@ class IceGrid;
 //! Input and output code (NetCDF wrappers, etc)
 namespace io {
 
+//! Mutex used to serialize calls to the NetCDF library (it is not thread-safe).
+/*!
+ * Locked by NCFile methods (unless `m_use_lock` is false) and by the background writer
+ * thread used by NC3AsyncFile.
+ */
+std::recursive_mutex& netcdf_mutex();
+
 //! \brief The PISM wrapper for a subset of the NetCDF C API.
 /*!
  * The goal of this class is to hide the fact that we need to communicate data
@@ -90,11 +98,24 @@ public:
 
   void def_var_chunking(const std::string &name, std::vector<size_t> &dimensions) const;
 
+  void def_var_deflate(const std::string &name, int shuffle, int deflate, int level) const;
+
+  void def_var_zstandard(const std::string &name, int level) const;
+
+  void def_var_quantize(const std::string &name, int significant_digits) const;
+
   void get_vara_double(const std::string &variable_name,
                        const std::vector<unsigned int> &start,
                        const std::vector<unsigned int> &count,
                        double *ip) const;
 
+  void iget_vara_double(const std::string &variable_name,
+                        const std::vector<unsigned int> &start,
+                        const std::vector<unsigned int> &count,
+                        double *ip) const;
+
+  void wait_all() const;
+
   void put_vara_double(const std::string &variable_name,
                        const std::vector<unsigned int> &start,
                        const std::vector<unsigned int> &count,
@@ -176,6 +197,13 @@ protected:
   virtual void def_var_chunking_impl(const std::string &name,
                                     std::vector<size_t> &dimensions) const;
 
+  virtual void def_var_deflate_impl(const std::string &name, int shuffle, int deflate,
+                                    int level) const;
+
+  virtual void def_var_zstandard_impl(const std::string &name, int level) const;
+
+  virtual void def_var_quantize_impl(const std::string &name, int significant_digits) const;
+
   virtual void get_vara_double_impl(const std::string &variable_name,
                                    const std::vector<unsigned int> &start,
                                    const std::vector<unsigned int> &count,
@@ -198,6 +226,13 @@ protected:
                                    const std::vector<unsigned int> &imap,
                                    double *ip) const = 0;
 
+  virtual void iget_vara_double_impl(const std::string &variable_name,
+                                     const std::vector<unsigned int> &start,
+                                     const std::vector<unsigned int> &count,
+                                     double *ip) const;
+
+  virtual void wait_all_impl() const;
+
   virtual void inq_nvars_impl(int &result) const = 0;
 
   virtual void inq_vardimid_impl(const std::string &variable_name, std::vector<std::string> &result) const = 0;
@@ -231,6 +266,8 @@ protected:                      // data members
   MPI_Comm m_com;
   int m_file_id;
   std::string m_filename;
+  //! true if calls to implementations should lock netcdf_mutex()
+  bool m_use_lock;
 private:
   mutable bool m_define_mode;
 };
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -67,12 +67,15 @@ void PNCFile::create_impl(const std::string &fname) {
 }
 
 void PNCFile::sync_impl() const {
+  wait_all_impl();
 
   int stat = ncmpi_sync(m_file_id); check(PISM_ERROR_LOCATION, stat);
 }
 
 
 void PNCFile::close_impl() {
+  wait_all_impl();
+
   int stat = ncmpi_close(m_file_id); check(PISM_ERROR_LOCATION, stat);
 
   m_file_id = -1;
@@ -86,6 +89,7 @@ void PNCFile::enddef_impl() const {
 
 
 void PNCFile::redef_impl() const {
+  wait_all_impl();
 
   int stat = ncmpi_redef(m_file_id); check(PISM_ERROR_LOCATION, stat);
 }
@@ -164,26 +168,40 @@ void PNCFile::get_vara_double_impl(const std::string &variable_name,
 }
 
 
+/*!
+ * Start writing a hyperslab of `variable_name`.
+ *
+ * Writes are non-blocking: `op` is copied and the write is completed by the following
+ * call of wait_all() (or sync(), redef() and close()). This way PnetCDF can merge all the
+ * writes of an output event into a few large I/O requests.
+ */
 void PNCFile::put_vara_double_impl(const std::string &variable_name,
                                   const std::vector<unsigned int> &start,
                                   const std::vector<unsigned int> &count,
                                   const double *op) const {
   int stat, varid, ndims = static_cast<int>(start.size());
 
-  std::vector<MPI_Offset> nc_start(ndims), nc_count(ndims), nc_stride(ndims);
+  std::vector<MPI_Offset> nc_start(ndims), nc_count(ndims);
 
   stat = ncmpi_inq_varid(m_file_id, variable_name.c_str(), &varid);
   check(PISM_ERROR_LOCATION, stat);
 
+  size_t size = 1;
   for (int j = 0; j < ndims; ++j) {
-    nc_start[j]  = start[j];
-    nc_count[j]  = count[j];
-    nc_stride[j] = 1;
+    nc_start[j] = start[j];
+    nc_count[j] = count[j];
+    size *= count[j];
   }
 
-  stat = ncmpi_put_vara_double_all(m_file_id, varid,
-                                   &nc_start[0], &nc_count[0],
-                                   op); check(PISM_ERROR_LOCATION, stat);
+  // the caller may re-use op before the write is complete
+  m_write_buffers.emplace_back(op, op + size);
+
+  int request = 0;
+  stat = ncmpi_iput_vara_double(m_file_id, varid, &nc_start[0], &nc_count[0],
+                                m_write_buffers.back().data(), &request);
+  check(PISM_ERROR_LOCATION, stat);
+
+  m_requests.push_back(request);
 }
 
 
@@ -197,6 +215,46 @@ void PNCFile::get_varm_double_impl(const std::string &variable_name,
 }
 
 
+void PNCFile::iget_vara_double_impl(const std::string &variable_name,
+                                    const std::vector<unsigned int> &start,
+                                    const std::vector<unsigned int> &count,
+                                    double *ip) const {
+  int stat, varid, ndims = static_cast<int>(start.size());
+
+  std::vector<MPI_Offset> nc_start(ndims), nc_count(ndims);
+
+  stat = ncmpi_inq_varid(m_file_id, variable_name.c_str(), &varid);
+  check(PISM_ERROR_LOCATION, stat);
+
+  for (int j = 0; j < ndims; ++j) {
+    nc_start[j] = start[j];
+    nc_count[j] = count[j];
+  }
+
+  int request = 0;
+  stat = ncmpi_iget_vara_double(m_file_id, varid, &nc_start[0], &nc_count[0], ip, &request);
+  check(PISM_ERROR_LOCATION, stat);
+
+  m_requests.push_back(request);
+}
+
+void PNCFile::wait_all_impl() const {
+  if (m_requests.empty()) {
+    return;
+  }
+
+  std::vector<int> statuses(m_requests.size());
+
+  int stat = ncmpi_wait_all(m_file_id, m_requests.size(), &m_requests[0], &statuses[0]);
+  m_requests.clear();
+  m_write_buffers.clear();
+  check(PISM_ERROR_LOCATION, stat);
+
+  for (auto s : statuses) {
+    check(PISM_ERROR_LOCATION, s);
+  }
+}
+
 void PNCFile::inq_nvars_impl(int &result) const {
   int stat;
 
@@ -394,6 +452,9 @@ void PNCFile::get_var_double(const std::string &variable_name,
                             const std::vector<unsigned int> &count,
                             const std::vector<unsigned int> &imap_input, double *ip,
                             bool transposed) const {
+  // complete pending writes (they may overlap this read)
+  wait_all_impl();
+
   std::vector<unsigned int> imap = imap_input;
   int stat, varid, ndims = static_cast<int>(start.size());
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019 PISM Authors
+// Copyright (C) 2012, 2013, 2014, 2015, 2016, 2017, 2019, 2020 PISM Authors
 //
 // This file is part of PISM.
 //
@@ -78,6 +78,13 @@ protected:
                       const std::vector<unsigned int> &imap,
                       double *ip) const;
 
+  void iget_vara_double_impl(const std::string &variable_name,
+                             const std::vector<unsigned int> &start,
+                             const std::vector<unsigned int> &count,
+                             double *ip) const;
+
+  void wait_all_impl() const;
+
   void inq_nvars_impl(int &result) const;
 
   void inq_vardimid_impl(const std::string &variable_name, std::vector<std::string> &result) const;
@@ -126,6 +133,13 @@ private:
   int get_varid(const std::string &variable_name) const;
 
   MPI_Info m_mpi_info;            // MPI hints
+
+  //! pending non-blocking read and write requests (see iget_vara_double_impl() and
+  //! put_vara_double_impl())
+  mutable std::vector<int> m_requests;
+
+  //! copies of data written by pending write requests
+  mutable std::vector<std::vector<double> > m_write_buffers;
 };
 
 } // end of namespace io
@@ -0,0 +1,317 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include <algorithm>            // std::copy
+#include <cstring>              // memcpy, strncpy
+#include <random>
+
+#include <fcntl.h>              // open
+#include <sys/mman.h>           // mmap, munmap
+#include <sys/stat.h>           // fstat
+#include <unistd.h>             // close
+
+#include "Patches.hh"
+#include "File.hh"
+#include "pism/util/IceGrid.hh"
+#include "pism/util/pism_utilities.hh"
+#include "pism/util/error_handling.hh"
+
+namespace pism {
+namespace io {
+
+namespace {
+
+const char magic[8] = {'P', 'I', 'S', 'M', 'P', 'T', 'C', 'H'};
+const uint32_t version = 1;
+
+//! The trailer at the end of a patch file.
+struct Trailer {
+  char magic[8];
+  uint32_t version;
+  int32_t layout[6];
+  uint64_t index_offset;
+  uint64_t n_entries;
+  char id[64];
+};
+
+//! Sub-domain owned by the current process and the grid size.
+std::vector<int> layout(const IceGrid &grid) {
+  return {(int)grid.Mx(), (int)grid.My(), grid.xs(), grid.xm(), grid.ys(), grid.ym()};
+}
+
+template<typename T>
+void write_value(FILE *f, const T &value) {
+  if (fwrite(&value, sizeof(T), 1, f) != 1) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "fwrite failed");
+  }
+}
+
+//! Read a value of type T from `data` (of length `length`), starting at `offset`.
+template<typename T>
+T read_value(const char *data, size_t length, size_t &offset) {
+  if (offset + sizeof(T) > length) {
+    throw RuntimeError(PISM_ERROR_LOCATION, "truncated patch file");
+  }
+  T result;
+  memcpy(&result, data + offset, sizeof(T));
+  offset += sizeof(T);
+  return result;
+}
+
+} // end of anonymous namespace
+
+std::string patch_filename(const std::string &filename, int rank) {
+  return pism::printf("%s.patch.%d", filename.c_str(), rank);
+}
+
+PatchWriter::PatchWriter(const File &file, const IceGrid &grid)
+  : m_file(nullptr), m_offset(0) {
+
+  MPI_Comm com = file.com();
+
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  // generate a random identifier on rank 0 and use it on all ranks
+  unsigned long int id = 0;
+  if (rank == 0) {
+    std::random_device device;
+    std::mt19937_64 generator(device());
+    id = generator();
+  }
+  MPI_Bcast(&id, 1, MPI_UNSIGNED_LONG, 0, com);
+
+  m_id       = pism::printf("%016lx", id);
+  m_layout   = layout(grid);
+  m_filename = patch_filename(file.filename(), rank);
+
+  m_file = fopen(m_filename.c_str(), "wb");
+  if (m_file == nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "failed to create '%s'",
+                                  m_filename.c_str());
+  }
+
+  file.write_attribute("PISM_GLOBAL", "pism_patch_id", m_id);
+}
+
+PatchWriter::~PatchWriter() {
+  try {
+    close();
+  } catch (...) {
+    // don't ever throw from here
+    handle_fatal_errors(MPI_COMM_SELF);
+  }
+}
+
+/*!
+ * Write a patch of the variable `variable_name`; `record` is the record index in the
+ * NetCDF file (-1 if the variable is time-independent).
+ *
+ * If a variable is written more than once only the last patch is kept in the index.
+ */
+void PatchWriter::write(const std::string &variable_name, int record,
+                        const double *data, size_t size) {
+  if (m_file == nullptr) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "'%s' is closed", m_filename.c_str());
+  }
+
+  if (size > 0 and fwrite(data, sizeof(double), size, m_file) != size) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "failed to write '%s' to '%s'",
+                                  variable_name.c_str(), m_filename.c_str());
+  }
+
+  m_index[variable_name] = {record, m_offset, size};
+
+  m_offset += size * sizeof(double);
+}
+
+//! Write the index and the trailer and close the patch file.
+void PatchWriter::close() {
+  if (m_file == nullptr) {
+    return;
+  }
+
+  try {
+    for (const auto &e : m_index) {
+      const std::string &name = e.first;
+
+      write_value(m_file, (uint32_t)name.size());
+      if (fwrite(name.c_str(), 1, name.size(), m_file) != name.size()) {
+        throw RuntimeError(PISM_ERROR_LOCATION, "fwrite failed");
+      }
+      write_value(m_file, (int32_t)e.second.record);
+      write_value(m_file, e.second.offset);
+      write_value(m_file, e.second.size);
+    }
+
+    Trailer trailer;
+    memset(&trailer, 0, sizeof(Trailer));
+    memcpy(trailer.magic, magic, sizeof(magic));
+    trailer.version = version;
+    std::copy(m_layout.begin(), m_layout.end(), trailer.layout);
+    trailer.index_offset = m_offset;
+    trailer.n_entries    = m_index.size();
+    strncpy(trailer.id, m_id.c_str(), sizeof(trailer.id) - 1);
+
+    write_value(m_file, trailer);
+  } catch (RuntimeError &e) {
+    fclose(m_file);
+    m_file = nullptr;
+    e.add_context("writing the index to '%s'", m_filename.c_str());
+    throw;
+  }
+
+  if (fclose(m_file) != 0) {
+    m_file = nullptr;
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION, "failed to close '%s'",
+                                  m_filename.c_str());
+  }
+  m_file = nullptr;
+}
+
+PatchReader::PatchReader(MPI_Comm com)
+  : m_com(com), m_data(nullptr), m_length(0) {
+  // empty
+}
+
+PatchReader::~PatchReader() {
+  if (m_data != nullptr) {
+    munmap(m_data, m_length);
+  }
+}
+
+/*!
+ * Memory-map the patch file written for the NetCDF file `filename` by this process.
+ *
+ * Collective: returns NULL if a patch file is missing, damaged, or does not match `id` on
+ * at least one process.
+ */
+std::shared_ptr<PatchReader> PatchReader::open(MPI_Comm com,
+                                               const std::string &filename,
+                                               const std::string &id) {
+  int rank = 0;
+  MPI_Comm_rank(com, &rank);
+
+  std::shared_ptr<PatchReader> result(new PatchReader(com));
+
+  int success = result->open_impl(patch_filename(filename, rank), id) ? 1 : 0;
+
+  int all_success = 0;
+  MPI_Allreduce(&success, &all_success, 1, MPI_INT, MPI_LAND, com);
+
+  if (all_success == 0) {
+    return nullptr;
+  }
+
+  return result;
+}
+
+bool PatchReader::open_impl(const std::string &filename, const std::string &id) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 or (size_t)info.st_size < sizeof(Trailer)) {
+    ::close(fd);
+    return false;
+  }
+
+  m_length = info.st_size;
+  void *data = mmap(nullptr, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  m_data = data;
+
+  const char *bytes = static_cast<const char*>(m_data);
+
+  try {
+    size_t offset = m_length - sizeof(Trailer);
+    auto trailer = read_value<Trailer>(bytes, m_length, offset);
+
+    if (memcmp(trailer.magic, magic, sizeof(magic)) != 0 or
+        trailer.version != version or
+        std::string(trailer.id, strnlen(trailer.id, sizeof(trailer.id))) != id) {
+      return false;
+    }
+
+    m_layout = std::vector<int>(trailer.layout, trailer.layout + 6);
+
+    offset = trailer.index_offset;
+    for (uint64_t k = 0; k < trailer.n_entries; ++k) {
+      auto length = read_value<uint32_t>(bytes, m_length, offset);
+      if (offset + length > m_length) {
+        return false;
+      }
+      std::string name(bytes + offset, length);
+      offset += length;
+
+      Entry entry;
+      entry.record   = read_value<int32_t>(bytes, m_length, offset);
+      auto position  = read_value<uint64_t>(bytes, m_length, offset);
+      entry.size     = read_value<uint64_t>(bytes, m_length, offset);
+
+      if (position + entry.size * sizeof(double) > trailer.index_offset) {
+        return false;
+      }
+      // data start at the beginning of the file (which is page-aligned) and each
+      // patch is a whole number of doubles, so this pointer is properly aligned
+      entry.data = reinterpret_cast<const double*>(bytes + position);
+
+      m_index[name] = entry;
+    }
+  } catch (RuntimeError &e) {
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * Read the patch of `variable_name` (record `record`) into `output` (of length `size`).
+ *
+ * Collective: returns false on all processes if the patch is not available (or does not
+ * match the domain decomposition of `grid`) on at least one process.
+ */
+bool PatchReader::read(const IceGrid &grid, const std::string &variable_name,
+                       unsigned int record, size_t size, double *output) const {
+  auto e = m_index.find(variable_name);
+
+  int success = (e != m_index.end() and
+                 (e->second.record == -1 or e->second.record == (int)record) and
+                 e->second.size == size and
+                 m_layout == layout(grid)) ? 1 : 0;
+
+  int all_success = 0;
+  MPI_Allreduce(&success, &all_success, 1, MPI_INT, MPI_LAND, m_com);
+
+  if (all_success == 0) {
+    return false;
+  }
+
+  std::copy(e->second.data, e->second.data + size, output);
+
+  return true;
+}
+
+} // end of namespace io
+} // end of namespace pism
@@ -0,0 +1,107 @@
+// Copyright (C) 2020 PISM Authors
+//
+// This file is part of PISM.
+//
+// PISM is free software; you can redistribute it and/or modify it under the
+// terms of the GNU General Public License as published by the Free Software
+// Foundation; either version 3 of the License, or (at your option) any later
+// version.
+//
+// PISM is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+// details.
+//
+// You should have received a copy of the GNU General Public License
+// along with PISM; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef _PISMPATCHES_H_
+#define _PISMPATCHES_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+namespace pism {
+
+class File;
+class IceGrid;
+
+namespace io {
+
+/*!
+ * "Patch files" store copies of sub-domains ("patches") of spatial variables written to a
+ * NetCDF file, one binary file per MPI process. Patches are stored in PISM's memory order
+ * and in internal units, so a run using the same grid and domain decomposition can read
+ * them back without communication, unit conversion, or calls to the NetCDF library.
+ *
+ * The patch file written by the process `rank` for the NetCDF file `filename` is called
+ * `filename.patch.rank`. It contains data followed by an index and a trailer recording the
+ * domain decomposition and a random identifier. The same identifier is saved in the
+ * NetCDF file (global attribute `pism_patch_id`) to detect stale patch files.
+ */
+std::string patch_filename(const std::string &filename, int rank);
+
+//! Writes patches of spatial variables written to a NetCDF file (see patch_filename()).
+class PatchWriter {
+public:
+  PatchWriter(const File &file, const IceGrid &grid);
+  ~PatchWriter();
+
+  void write(const std::string &variable_name, int record,
+             const double *data, size_t size);
+
+  void close();
+private:
+  struct Entry {
+    int record;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  std::string m_filename;
+  std::string m_id;
+  std::vector<int> m_layout;
+  FILE *m_file;
+  uint64_t m_offset;
+  std::map<std::string, Entry> m_index;
+};
+
+//! Reads patches of spatial variables using a memory-mapped patch file (see patch_filename()).
+class PatchReader {
+public:
+  static std::shared_ptr<PatchReader> open(MPI_Comm com,
+                                           const std::string &filename,
+                                           const std::string &id);
+  ~PatchReader();
+
+  bool read(const IceGrid &grid, const std::string &variable_name, unsigned int record,
+            size_t size, double *output) const;
+private:
+  PatchReader(MPI_Comm com);
+
+  bool open_impl(const std::string &filename, const std::string &id);
+
+  struct Entry {
+    int record;
+    const double *data;
+    uint64_t size;
+  };
+
+  MPI_Comm m_com;
+  void *m_data;
+  size_t m_length;
+  std::vector<int> m_layout;
+  std::map<std::string, Entry> m_index;
+};
+
+} // end of namespace io
+} // end of namespace pism
+
+#endif /* _PISMPATCHES_H_ */
@@ -19,6 +19,9 @@
 
 #include <memory>
 #include <cassert>
+#include <cstdlib>              // strtol
+#include <cmath>                // std::isnan
+#include <limits>
 
 #include "io_helpers.hh"
 #include "File.hh"
@@ -28,12 +31,18 @@
 #include "pism/util/pism_utilities.hh"
 #include "pism/util/ConfigInterface.hh"
 #include "pism/util/io/LocalInterpCtx.hh"
+#include "pism/util/io/Patches.hh"
+#include "pism/util/io/DeltaEncoder.hh"
 #include "pism/util/Time.hh"
 #include "pism/util/Logger.hh"
 #include "pism/util/Context.hh"
 #include "pism/util/projection.hh"
 #include "pism/util/interpolation.hh"
 #include "pism/util/Profiling.hh"
+#include "pism/util/iceModelVec.hh"
+#include "pism/util/petscwrappers/Vec.hh"
+#include "pism/util/petscwrappers/IS.hh"
+#include "pism/util/petscwrappers/VecScatter.hh"
 
 namespace pism {
 namespace io {
@@ -45,7 +54,7 @@ namespace io {
  * Note that its inputs are (essentially)
  * - the definition of the input grid
  * - the definition of the output grid
- * - input array (lic->buffer)
+ * - input array (`input_array`, of the size of lic->buffer)
  * - output array (double *output_array)
  *
  * The `output_array` is expected to be big enough to contain
@@ -55,14 +64,14 @@ namespace io {
  * fairly easily...
  */
 static void regrid(const IceGrid& grid, const std::vector<double> &zlevels_out,
-                   LocalInterpCtx *lic, double *output_array) {
+                   const LocalInterpCtx *lic, const double *input_array,
+                   double *output_array) {
   // We'll work with the raw storage here so that the array we are filling is
   // indexed the same way as the buffer we are pulling from (input_array)
 
   const int X = 1, Z = 3; // indices, just for clarity
 
   unsigned int nlevels = zlevels_out.size();
-  double *input_array = &(lic->buffer[0]);
 
   // array sizes for mapping from logical to "flat" indices
   int
@@ -362,6 +371,10 @@ void write_dimensions(const SpatialVariableMetadata& var,
  * Check if the storage order of a variable in the current file
  * matches the memory storage order used by PISM.
  *
+ * Variables written by PISM have the attribute "pism_storage_order" (see
+ * define_spatial_variable()). If it matches the list of dimensions of a variable we know
+ * that storage orders match and do not need to look at coordinate variables.
+ *
  * @param[in] file input file
  * @param var_name name of the variable to check
  * @returns false if storage orders match, true otherwise
@@ -372,6 +385,12 @@ static bool use_transposed_io(const File &file,
 
   std::vector<std::string> dimnames = file.dimensions(var_name);
 
+  // Note: tools like ncpdq change the order of dimensions but keep attributes, so we
+  // compare the attribute to the actual list of dimensions.
+  if (file.read_text_attribute(var_name, "pism_storage_order") == join(dimnames, ",")) {
+    return false;
+  }
+
   std::vector<AxisType> storage, memory = {Y_AXIS, X_AXIS};
 
   for (unsigned int j = 0; j < dimnames.size(); ++j) {
@@ -408,10 +427,14 @@ static bool use_transposed_io(const File &file,
 }
 
 //! \brief Read an array distributed according to the grid.
+/*!
+ * If `nonblocking` is true the read may be completed by the following call of
+ * File::wait_all() (reads that need mapped I/O are always blocking).
+ */
 static void read_distributed_array(const File &file, const IceGrid &grid,
                                    const std::string &var_name,
                                    unsigned int z_count, unsigned int t_start,
-                                   double *output) {
+                                   double *output, bool nonblocking = false) {
   try {
     std::vector<unsigned int> start, count, imap;
     const unsigned int t_count = 1;
@@ -427,6 +450,8 @@ static void read_distributed_array(const File &file, const IceGrid &grid,
     bool transposed_io = use_transposed_io(file, grid.ctx()->unit_system(), var_name);
     if (transposed_io) {
       file.read_variable_transposed(var_name, start, count, imap, output);
+    } else if (nonblocking) {
+      file.read_variable_nonblocking(var_name, start, count, output);
     } else {
       file.read_variable(var_name, start, count, output);
     }
@@ -438,10 +463,17 @@ static void read_distributed_array(const File &file, const IceGrid &grid,
   }
 }
 
+/*!
+ * Read `t_count` records starting from `t_start` using one hyperslab call and interpolate
+ * them. Interpolated records are stored one after another in `output`:
+ * `output` has to have room for `t_count * grid.xm() * grid.ym() * zlevels_out.size()`
+ * numbers.
+ */
 static void regrid_vec_generic(const File &file, const IceGrid &grid,
                                const std::string &variable_name,
                                const std::vector<double> &zlevels_out,
                                unsigned int t_start,
+                               unsigned int t_count,
                                bool fill_missing,
                                double default_value,
                                InterpolationType interpolation_type,
@@ -451,12 +483,17 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
   const Profiling& profiling = grid.ctx()->profiling();
 
   try {
-    grid_info gi(file, variable_name, grid.ctx()->unit_system(), grid.registration());
-    LocalInterpCtx lic(gi, grid, zlevels_out, interpolation_type);
-
-    std::vector<double> &buffer = lic.buffer;
+    // interpolation contexts are shared by all variables using the same dimensions
+    LocalInterpCtx &lic = file.regridding_cache().context(file, variable_name, grid,
+                                                          zlevels_out, interpolation_type);
+
+    // use the buffer owned by the interpolation context if reading one record
+    std::vector<double> records;
+    if (t_count > 1) {
+      records.resize(t_count * lic.buffer.size());
+    }
+    std::vector<double> &buffer = t_count > 1 ? records : lic.buffer;
 
-    const unsigned int t_count = 1;
     std::vector<unsigned int> start, count, imap;
     compute_start_and_count(file,
                             grid.ctx()->unit_system(),
@@ -493,7 +530,15 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
 
     // interpolate
     profiling.begin("io.regridding.interpolate");
-    regrid(grid, zlevels_out, &lic, output);
+    {
+      const size_t
+        input_size  = lic.buffer.size(),
+        output_size = grid.xm() * grid.ym() * zlevels_out.size();
+
+      for (unsigned int k = 0; k < t_count; ++k) {
+        regrid(grid, zlevels_out, &lic, &buffer[k * input_size], output + k * output_size);
+      }
+    }
     profiling.end("io.regridding.interpolate");
   } catch (RuntimeError &e) {
     e.add_context("reading variable '%s' (using linear interpolation) from '%s'",
@@ -507,12 +552,13 @@ static void regrid_vec_generic(const File &file, const IceGrid &grid,
 static void regrid_vec(const File &file, const IceGrid &grid, const std::string &var_name,
                        const std::vector<double> &zlevels_out,
                        unsigned int t_start,
+                       unsigned int t_count,
                        InterpolationType interpolation_type,
                        double *output) {
   regrid_vec_generic(file, grid,
                      var_name,
                      zlevels_out,
-                     t_start,
+                     t_start, t_count,
                      false, 0.0,
                      interpolation_type,
                      output);
@@ -524,27 +570,100 @@ static void regrid_vec(const File &file, const IceGrid &grid, const std::string
  * @param grid computational grid; used to initialize interpolation
  * @param var_name variable to regrid
  * @param zlevels_out vertical levels of the resulting grid
- * @param t_start time index of the record to regrid
+ * @param t_start time index of the first record to regrid
+ * @param t_count number of records to regrid
  * @param default_value default value to replace `_FillValue` with
+ *        (use NaN to keep missing values for the caller to fill)
  * @param[out] output resulting interpolated field
  */
 static void regrid_vec_fill_missing(const File &file, const IceGrid &grid,
                                     const std::string &var_name,
                                     const std::vector<double> &zlevels_out,
                                     unsigned int t_start,
+                                    unsigned int t_count,
                                     double default_value,
                                     InterpolationType interpolation_type,
                                     double *output) {
   regrid_vec_generic(file, grid,
                      var_name,
                      zlevels_out,
-                     t_start,
+                     t_start, t_count,
                      true, default_value,
                      interpolation_type,
                      output);
 }
 
 //! Define a NetCDF variable corresponding to a VariableMetadata object.
+//! Parse a comma-separated list of chunk sizes stored in the configuration parameter `name`.
+static std::vector<size_t> chunk_sizes(const Config &config, const std::string &name) {
+  std::vector<size_t> result;
+
+  for (auto s : split(config.get_string(name), ',')) {
+    char *endptr = NULL;
+    long int n = strtol(s.c_str(), &endptr, 10);
+    if (*endptr != '\0' or n < 1) {
+      throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                    "%s has to be a comma-separated list of positive integers (got '%s')",
+                                    name.c_str(), config.get_string(name).c_str());
+    }
+    result.push_back(n);
+  }
+
+  return result;
+}
+
+/*!
+ * Set chunk sizes, compression and quantization of a spatial variable using `output.chunking.*`
+ * and `output.compression.*`.
+ *
+ * Backends that do not support these features (all formats except NetCDF-4) ignore them.
+ */
+static void define_storage(const File &file, const Config &config,
+                           const std::string &name, IO_Type type,
+                           const std::vector<std::string> &dims,
+                           bool time_dependent) {
+  // chunking
+  {
+    bool map_3d = dims.size() - (time_dependent ? 1 : 0) > 2;
+
+    auto sizes = chunk_sizes(config, map_3d ? "output.chunking.fields_3d" : "output.chunking.fields_2d");
+
+    if (not sizes.empty()) {
+      std::vector<size_t> chunks;
+      size_t k = 0;
+      for (auto d : dims) {
+        if (time_dependent and chunks.empty()) {
+          // one record per chunk
+          chunks.push_back(1);
+          continue;
+        }
+
+        size_t length = std::max(file.dimension_length(d), 1U);
+
+        // use the whole dimension if the chunk size is not specified (e.g. along z in 3D
+        // fields)
+        size_t size = k < sizes.size() ? sizes[k] : length;
+        chunks.push_back(std::min(size, length));
+        k += 1;
+      }
+
+      file.define_variable_chunking(name, chunks);
+    }
+  }
+
+  // compression
+  file.define_variable_compression(name,
+                                   config.get_string("output.compression.codec"),
+                                   config.get_number("output.compression.level"),
+                                   config.get_flag("output.compression.shuffle"));
+
+  // lossy quantization of floating point data
+  int digits = config.get_number("output.compression.significant_digits");
+  if (digits > 0 and (type == PISM_FLOAT or type == PISM_DOUBLE)) {
+    file.define_variable_quantization(name, digits);
+  }
+}
+
 void define_spatial_variable(const SpatialVariableMetadata &var,
                              const IceGrid &grid, const File &file,
                              IO_Type default_type) {
@@ -579,8 +698,20 @@ void define_spatial_variable(const SpatialVariableMetadata &var,
   if (type == PISM_NAT) {
     type = default_type;
   }
+
+  // use single precision for variables listed in output.float_variables
+  if (type == PISM_DOUBLE) {
+    auto float_variables = set_split(grid.ctx()->config()->get_string("output.float_variables"), ',');
+    if (member(name, float_variables)) {
+      type = PISM_FLOAT;
+    }
+  }
+
   file.define_variable(name, type, dims);
 
+  define_storage(file, *grid.ctx()->config(), name, type, dims,
+                 not var.get_time_independent());
+
   write_attributes(file, var, type);
 
   // add the "grid_mapping" attribute if the grid has an associated mapping. Variables lat, lon,
@@ -593,6 +724,12 @@ void define_spatial_variable(const SpatialVariableMetadata &var,
                       mapping.get_name());
   }
 
+  // record the storage order so that reading this variable can skip use_transposed_io()
+  // checks
+  if (grid.ctx()->config()->get_flag("output.mark_storage_order")) {
+    file.write_attribute(var.get_name(), "pism_storage_order", join(dims, ","));
+  }
+
   if (var.get_time_independent()) {
     // mark this variable as "not written" so that write_spatial_variable can avoid
     // writing it more than once.
@@ -600,15 +737,60 @@ void define_spatial_variable(const SpatialVariableMetadata &var,
   }
 }
 
-//! Read a variable from a file into an array `output`.
-/*! This also converts data from input units to internal units if needed.
+/*!
+ * Returns true if `var` can be written as a difference from a base file (see
+ * DeltaEncoder).
+ *
+ * Differences are exact in glaciological units only if the unit conversion does not
+ * involve an offset (as in the conversion from Kelvin to Celsius). Differences do not
+ * preserve fill values.
  */
-void read_spatial_variable(const SpatialVariableMetadata &variable,
-                           const IceGrid& grid, const File &file,
-                           unsigned int time, double *output) {
+static bool supports_delta_encoding(const SpatialVariableMetadata &var) {
+  if (var.has_attribute("_FillValue")) {
+    return false;
+  }
 
-  const Logger &log = *grid.ctx()->log();
+  std::string
+    units               = var.get_string("units"),
+    glaciological_units = var.get_string("glaciological_units");
+
+  return (units == glaciological_units or
+          (*units::converter(var.unit_system(), units, glaciological_units))(0.0) == 0.0);
+}
 
+/*!
+ * Add values of `variable` from the file `base_filename` to `output` (used to read
+ * variables stored as differences; see DeltaEncoder).
+ *
+ * `read` reads a variable from a file, converting to internal units.
+ */
+template<class F>
+static void add_delta_base(const IceGrid &grid, const std::string &base_filename,
+                           const SpatialVariableMetadata &variable,
+                           size_t size, F read, double *output) {
+  File base(grid.com, base_filename, PISM_GUESS, PISM_READONLY);
+
+  unsigned int n_records = base.nrecords(variable.get_name(),
+                                         variable.get_string("standard_name"),
+                                         variable.unit_system());
+
+  std::vector<double> tmp(size);
+  read(base, n_records > 0 ? n_records - 1 : 0, tmp.data());
+
+  for (size_t k = 0; k < size; ++k) {
+    output[k] += tmp[k];
+  }
+}
+
+//! Read a variable from a file into an array `output`.
+/*! This also converts data from input units to internal units if needed.
+ */
+/*!
+ * Find `variable` in `file` and check that it has the expected number of spatial
+ * dimensions. Returns the name of the variable in the file.
+ */
+static std::string find_spatial_variable(const SpatialVariableMetadata &variable,
+                                         const File &file) {
   // Find the variable:
   auto var = file.find_variable(variable.get_name(), variable.get_string("standard_name"));
 
@@ -663,13 +845,23 @@ void read_spatial_variable(const SpatialVariableMetadata &variable,
     }
   }
 
-  // make sure we have at least one level
+  return var.name;
+}
+
+/*!
+ * Convert units of `variable` read from `file` (stored as `name`) and add values from the
+ * base file if it is stored as a difference.
+ */
+static void finish_reading(const SpatialVariableMetadata &variable,
+                           const std::string &name,
+                           const IceGrid& grid, const File &file,
+                           double *output) {
+  const Logger &log = *grid.ctx()->log();
+
   const std::vector<double>& zlevels = variable.get_levels();
   unsigned int nlevels = std::max(zlevels.size(), (size_t)1);
 
-  read_distributed_array(file, grid, var.name, nlevels, time, output);
-
-  std::string input_units = file.read_text_attribute(var.name, "units");
+  std::string input_units = file.read_text_attribute(name, "units");
   const std::string &internal_units = variable.get_string("units");
 
   if (input_units.empty() and not internal_units.empty()) {
@@ -687,6 +879,78 @@ void read_spatial_variable(const SpatialVariableMetadata &variable,
 
   units::Converter(variable.unit_system(),
                    input_units, internal_units).convert_doubles(output, size);
+
+  // add values from the base file if this variable is stored as a difference
+  std::string base = delta_base_filename(file, name);
+  if (not base.empty()) {
+    add_delta_base(grid, base, variable, size,
+                   [&](const File &base_file, unsigned int record, double *result) {
+                     read_spatial_variable(variable, grid, base_file, record, result);
+                   },
+                   output);
+  }
+}
+
+void read_spatial_variable(const SpatialVariableMetadata &variable,
+                           const IceGrid& grid, const File &file,
+                           unsigned int time, double *output) {
+  read_spatial_variables({variable}, grid, file, time, {output});
+}
+
+/*!
+ * Read `variables` (record `time`) from `file` into `outputs`.
+ *
+ * All reads are started before waiting for any of them, so that I/O backends supporting
+ * non-blocking reads (PnetCDF) can combine them. Units are converted after all reads are
+ * complete.
+ */
+void read_spatial_variables(const std::vector<SpatialVariableMetadata> &variables,
+                            const IceGrid& grid, const File &file,
+                            unsigned int time, const std::vector<double*> &outputs) {
+
+  if (variables.size() != outputs.size()) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "got %d variables and %d output arrays",
+                                  (int)variables.size(), (int)outputs.size());
+  }
+
+  const Logger &log = *grid.ctx()->log();
+
+  // names of variables in the file (empty if read from a patch file)
+  std::vector<std::string> names(variables.size());
+
+  for (unsigned int k = 0; k < variables.size(); ++k) {
+    const SpatialVariableMetadata &variable = variables[k];
+
+    std::string name = find_spatial_variable(variable, file);
+
+    // make sure we have at least one level
+    const std::vector<double>& zlevels = variable.get_levels();
+    unsigned int nlevels = std::max(zlevels.size(), (size_t)1);
+
+    // Use the patch file if it is available. Patches are stored in internal units, so unit
+    // conversion is not needed.
+    if (grid.ctx()->config()->get_flag("input.use_patches")) {
+      auto patches = file.patch_reader();
+      if (patches and
+          patches->read(grid, name, time, grid.xm() * grid.ym() * nlevels, outputs[k])) {
+        log.message(3, "  Read %s from a patch file\n", name.c_str());
+        continue;
+      }
+    }
+
+    read_distributed_array(file, grid, name, nlevels, time, outputs[k], true);
+
+    names[k] = name;
+  }
+
+  file.wait_all();
+
+  for (unsigned int k = 0; k < variables.size(); ++k) {
+    if (not names[k].empty()) {
+      finish_reading(variables[k], names[k], grid, file, outputs[k]);
+    }
+  }
 }
 
 //! \brief Write a double array to a file.
@@ -723,6 +987,23 @@ void write_spatial_variable(const SpatialVariableMetadata &var,
   // make sure we have at least one level
   unsigned int nlevels = std::max(var.get_levels().size(), (size_t)1);
 
+  // save a copy in the patch file (in internal units)
+  auto patches = file.patch_writer();
+  if (patches) {
+    int record = var.get_time_independent() ? -1 : (int)file.nrecords() - 1;
+    patches->write(name, record, input, grid.xm() * grid.ym() * nlevels);
+  }
+
+  // write the difference from the base file (see DeltaEncoder)
+  std::vector<double> delta;
+  auto encoder = file.delta_encoder();
+  if (encoder and supports_delta_encoding(var) and
+      encoder->encode(name, input, grid.xm() * grid.ym() * nlevels, delta)) {
+    file.redef();
+    file.write_attribute(name, "pism_encoding", "delta");
+    input = delta.data();
+  }
+
   std::string
     units               = var.get_string("units"),
     glaciological_units = var.get_string("glaciological_units");
@@ -737,9 +1018,9 @@ void write_spatial_variable(const SpatialVariableMetadata &var,
       tmp[k] = input[k];
     }
 
-    units::Converter(var.unit_system(),
+    units::converter(var.unit_system(),
                      units,
-                     glaciological_units).convert_doubles(&tmp[0], tmp.size());
+                     glaciological_units)->convert_doubles(&tmp[0], tmp.size());
 
     file.write_distributed_array(name, grid, nlevels, &tmp[0]);
   } else {
@@ -773,11 +1054,15 @@ void regrid_spatial_variable(SpatialVariableMetadata &var,
                           default_value, interpolation_type, output);
 }
 
+//! Compute the range of `data`, ignoring NaNs (missing values kept for the caller to fill).
 static void compute_range(MPI_Comm com, double *data, size_t data_size, double *min, double *max) {
   double
-    min_result = data[0],
-    max_result = data[0];
+    min_result = std::numeric_limits<double>::max(),
+    max_result = -std::numeric_limits<double>::max();
   for (size_t k = 0; k < data_size; ++k) {
+    if (std::isnan(data[k])) {
+      continue;
+    }
     min_result = std::min(min_result, data[k]);
     max_result = std::max(max_result, data[k]);
   }
@@ -900,11 +1185,31 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
                              double default_value,
                              InterpolationType interpolation_type,
                              double *output) {
+  regrid_spatial_variable(variable, grid, file, t_start, 1, flag, report_range,
+                          allow_extrapolation, default_value, interpolation_type, output);
+}
+
+/*!
+ * Regrid `t_count` records of a variable starting from `t_start`, reading them using one
+ * hyperslab call.
+ *
+ * Records are stored one after another in `output`, which has to have room for `t_count
+ * * grid.xm() * grid.ym() * variable.get_levels().size()` numbers.
+ */
+void regrid_spatial_variable(SpatialVariableMetadata &variable,
+                             const IceGrid& grid, const File &file,
+                             unsigned int t_start, unsigned int t_count,
+                             RegriddingFlag flag,
+                             bool report_range,
+                             bool allow_extrapolation,
+                             double default_value,
+                             InterpolationType interpolation_type,
+                             double *output) {
   const Logger &log = *grid.ctx()->log();
 
   units::System::Ptr sys = variable.unit_system();
   const std::vector<double>& levels = variable.get_levels();
-  const size_t data_size = grid.xm() * grid.ym() * levels.size();
+  const size_t data_size = t_count * grid.xm() * grid.ym() * levels.size();
 
   // Find the variable
   auto var = file.find_variable(variable.get_name(), variable.get_string("standard_name"));
@@ -912,7 +1217,8 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
   if (var.exists) {                      // the variable was found successfully
 
     {
-      grid_info input_grid(file, var.name, sys, grid.registration());
+      const grid_info &input_grid = file.regridding_cache().input_grid(file, var.name, sys,
+                                                                        grid.registration());
 
       check_input_grid(input_grid);
 
@@ -922,15 +1228,21 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
     }
 
     if (flag == OPTIONAL_FILL_MISSING or flag == CRITICAL_FILL_MISSING) {
-      log.message(2,
-                  "PISM WARNING: Replacing missing values with %f [%s] in variable '%s' read from '%s'.\n",
-                  default_value, variable.get_string("units").c_str(), variable.get_name().c_str(),
-                  file.filename().c_str());
+      if (std::isnan(default_value)) {
+        log.message(2,
+                    "PISM WARNING: Filling missing values in variable '%s' read from '%s'.\n",
+                    variable.get_name().c_str(), file.filename().c_str());
+      } else {
+        log.message(2,
+                    "PISM WARNING: Replacing missing values with %f [%s] in variable '%s' read from '%s'.\n",
+                    default_value, variable.get_string("units").c_str(), variable.get_name().c_str(),
+                    file.filename().c_str());
+      }
 
       regrid_vec_fill_missing(file, grid, var.name, levels,
-                              t_start, default_value, interpolation_type, output);
+                              t_start, t_count, default_value, interpolation_type, output);
     } else {
-      regrid_vec(file, grid, var.name, levels, t_start, interpolation_type, output);
+      regrid_vec(file, grid, var.name, levels, t_start, t_count, interpolation_type, output);
     }
 
     // Now we need to get the units string from the file and convert
@@ -953,6 +1265,26 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
     // Convert data:
     units::Converter(sys, input_units, internal_units).convert_doubles(output, data_size);
 
+    // add values from the base file if this variable is stored as a difference
+    std::string base = delta_base_filename(file, var.name);
+    if (not base.empty()) {
+      if (t_count != 1) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "cannot read more than one record of '%s' from '%s':"
+                                      " it is stored as a difference from '%s'",
+                                      var.name.c_str(), file.filename().c_str(), base.c_str());
+      }
+
+      add_delta_base(grid, base, variable, data_size,
+                     [&](const File &base_file, unsigned int record, double *result) {
+                       SpatialVariableMetadata tmp = variable;
+                       regrid_spatial_variable(tmp, grid, base_file, record, 1, CRITICAL,
+                                               false, allow_extrapolation, default_value,
+                                               interpolation_type, result);
+                     },
+                     output);
+    }
+
     // Check the range and report it if necessary.
     {
       double min = 0.0, max = 0.0;
@@ -998,6 +1330,139 @@ void regrid_spatial_variable(SpatialVariableMetadata &variable,
 }
 
 
+/*!
+ * Interpolate `source`, a field defined on a different grid, onto `grid` and vertical
+ * levels `zlevels_out` without writing it to a file.
+ *
+ * Each process gets the block of `source` it needs (the same block it would read from a
+ * file, see LocalInterpCtx) using a scatter from the natural ordering, so results are the
+ * same as if `source` was saved and then regridded.
+ *
+ * `output` uses the storage order of a global Vec with `dof = max(ndof, number of levels)`.
+ */
+void regrid_spatial_variable(const IceModelVec &source,
+                             const IceGrid& grid,
+                             const std::vector<double> &zlevels_out,
+                             InterpolationType interpolation_type,
+                             bool allow_extrapolation,
+                             double *output) {
+  const int X = 1, Y = 2;       // indices, just for clarity
+
+  IceGrid::ConstPtr source_grid = source.grid();
+
+  const unsigned int
+    n_dof = source.ndof(),
+    N     = std::max((size_t)n_dof, source.levels().size());
+
+  try {
+    // describe the source grid the way grid_info describes a file
+    grid_info input;
+    input.filename = "(in memory)";
+    input.t_len    = 1;
+    input.x_len    = source_grid->Mx();
+    input.y_len    = source_grid->My();
+    input.x        = source_grid->x();
+    input.y        = source_grid->y();
+    input.x0       = source_grid->x0();
+    input.y0       = source_grid->y0();
+    input.Lx       = source_grid->Lx();
+    input.Ly       = source_grid->Ly();
+    if (source.ndims() == 3) {
+      input.z     = source.levels();
+      input.z_len = input.z.size();
+      input.z_min = vector_min(input.z);
+      input.z_max = vector_max(input.z);
+    }
+
+    if (not allow_extrapolation) {
+      check_grid_overlap(input, grid, zlevels_out);
+    }
+
+    LocalInterpCtx lic(input, grid, zlevels_out, interpolation_type);
+
+    PetscErrorCode ierr = 0;
+
+    // copy source to a Vec using the natural ordering of the grid (the same as in a file)
+    petsc::DM::Ptr da = source_grid->get_dm(N, 0);
+    petsc::TemporaryGlobalVec global(da);
+    source.copy_to_vec(da, global);
+
+    petsc::Vec natural;
+    ierr = DMDACreateNaturalVector(*da, natural.rawptr());
+    PISM_CHK(ierr, "DMDACreateNaturalVector");
+
+    ierr = DMDAGlobalToNaturalBegin(*da, global, INSERT_VALUES, natural);
+    PISM_CHK(ierr, "DMDAGlobalToNaturalBegin");
+
+    ierr = DMDAGlobalToNaturalEnd(*da, global, INSERT_VALUES, natural);
+    PISM_CHK(ierr, "DMDAGlobalToNaturalEnd");
+
+    // get the block needed by this process
+    std::vector<PetscInt> indices;
+    indices.reserve(lic.count[X] * lic.count[Y] * N);
+    for (unsigned int j = 0; j < lic.count[Y]; ++j) {
+      for (unsigned int i = 0; i < lic.count[X]; ++i) {
+        const PetscInt
+          J = lic.start[Y] + j,
+          I = lic.start[X] + i;
+        for (unsigned int k = 0; k < N; ++k) {
+          indices.push_back((J * source_grid->Mx() + I) * N + k);
+        }
+      }
+    }
+
+    petsc::IS is;
+    ierr = ISCreateGeneral(PETSC_COMM_SELF, indices.size(), indices.data(),
+                           PETSC_COPY_VALUES, is.rawptr());
+    PISM_CHK(ierr, "ISCreateGeneral");
+
+    petsc::Vec block;
+    ierr = VecCreateSeq(PETSC_COMM_SELF, indices.size(), block.rawptr());
+    PISM_CHK(ierr, "VecCreateSeq");
+
+    petsc::VecScatter scatter;
+    ierr = VecScatterCreate(natural, is, block, NULL, scatter.rawptr());
+    PISM_CHK(ierr, "VecScatterCreate");
+
+    ierr = VecScatterBegin(scatter, natural, block, INSERT_VALUES, SCATTER_FORWARD);
+    PISM_CHK(ierr, "VecScatterBegin");
+
+    ierr = VecScatterEnd(scatter, natural, block, INSERT_VALUES, SCATTER_FORWARD);
+    PISM_CHK(ierr, "VecScatterEnd");
+
+    petsc::VecArray block_array(block);
+    const double *data = block_array.get();
+
+    if (n_dof == 1) {
+      regrid(grid, zlevels_out, &lic, data, output);
+    } else {
+      // interpolate components one at a time; they are interleaved in the block and in
+      // the output
+      const size_t
+        block_size  = lic.count[X] * lic.count[Y],
+        output_size = grid.xm() * grid.ym();
+
+      std::vector<double> component(output_size);
+
+      for (unsigned int d = 0; d < n_dof; ++d) {
+        for (size_t k = 0; k < block_size; ++k) {
+          lic.buffer[k] = data[k * n_dof + d];
+        }
+
+        regrid(grid, zlevels_out, &lic, lic.buffer.data(), component.data());
+
+        for (size_t k = 0; k < output_size; ++k) {
+          output[k * n_dof + d] = component[k];
+        }
+      }
+    }
+  } catch (RuntimeError &e) {
+    e.add_context("interpolating '%s' from a %d x %d grid",
+                  source.get_name().c_str(), source_grid->Mx(), source_grid->My());
+    throw;
+  }
+}
+
 
 //! Define a NetCDF variable corresponding to a time-series.
 void define_timeseries(const TimeseriesMetadata& var,
@@ -1117,9 +1582,9 @@ void write_timeseries(const File &file, const TimeseriesMetadata &metadata, size
 
     units::System::Ptr system = metadata.unit_system();
     // convert to glaciological units:
-    units::Converter(system,
+    units::converter(system,
                      metadata.get_string("units"),
-                     metadata.get_string("glaciological_units")).convert_doubles(&tmp[0], tmp.size());
+                     metadata.get_string("glaciological_units"))->convert_doubles(&tmp[0], tmp.size());
 
     file.write_variable(name, {(unsigned int)t_start}, {(unsigned int)tmp.size()}, tmp.data());
 
@@ -1250,9 +1715,9 @@ void write_time_bounds(const File &file, const TimeBoundsMetadata &metadata,
 
     // convert to glaciological units:
     units::System::Ptr system = metadata.unit_system();
-    units::Converter(system,
+    units::converter(system,
                      metadata.get_string("units"),
-                     metadata.get_string("glaciological_units")).convert_doubles(&tmp[0], tmp.size());
+                     metadata.get_string("glaciological_units"))->convert_doubles(&tmp[0], tmp.size());
 
     std::vector<unsigned int>
       start{static_cast<unsigned int>(t_start), 0},
@@ -1368,7 +1833,8 @@ void write_attributes(const File &file, const VariableMetadata &variable, IO_Typ
     // matching the ones in the output.
     if (use_glaciological_units) {
 
-      units::Converter c(variable.unit_system(), units, glaciological_units);
+      const units::Converter &c = *units::converter(variable.unit_system(),
+                                                    units, glaciological_units);
 
       bounds[0]  = c(bounds[0]);
       bounds[1]  = c(bounds[1]);
@@ -1,4 +1,4 @@
-/* Copyright (C) 2015, 2016, 2017, 2018, 2019 PISM Authors
+/* Copyright (C) 2015, 2016, 2017, 2018, 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -35,6 +35,7 @@ class SpatialVariableMetadata;
 class TimeseriesMetadata;
 class TimeBoundsMetadata;
 class IceGrid;
+class IceModelVec;
 class File;
 class Time;
 class Logger;
@@ -60,10 +61,30 @@ void regrid_spatial_variable(SpatialVariableMetadata &var,
                              InterpolationType type,
                              double *output);
 
+void regrid_spatial_variable(SpatialVariableMetadata &var,
+                             const IceGrid& grid, const File &nc,
+                             unsigned int t_start, unsigned int t_count,
+                             RegriddingFlag flag, bool do_report_range,
+                             bool allow_extrapolation,
+                             double default_value,
+                             InterpolationType type,
+                             double *output);
+
+void regrid_spatial_variable(const IceModelVec &source,
+                             const IceGrid& grid,
+                             const std::vector<double> &zlevels_out,
+                             InterpolationType type,
+                             bool allow_extrapolation,
+                             double *output);
+
 void read_spatial_variable(const SpatialVariableMetadata &var,
                            const IceGrid& grid, const File &nc,
                            unsigned int time, double *output);
 
+void read_spatial_variables(const std::vector<SpatialVariableMetadata> &variables,
+                            const IceGrid& grid, const File &file,
+                            unsigned int time, const std::vector<double*> &outputs);
+
 void write_spatial_variable(const SpatialVariableMetadata &var,
                             const IceGrid& grid, const File &nc,
                             const double *input);
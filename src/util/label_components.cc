@@ -1,4 +1,4 @@
-/* Copyright (C) 2019 PISM Authors
+/* Copyright (C) 2019, 2020 PISM Authors
  *
  * This file is part of PISM.
  *
@@ -17,40 +17,269 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <vector>
+#include <algorithm>            // std::sort, std::unique, std::lower_bound
+#include <cmath>                // fabs
+
 #include "label_components.hh"
 
 #include "pism/util/iceModelVec.hh"
 #include "pism/util/error_handling.hh"
+#include "pism/util/pism_utilities.hh"
 #include "connected_components.hh"
 
 namespace pism {
 
+/*!
+ * Collect values in `local` from all ranks in `comm`, then sort them and remove
+ * duplicates.
+ */
+static std::vector<double> all_unique(MPI_Comm comm, const std::vector<double> &local) {
+  int size = 0;
+  MPI_Comm_size(comm, &size);
+
+  int local_count = local.size();
+  std::vector<int> counts(size), offsets(size);
+  MPI_Allgather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+
+  int total = 0;
+  for (int k = 0; k < size; ++k) {
+    offsets[k] = total;
+    total += counts[k];
+  }
+
+  std::vector<double> result(total);
+  MPI_Allgatherv(const_cast<double*>(local.data()), local_count, MPI_DOUBLE,
+                 result.data(), counts.data(), offsets.data(), MPI_DOUBLE, comm);
+
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+
+  return result;
+}
+
 /*!
  * Label connected components in a mask stored in an IceModelVec2Int.
  *
- * This function allocates a copy on rank 0 and so should not be used if that is a
- * problem.
+ * Computes the same result as label_connected_components() applied to the whole mask
+ * (see that function for the meaning of `identify_icebergs` and `mask_grounded`), but
+ * does not gather the mask on rank 0:
+ *
+ * 1. Each rank labels connected components in its sub-domain. Each local component
+ *    gets the smallest global (natural) index of its cells as its ID.
+ *
+ * 2. Components touching sub-domain boundaries are merged by exchanging IDs (and the
+ *    "grounded" flag) with neighbors: each component takes the smallest neighboring ID
+ *    (and the largest flag). This is repeated until no ID changes anywhere.
+ *
+ *    Each round propagates the smallest ID by one step along the graph of local
+ *    components (pieces of global components in each sub-domain) connected across
+ *    sub-domain boundaries. The number of rounds is one more than the longest path in
+ *    this graph: usually the number of sub-domains a component spans, but a winding
+ *    component entering and leaving a sub-domain many times has more pieces. The total
+ *    number of local components is a hard upper bound; exceeding it means that the
+ *    merge did not converge and is reported as an error.
+ *
+ * 3. Final IDs are numbered 1, 2, ... in increasing order. This reproduces the order
+ *    used by the serial code.
+ *
+ * `work` is used as temporary storage (IDs and flags of components in the `u` and `v`
+ * components, respectively); it has to have ghosts (stencil width of at least 1).
  */
-void label_components(IceModelVec2Int &mask, bool identify_icebergs, double mask_grounded) {
-  auto mask_p0 = mask.allocate_proc0_copy();
-
-  mask.put_on_proc0(*mask_p0);
+void label_components(IceModelVec2Int &mask, bool identify_icebergs, double mask_grounded,
+                      IceModelVec2V &work) {
+  const double eps = 1e-6;
 
   auto grid = mask.grid();
 
-  ParallelSection rank0(grid->com);
-  try {
-    if (grid->rank() == 0) {
-      petsc::VecArray array(*mask_p0);
-      label_connected_components(array.get(), grid->My(), grid->Mx(),
-                                 identify_icebergs, mask_grounded);
+  const int
+    Mx = grid->Mx(),
+    My = grid->My(),
+    xs = grid->xs(),
+    xm = grid->xm(),
+    ys = grid->ys(),
+    ym = grid->ym();
+
+  // local labels (0 is the background) stored row by row
+  std::vector<double> label(xm * ym, 0.0);
+
+  // Step 1: label components in this sub-domain.
+  {
+    IceModelVec::AccessList list{&mask};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      label[(j - ys) * xm + (i - xs)] = mask(i, j) > 0.0 ? 1.0 : 0.0;
+    }
+  }
+
+  if (xm > 0 and ym > 0) {
+    label_connected_components(label.data(), ym, xm, false, 0.0);
+  }
+
+  int n_components = 0;
+  for (auto l : label) {
+    n_components = std::max(n_components, (int)l);
+  }
+
+  // IDs and "grounded" flags of local components (component 0 is the background)
+  std::vector<double> id(n_components + 1, -1.0), grounded(n_components + 1, 0.0);
+  {
+    IceModelVec::AccessList list{&mask};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      int k = label[(j - ys) * xm + (i - xs)];
+      if (k == 0) {
+        continue;
+      }
+
+      double natural_index = j * Mx + i + 1;
+      if (id[k] < 0.0 or natural_index < id[k]) {
+        id[k] = natural_index;
+      }
+
+      if (fabs(mask(i, j) - mask_grounded) < eps) {
+        grounded[k] = 1.0;
+      }
+    }
+  }
+
+  // Step 2: merge components across sub-domain boundaries.
+  {
+    if (work.stencil_width() < 1) {
+      throw RuntimeError(PISM_ERROR_LOCATION,
+                         "label_components() requires a work field with ghosts");
+    }
+
+    const int
+      di[] = {-1, 1, 0, 0},
+      dj[] = {0, 0, -1, 1};
+
+    // the number of rounds cannot exceed the total number of local components (see
+    // above)
+    const int max_rounds = GlobalSum(grid->com, n_components) + 1;
+
+    int round = 0;
+    bool changed = true;
+    while (changed) {
+      if (round > max_rounds) {
+        throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                      "connected component labeling did not converge"
+                                      " after %d rounds", round);
+      }
+      round += 1;
+
+      {
+        IceModelVec::AccessList list{&work};
+
+        for (Points p(*grid); p; p.next()) {
+          const int i = p.i(), j = p.j();
+
+          int k = label[(j - ys) * xm + (i - xs)];
+
+          work(i, j) = Vector2(k > 0 ? id[k] : 0.0, grounded[k]);
+        }
+      }
+
+      work.update_ghosts();
+
+      int local_changed = 0;
+      {
+        IceModelVec::AccessList list{&work};
+
+        for (Points p(*grid); p; p.next()) {
+          const int i = p.i(), j = p.j();
+
+          int k = label[(j - ys) * xm + (i - xs)];
+
+          // skip the background and cells away from sub-domain boundaries
+          if (k == 0 or
+              (i > xs and i < xs + xm - 1 and j > ys and j < ys + ym - 1)) {
+            continue;
+          }
+
+          for (int n = 0; n < 4; ++n) {
+            const int
+              ii = i + di[n],
+              jj = j + dj[n];
+
+            // skip neighbors in this sub-domain and outside the grid (ghosts of PISM's
+            // DMs are periodic)
+            bool local = (ii >= xs and ii < xs + xm and jj >= ys and jj < ys + ym);
+            bool outside = (ii < 0 or ii >= Mx or jj < 0 or jj >= My);
+            if (local or outside) {
+              continue;
+            }
+
+            const Vector2 &neighbor = work(ii, jj);
+
+            if (neighbor.u <= 0.0) {
+              continue;
+            }
+
+            if (neighbor.u < id[k]) {
+              id[k] = neighbor.u;
+              local_changed = 1;
+            }
+
+            if (neighbor.v > grounded[k]) {
+              grounded[k] = neighbor.v;
+              local_changed = 1;
+            }
+          }
+        }
+      }
+
+      changed = GlobalMax(grid->com, local_changed) > 0;
     }
-  } catch (...) {
-    rank0.failed();
   }
-  rank0.check();
 
-  mask.get_from_proc0(*mask_p0);
+  // Step 3: compute final labels.
+  std::vector<double> result(n_components + 1, 0.0);
+  if (identify_icebergs) {
+    for (int k = 1; k <= n_components; ++k) {
+      result[k] = 1.0 - grounded[k];
+    }
+  } else {
+    std::vector<double> local_ids(id.begin() + 1, id.end());
+    std::vector<double> ids = all_unique(grid->com, local_ids);
+
+    for (int k = 1; k <= n_components; ++k) {
+      result[k] = std::lower_bound(ids.begin(), ids.end(), id[k]) - ids.begin() + 1;
+    }
+  }
+
+  {
+    IceModelVec::AccessList list{&mask};
+
+    for (Points p(*grid); p; p.next()) {
+      const int i = p.i(), j = p.j();
+
+      int k = label[(j - ys) * xm + (i - xs)];
+
+      // the background is left unchanged
+      if (k > 0) {
+        mask(i, j) = result[k];
+      }
+    }
+  }
+
+  mask.update_ghosts();
+  mask.inc_state_counter();
+}
+
+/*!
+ * Label connected components in `mask`, allocating temporary storage.
+ *
+ * Callers labeling components repeatedly should use the version taking a work field.
+ */
+void label_components(IceModelVec2Int &mask, bool identify_icebergs, double mask_grounded) {
+  IceModelVec2V work(mask.grid(), "label_components_work", WITH_GHOSTS, 1);
+
+  label_components(mask, identify_icebergs, mask_grounded, work);
 }
 
 } // end of namespace pism
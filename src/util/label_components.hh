@@ -23,6 +23,10 @@
 namespace pism {
 
 class IceModelVec2Int;
+class IceModelVec2V;
+
+void label_components(IceModelVec2Int &mask, bool identify_icebergs, double mask_grounded,
+                      IceModelVec2V &work);
 
 void label_components(IceModelVec2Int &mask, bool identify_icebergs, double mask_grounded);
 
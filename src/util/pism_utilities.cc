@@ -176,6 +176,51 @@ double GlobalSum(MPI_Comm comm, double local) {
   return result;
 }
 
+//! Union of sets of names on all processes, in alphabetical order. Collective.
+/*!
+ * Names must not contain newline characters.
+ */
+std::vector<std::string> global_union(MPI_Comm com, const std::set<std::string> &names) {
+  int rank = 0, size = 1;
+  MPI_Comm_rank(com, &rank);
+  MPI_Comm_size(com, &size);
+
+  std::string local;
+  for (const auto &name : names) {
+    local += name + "\n";
+  }
+
+  int length = local.size();
+  std::vector<int> lengths(size, 0), offsets(size, 0);
+  MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, com);
+
+  int total = 0;
+  for (int k = 0; k < size; ++k) {
+    offsets[k] = total;
+    total += lengths[k];
+  }
+
+  std::vector<char> buffer(total + 1, '\0');
+  MPI_Gatherv(const_cast<char*>(local.c_str()), length, MPI_CHAR,
+              buffer.data(), lengths.data(), offsets.data(), MPI_CHAR, 0, com);
+
+  std::string all_names;
+  if (rank == 0) {
+    for (const auto &name : set_split(std::string(buffer.data(), total), '\n')) {
+      all_names += name + "\n";
+    }
+  }
+
+  length = all_names.size();
+  MPI_Bcast(&length, 1, MPI_INT, 0, com);
+
+  buffer.resize(length + 1);
+  std::copy(all_names.begin(), all_names.end(), buffer.begin());
+  MPI_Bcast(buffer.data(), length, MPI_CHAR, 0, com);
+
+  return split(std::string(buffer.data(), length), '\n');
+}
+
 static const int TEMPORARY_STRING_LENGTH = 32768;
 
 std::string version() {
@@ -226,6 +271,11 @@ std::string version() {
   result += buffer;
 #endif
 
+#if (Pism_USE_OPENMP==1)
+  snprintf(buffer, sizeof(buffer), "OpenMP %d.\n", _OPENMP);
+  result += buffer;
+#endif
+
 #if (Pism_BUILD_PYTHON_BINDINGS==1)
   snprintf(buffer, sizeof(buffer), "SWIG %s.\n", pism::swig_version);
   result += buffer;
@@ -115,6 +115,8 @@ unsigned int GlobalSum(MPI_Comm comm, unsigned int input);
 
 int GlobalSum(MPI_Comm comm, int input);
 
+std::vector<std::string> global_union(MPI_Comm com, const std::set<std::string> &names);
+
 std::string version();
 
 std::string printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
@@ -19,6 +19,9 @@
 
 #include <cstdlib>              // strtol
 #include <cmath>                // fabs
+#include <cstdio>               // std::rename
+#include <map>
+#include <unistd.h>             // getpid
 
 #include "projection.hh"
 #include "VariableMetadata.hh"
@@ -27,6 +30,9 @@
 #include "io/io_helpers.hh"
 #include "pism/util/IceGrid.hh"
 #include "pism/util/iceModelVec.hh"
+#include "pism/util/ConfigInterface.hh"
+#include "pism/util/Context.hh"
+#include "pism/util/pism_utilities.hh"
 
 #include "pism/pism_config.hh"
 
@@ -253,6 +259,252 @@ static double triangle_area(double *A, double *B, double *C) {
                   PetscSqr(V1[0]*V2[1] - V2[0]*V1[1]));
 }
 
+/*!
+ * Coordinates of cell corners in the sub-domain of this process, stored row by row in an
+ * `(xm + 1) * (ym + 1)` lattice with the corner `(0, 0)` at the south-west corner of the
+ * cell `(xs, ys)`.
+ *
+ * Neighboring cells share corners, so this is about 4 times fewer points than
+ * transforming four corners of each cell.
+ */
+static void cell_corners(const IceGrid &grid, std::vector<double> &x, std::vector<double> &y) {
+  const int
+    xs = grid.xs(),
+    xm = grid.xm(),
+    ys = grid.ys(),
+    ym = grid.ym();
+
+  const double dx2 = 0.5 * grid.dx(), dy2 = 0.5 * grid.dy();
+
+  x.resize((xm + 1) * (ym + 1));
+  y.resize(x.size());
+
+  for (int b = 0; b <= ym; ++b) {
+    const double y_b = b < ym ? grid.y(ys + b) - dy2 : grid.y(ys + ym - 1) + dy2;
+
+    for (int a = 0; a <= xm; ++a) {
+      const int n = b * (xm + 1) + a;
+
+      x[n] = a < xm ? grid.x(xs + a) - dx2 : grid.x(xs + xm - 1) + dx2;
+      y[n] = y_b;
+    }
+  }
+}
+
+//! Coordinates of cell centers in the sub-domain of this process, stored row by row.
+static void cell_centers(const IceGrid &grid, std::vector<double> &x, std::vector<double> &y) {
+  const int
+    xs = grid.xs(),
+    xm = grid.xm(),
+    ys = grid.ys(),
+    ym = grid.ym();
+
+  x.resize(xm * ym);
+  y.resize(x.size());
+
+  for (int j = 0; j < ym; ++j) {
+    for (int i = 0; i < xm; ++i) {
+      x[j * xm + i] = grid.x(xs + i);
+      y[j * xm + i] = grid.y(ys + j);
+    }
+  }
+}
+
+/*!
+ * Transform all points in `x`, `y` (and `z`, if not empty) in place using one PROJ call.
+ */
+static void transform(Proj &crs, std::vector<double> &x, std::vector<double> &y,
+                      std::vector<double> &z) {
+  const size_t
+    n   = x.size(),
+    n_z = z.size(),
+    s   = sizeof(double);
+
+  size_t n_transformed = proj_trans_generic(*crs, PJ_FWD,
+                                            x.data(), s, n,
+                                            y.data(), s, n,
+                                            n_z > 0 ? z.data() : NULL, s, n_z,
+                                            NULL, 0, 0);
+  if (n_transformed != n) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "failed to transform %d points (errno: %d, %s)",
+                                  (int)n, proj_errno(*crs),
+                                  proj_errno_string(proj_errno(*crs)));
+  }
+}
+
+/*!
+ * Longitudes and latitudes of cell centers and cell corners (see cell_corners()) in the
+ * sub-domain of this process.
+ */
+struct LonLatPatch {
+  std::vector<double> lon, lat, corner_lon, corner_lat;
+};
+
+static const char *lon_lat_variables[] = {"lon", "lat", "lon_corners", "lat_corners"};
+
+//! Returns the key identifying a projection and a grid in the cache of lon,lat patches.
+static std::string lon_lat_key(const std::string &projection, const IceGrid &grid) {
+  return pism::printf("%s;%d,%d,%.17g,%.17g,%.17g,%.17g;%d,%d,%d,%d",
+                      projection.c_str(),
+                      (int)grid.Mx(), (int)grid.My(),
+                      grid.x(0), grid.y(0), grid.dx(), grid.dy(),
+                      grid.xs(), grid.xm(), grid.ys(), grid.ym());
+}
+
+/*!
+ * Read the patch of this process from the projection cache file `filename`.
+ *
+ * Returns false if the file does not exist or was created using a different projection
+ * string or grid.
+ */
+static bool read_lon_lat(const std::string &filename, const std::string &projection,
+                         const IceGrid &grid, LonLatPatch &result) {
+
+  if (not io::file_exists(grid.com, filename)) {
+    return false;
+  }
+
+  File file(grid.com, filename, PISM_NETCDF3, PISM_READONLY);
+
+  for (auto v : lon_lat_variables) {
+    if (not file.find_variable(v)) {
+      return false;
+    }
+  }
+
+  if (file.read_text_attribute("PISM_GLOBAL", "proj") != projection) {
+    return false;
+  }
+
+  auto grid_info = file.read_double_attribute("PISM_GLOBAL", "grid");
+  std::vector<double> expected = {(double)grid.Mx(), (double)grid.My(),
+                                  grid.x(0), grid.y(0), grid.dx(), grid.dy()};
+  if (grid_info != expected) {
+    return false;
+  }
+
+  const unsigned int
+    xs = grid.xs(),
+    xm = grid.xm(),
+    ys = grid.ys(),
+    ym = grid.ym();
+
+  result.lon.resize(xm * ym);
+  result.lat.resize(xm * ym);
+  result.corner_lon.resize((xm + 1) * (ym + 1));
+  result.corner_lat.resize((xm + 1) * (ym + 1));
+
+  file.read_variable("lon", {ys, xs}, {ym, xm}, result.lon.data());
+  file.read_variable("lat", {ys, xs}, {ym, xm}, result.lat.data());
+  file.read_variable("lon_corners", {ys, xs}, {ym + 1, xm + 1}, result.corner_lon.data());
+  file.read_variable("lat_corners", {ys, xs}, {ym + 1, xm + 1}, result.corner_lat.data());
+
+  return true;
+}
+
+/*!
+ * Save patches of all processes to the projection cache file `filename`.
+ *
+ * Neighboring patches of cell corners overlap (and contain identical values).
+ */
+static void write_lon_lat(const std::string &filename, const std::string &projection,
+                          const IceGrid &grid, const LonLatPatch &patch) {
+  int rank = 0;
+  MPI_Comm_rank(grid.com, &rank);
+
+  // Write to a temporary file and rename it to make sure that concurrent runs sharing a
+  // cache file never see a partially written one.
+  int pid = getpid();
+  MPI_Bcast(&pid, 1, MPI_INT, 0, grid.com);
+  std::string tmp_filename = pism::printf("%s.%d.tmp", filename.c_str(), pid);
+
+  const unsigned int
+    xs = grid.xs(),
+    xm = grid.xm(),
+    ys = grid.ys(),
+    ym = grid.ym();
+
+  {
+    File file(grid.com, tmp_filename, PISM_NETCDF3, PISM_READWRITE_CLOBBER);
+
+    file.define_dimension("y", grid.My());
+    file.define_dimension("x", grid.Mx());
+    file.define_dimension("y_corners", grid.My() + 1);
+    file.define_dimension("x_corners", grid.Mx() + 1);
+
+    file.define_variable("lon", PISM_DOUBLE, {"y", "x"});
+    file.define_variable("lat", PISM_DOUBLE, {"y", "x"});
+    file.define_variable("lon_corners", PISM_DOUBLE, {"y_corners", "x_corners"});
+    file.define_variable("lat_corners", PISM_DOUBLE, {"y_corners", "x_corners"});
+
+    file.write_attribute("PISM_GLOBAL", "proj", projection);
+    file.write_attribute("PISM_GLOBAL", "grid", PISM_DOUBLE,
+                         {(double)grid.Mx(), (double)grid.My(),
+                          grid.x(0), grid.y(0), grid.dx(), grid.dy()});
+
+    file.write_variable("lon", {ys, xs}, {ym, xm}, patch.lon.data());
+    file.write_variable("lat", {ys, xs}, {ym, xm}, patch.lat.data());
+    file.write_variable("lon_corners", {ys, xs}, {ym + 1, xm + 1}, patch.corner_lon.data());
+    file.write_variable("lat_corners", {ys, xs}, {ym + 1, xm + 1}, patch.corner_lat.data());
+    file.close();
+  }
+
+  int stat = 0;
+  if (rank == 0) {
+    stat = std::rename(tmp_filename.c_str(), filename.c_str());
+  }
+  MPI_Bcast(&stat, 1, MPI_INT, 0, grid.com);
+
+  if (stat != 0) {
+    throw RuntimeError::formatted(PISM_ERROR_LOCATION,
+                                  "can't move '%s' to '%s'",
+                                  tmp_filename.c_str(), filename.c_str());
+  }
+}
+
+/*!
+ * Returns longitudes and latitudes of cell centers and corners in the sub-domain of this
+ * process.
+ *
+ * Results are cached in memory (keyed by the projection string and the grid), so that
+ * saving `lon_bnds` and `lat_bnds` (e.g. to every extra file) does not call PROJ again.
+ * If `grid.projection_cache_file` is set, results are also read from (or saved to) this
+ * file, so that re-starting a run does not call PROJ at all.
+ */
+static const LonLatPatch& lon_lat(const std::string &projection, const IceGrid &grid) {
+  static std::map<std::string, LonLatPatch> cache;
+
+  const std::string key = lon_lat_key(projection, grid);
+
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    return it->second;
+  }
+
+  std::string filename = grid.ctx()->config()->get_string("grid.projection_cache_file");
+
+  LonLatPatch result;
+
+  if (filename.empty() or not read_lon_lat(filename, projection, grid, result)) {
+    Proj crs(projection, "EPSG:4326");
+    std::vector<double> no_z;
+
+    // Note: EPSG:4326 uses the (latitude, longitude) axis order.
+    cell_centers(grid, result.lat, result.lon);
+    transform(crs, result.lat, result.lon, no_z);
+
+    cell_corners(grid, result.corner_lat, result.corner_lon);
+    transform(crs, result.corner_lat, result.corner_lon, no_z);
+
+    if (not filename.empty()) {
+      write_lon_lat(filename, projection, grid, result);
+    }
+  }
+
+  return cache[key] = result;
+}
+
 void compute_cell_areas(const std::string &projection, IceModelVec2S &result) {
   IceGrid::ConstPtr grid = result.grid();
 
@@ -269,77 +521,56 @@ void compute_cell_areas(const std::string &projection, IceModelVec2S &result) {
 // +-----------+
 // (sw)        (se)
 
-  double dx2 = 0.5 * grid->dx(), dy2 = 0.5 * grid->dy();
+  std::vector<double> X, Y, Z;
+  cell_corners(*grid, X, Y);
+  Z.resize(X.size(), 0.0);
+  transform(pism_to_geocent, X, Y, Z);
+
+  const int
+    xs = grid->xs(),
+    ys = grid->ys(),
+    nx = grid->xm() + 1;
 
   IceModelVec::AccessList list(result);
 
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    const double
-      x = grid->x(i),
-      y = grid->y(j);
-    double
-      x_nw = x - dx2, y_nw = y + dy2,
-      x_ne = x + dx2, y_ne = y + dy2,
-      x_se = x + dx2, y_se = y - dy2,
-      x_sw = x - dx2, y_sw = y - dy2;
-
-    PJ_COORD in, out;
-
-    in.xy = {x_nw, y_nw};
-    out = proj_trans(*pism_to_geocent, PJ_FWD, in);
-    double nw[3] = {out.xyz.x, out.xyz.y, out.xyz.z};
-
-    in.xy = {x_ne, y_ne};
-    out = proj_trans(*pism_to_geocent, PJ_FWD, in);
-    double ne[3] = {out.xyz.x, out.xyz.y, out.xyz.z};
-
-    in.xy = {x_se, y_se};
-    out = proj_trans(*pism_to_geocent, PJ_FWD, in);
-    double se[3] = {out.xyz.x, out.xyz.y, out.xyz.z};
+    const int
+      sw = (j - ys) * nx + (i - xs),
+      se = sw + 1,
+      nw = sw + nx,
+      ne = nw + 1;
 
-    in.xy = {x_sw, y_sw};
-    out = proj_trans(*pism_to_geocent, PJ_FWD, in);
-    double sw[3] = {out.xyz.x, out.xyz.y, out.xyz.z};
+    double
+      SW[3] = {X[sw], Y[sw], Z[sw]},
+      SE[3] = {X[se], Y[se], Z[se]},
+      NE[3] = {X[ne], Y[ne], Z[ne]},
+      NW[3] = {X[nw], Y[nw], Z[nw]};
 
-    result(i, j) = triangle_area(sw, se, ne) + triangle_area(ne, nw, sw);
+    result(i, j) = triangle_area(SW, SE, NE) + triangle_area(NE, NW, SW);
   }
 }
 
 static void compute_lon_lat(const std::string &projection,
                             LonLat which, IceModelVec2S &result) {
 
-  Proj crs(projection, "EPSG:4326");
+  IceGrid::ConstPtr grid = result.grid();
 
-// Cell layout:
-// (nw)        (ne)
-// +-----------+
-// |           |
-// |           |
-// |     o     |
-// |           |
-// |           |
-// +-----------+
-// (sw)        (se)
+  const LonLatPatch &patch = lon_lat(projection, *grid);
+  const std::vector<double> &values = which == LONGITUDE ? patch.lon : patch.lat;
 
-  IceGrid::ConstPtr grid = result.grid();
+  const int
+    xs = grid->xs(),
+    ys = grid->ys(),
+    xm = grid->xm();
 
   IceModelVec::AccessList list{&result};
 
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    PJ_COORD in, out;
-
-    in.xy = {grid->x(i), grid->y(j)};
-    out = proj_trans(*crs, PJ_FWD, in);
-
-    if (which == LONGITUDE) {
-      result(i, j) = out.lp.phi;
-    } else {
-      result(i, j) = out.lp.lam;
-    }
+    result(i, j) = values[(j - ys) * xm + (i - xs)];
   }
 }
 
@@ -347,38 +578,32 @@ static void compute_lon_lat_bounds(const std::string &projection,
                                    LonLat which,
                                    IceModelVec3D &result) {
 
-  Proj crs(projection, "EPSG:4326");
-
   IceGrid::ConstPtr grid = result.grid();
 
-  double dx2 = 0.5 * grid->dx(), dy2 = 0.5 * grid->dy();
-  double x_offsets[] = {-dx2, dx2, dx2, -dx2};
-  double y_offsets[] = {-dy2, -dy2, dy2, dy2};
+  const LonLatPatch &patch = lon_lat(projection, *grid);
+  const std::vector<double> &values = which == LONGITUDE ? patch.corner_lon : patch.corner_lat;
+
+  const int
+    xs = grid->xs(),
+    ys = grid->ys(),
+    nx = grid->xm() + 1;
 
   IceModelVec::AccessList list{&result};
 
   for (Points p(*grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    double x0 = grid->x(i), y0 = grid->y(j);
+    const int
+      sw = (j - ys) * nx + (i - xs),
+      nw = sw + nx;
 
-    double *values = result.get_column(i, j);
+    double *column = result.get_column(i, j);
 
-    for (int k = 0; k < 4; ++k) {
-
-      PJ_COORD in, out;
-
-      in.xy = {x0 + x_offsets[k], y0 + y_offsets[k]};
-
-      // compute lon,lat coordinates:
-      out = proj_trans(*crs, PJ_FWD, in);
-
-      if (which == LATITUDE) {
-        values[k] = out.lp.lam;
-      } else {
-        values[k] = out.lp.phi;
-      }
-    }
+    // corners are listed counter-clockwise starting from the south-west one
+    column[0] = values[sw];
+    column[1] = values[sw + 1];
+    column[2] = values[nw + 1];
+    column[3] = values[nw];
   }
 }
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2018 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2018, 2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -17,6 +17,7 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <cmath>
+#include <algorithm>            // sort, unique, lower_bound
 
 #include "tests/exactTestsFG.hh"
 #include "tests/exactTestK.h"
@@ -102,20 +103,14 @@ void IceCompModel::initTestFG() {
 
   IceModelVec::AccessList list{&m_geometry.ice_thickness};
 
-  const double time = m_testname == 'F' ? 0.0 : m_time->current();
-  const double A    = m_testname == 'F' ? 0.0 : m_ApforG;
+  update_exact_FG();
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    // avoid singularity at origin
-    const double r = std::max(radius(*m_grid, i, j), 1.0);
+    const TestFGParameters *P = exact_FG(i, j);
 
-    if (r > m_LforFG - 1.0) { // if (essentially) outside of sheet
-      m_geometry.ice_thickness(i, j) = 0.0;
-    } else {
-      m_geometry.ice_thickness(i, j) = exactFG(time, r, m_grid->z(), A).H;
-    }
+    m_geometry.ice_thickness(i, j) = P != nullptr ? P->H : 0.0;
   }
 
   m_geometry.ice_thickness.update_ghosts();
@@ -162,20 +157,17 @@ void IceCompModel::getCompSourcesTestFG() {
 
   IceModelVec::AccessList list{&m_strain_heating3_comp};
 
-  const double time = m_testname == 'F' ? 0.0 : m_time->current();
-  const double A    = m_testname == 'F' ? 0.0 : m_ApforG;
+  update_exact_FG();
 
   for (Points p(*m_grid); p; p.next()) {
     const int i = p.i(), j = p.j();
 
-    double r = std::max(radius(*m_grid, i, j), 1.0); // avoid singularity at origin
+    const TestFGParameters *P = exact_FG(i, j);
 
-    if (r > m_LforFG - 1.0) {  // outside of sheet
+    if (P == nullptr) {  // outside of sheet
       m_strain_heating3_comp.set_column(i, j, 0.0);
     } else {
-      TestFGParameters P = exactFG(time, r, m_grid->z(), A);
-
-      m_strain_heating3_comp.set_column(i, j, &P.Sigc[0]);
+      m_strain_heating3_comp.set_column(i, j, &P->Sigc[0]);
     }
   }
 
@@ -183,6 +175,68 @@ void IceCompModel::getCompSourcesTestFG() {
   m_strain_heating3_comp.scale(ice_rho * ice_c);
 }
 
+/*!
+ * Compute exact solutions of tests F and G at the current time, if necessary.
+ *
+ * The exact solution is radially symmetric, so columns are computed once per distinct
+ * radius (up to 8 times fewer evaluations on symmetric grids) and shared by all grid
+ * points at this radius. The exact solution of test F does not depend on time, so it is
+ * computed once and re-used by all time steps and reports.
+ */
+void IceCompModel::update_exact_FG() {
+  const double time = m_testname == 'F' ? 0.0 : m_time->current();
+  const double A    = m_testname == 'F' ? 0.0 : m_ApforG;
+
+  if (time == m_exact_FG_time) {
+    return;
+  }
+
+  const int
+    xs = m_grid->xs(),
+    ys = m_grid->ys(),
+    xm = m_grid->xm(),
+    ym = m_grid->ym();
+
+  std::vector<double> r(xm * ym);
+  for (Points p(*m_grid); p; p.next()) {
+    const int i = p.i(), j = p.j();
+
+    // avoid singularity at origin
+    r[(j - ys) * xm + (i - xs)] = std::max(radius(*m_grid, i, j), 1.0);
+  }
+
+  // distinct radii inside the sheet, in increasing order
+  std::vector<double> radii(r);
+  std::sort(radii.begin(), radii.end());
+  radii.erase(std::unique(radii.begin(), radii.end()), radii.end());
+  radii.erase(std::upper_bound(radii.begin(), radii.end(), m_LforFG - 1.0), radii.end());
+
+  m_exact_FG = exactFG(time, radii, m_grid->z(), A);
+
+  m_exact_FG_index.resize(r.size());
+  for (unsigned int k = 0; k < r.size(); ++k) {
+    if (r[k] > m_LforFG - 1.0) { // if (essentially) outside of sheet
+      m_exact_FG_index[k] = -1;
+    } else {
+      m_exact_FG_index[k] = std::lower_bound(radii.begin(), radii.end(), r[k]) - radii.begin();
+    }
+  }
+
+  m_exact_FG_time = time;
+}
+
+/*!
+ * Return the exact solution of tests F and G at the grid point (i, j) or `nullptr` if
+ * this point is outside of the ice sheet.
+ *
+ * Call update_exact_FG() first.
+ */
+const TestFGParameters* IceCompModel::exact_FG(int i, int j) const {
+  const int n = m_exact_FG_index[(j - m_grid->ys()) * m_grid->xm() + (i - m_grid->xs())];
+
+  return n >= 0 ? &m_exact_FG[n] : nullptr;
+}
+
 void IceCompModel::computeTemperatureErrors(double &gmaxTerr,
                                             double &gavTerr) {
   double maxTerr = 0.0, avTerr = 0.0, avcount = 0.0;
@@ -191,8 +245,7 @@ void IceCompModel::computeTemperatureErrors(double &gmaxTerr,
     throw RuntimeError(PISM_ERROR_LOCATION, "temperature errors only computable for tests F and G");
   }
 
-  const double time = m_testname == 'F' ? 0.0 : m_time->current();
-  const double A    = m_testname == 'F' ? 0.0 : m_ApforG;
+  update_exact_FG();
 
   energy::TemperatureModel *m = dynamic_cast<energy::TemperatureModel*>(m_energy_model);
   const IceModelVec3 &ice_temperature = m->temperature();
@@ -210,7 +263,7 @@ void IceCompModel::computeTemperatureErrors(double &gmaxTerr,
       // only evaluate error if inside sheet and not at central
       // singularity
       if ((r >= 1.0) and (r <= m_LforFG - 1.0)) {
-        TestFGParameters P = exactFG(time, r, m_grid->z(), A);
+        const TestFGParameters &P = *exact_FG(i, j);
 
         // only evaluate error if below ice surface
         const int ks = m_grid->kBelowHeight(m_geometry.ice_thickness(i, j));
@@ -329,9 +382,8 @@ void IceCompModel::computeBasalTemperatureErrors(double &gmaxTerr, double &gavTe
     Terr       = 0.0,
     avTerr     = 0.0;
 
-  const double time = m_testname == 'F' ? 0.0 : m_time->current();
-  const double A    = m_testname == 'F' ? 0.0 : m_ApforG;
-  std::vector<double> z(1, 0.0);
+  // note: the lowest level of the vertical grid is at z = 0
+  update_exact_FG();
 
   energy::TemperatureModel *m = dynamic_cast<energy::TemperatureModel*>(m_energy_model);
   const IceModelVec3 &ice_temperature = m->temperature();
@@ -345,10 +397,11 @@ void IceCompModel::computeBasalTemperatureErrors(double &gmaxTerr, double &gavTe
 
       double r = std::max(radius(*m_grid, i, j), 1.0);
 
-      if (r > m_LforFG - 1.0) { // outside of sheet
+      const TestFGParameters *P = exact_FG(i, j);
+      if (P == nullptr) { // outside of sheet
         Texact = m_Tmin + m_ST * r; // = Ts
       } else {
-        Texact = exactFG(time, r, z, A).T[0];
+        Texact = P->T[0];
       }
 
       const double Tbase = ice_temperature.get_column(i,j)[0];
@@ -393,8 +446,7 @@ void IceCompModel::compute_strain_heating_errors(double &gmax_strain_heating_err
 
   IceModelVec::AccessList list{&m_geometry.ice_thickness, &strain_heating3};
 
-  const double time = m_testname == 'F' ? 0.0 : m_time->current();
-  const double A    = m_testname == 'F' ? 0.0 : m_ApforG;
+  update_exact_FG();
 
   ParallelSection loop(m_grid->com);
   try {
@@ -405,18 +457,14 @@ void IceCompModel::compute_strain_heating_errors(double &gmax_strain_heating_err
       if ((r >= 1.0) && (r <= m_LforFG - 1.0)) {
         // only evaluate error if inside sheet and not at central singularity
 
-        TestFGParameters P = exactFG(time, r, m_grid->z(), A);
-
-        for (unsigned int k = 0; k < m_grid->Mz(); k++) {
-          // scale exact strain_heating to J/(s m^3)
-          P.Sig[k] *= ice_rho * ice_c;
-        }
+        const TestFGParameters &P = *exact_FG(i, j);
 
         const unsigned int ks = m_grid->kBelowHeight(m_geometry.ice_thickness(i, j));
         const double *strain_heating = strain_heating3.get_column(i, j);
 
         for (unsigned int k = 0; k < ks; k++) {  // only evaluate error if below ice surface
-          const double strain_heating_err = fabs(strain_heating[k] - P.Sig[k]);
+          // scale exact strain_heating to J/(s m^3)
+          const double strain_heating_err = fabs(strain_heating[k] - P.Sig[k] * ice_rho * ice_c);
           max_strain_heating_err = std::max(max_strain_heating_err, strain_heating_err);
           avcount += 1.0;
           av_strain_heating_err += strain_heating_err;
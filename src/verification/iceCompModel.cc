@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2019 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -57,7 +57,8 @@ namespace pism {
 using units::convert;
 
 IceCompModel::IceCompModel(IceGrid::Ptr g, Context::Ptr context, int mytest)
-  : IceModel(g, context), m_testname(mytest), m_bedrock_is_ice_forK(false) {
+  : IceModel(g, context), m_testname(mytest), m_exact_FG_time(NAN),
+    m_bedrock_is_ice_forK(false) {
 
   m_log->message(2, "starting Test %c ...\n", m_testname);
 
@@ -65,6 +66,8 @@ IceCompModel::IceCompModel(IceGrid::Ptr g, Context::Ptr context, int mytest)
   m_config->set_number("stress_balance.sia.enhancement_factor", 1.0);
   // none use bed smoothing & bed roughness parameterization
   m_config->set_number("stress_balance.sia.bed_smoother.range", 0.0);
+  // errors are computed using 3D velocity and strain heating on levels of the grid
+  m_config->set_number("stress_balance.Mz", 0);
 
   // set values of flags in run()
   m_config->set_flag("geometry.update.enabled", true);
@@ -464,6 +467,9 @@ void IceCompModel::computeGeometryErrors(double &gvolexact, double &gareaexact,
   if (m_testname == 'L') {
     list.add(m_HexactL);
   }
+  if (m_testname == 'F' or m_testname == 'G') {
+    update_exact_FG();
+  }
 
   double
     seawater_density = m_config->get_number("constants.sea_water.density"),
@@ -499,21 +505,10 @@ void IceCompModel::computeGeometryErrors(double &gvolexact, double &gareaexact,
         Hexact = exactD(time, r).H;
         break;
       case 'F':
-        if (r > m_LforFG - 1.0) {  // outside of sheet
-          Hexact=0.0;
-        } else {
-          r=std::max(r,1.0);
-          std::vector<double> z(1, 0.0);
-          Hexact = exactFG(0.0, r, z, 0.0).H;
-        }
-        break;
       case 'G':
-        if (r > m_LforFG -1.0) {  // outside of sheet
-          Hexact=0.0;
-        } else {
-          r=std::max(r,1.0);
-          std::vector<double> z(1, 0.0);
-          Hexact = exactFG(time, r, z, m_ApforG).H;
+        {
+          const TestFGParameters *P = exact_FG(i, j);
+          Hexact = P != nullptr ? P->H : 0.0;
         }
         break;
       case 'H':
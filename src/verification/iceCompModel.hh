@@ -1,4 +1,4 @@
-// Copyright (C) 2004-2017 Jed Brown, Ed Bueler and Constantine Khroulev
+// Copyright (C) 2004-2017, 2020 Jed Brown, Ed Bueler and Constantine Khroulev
 //
 // This file is part of PISM.
 //
@@ -21,6 +21,7 @@
 
 #include "pism/icemodel/IceModel.hh"
 #include "pism/energy/BedThermalUnit.hh"
+#include "tests/exactTestsFG.hh"
 
 namespace pism {
 
@@ -70,6 +71,15 @@ protected:
   void initTestFG();
   void getCompSourcesTestFG();
 
+  // exact solutions of tests F and G at distinct radii of grid points in this sub-domain
+  void update_exact_FG();
+  const TestFGParameters* exact_FG(int i, int j) const;
+  std::vector<TestFGParameters> m_exact_FG;
+  // index into m_exact_FG for each grid point in this sub-domain (-1 outside the sheet)
+  std::vector<int> m_exact_FG_index;
+  // model time corresponding to m_exact_FG (NAN if it is not computed yet)
+  double m_exact_FG_time;
+
   // tests F and G
   void computeTemperatureErrors(double &gmaxTerr, double &gavTerr);
   // tests F and G
@@ -1,5 +1,5 @@
 /*
-   Copyright (C) 2004-2008, 2014, 2015, 2016 Ed Bueler and Jed Brown and Constantine Khroulev
+   Copyright (C) 2004-2008, 2014, 2015, 2016, 2020 Ed Bueler and Jed Brown and Constantine Khroulev
 
    This file is part of PISM.
 
@@ -204,4 +204,16 @@ TestFGParameters exactFG(double t, double r, const std::vector<double> &z, doubl
   return result;
 }
 
+std::vector<TestFGParameters> exactFG(double t, const std::vector<double> &r,
+                                      const std::vector<double> &z, double Cp) {
+  std::vector<TestFGParameters> result;
+  result.reserve(r.size());
+
+  for (double R : r) {
+    result.push_back(exactFG(t, R, z, Cp));
+  }
+
+  return result;
+}
+
 } // end of namespace pism
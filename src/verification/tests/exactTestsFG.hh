@@ -1,5 +1,5 @@
 /*
-   Copyright (C) 2004-2006, 2014, 2016 Jed Brown and Ed Bueler and Constantine Khroulev
+   Copyright (C) 2004-2006, 2014, 2016, 2020 Jed Brown and Ed Bueler and Constantine Khroulev
   
    This file is part of PISM.
   
@@ -53,6 +53,10 @@ struct TestFGParameters {
 
 TestFGParameters exactFG(double t, double r, const std::vector<double> &z, double Cp);
 
+/* Evaluates exactFG() at each radius in `r` (at time `t`, using levels `z`). */
+std::vector<TestFGParameters> exactFG(double t, const std::vector<double> &r,
+                                      const std::vector<double> &z, double Cp);
+
 /*
  * NOTE:  Units returned for Sig and Sigc are K/s (i.e. temperature) not J/s.
  * This matches the published sources above but requires conversion in
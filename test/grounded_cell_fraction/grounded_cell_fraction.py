@@ -12,13 +12,13 @@ ocean_density = ctx.config.get_number("constants.sea_water.density")
 mu = ice_density / ocean_density
 
 
-def allocate_grid(ctx):
+def allocate_grid(ctx, M=7):
     params = PISM.GridParameters(ctx.config)
     params.Lx = 1e5
     params.Ly = 1e5
     params.Lz = 1000
-    params.Mx = 7
-    params.My = 7
+    params.Mx = M
+    params.My = M
     params.Mz = 5
     params.periodicity = PISM.NOT_PERIODIC
     params.registration = PISM.CELL_CORNER
@@ -145,5 +145,36 @@ def new_grounded_cell_fraction_test():
         print_vec(gl_mask)
 
 
+def benchmark(M=1001, N=20):
+    "Time compute_grounded_cell_fraction() on a grid with a grounding line crossing every row."
+
+    grid = allocate_grid(ctx, M)
+
+    ice_thickness, bed_topography, _, _, gl_mask, _, _, sea_level = allocate_storage(grid)
+
+    sea_level.set(0.0)
+    ice_thickness.set(500.0)
+
+    # a bed sloping down towards the east: the grounding line is near x = 0
+    with PISM.vec.Access(nocomm=[bed_topography]):
+        for (i, j) in grid.points():
+            bed_topography[i, j] = -10.0 * (grid.x(i) + grid.y(j)) / grid.dx() - 450.0
+    bed_topography.update_ghosts()
+
+    start = time.time()
+    for k in range(N):
+        PISM.compute_grounded_cell_fraction(ice_density, ocean_density,
+                                            sea_level,
+                                            ice_thickness,
+                                            bed_topography,
+                                            gl_mask)
+    elapsed = time.time() - start
+
+    print("compute_grounded_cell_fraction: %d x %d grid, %f ms per call" % (M, M, 1e3 * elapsed / N))
+
+
 grounded_cell_fraction_test()
 new_grounded_cell_fraction_test()
+
+if __name__ == "__main__":
+    benchmark()
@@ -196,6 +196,30 @@ class ForcingInput(unittest.TestCase):
 
         self.check_forcing(forcing, self.f[-1], 0, 1)
 
+    def test_one_record_values(self):
+        "Input file with one time record: check values at all grid points"
+        filename = "one_record_values.nc"
+
+        v = PISM.IceModelVec2S(self.grid, "v", PISM.WITHOUT_GHOSTS)
+        with PISM.vec.Access(nocomm=v):
+            for (i, j) in self.grid.points():
+                v[i, j] = i + 10.0 * j
+
+        output = PISM.util.prepare_output(filename)
+        v.write(output)
+        output.close()
+
+        try:
+            forcing = self.forcing(filename)
+            forcing.update(0, 1)
+            forcing.average(0, 1)
+
+            with PISM.vec.Access(nocomm=forcing):
+                for (i, j) in self.grid.points():
+                    numpy.testing.assert_almost_equal(forcing[i, j], i + 10.0 * j)
+        finally:
+            os.remove(filename)
+
     def test_no_time_dimension(self):
         "Forcing without a time dimension"
         forcing = self.forcing(self.no_time)
@@ -315,3 +339,33 @@ class ForcingInput(unittest.TestCase):
         with PISM.vec.Access(nocomm=forcing):
             numpy.testing.assert_almost_equal(forcing.interp(0, 0),
                                               numpy.r_[self.f, self.f[0:(6 + 1)]])
+
+    def test_low_memory(self):
+        "Low-memory mode: incremental averages and growing the buffer"
+        year = 360 * 86400.0
+
+        # reference: all records in memory
+        forcing = self.forcing(self.filename)
+        forcing.update(0, year)
+        forcing.average(0, year)
+        with PISM.vec.Access(nocomm=forcing):
+            mean = forcing[0, 0]
+
+        ctx.config.set_flag("input.forcing.low_memory", True)
+        try:
+            forcing = self.forcing(self.filename)
+            assert forcing.n_records() == 2
+
+            forcing.update(0, year)
+            forcing.average(0, year)
+            compare(forcing, mean)
+            assert forcing.n_records() == 2
+
+            # time series at a point need all records covering the interval
+            ts = (numpy.r_[0:12] + 0.5) * 30 * 86400.0
+            forcing.init_interpolation(ts)
+            with PISM.vec.Access(nocomm=forcing):
+                numpy.testing.assert_almost_equal(forcing.interp(0, 0), self.f)
+            assert forcing.n_records() == 12
+        finally:
+            ctx.config.set_flag("input.forcing.low_memory", False)
@@ -595,6 +595,58 @@ def pism_context_test():
     print(ctx.prefix())
 
 
+def linear_converter_test():
+    "Test UnitLinearConverter and cached unit conversions"
+
+    system = PISM.UnitSystem("")
+
+    for spec1, spec2 in [("m year-1", "m second-1"), ("Celsius", "Kelvin"), ("km", "m")]:
+        c = PISM.UnitLinearConverter(system, spec1, spec2)
+
+        for x in [-10.0, 0.0, 1.0, 1234.5]:
+            exact = PISM.UnitConverter(system, spec1, spec2)(x)
+
+            np.testing.assert_allclose(c(x), exact, rtol=1e-14)
+            # repeated calls use a cached converter
+            assert PISM.convert(system, x, spec1, spec2) == exact
+            assert PISM.convert(system, x, spec1, spec2) == exact
+
+    try:
+        PISM.UnitLinearConverter(system, "m", "second")
+        assert False, "failed to detect incompatible units"
+    except RuntimeError:
+        pass
+
+
+def async_logger_test():
+    "Test AsyncLogger"
+
+    com = PISM.PETSc.COMM_WORLD
+    prefix = "async_logger_test"
+    filename = "{}.{}.log".format(prefix, com.rank)
+
+    try:
+        logger = PISM.AsyncLogger(com, 2, 1024, prefix)
+
+        logger.message(2, "a message\n")
+        logger.debug("a debugging message\n")
+        logger.flush()
+
+        with open(filename) as f:
+            assert f.read() == "a debugging message\n"
+
+        # messages that don't fit in the buffer are dropped
+        logger.debug("x" * 2048)
+        logger.flush()
+
+        with open(filename) as f:
+            assert "1 log messages were dropped" in f.read()
+
+        del logger
+    finally:
+        os.remove(filename)
+
+
 def check_flow_law(factory, flow_law_name, EC, stored_data):
     factory.set_default(flow_law_name)
     law = factory.create()
@@ -671,6 +723,46 @@ def flowlaw_test():
         check_flow_law(factory, flow_law_name, EC, np.array(data))
 
 
+def arrhenius_table_test():
+    "Relative error of the Paterson-Budd Arrhenius factor lookup tables"
+    ctx = PISM.context_from_options(PISM.PETSc.COMM_WORLD, "arrhenius_table_test")
+    config = ctx.config()
+    EC = ctx.enthalpy_converter()
+
+    tolerance = 1e-6
+    config.set_number("flow_law.Paterson_Budd.lookup_table_tolerance", tolerance)
+    try:
+        factory = PISM.FlowLawFactory("stress_balance.sia.", config, EC)
+        factory.set_default("pb")
+        law = factory.create()
+    finally:
+        config.set_number("flow_law.Paterson_Budd.lookup_table_tolerance", 0.0)
+
+    R = config.get_number("constants.ideal_gas_constant")
+    T_critical = config.get_number("flow_law.Paterson_Budd.T_critical")
+    T_melting = config.get_number("constants.fresh_water.melting_point_temperature")
+
+    def exact(T):
+        if T < T_critical:
+            A = config.get_number("flow_law.Paterson_Budd.A_cold")
+            Q = config.get_number("flow_law.Paterson_Budd.Q_cold")
+        else:
+            A = config.get_number("flow_law.Paterson_Budd.A_warm")
+            Q = config.get_number("flow_law.Paterson_Budd.Q_warm")
+        return A * np.exp(-Q / (R * T))
+
+    # sample both the cold and the warm range covered by the tables (at zero pressure the
+    # pressure-adjusted temperature is equal to the temperature)
+    np.random.seed(1)
+    T = np.r_[np.linspace(T_critical - 100.0, T_melting, 1001),
+              np.random.uniform(T_critical - 100.0, T_melting, 1000)]
+
+    pressure = 0.0
+    for t in T:
+        E = EC.enthalpy(t, 0.0, pressure)
+        assert abs(law.softness(E, pressure) / exact(t) - 1.0) <= tolerance
+
+
 def ssa_trivial_test():
     "Test the SSA solver using a trivial setup."
 
@@ -726,6 +818,131 @@ def ssa_trivial_test():
     finally:
         os.remove(output_file)
 
+class SSATestI(PISM.ssa.SSAExactTestCase):
+    "Schoof's ice stream (verification test I) used to compare SSA solvers"
+    m, L, H0, B = 10, 40e3, 2000.0, 3.7e8
+
+    def _initGrid(self):
+        Ly = 3 * self.L
+        Lx = max(60.0e3, ((self.Mx - 1) / 2.0) * (2.0 * Ly / (self.My - 1)))
+        self.grid = PISM.IceGrid.Shallow(ctx.ctx, Lx, Ly, 0, 0, self.Mx, self.My,
+                                         PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    def _initPhysics(self):
+        self.modeldata.setPhysics(ctx.enthalpy_converter)
+
+    def _initSSACoefficients(self):
+        self._allocStdSSACoefficients()
+        self._allocateBCs()
+        vecs = self.modeldata.vecs
+        grid = self.grid
+
+        vecs.bc_mask.set(0)
+        vecs.thk.set(self.H0)
+        vecs.mask.set(PISM.MASK_GROUNDED)
+
+        g = self.config.get_number("constants.standard_gravity")
+        rho = self.config.get_number("constants.ice.density")
+        f = rho * g * self.H0 * 0.001
+
+        with PISM.vec.Access(comm=[vecs.tauc, vecs.surface_altitude, vecs.bedrock_altitude,
+                                   vecs.vel_bc, vecs.bc_mask]):
+            for (i, j) in grid.points():
+                p = PISM.exactI(self.m, grid.x(i), grid.y(j))
+                vecs.tauc[i, j] = f * abs(grid.y(j) / self.L) ** self.m
+                vecs.bedrock_altitude[i, j] = p.bed
+                vecs.surface_altitude[i, j] = p.bed + self.H0
+
+                if i in (0, grid.Mx() - 1) or j in (0, grid.My() - 1):
+                    vecs.bc_mask[i, j] = 1
+                    vecs.vel_bc[i, j].u = p.u
+                    vecs.vel_bc[i, j].v = p.v
+
+    def exactSolution(self, i, j, x, y):
+        p = PISM.exactI(self.m, x, y)
+        return [p.u, p.v]
+
+def solve_ssa_test_i(method, parameters, petsc_options):
+    """Solve test I using the SSA solver `method` with configuration `parameters` and
+    PETSc options `petsc_options` set. Returns the velocity (on rank 0) and the SSA report.
+    """
+    config = ctx.config
+    options = PISM.PETSc.Options()
+
+    saved = PISM.DefaultConfig(ctx.com, "saved", "-config", ctx.unit_system)
+    saved.init_with_default(ctx.log)
+    saved.import_from(config)
+
+    log_threshold = ctx.log.get_threshold()
+    try:
+        config.set_string("stress_balance.ssa.method", method)
+        config.set_flag("basal_resistance.pseudo_plastic.enabled", False)
+        config.set_string("stress_balance.ssa.flow_law", "isothermal_glen")
+        config.set_number("flow_law.isothermal_Glen.ice_softness",
+                          SSATestI.B ** (-config.get_number("stress_balance.ssa.Glen_exponent")))
+        config.set_flag("stress_balance.ssa.compute_surface_gradient_inward", True)
+        config.set_number("stress_balance.ssa.epsilon", 0.0)
+
+        for name, value in parameters.items():
+            if isinstance(value, bool):
+                config.set_flag(name, value)
+            else:
+                config.set_number(name, value)
+
+        for name, value in petsc_options.items():
+            options.setValue(name, value)
+
+        # the SSA report includes iteration counts at this verbosity level
+        ctx.log.set_threshold(2)
+
+        run = SSATestI(5, 31)
+        run.setup()
+        velocity = run.solve().numpy()
+
+        return velocity, run.ssa.stdout_report()
+    finally:
+        ctx.log.set_threshold(log_threshold)
+        for name in petsc_options:
+            options.delValue(name)
+        config.import_from(saved)
+
+def ssafd_anderson_test():
+    "SSAFD: Anderson acceleration of Picard iterations converges to the same solution"
+
+    options = {"-ssafd_ksp_rtol": 1e-12}
+
+    def solve(anderson):
+        return solve_ssa_test_i("fd",
+                                {"stress_balance.ssa.fd.relative_convergence": 1e-9,
+                                 "stress_balance.ssa.fd.anderson.enabled": anderson},
+                                options)
+
+    picard, _ = solve(False)
+    accelerated, report = solve(True)
+
+    # the accelerated solver was used...
+    assert "accelerated" in report
+
+    # ... and converged to the same solution
+    np.testing.assert_allclose(accelerated, picard, rtol=0,
+                               atol=1e-6 * np.max(np.abs(picard)))
+
+def ssafem_matrix_free_test():
+    "SSAFEM: the matrix-free Jacobian gives the same solution as the assembled one"
+
+    options = {"-snes_rtol": 1e-10, "-ksp_rtol": 1e-10}
+
+    def solve(matrix_free):
+        return solve_ssa_test_i("fem",
+                                {"stress_balance.ssa.fem.matrix_free_jacobian": matrix_free},
+                                options)
+
+    assembled, _ = solve(False)
+    matrix_free, _ = solve(True)
+
+    np.testing.assert_allclose(matrix_free, assembled, rtol=0,
+                               atol=1e-6 * np.max(np.abs(assembled)))
+
 def epsg_test():
     "Test EPSG to CF conversion."
     l = PISM.StringLogger(PISM.PETSc.COMM_WORLD, 2)
@@ -802,6 +1019,80 @@ def regridding_test():
 
 
 
+def in_memory_regridding_test():
+    "Test regridding from a field on a different grid: same result as a file round trip."
+
+    def create_grid(Mx, My, Mz):
+        params = PISM.GridParameters(ctx.config)
+        params.Lx = 1e5
+        params.Ly = 2e5
+        params.Mx = Mx
+        params.My = My
+        params.Mz = Mz
+        params.Lz = 1000
+        params.registration = PISM.CELL_CORNER
+        params.periodicity = PISM.NOT_PERIODIC
+        params.ownership_ranges_from_options(ctx.size)
+        params.z[:] = np.linspace(0, params.Lz, params.Mz)
+
+        return PISM.IceGrid(ctx.ctx, params)
+
+    coarse = create_grid(11, 21, 11)
+    fine = create_grid(21, 41, 21)
+
+    np.random.seed(99)
+
+    # a smooth function plus noise (so that interpolation weights matter)
+    def f(x, y, z):
+        return np.sin(x / 3e4) * np.cos(y / 5e4) + 1e-3 * z + 0.1 * np.random.rand()
+
+    source_2d = PISM.IceModelVec2S(coarse, "thk", PISM.WITH_GHOSTS)
+    source_3d = PISM.IceModelVec3(coarse, "temp", PISM.WITHOUT_GHOSTS)
+    for v in [source_2d, source_3d]:
+        v.set_attrs("internal", "test field", "m", "m", "", 0)
+
+    z = np.array(coarse.z())
+    with PISM.vec.Access(nocomm=[source_2d, source_3d]):
+        for (i, j) in coarse.points():
+            x, y = coarse.x(i), coarse.y(j)
+            source_2d[i, j] = f(x, y, 0.0)
+            source_3d.set_column(i, j, [f(x, y, zk) for zk in z])
+    source_2d.update_ghosts()
+
+    filename = "in_memory_regridding.nc"
+    output = PISM.util.prepare_output(filename)
+    source_2d.write(output)
+    source_3d.write(output)
+    output.close()
+
+    try:
+        for source, target_file, target_memory in [
+                (source_2d,
+                 PISM.IceModelVec2S(fine, "thk", PISM.WITH_GHOSTS),
+                 PISM.IceModelVec2S(fine, "thk", PISM.WITH_GHOSTS)),
+                (source_3d,
+                 PISM.IceModelVec3(fine, "temp", PISM.WITHOUT_GHOSTS),
+                 PISM.IceModelVec3(fine, "temp", PISM.WITHOUT_GHOSTS))]:
+            for v in [target_file, target_memory]:
+                v.set_attrs("internal", "test field", "m", "m", "", 0)
+
+            target_file.regrid(filename, critical=True)
+            target_memory._regrid(source)
+
+            expected = target_file.numpy()
+            result = target_memory.numpy()
+            if ctx.rank == 0:
+                np.testing.assert_allclose(result, expected, rtol=0, atol=1e-12)
+
+            # ghosts are up to date
+            if target_memory.stencil_width() > 0:
+                target_file.update_ghosts()
+                with target_file.local_array(read_only=True) as a:
+                    with target_memory.local_array(read_only=True) as b:
+                        np.testing.assert_allclose(b, a, rtol=0, atol=1e-12)
+    finally:
+        os.remove(filename)
+
 def interpolation_weights_test():
     "Test 2D interpolation weights."
 
@@ -1059,6 +1350,23 @@ def test_timeseries_linear_interpolation():
 
         assert ts(T) == f(T), (T, ts(T), f(T))
 
+def test_timeseries_evaluate():
+    "Evaluating a Timeseries at many times at once"
+
+    ctx = PISM.Context()
+    ts = PISM.Timeseries(ctx.com, ctx.unit_system, "test", "time")
+
+    t = np.arange(11, dtype=np.float64)
+    for k in range(len(t) - 1):
+        ts.append(np.sin(t[k + 1]), t[k], t[k + 1])
+
+    for use_bounds in [True, False]:
+        ts.set_use_bounds(use_bounds)
+
+        # sorted, unsorted, and with repeated values
+        for T in [np.linspace(-1, 12, 101), [5.5, 0.25, 9.0, 9.0, 9.0, 3.0, 12.0]]:
+            np.testing.assert_equal(ts.evaluate(T), [ts(x) for x in T])
+
 def test_trapezoid_integral():
     "Linear integration weights"
     x = [0.0, 0.5, 1.0, 2.0]
@@ -1219,3 +1527,399 @@ class ForcingOptions(TestCase):
         ctx.config.import_from(self.config)
 
         os.remove(self.filename)
+
+def label_components_test():
+    "Connected component labeling"
+    import scipy.ndimage
+
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, 41, 31,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    np.random.seed(1)
+    # 0 - background, 1 - "floating", 2 - "grounded"
+    image = np.random.choice([0, 1, 2], size=(grid.My(), grid.Mx()), p=[0.4, 0.5, 0.1])
+
+    mask = PISM.IceModelVec2Int(grid, "mask", PISM.WITHOUT_GHOSTS)
+
+    def set_mask():
+        with PISM.vec.Access(nocomm=mask):
+            for (i, j) in grid.points():
+                mask[i, j] = image[j, i]
+
+    # label components (4-connectivity)
+    labels, n_labels = scipy.ndimage.label(image > 0)
+
+    set_mask()
+    PISM.label_components(mask, False, 0)
+    np.testing.assert_equal(mask.numpy(), labels)
+
+    # identify "icebergs", i.e. components that do not contain cells marked as "grounded"
+    grounded = np.unique(labels[image == 2])
+    icebergs = np.logical_and(labels > 0, np.logical_not(np.isin(labels, grounded)))
+
+    set_mask()
+    PISM.label_components(mask, True, 2)
+    np.testing.assert_equal(mask.numpy() == 1, icebergs)
+
+def vec_pool_test():
+    "VecPool: shared Vecs are not pooled; entries of destroyed DMs are dropped"
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, 11, 11,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    memory = ctx.ctx.memory()
+
+    def pooled():
+        return memory.current("Vec pool")
+
+    p0 = pooled()
+
+    # storage referenced elsewhere (here: by a petsc4py Vec) is not pooled...
+    a = PISM.IceModelVec2S(grid, "a", PISM.WITHOUT_GHOSTS)
+    a_vec = a.vec()
+    del a
+    assert pooled() == p0
+
+    # ... so a new field does not alias it
+    b = PISM.IceModelVec2S(grid, "b", PISM.WITHOUT_GHOSTS)
+    b.set(1.0)
+    assert b.vec().handle != a_vec.handle
+    del a_vec
+
+    # storage that is not referenced elsewhere is pooled
+    del b
+    p1 = pooled()
+    assert p1 > p0
+
+    # the DM used by this field (dof=2, stencil width=2) is not used by anything else, so
+    # it is destroyed together with the field...
+    c = PISM.IceModelVec2V(grid, "c", PISM.WITH_GHOSTS, 2)
+    del c
+    assert pooled() > p1
+
+    # ... and the pool drops the entry the next time it is used (here: a layout that has
+    # no pooled Vecs)
+    d = PISM.IceModelVec2S(grid, "d", PISM.WITH_GHOSTS, 1)
+    assert pooled() == p1
+
+    # pooled storage is zeroed when it is re-used
+    e = PISM.IceModelVec2S(grid, "e", PISM.WITHOUT_GHOSTS)
+    assert pooled() == p0
+    np.testing.assert_equal(e.numpy(), 0.0)
+
+def eikonal_equation_test():
+    "Distances computed by PICO's eikonal_equation()"
+    from collections import deque
+
+    Mx, My = 41, 31
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, Mx, My,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    # -1 - outside the domain, 0 - domain, 1 - front
+    image = np.zeros((My, Mx))
+    image[0, :] = -1
+    image[-1, :] = -1
+    image[:, 0] = -1
+    image[:, -1] = -1
+    # a wall that makes the domain non-convex
+    image[1:-8, Mx // 2] = -1
+    # an isolated part of the domain
+    image[-6:-1, 1:6] = -1
+    image[-4, 3] = 0
+    # the front
+    image[5, 2] = 1
+
+    # breadth-first search
+    expected = image.copy()
+    queue = deque([(5, 2)])
+    while queue:
+        j, i = queue.popleft()
+        for (jj, ii) in [(j + 1, i), (j - 1, i), (j, i + 1), (j, i - 1)]:
+            if expected[jj, ii] == 0:
+                expected[jj, ii] = expected[j, i] + 1
+                queue.append((jj, ii))
+
+    mask = PISM.IceModelVec2Int(grid, "mask", PISM.WITH_GHOSTS)
+    with PISM.vec.Access(nocomm=mask):
+        for (i, j) in grid.points():
+            mask[i, j] = image[j, i]
+    mask.update_ghosts()
+
+    PISM.eikonal_equation(mask)
+
+    np.testing.assert_equal(mask.numpy(), expected)
+
+def level_view_test():
+    "LevelView: a level-major copy of an IceModelVec3"
+    grid = create_dummy_grid()
+
+    v = PISM.IceModelVec3(grid, "v", PISM.WITH_GHOSTS, 1)
+    z = np.array(grid.z())
+    with PISM.vec.Access(nocomm=v):
+        for (i, j) in grid.points():
+            v.set_column(i, j, i + 100.0 * j + z * 1e-3)
+    v.update_ghosts()
+
+    view = PISM.LevelView(v, 1)
+    view.update(v)
+
+    with PISM.vec.Access(nocomm=v):
+        for (i, j) in grid.points_with_ghosts(1):
+            for k in [0, len(z) // 2, len(z) - 1]:
+                assert view.value(i, j, k) == v[i, j, k]
+
+    # horizontal slices computed using the view and the original field are the same
+    a = PISM.IceModelVec2S(grid, "a", PISM.WITHOUT_GHOSTS)
+    b = PISM.IceModelVec2S(grid, "b", PISM.WITHOUT_GHOSTS)
+    for height in [0.0, 0.5 * (z[1] + z[2]), z[-1]]:
+        view.get_slice(height, a)
+        v.getHorSlice(b, height)
+        np.testing.assert_equal(a.numpy(), b.numpy())
+
+    view.get_level(1, a)
+    v.getHorSlice(b, z[1])
+    np.testing.assert_equal(a.numpy(), b.numpy())
+
+def local_array_test():
+    "Test IceModelVec.local_array()"
+    grid = create_dummy_grid()
+
+    a = PISM.IceModelVec2S(grid, "a", PISM.WITH_GHOSTS, 2)
+    b = PISM.IceModelVec2S(grid, "b", PISM.WITHOUT_GHOSTS)
+
+    with PISM.vec.Access(nocomm=b):
+        for (i, j) in grid.points():
+            b[i, j] = i + 100.0 * j
+
+    a.copy_from(b)
+    a.update_ghosts()
+
+    counter = a.get_state_counter()
+
+    w = a.stencil_width()
+    xs, ys = grid.xs(), grid.ys()
+    with a.local_array() as data:
+        assert data.shape == (grid.ym() + 2 * w, grid.xm() + 2 * w)
+        for (i, j) in grid.points_with_ghosts(w):
+            assert data[j - ys + w, i - xs + w] == (i % grid.Mx()) + 100.0 * (j % grid.My())
+
+        data *= 2.0
+
+    assert a.get_state_counter() == counter + 1
+
+    b.scale(2.0)
+    np.testing.assert_equal(a.numpy(), b.numpy())
+
+    # vector fields and 3D fields have one more dimension
+    v = PISM.IceModelVec2V(grid, "v", PISM.WITHOUT_GHOSTS)
+    with v.local_array(read_only=True) as data:
+        assert data.shape == (grid.ym(), grid.xm(), 2)
+        assert not data.flags.writeable
+
+    T = PISM.IceModelVec3(grid, "T", PISM.WITHOUT_GHOSTS)
+    with T.local_array(read_only=True) as data:
+        assert data.shape == (grid.ym(), grid.xm(), grid.Mz())
+
+def geometry_consistency_test():
+    "Geometry::ensure_consistency(): incremental updates match a full re-computation"
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, 21, 21,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    np.random.seed(83)
+
+    geometry = PISM.Geometry(grid)
+
+    x = np.linspace(-1, 1, grid.Mx())
+    with PISM.vec.Access(nocomm=[geometry.bed_elevation, geometry.ice_thickness]):
+        for (i, j) in grid.points():
+            geometry.bed_elevation[i, j] = 500.0 * x[i]
+            geometry.ice_thickness[i, j] = np.random.choice([0.0, 50.0, 300.0, 1000.0])
+    geometry.bed_elevation.update_ghosts()
+    geometry.sea_level_elevation.set(0.0)
+    geometry.ice_area_specific_volume.set(0.0)
+
+    def check(threshold):
+        "Compare to a new Geometry instance (the first call re-computes everything)"
+        expected = PISM.Geometry(grid)
+        for name in ["bed_elevation", "sea_level_elevation",
+                     "ice_thickness", "ice_area_specific_volume"]:
+            getattr(expected, name).copy_from(getattr(geometry, name))
+        expected.ensure_consistency(threshold)
+
+        for name in ["ice_thickness", "ice_area_specific_volume",
+                     "cell_type", "ice_surface_elevation", "cell_grounded_fraction"]:
+            with getattr(geometry, name).local_array(read_only=True) as a:
+                with getattr(expected, name).local_array(read_only=True) as b:
+                    # compare bit-for-bit, including ghosts
+                    np.testing.assert_array_equal(a, b, err_msg=name)
+
+    def edit(field, i0, j0, value, size=1):
+        "Modify owned values of a field, leaving ghosts alone"
+        with PISM.vec.Access(nocomm=field):
+            for (i, j) in grid.points():
+                if i0 <= i < i0 + size and j0 <= j < j0 + size:
+                    field[i, j] = value
+
+    threshold = 0.01
+    geometry.ensure_consistency(threshold)
+    check(threshold)
+
+    for step in range(30):
+        i, j = np.random.randint(0, grid.Mx()), np.random.randint(0, grid.My())
+        kind = step % 6
+
+        if kind == 0:
+            # nothing changed
+            pass
+        elif kind == 1:
+            # a patch of thick ice (grounded or floating, depending on the bed)
+            edit(geometry.ice_thickness, i, j, 600.0, size=3)
+        elif kind == 2:
+            # remove ice at a point (possibly at a sub-domain or domain boundary)
+            edit(geometry.ice_thickness, i, j, 0.0)
+        elif kind == 3:
+            # ice thinner than the threshold
+            edit(geometry.ice_thickness, i, j, 0.5 * threshold)
+        elif kind == 4:
+            # a partially filled cell next to the ice
+            edit(geometry.ice_thickness, i, j, 0.0)
+            edit(geometry.ice_area_specific_volume, i, j, 20.0)
+        else:
+            # change the sea level locally
+            edit(geometry.sea_level_elevation, i, j, 100.0)
+            geometry.sea_level_elevation.update_ghosts()
+
+        geometry.ensure_consistency(threshold)
+        check(threshold)
+
+    # change the ice-free thickness threshold only
+    threshold = 100.0
+    geometry.ensure_consistency(threshold)
+    check(threshold)
+
+    # stale ghosts of the ice thickness are updated even if nothing changed at owned grid
+    # points
+    w = geometry.ice_thickness.stencil_width()
+    with geometry.ice_thickness.local_array() as H:
+        H[:w, :] = -1.0
+    geometry.ensure_consistency(threshold)
+    check(threshold)
+
+def calendar_year_fraction_test():
+    "Time_Calendar: re-using year bounds in year_fraction() and calendar_year_start()"
+    def create():
+        return PISM.Time_Calendar(ctx.com, ctx.config, "gregorian", ctx.unit_system)
+
+    time = create()
+
+    day = 86400.0
+    # cover several years, including a leap year, both forward and backward in time
+    times = [k * 30.5 * day for k in range(60)]
+    times = times + times[::-1]
+
+    for t in times:
+        # a new object does not have year bounds computed earlier
+        expected = create()
+
+        np.testing.assert_almost_equal(time.year_fraction(t), expected.year_fraction(t))
+        assert time.calendar_year_start(t) == expected.calendar_year_start(t)
+        assert 0.0 <= time.year_fraction(t) < 1.0
+
+
+def diagnostic_borrow_test():
+    "Writing a diagnostic directly from the storage it wraps"
+    grid = create_dummy_grid()
+
+    a = PISM.IceModelVec2S(grid, "a", PISM.WITH_GHOSTS)
+    a.set_attrs("diagnostic", "test field", "m", "m", "", 0)
+    a.set_time_independent(True)
+    a.set(1.5)
+
+    diag = PISM.Diagnostic.wrap(a)
+    assert diag.borrow() is not None
+
+    output_file = "test_diagnostic_borrow.nc"
+    try:
+        f = PISM.File(grid.com, output_file, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_MOVE)
+        diag.define(f, PISM.PISM_DOUBLE)
+        diag.write(f)
+        f.close()
+
+        b = PISM.IceModelVec2S(grid, "a", PISM.WITHOUT_GHOSTS)
+        b.set_attrs("diagnostic", "test field", "m", "m", "", 0)
+        b.read(output_file, 0)
+
+        np.testing.assert_almost_equal(b.numpy(), a.numpy())
+    finally:
+        os.remove(output_file)
+
+class CountingListener(PISM.StepListener):
+    "Records the step counter every time it is notified."
+    def __init__(self):
+        PISM.StepListener.__init__(self)
+        self.steps = []
+
+    def after_steps(self, time, step_counter):
+        self.steps.append(step_counter)
+
+class StepListener(TestCase):
+    def setUp(self):
+        # store current configuration parameters
+        self.config = PISM.DefaultConfig(ctx.com, "pism_config", "-config", ctx.unit_system)
+        self.config.init_with_default(ctx.log)
+        self.config.import_from(ctx.config)
+
+        self.filename = "step-listener-input.nc"
+
+        ctx.config.set_number("grid.Mx", 11)
+        ctx.config.set_number("grid.My", 11)
+        ctx.config.set_number("grid.Mz", 11)
+
+        params = PISM.GridParameters(ctx.config)
+        params.ownership_ranges_from_options(ctx.size)
+        self.grid = PISM.IceGrid(ctx.ctx, params)
+
+        thk = PISM.model.createIceThicknessVec(self.grid)
+        thk.set(1000.0)
+        topg = PISM.model.createBedrockElevationVec(self.grid)
+        topg.set(0.0)
+
+        output = PISM.util.prepare_output(self.filename)
+        thk.write(output)
+        topg.write(output)
+        output.close()
+
+        ctx.config.set_string("input.file", self.filename)
+        ctx.config.set_flag("input.bootstrap", True)
+        ctx.config.set_string("surface.models", "elevation")
+
+        self.start = ctx.time.current()
+        self.end = ctx.time.end()
+
+    def test_run_with_listener(self):
+        "IceModel.run_with_listener() calls the listener every N steps and after the last one"
+        model = PISM.IceModel(self.grid, ctx.ctx)
+        model.init()
+
+        listener = CountingListener()
+        interval = 2
+        model.run_with_listener(self.start + PISM.util.convert(100, "years", "seconds"),
+                                listener, interval)
+
+        steps = listener.steps
+        assert len(steps) > 0
+        assert all(n % interval == 0 for n in steps[:-1])
+        assert steps == sorted(steps)
+
+        try:
+            model.run_with_listener(ctx.time.current(), listener, 0)
+            assert False, "failed to catch a zero listener interval"
+        except RuntimeError:
+            pass
+
+    def tearDown(self):
+        # reset configuration parameters and the model time
+        ctx.config.import_from(self.config)
+        ctx.time.set_end(self.end)
+        ctx.time.set(self.start)
+
+        os.remove(self.filename)
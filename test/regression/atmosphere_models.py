@@ -184,6 +184,9 @@ class DeltaT(TestCase):
 
         check_modifier(self.model, modifier, T=self.dT, ts=[0.5], Ts=[self.dT], Ps=[0])
 
+        # scalar offsets preserve spatial uniformity
+        assert modifier.spatially_uniform()
+
 class DeltaP(TestCase):
     def setUp(self):
         self.filename = "atmosphere_delta_P_input.nc"
@@ -359,6 +362,8 @@ class OneStation(TestCase):
 
         check_model(model, P=self.P, T=self.T, ts=[0.5], Ts=[self.T], Ps=[self.P])
 
+        assert model.spatially_uniform()
+
 class Uniform(TestCase):
     def setUp(self):
         self.grid = shallow_grid()
@@ -380,6 +385,8 @@ class Uniform(TestCase):
         P = PISM.util.convert(self.P, "kg m-2 year-1", "kg m-2 s-1")
         check_model(model, T=self.T, P=P, ts=[0.5], Ts=[self.T], Ps=[P])
 
+        assert model.spatially_uniform()
+
 class Anomaly(TestCase):
     def setUp(self):
         self.filename = "atmosphere_anomaly_input.nc"
@@ -419,6 +426,8 @@ class Anomaly(TestCase):
         check_modifier(self.model, modifier, T=self.dT, P=self.dP,
                        ts=[0.5], Ts=[self.dT], Ps=[self.dP])
 
+        assert not modifier.spatially_uniform()
+
 class PrecipScaling(TestCase):
     def setUp(self):
         self.filename = "atmosphere_precip_scaling_input.nc"
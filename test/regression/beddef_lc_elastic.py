@@ -1,7 +1,8 @@
 #!/usr/bin/env python3
 
-from unittest import TestCase
+from unittest import TestCase, SkipTest
 
+import os
 import numpy as np
 import scipy.integrate
 import scipy.signal
@@ -131,7 +132,122 @@ class LingleClarkElastic(TestCase):
         # This is a crappy relative tolerance. Oh well...
         np.testing.assert_allclose(self.lrm_pism, lrm_python, rtol=1e-2)
 
+    def lrm_cache_test(self):
+        "Check that using a cached load response matrix does not change results"
+        config = self.ctx.config
+        cache_file = "beddef_lc_elastic_lrm_cache.nc"
+
+        try:
+            config.set_string("bed_deformation.lc.lrm_cache_file", cache_file)
+
+            # the first run computes and saves the LRM, the second one reads it
+            H, db_computed, _ = self.run_model(self.grid)
+            assert os.path.exists(cache_file)
+            H, db_cached, _ = self.run_model(self.grid)
+        finally:
+            config.set_string("bed_deformation.lc.lrm_cache_file", "")
+            if os.path.exists(cache_file):
+                os.remove(cache_file)
+
+        np.testing.assert_allclose(db_computed, self.db_pism, rtol=1e-12)
+        np.testing.assert_allclose(db_cached, self.db_pism, rtol=1e-12)
+
     def tearDown(self):
         # reset configuration parameters
         self.ctx.config.set_flag("bed_deformation.lc.elastic_model", self.elastic)
         self.ctx.config.set_number("bed_deformation.lc.grid_size_factor", self.size_factor)
+
+def lc_mpi_test():
+    "Compare results of the serial and distributed versions of the Lingle-Clark model"
+    if not PISM.Pism_USE_FFTW_MPI:
+        raise SkipTest("PISM was built without FFTW's MPI interface")
+
+    ctx = PISM.Context()
+    config = ctx.config
+
+    model = config.get_string("bed_deformation.model")
+
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 2000e3, 2000e3, 0, 0, 11, 22,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    try:
+        config.set_string("bed_deformation.model", "lc")
+        H, db_serial, lrm_serial = LingleClarkElastic.run_model(grid)
+
+        config.set_string("bed_deformation.model", "lc_mpi")
+        H, db_parallel, lrm_parallel = LingleClarkElastic.run_model(grid)
+    finally:
+        config.set_string("bed_deformation.model", model)
+
+    np.testing.assert_allclose(lrm_parallel, lrm_serial, rtol=1e-12)
+    np.testing.assert_allclose(db_parallel, db_serial, rtol=1e-10, atol=1e-12)
+
+def run_viscous(grid, n_steps, dt):
+    "Run the Lingle-Clark model for `n_steps` steps of length `dt` with a changing load."
+    geometry = PISM.Geometry(grid)
+
+    bed_model = PISM.LingleClark(grid)
+
+    bed_uplift = PISM.IceModelVec2S(grid, "uplift", PISM.WITHOUT_GHOSTS)
+
+    # start with a flat bed, no ice, and no uplift
+    geometry.bed_elevation.set(0.0)
+    geometry.ice_thickness.set(0.0)
+    geometry.sea_level_elevation.set(-1000.0) # everything is grounded
+    geometry.ensure_consistency(0.0)
+
+    bed_uplift.set(0.0)
+
+    bed_model.bootstrap(geometry.bed_elevation, bed_uplift, geometry.ice_thickness,
+                        geometry.sea_level_elevation)
+
+    Mx = int(grid.Mx())
+    My = int(grid.My())
+
+    for k in range(n_steps):
+        # an asymmetric load that moves and grows, so that errors in the layout of the
+        # (transposed, padded) spectral arrays would show up
+        with PISM.vec.Access(nocomm=geometry.ice_thickness):
+            for (i, j) in grid.points():
+                if abs(i - (Mx // 3 + k)) < 2 and abs(j - My // 4) < 3:
+                    geometry.ice_thickness[i, j] = 500.0 * (k + 1)
+                else:
+                    geometry.ice_thickness[i, j] = 0.0
+
+        bed_model.step(geometry.ice_thickness, geometry.sea_level_elevation, dt)
+
+    return (bed_model.total_displacement().numpy(),
+            bed_model.bed_elevation().numpy())
+
+def lc_mpi_viscous_test():
+    "Compare serial and distributed versions of the Lingle-Clark model (viscous response)"
+    if not PISM.Pism_USE_FFTW_MPI:
+        raise SkipTest("PISM was built without FFTW's MPI interface")
+
+    ctx = PISM.Context()
+    config = ctx.config
+
+    model = config.get_string("bed_deformation.model")
+
+    # a non-square grid with odd sizes: the extended grid used by the FFT is padded
+    # differently in x and y
+    grid = PISM.IceGrid.Shallow(ctx.ctx, 2000e3, 3000e3, 0, 0, 13, 21,
+                                PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+    dt = PISM.util.convert(100, "years", "seconds")
+    n_steps = 5
+
+    try:
+        config.set_string("bed_deformation.model", "lc")
+        db_serial, topg_serial = run_viscous(grid, n_steps, dt)
+
+        config.set_string("bed_deformation.model", "lc_mpi")
+        db_parallel, topg_parallel = run_viscous(grid, n_steps, dt)
+    finally:
+        config.set_string("bed_deformation.model", model)
+
+    # make sure the viscous part of the model did something
+    assert np.max(np.fabs(db_serial)) > 1.0
+
+    np.testing.assert_allclose(db_parallel, db_serial, rtol=1e-10, atol=1e-8)
+    np.testing.assert_allclose(topg_parallel, topg_serial, rtol=1e-10, atol=1e-8)
@@ -25,7 +25,9 @@ backend_names = {PISM.PISM_NETCDF3 : "netcdf3",
                  PISM.PISM_PIO_NETCDF : "pio_netcdf",
                  PISM.PISM_PIO_NETCDF4P : "pio_netcdf4p",
                  PISM.PISM_PIO_NETCDF4C : "pio_netcdf4c",
-                 PISM.PISM_PIO_PNETCDF: "pio_pnetcdf"}
+                 PISM.PISM_PIO_PNETCDF: "pio_pnetcdf",
+                 PISM.PISM_NETCDF3_ASYNC : "netcdf3_async",
+                 PISM.PISM_MPIIO : "mpiio"}
 
 def fail(backend):
     assert False, "test failed (backend = {})".format(backend_names[backend])
@@ -42,6 +44,76 @@ def test_string_to_backend():
     except RuntimeError:
         pass
 
+def test_async_backend():
+    "File(..., PISM_NETCDF3_ASYNC, ...)"
+
+    filename = "test_async_backend.nc"
+    try:
+        f = PISM.File(ctx.com(), filename, PISM.PISM_NETCDF3_ASYNC, PISM.PISM_READWRITE_CLOBBER,
+                      ctx.pio_iosys_id())
+        f.define_dimension("x", 3)
+        f.define_variable("v", PISM.PISM_DOUBLE, ["x"])
+        f.write_attribute("v", "units", "m")
+        # metadata are available before pending writes are done
+        assert f.read_text_attribute("v", "units") == "m"
+        assert f.dimension_length("x") == 3
+        f.write_variable("v", [0], [3], [1.0, 2.0, 3.0])
+        assert f.read_variable("v", [1], [1]) == (2.0,)
+        f.close()
+
+        # opening a file waits for pending writes to it
+        f = PISM.File(ctx.com(), filename, PISM.PISM_NETCDF3, PISM.PISM_READONLY,
+                      ctx.pio_iosys_id())
+        assert f.read_variable("v", [0], [3]) == (1.0, 2.0, 3.0)
+        assert f.read_text_attribute("v", "units") == "m"
+        f.close()
+    finally:
+        os.remove(filename)
+
+def test_mpiio_backend():
+    "File(..., PISM_MPIIO, ...)"
+
+    filename = "test_mpiio_backend.nc"
+    try:
+        f = PISM.File(ctx.com(), filename, PISM.PISM_NETCDF3, PISM.PISM_READWRITE_CLOBBER,
+                      ctx.pio_iosys_id())
+        f.define_dimension("time", PISM.PISM_UNLIMITED)
+        f.define_dimension("x", 3)
+        f.define_variable("time", PISM.PISM_DOUBLE, ["time"])
+        f.define_variable("v", PISM.PISM_FLOAT, ["time", "x"])
+        f.define_variable("w", PISM.PISM_SHORT, ["x"])
+        f.write_attribute("v", "units", "m")
+        f.write_attribute("w", PISM.PISM_DOUBLE, "valid_range", [-1.0, 1.0])
+        f.write_attribute("PISM_GLOBAL", "title", "MPI-IO test")
+        f.write_variable("time", [0], [2], [0.0, 1.0])
+        f.write_variable("v", [0, 0], [2, 3], [1.0, 2.0, 3.0, 4.0, 5.0, 6.0])
+        f.write_variable("w", [0], [3], [-1.0, 0.0, 1.0])
+        f.close()
+
+        f = PISM.File(ctx.com(), filename, PISM.PISM_MPIIO, PISM.PISM_READONLY,
+                      ctx.pio_iosys_id())
+        assert f.backend() == PISM.PISM_MPIIO
+        assert f.nrecords() == 2
+        assert f.dimension_length("x") == 3
+        assert f.dimensions("v") == ("time", "x")
+        assert f.read_text_attribute("v", "units") == "m"
+        assert f.read_double_attribute("w", "valid_range") == (-1.0, 1.0)
+        assert f.read_text_attribute("PISM_GLOBAL", "title") == "MPI-IO test"
+        assert f.read_variable("time", [0], [2]) == (0.0, 1.0)
+        assert f.read_variable("v", [1, 1], [1, 2]) == (5.0, 6.0)
+        assert f.read_variable("w", [0], [3]) == (-1.0, 0.0, 1.0)
+
+        # this backend is read-only
+        try:
+            f.write_attribute("v", "units", "km")
+            assert False
+        except RuntimeError:
+            pass
+
+        f.close()
+    finally:
+        os.remove(filename)
+
 class File(TestCase):
 
     def test_empty_filename(self):
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Compare implicit and explicit time stepping in the routing and distributed
+subglacial hydrology models.
+"""
+from unittest import TestCase
+import numpy as np
+
+import PISM
+ctx = PISM.Context()
+ctx.log.set_threshold(1)
+
+day = 86400.0
+
+class ImplicitHydrology(TestCase):
+    def setUp(self):
+        # a 20 km by 20 km grid
+        L = 10e3
+        M = 21
+
+        grid = PISM.IceGrid.Shallow(ctx.ctx, L, L, 0, 0, M, M,
+                                    PISM.CELL_CENTER, PISM.NOT_PERIODIC)
+        self.grid = grid
+
+        geometry = PISM.Geometry(grid)
+        self.geometry = geometry
+
+        # grounded ice on a sloping bed with a bump
+        with PISM.vec.Access(nocomm=[geometry.bed_elevation, geometry.ice_thickness]):
+            for (i, j) in grid.points():
+                x = grid.x(i) / L
+                y = grid.y(j) / L
+                geometry.bed_elevation[i, j] = 100.0 * (1.0 + x) + 20.0 * np.exp(-4.0 * (x**2 + y**2))
+                geometry.ice_thickness[i, j] = 1000.0 - 200.0 * x
+        geometry.bed_elevation.update_ghosts()
+        geometry.sea_level_elevation.set(-1000.0)
+        geometry.ice_area_specific_volume.set(0.0)
+        geometry.ensure_consistency(0.0)
+
+        # water input in a patch up-glacier
+        water_input = PISM.IceModelVec2S(grid, "water_input_rate", PISM.WITHOUT_GHOSTS)
+        water_input.set_attrs("", "water input rate", "kg m-2 s-1", "kg m-2 s-1", "", 0)
+        with PISM.vec.Access(nocomm=water_input):
+            for (i, j) in grid.points():
+                x = grid.x(i) / L
+                y = grid.y(j) / L
+                if abs(x - 0.5) < 0.25 and abs(y) < 0.25:
+                    water_input[i, j] = 1000.0 * 1e-6 # 1 micrometer per second
+                else:
+                    water_input[i, j] = 0.0
+        self.water_input = water_input
+
+        zero = PISM.IceModelVec2S(grid, "zero", PISM.WITHOUT_GHOSTS)
+        zero.set(0.0)
+        self.zero = zero
+
+        sliding_speed = PISM.IceModelVec2S(grid, "sliding_speed", PISM.WITHOUT_GHOSTS)
+        sliding_speed.set(PISM.util.convert(50.0, "m / year", "m / s"))
+        self.sliding_speed = sliding_speed
+
+        self.inputs = PISM.HydrologyInputs()
+        self.inputs.no_model_mask = None
+        self.inputs.geometry = geometry
+        self.inputs.surface_input_rate = water_input
+        self.inputs.basal_melt_rate = zero
+        self.inputs.ice_sliding_speed = sliding_speed
+
+        self.saved = PISM.DefaultConfig(ctx.com, "saved", "-config", ctx.unit_system)
+        self.saved.init_with_default(ctx.log)
+        self.saved.import_from(ctx.config)
+
+        ctx.config.set_flag("hydrology.add_water_input_to_till_storage", False)
+
+    def tearDown(self):
+        ctx.config.import_from(self.saved)
+
+    def run_model(self, model_class, implicit, max_dt_days=1.0):
+        "Run a model for 30 days. Returns W and P (on rank 0) and the number of steps."
+        config = ctx.config
+        config.set_flag("hydrology.routing.implicit.enabled", implicit)
+        config.set_number("hydrology.maximum_time_step", max_dt_days / 365.0)
+
+        model = model_class(self.grid)
+        model.init(self.zero, self.zero, self.zero)
+
+        steps = 0
+        t, dt = 0.0, day
+        for k in range(30):
+            model.update(t, dt, self.inputs)
+            steps += model.solver_stats().steps
+            t += dt
+
+        return (model.subglacial_water_thickness().numpy(),
+                model.subglacial_water_pressure().numpy(),
+                steps)
+
+    def compare(self, model_class):
+        W_explicit, P_explicit, explicit_steps = self.run_model(model_class, False)
+
+        W_1, P_1, implicit_steps = self.run_model(model_class, True, 1.0)
+        W_2, P_2, _ = self.run_model(model_class, True, 0.5)
+
+        if ctx.rank != 0:
+            return
+
+        # implicit steps are limited by hydrology.maximum_time_step only
+        assert implicit_steps < explicit_steps
+
+        assert np.max(W_explicit) > 0.0
+
+        for name, explicit, coarse, fine in [("W", W_explicit, W_1, W_2),
+                                             ("P", P_explicit, P_1, P_2)]:
+            scale = np.max(np.abs(explicit))
+            if scale == 0.0:
+                continue
+
+            error_coarse = np.max(np.abs(coarse - explicit)) / scale
+            error_fine = np.max(np.abs(fine - explicit)) / scale
+
+            ctx.log.message(1, "{}: relative differences {}, {}\n".format(name,
+                                                                          error_coarse,
+                                                                          error_fine))
+
+            # backward Euler is first order: the difference has to be small and has to
+            # decrease when the time step is reduced
+            assert error_fine < 0.05, name
+            assert error_fine < 0.75 * error_coarse or error_fine < 1e-6, name
+
+    def routing_test(self):
+        "Routing: implicit time stepping approximates explicit time stepping"
+        self.compare(PISM.RoutingHydrology)
+
+    def distributed_test(self):
+        "Distributed: implicit time stepping approximates explicit time stepping"
+        self.compare(PISM.DistributedHydrology)
@@ -116,6 +116,43 @@ class SteadyHydrology(TestCase):
         assert relative_error < 1e-5
         ctx.log.message(1, "relative error: {}\n".format(relative_error))
 
+    def flow_accumulation_test(self):
+        "Test that flow accumulation gives the limit of the emptying problem iterations."
+        config = ctx.config
+
+        water_input_rate = PISM.IceModelVec2S(self.grid, "water_input_rate", PISM.WITHOUT_GHOSTS)
+        water_input_rate.copy_from(self.surface_input_rate)
+        water_input_rate.scale(1.0 / config.get_number("constants.fresh_water.density"))
+
+        def flux(method):
+            config.set_string("hydrology.steady.method", method)
+            problem = PISM.EmptyingProblem(self.grid)
+            problem.update(self.geometry, None, water_input_rate)
+            return problem.flux().numpy()
+
+        volume_ratio = config.get_number("hydrology.steady.volume_ratio")
+        n_iterations = config.get_number("hydrology.steady.n_iterations")
+        try:
+            # iterate until almost all the water left the domain
+            config.set_number("hydrology.steady.volume_ratio", 1e-8)
+            config.set_number("hydrology.steady.n_iterations", 1e6)
+
+            relaxation = flux("relaxation")
+            accumulation = flux("flow_accumulation")
+        finally:
+            config.set_string("hydrology.steady.method", "relaxation")
+            config.set_number("hydrology.steady.volume_ratio", volume_ratio)
+            config.set_number("hydrology.steady.n_iterations", n_iterations)
+
+        if ctx.rank == 0:
+            Q_max = np.max(np.abs(relaxation))
+            assert Q_max > 0.0
+
+            error = np.max(np.abs(accumulation - relaxation)) / Q_max
+            ctx.log.message(1, "relative difference: {}\n".format(error))
+
+            assert error < 1e-5
+
     def write_results(self):
         geometry = self.geometry
         model = self.model
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Compare full and incremental iceberg removal (geometry.remove_icebergs_incremental)
+during a calving sequence that detaches a floating piece spanning several sub-domains.
+Run this using 4 MPI processes.
+"""
+
+import numpy as np
+import PISM
+
+ctx = PISM.Context()
+config = ctx.config
+
+Mx, My = 41, 31
+
+grid = PISM.IceGrid.Shallow(ctx.ctx, 2e5, 1.5e5, 0, 0, Mx, My,
+                            PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+def create(incremental):
+    "Create a geometry and an iceberg remover"
+    geometry = PISM.Geometry(grid)
+
+    # grounded ice along the western edge, an ice shelf everywhere else
+    with PISM.vec.Access(nocomm=geometry.bed_elevation):
+        for (i, j) in grid.points():
+            geometry.bed_elevation[i, j] = 100.0 if i < 3 else -1000.0
+    geometry.bed_elevation.update_ghosts()
+    geometry.sea_level_elevation.set(0.0)
+    geometry.ice_thickness.set(500.0)
+    geometry.ice_area_specific_volume.set(0.0)
+    geometry.ensure_consistency(0.0)
+
+    config.set_flag("geometry.remove_icebergs_incremental", incremental)
+    remover = PISM.IcebergRemover(grid)
+    remover.init()
+
+    return geometry, remover
+
+def calve(geometry, cells):
+    "Remove ice from `cells`"
+    with PISM.vec.Access(nocomm=geometry.ice_thickness):
+        for (i, j) in grid.points():
+            if (i, j) in cells:
+                geometry.ice_thickness[i, j] = 0.0
+    geometry.ensure_consistency(0.0)
+
+# The calving sequence. Sub-domain boundaries are near i = Mx / 2 and j = My / 2.
+column = 3 * Mx // 4
+sequence = [
+    # calving front retreat next to grounded ice (full labeling can be skipped)
+    {(5, 2), (6, My - 3)},
+    # nothing changes
+    set(),
+    # retreat at the eastern calving front
+    {(Mx - 1, j) for j in range(My)},
+    # an isolated cell becomes an iceberg
+    {(9, 9), (11, 9), (10, 8), (10, 10)},
+]
+# a crack spreading south from the northern edge, cutting off the eastern part of the
+# shelf (spanning the boundary between the northern and southern sub-domains)
+for j_start in range(My - 4, -4, -4):
+    sequence.append({(column, j) for j in range(max(j_start, 0), My)})
+
+bc_mask = PISM.IceModelVec2Int(grid, "bc_mask", PISM.WITHOUT_GHOSTS)
+bc_mask.set(0.0)
+
+full, full_remover = create(False)
+incremental, incremental_remover = create(True)
+
+# all collective operations come first: rank 0 should not stop with an error while
+# other ranks are waiting for it
+results = []
+for cells in sequence:
+    for geometry, remover in [(full, full_remover), (incremental, incremental_remover)]:
+        calve(geometry, cells)
+        remover.update(bc_mask, geometry.cell_type, geometry.ice_thickness)
+
+    results.append((full.ice_thickness.numpy(), incremental.ice_thickness.numpy()))
+
+config.set_flag("geometry.remove_icebergs_incremental", False)
+
+if ctx.rank == 0:
+    for k, (H_full, H_incremental) in enumerate(results):
+        # results have to be identical
+        np.testing.assert_array_equal(H_incremental, H_full, err_msg="step {}".format(k))
+
+    H_final = results[-1][0]
+    # the isolated cell was removed
+    assert H_final[9, 10] == 0.0
+    # the part of the shelf east of the crack was removed...
+    assert np.all(H_final[:, column:] == 0.0)
+    # ... and the rest was not
+    assert H_final[My // 2, Mx // 2] == 500.0
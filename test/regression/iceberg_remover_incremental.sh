@@ -0,0 +1,15 @@
+#!/bin/bash
+
+# Compare full and incremental iceberg removal using 4 processes.
+
+PISM_PATH=$1
+MPIEXEC=$2
+PISM_SOURCE_DIR=$3
+PYTHONEXEC=$5
+
+export PYTHONPATH=${PISM_PATH}/site-packages:${PYTHONPATH}
+
+set -e
+set -x
+
+$MPIEXEC -n 4 $PYTHONEXEC $PISM_SOURCE_DIR/test/regression/iceberg_remover_incremental.py
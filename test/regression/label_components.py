@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""Compare PISM.label_components() to scipy.ndimage.label() using a mask with
+components spanning several sub-domains. Run this using several MPI processes.
+"""
+
+import numpy as np
+import scipy.ndimage
+import PISM
+
+ctx = PISM.Context()
+
+M = 41
+
+grid = PISM.IceGrid.Shallow(ctx.ctx, 1e5, 1e5, 0, 0, M, M,
+                            PISM.CELL_CORNER, PISM.NOT_PERIODIC)
+
+# 0 - background, 1 - "floating", 2 - "grounded"
+image = np.zeros((M, M), dtype=int)
+
+# A "snake" going back and forth across the domain. Every row of it crosses the
+# boundary between sub-domains, so the snake consists of many local components and
+# merging them takes more rounds than there are sub-domains.
+for k, j in enumerate(range(1, 30, 4)):
+    image[j, 1:M - 1] = 1
+    if j + 4 < 30:
+        column = M - 2 if k % 2 == 0 else 1
+        image[j:j + 4, column] = 1
+# the only "grounded" cell is at the far end of the snake
+image[1, 1] = 2
+
+# random blobs in the rest of the domain (the seed is the same on all ranks)
+np.random.seed(1)
+image[32:, :] = np.random.choice([0, 1, 2], size=(M - 32, M), p=[0.4, 0.5, 0.1])
+
+mask = PISM.IceModelVec2Int(grid, "mask", PISM.WITHOUT_GHOSTS)
+work = PISM.IceModelVec2V(grid, "work", PISM.WITH_GHOSTS, 1)
+
+def set_mask():
+    with PISM.vec.Access(nocomm=mask):
+        for (i, j) in grid.points():
+            mask[i, j] = image[j, i]
+
+# all collective operations come first: rank 0 should not stop with an error while
+# other ranks are waiting for it
+set_mask()
+PISM.label_components(mask, False, 0, work)
+labels = mask.numpy()
+
+set_mask()
+PISM.label_components(mask, True, 2, work)
+icebergs = mask.numpy()
+
+set_mask()
+PISM.label_components(mask, True, 2)
+icebergs_default = mask.numpy()
+
+if ctx.rank == 0:
+    # label components (4-connectivity)
+    expected_labels, _ = scipy.ndimage.label(image > 0)
+
+    # "icebergs" are components that do not contain cells marked as "grounded"
+    grounded = np.unique(expected_labels[image == 2])
+    expected_icebergs = np.logical_and(expected_labels > 0,
+                                       np.logical_not(np.isin(expected_labels, grounded)))
+
+    np.testing.assert_equal(labels, expected_labels)
+    np.testing.assert_equal(icebergs == 1, expected_icebergs)
+    np.testing.assert_equal(icebergs_default, icebergs)
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# Test connected component labeling using a mask with components spanning several
+# sub-domains.
+
+PISM_PATH=$1
+MPIEXEC=$2
+PISM_SOURCE_DIR=$3
+PYTHONEXEC=$5
+
+export PYTHONPATH=${PISM_PATH}/site-packages:${PYTHONPATH}
+
+set -e
+set -x
+
+$MPIEXEC -n 4 $PYTHONEXEC $PISM_SOURCE_DIR/test/regression/label_components.py
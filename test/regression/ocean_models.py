@@ -166,7 +166,10 @@ class GivenTHTest(TestCase):
         self.grid = shallow_grid()
         self.geometry = PISM.Geometry(self.grid)
 
+        # GivenTH computes outputs in floating areas only
+        self.geometry.bed_elevation.set(-2 * depth)
         self.geometry.ice_thickness.set(depth)
+        self.geometry.ensure_consistency(0.0)
 
         filename = "ocean_given_th_input.nc"
         self.filename = filename
@@ -196,6 +199,20 @@ class GivenTHTest(TestCase):
 
         check_model(model, self.temperature, self.mass_flux, self.melange_back_pressure)
 
+    def test_ocean_th_grounded(self):
+        "Model GivenTH: fill values in grounded areas"
+
+        self.geometry.bed_elevation.set(0.0)
+        self.geometry.ensure_consistency(0.0)
+
+        model = PISM.OceanGivenTH(self.grid)
+        model.init(self.geometry)
+        model.update(self.geometry, 0, 1)
+
+        T0 = config.get_number("constants.fresh_water.melting_point_temperature")
+
+        check_model(model, T0, 0.0, self.melange_back_pressure)
+
     def tearDown(self):
         os.remove(self.filename)
 
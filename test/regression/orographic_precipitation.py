@@ -1,4 +1,6 @@
 #!/usr/bin/env python3
+from unittest import SkipTest
+
 import numpy as np
 
 import PISM
@@ -171,5 +173,26 @@ def ltop_test(dxs=[2000, 1000, 500], plot=False):
     assert convergence_rate(dxs, max_error, 180, plot) > 1.99
     assert convergence_rate(dxs, max_error, 270, plot) > 1.99
 
+def ltop_fftw_mpi_test():
+    "Compare serial and distributed implementations of the orographic precipitation model"
+    if not PISM.Pism_USE_FFTW_MPI:
+        raise SkipTest("PISM was built without FFTW's MPI interface")
+
+    config = PISM.Context().config
+
+    grid = triangle_ridge_grid(dx=2000)
+    orography = np.tile(triangle_ridge(np.array(grid.x())), (grid.My(), 1))
+
+    try:
+        config.set_flag("atmosphere.orographic_precipitation.fftw_mpi", False)
+        P_serial = run_model(grid, orography)
+
+        config.set_flag("atmosphere.orographic_precipitation.fftw_mpi", True)
+        P_parallel = run_model(grid, orography)
+    finally:
+        config.set_flag("atmosphere.orographic_precipitation.fftw_mpi", False)
+
+    np.testing.assert_allclose(P_parallel, P_serial, rtol=1e-10, atol=1e-14)
+
 if __name__ == "__main__":
     ltop_test(dxs=[2000, 1000, 500, 250, 125], plot=True)
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+
+"""Performance regression test.
+
+Runs one of a fixed set of small, production-like pismr configurations several times,
+records the time spent in selected profiling regions (see pismr's -profile_regions) and
+the peak resident set size, and compares them to a baseline.
+
+Regions are compared using the minimum (over repeated runs) of the maximum (over
+processes) time. A region is "slower" if its time exceeds the baseline by more than the
+relative tolerance plus a small absolute slack (to ignore noise in short regions).
+
+Baselines depend on the machine, the compiler and the number of processes. Record them
+using --update-baseline. Tests without a baseline for the current number of processes
+are skipped (return code 77).
+"""
+
+import json
+import os
+import shlex
+import subprocess
+import sys
+from argparse import ArgumentParser
+
+SKIP = 77
+
+# Number of processes used by all cases
+N_PROCESSES = 2
+
+# Options shared by all cases. The input file is created by setup() below; runs start at
+# the end of the setup run (year 1000).
+COMMON = "-i perf_input.nc -surface given -surface_given_file perf_input.nc -y 100 -o_size small"
+
+# Configurations and profiling regions checked in each of them
+CASES = {
+    "sia": {
+        "options": "-stress_balance sia",
+        "regions": ["step", "stress_balance", "energy", "mass_transport"],
+    },
+    "ssafd": {
+        "options": "-stress_balance ssa+sia -ssa_method fd -yield_stress constant -tauc 1e5",
+        "regions": ["step", "stress_balance.shallow", "energy"],
+    },
+    "io": {
+        "options": ("-stress_balance sia -extra_times 1000:10:1100 -extra_file perf_extra.nc"
+                    " -extra_vars thk,usurf,velsurf_mag,temp,enthalpy"),
+        "regions": ["io.extra_file", "io.model_state"],
+    },
+}
+
+
+def process_arguments():
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument("PISM_PATH")
+    parser.add_argument("MPIEXEC")
+    parser.add_argument("PISM_SOURCE_DIR")
+    parser.add_argument("--case", choices=sorted(CASES.keys()), required=True)
+    parser.add_argument("--baseline", required=True, help="JSON file containing baselines")
+    parser.add_argument("--repeat", type=int, default=2, help="number of runs")
+    parser.add_argument("--tolerance", type=float, default=0.25,
+                        help="relative tolerance for run times")
+    parser.add_argument("--slack", type=float, default=0.05,
+                        help="absolute tolerance for run times, in seconds")
+    parser.add_argument("--memory_tolerance", type=float, default=0.1,
+                        help="relative tolerance for the peak resident set size")
+    parser.add_argument("--update-baseline", dest="update", action="store_true",
+                        help="save measured values as the baseline for this case")
+
+    return parser.parse_args()
+
+
+def mpi_command(opts, executable, options):
+    mpiexec = shlex.split(opts.MPIEXEC)
+    if mpiexec:
+        mpiexec += ["-n", str(N_PROCESSES)]
+    return mpiexec + [os.path.join(opts.PISM_PATH, executable)] + shlex.split(options)
+
+
+def run(command):
+    print(" ".join(command))
+    sys.stdout.flush()
+    subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+
+
+def setup(opts):
+    "Create the input file (an EISMINT II experiment A state) if it does not exist."
+    if os.path.exists("perf_input.nc"):
+        return
+
+    run(mpi_command(opts, "pisms",
+                    "-eisII A -Mx 61 -My 61 -Mz 41 -y 1000 -o_size big -o perf_input.nc"))
+
+
+def measure(opts, case):
+    "Run `case` opts.repeat times and return region times and the peak RSS."
+    times = {}
+    memory = []
+    for k in range(opts.repeat):
+        report = "perf_{}_{}.json".format(opts.case, k)
+        options = " ".join([COMMON, case["options"],
+                            "-o perf_{}.nc -profile_regions {}".format(opts.case, report)])
+        run(mpi_command(opts, "pismr", options))
+
+        with open(report) as f:
+            data = json.load(f)
+
+        memory.append(data["peak_resident_set_size"])
+        for region in data["regions"]:
+            name = region["name"]
+            if name in case["regions"]:
+                times[name] = min(times.get(name, region["time_max"]), region["time_max"])
+
+    missing = [r for r in case["regions"] if r not in times]
+    if missing:
+        raise RuntimeError("regions {} were not found in profiling reports".format(missing))
+
+    return {"n_processes": N_PROCESSES,
+            "regions": times,
+            "peak_resident_set_size": min(memory)}
+
+
+def load_baselines(filename):
+    try:
+        with open(filename) as f:
+            return json.load(f)
+    except FileNotFoundError:
+        return {"cases": {}}
+
+
+def compare(opts, result, baseline):
+    "Return the list of regressions."
+    failures = []
+
+    print("{:<30} {:>12} {:>12}".format("region", "time (s)", "baseline (s)"))
+    for name, time in sorted(result["regions"].items()):
+        reference = baseline["regions"].get(name)
+        if reference is None:
+            print("{:<30} {:>12.3f} {:>12}".format(name, time, "-"))
+            continue
+
+        print("{:<30} {:>12.3f} {:>12.3f}".format(name, time, reference))
+        if time > reference * (1.0 + opts.tolerance) + opts.slack:
+            failures.append("{}: {:.3f} s (baseline: {:.3f} s)".format(name, time, reference))
+
+    MiB = 2.0**20
+    rss = result["peak_resident_set_size"]
+    reference = baseline.get("peak_resident_set_size")
+    if reference:
+        print("peak resident set size: {:.1f} MiB (baseline: {:.1f} MiB)".format(rss / MiB,
+                                                                               reference / MiB))
+        if rss > reference * (1.0 + opts.memory_tolerance):
+            failures.append("peak resident set size: {:.1f} MiB (baseline: {:.1f} MiB)".format(
+                rss / MiB, reference / MiB))
+
+    return failures
+
+
+def main():
+    opts = process_arguments()
+    case = CASES[opts.case]
+
+    baselines = load_baselines(opts.baseline)
+    baseline = baselines["cases"].get(opts.case)
+
+    if not opts.update and (baseline is None or baseline["n_processes"] != N_PROCESSES):
+        print("No baseline for the case '{}' using {} processes in {}.".format(opts.case,
+                                                                            N_PROCESSES,
+                                                                            opts.baseline))
+        print("Re-run with --update-baseline to record one.")
+        return SKIP
+
+    setup(opts)
+    result = measure(opts, case)
+
+    if opts.update:
+        baselines["cases"][opts.case] = result
+        with open(opts.baseline, "w") as f:
+            json.dump(baselines, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("Saved the baseline for the case '{}' to {}".format(opts.case, opts.baseline))
+        return 0
+
+    failures = compare(opts, result, baseline)
+
+    if failures:
+        print("Performance regressions:")
+        for failure in failures:
+            print("  " + failure)
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
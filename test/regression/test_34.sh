@@ -0,0 +1,47 @@
+#!/bin/bash
+
+PISM_PATH=$1
+MPIEXEC=$2
+
+echo "Test #34: ensemble members read their own commands and write their own checkpoints."
+# The list of files to delete when done:
+files="in-34.nc out-34_member0.nc out-34_member1.nc cmd-34_member0 cmd-34_member1 ckpt-34.nc ckpt-34_member0.nc ckpt-34_member1.nc"
+
+set -e -x
+
+rm -f $files
+
+# Create the input file:
+$PISM_PATH/pisms -Mx 21 -My 21 -Mz 11 -y 100 -o in-34.nc
+
+# Members run to different times, so their checkpoints have to differ:
+cat > cmd-34_member0 <<END
+run_to 110
+checkpoint ckpt-34.nc
+exit
+END
+
+cat > cmd-34_member1 <<END
+run_to 150
+checkpoint ckpt-34.nc
+exit
+END
+
+$MPIEXEC -n 2 $PISM_PATH/pismr -i in-34.nc -ensemble_size 2 -commands cmd-34 -o out-34.nc
+
+set +e
+
+# Each member has to write its own checkpoint file...
+if [[ ! -f ckpt-34_member0.nc || ! -f ckpt-34_member1.nc || -f ckpt-34.nc ]];
+then
+    exit 1
+fi
+
+# ... and these files have to differ:
+$PISM_PATH/nccmp.py -v thk ckpt-34_member0.nc ckpt-34_member1.nc
+if [ $? == 0 ];
+then
+    exit 1
+fi
+
+rm -f $files; exit 0
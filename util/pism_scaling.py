@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+
+""" Compute parallel efficiency using reports of pismv scaling studies (see the
+-scaling and -scaling_report options of pismv).
+
+Uses the run with the smallest number of processes as the reference. Efficiency is
+T_ref / T_N for weak scaling and (T_ref * N_ref) / (T_N * N) for strong scaling,
+where T is the time per step and N is the number of processes.
+
+Regions with the load imbalance (the ratio of the maximum and the mean time) above a
+threshold are listed for each run.
+"""
+
+import json
+from argparse import ArgumentParser
+
+parser = ArgumentParser(description=__doc__)
+parser.add_argument("FILE", nargs="+", help="scaling study reports (JSON files)")
+parser.add_argument("--imbalance", type=float, default=1.2,
+                    help="load imbalance threshold")
+parser.add_argument("--fraction", type=float, default=0.05,
+                    help="only check regions taking at least this fraction of the run time")
+options = parser.parse_args()
+
+runs = []
+for filename in options.FILE:
+    with open(filename) as f:
+        runs.append(json.load(f))
+
+modes = set(r["mode"] for r in runs)
+if len(modes) > 1:
+    raise RuntimeError("cannot mix weak and strong scaling runs: {}".format(sorted(modes)))
+mode = modes.pop()
+
+runs.sort(key=lambda r: r["n_processes"])
+reference = runs[0]
+
+print("{} scaling, test {}".format(mode, reference["test"]))
+print("{:>8} {:>14} {:>14} {:>10}".format("N", "grid", "s per step", "efficiency"))
+for r in runs:
+    T = r["time_per_step"]
+    N = r["n_processes"]
+    T_ref = reference["time_per_step"]
+    N_ref = reference["n_processes"]
+
+    if mode == "weak":
+        efficiency = T_ref / T
+    else:
+        efficiency = (T_ref * N_ref) / (T * N)
+
+    grid = "{}x{}x{}".format(r["Mx"], r["My"], r["Mz"])
+    print("{:>8} {:>14} {:>14.4f} {:>10.3f}".format(N, grid, T, efficiency))
+
+for r in runs:
+    imbalanced = [region for region in r["regions"]
+                  if region["time_max"] >= options.fraction * r["wall_time"] and
+                  region["imbalance"] > options.imbalance]
+    imbalanced.sort(key=lambda region: -region["imbalance"])
+
+    if imbalanced:
+        print("\nload imbalance using {} processes:".format(r["n_processes"]))
+        for region in imbalanced:
+            print("  {:<30} {:>8.3f} (max {:.3f} s, mean {:.3f} s)".format(region["name"],
+                                                                       region["imbalance"],
+                                                                       region["time_max"],
+                                                                       region["time_mean"]))